@@ -98,6 +98,7 @@ testScriptsExt=(
     'invalidblockrequest.py'
 #    'forknotify.py'
     'p2p-acceptblock.py'
+    'performance.py'
 );
 
 if [ "x$ENABLE_ZMQ" = "x1" ]; then
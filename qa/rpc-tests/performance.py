@@ -0,0 +1,259 @@
+#!/usr/bin/env python2
+# Copyright (c) 2026 The Verus developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#
+# Performance regression test. Runs fixed PBaaS heavy workloads on a regtest network of three nodes and compares
+# block template latency, mempool acceptance rate, block propagation time, block connect time and RPC latency
+# with the baselines in performance_baselines.json. Baselines are specific to the host they were measured on, so
+# write them on the reference host with --writebaselines, and a metric without a baseline is only reported.
+#
+
+import sys; assert sys.version_info < (3,), ur"This script does not run under Python 3. Please use Python 2.7.x."
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal, assert_greater_than, initialize_chain_clean, \
+    start_nodes, connect_nodes_bi, sync_blocks, sync_mempools, p2p_port, rpc_port
+
+from decimal import Decimal
+import json
+import os
+import random
+import time
+
+BASELINES_FILE = os.path.join(os.path.dirname(os.path.abspath(__file__)), "performance_baselines.json")
+
+# sizes of the workloads, which are fixed so that each run measures the same work
+SPLIT_OUTPUTS = 200
+IDENTITY_COUNT = 25
+CONVERSION_COUNT = 25
+TEMPLATE_SAMPLES = 20
+PROPAGATION_SAMPLES = 10
+RPC_SAMPLES = 50
+
+def median(values):
+    ordered = sorted(values)
+    mid = len(ordered) // 2
+    if len(ordered) % 2:
+        return ordered[mid]
+    return (ordered[mid - 1] + ordered[mid]) / 2.0
+
+def timed_ms(fn, *args):
+    start = time.time()
+    result = fn(*args)
+    return ((time.time() - start) * 1000.0, result)
+
+class PerformanceTest(BitcoinTestFramework):
+
+    def add_options(self, parser):
+        parser.add_option("--writebaselines", dest="writebaselines", default=False, action="store_true",
+                          help="Store the measured values as the new baselines instead of comparing with them")
+        parser.add_option("--tolerance", dest="tolerance", default=None, type="float",
+                          help="Allowed fraction worse than a baseline, overriding the tolerance of each metric")
+
+    def setup_chain(self):
+        print("Initializing test directory "+self.options.tmpdir)
+        self.num_nodes = 3
+        initialize_chain_clean(self.options.tmpdir, self.num_nodes)
+
+    def setup_network(self, split = False):
+        extra_args = []
+        for i in range(self.num_nodes):
+            extra_args.append(['-chain=VRSCTEST', '-regtest', '-port=%d' % p2p_port(i), '-rpcport=%d' % rpc_port(i),
+                               '-rpcuser=rt', '-rpcpassword=rt', '-whitelist=127.0.0.1', '-daemon'])
+        self.nodes = start_nodes(self.num_nodes, self.options.tmpdir, extra_args)
+        connect_nodes_bi(self.nodes, 0, 1)
+        connect_nodes_bi(self.nodes, 0, 2)
+        connect_nodes_bi(self.nodes, 1, 2)
+        self.is_network_split = False
+        self.sync_all()
+
+    def record(self, name, value):
+        print("%-32s %12.3f" % (name, value))
+        self.metrics[name] = value
+
+    def mine(self, count = 1):
+        hashes = self.nodes[0].generate(count)
+        sync_blocks(self.nodes)
+        return hashes
+
+    def reset_connect_stats(self):
+        for node in self.nodes:
+            node.getvalidationstats(False, True)
+
+    def record_connect_time(self, name):
+        # the relay nodes only connect the blocks, so their times are not mixed with template creation
+        stats = self.nodes[1].getvalidationstats()
+        self.record(name, stats['totals']['msperblock'])
+
+    def record_template_latency(self, name):
+        times = []
+        for i in range(TEMPLATE_SAMPLES):
+            times.append(timed_ms(self.nodes[0].getblocktemplate)[0])
+        self.record(name, median(times))
+
+    def wait_for_block(self, node, blockhash):
+        while node.getbestblockhash() != blockhash:
+            time.sleep(0.005)
+
+    def split_funds(self, node):
+        # one output for each transaction of the acceptance workload
+        self.split_addresses = [node.getnewaddress() for i in range(SPLIT_OUTPUTS)]
+        amounts = {}
+        for address in self.split_addresses:
+            amounts[address] = Decimal("1.0")
+        node.sendmany("", amounts)
+        self.mine()
+
+    def mempool_acceptance(self, node, rng):
+        # sign all of the transactions first, so only their acceptance is timed
+        signed = []
+        for utxo in node.listunspent(1):
+            if utxo['address'] not in self.split_addresses or utxo['amount'] != Decimal("1.0"):
+                continue
+            fee = Decimal("0.0001") * rng.randint(1, 10)
+            raw = node.createrawtransaction([{"txid": utxo['txid'], "vout": utxo['vout']}],
+                                            {node.getnewaddress(): Decimal("1.0") - fee})
+            signed.append(node.signrawtransaction(raw)['hex'])
+        assert_equal(len(signed), SPLIT_OUTPUTS)
+
+        start = time.time()
+        for txhex in signed:
+            node.sendrawtransaction(txhex)
+        elapsed = time.time() - start
+        assert_equal(node.getmempoolinfo()['size'], SPLIT_OUTPUTS)
+        self.record("mempool_accept_tx_per_sec", len(signed) / elapsed)
+        sync_mempools(self.nodes)
+
+    def block_propagation(self):
+        times = []
+        for i in range(PROPAGATION_SAMPLES):
+            for peer in range(1, self.num_nodes):
+                self.nodes[peer].sendtoaddress(self.nodes[0].getnewaddress(), Decimal("0.1"))
+            sync_mempools(self.nodes)
+            start = time.time()
+            blockhash = self.nodes[0].generate(1)[0]
+            for peer in range(1, self.num_nodes):
+                self.wait_for_block(self.nodes[peer], blockhash)
+            times.append((time.time() - start) * 1000.0)
+        self.record("block_propagation_ms", median(times))
+
+    def register_identities(self, node, prefix, count, metric = None):
+        address = node.getnewaddress()
+        commitments = [node.registernamecommitment("%s%d" % (prefix, i), address) for i in range(count)]
+        self.mine()
+        start = time.time()
+        for i in range(count):
+            node.registeridentity({"txid": commitments[i]['txid'],
+                                   "namereservation": commitments[i]['namereservation'],
+                                   "identity": {"name": "%s%d" % (prefix, i),
+                                                "primaryaddresses": [address],
+                                                "minimumsignatures": 1}})
+        if metric:
+            self.record(metric, count / (time.time() - start))
+        sync_mempools(self.nodes)
+        return address
+
+    def launch_basket(self, node):
+        # a fractional basket backed by the native currency, which the conversion workload converts into
+        self.register_identities(node, "perfbasket", 1)
+        self.mine()
+        # definecurrency returns the signed definition, which is only relayed when it is sent
+        definition = node.definecurrency({"name": "perfbasket0", "options": 33, "currencies": ["VRSCTEST"],
+                                          "weights": [1], "initialsupply": 1000, "initialcontributions": [1000]})
+        node.sendrawtransaction(definition['hex'])
+        self.mine()
+        definition = node.getcurrency("perfbasket0")
+        # after its start block the basket is launched with the first notarization of the chain
+        while node.getblockcount() <= definition['startblock'] + 1:
+            self.mine()
+        assert_greater_than(node.getcurrency("perfbasket0")['bestcurrencystate']['supply'], 0)
+
+    def conversions(self, node, address, rng):
+        start = time.time()
+        for i in range(CONVERSION_COUNT):
+            amount = Decimal(rng.randint(1, 100)) / 100
+            node.sendcurrency("*", [{"address": address, "currency": "VRSCTEST", "convertto": "perfbasket0",
+                                     "amount": amount}])
+        self.record("conversion_send_per_sec", CONVERSION_COUNT / (time.time() - start))
+        sync_mempools(self.nodes)
+        self.record_template_latency("conversion_template_latency_ms")
+
+    def rpc_latency(self, node):
+        calls = [("getinfo", []), ("getblockchaininfo", []), ("getmempoolinfo", []),
+                 ("getcurrency", ["perfbasket0"]), ("getidentity", ["perfid0@"]), ("listunspent", [])]
+        for name, args in calls:
+            fn = getattr(node, name)
+            times = [timed_ms(fn, *args)[0] for i in range(RPC_SAMPLES)]
+            self.record("rpc_%s_ms" % name, median(times))
+
+    def compare_with_baselines(self):
+        with open(BASELINES_FILE) as f:
+            baselines = json.load(f)
+
+        if self.options.writebaselines:
+            for name, value in self.metrics.items():
+                baselines['metrics'].setdefault(name, {"higherisbetter": name.endswith("_per_sec"), "tolerance": 0.25})
+                baselines['metrics'][name]['baseline'] = round(value, 3)
+            with open(BASELINES_FILE, 'w') as f:
+                json.dump(baselines, f, indent=4, sort_keys=True)
+                f.write("\n")
+            print("Wrote baselines to " + BASELINES_FILE)
+            return
+
+        regressions = []
+        for name, value in sorted(self.metrics.items()):
+            metric = baselines['metrics'].get(name)
+            if metric is None or metric.get('baseline') is None:
+                print("%s has no baseline, not compared" % name)
+                continue
+            tolerance = self.options.tolerance if self.options.tolerance is not None else metric['tolerance']
+            if metric['higherisbetter']:
+                limit = metric['baseline'] * (1 - tolerance)
+                regressed = value < limit
+            else:
+                limit = metric['baseline'] * (1 + tolerance)
+                regressed = value > limit
+            if regressed:
+                regressions.append("%s: %.3f, baseline %.3f, limit %.3f" % (name, value, metric['baseline'], limit))
+        if regressions:
+            raise AssertionError("performance regressions:\n  " + "\n  ".join(regressions))
+
+    def run_test(self):
+        # the same amounts and fees every run, so each run builds the same transactions and blocks
+        rng = random.Random(20260101)
+        self.metrics = {}
+        node = self.nodes[0]
+
+        print("Mining to mature coinbases...")
+        self.mine(150)
+        self.split_funds(node)
+
+        self.mempool_acceptance(node, rng)
+        self.record_template_latency("template_latency_ms")
+        self.reset_connect_stats()
+        self.mine()
+        self.record_connect_time("transfer_block_connect_ms")
+
+        self.block_propagation()
+
+        self.reset_connect_stats()
+        address = self.register_identities(node, "perfid", IDENTITY_COUNT, "identity_register_per_sec")
+        self.record_template_latency("identity_template_latency_ms")
+        self.mine()
+        self.record_connect_time("identity_block_connect_ms")
+
+        self.launch_basket(node)
+
+        # conversions are reserve transfers, exported to the basket and imported in the blocks that follow
+        self.reset_connect_stats()
+        self.conversions(node, address, rng)
+        self.mine(3)
+        self.record_connect_time("conversion_block_connect_ms")
+
+        self.rpc_latency(node)
+        self.compare_with_baselines()
+
+if __name__ == '__main__':
+    PerformanceTest().main()
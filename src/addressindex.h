@@ -9,6 +9,7 @@
 #include "uint256.h"
 #include "amount.h"
 #include "script/script.h"
+#include "pbaas/crosschainrpc.h"
 
 struct CAddressUnspentKey {
     unsigned int type;
@@ -222,25 +223,222 @@ struct CAddressIndexIteratorHeightKey {
     }
 };
 
+// writes n in an order preserving variable length form, so keys using it still sort by value in LevelDB. the top two
+// bits of the first byte give the length, 1, 2, 3 or 4 bytes holding 6, 14, 22 or 30 bits, and the largest 30 bit
+// value is followed by a 32 bit big endian value for anything that does not fit
+template<typename Stream>
+inline void ser_writeorderedvarint(Stream &s, uint32_t n)
+{
+    if (n < 0x40) {
+        ser_writedata8(s, n);
+    } else if (n < 0x4000) {
+        ser_writedata16be(s, 0x4000 | n);
+    } else if (n < 0x400000) {
+        ser_writedata8(s, 0x80 | (n >> 16));
+        ser_writedata16be(s, n & 0xffff);
+    } else if (n < 0x3fffffff) {
+        ser_writedata32be(s, 0xc0000000 | n);
+    } else {
+        ser_writedata32be(s, 0xffffffff);
+        ser_writedata32be(s, n);
+    }
+}
+
+template<typename Stream>
+inline uint32_t ser_readorderedvarint(Stream &s)
+{
+    uint32_t first = ser_readdata8(s);
+    switch (first >> 6) {
+        case 0:
+            return first;
+        case 1:
+            return ((first & 0x3f) << 8) | ser_readdata8(s);
+        case 2:
+            return ((first & 0x3f) << 16) | ser_readdata16be(s);
+    }
+    uint32_t n = ((first & 0x3f) << 24) | ((uint32_t)ser_readdata8(s) << 16) | ser_readdata16be(s);
+    return n == 0x3fffffff ? ser_readdata32be(s) : n;
+}
+
+inline size_t GetOrderedVarIntSize(uint32_t n)
+{
+    return n < 0x40 ? 1 : n < 0x4000 ? 2 : n < 0x400000 ? 3 : n < 0x3fffffff ? 4 : 8;
+}
+
+// the on-disk form of an address index key in the compact format. the transaction is referred to by its number in
+// the block, which the block tx number index maps to its txid, except for keys with an index height offset rather
+// than the height of their block, which carry the txid. the spending flag and txid presence are packed with the index
+struct CAddressIndexCompactKey {
+    enum {
+        FLAG_SPENDING = 1,
+        FLAG_TXID = 2
+    };
+
+    CAddressIndexKey key;
+    bool fTxid;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 21 + GetOrderedVarIntSize(key.blockHeight) + GetOrderedVarIntSize(key.txindex) +
+               GetOrderedVarIntSize(((uint32_t)key.index << 2) | 3) + (fTxid ? 32 : 0);
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writedata8(s, key.type);
+        key.hashBytes.Serialize(s);
+        ser_writeorderedvarint(s, key.blockHeight);
+        ser_writeorderedvarint(s, key.txindex);
+        ser_writeorderedvarint(s, ((uint32_t)key.index << 2) | (fTxid ? FLAG_TXID : 0) | (key.spending ? FLAG_SPENDING : 0));
+        if (fTxid) {
+            key.txhash.Serialize(s);
+        }
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        key.type = ser_readdata8(s);
+        key.hashBytes.Unserialize(s);
+        key.blockHeight = ser_readorderedvarint(s);
+        key.txindex = ser_readorderedvarint(s);
+        uint32_t packed = ser_readorderedvarint(s);
+        key.index = packed >> 2;
+        key.spending = (packed & FLAG_SPENDING) != 0;
+        fTxid = (packed & FLAG_TXID) != 0;
+        if (fTxid) {
+            key.txhash.Unserialize(s);
+        } else {
+            key.txhash.SetNull();
+        }
+    }
+
+    CAddressIndexCompactKey(const CAddressIndexKey &indexKey, bool withTxid) : key(indexKey), fTxid(withTxid) {}
+
+    CAddressIndexCompactKey() : fTxid(false) {}
+};
+
+// seeks to the first compact address index entry of an address at or above a height
+struct CAddressIndexCompactHeightKey {
+    unsigned int type;
+    uint160 hashBytes;
+    int blockHeight;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 21 + GetOrderedVarIntSize(blockHeight);
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writedata8(s, type);
+        hashBytes.Serialize(s);
+        ser_writeorderedvarint(s, blockHeight);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        type = ser_readdata8(s);
+        hashBytes.Unserialize(s);
+        blockHeight = ser_readorderedvarint(s);
+    }
+
+    CAddressIndexCompactHeightKey(unsigned int addressType, uint160 addressHash, int height) {
+        type = addressType;
+        hashBytes = addressHash;
+        blockHeight = height;
+    }
+};
+
+// a transaction's position in an active chain block, which compact address index keys refer to it by
+struct CBlockTxNumberKey {
+    int blockHeight;
+    unsigned int txindex;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return GetOrderedVarIntSize(blockHeight) + GetOrderedVarIntSize(txindex);
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writeorderedvarint(s, blockHeight);
+        ser_writeorderedvarint(s, txindex);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        blockHeight = ser_readorderedvarint(s);
+        txindex = ser_readorderedvarint(s);
+    }
+
+    CBlockTxNumberKey(int height, unsigned int blockindex) : blockHeight(height), txindex(blockindex) {}
+
+    CBlockTxNumberKey() : blockHeight(0), txindex(0) {}
+};
+
+// running totals for one address, keyed by CAddressIndexIteratorKey and kept in step with the address index, so the
+// current balance of an address can be read without walking its history
+struct CAddressBalanceValue {
+    CAmount balance;
+    CAmount received;
+    CCurrencyValueMap reserveBalance;
+    CCurrencyValueMap reserveReceived;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(balance);
+        READWRITE(received);
+        READWRITE(reserveBalance);
+        READWRITE(reserveReceived);
+    }
+
+    CAddressBalanceValue() {
+        SetNull();
+    }
+
+    void SetNull() {
+        balance = 0;
+        received = 0;
+        reserveBalance = CCurrencyValueMap();
+        reserveReceived = CCurrencyValueMap();
+    }
+
+    bool IsNull() const {
+        return !balance && !received && !reserveBalance.valueMap.size() && !reserveReceived.valueMap.size();
+    }
+
+    const CAddressBalanceValue &operator+=(const CAddressBalanceValue &operand) {
+        balance += operand.balance;
+        received += operand.received;
+        reserveBalance = (reserveBalance + operand.reserveBalance).CanonicalMap();
+        reserveReceived = (reserveReceived + operand.reserveReceived).CanonicalMap();
+        return *this;
+    }
+
+    const CAddressBalanceValue &operator-=(const CAddressBalanceValue &operand) {
+        balance -= operand.balance;
+        received -= operand.received;
+        reserveBalance = (reserveBalance - operand.reserveBalance).CanonicalMap();
+        reserveReceived = (reserveReceived - operand.reserveReceived).CanonicalMap();
+        return *this;
+    }
+};
+
 struct CMempoolAddressDelta
 {
     int64_t time;
     CAmount amount;
     uint256 prevhash;
     unsigned int prevout;
+    CCurrencyValueMap reserves;         // reserve currency change, negative when spending
 
-    CMempoolAddressDelta(int64_t t, CAmount a, uint256 hash, unsigned int out) {
+    CMempoolAddressDelta(int64_t t, CAmount a, uint256 hash, unsigned int out, const CCurrencyValueMap &r=CCurrencyValueMap()) {
         time = t;
         amount = a;
         prevhash = hash;
         prevout = out;
+        reserves = r;
     }
 
-    CMempoolAddressDelta(int64_t t, CAmount a) {
+    CMempoolAddressDelta(int64_t t, CAmount a, const CCurrencyValueMap &r=CCurrencyValueMap()) {
         time = t;
         amount = a;
         prevhash.SetNull();
         prevout = 0;
+        reserves = r;
     }
 };
 
@@ -10,6 +10,8 @@
 #include "streams.h"
 #include "util.h"
 
+#include <memory>
+
 // AMQP 1.0 Support
 //
 // The boost::signals2 signals and slot system is thread safe, so CValidationInterface listeners
@@ -25,8 +27,11 @@
 //
 // Like the ZMQ notification interface, if a notifier fails to send a message, the notifier is shut down.
 //
+// The notifiers are only called from the notification queue, one notification after the other, and never with
+// cs_main held, since validation may hold cs_main while it waits for room in the queue.
+//
 
-AMQPNotificationInterface::AMQPNotificationInterface()
+AMQPNotificationInterface::AMQPNotificationInterface() : queue("amqp")
 {
 }
 
@@ -95,6 +100,7 @@ bool AMQPNotificationInterface::Initialize()
         return false;
     }
 
+    queue.Start();
     return true;
 }
 
@@ -102,6 +108,7 @@ bool AMQPNotificationInterface::Initialize()
 void AMQPNotificationInterface::Shutdown()
 {
     LogPrint("amqp", "amqp: Shutdown notification interface\n");
+    queue.Stop();
 
     for (std::list<AMQPAbstractNotifier*>::iterator i = notifiers.begin(); i != notifiers.end(); ++i) {
         AMQPAbstractNotifier *notifier = *i;
@@ -109,7 +116,7 @@ void AMQPNotificationInterface::Shutdown()
     }
 }
 
-void AMQPNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindex)
+void AMQPNotificationInterface::NotifyBlock(const CBlockIndex *pindex)
 {
     for (std::list<AMQPAbstractNotifier*>::iterator i = notifiers.begin(); i != notifiers.end(); ) {
         AMQPAbstractNotifier *notifier = *i;
@@ -122,7 +129,7 @@ void AMQPNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindex)
     }
 }
 
-void AMQPNotificationInterface::SyncTransaction(const CTransaction &tx, const CBlock *pblock)
+void AMQPNotificationInterface::NotifyTransaction(const CTransaction &tx)
 {
     for (std::list<AMQPAbstractNotifier*>::iterator i = notifiers.begin(); i != notifiers.end(); ) {
         AMQPAbstractNotifier *notifier = *i;
@@ -134,3 +141,14 @@ void AMQPNotificationInterface::SyncTransaction(const CTransaction &tx, const CB
         }
     }
 }
+
+void AMQPNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindex)
+{
+    queue.Push([this, pindex]() { NotifyBlock(pindex); });
+}
+
+void AMQPNotificationInterface::SyncTransaction(const CTransaction &tx, const CBlock *pblock)
+{
+    std::shared_ptr<const CTransaction> ptx = std::make_shared<const CTransaction>(tx);
+    queue.Push([this, ptx]() { NotifyTransaction(*ptx); });
+}
@@ -6,6 +6,7 @@
 #define ZCASH_AMQP_AMQPNOTIFICATIONINTERFACE_H
 
 #include "validationinterface.h"
+#include "notificationqueue.h"
 #include <string>
 #include <map>
 
@@ -31,6 +32,12 @@ private:
     AMQPNotificationInterface();
 
     std::list<AMQPAbstractNotifier*> notifiers;
+
+    // notifications are sent from here, so that a slow broker does not hold up validation
+    CNotificationQueue queue;
+
+    void NotifyBlock(const CBlockIndex *pindex);
+    void NotifyTransaction(const CTransaction &tx);
 };
 
 #endif // ZCASH_AMQP_AMQPNOTIFICATIONINTERFACE_H
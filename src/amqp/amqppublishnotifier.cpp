@@ -154,9 +154,9 @@ bool AMQPPublishRawBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
     LogPrint("amqp", "amqp: Publish rawblock %s\n", pindex->GetBlockHash().GetHex());
 
     const Consensus::Params& consensusParams = Params().GetConsensus();
+    // this runs on the notification queue without cs_main, which the position of a connected block does not need
     CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
     {
-        LOCK(cs_main);
         CBlock block;
         if(!ReadBlockFromDisk(block, pindex, consensusParams)) {
             LogPrint("amqp", "amqp: Can't read block from disk");
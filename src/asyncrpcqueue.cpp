@@ -15,7 +15,7 @@ shared_ptr<AsyncRPCQueue> AsyncRPCQueue::sharedInstance() {
     return q;
 }
 
-AsyncRPCQueue::AsyncRPCQueue() : closed_(false), finish_(false) {
+AsyncRPCQueue::AsyncRPCQueue() : closed_(false), finish_(false), executing_(0), finished_(0) {
 }
 
 AsyncRPCQueue::~AsyncRPCQueue() {
@@ -65,7 +65,10 @@ void AsyncRPCQueue::run(size_t workerId) {
         } else if (operation->isCancelled()) {
             // skip cancelled operation
         } else {
+            executing_++;
             operation->main();
+            executing_--;
+            finished_++;
         }
     }
 }
@@ -171,6 +174,20 @@ size_t AsyncRPCQueue::getOperationCount() const {
     return operation_id_queue_.size();
 }
 
+/**
+ * Return the number of operations that workers are running now
+ */
+size_t AsyncRPCQueue::getNumberOfExecutingOperations() const {
+    return executing_.load();
+}
+
+/**
+ * Return the number of operations that workers have run since the queue was created
+ */
+uint64_t AsyncRPCQueue::getNumberOfFinishedOperations() const {
+    return finished_.load();
+}
+
 /**
  * Spawn a worker thread
  */
@@ -45,6 +45,8 @@ public:
     void finishAndWait(); // block thread until existing operations have finished, threads terminated
     void cancelAllOperations(); // mark all operations in the queue as cancelled
     size_t getOperationCount() const;
+    size_t getNumberOfExecutingOperations() const;
+    uint64_t getNumberOfFinishedOperations() const;
     std::shared_ptr<AsyncRPCOperation> getOperationForId(AsyncRPCOperationId) const;
     std::shared_ptr<AsyncRPCOperation> popOperationForId(AsyncRPCOperationId);
     void addOperation(const std::shared_ptr<AsyncRPCOperation> &ptrOperation);
@@ -60,6 +62,8 @@ private:
     std::condition_variable condition_;
     std::atomic<bool> closed_;
     std::atomic<bool> finish_;
+    std::atomic<size_t> executing_;
+    std::atomic<uint64_t> finished_;
     AsyncRPCOperationMap operation_map_;
     std::queue <AsyncRPCOperationId> operation_id_queue_;
     std::vector<std::thread> workers_;
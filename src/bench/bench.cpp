@@ -0,0 +1,157 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "bench/bench.h"
+
+#include "clientversion.h"
+
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+#include <regex>
+
+#include <univalue.h>
+
+namespace benchmark {
+
+double BenchResult::Total() const
+{
+    return std::accumulate(evalTimes.begin(), evalTimes.end(), 0.0);
+}
+
+double BenchResult::MinPerIteration() const
+{
+    return evalTimes.empty() ? 0.0 : *std::min_element(evalTimes.begin(), evalTimes.end()) / numIters;
+}
+
+double BenchResult::MaxPerIteration() const
+{
+    return evalTimes.empty() ? 0.0 : *std::max_element(evalTimes.begin(), evalTimes.end()) / numIters;
+}
+
+double BenchResult::MedianPerIteration() const
+{
+    if (evalTimes.empty())
+    {
+        return 0.0;
+    }
+    std::vector<double> sorted(evalTimes);
+    std::sort(sorted.begin(), sorted.end());
+    size_t mid = sorted.size() >> 1;
+    double median = (sorted.size() & 1) ? sorted[mid] : (sorted[mid - 1] + sorted[mid]) / 2;
+    return median / numIters;
+}
+
+static int64_t Nanoseconds(double seconds)
+{
+    return (int64_t)(seconds * 1e9 + 0.5);
+}
+
+void CsvPrinter::Header()
+{
+    std::cout << "# Benchmark, evals, iterations, total, min_ns, max_ns, median_ns" << std::endl;
+}
+
+void CsvPrinter::Result(const BenchResult &result)
+{
+    std::cout << result.name << ", " << result.evalTimes.size() << ", " << result.numIters << ", "
+              << result.Total() << ", " << Nanoseconds(result.MinPerIteration()) << ", "
+              << Nanoseconds(result.MaxPerIteration()) << ", " << Nanoseconds(result.MedianPerIteration()) << std::endl;
+}
+
+void CsvPrinter::Footer() {}
+
+void JsonPrinter::Header()
+{
+    results.clear();
+}
+
+void JsonPrinter::Result(const BenchResult &result)
+{
+    results.push_back(result);
+}
+
+void JsonPrinter::Footer()
+{
+    UniValue benchmarks(UniValue::VARR);
+    for (auto &result : results)
+    {
+        UniValue oneBench(UniValue::VOBJ);
+        oneBench.pushKV("name", result.name);
+        oneBench.pushKV("evals", (int64_t)result.evalTimes.size());
+        oneBench.pushKV("iterations", (int64_t)result.numIters);
+        oneBench.pushKV("total", result.Total());
+        oneBench.pushKV("min_ns", Nanoseconds(result.MinPerIteration()));
+        oneBench.pushKV("max_ns", Nanoseconds(result.MaxPerIteration()));
+        oneBench.pushKV("median_ns", Nanoseconds(result.MedianPerIteration()));
+        benchmarks.push_back(oneBench);
+    }
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("version", FormatFullVersion());
+    ret.pushKV("benchmarks", benchmarks);
+    std::cout << ret.write(1, 2) << std::endl;
+}
+
+BenchRunner::BenchmarkMap &BenchRunner::benchmarks()
+{
+    static BenchmarkMap benchmarksMap;
+    return benchmarksMap;
+}
+
+BenchRunner::BenchRunner(const std::string &name, BenchFunction func, uint64_t numIters)
+{
+    benchmarks().insert(std::make_pair(name, Bench({func, numIters})));
+}
+
+bool BenchRunner::RunAll(Printer &printer, uint64_t numEvals, const std::string &filter, bool listOnly)
+{
+    std::regex reFilter(filter);
+    std::smatch baseMatch;
+    bool allRan = true;
+
+    if (!listOnly)
+    {
+        printer.Header();
+    }
+    for (auto &oneBench : benchmarks())
+    {
+        if (!std::regex_match(oneBench.first, baseMatch, reFilter))
+        {
+            continue;
+        }
+        if (listOnly)
+        {
+            std::cout << oneBench.first << std::endl;
+            continue;
+        }
+
+        BenchResult result;
+        result.name = oneBench.first;
+        result.numIters = oneBench.second.numIters ? oneBench.second.numIters : 1;
+        try
+        {
+            for (uint64_t i = 0; i < numEvals; i++)
+            {
+                State state(result.numIters);
+                oneBench.second.func(state);
+                result.evalTimes.push_back(state.Elapsed());
+            }
+        }
+        catch (const std::exception &e)
+        {
+            // a fixture that cannot be set up is reported without a result, rather than timing something else
+            std::cerr << oneBench.first << ": " << e.what() << std::endl;
+            allRan = false;
+            continue;
+        }
+        printer.Result(result);
+    }
+    if (!listOnly)
+    {
+        printer.Footer();
+    }
+    return allRan;
+}
+
+} // namespace benchmark
@@ -0,0 +1,139 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_BENCH_BENCH_H
+#define BITCOIN_BENCH_BENCH_H
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/preprocessor/cat.hpp>
+#include <boost/preprocessor/stringize.hpp>
+
+// Benchmarks are functions that set up their fixture, then run the code being measured for as long as KeepRunning()
+// returns true. Only the loop is timed:
+//
+//     static void CodeToTime(benchmark::State& state)
+//     {
+//         ... set up the fixture ...
+//         while (state.KeepRunning())
+//         {
+//             ... the code being measured ...
+//         }
+//     }
+//
+//     BENCHMARK(CodeToTime, 1000);
+//
+// Each benchmark runs a fixed number of iterations in each evaluation, so results of one build can be compared with
+// those of another.
+
+namespace benchmark {
+
+class State
+{
+public:
+    typedef std::chrono::steady_clock clock;
+
+    State(uint64_t NumIters) : numIters(NumIters ? NumIters : 1), count(0) {}
+
+    bool KeepRunning()
+    {
+        if (count == 0)
+        {
+            start = clock::now();
+        }
+        else if (count == numIters)
+        {
+            end = clock::now();
+            return false;
+        }
+        count++;
+        return true;
+    }
+
+    uint64_t Iterations() const { return numIters; }
+
+    // seconds taken by all iterations, valid once KeepRunning() has returned false
+    double Elapsed() const
+    {
+        return std::chrono::duration<double>(end - start).count();
+    }
+
+private:
+    uint64_t numIters;
+    uint64_t count;
+    clock::time_point start, end;
+};
+
+typedef std::function<void(State&)> BenchFunction;
+
+// the times of all evaluations of one benchmark
+struct BenchResult
+{
+    std::string name;
+    uint64_t numIters;
+    std::vector<double> evalTimes;          // seconds per evaluation
+
+    double Total() const;
+    double MinPerIteration() const;
+    double MaxPerIteration() const;
+    double MedianPerIteration() const;
+};
+
+class Printer
+{
+public:
+    virtual ~Printer() {}
+    virtual void Header() = 0;
+    virtual void Result(const BenchResult &result) = 0;
+    virtual void Footer() = 0;
+};
+
+// one line per benchmark, with times per iteration in nanoseconds
+class CsvPrinter : public Printer
+{
+public:
+    void Header();
+    void Result(const BenchResult &result);
+    void Footer();
+};
+
+// an object with the client version and an array of the results, with times per iteration in nanoseconds
+class JsonPrinter : public Printer
+{
+    std::vector<BenchResult> results;
+public:
+    void Header();
+    void Result(const BenchResult &result);
+    void Footer();
+};
+
+class BenchRunner
+{
+    struct Bench
+    {
+        BenchFunction func;
+        uint64_t numIters;
+    };
+    typedef std::map<std::string, Bench> BenchmarkMap;
+    static BenchmarkMap &benchmarks();
+
+public:
+    BenchRunner(const std::string &name, BenchFunction func, uint64_t numIters);
+
+    // runs each benchmark with a name matching the filter regular expression numEvals times, in name order. a
+    // benchmark throws if its fixture cannot be set up, which is reported, and makes this return false
+    static bool RunAll(Printer &printer, uint64_t numEvals, const std::string &filter, bool listOnly);
+};
+
+} // namespace benchmark
+
+// registers a benchmark function with the number of iterations each of its evaluations runs
+#define BENCHMARK(n, numIters) \
+    benchmark::BenchRunner BOOST_PP_CAT(bench_, BOOST_PP_CAT(__LINE__, n))(BOOST_PP_STRINGIZE(n), n, numIters);
+
+#endif // BITCOIN_BENCH_BENCH_H
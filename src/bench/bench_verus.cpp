@@ -0,0 +1,83 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "bench/bench.h"
+
+#include "chainparams.h"
+#include "crypto/common.h"
+#include "crypto/verus_hash.h"
+#include "key.h"
+#include "pbaas/pbaas.h"
+#include "util.h"
+
+#include <memory>
+
+extern char ASSETCHAINS_SYMBOL[KOMODO_ASSETCHAIN_MAXLEN];
+extern uint160 VERUS_CHAINID;
+extern std::string VERUS_CHAINNAME;
+
+// this chain is set to VRSC, as komodo_args does when verusd starts, without reading or writing a configuration file
+static void SelectBenchChain()
+{
+    VERUS_CHAINNAME = "VRSC";
+    VERUS_CHAINID = CCrossChainRPCData::GetID(VERUS_CHAINNAME);
+    memset(ASSETCHAINS_SYMBOL, 0, sizeof(ASSETCHAINS_SYMBOL));
+    strcpy(ASSETCHAINS_SYMBOL, VERUS_CHAINNAME.c_str());
+    ASSETCHAINS_CHAINID = VERUS_CHAINID;
+    SelectParams(CBaseChainParams::MAIN);
+    ConnectedChains.ThisChain() = CCurrencyDefinition(VERUS_CHAINNAME, false);
+}
+
+int main(int argc, char** argv)
+{
+    ParseParameters(argc, argv);
+
+    if (mapArgs.count("-?") || mapArgs.count("-h") || mapArgs.count("-help"))
+    {
+        fprintf(stdout, "Usage:\n"
+                        "  bench_verus [options]\n\n"
+                        "Options:\n"
+                        "  -filter=<regex>        Run the benchmarks with names matching the regular expression (default: .*)\n"
+                        "  -evals=<n>             Number of times each benchmark is run (default: 5)\n"
+                        "  -printer=<csv|json>    Format of the results (default: csv)\n"
+                        "  -list                  List the benchmarks that match the filter without running them\n");
+        return 0;
+    }
+
+    assert(init_and_check_sodium() != -1);
+    ECC_Start();
+    std::unique_ptr<ECCVerifyHandle> verifyHandle(new ECCVerifyHandle());
+    SetupEnvironment();
+    fPrintToDebugLog = false;
+
+    CVerusHash::init();
+    CVerusHashV2::init();
+    SelectBenchChain();
+
+    std::unique_ptr<benchmark::Printer> printer;
+    std::string printerName = GetArg("-printer", "csv");
+    if (printerName == "json")
+    {
+        printer.reset(new benchmark::JsonPrinter());
+    }
+    else if (printerName == "csv")
+    {
+        printer.reset(new benchmark::CsvPrinter());
+    }
+    else
+    {
+        fprintf(stderr, "Unknown printer %s, must be csv or json\n", printerName.c_str());
+        return 1;
+    }
+
+    int64_t numEvals = GetArg("-evals", 5);
+    bool allRan = benchmark::BenchRunner::RunAll(*printer,
+                                                 std::max(numEvals, (int64_t)1),
+                                                 GetArg("-filter", ".*"),
+                                                 GetBoolArg("-list", false));
+
+    verifyHandle.reset();
+    ECC_Stop();
+    return allRan ? 0 : 1;
+}
@@ -0,0 +1,120 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "bench/bench.h"
+
+#include "hash.h"
+#include "mmr.h"
+
+#include <stdexcept>
+
+// depth of the branch nodes above each leaf, about that of the account proofs of a busy Ethereum state
+static const int BENCH_TRIE_DEPTH = 7;
+
+struct BenchTrieProof
+{
+    uint256 root;
+    std::vector<unsigned char> key;
+    std::vector<std::vector<unsigned char>> nodes;
+};
+
+static uint256 KeccakOf(const std::vector<unsigned char> &data)
+{
+    CKeccack256Writer writer;
+    writer.write((const char *)data.data(), data.size());
+    return writer.GetHash();
+}
+
+static unsigned char KeyNibble(const std::vector<unsigned char> &key, size_t n)
+{
+    return (n & 1) ? key[n >> 1] & 0xf : key[n >> 1] >> 4;
+}
+
+// a proof of one value in a trie of BENCH_TRIE_DEPTH branches over a leaf, built from the leaf up
+static BenchTrieProof MakeBenchTrieProof(uint64_t seed)
+{
+    RLP rlp;
+    BenchTrieProof proof;
+    CKeccack256Writer keyHasher;
+    keyHasher.write((const char *)&seed, sizeof(seed));
+    uint256 keyHash = keyHasher.GetHash();
+    proof.key.assign(keyHash.begin(), keyHash.end());
+
+    // the leaf holds the hex prefix encoding of the rest of the key, with a flag for its parity
+    size_t nibbles = proof.key.size() << 1;
+    std::vector<unsigned char> hpKey;
+    size_t n = BENCH_TRIE_DEPTH;
+    if ((nibbles - n) & 1)
+    {
+        hpKey.push_back(0x30 | KeyNibble(proof.key, n++));
+    }
+    else
+    {
+        hpKey.push_back(0x20);
+    }
+    for (; n < nibbles; n += 2)
+    {
+        hpKey.push_back((KeyNibble(proof.key, n) << 4) | KeyNibble(proof.key, n + 1));
+    }
+    std::vector<unsigned char> value(70, (unsigned char)seed);
+    proof.nodes.push_back(rlp.encode(std::vector<std::vector<unsigned char>>({hpKey, value})));
+
+    for (int depth = BENCH_TRIE_DEPTH - 1; depth >= 0; depth--)
+    {
+        uint256 childHash = KeccakOf(proof.nodes.front());
+        std::vector<std::vector<unsigned char>> branch(17);
+        branch[KeyNibble(proof.key, depth)].assign(childHash.begin(), childHash.end());
+        proof.nodes.insert(proof.nodes.begin(), rlp.encode(branch));
+    }
+    proof.root = KeccakOf(proof.nodes.front());
+    return proof;
+}
+
+static std::vector<BenchTrieProof> MakeBenchTrieProofs(size_t count)
+{
+    std::vector<BenchTrieProof> proofs;
+    proofs.reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        proofs.push_back(MakeBenchTrieProof(i));
+        CETHPATRICIABranch branch;
+        if (branch.verifyProof(proofs.back().root, proofs.back().key, proofs.back().nodes).size() != 70)
+        {
+            throw std::runtime_error("trie proof does not verify");
+        }
+    }
+    return proofs;
+}
+
+static void RunETHProofVerify(benchmark::State& state, const std::vector<BenchTrieProof> &proofs)
+{
+    CETHPATRICIABranch branch;
+    size_t i = 0;
+    while (state.KeepRunning())
+    {
+        const BenchTrieProof &proof = proofs[i];
+        if (branch.verifyProof(proof.root, proof.key, proof.nodes).size() != 70)
+        {
+            throw std::runtime_error("trie proof does not verify");
+        }
+        i = (i + 1) % proofs.size();
+    }
+}
+
+// the nodes of recently verified proofs are found in the verified node cache
+static void ETHProofVerifyCached(benchmark::State& state)
+{
+    static const std::vector<BenchTrieProof> proofs = MakeBenchTrieProofs(64);
+    RunETHProofVerify(state, proofs);
+}
+
+// more proofs are verified in turn than the verified node cache holds, so each node is hashed
+static void ETHProofVerifyUncached(benchmark::State& state)
+{
+    static const std::vector<BenchTrieProof> proofs = MakeBenchTrieProofs(4000);
+    RunETHProofVerify(state, proofs);
+}
+
+BENCHMARK(ETHProofVerifyCached, 20000);
+BENCHMARK(ETHProofVerifyUncached, 20000);
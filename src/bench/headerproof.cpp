@@ -0,0 +1,99 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "bench/bench.h"
+
+#include "arith_uint256.h"
+#include "mmr.h"
+#include "primitives/block.h"
+#include "random.h"
+
+#include <stdexcept>
+
+typedef CMerkleMountainRange<ChainMMRNode, CChunkedLayer<ChainMMRNode, 9>> BenchChainMMR;
+typedef CMerkleMountainView<ChainMMRNode, CChunkedLayer<ChainMMRNode, 9>> BenchChainMMRView;
+
+// about the number of blocks of a chain a few years old, so proofs are as deep as those of notary evidence
+static const uint64_t BENCH_CHAIN_BLOCKS = 1 << 21;
+
+struct BenchHeaderProof
+{
+    uint256 blockMMRRoot;
+    uint32_t height;
+    CBlockHeaderProof proof;
+};
+
+// proofs of headers spread across a chain MMR, each of which validates against its root
+static std::vector<BenchHeaderProof> MakeBenchHeaderProofs(size_t count)
+{
+    std::vector<BenchHeaderProof> proofs(count);
+    std::vector<CBlockHeader> headers(count);
+    std::vector<uint64_t> proven(BENCH_CHAIN_BLOCKS, count);
+    for (size_t i = 0; i < count; i++)
+    {
+        proofs[i].height = (i * 7919 * 263 + 1) % BENCH_CHAIN_BLOCKS;
+        proofs[i].blockMMRRoot = GetRandHash();
+        headers[i].hashMerkleRoot = GetRandHash();
+        proven[proofs[i].height] = i;
+    }
+
+    // each leaf is made as a block's node of the chain MMR is, from the block MMR root and the block hash its
+    // header proof is checked with
+    BenchChainMMR mmr;
+    for (uint64_t height = 0; height < BENCH_CHAIN_BLOCKS; height++)
+    {
+        uint256 power = ArithToUint256(arith_uint256(height + 1) << 128 | arith_uint256(height + 1000));
+        uint256 preHash = proven[height] < count ?
+            ChainMMRNode::HashObj(proofs[proven[height]].blockMMRRoot, headers[proven[height]].GetHash()) :
+            GetRandHash();
+        mmr.Add(ChainMMRNode(ChainMMRNode::HashObj(preHash, power), power));
+    }
+    BenchChainMMRView view(mmr, mmr.size());
+    uint256 root = view.GetRoot();
+
+    for (size_t i = 0; i < count; i++)
+    {
+        CMMRProof powerNodeProof;
+        if (!view.GetProof(powerNodeProof, proofs[i].height))
+        {
+            throw std::runtime_error("unable to make a header proof");
+        }
+        proofs[i].proof = CBlockHeaderProof(powerNodeProof, headers[i]);
+        if (proofs[i].proof.ValidateBlockMMRRoot(proofs[i].blockMMRRoot, proofs[i].height) != root)
+        {
+            throw std::runtime_error("header proof does not verify");
+        }
+    }
+    return proofs;
+}
+
+// the same proofs checked again, as evidence, challenges and finalizations do, which are answered from the
+// header proof cache after the first time
+static void HeaderProofCached(benchmark::State& state)
+{
+    std::vector<BenchHeaderProof> proofs = MakeBenchHeaderProofs(64);
+    size_t i = 0;
+    while (state.KeepRunning())
+    {
+        proofs[i].proof.ValidateBlockMMRRoot(proofs[i].blockMMRRoot, proofs[i].height);
+        i = (i + 1) % proofs.size();
+    }
+}
+
+// a different height each time, so that every check misses the cache and runs the whole proof, as well as
+// making and putting its key
+static void HeaderProofUncached(benchmark::State& state)
+{
+    std::vector<BenchHeaderProof> proofs = MakeBenchHeaderProofs(64);
+    size_t i = 0;
+    uint32_t nMiss = 0;
+    while (state.KeepRunning())
+    {
+        proofs[i].proof.ValidateBlockMMRRoot(proofs[i].blockMMRRoot, BENCH_CHAIN_BLOCKS + nMiss++);
+        i = (i + 1) % proofs.size();
+    }
+}
+
+BENCHMARK(HeaderProofCached, 20000);
+BENCHMARK(HeaderProofUncached, 20000);
@@ -0,0 +1,97 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "bench/bench.h"
+
+#include "key.h"
+#include "pbaas/identity.h"
+#include "random.h"
+#include "streams.h"
+
+#include <stdexcept>
+
+// an identity with several primary keys and content entries, similar in size to those used on chain
+static CIdentity BenchIdentity()
+{
+    std::vector<CTxDestination> primary;
+    for (int i = 0; i < 3; i++)
+    {
+        CKey key;
+        key.MakeNewKey(true);
+        primary.push_back(CTxDestination(key.GetPubKey().GetID()));
+    }
+
+    std::vector<std::pair<uint160, uint256>> hashes;
+    std::multimap<uint160, std::vector<unsigned char>> kvContent;
+    for (int i = 0; i < 4; i++)
+    {
+        uint160 key;
+        GetRandBytes(key.begin(), key.size());
+        hashes.push_back(std::make_pair(key, GetRandHash()));
+        kvContent.insert(std::make_pair(key, std::vector<unsigned char>(128, (unsigned char)i)));
+    }
+
+    uint160 parent = ASSETCHAINS_CHAINID, revokeParent = parent, recoverParent = parent;
+    CIdentity identity(CIdentity::VERSION_CURRENT, 0, primary, 2, parent, "benchidentity", hashes, kvContent,
+                       CIdentity::GetID("benchrevoke", revokeParent), CIdentity::GetID("benchrecover", recoverParent));
+    if (!identity.IsValid(true))
+    {
+        throw std::runtime_error("invalid identity fixture");
+    }
+    return identity;
+}
+
+static void IdentitySerialize(benchmark::State& state)
+{
+    CIdentity identity = BenchIdentity();
+    while (state.KeepRunning())
+    {
+        CDataStream ss(SER_DISK, PROTOCOL_VERSION);
+        ss << identity;
+    }
+}
+
+static void IdentityDeserializeAndValidate(benchmark::State& state)
+{
+    std::vector<unsigned char> identityBytes = ::AsVector(BenchIdentity());
+    while (state.KeepRunning())
+    {
+        CIdentity identity(identityBytes);
+        if (!identity.IsValid(true))
+        {
+            throw std::runtime_error("identity did not round trip");
+        }
+    }
+}
+
+static void IdentityFromOutputScript(benchmark::State& state)
+{
+    CScript script = BenchIdentity().IdentityUpdateOutputScript(INT32_MAX);
+    while (state.KeepRunning())
+    {
+        CIdentity identity(script);
+        if (!identity.IsValidUnrevoked())
+        {
+            throw std::runtime_error("identity not found in its output script");
+        }
+    }
+}
+
+static void OptCCParamsParse(benchmark::State& state)
+{
+    CScript script = BenchIdentity().IdentityUpdateOutputScript(INT32_MAX);
+    while (state.KeepRunning())
+    {
+        COptCCParams p;
+        if (!script.IsPayToCryptoCondition(p) || !p.IsValid())
+        {
+            throw std::runtime_error("identity output script is not a valid smart transaction");
+        }
+    }
+}
+
+BENCHMARK(IdentitySerialize, 100000);
+BENCHMARK(IdentityDeserializeAndValidate, 50000);
+BENCHMARK(IdentityFromOutputScript, 50000);
+BENCHMARK(OptCCParamsParse, 50000);
@@ -0,0 +1,94 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "bench/bench.h"
+
+#include "hash.h"
+#include "mmr.h"
+
+#include <stdexcept>
+
+typedef CMMRNode<CBLAKE2bWriter> BenchMMRNode;
+typedef CMerkleMountainRange<BenchMMRNode> BenchMMR;
+typedef CMerkleMountainView<BenchMMRNode> BenchMMRView;
+
+static const uint64_t BENCH_MMR_LEAVES = 100000;
+
+static uint256 BenchLeafHash(uint64_t i)
+{
+    CBLAKE2bWriter hw(SER_GETHASH, PROTOCOL_VERSION);
+    hw << i;
+    return hw.GetHash();
+}
+
+static void BenchAddLeaves(BenchMMR &mmr, uint64_t count)
+{
+    for (uint64_t i = 0; i < count; i++)
+    {
+        mmr.Add(BenchMMRNode(BenchLeafHash(i)));
+    }
+}
+
+static void MMRBuild(benchmark::State& state)
+{
+    while (state.KeepRunning())
+    {
+        BenchMMR mmr;
+        BenchAddLeaves(mmr, BENCH_MMR_LEAVES);
+        BenchMMRView view(mmr, mmr.size());
+        view.GetRoot();
+    }
+}
+
+static void MMRProve(benchmark::State& state)
+{
+    BenchMMR mmr;
+    BenchAddLeaves(mmr, BENCH_MMR_LEAVES);
+    BenchMMRView view(mmr, mmr.size());
+    view.GetRoot();
+    uint64_t pos = 0;
+    while (state.KeepRunning())
+    {
+        CMMRProof proof;
+        if (!view.GetProof(proof, pos))
+        {
+            throw std::runtime_error("unable to make a proof");
+        }
+        pos = (pos + 7919) % BENCH_MMR_LEAVES;
+    }
+}
+
+static void MMRVerify(benchmark::State& state)
+{
+    BenchMMR mmr;
+    BenchAddLeaves(mmr, BENCH_MMR_LEAVES);
+    BenchMMRView view(mmr, mmr.size());
+    uint256 root = view.GetRoot();
+
+    // proofs of leaves spread across the range, each a different depth from its peak
+    std::vector<std::pair<uint256, CMMRProof>> proofs(64);
+    for (uint64_t i = 0; i < proofs.size(); i++)
+    {
+        uint64_t pos = (i * 7919) % BENCH_MMR_LEAVES;
+        proofs[i].first = BenchLeafHash(pos);
+        if (!view.GetProof(proofs[i].second, pos) || proofs[i].second.CheckProof(proofs[i].first) != root)
+        {
+            throw std::runtime_error("proof does not verify");
+        }
+    }
+
+    size_t i = 0;
+    while (state.KeepRunning())
+    {
+        if (proofs[i].second.CheckProof(proofs[i].first) != root)
+        {
+            throw std::runtime_error("proof does not verify");
+        }
+        i = (i + 1) % proofs.size();
+    }
+}
+
+BENCHMARK(MMRBuild, 5);
+BENCHMARK(MMRProve, 10000);
+BENCHMARK(MMRVerify, 10000);
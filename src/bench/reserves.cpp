@@ -0,0 +1,142 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "bench/bench.h"
+
+#include "consensus/validation.h"
+#include "key_io.h"
+#include "pbaas/pbaas.h"
+#include "pbaas/reserves.h"
+
+#include <stdexcept>
+
+// imports are made at a height at which all of the current rules apply
+static const uint32_t BENCH_IMPORT_HEIGHT = 3000000;
+
+// a basket currency of this chain's native currency and a token, launched and holding reserves, with all of the
+// definitions in the currency cache, so imports into it do not need the indexes
+struct BenchBasket
+{
+    CCurrencyDefinition reserveToken;
+    CCurrencyDefinition basket;
+    CCoinbaseCurrencyState state;
+};
+
+static BenchBasket MakeBenchBasket()
+{
+    BenchBasket ret;
+
+    UniValue tokenDef(UniValue::VOBJ);
+    tokenDef.pushKV("name", "benchreserve");
+    tokenDef.pushKV("options", (int64_t)CCurrencyDefinition::OPTION_TOKEN);
+    ret.reserveToken = CCurrencyDefinition(tokenDef);
+    if (!ret.reserveToken.IsValid())
+    {
+        throw std::runtime_error("invalid reserve token fixture");
+    }
+
+    UniValue currencies(UniValue::VARR);
+    currencies.push_back(EncodeDestination(CIdentityID(ASSETCHAINS_CHAINID)));
+    currencies.push_back(EncodeDestination(CIdentityID(ret.reserveToken.GetID())));
+    UniValue weights(UniValue::VARR);
+    weights.push_back(UniValue(UniValue::VNUM, "0.5"));
+    weights.push_back(UniValue(UniValue::VNUM, "0.5"));
+    UniValue basketDef(UniValue::VOBJ);
+    basketDef.pushKV("name", "benchbasket");
+    basketDef.pushKV("options", (int64_t)(CCurrencyDefinition::OPTION_FRACTIONAL | CCurrencyDefinition::OPTION_TOKEN));
+    basketDef.pushKV("currencies", currencies);
+    basketDef.pushKV("weights", weights);
+    basketDef.pushKV("initialsupply", 1000000);
+    ret.basket = CCurrencyDefinition(basketDef);
+    if (!ret.basket.IsValid() || ret.basket.currencies.size() != 2)
+    {
+        throw std::runtime_error("invalid basket currency fixture");
+    }
+
+    CCurrencyState currencyState(ret.basket.GetID(),
+                                 ret.basket.currencies,
+                                 ret.basket.weights,
+                                 std::vector<int64_t>({1000000 * COIN, 1000000 * COIN}),
+                                 ret.basket.initialFractionalSupply,
+                                 0,
+                                 4000000 * COIN,
+                                 CCurrencyState::FLAG_FRACTIONAL | CCurrencyState::FLAG_LAUNCHCONFIRMED);
+    ret.state = CCoinbaseCurrencyState(currencyState);
+    ret.state.conversionPrice = ret.state.PricesInReserve();
+    ret.state.viaConversionPrice = ret.state.conversionPrice;
+
+    ConnectedChains.UpdateCachedCurrency(ConnectedChains.ThisChain(), BENCH_IMPORT_HEIGHT);
+    ConnectedChains.UpdateCachedCurrency(ret.reserveToken, BENCH_IMPORT_HEIGHT);
+    ConnectedChains.UpdateCachedCurrency(ret.basket, BENCH_IMPORT_HEIGHT);
+    return ret;
+}
+
+static const BenchBasket &GetBenchBasket()
+{
+    static const BenchBasket basket = MakeBenchBasket();
+    return basket;
+}
+
+static void ConvertAmounts(benchmark::State& state)
+{
+    const BenchBasket &basket = GetBenchBasket();
+    std::vector<CAmount> reserveIn({5000 * COIN, 3000 * COIN});
+    std::vector<CAmount> fractionalIn({2000 * COIN, 4000 * COIN});
+    while (state.KeepRunning())
+    {
+        CCurrencyState newState;
+        CValidationState validationState;
+        std::vector<CAmount> prices =
+            basket.state.ConvertAmounts(reserveIn, fractionalIn, newState, true, validationState);
+        if (prices.size() != reserveIn.size() || !validationState.IsValid())
+        {
+            throw std::runtime_error("conversion failed");
+        }
+    }
+}
+
+static void AddReserveTransferImportOutputs(benchmark::State& state)
+{
+    const BenchBasket &basket = GetBenchBasket();
+    const CCurrencyDefinition &thisChain = ConnectedChains.ThisChain();
+
+    // conversions from both reserves into the basket, to different recipients, as in a busy export
+    std::vector<CReserveTransfer> transfers;
+    for (int i = 0; i < 50; i++)
+    {
+        uint160 recipient;
+        memset(recipient.begin(), i + 1, recipient.size());
+        transfers.push_back(CReserveTransfer(CReserveTransfer::VALID | CReserveTransfer::CONVERT,
+                                             basket.basket.currencies[i & 1],
+                                             (10 + i) * COIN,
+                                             ASSETCHAINS_CHAINID,
+                                             CReserveTransfer::DEFAULT_PER_STEP_FEE << 1,
+                                             basket.basket.GetID(),
+                                             DestinationToTransferDestination(CTxDestination(CKeyID(recipient)))));
+    }
+
+    auto runImport = [&]()
+    {
+        CReserveTransactionDescriptor rtxd;
+        std::vector<CTxOut> vOutputs;
+        CCurrencyValueMap importedCurrency, gatewayDepositsIn, spentCurrencyOut;
+        CCoinbaseCurrencyState newState;
+        return rtxd.AddReserveTransferImportOutputs(thisChain, thisChain, basket.basket, basket.state, transfers,
+                                                    BENCH_IMPORT_HEIGHT, vOutputs, importedCurrency, gatewayDepositsIn,
+                                                    spentCurrencyOut, &newState) &&
+               vOutputs.size() >= transfers.size();
+    };
+
+    if (!runImport())
+    {
+        throw std::runtime_error("import of the transfers failed");
+    }
+    while (state.KeepRunning())
+    {
+        runImport();
+    }
+}
+
+BENCHMARK(ConvertAmounts, 20000);
+BENCHMARK(AddReserveTransferImportOutputs, 200);
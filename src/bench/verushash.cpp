@@ -0,0 +1,54 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "bench/bench.h"
+
+#include "hash.h"
+#include "primitives/block.h"
+#include "random.h"
+
+// the serialized header a miner hashes, with an empty solution
+static std::vector<unsigned char> BenchHeaderBytes()
+{
+    CBlockHeader header;
+    header.nVersion = CBlockHeader::VERUS_V2;
+    header.hashPrevBlock = GetRandHash();
+    header.hashMerkleRoot = GetRandHash();
+    header.hashFinalSaplingRoot = GetRandHash();
+    header.nTime = 1700000000;
+    header.nBits = 0x1d00ffff;
+    header.nNonce = GetRandHash();
+    header.nSolution.resize(1344);
+
+    CDataStream ss(SER_GETHASH, PROTOCOL_VERSION);
+    ss << header;
+    return std::vector<unsigned char>(ss.begin(), ss.end());
+}
+
+static void VerusHashV2b2Header(benchmark::State& state)
+{
+    std::vector<unsigned char> headerBytes = BenchHeaderBytes();
+    uint256 hash;
+    while (state.KeepRunning())
+    {
+        CVerusHashV2bWriter hw(SER_GETHASH, PROTOCOL_VERSION, SOLUTION_VERUSHHASH_V2_2);
+        hw.write((const char *)headerBytes.data(), headerBytes.size());
+        hash = hw.GetHash();
+        headerBytes[0] ^= hash.begin()[0];
+    }
+}
+
+static void VerusHashV2Block1MB(benchmark::State& state)
+{
+    std::vector<unsigned char> data(1024 * 1024, 0x5a);
+    while (state.KeepRunning())
+    {
+        CVerusHashV2Writer hw(SER_GETHASH, PROTOCOL_VERSION);
+        hw.write((const char *)data.data(), data.size());
+        data[0] ^= hw.GetHash().begin()[0];
+    }
+}
+
+BENCHMARK(VerusHashV2b2Header, 20000);
+BENCHMARK(VerusHashV2Block1MB, 20);
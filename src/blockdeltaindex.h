@@ -0,0 +1,112 @@
+// Copyright (c) 2009-2010 Satoshi Nakamoto
+// Copyright (c) 2009-2015 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_BLOCKDELTAINDEX_H
+#define BITCOIN_BLOCKDELTAINDEX_H
+
+#include "uint256.h"
+#include "amount.h"
+#include "serialize.h"
+
+#include <vector>
+
+// an address balance change reported by getblockdeltas. outputs whose address cannot be
+// extracted are kept with an addressType of 0 (CScript::UNKNOWN), without an address
+struct CBlockDeltaOutput {
+    int addressType;
+    uint160 addressHash;
+    CAmount satoshis;
+    unsigned int index;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(VARINT(addressType));
+        READWRITE(addressHash);
+        READWRITE(VARINT(satoshis));
+        READWRITE(VARINT(index));
+    }
+
+    CBlockDeltaOutput(int type, const uint160 &hash, CAmount amount, unsigned int i) {
+        addressType = type;
+        addressHash = hash;
+        satoshis = amount;
+        index = i;
+    }
+
+    CBlockDeltaOutput() {
+        SetNull();
+    }
+
+    void SetNull() {
+        addressType = 0;
+        addressHash.SetNull();
+        satoshis = 0;
+        index = 0;
+    }
+};
+
+// an input spending from a transparent address, satoshis is the (positive) value spent
+struct CBlockDeltaInput : public CBlockDeltaOutput {
+    uint256 prevTxid;
+    unsigned int prevOut;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(*(CBlockDeltaOutput*)this);
+        READWRITE(prevTxid);
+        READWRITE(VARINT(prevOut));
+    }
+
+    CBlockDeltaInput(int type, const uint160 &hash, CAmount amount, unsigned int i, const uint256 &prevHash, unsigned int n) :
+        CBlockDeltaOutput(type, hash, amount, i) {
+        prevTxid = prevHash;
+        prevOut = n;
+    }
+
+    CBlockDeltaInput() {
+        prevTxid.SetNull();
+        prevOut = 0;
+    }
+};
+
+struct CBlockDeltaTx {
+    uint256 txid;
+    std::vector<CBlockDeltaInput> inputs;
+    std::vector<CBlockDeltaOutput> outputs;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(txid);
+        READWRITE(inputs);
+        READWRITE(outputs);
+    }
+};
+
+// everything getblockdeltas needs beyond the block header, stored for each connected block so that
+// it is answered without reading the block or looking up each spent output
+struct CBlockDeltaSummary {
+    unsigned int nSize;
+    std::vector<CBlockDeltaTx> txs;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(VARINT(nSize));
+        READWRITE(txs);
+    }
+
+    CBlockDeltaSummary() {
+        nSize = 0;
+    }
+};
+
+#endif // BITCOIN_BLOCKDELTAINDEX_H
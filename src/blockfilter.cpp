@@ -0,0 +1,324 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "blockfilter.h"
+
+#include "cc/eval.h"
+#include "crypto/common.h"
+#include "hash.h"
+#include "key_io.h"
+#include "pbaas/identity.h"
+#include "primitives/block.h"
+#include "streams.h"
+#include "undo.h"
+#include "version.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+// writes bits most significant first, the order of the Golomb-Rice codes in BIP158
+class CBitWriter
+{
+public:
+    CBitWriter(std::vector<unsigned char> &outIn) : out(outIn), buffer(0), nBits(0) {}
+
+    void Write(uint64_t data, int nCount)
+    {
+        while (nCount > 0)
+        {
+            int nTake = std::min(8 - nBits, nCount);
+            uint64_t bits = (data >> (nCount - nTake)) & ((1ULL << nTake) - 1);
+            buffer |= (unsigned char)(bits << (8 - nBits - nTake));
+            nBits += nTake;
+            nCount -= nTake;
+            if (nBits == 8)
+            {
+                Flush();
+            }
+        }
+    }
+
+    void Flush()
+    {
+        if (nBits)
+        {
+            out.push_back(buffer);
+            buffer = 0;
+            nBits = 0;
+        }
+    }
+
+private:
+    std::vector<unsigned char> &out;
+    unsigned char buffer;
+    int nBits;
+};
+
+class CBitReader
+{
+public:
+    CBitReader(const unsigned char *pbegin, const unsigned char *pendIn) : p(pbegin), pend(pendIn), buffer(0), nBits(0) {}
+
+    bool Read(int nCount, uint64_t &ret)
+    {
+        ret = 0;
+        while (nCount > 0)
+        {
+            if (!nBits)
+            {
+                if (p == pend)
+                {
+                    return false;
+                }
+                buffer = *p++;
+                nBits = 8;
+            }
+            int nTake = std::min(nBits, nCount);
+            ret = (ret << nTake) | ((buffer >> (nBits - nTake)) & ((1U << nTake) - 1));
+            nBits -= nTake;
+            nCount -= nTake;
+        }
+        return true;
+    }
+
+private:
+    const unsigned char *p;
+    const unsigned char *pend;
+    unsigned char buffer;
+    int nBits;
+};
+
+// the quotient in unary, ones ended by a zero, followed by the P low bits of the value
+void GolombRiceEncode(CBitWriter &writer, int nP, uint64_t value)
+{
+    for (uint64_t q = value >> nP; q > 0; q -= std::min(q, (uint64_t)64))
+    {
+        int nOnes = (int)std::min(q, (uint64_t)64);
+        writer.Write(~0ULL, nOnes);
+    }
+    writer.Write(0, 1);
+    writer.Write(value, nP);
+}
+
+bool GolombRiceDecode(CBitReader &reader, int nP, uint64_t &value)
+{
+    uint64_t q = 0, bit;
+    while (true)
+    {
+        if (!reader.Read(1, bit))
+        {
+            return false;
+        }
+        if (!bit)
+        {
+            break;
+        }
+        q++;
+    }
+    uint64_t r;
+    if (!reader.Read(nP, r))
+    {
+        return false;
+    }
+    value = (q << nP) + r;
+    return true;
+}
+
+// the high 64 bits of the 128 bit product, which maps a hash uniformly onto [0, range)
+uint64_t MapIntoRange(uint64_t x, uint64_t range)
+{
+#ifdef __SIZEOF_INT128__
+    return (uint64_t)(((unsigned __int128)x * range) >> 64);
+#else
+    uint64_t xHi = x >> 32, xLo = x & 0xffffffff;
+    uint64_t rHi = range >> 32, rLo = range & 0xffffffff;
+    uint64_t loLo = xLo * rLo, hiLo = xHi * rLo, loHi = xLo * rHi, hiHi = xHi * rHi;
+    uint64_t cross = (loLo >> 32) + (hiLo & 0xffffffff) + loHi;
+    return hiHi + (hiLo >> 32) + (cross >> 32);
+#endif
+}
+
+void AddScriptElements(const CScript &script, CGCSFilter::ElementSet &elements)
+{
+    if (script.empty() || script[0] == OP_RETURN)
+    {
+        return;
+    }
+    elements.insert(CGCSFilter::Element(script.begin(), script.end()));
+
+    // condition scripts differ with every change of their parameters, so wallets match the IDs they pay instead
+    COptCCParams p;
+    if (script.IsPayToCryptoCondition(p))
+    {
+        std::vector<CTxDestination> dests = p.IsValid() ? p.GetDestinations() : script.GetDestinations();
+        for (auto &dest : dests)
+        {
+            if (dest.which() != COptCCParams::ADDRTYPE_INVALID)
+            {
+                uint160 destID = GetDestinationID(dest);
+                if (!destID.IsNull())
+                {
+                    elements.insert(CGCSFilter::Element(destID.begin(), destID.end()));
+                }
+            }
+        }
+        CIdentity identity;
+        if (p.IsValid() && p.evalCode == EVAL_IDENTITY_PRIMARY && p.vData.size() &&
+            (identity = CIdentity(p.vData[0])).IsValid())
+        {
+            uint160 idID = identity.GetID();
+            elements.insert(CGCSFilter::Element(idID.begin(), idID.end()));
+        }
+    }
+}
+
+}
+
+CGCSFilter::CGCSFilter() : nK0(0), nK1(0), nN(0), nF(0)
+{
+    vEncoded.push_back(0);
+}
+
+CGCSFilter::CGCSFilter(uint64_t k0, uint64_t k1, std::vector<unsigned char> encodedFilter) :
+    nK0(k0), nK1(k1), vEncoded(std::move(encodedFilter))
+{
+    CDataStream stream(vEncoded, SER_NETWORK, PROTOCOL_VERSION);
+    uint64_t n = ReadCompactSize(stream);
+    if (n > std::numeric_limits<uint32_t>::max())
+    {
+        throw std::ios_base::failure("filter element count too large");
+    }
+    nN = (uint32_t)n;
+    nF = (uint64_t)nN * BLOCK_FILTER_M;
+}
+
+CGCSFilter::CGCSFilter(uint64_t k0, uint64_t k1, const ElementSet &elements) :
+    nK0(k0), nK1(k1), nN(elements.size()), nF((uint64_t)elements.size() * BLOCK_FILTER_M)
+{
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    WriteCompactSize(stream, nN);
+    vEncoded.assign(stream.begin(), stream.end());
+
+    std::vector<uint64_t> hashes;
+    hashes.reserve(elements.size());
+    for (const Element &element : elements)
+    {
+        hashes.push_back(HashToRange(element));
+    }
+    std::sort(hashes.begin(), hashes.end());
+
+    CBitWriter writer(vEncoded);
+    uint64_t last = 0;
+    for (uint64_t value : hashes)
+    {
+        GolombRiceEncode(writer, BLOCK_FILTER_P, value - last);
+        last = value;
+    }
+    writer.Flush();
+}
+
+uint64_t CGCSFilter::HashToRange(const Element &element) const
+{
+    uint64_t hash = CSipHasher(nK0, nK1).Write(element.data(), element.size()).Finalize();
+    return MapIntoRange(hash, nF);
+}
+
+// walks the filter once, against queries sorted the same way as its values
+bool CGCSFilter::MatchSorted(const std::vector<uint64_t> &hashes) const
+{
+    const unsigned char *p = vEncoded.data() + GetSizeOfCompactSize(nN);
+    CBitReader reader(p, vEncoded.data() + vEncoded.size());
+    uint64_t value = 0;
+    size_t next = 0;
+    for (uint32_t i = 0; i < nN; i++)
+    {
+        uint64_t delta;
+        if (!GolombRiceDecode(reader, BLOCK_FILTER_P, delta))
+        {
+            return false;
+        }
+        value += delta;
+        while (next < hashes.size() && hashes[next] < value)
+        {
+            next++;
+        }
+        if (next == hashes.size())
+        {
+            return false;
+        }
+        if (hashes[next] == value)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool CGCSFilter::Match(const Element &element) const
+{
+    return nN && MatchSorted(std::vector<uint64_t>(1, HashToRange(element)));
+}
+
+bool CGCSFilter::MatchAny(const ElementSet &elements) const
+{
+    if (!nN || elements.empty())
+    {
+        return false;
+    }
+    std::vector<uint64_t> hashes;
+    hashes.reserve(elements.size());
+    for (const Element &element : elements)
+    {
+        hashes.push_back(HashToRange(element));
+    }
+    std::sort(hashes.begin(), hashes.end());
+    return MatchSorted(hashes);
+}
+
+CGCSFilter::ElementSet CBlockFilter::GetElements(const CBlock &block, const CBlockUndo &blockUndo)
+{
+    CGCSFilter::ElementSet elements;
+    for (size_t i = 0; i < block.vtx.size(); i++)
+    {
+        for (const CTxOut &out : block.vtx[i].vout)
+        {
+            AddScriptElements(out.scriptPubKey, elements);
+        }
+        if (i > 0 && i - 1 < blockUndo.vtxundo.size())
+        {
+            for (const CTxInUndo &prevout : blockUndo.vtxundo[i - 1].vprevout)
+            {
+                AddScriptElements(prevout.txout.scriptPubKey, elements);
+            }
+        }
+    }
+    return elements;
+}
+
+// the SipHash key is the first 16 bytes of the block hash, so matches cannot be predicted before the block is found
+CBlockFilter::CBlockFilter(const CBlock &block, const CBlockUndo &blockUndo) :
+    nFilterType(BLOCK_FILTER_BASIC), blockHash(block.GetHash())
+{
+    filter = CGCSFilter(ReadLE64(blockHash.begin()), ReadLE64(blockHash.begin() + 8), GetElements(block, blockUndo));
+}
+
+CBlockFilter::CBlockFilter(const uint256 &hashBlock, std::vector<unsigned char> encodedFilter) :
+    nFilterType(BLOCK_FILTER_BASIC), blockHash(hashBlock),
+    filter(ReadLE64(hashBlock.begin()), ReadLE64(hashBlock.begin() + 8), std::move(encodedFilter))
+{
+}
+
+uint256 CBlockFilter::GetHash() const
+{
+    const std::vector<unsigned char> &encoded = filter.GetEncoded();
+    return Hash(encoded.begin(), encoded.end());
+}
+
+uint256 CBlockFilter::ComputeHeader(const uint256 &prevHeader) const
+{
+    uint256 filterHash = GetHash();
+    return Hash(filterHash.begin(), filterHash.end(), prevHeader.begin(), prevHeader.end());
+}
@@ -0,0 +1,107 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef VERUS_BLOCKFILTER_H
+#define VERUS_BLOCKFILTER_H
+
+#include "serialize.h"
+#include "uint256.h"
+
+#include <set>
+#include <stdint.h>
+#include <vector>
+
+class CBlock;
+class CBlockUndo;
+
+// the only filter type, the BIP158 basic filter, extended with the destinations of crypto-condition outputs
+static const uint8_t BLOCK_FILTER_BASIC = 0;
+
+// Golomb-Rice parameters of the basic filter, from BIP158
+static const int BLOCK_FILTER_P = 19;
+static const uint32_t BLOCK_FILTER_M = 784931;
+
+// most filters and filter hashes sent in reply to one getcfilters or getcfheaders, and the interval of cfcheckpt
+static const int MAX_GETCFILTERS_SIZE = 1000;
+static const int MAX_GETCFHEADERS_SIZE = 2000;
+static const int CFCHECKPT_INTERVAL = 1000;
+
+/** A Golomb-coded set, which matches every element it was built from and any other with a probability of 1/M */
+class CGCSFilter
+{
+public:
+    typedef std::vector<unsigned char> Element;
+    typedef std::set<Element> ElementSet;
+
+    CGCSFilter();
+    // decodes the element count of an encoded filter, which must then be matched with the same keys
+    CGCSFilter(uint64_t k0, uint64_t k1, std::vector<unsigned char> encodedFilter);
+    CGCSFilter(uint64_t k0, uint64_t k1, const ElementSet &elements);
+
+    uint32_t GetN() const { return nN; }
+    const std::vector<unsigned char> &GetEncoded() const { return vEncoded; }
+
+    bool Match(const Element &element) const;
+    bool MatchAny(const ElementSet &elements) const;
+
+private:
+    uint64_t nK0, nK1;
+    uint32_t nN;
+    uint64_t nF;
+    std::vector<unsigned char> vEncoded;
+
+    uint64_t HashToRange(const Element &element) const;
+    bool MatchSorted(const std::vector<uint64_t> &hashes) const;
+};
+
+/** The basic filter of a block. Its elements are the output scripts of the block and those of the outputs it spends,
+    except empty and OP_RETURN scripts, and the destination and identity IDs of crypto-condition outputs, so a wallet
+    can match the 20 byte IDs it watches without knowing the condition scripts paying them */
+class CBlockFilter
+{
+public:
+    CBlockFilter() : nFilterType(BLOCK_FILTER_BASIC) {}
+    // the undo data may be empty for the genesis block, whose coinbase spends nothing
+    CBlockFilter(const CBlock &block, const CBlockUndo &blockUndo);
+    CBlockFilter(const uint256 &hashBlock, std::vector<unsigned char> encodedFilter);
+
+    uint8_t GetFilterType() const { return nFilterType; }
+    const uint256 &GetBlockHash() const { return blockHash; }
+    const CGCSFilter &GetFilter() const { return filter; }
+    const std::vector<unsigned char> &GetEncoded() const { return filter.GetEncoded(); }
+
+    uint256 GetHash() const;
+    uint256 ComputeHeader(const uint256 &prevHeader) const;
+
+    static CGCSFilter::ElementSet GetElements(const CBlock &block, const CBlockUndo &blockUndo);
+
+private:
+    uint8_t nFilterType;
+    uint256 blockHash;
+    CGCSFilter filter;
+};
+
+/** The block filter index entry of one block, keyed by its hash. The header commits to the filters of all of the
+    blocks before it, and the filter hash is kept so cfheaders replies do not hash each filter again */
+struct CBlockFilterIndexEntry
+{
+    std::vector<unsigned char> filter;
+    uint256 filterHash;
+    uint256 header;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(filter);
+        READWRITE(filterHash);
+        READWRITE(header);
+    }
+
+    CBlockFilterIndexEntry() {}
+    CBlockFilterIndexEntry(const CBlockFilter &blockFilter, const uint256 &prevHeader) :
+        filter(blockFilter.GetEncoded()), filterHash(blockFilter.GetHash()), header(blockFilter.ComputeHeader(prevHeader)) {}
+};
+
+#endif // VERUS_BLOCKFILTER_H
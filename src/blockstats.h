@@ -0,0 +1,84 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef VERUS_BLOCKSTATS_H
+#define VERUS_BLOCKSTATS_H
+
+#include "amount.h"
+#include "serialize.h"
+#include "pbaas/crosschainrpc.h"
+
+#include <stdint.h>
+
+/** The statistics of one connected block, keyed by its hash in the block stats index. The PBaaS counters come from
+    the reserve transaction descriptor of each transaction as the block is connected, so getblockstats reports them
+    without reading or decoding the block. Fees are those of the transactions other than the coinbase */
+struct CBlockStats
+{
+    uint32_t nTx;
+    uint32_t nSize;
+    uint32_t nInputs;
+    uint32_t nOutputs;
+    CAmount nTotalOut;              // transparent value out of the transactions other than the coinbase
+    CAmount nFees;
+    CAmount nMinFee;
+    CAmount nMaxFee;
+    CCurrencyValueMap reserveFees;
+
+    uint32_t nReserveTransfers;     // reserve transfer outputs, each sent to an export
+    uint32_t nConversions;          // reserve transfers that convert or preconvert
+    uint32_t nImports;
+    uint32_t nExports;
+    uint32_t nIdentityRegistrations;
+    uint32_t nIdentityUpdates;
+    uint32_t nCurrencyDefinitions;
+    uint32_t nNotarizations;
+
+    uint32_t nShieldedTxs;          // transactions with any Sapling spend or output or JoinSplit
+    uint32_t nShieldedSpends;
+    uint32_t nShieldedOutputs;
+    uint32_t nJoinSplits;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(VARINT(nTx));
+        READWRITE(VARINT(nSize));
+        READWRITE(VARINT(nInputs));
+        READWRITE(VARINT(nOutputs));
+        READWRITE(VARINT(nTotalOut));
+        READWRITE(VARINT(nFees));
+        READWRITE(VARINT(nMinFee));
+        READWRITE(VARINT(nMaxFee));
+        READWRITE(reserveFees);
+        READWRITE(VARINT(nReserveTransfers));
+        READWRITE(VARINT(nConversions));
+        READWRITE(VARINT(nImports));
+        READWRITE(VARINT(nExports));
+        READWRITE(VARINT(nIdentityRegistrations));
+        READWRITE(VARINT(nIdentityUpdates));
+        READWRITE(VARINT(nCurrencyDefinitions));
+        READWRITE(VARINT(nNotarizations));
+        READWRITE(VARINT(nShieldedTxs));
+        READWRITE(VARINT(nShieldedSpends));
+        READWRITE(VARINT(nShieldedOutputs));
+        READWRITE(VARINT(nJoinSplits));
+    }
+
+    CBlockStats() {
+        SetNull();
+    }
+
+    void SetNull() {
+        nTx = nSize = nInputs = nOutputs = 0;
+        nTotalOut = nFees = nMinFee = nMaxFee = 0;
+        reserveFees = CCurrencyValueMap();
+        nReserveTransfers = nConversions = nImports = nExports = 0;
+        nIdentityRegistrations = nIdentityUpdates = nCurrencyDefinitions = nNotarizations = 0;
+        nShieldedTxs = nShieldedSpends = nShieldedOutputs = nJoinSplits = 0;
+    }
+};
+
+#endif // VERUS_BLOCKSTATS_H
@@ -13,6 +13,7 @@
  *                                                                            *
  ******************************************************************************/
 
+#include <array>
 #include <univalue.h>
 #include "key_io.h"
 #include "CCinclude.h"
@@ -343,9 +344,63 @@ uint8_t GatewaysCCpriv[32] = { 0xf7, 0x4b, 0x5b, 0xa2, 0x7a, 0x5e, 0x9c, 0xda, 0
 #undef FUNCNAME
 #undef EVALCODE
 
+// validators, input checks and prechecks by eval code, where CCinit also fills in the addresses and keys of a contract
+static constexpr std::array<CCEvalFunctions, 0x100> MakeCCEvalFunctions()
+{
+    std::array<CCEvalFunctions, 0x100> table{};
+    table[EVAL_STAKEGUARD] = {StakeGuardValidate, IsStakeGuardInput, PrecheckStakeGuardOutput};
+    table[EVAL_CURRENCY_DEFINITION] = {ValidateCurrencyDefinition, IsCurrencyDefinitionInput, PrecheckCurrencyDefinition};
+    table[EVAL_EARNEDNOTARIZATION] = {ValidateEarnedNotarization, IsEarnedNotarizationInput, PreCheckAcceptedOrEarnedNotarization};
+    table[EVAL_ACCEPTEDNOTARIZATION] = {ValidateAcceptedNotarization, IsAcceptedNotarizationInput, PreCheckAcceptedOrEarnedNotarization};
+    table[EVAL_FINALIZE_NOTARIZATION] = {ValidateFinalizeNotarization, IsFinalizeNotarizationInput, PreCheckFinalizeNotarization};
+    table[EVAL_NOTARY_EVIDENCE] = {ValidateNotaryEvidence, IsNotaryEvidenceInput, PreCheckNotaryEvidence};
+    table[EVAL_RESERVE_OUTPUT] = {ValidateReserveOutput, IsReserveOutputInput, DefaultCCContextualPreCheck};
+    table[EVAL_IDENTITY_ADVANCEDRESERVATION] = {ValidateAdvancedNameReservation, IsIdentityInput, PrecheckIdentityReservation};
+    table[EVAL_RESERVE_TRANSFER] = {ValidateReserveTransfer, IsReserveTransferInput, PrecheckReserveTransfer};
+    table[EVAL_RESERVE_DEPOSIT] = {ValidateReserveDeposit, IsReserveDepositInput, PrecheckReserveDeposit};
+    table[EVAL_CROSSCHAIN_IMPORT] = {ValidateCrossChainImport, IsCrossChainImportInput, PrecheckCrossChainImport};
+    table[EVAL_CROSSCHAIN_EXPORT] = {ValidateCrossChainExport, IsCrossChainExportInput, PrecheckCrossChainExport};
+    table[EVAL_CURRENCYSTATE] = {ValidateCurrencyState, IsCurrencyStateInput, DefaultCCContextualPreCheck};
+    table[EVAL_IDENTITY_PRIMARY] = {ValidateIdentityPrimary, IsIdentityInput, PrecheckIdentityPrimary};
+    table[EVAL_IDENTITY_REVOKE] = {ValidateIdentityRevoke, IsIdentityInput, DefaultCCContextualPreCheck};
+    table[EVAL_IDENTITY_RECOVER] = {ValidateIdentityRecover, IsIdentityInput, DefaultCCContextualPreCheck};
+    table[EVAL_IDENTITY_COMMITMENT] = {ValidateIdentityCommitment, IsIdentityInput, PrecheckIdentityCommitment};
+    table[EVAL_IDENTITY_RESERVATION] = {ValidateIdentityReservation, IsIdentityInput, PrecheckIdentityReservation};
+    table[EVAL_FINALIZE_EXPORT] = {ValidateFinalizeExport, IsFinalizeExportInput, PreCheckFinalizeExport};
+    table[EVAL_FEE_POOL] = {ValidateFeePool, IsFeePoolInput, PrecheckFeePool};
+    table[EVAL_QUANTUM_KEY] = {ValidateQuantumKeyOut, IsQuantumKeyOutInput, PrecheckQuantumKeyOut};
+    table[EVAL_ASSETS] = {AssetsValidate, IsAssetsInput, nullptr};
+    table[EVAL_FAUCET] = {FaucetValidate, IsFaucetInput, nullptr};
+    table[EVAL_REWARDS] = {RewardsValidate, IsRewardsInput, nullptr};
+    table[EVAL_DICE] = {DiceValidate, IsDiceInput, nullptr};
+    table[EVAL_LOTTO] = {LottoValidate, IsLottoInput, nullptr};
+    table[EVAL_FSM] = {FSMValidate, IsFSMInput, nullptr};
+    table[EVAL_AUCTION] = {AuctionValidate, IsAuctionInput, nullptr};
+    table[EVAL_MOFN] = {MofNValidate, IsMofNInput, nullptr};
+    table[EVAL_CHANNELS] = {ChannelsValidate, IsChannelsInput, nullptr};
+    table[EVAL_ORACLES] = {OraclesValidate, IsOraclesInput, nullptr};
+    table[EVAL_PRICES] = {PricesValidate, IsPricesInput, nullptr};
+    table[EVAL_PEGS] = {PegsValidate, IsPegsInput, nullptr};
+    table[EVAL_TRIGGERS] = {TriggersValidate, IsTriggersInput, nullptr};
+    table[EVAL_PAYMENTS] = {PaymentsValidate, IsPaymentsInput, nullptr};
+    table[EVAL_GATEWAYS] = {GatewaysValidate, IsGatewaysInput, nullptr};
+    return table;
+}
+
+static constexpr std::array<CCEvalFunctions, 0x100> ccEvalFunctions = MakeCCEvalFunctions();
+
+const CCEvalFunctions &GetCCEvalFunctions(uint8_t evalcode)
+{
+    return ccEvalFunctions[evalcode];
+}
+
 struct CCcontract_info *CCinit(struct CCcontract_info *cp, uint8_t evalcode)
 {
+    const CCEvalFunctions &functions = GetCCEvalFunctions(evalcode);
     cp->evalcode = evalcode;
+    cp->validate = functions.validate;
+    cp->ismyvin = functions.ismyvin;
+    cp->contextualprecheck = functions.contextualprecheck;
     switch ( evalcode )
     {
         case EVAL_STAKEGUARD:
@@ -353,9 +408,6 @@ struct CCcontract_info *CCinit(struct CCcontract_info *cp, uint8_t evalcode)
             strcpy(cp->normaladdr,StakeGuardAddr.c_str());
             strcpy(cp->CChexstr,StakeGuardPubKey.c_str());
             memcpy(cp->CCpriv,DecodeSecret(StakeGuardWIF).begin(),32);
-            cp->validate = StakeGuardValidate;
-            cp->ismyvin = IsStakeGuardInput;  // TODO: these input functions are not useful for new CCs
-            cp->contextualprecheck = PrecheckStakeGuardOutput;
             break;
 
         case EVAL_CURRENCY_DEFINITION:
@@ -363,9 +415,6 @@ struct CCcontract_info *CCinit(struct CCcontract_info *cp, uint8_t evalcode)
             strcpy(cp->normaladdr,PBaaSDefinitionAddr.c_str());
             strcpy(cp->CChexstr,PBaaSDefinitionPubKey.c_str());
             memcpy(cp->CCpriv,DecodeSecret(PBaaSDefinitionWIF).begin(),32);
-            cp->validate = ValidateCurrencyDefinition;
-            cp->ismyvin = IsCurrencyDefinitionInput;
-            cp->contextualprecheck = PrecheckCurrencyDefinition;
             break;
 
         case EVAL_EARNEDNOTARIZATION:
@@ -373,9 +422,6 @@ struct CCcontract_info *CCinit(struct CCcontract_info *cp, uint8_t evalcode)
             strcpy(cp->normaladdr,EarnedNotarizationAddr.c_str());
             strcpy(cp->CChexstr,EarnedNotarizationPubKey.c_str());
             memcpy(cp->CCpriv,DecodeSecret(EarnedNotarizationWIF).begin(),32);
-            cp->validate = ValidateEarnedNotarization;
-            cp->ismyvin = IsEarnedNotarizationInput;
-            cp->contextualprecheck = PreCheckAcceptedOrEarnedNotarization;
             break;
 
         case EVAL_ACCEPTEDNOTARIZATION:
@@ -383,9 +429,6 @@ struct CCcontract_info *CCinit(struct CCcontract_info *cp, uint8_t evalcode)
             strcpy(cp->normaladdr,AcceptedNotarizationAddr.c_str());
             strcpy(cp->CChexstr,AcceptedNotarizationPubKey.c_str());
             memcpy(cp->CCpriv,DecodeSecret(AcceptedNotarizationWIF).begin(),32);
-            cp->validate = ValidateAcceptedNotarization;
-            cp->ismyvin = IsAcceptedNotarizationInput;
-            cp->contextualprecheck = PreCheckAcceptedOrEarnedNotarization;
             break;
 
         case EVAL_FINALIZE_NOTARIZATION:
@@ -393,9 +436,6 @@ struct CCcontract_info *CCinit(struct CCcontract_info *cp, uint8_t evalcode)
             strcpy(cp->normaladdr,FinalizeNotarizationAddr.c_str());
             strcpy(cp->CChexstr,FinalizeNotarizationPubKey.c_str());
             memcpy(cp->CCpriv,DecodeSecret(FinalizeNotarizationWIF).begin(),32);
-            cp->validate = ValidateFinalizeNotarization;
-            cp->ismyvin = IsFinalizeNotarizationInput;
-            cp->contextualprecheck = PreCheckFinalizeNotarization;
             break;
 
         case EVAL_NOTARY_EVIDENCE:
@@ -403,9 +443,6 @@ struct CCcontract_info *CCinit(struct CCcontract_info *cp, uint8_t evalcode)
             strcpy(cp->normaladdr,NotaryEvidenceAddr.c_str());
             strcpy(cp->CChexstr,NotaryEvidencePubKey.c_str());
             memcpy(cp->CCpriv,DecodeSecret(NotaryEvidenceWIF).begin(),32);
-            cp->validate = ValidateNotaryEvidence;
-            cp->ismyvin = IsNotaryEvidenceInput;
-            cp->contextualprecheck = PreCheckNotaryEvidence;
             break;
 
         case EVAL_RESERVE_OUTPUT:
@@ -413,9 +450,6 @@ struct CCcontract_info *CCinit(struct CCcontract_info *cp, uint8_t evalcode)
             strcpy(cp->normaladdr, ReserveOutputAddr.c_str());
             strcpy(cp->CChexstr, ReserveOutputPubKey.c_str());
             memcpy(cp->CCpriv,DecodeSecret(ReserveOutputWIF).begin(),32);
-            cp->validate = ValidateReserveOutput;
-            cp->ismyvin = IsReserveOutputInput;
-            cp->contextualprecheck = DefaultCCContextualPreCheck;
             break;
 
         case EVAL_IDENTITY_ADVANCEDRESERVATION:
@@ -423,9 +457,6 @@ struct CCcontract_info *CCinit(struct CCcontract_info *cp, uint8_t evalcode)
             strcpy(cp->normaladdr, AdvancedNameReservationAddr.c_str());
             strcpy(cp->CChexstr, AdvancedNameReservationPubKey.c_str());
             memcpy(cp->CCpriv,DecodeSecret(AdvancedNameReservationWIF).begin(),32);
-            cp->validate = ValidateAdvancedNameReservation;
-            cp->ismyvin = IsIdentityInput;
-            cp->contextualprecheck = PrecheckIdentityReservation;
             break;
 
         case EVAL_RESERVE_TRANSFER:
@@ -433,9 +464,6 @@ struct CCcontract_info *CCinit(struct CCcontract_info *cp, uint8_t evalcode)
             strcpy(cp->normaladdr, ReserveTransferAddr.c_str());
             strcpy(cp->CChexstr, ReserveTransferPubKey.c_str());
             memcpy(cp->CCpriv,DecodeSecret(ReserveTransferWIF).begin(),32);
-            cp->validate = ValidateReserveTransfer;
-            cp->ismyvin = IsReserveTransferInput;
-            cp->contextualprecheck = PrecheckReserveTransfer;
             break;
 
         case EVAL_RESERVE_DEPOSIT:
@@ -443,9 +471,6 @@ struct CCcontract_info *CCinit(struct CCcontract_info *cp, uint8_t evalcode)
             strcpy(cp->normaladdr, ReserveDepositAddr.c_str());
             strcpy(cp->CChexstr, ReserveDepositPubKey.c_str());
             memcpy(cp->CCpriv,DecodeSecret(ReserveDepositWIF).begin(),32);
-            cp->validate = ValidateReserveDeposit;
-            cp->ismyvin = IsReserveDepositInput;
-            cp->contextualprecheck = PrecheckReserveDeposit;
             break;
 
         case EVAL_CROSSCHAIN_IMPORT:
@@ -453,9 +478,6 @@ struct CCcontract_info *CCinit(struct CCcontract_info *cp, uint8_t evalcode)
             strcpy(cp->normaladdr, CrossChainImportAddr.c_str());
             strcpy(cp->CChexstr, CrossChainImportPubKey.c_str());
             memcpy(cp->CCpriv,DecodeSecret(CrossChainImportWIF).begin(),32);
-            cp->validate = ValidateCrossChainImport;
-            cp->ismyvin = IsCrossChainImportInput;
-            cp->contextualprecheck = PrecheckCrossChainImport;
             break;
 
         case EVAL_CROSSCHAIN_EXPORT:
@@ -463,9 +485,6 @@ struct CCcontract_info *CCinit(struct CCcontract_info *cp, uint8_t evalcode)
             strcpy(cp->normaladdr, CrossChainExportAddr.c_str());
             strcpy(cp->CChexstr, CrossChainExportPubKey.c_str());
             memcpy(cp->CCpriv,DecodeSecret(CrossChainExportWIF).begin(),32);
-            cp->validate = ValidateCrossChainExport;
-            cp->ismyvin = IsCrossChainExportInput;
-            cp->contextualprecheck = PrecheckCrossChainExport;
             break;
 
         case EVAL_CURRENCYSTATE:
@@ -473,9 +492,6 @@ struct CCcontract_info *CCinit(struct CCcontract_info *cp, uint8_t evalcode)
             strcpy(cp->normaladdr,CurrencyStateAddr.c_str());
             strcpy(cp->CChexstr, CurrencyStatePubKey.c_str());
             memcpy(cp->CCpriv,DecodeSecret(CurrencyStateWIF).begin(),32);
-            cp->validate = ValidateCurrencyState;
-            cp->ismyvin = IsCurrencyStateInput;
-            cp->contextualprecheck = DefaultCCContextualPreCheck;
             break;
 
         case EVAL_IDENTITY_PRIMARY:
@@ -483,9 +499,6 @@ struct CCcontract_info *CCinit(struct CCcontract_info *cp, uint8_t evalcode)
             strcpy(cp->normaladdr, IdentityPrimaryAddr.c_str());
             strcpy(cp->CChexstr, IdentityPrimaryPubKey.c_str());
             memcpy(cp->CCpriv, DecodeSecret(IdentityPrimaryWIF).begin(),32);
-            cp->validate = ValidateIdentityPrimary;
-            cp->ismyvin = IsIdentityInput;
-            cp->contextualprecheck = &PrecheckIdentityPrimary;
             break;
 
         case EVAL_IDENTITY_REVOKE:
@@ -493,9 +506,6 @@ struct CCcontract_info *CCinit(struct CCcontract_info *cp, uint8_t evalcode)
             strcpy(cp->normaladdr, IdentityRevokeAddr.c_str());
             strcpy(cp->CChexstr, IdentityRevokePubKey.c_str());
             memcpy(cp->CCpriv, DecodeSecret(IdentityRevokeWIF).begin(),32);
-            cp->validate = ValidateIdentityRevoke;
-            cp->ismyvin = IsIdentityInput;
-            cp->contextualprecheck = DefaultCCContextualPreCheck;
             break;
 
         case EVAL_IDENTITY_RECOVER:
@@ -503,9 +513,6 @@ struct CCcontract_info *CCinit(struct CCcontract_info *cp, uint8_t evalcode)
             strcpy(cp->normaladdr, IdentityRecoverAddr.c_str());
             strcpy(cp->CChexstr, IdentityRecoverPubKey.c_str());
             memcpy(cp->CCpriv, DecodeSecret(IdentityRecoverWIF).begin(),32);
-            cp->validate = ValidateIdentityRecover;
-            cp->ismyvin = IsIdentityInput;
-            cp->contextualprecheck = DefaultCCContextualPreCheck;
             break;
 
         case EVAL_IDENTITY_COMMITMENT:
@@ -513,9 +520,6 @@ struct CCcontract_info *CCinit(struct CCcontract_info *cp, uint8_t evalcode)
             strcpy(cp->normaladdr, IdentityCommitmentAddr.c_str());
             strcpy(cp->CChexstr, IdentityCommitmentPubKey.c_str());
             memcpy(cp->CCpriv, DecodeSecret(IdentityCommitmentWIF).begin(),32);
-            cp->validate = ValidateIdentityCommitment;
-            cp->ismyvin = IsIdentityInput;
-            cp->contextualprecheck = PrecheckIdentityCommitment;
             break;
 
         case EVAL_IDENTITY_RESERVATION:
@@ -523,9 +527,6 @@ struct CCcontract_info *CCinit(struct CCcontract_info *cp, uint8_t evalcode)
             strcpy(cp->normaladdr, IdentityReservationAddr.c_str());
             strcpy(cp->CChexstr, IdentityReservationPubKey.c_str());
             memcpy(cp->CCpriv, DecodeSecret(IdentityReservationWIF).begin(),32);
-            cp->validate = ValidateIdentityReservation;
-            cp->ismyvin = IsIdentityInput;
-            cp->contextualprecheck = PrecheckIdentityReservation;
             break;
 
         case EVAL_FINALIZE_EXPORT:
@@ -533,9 +534,6 @@ struct CCcontract_info *CCinit(struct CCcontract_info *cp, uint8_t evalcode)
             strcpy(cp->normaladdr,FinalizeExportAddr.c_str());
             strcpy(cp->CChexstr,FinalizeExportPubKey.c_str());
             memcpy(cp->CCpriv,DecodeSecret(FinalizeExportWIF).begin(),32);
-            cp->validate = ValidateFinalizeExport;
-            cp->ismyvin = IsFinalizeExportInput;  // TODO: these input functions are not useful for new CCs
-            cp->contextualprecheck = PreCheckFinalizeExport;
             break;
 
         case EVAL_FEE_POOL:
@@ -543,9 +541,6 @@ struct CCcontract_info *CCinit(struct CCcontract_info *cp, uint8_t evalcode)
             strcpy(cp->normaladdr, FeePoolAddr.c_str());
             strcpy(cp->CChexstr, FeePoolPubKey.c_str());
             memcpy(cp->CCpriv, DecodeSecret(FeePoolWIF).begin(),32);
-            cp->validate = ValidateFeePool;
-            cp->ismyvin = IsFeePoolInput;
-            cp->contextualprecheck = PrecheckFeePool;
             break;
 
         case EVAL_QUANTUM_KEY:
@@ -553,9 +548,6 @@ struct CCcontract_info *CCinit(struct CCcontract_info *cp, uint8_t evalcode)
             strcpy(cp->normaladdr, QuantumKeyOutAddr.c_str());
             strcpy(cp->CChexstr, QuantumKeyOutPubKey.c_str());     // ironically, this does not need to be a quantum secure public key, since privkey is public
             memcpy(cp->CCpriv, DecodeSecret(QuantumKeyOutWIF).begin(),32);
-            cp->validate = ValidateQuantumKeyOut;
-            cp->ismyvin = IsQuantumKeyOutInput;
-            cp->contextualprecheck = PrecheckQuantumKeyOut;
             break;
 
         // these are currently not used and should be triple checked if reenabled
@@ -564,120 +556,90 @@ struct CCcontract_info *CCinit(struct CCcontract_info *cp, uint8_t evalcode)
             strcpy(cp->normaladdr,AssetsNormaladdr);
             strcpy(cp->CChexstr,AssetsCChexstr);
             memcpy(cp->CCpriv,AssetsCCpriv,32);
-            cp->validate = AssetsValidate;
-            cp->ismyvin = IsAssetsInput;
             break;
         case EVAL_FAUCET:
             strcpy(cp->unspendableCCaddr,FaucetCCaddr);
             strcpy(cp->normaladdr,FaucetNormaladdr);
             strcpy(cp->CChexstr,FaucetCChexstr);
             memcpy(cp->CCpriv,FaucetCCpriv,32);
-            cp->validate = FaucetValidate;
-            cp->ismyvin = IsFaucetInput;
             break;
         case EVAL_REWARDS:
             strcpy(cp->unspendableCCaddr,RewardsCCaddr);
             strcpy(cp->normaladdr,RewardsNormaladdr);
             strcpy(cp->CChexstr,RewardsCChexstr);
             memcpy(cp->CCpriv,RewardsCCpriv,32);
-            cp->validate = RewardsValidate;
-            cp->ismyvin = IsRewardsInput;
             break;
         case EVAL_DICE:
             strcpy(cp->unspendableCCaddr,DiceCCaddr);
             strcpy(cp->normaladdr,DiceNormaladdr);
             strcpy(cp->CChexstr,DiceCChexstr);
             memcpy(cp->CCpriv,DiceCCpriv,32);
-            cp->validate = DiceValidate;
-            cp->ismyvin = IsDiceInput;
             break;
         case EVAL_LOTTO:
             strcpy(cp->unspendableCCaddr,LottoCCaddr);
             strcpy(cp->normaladdr,LottoNormaladdr);
             strcpy(cp->CChexstr,LottoCChexstr);
             memcpy(cp->CCpriv,LottoCCpriv,32);
-            cp->validate = LottoValidate;
-            cp->ismyvin = IsLottoInput;
             break;
         case EVAL_FSM:
             strcpy(cp->unspendableCCaddr,FSMCCaddr);
             strcpy(cp->normaladdr,FSMNormaladdr);
             strcpy(cp->CChexstr,FSMCChexstr);
             memcpy(cp->CCpriv,FSMCCpriv,32);
-            cp->validate = FSMValidate;
-            cp->ismyvin = IsFSMInput;
             break;
         case EVAL_AUCTION:
             strcpy(cp->unspendableCCaddr,AuctionCCaddr);
             strcpy(cp->normaladdr,AuctionNormaladdr);
             strcpy(cp->CChexstr,AuctionCChexstr);
             memcpy(cp->CCpriv,AuctionCCpriv,32);
-            cp->validate = AuctionValidate;
-            cp->ismyvin = IsAuctionInput;
             break;
         case EVAL_MOFN:
             strcpy(cp->unspendableCCaddr,MofNCCaddr);
             strcpy(cp->normaladdr,MofNNormaladdr);
             strcpy(cp->CChexstr,MofNCChexstr);
             memcpy(cp->CCpriv,MofNCCpriv,32);
-            cp->validate = MofNValidate;
-            cp->ismyvin = IsMofNInput;
             break;
         case EVAL_CHANNELS:
             strcpy(cp->unspendableCCaddr,ChannelsCCaddr);
             strcpy(cp->normaladdr,ChannelsNormaladdr);
             strcpy(cp->CChexstr,ChannelsCChexstr);
             memcpy(cp->CCpriv,ChannelsCCpriv,32);
-            cp->validate = ChannelsValidate;
-            cp->ismyvin = IsChannelsInput;
             break;
         case EVAL_ORACLES:
             strcpy(cp->unspendableCCaddr,OraclesCCaddr);
             strcpy(cp->normaladdr,OraclesNormaladdr);
             strcpy(cp->CChexstr,OraclesCChexstr);
             memcpy(cp->CCpriv,OraclesCCpriv,32);
-            cp->validate = OraclesValidate;
-            cp->ismyvin = IsOraclesInput;
             break;
         case EVAL_PRICES:
             strcpy(cp->unspendableCCaddr,PricesCCaddr);
             strcpy(cp->normaladdr,PricesNormaladdr);
             strcpy(cp->CChexstr,PricesCChexstr);
             memcpy(cp->CCpriv,PricesCCpriv,32);
-            cp->validate = PricesValidate;
-            cp->ismyvin = IsPricesInput;
             break;
         case EVAL_PEGS:
             strcpy(cp->unspendableCCaddr,PegsCCaddr);
             strcpy(cp->normaladdr,PegsNormaladdr);
             strcpy(cp->CChexstr,PegsCChexstr);
             memcpy(cp->CCpriv,PegsCCpriv,32);
-            cp->validate = PegsValidate;
-            cp->ismyvin = IsPegsInput;
             break;
         case EVAL_TRIGGERS:
             strcpy(cp->unspendableCCaddr,TriggersCCaddr);
             strcpy(cp->normaladdr,TriggersNormaladdr);
             strcpy(cp->CChexstr,TriggersCChexstr);
             memcpy(cp->CCpriv,TriggersCCpriv,32);
-            cp->validate = TriggersValidate;
-            cp->ismyvin = IsTriggersInput;
             break;
         case EVAL_PAYMENTS:
             strcpy(cp->unspendableCCaddr,PaymentsCCaddr);
             strcpy(cp->normaladdr,PaymentsNormaladdr);
             strcpy(cp->CChexstr,PaymentsCChexstr);
             memcpy(cp->CCpriv,PaymentsCCpriv,32);
-            cp->validate = PaymentsValidate;
-            cp->ismyvin = IsPaymentsInput;
             break;
         case EVAL_GATEWAYS:
             strcpy(cp->unspendableCCaddr,GatewaysCCaddr);
             strcpy(cp->normaladdr,GatewaysNormaladdr);
             strcpy(cp->CChexstr,GatewaysCChexstr);
             memcpy(cp->CCpriv,GatewaysCCpriv,32);
-            cp->validate = GatewaysValidate;
-            cp->ismyvin = IsGatewaysInput;
             break;
     }
     return(cp);
@@ -86,6 +86,15 @@ struct CCcontract_info
 };
 struct CCcontract_info *CCinit(struct CCcontract_info *cp,uint8_t evalcode);
 
+// the functions of an eval code, which are null for those it has none of or if the eval code is unknown
+struct CCEvalFunctions
+{
+    bool (*validate)(struct CCcontract_info *cp, Eval* eval, const CTransaction &tx, uint32_t nIn, bool fulfilled);
+    bool (*ismyvin)(CScript const& scriptSig);
+    bool (*contextualprecheck)(const CTransaction &tx, int32_t outNum, CValidationState &state, uint32_t height);
+};
+const CCEvalFunctions &GetCCEvalFunctions(uint8_t evalcode);
+
 struct oracleprice_info
 {
     CPubKey pk;
@@ -96,7 +105,8 @@ struct oracleprice_info
 #ifdef ENABLE_WALLET
 extern CWallet* pwalletMain;
 #endif
-bool GetAddressUnspent(const uint160& addressHash, int type, std::vector<CAddressUnspentDbEntry>& unspentOutputs);
+bool GetAddressUnspent(const uint160& addressHash, int type, std::vector<CAddressUnspentDbEntry>& unspentOutputs,
+                       unsigned int maxCount, const CAddressUnspentKey *pAfter);
 
 static const uint256 zeroid;
 bool myGetTransaction(const uint256 &hash, CTransaction &txOut, uint256 &hashBlock, bool checkMempool=true);
@@ -190,13 +200,15 @@ CScript MakeMofNCCScript(const CConditionObj<TOBJ> &conditionObj, const CTxDesti
     int idxSize = indexIDs.size();
 
     COptCCParams masterParams = COptCCParams(COptCCParams::VERSION_V3, 0, idxSize, idxSize, indexIDs, std::vector<std::vector<unsigned char>>());
-    CScript scriptRet = CScript() << masterParams.AsVector() << OP_CHECKCRYPTOCONDITION;
 
     std::vector<std::vector<unsigned char>> vvch = conditionObj.HaveObject() ? std::vector<std::vector<unsigned char>>({::AsVector(conditionObj.obj)}) : std::vector<std::vector<unsigned char>>();
-    COptCCParams vParams = COptCCParams(COptCCParams::VERSION_V3, conditionObj.evalCode, conditionObj.m, (uint8_t)(conditionObj.dests.size()), conditionObj.dests, vvch);
+    COptCCParams vParams = COptCCParams(COptCCParams::VERSION_V3, conditionObj.evalCode, conditionObj.m, (uint8_t)(conditionObj.dests.size()), conditionObj.dests, std::move(vvch));
 
-    // add the object to the end of the script
-    scriptRet << vParams.AsVector() << OP_DROP;
+    // add the object after the master condition, in a script sized once for both
+    std::vector<unsigned char> vMasterData = masterParams.AsVector(), vParamsData = vParams.AsVector();
+    CScript scriptRet;
+    scriptRet.reserve(vMasterData.size() + vParamsData.size() + 2 * MAX_CC_PUSH_OVERHEAD);
+    scriptRet << vMasterData << OP_CHECKCRYPTOCONDITION << vParamsData << OP_DROP;
     return scriptRet;
 }
 
@@ -209,13 +221,15 @@ CScript MakeMofNCCScript(const CConditionObj<TOBJ> &conditionObj, const std::vec
     int idxSize = indexIDs.size();
 
     COptCCParams masterParams = COptCCParams(COptCCParams::VERSION_V3, 0, idxSize, idxSize, indexIDs, std::vector<std::vector<unsigned char>>());
-    CScript scriptRet = CScript() << masterParams.AsVector() << OP_CHECKCRYPTOCONDITION;
 
     std::vector<std::vector<unsigned char>> vvch = conditionObj.HaveObject() ? std::vector<std::vector<unsigned char>>({::AsVector(conditionObj.obj)}) : std::vector<std::vector<unsigned char>>();
-    COptCCParams vParams = COptCCParams(COptCCParams::VERSION_V3, conditionObj.evalCode, conditionObj.m, (uint8_t)(conditionObj.dests.size()), conditionObj.dests, vvch);
+    COptCCParams vParams = COptCCParams(COptCCParams::VERSION_V3, conditionObj.evalCode, conditionObj.m, (uint8_t)(conditionObj.dests.size()), conditionObj.dests, std::move(vvch));
 
-    // add the object to the end of the script
-    scriptRet << vParams.AsVector() << OP_DROP;
+    // add the object after the master condition, in a script sized once for both
+    std::vector<unsigned char> vMasterData = masterParams.AsVector(), vParamsData = vParams.AsVector();
+    CScript scriptRet;
+    scriptRet.reserve(vMasterData.size() + vParamsData.size() + 2 * MAX_CC_PUSH_OVERHEAD);
+    scriptRet << vMasterData << OP_CHECKCRYPTOCONDITION << vParamsData << OP_DROP;
     return scriptRet;
 }
 
@@ -226,16 +240,18 @@ CScript MakeMofNCCScript(int M, TOBJ1 &condition1, TOBJ2 &condition2, const std:
     std::vector<CTxDestination> indexIDs = indexDests ? *indexDests : std::vector<CTxDestination>({condition1.dests[0], condition2.dests[0]});
 
     COptCCParams masterParams = COptCCParams(COptCCParams::VERSION_V3, 0, M, 2, indexIDs, std::vector<std::vector<unsigned char>>());
-    CScript scriptRet = CScript() << masterParams.AsVector() << OP_CHECKCRYPTOCONDITION;
 
     std::vector<std::vector<unsigned char>> vvch2 = condition2.HaveObject() ? std::vector<std::vector<unsigned char>>({::AsVector(condition2.obj)}) : std::vector<std::vector<unsigned char>>();
-    COptCCParams vParams2 = COptCCParams(COptCCParams::VERSION_V3, condition2.evalCode, condition2.m, (uint8_t)(condition2.dests.size()), condition2.dests, vvch2);
+    COptCCParams vParams2 = COptCCParams(COptCCParams::VERSION_V3, condition2.evalCode, condition2.m, (uint8_t)(condition2.dests.size()), condition2.dests, std::move(vvch2));
 
     std::vector<std::vector<unsigned char>> vvch1({::AsVector(condition1.obj), vParams2.AsVector()});
-    COptCCParams vParams1 = COptCCParams(COptCCParams::VERSION_V3, condition1.evalCode, condition1.m, (uint8_t)(condition1.dests.size()), condition1.dests, vvch1);
+    COptCCParams vParams1 = COptCCParams(COptCCParams::VERSION_V3, condition1.evalCode, condition1.m, (uint8_t)(condition1.dests.size()), condition1.dests, std::move(vvch1));
 
-    // add the object to the end of the script
-    scriptRet << vParams1.AsVector() << OP_DROP;
+    // add the object after the master condition, in a script sized once for both
+    std::vector<unsigned char> vMasterData = masterParams.AsVector(), vParamsData = vParams1.AsVector();
+    CScript scriptRet;
+    scriptRet.reserve(vMasterData.size() + vParamsData.size() + 2 * MAX_CC_PUSH_OVERHEAD);
+    scriptRet << vMasterData << OP_CHECKCRYPTOCONDITION << vParamsData << OP_DROP;
     return scriptRet;
 }
 
@@ -246,19 +262,21 @@ CScript MakeMofNCCScript(int M, TOBJ1 &condition1, TOBJ2 &condition2, TOBJ3 &con
     std::vector<CTxDestination> indexIDs = indexDests ? *indexDests : std::vector<CTxDestination>({condition1.dests[0], condition2.dests[0], condition3.dests[0]});
 
     COptCCParams masterParams = COptCCParams(COptCCParams::VERSION_V3, 0, M, 3, indexIDs, std::vector<std::vector<unsigned char>>());
-    CScript scriptRet = CScript() << masterParams.AsVector() << OP_CHECKCRYPTOCONDITION;
 
     std::vector<std::vector<unsigned char>> vvch2 = condition2.HaveObject() ? std::vector<std::vector<unsigned char>>({::AsVector(condition2.obj)}) : std::vector<std::vector<unsigned char>>();
-    COptCCParams vParams2 = COptCCParams(COptCCParams::VERSION_V3, condition2.evalCode, condition2.m, (uint8_t)(condition2.dests.size()), condition2.dests, vvch2);
+    COptCCParams vParams2 = COptCCParams(COptCCParams::VERSION_V3, condition2.evalCode, condition2.m, (uint8_t)(condition2.dests.size()), condition2.dests, std::move(vvch2));
 
     std::vector<std::vector<unsigned char>> vvch3 = condition3.HaveObject() ? std::vector<std::vector<unsigned char>>({::AsVector(condition3.obj)}) : std::vector<std::vector<unsigned char>>();
-    COptCCParams vParams3 = COptCCParams(COptCCParams::VERSION_V3, condition3.evalCode, condition3.m, (uint8_t)(condition3.dests.size()), condition3.dests, vvch3);
+    COptCCParams vParams3 = COptCCParams(COptCCParams::VERSION_V3, condition3.evalCode, condition3.m, (uint8_t)(condition3.dests.size()), condition3.dests, std::move(vvch3));
 
     std::vector<std::vector<unsigned char>> vvch({::AsVector(condition1.obj), vParams2.AsVector(), vParams3.AsVector()});
-    COptCCParams vParams1 = COptCCParams(COptCCParams::VERSION_V3, condition1.evalCode, condition1.m, (uint8_t)(condition1.dests.size()), condition1.dests, vvch);
+    COptCCParams vParams1 = COptCCParams(COptCCParams::VERSION_V3, condition1.evalCode, condition1.m, (uint8_t)(condition1.dests.size()), condition1.dests, std::move(vvch));
 
-    // add the object to the end of the script
-    scriptRet << vParams1.AsVector() << OP_DROP;
+    // add the object after the master condition, in a script sized once for both
+    std::vector<unsigned char> vMasterData = masterParams.AsVector(), vParamsData = vParams1.AsVector();
+    CScript scriptRet;
+    scriptRet.reserve(vMasterData.size() + vParamsData.size() + 2 * MAX_CC_PUSH_OVERHEAD);
+    scriptRet << vMasterData << OP_CHECKCRYPTOCONDITION << vParamsData << OP_DROP;
     return scriptRet;
 }
 
@@ -269,22 +287,24 @@ CScript MakeMofNCCScript(int M, TOBJ1 &condition1, TOBJ2 &condition2, TOBJ3 &con
     std::vector<CTxDestination> indexIDs = indexDests ? *indexDests : std::vector<CTxDestination>({condition1.dests[0], condition2.dests[0], condition3.dests[0], condition4.dests[0]});
 
     COptCCParams masterParams = COptCCParams(COptCCParams::VERSION_V3, 0, M, 4, indexIDs, std::vector<std::vector<unsigned char>>());
-    CScript scriptRet = CScript() << masterParams.AsVector() << OP_CHECKCRYPTOCONDITION;
 
     std::vector<std::vector<unsigned char>> vvch2 = condition2.HaveObject() ? std::vector<std::vector<unsigned char>>({::AsVector(condition2.obj)}) : std::vector<std::vector<unsigned char>>();
-    COptCCParams vParams2 = COptCCParams(COptCCParams::VERSION_V3, condition2.evalCode, condition2.m, (uint8_t)(condition2.dests.size()), condition2.dests, vvch2);
+    COptCCParams vParams2 = COptCCParams(COptCCParams::VERSION_V3, condition2.evalCode, condition2.m, (uint8_t)(condition2.dests.size()), condition2.dests, std::move(vvch2));
 
     std::vector<std::vector<unsigned char>> vvch3 = condition3.HaveObject() ? std::vector<std::vector<unsigned char>>({::AsVector(condition3.obj)}) : std::vector<std::vector<unsigned char>>();
-    COptCCParams vParams3 = COptCCParams(COptCCParams::VERSION_V3, condition3.evalCode, condition3.m, (uint8_t)(condition3.dests.size()), condition3.dests, vvch3);
+    COptCCParams vParams3 = COptCCParams(COptCCParams::VERSION_V3, condition3.evalCode, condition3.m, (uint8_t)(condition3.dests.size()), condition3.dests, std::move(vvch3));
 
     std::vector<std::vector<unsigned char>> vvch4 = condition3.HaveObject() ? std::vector<std::vector<unsigned char>>({::AsVector(condition4.obj)}) : std::vector<std::vector<unsigned char>>();
-    COptCCParams vParams4 = COptCCParams(COptCCParams::VERSION_V3, condition4.evalCode, condition4.m, (uint8_t)(condition4.dests.size()), condition4.dests, vvch4);
+    COptCCParams vParams4 = COptCCParams(COptCCParams::VERSION_V3, condition4.evalCode, condition4.m, (uint8_t)(condition4.dests.size()), condition4.dests, std::move(vvch4));
 
     std::vector<std::vector<unsigned char>> vvch({::AsVector(condition1.obj), vParams2.AsVector(), vParams3.AsVector(), vParams4.AsVector()});
-    COptCCParams vParams1 = COptCCParams(COptCCParams::VERSION_V3, condition1.evalCode, condition1.m, (uint8_t)(condition1.dests.size()), condition1.dests, vvch);
+    COptCCParams vParams1 = COptCCParams(COptCCParams::VERSION_V3, condition1.evalCode, condition1.m, (uint8_t)(condition1.dests.size()), condition1.dests, std::move(vvch));
 
-    // add the object to the end of the script
-    scriptRet << vParams1.AsVector() << OP_DROP;
+    // add the object after the master condition, in a script sized once for both
+    std::vector<unsigned char> vMasterData = masterParams.AsVector(), vParamsData = vParams1.AsVector();
+    CScript scriptRet;
+    scriptRet.reserve(vMasterData.size() + vParamsData.size() + 2 * MAX_CC_PUSH_OVERHEAD);
+    scriptRet << vMasterData << OP_CHECKCRYPTOCONDITION << vParamsData << OP_DROP;
     return scriptRet;
 }
 
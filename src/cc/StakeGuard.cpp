@@ -15,9 +15,11 @@
 #include "hash.h"
 #include "key_io.h"
 #include "pbaas/pbaas.h"
+#include "lrucache.h"
 
 #include <vector>
 #include <map>
+#include <tuple>
 
 #include "streams.h"
 
@@ -29,7 +31,7 @@ extern int32_t VERUS_MIN_STAKEAGE;
 // the only time it matters is to validate a properly formed stake transaction for either pre-check before PoS validity check,
 // or to validate the stake transaction on a fork that will be used to spend a winning stake that cheated by being posted
 // on two fork chains
-bool ValidateStakeTransaction(const CCurrencyDefinition &sourceChain, const CTransaction &stakeTx, CStakeParams &stakeParams, bool slowValidation)
+static bool ValidateStakeTransactionUncached(const CCurrencyDefinition &sourceChain, const CTransaction &stakeTx, CStakeParams &stakeParams, bool slowValidation)
 {
     std::vector<std::vector<unsigned char>> vData = std::vector<std::vector<unsigned char>>();
 
@@ -150,6 +152,34 @@ bool ValidateStakeTransaction(const CCurrencyDefinition &sourceChain, const CTra
     return false;
 }
 
+// slow validation results by the tip they were checked on, the source chain and the stake transaction. a PoS block
+// checks its stake once for each guarded coinbase output and again for itself, when it is checked and when it is
+// connected, and a cheat spend checks it again, all on the same tip
+static LRUCache<std::tuple<uint256, uint160, uint256>, std::pair<bool, CStakeParams>> stakeValidationCache(1000, 0.1F, true);
+
+bool ValidateStakeTransaction(const CCurrencyDefinition &sourceChain, const CTransaction &stakeTx, CStakeParams &stakeParams, bool slowValidation)
+{
+    if (!slowValidation)
+    {
+        return ValidateStakeTransactionUncached(sourceChain, stakeTx, stakeParams, false);
+    }
+
+    // the source transaction's block must be in the active chain, and its identities are looked up at the tip, so the
+    // result only holds for the tip it was checked on
+    CBlockIndex *pindexTip = chainActive.LastTip();
+    std::tuple<uint256, uint160, uint256> cacheKey(pindexTip ? pindexTip->GetBlockHash() : uint256(), sourceChain.GetID(), stakeTx.GetHash());
+    std::pair<bool, CStakeParams> result;
+    if (stakeValidationCache.Get(cacheKey, result))
+    {
+        stakeParams = result.second;
+        return result.first;
+    }
+    result.first = ValidateStakeTransactionUncached(sourceChain, stakeTx, stakeParams, true);
+    result.second = stakeParams;
+    stakeValidationCache.Put(cacheKey, result);
+    return result.first;
+}
+
 bool ValidateStakeTransaction(const CTransaction &stakeTx, CStakeParams &stakeParams, bool slowValidation)
 {
     return ValidateStakeTransaction(ConnectedChains.ThisChain(), stakeTx, stakeParams, slowValidation);
@@ -340,7 +370,7 @@ bool RawPrecheckStakeGuardOutput(const CTransaction &tx, int32_t outNum, CValida
     cp = CCinit(&C,EVAL_STAKEGUARD);
     CPubKey defaultPubKey(ParseHex(cp->CChexstr));
 
-    if (tx.vout[outNum].scriptPubKey.IsPayToCryptoCondition(p) &&
+    if (tx.IsPayToCryptoCondition(outNum, p) &&
         p.IsValid() &&
         p.version >= p.VERSION_V3 &&
         p.evalCode == EVAL_STAKEGUARD &&
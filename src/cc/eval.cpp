@@ -14,6 +14,7 @@
  ******************************************************************************/
 
 #include <assert.h>
+#include <mutex>
 #include <cryptoconditions.h>
 
 #include "script/cc.h"
@@ -24,16 +25,147 @@
 #include "chain.h"
 #include "core_io.h"
 #include "crosschain.h"
+#include "dbwrapper.h"
+#include "tinyformat.h"
+#include "trace.h"
 
 
 Eval* EVAL_TEST = 0;
 struct CCcontract_info CCinfos[0x100];
 extern CCriticalSection smartTransactionCS;
 
-bool RunCCEval(const CC *cond, const CTransaction &tx, unsigned int nIn, bool fulfilled)
+static thread_local const CEvalBlockContext *pThreadBlockContext = nullptr;
+
+const CEvalBlockContext *CEvalBlockContext::Current()
+{
+    return pThreadBlockContext;
+}
+
+// filled once for each eval code, then only read, so the script check threads share it without a lock
+static const CCcontract_info &GetCCinfo(uint8_t evalCode)
+{
+    static std::once_flag initFlags[0x100];
+    std::call_once(initFlags[evalCode], [evalCode]()
+    {
+        CCinit(&CCinfos[evalCode], evalCode);
+        CCinfos[evalCode].didinit = 1;
+    });
+    return CCinfos[evalCode];
+}
+
+namespace {
+
+struct CCEvalRecorder
+{
+    CDBLatencyHistogram times;
+    std::atomic<uint64_t> nFailures;
+
+    CCEvalRecorder() : nFailures(0) {}
+};
+
+// by eval code, validations of spends, then prechecks of outputs
+CCEvalRecorder ccEvalRecorders[2][0x100];
+
+const char *ccEvalCheckNames[2] = {"validate", "precheck"};
+
+} // namespace
+
+void RecordCCEval(uint8_t evalCode, bool fPrecheck, bool fValid, int64_t nMicros)
+{
+    TRACE4(cc, eval_end, evalCode, fPrecheck, fValid, nMicros);
+    CCEvalRecorder &recorder = ccEvalRecorders[fPrecheck ? 1 : 0][evalCode];
+    recorder.times.Add(nMicros);
+    if (!fValid)
+    {
+        recorder.nFailures++;
+    }
+}
+
+std::string GetCCEvalMetrics()
+{
+    std::string strCounts, strFailures, strTimes;
+    for (int check = 0; check < 2; check++)
+    {
+        for (int evalCode = 0; evalCode < 0x100; evalCode++)
+        {
+            const CCEvalRecorder &recorder = ccEvalRecorders[check][evalCode];
+            CDBLatencyStats stats = recorder.times.GetStats();
+            if (!stats.nCount)
+            {
+                continue;
+            }
+            std::string strLabels = strprintf("eval=\"%s\",check=\"%s\"", EvalToStr((EvalCode)evalCode), ccEvalCheckNames[check]);
+            strCounts += strprintf("verus_cc_eval_total{%s} %u\n", strLabels, stats.nCount);
+            strFailures += strprintf("verus_cc_eval_failures_total{%s} %u\n", strLabels, recorder.nFailures.load());
+
+            // the histogram buckets are cumulative, the last of ours only has the +Inf bound
+            uint64_t nCumulative = 0;
+            for (int i = 0; i < CDBLatencyStats::BUCKETS - 1; i++)
+            {
+                nCumulative += stats.buckets[i];
+                strTimes += strprintf("verus_cc_eval_seconds_bucket{%s,le=\"%g\"} %u\n", strLabels, ((int64_t)1 << i) / 1e6, nCumulative);
+            }
+            strTimes += strprintf("verus_cc_eval_seconds_bucket{%s,le=\"+Inf\"} %u\n", strLabels, stats.nCount);
+            strTimes += strprintf("verus_cc_eval_seconds_sum{%s} %.6f\n", strLabels, stats.nTotalMicros / 1e6);
+            strTimes += strprintf("verus_cc_eval_seconds_count{%s} %u\n", strLabels, stats.nCount);
+        }
+    }
+
+    return "# HELP verus_cc_eval_total Smart transaction spends validated and outputs prechecked, by eval code\n"
+           "# TYPE verus_cc_eval_total counter\n" + strCounts +
+           "# HELP verus_cc_eval_failures_total Smart transaction spends and outputs that failed validation, by eval code\n"
+           "# TYPE verus_cc_eval_failures_total counter\n" + strFailures +
+           "# HELP verus_cc_eval_seconds Time spent validating smart transaction spends and prechecking outputs, by eval code\n"
+           "# TYPE verus_cc_eval_seconds histogram\n" + strTimes;
+}
+
+std::vector<CCEvalStats> GetCCEvalStats()
+{
+    std::vector<CCEvalStats> ret;
+    for (int check = 0; check < 2; check++)
+    {
+        for (int evalCode = 0; evalCode < 0x100; evalCode++)
+        {
+            const CCEvalRecorder &recorder = ccEvalRecorders[check][evalCode];
+            CDBLatencyStats stats = recorder.times.GetStats();
+            if (stats.nCount)
+            {
+                ret.push_back({(uint8_t)evalCode, check == 1, recorder.nFailures.load(), stats});
+            }
+        }
+    }
+    return ret;
+}
+
+void ResetCCEvalStats()
+{
+    for (int check = 0; check < 2; check++)
+    {
+        for (int evalCode = 0; evalCode < 0x100; evalCode++)
+        {
+            ccEvalRecorders[check][evalCode].times.Reset();
+            ccEvalRecorders[check][evalCode].nFailures = 0;
+        }
+    }
+}
+
+bool RunCCEval(const CC *cond, const CTransaction &tx, unsigned int nIn, bool fulfilled, const CEvalBlockContext *pBlockContext)
 {
     EvalRef eval;
     bool out;
+    if (pBlockContext)
+    {
+        struct CContextScope
+        {
+            const CEvalBlockContext *pPriorContext;
+            CContextScope(const CEvalBlockContext *pContext) : pPriorContext(pThreadBlockContext) { pThreadBlockContext = pContext; }
+            ~CContextScope() { pThreadBlockContext = pPriorContext; }
+        } contextScope(pBlockContext);
+
+        eval->pBlockContext = pBlockContext;
+        out = eval->Dispatch(cond, tx, nIn, fulfilled);
+    }
+    else
     {
         LOCK(smartTransactionCS);
         out = eval->Dispatch(cond, tx, nIn, fulfilled);
@@ -78,17 +210,16 @@ bool EvalNoneContextualPreCheck(const CTransaction &tx, int32_t outNum, CValidat
  */
 bool Eval::Dispatch(const CC *cond, const CTransaction &txTo, unsigned int nIn, bool fulfilled)
 {
-    struct CCcontract_info *cp;
     if (cond->codeLength == 0)
         return Invalid("empty-eval");
 
     uint8_t ecode = cond->code[0];
-    cp = &CCinfos[(int32_t)ecode];
-    if ( cp->didinit == 0 )
-    {
-        CCinit(cp,ecode);
-        cp->didinit = 1;
-    }
+    // validators get their own copy, since they may write to it
+    struct CCcontract_info C = GetCCinfo(ecode), *cp = &C;
+
+    // when checking a block, the tip may not be its parent for as long as its checks run
+    const CBlockIndex *pindexPrev = pBlockContext ? pBlockContext->pindexPrev : chainActive.LastTip();
+
     std::vector<uint8_t> vparams(cond->code+1, cond->code+cond->codeLength);
     switch ( ecode )
     {
@@ -104,7 +235,7 @@ bool Eval::Dispatch(const CC *cond, const CTransaction &txTo, unsigned int nIn,
         case EVAL_CROSSCHAIN_IMPORT:
         case EVAL_FINALIZE_EXPORT:
         case EVAL_FEE_POOL:
-            if (!chainActive.LastTip() || CConstVerusSolutionVector::activationHeight.ActiveVersion(chainActive.LastTip()->GetHeight() + 1) < CActivationHeight::ACTIVATE_PBAAS)
+            if (!pindexPrev || CConstVerusSolutionVector::activationHeight.ActiveVersion(pindexPrev->GetHeight() + 1) < CActivationHeight::ACTIVATE_PBAAS)
             {
                 // if chain is not able to process this yet, don't drop through to do so
                 break;
@@ -115,14 +246,19 @@ bool Eval::Dispatch(const CC *cond, const CTransaction &txTo, unsigned int nIn,
         case EVAL_IDENTITY_RECOVER:
         case EVAL_IDENTITY_COMMITMENT:
         case EVAL_IDENTITY_RESERVATION:
-            if (!chainActive.LastTip() || CConstVerusSolutionVector::activationHeight.ActiveVersion(chainActive.LastTip()->GetHeight() + 1) < CActivationHeight::ACTIVATE_IDENTITY)
+            if (!pindexPrev || CConstVerusSolutionVector::activationHeight.ActiveVersion(pindexPrev->GetHeight() + 1) < CActivationHeight::ACTIVATE_IDENTITY)
             {
                 break;
             }
 
         case EVAL_STAKEGUARD:
-            return(ProcessCC(cp,this, vparams, txTo, nIn, fulfilled));
-            break;
+        {
+            TRACE4(cc, eval_start, ecode, false, txTo.GetHash().begin(), nIn);
+            int64_t nStart = GetTimeMicros();
+            bool fValid = ProcessCC(cp,this, vparams, txTo, nIn, fulfilled);
+            RecordCCEval(ecode, false, fValid, GetTimeMicros() - nStart);
+            return fValid;
+        }
     }
     return Invalid("invalid smart transaction code");
 }
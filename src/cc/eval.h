@@ -23,7 +23,9 @@
 #include "streams.h"
 #include "version.h"
 #include "consensus/validation.h"
+#include "dbwrapper.h"
 #include "primitives/transaction.h"
+#include "sync.h"
 
 #define KOMODO_FIRSTFUNGIBLEID 100
 
@@ -95,10 +97,32 @@ class AppVM;
 class NotarisationData;
 
 
+/**
+ * The block whose transactions are being checked, set by ConnectBlock on the script checks it queues. The thread
+ * connecting the block holds cs_main until they are done, so neither the chain below the block nor the mempool can
+ * change while they run, which is what smartTransactionCS and the mempool lock otherwise keep validators safe
+ * against. Checks with a context take neither, so those of one block run in parallel on the script check threads.
+ */
+class CEvalBlockContext
+{
+public:
+    const CBlockIndex *pindexPrev;
+
+    CEvalBlockContext(const CBlockIndex *pindexPrevIn) : pindexPrev(pindexPrevIn) {}
+
+    /** The context of the check running on this thread, or null */
+    static const CEvalBlockContext *Current();
+};
+
+/** Locks cs, unless this thread is checking a block, see CEvalBlockContext */
+#define LOCK_UNLESS_BLOCK_CHECK(cs) CCriticalBlock criticalblock(CEvalBlockContext::Current() ? nullptr : &(cs), #cs, __FILE__, __LINE__, false, LOCK_SITE(cs))
+
+
 class Eval
 {
 public:
     CValidationState state;
+    const CEvalBlockContext *pBlockContext = nullptr;
 
     bool Invalid(std::string s) { return state.Invalid(false, 0, s); }
     bool Error(std::string s) { return state.Error(s); }
@@ -143,6 +167,25 @@ public:
 
 extern Eval* EVAL_TEST;
 
+/** Counts and times one validation of a spend or precheck of an output of an eval code */
+void RecordCCEval(uint8_t evalCode, bool fPrecheck, bool fValid, int64_t nMicros);
+
+/** Counts and times of the validations and prechecks of each eval code since startup, as Prometheus metrics */
+std::string GetCCEvalMetrics();
+
+/** Validation or precheck times of one eval code */
+struct CCEvalStats
+{
+    uint8_t evalCode;
+    bool fPrecheck;
+    uint64_t nFailures;
+    CDBLatencyStats times;
+};
+
+/** The times of each eval code and check that has been run since startup or the last ResetCCEvalStats */
+std::vector<CCEvalStats> GetCCEvalStats();
+void ResetCCEvalStats();
+
 
 /*
  * Get a pointer to an Eval to use
@@ -158,7 +201,7 @@ public:
 
 
 
-bool RunCCEval(const CC *cond, const CTransaction &tx, unsigned int nIn, bool fulfilled);
+bool RunCCEval(const CC *cond, const CTransaction &tx, unsigned int nIn, bool fulfilled, const CEvalBlockContext *pBlockContext=nullptr);
 
 
 /*
@@ -5,6 +5,10 @@
 
 #include "chain.h"
 
+#include "hash.h"
+#include "random.h"
+#include "streams.h"
+
 using namespace std;
 
 /**
@@ -25,11 +29,171 @@ void CChain::SetTip(CBlockIndex *pindex) {
         pindex = pindex->pprev;
     }
     mmr.Truncate(vChain.size() - modCount);
-    for (int i = (vChain.size() - modCount); i < vChain.size(); i++)
+
+    // add the new blocks to the Merkle Mountain Range, which reads their nodes from the chain
+    mmr.layer0.resize(vChain.size());
+    mmr.AddParentNodes();
+}
+
+static const uint32_t CHAIN_MMR_FILE_MAGIC = 0x726d6d63;
+static const uint32_t CHAIN_MMR_FILE_VERSION = 1;
+
+/**
+ * Chain MMR file format, version 1:
+ *   magic, version, number of leaves, hash of the last block covered
+ *   number of upper layers, size of each upper layer
+ *   hash and power of every upper node, lowest layer first
+ *   hash of all of the above
+ * Leaves are not stored, as they are derived from the block index.
+ */
+void CChain::WriteMMR(CAutoFile &file) const
+{
+    CHashWriter hw(SER_GETHASH, 0);
+    auto put = [&file, &hw](const auto &obj)
+    {
+        file << obj;
+        hw << obj;
+    };
+
+    uint64_t nLeaves = mmr.size();
+    put(CHAIN_MMR_FILE_MAGIC);
+    put(CHAIN_MMR_FILE_VERSION);
+    put(nLeaves);
+    put(nLeaves ? vChain[nLeaves - 1]->GetBlockHash() : uint256());
+    put((uint32_t)mmr.upperNodes.size());
+    for (auto &layer : mmr.upperNodes)
+    {
+        put(layer.size());
+    }
+    for (auto &layer : mmr.upperNodes)
+    {
+        for (uint64_t i = 0; i < layer.size(); i++)
+        {
+            ChainMMRNode node = layer[i];
+            put(node.hash);
+            put(node.power);
+        }
+    }
+    file << hw.GetHash();
+}
+
+// reads the upper layers written by WriteMMR into the empty MMR, returns the number of leaves they cover or 0
+uint64_t CChain::ReadMMR(CAutoFile &file)
+{
+    // nodes recomputed from their children as a check of the loaded layers
+    static const int MMR_SPOT_CHECKS = 64;
+
+    CHashWriter hw(SER_GETHASH, 0);
+    auto get = [&file, &hw](auto &obj)
+    {
+        file >> obj;
+        hw << obj;
+    };
+
+    uint32_t magic, version, nLayers;
+    uint64_t nLeaves;
+    uint256 lastHash;
+    get(magic);
+    get(version);
+    if (magic != CHAIN_MMR_FILE_MAGIC || version != CHAIN_MMR_FILE_VERSION)
+    {
+        return 0;
+    }
+    get(nLeaves);
+    get(lastHash);
+    if (!nLeaves || nLeaves > vChain.size() || vChain[nLeaves - 1]->GetBlockHash() != lastHash)
+    {
+        return 0;
+    }
+
+    // the shape of an MMR only depends on its number of leaves, layer h above the leaves has nLeaves >> (h + 1) nodes
+    uint32_t nExpectedLayers = 0;
+    for (uint64_t n = nLeaves >> 1; n; n >>= 1)
+    {
+        nExpectedLayers++;
+    }
+    get(nLayers);
+    if (nLayers != nExpectedLayers)
+    {
+        return 0;
+    }
+    for (uint32_t h = 0; h < nLayers; h++)
+    {
+        uint64_t layerSize;
+        get(layerSize);
+        if (layerSize != nLeaves >> (h + 1))
+        {
+            return 0;
+        }
+    }
+
+    mmr.upperNodes.resize(nLayers);
+    for (uint32_t h = 0; h < nLayers; h++)
+    {
+        for (uint64_t i = 0, layerSize = nLeaves >> (h + 1); i < layerSize; i++)
+        {
+            ChainMMRNode node;
+            get(node.hash);
+            get(node.power);
+            mmr.upperNodes[h].push_back(node);
+        }
+    }
+
+    uint256 fileHash;
+    file >> fileHash;
+    if (fileHash != hw.GetHash())
+    {
+        return 0;
+    }
+
+    mmr.layer0.resize(nLeaves);
+    for (int i = 0; i < MMR_SPOT_CHECKS && nLayers; i++)
+    {
+        uint32_t h = GetRand(nLayers);
+        uint64_t idx = GetRand(mmr.upperNodes[h].size());
+        ChainMMRNode left = h ? mmr.upperNodes[h - 1][idx << 1] : mmr.layer0[idx << 1];
+        ChainMMRNode right = h ? mmr.upperNodes[h - 1][(idx << 1) + 1] : mmr.layer0[(idx << 1) + 1];
+        ChainMMRNode parent = left.CreateParentNode(right);
+        if (parent.hash != mmr.upperNodes[h][idx].hash || parent.power != mmr.upperNodes[h][idx].power)
+        {
+            return 0;
+        }
+    }
+    return nLeaves;
+}
+
+uint64_t CChain::SetTipWithMMR(CBlockIndex *pindex, CAutoFile &file)
+{
+    lastTip = pindex;
+    vChain.clear();
+    mmr.Clear();
+    if (pindex == NULL)
+    {
+        return 0;
+    }
+    vChain.resize(pindex->GetHeight() + 1);
+    for (CBlockIndex *pindexWalk = pindex; pindexWalk; pindexWalk = pindexWalk->pprev)
+    {
+        vChain[pindexWalk->GetHeight()] = pindexWalk;
+    }
+
+    uint64_t nLoaded = 0;
+    try
+    {
+        nLoaded = ReadMMR(file);
+    }
+    catch (const std::exception &e)
+    {
+        nLoaded = 0;
+    }
+    if (!nLoaded)
     {
-        // add this block to the Merkle Mountain Range
-        mmr.Add(vChain[i]->GetBlockMMRNode());
+        mmr.Clear();
     }
+
+    mmr.layer0.resize(vChain.size());
+    mmr.AddParentNodes();
+    return nLoaded;
 }
 
 // returns false if unable to fast calculate the VerusPOSHash from the header.
@@ -223,13 +387,48 @@ const CBlockIndex *CChain::FindFork(const CBlockIndex *pindex) const {
     return pindex;
 }
 
+CChainProofCache chainProofCache;
+
+UniValue CChainProofCache::ToUniValue()
+{
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("entries", (int64_t)branches.size());
+    ret.pushKV("maxentries", branches.capacity());
+    ret.pushKV("hits", (int64_t)nHits.load());
+    ret.pushKV("misses", (int64_t)nMisses.load());
+    return ret;
+}
+
+bool CChain::GetChainMMRBranch(ChainMerkleMountainView &view, CMMRProof &retProof, int index) const
+{
+    CChainProofCache::CProofKey key(view.GetRoot(), index, CMerkleBranchBase::BRANCH_MMRBLAKE_POWERNODE);
+    CMMRPowerNodeBranch branch;
+    if (chainProofCache.Get(key, branch))
+    {
+        retProof << branch;
+        return true;
+    }
+
+    CMMRProof branchProof;
+    if (!view.GetProof(branchProof, index) ||
+        branchProof.proofSequence.size() != 1 ||
+        branchProof.proofSequence[0]->branchType != CMerkleBranchBase::BRANCH_MMRBLAKE_POWERNODE)
+    {
+        return false;
+    }
+    branch = *(CMMRPowerNodeBranch *)branchProof.proofSequence[0];
+    chainProofCache.Put(key, branch);
+    retProof << branch;
+    return true;
+}
+
 bool CChain::GetBlockProof(ChainMerkleMountainView &view, CMMRProof &retProof, int index) const
 {
     CBlockIndex *pindex = (index < 0 || index >= (int)vChain.size()) ? NULL : vChain[index];
     if (pindex)
     {
         retProof << pindex->BlockProofBridge();
-        return view.GetProof(retProof, index);
+        return GetChainMMRBranch(view, retProof, index);
     }
     else
     {
@@ -243,7 +442,7 @@ bool CChain::GetMerkleProof(ChainMerkleMountainView &view, CMMRProof &retProof,
     if (pindex)
     {
         retProof << pindex->MMRProofBridge();
-        return view.GetProof(retProof, index);
+        return GetChainMMRBranch(view, retProof, index);
     }
     else
     {
@@ -14,7 +14,10 @@ class CChainPower;
 #include "tinyformat.h"
 #include "uint256.h"
 #include "mmr.h"
+#include "lrucache.h"
 
+#include <atomic>
+#include <tuple>
 #include <vector>
 
 static const int SPROUT_VALUE_VERSION = 1001400;
@@ -504,14 +507,23 @@ public:
     CBlockIndex* GetAncestor(int height);
     const CBlockIndex* GetAncestor(int height) const;
 
+    // these only depend on the nonce and version, so they are read directly rather than by building a header,
+    // which would copy the entire solution
     int32_t GetVerusPOSTarget() const
     {
-        return GetBlockHeader().GetVerusPOSTarget();
+        uint32_t nBits = 0;
+
+        for (const unsigned char *p = nNonce.begin() + 3; p >= nNonce.begin(); p--)
+        {
+            nBits <<= 8;
+            nBits += *p;
+        }
+        return nBits;
     }
 
     bool IsVerusPOSBlock() const
     {
-        return GetBlockHeader().IsVerusPOSBlock();
+        return CPOSNonce(nNonce).IsPOSNonce(nVersion) && GetVerusPOSTarget() != 0;
     }
 
     bool GetRawVerusPOSHash(uint256 &ret) const;
@@ -712,9 +724,50 @@ public:
 };
 
 class CChain;
+class CAutoFile;
 typedef CMerkleMountainRange<ChainMMRNode, CChunkedLayer<ChainMMRNode, 9>, COverlayNodeLayer<ChainMMRNode, CChain>> ChainMerkleMountainRange;
 typedef CMerkleMountainView<ChainMMRNode, CChunkedLayer<ChainMMRNode, 9>, COverlayNodeLayer<ChainMMRNode, CChain>> ChainMerkleMountainView;
 
+/** A shared cache of the chain MMR branches of block header and merkle proofs, keyed by the root of the view the
+ * branch proves to, the height of the proven block and the branch type. Notaries and bridge relayers request proofs
+ * of the same blocks against the same notarized roots from many processes, and as an entry can only be valid for
+ * the view whose root it is keyed by, entries never need to be invalidated on a reorg.
+ */
+class CChainProofCache
+{
+public:
+    static const int DEFAULT_MAX_ENTRIES = 10000;
+
+    typedef std::tuple<uint256, uint32_t, uint8_t> CProofKey;
+
+    CChainProofCache(int maxEntries=DEFAULT_MAX_ENTRIES) : branches(maxEntries, 0.1, true), nHits(0), nMisses(0) {}
+
+    bool Get(const CProofKey &key, CMMRPowerNodeBranch &branch)
+    {
+        if (branches.Get(key, branch))
+        {
+            nHits++;
+            return true;
+        }
+        nMisses++;
+        return false;
+    }
+
+    void Put(const CProofKey &key, const CMMRPowerNodeBranch &branch)
+    {
+        branches.Put(key, branch);
+    }
+
+    UniValue ToUniValue();
+
+private:
+    LRUCache<CProofKey, CMMRPowerNodeBranch> branches;
+    std::atomic<uint64_t> nHits;
+    std::atomic<uint64_t> nMisses;
+};
+
+extern CChainProofCache chainProofCache;
+
 /** An in-memory indexed chain of blocks.
  * With Verus and PBaaS chains, this also provides a complete Merkle Mountain Range (MMR) for the chain at all times,
  * enabling proof of any transaction that can be exported and trusted on any chain that has a trusted oracle or other lite proof of this chain.
@@ -773,6 +826,9 @@ public:
     bool GetBlockProof(ChainMerkleMountainView &view, CMMRProof &retProof, int index) const;
     bool GetMerkleProof(ChainMerkleMountainView &view, CMMRProof &retProof, int index) const;
 
+    // adds the branch from a block to the root of the view, from chainProofCache if present
+    bool GetChainMMRBranch(ChainMerkleMountainView &view, CMMRProof &retProof, int index) const;
+
     /** Compare two chains efficiently. */
     friend bool operator==(const CChain &a, const CChain &b) {
         return a.vChain.size() == b.vChain.size() &&
@@ -805,6 +861,16 @@ public:
     /** Set/initialize a chain with a given tip. */
     void SetTip(CBlockIndex *pindex);
 
+    /** Write the upper layers of the MMR, which take long to recompute for a long chain, for SetTipWithMMR. */
+    void WriteMMR(CAutoFile &file) const;
+
+    /**
+     * Initialize a chain with a given tip like SetTip, but take the upper MMR layers covering the start of the chain from
+     * a file written by WriteMMR, if it is intact and that part is still in the chain. Only blocks past it are added to
+     * the MMR. Returns the number of blocks covered by the file, 0 if it could not be used.
+     */
+    uint64_t SetTipWithMMR(CBlockIndex *pindex, CAutoFile &file);
+
     /** Return a CBlockLocator that refers to a block in this chain (by default the tip). */
     CBlockLocator GetLocator(const CBlockIndex *pindex = NULL) const;
 
@@ -812,6 +878,9 @@ public:
     const CBlockIndex *FindFork(const CBlockIndex *pindex) const;
 
     CPartialTransactionProof GetPreHeaderProof(const CBlock &block, uint32_t blockHeight, uint32_t proofAtHeight) const;
+
+private:
+    uint64_t ReadMMR(CAutoFile &file);
 };
 
 #endif // BITCOIN_CHAIN_H
@@ -21,6 +21,7 @@
 
 #include <vector>
 #include <map>
+#include <unordered_map>
 
 class CTxHolder
 {
@@ -49,10 +50,31 @@ class CTxHolder
 class CCheatList
 {
     private:
-        std::multimap<const int32_t, CTxHolder> orderedCheatCandidates;
-        std::multimap<const uint256, CTxHolder *> indexedCheatCandidates;
+        // a candidate with the stake parameters of its transaction, which are parsed once, when it is added
+        struct CCheatCandidate
+        {
+            CTxHolder txh;
+            bool fStakeParams;
+            uint256 prevHash;
+            uint32_t blkHeight;
+
+            CCheatCandidate(const CTxHolder &_txh);
+        };
+
+        struct CUTXOHasher
+        {
+            size_t operator()(const uint256 &utxo) const { return utxo.GetCheapHash(); }
+        };
+
+        // candidates by the hash of the outpoint they stake, so a check only visits the candidates of one outpoint,
+        // and the outpoint hashes at each height, so pruning only visits the heights it removes
+        std::unordered_map<uint256, std::vector<CCheatCandidate>, CUTXOHasher> utxoCandidates;
+        std::map<uint32_t, std::vector<uint256>> heightCandidates;
         CCriticalSection cs_cheat;
 
+        // removes the candidates staking utxo at or below height, returning how many were removed
+        uint32_t RemoveCandidates(const uint256 &utxo, uint32_t height);
+
     public:
         CCheatList() {}
 
@@ -6,6 +6,7 @@
 
 #include "memusage.h"
 #include "random.h"
+#include "trace.h"
 #include "version.h"
 #include "policy/fees.h"
 #include "komodo_defs.h"
@@ -62,6 +63,21 @@ bool CCoinsView::BatchWrite(CCoinsMap &mapCoins,
                             CNullifiersMap &mapSproutNullifiers,
                             CNullifiersMap &mapSaplingNullifiers) { return false; }
 bool CCoinsView::GetStats(CCoinsStats &stats) const { return false; }
+bool CCoinsView::WriteSnapshot(CAutoFile &file, const uint160 &chainID, CCoinsSnapshotInfo &info) const { return false; }
+bool CCoinsView::SupportsConcurrentReads() const { return false; }
+size_t CCoinsView::GetCoinsMany(const std::vector<uint256> &txids, std::vector<CCoins> &coins, std::vector<unsigned char> &found, int nThreads) const
+{
+    size_t nFound = 0;
+    coins.assign(txids.size(), CCoins());
+    found.assign(txids.size(), 0);
+    for (size_t i = 0; i < txids.size(); i++)
+    {
+        found[i] = GetCoins(txids[i], coins[i]);
+        nFound += found[i];
+    }
+    return nFound;
+}
+bool CCoinsView::SyncWrites() { return true; }
 
 
 CCoinsViewBacked::CCoinsViewBacked(CCoinsView *viewIn) : base(viewIn) { }
@@ -83,10 +99,16 @@ bool CCoinsViewBacked::BatchWrite(CCoinsMap &mapCoins,
                                   CNullifiersMap &mapSproutNullifiers,
                                   CNullifiersMap &mapSaplingNullifiers) { return base->BatchWrite(mapCoins, hashBlock, hashSproutAnchor, hashSaplingAnchor, mapSproutAnchors, mapSaplingAnchors, mapSproutNullifiers, mapSaplingNullifiers); }
 bool CCoinsViewBacked::GetStats(CCoinsStats &stats) const { return base->GetStats(stats); }
+bool CCoinsViewBacked::WriteSnapshot(CAutoFile &file, const uint160 &chainID, CCoinsSnapshotInfo &info) const { return base->WriteSnapshot(file, chainID, info); }
+bool CCoinsViewBacked::SupportsConcurrentReads() const { return base->SupportsConcurrentReads(); }
+bool CCoinsViewBacked::SyncWrites() { return base->SyncWrites(); }
 
 CCoinsKeyHasher::CCoinsKeyHasher() : salt(GetRandHash()) {}
 
-CCoinsViewCache::CCoinsViewCache(CCoinsView *baseIn) : CCoinsViewBacked(baseIn), hasModifier(false), cachedCoinsUsage(0) { }
+CCoinsViewCache::CCoinsViewCache(CCoinsView *baseIn) :
+    CCoinsViewBacked(baseIn), hasModifier(false),
+    cacheCoins(0, CCoinsKeyHasher(), std::equal_to<uint256>(), CCoinsMapAllocator(&cacheCoinsMemoryResource)),
+    cachedCoinsUsage(0) { }
 
 CCoinsViewCache::~CCoinsViewCache()
 {
@@ -106,6 +128,7 @@ CCoinsMap::const_iterator CCoinsViewCache::FetchCoins(const uint256 &txid) const
     CCoinsMap::iterator it = cacheCoins.find(txid);
     if (it != cacheCoins.end())
         return it;
+    TRACE1(coins, cache_miss, txid.begin());
     CCoins tmp;
     if (!base->GetCoins(txid, tmp))
         return cacheCoins.end();
@@ -373,6 +396,66 @@ CCoinsModifier CCoinsViewCache::ModifyNewCoins(const uint256 &txid) {
     return CCoinsModifier(*this, ret.first, 0);
 }
 
+size_t CCoinsViewCache::PrefetchCoins(const std::vector<uint256> &txids, int nThreads)
+{
+    if (nThreads <= 0 || !base->SupportsConcurrentReads())
+    {
+        return 0;
+    }
+
+    std::vector<uint256> missing;
+    missing.reserve(txids.size());
+    for (const uint256 &txid : txids)
+    {
+        if (!cacheCoins.count(txid))
+        {
+            missing.push_back(txid);
+        }
+    }
+    std::sort(missing.begin(), missing.end());
+    missing.erase(std::unique(missing.begin(), missing.end()), missing.end());
+    if (missing.empty())
+    {
+        return 0;
+    }
+
+    // the backing view resolves the sorted txids in as few passes over its store as it can.
+    // a read that throws is left to the lazy path, which reports it in the caller's thread
+    std::vector<CCoins> fetched;
+    std::vector<unsigned char> found;
+    try
+    {
+        base->GetCoinsMany(missing, fetched, found, nThreads);
+    }
+    catch (const std::exception &e)
+    {
+        return 0;
+    }
+
+    size_t nAdded = 0;
+    for (size_t i = 0; i < missing.size(); i++)
+    {
+        if (!found[i])
+        {
+            continue;
+        }
+        std::pair<CCoinsMap::iterator, bool> ret = cacheCoins.insert(std::make_pair(missing[i], CCoinsCacheEntry()));
+        if (!ret.second)
+        {
+            continue;
+        }
+        fetched[i].swap(ret.first->second.coins);
+        if (ret.first->second.coins.IsPruned())
+        {
+            // as in FetchCoins, the parent only has an empty entry for this txid
+            ret.first->second.flags = CCoinsCacheEntry::FRESH;
+        }
+        cachedCoinsUsage += ret.first->second.coins.DynamicMemoryUsage();
+        nAdded++;
+    }
+    return nAdded;
+}
+
 const CCoins* CCoinsViewCache::AccessCoins(const uint256 &txid) const {
     CCoinsMap::const_iterator it = FetchCoins(txid);
     if (it == cacheCoins.end()) {
@@ -542,6 +625,7 @@ bool CCoinsViewCache::BatchWrite(CCoinsMap &mapCoins,
 bool CCoinsViewCache::Flush() {
     bool fOk = base->BatchWrite(cacheCoins, hashBlock, hashSproutAnchor, hashSaplingAnchor, cacheSproutAnchors, cacheSaplingAnchors, cacheSproutNullifiers, cacheSaplingNullifiers);
     cacheCoins.clear();
+    ReallocateCache();
     cacheSproutAnchors.clear();
     cacheSaplingAnchors.clear();
     cacheSproutNullifiers.clear();
@@ -550,6 +634,16 @@ bool CCoinsViewCache::Flush() {
     return fOk;
 }
 
+void CCoinsViewCache::ReallocateCache()
+{
+    // the pool never returns its chunks, so give the memory of a flushed cache back by starting a new pool
+    assert(cacheCoins.empty());
+    cacheCoins.~CCoinsMap();
+    cacheCoinsMemoryResource.~CCoinsMapMemoryResource();
+    ::new (&cacheCoinsMemoryResource) CCoinsMapMemoryResource();
+    ::new (&cacheCoins) CCoinsMap(0, CCoinsKeyHasher(), std::equal_to<uint256>(), CCoinsMapAllocator(&cacheCoinsMemoryResource));
+}
+
 unsigned int CCoinsViewCache::GetCacheSize() const {
     return cacheCoins.size();
 }
@@ -11,6 +11,7 @@
 #include "compressor.h"
 #include "core_memusage.h"
 #include "memusage.h"
+#include "support/allocators/pool.h"
 #include "serialize.h"
 #include "uint256.h"
 #include "base58.h"
@@ -335,7 +336,15 @@ enum ShieldedType
     SAPLING,
 };
 
-typedef boost::unordered_map<uint256, CCoinsCacheEntry, CCoinsKeyHasher> CCoinsMap;
+/**
+ * The nodes of the coins cache come from a pool rather than one malloc each, as with a large -dbcache the
+ * allocator overhead otherwise takes a good part of the cache's memory. Blocks of up to this size are pooled,
+ * which covers the map node on all supported Boost versions, while bucket arrays still come from the heap.
+ */
+static const size_t COINS_MAP_POOL_BLOCK_SIZE = sizeof(std::pair<const uint256, CCoinsCacheEntry>) + sizeof(void*) * 4;
+typedef PoolAllocator<std::pair<const uint256, CCoinsCacheEntry>, COINS_MAP_POOL_BLOCK_SIZE> CCoinsMapAllocator;
+typedef CCoinsMapAllocator::ResourceType CCoinsMapMemoryResource;
+typedef boost::unordered_map<uint256, CCoinsCacheEntry, CCoinsKeyHasher, std::equal_to<uint256>, CCoinsMapAllocator> CCoinsMap;
 typedef boost::unordered_map<uint256, CAnchorsSproutCacheEntry, CCoinsKeyHasher> CAnchorsSproutMap;
 typedef boost::unordered_map<uint256, CAnchorsSaplingCacheEntry, CCoinsKeyHasher> CAnchorsSaplingMap;
 typedef boost::unordered_map<uint256, CNullifiersCacheEntry, CCoinsKeyHasher> CNullifiersMap;
@@ -353,6 +362,22 @@ struct CCoinsStats
     CCoinsStats() : nHeight(0), nTransactions(0), nTransactionOutputs(0), nSerializedSize(0), nTotalAmount(0) {}
 };
 
+/** Contents of a chainstate snapshot, see CCoinsView::WriteSnapshot */
+struct CCoinsSnapshotInfo
+{
+    uint256 hashBlock;
+    uint256 hashSproutAnchor;
+    uint256 hashSaplingAnchor;
+    uint64_t nCoins;
+    uint64_t nAnchors;
+    uint64_t nNullifiers;
+    uint256 hashSnapshot;           // hash of the snapshot contents, which is also stored at its end
+
+    CCoinsSnapshotInfo() : nCoins(0), nAnchors(0), nNullifiers(0) {}
+};
+
+class CAutoFile;
+
 
 /** Abstract view on the open txout dataset. */
 class CCoinsView
@@ -394,6 +419,18 @@ public:
     //! Calculate statistics about the unspent transaction output set
     virtual bool GetStats(CCoinsStats &stats) const;
 
+    //! Write a versioned snapshot of all coins, anchors and nullifiers, committed to by a hash of its contents
+    virtual bool WriteSnapshot(CAutoFile &file, const uint160 &chainID, CCoinsSnapshotInfo &info) const;
+
+    //! Whether GetCoins may be called from several threads at once
+    virtual bool SupportsConcurrentReads() const;
+
+    //! Retrieve the CCoins for many txids at once, found[i] tells whether coins[i] was filled in. Returns the number found
+    virtual size_t GetCoinsMany(const std::vector<uint256> &txids, std::vector<CCoins> &coins, std::vector<unsigned char> &found, int nThreads) const;
+
+    //! Wait until all changes passed to BatchWrite are on disk, returns false if writing them failed
+    virtual bool SyncWrites();
+
     //! As we use CCoinsViews polymorphically, have a virtual destructor
     virtual ~CCoinsView() {}
 };
@@ -424,6 +461,9 @@ public:
                     CNullifiersMap &mapSproutNullifiers,
                     CNullifiersMap &mapSaplingNullifiers);
     bool GetStats(CCoinsStats &stats) const;
+    bool WriteSnapshot(CAutoFile &file, const uint160 &chainID, CCoinsSnapshotInfo &info) const;
+    bool SupportsConcurrentReads() const;
+    bool SyncWrites();
 };
 
 
@@ -492,6 +532,8 @@ protected:
      * declared as "const".  
      */
     mutable uint256 hashBlock;
+    // must be declared before, and so outlive, cacheCoins
+    mutable CCoinsMapMemoryResource cacheCoinsMemoryResource;
     mutable CCoinsMap cacheCoins;
     mutable uint256 hashSproutAnchor;
     mutable uint256 hashSaplingAnchor;
@@ -562,6 +604,16 @@ public:
      */
     CCoinsModifier ModifyNewCoins(const uint256 &txid);
 
+    /**
+     * Load the coins of all given txids that are not cached yet from the backing view, reading them on up to
+     * nThreads threads at once. Entries are added unmodified, exactly as AccessCoins would add them. Does nothing
+     * unless the backing view supports concurrent reads. Returns the number of entries added.
+     */
+    size_t PrefetchCoins(const std::vector<uint256> &txids, int nThreads);
+
+    // the cache itself is not thread safe, even for reads
+    bool SupportsConcurrentReads() const { return false; }
+
     /**
      * Push the modifications applied to this cache to its base.
      * Failure to call this method before destruction will cause the changes to be forgotten.
@@ -609,6 +661,9 @@ private:
     CCoinsMap::iterator FetchCoins(const uint256 &txid);
     CCoinsMap::const_iterator FetchCoins(const uint256 &txid) const;
 
+    //! Replace the empty coins map and its memory pool with new ones, releasing the pool's chunks
+    void ReallocateCache();
+
     /**
      * By making the copy constructor private, we prevent accidentally using it when one intends to create a cache on top of a base cache.
      */
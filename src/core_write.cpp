@@ -1512,6 +1512,42 @@ UniValue CMMRProof::ToUniValue() const
                 retObj.push_back(Pair("hashes", branchArray));
                 break;
             }
+            case CMerkleBranchBase::BRANCH_MMRBLAKE_NODE_MULTILEAF:
+            {
+                CMMRNodeMultiBranch &branch = *(CMMRNodeMultiBranch *)(proof);
+                retObj.push_back(Pair("branchtype", (int)CMerkleBranchBase::BRANCH_MMRBLAKE_NODE_MULTILEAF));
+                UniValue indexArray(UniValue::VARR);
+                for (auto oneIndex : branch.nIndexes)
+                {
+                    indexArray.push_back((int64_t)oneIndex);
+                }
+                retObj.push_back(Pair("indexes", indexArray));
+                retObj.push_back(Pair("mmvsize", (int64_t)(branch.nSize)));
+                for (auto &oneHash : branch.branch)
+                {
+                    branchArray.push_back(oneHash.GetHex());
+                }
+                retObj.push_back(Pair("hashes", branchArray));
+                break;
+            }
+            case CMerkleBranchBase::BRANCH_MMRBLAKE_POWERNODE_MULTILEAF:
+            {
+                CMMRPowerNodeMultiBranch &branch = *(CMMRPowerNodeMultiBranch *)(proof);
+                retObj.push_back(Pair("branchtype", (int)CMerkleBranchBase::BRANCH_MMRBLAKE_POWERNODE_MULTILEAF));
+                UniValue indexArray(UniValue::VARR);
+                for (auto oneIndex : branch.nIndexes)
+                {
+                    indexArray.push_back((int64_t)oneIndex);
+                }
+                retObj.push_back(Pair("indexes", indexArray));
+                retObj.push_back(Pair("mmvsize", (int64_t)(branch.nSize)));
+                for (auto &oneHash : branch.branch)
+                {
+                    branchArray.push_back(oneHash.GetHex());
+                }
+                retObj.push_back(Pair("hashes", branchArray));
+                break;
+            }
             case CMerkleBranchBase::BRANCH_ETH:
             {
                 CETHPATRICIABranch &branch = *(CETHPATRICIABranch *)(proof);
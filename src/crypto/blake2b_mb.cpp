@@ -0,0 +1,312 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "crypto/blake2b_mb.h"
+#include "crypto/common.h"
+
+#include <string.h>
+
+#if !defined(__arm__) && !defined(__aarch64__)
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+static const uint64_t blake2b_IV[8] = {
+    0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+    0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+
+static const uint8_t blake2b_sigma[12][16] = {
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+    { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+    { 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+    {  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+    {  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+    {  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+    { 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+    { 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+    {  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+    { 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 },
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+    { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 }
+};
+
+// the chaining value after the parameter block, before any message: 32 byte digest, no key, fanout and depth 1,
+// zero salt and the personalization in the last two words
+static void InitialState(const unsigned char personal[BLAKE2B_MB_PERSONAL_SIZE], uint64_t h[8])
+{
+    for (int i = 0; i < 8; i++)
+    {
+        h[i] = blake2b_IV[i];
+    }
+    h[0] ^= 0x01010000ULL | BLAKE2B_MB_OUTPUT_SIZE;
+    h[6] ^= ReadLE64(personal);
+    h[7] ^= ReadLE64(personal + 8);
+}
+
+static inline uint64_t rotr64(uint64_t x, int n)
+{
+    return (x >> n) | (x << (64 - n));
+}
+
+#define BLAKE2B_G(a, b, c, d, x, y)                         \
+    do {                                                    \
+        a = ADD(ADD(a, b), x); d = ROR32(XOR(d, a));        \
+        c = ADD(c, d);         b = ROR24(XOR(b, c));        \
+        a = ADD(ADD(a, b), y); d = ROR16(XOR(d, a));        \
+        c = ADD(c, d);         b = ROR63(XOR(b, c));        \
+    } while (0)
+
+// the twelve rounds of one final compression of a 64 byte message, zero padded to a full block, in terms of
+// the lane operations defined around each use
+#define BLAKE2B_ROUNDS(v, m)                                                                        \
+    for (int r = 0; r < 12; r++)                                                                    \
+    {                                                                                               \
+        const uint8_t *s = blake2b_sigma[r];                                                        \
+        BLAKE2B_G(v[0], v[4], v[ 8], v[12], MSG(m, s[ 0]), MSG(m, s[ 1]));                          \
+        BLAKE2B_G(v[1], v[5], v[ 9], v[13], MSG(m, s[ 2]), MSG(m, s[ 3]));                          \
+        BLAKE2B_G(v[2], v[6], v[10], v[14], MSG(m, s[ 4]), MSG(m, s[ 5]));                          \
+        BLAKE2B_G(v[3], v[7], v[11], v[15], MSG(m, s[ 6]), MSG(m, s[ 7]));                          \
+        BLAKE2B_G(v[0], v[5], v[10], v[15], MSG(m, s[ 8]), MSG(m, s[ 9]));                          \
+        BLAKE2B_G(v[1], v[6], v[11], v[12], MSG(m, s[10]), MSG(m, s[11]));                          \
+        BLAKE2B_G(v[2], v[7], v[ 8], v[13], MSG(m, s[12]), MSG(m, s[13]));                          \
+        BLAKE2B_G(v[3], v[4], v[ 9], v[14], MSG(m, s[14]), MSG(m, s[15]));                          \
+    }
+
+static void Blake2b256Personal64Portable(const uint64_t h0[8], const unsigned char *in, unsigned char *out)
+{
+#define ADD(a, b) ((a) + (b))
+#define XOR(a, b) ((a) ^ (b))
+#define ROR32(x) rotr64(x, 32)
+#define ROR24(x) rotr64(x, 24)
+#define ROR16(x) rotr64(x, 16)
+#define ROR63(x) rotr64(x, 63)
+#define MSG(m, i) m[i]
+    uint64_t m[16], v[16];
+    for (int i = 0; i < 16; i++)
+    {
+        m[i] = i < 8 ? ReadLE64(in + (i << 3)) : 0;
+    }
+    for (int i = 0; i < 8; i++)
+    {
+        v[i] = h0[i];
+        v[i + 8] = blake2b_IV[i];
+    }
+    v[12] ^= BLAKE2B_MB_INPUT_SIZE;     // bytes compressed
+    v[14] = ~v[14];                     // last block
+
+    BLAKE2B_ROUNDS(v, m);
+
+    for (int i = 0; i < 4; i++)
+    {
+        WriteLE64(out + (i << 3), h0[i] ^ v[i] ^ v[i + 8]);
+    }
+#undef ADD
+#undef XOR
+#undef ROR32
+#undef ROR24
+#undef ROR16
+#undef ROR63
+#undef MSG
+}
+
+#if !defined(__arm__) && !defined(__aarch64__)
+
+#define BLAKE2B_TARGET_AVX2 __attribute__((target("avx2")))
+#define BLAKE2B_TARGET_AVX512 __attribute__((target("avx2,avx512f")))
+
+// four messages, one in each 64 bit lane of every register
+static BLAKE2B_TARGET_AVX2 void Blake2b256Personal64x4(const uint64_t h0[8], const unsigned char *in, unsigned char *out)
+{
+#define ADD(a, b) _mm256_add_epi64(a, b)
+#define XOR(a, b) _mm256_xor_si256(a, b)
+#define ROR32(x) _mm256_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1))
+#define ROR24(x) _mm256_shuffle_epi8(x, rot24)
+#define ROR16(x) _mm256_shuffle_epi8(x, rot16)
+#define ROR63(x) _mm256_or_si256(_mm256_srli_epi64(x, 63), _mm256_add_epi64(x, x))
+#define MSG(m, i) m[i]
+    const __m256i rot24 = _mm256_setr_epi8(3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10,
+                                           3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10);
+    const __m256i rot16 = _mm256_setr_epi8(2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9,
+                                           2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9);
+    const __m256i lanes = _mm256_setr_epi64x(0, 8, 16, 24);
+
+    __m256i m[16], v[16];
+    for (int i = 0; i < 8; i++)
+    {
+        m[i] = _mm256_i64gather_epi64((const long long *)(in + (i << 3)), lanes, 8);
+        m[i + 8] = _mm256_setzero_si256();
+    }
+    for (int i = 0; i < 8; i++)
+    {
+        v[i] = _mm256_set1_epi64x(h0[i]);
+        v[i + 8] = _mm256_set1_epi64x(blake2b_IV[i]);
+    }
+    v[12] = _mm256_xor_si256(v[12], _mm256_set1_epi64x(BLAKE2B_MB_INPUT_SIZE));
+    v[14] = _mm256_xor_si256(v[14], _mm256_set1_epi64x(-1));
+
+    BLAKE2B_ROUNDS(v, m);
+
+    alignas(32) uint64_t result[4][4];
+    for (int i = 0; i < 4; i++)
+    {
+        _mm256_store_si256((__m256i *)result[i], _mm256_xor_si256(_mm256_set1_epi64x(h0[i]), _mm256_xor_si256(v[i], v[i + 8])));
+    }
+    for (int l = 0; l < 4; l++)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            WriteLE64(out + (l << 5) + (i << 3), result[i][l]);
+        }
+    }
+#undef ADD
+#undef XOR
+#undef ROR32
+#undef ROR24
+#undef ROR16
+#undef ROR63
+#undef MSG
+}
+
+// eight messages, one in each 64 bit lane of every register
+static BLAKE2B_TARGET_AVX512 void Blake2b256Personal64x8(const uint64_t h0[8], const unsigned char *in, unsigned char *out)
+{
+#define ADD(a, b) _mm512_add_epi64(a, b)
+#define XOR(a, b) _mm512_xor_si512(a, b)
+#define ROR32(x) _mm512_ror_epi64(x, 32)
+#define ROR24(x) _mm512_ror_epi64(x, 24)
+#define ROR16(x) _mm512_ror_epi64(x, 16)
+#define ROR63(x) _mm512_ror_epi64(x, 63)
+#define MSG(m, i) m[i]
+    const __m512i lanes = _mm512_setr_epi64(0, 8, 16, 24, 32, 40, 48, 56);
+
+    __m512i m[16], v[16];
+    for (int i = 0; i < 8; i++)
+    {
+        m[i] = _mm512_i64gather_epi64(lanes, (const void *)(in + (i << 3)), 8);
+        m[i + 8] = _mm512_setzero_si512();
+    }
+    for (int i = 0; i < 8; i++)
+    {
+        v[i] = _mm512_set1_epi64(h0[i]);
+        v[i + 8] = _mm512_set1_epi64(blake2b_IV[i]);
+    }
+    v[12] = _mm512_xor_si512(v[12], _mm512_set1_epi64(BLAKE2B_MB_INPUT_SIZE));
+    v[14] = _mm512_xor_si512(v[14], _mm512_set1_epi64(-1));
+
+    BLAKE2B_ROUNDS(v, m);
+
+    alignas(64) uint64_t result[4][8];
+    for (int i = 0; i < 4; i++)
+    {
+        _mm512_store_si512((void *)result[i], _mm512_xor_si512(_mm512_set1_epi64(h0[i]), _mm512_xor_si512(v[i], v[i + 8])));
+    }
+    for (int l = 0; l < 8; l++)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            WriteLE64(out + (l << 5) + (i << 3), result[i][l]);
+        }
+    }
+#undef ADD
+#undef XOR
+#undef ROR32
+#undef ROR24
+#undef ROR16
+#undef ROR63
+#undef MSG
+}
+
+#ifndef bit_AVX2
+#define bit_AVX2 (1 << 5)
+#endif
+#ifndef bit_AVX512F
+#define bit_AVX512F (1 << 16)
+#endif
+#ifndef bit_OSXSAVE
+#define bit_OSXSAVE (1 << 27)
+#endif
+
+#endif // !defined(__arm__) && !defined(__aarch64__)
+
+int GetBlake2bMultiBufferKernel()
+{
+#if defined(__arm__) || defined(__aarch64__)
+    return BLAKE2B_MB_KERNEL_PORTABLE;
+#else
+    // cpuid may be very slow in virtual machines, so only check once
+    static int kernel = -1;
+    if (kernel == -1)
+    {
+        int bestKernel = BLAKE2B_MB_KERNEL_PORTABLE;
+        unsigned int eax, ebx, ecx, edx;
+        if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_OSXSAVE) &&
+            __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+        {
+            // the OS must also save the upper register state on context switches
+            uint32_t xcr0, xcr0hi;
+            __asm__ __volatile__ ("xgetbv" : "=a"(xcr0), "=d"(xcr0hi) : "c"(0));
+            if ((ebx & bit_AVX512F) && (xcr0 & 0xe6) == 0xe6)
+            {
+                bestKernel = BLAKE2B_MB_KERNEL_AVX512;
+            }
+            else if ((ebx & bit_AVX2) && (xcr0 & 0x6) == 0x6)
+            {
+                bestKernel = BLAKE2B_MB_KERNEL_AVX2;
+            }
+        }
+        kernel = bestKernel;
+    }
+    return kernel;
+#endif
+}
+
+const char *GetBlake2bMultiBufferKernelName(int kernel)
+{
+    switch (kernel)
+    {
+        case BLAKE2B_MB_KERNEL_AVX2:
+            return "avx2";
+        case BLAKE2B_MB_KERNEL_AVX512:
+            return "avx512";
+    }
+    return "portable";
+}
+
+void Blake2b256Personal64(const unsigned char personal[BLAKE2B_MB_PERSONAL_SIZE], const unsigned char *in, unsigned char *out, size_t count)
+{
+    Blake2b256Personal64(personal, in, out, count, GetBlake2bMultiBufferKernel());
+}
+
+void Blake2b256Personal64(const unsigned char personal[BLAKE2B_MB_PERSONAL_SIZE], const unsigned char *in, unsigned char *out, size_t count, int kernel)
+{
+    uint64_t h0[8];
+    InitialState(personal, h0);
+
+#if !defined(__arm__) && !defined(__aarch64__)
+    if (kernel > GetBlake2bMultiBufferKernel())
+    {
+        kernel = GetBlake2bMultiBufferKernel();
+    }
+    if (kernel == BLAKE2B_MB_KERNEL_AVX512)
+    {
+        for (; count >= 8; count -= 8, in += 8 * BLAKE2B_MB_INPUT_SIZE, out += 8 * BLAKE2B_MB_OUTPUT_SIZE)
+        {
+            Blake2b256Personal64x8(h0, in, out);
+        }
+    }
+    if (kernel >= BLAKE2B_MB_KERNEL_AVX2)
+    {
+        for (; count >= 4; count -= 4, in += 4 * BLAKE2B_MB_INPUT_SIZE, out += 4 * BLAKE2B_MB_OUTPUT_SIZE)
+        {
+            Blake2b256Personal64x4(h0, in, out);
+        }
+    }
+#endif
+
+    for (; count; count--, in += BLAKE2B_MB_INPUT_SIZE, out += BLAKE2B_MB_OUTPUT_SIZE)
+    {
+        Blake2b256Personal64Portable(h0, in, out);
+    }
+}
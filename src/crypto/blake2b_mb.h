@@ -0,0 +1,38 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_CRYPTO_BLAKE2B_MB_H
+#define BITCOIN_CRYPTO_BLAKE2B_MB_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * Multi-buffer BLAKE2b-256 of 64 byte messages, such as the two child hashes of a merkle mountain range node,
+ * with a 16 byte personalization, no key and no salt. Each message fits one compression, so independent messages
+ * are hashed together, one per 64 bit lane: four lanes with AVX2 and eight with AVX-512. The result is identical
+ * to crypto_generichash_blake2b_init_salt_personal with a 32 byte output, followed by a 64 byte update.
+ */
+enum {
+    BLAKE2B_MB_KERNEL_PORTABLE = 0,
+    BLAKE2B_MB_KERNEL_AVX2 = 1,
+    BLAKE2B_MB_KERNEL_AVX512 = 2
+};
+
+static const size_t BLAKE2B_MB_INPUT_SIZE = 64;
+static const size_t BLAKE2B_MB_OUTPUT_SIZE = 32;
+static const size_t BLAKE2B_MB_PERSONAL_SIZE = 16;
+
+/** Returns the widest kernel supported by the running CPU and OS. */
+int GetBlake2bMultiBufferKernel();
+
+const char *GetBlake2bMultiBufferKernelName(int kernel=GetBlake2bMultiBufferKernel());
+
+/** Hashes count consecutive 64 byte messages from in to consecutive 32 byte digests at out. */
+void Blake2b256Personal64(const unsigned char personal[BLAKE2B_MB_PERSONAL_SIZE], const unsigned char *in, unsigned char *out, size_t count);
+
+/** The same, using no wider a kernel than the one given, so that each kernel supported can be compared to the others. */
+void Blake2b256Personal64(const unsigned char personal[BLAKE2B_MB_PERSONAL_SIZE], const unsigned char *in, unsigned char *out, size_t count, int kernel);
+
+#endif // BITCOIN_CRYPTO_BLAKE2B_MB_H
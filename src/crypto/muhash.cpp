@@ -0,0 +1,175 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "crypto/muhash.h"
+
+#include "crypto/chacha20.h"
+#include "crypto/common.h"
+#include "crypto/sha256.h"
+
+#include <string.h>
+
+namespace {
+
+// the modulus is 2^3072 - MAX_PRIME_DIFF, so 2^3072 is congruent to MAX_PRIME_DIFF
+const uint32_t MAX_PRIME_DIFF = 1103717;
+
+// adds MAX_PRIME_DIFF times the carry out of the top limb back in, until nothing is carried out
+void FoldCarry(uint32_t* limbs, uint64_t carry)
+{
+    while (carry) {
+        uint64_t acc = carry * MAX_PRIME_DIFF;
+        carry = 0;
+        for (size_t i = 0; i < Num3072::LIMBS && acc; i++) {
+            acc += limbs[i];
+            limbs[i] = (uint32_t)acc;
+            acc >>= 32;
+        }
+        carry = acc;
+    }
+}
+
+// reduces a value below 2^3072 that may be at or above the modulus, which is when adding MAX_PRIME_DIFF carries out
+void FinalReduce(uint32_t* limbs)
+{
+    uint32_t sum[Num3072::LIMBS];
+    uint64_t acc = MAX_PRIME_DIFF;
+    for (size_t i = 0; i < Num3072::LIMBS; i++) {
+        acc += limbs[i];
+        sum[i] = (uint32_t)acc;
+        acc >>= 32;
+    }
+    if (acc) {
+        memcpy(limbs, sum, sizeof(sum));
+    }
+}
+
+} // namespace
+
+Num3072::Num3072(const unsigned char (&data)[BYTE_SIZE])
+{
+    for (size_t i = 0; i < LIMBS; i++) {
+        limbs[i] = ReadLE32(data + 4 * i);
+    }
+    FinalReduce(limbs);
+}
+
+void Num3072::SetToOne()
+{
+    memset(limbs, 0, sizeof(limbs));
+    limbs[0] = 1;
+}
+
+void Num3072::Multiply(const Num3072& a)
+{
+    uint32_t product[2 * LIMBS] = {0};
+    for (size_t i = 0; i < LIMBS; i++) {
+        uint64_t carry = 0;
+        for (size_t j = 0; j < LIMBS; j++) {
+            uint64_t cur = (uint64_t)limbs[i] * a.limbs[j] + product[i + j] + carry;
+            product[i + j] = (uint32_t)cur;
+            carry = cur >> 32;
+        }
+        product[i + LIMBS] = (uint32_t)carry;
+    }
+
+    // low + high * 2^3072 is congruent to low + high * MAX_PRIME_DIFF
+    uint64_t carry = 0;
+    for (size_t i = 0; i < LIMBS; i++) {
+        uint64_t cur = (uint64_t)product[i + LIMBS] * MAX_PRIME_DIFF + product[i] + carry;
+        limbs[i] = (uint32_t)cur;
+        carry = cur >> 32;
+    }
+    FoldCarry(limbs, carry);
+    FinalReduce(limbs);
+}
+
+Num3072 Num3072::GetInverse() const
+{
+    // by Fermat's little theorem, the inverse is this to the power of the modulus - 2, whose limbs are all ones but
+    // the lowest
+    Num3072 result;
+    const uint32_t lowLimb = (uint32_t)(0x100000000ULL - MAX_PRIME_DIFF - 2);
+    for (size_t i = LIMBS; i-- > 0;) {
+        uint32_t exponentLimb = i ? 0xffffffff : lowLimb;
+        for (int bit = 31; bit >= 0; bit--) {
+            result.Multiply(result);
+            if ((exponentLimb >> bit) & 1) {
+                result.Multiply(*this);
+            }
+        }
+    }
+    return result;
+}
+
+void Num3072::Divide(const Num3072& a)
+{
+    Multiply(a.GetInverse());
+}
+
+void Num3072::ToBytes(unsigned char (&out)[BYTE_SIZE]) const
+{
+    for (size_t i = 0; i < LIMBS; i++) {
+        WriteLE32(out + 4 * i, limbs[i]);
+    }
+}
+
+Num3072 MuHash3072::ToNum3072(const unsigned char* data, size_t len)
+{
+    unsigned char hash[CSHA256::OUTPUT_SIZE];
+    CSHA256().Write(data, len).Finalize(hash);
+
+    unsigned char expanded[Num3072::BYTE_SIZE];
+    ChaCha20 chacha(hash, sizeof(hash));
+    chacha.Output(expanded, sizeof(expanded));
+    return Num3072(expanded);
+}
+
+MuHash3072& MuHash3072::Insert(const unsigned char* data, size_t len)
+{
+    numerator.Multiply(ToNum3072(data, len));
+    return *this;
+}
+
+MuHash3072& MuHash3072::Remove(const unsigned char* data, size_t len)
+{
+    denominator.Multiply(ToNum3072(data, len));
+    return *this;
+}
+
+MuHash3072& MuHash3072::operator*=(const MuHash3072& mul)
+{
+    numerator.Multiply(mul.numerator);
+    denominator.Multiply(mul.denominator);
+    return *this;
+}
+
+MuHash3072& MuHash3072::operator/=(const MuHash3072& div)
+{
+    numerator.Multiply(div.denominator);
+    denominator.Multiply(div.numerator);
+    return *this;
+}
+
+void MuHash3072::Finalize(unsigned char out[32]) const
+{
+    Num3072 result = numerator;
+    result.Divide(denominator);
+
+    unsigned char data[Num3072::BYTE_SIZE];
+    result.ToBytes(data);
+    CSHA256().Write(data, sizeof(data)).Finalize(out);
+}
+
+void MuHash3072::GetState(unsigned char (&num)[Num3072::BYTE_SIZE], unsigned char (&den)[Num3072::BYTE_SIZE]) const
+{
+    numerator.ToBytes(num);
+    denominator.ToBytes(den);
+}
+
+void MuHash3072::SetState(const unsigned char (&num)[Num3072::BYTE_SIZE], const unsigned char (&den)[Num3072::BYTE_SIZE])
+{
+    numerator = Num3072(num);
+    denominator = Num3072(den);
+}
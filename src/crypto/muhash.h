@@ -0,0 +1,61 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_CRYPTO_MUHASH_H
+#define BITCOIN_CRYPTO_MUHASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** A number modulo the prime 2^3072 - 1103717, in little endian 32 bit limbs */
+class Num3072
+{
+public:
+    static const size_t LIMBS = 96;
+    static const size_t BYTE_SIZE = 384;
+
+    uint32_t limbs[LIMBS];
+
+    Num3072() { SetToOne(); }
+    explicit Num3072(const unsigned char (&data)[BYTE_SIZE]);
+
+    void SetToOne();
+    void Multiply(const Num3072& a);
+    void Divide(const Num3072& a);
+    Num3072 GetInverse() const;
+    void ToBytes(unsigned char (&out)[BYTE_SIZE]) const;
+};
+
+/**
+ * A hash of a set of byte strings that can be updated as strings are added and removed, in any order. Each string is
+ * mapped to a number modulo a 3072 bit prime, and the set is their product. Removals are kept as a separate product
+ * that is only divided out when the hash is finalized, so updates never need an inverse.
+ */
+class MuHash3072
+{
+private:
+    Num3072 numerator;
+    Num3072 denominator;
+
+    static Num3072 ToNum3072(const unsigned char* data, size_t len);
+
+public:
+    MuHash3072() {}
+
+    MuHash3072& Insert(const unsigned char* data, size_t len);
+    MuHash3072& Remove(const unsigned char* data, size_t len);
+
+    /** Combines the sets of two hashes, or with /=, removes the set of one from the other */
+    MuHash3072& operator*=(const MuHash3072& mul);
+    MuHash3072& operator/=(const MuHash3072& div);
+
+    /** Writes the SHA256 of the set, which is the same for equal sets however they were built */
+    void Finalize(unsigned char out[32]) const;
+
+    /** The numerator and denominator as they are persisted */
+    void GetState(unsigned char (&num)[Num3072::BYTE_SIZE], unsigned char (&den)[Num3072::BYTE_SIZE]) const;
+    void SetState(const unsigned char (&num)[Num3072::BYTE_SIZE], const unsigned char (&den)[Num3072::BYTE_SIZE]);
+};
+
+#endif // BITCOIN_CRYPTO_MUHASH_H
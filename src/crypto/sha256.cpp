@@ -5,10 +5,28 @@
 #include "crypto/sha256.h"
 
 #include "crypto/common.h"
+#include "crypto/sha256_kernels.h"
 
 #include <string.h>
 #include <stdexcept>
 
+#if defined(SHA256_X86_KERNELS)
+#include <cpuid.h>
+#elif defined(SHA256_ARM_KERNELS) && defined(__linux__)
+#include <sys/auxv.h>
+#endif
+
+const uint32_t sha256_K[64] = {
+    0x428a2f98ul, 0x71374491ul, 0xb5c0fbcful, 0xe9b5dba5ul, 0x3956c25bul, 0x59f111f1ul, 0x923f82a4ul, 0xab1c5ed5ul,
+    0xd807aa98ul, 0x12835b01ul, 0x243185beul, 0x550c7dc3ul, 0x72be5d74ul, 0x80deb1feul, 0x9bdc06a7ul, 0xc19bf174ul,
+    0xe49b69c1ul, 0xefbe4786ul, 0x0fc19dc6ul, 0x240ca1ccul, 0x2de92c6ful, 0x4a7484aaul, 0x5cb0a9dcul, 0x76f988daul,
+    0x983e5152ul, 0xa831c66dul, 0xb00327c8ul, 0xbf597fc7ul, 0xc6e00bf3ul, 0xd5a79147ul, 0x06ca6351ul, 0x14292967ul,
+    0x27b70a85ul, 0x2e1b2138ul, 0x4d2c6dfcul, 0x53380d13ul, 0x650a7354ul, 0x766a0abbul, 0x81c2c92eul, 0x92722c85ul,
+    0xa2bfe8a1ul, 0xa81a664bul, 0xc24b8b70ul, 0xc76c51a3ul, 0xd192e819ul, 0xd6990624ul, 0xf40e3585ul, 0x106aa070ul,
+    0x19a4c116ul, 0x1e376c08ul, 0x2748774cul, 0x34b0bcb5ul, 0x391c0cb3ul, 0x4ed8aa4aul, 0x5b9cca4ful, 0x682e6ff3ul,
+    0x748f82eeul, 0x78a5636ful, 0x84c87814ul, 0x8cc70208ul, 0x90befffaul, 0xa4506cebul, 0xbef9a3f7ul, 0xc67178f2ul
+};
+
 // Internal implementation code.
 namespace
 {
@@ -128,9 +146,172 @@ void Transform(uint32_t* s, const unsigned char* chunk)
     s[7] += h;
 }
 
+void TransformBlocks(uint32_t* s, const unsigned char* chunk, size_t blocks)
+{
+    for (; blocks; blocks--, chunk += 64) {
+        Transform(s, chunk);
+    }
+}
+
+typedef void (*TransformType)(uint32_t* s, const unsigned char* chunk, size_t blocks);
+
+TransformType SelectTransform()
+{
+    switch (GetSHA256Kernel()) {
+#ifdef SHA256_X86_KERNELS
+    case SHA256_KERNEL_SHANI:
+        return sha256_shani::Transform;
+#endif
+#ifdef SHA256_ARM_KERNELS
+    case SHA256_KERNEL_ARM_SHA2:
+        return sha256_arm_sha2::Transform;
+#endif
+    }
+    return TransformBlocks;
+}
+
+void inline TransformSelected(uint32_t* s, const unsigned char* chunk, size_t blocks)
+{
+    static const TransformType transform = SelectTransform();
+    transform(s, chunk, blocks);
+}
+
 } // namespace sha256
 } // namespace
 
+#ifdef SHA256_X86_KERNELS
+#ifndef bit_SSE4_1
+#define bit_SSE4_1 (1 << 19)
+#endif
+#ifndef bit_OSXSAVE
+#define bit_OSXSAVE (1 << 27)
+#endif
+#ifndef bit_AVX2
+#define bit_AVX2 (1 << 5)
+#endif
+#ifndef bit_SHA
+#define bit_SHA (1 << 29)
+#endif
+#endif
+
+#if defined(SHA256_ARM_KERNELS) && defined(__linux__) && !defined(HWCAP_SHA2)
+#define HWCAP_SHA2 (1 << 6)
+#endif
+
+int GetSHA256Kernel()
+{
+    // cpuid may be very slow in virtual machines, so only check once
+    static int kernel = -1;
+    if (kernel == -1)
+    {
+        int bestKernel = SHA256_KERNEL_PORTABLE;
+#if defined(SHA256_X86_KERNELS)
+        unsigned int eax, ebx, ecx, edx;
+        if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_SSE4_1) &&
+            __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & bit_SHA))
+        {
+            bestKernel = SHA256_KERNEL_SHANI;
+        }
+#elif defined(SHA256_ARM_KERNELS) && defined(__linux__)
+        if (getauxval(AT_HWCAP) & HWCAP_SHA2)
+        {
+            bestKernel = SHA256_KERNEL_ARM_SHA2;
+        }
+#elif defined(SHA256_ARM_KERNELS) && defined(__APPLE__)
+        // every 64 bit Apple processor has them
+        bestKernel = SHA256_KERNEL_ARM_SHA2;
+#endif
+        kernel = bestKernel;
+    }
+    return kernel;
+}
+
+int GetSHA256D64Kernel()
+{
+    static int kernel = -1;
+    if (kernel == -1)
+    {
+        int bestKernel = SHA256_D64_KERNEL_SINGLE;
+#ifdef SHA256_X86_KERNELS
+        unsigned int eax, ebx, ecx, edx;
+        if (__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        {
+            bool fOSXSave = ecx & bit_OSXSAVE;
+            if (ecx & bit_SSE4_1)
+            {
+                bestKernel = SHA256_D64_KERNEL_SSE41;
+            }
+            if (fOSXSave && __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & bit_AVX2))
+            {
+                // the OS must also save the upper register state on context switches
+                uint32_t xcr0, xcr0hi;
+                __asm__ __volatile__ ("xgetbv" : "=a"(xcr0), "=d"(xcr0hi) : "c"(0));
+                if ((xcr0 & 0x6) == 0x6)
+                {
+                    bestKernel = SHA256_D64_KERNEL_AVX2;
+                }
+            }
+        }
+#endif
+        kernel = bestKernel;
+    }
+    return kernel;
+}
+
+std::string GetSHA256KernelName()
+{
+    std::string name;
+    switch (GetSHA256Kernel())
+    {
+        case SHA256_KERNEL_SHANI:
+            name = "shani";
+            break;
+        case SHA256_KERNEL_ARM_SHA2:
+            name = "arm-sha2";
+            break;
+        default:
+            name = "portable";
+    }
+    switch (GetSHA256D64Kernel())
+    {
+        case SHA256_D64_KERNEL_SSE41:
+            name += ",sse41";
+            break;
+        case SHA256_D64_KERNEL_AVX2:
+            name += ",avx2";
+            break;
+    }
+    return name;
+}
+
+void SHA256D64(unsigned char* out, const unsigned char* in, size_t count)
+{
+#ifdef SHA256_X86_KERNELS
+    int kernel = GetSHA256D64Kernel();
+    if (kernel == SHA256_D64_KERNEL_AVX2)
+    {
+        for (; count >= 8; count -= 8, in += 8 * 64, out += 8 * CSHA256::OUTPUT_SIZE)
+        {
+            sha256_avx2::TransformD64x8(out, in);
+        }
+    }
+    if (kernel >= SHA256_D64_KERNEL_SSE41)
+    {
+        for (; count >= 4; count -= 4, in += 4 * 64, out += 4 * CSHA256::OUTPUT_SIZE)
+        {
+            sha256_sse41::TransformD64x4(out, in);
+        }
+    }
+#endif
+
+    for (; count; count--, in += 64, out += CSHA256::OUTPUT_SIZE)
+    {
+        unsigned char first[CSHA256::OUTPUT_SIZE];
+        CSHA256().Write(in, 64).Finalize(first);
+        CSHA256().Write(first, sizeof(first)).Finalize(out);
+    }
+}
+
 
 ////// SHA-256
 
@@ -148,14 +329,15 @@ CSHA256& CSHA256::Write(const unsigned char* data, size_t len)
         memcpy(buf + bufsize, data, 64 - bufsize);
         bytes += 64 - bufsize;
         data += 64 - bufsize;
-        sha256::Transform(s, buf);
+        sha256::TransformSelected(s, buf, 1);
         bufsize = 0;
     }
-    while (end >= data + 64) {
+    if (end >= data + 64) {
         // Process full chunks directly from the source.
-        sha256::Transform(s, data);
-        bytes += 64;
-        data += 64;
+        size_t blocks = (end - data) / 64;
+        sha256::TransformSelected(s, data, blocks);
+        bytes += 64 * blocks;
+        data += 64 * blocks;
     }
     if (end > data) {
         // Fill the buffer with what remains.
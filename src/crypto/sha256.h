@@ -7,6 +7,7 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <string>
 
 /** A hasher class for SHA-256. */
 class CSHA256
@@ -29,4 +30,32 @@ private:
     void FinalizeNoPadding(unsigned char hash[OUTPUT_SIZE], bool enforce_compression);
 };
 
+/**
+ * The compression of single blocks is done with the SHA extensions of x86 or ARMv8 when the running CPU has them.
+ * Double SHA-256 of independent 64 byte messages, such as the two children of a merkle tree node, is also done
+ * four or eight messages at a time, one in each 32 bit lane, with SSE4.1 or AVX2. Both are chosen on first use.
+ */
+enum {
+    SHA256_KERNEL_PORTABLE = 0,
+    SHA256_KERNEL_SHANI = 1,            // x86 SHA extensions
+    SHA256_KERNEL_ARM_SHA2 = 2          // ARMv8 cryptography extensions
+};
+
+enum {
+    SHA256_D64_KERNEL_SINGLE = 0,       // one message at a time, with the single block kernel
+    SHA256_D64_KERNEL_SSE41 = 1,
+    SHA256_D64_KERNEL_AVX2 = 2
+};
+
+/** Returns the single block kernel used on the running CPU. */
+int GetSHA256Kernel();
+/** Returns the multi-buffer kernel used for SHA256D64 on the running CPU. */
+int GetSHA256D64Kernel();
+
+/** Names the kernels in use, such as "shani" or "portable,avx2". */
+std::string GetSHA256KernelName();
+
+/** Double SHA-256 of count consecutive 64 byte messages from in to consecutive 32 byte digests at out. */
+void SHA256D64(unsigned char *out, const unsigned char *in, size_t count);
+
 #endif // BITCOIN_CRYPTO_SHA256_H
@@ -0,0 +1,58 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+// SHA-256 with the ARMv8 cryptography extensions. This function is compiled with a target attribute when the build
+// does not already target them, see sha256_kernels.h.
+
+#include "crypto/sha256_kernels.h"
+
+#ifdef SHA256_ARM_KERNELS
+
+#include <arm_neon.h>
+
+#if defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_SHA2)
+#define SHA256_TARGET_ARM_SHA2
+#else
+#define SHA256_TARGET_ARM_SHA2 __attribute__((target("+crypto")))
+#endif
+
+namespace sha256_arm_sha2
+{
+void SHA256_TARGET_ARM_SHA2 Transform(uint32_t *s, const unsigned char *chunk, size_t blocks)
+{
+    uint32x4_t s0 = vld1q_u32(s);           // ABCD
+    uint32x4_t s1 = vld1q_u32(s + 4);       // EFGH
+
+    for (; blocks; blocks--, chunk += 64)
+    {
+        const uint32x4_t so0 = s0, so1 = s1;
+        uint32x4_t m[4];
+        for (int i = 0; i < 4; i++)
+        {
+            m[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(chunk + (i << 4))));
+        }
+
+        // four rounds at a time, each set of message words scheduled from the four before it once they are used
+        for (int i = 0; i < 16; i++)
+        {
+            const uint32x4_t wk = vaddq_u32(m[i & 3], vld1q_u32(sha256_K + (i << 2)));
+            const uint32x4_t abcd = s0;
+            s0 = vsha256hq_u32(s0, s1, wk);
+            s1 = vsha256h2q_u32(s1, abcd, wk);
+            if (i < 12)
+            {
+                m[i & 3] = vsha256su1q_u32(vsha256su0q_u32(m[i & 3], m[(i + 1) & 3]), m[(i + 2) & 3], m[(i + 3) & 3]);
+            }
+        }
+
+        s0 = vaddq_u32(s0, so0);
+        s1 = vaddq_u32(s1, so1);
+    }
+
+    vst1q_u32(s, s0);
+    vst1q_u32(s + 4, s1);
+}
+} // namespace sha256_arm_sha2
+
+#endif // SHA256_ARM_KERNELS
@@ -0,0 +1,50 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_CRYPTO_SHA256_KERNELS_H
+#define BITCOIN_CRYPTO_SHA256_KERNELS_H
+
+// the hardware kernels behind CSHA256 and SHA256D64. they are compiled with target attributes, and must only be
+// called after GetSHA256Kernel() or GetSHA256D64Kernel() selected them on the running CPU
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SHA256_X86_KERNELS
+#elif defined(__aarch64__) && (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_SHA2) || !defined(__clang__))
+// gcc makes the crypto intrinsics available to functions targeting them, older clang only when building for them
+#define SHA256_ARM_KERNELS
+#endif
+
+/** The round constants */
+extern const uint32_t sha256_K[64];
+
+#ifdef SHA256_X86_KERNELS
+namespace sha256_shani
+{
+void Transform(uint32_t *s, const unsigned char *chunk, size_t blocks);
+}
+
+namespace sha256_sse41
+{
+/** Double SHA-256 of four consecutive 64 byte messages */
+void TransformD64x4(unsigned char *out, const unsigned char *in);
+}
+
+namespace sha256_avx2
+{
+/** Double SHA-256 of eight consecutive 64 byte messages */
+void TransformD64x8(unsigned char *out, const unsigned char *in);
+}
+#endif
+
+#ifdef SHA256_ARM_KERNELS
+namespace sha256_arm_sha2
+{
+void Transform(uint32_t *s, const unsigned char *chunk, size_t blocks);
+}
+#endif
+
+#endif // BITCOIN_CRYPTO_SHA256_KERNELS_H
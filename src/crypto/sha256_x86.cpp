@@ -0,0 +1,260 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+// SHA-256 with the x86 SHA extensions, and double SHA-256 of 64 byte messages in the 32 bit lanes of SSE4.1 and
+// AVX2 registers. These functions are compiled with target attributes, see sha256_kernels.h.
+
+#include "crypto/sha256_kernels.h"
+
+#ifdef SHA256_X86_KERNELS
+
+#include "crypto/common.h"
+
+#include <immintrin.h>
+
+#define SHA256_TARGET_SHANI __attribute__((target("sse4.1,sha")))
+#define SHA256_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define SHA256_TARGET_AVX2 __attribute__((target("avx2")))
+#define SHA256_ALWAYS_INLINE inline __attribute__((always_inline))
+
+namespace
+{
+const uint32_t sha256_H[8] = {
+    0x6a09e667ul, 0xbb67ae85ul, 0x3c6ef372ul, 0xa54ff53aul, 0x510e527ful, 0x9b05688cul, 0x1f83d9abul, 0x5be0cd19ul
+};
+
+// the round constants plus the message schedule of the block that pads a 64 byte message, which is the same for
+// every message
+struct CPaddingRounds
+{
+    uint32_t kw[64];
+
+    CPaddingRounds()
+    {
+        uint32_t w[64] = {0x80000000ul};
+        w[15] = 512;
+        for (int i = 16; i < 64; i++)
+        {
+            uint32_t s0 = (w[i - 15] >> 7 | w[i - 15] << 25) ^ (w[i - 15] >> 18 | w[i - 15] << 14) ^ (w[i - 15] >> 3);
+            uint32_t s1 = (w[i - 2] >> 17 | w[i - 2] << 15) ^ (w[i - 2] >> 19 | w[i - 2] << 13) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        for (int i = 0; i < 64; i++)
+        {
+            kw[i] = sha256_K[i] + w[i];
+        }
+    }
+};
+
+const uint32_t *PaddingRoundInputs()
+{
+    static const CPaddingRounds padding;
+    return padding.kw;
+}
+} // namespace
+
+// the lane operations used by these macros are defined around each use
+#define SHA256_ROTR(x, n) OR(SHR(x, n), SHL(x, 32 - (n)))
+#define SHA256_CH(x, y, z) XOR(z, AND(x, XOR(y, z)))
+#define SHA256_MAJ(x, y, z) OR(AND(x, y), AND(z, OR(x, y)))
+#define SHA256_SIGMA0(x) XOR(XOR(SHA256_ROTR(x, 2), SHA256_ROTR(x, 13)), SHA256_ROTR(x, 22))
+#define SHA256_SIGMA1(x) XOR(XOR(SHA256_ROTR(x, 6), SHA256_ROTR(x, 11)), SHA256_ROTR(x, 25))
+#define SHA256_sigma0(x) XOR(XOR(SHA256_ROTR(x, 7), SHA256_ROTR(x, 18)), SHR(x, 3))
+#define SHA256_sigma1(x) XOR(XOR(SHA256_ROTR(x, 17), SHA256_ROTR(x, 19)), SHR(x, 10))
+
+// round i of a block whose words are in w, which is overwritten by the message schedule
+#define SHA256_SCHEDULED_INPUT(w, i)                                                                                \
+    ADD(SPLAT(sha256_K[i]), (i) < 16 ? w[(i) & 15] :                                                                \
+        (w[(i) & 15] = ADD(ADD(w[(i) & 15], SHA256_sigma0(w[((i) + 1) & 15])),                                     \
+                           ADD(w[((i) + 9) & 15], SHA256_sigma1(w[((i) + 14) & 15])))))
+
+// round i of the block that pads a 64 byte message
+#define SHA256_PADDING_INPUT(kw, i) SPLAT(kw[i])
+
+// the 64 rounds of one compression of the working state v, with INPUT(src, i) giving the round constant plus the
+// schedule word of round i
+#define SHA256_ROUNDS(v, INPUT, src)                                                                                \
+    for (int i = 0; i < 64; i++)                                                                                    \
+    {                                                                                                               \
+        VEC t1 = ADD(ADD(v[7], SHA256_SIGMA1(v[4])), ADD(SHA256_CH(v[4], v[5], v[6]), INPUT(src, i)));            \
+        VEC t2 = ADD(SHA256_SIGMA0(v[0]), SHA256_MAJ(v[0], v[1], v[2]));                                            \
+        v[7] = v[6]; v[6] = v[5]; v[5] = v[4]; v[4] = ADD(v[3], t1);                                                \
+        v[3] = v[2]; v[2] = v[1]; v[1] = v[0]; v[0] = ADD(t1, t2);                                                  \
+    }
+
+// double SHA-256 of one 64 byte message in each lane: the message and its padding, and then the 32 byte digest
+// of that with its padding, which only needs one more block
+#define SHA256_D64_LANES(in, out)                                                                                   \
+    do {                                                                                                            \
+        const uint32_t *padKW = PaddingRoundInputs();                                                               \
+        VEC s[8], v[8], w[16];                                                                                      \
+        for (int i = 0; i < 16; i++)                                                                                \
+        {                                                                                                           \
+            w[i] = LOAD(in, i);                                                                                     \
+        }                                                                                                           \
+        for (int i = 0; i < 8; i++)                                                                                 \
+        {                                                                                                           \
+            s[i] = v[i] = SPLAT(sha256_H[i]);                                                                       \
+        }                                                                                                           \
+        SHA256_ROUNDS(v, SHA256_SCHEDULED_INPUT, w);                                                                \
+        for (int i = 0; i < 8; i++)                                                                                 \
+        {                                                                                                           \
+            s[i] = v[i] = ADD(v[i], s[i]);                                                                          \
+        }                                                                                                           \
+        SHA256_ROUNDS(v, SHA256_PADDING_INPUT, padKW);                                                              \
+        for (int i = 0; i < 8; i++)                                                                                 \
+        {                                                                                                           \
+            w[i] = ADD(v[i], s[i]);                                                                                 \
+            w[i + 8] = SPLAT(i == 0 ? 0x80000000ul : i == 7 ? 256 : 0);                                             \
+            s[i] = v[i] = SPLAT(sha256_H[i]);                                                                       \
+        }                                                                                                           \
+        SHA256_ROUNDS(v, SHA256_SCHEDULED_INPUT, w);                                                                \
+        for (int i = 0; i < 8; i++)                                                                                 \
+        {                                                                                                           \
+            STORE(out, i, ADD(v[i], s[i]));                                                                         \
+        }                                                                                                           \
+    } while (0)
+
+namespace sha256_sse41
+{
+void SHA256_TARGET_SSE41 TransformD64x4(unsigned char *out, const unsigned char *in)
+{
+#define VEC __m128i
+#define ADD(a, b) _mm_add_epi32(a, b)
+#define XOR(a, b) _mm_xor_si128(a, b)
+#define AND(a, b) _mm_and_si128(a, b)
+#define OR(a, b) _mm_or_si128(a, b)
+#define SHR(x, n) _mm_srli_epi32(x, n)
+#define SHL(x, n) _mm_slli_epi32(x, n)
+#define SPLAT(x) _mm_set1_epi32(x)
+#define LOAD(p, j) _mm_set_epi32(ReadBE32(p + 192 + ((j) << 2)), ReadBE32(p + 128 + ((j) << 2)),                   \
+                                 ReadBE32(p + 64 + ((j) << 2)), ReadBE32(p + ((j) << 2)))
+#define STORE(p, j, x)                                                                                              \
+    do {                                                                                                            \
+        VEC lanes = (x);                                                                                            \
+        WriteBE32(p + ((j) << 2), _mm_extract_epi32(lanes, 0));                                                     \
+        WriteBE32(p + 32 + ((j) << 2), _mm_extract_epi32(lanes, 1));                                                \
+        WriteBE32(p + 64 + ((j) << 2), _mm_extract_epi32(lanes, 2));                                                \
+        WriteBE32(p + 96 + ((j) << 2), _mm_extract_epi32(lanes, 3));                                                \
+    } while (0)
+
+    SHA256_D64_LANES(in, out);
+
+#undef VEC
+#undef ADD
+#undef XOR
+#undef AND
+#undef OR
+#undef SHR
+#undef SHL
+#undef SPLAT
+#undef LOAD
+#undef STORE
+}
+} // namespace sha256_sse41
+
+namespace sha256_avx2
+{
+void SHA256_TARGET_AVX2 TransformD64x8(unsigned char *out, const unsigned char *in)
+{
+#define VEC __m256i
+#define ADD(a, b) _mm256_add_epi32(a, b)
+#define XOR(a, b) _mm256_xor_si256(a, b)
+#define AND(a, b) _mm256_and_si256(a, b)
+#define OR(a, b) _mm256_or_si256(a, b)
+#define SHR(x, n) _mm256_srli_epi32(x, n)
+#define SHL(x, n) _mm256_slli_epi32(x, n)
+#define SPLAT(x) _mm256_set1_epi32(x)
+#define LOAD(p, j) _mm256_set_epi32(ReadBE32(p + 448 + ((j) << 2)), ReadBE32(p + 384 + ((j) << 2)),                \
+                                    ReadBE32(p + 320 + ((j) << 2)), ReadBE32(p + 256 + ((j) << 2)),                \
+                                    ReadBE32(p + 192 + ((j) << 2)), ReadBE32(p + 128 + ((j) << 2)),                \
+                                    ReadBE32(p + 64 + ((j) << 2)), ReadBE32(p + ((j) << 2)))
+#define STORE(p, j, x)                                                                                              \
+    do {                                                                                                            \
+        alignas(32) uint32_t lanes[8];                                                                              \
+        _mm256_store_si256((__m256i *)lanes, (x));                                                                  \
+        for (int l = 0; l < 8; l++)                                                                                 \
+        {                                                                                                           \
+            WriteBE32(p + (l << 5) + ((j) << 2), lanes[l]);                                                         \
+        }                                                                                                           \
+    } while (0)
+
+    SHA256_D64_LANES(in, out);
+
+#undef VEC
+#undef ADD
+#undef XOR
+#undef AND
+#undef OR
+#undef SHR
+#undef SHL
+#undef SPLAT
+#undef LOAD
+#undef STORE
+}
+} // namespace sha256_avx2
+
+namespace sha256_shani
+{
+namespace
+{
+// sha256rnds2 keeps the state as ABEF and CDGH, with A and C in the high lanes
+SHA256_ALWAYS_INLINE SHA256_TARGET_SHANI void Shuffle(__m128i &s0, __m128i &s1)
+{
+    const __m128i t1 = _mm_shuffle_epi32(s0, 0xB1);
+    const __m128i t2 = _mm_shuffle_epi32(s1, 0x1B);
+    s0 = _mm_alignr_epi8(t1, t2, 0x08);
+    s1 = _mm_blend_epi16(t2, t1, 0xF0);
+}
+
+SHA256_ALWAYS_INLINE SHA256_TARGET_SHANI void Unshuffle(__m128i &s0, __m128i &s1)
+{
+    const __m128i t1 = _mm_shuffle_epi32(s0, 0x1B);
+    const __m128i t2 = _mm_shuffle_epi32(s1, 0xB1);
+    s0 = _mm_blend_epi16(t1, t2, 0xF0);
+    s1 = _mm_alignr_epi8(t2, t1, 0x08);
+}
+} // namespace
+
+void SHA256_TARGET_SHANI Transform(uint32_t *s, const unsigned char *chunk, size_t blocks)
+{
+    const __m128i byteSwap = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+    __m128i s0 = _mm_loadu_si128((const __m128i *)s);
+    __m128i s1 = _mm_loadu_si128((const __m128i *)(s + 4));
+    Shuffle(s0, s1);
+
+    for (; blocks; blocks--, chunk += 64)
+    {
+        const __m128i so0 = s0, so1 = s1;
+        __m128i m[4];
+        for (int i = 0; i < 4; i++)
+        {
+            m[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(chunk + (i << 4))), byteSwap);
+        }
+
+        // four rounds at a time, each set of message words scheduled from the four before it once they are used
+        for (int i = 0; i < 16; i++)
+        {
+            const __m128i msg = _mm_add_epi32(m[i & 3], _mm_loadu_si128((const __m128i *)(sha256_K + (i << 2))));
+            s1 = _mm_sha256rnds2_epu32(s1, s0, msg);
+            s0 = _mm_sha256rnds2_epu32(s0, s1, _mm_shuffle_epi32(msg, 0x0e));
+            if (i < 12)
+            {
+                __m128i next = _mm_add_epi32(_mm_sha256msg1_epu32(m[i & 3], m[(i + 1) & 3]),
+                                             _mm_alignr_epi8(m[(i + 3) & 3], m[(i + 2) & 3], 4));
+                m[i & 3] = _mm_sha256msg2_epu32(next, m[(i + 3) & 3]);
+            }
+        }
+
+        s0 = _mm_add_epi32(s0, so0);
+        s1 = _mm_add_epi32(s1, so1);
+    }
+
+    Unshuffle(s0, s1);
+    _mm_storeu_si128((__m128i *)s, s0);
+    _mm_storeu_si128((__m128i *)(s + 4), s1);
+}
+} // namespace sha256_shani
+
+#endif // SHA256_X86_KERNELS
@@ -40,6 +40,8 @@ int __cpuverusoptimized = 0x80;
 
 thread_local thread_specific_ptr verusclhasher_key;
 thread_local thread_specific_ptr verusclhasher_descr;
+thread_local thread_specific_ptr verusclhasher_lanes_key;
+thread_local thread_specific_ptr verusclhasher_lanes_descr;
 
 #if defined(__APPLE__) || defined(_WIN32)
 // attempt to workaround horrible mingw/gcc destructor bug on Windows and Mac, which passes garbage in the this pointer
@@ -54,6 +56,14 @@ thread_specific_ptr::~thread_specific_ptr() {
     {
         verusclhasher_descr.reset();
     }
+    if (verusclhasher_lanes_key.ptr)
+    {
+        verusclhasher_lanes_key.reset();
+    }
+    if (verusclhasher_lanes_descr.ptr)
+    {
+        verusclhasher_lanes_descr.reset();
+    }
 }
 #endif // defined(__APPLE__) || defined(_WIN32)
 
@@ -792,289 +802,671 @@ __m128i __verusclmulwithoutreduction64alignedrepeat_sv2_1(__m128i *randomsource,
     return acc;
 }
 
-__m128i __verusclmulwithoutreduction64alignedrepeat_sv2_2(__m128i *randomsource, const __m128i buf[4], uint64_t keyMask, __m128i **pMoveScratch)
+// one of the 32 rounds of the VerusHash 2.2 intermediate hash. keyMask must already be in units of __m128i. this is
+// shared by the single and multi-lane versions, so that the multi-lane version can interleave the independent
+// dependency chains of each lane without any divergence from the single lane result
+static inline __attribute__((always_inline)) void verusclhash_sv2_2_round(__m128i *randomsource, const __m128i *pbuf_copy, const uint64_t keyMask, __m128i **&pMoveScratch, __m128i &acc)
 {
-    const __m128i pbuf_copy[4] = {_mm_xor_si128(buf[0], buf[2]), _mm_xor_si128(buf[1], buf[3]), buf[2], buf[3]};
-    const __m128i *pbuf;
+    const uint64_t selector = _mm_cvtsi128_si64(acc);
 
-    // divide key mask by 16 from bytes to __m128i
-    keyMask >>= 4;
+    // get two random locations in the key, which will be mutated and swapped
+    __m128i *prand = randomsource + ((selector >> 5) & keyMask);
+    __m128i *prandex = randomsource + ((selector >> 32) & keyMask);
 
-    // the random buffer must have at least 32 16 byte dwords after the keymask to work with this
-    // algorithm. we take the value from the last element inside the keyMask + 2, as that will never
-    // be used to xor into the accumulator before it is hashed with other values first
-    __m128i acc = _mm_load_si128(randomsource + (keyMask + 2));
+    *(pMoveScratch++) = prand;
+    *(pMoveScratch++) = prandex;        
 
-    for (int64_t i = 0; i < 32; i++)
-    {
-        const uint64_t selector = _mm_cvtsi128_si64(acc);
+    // select random start and order of pbuf processing
+    const __m128i *pbuf = pbuf_copy + (selector & 3);
 
-        // get two random locations in the key, which will be mutated and swapped
-        __m128i *prand = randomsource + ((selector >> 5) & keyMask);
-        __m128i *prandex = randomsource + ((selector >> 32) & keyMask);
+    switch (selector & 0x1c)
+    {
+        case 0:
+        {
+            const __m128i temp1 = _mm_load_si128(prandex);
+            const __m128i temp2 = _mm_load_si128(pbuf - (((selector & 1) << 1) - 1));
+            const __m128i add1 = _mm_xor_si128(temp1, temp2);
+            const __m128i clprod1 = _mm_clmulepi64_si128(add1, add1, 0x10);
+            acc = _mm_xor_si128(clprod1, acc);
+
+            const __m128i tempa1 = _mm_mulhrs_epi16(acc, temp1);
+            const __m128i tempa2 = _mm_xor_si128(tempa1, temp1);
+
+            const __m128i temp12 = _mm_load_si128(prand);
+            _mm_store_si128(prand, tempa2);
+
+            const __m128i temp22 = _mm_load_si128(pbuf);
+            const __m128i add12 = _mm_xor_si128(temp12, temp22);
+            const __m128i clprod12 = _mm_clmulepi64_si128(add12, add12, 0x10);
+            acc = _mm_xor_si128(clprod12, acc);
+
+            const __m128i tempb1 = _mm_mulhrs_epi16(acc, temp12);
+            const __m128i tempb2 = _mm_xor_si128(tempb1, temp12);
+            _mm_store_si128(prandex, tempb2);
+            break;
+        }
+        case 4:
+        {
+            const __m128i temp1 = _mm_load_si128(prand);
+            const __m128i temp2 = _mm_load_si128(pbuf);
+            const __m128i add1 = _mm_xor_si128(temp1, temp2);
+            const __m128i clprod1 = _mm_clmulepi64_si128(add1, add1, 0x10);
+            acc = _mm_xor_si128(clprod1, acc);
+            const __m128i clprod2 = _mm_clmulepi64_si128(temp2, temp2, 0x10);
+            acc = _mm_xor_si128(clprod2, acc);
+
+            const __m128i tempa1 = _mm_mulhrs_epi16(acc, temp1);
+            const __m128i tempa2 = _mm_xor_si128(tempa1, temp1);
+
+            const __m128i temp12 = _mm_load_si128(prandex);
+            _mm_store_si128(prandex, tempa2);
+
+            const __m128i temp22 = _mm_load_si128(pbuf - (((selector & 1) << 1) - 1));
+            const __m128i add12 = _mm_xor_si128(temp12, temp22);
+            acc = _mm_xor_si128(add12, acc);
+
+            const __m128i tempb1 = _mm_mulhrs_epi16(acc, temp12);
+            const __m128i tempb2 = _mm_xor_si128(tempb1, temp12);
+            _mm_store_si128(prand, tempb2);
+            break;
+        }
+        case 8:
+        {
+            const __m128i temp1 = _mm_load_si128(prandex);
+            const __m128i temp2 = _mm_load_si128(pbuf);
+            const __m128i add1 = _mm_xor_si128(temp1, temp2);
+            acc = _mm_xor_si128(add1, acc);
+
+            const __m128i tempa1 = _mm_mulhrs_epi16(acc, temp1);
+            const __m128i tempa2 = _mm_xor_si128(tempa1, temp1);
+
+            const __m128i temp12 = _mm_load_si128(prand);
+            _mm_store_si128(prand, tempa2);
+
+            const __m128i temp22 = _mm_load_si128(pbuf - (((selector & 1) << 1) - 1));
+            const __m128i add12 = _mm_xor_si128(temp12, temp22);
+            const __m128i clprod12 = _mm_clmulepi64_si128(add12, add12, 0x10);
+            acc = _mm_xor_si128(clprod12, acc);
+            const __m128i clprod22 = _mm_clmulepi64_si128(temp22, temp22, 0x10);
+            acc = _mm_xor_si128(clprod22, acc);
+
+            const __m128i tempb1 = _mm_mulhrs_epi16(acc, temp12);
+            const __m128i tempb2 = _mm_xor_si128(tempb1, temp12);
+            _mm_store_si128(prandex, tempb2);
+            break;
+        }
+        case 0xc:
+        {
+            const __m128i temp1 = _mm_load_si128(prand);
+            const __m128i temp2 = _mm_load_si128(pbuf - (((selector & 1) << 1) - 1));
+            const __m128i add1 = _mm_xor_si128(temp1, temp2);
 
-        *(pMoveScratch++) = prand;
-        *(pMoveScratch++) = prandex;        
+            // cannot be zero here
+            const int32_t divisor = (uint32_t)selector;
 
-        // select random start and order of pbuf processing
-        pbuf = pbuf_copy + (selector & 3);
+            acc = _mm_xor_si128(add1, acc);
 
-        switch (selector & 0x1c)
-        {
-            case 0:
-            {
-                const __m128i temp1 = _mm_load_si128(prandex);
-                const __m128i temp2 = _mm_load_si128(pbuf - (((selector & 1) << 1) - 1));
-                const __m128i add1 = _mm_xor_si128(temp1, temp2);
-                const __m128i clprod1 = _mm_clmulepi64_si128(add1, add1, 0x10);
-                acc = _mm_xor_si128(clprod1, acc);
+            const int64_t dividend = _mm_cvtsi128_si64(acc);
+            const __m128i modulo = _mm_cvtsi32_si128(dividend % divisor);
+            acc = _mm_xor_si128(modulo, acc);
 
-                const __m128i tempa1 = _mm_mulhrs_epi16(acc, temp1);
-                const __m128i tempa2 = _mm_xor_si128(tempa1, temp1);
+            const __m128i tempa1 = _mm_mulhrs_epi16(acc, temp1);
+            const __m128i tempa2 = _mm_xor_si128(tempa1, temp1);
 
-                const __m128i temp12 = _mm_load_si128(prand);
-                _mm_store_si128(prand, tempa2);
+            if (dividend & 1)
+            {
+                const __m128i temp12 = _mm_load_si128(prandex);
+                _mm_store_si128(prandex, tempa2);
 
                 const __m128i temp22 = _mm_load_si128(pbuf);
                 const __m128i add12 = _mm_xor_si128(temp12, temp22);
                 const __m128i clprod12 = _mm_clmulepi64_si128(add12, add12, 0x10);
                 acc = _mm_xor_si128(clprod12, acc);
+                const __m128i clprod22 = _mm_clmulepi64_si128(temp22, temp22, 0x10);
+                acc = _mm_xor_si128(clprod22, acc);
 
                 const __m128i tempb1 = _mm_mulhrs_epi16(acc, temp12);
                 const __m128i tempb2 = _mm_xor_si128(tempb1, temp12);
-                _mm_store_si128(prandex, tempb2);
-                break;
+                _mm_store_si128(prand, tempb2);
             }
-            case 4:
+            else
             {
-                const __m128i temp1 = _mm_load_si128(prand);
-                const __m128i temp2 = _mm_load_si128(pbuf);
-                const __m128i add1 = _mm_xor_si128(temp1, temp2);
-                const __m128i clprod1 = _mm_clmulepi64_si128(add1, add1, 0x10);
-                acc = _mm_xor_si128(clprod1, acc);
-                const __m128i clprod2 = _mm_clmulepi64_si128(temp2, temp2, 0x10);
-                acc = _mm_xor_si128(clprod2, acc);
-
-                const __m128i tempa1 = _mm_mulhrs_epi16(acc, temp1);
-                const __m128i tempa2 = _mm_xor_si128(tempa1, temp1);
-
-                const __m128i temp12 = _mm_load_si128(prandex);
+                const __m128i tempb3 = _mm_load_si128(prandex);
                 _mm_store_si128(prandex, tempa2);
-
-                const __m128i temp22 = _mm_load_si128(pbuf - (((selector & 1) << 1) - 1));
-                const __m128i add12 = _mm_xor_si128(temp12, temp22);
-                acc = _mm_xor_si128(add12, acc);
-
-                const __m128i tempb1 = _mm_mulhrs_epi16(acc, temp12);
-                const __m128i tempb2 = _mm_xor_si128(tempb1, temp12);
-                _mm_store_si128(prand, tempb2);
-                break;
+                _mm_store_si128(prand, tempb3);
+                const __m128i tempb4 = _mm_load_si128(pbuf);
+                acc = _mm_xor_si128(tempb4, acc);
             }
-            case 8:
-            {
-                const __m128i temp1 = _mm_load_si128(prandex);
-                const __m128i temp2 = _mm_load_si128(pbuf);
-                const __m128i add1 = _mm_xor_si128(temp1, temp2);
-                acc = _mm_xor_si128(add1, acc);
+            break;
+        }
+        case 0x10:
+        {
+            // a few AES operations
+            const __m128i *rc = prand;
+            __m128i tmp;
 
-                const __m128i tempa1 = _mm_mulhrs_epi16(acc, temp1);
-                const __m128i tempa2 = _mm_xor_si128(tempa1, temp1);
+            __m128i temp1 = _mm_load_si128(pbuf - (((selector & 1) << 1) - 1));
+            __m128i temp2 = _mm_load_si128(pbuf);
 
-                const __m128i temp12 = _mm_load_si128(prand);
-                _mm_store_si128(prand, tempa2);
+            AES2(temp1, temp2, 0);
+            MIX2(temp1, temp2);
 
-                const __m128i temp22 = _mm_load_si128(pbuf - (((selector & 1) << 1) - 1));
-                const __m128i add12 = _mm_xor_si128(temp12, temp22);
-                const __m128i clprod12 = _mm_clmulepi64_si128(add12, add12, 0x10);
-                acc = _mm_xor_si128(clprod12, acc);
-                const __m128i clprod22 = _mm_clmulepi64_si128(temp22, temp22, 0x10);
-                acc = _mm_xor_si128(clprod22, acc);
+            AES2(temp1, temp2, 4);
+            MIX2(temp1, temp2);
 
-                const __m128i tempb1 = _mm_mulhrs_epi16(acc, temp12);
-                const __m128i tempb2 = _mm_xor_si128(tempb1, temp12);
-                _mm_store_si128(prandex, tempb2);
-                break;
-            }
-            case 0xc:
-            {
-                const __m128i temp1 = _mm_load_si128(prand);
-                const __m128i temp2 = _mm_load_si128(pbuf - (((selector & 1) << 1) - 1));
-                const __m128i add1 = _mm_xor_si128(temp1, temp2);
+            AES2(temp1, temp2, 8);
+            MIX2(temp1, temp2);
 
-                // cannot be zero here
-                const int32_t divisor = (uint32_t)selector;
+            acc = _mm_xor_si128(temp2, _mm_xor_si128(temp1, acc));
 
-                acc = _mm_xor_si128(add1, acc);
+            const __m128i tempa1 = _mm_load_si128(prand);
+            const __m128i tempa2 = _mm_mulhrs_epi16(acc, tempa1);
+            const __m128i tempa3 = _mm_xor_si128(tempa1, tempa2);
 
-                const int64_t dividend = _mm_cvtsi128_si64(acc);
-                const __m128i modulo = _mm_cvtsi32_si128(dividend % divisor);
-                acc = _mm_xor_si128(modulo, acc);
+            const __m128i tempa4 = _mm_load_si128(prandex);
+            _mm_store_si128(prandex, tempa3);
+            _mm_store_si128(prand, tempa4);
+            break;
+        }
+        case 0x14:
+        {
+            // we'll just call this one the monkins loop, inspired by Chris - modified to cast to uint64_t on shift for more variability in the loop
+            const __m128i *buftmp = pbuf - (((selector & 1) << 1) - 1);
+            __m128i tmp; // used by MIX2
 
-                const __m128i tempa1 = _mm_mulhrs_epi16(acc, temp1);
-                const __m128i tempa2 = _mm_xor_si128(tempa1, temp1);
+            uint64_t rounds = selector >> 61; // loop randomly between 1 and 8 times
+            __m128i *rc = prand;
+            uint64_t aesroundoffset = 0;
+            __m128i onekey;
 
-                if (dividend & 1)
+            do
+            {
+                if (selector & (((uint64_t)0x10000000) << rounds))
                 {
-                    const __m128i temp12 = _mm_load_si128(prandex);
-                    _mm_store_si128(prandex, tempa2);
+                    onekey = _mm_load_si128(rc++);
+                    const __m128i temp2 = _mm_load_si128(rounds & 1 ? pbuf : buftmp);
+                    const __m128i add1 = _mm_xor_si128(onekey, temp2);
+                    const __m128i clprod1 = _mm_clmulepi64_si128(add1, add1, 0x10);
+                    acc = _mm_xor_si128(clprod1, acc);
+                }
+                else
+                {
+                    onekey = _mm_load_si128(rc++);
+                    __m128i temp2 = _mm_load_si128(rounds & 1 ? buftmp : pbuf);
+                    AES2(onekey, temp2, aesroundoffset);
+                    aesroundoffset += 4;
+                    MIX2(onekey, temp2);
+                    acc = _mm_xor_si128(onekey, acc);
+                    acc = _mm_xor_si128(temp2, acc);
+                }
+            } while (rounds--);
 
-                    const __m128i temp22 = _mm_load_si128(pbuf);
-                    const __m128i add12 = _mm_xor_si128(temp12, temp22);
-                    const __m128i clprod12 = _mm_clmulepi64_si128(add12, add12, 0x10);
-                    acc = _mm_xor_si128(clprod12, acc);
-                    const __m128i clprod22 = _mm_clmulepi64_si128(temp22, temp22, 0x10);
-                    acc = _mm_xor_si128(clprod22, acc);
+            const __m128i tempa1 = _mm_load_si128(prand);
+            const __m128i tempa2 = _mm_mulhrs_epi16(acc, tempa1);
+            const __m128i tempa3 = _mm_xor_si128(tempa1, tempa2);
 
-                    const __m128i tempb1 = _mm_mulhrs_epi16(acc, temp12);
-                    const __m128i tempb2 = _mm_xor_si128(tempb1, temp12);
-                    _mm_store_si128(prand, tempb2);
+            const __m128i tempa4 = _mm_load_si128(prandex);
+            _mm_store_si128(prandex, tempa3);
+            _mm_store_si128(prand, tempa4);
+            break;
+        }
+        case 0x18:
+        {
+            const __m128i *buftmp = pbuf - (((selector & 1) << 1) - 1);
+            __m128i tmp; // used by MIX2
+
+            uint64_t rounds = selector >> 61; // loop randomly between 1 and 8 times
+            __m128i *rc = prand;
+            __m128i onekey;
+
+            do
+            {
+                if (selector & (((uint64_t)0x10000000) << rounds))
+                {
+                    onekey = _mm_load_si128(rc++);
+                    const __m128i temp2 = _mm_load_si128(rounds & 1 ? pbuf : buftmp);
+                    onekey = _mm_xor_si128(onekey, temp2);
+                    // cannot be zero here, may be negative
+                    const int32_t divisor = (uint32_t)selector;
+                    const int64_t dividend = _mm_cvtsi128_si64(onekey);
+                    const __m128i modulo = _mm_cvtsi32_si128(dividend % divisor);
+                    acc = _mm_xor_si128(modulo, acc);
                 }
                 else
                 {
-                    const __m128i tempb3 = _mm_load_si128(prandex);
-                    _mm_store_si128(prandex, tempa2);
-                    _mm_store_si128(prand, tempb3);
-                    const __m128i tempb4 = _mm_load_si128(pbuf);
-                    acc = _mm_xor_si128(tempb4, acc);
+                    onekey = _mm_load_si128(rc++);
+                    __m128i temp2 = _mm_load_si128(rounds & 1 ? buftmp : pbuf);
+                    const __m128i add1 = _mm_xor_si128(onekey, temp2);
+                    onekey = _mm_clmulepi64_si128(add1, add1, 0x10);
+                    const __m128i clprod2 = _mm_mulhrs_epi16(acc, onekey);
+                    acc = _mm_xor_si128(clprod2, acc);
                 }
-                break;
-            }
-            case 0x10:
-            {
-                // a few AES operations
-                const __m128i *rc = prand;
-                __m128i tmp;
+            } while (rounds--);
 
-                __m128i temp1 = _mm_load_si128(pbuf - (((selector & 1) << 1) - 1));
-                __m128i temp2 = _mm_load_si128(pbuf);
+            const __m128i tempa3 = _mm_load_si128(prandex);
+            const __m128i tempa4 = _mm_xor_si128(tempa3, acc);
 
-                AES2(temp1, temp2, 0);
-                MIX2(temp1, temp2);
+            _mm_store_si128(prandex, onekey);
+            _mm_store_si128(prand, tempa4);
+            break;
+        }
+        case 0x1c:
+        {
+            const __m128i temp1 = _mm_load_si128(pbuf);
+            const __m128i temp2 = _mm_load_si128(prandex);
+            const __m128i add1 = _mm_xor_si128(temp1, temp2);
+            const __m128i clprod1 = _mm_clmulepi64_si128(add1, add1, 0x10);
+            acc = _mm_xor_si128(clprod1, acc);
+
+            const __m128i tempa1 = _mm_mulhrs_epi16(acc, temp2);
+            const __m128i tempa2 = _mm_xor_si128(tempa1, temp2);
+
+            const __m128i tempa3 = _mm_load_si128(prand);
+            _mm_store_si128(prand, tempa2);
+
+            acc = _mm_xor_si128(tempa3, acc);
+            const __m128i temp4 = _mm_load_si128(pbuf - (((selector & 1) << 1) - 1)); 
+            acc = _mm_xor_si128(temp4,acc);  
+            const __m128i tempb1 = _mm_mulhrs_epi16(acc, tempa3);
+            const __m128i tempb2 = _mm_xor_si128(tempb1, tempa3);
+            _mm_store_si128(prandex, tempb2);
+            break;
+        }
+    }
+}
 
-                AES2(temp1, temp2, 4);
-                MIX2(temp1, temp2);
+__m128i __verusclmulwithoutreduction64alignedrepeat_sv2_2(__m128i *randomsource, const __m128i buf[4], uint64_t keyMask, __m128i **pMoveScratch)
+{
+    const __m128i pbuf_copy[4] = {_mm_xor_si128(buf[0], buf[2]), _mm_xor_si128(buf[1], buf[3]), buf[2], buf[3]};
 
-                AES2(temp1, temp2, 8);
-                MIX2(temp1, temp2);
+    // divide key mask by 16 from bytes to __m128i
+    keyMask >>= 4;
 
-                acc = _mm_xor_si128(temp2, _mm_xor_si128(temp1, acc));
+    // the random buffer must have at least 32 16 byte dwords after the keymask to work with this
+    // algorithm. we take the value from the last element inside the keyMask + 2, as that will never
+    // be used to xor into the accumulator before it is hashed with other values first
+    __m128i acc = _mm_load_si128(randomsource + (keyMask + 2));
 
-                const __m128i tempa1 = _mm_load_si128(prand);
-                const __m128i tempa2 = _mm_mulhrs_epi16(acc, tempa1);
-                const __m128i tempa3 = _mm_xor_si128(tempa1, tempa2);
+    for (int64_t i = 0; i < 32; i++)
+    {
+        verusclhash_sv2_2_round(randomsource, pbuf_copy, keyMask, pMoveScratch, acc);
+    }
+    return acc;
+}
 
-                const __m128i tempa4 = _mm_load_si128(prandex);
-                _mm_store_si128(prandex, tempa3);
-                _mm_store_si128(prand, tempa4);
-                break;
-            }
-            case 0x14:
-            {
-                // we'll just call this one the monkins loop, inspired by Chris - modified to cast to uint64_t on shift for more variability in the loop
-                const __m128i *buftmp = pbuf - (((selector & 1) << 1) - 1);
-                __m128i tmp; // used by MIX2
+// interleaves NLANES independent VerusHash 2.2 intermediate hashes, each with its own key and move scratch
+template <int NLANES>
+static inline __attribute__((always_inline)) void verusclhash_sv2_2_lanes(__m128i **randomsource, unsigned char **buf, uint64_t keyMask, __m128i ***pMoveScratch, uint64_t *result)
+{
+    __m128i pbuf_copy[NLANES][4];
+    __m128i acc[NLANES];
+    __m128i **pScratch[NLANES];
 
-                uint64_t rounds = selector >> 61; // loop randomly between 1 and 8 times
-                __m128i *rc = prand;
-                uint64_t aesroundoffset = 0;
-                __m128i onekey;
+    // divide key mask by 16 from bytes to __m128i
+    keyMask >>= 4;
 
-                do
-                {
-                    if (selector & (((uint64_t)0x10000000) << rounds))
-                    {
-                        onekey = _mm_load_si128(rc++);
-                        const __m128i temp2 = _mm_load_si128(rounds & 1 ? pbuf : buftmp);
-                        const __m128i add1 = _mm_xor_si128(onekey, temp2);
-                        const __m128i clprod1 = _mm_clmulepi64_si128(add1, add1, 0x10);
-                        acc = _mm_xor_si128(clprod1, acc);
-                    }
-                    else
-                    {
-                        onekey = _mm_load_si128(rc++);
-                        __m128i temp2 = _mm_load_si128(rounds & 1 ? buftmp : pbuf);
-                        AES2(onekey, temp2, aesroundoffset);
-                        aesroundoffset += 4;
-                        MIX2(onekey, temp2);
-                        acc = _mm_xor_si128(onekey, acc);
-                        acc = _mm_xor_si128(temp2, acc);
-                    }
-                } while (rounds--);
+    for (int l = 0; l < NLANES; l++)
+    {
+        const __m128i *pbuf = (const __m128i *)buf[l];
+        pbuf_copy[l][0] = _mm_xor_si128(pbuf[0], pbuf[2]);
+        pbuf_copy[l][1] = _mm_xor_si128(pbuf[1], pbuf[3]);
+        pbuf_copy[l][2] = pbuf[2];
+        pbuf_copy[l][3] = pbuf[3];
+        acc[l] = _mm_load_si128(randomsource[l] + (keyMask + 2));
+        pScratch[l] = pMoveScratch[l];
+    }
 
-                const __m128i tempa1 = _mm_load_si128(prand);
-                const __m128i tempa2 = _mm_mulhrs_epi16(acc, tempa1);
-                const __m128i tempa3 = _mm_xor_si128(tempa1, tempa2);
+    for (int64_t i = 0; i < 32; i++)
+    {
+        for (int l = 0; l < NLANES; l++)
+        {
+            verusclhash_sv2_2_round(randomsource[l], pbuf_copy[l], keyMask, pScratch[l], acc[l]);
+        }
+    }
 
-                const __m128i tempa4 = _mm_load_si128(prandex);
-                _mm_store_si128(prandex, tempa3);
-                _mm_store_si128(prand, tempa4);
-                break;
-            }
-            case 0x18:
-            {
-                const __m128i *buftmp = pbuf - (((selector & 1) << 1) - 1);
-                __m128i tmp; // used by MIX2
+    for (int l = 0; l < NLANES; l++)
+    {
+        result[l] = precompReduction64(_mm_xor_si128(acc[l], lazyLengthHash(1024, 64)));
+    }
+}
 
-                uint64_t rounds = selector >> 61; // loop randomly between 1 and 8 times
-                __m128i *rc = prand;
-                __m128i onekey;
+// NLANES keyed Haraka512 hashes, each lane with its own key, interleaved round by round
+template <int NLANES>
+static inline __attribute__((always_inline)) void haraka512_keyed_lanes(unsigned char **out, unsigned char **in, const u128 **prc)
+{
+    u128 s[NLANES][4], tmp;
 
-                do
-                {
-                    if (selector & (((uint64_t)0x10000000) << rounds))
-                    {
-                        onekey = _mm_load_si128(rc++);
-                        const __m128i temp2 = _mm_load_si128(rounds & 1 ? pbuf : buftmp);
-                        onekey = _mm_xor_si128(onekey, temp2);
-                        // cannot be zero here, may be negative
-                        const int32_t divisor = (uint32_t)selector;
-                        const int64_t dividend = _mm_cvtsi128_si64(onekey);
-                        const __m128i modulo = _mm_cvtsi32_si128(dividend % divisor);
-                        acc = _mm_xor_si128(modulo, acc);
-                    }
-                    else
-                    {
-                        onekey = _mm_load_si128(rc++);
-                        __m128i temp2 = _mm_load_si128(rounds & 1 ? buftmp : pbuf);
-                        const __m128i add1 = _mm_xor_si128(onekey, temp2);
-                        onekey = _mm_clmulepi64_si128(add1, add1, 0x10);
-                        const __m128i clprod2 = _mm_mulhrs_epi16(acc, onekey);
-                        acc = _mm_xor_si128(clprod2, acc);
-                    }
-                } while (rounds--);
+    for (int l = 0; l < NLANES; l++)
+    {
+        s[l][0] = LOAD(in[l]);
+        s[l][1] = LOAD(in[l] + 16);
+        s[l][2] = LOAD(in[l] + 32);
+        s[l][3] = LOAD(in[l] + 48);
+    }
 
-                const __m128i tempa3 = _mm_load_si128(prandex);
-                const __m128i tempa4 = _mm_xor_si128(tempa3, acc);
+    for (int round = 0; round < 40; round += 8)
+    {
+        for (int l = 0; l < NLANES; l++)
+        {
+            const u128 *rc = prc[l];
+            AES4(s[l][0], s[l][1], s[l][2], s[l][3], round);
+            MIX4(s[l][0], s[l][1], s[l][2], s[l][3]);
+        }
+    }
 
-                _mm_store_si128(prandex, onekey);
-                _mm_store_si128(prand, tempa4);
-                break;
-            }
-            case 0x1c:
+    for (int l = 0; l < NLANES; l++)
+    {
+        s[l][0] = _mm_xor_si128(s[l][0], LOAD(in[l]));
+        s[l][1] = _mm_xor_si128(s[l][1], LOAD(in[l] + 16));
+        s[l][2] = _mm_xor_si128(s[l][2], LOAD(in[l] + 32));
+        s[l][3] = _mm_xor_si128(s[l][3], LOAD(in[l] + 48));
+
+        TRUNCSTORE(out[l], s[l][0], s[l][1], s[l][2], s[l][3]);
+    }
+}
+
+typedef void (*haraka512_keyed_lanes_fn)(unsigned char **out, unsigned char **in, const u128 **prc);
+
+static void haraka512_keyed_4x_aes(unsigned char **out, unsigned char **in, const u128 **prc)
+{
+    haraka512_keyed_lanes<VERUSHASH_LANES_4X>(out, in, prc);
+}
+
+static void haraka512_keyed_8x_aes(unsigned char **out, unsigned char **in, const u128 **prc)
+{
+    haraka512_keyed_lanes<VERUSHASH_LANES_8X>(out, in, prc);
+}
+
+#if !defined(__arm__) && !defined(__aarch64__)
+void haraka512_keyed_4x_vaes256(unsigned char **out, unsigned char **in, const u128 **prc);
+void haraka512_keyed_8x_vaes256(unsigned char **out, unsigned char **in, const u128 **prc);
+void haraka512_keyed_4x_vaes512(unsigned char **out, unsigned char **in, const u128 **prc);
+void haraka512_keyed_8x_vaes512(unsigned char **out, unsigned char **in, const u128 **prc);
+#endif
+
+struct verusclhash_lanes_kernel
+{
+    haraka512_keyed_lanes_fn haraka512_keyed_4x;
+    haraka512_keyed_lanes_fn haraka512_keyed_8x;
+};
+
+// indexed by the result of GetVerusCLHashKernel()
+static const verusclhash_lanes_kernel verusclhash_lanes_kernels[] = {
+    { &haraka512_keyed_4x_aes, &haraka512_keyed_8x_aes },           // VERUSCLHASH_KERNEL_PORTABLE, lanes are never used
+    { &haraka512_keyed_4x_aes, &haraka512_keyed_8x_aes },           // VERUSCLHASH_KERNEL_AES
+#if !defined(__arm__) && !defined(__aarch64__)
+    { &haraka512_keyed_4x_vaes256, &haraka512_keyed_8x_vaes256 },   // VERUSCLHASH_KERNEL_VAES_AVX2
+    { &haraka512_keyed_4x_vaes512, &haraka512_keyed_8x_vaes512 }    // VERUSCLHASH_KERNEL_VAES_AVX512
+#endif
+};
+
+template <int NLANES>
+static inline haraka512_keyed_lanes_fn haraka512keyedlanes()
+{
+    const verusclhash_lanes_kernel &kernel = verusclhash_lanes_kernels[GetVerusCLHashKernel()];
+    return NLANES == VERUSHASH_LANES_8X ? kernel.haraka512_keyed_8x : kernel.haraka512_keyed_4x;
+}
+
+// gets one key for each of nLanes lanes, ready to hash with the primary key's current seed. lane 0 is the primary
+// key, which must already be current and unmutated. the other lanes are copied from it after a seed change,
+// otherwise, they are restored from their own refresh area with the move scratch list from their last hash.
+static bool getlanekeys(verusclhasher &vclh, int nLanes, __m128i **laneKeys, __m128i ***laneMoveScratch)
+{
+    unsigned char *primaryKey = (unsigned char *)verusclhasher_key.get();
+    verusclhash_descr *pdesc = (verusclhash_descr *)verusclhasher_descr.get();
+    const uint32_t keysize = pdesc->keySizeInBytes;
+    const uint64_t laneBufSize = keysize << 1;
+    const uint64_t keyrefreshsize = vclh.keyrefreshsize();
+
+    verusclhash_lanes_descr *pLanesDesc = (verusclhash_lanes_descr *)verusclhasher_lanes_descr.get();
+    bool newKeys = false;
+    if (!pLanesDesc || pLanesDesc->keySizeInBytes != keysize || pLanesDesc->numLanes < (nLanes - 1))
+    {
+        verusclhasher_lanes_key.reset(alloc_aligned_buffer(laneBufSize * (VERUSHASH_MAX_LANES - 1)));
+        if (!verusclhasher_lanes_key.get())
+        {
+            verusclhasher_lanes_descr.reset();
+            return false;
+        }
+        if (!pLanesDesc)
+        {
+            verusclhasher_lanes_descr.reset(new verusclhash_lanes_descr());
+            if (!(pLanesDesc = (verusclhash_lanes_descr *)verusclhasher_lanes_descr.get()))
             {
-                const __m128i temp1 = _mm_load_si128(pbuf);
-                const __m128i temp2 = _mm_load_si128(prandex);
-                const __m128i add1 = _mm_xor_si128(temp1, temp2);
-                const __m128i clprod1 = _mm_clmulepi64_si128(add1, add1, 0x10);
-                acc = _mm_xor_si128(clprod1, acc);
+                verusclhasher_lanes_key.reset();
+                return false;
+            }
+        }
+        pLanesDesc->keySizeInBytes = keysize;
+        pLanesDesc->numLanes = VERUSHASH_MAX_LANES - 1;
+        newKeys = true;
+    }
 
-                const __m128i tempa1 = _mm_mulhrs_epi16(acc, temp2);
-                const __m128i tempa2 = _mm_xor_si128(tempa1, temp2);
+    unsigned char *laneKeyBase = (unsigned char *)verusclhasher_lanes_key.get();
+    if (newKeys || pLanesDesc->seed != pdesc->seed)
+    {
+        // all allocated lanes must be current for the seed we record, even those we are not using now
+        for (int l = 0; l < pLanesDesc->numLanes; l++)
+        {
+            unsigned char *pLaneKey = laneKeyBase + (laneBufSize * l);
+            memcpy(pLaneKey, primaryKey, keysize + keyrefreshsize);
+            memset(pLaneKey + keysize + keyrefreshsize, 0, keysize - keyrefreshsize);
+        }
+        pLanesDesc->seed = pdesc->seed;
+    }
+    else
+    {
+        for (int l = 0; l < (nLanes - 1); l++)
+        {
+            fixupkey(vclh.getpmovescratch(laneKeyBase + (laneBufSize * l) + keysize), pdesc);
+        }
+    }
 
-                const __m128i tempa3 = _mm_load_si128(prand);
-                _mm_store_si128(prand, tempa2);
+    laneKeys[0] = (__m128i *)primaryKey;
+    laneMoveScratch[0] = vclh.getpmovescratch(primaryKey + keysize);
+    for (int l = 1; l < nLanes; l++)
+    {
+        unsigned char *pLaneKey = laneKeyBase + (laneBufSize * (l - 1));
+        laneKeys[l] = (__m128i *)pLaneKey;
+        laneMoveScratch[l] = vclh.getpmovescratch(pLaneKey + keysize);
+    }
+    return true;
+}
 
-                acc = _mm_xor_si128(tempa3, acc);
-                const __m128i temp4 = _mm_load_si128(pbuf - (((selector & 1) << 1) - 1)); 
-                acc = _mm_xor_si128(temp4,acc);  
-                const __m128i tempb1 = _mm_mulhrs_epi16(acc, tempa3);
-                const __m128i tempb2 = _mm_xor_si128(tempb1, tempa3);
-                _mm_store_si128(prandex, tempb2);
+template <int NLANES>
+static bool verushash_sv2_2_lanes_t(verusclhasher &vclh, unsigned char **laneBufs, unsigned char **hashes, int curPos)
+{
+    __m128i *laneKeys[NLANES];
+    __m128i **laneMoveScratch[NLANES];
+    uint64_t intermediate[NLANES];
+    const u128 *finalKeys[NLANES];
+
+    if (!getlanekeys(vclh, NLANES, laneKeys, laneMoveScratch))
+    {
+        return false;
+    }
+
+    verusclhash_sv2_2_lanes<NLANES>(laneKeys, laneBufs, vclh.keyMask, laneMoveScratch, intermediate);
+
+    const uint64_t mask = vclh.keyMask >> 4;
+    for (int l = 0; l < NLANES; l++)
+    {
+        // fill buffer to the end with the result, as CVerusHashV2::FillExtra does
+        int pos = curPos;
+        int left = 32 - pos;
+        do
+        {
+            int len = left > sizeof(uint64_t) ? sizeof(uint64_t) : left;
+            std::memcpy(laneBufs[l] + 32 + pos, &intermediate[l], len);
+            pos += len;
+            left -= len;
+        } while (left > 0);
+        finalKeys[l] = laneKeys[l] + (intermediate[l] & mask);
+    }
+
+    (*haraka512keyedlanes<NLANES>())(hashes, laneBufs, finalKeys);
+    return true;
+}
+
+bool verushash_sv2_2_lanes(verusclhasher &vclh, unsigned char *laneBufs[], unsigned char *hashes[], int curPos, int nLanes)
+{
+    switch (nLanes)
+    {
+        case VERUSHASH_LANES_4X:
+            return verushash_sv2_2_lanes_t<VERUSHASH_LANES_4X>(vclh, laneBufs, hashes, curPos);
+        case VERUSHASH_LANES_8X:
+            return verushash_sv2_2_lanes_t<VERUSHASH_LANES_8X>(vclh, laneBufs, hashes, curPos);
+    }
+    return false;
+}
+
+static inline __attribute__((always_inline)) bool hashabovetarget(const uint64_t *compResult, const uint64_t *compTarget)
+{
+    return compResult[3] > compTarget[3] || (compResult[3] == compTarget[3] && compResult[2] > compTarget[2]) ||
+            (compResult[3] == compTarget[3] && compResult[2] == compTarget[2] && compResult[1] > compTarget[1]) ||
+            (compResult[3] == compTarget[3] && compResult[2] == compTarget[2] && compResult[1] == compTarget[1] && compResult[0] > compTarget[0]);
+}
+
+// same as mine_verus_v2, but only for VerusHash 2.2, and hashing NLANES nonces at a time. winners are reported
+// in nonce order, so the result is the same as mine_verus_v2 on the same range.
+template <int NLANES>
+static bool mine_verus_v2_lanes(CBlockHeader &bh, CVerusHashV2bWriter &vhw, uint256 &finalHash, uint256 &target, uint64_t start, uint64_t *count)
+{
+    CVerusHashV2 &vh = vhw.GetState();
+    verusclhasher &vclh = vh.vclh;
+
+    alignas(32) uint256 curHash[NLANES];
+    alignas(32) uint256 curTarget = target;
+    alignas(32) unsigned char laneBuf[NLANES][64];
+
+    const uint64_t *compTarget = (uint64_t *)&curTarget;
+
+    u128 *hashKey = (u128 *)verusclhasher_key.get();
+    verusclhash_descr *pdesc = (verusclhash_descr *)verusclhasher_descr.get();
+    const uint32_t keysize = pdesc->keySizeInBytes;
+    void *hasherrefresh = ((unsigned char *)hashKey) + keysize;
+    __m128i **pMoveScratch = vclh.getpmovescratch(hasherrefresh);
+    const int keyrefreshsize = vclh.keyrefreshsize(); // number of 256 bit blocks
+
+    vhw.Reset();
+    vhw << bh;
+
+    unsigned char *curBuf = vh.CurBuffer();
+
+    // skip keygen if it is the current key
+    if (pdesc->seed != *((uint256 *)curBuf))
+    {
+        // generate a new key by chain hashing with Haraka256 from the last curbuf
+        // assume 256 bit boundary
+        int n256blks = keysize >> 5;
+        unsigned char *pkey = ((unsigned char *)hashKey);
+        unsigned char *psrc = curBuf;
+        for (int i = 0; i < n256blks; i++)
+        {
+            haraka256(pkey, psrc);
+            psrc = pkey;
+            pkey += 32;
+        }
+        pdesc->seed = *((uint256 *)curBuf);
+        memcpy(hasherrefresh, hashKey, keyrefreshsize);
+        memset(((unsigned char *)hasherrefresh) + keyrefreshsize, 0, keysize - keyrefreshsize);
+    }
+    else
+    {
+        fixupkey(pMoveScratch, pdesc);
+    }
+
+    __m128i *laneKeys[NLANES];
+    __m128i **laneMoveScratch[NLANES];
+    if (!getlanekeys(vclh, NLANES, laneKeys, laneMoveScratch))
+    {
+        return mine_verus_v2(bh, vhw, finalHash, target, start, count);
+    }
+
+    const __m128i shuf1 = _mm_setr_epi8(1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 0);
+    const __m128i fill1 = _mm_shuffle_epi8(_mm_load_si128((u128 *)curBuf), shuf1);
+    const __m128i shuf2 = _mm_setr_epi8(1, 2, 3, 4, 5, 6, 7, 0, 1, 2, 3, 4, 5, 6, 7, 0);
+    unsigned char ch = curBuf[0];
+
+    unsigned char *pLaneBufs[NLANES];
+    unsigned char *pLaneHashes[NLANES];
+    const u128 *finalKeys[NLANES];
+    uint64_t intermediate[NLANES];
+    for (int l = 0; l < NLANES; l++)
+    {
+        memcpy(laneBuf[l], curBuf, 64);
+        pLaneBufs[l] = laneBuf[l];
+        pLaneHashes[l] = (unsigned char *)&curHash[l];
+    }
+
+    const haraka512_keyed_lanes_fn haraka512keyed = haraka512keyedlanes<NLANES>();
+    const uint64_t mask = vclh.keyMask >> 4;
+    uint64_t i, end = start + *count;
+    for (i = start; i < end; i += NLANES)
+    {
+        for (int l = 0; l < NLANES; l++)
+        {
+            *((int64_t *)(laneBuf[l] + 32)) = i + l;
+
+            // prepare the buffer
+            _mm_store_si128((u128 *)(&laneBuf[l][32 + 16]), fill1);
+            laneBuf[l][32 + 15] = ch;
+        }
+
+        // run verusclhash on all lanes
+        verusclhash_sv2_2_lanes<NLANES>(laneKeys, pLaneBufs, vclh.keyMask, laneMoveScratch, intermediate);
+
+        // fill buffers to the end with the result and final hash
+        for (int l = 0; l < NLANES; l++)
+        {
+            __m128i fill2 = _mm_shuffle_epi8(_mm_loadl_epi64((u128 *)&intermediate[l]), shuf2);
+            _mm_store_si128((u128 *)(&laneBuf[l][32 + 16]), fill2);
+            laneBuf[l][32 + 15] = *((unsigned char *)&intermediate[l]);
+            finalKeys[l] = laneKeys[l] + (intermediate[l] & mask);
+        }
+
+        (*haraka512keyed)(pLaneHashes, pLaneBufs, finalKeys);
+
+        int winner = -1;
+        for (int l = 0; l < NLANES && (i + l) < end; l++)
+        {
+            if (!hashabovetarget((const uint64_t *)&curHash[l], compTarget))
+            {
+                winner = l;
                 break;
             }
         }
+
+        if (winner == -1)
+        {
+            // refresh the keys
+            for (int l = 0; l < NLANES; l++)
+            {
+                fixupkey(laneMoveScratch[l], pdesc);
+            }
+            continue;
+        }
+
+        std::vector<unsigned char> solution = bh.nSolution;
+        int extraSpace = (solution.size() % 32) + 15;
+        assert(solution.size() > 32);
+        *((int64_t *)&(solution.data()[solution.size() - extraSpace])) = i + winner;
+        bh.nSolution = solution;
+        finalHash = curHash[winner];
+        *count = (i + winner - start) + 1;
+        return true;
     }
-    return acc;
+    return false;
+}
+
+bool mine_verus_v2_4x(CBlockHeader &bh, CVerusHashV2bWriter &vhw, uint256 &finalHash, uint256 &target, uint64_t start, uint64_t *count)
+{
+    return mine_verus_v2_lanes<VERUSHASH_LANES_4X>(bh, vhw, finalHash, target, start, count);
+}
+
+bool mine_verus_v2_8x(CBlockHeader &bh, CVerusHashV2bWriter &vhw, uint256 &finalHash, uint256 &target, uint64_t start, uint64_t *count)
+{
+    return mine_verus_v2_lanes<VERUSHASH_LANES_8X>(bh, vhw, finalHash, target, start, count);
 }
 
 void *alloc_aligned_buffer(uint64_t bufSize)
@@ -23,6 +23,7 @@
 
 
 #include <stdlib.h>
+#include <string.h>
 #include <stdint.h>
 #include <stddef.h>
 #include <assert.h>
@@ -70,6 +71,15 @@ struct verusclhash_descr
     uint32_t keySizeInBytes;
 };
 
+// describes the extra, per thread key copies used to hash multiple candidates at once. each lane after
+// the first has its own key, refresh and move scratch area, laid out the same as the primary key
+struct verusclhash_lanes_descr
+{
+    uint256 seed;
+    uint32_t keySizeInBytes;
+    uint32_t numLanes;                  // number of extra lane keys allocated, not including the primary key
+};
+
 struct thread_specific_ptr {
     void *ptr;
     thread_specific_ptr() { ptr = NULL; }
@@ -95,6 +105,8 @@ struct thread_specific_ptr {
 
 extern thread_local thread_specific_ptr verusclhasher_key;
 extern thread_local thread_specific_ptr verusclhasher_descr;
+extern thread_local thread_specific_ptr verusclhasher_lanes_key;
+extern thread_local thread_specific_ptr verusclhasher_lanes_descr;
 
 extern int __cpuverusoptimized;
 
@@ -250,6 +262,9 @@ struct verusclhasher {
         if (!(key = verusclhasher_key.get()) &&
             (verusclhasher_key.reset((unsigned char *)alloc_aligned_buffer(keySizeInBytes << 1)), key = verusclhasher_key.get()))
         {
+            // the move scratch list must start out empty, as key refresh follows it
+            memset(key, 0, keySizeInBytes << 1);
+
             verusclhash_descr *pdesc;
             if (verusclhasher_descr.reset(new verusclhash_descr()), pdesc = (verusclhash_descr *)verusclhasher_descr.get())
             {
@@ -334,6 +349,90 @@ struct verusclhasher {
     }
 };
 
+// number of candidates that can be hashed together by the multi-lane VerusHash 2.2 functions
+enum {
+    VERUSHASH_LANES_4X = 4,
+    VERUSHASH_LANES_8X = 8,
+    VERUSHASH_MAX_LANES = VERUSHASH_LANES_8X
+};
+
+// the implementations that can be used for multi-lane VerusHash 2.2, from slowest to fastest
+enum {
+    VERUSCLHASH_KERNEL_PORTABLE = 0,    // no multi-lane support, candidates are hashed one at a time
+    VERUSCLHASH_KERNEL_AES = 1,         // AES-NI / PCLMULQDQ on SSE registers, or ARM crypto extensions
+    VERUSCLHASH_KERNEL_VAES_AVX2 = 2,   // final keyed Haraka512 of two lanes per VAES instruction
+    VERUSCLHASH_KERNEL_VAES_AVX512 = 3  // final keyed Haraka512 of one lane and all four states per VAES instruction
+};
+
+#if !defined(__arm__) && !defined(__aarch64__)
+#ifndef bit_VAES
+#define bit_VAES (1 << 9)
+#endif
+#ifndef bit_AVX512F
+#define bit_AVX512F (1 << 16)
+#endif
+#ifndef bit_OSXSAVE
+#define bit_OSXSAVE (1 << 27)
+#endif
+#endif
+
+// returns the best multi-lane kernel available on the running CPU. the check for wide register support
+// runs only once, as cpuid may be very slow in virtual machines
+inline int GetVerusCLHashKernel()
+{
+    if (!IsCPUVerusOptimized())
+    {
+        return VERUSCLHASH_KERNEL_PORTABLE;
+    }
+#if defined(__arm__) || defined(__aarch64__)
+    return VERUSCLHASH_KERNEL_AES;
+#else
+    static int wideKernel = -1;
+    if (wideKernel == -1)
+    {
+        int kernel = VERUSCLHASH_KERNEL_AES;
+        unsigned int eax, ebx, ecx, edx;
+        if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_OSXSAVE) &&
+            __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ecx & bit_VAES))
+        {
+            // the OS must also save the upper register state on context switches
+            uint32_t xcr0, xcr0hi;
+            __asm__ __volatile__ ("xgetbv" : "=a"(xcr0), "=d"(xcr0hi) : "c"(0));
+            if ((ebx & bit_AVX512F) && (xcr0 & 0xe6) == 0xe6)
+            {
+                kernel = VERUSCLHASH_KERNEL_VAES_AVX512;
+            }
+            else if ((ebx & bit_AVX2) && (xcr0 & 0x6) == 0x6)
+            {
+                kernel = VERUSCLHASH_KERNEL_VAES_AVX2;
+            }
+        }
+        wideKernel = kernel;
+    }
+    return wideKernel;
+#endif
+}
+
+inline const char *GetVerusCLHashKernelName(int kernel=GetVerusCLHashKernel())
+{
+    switch (kernel)
+    {
+        case VERUSCLHASH_KERNEL_AES:
+            return "aes";
+        case VERUSCLHASH_KERNEL_VAES_AVX2:
+            return "vaes-avx2";
+        case VERUSCLHASH_KERNEL_VAES_AVX512:
+            return "vaes-avx512";
+    }
+    return "portable";
+}
+
+// computes the final, keyed VerusHash 2.2 step for 4 or 8 prepared 64 byte buffers, which must all share the same
+// 32 byte key seed at the beginning of the buffer. each buffer must already have its extra data filled with
+// the beginning of the buffer, and curPos is the number of extra bytes that were written before that fill.
+// the primary key must be current for the seed before calling. returns false if lane key space cannot be allocated.
+bool verushash_sv2_2_lanes(verusclhasher &vclh, unsigned char *laneBufs[], unsigned char *hashes[], int curPos, int nLanes);
+
 #endif // #ifdef __cplusplus
 
 #endif // INCLUDE_VERUS_CLHASH_H
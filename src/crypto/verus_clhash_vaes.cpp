@@ -0,0 +1,140 @@
+/*
+ * This uses variations of the clhash algorithm for Verus Coin, licensed
+ * with the Apache-2.0 open source license.
+ *
+ * Copyright (c) 2018 Michael Toutonghi
+ * Distributed under the Apache 2.0 software license, available in the original form for clhash
+ * here: https://github.com/lemire/clhash/commit/934da700a2a54d8202929a826e2763831bd43cf7#diff-9879d6db96fd29134fc802214163b95a
+ *
+ * This implements the multi-lane, per lane keyed Haraka512 final step of VerusHash 2.2 with VAES on 256 and 512 bit
+ * registers. The CLHash step itself selects its operations and key locations from the accumulator of each lane,
+ * so lanes diverge on every round and remain on 128 bit registers.
+ *
+ * These functions are compiled with target attributes, and must only be called after checking
+ * GetVerusCLHashKernel() on the running CPU.
+ *
+ **/
+
+#if !defined(__arm__) && !defined(__aarch64__)
+
+#include "uint256.h"
+#include "crypto/verus_clhash.h"
+
+extern "C"
+{
+#include "crypto/haraka.h"
+}
+
+#define VAES_TARGET_AVX2 __attribute__((target("avx2,aes,vaes")))
+#define VAES_TARGET_AVX512 __attribute__((target("avx2,avx512f,aes,vaes")))
+
+// two lanes in each 256 bit register, one register for each of the four 128 bit Haraka512 states. each lane
+// has its own round key, so we combine the round keys of two lanes for every instruction
+static inline __attribute__((always_inline)) VAES_TARGET_AVX2 __m256i loadlanekeys_2x(const u128 *prc0, const u128 *prc1)
+{
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128(prc0)), _mm_loadu_si128(prc1), 1);
+}
+
+template <int NLANES>
+static inline __attribute__((always_inline)) VAES_TARGET_AVX2 void haraka512_keyed_lanes_vaes256(unsigned char **out, unsigned char **in, const u128 **prc)
+{
+    __m256i s[NLANES >> 1][4], tmp;
+
+    for (int p = 0; p < (NLANES >> 1); p++)
+    {
+        for (int k = 0; k < 4; k++)
+        {
+            s[p][k] = loadlanekeys_2x((const u128 *)(in[p << 1] + (k << 4)), (const u128 *)(in[(p << 1) + 1] + (k << 4)));
+        }
+    }
+
+    for (int round = 0; round < 40; round += 8)
+    {
+        for (int p = 0; p < (NLANES >> 1); p++)
+        {
+            const u128 *rc0 = prc[p << 1], *rc1 = prc[(p << 1) + 1];
+            for (int k = 0; k < 8; k++)
+            {
+                s[p][k & 3] = _mm256_aesenc_epi128(s[p][k & 3], loadlanekeys_2x(rc0 + round + k, rc1 + round + k));
+            }
+
+            // same as MIX4, which only crosses 32 bit words within each 128 bit lane
+            tmp = _mm256_unpacklo_epi32(s[p][0], s[p][1]);
+            s[p][0] = _mm256_unpackhi_epi32(s[p][0], s[p][1]);
+            s[p][1] = _mm256_unpacklo_epi32(s[p][2], s[p][3]);
+            s[p][2] = _mm256_unpackhi_epi32(s[p][2], s[p][3]);
+            s[p][3] = _mm256_unpacklo_epi32(s[p][0], s[p][2]);
+            s[p][0] = _mm256_unpackhi_epi32(s[p][0], s[p][2]);
+            s[p][2] = _mm256_unpackhi_epi32(s[p][1], tmp);
+            s[p][1] = _mm256_unpacklo_epi32(s[p][1], tmp);
+        }
+    }
+
+    for (int p = 0; p < (NLANES >> 1); p++)
+    {
+        alignas(32) u128 result[2][4];
+        for (int k = 0; k < 4; k++)
+        {
+            const __m256i feed = loadlanekeys_2x((const u128 *)(in[p << 1] + (k << 4)), (const u128 *)(in[(p << 1) + 1] + (k << 4)));
+            s[p][k] = _mm256_xor_si256(s[p][k], feed);
+            result[0][k] = _mm256_castsi256_si128(s[p][k]);
+            result[1][k] = _mm256_extracti128_si256(s[p][k], 1);
+        }
+        TRUNCSTORE(out[p << 1], result[0][0], result[0][1], result[0][2], result[0][3]);
+        TRUNCSTORE(out[(p << 1) + 1], result[1][0], result[1][1], result[1][2], result[1][3]);
+    }
+}
+
+// one lane in each 512 bit register. the four round keys used together by each AES4 step are contiguous in the
+// lane's key, and MIX4 becomes a single permutation of the 16 words
+template <int NLANES>
+static inline __attribute__((always_inline)) VAES_TARGET_AVX512 void haraka512_keyed_lanes_vaes512(unsigned char **out, unsigned char **in, const u128 **prc)
+{
+    const __m512i mix4 = _mm512_setr_epi32(3, 11, 7, 15, 8, 0, 12, 4, 9, 1, 13, 5, 2, 10, 6, 14);
+    __m512i s[NLANES];
+
+    for (int l = 0; l < NLANES; l++)
+    {
+        s[l] = _mm512_loadu_si512((const void *)in[l]);
+    }
+
+    for (int round = 0; round < 40; round += 8)
+    {
+        for (int l = 0; l < NLANES; l++)
+        {
+            s[l] = _mm512_aesenc_epi128(s[l], _mm512_loadu_si512((const void *)(prc[l] + round)));
+            s[l] = _mm512_aesenc_epi128(s[l], _mm512_loadu_si512((const void *)(prc[l] + round + 4)));
+            s[l] = _mm512_permutexvar_epi32(mix4, s[l]);
+        }
+    }
+
+    for (int l = 0; l < NLANES; l++)
+    {
+        alignas(64) u128 result[4];
+        s[l] = _mm512_xor_si512(s[l], _mm512_loadu_si512((const void *)in[l]));
+        _mm512_store_si512((void *)result, s[l]);
+        TRUNCSTORE(out[l], result[0], result[1], result[2], result[3]);
+    }
+}
+
+VAES_TARGET_AVX2 void haraka512_keyed_4x_vaes256(unsigned char **out, unsigned char **in, const u128 **prc)
+{
+    haraka512_keyed_lanes_vaes256<VERUSHASH_LANES_4X>(out, in, prc);
+}
+
+VAES_TARGET_AVX2 void haraka512_keyed_8x_vaes256(unsigned char **out, unsigned char **in, const u128 **prc)
+{
+    haraka512_keyed_lanes_vaes256<VERUSHASH_LANES_8X>(out, in, prc);
+}
+
+VAES_TARGET_AVX512 void haraka512_keyed_4x_vaes512(unsigned char **out, unsigned char **in, const u128 **prc)
+{
+    haraka512_keyed_lanes_vaes512<VERUSHASH_LANES_4X>(out, in, prc);
+}
+
+VAES_TARGET_AVX512 void haraka512_keyed_8x_vaes512(unsigned char **out, unsigned char **in, const u128 **prc)
+{
+    haraka512_keyed_lanes_vaes512<VERUSHASH_LANES_8X>(out, in, prc);
+}
+
+#endif // !defined(__arm__) && !defined(__aarch64__)
@@ -179,6 +179,45 @@ CVerusHashV2 &CVerusHashV2::Write(const unsigned char *data, size_t len)
     return *this;
 }
 
+void CVerusHashV2::Finalize2bLanes(unsigned char (*hashes)[32], const int64_t *nonces, int nLanes)
+{
+    alignas(32) unsigned char savedBuf[64];
+    std::memcpy(savedBuf, curBuf, 64);
+
+    if (IsCPUVerusOptimized() &&
+        vclh.verusclhashfunction == &verusclhash_sv2_2 &&
+        (nLanes == VERUSHASH_LANES_4X || nLanes == VERUSHASH_LANES_8X))
+    {
+        alignas(32) unsigned char laneBuf[VERUSHASH_MAX_LANES][64];
+        unsigned char *pLaneBufs[VERUSHASH_MAX_LANES];
+        unsigned char *pHashes[VERUSHASH_MAX_LANES];
+
+        for (int l = 0; l < nLanes; l++)
+        {
+            *ExtraI64Ptr() = nonces[l];
+            FillExtra((u128 *)curBuf);
+            std::memcpy(laneBuf[l], curBuf, 64);
+            std::memcpy(curBuf, savedBuf, 64);
+            pLaneBufs[l] = laneBuf[l];
+            pHashes[l] = hashes[l];
+        }
+
+        // all lanes share the seed, so the primary key is generated once for all of them
+        GenNewCLKey(laneBuf[0]);
+        if (verushash_sv2_2_lanes(vclh, pLaneBufs, pHashes, curPos, nLanes))
+        {
+            return;
+        }
+    }
+
+    for (int l = 0; l < nLanes; l++)
+    {
+        *ExtraI64Ptr() = nonces[l];
+        Finalize2b(hashes[l]);
+        std::memcpy(curBuf, savedBuf, 64);
+    }
+}
+
 // to be declared and accessed from C
 void verus_hash_v2(void *result, const void *data, size_t len)
 {
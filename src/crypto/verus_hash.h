@@ -170,13 +170,21 @@ class CVerusHashV2
                 }
                 pdesc->seed = *((uint256 *)seedBytes32);
                 memcpy(key + size, key, refreshsize);
+                memset((unsigned char *)key + (size + refreshsize), 0, size - refreshsize);
             }
             else
             {
-                memcpy(key, key + size, refreshsize);
+                // verusclhash records each location it mutates in the move scratch area after the
+                // refresh copy, so we only need to restore those instead of the whole key
+                u128 **ppfixup = (u128 **)(key + size + refreshsize);
+                const int ofs = size >> 4;
+                for (u128 *pfixup = *ppfixup; pfixup; pfixup = *++ppfixup)
+                {
+                    *pfixup = *(pfixup + ofs);
+                }
+                // mark the list as restored, so we don't repeat it if there is no hash in between
+                *((u128 **)(key + size + refreshsize)) = NULL;
             }
-
-            memset((unsigned char *)key + (size + refreshsize), 0, size - refreshsize);
             return (u128 *)key;
         }
 
@@ -220,6 +228,11 @@ class CVerusHashV2
             (*haraka512KeyedFunction)(hash, curBuf, key + IntermediateTo128Offset(intermediate));
         }
 
+        // computes Finalize2b for nLanes candidates that differ only in the 64 bit value at ExtraI64Ptr(), one
+        // hash per nonce. VerusHash 2.2 hashes 4 or 8 at a time on optimized CPUs, other cases hash them one
+        // at a time. the state of this object is not changed.
+        void Finalize2bLanes(unsigned char (*hashes)[32], const int64_t *nonces, int nLanes);
+
         inline unsigned char *CurBuffer()
         {
             return curBuf;
@@ -96,6 +96,8 @@ int             cc_MakeSecp256k1Signature(const unsigned char *msg32, const unsi
 int             cc_MakeFalcon512Signature(const unsigned char *msg32, const unsigned char *privateKey, unsigned char **signatureOut);
 int             cc_MakeFalcon512KeyPair(unsigned char *privateKey, unsigned char *publicKey);
 int             cc_VerifyFalcon512Key(const unsigned char *msg32, const unsigned char *publicKey, unsigned char *signature);
+int             cc_VerifyFalcon512Batch(size_t count, const unsigned char *const *msg32s, const unsigned char *const *publicKeys,
+                                        unsigned char *const *signatures, int *results);
 int             cc_ApplySecp256k1Signature(const CC *cond, const unsigned char *publicKey, const unsigned char *pubkeyHash20, const unsigned char *signature);
 int             cc_readFulfillmentBinaryExt(const unsigned char *ffill_bin, size_t ffill_bin_len, CC **ppcc);
 int             cc_readPartialFulfillmentBinaryExt(const unsigned char *ffill_bin, size_t ffill_bin_len, CC **ppcc);
@@ -103,32 +103,45 @@ int cc_MakeFalcon512KeyPair(unsigned char *privateKey, unsigned char *publicKey)
     return 1;    
 }
 
-int cc_VerifyFalcon512Key(const unsigned char *msg32, const unsigned char *publicKey, unsigned char *signature){  
-    
-    shake256_context rng;
-    shake256_init_prng_from_system(&rng);
-
-    size_t pubkey_len, sig_len;
-    size_t tmpvv_len;
-    uint8_t *tmpvv;
-
+/*
+ * verifies count signatures with one scratch buffer, which is what costs the most to set up when each is verified
+ * alone. results[i], if results is not null, is set to whether signature i is valid. returns 1 if all of them are.
+ */
+int cc_VerifyFalcon512Batch(size_t count, const unsigned char *const *msg32s, const unsigned char *const *publicKeys,
+                            unsigned char *const *signatures, int *results)
+{
     unsigned logn = 9; // 9 is falcon 512
-    pubkey_len = FALCON_PUBKEY_SIZE(logn); // not sure if we are using these lengths?
-
-	sig_len = FALCON_SIG_VARTIME_MAXSIZE(logn);
-
-    tmpvv_len = FALCON_TMPSIZE_VERIFY(logn);
+    size_t pubkey_len = FALCON_PUBKEY_SIZE(logn);
+    size_t sig_len = FALCON_SIG_VARTIME_MAXSIZE(logn);
+    size_t tmpvv_len = FALCON_TMPSIZE_VERIFY(logn);
+    uint8_t *tmpvv = malloc(tmpvv_len);
+    int allValid = 1;
+    size_t i;
+
+    if (!tmpvv) {
+        return 0;
+    }
 
-    tmpvv = malloc(tmpvv_len);
+    for (i = 0; i < count; i++) {
+        // the message length is that used when signing, see cc_MakeFalcon512Signature
+        int error = falcon_verify(signatures[i], sig_len, publicKeys[i], pubkey_len,
+                                  (const void*)msg32s[i], sizeof(msg32s[i]), tmpvv, tmpvv_len);
+        if (error != 0) {
+            fprintf(stderr, "Falcon512 verify failed: %d\n", error);
+            allValid = 0;
+        }
+        if (results) {
+            results[i] = error == 0;
+        }
+    }
 
-   int  error = falcon_verify(signature, sig_len,
-			publicKey, pubkey_len, (const void*)msg32, sizeof(msg32), tmpvv, tmpvv_len);
-		if (error != 0) {
-			fprintf(stderr, "Falcon512 verify failed: %d\n", error);
-            return 0;
-		}
+    free(tmpvv);
+    return allValid;
+}
 
-    return 1;
+int cc_VerifyFalcon512Key(const unsigned char *msg32, const unsigned char *publicKey, unsigned char *signature)
+{
+    return cc_VerifyFalcon512Batch(1, &msg32, &publicKey, &signature, NULL);
 }
 
 static unsigned char *falcon512Fingerprint(const CC *cond) {
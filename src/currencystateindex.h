@@ -0,0 +1,78 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_CURRENCYSTATEINDEX_H
+#define BITCOIN_CURRENCYSTATEINDEX_H
+
+#include "uint256.h"
+#include "serialize.h"
+
+// currency states are keyed by height first, so all states of a disconnected block can be erased with one seek
+struct CCurrencyStateIndexIteratorKey {
+    unsigned int height;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 4;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writedata32be(s, height);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        height = ser_readdata32be(s);
+    }
+
+    CCurrencyStateIndexIteratorKey(unsigned int nHeight) {
+        height = nHeight;
+    }
+
+    CCurrencyStateIndexIteratorKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        height = 0;
+    }
+};
+
+struct CCurrencyStateIndexKey {
+    unsigned int height;
+    uint160 currencyID;
+    bool pendingTransfers;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 25;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writedata32be(s, height);
+        currencyID.Serialize(s);
+        ser_writedata8(s, pendingTransfers);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        height = ser_readdata32be(s);
+        currencyID.Unserialize(s);
+        pendingTransfers = ser_readdata8(s) != 0;
+    }
+
+    CCurrencyStateIndexKey(unsigned int nHeight, const uint160 &id, bool fPendingTransfers) {
+        height = nHeight;
+        currencyID = id;
+        pendingTransfers = fPendingTransfers;
+    }
+
+    CCurrencyStateIndexKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        height = 0;
+        currencyID.SetNull();
+        pendingTransfers = false;
+    }
+};
+
+#endif // BITCOIN_CURRENCYSTATEINDEX_H
@@ -4,22 +4,184 @@
 
 #include "dbwrapper.h"
 
+#include "trace.h"
 #include "util.h"
 
 #include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
 
 #include <leveldb/cache.h>
 #include <leveldb/env.h>
 #include <leveldb/filter_policy.h>
 #include <memenv.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <string.h>
 
-static leveldb::Options GetOptions(size_t nCacheSize, bool compression, int maxOpenFiles)
+#include <algorithm>
+#include <mutex>
+
+/** LevelDB block cache that counts lookups that hit and the bytes it holds */
+class CDBCountingCache : public leveldb::Cache
+{
+private:
+    // entries are wrapped to learn when the cache lets go of them
+    struct Entry
+    {
+        void *value;
+        void (*deleter)(const leveldb::Slice &key, void *value);
+        size_t charge;
+        CDBCountingCache *cache;
+    };
+
+    static void DeleteEntry(const leveldb::Slice &key, void *value)
+    {
+        Entry *entry = static_cast<Entry *>(value);
+        entry->cache->nUsage -= entry->charge;
+        entry->deleter(key, entry->value);
+        delete entry;
+    }
+
+    leveldb::Cache *base;
+
+public:
+    const size_t nCapacity;
+    std::atomic<uint64_t> nHits;
+    std::atomic<uint64_t> nMisses;
+    std::atomic<uint64_t> nUsage;
+
+    CDBCountingCache(size_t capacity) : base(leveldb::NewLRUCache(capacity)), nCapacity(capacity), nHits(0), nMisses(0), nUsage(0) {}
+    ~CDBCountingCache() { delete base; }
+
+    Handle *Insert(const leveldb::Slice &key, void *value, size_t charge, void (*deleter)(const leveldb::Slice &key, void *value))
+    {
+        nUsage += charge;
+        return base->Insert(key, new Entry{value, deleter, charge, this}, charge, &DeleteEntry);
+    }
+
+    Handle *Lookup(const leveldb::Slice &key)
+    {
+        Handle *handle = base->Lookup(key);
+        if (handle)
+            nHits++;
+        else
+            nMisses++;
+        return handle;
+    }
+
+    void Release(Handle *handle) { base->Release(handle); }
+    void *Value(Handle *handle) { return static_cast<Entry *>(base->Value(handle))->value; }
+    void Erase(const leveldb::Slice &key) { base->Erase(key); }
+    uint64_t NewId() { return base->NewId(); }
+};
+
+/** Sends the LevelDB info log to the debug log under -debug=leveldb, counting the writes it reports as stalled */
+class CDBLogger : public leveldb::Logger
+{
+public:
+    std::atomic<uint64_t> nWriteStalls;
+
+    CDBLogger() : nWriteStalls(0) {}
+
+    void Logv(const char *format, va_list ap)
+    {
+        // "Current memtable full; waiting..." and "Too many L0 files; waiting..." are logged as a write blocks
+        if (strstr(format, "waiting..."))
+            nWriteStalls++;
+        if (!LogAcceptCategory("leveldb"))
+            return;
+
+        char buffer[500];
+        va_list apCopy;
+        va_copy(apCopy, ap);
+        int nLength = vsnprintf(buffer, sizeof(buffer), format, apCopy);
+        va_end(apCopy);
+        if (nLength < 0)
+            return;
+        std::string strMessage;
+        if ((size_t)nLength < sizeof(buffer)) {
+            strMessage.assign(buffer, nLength);
+        } else {
+            std::vector<char> longBuffer(nLength + 1);
+            vsnprintf(&longBuffer[0], longBuffer.size(), format, ap);
+            strMessage.assign(&longBuffer[0], nLength);
+        }
+        if (strMessage.empty() || strMessage.back() != '\n')
+            strMessage += '\n';
+        LogPrint("leveldb", "leveldb: %s", strMessage);
+    }
+};
+
+// open databases, for GetAllStats
+static std::mutex &OpenDatabasesMutex()
+{
+    static std::mutex cs;
+    return cs;
+}
+
+static std::vector<const CDBWrapper *> &OpenDatabases()
+{
+    static std::vector<const CDBWrapper *> databases;
+    return databases;
+}
+
+CDBLatencyHistogram::CDBLatencyHistogram() : nCount(0), nTotalMicros(0)
+{
+    for (auto &bucket : buckets)
+        bucket = 0;
+}
+
+void CDBLatencyHistogram::Reset()
+{
+    for (auto &bucket : buckets)
+        bucket = 0;
+    nCount = 0;
+    nTotalMicros = 0;
+}
+
+void CDBLatencyHistogram::Add(int64_t nMicros)
+{
+    int bucket = 0;
+    while (bucket < CDBLatencyStats::BUCKETS - 1 && nMicros >= ((int64_t)1 << bucket))
+        bucket++;
+    buckets[bucket]++;
+    nCount++;
+    nTotalMicros += std::max(nMicros, (int64_t)0);
+}
+
+CDBLatencyStats CDBLatencyHistogram::GetStats() const
+{
+    CDBLatencyStats stats;
+    for (int i = 0; i < CDBLatencyStats::BUCKETS; i++) {
+        stats.buckets[i] = buckets[i];
+        stats.nCount += stats.buckets[i];
+    }
+    stats.nTotalMicros = nTotalMicros;
+    return stats;
+}
+
+int64_t CDBLatencyStats::Percentile(double fraction) const
+{
+    uint64_t nSeen = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+        nSeen += buckets[i];
+        if (nSeen && nSeen >= fraction * nCount)
+            return (int64_t)1 << i;
+    }
+    return 0;
+}
+
+static leveldb::Options GetOptions(size_t nCacheSize, bool compression, int maxOpenFiles, int bloomBits, size_t blockSize, size_t writeBufferSize)
 {
     leveldb::Options options;
-    options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
-    options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
-    options.filter_policy = leveldb::NewBloomFilterPolicy(10);
+    options.block_cache = new CDBCountingCache(nCacheSize / 2);
+    options.info_log = new CDBLogger();
+    // up to two write buffers may be held in memory simultaneously
+    options.write_buffer_size = writeBufferSize ? writeBufferSize : nCacheSize / 4;
+    options.filter_policy = leveldb::NewBloomFilterPolicy(bloomBits);
+    if (blockSize) {
+        options.block_size = blockSize;
+    }
     options.compression = compression ? leveldb::kSnappyCompression : leveldb::kNoCompression;
     options.max_open_files = maxOpenFiles;
     if (leveldb::kMajorVersion > 1 || (leveldb::kMajorVersion == 1 && leveldb::kMinorVersion >= 16)) {
@@ -30,14 +192,15 @@ static leveldb::Options GetOptions(size_t nCacheSize, bool compression, int maxO
     return options;
 }
 
-CDBWrapper::CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool compression, int maxOpenFiles)
+CDBWrapper::CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool compression, int maxOpenFiles,
+                       int bloomBits, size_t blockSize, size_t writeBufferSize)
 {
     penv = NULL;
     readoptions.verify_checksums = true;
     iteroptions.verify_checksums = true;
     iteroptions.fill_cache = false;
     syncoptions.sync = true;
-    options = GetOptions(nCacheSize, compression, maxOpenFiles);
+    options = GetOptions(nCacheSize, compression, maxOpenFiles, bloomBits, blockSize, writeBufferSize);
     options.create_if_missing = true;
     if (fMemory) {
         penv = leveldb::NewMemEnv(leveldb::Env::Default());
@@ -54,27 +217,170 @@ CDBWrapper::CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, b
     leveldb::Status status = leveldb::DB::Open(options, path.string(), &pdb);
     dbwrapper_private::HandleError(status);
     LogPrintf("Opened LevelDB successfully\n");
+
+    name = path.string();
+    std::string strDataDir = GetDataDir().string();
+    if (name.size() > strDataDir.size() && name.compare(0, strDataDir.size(), strDataDir) == 0)
+        name = name.substr(strDataDir.size() + 1);
+    std::lock_guard<std::mutex> lock(OpenDatabasesMutex());
+    OpenDatabases().push_back(this);
 }
 
 CDBWrapper::~CDBWrapper()
 {
+    {
+        std::lock_guard<std::mutex> lock(OpenDatabasesMutex());
+        std::vector<const CDBWrapper *> &databases = OpenDatabases();
+        databases.erase(std::remove(databases.begin(), databases.end(), this), databases.end());
+    }
     delete pdb;
     pdb = NULL;
     delete options.filter_policy;
     options.filter_policy = NULL;
     delete options.block_cache;
     options.block_cache = NULL;
+    delete options.info_log;
+    options.info_log = NULL;
     delete penv;
     options.env = NULL;
 }
 
-bool CDBWrapper::WriteBatch(CDBBatch& batch, bool fSync)
+bool CDBWrapper::CommitBatch(CDBBatch& batch, bool fSync, DBOperation op)
 {
+    int64_t nStart = GetTimeMicros();
     leveldb::Status status = pdb->Write(fSync ? syncoptions : writeoptions, &batch.batch);
+    int64_t nMicros = GetTimeMicros() - nStart;
+    latency[op].Add(nMicros);
+    TRACE4(dbwrapper, batch_commit, name.c_str(), (int)op, fSync, nMicros);
     dbwrapper_private::HandleError(status);
     return true;
 }
 
+CDBIterator *CDBWrapper::NewIterator(bool fFillCache)
+{
+    leveldb::ReadOptions options = iteroptions;
+    options.fill_cache = fFillCache;
+    return new CDBIterator(*this, pdb->NewIterator(options));
+}
+
+CDBIterator *CDBWrapper::NewIterator(const CDBSnapshot &snapshot, bool fFillCache)
+{
+    leveldb::ReadOptions options = iteroptions;
+    options.fill_cache = fFillCache;
+    options.snapshot = snapshot.get();
+    return new CDBIterator(*this, pdb->NewIterator(options));
+}
+
+void CDBWrapper::ReadSerializedMany(const std::vector<std::string> &keys, std::vector<std::string> &values,
+                                    std::vector<unsigned char> &found, int nThreads) const
+{
+    // below this many keys per thread, starting threads costs more than the overlapped reads save
+    static const size_t MIN_KEYS_PER_THREAD = 16;
+
+    std::vector<size_t> order(keys.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&keys](size_t a, size_t b) { return keys[a] < keys[b]; });
+
+    values.assign(keys.size(), std::string());
+    found.assign(keys.size(), 0);
+    if (keys.empty())
+        return;
+
+    size_t nRuns = std::max((size_t)1, std::min((size_t)std::max(nThreads, 1), keys.size() / MIN_KEYS_PER_THREAD));
+    size_t runSize = (keys.size() + nRuns - 1) / nRuns;
+    std::vector<leveldb::Status> runStatus(nRuns);
+
+    auto readRun = [this, &keys, &values, &found, &order, &runStatus, runSize](size_t run)
+    {
+        std::unique_ptr<leveldb::Iterator> piter(pdb->NewIterator(readoptions));
+        size_t end = std::min(keys.size(), (run + 1) * runSize);
+        for (size_t j = run * runSize; j < end; j++) {
+            size_t i = order[j];
+            leveldb::Slice slKey(keys[i]);
+            // the entry after the last key read is often this one, and an entry past this key means it is absent
+            if (piter->Valid() && piter->key().compare(slKey) < 0)
+                piter->Next();
+            if (!piter->Valid() || piter->key().compare(slKey) < 0)
+                piter->Seek(slKey);
+            if (!piter->Valid())
+                break;
+            if (piter->key() == slKey) {
+                values[i] = piter->value().ToString();
+                found[i] = 1;
+            }
+        }
+        runStatus[run] = piter->status();
+    };
+
+    if (nRuns == 1) {
+        readRun(0);
+    } else {
+        boost::thread_group readThreads;
+        for (size_t run = 0; run < nRuns; run++)
+            readThreads.create_thread(boost::bind<void>(readRun, run));
+        readThreads.join_all();
+    }
+    for (const leveldb::Status &status : runStatus)
+        dbwrapper_private::HandleError(status);
+}
+
+void CDBWrapper::GetStats(CDBStats &stats) const
+{
+    // LevelDB 1.18 has no per level size or pending compaction properties, so both come from the table list.
+    // its lines are " number:size[smallest .. largest]" under a "--- level N ---" heading
+    static const int NUM_LEVELS = 7;
+    stats.name = name;
+    stats.levelFiles.assign(NUM_LEVELS, 0);
+    stats.levelBytes.assign(NUM_LEVELS, 0);
+    std::string strTables;
+    pdb->GetProperty("leveldb.stats", &stats.strLevelDBStats);
+    pdb->GetProperty("leveldb.sstables", &strTables);
+    int level = 0;
+    size_t pos = 0;
+    while (pos < strTables.size()) {
+        size_t end = strTables.find('\n', pos);
+        if (end == std::string::npos)
+            end = strTables.size();
+        std::string strLine = strTables.substr(pos, end - pos);
+        pos = end + 1;
+        unsigned long long nNumber, nSize;
+        if (sscanf(strLine.c_str(), "--- level %d ---", &level) == 1)
+            continue;
+        if (level >= 0 && level < NUM_LEVELS && sscanf(strLine.c_str(), " %llu:%llu[", &nNumber, &nSize) == 2) {
+            stats.levelFiles[level]++;
+            stats.levelBytes[level] += nSize;
+        }
+    }
+
+    // level 0 is compacted once it has 4 files, level n above 0 once it holds more than 10^n MB. the last level never is
+    stats.nPendingCompactionBytes = stats.levelFiles[0] >= 4 ? stats.levelBytes[0] : 0;
+    double nMaxLevelBytes = 10.0 * 1048576.0;
+    for (int i = 1; i < NUM_LEVELS - 1; i++, nMaxLevelBytes *= 10) {
+        if (stats.levelBytes[i] > nMaxLevelBytes)
+            stats.nPendingCompactionBytes += stats.levelBytes[i] - (uint64_t)nMaxLevelBytes;
+    }
+
+    const CDBCountingCache *pcache = static_cast<const CDBCountingCache *>(options.block_cache);
+    stats.nCacheSize = pcache->nCapacity;
+    stats.nCacheUsage = pcache->nUsage;
+    stats.nCacheHits = pcache->nHits;
+    stats.nCacheMisses = pcache->nMisses;
+    stats.nWriteBufferSize = options.write_buffer_size;
+    stats.nWriteStalls = static_cast<const CDBLogger *>(options.info_log)->nWriteStalls;
+    for (int op = 0; op < DBOP_COUNT; op++)
+        stats.latency[op] = latency[op].GetStats();
+}
+
+std::vector<CDBStats> CDBWrapper::GetAllStats()
+{
+    std::lock_guard<std::mutex> lock(OpenDatabasesMutex());
+    std::vector<CDBStats> allStats(OpenDatabases().size());
+    for (size_t i = 0; i < allStats.size(); i++)
+        OpenDatabases()[i]->GetStats(allStats[i]);
+    return allStats;
+}
+
 bool CDBWrapper::IsEmpty()
 {
     boost::scoped_ptr<CDBIterator> it(NewIterator());
@@ -11,6 +11,9 @@
 #include "util.h"
 #include "version.h"
 
+#include <atomic>
+#include <memory>
+
 #include <boost/filesystem/path.hpp>
 
 #include <leveldb/db.h>
@@ -37,6 +40,67 @@ void HandleError(const leveldb::Status& status);
 
 };
 
+/** Kinds of database operation whose latency is recorded */
+enum DBOperation
+{
+    DBOP_READ,          // point reads, including Exists
+    DBOP_WRITE,         // single key writes and erases
+    DBOP_BATCH,         // batch commits
+    DBOP_COUNT
+};
+
+/** Latencies of one kind of operation, as counts in power of two microsecond buckets */
+struct CDBLatencyStats
+{
+    //! bucket i counts latencies below 2^i microseconds, the last bucket all slower ones
+    static const int BUCKETS = 24;
+
+    uint64_t nCount;
+    int64_t nTotalMicros;
+    std::vector<uint64_t> buckets;
+
+    CDBLatencyStats() : nCount(0), nTotalMicros(0), buckets(BUCKETS, 0) {}
+
+    //! upper bound in microseconds of the bucket that the given fraction of operations falls within
+    int64_t Percentile(double fraction) const;
+};
+
+/** Thread safe recorder for CDBLatencyStats */
+class CDBLatencyHistogram
+{
+private:
+    std::atomic<uint64_t> buckets[CDBLatencyStats::BUCKETS];
+    std::atomic<uint64_t> nCount;
+    std::atomic<int64_t> nTotalMicros;
+
+public:
+    CDBLatencyHistogram();
+    void Add(int64_t nMicros);
+    CDBLatencyStats GetStats() const;
+    //! not atomic with respect to concurrent Adds, which may be counted on either side of the reset
+    void Reset();
+};
+
+/** Statistics of one open database, see CDBWrapper::GetStats */
+struct CDBStats
+{
+    std::string name;                   // location relative to the data directory
+    std::string strLevelDBStats;        // the leveldb.stats property, compaction totals per level
+    std::vector<int> levelFiles;
+    std::vector<uint64_t> levelBytes;
+    uint64_t nPendingCompactionBytes;   // bytes to compact before every level is back under its size target
+    uint64_t nCacheSize;
+    uint64_t nCacheUsage;
+    uint64_t nCacheHits;
+    uint64_t nCacheMisses;
+    uint64_t nWriteBufferSize;
+    uint64_t nWriteStalls;              // writes that waited for a memtable flush or level 0 compaction
+    CDBLatencyStats latency[DBOP_COUNT];
+
+    CDBStats() : nPendingCompactionBytes(0), nCacheSize(0), nCacheUsage(0), nCacheHits(0), nCacheMisses(0),
+                 nWriteBufferSize(0), nWriteStalls(0) {}
+};
+
 /** Batch of changes queued to be written to a CDBWrapper */
 class CDBBatch
 {
@@ -78,6 +142,32 @@ public:
 
         batch.Delete(slKey);
     }
+
+    /** Discard the queued changes, so the batch can be reused after it is written */
+    void Clear()
+    {
+        batch.Clear();
+    }
+};
+
+/**
+ * A consistent view of a database as it was when the snapshot was taken, later writes are not seen through it. The
+ * LevelDB snapshot is released when the last reference goes, which must be before the database is closed.
+ */
+class CDBSnapshot
+{
+private:
+    leveldb::DB* pdb;
+    const leveldb::Snapshot* psnapshot;
+
+public:
+    CDBSnapshot(leveldb::DB* pdbIn) : pdb(pdbIn), psnapshot(pdbIn->GetSnapshot()) {}
+    ~CDBSnapshot() { pdb->ReleaseSnapshot(psnapshot); }
+
+    CDBSnapshot(const CDBSnapshot&) = delete;
+    CDBSnapshot& operator=(const CDBSnapshot&) = delete;
+
+    const leveldb::Snapshot* get() const { return psnapshot; }
 };
 
 class CDBIterator
@@ -127,6 +217,11 @@ public:
         return piter->key().size();
     }
 
+    //! Copy of the serialized key, for keys of a format that may no longer be known
+    std::string GetKeyBytes() {
+        return piter->key().ToString();
+    }
+
     template<typename V> bool GetValue(V& value) {
         leveldb::Slice slValue = piter->value();
         try {
@@ -142,6 +237,11 @@ public:
         return piter->value().size();
     }
 
+    //! Copy of the serialized value, for deserializing it later or on another thread
+    std::string GetValueBytes() {
+        return piter->value().ToString();
+    }
+
 };
 
 class CDBWrapper
@@ -168,14 +268,31 @@ private:
     //! the database itself
     leveldb::DB* pdb;
 
+    //! name reported in statistics
+    std::string name;
+
+    //! latency of reads, writes and batch commits
+    mutable CDBLatencyHistogram latency[DBOP_COUNT];
+
+    //! write a batch, counting its latency as the given operation
+    bool CommitBatch(CDBBatch& batch, bool fSync, DBOperation op);
+
+    //! resolve serialized keys to serialized values, see ReadMany
+    void ReadSerializedMany(const std::vector<std::string> &keys, std::vector<std::string> &values,
+                            std::vector<unsigned char> &found, int nThreads) const;
+
 public:
     /**
      * @param[in] path        Location in the filesystem where leveldb data will be stored.
      * @param[in] nCacheSize  Configures various leveldb cache settings.
      * @param[in] fMemory     If true, use leveldb's memory environment.
      * @param[in] fWipe       If true, remove all existing data.
+     * @param[in] bloomBits   Bloom filter bits per key.
+     * @param[in] blockSize   Uncompressed table block size in bytes, 0 for the leveldb default.
+     * @param[in] writeBufferSize  Bytes buffered before a table is written, 0 for a quarter of nCacheSize.
      */
-    CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool compression = false, int maxOpenFiles = 64);
+    CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool compression = false, int maxOpenFiles = 64,
+               int bloomBits = 10, size_t blockSize = 0, size_t writeBufferSize = 0);
     ~CDBWrapper();
 
     template <typename K, typename V>
@@ -187,7 +304,9 @@ public:
         leveldb::Slice slKey(&ssKey[0], ssKey.size());
 
         std::string strValue;
+        int64_t nStart = GetTimeMicros();
         leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+        latency[DBOP_READ].Add(GetTimeMicros() - nStart);
         if (!status.ok()) {
             if (status.IsNotFound())
                 return false;
@@ -203,12 +322,52 @@ public:
         return true;
     }
 
+    /**
+     * Read the values of many keys at once. Keys are visited in sorted order through one iterator per thread, so keys
+     * that are close together are served from table blocks the iterator already holds, rather than each being looked
+     * up separately.
+     * @param[in]  keys      Keys to read, in any order and possibly repeated.
+     * @param[out] values    Value of each key, in the order of keys.
+     * @param[out] found     Whether each key was found, in the order of keys.
+     * @param[in]  nThreads  Number of threads resolving contiguous runs of the sorted keys.
+     * @return               The number of keys found.
+     */
+    template <typename K, typename V>
+    size_t ReadMany(const std::vector<K> &keys, std::vector<V> &values, std::vector<unsigned char> &found, int nThreads = 1) const
+    {
+        std::vector<std::string> serializedKeys(keys.size());
+        for (size_t i = 0; i < keys.size(); i++) {
+            CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+            ssKey.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
+            ssKey << keys[i];
+            serializedKeys[i].assign(ssKey.begin(), ssKey.end());
+        }
+
+        std::vector<std::string> serializedValues;
+        ReadSerializedMany(serializedKeys, serializedValues, found, nThreads);
+
+        values.resize(keys.size());
+        size_t nFound = 0;
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (!found[i])
+                continue;
+            try {
+                CDataStream ssValue(serializedValues[i].data(), serializedValues[i].data() + serializedValues[i].size(), SER_DISK, CLIENT_VERSION);
+                ssValue >> values[i];
+                nFound++;
+            } catch (const std::exception&) {
+                found[i] = 0;
+            }
+        }
+        return nFound;
+    }
+
     template <typename K, typename V>
     bool Write(const K& key, const V& value, bool fSync = false)
     {
         CDBBatch batch(*this);
         batch.Write(key, value);
-        return WriteBatch(batch, fSync);
+        return CommitBatch(batch, fSync, DBOP_WRITE);
     }
 
     template <typename K>
@@ -220,7 +379,9 @@ public:
         leveldb::Slice slKey(&ssKey[0], ssKey.size());
 
         std::string strValue;
+        int64_t nStart = GetTimeMicros();
         leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+        latency[DBOP_READ].Add(GetTimeMicros() - nStart);
         if (!status.ok()) {
             if (status.IsNotFound())
                 return false;
@@ -235,10 +396,13 @@ public:
     {
         CDBBatch batch(*this);
         batch.Erase(key);
-        return WriteBatch(batch, fSync);
+        return CommitBatch(batch, fSync, DBOP_WRITE);
     }
 
-    bool WriteBatch(CDBBatch& batch, bool fSync = false);
+    bool WriteBatch(CDBBatch& batch, bool fSync = false)
+    {
+        return CommitBatch(batch, fSync, DBOP_BATCH);
+    }
 
     // not available for LevelDB; provide for compatibility with BDB
     bool Flush()
@@ -257,10 +421,40 @@ public:
         return new CDBIterator(*this, pdb->NewIterator(iteroptions));
     }
 
+    /**
+     * Iterator for scans that are repeated often enough to be worth keeping in the block cache, which plain iterators
+     * bypass so that one-off scans of the whole database do not evict everything else.
+     * @param[in] fFillCache  If true, blocks read by the iterator are added to the block cache.
+     */
+    CDBIterator *NewIterator(bool fFillCache);
+
+    /**
+     * Iterator over the database as of a snapshot taken from it, see GetSnapshot.
+     */
+    CDBIterator *NewIterator(const CDBSnapshot &snapshot, bool fFillCache);
+
+    /**
+     * Take a snapshot of the database, for reads that must see one state of it while it is being written.
+     */
+    std::shared_ptr<const CDBSnapshot> GetSnapshot() const
+    {
+        return std::make_shared<const CDBSnapshot>(pdb);
+    }
+
     /**
      * Return true if the database managed by this class contains no entries.
      */
     bool IsEmpty();
+
+    /**
+     * Fill in the LevelDB properties, block cache use and operation latencies of this database.
+     */
+    void GetStats(CDBStats &stats) const;
+
+    /**
+     * Statistics of every database that is currently open, in the order they were opened.
+     */
+    static std::vector<CDBStats> GetAllStats();
 };
 
 #endif // BITCOIN_DBWRAPPER_H
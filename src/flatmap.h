@@ -0,0 +1,200 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_FLATMAP_H
+#define BITCOIN_FLATMAP_H
+
+#include "serialize.h"
+
+#include <algorithm>
+#include <map>
+#include <utility>
+#include <vector>
+
+/** Implements a drop-in replacement for the commonly used subset of std::map<K, V> as a vector of pairs sorted
+ *  by key, which stores up to N elements directly, without heap allocation, and moves them to a heap vector only
+ *  when it grows beyond N.
+ *
+ *  Iteration order and serialization are identical to std::map<K, V>. Unlike std::map, inserting or erasing
+ *  elements invalidates all iterators and references into the map.
+ */
+template<unsigned int N, typename K, typename V>
+class flatmap {
+public:
+    typedef K key_type;
+    typedef V mapped_type;
+    typedef std::pair<K, V> value_type;
+    typedef value_type* iterator;
+    typedef const value_type* const_iterator;
+    typedef size_t size_type;
+
+private:
+    size_type nSize;
+    value_type direct[N];
+    std::vector<value_type> indirect;   // holds all elements, only while there are more than N
+
+    value_type *item_ptr() { return nSize > N ? indirect.data() : direct; }
+    const value_type *item_ptr() const { return nSize > N ? indirect.data() : direct; }
+
+    iterator insert_at(size_type index, const value_type &value)
+    {
+        if (nSize < N)
+        {
+            std::move_backward(direct + index, direct + nSize, direct + nSize + 1);
+            direct[index] = value;
+            nSize++;
+            return direct + index;
+        }
+        if (nSize == N)
+        {
+            indirect.reserve(N << 1);
+            indirect.assign(direct, direct + N);
+        }
+        indirect.insert(indirect.begin() + index, value);
+        nSize++;
+        return indirect.data() + index;
+    }
+
+    iterator erase_at(size_type index)
+    {
+        if (nSize <= N)
+        {
+            std::move(direct + index + 1, direct + nSize, direct + index);
+            nSize--;
+            return direct + index;
+        }
+        indirect.erase(indirect.begin() + index);
+        if (--nSize == N)
+        {
+            std::copy(indirect.begin(), indirect.end(), direct);
+            std::vector<value_type>().swap(indirect);
+        }
+        return item_ptr() + index;
+    }
+
+public:
+    flatmap() : nSize(0) {}
+
+    template<typename Compare, typename Alloc>
+    flatmap(const std::map<K, V, Compare, Alloc> &m) : nSize(0)
+    {
+        for (auto &oneItem : m)
+        {
+            insert_at(nSize, oneItem);
+        }
+    }
+
+    size_type size() const { return nSize; }
+    bool empty() const { return nSize == 0; }
+
+    iterator begin() { return item_ptr(); }
+    const_iterator begin() const { return item_ptr(); }
+    iterator end() { return item_ptr() + nSize; }
+    const_iterator end() const { return item_ptr() + nSize; }
+
+    iterator lower_bound(const K &key)
+    {
+        return std::lower_bound(begin(), end(), key, [](const value_type &a, const K &b) { return a.first < b; });
+    }
+
+    const_iterator lower_bound(const K &key) const
+    {
+        return std::lower_bound(begin(), end(), key, [](const value_type &a, const K &b) { return a.first < b; });
+    }
+
+    iterator find(const K &key)
+    {
+        iterator it = lower_bound(key);
+        return (it != end() && !(key < it->first)) ? it : end();
+    }
+
+    const_iterator find(const K &key) const
+    {
+        const_iterator it = lower_bound(key);
+        return (it != end() && !(key < it->first)) ? it : end();
+    }
+
+    size_type count(const K &key) const
+    {
+        return find(key) != end() ? 1 : 0;
+    }
+
+    V &operator[](const K &key)
+    {
+        iterator it = lower_bound(key);
+        if (it != end() && !(key < it->first))
+        {
+            return it->second;
+        }
+        return insert_at(it - begin(), value_type(key, V()))->second;
+    }
+
+    // like std::map, does not replace the value of an existing key
+    std::pair<iterator, bool> insert(const value_type &value)
+    {
+        iterator it = lower_bound(value.first);
+        if (it != end() && !(value.first < it->first))
+        {
+            return std::make_pair(it, false);
+        }
+        return std::make_pair(insert_at(it - begin(), value), true);
+    }
+
+    iterator erase(const_iterator pos)
+    {
+        return erase_at(pos - begin());
+    }
+
+    size_type erase(const K &key)
+    {
+        const_iterator it = find(key);
+        if (it == end())
+        {
+            return 0;
+        }
+        erase_at(it - begin());
+        return 1;
+    }
+
+    void clear()
+    {
+        nSize = 0;
+        std::vector<value_type>().swap(indirect);
+    }
+
+    bool operator==(const flatmap &other) const
+    {
+        return nSize == other.nSize && std::equal(begin(), end(), other.begin());
+    }
+
+    bool operator!=(const flatmap &other) const
+    {
+        return !(*this == other);
+    }
+
+    template<typename Stream>
+    void Serialize(Stream &s) const
+    {
+        WriteCompactSize(s, nSize);
+        for (const_iterator it = begin(); it != end(); it++)
+        {
+            s << *it;
+        }
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream &s)
+    {
+        clear();
+        unsigned int nCount = ReadCompactSize(s);
+        for (unsigned int i = 0; i < nCount; i++)
+        {
+            value_type item;
+            s >> item;
+            insert(item);
+        }
+    }
+};
+
+#endif // BITCOIN_FLATMAP_H
@@ -0,0 +1,81 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include <gtest/gtest.h>
+
+#include "crypto/blake2b_mb.h"
+#include "hash.h"
+#include "random.h"
+
+#include <vector>
+
+static const unsigned char OTHER_PERSONAL[BLAKE2B_MB_PERSONAL_SIZE] = {'Z','c','a','s','h','_','A','n','c','h','o','r','T','e','s','t'};
+
+static std::vector<unsigned char> WriterHashes(const unsigned char *personal, const unsigned char *in, size_t count)
+{
+    std::vector<unsigned char> out(count * BLAKE2B_MB_OUTPUT_SIZE);
+    for (size_t i = 0; i < count; i++)
+    {
+        CBLAKE2bWriter hw(SER_GETHASH, 0, personal);
+        hw.write((const char *)in + i * BLAKE2B_MB_INPUT_SIZE, BLAKE2B_MB_INPUT_SIZE);
+        uint256 hash = hw.GetHash();
+        std::copy(hash.begin(), hash.end(), out.begin() + i * BLAKE2B_MB_OUTPUT_SIZE);
+    }
+    return out;
+}
+
+// every kernel, at counts that fill no lanes, some lanes, and whole batches of lanes plus a remainder, equals BLAKE2b
+// of each message through CBLAKE2bWriter. kernels wider than the CPU supports fall back to the widest it does
+TEST(blake2b_mb, KernelsMatchWriter)
+{
+    int bestKernel = GetBlake2bMultiBufferKernel();
+    for (int kernel = bestKernel + 1; kernel <= BLAKE2B_MB_KERNEL_AVX512; kernel++)
+    {
+        std::cout << "the " << GetBlake2bMultiBufferKernelName(kernel) << " BLAKE2b kernel is not supported by this CPU, "
+                  << GetBlake2bMultiBufferKernelName(bestKernel) << " is tested in its place" << std::endl;
+    }
+
+    std::vector<size_t> counts;
+    for (size_t count = 0; count <= 25; count++)
+    {
+        counts.push_back(count);
+    }
+    counts.push_back(63);
+    counts.push_back(64);
+    counts.push_back(101);
+
+    for (const unsigned char *personal : {BLAKE2Bpersonal, OTHER_PERSONAL})
+    {
+        for (size_t count : counts)
+        {
+            // one extra byte on each buffer to run the kernels on unaligned input and output as well
+            std::vector<unsigned char> in(count * BLAKE2B_MB_INPUT_SIZE + 1);
+            if (in.size() > 1)
+            {
+                GetRandBytes(in.data(), in.size());
+            }
+
+            for (int offset = 0; offset < 2; offset++)
+            {
+                std::vector<unsigned char> expected = WriterHashes(personal, in.data() + offset, count);
+                for (int kernel = BLAKE2B_MB_KERNEL_PORTABLE; kernel <= BLAKE2B_MB_KERNEL_AVX512; kernel++)
+                {
+                    std::vector<unsigned char> out(count * BLAKE2B_MB_OUTPUT_SIZE + 1, 0);
+                    Blake2b256Personal64(personal, in.data() + offset, out.data() + offset, count, kernel);
+                    EXPECT_TRUE(std::equal(expected.begin(), expected.end(), out.begin() + offset))
+                        << "kernel " << GetBlake2bMultiBufferKernelName(kernel) << ", count " << count << ", offset " << offset;
+                    // nothing outside of the digests may be written
+                    EXPECT_EQ(out[offset ? 0 : out.size() - 1], 0);
+                }
+            }
+        }
+    }
+
+    // the default entry point uses the widest kernel
+    std::vector<unsigned char> in(13 * BLAKE2B_MB_INPUT_SIZE);
+    GetRandBytes(in.data(), in.size());
+    std::vector<unsigned char> out(13 * BLAKE2B_MB_OUTPUT_SIZE);
+    Blake2b256Personal64(BLAKE2Bpersonal, in.data(), out.data(), 13);
+    EXPECT_EQ(out, WriterHashes(BLAKE2Bpersonal, in.data(), 13));
+}
@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+
+#include "arith_uint256.h"
+#include "pbaas/reserves.h"
+#include "random.h"
+
+// the string constructed calculation that CalculateFractionalOut replaced
+static CAmount ReferenceFractionalOut(CAmount NormalizedReserveIn, CAmount Supply, CAmount NormalizedReserve, int32_t reserveRatio)
+{
+    cpp_dec_float_50 one("1");
+    cpp_dec_float_50 bigSatoshi("100000000");
+    cpp_dec_float_50 reservein = cpp_dec_float_50(std::to_string(NormalizedReserveIn)) / bigSatoshi;
+    cpp_dec_float_50 supply = cpp_dec_float_50(std::to_string(Supply ? Supply : 1)) / bigSatoshi;
+    cpp_dec_float_50 reserve = cpp_dec_float_50(std::to_string(NormalizedReserve ? NormalizedReserve : 1)) / bigSatoshi;
+    cpp_dec_float_50 ratio = cpp_dec_float_50(std::to_string(reserveRatio)) / bigSatoshi;
+    int64_t fractionalOut = 0;
+    if (NormalizedReserveIn)
+    {
+        cpp_dec_float_50 supplyout = bigSatoshi * (supply * (pow((reservein / reserve) + one, ratio) - one));
+        if (!CCurrencyState::to_int64(supplyout, fractionalOut))
+        {
+            return -1;
+        }
+    }
+    return fractionalOut;
+}
+
+// the string constructed calculation that CalculateReserveOut replaced
+static CAmount ReferenceReserveOut(CAmount FractionalIn, CAmount Supply, CAmount NormalizedReserve, int32_t reserveRatio)
+{
+    cpp_dec_float_50 one("1");
+    cpp_dec_float_50 bigSatoshi("100000000");
+    cpp_dec_float_50 fractionalin = cpp_dec_float_50(std::to_string(FractionalIn)) / bigSatoshi;
+    cpp_dec_float_50 supply = cpp_dec_float_50(std::to_string(Supply ? Supply : 1)) / bigSatoshi;
+    cpp_dec_float_50 reserve = cpp_dec_float_50(std::to_string(NormalizedReserve ? NormalizedReserve : 1)) / bigSatoshi;
+    cpp_dec_float_50 ratio = cpp_dec_float_50(std::to_string(reserveRatio)) / bigSatoshi;
+    int64_t reserveOut = 0;
+    if (FractionalIn)
+    {
+        cpp_dec_float_50 reserveout = bigSatoshi * (reserve * (one - pow(one - (fractionalin / supply), (one / ratio))));
+        EXPECT_TRUE(CCurrencyState::to_int64(reserveout, reserveOut));
+    }
+    return reserveOut;
+}
+
+static uint64_t RandomOperand()
+{
+    // mix full range values with amounts, weights and satoshi multiples typical of conversions
+    switch (GetRand(4))
+    {
+        case 0:
+            return GetRand(std::numeric_limits<uint64_t>::max());
+        case 1:
+            return (uint64_t)(int64_t)(int32_t)GetRand(std::numeric_limits<uint32_t>::max());
+        case 2:
+            return GetRand(CCurrencyState::MAX_RESERVE_RATIO + 1);
+        default:
+            return GetRand(MAX_MONEY) * SATOSHIDEN / (GetRand(SATOSHIDEN) + 1);
+    }
+}
+
+TEST(ConvertAmounts, MultiplyDivideMatchesArith256)
+{
+    const uint64_t edges[] = {0, 1, 2, SATOSHIDEN, CCurrencyState::MAX_RESERVE_RATIO, (uint64_t)MAX_MONEY,
+                              std::numeric_limits<uint32_t>::max(), std::numeric_limits<int64_t>::max(),
+                              std::numeric_limits<uint64_t>::max()};
+    for (uint64_t a : edges)
+    {
+        for (uint64_t b : edges)
+        {
+            for (uint64_t c : edges)
+            {
+                if (!c)
+                {
+                    EXPECT_THROW(CCurrencyState::MultiplyDivide(a, b, c), uint_error);
+                    continue;
+                }
+                arith_uint256 expected = (arith_uint256(a) * arith_uint256(b)) / arith_uint256(c);
+                unsigned __int128 result = CCurrencyState::MultiplyDivide(a, b, c);
+                EXPECT_EQ(expected.GetLow64(), (uint64_t)result);
+                EXPECT_EQ((expected >> 64).GetLow64(), (uint64_t)(result >> 64));
+            }
+        }
+    }
+
+    for (int i = 0; i < 100000; i++)
+    {
+        uint64_t a = RandomOperand(), b = RandomOperand(), c = RandomOperand() | 1;
+        arith_uint256 expected = (arith_uint256(a) * arith_uint256(b)) / arith_uint256(c);
+        unsigned __int128 result = CCurrencyState::MultiplyDivide(a, b, c);
+        ASSERT_EQ(expected.GetLow64(), (uint64_t)result);
+        ASSERT_EQ((expected >> 64).GetLow64(), (uint64_t)(result >> 64));
+    }
+}
+
+TEST(ConvertAmounts, FormulasMatchReference)
+{
+    for (int i = 0; i < 2000; i++)
+    {
+        CAmount supply = GetRand(MAX_MONEY) + 1;
+        CAmount reserve = GetRand(MAX_MONEY) + 1;
+        int32_t ratio = GetRand(CCurrencyState::MAX_RESERVE_RATIO) + 1;
+        CAmount reserveIn = GetRand(reserve) + 1;
+        CAmount fractionalIn = GetRand(supply) + 1;
+
+        CAmount fractionalOut = ReferenceFractionalOut(reserveIn, supply, reserve, ratio);
+        CAmount reserveOut = ReferenceReserveOut(fractionalIn, supply, reserve, ratio);
+
+        // the second call of each is answered from the cache
+        EXPECT_EQ(fractionalOut, CalculateFractionalOut(reserveIn, supply, reserve, ratio));
+        EXPECT_EQ(fractionalOut, CalculateFractionalOut(reserveIn, supply, reserve, ratio));
+        EXPECT_EQ(reserveOut, CalculateReserveOut(fractionalIn, supply, reserve, ratio));
+        EXPECT_EQ(reserveOut, CalculateReserveOut(fractionalIn, supply, reserve, ratio));
+    }
+    EXPECT_EQ(0, CalculateFractionalOut(0, 1000, 1000, CCurrencyState::MAX_RESERVE_RATIO));
+    EXPECT_EQ(0, CalculateReserveOut(0, 1000, 1000, CCurrencyState::MAX_RESERVE_RATIO));
+}
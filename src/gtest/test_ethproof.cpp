@@ -0,0 +1,107 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include <gtest/gtest.h>
+
+#include "test/data/eth_getproof.json.h"
+
+#include "arith_uint256.h"
+#include "mmr.h"
+#include "streams.h"
+#include "utilstrencodings.h"
+#include "version.h"
+
+#include "json_test_vectors.h"
+
+#include <vector>
+
+#define MAKE_STRING(x) std::string((x), (x)+sizeof(x))
+
+// eth_getProof results are 0x prefixed hex
+static std::vector<unsigned char> HexBytes(const UniValue &hex)
+{
+    return ParseHex(hex.get_str().substr(2));
+}
+
+// hashes and storage keys in the byte order of the proof, with any leading zeros that were left out
+static uint256 HexUint256(const UniValue &hex)
+{
+    std::vector<unsigned char> bytes = HexBytes(hex);
+    bytes.insert(bytes.begin(), 32 - bytes.size(), 0);
+    return uint256(bytes);
+}
+
+static std::vector<std::vector<unsigned char>> HexNodes(const UniValue &nodes)
+{
+    std::vector<std::vector<unsigned char>> result;
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        result.push_back(HexBytes(nodes[i]));
+    }
+    return result;
+}
+
+// the branch a bridge keeper makes of the result of eth_getProof for one storage slot of an account
+static CETHPATRICIABranch BranchFromGetProof(const UniValue &result)
+{
+    CETHPATRICIABranch branch;
+    branch.proofdata.proof_branch = HexNodes(find_value(result, "accountProof"));
+    branch.address = uint160(HexBytes(find_value(result, "address")));
+    arith_uint256 balance;
+    balance.SetHex(find_value(result, "balance").get_str());
+    branch.balance = ArithToUint256(balance);
+    branch.codeHash = HexUint256(find_value(result, "codeHash"));
+    branch.nonce = strtoull(find_value(result, "nonce").get_str().c_str(), nullptr, 16);
+    branch.storageHash = HexUint256(find_value(result, "storageHash"));
+
+    const UniValue &storageProof = find_value(result, "storageProof")[0];
+    branch.storageProofKey = HexUint256(find_value(storageProof, "key"));
+    branch.storageProof.proof_branch = HexNodes(find_value(storageProof, "proof"));
+    return branch;
+}
+
+// each proof is accepted or rejected as the verifier before in place RLP decoding did. every case is checked a second
+// time in the opposite order, after the nodes of the accepted proofs are in the verified trie node cache
+TEST(ethproof, GetProofFixtures)
+{
+    UniValue tests = read_json(MAKE_STRING(json_tests::eth_getproof));
+    std::vector<UniValue> cases;
+    for (size_t i = 0; i < tests.size(); i++)
+    {
+        // comments have a single element
+        if (tests[i].size() > 1)
+        {
+            cases.push_back(tests[i]);
+        }
+    }
+    ASSERT_FALSE(cases.empty());
+
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (size_t n = 0; n < cases.size(); n++)
+        {
+            const UniValue &test = cases[pass ? cases.size() - 1 - n : n];
+            std::string description = test[0].get_str();
+            uint256 exportHash = HexUint256(test[2]);
+            uint256 expectedRoot;
+            if (!test[5].get_str().empty())
+            {
+                expectedRoot = uint256(ParseHex(test[5].get_str()));
+            }
+
+            CETHPATRICIABranch branch = BranchFromGetProof(test[1]);
+            EXPECT_EQ(branch.CheckStorageKeyHash(test[3].get_int()), test[4].get_bool()) << description;
+            EXPECT_EQ(branch.SafeCheck(exportHash), expectedRoot) << description << ", pass " << pass;
+
+            // the same through a serialized proof, as it is checked in an import
+            CMMRProof proof;
+            proof << branch;
+            CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+            ss << proof;
+            CMMRProof readProof;
+            ss >> readProof;
+            EXPECT_EQ(readProof.CheckProof(exportHash), expectedRoot) << description << ", serialized, pass " << pass;
+        }
+    }
+}
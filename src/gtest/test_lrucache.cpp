@@ -0,0 +1,249 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include <gtest/gtest.h>
+
+#include "arith_uint256.h"
+#include "lrucache.h"
+#include "random.h"
+#include "uint256.h"
+
+#include <algorithm>
+#include <atomic>
+#include <list>
+#include <thread>
+#include <vector>
+
+// the value stored for each key by the tests, so any value read can be checked against its key
+static int64_t ValueFor(int key)
+{
+    return (int64_t)key * 7919 + 3;
+}
+
+// a cache that is not thread safe has a single shard, which evicts exactly as one LRU list of its capacity. the
+// oracle keeps that list, most recently used first
+TEST(lrucache, EvictsLeastRecentlyUsed)
+{
+    for (int capacity : {1, 2, 7, 64})
+    {
+        ShardedLRUCache<int, int64_t> cache(capacity);
+        std::list<int> oracle;
+        int nKeys = capacity * 3 + 2;
+        for (int i = 0; i < 4000; i++)
+        {
+            int key = GetRand(nKeys);
+            auto it = std::find(oracle.begin(), oracle.end(), key);
+            if (GetRand(3))
+            {
+                cache.Put(key, ValueFor(key));
+                if (it != oracle.end())
+                {
+                    oracle.erase(it);
+                }
+                oracle.push_front(key);
+                if (oracle.size() > capacity)
+                {
+                    oracle.pop_back();
+                }
+            }
+            else
+            {
+                int64_t value = 0;
+                bool found = cache.Get(key, value);
+                ASSERT_EQ(found, it != oracle.end()) << "key " << key << ", capacity " << capacity;
+                if (found)
+                {
+                    EXPECT_EQ(value, ValueFor(key));
+                    oracle.splice(oracle.begin(), oracle, it);
+                }
+            }
+            ASSERT_EQ(cache.size(), oracle.size());
+        }
+
+        for (int key = 0; key < nKeys; key++)
+        {
+            EXPECT_EQ(cache.count(key), std::count(oracle.begin(), oracle.end(), key)) << "key " << key;
+        }
+    }
+}
+
+TEST(lrucache, PutReplacesAndTouches)
+{
+    ShardedLRUCache<uint256, int> cache(3);
+    std::vector<uint256> keys;
+    for (int i = 0; i < 4; i++)
+    {
+        keys.push_back(GetRandHash());
+    }
+    cache.Put(keys[0], 0);
+    cache.Put(keys[1], 1);
+    cache.Put(keys[2], 2);
+
+    // replacing the value of the oldest makes it the newest, so the next oldest is evicted
+    cache.Put(keys[0], 10);
+    cache.Put(keys[3], 3);
+    EXPECT_EQ(cache.size(), 3);
+    EXPECT_EQ(cache.Get(keys[0]), 10);
+    EXPECT_EQ(cache.count(keys[1]), 0);
+    EXPECT_EQ(cache.Get(keys[2]), 2);
+    EXPECT_EQ(cache.Get(keys[3]), 3);
+
+    int value = -1;
+    EXPECT_FALSE(cache.Get(keys[1], value));
+    EXPECT_EQ(value, -1);
+
+    uint64_t hits, misses, evictions;
+    cache.GetStats(hits, misses, evictions);
+    EXPECT_EQ(hits, 3);
+    EXPECT_EQ(misses, 1);
+    EXPECT_EQ(evictions, 1);
+}
+
+TEST(lrucache, EraseAndClear)
+{
+    ShardedLRUCache<int, int64_t> cache(1000, 0, true);
+    for (int key = 0; key < 500; key++)
+    {
+        cache.Put(key, ValueFor(key));
+    }
+    ASSERT_EQ(cache.size(), 500);
+
+    for (int key = 0; key < 500; key += 3)
+    {
+        EXPECT_TRUE(cache.Erase(key));
+        EXPECT_FALSE(cache.Erase(key));
+    }
+    EXPECT_FALSE(cache.Erase(500));
+    EXPECT_EQ(cache.size(), 500 - 167);
+    for (int key = 0; key < 500; key++)
+    {
+        int64_t value = 0;
+        EXPECT_EQ(cache.Get(key, value), key % 3 != 0) << "key " << key;
+        EXPECT_EQ(value, key % 3 ? ValueFor(key) : 0);
+    }
+
+    cache.Clear();
+    EXPECT_EQ(cache.size(), 0);
+    for (int key = 0; key < 500; key++)
+    {
+        EXPECT_EQ(cache.count(key), 0);
+    }
+
+    // the cache is as usable after it is cleared as when it was new
+    for (int key = 0; key < 2000; key++)
+    {
+        cache.Put(key, ValueFor(key));
+    }
+    EXPECT_EQ(cache.Get(1999), ValueFor(1999));
+    EXPECT_TRUE(cache.Erase(1999));
+    EXPECT_EQ(cache.count(1999), 0);
+}
+
+// the capacity is divided among the shards of a thread safe cache, so it holds no more than each shard's share of it
+// rounded up, and an entry that is used after each new one is added is never the one evicted
+TEST(lrucache, ShardedCapacity)
+{
+    for (int capacity : {100, 1000, 5000})
+    {
+        ShardedLRUCache<int, int64_t> cache(capacity, 0, true);
+        EXPECT_EQ(cache.capacity(), capacity);
+        const int hot = -1;
+        cache.Put(hot, ValueFor(hot));
+        for (int key = 0; key < capacity * 4; key++)
+        {
+            cache.Put(key, ValueFor(key));
+            ASSERT_EQ(cache.Get(hot), ValueFor(hot)) << "after key " << key << ", capacity " << capacity;
+            ASSERT_EQ(cache.count(key), 1);
+        }
+        EXPECT_LE(cache.size(), capacity + 15);
+        EXPECT_GE(cache.size(), capacity * 3 / 4);
+
+        // the most recent entries are the last evicted
+        for (int key = capacity * 4 - 8; key < capacity * 4; key++)
+        {
+            EXPECT_EQ(cache.count(key), 1);
+        }
+
+        cache.SetCapacity(capacity / 10);
+        EXPECT_EQ(cache.capacity(), capacity / 10);
+        EXPECT_LE(cache.size(), capacity / 10 + 15);
+        EXPECT_EQ(cache.Get(hot), ValueFor(hot));
+
+        uint64_t hits, misses, evictions;
+        cache.GetStats(hits, misses, evictions);
+        EXPECT_EQ(evictions, capacity * 4 + 1 - cache.size());
+    }
+}
+
+// threads that put, get, erase and clear the same keys at once never see a value that was not stored for its key, and
+// the cache stays within its capacity
+TEST(lrucache, ConcurrentGetPut)
+{
+    const int capacity = 4096, nKeys = 6000, nThreads = 8;
+    ShardedLRUCache<uint256, int64_t> cache(capacity, 0, true);
+    std::vector<uint256> keys;
+    for (int i = 0; i < nKeys; i++)
+    {
+        keys.push_back(ArithToUint256(arith_uint256(i) * 1000003));
+    }
+
+    std::atomic<int> nMismatches(0), nHits(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nThreads; t++)
+    {
+        threads.push_back(std::thread([&, t]()
+        {
+            uint32_t state = t * 2654435761u + 1;
+            for (int i = 0; i < 40000; i++)
+            {
+                state = state * 1664525 + 1013904223;
+                int key = (state >> 8) % nKeys;
+                int64_t value;
+                if (t == 0 && i % 5000 == 4999)
+                {
+                    cache.Clear();
+                }
+                switch ((state >> 4) % 16)
+                {
+                    case 0:
+                        cache.Erase(keys[key]);
+                        break;
+                    case 1: case 2: case 3: case 4: case 5:
+                        cache.Put(keys[key], ValueFor(key));
+                        break;
+                    default:
+                        if (cache.Get(keys[key], value))
+                        {
+                            nHits++;
+                            if (value != ValueFor(key))
+                            {
+                                nMismatches++;
+                            }
+                        }
+                        break;
+                }
+            }
+        }));
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    EXPECT_EQ(nMismatches.load(), 0);
+    EXPECT_GT(nHits.load(), 0);
+    EXPECT_LE(cache.size(), capacity + 15);
+
+    uint64_t hits, misses, evictions;
+    cache.GetStats(hits, misses, evictions);
+    EXPECT_EQ(hits, (uint64_t)nHits.load());
+    for (int key = 0; key < nKeys; key++)
+    {
+        int64_t value;
+        if (cache.Get(keys[key], value))
+        {
+            EXPECT_EQ(value, ValueFor(key));
+        }
+    }
+}
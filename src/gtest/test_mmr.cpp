@@ -0,0 +1,268 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include <gtest/gtest.h>
+
+#include "arith_uint256.h"
+#include "mmr.h"
+#include "random.h"
+#include "streams.h"
+#include "utilstrencodings.h"
+#include "version.h"
+
+#include <algorithm>
+#include <vector>
+
+// small chunks, so that the layers of the test ranges span several of them
+typedef CMerkleMountainRange<CDefaultMMRNode, CChunkedLayer<CDefaultMMRNode, 3>> TestMMR;
+typedef CMerkleMountainView<CDefaultMMRNode, CChunkedLayer<CDefaultMMRNode, 3>> TestMMView;
+typedef CMerkleMountainRange<CDefaultMMRPowerNode, CChunkedLayer<CDefaultMMRPowerNode, 3>> TestPowerMMR;
+typedef CMerkleMountainView<CDefaultMMRPowerNode, CChunkedLayer<CDefaultMMRPowerNode, 3>> TestPowerMMView;
+
+// the hash that a proof of each leaf is checked with is returned in checkHashes
+static std::vector<CDefaultMMRNode> RandomNodes(size_t count, std::vector<uint256> &checkHashes)
+{
+    std::vector<CDefaultMMRNode> nodes;
+    checkHashes.clear();
+    for (size_t i = 0; i < count; i++)
+    {
+        nodes.push_back(CDefaultMMRNode(GetRandHash()));
+        checkHashes.push_back(nodes.back().hash);
+    }
+    return nodes;
+}
+
+static std::vector<CDefaultMMRNode> RandomNodes(size_t count)
+{
+    std::vector<uint256> checkHashes;
+    return RandomNodes(count, checkHashes);
+}
+
+// leaves are made the way a block's node of the chain MMR is, hashing the power of the leaf with the hash it is proven by
+static std::vector<CDefaultMMRPowerNode> RandomPowerNodes(size_t count, std::vector<uint256> &checkHashes)
+{
+    // work and stake are each in the low 128 bits of their half of the power, and their sums must not overflow it
+    std::vector<CDefaultMMRPowerNode> nodes;
+    checkHashes.clear();
+    for (size_t i = 0; i < count; i++)
+    {
+        arith_uint256 work(GetRand(1000000000) + 1), stake(GetRand(1000000000));
+        uint256 power = ArithToUint256(stake << 128 | work);
+        checkHashes.push_back(GetRandHash());
+        nodes.push_back(CDefaultMMRPowerNode(CDefaultMMRPowerNode::HashObj(checkHashes.back(), power), power));
+    }
+    return nodes;
+}
+
+static std::vector<CDefaultMMRPowerNode> RandomPowerNodes(size_t count)
+{
+    std::vector<uint256> checkHashes;
+    return RandomPowerNodes(count, checkHashes);
+}
+
+static std::string ProofHex(const CMMRProof &proof)
+{
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << proof;
+    return HexStr(ss.begin(), ss.end());
+}
+
+template <typename NODE_TYPE>
+static void ExpectSameParents(const std::vector<NODE_TYPE> &children)
+{
+    size_t count = children.size() >> 1;
+    std::vector<NODE_TYPE> parents(count);
+    NODE_TYPE::CreateParentNodes(children.data(), count, parents.data());
+    for (size_t i = 0; i < count; i++)
+    {
+        NODE_TYPE expected = children[i << 1].CreateParentNode(children[(i << 1) + 1]);
+        EXPECT_EQ(parents[i].hash, expected.hash) << "parent " << i << " of " << count;
+    }
+}
+
+TEST(mmr, CreateParentNodesMatchesCreateParentNode)
+{
+    for (size_t count : {0, 1, 2, 3, 4, 5, 7, 8, 9, 16, 17, 33})
+    {
+        ExpectSameParents(RandomNodes(count << 1));
+        std::vector<CDefaultMMRPowerNode> powerChildren = RandomPowerNodes(count << 1);
+        ExpectSameParents(powerChildren);
+
+        std::vector<CDefaultMMRPowerNode> parents(count);
+        CDefaultMMRPowerNode::CreateParentNodes(powerChildren.data(), count, parents.data());
+        for (size_t i = 0; i < count; i++)
+        {
+            EXPECT_EQ(parents[i].power, powerChildren[i << 1].CreateParentNode(powerChildren[(i << 1) + 1]).power);
+        }
+    }
+}
+
+// builds the same leaves one at a time, in bulk batches of varied sizes, and by extending layer0 and adding the parents
+// afterwards, then compares the roots and proofs of each at every size
+template <typename MMR_TYPE, typename VIEW_TYPE, typename NODE_TYPE>
+static void ExpectBulkMatchesSingle(const std::vector<NODE_TYPE> &leaves, const std::vector<uint256> &checkHashes)
+{
+    MMR_TYPE single, bulk, deferred;
+    for (auto &leaf : leaves)
+    {
+        single.Add(leaf);
+    }
+
+    static const size_t batchSizes[] = {1, 2, 3, 5, 8, 13, 64, 129, 300};
+    for (size_t i = 0, batch = 0; i < leaves.size(); batch++)
+    {
+        size_t count = std::min(batchSizes[batch % (sizeof(batchSizes) / sizeof(batchSizes[0]))], leaves.size() - i);
+        bulk.Add(std::vector<NODE_TYPE>(leaves.begin() + i, leaves.begin() + i + count));
+        i += count;
+    }
+
+    for (auto &leaf : leaves)
+    {
+        deferred.layer0.push_back(leaf);
+    }
+    deferred.AddParentNodes();
+
+    ASSERT_EQ(bulk.size(), single.size());
+    ASSERT_EQ(deferred.size(), single.size());
+    ASSERT_EQ(bulk.height(), single.height());
+    ASSERT_EQ(deferred.height(), single.height());
+
+    for (uint64_t size = 1; size <= leaves.size(); size += (size < 70 ? 1 : 37))
+    {
+        VIEW_TYPE singleView(single, size), bulkView(bulk, size), deferredView(deferred, size);
+        uint256 root = singleView.GetRoot();
+        EXPECT_EQ(bulkView.GetRoot(), root) << "size " << size;
+        EXPECT_EQ(deferredView.GetRoot(), root) << "size " << size;
+
+        for (uint64_t pos : {(uint64_t)0, size >> 1, size - 1})
+        {
+            CMMRProof singleProof, bulkProof;
+            ASSERT_TRUE(singleView.GetProof(singleProof, pos));
+            ASSERT_TRUE(bulkView.GetProof(bulkProof, pos));
+            EXPECT_EQ(ProofHex(bulkProof), ProofHex(singleProof)) << "size " << size << ", pos " << pos;
+            EXPECT_EQ(bulkProof.CheckProof(checkHashes[pos]), root) << "size " << size << ", pos " << pos;
+        }
+    }
+}
+
+TEST(mmr, BulkAddMatchesSingleAdd)
+{
+    std::vector<uint256> checkHashes;
+    std::vector<CDefaultMMRNode> leaves = RandomNodes(777, checkHashes);
+    ExpectBulkMatchesSingle<TestMMR, TestMMView>(leaves, checkHashes);
+    std::vector<CDefaultMMRPowerNode> powerLeaves = RandomPowerNodes(777, checkHashes);
+    ExpectBulkMatchesSingle<TestPowerMMR, TestPowerMMView>(powerLeaves, checkHashes);
+}
+
+// checks a proof of the leaves at positions of a view, and that it fails with them reordered, with one missing or
+// changed, and with any hash of its branch changed, added or removed
+template <typename VIEW_TYPE, typename BRANCH_TYPE>
+static void ExpectMultiLeafProof(VIEW_TYPE &view, const std::vector<uint256> &checkHashes, std::vector<uint64_t> positions)
+{
+    uint256 root = view.GetRoot();
+    CMMRProof proof;
+    ASSERT_TRUE(view.GetMultiLeafProof(proof, positions)) << "size " << view.size();
+
+    // leaves are proven in ascending order of their positions, without repeats
+    std::sort(positions.begin(), positions.end());
+    positions.erase(std::unique(positions.begin(), positions.end()), positions.end());
+    std::vector<uint256> leafHashes;
+    for (auto pos : positions)
+    {
+        leafHashes.push_back(checkHashes[pos]);
+    }
+    EXPECT_EQ(proof.CheckMultiLeafProof(leafHashes), root) << "size " << view.size() << ", " << positions.size() << " leaves from " << positions[0];
+
+    // a multi leaf proof does not prove a single hash
+    EXPECT_TRUE(proof.CheckProof(leafHashes[0]).IsNull());
+
+    if (leafHashes.size() > 1)
+    {
+        std::vector<uint256> reordered(leafHashes);
+        std::swap(reordered.front(), reordered.back());
+        EXPECT_NE(proof.CheckMultiLeafProof(reordered), root) << "reordered leaves, size " << view.size();
+
+        std::vector<uint256> missing(leafHashes.begin(), leafHashes.end() - 1);
+        EXPECT_NE(proof.CheckMultiLeafProof(missing), root) << "missing leaf, size " << view.size();
+    }
+
+    for (size_t i = 0; i < leafHashes.size(); i += std::max((size_t)1, leafHashes.size() >> 1))
+    {
+        std::vector<uint256> tampered(leafHashes);
+        *tampered[i].begin() ^= 1;
+        EXPECT_NE(proof.CheckMultiLeafProof(tampered), root) << "tampered leaf " << i << ", size " << view.size();
+    }
+
+    // each hash of the branch is needed, so a change to any of them, or one too many or too few, fails the proof
+    ASSERT_EQ(proof.proofSequence.size(), 1);
+    const BRANCH_TYPE &multiBranch = *(const BRANCH_TYPE *)proof.proofSequence[0];
+    EXPECT_EQ(std::vector<uint64_t>(multiBranch.nIndexes.begin(), multiBranch.nIndexes.end()), positions);
+    for (size_t i = 0; i <= multiBranch.branch.size(); i++)
+    {
+        BRANCH_TYPE tampered(multiBranch);
+        if (i < tampered.branch.size())
+        {
+            *tampered.branch[i].begin() ^= 0x80;
+        }
+        else
+        {
+            tampered.branch.push_back(GetRandHash());
+        }
+        EXPECT_NE(tampered.SafeCheck(leafHashes), root) << "tampered branch hash " << i << ", size " << view.size();
+        if (i < multiBranch.branch.size())
+        {
+            BRANCH_TYPE truncated(multiBranch);
+            truncated.branch.resize(i);
+            EXPECT_TRUE(truncated.SafeCheck(leafHashes).IsNull()) << "truncated branch, size " << view.size();
+        }
+    }
+}
+
+TEST(mmr, MultiLeafProof)
+{
+    std::vector<uint256> checkHashes, powerCheckHashes;
+    TestMMR mmr;
+    mmr.Add(RandomNodes(301, checkHashes));
+    TestPowerMMR powerMMR;
+    powerMMR.Add(RandomPowerNodes(301, powerCheckHashes));
+
+    // odd sizes, which have several peaks, and sizes of whole mountains
+    for (uint64_t size : {1, 2, 3, 7, 8, 13, 64, 99, 257, 301})
+    {
+        std::vector<std::vector<uint64_t>> positionSets = {
+            {0},
+            {size - 1},
+            {0, size - 1},
+            {size >> 1, size >> 2, size - 1, 0},
+            {size >> 1, size >> 1},     // repeats are proven once
+        };
+        std::vector<uint64_t> every, evens;
+        for (uint64_t pos = 0; pos < size; pos++)
+        {
+            if (pos < 40)
+            {
+                every.push_back(pos);
+            }
+            if (!(pos & 1))
+            {
+                evens.push_back(pos);
+            }
+        }
+        positionSets.push_back(every);
+        positionSets.push_back(evens);
+
+        TestMMView view(mmr, size);
+        TestPowerMMView powerView(powerMMR, size);
+        for (auto &positions : positionSets)
+        {
+            ExpectMultiLeafProof<TestMMView, CMMRNodeMultiBranch>(view, checkHashes, positions);
+            ExpectMultiLeafProof<TestPowerMMView, CMMRPowerNodeMultiBranch>(powerView, powerCheckHashes, positions);
+        }
+
+        // positions outside of the view can't be proven
+        CMMRProof proof;
+        EXPECT_FALSE(view.GetMultiLeafProof(proof, {size}));
+        EXPECT_FALSE(view.GetMultiLeafProof(proof, {}));
+    }
+}
@@ -0,0 +1,280 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include <gtest/gtest.h>
+
+#include "arith_uint256.h"
+#include "crypto/verus_hash.h"
+#include "hash.h"
+#include "primitives/block.h"
+#include "random.h"
+#include "utilstrencodings.h"
+
+#include <cstring>
+#include <limits>
+#include <vector>
+
+bool mine_verus_v2(CBlockHeader &bh, CVerusHashV2bWriter &vhw, uint256 &finalHash, uint256 &target, uint64_t start, uint64_t *count);
+bool mine_verus_v2_4x(CBlockHeader &bh, CVerusHashV2bWriter &vhw, uint256 &finalHash, uint256 &target, uint64_t start, uint64_t *count);
+bool mine_verus_v2_8x(CBlockHeader &bh, CVerusHashV2bWriter &vhw, uint256 &finalHash, uint256 &target, uint64_t start, uint64_t *count);
+
+// data that leaves the 15 bytes a block header leaves in the last buffer, so the nonce fits before the fill
+static std::vector<unsigned char> LaneTestData()
+{
+    std::vector<unsigned char> data(32 * 3 + 15);
+    GetRandBytes(data.data(), data.size());
+    return data;
+}
+
+static uint256 SerialHash(const std::vector<unsigned char> &data, int64_t nonce)
+{
+    CVerusHashV2 vh(SOLUTION_VERUSHHASH_V2_2);
+    vh.Reset();
+    vh.Write(data.data(), data.size());
+    *vh.ExtraI64Ptr() = nonce;
+    uint256 hash;
+    vh.Finalize2b(hash.begin());
+    return hash;
+}
+
+// every lane count, including the 4 and 8 that use the multi-lane kernels when the CPU has them, equals finalizing
+// each nonce on its own
+TEST(verushash, Finalize2bLanesMatchesSerial)
+{
+    CVerusHash::init();
+    CVerusHashV2::init();
+    std::cout << "multi-lane VerusHash kernel: " << GetVerusCLHashKernelName() << std::endl;
+
+    for (int round = 0; round < 4; round++)
+    {
+        std::vector<unsigned char> data = LaneTestData();
+        for (int nLanes = 1; nLanes <= VERUSHASH_MAX_LANES; nLanes++)
+        {
+            std::vector<int64_t> nonces(nLanes);
+            for (int l = 0; l < nLanes; l++)
+            {
+                nonces[l] = round ? (int64_t)GetRand(std::numeric_limits<int64_t>::max()) : l;
+            }
+
+            CVerusHashV2 vh(SOLUTION_VERUSHHASH_V2_2);
+            vh.Reset();
+            vh.Write(data.data(), data.size());
+            unsigned char hashes[VERUSHASH_MAX_LANES][32];
+            vh.Finalize2bLanes(hashes, nonces.data(), nLanes);
+
+            for (int l = 0; l < nLanes; l++)
+            {
+                EXPECT_EQ(uint256(std::vector<unsigned char>(hashes[l], hashes[l] + 32)), SerialHash(data, nonces[l]))
+                    << "lane " << l << " of " << nLanes << ", round " << round;
+            }
+
+            // the state is not changed, so the same lanes hash the same again
+            unsigned char again[VERUSHASH_MAX_LANES][32];
+            vh.Finalize2bLanes(again, nonces.data(), nLanes);
+            EXPECT_EQ(0, memcmp(hashes, again, nLanes * 32));
+        }
+    }
+}
+
+// the 4 and 8 lane nonce sweeps of the miner find the same nonce and hash as the single lane sweep, whichever lane
+// the winning nonce falls in
+TEST(verushash, MinerLaneSweepsMatchSerial)
+{
+    CVerusHash::init();
+    CVerusHashV2::init();
+    if (!IsCPUVerusOptimized())
+    {
+        std::cout << "skipping multi-lane miner test, the CPU does not support optimized VerusHash" << std::endl;
+        return;
+    }
+
+    CBlockHeader bh;
+    bh.nVersion = CBlockHeader::VERUS_V2;
+    bh.hashPrevBlock = GetRandHash();
+    bh.hashMerkleRoot = GetRandHash();
+    bh.nTime = 1700000000;
+    bh.nBits = 0x200f0f0f;
+    bh.nSolution.resize(1344);
+    GetRandBytes(bh.nSolution.data(), bh.nSolution.size());
+
+    const uint64_t nHashes = 64;
+    std::vector<uint256> serialHashes(nHashes);
+    uint256 maxTarget;
+    memset(maxTarget.begin(), 0xff, maxTarget.size());
+    for (uint64_t i = 0; i < nHashes; i++)
+    {
+        CBlockHeader serialHeader(bh);
+        CVerusHashV2bWriter vhw(SER_GETHASH, PROTOCOL_VERSION, SOLUTION_VERUSHHASH_V2_2);
+        uint64_t count = 1;
+        ASSERT_TRUE(mine_verus_v2(serialHeader, vhw, serialHashes[i], maxTarget, i, &count));
+    }
+
+    for (int nLanes : {VERUSHASH_LANES_4X, VERUSHASH_LANES_8X})
+    {
+        for (uint64_t start = 0; start + nLanes <= nHashes; start += 3)
+        {
+            // the lowest hash of the sweep is the only one at or below it, so it is the winner
+            uint64_t best = start;
+            for (uint64_t i = start; i < start + nLanes; i++)
+            {
+                if (UintToArith256(serialHashes[i]) < UintToArith256(serialHashes[best]))
+                {
+                    best = i;
+                }
+            }
+            uint256 target = serialHashes[best];
+
+            CBlockHeader laneHeader(bh);
+            CVerusHashV2bWriter vhw(SER_GETHASH, PROTOCOL_VERSION, SOLUTION_VERUSHHASH_V2_2);
+            uint256 laneHash;
+            uint64_t count = nLanes;
+            bool found = nLanes == VERUSHASH_LANES_4X ?
+                            mine_verus_v2_4x(laneHeader, vhw, laneHash, target, start, &count) :
+                            mine_verus_v2_8x(laneHeader, vhw, laneHash, target, start, &count);
+            ASSERT_TRUE(found) << nLanes << " lanes from " << start;
+            EXPECT_EQ(laneHash, serialHashes[best]) << nLanes << " lanes from " << start;
+            EXPECT_EQ(count, best - start + 1) << nLanes << " lanes from " << start;
+        }
+    }
+}
+
+#if !defined(__arm__) && !defined(__aarch64__)
+void haraka512_keyed_4x_vaes256(unsigned char **out, unsigned char **in, const u128 **prc);
+void haraka512_keyed_8x_vaes256(unsigned char **out, unsigned char **in, const u128 **prc);
+void haraka512_keyed_4x_vaes512(unsigned char **out, unsigned char **in, const u128 **prc);
+void haraka512_keyed_8x_vaes512(unsigned char **out, unsigned char **in, const u128 **prc);
+#endif
+
+// with the Haraka v2 round constants as its key, keyed Haraka512 is Haraka512, whose reference test vector hashes
+// the bytes 0 to 63. the VAES lane kernels, each lane with its own key, match the AES-NI and portable implementations
+TEST(verushash, HarakaKeyedKernelsKnownAnswers)
+{
+    CVerusHash::init();
+    CVerusHashV2::init();
+    if (!IsCPUVerusOptimized())
+    {
+        std::cout << "skipping Haraka kernel test, the CPU does not support AES-NI" << std::endl;
+        return;
+    }
+    load_constants();
+
+    alignas(32) unsigned char in[64];
+    for (int i = 0; i < 64; i++)
+    {
+        in[i] = i;
+    }
+    unsigned char out[32], portOut[32];
+    haraka512_keyed(out, in, rc);
+    haraka512_port_keyed(portOut, in, rc);
+    EXPECT_EQ(HexStr(out, out + 32), "be7f723b4e80a99813b292287f306f625a6d57331cae5f34dd9277b0945be2aa");
+    EXPECT_EQ(HexStr(portOut, portOut + 32), HexStr(out, out + 32));
+
+    typedef void (*lanes_fn)(unsigned char **out, unsigned char **in, const u128 **prc);
+    std::vector<std::pair<std::string, lanes_fn>> kernels;
+#if !defined(__arm__) && !defined(__aarch64__)
+    if (GetVerusCLHashKernel() >= VERUSCLHASH_KERNEL_VAES_AVX2)
+    {
+        kernels.push_back({"vaes-avx2-4x", &haraka512_keyed_4x_vaes256});
+        kernels.push_back({"vaes-avx2-8x", &haraka512_keyed_8x_vaes256});
+    }
+    if (GetVerusCLHashKernel() >= VERUSCLHASH_KERNEL_VAES_AVX512)
+    {
+        kernels.push_back({"vaes-avx512-4x", &haraka512_keyed_4x_vaes512});
+        kernels.push_back({"vaes-avx512-8x", &haraka512_keyed_8x_vaes512});
+    }
+#endif
+    if (kernels.empty())
+    {
+        std::cout << "skipping Haraka VAES kernels, the CPU does not support them" << std::endl;
+    }
+
+    for (int round = 0; round < 8; round++)
+    {
+        // lane keys overlap at different offsets, as the final keys of VerusHash lanes are offsets into their keys
+        alignas(32) unsigned char laneIn[VERUSHASH_MAX_LANES][64];
+        alignas(32) u128 keys[VERUSHASH_MAX_LANES + 40];
+        GetRandBytes((unsigned char *)laneIn, sizeof(laneIn));
+        GetRandBytes((unsigned char *)keys, sizeof(keys));
+
+        unsigned char *pIn[VERUSHASH_MAX_LANES];
+        const u128 *prc[VERUSHASH_MAX_LANES];
+        unsigned char expected[VERUSHASH_MAX_LANES][32];
+        for (int l = 0; l < VERUSHASH_MAX_LANES; l++)
+        {
+            pIn[l] = laneIn[l];
+            prc[l] = keys + ((l * 5 + round) % VERUSHASH_MAX_LANES);
+            haraka512_port_keyed(expected[l], laneIn[l], prc[l]);
+            haraka512_keyed(out, laneIn[l], prc[l]);
+            EXPECT_EQ(0, memcmp(out, expected[l], 32)) << "haraka512_keyed, lane " << l;
+        }
+
+        for (auto &kernel : kernels)
+        {
+            int nLanes = kernel.first.back() == '8' ? VERUSHASH_LANES_8X : VERUSHASH_LANES_4X;
+            unsigned char laneOut[VERUSHASH_MAX_LANES][32];
+            unsigned char *pOut[VERUSHASH_MAX_LANES];
+            for (int l = 0; l < VERUSHASH_MAX_LANES; l++)
+            {
+                pOut[l] = laneOut[l];
+            }
+            (*kernel.second)(pOut, pIn, prc);
+            for (int l = 0; l < nLanes; l++)
+            {
+                EXPECT_EQ(0, memcmp(laneOut[l], expected[l], 32)) << kernel.first << ", lane " << l << ", round " << round;
+            }
+        }
+    }
+}
+
+// the key of a seed is the same whether it was just generated or restored after hashes that mutated it, however many
+// hashes ran in between, and refreshing it without a hash in between leaves it as it is
+TEST(verushash, GenNewCLKeyRestoresKey)
+{
+    CVerusHash::init();
+    CVerusHashV2::init();
+    CVerusHashV2 vh(SOLUTION_VERUSHHASH_V2_2);
+    int size = ((verusclhash_descr *)verusclhasher_descr.get())->keySizeInBytes;
+    int refreshsize = verusclhasher::keymask(size) + 1;
+
+    alignas(32) unsigned char seed[32], otherSeed[32];
+    for (int i = 0; i < 32; i++)
+    {
+        seed[i] = i;
+        otherSeed[i] = 0xff - i;
+    }
+
+    // a new key for each seed, so the key of the seed is generated rather than restored
+    CVerusHashV2::GenNewCLKey(otherSeed);
+    unsigned char *key = (unsigned char *)CVerusHashV2::GenNewCLKey(seed);
+    std::vector<unsigned char> fresh(key, key + size);
+    EXPECT_EQ(Hash(fresh.begin(), fresh.end()).GetHex(), "72b21af3717ee639c0b0b2eb9b839c5e86e519c85b1cc0f194a362b28b92a1c3");
+
+    for (int round = 0; round < 64; round++)
+    {
+        // only the first 32 bytes of the buffer are the seed, the rest differs for each hash as the nonce does
+        alignas(32) unsigned char buf[64];
+        memcpy(buf, seed, 32);
+        GetRandBytes(buf + 32, 32);
+        for (int i = 0; i <= round % 3; i++)
+        {
+            vh.vclh(buf, key);
+            key = (unsigned char *)CVerusHashV2::GenNewCLKey(seed);
+        }
+        ASSERT_EQ(0, memcmp(key, fresh.data(), size)) << "round " << round;
+
+        // the copy that mutated entries are restored from is not changed either
+        ASSERT_EQ(0, memcmp(key + size, fresh.data(), refreshsize)) << "round " << round;
+
+        key = (unsigned char *)CVerusHashV2::GenNewCLKey(seed);
+        ASSERT_EQ(0, memcmp(key, fresh.data(), size)) << "refresh without a hash, round " << round;
+    }
+
+    // a key regenerated after another seed is the same as well
+    alignas(32) unsigned char buf[64] = {0};
+    memcpy(buf, seed, 32);
+    vh.vclh(buf, key);
+    CVerusHashV2::GenNewCLKey(otherSeed);
+    key = (unsigned char *)CVerusHashV2::GenNewCLKey(seed);
+    EXPECT_EQ(0, memcmp(key, fresh.data(), size));
+}
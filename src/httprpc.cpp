@@ -1,8 +1,12 @@
 #include "httprpc.h"
 
+#include "cc/eval.h"
 #include "chainparams.h"
 #include "httpserver.h"
 #include "key_io.h"
+#include "main.h"
+#include "metrics.h"
+#include "rpc/jsonstream.h"
 #include "rpc/protocol.h"
 #include "rpc/server.h"
 #include "random.h"
@@ -87,6 +91,89 @@ static bool RPCAuthorized(const std::string& strAuth)
     return TimingResistantEqual(strUserPass, strRPCUserColonPass);
 }
 
+/** Cache headers for a result bound to a block deep below the tip, whose ETag changes only if that block is reorganized */
+static void WriteCacheHeaders(HTTPRequest* req, const std::string& strETag)
+{
+    req->WriteHeader("ETag", strETag);
+    // confirmations still change with each block for a result with a weak tag
+    if (boost::starts_with(strETag, "W/"))
+        req->WriteHeader("Cache-Control", "no-cache");
+    else
+        req->WriteHeader("Cache-Control", "public, max-age=31536000, immutable");
+}
+
+/** Reply with a cached result, or without one if the client already has it */
+static bool JSONRPCCachedReply(HTTPRequest* req, const JSONRequest& jreq, const CRPCCachedResult& cached)
+{
+    WriteCacheHeaders(req, cached.strETag);
+    std::pair<bool, std::string> ifNoneMatch = req->GetHeader("if-none-match");
+    if (ifNoneMatch.first && boost::trim_copy(ifNoneMatch.second) == cached.strETag) {
+        req->WriteReply(HTTP_NOT_MODIFIED);
+        return true;
+    }
+
+    req->WriteHeader("Content-Type", "application/json");
+    req->WriteReply(HTTP_OK, "{\"result\":" + cached.strResult + ",\"error\":null,\"id\":" + jreq.id.write() + "}\n");
+    return true;
+}
+
+/**
+ * Reply to a single request for a method with a streaming form. A result that fits in one chunk is sent as a plain
+ * reply, a larger one as a chunked reply while it is written. An error after part of that is sent can only cut it short.
+ */
+static bool JSONRPCStreamingReply(HTTPRequest* req, const JSONRequest& jreq)
+{
+    bool fStarted = false;
+    CJSONStreamWriter out([req, &fStarted](const std::string& chunk)
+    {
+        if (!fStarted) {
+            req->WriteHeader("Content-Type", "application/json");
+            req->WriteReplyStart(HTTP_OK);
+            fStarted = true;
+        }
+        return req->WriteReplyChunk(chunk);
+    });
+
+    std::string strError;
+    try {
+        out.BeginObject();
+        out.Key("result");
+        tableRPC.executeStreaming(jreq.strMethod, jreq.params, out);
+        out.Key("error");
+        out.Value(NullUniValue);
+        out.Key("id");
+        out.Value(jreq.id);
+        out.EndObject();
+    } catch (const UniValue& objError) {
+        if (!fStarted) {
+            JSONErrorReply(req, objError, jreq.id);
+            return false;
+        }
+        strError = find_value(objError, "message").getValStr();
+    } catch (const std::exception& e) {
+        if (!fStarted) {
+            JSONErrorReply(req, JSONRPCError(RPC_MISC_ERROR, e.what()), jreq.id);
+            return false;
+        }
+        strError = e.what();
+    }
+
+    if (!strError.empty()) {
+        LogPrintf("%s: %s failed after %u bytes of its reply were sent: %s\n", __func__, jreq.strMethod, out.Sent(), strError);
+        req->WriteReplyEnd();
+        return false;
+    }
+
+    if (!fStarted) {
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, out.Buffered() + "\n");
+    } else {
+        req->WriteReplyChunk(out.Buffered() + "\n");
+        req->WriteReplyEnd();
+    }
+    return true;
+}
+
 static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
 {
     // JSONRPC handles only POST
@@ -163,10 +250,25 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
             }
             LogPrint("rpcapi", "%s %s\n", jreq.strMethod.c_str(), jreq.params.write().c_str());
 
-            UniValue result = tableRPC.execute(jreq.strMethod, jreq.params);
+            RecordRPCPhase(jreq.strMethod, RPC_PHASE_QUEUE, GetHTTPRequestQueueWait());
+
+            CRPCCachedResult cached;
+            if (tableRPC.executeCached(jreq.strMethod, jreq.params, cached))
+                return JSONRPCCachedReply(req, jreq, cached);
+
+            // a result that will be cached is built whole rather than streamed
+            if (tableRPC.streamingActor(jreq.strMethod) && !IsRPCCallCacheable(jreq.strMethod, jreq.params))
+                return JSONRPCStreamingReply(req, jreq);
+
+            std::string strETag;
+            UniValue result = tableRPC.execute(jreq.strMethod, jreq.params, &strETag);
+            if (!strETag.empty())
+                WriteCacheHeaders(req, strETag);
 
             // Send reply
+            int64_t nSerializeStart = GetTimeMicros();
             strReply = JSONRPCReply(result, NullUniValue, jreq.id);
+            RecordRPCPhase(jreq.strMethod, RPC_PHASE_SERIALIZE, GetTimeMicros() - nSerializeStart);
 
         // array of requests
         } else if (valRequest.isArray())
@@ -186,6 +288,29 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
     return true;
 }
 
+/** Prometheus scrape endpoint for the RPC call statistics, see -rpcmetrics */
+static bool HTTPReq_Metrics(HTTPRequest* req, const std::string &)
+{
+    if (req->GetRequestMethod() != HTTPRequest::GET) {
+        req->WriteReply(HTTP_BAD_METHOD, "Metrics are only served for GET requests");
+        return false;
+    }
+    std::pair<bool, std::string> authHeader = req->GetHeader("authorization");
+    if (!authHeader.first || !RPCAuthorized(authHeader.second)) {
+        if (authHeader.first) {
+            LogPrintf("ThreadRPCServer incorrect password attempt from %s\n", req->GetPeer().ToString());
+            MilliSleep(250);
+        }
+        req->WriteHeader("WWW-Authenticate", WWW_AUTH_HEADER_DATA);
+        req->WriteReply(HTTP_UNAUTHORIZED);
+        return false;
+    }
+
+    req->WriteHeader("Content-Type", "text/plain; version=0.0.4");
+    req->WriteReply(HTTP_OK, GetRPCMetrics() + GetCCEvalMetrics() + GetValidationMetrics() + GetMiningMetrics());
+    return true;
+}
+
 static bool InitRPCAuthentication()
 {
     if (mapArgs["-rpcpassword"] == "")
@@ -210,6 +335,8 @@ bool StartHTTPRPC()
         return false;
 
     RegisterHTTPHandler("/", true, HTTPReq_JSONRPC);
+    if (GetBoolArg("-rpcmetrics", false))
+        RegisterHTTPHandler("/metrics", true, HTTPReq_Metrics);
 
     assert(EventBase());
     httpRPCTimerInterface = new HTTPRPCTimerInterface(EventBase());
@@ -226,6 +353,8 @@ void StopHTTPRPC()
 {
     LogPrint("rpc", "Stopping HTTP RPC server\n");
     UnregisterHTTPHandler("/", true);
+    if (GetBoolArg("-rpcmetrics", false))
+        UnregisterHTTPHandler("/metrics", true);
     if (httpRPCTimerInterface) {
         RPCUnregisterTimerInterface(httpRPCTimerInterface);
         delete httpRPCTimerInterface;
@@ -13,7 +13,10 @@
 #include "ui_interface.h"
 #include "utilstrencodings.h"
 
+#include <algorithm>
+#include <atomic>
 #include <deque>
+#include <map>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -60,21 +63,44 @@ private:
     HTTPRequestHandler func;
 };
 
-/** Simple work queue for distributing work over multiple threads.
- * Work items are simply callable objects.
+//! How long the request a worker thread is handling waited in the work queue
+static thread_local int64_t nRequestQueueWaitMicros = 0;
+
+/** Work queue for distributing work over multiple threads, with a bounded queue for each priority class.
+ * Work items are simply callable objects. A worker takes the oldest item of the most urgent class that may run:
+ * some workers are kept for critical items and heavy items never take more than their share of the others,
+ * so that slow calls cannot starve latency critical ones.
  */
 template <typename WorkItem>
 class WorkQueue
 {
 private:
+    struct Entry
+    {
+        WorkItem* item;
+        int64_t nTime;
+    };
+    struct ClassQueue
+    {
+        std::deque<Entry> queue;
+        int running;
+        int maxRunning;
+        uint64_t nProcessed;
+        uint64_t nRejected;
+        int64_t nTotalWait;
+        int64_t nMaxWait;
+    };
+
     /** Mutex protects entire object */
     CWaitableCriticalSection cs;
     CConditionVariable cond;
-    /* XXX in C++11 we can use std::unique_ptr here and avoid manual cleanup */
-    std::deque<WorkItem*> queue;
+    ClassQueue classes[HTTP_PRIORITY_CLASSES];
     bool running;
     size_t maxDepth;
     int numThreads;
+    /** Normal and heavy items running at once, and how many may */
+    int runningUnreserved;
+    int maxUnreserved;
 
     /** RAII object to keep track of number of running worker threads */
     class ThreadCounter
@@ -94,30 +120,60 @@ private:
         }
     };
 
+    /** The most urgent class with an item that may run now, requires cs */
+    bool NextClass(int &nClass)
+    {
+        for (nClass = 0; nClass < HTTP_PRIORITY_CLASSES; nClass++) {
+            const ClassQueue &c = classes[nClass];
+            if (c.queue.empty() || c.running >= c.maxRunning)
+                continue;
+            if (nClass != HTTP_PRIORITY_CRITICAL && runningUnreserved >= maxUnreserved)
+                continue;
+            return true;
+        }
+        return false;
+    }
+
 public:
-    WorkQueue(size_t maxDepth) : running(true),
+    WorkQueue(size_t maxDepth, int nThreads, int nReserved) : running(true),
                                  maxDepth(maxDepth),
-                                 numThreads(0)
+                                 numThreads(0),
+                                 runningUnreserved(0)
     {
+        nThreads = std::max(nThreads, 1);
+        nReserved = std::max(std::min(nReserved, nThreads - 1), 0);
+        maxUnreserved = nThreads - nReserved;
+        for (int i = 0; i < HTTP_PRIORITY_CLASSES; i++) {
+            classes[i].running = 0;
+            classes[i].maxRunning = maxUnreserved;
+            classes[i].nProcessed = classes[i].nRejected = 0;
+            classes[i].nTotalWait = classes[i].nMaxWait = 0;
+        }
+        classes[HTTP_PRIORITY_CRITICAL].maxRunning = nThreads;
+        classes[HTTP_PRIORITY_HEAVY].maxRunning = std::max(maxUnreserved / 2, 1);
     }
     /*( Precondition: worker threads have all stopped
      * (call WaitExit)
      */
     ~WorkQueue()
     {
-        while (!queue.empty()) {
-            delete queue.front();
-            queue.pop_front();
+        for (int i = 0; i < HTTP_PRIORITY_CLASSES; i++) {
+            while (!classes[i].queue.empty()) {
+                delete classes[i].queue.front().item;
+                classes[i].queue.pop_front();
+            }
         }
     }
     /** Enqueue a work item */
-    bool Enqueue(WorkItem* item)
+    bool Enqueue(WorkItem* item, HTTPPriorityClass nClass)
     {
         boost::unique_lock<boost::mutex> lock(cs);
-        if (queue.size() >= maxDepth) {
+        ClassQueue &c = classes[nClass];
+        if (c.queue.size() >= maxDepth) {
+            c.nRejected++;
             return false;
         }
-        queue.push_back(item);
+        c.queue.push_back({item, GetTimeMicros()});
         cond.notify_one();
         return true;
     }
@@ -127,17 +183,35 @@ public:
         ThreadCounter count(*this);
         while (running) {
             WorkItem* i = 0;
+            int nClass = 0;
             {
                 boost::unique_lock<boost::mutex> lock(cs);
-                while (running && queue.empty())
+                while (running && !NextClass(nClass))
                     cond.wait(lock);
                 if (!running)
                     break;
-                i = queue.front();
-                queue.pop_front();
+                ClassQueue &c = classes[nClass];
+                i = c.queue.front().item;
+                int64_t nWait = GetTimeMicros() - c.queue.front().nTime;
+                c.queue.pop_front();
+                c.nTotalWait += nWait;
+                c.nMaxWait = std::max(c.nMaxWait, nWait);
+                nRequestQueueWaitMicros = nWait;
+                c.running++;
+                if (nClass != HTTP_PRIORITY_CRITICAL)
+                    runningUnreserved++;
             }
             (*i)();
             delete i;
+            {
+                boost::unique_lock<boost::mutex> lock(cs);
+                classes[nClass].running--;
+                classes[nClass].nProcessed++;
+                if (nClass != HTTP_PRIORITY_CRITICAL)
+                    runningUnreserved--;
+                // an item of another class may have been waiting for this one to finish
+                cond.notify_all();
+            }
         }
     }
     /** Interrupt and exit loops */
@@ -159,7 +233,23 @@ public:
     size_t Depth()
     {
         boost::unique_lock<boost::mutex> lock(cs);
-        return queue.size();
+        size_t depth = 0;
+        for (int i = 0; i < HTTP_PRIORITY_CLASSES; i++)
+            depth += classes[i].queue.size();
+        return depth;
+    }
+
+    std::vector<HTTPWorkQueueStats> Stats()
+    {
+        static const char* const names[HTTP_PRIORITY_CLASSES] = {"critical", "normal", "heavy"};
+        boost::unique_lock<boost::mutex> lock(cs);
+        std::vector<HTTPWorkQueueStats> stats;
+        for (int i = 0; i < HTTP_PRIORITY_CLASSES; i++) {
+            const ClassQueue &c = classes[i];
+            stats.push_back({names[i], c.queue.size(), maxDepth, c.running, c.maxRunning,
+                             c.nProcessed, c.nRejected, c.nTotalWait, c.nMaxWait});
+        }
+        return stats;
     }
 };
 
@@ -185,6 +275,8 @@ struct evhttp* eventHTTP = 0;
 static std::vector<CSubNet> rpc_allow_subnets;
 //! Work queue for handling longer requests off the event loop thread
 static WorkQueue<HTTPClosure>* workQueue = 0;
+//! Priority class of RPC methods that are not of the normal class
+static std::map<std::string, HTTPPriorityClass> mapMethodPriority;
 //! Handlers for (sub)paths
 std::vector<HTTPPathHandler> pathHandlers;
 //! Bound listening sockets
@@ -248,6 +340,92 @@ static std::string RequestMethodString(HTTPRequest::RequestMethod m)
     }
 }
 
+static bool ParsePriorityClass(const std::string& strClass, HTTPPriorityClass& nClass)
+{
+    if (strClass == "critical")
+        nClass = HTTP_PRIORITY_CRITICAL;
+    else if (strClass == "normal")
+        nClass = HTTP_PRIORITY_NORMAL;
+    else if (strClass == "heavy")
+        nClass = HTTP_PRIORITY_HEAVY;
+    else
+        return false;
+    return true;
+}
+
+/** Set up the priority classes of RPC methods, the defaults and then any -rpcmethodclass=<method>:<class> */
+static bool InitMethodPriorities()
+{
+    static const char* const criticalMethods[] = {
+        "getblocktemplate", "submitblock", "submitmergedblock", "getmininginfo", "getblockcount", "getbestblockhash",
+        "getbestproofroot", "getnotarizationdata", "getnotarizationproofs", "submitacceptednotarization", "submitimports", "ping"
+    };
+    static const char* const heavyMethods[] = {
+        "listidentities", "getidentitieswithaddress", "getidentitieswithrevocation", "getidentitieswithrecovery",
+        "getaddressdeltas", "getaddressutxos", "getaddresstxids", "getaddressbalance", "getaddressmempool",
+        "listcurrencies", "getsnapshot", "gettxoutsetinfo", "listtransactions", "waitforsubscriptionevents"
+    };
+
+    mapMethodPriority.clear();
+    BOOST_FOREACH (const char* method, criticalMethods)
+        mapMethodPriority[method] = HTTP_PRIORITY_CRITICAL;
+    BOOST_FOREACH (const char* method, heavyMethods)
+        mapMethodPriority[method] = HTTP_PRIORITY_HEAVY;
+
+    if (mapMultiArgs.count("-rpcmethodclass")) {
+        BOOST_FOREACH (const std::string& strArg, mapMultiArgs["-rpcmethodclass"]) {
+            size_t nPos = strArg.rfind(':');
+            HTTPPriorityClass nClass;
+            if (nPos == std::string::npos || nPos == 0 || !ParsePriorityClass(strArg.substr(nPos + 1), nClass)) {
+                uiInterface.ThreadSafeMessageBox(
+                    strprintf("Invalid -rpcmethodclass %s, expected <method>:<critical|normal|heavy>", strArg),
+                    "", CClientUIInterface::MSG_ERROR);
+                return false;
+            }
+            mapMethodPriority[strArg.substr(0, nPos)] = nClass;
+        }
+    }
+    return true;
+}
+
+/** Priority class of a JSON-RPC request, from the first method named in its body. Everything else is normal */
+static HTTPPriorityClass GetRequestPriority(HTTPRequest* req)
+{
+    if (req->GetRequestMethod() != HTTPRequest::POST)
+        return HTTP_PRIORITY_NORMAL;
+
+    size_t nSize = 0;
+    const char* pBody = req->PeekBody(nSize);
+    if (!pBody)
+        return HTTP_PRIORITY_NORMAL;
+
+    // a scan for the method key rather than a parse, this runs on the event loop thread and bodies can be large
+    static const std::string strKey = "\"method\"";
+    const char* pEnd = pBody + nSize;
+    const char* p = std::search(pBody, pEnd, strKey.begin(), strKey.end());
+    if (p == pEnd)
+        return HTTP_PRIORITY_NORMAL;
+    p += strKey.size();
+    while (p < pEnd && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n' || *p == ':'))
+        p++;
+    if (p == pEnd || *p != '"')
+        return HTTP_PRIORITY_NORMAL;
+    const char* pMethod = ++p;
+    while (p < pEnd && *p != '"' && p - pMethod < 64)
+        p++;
+    if (p == pEnd || *p != '"')
+        return HTTP_PRIORITY_NORMAL;
+
+    std::string strMethod(pMethod, p);
+    std::map<std::string, HTTPPriorityClass>::const_iterator it = mapMethodPriority.find(strMethod);
+    if (it != mapMethodPriority.end())
+        return it->second;
+    // shielded operations make proofs or scan notes
+    if (strMethod.compare(0, 2, "z_") == 0)
+        return HTTP_PRIORITY_HEAVY;
+    return HTTP_PRIORITY_NORMAL;
+}
+
 /** HTTP request callback */
 static void http_request_cb(struct evhttp_request* req, void* arg)
 {
@@ -291,9 +469,10 @@ static void http_request_cb(struct evhttp_request* req, void* arg)
 
     // Dispatch to worker thread
     if (i != iend) {
+        HTTPPriorityClass nClass = GetRequestPriority(hreq.get());
         std::unique_ptr<HTTPWorkItem> item(new HTTPWorkItem(hreq.release(), path, i->handler));
         assert(workQueue);
-        if (workQueue->Enqueue(item.get()))
+        if (workQueue->Enqueue(item.get(), nClass))
             item.release(); /* if true, queue took ownership */
         else
             item->req->WriteReply(HTTP_INTERNAL, "Work queue depth exceeded");
@@ -386,6 +565,9 @@ bool InitHTTPServer()
     if (!InitHTTPAllowList())
         return false;
 
+    if (!InitMethodPriorities())
+        return false;
+
     if (GetBoolArg("-rpcssl", false)) {
         uiInterface.ThreadSafeMessageBox(
             "SSL mode for RPC (-rpcssl) is no longer supported.",
@@ -436,14 +618,29 @@ bool InitHTTPServer()
 
     LogPrint("http", "Initialized HTTP server\n");
     int workQueueDepth = std::max((long)GetArg("-rpcworkqueue", DEFAULT_HTTP_WORKQUEUE), 1L);
-    LogPrintf("HTTP: creating work queue of depth %d\n", workQueueDepth);
+    int rpcThreads = std::max((long)GetArg("-rpcthreads", DEFAULT_HTTP_THREADS), 1L);
+    int rpcReservedThreads = GetArg("-rpcreservedthreads", DEFAULT_HTTP_RESERVED_THREADS);
+    LogPrintf("HTTP: creating work queues of depth %d, %d workers reserved for critical calls\n", workQueueDepth,
+              std::max(std::min(rpcReservedThreads, rpcThreads - 1), 0));
 
-    workQueue = new WorkQueue<HTTPClosure>(workQueueDepth);
+    workQueue = new WorkQueue<HTTPClosure>(workQueueDepth, rpcThreads, rpcReservedThreads);
     eventBase = base;
     eventHTTP = http;
     return true;
 }
 
+int64_t GetHTTPRequestQueueWait()
+{
+    return nRequestQueueWaitMicros;
+}
+
+std::vector<HTTPWorkQueueStats> GetHTTPWorkQueueStats()
+{
+    if (!workQueue)
+        return std::vector<HTTPWorkQueueStats>();
+    return workQueue->Stats();
+}
+
 boost::thread threadHTTP;
 
 bool StartHTTPServer()
@@ -541,12 +738,55 @@ void HTTPEvent::trigger(struct timeval* tv)
     else
         evtimer_add(ev, tv); // trigger after timeval passed
 }
+/** State of a chunked reply, shared between the worker making it and the events that send it */
+struct HTTPReplyStream
+{
+    // set on the event thread when the client closes the connection, after which the request is freed by libevent
+    std::atomic<bool> fClosed;
+    HTTPReplyStream() : fClosed(false) {}
+};
+
+static void http_reply_stream_closed_cb(struct evhttp_connection* conn, void* arg)
+{
+    static_cast<HTTPReplyStream*>(arg)->fClosed = true;
+}
+
+static void http_reply_stream_start(struct evhttp_request* req, int nStatus, std::shared_ptr<HTTPReplyStream> stream)
+{
+    struct evhttp_connection* conn = evhttp_request_get_connection(req);
+    if (conn)
+        evhttp_connection_set_closecb(conn, http_reply_stream_closed_cb, stream.get());
+    evhttp_send_reply_start(req, nStatus, NULL);
+}
+
+static void http_reply_stream_chunk(struct evhttp_request* req, struct evbuffer* buf, std::shared_ptr<HTTPReplyStream> stream)
+{
+    if (!stream->fClosed)
+        evhttp_send_reply_chunk(req, buf);
+    evbuffer_free(buf);
+}
+
+static void http_reply_stream_end(struct evhttp_request* req, std::shared_ptr<HTTPReplyStream> stream)
+{
+    if (stream->fClosed)
+        return;
+    struct evhttp_connection* conn = evhttp_request_get_connection(req);
+    if (conn)
+        evhttp_connection_set_closecb(conn, NULL, NULL);
+    evhttp_send_reply_end(req);
+}
+
 HTTPRequest::HTTPRequest(struct evhttp_request* req) : req(req),
                                                        replySent(false)
 {
 }
 HTTPRequest::~HTTPRequest()
 {
+    if (replyStream) {
+        // a call that failed part way through a chunked reply, the client sees it cut short
+        LogPrintf("%s: Unfinished chunked reply\n", __func__);
+        WriteReplyEnd();
+    }
     if (!replySent) {
         // Keep track of whether reply was sent to avoid request leaks
         LogPrintf("%s: Unhandled request\n", __func__);
@@ -586,6 +826,17 @@ std::string HTTPRequest::ReadBody()
     return rv;
 }
 
+const char* HTTPRequest::PeekBody(size_t& nSize)
+{
+    nSize = 0;
+    struct evbuffer* buf = evhttp_request_get_input_buffer(req);
+    if (!buf)
+        return NULL;
+    nSize = evbuffer_get_length(buf);
+    // makes the buffer contiguous, ReadBody then finds it so and needs no copy of its own
+    return (const char*)evbuffer_pullup(buf, nSize);
+}
+
 void HTTPRequest::WriteHeader(const std::string& hdr, const std::string& value)
 {
     struct evkeyvalq* headers = evhttp_request_get_output_headers(req);
@@ -612,6 +863,41 @@ void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
     req = 0; // transferred back to main thread
 }
 
+void HTTPRequest::WriteReplyStart(int nStatus)
+{
+    assert(!replySent && !replyStream && req);
+    replyStream = std::make_shared<HTTPReplyStream>();
+    HTTPEvent* ev = new HTTPEvent(eventBase, true,
+        boost::bind(http_reply_stream_start, req, nStatus, replyStream));
+    ev->trigger(0);
+}
+
+bool HTTPRequest::WriteReplyChunk(const std::string& strChunk)
+{
+    assert(replyStream && req);
+    if (replyStream->fClosed)
+        return false;
+    struct evbuffer* buf = evbuffer_new();
+    assert(buf);
+    evbuffer_add(buf, strChunk.data(), strChunk.size());
+    // events run in the order they are triggered, so the chunks arrive in order
+    HTTPEvent* ev = new HTTPEvent(eventBase, true,
+        boost::bind(http_reply_stream_chunk, req, buf, replyStream));
+    ev->trigger(0);
+    return true;
+}
+
+void HTTPRequest::WriteReplyEnd()
+{
+    assert(replyStream && req);
+    HTTPEvent* ev = new HTTPEvent(eventBase, true,
+        boost::bind(http_reply_stream_end, req, replyStream));
+    ev->trigger(0);
+    replyStream.reset();
+    replySent = true;
+    req = 0; // transferred back to main thread
+}
+
 CService HTTPRequest::GetPeer()
 {
     evhttp_connection* con = evhttp_request_get_connection(req);
@@ -5,7 +5,9 @@
 #ifndef BITCOIN_HTTPSERVER_H
 #define BITCOIN_HTTPSERVER_H
 
+#include <memory>
 #include <string>
+#include <vector>
 #include <stdint.h>
 #ifdef _WIN32
 #undef __cpuid
@@ -17,16 +19,46 @@
 static const int DEFAULT_HTTP_THREADS=4;
 static const int DEFAULT_HTTP_WORKQUEUE=16;
 static const int DEFAULT_HTTP_SERVER_TIMEOUT=30;
+/** Workers that only serve critical RPC calls, so that heavy queries can never occupy all of them */
+static const int DEFAULT_HTTP_RESERVED_THREADS=1;
+
+/** RPC priority and cost classes, each has its own bounded queue. Most urgent first */
+enum HTTPPriorityClass
+{
+    HTTP_PRIORITY_CRITICAL, //!< mining, block submission and notarization, which time out when delayed
+    HTTP_PRIORITY_NORMAL,
+    HTTP_PRIORITY_HEAVY,    //!< index scans and shielded operations, never more than half of the unreserved workers
+    HTTP_PRIORITY_CLASSES
+};
+
+/** Queue depth and wait time of one priority class of the HTTP work queue */
+struct HTTPWorkQueueStats
+{
+    std::string strClass;
+    size_t nDepth;
+    size_t nMaxDepth;
+    int nRunning;
+    int nMaxRunning;
+    uint64_t nProcessed;
+    uint64_t nRejected;
+    int64_t nTotalWaitMicros;
+    int64_t nMaxWaitMicros;
+};
 
 struct evhttp_request;
 struct event_base;
 class CService;
 class HTTPRequest;
+struct HTTPReplyStream;
 
 /** Initialize HTTP server.
  * Call this before RegisterHTTPHandler or EventBase().
  */
 bool InitHTTPServer();
+/** Statistics of the HTTP work queue by priority class, empty while the server is not running */
+std::vector<HTTPWorkQueueStats> GetHTTPWorkQueueStats();
+/** Microseconds the request being handled on this worker thread waited in the work queue */
+int64_t GetHTTPRequestQueueWait();
 /** Start HTTP server.
  * This is separate from InitHTTPServer to give users race-condition-free time
  * to register their handlers between InitHTTPServer and StartHTTPServer.
@@ -59,6 +91,8 @@ class HTTPRequest
 {
 private:
     struct evhttp_request* req;
+    // set for a chunked reply, see WriteReplyStart
+    std::shared_ptr<HTTPReplyStream> replyStream;
 
     // For test access
 protected:
@@ -102,6 +136,13 @@ public:
      */
     std::string ReadBody();
 
+    /**
+     * Look at the request body without consuming it, nSize is set to its length.
+     *
+     * @note The data is valid until ReadBody is called.
+     */
+    const char* PeekBody(size_t& nSize);
+
     /**
      * Write output header.
      *
@@ -118,6 +159,23 @@ public:
      * main thread, do not call any other HTTPRequest methods after calling this.
      */
     virtual void WriteReply(int nStatus, const std::string& strReply = "");
+
+    /**
+     * Start a chunked reply, for a body that is sent in parts as it is made rather than held in full.
+     * Write headers before this, as for WriteReply, then the body with WriteReplyChunk and end it with WriteReplyEnd.
+     */
+    void WriteReplyStart(int nStatus);
+
+    /**
+     * Send the next part of a chunked reply. Returns false once the client has closed the connection,
+     * and the rest of the reply should not be made.
+     */
+    bool WriteReplyChunk(const std::string& strChunk);
+
+    /**
+     * End a chunked reply. As for WriteReply, this gives the request back to the main thread.
+     */
+    void WriteReplyEnd();
 };
 
 /** Event handler closure.
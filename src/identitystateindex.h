@@ -0,0 +1,346 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_IDENTITYSTATEINDEX_H
+#define BITCOIN_IDENTITYSTATEINDEX_H
+
+#include "uint256.h"
+#include "serialize.h"
+
+#include <utility>
+
+class CIdentity;
+class CTxOut;
+
+// identity outputs are keyed by identity first, then by their position in the chain, so the state of an identity as of
+// any height is the last entry at or below that height
+struct CIdentityStateIndexIteratorKey {
+    uint160 identityID;
+    unsigned int height;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 24;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        identityID.Serialize(s);
+        ser_writedata32be(s, height);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        identityID.Unserialize(s);
+        height = ser_readdata32be(s);
+    }
+
+    CIdentityStateIndexIteratorKey(const uint160 &id, unsigned int nHeight) {
+        identityID = id;
+        height = nHeight;
+    }
+
+    CIdentityStateIndexIteratorKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        identityID.SetNull();
+        height = 0;
+    }
+};
+
+struct CIdentityStateIndexKey {
+    uint160 identityID;
+    unsigned int height;
+    unsigned int txindex;
+    unsigned int index;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 32;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        identityID.Serialize(s);
+        ser_writedata32be(s, height);
+        ser_writedata32be(s, txindex);
+        ser_writedata32be(s, index);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        identityID.Unserialize(s);
+        height = ser_readdata32be(s);
+        txindex = ser_readdata32be(s);
+        index = ser_readdata32be(s);
+    }
+
+    CIdentityStateIndexKey(const uint160 &id, unsigned int nHeight, unsigned int nTxIndex, unsigned int nIndex) {
+        identityID = id;
+        height = nHeight;
+        txindex = nTxIndex;
+        index = nIndex;
+    }
+
+    CIdentityStateIndexKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        identityID.SetNull();
+        height = 0;
+        txindex = 0;
+        index = 0;
+    }
+};
+
+// the reverse index finds identities by one of their reverse index keys, which are derived from their primary addresses,
+// revocation and recovery authorities. each entry points to the identity state index entry at the same position.
+struct CIdentityReverseIndexIteratorKey {
+    uint160 reverseKey;
+    unsigned int height;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 24;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        reverseKey.Serialize(s);
+        ser_writedata32be(s, height);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        reverseKey.Unserialize(s);
+        height = ser_readdata32be(s);
+    }
+
+    CIdentityReverseIndexIteratorKey(const uint160 &key, unsigned int nHeight) {
+        reverseKey = key;
+        height = nHeight;
+    }
+
+    CIdentityReverseIndexIteratorKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        reverseKey.SetNull();
+        height = 0;
+    }
+};
+
+struct CIdentityReverseIndexKey {
+    uint160 reverseKey;
+    unsigned int height;
+    unsigned int txindex;
+    unsigned int index;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 32;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        reverseKey.Serialize(s);
+        ser_writedata32be(s, height);
+        ser_writedata32be(s, txindex);
+        ser_writedata32be(s, index);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        reverseKey.Unserialize(s);
+        height = ser_readdata32be(s);
+        txindex = ser_readdata32be(s);
+        index = ser_readdata32be(s);
+    }
+
+    CIdentityReverseIndexKey(const uint160 &key, unsigned int nHeight, unsigned int nTxIndex, unsigned int nIndex) {
+        reverseKey = key;
+        height = nHeight;
+        txindex = nTxIndex;
+        index = nIndex;
+    }
+
+    CIdentityReverseIndexKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        reverseKey.SetNull();
+        height = 0;
+        txindex = 0;
+        index = 0;
+    }
+};
+
+// the content index finds the identity states that have content under a VDXF key in their content multimap, including
+// content removal actions, which are under their own key. each entry points to the identity state at the same position.
+struct CIdentityContentIndexIteratorKey {
+    uint160 identityID;
+    uint160 vdxfKey;
+    unsigned int height;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 44;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        identityID.Serialize(s);
+        vdxfKey.Serialize(s);
+        ser_writedata32be(s, height);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        identityID.Unserialize(s);
+        vdxfKey.Unserialize(s);
+        height = ser_readdata32be(s);
+    }
+
+    CIdentityContentIndexIteratorKey(const uint160 &id, const uint160 &key, unsigned int nHeight) {
+        identityID = id;
+        vdxfKey = key;
+        height = nHeight;
+    }
+
+    CIdentityContentIndexIteratorKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        identityID.SetNull();
+        vdxfKey.SetNull();
+        height = 0;
+    }
+};
+
+struct CIdentityContentIndexKey {
+    uint160 identityID;
+    uint160 vdxfKey;
+    unsigned int height;
+    unsigned int txindex;
+    unsigned int index;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 52;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        identityID.Serialize(s);
+        vdxfKey.Serialize(s);
+        ser_writedata32be(s, height);
+        ser_writedata32be(s, txindex);
+        ser_writedata32be(s, index);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        identityID.Unserialize(s);
+        vdxfKey.Unserialize(s);
+        height = ser_readdata32be(s);
+        txindex = ser_readdata32be(s);
+        index = ser_readdata32be(s);
+    }
+
+    CIdentityContentIndexKey(const uint160 &id, const uint160 &key, unsigned int nHeight, unsigned int nTxIndex, unsigned int nIndex) {
+        identityID = id;
+        vdxfKey = key;
+        height = nHeight;
+        txindex = nTxIndex;
+        index = nIndex;
+    }
+
+    CIdentityContentIndexKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        identityID.SetNull();
+        vdxfKey.SetNull();
+        height = 0;
+        txindex = 0;
+        index = 0;
+    }
+};
+
+// name commitments are keyed by their commitment hash, so the commitment output for a name reservation can be found
+// from the reservation alone
+struct CIdentityCommitmentIndexIteratorKey {
+    uint256 commitmentHash;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 32;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        commitmentHash.Serialize(s);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        commitmentHash.Unserialize(s);
+    }
+
+    CIdentityCommitmentIndexIteratorKey(const uint256 &hash) {
+        commitmentHash = hash;
+    }
+
+    CIdentityCommitmentIndexIteratorKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        commitmentHash.SetNull();
+    }
+};
+
+struct CIdentityCommitmentIndexKey {
+    uint256 commitmentHash;
+    unsigned int height;
+    unsigned int txindex;
+    unsigned int index;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 44;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        commitmentHash.Serialize(s);
+        ser_writedata32be(s, height);
+        ser_writedata32be(s, txindex);
+        ser_writedata32be(s, index);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        commitmentHash.Unserialize(s);
+        height = ser_readdata32be(s);
+        txindex = ser_readdata32be(s);
+        index = ser_readdata32be(s);
+    }
+
+    CIdentityCommitmentIndexKey(const uint256 &hash, unsigned int nHeight, unsigned int nTxIndex, unsigned int nIndex) {
+        commitmentHash = hash;
+        height = nHeight;
+        txindex = nTxIndex;
+        index = nIndex;
+    }
+
+    CIdentityCommitmentIndexKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        commitmentHash.SetNull();
+        height = 0;
+        txindex = 0;
+        index = 0;
+    }
+};
+
+// the value of each entry is the hash of the transaction with the output and the identity it defines, so no transaction
+// needs to be loaded to use it
+typedef std::pair<CIdentityStateIndexKey, std::pair<uint256, CIdentity>> CIdentityStateIndexEntry;
+
+// the value of each commitment entry is the hash of the transaction with the commitment output
+typedef std::pair<CIdentityCommitmentIndexKey, uint256> CIdentityCommitmentIndexEntry;
+
+// returns true and fills in the entry if this output is a valid primary identity output
+bool GetIdentityStateIndexEntry(const CTxOut &out, const uint256 &txHash, unsigned int txIndex, unsigned int outNum, unsigned int height, CIdentityStateIndexEntry &entry);
+
+// returns true and fills in the entry if this output is a name commitment
+bool GetIdentityCommitmentIndexEntry(const CTxOut &out, const uint256 &txHash, unsigned int txIndex, unsigned int outNum, unsigned int height, CIdentityCommitmentIndexEntry &entry);
+
+#endif // BITCOIN_IDENTITYSTATEINDEX_H
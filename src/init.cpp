@@ -9,6 +9,7 @@
 
 #include "init.h"
 #include "crypto/common.h"
+#include "crypto/sha256.h"
 #include "primitives/block.h"
 #include "addrman.h"
 #include "amount.h"
@@ -25,6 +26,7 @@
 #include "metrics.h"
 #include "miner.h"
 #include "net.h"
+#include "notificationqueue.h"
 #include "params.h"
 #include "rpc/server.h"
 #include "rpc/pbaasrpc.h"
@@ -37,6 +39,8 @@
 #include "ui_interface.h"
 #include "util.h"
 #include "utilmoneystr.h"
+#include "utxostats.h"
+#include "subscriptionindex.h"
 #include "validationinterface.h"
 #ifdef ENABLE_WALLET
 #include "key_io.h"
@@ -82,11 +86,14 @@ extern int64_t STORAGE_FEE_FACTOR;
 extern std::string VERUS_DEFAULT_ZADDR;
 
 ZCJoinSplit* pzcashParams = NULL;
+static CScheduler* pschedulerMain = NULL;
 
 #ifdef ENABLE_WALLET
 CWallet* pwalletMain = NULL;
 #endif
 bool fFeeEstimatesInitialized = false;
+// set once the saved mempool has been loaded, so that an interrupted startup does not overwrite mempool.dat
+static bool fDumpMempoolLater = false;
 
 #if ENABLE_ZMQ
 static CZMQNotificationInterface* pzmqNotificationInterface = NULL;
@@ -170,6 +177,15 @@ public:
             abort();
         }
     }
+    size_t GetCoinsMany(const std::vector<uint256> &txids, std::vector<CCoins> &coins, std::vector<unsigned char> &found, int nThreads) const {
+        try {
+            return base->GetCoinsMany(txids, coins, found, nThreads);
+        } catch(const std::runtime_error& e) {
+            uiInterface.ThreadSafeMessageBox(_("Error reading from database, shutting down."), "", CClientUIInterface::MSG_ERROR);
+            LogPrintf("Error reading from database: %s\n", e.what());
+            abort();
+        }
+    }
     // Writes do not need similar protection, as failure to write is handled by the caller.
 };
 
@@ -183,6 +199,8 @@ void Interrupt(boost::thread_group& threadGroup)
     InterruptHTTPRPC();
     InterruptRPC();
     InterruptREST();
+    if (pSubscriptionIndex)
+        pSubscriptionIndex->Interrupt();
     InterruptTorControl();
     threadGroup.interrupt_all();
 }
@@ -223,6 +241,12 @@ void Shutdown()
     StopTorControl();
     UnregisterNodeSignals(GetNodeSignals());
 
+    if (fDumpMempoolLater && GetBoolArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL))
+    {
+        DumpMempool();
+        fDumpMempoolLater = false;
+    }
+
     if (fFeeEstimatesInitialized)
     {
         boost::filesystem::path est_path = GetDataDir() / FEE_ESTIMATES_FILENAME;
@@ -238,6 +262,7 @@ void Shutdown()
         LOCK(cs_main);
         if (pcoinsTip != NULL) {
             FlushStateToDisk();
+            WriteChainMMR();
         }
         delete pcoinsTip;
         pcoinsTip = NULL;
@@ -245,6 +270,7 @@ void Shutdown()
         pcoinscatcher = NULL;
         delete pcoinsdbview;
         pcoinsdbview = NULL;
+        ResetChainReadSnapshot();
         delete pblocktree;
         pblocktree = NULL;
         delete pnotarisations;
@@ -255,6 +281,12 @@ void Shutdown()
         pwalletMain->Flush(true);
 #endif
 
+    if (pSubscriptionIndex) {
+        UnregisterValidationInterface(pSubscriptionIndex);
+        delete pSubscriptionIndex;
+        pSubscriptionIndex = NULL;
+    }
+
 #if ENABLE_ZMQ
     if (pzmqNotificationInterface) {
         UnregisterValidationInterface(pzmqNotificationInterface);
@@ -353,6 +385,9 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-?", _("This help message"));
     strUsage += HelpMessageOpt("-alerts", strprintf(_("Receive and display P2P network alerts (default: %u)"), DEFAULT_ALERTS));
     strUsage += HelpMessageOpt("-alertnotify=<cmd>", _("Execute command when a relevant alert is received or we see a really long fork (%s in cmd is replaced by message)"));
+    strUsage += HelpMessageOpt("-assumenotarized=<height>:<blockhash>:<stateroot>", _("The proof root of a notarization of this chain confirmed on its root chain. Once the chain MMR root of our headers up to that block matches the state root, skip script, signature and proof verification of it and its ancestors, and only require a -loadchainstate snapshot to be of that block"));
+    strUsage += HelpMessageOpt("-assumevalid=<hex>", _("If this block is in the chain assume that it and its ancestors are valid and potentially skip their script, signature and proof verification (0 to verify all, default: 0)"));
+    strUsage += HelpMessageOpt("-backgroundflush", strprintf(_("Write the flushed database cache to disk on a background thread while validation continues, briefly holding up to twice the cache in memory (default: %u)"), DEFAULT_BACKGROUND_FLUSH));
     strUsage += HelpMessageOpt("-blocknotify=<cmd>", _("Execute command when the best block changes (%s in cmd is replaced by block hash)"));
     strUsage += HelpMessageOpt("-bootstrap", _("Removes previous chain data (if present), downloads and extracts the bootstrap archive."));
     strUsage += HelpMessageOpt("-checkblocks=<n>", strprintf(_("How many blocks to check at startup (default: %u, 0 = all)"), 288));
@@ -367,29 +402,56 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-datadir=<dir>", _("Specify data directory"));
     strUsage += HelpMessageOpt("-dbcache=<n>", strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"), nMinDbCache, nMaxDbCache, nDefaultDbCache));
     strUsage += HelpMessageOpt("-exportdir=<dir>", _("Specify directory to be used when exporting data"));
+    strUsage += HelpMessageOpt("-inputprefetchthreads=<n>", strprintf(_("Number of threads reading the coins spent by a block from disk at once before it is connected (0 to %d, 0 = read each when validated, default: %d)"),
+        MAX_INPUT_PREFETCH_THREADS, DEFAULT_INPUT_PREFETCH_THREADS));
     strUsage += HelpMessageOpt("-loadblock=<file>", _("Imports blocks from external blk000??.dat file") + " " + _("on startup"));
+    strUsage += HelpMessageOpt("-loadchainstate=<file>", _("If the chainstate is empty, load it on startup from a snapshot written by dumpchainstate. The block database must already contain the blocks up to the snapshot"));
+    strUsage += HelpMessageOpt("-loadparamsasync", strprintf(_("Load the zk-SNARK parameters on a thread while the node starts, so that proofs are only waited for once they are needed (default: %u)"), DEFAULT_LOAD_PARAMS_ASYNC));
     strUsage += HelpMessageOpt("-maxorphantx=<n>", strprintf(_("Keep at most <n> unconnectable transactions in memory (default: %u)"), DEFAULT_MAX_ORPHAN_TRANSACTIONS));
     strUsage += HelpMessageOpt("-mempooltxinputlimit=<n>", _("[DEPRECATED FROM OVERWINTER] Set the maximum number of transparent inputs in a transaction that the mempool will accept (default: 0 = no limit applied)"));
     strUsage += HelpMessageOpt("-notarydatadir=<dir>", _("Specify data directory for notary chain"));
+    strUsage += HelpMessageOpt("-nullifierfilter", strprintf(_("Keep a filter over the spent Sprout and Sapling nullifiers in memory, so looking up unspent ones does not read the coins database (default: %u)"), DEFAULT_NULLIFIER_FILTER));
     strUsage += HelpMessageOpt("-par=<n>", strprintf(_("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
         -(int)boost::thread::hardware_concurrency(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS));
 #ifndef _WIN32
     strUsage += HelpMessageOpt("-pid=<file>", strprintf(_("Specify pid file (default: %s)"), "verusd.pid"));
 #endif
+    strUsage += HelpMessageOpt("-schedulerthreads=<n>", strprintf(_("Number of threads that run periodic background tasks (default: %d)"), DEFAULT_SCHEDULER_THREADS));
+    strUsage += HelpMessageOpt("-persistmempool", strprintf(_("Whether to save the mempool on shutdown and load on restart (default: %u)"), DEFAULT_PERSIST_MEMPOOL));
     strUsage += HelpMessageOpt("-prune=<n>", strprintf(_("Reduce storage requirements by pruning (deleting) old blocks. This mode disables wallet support and is incompatible with -txindex. "
             "Warning: Reverting this setting requires re-downloading the entire blockchain. "
             "(default: 0 = disable pruning blocks, >%u = target size in MiB to use for block files)"), MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024));
+    strUsage += HelpMessageOpt("-pruneproofs", strprintf(_("With -prune, keep what pruned blocks need to prove their coinbases, stakes, PBaaS transactions and transactions with unspent outputs, and keep those transactions (default: %u)"), DEFAULT_PRUNE_PROOFS));
+    strUsage += HelpMessageOpt("-compressblocks", strprintf(_("Compress new blocks and undo data written to disk. Files with compressed records cannot be read by versions without support for them (default: %u)"), DEFAULT_COMPRESS_BLOCK_FILES));
     strUsage += HelpMessageOpt("-reindex", _("Rebuild block chain index from current blk000??.dat files on startup"));
+    strUsage += HelpMessageOpt("-reindexprefetch=<n>", strprintf(_("Number of blocks to read and deserialize ahead of the block being connected during -reindex and -loadblock (0 to %d, 0 = read inline, default: %d)"),
+        MAX_REINDEX_PREFETCH, DEFAULT_REINDEX_PREFETCH));
 #if !defined(WIN32)
     strUsage += HelpMessageOpt("-sysperms", _("Create new files with system default permissions, instead of umask 077 (only effective with disabled wallet functionality)"));
 #endif
     strUsage += HelpMessageGroup(_("Index options:"));
+    strUsage += HelpMessageOpt("-blockfilterindex", strprintf(_("Maintain the BIP158 compact filter of each block, including the destination and identity IDs of crypto-condition outputs, for getblockfilter and -peerblockfilters. Enabled on an existing database, it is built in the background (default: %u)"), DEFAULT_BLOCKFILTERINDEX));
+    strUsage += HelpMessageOpt("-blockstatsindex", strprintf(_("Maintain the transaction, fee, reserve transfer, conversion, identity and shielded statistics of each block, for getblockstats. Enabling it on an existing database reindexes (default: %u)"), DEFAULT_BLOCKSTATSINDEX));
+    strUsage += HelpMessageOpt("-blockdeltaindex", strprintf(_("With -insightexplorer, store a summary of the address deltas of each new block, so getblockdeltas does not need to read the block or look up its spent outputs (default: %u)"), DEFAULT_BLOCKDELTAINDEX));
     strUsage += HelpMessageOpt("-addressindex", strprintf(_("Maintain a full address index, used to query for the balance, txids and unspent outputs for addresses (default: %u)"), DEFAULT_ADDRESSINDEX));
+    strUsage += HelpMessageOpt("-identitycachesize=<n>", strprintf(_("Number of current identity states to keep in memory for identity lookups (default: %d)"), CIdentity::DEFAULT_LOOKUP_CACHE_SIZE));
     strUsage += HelpMessageOpt("-idindex", strprintf(_("Maintain a full identity index, enabling queries to select IDs with addresses, revocation or recovery IDs (default: %u)"), 0));
+    strUsage += HelpMessageOpt("-txcachesize=<n>", strprintf(_("Number of confirmed transactions read from disk to keep in memory for transaction lookups, 0 disables the cache (default: %d)"), DEFAULT_TX_CACHE_SIZE));
     strUsage += HelpMessageOpt("-timestampindex", strprintf(_("Maintain a timestamp index for block hashes, used to query blocks hashes by a range of timestamps (default: %u)"), DEFAULT_TIMESTAMPINDEX));
     if (showDebug)  
         strUsage += HelpMessageOpt("-txindex", strprintf(_("Maintain a full transaction index, used by the getrawtransaction rpc call (default: %u)"), 0));
+    strUsage += HelpMessageOpt("-utxostats", strprintf(_("Maintain statistics of the unspent output set as blocks are connected, so gettxoutsetinfo with hash_type muhash and coinsupply need no scan. They are rebuilt in the background when missing (default: %u)"), DEFAULT_UTXOSTATS));
     strUsage += HelpMessageOpt("-spentindex", strprintf(_("Maintain a full spent index, used to query the spending txid and input index for an outpoint (default: %u)"), DEFAULT_SPENTINDEX));
+    strUsage += HelpMessageOpt("-compactaddressindex", strprintf(_("Store address index keys in the compact format, which refers to transactions by their number in the block. Applies to new databases, and setting it converts an existing address index once at startup (default: %u)"), DEFAULT_COMPACT_ADDRESS_INDEX));
+    strUsage += HelpMessageOpt("-backgroundindex", strprintf(_("When an index is enabled on an existing database, build it in the background while following the chain, instead of reindexing (default: %u)"), DEFAULT_BACKGROUND_INDEX));
+    strUsage += HelpMessageOpt("-separateindexdb", strprintf(_("Keep the address, unspent, spent and timestamp indexes in their own database under blocks/indexes, only takes effect on a new block index or with -reindex (default: %u)"), DEFAULT_SEPARATE_INDEX_DB));
+    if (showDebug)
+    {
+        strUsage += HelpMessageOpt("-indexdbcache=<n>", _("Part of the block index database cache in megabytes given to the separate index database, at most three quarters (default: three quarters)"));
+        strUsage += HelpMessageOpt("-indexdbbloombits=<n>", strprintf(_("Bloom filter bits per key for the separate index database (default: %d)"), DEFAULT_INDEX_DB_BLOOM_BITS));
+        strUsage += HelpMessageOpt("-indexdbblocksize=<n>", strprintf(_("Block size in bytes for the separate index database (default: %d)"), DEFAULT_INDEX_DB_BLOCK_SIZE));
+        strUsage += HelpMessageOpt("-indexdbwritebuffer=<n>", _("Write buffer size in megabytes for the separate index database, which sets how much is written before compacting into a new table (default: a quarter of its cache)"));
+    }
     strUsage += HelpMessageGroup(_("Connection options:"));
     strUsage += HelpMessageOpt("-addnode=<ip>", _("Add a node to connect to and attempt to keep the connection open"));
     strUsage += HelpMessageOpt("-banscore=<n>", strprintf(_("Threshold for disconnecting misbehaving peers (default: %u)"), 100));
@@ -410,6 +472,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-onion=<ip:port>", strprintf(_("Use separate SOCKS5 proxy to reach peers via Tor hidden services (default: %s)"), "-proxy"));
     strUsage += HelpMessageOpt("-onlynet=<net>", _("Only connect to nodes in network <net> (ipv4, ipv6 or onion)"));
     strUsage += HelpMessageOpt("-permitbaremultisig", strprintf(_("Relay non-P2SH multisig (default: %u)"), 1));
+    strUsage += HelpMessageOpt("-peerblockfilters", strprintf(_("Serve compact block filters to peers per BIP157, requires -blockfilterindex (default: %u)"), DEFAULT_PEERBLOCKFILTERS));
     strUsage += HelpMessageOpt("-peerbloomfilters", strprintf(_("Support filtering of blocks and transaction with Bloom filters (default: %u)"), 1));
     if (showDebug)
         strUsage += HelpMessageOpt("-enforcenodebloom", strprintf("Enforce minimum protocol version to limit use of Bloom filters (default: %u)", 0));
@@ -417,6 +480,17 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-proxy=<ip:port>", _("Connect through SOCKS5 proxy"));
     strUsage += HelpMessageOpt("-proxyrandomize", strprintf(_("Randomize credentials for every proxy connection. This enables Tor stream isolation (default: %u)"), 1));
     strUsage += HelpMessageOpt("-seednode=<ip>", _("Connect to a node to retrieve peer addresses, and disconnect"));
+    {
+        std::string strModes = "select";
+#if defined(HAVE_SYS_EPOLL_H)
+        strModes += ", epoll";
+#endif
+#if defined(HAVE_SYS_EVENT_H)
+        strModes += ", kqueue";
+#endif
+        strUsage += HelpMessageOpt("-socketevents=<mode>", strprintf(_("How to wait on peer sockets: %s. select limits connections to %u (default: %s)"),
+            strModes, FD_SETSIZE, SocketEventsModeName(DEFAULT_SOCKETEVENTS)));
+    }
     strUsage += HelpMessageOpt("-timeout=<n>", strprintf(_("Specify connection timeout in milliseconds (minimum: 1, default: %d)"), DEFAULT_CONNECT_TIMEOUT));
     strUsage += HelpMessageOpt("-torcontrol=<ip>:<port>", strprintf(_("Tor control port to use if onion listening enabled (default: %s)"), DEFAULT_TOR_CONTROL));
     strUsage += HelpMessageOpt("-torpassword=<pass>", _("Tor control port password (default: empty)"));
@@ -428,6 +502,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-tlskeypwd=<password>", _("Password for a private key encryption (default: not set, i.e. private key will be stored unencrypted)"));
     strUsage += HelpMessageOpt("-tlscertpath=<path>", _("Full path to a certificate"));
     strUsage += HelpMessageOpt("-tlstrustdir=<path>", _("Full path to a trusted certificates directory"));
+    strUsage += HelpMessageOpt("-txreconciliation", strprintf(_("Offer transactions to inbound peers that support it by 4 byte short IDs instead of inv, they ask for the ones they miss (default: %u)"), DEFAULT_TXRECONCILIATION));
     strUsage += HelpMessageOpt("-whitebind=<addr>", _("Bind to given address and whitelist peers connecting to it. Use [host]:port notation for IPv6"));
     strUsage += HelpMessageOpt("-whitelist=<netmask>", _("Whitelist peers connecting from the given netmask or IP address. Can be specified multiple times.") +
         " " + _("Whitelisted peers cannot be DoS banned and their transactions are always relayed, even if they are already in the mempool, useful e.g. for a gateway"));
@@ -454,6 +529,8 @@ std::string HelpMessage(HelpMessageMode mode)
         CURRENCY_UNIT, FormatMoney(payTxFee.GetFeePerK())));
     strUsage += HelpMessageOpt("-privatechange", _("directs all change from sendcurency or z_sendmany APIs to the defaultzaddr set, if it is a valid sapling address"));
     strUsage += HelpMessageOpt("-rescan", _("Rescan the block chain for missing wallet transactions") + " " + _("on startup"));
+    strUsage += HelpMessageOpt("-rescanthreads=<n>", strprintf(_("Number of threads that read blocks and decrypt shielded outputs ahead of a rescan, 0 or 1 to rescan on one thread (default: %u)"), DEFAULT_RESCAN_THREADS));
+    strUsage += HelpMessageOpt("-saplingdecryptthreads=<n>", strprintf(_("Number of threads that trial decrypt the shielded outputs of a block or transaction with the wallet's viewing keys (default: %u)"), DEFAULT_SAPLING_DECRYPT_THREADS));
     strUsage += HelpMessageOpt("-salvagewallet", _("Attempt to recover private keys from a corrupt wallet.dat") + " " + _("on startup"));
     strUsage += HelpMessageOpt("-sendfreetransactions", strprintf(_("Send transactions as zero-fee transactions if possible (default: %u)"), 0));
     strUsage += HelpMessageOpt("-spendzeroconfchange", strprintf(_("Spend unconfirmed change when sending transactions (default: %u)"), 1));
@@ -462,7 +539,9 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-upgradewallet", _("Upgrade wallet to latest format") + " " + _("on startup"));
     strUsage += HelpMessageOpt("-wallet=<file>", _("Specify wallet file (within data directory)") + " " + strprintf(_("(default: %s)"), "wallet.dat"));
     strUsage += HelpMessageOpt("-walletbroadcast", _("Make the wallet broadcast transactions") + " " + strprintf(_("(default: %u)"), true));
+    strUsage += HelpMessageOpt("-walletloadthreads=<n>", strprintf(_("Number of threads that read wallet transactions from the wallet file on startup (default: %u)"), DEFAULT_WALLET_LOAD_THREADS));
     strUsage += HelpMessageOpt("-walletnotify=<cmd>", _("Execute command when a wallet transaction changes (%s in cmd is replaced by TxID)"));
+    strUsage += HelpMessageOpt("-witnessthreads=<n>", strprintf(_("Number of threads that update the witnesses of the wallet's shielded notes when a block is connected (default: %u)"), DEFAULT_WITNESS_THREADS));
     strUsage += HelpMessageOpt("-zapwallettxes=<mode>", _("Delete all wallet transactions and only recover those parts of the blockchain through -rescan on startup") +
         " " + _("(1 = keep tx meta data e.g. account owner and payment request information, 2 = drop tx meta data)"));
 #endif
@@ -473,6 +552,13 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-zmqpubhashtx=<address>", _("Enable publish hash transaction in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawblock=<address>", _("Enable publish raw block in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawtx=<address>", _("Enable publish raw transaction in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubpbaasidentity=<address>", _("Enable publish decoded identity updates in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubpbaascurrencystate=<address>", _("Enable publish decoded currency states in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubpbaascrosschain=<address>", _("Enable publish decoded exports and imports in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubpbaasnotarization=<address>", _("Enable publish decoded confirmed notarizations in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubpbaasoffer=<address>", _("Enable publish offers opened and closed in <address>"));
+    strUsage += HelpMessageOpt("-zmqpbaasfilter=<ids>", _("Only publish PBaaS objects for these comma separated identities or currencies"));
+    strUsage += HelpMessageOpt("-zmqpbaasbatch", _("Publish the PBaaS objects of a block together once it is connected (default: 0)"));
 #endif
 
 #if ENABLE_PROTON
@@ -483,9 +569,15 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-amqppubrawtx=<address>", _("Enable publish raw transaction in <address>"));
 #endif
 
+#if ENABLE_ZMQ || ENABLE_PROTON
+    strUsage += HelpMessageOpt("-notificationqueuesize=<n>", strprintf(_("Number of ZMQ or AMQP notifications waiting to be sent at which validation waits or drops the next (default: %u)"), DEFAULT_NOTIFICATION_QUEUE_SIZE));
+    strUsage += HelpMessageOpt("-notificationqueuepolicy=<policy>", strprintf(_("What to do with a notification when the queue is full, block validation until there is room or drop it (block, drop, default: %s)"), DEFAULT_NOTIFICATION_QUEUE_POLICY));
+#endif
+
     strUsage += HelpMessageGroup(_("Debugging/Testing options:"));
     if (showDebug)
     {
+        strUsage += HelpMessageOpt("-checkbalancecache", strprintf("Recompute cached wallet balances on each call and log any that differ (default: %u)", 0));
         strUsage += HelpMessageOpt("-checkpoints", strprintf("Disable expensive verification for known chain history (default: %u)", 1));
         strUsage += HelpMessageOpt("-dblogsize=<n>", strprintf("Flush database activity from memory pool to disk log every <n> megabytes (default: %u)", 100));
         strUsage += HelpMessageOpt("-disablesafemode", strprintf("Disable safemode, override a real safe mode event (default: %u)", 0));
@@ -493,10 +585,11 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-dropmessagestest=<n>", "Randomly drop 1 of every <n> network messages");
         strUsage += HelpMessageOpt("-fuzzmessagestest=<n>", "Randomly fuzz 1 of every <n> network messages");
         strUsage += HelpMessageOpt("-flushwallet", strprintf("Run a thread to flush wallet periodically (default: %u)", 1));
+        strUsage += HelpMessageOpt("-lockholdsample=<n>", strprintf("Time how long locks are held for one in every <n> acquisitions, 0 for none, see getlockstats (default: %u)", DEFAULT_LOCK_HOLD_SAMPLE_INTERVAL));
         strUsage += HelpMessageOpt("-stopafterblockimport", strprintf("Stop running after importing blocks from disk (default: %u)", 0));
         strUsage += HelpMessageOpt("-nuparams=hexBranchId:activationHeight", "Use given activation height for specified network upgrade (regtest-only)");
     }
-    string debugCategories = "addrman, alert, bench, coindb, db, estimatefee, http, libevent, lock, mempool, net, partitioncheck, pow, proxy, prune, "
+    string debugCategories = "addrman, alert, bench, coindb, db, estimatefee, http, leveldb, libevent, lock, mempool, net, partitioncheck, pow, proxy, prune, "
                              "rand, reindex, rpc, selectcoins, tor, zmq, zrpc, zrpcunsafe (implies zrpc)"; // Don't translate these
     strUsage += HelpMessageOpt("-debug=<category>", strprintf(_("Output debugging information (default: %u, supplying <category> is optional)"), 0) + ". " +
         _("If <category> is not supplied or if <category> = 1, output all debugging information.") + " " + _("<category> can be:") + " " + debugCategories + ".");
@@ -542,6 +635,8 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-gen", strprintf(_("Mine/generate coins (default: %u)"), 0));
     strUsage += HelpMessageOpt("-genproclimit=<n>", strprintf(_("Set the number of threads for coin mining if enabled (-1 = all cores, default: %d)"), 0));
     strUsage += HelpMessageOpt("-mineraddress=<addr>", _("Send mined coins to a specific single address"));
+    strUsage += HelpMessageOpt("-minerlanes=<n>", strprintf(_("Number of nonces each mining thread hashes together, 1, 4, or 8 (default: %d)"), 1));
+    strUsage += HelpMessageOpt("-minerthreadaffinity", strprintf(_("Pin each mining thread to its own physical core, filling one CPU package before the next, and keep its hash keys on that core's NUMA node (Linux only, default: %u)"), 0));
     strUsage += HelpMessageOpt("-minetolocalwallet", strprintf(_("Require that mined blocks use a coinbase address in the local wallet (default: %u)"),
  #ifdef ENABLE_WALLET
             1
@@ -564,6 +659,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-miningdistributionpassthrough", _("uses the same miningdistribution values and addresses/IDs as Verus when merge mining"));
     strUsage += HelpMessageOpt("-notarizationperiod=<n>", strprintf(_("Set minimum spacing consensus between cross-chain notarization, in blocks (default: %d, min 10 min)"), CCurrencyDefinition::BLOCK_NOTARIZATION_MODULO));
     strUsage += HelpMessageOpt("-notaryid=<i-address>", _("VerusID used for PBaaS and Ethereum cross-chain notarization"));
+    strUsage += HelpMessageOpt("-notarymonitor", strprintf(_("Check the notary chain or Ethereum bridge on one background thread, which the miner, staker and notarization loops read without waiting (default: %u)"), DEFAULT_NOTARY_MONITOR));
     strUsage += HelpMessageOpt("-notificationoracle=<i-address>", strprintf(_("VerusID monitored for network alerts, triggers, and signals. Current default is \"%s\" for Verus and the chain ID for PBaaS chains"), PBAAS_DEFAULT_NOTIFICATION_ORACLE.c_str()));
     strUsage += HelpMessageOpt("-powaveragingwindow=<n>", strprintf(_("Set averaging window for PoW difficulty adjustment, in blocks (default: %d)"), CCurrencyDefinition::DEFAULT_AVERAGING_WINDOW));
     strUsage += HelpMessageOpt("-testnet", _("loads PBaaS network in testmode"));
@@ -577,13 +673,24 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-rpcport=<port>", strprintf(_("Listen for JSON-RPC connections on <port> (default: %u or testnet: %u)"), 7771, 17771));
     strUsage += HelpMessageOpt("-rpcallowip=<ip>", _("Allow JSON-RPC connections from specified source. Valid for <ip> are a single IP (e.g. 1.2.3.4), a network/netmask (e.g. 1.2.3.4/255.255.255.0) or a network/CIDR (e.g. 1.2.3.4/24). This option can be specified multiple times"));
     strUsage += HelpMessageOpt("-rpcthreads=<n>", strprintf(_("Set the number of threads to service RPC calls (default: %d)"), DEFAULT_HTTP_THREADS));
+    strUsage += HelpMessageOpt("-rpcreservedthreads=<n>", strprintf(_("Number of RPC threads kept for latency critical calls such as getblocktemplate and submitblock (default: %d)"), DEFAULT_HTTP_RESERVED_THREADS));
+    strUsage += HelpMessageOpt("-rpcmethodclass=<method>:<class>", _("Queue calls to an RPC method as critical, normal or heavy. This option can be specified multiple times"));
+    strUsage += HelpMessageOpt("-rpcbatchthreads=<n>", strprintf(_("Set the number of threads that run the read-only calls of a JSON-RPC batch at once, 0 runs batches in order (default: %d)"), DEFAULT_RPC_BATCH_THREADS));
+    strUsage += HelpMessageOpt("-rpcbatchserial=<method>", _("Always run calls to an RPC method in a batch on their own. This option can be specified multiple times"));
+    strUsage += HelpMessageOpt("-maxsubscriptions=<n>", strprintf(_("Keep at most <n> event subscriptions made with the subscribe RPC, 0 disables them (default: %u)"), DEFAULT_MAX_SUBSCRIPTIONS));
+    strUsage += HelpMessageOpt("-subscriptionqueue=<n>", strprintf(_("Keep at most <n> unacknowledged events for each subscription (default: %u)"), DEFAULT_SUBSCRIPTION_QUEUE));
+    strUsage += HelpMessageOpt("-subscriptiontimeout=<n>", strprintf(_("Remove subscriptions that are not polled for <n> seconds (default: %d)"), DEFAULT_SUBSCRIPTION_TIMEOUT));
+    strUsage += HelpMessageOpt("-rpccachedepth=<n>", strprintf(_("Cache the results of RPC calls for blocks, currency states, identities and notarization proofs at heights at least <n> blocks below the tip (default: %d)"), DEFAULT_RPC_CACHE_DEPTH));
+    strUsage += HelpMessageOpt("-rpccachesize=<n>", strprintf(_("Size of the RPC result cache in MiB, 0 disables it (default: %d)"), DEFAULT_RPC_CACHE_SIZE));
+    strUsage += HelpMessageOpt("-rpcslowcallms=<n>", _("Log RPC calls that take at least <n> milliseconds to execute, with their lock waits, index scans and transaction reads, see getslowrpccalls (default: 0, off)"));
+    strUsage += HelpMessageOpt("-rpcmetrics", _("Serve per method RPC call counts and latencies for Prometheus at /metrics on the RPC port, with RPC authentication (default: 0)"));
     if (showDebug) {
         strUsage += HelpMessageOpt("-rpcworkqueue=<n>", strprintf("Set the depth of the work queue to service RPC calls (default: %d)", DEFAULT_HTTP_WORKQUEUE));
         strUsage += HelpMessageOpt("-rpcservertimeout=<n>", strprintf("Timeout during HTTP requests (default: %d)", DEFAULT_HTTP_SERVER_TIMEOUT));
     }
+    strUsage += HelpMessageOpt("-notaryrpcconnections=<n>", strprintf(_("Maximum number of concurrent, persistent RPC connections to each notary or root chain daemon (default: %d)"), DEFAULT_NOTARY_RPC_CONNECTIONS));
 
-    // Disabled until we can lock notes and also tune performance of the prover which by default uses multiple threads
-    //strUsage += HelpMessageOpt("-rpcasyncthreads=<n>", strprintf(_("Set the number of threads to service Async RPC calls (default: %d)"), 1));
+    strUsage += HelpMessageOpt("-rpcasyncthreads=<n>", strprintf(_("Set the number of threads to service Async RPC calls such as z_sendmany, 0 starts one per core (default: %d)"), DEFAULT_RPC_ASYNC_THREADS));
 
     if (mode == HMM_BITCOIND) {
         strUsage += HelpMessageGroup(_("Metrics Options (only if -daemon and -printtoconsole are not set):"));
@@ -720,6 +827,14 @@ void ThreadImport(std::vector<boost::filesystem::path> vImportFiles)
         LogPrintf("Stopping after block import\n");
         StartShutdown();
     }
+
+    // the saved mempool is revalidated against the tip the import left us at, while the node already serves peers
+    if (GetBoolArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL)) {
+        LoadMempool();
+        fDumpMempoolLater = !ShutdownRequested();
+    }
+    // the fee estimates were read with the transactions that were in the mempool at shutdown
+    mempool.PruneFeeEstimates();
 }
 
 void ThreadNotifyRecentlyAdded()
@@ -756,12 +871,9 @@ bool InitSanityCheck(void)
 
 
 static void ZC_LoadParams(
-    const CChainParams& chainparams, bool verified
+    const CChainParams& chainparams, bool verified, boost::thread_group& threadGroup
 )
 {
-    struct timeval tv_start, tv_end;
-    float elapsed;
-
     boost::filesystem::path sapling_spend = ZC_GetParamsDir() / "sapling-spend.params";
     boost::filesystem::path sapling_output = ZC_GetParamsDir() / "sapling-output.params";
     boost::filesystem::path sprout_groth16 = ZC_GetParamsDir() / "sprout-groth16.params";
@@ -793,23 +905,42 @@ static void ZC_LoadParams(
     LogPrintf("Loading Sapling (Spend) parameters from %s\n", sapling_spend.string().c_str());
     LogPrintf("Loading Sapling (Output) parameters from %s\n", sapling_output.string().c_str());
     LogPrintf("Loading Sapling (Sprout Groth16) parameters from %s\n", sprout_groth16.string().c_str());
-    gettimeofday(&tv_start, 0);
-
-    librustzcash_init_zksnark_params(
-        reinterpret_cast<const codeunit*>(sapling_spend_str.c_str()),
-        sapling_spend_str.length(),
-        "8270785a1a0d0bc77196f000ee6d221c9c9894f55307bd9357c3f0105d31ca63991ab91324160d8f53e2bbd3c2633a6eb8bdf5205d822e7f3f73edac51b2b70c",
-        reinterpret_cast<const codeunit*>(sapling_output_str.c_str()),
-        sapling_output_str.length(),
-        "657e3d38dbb5cb5e7dd2970e8b03d69b4787dd907285b5a7f0790dcc8072f60bf593b32cc2d1c030e00ff5ae64bf84c5c3beb84ddc841d48264b4a171744d028",
-        reinterpret_cast<const codeunit*>(sprout_groth16_str.c_str()),
-        sprout_groth16_str.length(),
-        "e9b238411bd6c0ec4791e9d04245ec350c9c5744f5610dfcce4365d5ca49dfefd5054e371842b3f88fa1b9d7e8e075249b3ebabd167fa8b0f3161292d36c180a"
-    );
-
-    gettimeofday(&tv_end, 0);
-    elapsed = float(tv_end.tv_sec-tv_start.tv_sec) + (tv_end.tv_usec-tv_start.tv_usec)/float(1000000);
-    LogPrintf("Loaded Sapling parameters in %fs seconds.\n", elapsed);
+
+    auto loadParams = [sapling_spend_str, sapling_output_str, sprout_groth16_str]()
+    {
+        struct timeval tv_start, tv_end;
+        float elapsed;
+        gettimeofday(&tv_start, 0);
+
+        librustzcash_init_zksnark_params(
+            reinterpret_cast<const codeunit*>(sapling_spend_str.c_str()),
+            sapling_spend_str.length(),
+            "8270785a1a0d0bc77196f000ee6d221c9c9894f55307bd9357c3f0105d31ca63991ab91324160d8f53e2bbd3c2633a6eb8bdf5205d822e7f3f73edac51b2b70c",
+            reinterpret_cast<const codeunit*>(sapling_output_str.c_str()),
+            sapling_output_str.length(),
+            "657e3d38dbb5cb5e7dd2970e8b03d69b4787dd907285b5a7f0790dcc8072f60bf593b32cc2d1c030e00ff5ae64bf84c5c3beb84ddc841d48264b4a171744d028",
+            reinterpret_cast<const codeunit*>(sprout_groth16_str.c_str()),
+            sprout_groth16_str.length(),
+            "e9b238411bd6c0ec4791e9d04245ec350c9c5744f5610dfcce4365d5ca49dfefd5054e371842b3f88fa1b9d7e8e075249b3ebabd167fa8b0f3161292d36c180a"
+        );
+
+        gettimeofday(&tv_end, 0);
+        elapsed = float(tv_end.tv_sec-tv_start.tv_sec) + (tv_end.tv_usec-tv_start.tv_usec)/float(1000000);
+        LogPrintf("Loaded Sapling parameters in %fs seconds.\n", elapsed);
+        ZC_SetParamsLoading(false);
+    };
+
+    // the parameters are only needed once blocks or transactions are verified or proofs are made, so they may load
+    // while the block index and wallet do
+    if (GetBoolArg("-loadparamsasync", DEFAULT_LOAD_PARAMS_ASYNC))
+    {
+        ZC_SetParamsLoading(true);
+        threadGroup.create_thread(boost::bind(&TraceThread<std::function<void()>>, "loadparams", std::function<void()>(loadParams)));
+    }
+    else
+    {
+        loadParams();
+    }
 }
 
 bool AppInitServers(boost::thread_group& threadGroup)
@@ -866,6 +997,11 @@ bool AppInitNetworking()
     return true;
 }
 
+CScheduler* GetMainScheduler()
+{
+    return pschedulerMain;
+}
+
 bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
 {
 #ifndef _WIN32
@@ -986,7 +1122,14 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     // Make sure enough file descriptors are available
     int nBind = std::max((int)mapArgs.count("-bind") + (int)mapArgs.count("-whitebind"), 1);
     nMaxConnections = GetArg("-maxconnections", DEFAULT_MAX_PEER_CONNECTIONS);
-    nMaxConnections = std::max(std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS)), 0);
+    std::string strSocketEvents = GetArg("-socketevents", SocketEventsModeName(DEFAULT_SOCKETEVENTS));
+    if (!ParseSocketEventsMode(strSocketEvents, nSocketEventsMode))
+        return InitError(strprintf(_("Unsupported -socketevents mode '%s'"), strSocketEvents));
+    // only select is bound to descriptors below FD_SETSIZE, the descriptor limit is raised below for the others
+    if (nSocketEventsMode == SOCKETEVENTS_SELECT)
+        nMaxConnections = std::max(std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS)), 0);
+    else
+        nMaxConnections = std::max(nMaxConnections, 0);
     int nFD = RaiseFileDescriptorLimit(nMaxConnections + MIN_CORE_FILEDESCRIPTORS);
     if (nFD < MIN_CORE_FILEDESCRIPTORS)
         return InitError(_("Not enough file descriptors available."));
@@ -1044,7 +1187,26 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
         mempool.setSanityCheck(1.0 / ratio);
     }
     fCheckBlockIndex = GetBoolArg("-checkblockindex", chainparams.DefaultConsistencyChecks());
+    SetLockHoldSampleInterval(GetArg("-lockholdsample", DEFAULT_LOCK_HOLD_SAMPLE_INTERVAL));
     fCheckpointsEnabled = GetBoolArg("-checkpoints", true);
+    fCompressBlockFiles = GetBoolArg("-compressblocks", DEFAULT_COMPRESS_BLOCK_FILES);
+    hashAssumeValid = uint256S(GetArg("-assumevalid", "0"));
+    if (!hashAssumeValid.IsNull())
+        LogPrintf("Assuming ancestors of block %s have valid signatures.\n", hashAssumeValid.GetHex());
+    if (mapArgs.count("-assumenotarized"))
+    {
+        std::vector<std::string> anchorParts;
+        boost::split(anchorParts, mapArgs["-assumenotarized"], boost::is_any_of(":"));
+        if (anchorParts.size() != 3 || !ParseInt32(anchorParts[0], &nAssumeNotarizedHeight) || nAssumeNotarizedHeight < 0 ||
+            !IsHex(anchorParts[1]) || anchorParts[1].size() != 64 || !IsHex(anchorParts[2]) || anchorParts[2].size() != 64)
+        {
+            return InitError(_("-assumenotarized must be the height, block hash and state root of a notarization proof root"));
+        }
+        hashAssumeNotarizedBlock = uint256S(anchorParts[1]);
+        hashAssumeNotarizedMMRRoot = uint256S(anchorParts[2]);
+        LogPrintf("Assuming ancestors of notarized block %s at height %d are valid, once our headers match its chain MMR root\n",
+                  hashAssumeNotarizedBlock.GetHex(), nAssumeNotarizedHeight);
+    }
 
     // -par=0 means autodetect, but nScriptCheckThreads==0 means no concurrency
     nScriptCheckThreads = GetArg("-par", DEFAULT_SCRIPTCHECK_THREADS);
@@ -1069,6 +1231,7 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
         }
         LogPrintf("Prune configured to target %uMiB on disk for block and undo files.\n", nPruneTarget / 1024 / 1024);
         fPruneMode = true;
+        fPruneProofs = GetBoolArg("-pruneproofs", DEFAULT_PRUNE_PROOFS);
     }
 
     RegisterAllCoreRPCCommands(tableRPC);
@@ -1168,6 +1331,12 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     if (GetBoolArg("-peerbloomfilters", true))
         nLocalServices |= NODE_BLOOM;
 
+    if (GetBoolArg("-peerblockfilters", DEFAULT_PEERBLOCKFILTERS)) {
+        if (!GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX))
+            return InitError(_("-peerblockfilters requires -blockfilterindex"));
+        nLocalServices |= NODE_COMPACT_FILTERS;
+    }
+
     nMaxTipAge = GetArg("-maxtipage", DEFAULT_MAX_TIP_AGE);
 
 #ifdef ENABLE_MINING
@@ -1414,6 +1583,7 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     if (fPrintToDebugLog)
         OpenDebugLog();
     LogPrintf("Using OpenSSL version %s\n", SSLeay_version(SSLEAY_VERSION));
+    LogPrintf("Using SHA256 implementation %s\n", GetSHA256KernelName());
 #ifdef ENABLE_WALLET
     LogPrintf("Using BerkeleyDB version %s\n", DbEnv::version(0, 0, 0));
 #endif
@@ -1428,12 +1598,17 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     LogPrintf("Using %u threads for script verification\n", nScriptCheckThreads);
     if (nScriptCheckThreads) {
         for (int i=0; i<nScriptCheckThreads-1; i++)
+        {
             threadGroup.create_thread(&ThreadScriptCheck);
+        }
     }
 
-    // Start the lightweight task scheduler thread
+    // Start the lightweight task scheduler threads, so a slow task only holds up the tasks in its domain
+    pschedulerMain = &scheduler;
     CScheduler::Function serviceLoop = boost::bind(&CScheduler::serviceQueue, &scheduler);
-    threadGroup.create_thread(boost::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
+    int nSchedulerThreads = std::max(1, std::min(16, (int)GetArg("-schedulerthreads", DEFAULT_SCHEDULER_THREADS)));
+    for (int i = 0; i < nSchedulerThreads; i++)
+        threadGroup.create_thread(boost::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
 
     // Count uptime
     MarkStartTime();
@@ -1460,7 +1635,7 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     }
 
     // Initialize Zcash circuit parameters
-    ZC_LoadParams(chainparams, paramsVerified);
+    ZC_LoadParams(chainparams, paramsVerified, threadGroup);
 
     /* Start the RPC server already.  It will be started in "warmup" mode
      * and not really process calls already (but it will signify connections
@@ -1638,6 +1813,14 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
             return InitError(strprintf(_("Cannot find trusted certificates directory: '%s'"), pathTLSTrustredDir.string()));
     }
 
+    int nMaxSubscriptions = GetArg("-maxsubscriptions", DEFAULT_MAX_SUBSCRIPTIONS);
+    if (nMaxSubscriptions > 0) {
+        pSubscriptionIndex = new CSubscriptionIndex(nMaxSubscriptions,
+                                                    std::max((int64_t)1, GetArg("-subscriptionqueue", DEFAULT_SUBSCRIPTION_QUEUE)),
+                                                    std::max((int64_t)1, GetArg("-subscriptiontimeout", DEFAULT_SUBSCRIPTION_TIMEOUT)));
+        RegisterValidationInterface(pSubscriptionIndex);
+    }
+
 #if ENABLE_ZMQ
     pzmqNotificationInterface = CZMQNotificationInterface::CreateWithArguments(mapArgs);
 
@@ -1730,6 +1913,9 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     LogPrintf("* Using %d max open files\n", dbMaxOpenFiles);
     LogPrintf("* Compression is %s\n", dbCompression ? "enabled" : "disabled");
 
+    CIdentity::IdentityLookupCache.SetCapacity(GetArg("-identitycachesize", CIdentity::DEFAULT_LOOKUP_CACHE_SIZE));
+    SetTransactionCacheSize(GetArg("-txcachesize", DEFAULT_TX_CACHE_SIZE));
+
     // cache size calculations
     int64_t nTotalCache = (GetArg("-dbcache", nDefaultDbCache) << 20);
     nTotalCache = std::max(nTotalCache, nMinDbCache << 20); // total cache cannot be less than nMinDbCache
@@ -1744,6 +1930,7 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
             nBlockTreeDBCache = (1 << 21); // block tree db cache shouldn't be larger than 2 MiB
         }
     }
+    int64_t nIndexDBCache = std::min(std::max(GetArg("-indexdbcache", 0), (int64_t)0) << 20, nBlockTreeDBCache);
     nTotalCache -= nBlockTreeDBCache;
     int64_t nCoinDBCache = std::min(nTotalCache / 2, (nTotalCache / 4) + (1 << 23)); // use 25%-50% of the remainder for disk cache
     nTotalCache -= nCoinDBCache;
@@ -1757,10 +1944,11 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     if ( fReindex == 0 )
     {
         bool checkval,fAddressIndex,fSpentIndex,fTimeStampIndex;
-        pblocktree = new CBlockTreeDB(nBlockTreeDBCache, false, fReindex, dbCompression, dbMaxOpenFiles);
+        pblocktree = new CBlockTreeDB(nBlockTreeDBCache, false, fReindex, dbCompression, dbMaxOpenFiles, nIndexDBCache);
 
         fAddressIndex = true;
-        pblocktree->ReadFlag("addressindex", checkval);
+        bool fExistingDB = pblocktree->ReadFlag("addressindex", checkval);
+        bool fBackgroundIndex = fExistingDB && GetBoolArg("-backgroundindex", DEFAULT_BACKGROUND_INDEX);
         if ( checkval != fAddressIndex  )
         {
             pblocktree->WriteFlag("addressindex", fAddressIndex);
@@ -1797,22 +1985,86 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
         }
         */
 
+        // the address and spent indexes are always kept, so enabling the insight explorer only adds the timestamp
+        // index, which can be built in the background
         pblocktree->ReadFlag("insightexplorer", checkval);
         fInsightExplorer = GetBoolArg("-insightexplorer", checkval);
         if ( checkval != fInsightExplorer )
         {
             pblocktree->WriteFlag("insightexplorer", fInsightExplorer);
-            fprintf(stderr,"set insightexplorer, will reindex. sorry will take a while.\n");
-            fReindex = true;
+            if (fInsightExplorer && fBackgroundIndex && StartIndexBuild(BACKGROUND_INDEX_TIMESTAMP))
+            {
+                fprintf(stderr,"set insightexplorer, building timestamp index in the background.\n");
+            }
+            else
+            {
+                fprintf(stderr,"set insightexplorer, will reindex. sorry will take a while.\n");
+                fReindex = true;
+            }
         }
 
+        // block delta summaries are only written from here on, getblockdeltas looks up older blocks as before
+        fBlockDeltaIndex = fInsightExplorer && GetBoolArg("-blockdeltaindex", DEFAULT_BLOCKDELTAINDEX);
+
+        fUTXOStats = GetBoolArg("-utxostats", DEFAULT_UTXOSTATS);
+
         fTimeStampIndex = GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX);
         pblocktree->ReadFlag("timestampindex", checkval);
         if ( checkval != fTimeStampIndex )
         {
             pblocktree->WriteFlag("timestampindex", fTimeStampIndex);
-            fprintf(stderr,"set timestampindex, will reindex. sorry will take a while.\n");
-            fReindex = true;
+            if (fTimeStampIndex && fBackgroundIndex && StartIndexBuild(BACKGROUND_INDEX_TIMESTAMP))
+            {
+                fprintf(stderr,"set timestampindex, building it in the background.\n");
+            }
+            else
+            {
+                fprintf(stderr,"set timestampindex, will reindex. sorry will take a while.\n");
+                fReindex = true;
+            }
+        }
+
+        // filter headers chain from the genesis block, so the filters of an existing database are built in the background.
+        // those of a new database are written as its blocks are connected
+        bool fFilterIndexFlag = false;
+        pblocktree->ReadFlag("blockfilterindex", fFilterIndexFlag);
+        fBlockFilterIndex = GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX);
+        if ( fFilterIndexFlag != fBlockFilterIndex )
+        {
+            pblocktree->WriteFlag("blockfilterindex", fBlockFilterIndex);
+            if (fBlockFilterIndex && fBackgroundIndex && StartIndexBuild(BACKGROUND_INDEX_BLOCKFILTER))
+            {
+                fprintf(stderr,"set blockfilterindex, building it in the background.\n");
+            }
+            else if (fBlockFilterIndex && fExistingDB)
+            {
+                fprintf(stderr,"set blockfilterindex, will reindex. sorry will take a while.\n");
+                fReindex = true;
+            }
+        }
+
+        // the PBaaS counters come from the reserve descriptors made as each block is connected, which depend on the chain
+        // state at that block, so enabling the stats index on an existing database reindexes instead of building it in
+        // the background
+        bool fStatsIndexFlag = false;
+        pblocktree->ReadFlag("blockstatsindex", fStatsIndexFlag);
+        fBlockStatsIndex = GetBoolArg("-blockstatsindex", DEFAULT_BLOCKSTATSINDEX);
+        if ( fStatsIndexFlag != fBlockStatsIndex )
+        {
+            pblocktree->WriteFlag("blockstatsindex", fBlockStatsIndex);
+            if (fBlockStatsIndex && fExistingDB)
+            {
+                fprintf(stderr,"set blockstatsindex, will reindex. sorry will take a while.\n");
+                fReindex = true;
+            }
+        }
+
+        // databases created before the address balance index get it built in the background
+        if (fBackgroundIndex && !fReindex &&
+            (!pblocktree->ReadFlag("addressbalanceindex", checkval) || !checkval) &&
+            StartIndexBuild(BACKGROUND_INDEX_ADDRESSBALANCE))
+        {
+            pblocktree->WriteFlag("addressbalanceindex", true);
         }
     }
 
@@ -1835,8 +2087,34 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
                 delete pblocktree;
                 delete pnotarisations;
 
-                pblocktree = new CBlockTreeDB(nBlockTreeDBCache, false, fReindex, dbCompression, dbMaxOpenFiles);
+                pblocktree = new CBlockTreeDB(nBlockTreeDBCache, false, fReindex, dbCompression, dbMaxOpenFiles, nIndexDBCache);
+                if (!pblocktree->CheckCurrencyStateIndexVersion()) {
+                    strLoadError = _("Error upgrading currency state index");
+                    break;
+                }
                 pcoinsdbview = new CCoinsViewDB(nCoinDBCache, false, fReindex);
+                pcoinsdbview->SetBackgroundWrites(GetBoolArg("-backgroundflush", DEFAULT_BACKGROUND_FLUSH));
+
+                // load a chainstate snapshot into a new coins database, before anything reads from it
+                bool fLoadedSnapshot = false;
+                if (!fReindex && mapArgs.count("-loadchainstate") && pcoinsdbview->GetBestBlock().IsNull())
+                {
+                    uiInterface.InitMessage(_("Loading chainstate snapshot..."));
+                    CCoinsSnapshotInfo snapshotInfo;
+                    std::string strSnapshotError;
+                    boost::filesystem::path snapshotPath = boost::filesystem::absolute(GetArg("-loadchainstate", ""), GetDataDir());
+                    if (!pcoinsdbview->LoadSnapshot(snapshotPath, ASSETCHAINS_CHAINID, snapshotInfo, strSnapshotError))
+                    {
+                        return InitError(strprintf(_("Unable to load chainstate snapshot: %s"), strSnapshotError));
+                    }
+                    LogPrintf("Loaded chainstate snapshot at block %s\n", snapshotInfo.hashBlock.GetHex());
+                    fLoadedSnapshot = true;
+                }
+                if (GetBoolArg("-nullifierfilter", DEFAULT_NULLIFIER_FILTER))
+                {
+                    pcoinsdbview->StartNullifierFilter();
+                }
+
                 pcoinscatcher = new CCoinsViewErrorCatcher(pcoinsdbview);
                 pcoinsTip = new CCoinsViewCache(pcoinscatcher);
                 pnotarisations = new NotarisationDB(100*1024*1024, false, fReindex);
@@ -1854,11 +2132,26 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
                     break;
                 }
 
+                // a snapshot can only become the chain tip if its block and all of its ancestors are in our block files
+                if (fLoadedSnapshot && (chainActive.LastTip() == NULL || chainActive.LastTip()->GetBlockHash() != pcoinsTip->GetBestBlock()))
+                {
+                    strLoadError = _("The block of the -loadchainstate snapshot is not in the block database, which must already contain the blocks up to it");
+                    break;
+                }
+                if (fLoadedSnapshot && !hashAssumeNotarizedBlock.IsNull() && pcoinsTip->GetBestBlock() != hashAssumeNotarizedBlock)
+                {
+                    strLoadError = _("The -loadchainstate snapshot is not of the -assumenotarized block");
+                    break;
+                }
+
                 // If the loaded chain has a wrong genesis, bail out immediately
                 // (we're likely using a testnet datadir, or the other way around).
                 if (!mapBlockIndex.empty() && mapBlockIndex.count(chainparams.GetConsensus().hashGenesisBlock) == 0)
                     return InitError(_("Incorrect or no genesis block found. Wrong datadir for network?"));
 
+                // before any block is connected, which the statistics must follow
+                LoadUTXOSetStats();
+
                 // Initialize the block index (no-op if non-empty database was already loaded)
                 if (!InitBlockIndex(chainparams)) {
                     strLoadError = _("Error initializing block database");
@@ -2282,6 +2575,9 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
             vImportFiles.push_back(strFile);
     }
     threadGroup.create_thread(boost::bind(&ThreadImport, vImportFiles));
+    threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "indexbuild", &ThreadBuildIndexes));
+    if (fUTXOStats)
+        StartUTXOSetStats(threadGroup, pcoinsdbview);
     if (chainActive.Tip() == NULL) {
         LogPrintf("Waiting for genesis block to be imported...\n");
         while (!fRequestShutdown && chainActive.Tip() == NULL)
@@ -2316,6 +2612,11 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     StartNode(threadGroup, scheduler);
 
+    if (GetBoolArg("-notarymonitor", DEFAULT_NOTARY_MONITOR))
+    {
+        threadGroup.create_thread(boost::bind(&CConnectedChains::NotaryMonitorThreadStub));
+    }
+
     bool gen = GetBoolArg("-gen", false);
 
 #ifdef ENABLE_MINING
@@ -2335,7 +2636,7 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     // Monitor the chain every minute, and alert if we get blocks much quicker or slower than expected.
     CScheduler::Function f = boost::bind(&PartitionCheck, &IsInitialBlockDownload,
                                          boost::ref(cs_main), boost::cref(pindexBestHeader));
-    scheduler.scheduleEvery(f, 60);
+    scheduler.scheduleEvery(f, 60, CScheduler::TaskOptions("partitioncheck", CScheduler::PRIORITY_HIGH));
 
     // ********************************************************* Step 11: finished
 
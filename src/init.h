@@ -28,6 +28,8 @@ void Interrupt(boost::thread_group& threadGroup);
 void Shutdown();
 bool AppInitNetworking();
 bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler);
+/** The scheduler that AppInit2 started, or NULL before it has */
+CScheduler* GetMainScheduler();
 
 /** The help message mode determines what help message to show */
 enum HelpMessageMode {
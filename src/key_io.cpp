@@ -8,6 +8,7 @@
 #include <base58.h>
 #include <bech32.h>
 #include <script/script.h>
+#include <lrucache.h>
 #include <utilstrencodings.h>
 
 #include <boost/variant/apply_visitor.hpp>
@@ -499,6 +500,34 @@ public:
     std::string operator()(const libzcash::InvalidEncoding& no) const { return {}; }
 };
 
+// the ID that the encoding of a destination is cached by
+class DestinationCacheID : public boost::static_visitor<bool>
+{
+private:
+    uint160 &m_id;
+
+public:
+    DestinationCacheID(uint160 &id) : m_id(id) {}
+
+    bool operator()(const CKeyID& id) const { m_id = id; return true; }
+    bool operator()(const CPubKey& key) const { m_id = key.GetID(); return true; }
+    bool operator()(const CScriptID& id) const { m_id = id; return true; }
+    bool operator()(const CIdentityID& id) const { m_id = id; return true; }
+    bool operator()(const CIndexID& id) const { m_id = id; return true; }
+    bool operator()(const CQuantumID& id) const { m_id = id; return true; }
+    bool operator()(const CNoDestination& no) const { return false; }
+};
+
+// building JSON for blocks and transactions encodes the same few addresses over and over, and each base58check
+// encoding costs a double SHA256, so recent encodings are kept
+const int DESTINATION_ENCODING_CACHE_SIZE = 20000;
+
+ShardedLRUCache<std::tuple<uintptr_t, int, uint160>, std::string> &EncodedDestinationCache()
+{
+    static ShardedLRUCache<std::tuple<uintptr_t, int, uint160>, std::string> cache(DESTINATION_ENCODING_CACHE_SIZE, 0, true);
+    return cache;
+}
+
 // Sizes of SaplingPaymentAddress, SaplingExtendedFullViewingKey, and
 // SaplingExtendedSpendingKey after ConvertBits<8, 5, true>(). The calculations
 // below take the regular serialized size in bytes, convert to bits, and then
@@ -596,7 +625,21 @@ std::string EncodeExtKey(const CExtKey& key)
 
 std::string EncodeDestination(const CTxDestination& dest)
 {
-    return boost::apply_visitor(DestinationEncoder(Params()), dest);
+    uint160 id;
+    if (!boost::apply_visitor(DestinationCacheID(id), dest))
+    {
+        return boost::apply_visitor(DestinationEncoder(Params()), dest);
+    }
+
+    // the parameters are part of the key, since tests switch networks
+    std::tuple<uintptr_t, int, uint160> key((uintptr_t)&Params(), dest.which(), id);
+    std::string encoded;
+    if (!EncodedDestinationCache().Get(key, encoded))
+    {
+        encoded = boost::apply_visitor(DestinationEncoder(Params()), dest);
+        EncodedDestinationCache().Put(key, encoded);
+    }
+    return encoded;
 }
 
 std::vector<unsigned char> GetDestinationBytes(const CTxDestination& dest)
@@ -791,12 +834,12 @@ CReserveTransfer::CReserveTransfer(const UniValue &uni) : CTokenOutput(uni), nFe
 
 CReserveTransfer::CReserveTransfer(const CScript &script) : flags(0)
 {
-    COptCCParams p;
-    if (script.IsPayToCryptoCondition(p) && p.IsValid())
+    COptCCParamsView p(script);
+    if (p.IsPayToCryptoCondition() && p.IsValid())
     {
         if (p.evalCode == EVAL_RESERVE_TRANSFER && p.vData.size())
         {
-            FromVector(p.vData[0], *this);
+            FromSpan(p.vData[0].pBegin, p.vData[0].pEnd, *this);
         }
     }
 }
@@ -1705,10 +1748,10 @@ CNameReservation::CNameReservation(const CTransaction &tx, int *pOutNum)
 
 CIdentity::CIdentity(const CScript &scriptPubKey)
 {
-    COptCCParams p;
-    if (IsPayToCryptoCondition(scriptPubKey, p) && p.IsValid() && p.evalCode == EVAL_IDENTITY_PRIMARY && p.vData.size())
+    COptCCParamsView p(scriptPubKey);
+    if (p.IsPayToCryptoCondition() && p.IsValid() && p.evalCode == EVAL_IDENTITY_PRIMARY && p.vData.size())
     {
-        *this = CIdentity(p.vData[0]);
+        ::FromSpan(p.vData[0].pBegin, p.vData[0].pEnd, *this);
     }
 }
 
@@ -732,7 +732,13 @@ int32_t komodo_blockload(CBlock& block,CBlockIndex *pindex)
     if (filein.IsNull())
         return(-1);
     // Read block
-    try { filein >> block; }
+    try
+    {
+        std::unique_ptr<CDataStream> pRecord = ReadCompressedDiskRecord(filein);
+        if ( pRecord )
+            *pRecord >> block;
+        else filein >> block;
+    }
     catch (const std::exception& e)
     {
         fprintf(stderr,"readblockfromdisk err B\n");
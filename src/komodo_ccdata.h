@@ -19,7 +19,7 @@
 struct komodo_ccdata *CC_data;
 int32_t CC_firstheight;
 
-uint256 BuildMerkleTree(bool* fMutated, const std::vector<uint256> leaves, std::vector<uint256> &vMerkleTree);
+uint256 BuildMerkleTree(bool* fMutated, const std::vector<uint256> &leaves, std::vector<uint256> &vMerkleTree);
 
 uint256 komodo_calcMoM(int32_t height,int32_t MoMdepth)
 {
@@ -53,12 +53,100 @@ uint64_t komodo_kvfee(uint32_t flags,int32_t opretlen,int32_t keylen)
     return(fee);
 }
 
+// parses a 'K' OP_RETURN output into the key, value and declared owner and signature of the update, if it pays enough of a
+// fee for its size
+bool komodo_kvparse(const CTxOut &out,std::vector<uint8_t> &key,std::vector<uint8_t> &value,uint32_t &flags,uint256 &pubkey,uint256 &sig)
+{
+    std::vector<uint8_t> opret; opcodetype opcode; uint16_t keylen,valuesize; int32_t height,coresize,opretlen;
+    CScript::const_iterator pc = out.scriptPubKey.begin();
+    if ( ASSETCHAINS_SYMBOL[0] == 0 || out.scriptPubKey.size() < 2 || out.scriptPubKey[0] != OP_RETURN )
+        return(false);
+    pc++;
+    if ( !out.scriptPubKey.GetOp(pc,opcode,opret) || (opretlen= (int32_t)opret.size()) < 13 || opret[0] != 'K' || opretlen == 40 )
+        return(false);
+    iguana_rwnum(0,&opret[1],sizeof(keylen),&keylen);
+    iguana_rwnum(0,&opret[3],sizeof(valuesize),&valuesize);
+    iguana_rwnum(0,&opret[5],sizeof(height),&height);
+    iguana_rwnum(0,&opret[9],sizeof(flags),&flags);
+    coresize = (int32_t)(sizeof(flags)+sizeof(height)+sizeof(keylen)+sizeof(valuesize)+keylen+valuesize+1);
+    if ( keylen == 0 || valuesize > IGUANA_MAXSCRIPTSIZE || out.nValue < 0 || (uint64_t)out.nValue < komodo_kvfee(flags,opretlen,keylen) )
+        return(false);
+    if ( opretlen != coresize && opretlen != coresize+sizeof(uint256) && opretlen != coresize+2*sizeof(uint256) )
+        return(false);
+    key.assign(&opret[13],&opret[13+keylen]);
+    value.assign(&opret[13+keylen],&opret[13+keylen+valuesize]);
+    pubkey.SetNull();
+    sig.SetNull();
+    if ( opretlen >= coresize+sizeof(uint256) )
+        memcpy(pubkey.begin(),&opret[coresize],sizeof(uint256));
+    if ( opretlen == coresize+2*sizeof(uint256) )
+        memcpy(sig.begin(),&opret[coresize+sizeof(uint256)],sizeof(uint256));
+    return(true);
+}
+
+// makes the key value index entry of an output confirmed at height, if it is an update that the current owner of its
+// key signed. latest holds the state of the keys updated earlier in the same block, and is updated with this entry.
+bool komodo_kvindexentry(const CTxOut &out,const uint256 &txid,uint32_t txindex,uint32_t vout,int32_t height,std::map<uint256,CKVIndexEntry> &latest,CKVIndexEntry &entry)
+{
+    std::vector<uint8_t> key,value,keyvalue; uint32_t flags; uint256 pubkey,sig; CKVIndexEntry prev; bool haveprev = false;
+    const char *tstr = "transfer:"; int32_t i,tlen = (int32_t)strlen(tstr);
+    if ( !komodo_kvparse(out,key,value,flags,pubkey,sig) )
+        return(false);
+    uint256 keyhash = Hash(key.begin(),key.end());
+    std::map<uint256,CKVIndexEntry>::iterator it = latest.find(keyhash);
+    if ( it != latest.end() )
+        prev = it->second, haveprev = true;
+    else haveprev = pblocktree->ReadKVIndex(keyhash,height - 1,prev);
+    // an expired key is free for anyone to claim again
+    if ( haveprev && (prev.second.key != key || height > (int32_t)prev.first.height + komodo_kvduration(prev.second.flags)) )
+        haveprev = false;
+    if ( haveprev && !prev.second.owner.IsNull() )
+    {
+        keyvalue = key;
+        keyvalue.insert(keyvalue.end(),prev.second.value.begin(),prev.second.value.end());
+        if ( komodo_kvsigverify(&keyvalue[0],(int32_t)keyvalue.size(),prev.second.owner,sig) < 0 )
+            return(false);
+    }
+    entry.first = CKVIndexKey(keyhash,height,txindex,vout);
+    entry.second.txid = txid;
+    entry.second.key = key;
+    entry.second.flags = flags;
+    entry.second.owner = pubkey;
+    entry.second.value = value;
+    if ( haveprev )
+    {
+        std::string transferpubstr(value.begin(),value.end());
+        if ( (int32_t)transferpubstr.size() == tlen+64 && transferpubstr.compare(0,tlen,tstr) == 0 && IsHex(transferpubstr.substr(tlen)) )
+        {
+            for (i=0; i<32; i++)
+                entry.second.owner.begin()[31-i] = _decode_hex(&transferpubstr[tlen+i*2]);
+        }
+        if ( (prev.second.flags & KOMODO_KVPROTECTED) != 0 )
+            entry.second.value = prev.second.value;
+    }
+    latest[keyhash] = entry;
+    return(true);
+}
+
 int32_t komodo_kvsearch(uint256 *pubkeyp,int32_t current_height,uint32_t *flagsp,int32_t *heightp,uint8_t value[IGUANA_MAXSCRIPTSIZE],uint8_t *key,int32_t keylen)
 {
     struct komodo_kv *ptr; int32_t duration,retval = -1;
     *heightp = -1;
     *flagsp = 0;
     memset(pubkeyp,0,sizeof(*pubkeyp));
+    if ( fKVIndex )
+    {
+        CKVIndexEntry entry;
+        if ( !pblocktree->ReadKVIndex(Hash(key,key+keylen),0,entry) || entry.second.key != std::vector<uint8_t>(key,key+keylen) ||
+             current_height > (int32_t)entry.first.height + komodo_kvduration(entry.second.flags) )
+            return(-1);
+        *heightp = entry.first.height;
+        *flagsp = entry.second.flags;
+        *pubkeyp = entry.second.owner;
+        if ( (retval= (int32_t)entry.second.value.size()) > 0 )
+            memcpy(value,&entry.second.value[0],retval);
+        return(retval);
+    }
     portable_mutex_lock(&KOMODO_KV_mutex);
     HASH_FIND(hh,KOMODO_KV,key,keylen,ptr);
     if ( ptr != 0 )
@@ -103,6 +191,8 @@ void komodo_kvupdate(uint8_t *opretbuf,int32_t opretlen,uint64_t value)
     uint32_t flags; uint256 pubkey,refpubkey,sig; int32_t i,refvaluesize,hassig,coresize,haspubkey,height,kvheight; uint16_t keylen,valuesize,newflag = 0; uint8_t *key,*valueptr,keyvalue[IGUANA_MAXSCRIPTSIZE*8]; struct komodo_kv *ptr; char *transferpubstr,*tstr; uint64_t fee;
     if ( ASSETCHAINS_SYMBOL[0] == 0 ) // disable KV for KMD
         return;
+    if ( fKVIndex ) // updates are indexed as their blocks are connected
+        return;
     iguana_rwnum(0,&opretbuf[1],sizeof(keylen),&keylen);
     iguana_rwnum(0,&opretbuf[3],sizeof(valuesize),&valuesize);
     iguana_rwnum(0,&opretbuf[5],sizeof(height),&height);
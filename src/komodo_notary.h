@@ -553,131 +553,87 @@ const char *Notaries_elected7[][2] =
     {"dragonhound_DEV", "02a473e980bf0d198ece8ed11f1ecbe437edb688de6c83b82efa6f7de3a5d43c19"}
 };
 
-int32_t komodo_notaries(uint8_t pubkeys[64][33],int32_t height,uint32_t timestamp)
+// the elected notary sets, decoded once, each with a hash from pubkey to notary ID so that finding a notary does not
+// scan its set
+struct komodo_elected_set { int32_t numnotaries; uint8_t pubkeys[64][33]; struct knotary_entry *Notaries; };
+
+#define KOMODO_ELECTED_SET(notaries) { (const char *(*)[2])notaries, (int32_t)(sizeof(notaries)/sizeof(*notaries)) }
+
+static struct komodo_elected_set *komodo_build_elected_sets()
+{
+    static const struct { const char *(*notaries)[2]; int32_t n; } elected[] =
+    {
+        KOMODO_ELECTED_SET(Notaries_elected0),
+        KOMODO_ELECTED_SET(Notaries_elected1),
+        KOMODO_ELECTED_SET(Notaries_elected2),
+        KOMODO_ELECTED_SET(Notaries_elected4),
+        KOMODO_ELECTED_SET(Notaries_elected5),
+        KOMODO_ELECTED_SET(Notaries_elected6),
+        KOMODO_ELECTED_SET(Notaries_elected7)
+    };
+    static struct komodo_elected_set sets[sizeof(elected)/sizeof(*elected)];
+    int32_t i,k; struct knotary_entry *kp;
+    for (i=0; i<sizeof(elected)/sizeof(*elected); i++)
+    {
+        sets[i].numnotaries = elected[i].n;
+        for (k=0; k<elected[i].n; k++)
+        {
+            decode_hex(sets[i].pubkeys[k],33,(char *)elected[i].notaries[k][1]);
+            // a pubkey listed twice is found as its first notary ID, as when the set was scanned
+            HASH_FIND(hh,sets[i].Notaries,sets[i].pubkeys[k],33,kp);
+            if ( kp != 0 )
+                continue;
+            kp = (struct knotary_entry *)calloc(1,sizeof(*kp));
+            memcpy(kp->pubkey,sets[i].pubkeys[k],33);
+            kp->notaryid = k;
+            HASH_ADD_KEYPTR(hh,sets[i].Notaries,kp->pubkey,33,kp);
+        }
+    }
+    return(sets);
+}
+
+static struct komodo_elected_set *komodo_elected_sets()
+{
+    // built on first use, which is thread safe for a function static
+    static struct komodo_elected_set *sets = komodo_build_elected_sets();
+    return(sets);
+}
+
+// the index of the elected set active at a height and time, or -1 before the sets were hardcoded, when the notaries
+// elected on chain in Pubkeys are used
+static int32_t komodo_elected_index(int32_t height,uint32_t timestamp)
 {
-    static uint8_t elected_pubkeys0[64][33],
-                   elected_pubkeys1[64][33],
-                   elected_pubkeys2[64][33],
-                   elected_pubkeys4[64][33],
-                   elected_pubkeys5[64][33],
-                   elected_pubkeys6[64][33],
-                   elected_pubkeys7[64][33],
-                   did0,
-                   did1,
-                   did2,
-                   did4,
-                   did5,
-                   did6,
-                   did7;
-
-    static int32_t n0, n1, n2, n4, n5, n6, n7;
-    int32_t i, htind, n;
-    uint64_t mask = 0;
-    struct knotary_entry *kp, *tmp;
     if ( timestamp == 0 && ASSETCHAINS_SYMBOL[0] != 0 )
         timestamp = komodo_heightstamp(height);
     else if ( ASSETCHAINS_SYMBOL[0] == 0 )
         timestamp = 0;
-    if ( height >= KOMODO_NOTARIES_HARDCODED || ASSETCHAINS_SYMBOL[0] != 0 )
+    if ( height < KOMODO_NOTARIES_HARDCODED && ASSETCHAINS_SYMBOL[0] == 0 )
+        return(-1);
+    if ( (timestamp != 0 && timestamp <= KOMODO_NOTARIES_TIMESTAMP1) || (ASSETCHAINS_SYMBOL[0] == 0 && height <= KOMODO_NOTARIES_HEIGHT1) )
+        return(0);
+    else if ( (timestamp != 0 && timestamp <= KOMODO_NOTARIES_TIMESTAMP2) || height <= KOMODO_NOTARIES_HEIGHT2 )
+        return(1);
+    else if ( (timestamp != 0 && timestamp <= KOMODO_NOTARIES_TIMESTAMP4) || height <= KOMODO_NOTARIES_HEIGHT4 )
+        return(2);
+    else if ( (timestamp != 0 && timestamp <= KOMODO_NOTARIES_TIMESTAMP5) || height <= KOMODO_NOTARIES_HEIGHT5 )
+        return(3);
+    else if ( (timestamp != 0 && timestamp <= KOMODO_NOTARIES_TIMESTAMP6) || height <= KOMODO_NOTARIES_HEIGHT6 )
+        return(4);
+    else if ( (timestamp != 0 && timestamp <= KOMODO_NOTARIES_TIMESTAMP7) || height <= KOMODO_NOTARIES_HEIGHT7 )
+        return(5);
+    return(6);
+}
+
+int32_t komodo_notaries(uint8_t pubkeys[64][33],int32_t height,uint32_t timestamp)
+{
+    int32_t i, htind, n, seti;
+    uint64_t mask = 0;
+    struct knotary_entry *kp, *tmp;
+    if ( (seti= komodo_elected_index(height,timestamp)) >= 0 )
     {
-        if ( (timestamp != 0 && timestamp <= KOMODO_NOTARIES_TIMESTAMP1) || (ASSETCHAINS_SYMBOL[0] == 0 && height <= KOMODO_NOTARIES_HEIGHT1) )
-        {
-            if ( did0 == 0 )
-            {
-                n0 = (int32_t)(sizeof(Notaries_elected0)/sizeof(*Notaries_elected0));
-                for (i=0; i<n0; i++)
-                    decode_hex(elected_pubkeys0[i],33,(char *)Notaries_elected0[i][1]);
-                did0 = 1;
-            }
-            memcpy(pubkeys, elected_pubkeys0, n0 * 33);
-            //if ( ASSETCHAINS_SYMBOL[0] != 0 )
-            //fprintf(stderr,"%s height.%d t.%u elected.%d notaries\n",ASSETCHAINS_SYMBOL,height,timestamp,n0);
-            return(n0);
-        }
-        else if ( (timestamp != 0 && timestamp <= KOMODO_NOTARIES_TIMESTAMP2) || height <= KOMODO_NOTARIES_HEIGHT2 )
-        {
-            if ( did1 == 0 )
-            {
-                n1 = (int32_t)(sizeof(Notaries_elected1)/sizeof(*Notaries_elected1));
-                for (i=0; i<n1; i++)
-                    decode_hex(elected_pubkeys1[i],33,(char *)Notaries_elected1[i][1]);
-                if ( 0 && ASSETCHAINS_SYMBOL[0] != 0 )
-                    fprintf(stderr,"%s height.%d t.%u elected.%d notaries2\n",ASSETCHAINS_SYMBOL,height,timestamp,n1);
-                did1 = 1;
-            }
-            memcpy(pubkeys, elected_pubkeys1, n1 * 33);
-            return(n1);
-        }
-        else if ( (timestamp != 0 && timestamp <= KOMODO_NOTARIES_TIMESTAMP4) || height <= KOMODO_NOTARIES_HEIGHT4 )
-        {
-            if ( did2 == 0 )
-            {
-                n2 = (int32_t)(sizeof(Notaries_elected2)/sizeof(*Notaries_elected2));
-                for (i=0; i<n2; i++)
-                    decode_hex(elected_pubkeys2[i],33,(char *)Notaries_elected2[i][1]);
-                if ( 0 && ASSETCHAINS_SYMBOL[0] != 0 )
-                    fprintf(stderr,"%s height.%d t.%u elected.%d notaries2\n",ASSETCHAINS_SYMBOL,height,timestamp,n2);
-                did2 = 1;
-            }
-            memcpy(pubkeys, elected_pubkeys2, n2 * 33);
-            return(n2);
-        }
-        else if ( (timestamp != 0 && timestamp <= KOMODO_NOTARIES_TIMESTAMP5) || height <= KOMODO_NOTARIES_HEIGHT5 )
-        {
-            if ( did4 == 0 )
-            {
-                n4 = (int32_t)(sizeof(Notaries_elected4)/sizeof(*Notaries_elected4));
-                for (i=0; i<n4; i++)
-                    decode_hex(elected_pubkeys4[i],33,(char *)Notaries_elected4[i][1]);
-                if ( 0 && ASSETCHAINS_SYMBOL[0] != 0 )
-                    fprintf(stderr,"%s height.%d t.%u elected.%d notaries4\n",ASSETCHAINS_SYMBOL,height,timestamp,n4);
-                did4 = 1;
-            }
-            memcpy(pubkeys, elected_pubkeys4, n4 * 33);
-            return(n4);
-        }
-        else if ( (timestamp != 0 && timestamp <= KOMODO_NOTARIES_TIMESTAMP6) || height <= KOMODO_NOTARIES_HEIGHT6 )
-        {
-            if ( did5 == 0 )
-            {
-                n5 = (int32_t)(sizeof(Notaries_elected5)/sizeof(*Notaries_elected5));
-                for (i=0; i<n5; i++)
-                    decode_hex(elected_pubkeys5[i],33,(char *)Notaries_elected5[i][1]);
-                if ( 0 && ASSETCHAINS_SYMBOL[0] != 0 )
-                    fprintf(stderr,"%s height.%d t.%u elected.%d notaries5\n",ASSETCHAINS_SYMBOL,height,timestamp,n5);
-                did5 = 1;
-            }
-            memcpy(pubkeys, elected_pubkeys5, n5 * 33);
-            return(n5);
-        }
-        else if ( (timestamp != 0 && timestamp <= KOMODO_NOTARIES_TIMESTAMP7) || height <= KOMODO_NOTARIES_HEIGHT7 )
-        {
-            if ( did6 == 0 )
-            {
-                n6 = (int32_t)(sizeof(Notaries_elected6)/sizeof(*Notaries_elected6));
-                for (i=0; i<n6; i++)
-                    decode_hex(elected_pubkeys6[i],33,(char *)Notaries_elected6[i][1]);
-                if ( 0 && ASSETCHAINS_SYMBOL[0] != 0 )
-                    fprintf(stderr,"%s height.%d t.%u elected.%d notaries6\n",ASSETCHAINS_SYMBOL,height,timestamp,n6);
-                did6 = 1;
-            }
-            memcpy(pubkeys, elected_pubkeys6, n6 * 33);
-            return(n6);
-        }
-        else
-        {
-            if ( did7 == 0 )
-            {
-                n7 = (int32_t)(sizeof(Notaries_elected7)/sizeof(*Notaries_elected7));
-                for (i=0; i<n7; i++)
-                    decode_hex(elected_pubkeys7[i],33,(char *)Notaries_elected7[i][1]);
-                if ( 0 && ASSETCHAINS_SYMBOL[0] != 0 )
-                    fprintf(stderr,"%s height.%d t.%u elected.%d notaries6\n",ASSETCHAINS_SYMBOL,height,timestamp,n7);
-                did7 = 1;
-            }
-            memcpy(pubkeys, elected_pubkeys7, n7 * 33);
-            return(n7);
-        }
+        struct komodo_elected_set *sp = &komodo_elected_sets()[seti];
+        memcpy(pubkeys, sp->pubkeys, sp->numnotaries * 33);
+        return(sp->numnotaries);
     }
     htind = height / KOMODO_ELECTION_GAP;
     if ( htind >= KOMODO_MAXBLOCKS / KOMODO_ELECTION_GAP )
@@ -708,7 +664,14 @@ int32_t komodo_notaries(uint8_t pubkeys[64][33],int32_t height,uint32_t timestam
 
 int32_t komodo_electednotary(int32_t *numnotariesp,uint8_t *pubkey33,int32_t height,uint32_t timestamp)
 {
-    int32_t i,n; uint8_t pubkeys[64][33];
+    int32_t i,n,seti; uint8_t pubkeys[64][33]; struct knotary_entry *kp;
+    if ( (seti= komodo_elected_index(height,timestamp)) >= 0 )
+    {
+        struct komodo_elected_set *sp = &komodo_elected_sets()[seti];
+        *numnotariesp = sp->numnotaries;
+        HASH_FIND(hh,sp->Notaries,pubkey33,33,kp);
+        return(kp != 0 ? kp->notaryid : -1);
+    }
     n = komodo_notaries(pubkeys,height,timestamp);
     *numnotariesp = n;
     for (i=0; i<n; i++)
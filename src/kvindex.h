@@ -0,0 +1,116 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_KVINDEX_H
+#define BITCOIN_KVINDEX_H
+
+#include "uint256.h"
+#include "serialize.h"
+
+#include <utility>
+#include <vector>
+
+// key value updates are keyed by the hash of their key first, then by their position in the chain, so the value of a
+// key as of any height is the last entry at or below that height
+struct CKVIndexIteratorKey {
+    uint256 keyHash;
+    unsigned int height;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 36;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        keyHash.Serialize(s);
+        ser_writedata32be(s, height);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        keyHash.Unserialize(s);
+        height = ser_readdata32be(s);
+    }
+
+    CKVIndexIteratorKey(const uint256 &hash, unsigned int nHeight) {
+        keyHash = hash;
+        height = nHeight;
+    }
+
+    CKVIndexIteratorKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        keyHash.SetNull();
+        height = 0;
+    }
+};
+
+struct CKVIndexKey {
+    uint256 keyHash;
+    unsigned int height;
+    unsigned int txindex;
+    unsigned int index;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 44;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        keyHash.Serialize(s);
+        ser_writedata32be(s, height);
+        ser_writedata32be(s, txindex);
+        ser_writedata32be(s, index);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        keyHash.Unserialize(s);
+        height = ser_readdata32be(s);
+        txindex = ser_readdata32be(s);
+        index = ser_readdata32be(s);
+    }
+
+    CKVIndexKey(const uint256 &hash, unsigned int nHeight, unsigned int nTxIndex, unsigned int nIndex) {
+        keyHash = hash;
+        height = nHeight;
+        txindex = nTxIndex;
+        index = nIndex;
+    }
+
+    CKVIndexKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        keyHash.SetNull();
+        height = 0;
+        txindex = 0;
+        index = 0;
+    }
+};
+
+// the state of a key after an accepted update. the key is kept with it, so a lookup can tell a match from a collision.
+struct CKVIndexValue {
+    uint256 txid;
+    std::vector<unsigned char> key;
+    std::vector<unsigned char> value;
+    uint256 owner;                          // curve25519 pubkey that must sign the next update, or null
+    uint32_t flags;
+
+    CKVIndexValue() : flags(0) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(txid);
+        READWRITE(key);
+        READWRITE(value);
+        READWRITE(owner);
+        READWRITE(flags);
+    }
+};
+
+typedef std::pair<CKVIndexKey, CKVIndexValue> CKVIndexEntry;
+
+#endif // BITCOIN_KVINDEX_H
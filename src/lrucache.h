@@ -27,10 +27,21 @@ SOFTWARE.
 #ifndef LRUCACHE_H
 #define LRUCACHE_H
 
+#include <algorithm>
 #include <iterator>
+#include <limits>
 #include <list>
 #include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
+#include "hash.h"
+#include "memusage.h"
+#include "random.h"
 #include "sync.h"
 #include "util.h"
 
@@ -58,6 +69,10 @@ private:
     float m_compactFactor;
     bool m_threadSafe;
 
+    // lookups through Get(key, outValue), for hit rate statistics
+    uint64_t m_hits;
+    uint64_t m_misses;
+
     static constexpr const float DEFAULT_COMPACT_FACTOR = 0.1;
     static constexpr const int DEFAULT_CAPACITY = 1000;
 
@@ -65,7 +80,7 @@ private:
 
 public:
     LRUCache(int capacity=DEFAULT_CAPACITY, float compactionFactor=DEFAULT_COMPACT_FACTOR, bool ThreadSafe=false) :
-        m_capacity(capacity), m_compactFactor(compactionFactor), m_threadSafe(ThreadSafe) {}
+        m_capacity(capacity), m_compactFactor(compactionFactor), m_threadSafe(ThreadSafe), m_hits(0), m_misses(0) {}
 
     int count(const TKey &key)
     {
@@ -134,8 +149,10 @@ public:
                 }
                 // copy the value
                 outValue = lruEntry->Value;
+                m_hits++;
                 return true;
             } else {
+                m_misses++;
                 return false;
             }
         }
@@ -151,8 +168,10 @@ public:
                 }
                 // copy the value
                 outValue = lruEntry->Value;
+                m_hits++;
                 return true;
             } else {
+                m_misses++;
                 return false;
             }
         }
@@ -197,6 +216,68 @@ public:
         }
     }
 
+    size_t size()
+    {
+        if (m_threadSafe)
+        {
+            LOCK(m_cacheLock);
+            return m_lruList.size();
+        }
+        else
+        {
+            return m_lruList.size();
+        }
+    }
+
+    int capacity() const
+    {
+        return m_capacity;
+    }
+
+    // removes the entry for key, if present, and returns true if it was
+    bool Erase(const TKey &key)
+    {
+        if (m_threadSafe)
+        {
+            LOCK(m_cacheLock);
+            return eraseEntry(key);
+        }
+        else
+        {
+            return eraseEntry(key);
+        }
+    }
+
+    void SetCapacity(int capacity)
+    {
+        if (m_threadSafe)
+        {
+            LOCK(m_cacheLock);
+            m_capacity = std::max(capacity, 1);
+            ensureCompaction();
+        }
+        else
+        {
+            m_capacity = std::max(capacity, 1);
+            ensureCompaction();
+        }
+    }
+
+    void GetStats(uint64_t &hits, uint64_t &misses)
+    {
+        if (m_threadSafe)
+        {
+            LOCK(m_cacheLock);
+            hits = m_hits;
+            misses = m_misses;
+        }
+        else
+        {
+            hits = m_hits;
+            misses = m_misses;
+        }
+    }
+
     void Clear()
     {
         m_lruList.clear();
@@ -205,6 +286,18 @@ public:
     }
 
 private:
+    bool eraseEntry(const TKey &key)
+    {
+        auto mapEntry = m_lookUpMap.find(key);
+        if (mapEntry == m_lookUpMap.end())
+        {
+            return false;
+        }
+        m_lruList.erase(mapEntry->second.LRUEntryRef);
+        m_lookUpMap.erase(mapEntry);
+        return true;
+    }
+
     void ensureCompaction()
     {
         int cacheOrigSize = m_lruList.size();
@@ -233,4 +326,385 @@ private:
     }
 };
 
+// keys of a ShardedLRUCache are hashed with SipHash under a random key, so entries cannot be steered into one bucket
+namespace lrucache_hash
+{
+// chosen on first use rather than at static initialization, since the caches are globals
+inline const uint64_t *Salt()
+{
+    static const uint64_t salt[2] = {GetRand(std::numeric_limits<uint64_t>::max()), GetRand(std::numeric_limits<uint64_t>::max())};
+    return salt;
+}
+
+template <unsigned int BITS>
+inline void Write(CSipHasher &hasher, const base_blob<BITS> &value)
+{
+    hasher.Write(value.begin(), value.size());
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value>::type Write(CSipHasher &hasher, const T &value)
+{
+    hasher.Write((uint64_t)value);
+}
+
+inline void Write(CSipHasher &hasher, const std::string &value)
+{
+    hasher.Write((const unsigned char *)value.data(), value.size());
+    hasher.Write((uint64_t)value.size());
+}
+
+template <typename T1, typename T2>
+inline void Write(CSipHasher &hasher, const std::pair<T1, T2> &value)
+{
+    Write(hasher, value.first);
+    Write(hasher, value.second);
+}
+
+template <typename Tuple, size_t... I>
+inline void WriteTuple(CSipHasher &hasher, const Tuple &value, std::index_sequence<I...>)
+{
+    (Write(hasher, std::get<I>(value)), ...);
+}
+
+template <typename... T>
+inline void Write(CSipHasher &hasher, const std::tuple<T...> &value)
+{
+    WriteTuple(hasher, value, std::index_sequence_for<T...>());
+}
+} // namespace lrucache_hash
+
+// a drop in for LRUCache whose keys can be hashed by lrucache_hash. entries are spread over shards by hash, each with
+// its own lock, so threads using different keys rarely wait for each other. each shard is a hash table of intrusive
+// nodes that are also its LRU list, so every operation is O(1), and the least recently used entry of a full shard is
+// evicted as each new one is added, rather than compacting the whole cache at once.
+template <typename TKey, typename TValue>
+class ShardedLRUCache {
+private:
+    // LRU list, most recently used after the head
+    struct Link {
+        Link *pPrev;
+        Link *pNext;
+    };
+
+    struct Node : public Link {
+        Node(const TKey &key, const TValue &value, uint64_t nHash) : Key(key), Value(value), Hash(nHash), pChain(nullptr) { }
+
+        TKey Key;
+        TValue Value;
+        uint64_t Hash;
+        Node *pChain;                       // next node in the same bucket
+    };
+
+    struct Shard {
+        CCriticalSection cs;
+        std::vector<Node *> buckets;
+        Link head;                          // sentinel of the circular LRU list
+        size_t nCount;
+        size_t nCapacity;
+        uint64_t nHits;
+        uint64_t nMisses;
+        uint64_t nEvictions;
+
+        Shard() : buckets(16, nullptr), nCount(0), nCapacity(1), nHits(0), nMisses(0), nEvictions(0)
+        {
+            head.pPrev = head.pNext = &head;
+        }
+
+        ~Shard()
+        {
+            Clear();
+        }
+
+        Node **FindRef(const TKey &key, uint64_t nHash)
+        {
+            Node **ppNode = &buckets[nHash & (buckets.size() - 1)];
+            while (*ppNode && ((*ppNode)->Hash != nHash || !((*ppNode)->Key == key)))
+            {
+                ppNode = &(*ppNode)->pChain;
+            }
+            return ppNode;
+        }
+
+        void Unlink(Link *pNode)
+        {
+            pNode->pPrev->pNext = pNode->pNext;
+            pNode->pNext->pPrev = pNode->pPrev;
+        }
+
+        void PushFront(Link *pNode)
+        {
+            pNode->pNext = head.pNext;
+            pNode->pPrev = &head;
+            head.pNext->pPrev = pNode;
+            head.pNext = pNode;
+        }
+
+        void Touch(Node *pNode)
+        {
+            if (head.pNext != pNode)
+            {
+                Unlink(pNode);
+                PushFront(pNode);
+            }
+        }
+
+        void Remove(Node **ppNode)
+        {
+            Node *pNode = *ppNode;
+            *ppNode = pNode->pChain;
+            Unlink(pNode);
+            delete pNode;
+            nCount--;
+        }
+
+        void Grow()
+        {
+            std::vector<Node *> newBuckets(buckets.size() << 1, nullptr);
+            for (Link *pLink = head.pNext; pLink != &head; pLink = pLink->pNext)
+            {
+                Node *pNode = static_cast<Node *>(pLink);
+                Node *&bucket = newBuckets[pNode->Hash & (newBuckets.size() - 1)];
+                pNode->pChain = bucket;
+                bucket = pNode;
+            }
+            buckets.swap(newBuckets);
+        }
+
+        void Trim()
+        {
+            while (nCount > nCapacity)
+            {
+                Node *pOldest = static_cast<Node *>(head.pPrev);
+                Remove(FindRef(pOldest->Key, pOldest->Hash));
+                nEvictions++;
+            }
+        }
+
+        void Clear()
+        {
+            for (Link *pLink = head.pNext; pLink != &head;)
+            {
+                Link *pNext = pLink->pNext;
+                delete static_cast<Node *>(pLink);
+                pLink = pNext;
+            }
+            head.pPrev = head.pNext = &head;
+            std::fill(buckets.begin(), buckets.end(), nullptr);
+            nCount = 0;
+        }
+    };
+
+    std::unique_ptr<Shard[]> m_shards;
+    size_t m_shardCount;
+    int m_capacity;
+    bool m_threadSafe;
+
+    static constexpr const int DEFAULT_CAPACITY = 1000;
+    static constexpr const size_t MAX_SHARDS = 16;
+    static constexpr const size_t MIN_SHARD_CAPACITY = 64;
+
+    uint64_t hashKey(const TKey &key) const
+    {
+        CSipHasher hasher(lrucache_hash::Salt()[0], lrucache_hash::Salt()[1]);
+        lrucache_hash::Write(hasher, key);
+        return hasher.Finalize();
+    }
+
+    // the low bits of the hash pick the bucket in a shard, so the shard is picked by the high bits
+    Shard &shardFor(uint64_t nHash) const
+    {
+        return m_shards[(nHash >> 48) % m_shardCount];
+    }
+
+    size_t shardCapacity() const
+    {
+        return std::max((size_t)1, ((size_t)m_capacity + m_shardCount - 1) / m_shardCount);
+    }
+
+    template <typename Func>
+    auto withShard(Shard &shard, Func func) -> decltype(func())
+    {
+        if (m_threadSafe)
+        {
+            LOCK(shard.cs);
+            return func();
+        }
+        return func();
+    }
+
+public:
+    // the compaction factor is accepted for compatibility with LRUCache, entries are evicted one at a time
+    ShardedLRUCache(int capacity=DEFAULT_CAPACITY, float compactionFactor=0, bool ThreadSafe=false) :
+        m_capacity(std::max(capacity, 1)), m_threadSafe(ThreadSafe)
+    {
+        m_shardCount = 1;
+        while (ThreadSafe && m_shardCount < MAX_SHARDS && (size_t)m_capacity / (m_shardCount << 1) >= MIN_SHARD_CAPACITY)
+        {
+            m_shardCount <<= 1;
+        }
+        m_shards.reset(new Shard[m_shardCount]);
+        for (size_t i = 0; i < m_shardCount; i++)
+        {
+            m_shards[i].nCapacity = shardCapacity();
+        }
+    }
+
+    ShardedLRUCache(const ShardedLRUCache &) = delete;
+    ShardedLRUCache &operator=(const ShardedLRUCache &) = delete;
+
+    int count(const TKey &key)
+    {
+        uint64_t nHash = hashKey(key);
+        Shard &shard = shardFor(nHash);
+        return withShard(shard, [&]() { return *shard.FindRef(key, nHash) ? 1 : 0; });
+    }
+
+    TValue Get(const TKey &key)
+    {
+        TValue value;
+        Get(key, value);
+        return value;
+    }
+
+    bool Get(const TKey &key, TValue &outValue)
+    {
+        uint64_t nHash = hashKey(key);
+        Shard &shard = shardFor(nHash);
+        return withShard(shard, [&]() {
+            Node *pNode = *shard.FindRef(key, nHash);
+            if (!pNode)
+            {
+                shard.nMisses++;
+                return false;
+            }
+            shard.Touch(pNode);
+            outValue = pNode->Value;
+            shard.nHits++;
+            return true;
+        });
+    }
+
+    void Put(const TKey &key, const TValue &value)
+    {
+        uint64_t nHash = hashKey(key);
+        Shard &shard = shardFor(nHash);
+        withShard(shard, [&]() {
+            Node **ppNode = shard.FindRef(key, nHash);
+            if (*ppNode)
+            {
+                (*ppNode)->Value = value;
+                shard.Touch(*ppNode);
+                return;
+            }
+            Node *pNode = new Node(key, value, nHash);
+            *ppNode = pNode;
+            shard.PushFront(pNode);
+            shard.nCount++;
+            shard.Trim();
+            if (shard.nCount > shard.buckets.size())
+            {
+                shard.Grow();
+            }
+        });
+    }
+
+    size_t size()
+    {
+        size_t nSize = 0;
+        for (size_t i = 0; i < m_shardCount; i++)
+        {
+            nSize += withShard(m_shards[i], [&]() { return m_shards[i].nCount; });
+        }
+        return nSize;
+    }
+
+    int capacity() const
+    {
+        return m_capacity;
+    }
+
+    // removes the entry for key, if present, and returns true if it was
+    bool Erase(const TKey &key)
+    {
+        uint64_t nHash = hashKey(key);
+        Shard &shard = shardFor(nHash);
+        return withShard(shard, [&]() {
+            Node **ppNode = shard.FindRef(key, nHash);
+            if (!*ppNode)
+            {
+                return false;
+            }
+            shard.Remove(ppNode);
+            return true;
+        });
+    }
+
+    // the number of shards is fixed when the cache is constructed, and the capacity is divided among them
+    void SetCapacity(int capacity)
+    {
+        m_capacity = std::max(capacity, 1);
+        for (size_t i = 0; i < m_shardCount; i++)
+        {
+            Shard &shard = m_shards[i];
+            withShard(shard, [&]() {
+                shard.nCapacity = shardCapacity();
+                shard.Trim();
+            });
+        }
+    }
+
+    void GetStats(uint64_t &hits, uint64_t &misses, uint64_t &evictions)
+    {
+        hits = misses = evictions = 0;
+        for (size_t i = 0; i < m_shardCount; i++)
+        {
+            Shard &shard = m_shards[i];
+            withShard(shard, [&]() {
+                hits += shard.nHits;
+                misses += shard.nMisses;
+                evictions += shard.nEvictions;
+            });
+        }
+    }
+
+    void GetStats(uint64_t &hits, uint64_t &misses)
+    {
+        uint64_t evictions;
+        GetStats(hits, misses, evictions);
+    }
+
+    // the memory held by the shards, their buckets and nodes, with entryUsage(key, value) giving what each entry
+    // holds outside of its node. this visits every entry, so it is for occasional reporting only
+    template <typename EntryUsage>
+    size_t DynamicMemoryUsage(EntryUsage entryUsage)
+    {
+        size_t usage = memusage::MallocUsage(sizeof(Shard) * m_shardCount);
+        for (size_t i = 0; i < m_shardCount; i++)
+        {
+            Shard &shard = m_shards[i];
+            usage += withShard(shard, [&]() {
+                size_t shardUsage = memusage::DynamicUsage(shard.buckets) + memusage::MallocUsage(sizeof(Node)) * shard.nCount;
+                for (Link *pLink = shard.head.pNext; pLink != &shard.head; pLink = pLink->pNext)
+                {
+                    Node *pNode = static_cast<Node *>(pLink);
+                    shardUsage += entryUsage(pNode->Key, pNode->Value);
+                }
+                return shardUsage;
+            });
+        }
+        return usage;
+    }
+
+    void Clear()
+    {
+        for (size_t i = 0; i < m_shardCount; i++)
+        {
+            Shard &shard = m_shards[i];
+            withShard(shard, [&]() { shard.Clear(); });
+        }
+        LogPrint("lrucache", "%s\n", "Cache cleared");
+    }
+};
+
 #endif // LRUCACHE_H
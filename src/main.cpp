@@ -13,6 +13,8 @@
 #include "addrman.h"
 #include "alert.h"
 #include "arith_uint256.h"
+#include "blockencodings.h"
+#include "blockstats.h"
 #include "importcoin.h"
 #include "chainparams.h"
 #include "checkpoints.h"
@@ -20,6 +22,7 @@
 #include "clientversion.h"
 #include "consensus/upgrades.h"
 #include "consensus/validation.h"
+#include "core_memusage.h"
 #include "deprecation.h"
 #include "init.h"
 #include "merkleblock.h"
@@ -32,11 +35,13 @@
 #include "pbaas/identity.h"
 #include "pow.h"
 #include "script/interpreter.h"
+#include "trace.h"
 #include "txdb.h"
 #include "txmempool.h"
 #include "ui_interface.h"
 #include "undo.h"
 #include "util.h"
+#include "utxostats.h"
 #include "utilmoneystr.h"
 #include "validationinterface.h"
 #include "wallet/asyncrpcoperation_sendmany.h"
@@ -46,8 +51,11 @@
 #include <algorithm>
 #include <atomic>
 #include <sstream>
+#include <tuple>
 #include <map>
+#include <queue>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include <boost/algorithm/string/replace.hpp>
@@ -57,6 +65,8 @@
 #include <boost/thread.hpp>
 #include <boost/static_assert.hpp>
 
+#include <zlib.h>
+
 using namespace std;
 
 #if defined(NDEBUG)
@@ -93,11 +103,25 @@ bool fInsightExplorer = false;      // this ensures that the primary address and
 bool fAddressIndex = true;
 bool fSpentIndex = true;
 bool fTimestampIndex = false;
+bool fBlockDeltaIndex = false;
+bool fBlockFilterIndex = false;
+bool fBlockStatsIndex = false;
+bool fReserveTransferIndex = false;
+bool fIdentityStateIndex = false;
+bool fKVIndex = false;
+bool fAddressBalanceIndex = false;
 bool fHavePruned = false;
 bool fPruneMode = false;
+bool fPruneProofs = false;
 bool fIsBareMultisigStd = true;
 bool fCheckBlockIndex = false;
+bool fCompressBlockFiles = DEFAULT_COMPRESS_BLOCK_FILES;
 bool fCheckpointsEnabled = true;
+uint256 hashAssumeValid;
+uint64_t nAssumeValidSkipped = 0;
+int nAssumeNotarizedHeight = -1;
+uint256 hashAssumeNotarizedBlock;
+uint256 hashAssumeNotarizedMMRRoot;
 bool fCoinbaseEnforcedProtectionEnabled = true;
 size_t nCoinCacheUsage = 5000 * 300;
 uint64_t nPruneTarget = 0;
@@ -113,7 +137,7 @@ CFeeRate minRelayTxFee = CFeeRate(DEFAULT_MIN_RELAY_TX_FEE);
 
 CTxMemPool mempool(::minRelayTxFee);
 
-LRUCache<std::pair<uint256, uint32_t>, std::tuple<uint256, CInputDescriptor, CReserveTransfer>> reserveTransferCache(6000); // reserve transfers are entered here as processed, <<txid, outnum>, <blockHash, CInputDescriptor, CReserveTransfer>>
+LRUCache<std::pair<uint256, uint32_t>, std::tuple<uint256, CInputDescriptor, CReserveTransfer>> reserveTransferCache(6000, 0.1F, true); // reserve transfers are entered here as processed, <<txid, outnum>, <blockHash, CInputDescriptor, CReserveTransfer>>
 
 struct IteratorComparator
 {
@@ -245,6 +269,7 @@ namespace {
         int64_t nTime;           //!< Time of "getdata" request in microseconds.
         bool fValidatedHeaders;  //!< Whether this block has validated headers at the time of request.
         int64_t nTimeDisconnect; //!< The timeout for this block request (for disconnecting a slow peer)
+        std::shared_ptr<PartiallyDownloadedBlock> partialBlock; //!< Optional, set while a cmpctblock waits for its blocktxn.
     };
     map<uint256, pair<NodeId, list<QueuedBlock>::iterator> > mapBlocksInFlight;
 
@@ -254,6 +279,28 @@ namespace {
     /** Number of preferable block download peers. */
     int nPreferredDownload = 0;
 
+    /** Peers we asked to announce new blocks with cmpctblock, oldest first. Requires cs_main. */
+    list<NodeId> lNodesAnnouncingHeaderAndIDs;
+
+    /** The compact block last built for announcing our tip, shared by all peers that asked for them. Requires cs_main. */
+    std::shared_ptr<const CBlockHeaderAndShortTxIDs> pMostRecentCompactBlock;
+
+    /** A message for the tip block, serialized once for a send version and then queued to every peer it goes to. */
+    struct CTipMessage
+    {
+        uint256 hash;
+        int nVersion = 0;
+        CSharedMessage msg;
+
+        bool Matches(const uint256 &hashIn, int nVersionIn) const
+        {
+            return msg && hash == hashIn && nVersion == nVersionIn;
+        }
+    };
+
+    /** The tip as sent in block and cmpctblock messages, most peers ask for it right after it is found. Requires cs_main. */
+    CTipMessage tipBlockMessage, tipCompactBlockMessage;
+
     /** Dirty block index entries. */
     set<CBlockIndex*> setDirtyBlockIndex;
 
@@ -308,6 +355,18 @@ namespace {
         int nBlocksInFlightValidHeaders;
         //! Whether we consider this a preferred download peer.
         bool fPreferredDownload;
+        //! Whether this peer understands our version of cmpctblock, getblocktxn and blocktxn.
+        bool fSupportsCompactBlocks;
+        //! Whether this peer wants new blocks announced to it with cmpctblock instead of inv.
+        bool fPreferHeaderAndIDs;
+        //! Number of requested blocks this peer delivered, and the averages they were delivered at.
+        int nBlocksDownloaded;
+        //! Average time (in microseconds) from a request reaching the front of this peer's queue to its block arriving.
+        int64_t nBlockResponseTime;
+        //! Average rate, in bytes per second, at which this peer delivered blocks.
+        double dBlockBytesPerSec;
+        //! When this peer last delivered a block we asked for (in microseconds), or 0.
+        int64_t nLastBlockReceived;
 
         CNodeState() {
             fCurrentlyConnected = false;
@@ -321,6 +380,12 @@ namespace {
             nBlocksInFlight = 0;
             nBlocksInFlightValidHeaders = 0;
             fPreferredDownload = false;
+            fSupportsCompactBlocks = false;
+            fPreferHeaderAndIDs = false;
+            nBlocksDownloaded = 0;
+            nBlockResponseTime = 0;
+            dBlockBytesPerSec = 0;
+            nLastBlockReceived = 0;
         }
     };
 
@@ -379,6 +444,7 @@ namespace {
         mapBlocksInFlight.erase(entry.hash);
         EraseOrphansFor(nodeid);
         nPreferredDownload -= state->fPreferredDownload;
+        lNodesAnnouncingHeaderAndIDs.remove(nodeid);
 
         mapNodeState.erase(nodeid);
     }
@@ -395,6 +461,46 @@ namespace {
          pcoinsTip->Uncache(removed);*/
     }
 
+    // Requires cs_main.
+    // How many blocks may be in flight from a peer: enough to keep BLOCK_DOWNLOAD_QUEUE_TARGET of deliveries queued at its
+    // measured response time, so fast peers are kept busy and slow ones don't hold the blocks everyone else waits on.
+    int GetBlocksInTransitLimit(const CNodeState *state) {
+        if (state->nBlocksDownloaded == 0 || state->nBlockResponseTime <= 0)
+            return MAX_BLOCKS_IN_TRANSIT_PER_PEER;
+        int64_t nLimit = BLOCK_DOWNLOAD_QUEUE_TARGET / state->nBlockResponseTime;
+        return (int)std::max<int64_t>(MIN_BLOCKS_IN_TRANSIT_PER_PEER, std::min<int64_t>(MAX_ADAPTIVE_BLOCKS_IN_TRANSIT_PER_PEER, nLimit));
+    }
+
+    // Requires cs_main.
+    // Updates the response time and bandwidth measured for a peer delivering a block we asked it for. Call before the
+    // block is processed, while it is still in flight.
+    void UpdateBlockDownloadStats(NodeId nodeid, const uint256& hash, size_t nBytes) {
+        map<uint256, pair<NodeId, list<QueuedBlock>::iterator> >::iterator itInFlight = mapBlocksInFlight.find(hash);
+        if (itInFlight == mapBlocksInFlight.end() || itInFlight->second.first != nodeid)
+            return;
+        CNodeState *state = State(nodeid);
+        if (state == NULL)
+            return;
+
+        // blocks are sent in the order they were asked for, so a request only starts being served once the block before it
+        // has arrived
+        int64_t nNow = GetTimeMicros();
+        int64_t nStart = std::max(itInFlight->second.second->nTime, state->nLastBlockReceived);
+        int64_t nResponseTime = std::max<int64_t>(nNow - nStart, 1);
+        double dBytesPerSec = (double)nBytes * 1000000 / nResponseTime;
+        state->nLastBlockReceived = nNow;
+
+        // exponentially weighted, so that a peer whose link changes is reassessed within a few blocks
+        if (state->nBlocksDownloaded == 0) {
+            state->nBlockResponseTime = nResponseTime;
+            state->dBlockBytesPerSec = dBytesPerSec;
+        } else {
+            state->nBlockResponseTime = (state->nBlockResponseTime * 7 + nResponseTime) / 8;
+            state->dBlockBytesPerSec = (state->dBlockBytesPerSec * 7 + dBytesPerSec) / 8;
+        }
+        state->nBlocksDownloaded++;
+    }
+
     // Requires cs_main.
     // Returns a bool indicating whether we requested this block.
     bool MarkBlockAsReceived(const uint256& hash) {
@@ -413,7 +519,8 @@ namespace {
     }
 
     // Requires cs_main.
-    void MarkBlockAsInFlight(NodeId nodeid, const uint256& hash, const Consensus::Params& consensusParams, CBlockIndex *pindex = NULL) {
+    // Returns the new entry, so that a partially downloaded block can be attached to it.
+    list<QueuedBlock>::iterator MarkBlockAsInFlight(NodeId nodeid, const uint256& hash, const Consensus::Params& consensusParams, CBlockIndex *pindex = NULL) {
         CNodeState *state = State(nodeid);
         assert(state != NULL);
 
@@ -427,6 +534,38 @@ namespace {
         state->nBlocksInFlight++;
         state->nBlocksInFlightValidHeaders += newentry.fValidatedHeaders;
         mapBlocksInFlight[hash] = std::make_pair(nodeid, it);
+        return it;
+    }
+
+    // Requires cs_main.
+    // Asks a peer that just gave us a new tip to push its next blocks to us as cmpctblock, saving the inv and getdata
+    // round trips. Only the last MAX_COMPACT_BLOCK_ANNOUNCERS such peers are kept in that mode.
+    void MaybeSetPeerAsAnnouncingHeaderAndIDs(CNode *pfrom) {
+        CNodeState *state = State(pfrom->GetId());
+        if (state == NULL || !state->fSupportsCompactBlocks)
+            return;
+
+        for (list<NodeId>::iterator it = lNodesAnnouncingHeaderAndIDs.begin(); it != lNodesAnnouncingHeaderAndIDs.end(); it++) {
+            if (*it == pfrom->GetId()) {
+                lNodesAnnouncingHeaderAndIDs.erase(it);
+                lNodesAnnouncingHeaderAndIDs.push_back(pfrom->GetId());
+                return;
+            }
+        }
+
+        if (lNodesAnnouncingHeaderAndIDs.size() >= MAX_COMPACT_BLOCK_ANNOUNCERS) {
+            NodeId oldest = lNodesAnnouncingHeaderAndIDs.front();
+            lNodesAnnouncingHeaderAndIDs.pop_front();
+            LOCK(cs_vNodes);
+            BOOST_FOREACH(CNode* pnode, vNodes) {
+                if (pnode->GetId() == oldest) {
+                    pnode->PushMessage("sendcmpct", false, COMPACT_BLOCKS_VERSION);
+                    break;
+                }
+            }
+        }
+        pfrom->PushMessage("sendcmpct", true, COMPACT_BLOCKS_VERSION);
+        lNodesAnnouncingHeaderAndIDs.push_back(pfrom->GetId());
     }
 
     /** Check whether the last unknown block a peer advertized is not yet known. */
@@ -485,7 +624,7 @@ namespace {
 
     /** Update pindexLastCommonBlock and add not-in-flight missing successors to vBlocks, until it has
      *  at most count entries. */
-    void FindNextBlocksToDownload(NodeId nodeid, unsigned int count, std::vector<CBlockIndex*>& vBlocks, NodeId& nodeStaller) {
+    void FindNextBlocksToDownload(NodeId nodeid, unsigned int count, std::vector<CBlockIndex*>& vBlocks, NodeId& nodeStaller, CBlockIndex*& pindexStalled) {
         if (count == 0)
             return;
 
@@ -521,6 +660,7 @@ namespace {
         int nWindowEnd = state->pindexLastCommonBlock->GetHeight() + BLOCK_DOWNLOAD_WINDOW;
         int nMaxHeight = std::min<int>(state->pindexBestKnownBlock->GetHeight(), nWindowEnd + 1);
         NodeId waitingfor = -1;
+        CBlockIndex *pindexWaitingFor = NULL;
         while (pindexWalk->GetHeight() < nMaxHeight) {
             // Read up to 128 (or more, if more blocks than that are needed) successors of pindexWalk (towards
             // pindexBestKnownBlock) into vToFetch. We fetch 128, because CBlockIndex::GetAncestor may be as expensive
@@ -552,6 +692,7 @@ namespace {
                         if (vBlocks.size() == 0 && waitingfor != nodeid) {
                             // We aren't able to fetch anything, but we would be if the download window was one larger.
                             nodeStaller = waitingfor;
+                            pindexStalled = pindexWaitingFor;
                         }
                         return;
                     }
@@ -562,6 +703,7 @@ namespace {
                 } else if (waitingfor == -1) {
                     // This is the first already-in-flight block.
                     waitingfor = mapBlocksInFlight[pindex->GetBlockHash()].first;
+                    pindexWaitingFor = pindex;
                 }
             }
         }
@@ -581,6 +723,10 @@ bool GetNodeStateStats(NodeId nodeid, CNodeStateStats &stats) {
         if (queue.pindex)
             stats.vHeightInFlight.push_back(queue.pindex->GetHeight());
     }
+    stats.nBlocksInTransitLimit = GetBlocksInTransitLimit(state);
+    stats.nBlocksDownloaded = state->nBlocksDownloaded;
+    stats.nBlockResponseTime = state->nBlockResponseTime;
+    stats.dBlockBytesPerSec = state->dBlockBytesPerSec;
     return true;
 }
 
@@ -1214,6 +1360,204 @@ bool ContextualCheckCoinbaseTransaction(const CTransaction &tx, uint32_t nHeight
     return valid;
 }
 
+/**
+ * Computes the hash that the Sapling binding and spend authorization signatures and the JoinSplit signature
+ * of a shielded transaction sign, returns false if it cannot be computed.
+ */
+static bool GetShieldedSignatureHash(const CTransaction &tx, const CChainParams &chainparams, int nHeight, uint256 &dataToBeSigned)
+{
+    bool isVerusVault = CVerusSolutionVector::GetVersionByHeight(nHeight) >= CActivationHeight::ACTIVATE_VERUSVAULT;
+    auto consensusBranchId = CurrentEpochBranchId(nHeight, chainparams.GetConsensus());
+    // Empty output script.
+    CScript scriptCode;
+    bool sigHashSingle = false;
+
+    if (isVerusVault && tx.vJoinSplit.empty() && tx.vShieldedSpend.empty() && !tx.vShieldedOutput.empty() && tx.vin.size() > 0)
+    {
+        // if vin[0] is a smart signature for SIGHASH_SINGLE | SIGHASH_ANYONECANPAY, and the tx has no shielded spends,
+        // but does have shielded outputs, the transaction binding signature is only bound to the transparent input,
+        // all z-outputs, and no z-inputs. if there are shielded inputs, we do not afford the transaction this exception
+        CSmartTransactionSignatures smartSigs;
+        std::vector<unsigned char> ffVec = GetFulfillmentVector(tx.vin[0].scriptSig);
+        if (ffVec.size() && (smartSigs = CSmartTransactionSignatures(std::vector<unsigned char>(ffVec.begin(), ffVec.end()))).IsValid())
+        {
+            if (smartSigs.sigHashType == (SIGHASH_SINGLE | SIGHASH_ANYONECANPAY))
+            {
+                sigHashSingle = true;
+            }
+        }
+    }
+    try {
+        if (sigHashSingle == true)
+        {
+            dataToBeSigned = SignatureHash(scriptCode, tx, 0, SIGHASH_SINGLE | SIGHASH_ANYONECANPAY, 0, consensusBranchId);
+        }
+        else
+        {
+            dataToBeSigned = SignatureHash(scriptCode, tx, NOT_AN_INPUT, SIGHASH_ALL, 0, consensusBranchId);
+        }
+    } catch (std::logic_error ex) {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Verifies all Sapling spend and output proofs, spend authorization signatures and the binding signature of a transaction.
+ */
+static bool VerifySaplingBundle(const CTransaction &tx, const uint256 &dataToBeSigned, CValidationState &state)
+{
+    ZC_WaitForParams();
+    auto ctx = librustzcash_sapling_verification_ctx_init();
+
+    for (const SpendDescription &spend : tx.vShieldedSpend) {
+        if (!librustzcash_sapling_check_spend(
+            ctx,
+            spend.cv.begin(),
+            spend.anchor.begin(),
+            spend.nullifier.begin(),
+            spend.rk.begin(),
+            spend.zkproof.begin(),
+            spend.spendAuthSig.begin(),
+            dataToBeSigned.begin()
+        ))
+        {
+            librustzcash_sapling_verification_ctx_free(ctx);
+            return state.DoS(100, error("ContextualCheckTransaction(): Sapling spend description invalid"),
+                                  REJECT_INVALID, "bad-txns-sapling-spend-description-invalid");
+        }
+    }
+
+    for (const OutputDescription &output : tx.vShieldedOutput) {
+        if (!librustzcash_sapling_check_output(
+            ctx,
+            output.cv.begin(),
+            output.cm.begin(),
+            output.ephemeralKey.begin(),
+            output.zkproof.begin()
+        ))
+        {
+            librustzcash_sapling_verification_ctx_free(ctx);
+            return state.DoS(100, error("ContextualCheckTransaction(): Sapling output description invalid"),
+                                  REJECT_INVALID, "bad-txns-sapling-output-description-invalid");
+        }
+    }
+
+    if (!librustzcash_sapling_final_check(
+        ctx,
+        tx.valueBalance,
+        tx.bindingSig.begin(),
+        dataToBeSigned.begin()
+    ))
+    {
+        librustzcash_sapling_verification_ctx_free(ctx);
+        return state.DoS(100, error("ContextualCheckTransaction(): Sapling binding signature invalid"),
+                              REJECT_INVALID, "bad-txns-sapling-binding-signature-invalid");
+    }
+
+    librustzcash_sapling_verification_ctx_free(ctx);
+    return true;
+}
+
+/**
+ * Transactions whose Sapling proofs and signatures have verified, keyed by SaplingProofCacheKey. Like the signature cache,
+ * proofs verified when a transaction enters the mempool are not verified again when the block containing it is connected.
+ * The key commits to the signature hash, so an entry only matches under the consensus branch it was verified with. The
+ * cache is emptied whenever it fills.
+ */
+class CSaplingProofCache
+{
+private:
+    static const size_t MAX_ENTRIES = 50000;
+
+    boost::mutex cs;
+    std::set<uint256> verified;
+
+public:
+    void Add(const uint256 &key)
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        if (verified.size() >= MAX_ENTRIES)
+        {
+            verified.clear();
+        }
+        verified.insert(key);
+    }
+
+    bool Contains(const uint256 &key)
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        return verified.count(key) != 0;
+    }
+};
+
+static CSaplingProofCache saplingProofCache;
+
+// the signature hash does not commit to the signatures themselves, the txid does
+static uint256 SaplingProofCacheKey(const CTransaction &tx, const uint256 &dataToBeSigned)
+{
+    CHashWriter hw(SER_GETHASH, PROTOCOL_VERSION);
+    hw << tx.GetHash();
+    hw << dataToBeSigned;
+    return hw.GetHash();
+}
+
+/**
+ * Successful contextual prechecks of smart transaction outputs, keyed by txid, output number and consensus branch and
+ * tagged with the chain tip and height they were checked against. Prechecks done when a transaction enters the mempool
+ * are done again against the same tip and height when the next block containing it is connected, and those repeats are
+ * skipped. Prechecks depend on the chain they are checked against, so the cache only ever holds results for the current
+ * tip, and everything is dropped when the tip changes, including on reorg.
+ */
+class CPrecheckCache
+{
+private:
+    static const size_t MAX_ENTRIES = 100000;
+
+    boost::mutex cs;
+    uint256 tipHash;
+    uint32_t height;
+    std::set<std::tuple<uint256, int32_t, uint32_t>> passed;
+
+    // must be called with cs held, returns true if the cache is for this context
+    bool SetContext(const uint256 &contextTip, uint32_t contextHeight, bool reset)
+    {
+        if (contextTip != tipHash || contextHeight != height)
+        {
+            if (!reset)
+            {
+                return false;
+            }
+            passed.clear();
+            tipHash = contextTip;
+            height = contextHeight;
+        }
+        return true;
+    }
+
+public:
+    CPrecheckCache() : height(0) {}
+
+    bool Contains(const uint256 &contextTip, uint32_t contextHeight, const uint256 &txid, int32_t outNum, uint32_t branchId)
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        return SetContext(contextTip, contextHeight, false) && passed.count(std::make_tuple(txid, outNum, branchId));
+    }
+
+    void Add(const uint256 &contextTip, uint32_t contextHeight, const uint256 &txid, int32_t outNum, uint32_t branchId)
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        SetContext(contextTip, contextHeight, true);
+        if (passed.size() >= MAX_ENTRIES)
+        {
+            passed.clear();
+        }
+        passed.insert(std::make_tuple(txid, outNum, branchId));
+    }
+};
+
+static CPrecheckCache precheckCache;
+
 /**
  * Check a transaction contextually against a set of consensus rules valid at a given block height.
  *
@@ -1334,36 +1678,8 @@ bool ContextualCheckTransaction(
          !tx.vShieldedSpend.empty() ||
          !tx.vShieldedOutput.empty()))
     {
-        auto consensusBranchId = CurrentEpochBranchId(nHeight, chainparams.GetConsensus());
-        // Empty output script.
-        CScript scriptCode;
-        bool sigHashSingle = false;
-
-        if (isVerusVault && tx.vJoinSplit.empty() && tx.vShieldedSpend.empty() && !tx.vShieldedOutput.empty() && tx.vin.size() > 0)
+        if (!GetShieldedSignatureHash(tx, chainparams, nHeight, dataToBeSigned))
         {
-            // if vin[0] is a smart signature for SIGHASH_SINGLE | SIGHASH_ANYONECANPAY, and the tx has no shielded spends,
-            // but does have shielded outputs, the transaction binding signature is only bound to the transparent input,
-            // all z-outputs, and no z-inputs. if there are shielded inputs, we do not afford the transaction this exception
-            CSmartTransactionSignatures smartSigs;
-            std::vector<unsigned char> ffVec = GetFulfillmentVector(tx.vin[0].scriptSig);
-            if (ffVec.size() && (smartSigs = CSmartTransactionSignatures(std::vector<unsigned char>(ffVec.begin(), ffVec.end()))).IsValid())
-            {
-                if (smartSigs.sigHashType == (SIGHASH_SINGLE | SIGHASH_ANYONECANPAY))
-                {
-                    sigHashSingle = true;
-                }
-            }
-        }
-        try {
-            if (sigHashSingle == true)
-            {
-                dataToBeSigned = SignatureHash(scriptCode, tx, 0, SIGHASH_SINGLE | SIGHASH_ANYONECANPAY, 0, consensusBranchId);
-            }
-            else
-            {
-                dataToBeSigned = SignatureHash(scriptCode, tx, NOT_AN_INPUT, SIGHASH_ALL, 0, consensusBranchId);
-            }
-        } catch (std::logic_error ex) {
             return state.DoS(100, error("CheckTransaction(): error computing signature hash"),
                              REJECT_INVALID, "error-computing-signature-hash");
         }
@@ -1403,66 +1719,35 @@ bool ContextualCheckTransaction(
     if (!tx.vShieldedSpend.empty() ||
         !tx.vShieldedOutput.empty())
     {
-        auto ctx = librustzcash_sapling_verification_ctx_init();
-
-        for (const SpendDescription &spend : tx.vShieldedSpend) {
-            if (!librustzcash_sapling_check_spend(
-                ctx,
-                spend.cv.begin(),
-                spend.anchor.begin(),
-                spend.nullifier.begin(),
-                spend.rk.begin(),
-                spend.zkproof.begin(),
-                spend.spendAuthSig.begin(),
-                dataToBeSigned.begin()
-            ))
-            {
-                librustzcash_sapling_verification_ctx_free(ctx);
-                return state.DoS(100, error("ContextualCheckTransaction(): Sapling spend description invalid"),
-                                      REJECT_INVALID, "bad-txns-sapling-spend-description-invalid");
-            }
-        }
-
-        for (const OutputDescription &output : tx.vShieldedOutput) {
-            if (!librustzcash_sapling_check_output(
-                ctx,
-                output.cv.begin(),
-                output.cm.begin(),
-                output.ephemeralKey.begin(),
-                output.zkproof.begin()
-            ))
+        // proofs already verified, in parallel or when the transaction entered the mempool, are not checked again
+        uint256 proofKey = SaplingProofCacheKey(tx, dataToBeSigned);
+        if (!saplingProofCache.Contains(proofKey))
+        {
+            if (!VerifySaplingBundle(tx, dataToBeSigned, state))
             {
-                librustzcash_sapling_verification_ctx_free(ctx);
-                return state.DoS(100, error("ContextualCheckTransaction(): Sapling output description invalid"),
-                                      REJECT_INVALID, "bad-txns-sapling-output-description-invalid");
+                return false;
             }
+            saplingProofCache.Add(proofKey);
         }
-
-        if (!librustzcash_sapling_final_check(
-            ctx,
-            tx.valueBalance,
-            tx.bindingSig.begin(),
-            dataToBeSigned.begin()
-        ))
-        {
-            librustzcash_sapling_verification_ctx_free(ctx);
-            return state.DoS(100, error("ContextualCheckTransaction(): Sapling binding signature invalid"),
-                                  REJECT_INVALID, "bad-txns-sapling-binding-signature-invalid");
-        }
-
-        librustzcash_sapling_verification_ctx_free(ctx);
     }
 
-    // precheck all crypto conditions
+    // precheck all crypto conditions, skipping any that already passed against the same chain tip and height
+    uint256 precheckTip = chainActive.LastTip() ? chainActive.LastTip()->GetBlockHash() : uint256();
+    uint32_t precheckBranchId = CurrentEpochBranchId(nHeight, chainparams.GetConsensus());
+    const uint256 txid = tx.GetHash();
     for (int i = 0; i < tx.vout.size(); i++)
     {
         COptCCParams p;
-        if (tx.vout[i].scriptPubKey.IsPayToCryptoCondition(p))
+        if (tx.IsPayToCryptoCondition(i, p))
         {
             if (!p.IsValid(isPBaaS, nHeight) && isPBaaS)
             {
                 return state.DoS(10, error(state.GetRejectReason().c_str()), REJECT_INVALID, "bad-txns-failed-params-precheck");
             }
+            if (precheckCache.Contains(precheckTip, nHeight, txid, i, precheckBranchId))
+            {
+                continue;
+            }
             if (p.evalCode == EVAL_NONE)
             {
                 if (!EvalNoneContextualPreCheck(tx, i, state, nHeight))
@@ -1472,10 +1757,8 @@ bool ContextualCheckTransaction(
             }
             else
             {
-                CCcontract_info CC;
-                CCcontract_info *cp;
-                if (!((p.evalCode <= EVAL_LAST) &&
-                      (cp = CCinit(&CC, p.evalCode))))
+                const CCEvalFunctions &evalFunctions = GetCCEvalFunctions(p.evalCode);
+                if (p.evalCode > EVAL_LAST || !evalFunctions.contextualprecheck)
                 {
                     return state.DoS(100, error("ContextualCheckTransaction(): Invalid smart transaction eval code"), REJECT_INVALID, "bad-txns-evalcode-invalid");
                 }
@@ -1488,7 +1771,11 @@ bool ContextualCheckTransaction(
                     }
                     return state.DoS(100, error("ContextualCheckTransaction(): smart transaction params exceed maximum size"), REJECT_INVALID, "bad-txns-script-element-too-large");
                 }
-                if (!CC.contextualprecheck(tx, i, state, nHeight))
+                TRACE4(cc, eval_start, p.evalCode, true, tx.GetHash().begin(), i);
+                int64_t nPrecheckStart = GetTimeMicros();
+                bool fPrecheckValid = evalFunctions.contextualprecheck(tx, i, state, nHeight);
+                RecordCCEval(p.evalCode, true, fPrecheckValid, GetTimeMicros() - nPrecheckStart);
+                if (!fPrecheckValid)
                 {
                     if (LogAcceptCategory("precheck"))
                     {
@@ -1500,6 +1787,7 @@ bool ContextualCheckTransaction(
                     return state.DoS(10, error(state.GetRejectReason().c_str()), REJECT_INVALID, "bad-txns-failed-precheck" );
                 }
             }
+            precheckCache.Add(precheckTip, nHeight, txid, i, precheckBranchId);
         }
     }
     return true;
@@ -1534,6 +1822,9 @@ bool CheckTransaction(const CTransaction& tx, CValidationState &state,
         return false;
     } else {
         // Ensure that zk-SNARKs verify
+        if (tx.vJoinSplit.size()) {
+            ZC_WaitForParams();
+        }
         BOOST_FOREACH(const JSDescription &joinsplit, tx.vJoinSplit) {
             if (!joinsplit.Verify(*pzcashParams, verifier, tx.joinSplitPubKey)) {
                 return state.DoS(100, error("CheckTransaction(): joinsplit does not verify"),
@@ -1923,9 +2214,27 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransa
     return AcceptToMemoryPoolInt(pool, state, tx, fLimitFree, fLimitDust, pfMissingInputs, fRejectAbsurdFee, dosLevel);
 }
 
-bool AcceptToMemoryPoolInt(CTxMemPool& pool, CValidationState &state, const CTransaction &tx, bool fLimitFree, bool fLimitDust, bool* pfMissingInputs, bool fRejectAbsurdFee, int dosLevel, int32_t simHeight, int expireThreshold)
+// traces a transaction left out of the mempool on any of the many ways out of AcceptToMemoryPoolInt
+struct CMempoolRejectTrace
+{
+    const CTransaction &tx;
+    const CValidationState &state;
+    bool fAccepted;
+
+    CMempoolRejectTrace(const CTransaction &txIn, const CValidationState &stateIn) : tx(txIn), state(stateIn), fAccepted(false) {}
+    ~CMempoolRejectTrace()
+    {
+        if (!fAccepted)
+        {
+            TRACE3(mempool, rejected, tx.GetHash().begin(), state.GetRejectReason().c_str(), state.GetRejectCode());
+        }
+    }
+};
+
+bool AcceptToMemoryPoolInt(CTxMemPool& pool, CValidationState &state, const CTransaction &tx, bool fLimitFree, bool fLimitDust, bool* pfMissingInputs, bool fRejectAbsurdFee, int dosLevel, int32_t simHeight, int expireThreshold, bool fContextFreeChecked, int64_t nAcceptTime)
 {
     AssertLockHeld(cs_main);
+    CMempoolRejectTrace rejectTrace(tx, state);
     if (pfMissingInputs)
         *pfMissingInputs = false;
 
@@ -1960,7 +2269,8 @@ bool AcceptToMemoryPoolInt(CTxMemPool& pool, CValidationState &state, const CTra
         //fprintf(stderr,"AcceptToMemoryPool komodo_validate_interest failure\n");
         return error("AcceptToMemoryPool: komodo_validate_interest failed");
     }
-    if (!CheckTransaction(tx, state, verifier))
+    // AcceptToMemoryPoolBatch has already run CheckTransaction outside of cs_main
+    if (!fContextFreeChecked && !CheckTransaction(tx, state, verifier))
     {
         return error("AcceptToMemoryPool: CheckTransaction failed");
     }
@@ -2179,7 +2489,7 @@ bool AcceptToMemoryPoolInt(CTxMemPool& pool, CValidationState &state, const CTra
                 for (int32_t outNum = 0; outNum < tx.vout.size(); outNum++)
                 {
                     int32_t sysOutNum = -1, notarizationOut = -1, evidenceOutStart = -1, evidenceOutEnd = -1;
-                    if (tx.vout[outNum].scriptPubKey.IsPayToCryptoCondition(p) &&
+                    if (tx.IsPayToCryptoCondition(outNum, p) &&
                         p.IsValid() &&
                         p.evalCode == EVAL_CROSSCHAIN_IMPORT &&
                         p.vData.size() > 1 &&
@@ -2286,7 +2596,7 @@ bool AcceptToMemoryPoolInt(CTxMemPool& pool, CValidationState &state, const CTra
         // it has passed ContextualCheckInputs and therefore this is correct.
         auto consensusBranchId = CurrentEpochBranchId(chainActive.Height() + 1, Params().GetConsensus());
 
-        CTxMemPoolEntry entry(tx, nFees, GetTime(), dPriority, chainActive.Height(), mempool.HasNoInputsOf(tx), fSpendsCoinbase, consensusBranchId, txDesc.IsValid() && txDesc.IsReserve() != 0);
+        CTxMemPoolEntry entry(tx, nFees, nAcceptTime ? nAcceptTime : GetTime(), dPriority, chainActive.Height(), mempool.HasNoInputsOf(tx), fSpendsCoinbase, consensusBranchId, txDesc.IsValid() && txDesc.IsReserve() != 0);
 
         unsigned int nSize = entry.GetTxSize();
 
@@ -2407,6 +2717,8 @@ bool AcceptToMemoryPoolInt(CTxMemPool& pool, CValidationState &state, const CTra
         if ( komodo_is_notarytx(tx) == 0 )
             KOMODO_ON_DEMAND++;
         pool.addUnchecked(hash, entry, !IsInitialBlockDownload(chainParams));
+        rejectTrace.fAccepted = true;
+        TRACE3(mempool, added, hash.begin(), entry.GetTxSize(), entry.GetFee());
 
         if (txDesc.IsValid())
         {
@@ -2425,20 +2737,56 @@ bool AcceptToMemoryPoolInt(CTxMemPool& pool, CValidationState &state, const CTra
             if (fSpentIndex) {
                 pool.addSpentIndex(entry, view);
             }
+
+            if (fReserveTransferIndex) {
+                pool.addReserveTransferIndex(entry);
+            }
         }
     }
 
     return true;
 }
 
+static thread_local CThreadReadStats threadReadStats;
+
+const CThreadReadStats &GetThreadReadStats()
+{
+    return threadReadStats;
+}
+
+// adds the time from its construction to its destruction, and the rows it is given, to this thread's index scans.
+// scans that read in parallel are timed by the thread that waits for them
+class CIndexScanTimer
+{
+private:
+    int64_t nStart;
+
+public:
+    uint64_t nRows;
+
+    CIndexScanTimer() : nStart(GetTimeMicros()), nRows(0) {}
+    ~CIndexScanTimer()
+    {
+        threadReadStats.nIndexScans++;
+        threadReadStats.nIndexRows += nRows;
+        threadReadStats.nIndexScanMicros += GetTimeMicros() - nStart;
+    }
+};
+
 bool GetTimestampIndex(const unsigned int &high,const unsigned int &low, bool fActiveOnly,
     std::vector<std::pair<uint256, unsigned int> > &hashes)
 {
     if (!fTimestampIndex)
         return error("Timestamp index not enabled");
 
+    if (IsIndexBuilding(BACKGROUND_INDEX_TIMESTAMP))
+        return error("Timestamp index is still being built");
+
+    CIndexScanTimer scanTimer;
+    size_t nPrior = hashes.size();
     if (!pblocktree->ReadTimestampIndex(high, low, fActiveOnly, hashes))
         return error("Unable to get hashes for timestamps");
+    scanTimer.nRows = hashes.size() - nPrior;
 
     return true;
 }
@@ -2452,88 +2800,1159 @@ bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value)
     if (mempool.getSpentIndex(key, value))
         return true;
 
+    CIndexScanTimer scanTimer;
     if (!pblocktree->ReadSpentIndex(key, value))
         //return error("Unable to get spent index information");
         return false;
+    scanTimer.nRows = 1;
 
     return true;
 }
 
+size_t GetSpentIndex(const std::vector<CSpentIndexKey> &keys, std::vector<CSpentIndexValue> &values, std::vector<unsigned char> &found)
+{
+    AssertLockHeld(cs_main);
+    values.assign(keys.size(), CSpentIndexValue());
+    found.assign(keys.size(), 0);
+    if (!fSpentIndex)
+    {
+        return 0;
+    }
+
+    size_t nFound = 0;
+    std::vector<size_t> dbIndex;
+    std::vector<CSpentIndexKey> dbKeys;
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        if (mempool.getSpentIndex(keys[i], values[i]))
+        {
+            found[i] = 1;
+            nFound++;
+        }
+        else
+        {
+            dbIndex.push_back(i);
+            dbKeys.push_back(keys[i]);
+        }
+    }
+
+    CIndexScanTimer scanTimer;
+    size_t nMempoolFound = nFound;
+    std::vector<CSpentIndexValue> dbValues;
+    std::vector<unsigned char> dbFound;
+    pblocktree->ReadSpentIndex(dbKeys, dbValues, dbFound);
+    for (size_t j = 0; j < dbIndex.size(); j++)
+    {
+        if (dbFound[j])
+        {
+            values[dbIndex[j]] = dbValues[j];
+            found[dbIndex[j]] = 1;
+            nFound++;
+        }
+    }
+    scanTimer.nRows = nFound - nMempoolFound;
+    return nFound;
+}
+
 bool GetAddressIndex(const uint160& addressHash, int type,
                      std::vector<CAddressIndexDbEntry>& addressIndex,
-                     int start, int end)
+                     int start, int end, unsigned int maxCount, const CAddressIndexKey *pAfter)
 {
     if (!fAddressIndex)
         return error("address index not enabled");
 
-    if (!pblocktree->ReadAddressIndex(addressHash, type, addressIndex, start, end))
+    CIndexScanTimer scanTimer;
+    size_t nPrior = addressIndex.size();
+    if (!pblocktree->ReadAddressIndex(addressHash, type, addressIndex, start, end, maxCount, pAfter))
         return error("unable to get txids for address");
+    scanTimer.nRows = addressIndex.size() - nPrior;
 
     return true;
 }
 
 bool GetAddressUnspent(const uint160& addressHash, int type,
-                       std::vector<CAddressUnspentDbEntry>& unspentOutputs)
+                       std::vector<CAddressUnspentDbEntry>& unspentOutputs,
+                       unsigned int maxCount, const CAddressUnspentKey *pAfter, const CDBSnapshot *pSnapshot)
 {
     if (!fAddressIndex)
         return error("address index not enabled");
 
-    if (!pblocktree->ReadAddressUnspentIndex(addressHash, type, unspentOutputs))
+    CIndexScanTimer scanTimer;
+    size_t nPrior = unspentOutputs.size();
+    if (!pblocktree->ReadAddressUnspentIndex(addressHash, type, unspentOutputs, maxCount, pAfter, pSnapshot))
         return error("unable to get txids for address");
+    scanTimer.nRows = unspentOutputs.size() - nPrior;
 
     return true;
 }
 
-bool myAddtomempool(CTransaction &tx, CValidationState *pstate, int32_t simHeight, bool limitFree, bool fLimitDust, bool *missinginputs)
-{
-    CValidationState state;
-    if (!pstate)
-        pstate = &state;
-    CTransaction Ltx; bool fOverrideFees = false;
-    if ( mempool.lookup(tx.GetHash(),Ltx) == 0 )
-        return(AcceptToMemoryPoolInt(mempool, *pstate, tx, limitFree, fLimitDust, missinginputs, !fOverrideFees, -1, simHeight));
-    else return(true);
-}
-
-void myRemovefrommempool(const CTransaction &tx)
+size_t AcceptToMemoryPoolBatch(CTxMemPool& pool, const std::vector<CTransaction> &txs, std::vector<CValidationState> &states,
+                               std::vector<unsigned char> &accepted, std::vector<unsigned char> &missingInputs,
+                               bool fLimitFree, bool fLimitDust, const std::vector<unsigned char> &rejectAbsurdFee,
+                               const std::vector<int64_t> &acceptTimes)
 {
-    std::list<CTransaction> removed;
-    mempool.remove(tx, removed, true);
-}
+    const CChainParams &chainparams = Params();
+    states.assign(txs.size(), CValidationState());
+    accepted.assign(txs.size(), 0);
+    missingInputs.assign(txs.size(), 0);
+
+    // the rules of the next block and the outputs already spendable are taken under a brief lock. outputs created
+    // by earlier transactions of the batch are not known yet, and spends of them are only checked when accepting
+    int nextBlockHeight;
+    uint32_t consensusBranchId;
+    std::map<uint256, CCoins> spentCoins;
+    {
+        LOCK2(cs_main, pool.cs);
+        nextBlockHeight = chainActive.Height() + 1;
+        consensusBranchId = CurrentEpochBranchId(nextBlockHeight, chainparams.GetConsensus());
+        CCoinsViewMemPool viewMemPool(pcoinsTip, pool);
+        for (const CTransaction &tx : txs)
+        {
+            if (tx.IsMint())
+            {
+                continue;
+            }
+            for (const CTxIn &txin : tx.vin)
+            {
+                CCoins coins;
+                if (!spentCoins.count(txin.prevout.hash) && viewMemPool.GetCoins(txin.prevout.hash, coins))
+                {
+                    spentCoins.insert(std::make_pair(txin.prevout.hash, coins));
+                }
+            }
+        }
+    }
 
-bool myGetTransaction(const uint256 &hash, CTransaction &txOut, uint256 &hashBlock, bool checkMempool)
-{
-    // need a GetTransaction without lock so the validation code for assets can run without deadlock
+    // Sapling proofs go to saplingProofCache and signatures to the signature cache, where the checks in context find
+    // them. smart transaction inputs depend on chain state and are left to those checks
+    std::vector<unsigned char> contextFreeChecked(txs.size(), 0);
+    RunInParallel(txs.size(), [&](size_t i)
     {
-        //fprintf(stderr,"check mempool\n");
-        if (checkMempool && mempool.lookup(hash, txOut))
+        const CTransaction &tx = txs[i];
+        auto verifier = libzcash::ProofVerifier::Strict();
+        if (!CheckTransaction(tx, states[i], verifier))
+        {
+            return true;
+        }
+        contextFreeChecked[i] = 1;
+        if (tx.IsMint())
         {
-            //fprintf(stderr,"found in mempool\n");
             return true;
         }
-    }
-    //fprintf(stderr,"check disk\n");
 
-    if (fTxIndex) {
-        CDiskTxPos postx;
-        //fprintf(stderr,"ReadTxIndex\n");
-        if (pblocktree->ReadTxIndex(hash, postx)) {
-            //fprintf(stderr,"OpenBlockFile\n");
-            CAutoFile file(OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
-            if (file.IsNull())
-                return error("%s: OpenBlockFile failed", __func__);
-            CBlockHeader header;
-            //fprintf(stderr,"seek and read\n");
-            try {
-                file >> header;
-                fseek(file.Get(), postx.nTxOffset, SEEK_CUR);
-                file >> txOut;
-            } catch (const std::exception& e) {
-                return error("%s: Deserialize or I/O error - %s", __func__, e.what());
-            }
-            hashBlock = header.GetHash();
-            if (txOut.GetHash() != hash)
-            {
+        uint256 dataToBeSigned;
+        CValidationState proofState;
+        if ((tx.vShieldedSpend.size() || tx.vShieldedOutput.size()) &&
+            GetShieldedSignatureHash(tx, chainparams, nextBlockHeight, dataToBeSigned) &&
+            VerifySaplingBundle(tx, dataToBeSigned, proofState))
+        {
+            saplingProofCache.Add(SaplingProofCacheKey(tx, dataToBeSigned));
+        }
+
+        PrecomputedTransactionData txdata(tx);
+        for (unsigned int j = 0; j < tx.vin.size(); j++)
+        {
+            auto coinsIt = spentCoins.find(tx.vin[j].prevout.hash);
+            if (coinsIt == spentCoins.end() ||
+                !coinsIt->second.IsAvailable(tx.vin[j].prevout.n) ||
+                coinsIt->second.vout[tx.vin[j].prevout.n].scriptPubKey.IsPayToCryptoCondition())
+            {
+                continue;
+            }
+            CScriptCheck check(coinsIt->second, tx, j, STANDARD_SCRIPT_VERIFY_FLAGS, true, consensusBranchId, &txdata);
+            if (!check())
+            {
+                break;
+            }
+        }
+        return true;
+    });
+
+    size_t nAccepted = 0;
+    for (size_t i = 0; i < txs.size(); i++)
+    {
+        if (txs[i].IsCoinBase())
+        {
+            states[i].DoS(100, error("AcceptToMemoryPoolBatch: coinbase as individual tx"), REJECT_INVALID, "coinbase");
+            continue;
+        }
+        if (!contextFreeChecked[i])
+        {
+            if (states[i].IsValid())
+            {
+                states[i].DoS(0, false, REJECT_INVALID, "bad-txns-check-failed");
+            }
+            continue;
+        }
+        LOCK(cs_main);
+        bool fMissingInputs = false;
+        if (AcceptToMemoryPoolInt(pool, states[i], txs[i], fLimitFree, fLimitDust, &fMissingInputs, rejectAbsurdFee[i], -1, 0,
+                                  TX_EXPIRING_SOON_THRESHOLD, true, acceptTimes.empty() ? 0 : acceptTimes[i]))
+        {
+            accepted[i] = 1;
+            nAccepted++;
+        }
+        missingInputs[i] = fMissingInputs;
+    }
+    return nAccepted;
+}
+
+static const uint64_t MEMPOOL_DUMP_VERSION = 1;
+// transactions revalidated together when loading the mempool, bounding how long shutdown waits on a load
+static const size_t MEMPOOL_LOAD_BATCH_SIZE = 500;
+
+bool DumpMempool()
+{
+    int64_t nStart = GetTimeMicros();
+
+    // entries are written oldest first, so that most transactions follow those they spend
+    std::vector<std::pair<int64_t, std::shared_ptr<const CTransaction>>> entries;
+    std::map<uint256, std::pair<double, CAmount> > mapDeltas;
+    {
+        LOCK(mempool.cs);
+        entries.reserve(mempool.mapTx.size());
+        for (auto it = mempool.mapTx.begin(); it != mempool.mapTx.end(); it++)
+        {
+            entries.push_back(std::make_pair(it->GetTime(), it->GetSharedTx()));
+        }
+    }
+    mempool.GetDeltas(mapDeltas);
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const std::pair<int64_t, std::shared_ptr<const CTransaction>> &a,
+                        const std::pair<int64_t, std::shared_ptr<const CTransaction>> &b) { return a.first < b.first; });
+
+    int64_t nMid = GetTimeMicros();
+
+    try
+    {
+        boost::filesystem::path path = GetDataDir() / "mempool.dat";
+        boost::filesystem::path pathNew = GetDataDir() / "mempool.dat.new";
+        FILE *filestr = fopen(pathNew.string().c_str(), "wb");
+        if (!filestr)
+        {
+            return error("%s: failed to open %s", __func__, pathNew.string());
+        }
+        CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+
+        file << MEMPOOL_DUMP_VERSION;
+        file << (uint64_t)entries.size();
+        for (auto &oneEntry : entries)
+        {
+            file << *oneEntry.second;
+            file << oneEntry.first;
+        }
+        file << mapDeltas;
+
+        FileCommit(file.Get());
+        file.fclose();
+        if (!RenameOver(pathNew, path))
+        {
+            return error("%s: failed to rename %s", __func__, pathNew.string());
+        }
+    }
+    catch (const std::exception& e)
+    {
+        return error("%s: failed to dump mempool: %s", __func__, e.what());
+    }
+
+    int64_t nLast = GetTimeMicros();
+    LogPrintf("Dumped mempool of %u transactions: %.3fs to copy, %.3fs to dump\n", entries.size(),
+              (nMid - nStart) * 0.000001, (nLast - nMid) * 0.000001);
+    return true;
+}
+
+bool LoadMempool()
+{
+    boost::filesystem::path path = GetDataDir() / "mempool.dat";
+    FILE *filestr = fopen(path.string().c_str(), "rb");
+    CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+    if (file.IsNull())
+    {
+        // missing on first startup and after -persistmempool=0
+        return false;
+    }
+
+    int64_t nStart = GetTimeMillis();
+    std::vector<CTransaction> txs;
+    std::vector<int64_t> acceptTimes;
+    std::map<uint256, std::pair<double, CAmount> > mapDeltas;
+    try
+    {
+        uint64_t version;
+        file >> version;
+        if (version != MEMPOOL_DUMP_VERSION)
+        {
+            return error("%s: unknown mempool.dat version %lu", __func__, version);
+        }
+        uint64_t num;
+        file >> num;
+        while (num--)
+        {
+            CTransaction tx;
+            int64_t nTime;
+            file >> tx;
+            file >> nTime;
+            txs.push_back(tx);
+            acceptTimes.push_back(nTime);
+        }
+        file >> mapDeltas;
+    }
+    catch (const std::exception& e)
+    {
+        return error("%s: failed to read mempool.dat, continuing with an empty mempool: %s", __func__, e.what());
+    }
+
+    // prioritisations are restored first, so the entries they apply to enter with them
+    for (auto &oneDelta : mapDeltas)
+    {
+        mempool.PrioritiseTransaction(oneDelta.first, oneDelta.first.GetHex(), oneDelta.second.first, oneDelta.second.second);
+    }
+
+    // any transaction dumped ahead of one it spends is retried once the others are in
+    size_t nAccepted = 0, nFailed = 0, nAlreadyHave = 0;
+    while (txs.size() && !ShutdownRequested())
+    {
+        std::vector<CTransaction> retryTxs;
+        std::vector<int64_t> retryTimes;
+        size_t nLastAccepted = nAccepted;
+        for (size_t start = 0; start < txs.size() && !ShutdownRequested(); start += MEMPOOL_LOAD_BATCH_SIZE)
+        {
+            size_t end = std::min(start + MEMPOOL_LOAD_BATCH_SIZE, txs.size());
+            std::vector<CTransaction> batchTxs;
+            std::vector<int64_t> batchTimes;
+            for (size_t i = start; i < end; i++)
+            {
+                if (mempool.exists(txs[i].GetHash()))
+                {
+                    nAlreadyHave++;
+                    continue;
+                }
+                batchTxs.push_back(txs[i]);
+                batchTimes.push_back(acceptTimes[i]);
+            }
+
+            std::vector<CValidationState> states;
+            std::vector<unsigned char> accepted, missingInputs;
+            nAccepted += AcceptToMemoryPoolBatch(mempool, batchTxs, states, accepted, missingInputs, false, true,
+                                                 std::vector<unsigned char>(batchTxs.size(), 0), batchTimes);
+            for (size_t i = 0; i < batchTxs.size(); i++)
+            {
+                if (accepted[i])
+                {
+                    continue;
+                }
+                if (missingInputs[i])
+                {
+                    retryTxs.push_back(batchTxs[i]);
+                    retryTimes.push_back(batchTimes[i]);
+                }
+                else
+                {
+                    nFailed++;
+                }
+            }
+            boost::this_thread::interruption_point();
+        }
+        if (nAccepted == nLastAccepted)
+        {
+            // whatever is left spends outputs that are gone
+            nFailed += retryTxs.size();
+            break;
+        }
+        txs.swap(retryTxs);
+        acceptTimes.swap(retryTimes);
+    }
+
+    LogPrintf("Imported mempool transactions from disk: %u succeeded, %u failed, %u already present, %dms\n",
+              nAccepted, nFailed, nAlreadyHave, GetTimeMillis() - nStart);
+    return true;
+}
+
+bool GetAddressIndex(const std::vector<std::pair<uint160, int>> &addresses,
+                     std::vector<CAddressIndexDbEntry> &addressIndex,
+                     int start, int end)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    CIndexScanTimer scanTimer;
+    std::vector<std::vector<CAddressIndexDbEntry>> perAddress(addresses.size());
+    if (!RunInParallel(addresses.size(), [&addresses, &perAddress, start, end](size_t i)
+        {
+            return pblocktree->ReadAddressIndex(addresses[i].first, addresses[i].second, perAddress[i], start, end);
+        }))
+    {
+        return error("unable to get txids for address");
+    }
+
+    // each address' entries are in chain order, so merge them, with ties kept in the order the addresses were given
+    typedef std::tuple<int, unsigned int, size_t> MergePosition;
+    std::priority_queue<MergePosition, std::vector<MergePosition>, std::greater<MergePosition>> nextEntries;
+    std::vector<size_t> positions(addresses.size(), 0);
+    size_t total = addressIndex.size();
+    for (size_t i = 0; i < perAddress.size(); i++)
+    {
+        total += perAddress[i].size();
+        if (perAddress[i].size())
+        {
+            nextEntries.push(MergePosition(perAddress[i][0].first.blockHeight, perAddress[i][0].first.txindex, i));
+        }
+    }
+    addressIndex.reserve(total);
+    scanTimer.nRows = total - addressIndex.size();
+    while (!nextEntries.empty())
+    {
+        size_t i = std::get<2>(nextEntries.top());
+        nextEntries.pop();
+        addressIndex.push_back(perAddress[i][positions[i]]);
+        if (++positions[i] < perAddress[i].size())
+        {
+            const CAddressIndexKey &key = perAddress[i][positions[i]].first;
+            nextEntries.push(MergePosition(key.blockHeight, key.txindex, i));
+        }
+    }
+    return true;
+}
+
+bool GetAddressUnspent(const std::vector<std::pair<uint160, int>> &addresses,
+                       std::vector<CAddressUnspentDbEntry> &unspentOutputs,
+                       const CDBSnapshot *pSnapshot)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    CIndexScanTimer scanTimer;
+    size_t nPrior = unspentOutputs.size();
+
+    // below this many addresses per chunk, another thread costs more than sharing a cursor saves
+    static const size_t MIN_ADDRESSES_PER_CHUNK = 8;
+
+    // read in key order, in contiguous chunks that each move one cursor forward
+    std::vector<size_t> order(addresses.size());
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&addresses](size_t a, size_t b)
+    {
+        return std::make_pair(addresses[a].second, addresses[a].first) < std::make_pair(addresses[b].second, addresses[b].first);
+    });
+
+    size_t nChunks = std::max((size_t)1, std::min((size_t)std::max(GetNumCores(), 1), addresses.size() / MIN_ADDRESSES_PER_CHUNK));
+    size_t chunkSize = (addresses.size() + nChunks - 1) / nChunks;
+    std::vector<std::vector<std::vector<CAddressUnspentDbEntry>>> perChunk(nChunks);
+    if (!RunInParallel(nChunks, [&addresses, &order, &perChunk, chunkSize, pSnapshot](size_t chunk)
+        {
+            std::vector<std::pair<uint160, int>> chunkAddresses;
+            for (size_t j = chunk * chunkSize; j < std::min(order.size(), (chunk + 1) * chunkSize); j++)
+            {
+                chunkAddresses.push_back(addresses[order[j]]);
+            }
+            return pblocktree->ReadAddressUnspentIndex(chunkAddresses, perChunk[chunk], pSnapshot);
+        }))
+    {
+        return error("unable to get txids for address");
+    }
+
+    // results are returned in the order the addresses were given
+    std::vector<std::vector<CAddressUnspentDbEntry> *> perAddress(addresses.size());
+    for (size_t j = 0; j < order.size(); j++)
+    {
+        perAddress[order[j]] = &perChunk[j / chunkSize][j % chunkSize];
+    }
+    for (auto *pOneAddress : perAddress)
+    {
+        unspentOutputs.insert(unspentOutputs.end(), pOneAddress->begin(), pOneAddress->end());
+    }
+    scanTimer.nRows = unspentOutputs.size() - nPrior;
+    return true;
+}
+
+bool GetAddressBalance(const uint160& addressHash, int type, CAddressBalanceValue &balance)
+{
+    if (!fAddressIndex || !fAddressBalanceIndex)
+        return error("address balance index not enabled");
+
+    if (IsIndexBuilding(BACKGROUND_INDEX_ADDRESSBALANCE))
+        return error("address balance index is still being built");
+
+    CIndexScanTimer scanTimer;
+    if (!pblocktree->ReadAddressBalanceIndex(addressHash, type, balance))
+        return error("unable to get balance for address");
+    scanTimer.nRows = 1;
+
+    return true;
+}
+
+// sums the address index entries of a block into one balance change per address. spent output values, including
+// reserve currencies, come from the block undo data, so this gives the same result when connecting or disconnecting
+static void GetAddressBalanceDeltas(const CBlock &block,
+                                    const CBlockUndo &blockUndo,
+                                    const std::vector<CAddressIndexDbEntry> &addressIndex,
+                                    std::vector<CAddressBalanceDbEntry> &balanceDeltas)
+{
+    std::map<std::pair<unsigned int, uint160>, CAddressBalanceValue> deltaMap;
+    for (auto &oneEntry : addressIndex)
+    {
+        const CAddressIndexKey &key = oneEntry.first;
+        CAddressBalanceValue &delta = deltaMap[std::make_pair(key.type, key.hashBytes)];
+        if (key.spending)
+        {
+            delta.reserveBalance -= blockUndo.vtxundo[key.txindex - 1].vprevout[key.index].txout.ReserveOutValue();
+        }
+        else
+        {
+            CCurrencyValueMap reserveOut = block.vtx[key.txindex].vout[key.index].ReserveOutValue();
+            delta.reserveBalance += reserveOut;
+            delta.reserveReceived += reserveOut;
+        }
+        if (oneEntry.second > 0)
+        {
+            delta.received += oneEntry.second;
+        }
+        delta.balance += oneEntry.second;
+    }
+    for (auto &oneDelta : deltaMap)
+    {
+        balanceDeltas.push_back(std::make_pair(CAddressIndexIteratorKey(oneDelta.first.first, oneDelta.first.second), oneDelta.second));
+    }
+}
+
+// adds the address index entries of one spent or received output, without index height offsets, since these entries are
+// only used to derive balance deltas
+static void GetOutputAddressIndex(const CTxOut &out, int nHeight, int txindex, const uint256 &txhash, int index, bool spending,
+                                  std::vector<CAddressIndexDbEntry> &addressIndex)
+{
+    CAmount amount = spending ? out.nValue * -1 : out.nValue;
+    COptCCParams p;
+    if (out.scriptPubKey.IsPayToCryptoCondition(p))
+    {
+        std::vector<CTxDestination> dests = p.IsValid() ? p.GetDestinations() : out.scriptPubKey.GetDestinations();
+        for (auto &dest : dests)
+        {
+            if (dest.which() != COptCCParams::ADDRTYPE_INVALID)
+            {
+                addressIndex.push_back(make_pair(
+                    CAddressIndexKey(AddressTypeFromDest(dest), GetDestinationID(dest), nHeight, txindex, txhash, index, spending),
+                    amount));
+            }
+        }
+    }
+    else
+    {
+        CScript::ScriptType scriptType = out.scriptPubKey.GetType();
+        if (scriptType != CScript::UNKNOWN)
+        {
+            uint160 const addrHash = out.scriptPubKey.AddressHash();
+            if (!addrHash.IsNull())
+            {
+                addressIndex.push_back(make_pair(CAddressIndexKey(scriptType, addrHash, nHeight, txindex, txhash, index, spending), amount));
+            }
+        }
+    }
+}
+
+// rebuilds the address index entries of a connected block from the block and its undo data, for the index builder
+static void GetBlockAddressIndex(const CBlock &block, const CBlockUndo &blockUndo, int nHeight, std::vector<CAddressIndexDbEntry> &addressIndex)
+{
+    for (unsigned int i = 0; i < block.vtx.size(); i++)
+    {
+        const CTransaction &tx = block.vtx[i];
+        const uint256 txhash = tx.GetHash();
+        if (!tx.IsMint())
+        {
+            const CTxUndo &txundo = blockUndo.vtxundo[i - 1];
+            for (unsigned int j = 0; j < tx.vin.size() && j < txundo.vprevout.size(); j++)
+            {
+                GetOutputAddressIndex(txundo.vprevout[j].txout, nHeight, i, txhash, j, true, addressIndex);
+            }
+        }
+        for (unsigned int k = 0; k < tx.vout.size(); k++)
+        {
+            GetOutputAddressIndex(tx.vout[k], nHeight, i, txhash, k, false, addressIndex);
+        }
+    }
+}
+
+void GetBlockDeltaOutputs(const CTransaction &tx, std::vector<CBlockDeltaOutput> &outputs)
+{
+    for (unsigned int k = 0; k < tx.vout.size(); k++)
+    {
+        const CScript &script = tx.vout[k].scriptPubKey;
+        if (script.IsPayToScriptHash())
+        {
+            outputs.push_back(CBlockDeltaOutput(CScript::P2SH, uint160(std::vector<unsigned char>(script.begin() + 2, script.begin() + 22)), tx.vout[k].nValue, k));
+        }
+        else if (script.IsPayToPublicKeyHash())
+        {
+            outputs.push_back(CBlockDeltaOutput(CScript::P2PKH, uint160(std::vector<unsigned char>(script.begin() + 3, script.begin() + 23)), tx.vout[k].nValue, k));
+        }
+        else if (script.IsPayToPublicKey() || script.IsPayToCryptoCondition())
+        {
+            CTxDestination address;
+            if (ExtractDestination(script, address))
+            {
+                outputs.push_back(CBlockDeltaOutput(AddressTypeFromDest(address), GetDestinationID(address), tx.vout[k].nValue, k));
+            }
+            else
+            {
+                outputs.push_back(CBlockDeltaOutput(CScript::UNKNOWN, uint160(), tx.vout[k].nValue, k));
+            }
+        }
+    }
+}
+
+// builds the getblockdeltas summary of a block from its undo data. inputs are classified as the spent index
+// classifies them, and only those spending from a key or script hash are reported
+static void GetBlockDeltaSummary(const CBlock &block, const CBlockUndo &blockUndo, CBlockDeltaSummary &summary)
+{
+    summary.nSize = ::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION);
+    summary.txs.resize(block.vtx.size());
+    for (unsigned int i = 0; i < block.vtx.size(); i++)
+    {
+        const CTransaction &tx = block.vtx[i];
+        CBlockDeltaTx &deltaTx = summary.txs[i];
+        deltaTx.txid = tx.GetHash();
+        if (!tx.IsMint())
+        {
+            const CTxUndo &txundo = blockUndo.vtxundo[i - 1];
+            for (unsigned int j = 0; j < tx.vin.size() && j < txundo.vprevout.size(); j++)
+            {
+                const CTxOut &prevout = txundo.vprevout[j].txout;
+                int addressType = CScript::UNKNOWN;
+                uint160 addressHash;
+                COptCCParams p;
+                if (prevout.scriptPubKey.IsPayToCryptoCondition(p))
+                {
+                    std::vector<CTxDestination> dests = p.IsValid() ? p.GetDestinations() : prevout.scriptPubKey.GetDestinations();
+                    if (dests.size())
+                    {
+                        addressType = AddressTypeFromDest(dests[0]);
+                        addressHash = GetDestinationID(dests[0]);
+                    }
+                }
+                else
+                {
+                    addressType = prevout.scriptPubKey.GetType();
+                    addressHash = prevout.scriptPubKey.AddressHash();
+                }
+                if (addressType == CScript::P2PKH || addressType == CScript::P2SH)
+                {
+                    deltaTx.inputs.push_back(CBlockDeltaInput(addressType, addressHash, prevout.nValue, j, tx.vin[j].prevout.hash, tx.vin[j].prevout.n));
+                }
+            }
+        }
+        GetBlockDeltaOutputs(tx, deltaTx.outputs);
+    }
+}
+
+bool GetBlockDeltaSummary(const uint256 &blockHash, CBlockDeltaSummary &summary)
+{
+    return fBlockDeltaIndex && pblocktree->ReadBlockDeltaSummary(blockHash, summary);
+}
+
+// stores the filter of a connected block with its header, which chains it to the header of its parent
+static bool WriteBlockFilterIndex(const CBlockFilter &filter, const CBlockIndex *pindex)
+{
+    uint256 prevHeader;
+    if (pindex->pprev)
+    {
+        CBlockFilterIndexEntry prevEntry;
+        if (!pblocktree->ReadBlockFilter(pindex->pprev->GetBlockHash(), prevEntry))
+        {
+            return error("%s: no block filter for the parent of block %s", __func__, pindex->GetBlockHash().ToString());
+        }
+        prevHeader = prevEntry.header;
+    }
+    return pblocktree->WriteBlockFilter(pindex->GetBlockHash(), CBlockFilterIndexEntry(filter, prevHeader));
+}
+
+bool GetBlockFilter(const uint256 &blockHash, CBlockFilterIndexEntry &entry)
+{
+    return fBlockFilterIndex && pblocktree->ReadBlockFilter(blockHash, entry);
+}
+
+// adds a transaction of a block being connected to its statistics, with the descriptor ConnectBlock made of it
+static void AddBlockStatsTx(CBlockStats &stats, const CTransaction &tx, const CReserveTransactionDescriptor &rtxd, CAmount nTxFee)
+{
+    stats.nTx++;
+    stats.nInputs += tx.vin.size();
+    stats.nOutputs += tx.vout.size();
+    if (!tx.IsCoinBase())
+    {
+        stats.nTotalOut += tx.GetValueOut();
+        // the coinbase comes first, so the second transaction has the first fee
+        stats.nMinFee = stats.nTx == 2 ? nTxFee : std::min(stats.nMinFee, nTxFee);
+        stats.nMaxFee = std::max(stats.nMaxFee, nTxFee);
+        stats.nFees += nTxFee;
+        if (rtxd.IsValid())
+        {
+            stats.reserveFees += rtxd.ReserveFees();
+        }
+    }
+
+    if (rtxd.IsValid())
+    {
+        stats.nImports += rtxd.IsImport();
+        stats.nExports += rtxd.IsExport();
+        stats.nCurrencyDefinitions += rtxd.IsCurrencyDefinition();
+        stats.nNotarizations += rtxd.IsNotaryPrioritized();
+        if (rtxd.IsIdentityDefinition())
+        {
+            stats.nIdentityRegistrations++;
+        }
+        else if (rtxd.IsIdentity())
+        {
+            stats.nIdentityUpdates++;
+        }
+        if (rtxd.IsReserveTransfer())
+        {
+            for (const CTxOut &out : tx.vout)
+            {
+                COptCCParams p;
+                CReserveTransfer rt;
+                if (out.scriptPubKey.IsPayToCryptoCondition(p) &&
+                    p.IsValid() &&
+                    p.evalCode == EVAL_RESERVE_TRANSFER &&
+                    p.vData.size() &&
+                    (rt = CReserveTransfer(p.vData[0])).IsValid())
+                {
+                    stats.nReserveTransfers++;
+                    stats.nConversions += rt.IsConversion() || rt.IsPreConversion();
+                }
+            }
+        }
+    }
+
+    if (tx.vShieldedSpend.size() || tx.vShieldedOutput.size() || tx.vJoinSplit.size())
+    {
+        stats.nShieldedTxs++;
+        stats.nShieldedSpends += tx.vShieldedSpend.size();
+        stats.nShieldedOutputs += tx.vShieldedOutput.size();
+        stats.nJoinSplits += tx.vJoinSplit.size();
+    }
+}
+
+bool GetBlockStats(const uint256 &blockHash, CBlockStats &stats)
+{
+    return fBlockStatsIndex && pblocktree->ReadBlockStats(blockHash, stats);
+}
+
+// a root names exactly one tree, so an entry stays correct even after the anchor is popped by a reorganization
+static ShardedLRUCache<uint256, std::shared_ptr<const std::vector<unsigned char>>> saplingTreeStateCache(SAPLING_TREE_STATE_CACHE_SIZE, 0, true);
+
+bool GetSaplingTreeStates(const std::vector<uint256> &roots, std::vector<std::shared_ptr<const std::vector<unsigned char>>> &states)
+{
+    states.assign(roots.size(), nullptr);
+    std::vector<size_t> vMissing;
+    for (size_t i = 0; i < roots.size(); i++)
+    {
+        // consecutive blocks without Sapling outputs share their root
+        if (i && roots[i] == roots[i - 1] && states[i - 1])
+            states[i] = states[i - 1];
+        else if (!saplingTreeStateCache.Get(roots[i], states[i]))
+            vMissing.push_back(i);
+    }
+    if (vMissing.empty())
+        return true;
+
+    LOCK(cs_main);
+    // a view of its own keeps the anchors that are read out of the tip cache
+    CCoinsViewCache view(pcoinsTip);
+    bool fAll = true;
+    for (size_t i : vMissing)
+    {
+        if (i && roots[i] == roots[i - 1] && states[i - 1])
+        {
+            states[i] = states[i - 1];
+            continue;
+        }
+        SaplingMerkleTree tree;
+        if (!view.GetSaplingAnchorAt(roots[i], tree))
+        {
+            fAll = false;
+            continue;
+        }
+        CDataStream s(SER_NETWORK, PROTOCOL_VERSION);
+        s << tree;
+        states[i] = std::make_shared<const std::vector<unsigned char>>(s.begin(), s.end());
+        saplingTreeStateCache.Put(roots[i], states[i]);
+    }
+    return fAll;
+}
+
+// logical timestamps strictly increase along the chain, so each block's entry is derived from its predecessor's
+static bool WriteBlockTimestampIndex(const CBlockIndex *pindex)
+{
+    unsigned int logicalTS = pindex->nTime;
+    unsigned int prevLogicalTS = 0;
+
+    // retrieve logical timestamp of the previous block
+    if (pindex->pprev)
+        if (!pblocktree->ReadTimestampBlockIndex(pindex->pprev->GetBlockHash(), prevLogicalTS))
+            LogPrintf("%s: Failed to read previous block's logical timestamp\n", __func__);
+
+    if (logicalTS <= prevLogicalTS) {
+        logicalTS = prevLogicalTS + 1;
+    }
+
+    if (!pblocktree->WriteTimestampIndex(CTimestampIndexKey(logicalTS, pindex->GetBlockHash())))
+        return error("%s: Failed to write timestamp index", __func__);
+
+    if (!pblocktree->WriteTimestampBlockIndex(CTimestampBlockIndexKey(pindex->GetBlockHash()), CTimestampBlockIndexValue(logicalTS)))
+        return error("%s: Failed to write blockhash index", __func__);
+
+    return true;
+}
+
+static const char *BACKGROUND_INDEX_NAMES[BACKGROUND_INDEX_COUNT] = { "timestampindex", "addressbalanceindex", "blockfilterindex" };
+
+// whether each background index is still being built, and the height through which it is complete, under cs_main
+static bool fIndexBuilding[BACKGROUND_INDEX_COUNT] = { false, false, false };
+static int nIndexBuildHeight[BACKGROUND_INDEX_COUNT] = { -1, -1, -1 };
+
+const char *BackgroundIndexName(BackgroundIndex index)
+{
+    return BACKGROUND_INDEX_NAMES[index];
+}
+
+static bool BackgroundIndexEnabled(BackgroundIndex index)
+{
+    switch (index)
+    {
+        case BACKGROUND_INDEX_TIMESTAMP:
+            return fTimestampIndex;
+        case BACKGROUND_INDEX_ADDRESSBALANCE:
+            return fAddressIndex && fAddressBalanceIndex;
+        case BACKGROUND_INDEX_BLOCKFILTER:
+            return fBlockFilterIndex;
+        default:
+            return false;
+    }
+}
+
+bool StartIndexBuild(BackgroundIndex index)
+{
+    int height;
+    if (pblocktree->ReadIndexBuildHeight(BackgroundIndexName(index), height))
+    {
+        return true;
+    }
+    LogPrintf("%s: %s will be built in the background\n", __func__, BackgroundIndexName(index));
+    return pblocktree->WriteIndexBuildHeight(BackgroundIndexName(index), -1);
+}
+
+static void LoadIndexBuildState()
+{
+    for (int i = 0; i < BACKGROUND_INDEX_COUNT; i++)
+    {
+        int height = -1;
+        fIndexBuilding[i] = pblocktree->ReadIndexBuildHeight(BACKGROUND_INDEX_NAMES[i], height);
+        nIndexBuildHeight[i] = height;
+        if (fIndexBuilding[i])
+        {
+            LogPrintf("%s: %s is being built in the background, complete through height %d\n", __func__, BACKGROUND_INDEX_NAMES[i], height);
+        }
+    }
+}
+
+bool IsIndexBuilding(BackgroundIndex index)
+{
+    LOCK(cs_main);
+    return fIndexBuilding[index];
+}
+
+bool IndexCoversHeight(BackgroundIndex index, int height)
+{
+    AssertLockHeld(cs_main);
+    return !fIndexBuilding[index] || height <= nIndexBuildHeight[index];
+}
+
+// a disconnected block that a building index already covers is taken out of it again, so the builder indexes its replacement
+static void RewindIndexBuild(BackgroundIndex index, int height, bool fPersist)
+{
+    AssertLockHeld(cs_main);
+    if (fIndexBuilding[index] && height <= nIndexBuildHeight[index])
+    {
+        nIndexBuildHeight[index] = height - 1;
+        if (fPersist)
+        {
+            pblocktree->WriteIndexBuildHeight(BackgroundIndexName(index), height - 1);
+        }
+    }
+}
+
+UniValue GetIndexBuildStatus()
+{
+    LOCK(cs_main);
+    UniValue ret(UniValue::VOBJ);
+    for (int i = 0; i < BACKGROUND_INDEX_COUNT; i++)
+    {
+        UniValue oneIndex(UniValue::VOBJ);
+        bool enabled = BackgroundIndexEnabled((BackgroundIndex)i);
+        oneIndex.push_back(Pair("enabled", enabled));
+        oneIndex.push_back(Pair("synced", enabled && !fIndexBuilding[i]));
+        if (fIndexBuilding[i])
+        {
+            oneIndex.push_back(Pair("builtheight", nIndexBuildHeight[i]));
+            oneIndex.push_back(Pair("progress", (double)(nIndexBuildHeight[i] + 1) / (double)(chainActive.Height() + 1)));
+        }
+        ret.push_back(Pair(BACKGROUND_INDEX_NAMES[i], oneIndex));
+    }
+    return ret;
+}
+
+bool myAddtomempool(CTransaction &tx, CValidationState *pstate, int32_t simHeight, bool limitFree, bool fLimitDust, bool *missinginputs)
+{
+    CValidationState state;
+    if (!pstate)
+        pstate = &state;
+    CTransaction Ltx; bool fOverrideFees = false;
+    if ( mempool.lookup(tx.GetHash(),Ltx) == 0 )
+        return(AcceptToMemoryPoolInt(mempool, *pstate, tx, limitFree, fLimitDust, missinginputs, !fOverrideFees, -1, simHeight));
+    else return(true);
+}
+
+void myRemovefrommempool(const CTransaction &tx)
+{
+    std::list<CTransaction> removed;
+    mempool.remove(tx, removed, true);
+}
+
+/**
+ * A block or undo file record, which is stored after the message start and a size word. With -compressblocks, the
+ * record is zlib compressed when that makes it smaller. Compressed records are marked by BLOCKFILE_RECORD_COMPRESSED
+ * in the size word, and their data is the uncompressed size followed by the compressed stream, so files of both
+ * formats, including files mixing them, are read transparently.
+ */
+class CDiskRecord
+{
+public:
+    std::vector<unsigned char> data;
+    unsigned int nSizeWord;
+
+    template <typename T>
+    explicit CDiskRecord(const T &obj)
+    {
+        CDataStream ss(SER_DISK, CLIENT_VERSION);
+        ss << obj;
+
+        if (fCompressBlockFiles && ss.size())
+        {
+            uLongf nCompressedSize = compressBound(ss.size());
+            data.resize(4 + nCompressedSize);
+            WriteLE32(data.data(), ss.size());
+            if (compress2(data.data() + 4, &nCompressedSize, (const Bytef *)&ss[0], ss.size(), Z_DEFAULT_COMPRESSION) == Z_OK &&
+                4 + nCompressedSize < ss.size())
+            {
+                data.resize(4 + nCompressedSize);
+                nSizeWord = data.size() | BLOCKFILE_RECORD_COMPRESSED;
+                return;
+            }
+        }
+        data.assign(ss.begin(), ss.end());
+        nSizeWord = data.size();
+    }
+
+    unsigned int size() const
+    {
+        return data.size();
+    }
+
+    // appends the record to fileout, and sets pos to the position of its data
+    bool Write(CAutoFile &fileout, CDiskBlockPos &pos, const CMessageHeader::MessageStartChars &messageStart) const
+    {
+        fileout << FLATDATA(messageStart) << nSizeWord;
+
+        long fileOutPos = ftell(fileout.Get());
+        if (fileOutPos < 0)
+            return false;
+        pos.nPos = (unsigned int)fileOutPos;
+        fileout.write((const char *)data.data(), data.size());
+        return true;
+    }
+};
+
+// decompresses the data of a compressed record, which may be no larger than nMaxRawSize when uncompressed
+static std::unique_ptr<CDataStream> DecompressDiskRecord(const std::vector<unsigned char> &compressed, unsigned int nMaxRawSize)
+{
+    if (compressed.size() < 4)
+        throw std::ios_base::failure("DecompressDiskRecord: invalid record size");
+    uLongf nRawSize = ReadLE32(compressed.data());
+    if (!nRawSize || nRawSize > nMaxRawSize)
+        throw std::ios_base::failure("DecompressDiskRecord: invalid uncompressed size");
+    std::unique_ptr<CDataStream> pRecord(new CDataStream(SER_DISK, CLIENT_VERSION));
+    pRecord->resize(nRawSize);
+    uLongf nDecompressedSize = nRawSize;
+    if (uncompress((Bytef *)&(*pRecord)[0], &nDecompressedSize, compressed.data() + 4, compressed.size() - 4) != Z_OK ||
+        nDecompressedSize != nRawSize)
+        throw std::ios_base::failure("DecompressDiskRecord: corrupt compressed record");
+    return pRecord;
+}
+
+std::unique_ptr<CDataStream> ReadCompressedDiskRecord(CAutoFile &file)
+{
+    if (fseek(file.Get(), -4, SEEK_CUR))
+        throw std::ios_base::failure("ReadCompressedDiskRecord: fseek failed");
+    unsigned int nSizeWord;
+    file >> nSizeWord;
+    if (!(nSizeWord & BLOCKFILE_RECORD_COMPRESSED))
+        return nullptr;
+
+    unsigned int nSize = nSizeWord & ~BLOCKFILE_RECORD_COMPRESSED;
+    if (nSize > MAX_BLOCKFILE_SIZE)
+        throw std::ios_base::failure("ReadCompressedDiskRecord: invalid record size");
+    std::vector<unsigned char> compressed(nSize);
+    file.read((char *)compressed.data(), nSize);
+    return DecompressDiskRecord(compressed, MAX_BLOCKFILE_SIZE);
+}
+
+// returns the stored size of the block record at pos, which is smaller than nRawSize when it is compressed
+static unsigned int GetDiskRecordSize(const CDiskBlockPos &pos, unsigned int nRawSize)
+{
+    if (pos.nPos < 4)
+        return nRawSize;
+    CAutoFile filein(OpenBlockFile(CDiskBlockPos(pos.nFile, pos.nPos - 4), true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return nRawSize;
+    unsigned int nSizeWord;
+    try {
+        filein >> nSizeWord;
+    } catch (const std::exception&) {
+        return nRawSize;
+    }
+    return (nSizeWord & BLOCKFILE_RECORD_COMPRESSED) ? nSizeWord & ~BLOCKFILE_RECORD_COMPRESSED : nRawSize;
+}
+
+// reads the header of the block that file is positioned at and the transaction nTxOffset bytes after it
+static void ReadBlockTransaction(CAutoFile &file, unsigned int nTxOffset, CBlockHeader &header, CTransaction &txOut)
+{
+    std::unique_ptr<CDataStream> pRecord = ReadCompressedDiskRecord(file);
+    if (pRecord)
+    {
+        *pRecord >> header;
+        pRecord->ignore(nTxOffset);
+        *pRecord >> txOut;
+    }
+    else
+    {
+        file >> header;
+        fseek(file.Get(), nTxOffset, SEEK_CUR);
+        file >> txOut;
+    }
+}
+
+// confirmed transactions read from disk by GetTransaction and myGetTransaction, with the hash of the block each was
+// read from. PBaaS validation and RPCs read the same notarizations, definitions, imports and identities many times
+// for each block. the entries of every transaction in a block connected to or disconnected from the tip are erased,
+// so an entry never names a block the transaction has been reorganized out of
+typedef std::pair<std::shared_ptr<const CTransaction>, uint256> CCachedTransaction;
+static ShardedLRUCache<uint256, CCachedTransaction> txReadCache(DEFAULT_TX_CACHE_SIZE, 0, true);
+static std::atomic<bool> fTxReadCache(true);
+// counts erasures, so a transaction read from disk while its block is being connected or disconnected, which
+// myGetTransaction does without cs_main, is not put back after its entry was erased
+static std::atomic<uint64_t> nTxReadCacheGeneration(0);
+
+void SetTransactionCacheSize(int nEntries)
+{
+    fTxReadCache = nEntries > 0;
+    txReadCache.SetCapacity(nEntries);
+    if (!fTxReadCache)
+    {
+        txReadCache.Clear();
+    }
+}
+
+CTransactionCacheStats GetTransactionCacheStats()
+{
+    CTransactionCacheStats stats;
+    stats.nEntries = txReadCache.size();
+    stats.nCapacity = fTxReadCache ? txReadCache.capacity() : 0;
+    txReadCache.GetStats(stats.nHits, stats.nMisses, stats.nEvictions);
+    stats.nMemoryUsage = txReadCache.DynamicMemoryUsage(
+        [](const uint256 &key, const CCachedTransaction &value) {
+            return memusage::MallocUsage(sizeof(CTransaction)) + RecursiveDynamicUsage(*value.first);
+        });
+    return stats;
+}
+
+static bool GetCachedTransaction(const uint256 &hash, CTransaction &txOut, uint256 &hashBlock)
+{
+    CCachedTransaction cached;
+    if (!fTxReadCache || !txReadCache.Get(hash, cached))
+    {
+        return false;
+    }
+    txOut = *cached.first;
+    hashBlock = cached.second;
+    return true;
+}
+
+static void CacheTransaction(const CTransaction &tx, const uint256 &hashBlock, uint64_t nGeneration)
+{
+    if (fTxReadCache && nGeneration == nTxReadCacheGeneration.load())
+    {
+        txReadCache.Put(tx.GetHash(), CCachedTransaction(std::make_shared<const CTransaction>(tx), hashBlock));
+    }
+}
+
+// transactions retained from blocks pruned with -pruneproofs, which are found by txid without their block
+static bool ReadPrunedTransaction(const uint256 &hash, CTransaction &txOut, uint256 &hashBlock)
+{
+    return fHavePruned && fPruneProofs && pblocktree->ReadPrunedTransaction(hash, txOut, hashBlock);
+}
+
+static void EraseCachedTransactions(const CBlock &block)
+{
+    nTxReadCacheGeneration++;
+    for (const CTransaction &tx : block.vtx)
+    {
+        txReadCache.Erase(tx.GetHash());
+    }
+}
+
+bool myGetTransaction(const uint256 &hash, CTransaction &txOut, uint256 &hashBlock, bool checkMempool)
+{
+    // need a GetTransaction without lock so the validation code for assets can run without deadlock
+    {
+        //fprintf(stderr,"check mempool\n");
+        if (checkMempool && mempool.lookup(hash, txOut))
+        {
+            //fprintf(stderr,"found in mempool\n");
+            return true;
+        }
+    }
+    //fprintf(stderr,"check disk\n");
+    if (GetCachedTransaction(hash, txOut, hashBlock))
+    {
+        return true;
+    }
+    uint64_t nCacheGeneration = nTxReadCacheGeneration.load();
+
+    if (ReadPrunedTransaction(hash, txOut, hashBlock))
+    {
+        CacheTransaction(txOut, hashBlock, nCacheGeneration);
+        return true;
+    }
+
+    if (fTxIndex) {
+        CDiskTxPos postx;
+        //fprintf(stderr,"ReadTxIndex\n");
+        if (pblocktree->ReadTxIndex(hash, postx)) {
+            //fprintf(stderr,"OpenBlockFile\n");
+            CAutoFile file(OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
+            if (file.IsNull())
+                return error("%s: OpenBlockFile failed", __func__);
+            CBlockHeader header;
+            //fprintf(stderr,"seek and read\n");
+            try {
+                ReadBlockTransaction(file, postx.nTxOffset, header, txOut);
+            } catch (const std::exception& e) {
+                return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+            }
+            hashBlock = header.GetHash();
+            if (txOut.GetHash() != hash)
+            {
                 if (LogAcceptCategory("notarization"))
                 {
                     CHashWriter hw(SER_GETHASH, PROTOCOL_VERSION);
@@ -2543,6 +3962,7 @@ bool myGetTransaction(const uint256 &hash, CTransaction &txOut, uint256 &hashBlo
                 return error("%s: txid mismatch", __func__);
             }
             //fprintf(stderr,"found on disk\n");
+            CacheTransaction(txOut, hashBlock, nCacheGeneration);
             return true;
         }
     }
@@ -2562,6 +3982,29 @@ bool GetTransaction(const uint256 &hash, CTransaction &txOut, const Consensus::P
         return true;
     }
 
+    if (GetCachedTransaction(hash, txOut, hashBlock))
+    {
+        return true;
+    }
+    uint64_t nCacheGeneration = nTxReadCacheGeneration.load();
+
+    // the rest reads from disk, whether or not it finds the transaction
+    struct CTxReadTimer
+    {
+        int64_t nStart = GetTimeMicros();
+        ~CTxReadTimer()
+        {
+            threadReadStats.nTxReads++;
+            threadReadStats.nTxReadMicros += GetTimeMicros() - nStart;
+        }
+    } txReadTimer;
+
+    if (ReadPrunedTransaction(hash, txOut, hashBlock))
+    {
+        CacheTransaction(txOut, hashBlock, nCacheGeneration);
+        return true;
+    }
+
     if (fTxIndex) {
         CDiskTxPos postx;
         if (pblocktree->ReadTxIndex(hash, postx)) {
@@ -2570,15 +4013,14 @@ bool GetTransaction(const uint256 &hash, CTransaction &txOut, const Consensus::P
                 return error("%s: OpenBlockFile failed", __func__);
             CBlockHeader header;
             try {
-                file >> header;
-                fseek(file.Get(), postx.nTxOffset, SEEK_CUR);
-                file >> txOut;
+                ReadBlockTransaction(file, postx.nTxOffset, header, txOut);
             } catch (const std::exception& e) {
                 return error("%s: Deserialize or I/O error - %s", __func__, e.what());
             }
             hashBlock = header.GetHash();
             if (txOut.GetHash() != hash)
                 return error("%s: txid mismatch", __func__);
+            CacheTransaction(txOut, hashBlock, nCacheGeneration);
             return true;
         }
     }
@@ -2602,6 +4044,7 @@ bool GetTransaction(const uint256 &hash, CTransaction &txOut, const Consensus::P
                 if (tx.GetHash() == hash) {
                     txOut = tx;
                     hashBlock = pindexSlow->GetBlockHash();
+                    CacheTransaction(txOut, hashBlock, nCacheGeneration);
                     return true;
                 }
             }
@@ -2617,6 +4060,59 @@ bool GetTransaction(const uint256 &hash, CTransaction &txOut, uint256 &hashBlock
     return GetTransaction(hash, txOut, Params().GetConsensus(), hashBlock, fAllowSlow);
 }
 
+bool GetRawTransaction(const uint256 &hash, std::vector<unsigned char> &rawTx, uint256 &hashBlock, bool fAllowSlow)
+{
+    CDiskTxPos postx;
+    {
+        LOCK2(cs_main, mempool.cs);
+        CTransaction tx;
+        // transactions already in memory are serialized from there, as are those indexed before sizes were stored
+        bool fFound = mempool.lookup(hash, tx) || GetCachedTransaction(hash, tx, hashBlock);
+        if (!fFound && !(fTxIndex && pblocktree->ReadTxIndex(hash, postx) && postx.nTxSize))
+        {
+            if (!GetTransaction(hash, tx, hashBlock, fAllowSlow))
+                return false;
+            fFound = true;
+        }
+        if (fFound)
+        {
+            CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+            ss << tx;
+            rawTx.assign(ss.begin(), ss.end());
+            return true;
+        }
+    }
+
+    // only the header is deserialized, for the block hash
+    CAutoFile file(OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull())
+        return error("%s: OpenBlockFile failed", __func__);
+    CBlockHeader header;
+    rawTx.resize(postx.nTxSize);
+    try {
+        std::unique_ptr<CDataStream> pRecord = ReadCompressedDiskRecord(file);
+        if (pRecord)
+        {
+            *pRecord >> header;
+            pRecord->ignore(postx.nTxOffset);
+            pRecord->read((char *)rawTx.data(), rawTx.size());
+        }
+        else
+        {
+            file >> header;
+            if (fseek(file.Get(), postx.nTxOffset, SEEK_CUR))
+                throw std::ios_base::failure("fseek failed");
+            file.read((char *)rawTx.data(), rawTx.size());
+        }
+    } catch (const std::exception& e) {
+        return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+    }
+    hashBlock = header.GetHash();
+    if (Hash(rawTx.begin(), rawTx.end()) != hash)
+        return error("%s: txid mismatch", __func__);
+    return true;
+}
+
 /*char *komodo_getspendscript(uint256 hash,int32_t n)
  {
  CTransaction tx; uint256 hashBlock;
@@ -2637,46 +4133,50 @@ bool GetTransaction(const uint256 &hash, CTransaction &txOut, uint256 &hashBlock
 // CBlock and CBlockIndex
 //
 
-bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart)
+static bool WriteBlockToDisk(const CDiskRecord &record, CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart)
 {
     // Open history file to append
     CAutoFile fileout(OpenBlockFile(pos), SER_DISK, CLIENT_VERSION);
     if (fileout.IsNull())
         return error("WriteBlockToDisk: OpenBlockFile failed");
 
-    // Write index header
-    unsigned int nSize = GetSerializeSize(fileout, block);
-    fileout << FLATDATA(messageStart) << nSize;
-
-    // Write block
-    long fileOutPos = ftell(fileout.Get());
-    if (fileOutPos < 0)
+    // Write index header and block
+    if (!record.Write(fileout, pos, messageStart))
         return error("WriteBlockToDisk: ftell failed");
-    pos.nPos = (unsigned int)fileOutPos;
-    fileout << block;
 
     return true;
 }
 
+bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart)
+{
+    return WriteBlockToDisk(CDiskRecord(block), pos, messageStart);
+}
+
 bool ReadBlockFromDisk(int32_t height, CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams, bool checkPOW)
 {
     uint8_t pubkey33[33];
-    block.SetNull();
+    block.SetNullForReuse();
 
     // Open history file to read
     CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
     if (filein.IsNull())
     {
         //fprintf(stderr,"readblockfromdisk err A\n");
+        block.SetNull();
         return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
     }
 
     // Read block
     try {
-        filein >> block;
+        std::unique_ptr<CDataStream> pRecord = ReadCompressedDiskRecord(filein);
+        if (pRecord)
+            *pRecord >> block;
+        else
+            filein >> block;
     }
     catch (const std::exception& e) {
         fprintf(stderr,"readblockfromdisk err B\n");
+        block.SetNull();
         return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
     }
     // Check the header
@@ -2718,6 +4218,52 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus
     return ReadBlockFromDisk(block, pindex, consensusParams, 0);
 }
 
+bool ReadBlockForProof(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams)
+{
+    if (!fHavePruned || (pindex->nStatus & BLOCK_HAVE_DATA))
+    {
+        return ReadBlockFromDisk(block, pindex, consensusParams, false);
+    }
+
+    CPrunedBlockProofs proofs;
+    if (!fPruneProofs || !pblocktree->ReadPrunedBlockProofs(pindex->GetBlockHash(), proofs))
+    {
+        return error("%s: block %s is pruned without its proof data", __func__, pindex->GetBlockHash().GetHex());
+    }
+    if (proofs.txids.size() != proofs.nTx)
+    {
+        return error("%s: invalid proof data for pruned block %s", __func__, pindex->GetBlockHash().GetHex());
+    }
+
+    // the transactions that were not retained are left empty, and the trees come from the stored hashes
+    block.SetNull();
+    *((CBlockHeader*)&block) = pindex->GetBlockHeader();
+    block.vtx.resize(proofs.nTx);
+    for (uint32_t txIndex : proofs.retained)
+    {
+        uint256 hashBlock;
+        if (txIndex >= proofs.nTx ||
+            !pblocktree->ReadPrunedTransaction(proofs.txids[txIndex], block.vtx[txIndex], hashBlock) ||
+            hashBlock != pindex->GetBlockHash())
+        {
+            block.SetNull();
+            return error("%s: missing retained transaction of pruned block %s", __func__, pindex->GetBlockHash().GetHex());
+        }
+    }
+
+    std::vector<CDefaultMMRNode> leaves(proofs.mmrLeaves.begin(), proofs.mmrLeaves.end());
+    std::shared_ptr<BlockMMRange> pTree = std::make_shared<BlockMMRange>();
+    pTree->Add(leaves);
+    block.pStoredMMRTree = pTree;
+    if (::BuildMerkleTree(nullptr, proofs.txids, block.vMerkleTree) != block.hashMerkleRoot ||
+        block.GetHash() != pindex->GetBlockHash())
+    {
+        block.SetNull();
+        return error("%s: proof data does not match pruned block %s", __func__, pindex->GetBlockHash().GetHex());
+    }
+    return true;
+}
+
 //uint64_t komodo_moneysupply(int32_t height);
 extern char ASSETCHAINS_SYMBOL[KOMODO_ASSETCHAIN_MAXLEN];
 extern uint64_t ASSETCHAINS_ENDSUBSIDY[ASSETCHAINS_MAX_ERAS], ASSETCHAINS_REWARD[ASSETCHAINS_MAX_ERAS], ASSETCHAINS_HALVING[ASSETCHAINS_MAX_ERAS];
@@ -2996,9 +4542,21 @@ void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, int nHeight)
 }
 
 bool CScriptCheck::operator()() {
+    if (fSaplingCheck)
+    {
+        // invalid proofs are checked again, and rejected, by ContextualCheckTransaction
+        CValidationState state;
+        if (!VerifySaplingBundle(*ptxTo, saplingSigHash, state))
+        {
+            return false;
+        }
+        saplingProofCache.Add(SaplingProofCacheKey(*ptxTo, saplingSigHash));
+        return true;
+    }
     const CScript &scriptSig = ptxTo->vin[nIn].scriptSig;
     ServerTransactionSignatureChecker checker(ptxTo, nIn, amount, cacheStore, *txdata);
     checker.SetIDMap(idMap);
+    checker.SetBlockContext(pBlockContext);
     if (!VerifyScript(scriptSig, scriptPubKey, nFlags, checker, consensusBranchId, &error)) {
         return ::error("CScriptCheck(): %s:%u VerifySignature failed: %s", ptxTo->vin[nIn].prevout.hash.GetHex(), ptxTo->vin[nIn].prevout.n, ScriptErrorString(error));
     }
@@ -3315,23 +4873,16 @@ bool ContextualCheckInputs(const CTransaction& tx,
 
 namespace {
 
-    bool UndoWriteToDisk(const CBlockUndo& blockundo, CDiskBlockPos& pos, const uint256& hashBlock, const CMessageHeader::MessageStartChars& messageStart)
+    bool UndoWriteToDisk(const CBlockUndo& blockundo, const CDiskRecord& record, CDiskBlockPos& pos, const uint256& hashBlock, const CMessageHeader::MessageStartChars& messageStart)
     {
         // Open history file to append
         CAutoFile fileout(OpenUndoFile(pos), SER_DISK, CLIENT_VERSION);
         if (fileout.IsNull())
             return error("%s: OpenUndoFile failed", __func__);
 
-        // Write index header
-        unsigned int nSize = GetSerializeSize(fileout, blockundo);
-        fileout << FLATDATA(messageStart) << nSize;
-
-        // Write undo data
-        long fileOutPos = ftell(fileout.Get());
-        if (fileOutPos < 0)
+        // Write index header and undo data
+        if (!record.Write(fileout, pos, messageStart))
             return error("%s: ftell failed", __func__);
-        pos.nPos = (unsigned int)fileOutPos;
-        fileout << blockundo;
 
         // calculate & write checksum
         CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
@@ -3352,7 +4903,11 @@ namespace {
         // Read block
         uint256 hashChecksum;
         try {
-            filein >> blockundo;
+            std::unique_ptr<CDataStream> pRecord = ReadCompressedDiskRecord(filein);
+            if (pRecord)
+                *pRecord >> blockundo;
+            else
+                filein >> blockundo;
             filein >> hashChecksum;
         }
         catch (const std::exception& e) {
@@ -3466,28 +5021,72 @@ void SetMaxScriptElementSize(uint32_t height)
     }
 }
 
+// the index entries erased or restored by the blocks of a batched disconnect, written together after the batch. each
+// kind is applied in the order the blocks were disconnected, so an entry restored by one block and erased by the one
+// before it ends up erased, as it would when written block by block
+struct CDisconnectedIndexes
+{
+    std::vector<CAddressIndexDbEntry> addressIndex;
+    std::vector<CAddressUnspentDbEntry> addressUnspentIndex;
+    std::vector<CSpentIndexDbEntry> spentIndex;
+    std::vector<CReserveTransferIndexEntry> createdTransfers;
+    std::vector<CReserveTransferIndexEntry> spentTransfers;
+    std::vector<CIdentityStateIndexEntry> identityStates;
+    std::vector<CIdentityCommitmentIndexEntry> identityCommitments;
+    std::vector<CKVIndexEntry> kvEntries;
+
+    bool Write(CValidationState &state) const
+    {
+        if (fAddressIndex && !pblocktree->EraseAddressIndex(addressIndex))
+            return AbortNode(state, "Failed to delete address index");
+        if (fAddressIndex && !pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex))
+            return AbortNode(state, "Failed to write address unspent index");
+        if (fSpentIndex && !pblocktree->UpdateSpentIndex(spentIndex))
+            return AbortNode(state, "Failed to write transaction index");
+        // restoring every spent transfer before erasing every created one also holds across blocks
+        if (fReserveTransferIndex && !pblocktree->UpdateReserveTransferIndex(createdTransfers, spentTransfers, true))
+            return AbortNode(state, "Failed to write reserve transfer index");
+        if (fIdentityStateIndex && !pblocktree->UpdateIdentityStateIndex(identityStates, identityCommitments, true))
+            return AbortNode(state, "Failed to write identity state index");
+        if (fKVIndex && !pblocktree->UpdateKVIndex(kvEntries, true))
+            return AbortNode(state, "Failed to write key value index");
+        return true;
+    }
+};
+
+template <typename ENTRY>
+static void AppendEntries(std::vector<ENTRY> &to, const std::vector<ENTRY> &from)
+{
+    to.insert(to.end(), from.begin(), from.end());
+}
+
 /** Undo the effects of this block (with given index) on the UTXO set represented by coins.
  *  When UNCLEAN or FAILED is returned, view is left in an indeterminate state.
  *  The addressIndex and spentIndex will be updated if requested.
+ *  When pBlockUndo is set, it is the undo data of the block, already read. When pIndexes is set, the index entries
+ *  that are written together for a batch are added to it instead, and the oracle upgrades are left to the caller.
  */
 static DisconnectResult DisconnectBlock(const CBlock& block, CValidationState& state,
     const CBlockIndex* pindex, CCoinsViewCache& view, const CChainParams& chainparams,
-    const bool updateIndices)
+    const bool updateIndices, const CBlockUndo *pBlockUndo = nullptr, CDisconnectedIndexes *pIndexes = nullptr)
 {
     assert(pindex->GetBlockHash() == view.GetBestBlock());
 
     bool fClean = true;
     komodo_disconnect(pindex, block);
-    CBlockUndo blockUndo;
-    CDiskBlockPos pos = pindex->GetUndoPos();
-    if (pos.IsNull()) {
-        error("DisconnectBlock(): no undo data available");
-        return DISCONNECT_FAILED;
-    }
-    if (!UndoReadFromDisk(blockUndo, pos, pindex->pprev->GetBlockHash())) {
-        error("DisconnectBlock(): failure reading undo data");
-        return DISCONNECT_FAILED;
+    CBlockUndo blockUndoRead;
+    if (!pBlockUndo) {
+        CDiskBlockPos pos = pindex->GetUndoPos();
+        if (pos.IsNull()) {
+            error("DisconnectBlock(): no undo data available");
+            return DISCONNECT_FAILED;
+        }
+        if (!UndoReadFromDisk(blockUndoRead, pos, pindex->pprev->GetBlockHash())) {
+            error("DisconnectBlock(): failure reading undo data");
+            return DISCONNECT_FAILED;
+        }
     }
+    const CBlockUndo &blockUndo = pBlockUndo ? *pBlockUndo : blockUndoRead;
 
     if (blockUndo.vtxundo.size() + 1 != block.vtx.size()) {
         error("DisconnectBlock(): block and undo data inconsistent");
@@ -3496,6 +5095,11 @@ static DisconnectResult DisconnectBlock(const CBlock& block, CValidationState& s
     std::vector<CAddressIndexDbEntry> addressIndex;
     std::vector<CAddressUnspentDbEntry> addressUnspentIndex;
     std::vector<CSpentIndexDbEntry> spentIndex;
+    std::vector<CReserveTransferIndexEntry> createdTransfers;
+    std::vector<CReserveTransferIndexEntry> spentTransfers;
+    std::vector<CIdentityStateIndexEntry> identityStates;
+    std::vector<CIdentityCommitmentIndexEntry> identityCommitments;
+    std::vector<CKVIndexEntry> kvEntries;
 
     uint32_t nHeight = pindex->GetHeight();
 
@@ -3504,6 +5108,39 @@ static DisconnectResult DisconnectBlock(const CBlock& block, CValidationState& s
         const CTransaction &tx = block.vtx[i];
         uint256 const hash = tx.GetHash();
 
+        if (fReserveTransferIndex && updateIndices) {
+            for (unsigned int k = 0; k < tx.vout.size(); k++) {
+                CReserveTransferIndexEntry newTransfer;
+                if (GetReserveTransferIndexEntry(tx.vout[k], hash, k, nHeight, newTransfer)) {
+                    createdTransfers.push_back(newTransfer);
+                }
+            }
+        }
+
+        if (fIdentityStateIndex && updateIndices) {
+            for (unsigned int k = 0; k < tx.vout.size(); k++) {
+                CIdentityStateIndexEntry identityState;
+                CIdentityCommitmentIndexEntry identityCommitment;
+                if (GetIdentityStateIndexEntry(tx.vout[k], hash, i, k, nHeight, identityState)) {
+                    identityStates.push_back(identityState);
+                } else if (GetIdentityCommitmentIndexEntry(tx.vout[k], hash, i, k, nHeight, identityCommitment)) {
+                    identityCommitments.push_back(identityCommitment);
+                }
+            }
+        }
+
+        // every update that could have been indexed is erased, since erasing one that was rejected does nothing
+        if (fKVIndex && updateIndices) {
+            for (unsigned int k = 0; k < tx.vout.size(); k++) {
+                std::vector<uint8_t> key, value;
+                uint32_t flags;
+                uint256 pubkey, sig;
+                if (komodo_kvparse(tx.vout[k], key, value, flags, pubkey, sig)) {
+                    kvEntries.push_back(make_pair(CKVIndexKey(Hash(key.begin(), key.end()), nHeight, i, k), CKVIndexValue()));
+                }
+            }
+        }
+
         if (fAddressIndex && updateIndices) {
             for (unsigned int k = tx.vout.size(); k-- > 0;) {
 
@@ -3615,6 +5252,14 @@ static DisconnectResult DisconnectBlock(const CBlock& block, CValidationState& s
                     fClean = false;
 
                 const CTxIn input = tx.vin[j];
+                CReserveTransferIndexEntry spentTransfer;
+                const CCoins *restoredCoins;
+                if (fReserveTransferIndex && updateIndices &&
+                    (restoredCoins = view.AccessCoins(out.hash)) &&
+                    restoredCoins->IsAvailable(out.n) &&
+                    GetReserveTransferIndexEntry(restoredCoins->vout[out.n], out.hash, out.n, restoredCoins->nHeight, spentTransfer)) {
+                    spentTransfers.push_back(spentTransfer);
+                }
                 if (fAddressIndex && updateIndices) {
                     const CTxOut &prevout = view.GetOutputFor(input);
 
@@ -3716,24 +5361,85 @@ static DisconnectResult DisconnectBlock(const CBlock& block, CValidationState& s
 
     // insightexplorer
     if (fAddressIndex && updateIndices) {
-        if (!pblocktree->EraseAddressIndex(addressIndex)) {
+        if (pIndexes) {
+            AppendEntries(pIndexes->addressIndex, addressIndex);
+            AppendEntries(pIndexes->addressUnspentIndex, addressUnspentIndex);
+        } else if (!pblocktree->EraseAddressIndex(addressIndex)) {
             AbortNode(state, "Failed to delete address index");
             return DISCONNECT_FAILED;
-        }
-        if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
+        } else if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
             AbortNode(state, "Failed to write address unspent index");
             return DISCONNECT_FAILED;
         }
+        if (fAddressBalanceIndex && IndexCoversHeight(BACKGROUND_INDEX_ADDRESSBALANCE, pindex->GetHeight())) {
+            std::vector<CAddressBalanceDbEntry> balanceDeltas;
+            GetAddressBalanceDeltas(block, blockUndo, addressIndex, balanceDeltas);
+            int buildHeight = pindex->GetHeight() - 1;
+            bool fBuilding = fIndexBuilding[BACKGROUND_INDEX_ADDRESSBALANCE];
+            if (!pblocktree->UpdateAddressBalanceIndex(balanceDeltas, true, fBuilding ? &buildHeight : nullptr)) {
+                AbortNode(state, "Failed to update address balance index");
+                return DISCONNECT_FAILED;
+            }
+            RewindIndexBuild(BACKGROUND_INDEX_ADDRESSBALANCE, pindex->GetHeight(), false);
+        }
+    }
+    if (fTimestampIndex && updateIndices) {
+        RewindIndexBuild(BACKGROUND_INDEX_TIMESTAMP, pindex->GetHeight(), true);
     }
     // insightexplorer
     if (fSpentIndex && updateIndices) {
-        if (!pblocktree->UpdateSpentIndex(spentIndex)) {
+        if (pIndexes) {
+            AppendEntries(pIndexes->spentIndex, spentIndex);
+        } else if (!pblocktree->UpdateSpentIndex(spentIndex)) {
             AbortNode(state, "Failed to write transaction index");
             return DISCONNECT_FAILED;
         }
     }
+    if (fBlockDeltaIndex && updateIndices) {
+        if (!pblocktree->EraseBlockDeltaSummary(pindex->GetBlockHash())) {
+            AbortNode(state, "Failed to erase block delta summary");
+            return DISCONNECT_FAILED;
+        }
+    }
+    if (fReserveTransferIndex && updateIndices) {
+        if (pIndexes) {
+            AppendEntries(pIndexes->createdTransfers, createdTransfers);
+            AppendEntries(pIndexes->spentTransfers, spentTransfers);
+        } else if (!pblocktree->UpdateReserveTransferIndex(createdTransfers, spentTransfers, true)) {
+            AbortNode(state, "Failed to write reserve transfer index");
+            return DISCONNECT_FAILED;
+        }
+    }
+    if (fIdentityStateIndex && updateIndices) {
+        if (pIndexes) {
+            AppendEntries(pIndexes->identityStates, identityStates);
+            AppendEntries(pIndexes->identityCommitments, identityCommitments);
+        } else if (!pblocktree->UpdateIdentityStateIndex(identityStates, identityCommitments, true)) {
+            AbortNode(state, "Failed to write identity state index");
+            return DISCONNECT_FAILED;
+        }
+    }
+    if (fKVIndex && updateIndices) {
+        if (pIndexes) {
+            AppendEntries(pIndexes->kvEntries, kvEntries);
+        } else if (!pblocktree->UpdateKVIndex(kvEntries, true)) {
+            AbortNode(state, "Failed to write key value index");
+            return DISCONNECT_FAILED;
+        }
+    }
+    if (fUTXOStats && updateIndices)
+        UpdateUTXOSetStats(block, blockUndo, pindex, true);
+    // identity states from this block are no longer current
+    for (const CTransaction &tx : block.vtx)
+        CIdentity::InvalidateLookupCache(tx);
+    // currency states calculated at this block are no longer valid
+    if (updateIndices && !pblocktree->EraseCurrencyStateIndex(pindex->GetHeight())) {
+        AbortNode(state, "Failed to erase currency state index");
+        return DISCONNECT_FAILED;
+    }
     // unwind any consensus upgrades that may have been removed in the block
-    ConnectedChains.CheckOracleUpgrades();
+    if (!pIndexes)
+        ConnectedChains.CheckOracleUpgrades();
     return fClean ? DISCONNECT_OK : DISCONNECT_UNCLEAN;
 }
 
@@ -3836,6 +5542,58 @@ void PartitionCheck(bool (*initialDownloadCheck)(const CChainParams&),
     }
 }
 
+static const CBlockIndex *pindexAssumeNotarized = nullptr;
+static bool fAssumeNotarizedFailed = false;
+
+const CBlockIndex *GetAssumeNotarizedAnchor()
+{
+    AssertLockHeld(cs_main);
+    if (pindexAssumeNotarized || fAssumeNotarizedFailed || hashAssumeNotarizedBlock.IsNull())
+    {
+        return pindexAssumeNotarized;
+    }
+
+    // wait for the header of the anchor, which makes the MMR of our headers up to it complete
+    BlockMap::iterator it = mapBlockIndex.find(hashAssumeNotarizedBlock);
+    if (it == mapBlockIndex.end() || !it->second)
+    {
+        return nullptr;
+    }
+    CBlockIndex *pindexAnchor = it->second;
+    if (pindexAnchor->GetHeight() != nAssumeNotarizedHeight || (pindexAnchor->nStatus & BLOCK_FAILED_MASK))
+    {
+        fAssumeNotarizedFailed = true;
+        error("%s: -assumenotarized block %s is not a valid block at height %d", __func__, hashAssumeNotarizedBlock.GetHex(), nAssumeNotarizedHeight);
+        return nullptr;
+    }
+
+    // the notarization committed to the chain MMR root at the anchor, which covers the hash, block MMR root and power
+    // of every block up to it, so our headers match it only if they are the headers that were notarized
+    uint256 mmrRoot;
+    if (chainActive.Contains(pindexAnchor))
+    {
+        ChainMerkleMountainView mmv = chainActive.GetMMV();
+        mmv.resize(nAssumeNotarizedHeight + 1);
+        mmrRoot = mmv.GetRoot();
+    }
+    else
+    {
+        CChain headerChain;
+        headerChain.SetTip(pindexAnchor);
+        mmrRoot = headerChain.GetMMV().GetRoot();
+    }
+    if (mmrRoot != hashAssumeNotarizedMMRRoot)
+    {
+        fAssumeNotarizedFailed = true;
+        error("%s: chain MMR root %s of our headers to block %s does not match the -assumenotarized root %s", __func__,
+              mmrRoot.GetHex(), hashAssumeNotarizedBlock.GetHex(), hashAssumeNotarizedMMRRoot.GetHex());
+        return nullptr;
+    }
+
+    LogPrintf("%s: verified notarized block %s at height %d against its chain MMR root\n", __func__, hashAssumeNotarizedBlock.GetHex(), nAssumeNotarizedHeight);
+    pindexAssumeNotarized = pindexAnchor;
+    return pindexAssumeNotarized;
+}
 
 static int64_t nTimeVerify = 0;
 static int64_t nTimeConnect = 0;
@@ -3843,6 +5601,12 @@ static int64_t nTimeIndex = 0;
 static int64_t nTimeCallbacks = 0;
 static int64_t nTimeTotal = 0;
 
+// the phases of blocks connected to the tip, which leave out blocks that are only checked
+static int64_t nTimeCheckBlock = 0;
+static int64_t nTimePrechecks = 0;
+static int64_t nTimeInputs = 0;
+static int64_t nTimeScripts = 0;
+
 bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck, bool fCheckPOW)
 {
     uint32_t nHeight = pindex->GetHeight();
@@ -3875,10 +5639,43 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
             fExpensiveChecks = false;
         }
     }
+    if (fExpensiveChecks && !hashAssumeNotarizedBlock.IsNull())
+    {
+        // This block is an ancestor of a block that a confirmed notarization on the root chain committed to, which is
+        // final without waiting for more work on top of it: disable the same checks as for -assumevalid
+        const CBlockIndex *pindexAnchor = GetAssumeNotarizedAnchor();
+        if (pindexAnchor && pindexAnchor->GetAncestor(nHeight) == pindex)
+        {
+            fExpensiveChecks = false;
+            if (!fJustCheck)
+            {
+                nAssumeValidSkipped++;
+            }
+        }
+    }
+    if (fExpensiveChecks && !hashAssumeValid.IsNull())
+    {
+        // This block is an ancestor of the assumed valid block, which is also in our best header chain and at least
+        // two weeks of work deep: disable script, crypto-condition fulfillment and proof checks. UTXO, amount and PBaaS
+        // accounting checks are unaffected.
+        BlockMap::const_iterator it = mapBlockIndex.find(hashAssumeValid);
+        if (it != mapBlockIndex.end() && it->second &&
+            it->second->GetAncestor(nHeight) == pindex &&
+            pindexBestHeader && pindexBestHeader->GetAncestor(nHeight) == pindex &&
+            GetBlockProofEquivalentTime(*pindexBestHeader, *pindex, *pindexBestHeader, chainparams.GetConsensus()) > 60 * 60 * 24 * 7 * 2)
+        {
+            fExpensiveChecks = false;
+            if (!fJustCheck)
+            {
+                nAssumeValidSkipped++;
+            }
+        }
+    }
     auto verifier = libzcash::ProofVerifier::Strict();
     auto disabledVerifier = libzcash::ProofVerifier::Disabled();
     int32_t futureblock;
 
+    int64_t nTimeCheckBlockStart = GetTimeMicros();
     {
         // Check it again to verify JoinSplit proofs, and in case a previous version let a bad block in
         if (!CheckBlock(&futureblock, pindex->GetHeight(), pindex, block, state, chainparams, fExpensiveChecks ? verifier : disabledVerifier, fCheckPOW, !fJustCheck, !fJustCheck) || futureblock != 0 )
@@ -3894,11 +5691,14 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         }
     }
 
+    int64_t nTimeCheckBlockEnd = GetTimeMicros();
+
     CBlockUndo blockundo;
     uint256 old_sprout_tree_root;
     SproutMerkleTree sprout_tree;
     SaplingMerkleTree sapling_tree;
     int64_t nTimeStart = 0;
+    int64_t nTimeBlockPrechecks = 0;
 
     uint32_t solutionVersion = CConstVerusSolutionVector::GetVersionByHeight(nHeight);
     bool isPBaaS = solutionVersion >= CActivationHeight::ACTIVATE_PBAAS;
@@ -3910,13 +5710,46 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     CCurrencyValueMap totalReserveTxFees;
     CCurrencyValueMap reserveRewardTaken;
     CCurrencyValueMap validExtraCoinbaseOutputs;
+    CBlockStats blockStats;
 
     std::vector<std::pair<uint256, CDiskTxPos> > vPos;
     std::vector<CAddressIndexDbEntry> addressIndex;
     std::vector<CAddressUnspentDbEntry> addressUnspentIndex;
     std::vector<CSpentIndexDbEntry> spentIndex;
+    std::vector<CReserveTransferIndexEntry> createdTransfers;
+    std::vector<CReserveTransferIndexEntry> spentTransfers;
+    std::vector<CIdentityStateIndexEntry> identityStates;
+    std::vector<CIdentityCommitmentIndexEntry> identityCommitments;
+    std::vector<CKVIndexEntry> kvEntries;
+    std::map<uint256, CKVIndexEntry> latestKV;
+
+    // verify the Sapling proofs and signatures of the shielded transactions in the block that are not already in the
+    // proof cache on the script check threads, before connecting them. ContextualCheckTransaction skips those that pass
+    // and verifies any others itself. the queue has one controller at a time, so this finishes before the script checks
+    if (fExpensiveChecks && nScriptCheckThreads)
+    {
+        CCheckQueueControl<CScriptCheck> saplingControl(&scriptcheckqueue);
+        std::vector<CScriptCheck> vSaplingChecks;
+        for (const CTransaction &tx : block.vtx)
+        {
+            uint256 dataToBeSigned;
+            if (!tx.IsMint() &&
+                (!tx.vShieldedSpend.empty() || !tx.vShieldedOutput.empty()) &&
+                GetShieldedSignatureHash(tx, chainparams, nHeight, dataToBeSigned) &&
+                !saplingProofCache.Contains(SaplingProofCacheKey(tx, dataToBeSigned)))
+            {
+                vSaplingChecks.push_back(CScriptCheck(tx, dataToBeSigned));
+            }
+        }
+        saplingControl.Add(vSaplingChecks);
+        if (!saplingControl.Wait())
+        {
+            LogPrint("bench", "%s: Sapling proofs of block %s did not all verify in parallel, checking each transaction\n", __func__, block.GetHash().GetHex());
+        }
+    }
 
     CCheckQueueControl<CScriptCheck> control(fExpensiveChecks && nScriptCheckThreads ? &scriptcheckqueue : NULL);
+    CEvalBlockContext evalBlockContext(pindex->pprev);
     CCurrencyDefinition newThisChain;
     std::vector<uint256> vOrphanErase;
 
@@ -3998,6 +5831,11 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
                 pindex->hashSproutAnchor = tree.root();
                 // The genesis block contained no JoinSplits
                 pindex->hashFinalSproutRoot = pindex->hashSproutAnchor;
+                // its coinbase outputs are still in its filter, which starts the chain of filter headers
+                if (fBlockFilterIndex && IndexCoversHeight(BACKGROUND_INDEX_BLOCKFILTER, 0) &&
+                    !WriteBlockFilterIndex(CBlockFilter(block, CBlockUndo()), pindex)) {
+                    return AbortNode(state, "Failed to write block filter index");
+                }
             }
             return true;
         }
@@ -4133,6 +5971,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
                 mempool.removeConflicts(tx, removedTxes);
             }
 
+            int64_t nTimePrecheckStart = GetTimeMicros();
             bool missingInputs = false;
             bool isPosTx = block.IsVerusPOSBlock() && (i + 1) == block.vtx.size();
             if (((tx.IsCoinBase() ||
@@ -4431,6 +6270,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
                     }
                 }
             }
+            nTimeBlockPrechecks += GetTimeMicros() - nTimePrecheckStart;
 
             // coinbase transaction output is dependent on all other transactions in the block, figure those out first
             if (!tx.IsCoinBase())
@@ -4461,6 +6301,13 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
                     const CTxIn input = tx.vin[j];
                     const CTxOut &prevout = view.GetOutputFor(tx.vin[j]);
 
+                    CReserveTransferIndexEntry spentTransfer;
+                    if (fReserveTransferIndex &&
+                        GetReserveTransferIndexEntry(prevout, input.prevout.hash, input.prevout.n, view.AccessCoins(input.prevout.hash)->nHeight, spentTransfer))
+                    {
+                        spentTransfers.push_back(spentTransfer);
+                    }
+
                     COptCCParams p;
                     if (prevout.scriptPubKey.IsPayToCryptoCondition(p))
                     {
@@ -4554,23 +6401,27 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 
             txdata.emplace_back(tx);
 
+            CAmount nTxFee = 0;
             if (!tx.IsCoinBase())
             {
                 if (rtxd.IsValid())
                 {
-                    nFees += rtxd.NativeFees();
+                    nTxFee = rtxd.NativeFees();
                     totalReserveTxFees += rtxd.ReserveFees();
                 }
                 else
                 {
                     CAmount interest;
-                    nFees += view.GetValueIn(chainActive.LastTip()->GetHeight(), &interest, tx, chainActive.LastTip()->nTime) - tx.GetValueOut();
+                    nTxFee = view.GetValueIn(chainActive.LastTip()->GetHeight(), &interest, tx, chainActive.LastTip()->nTime) - tx.GetValueOut();
                 }
+                nFees += nTxFee;
 
                 std::vector<CScriptCheck> vChecks;
                 bool fCacheResults = fJustCheck; /* Don't cache results if we're actually connecting blocks (still consult the cache, though) */
                 if (!ContextualCheckInputs(tx, state, view, nHeight, fExpensiveChecks, flags, fCacheResults, txdata[i], chainparams.GetConsensus(), consensusBranchId, nScriptCheckThreads ? &vChecks : NULL))
                     return false;
+                for (auto &check : vChecks)
+                    check.SetBlockContext(&evalBlockContext);
                 control.Add(vChecks);
             }
             else if (isPBaaSBlockOne)
@@ -4600,7 +6451,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
                     CReserveDeposit resDeposit;
                     int32_t sysCCIOut, notarizationOut, evidenceStart, evidenceEnd;
                     std::vector<CReserveTransfer> reserveTransfers;
-                    if (tx.vout[j].scriptPubKey.IsPayToCryptoCondition(p) &&
+                    if (tx.IsPayToCryptoCondition(j, p) &&
                         p.IsValid() &&
                         (p.evalCode == EVAL_NOTARY_EVIDENCE || p.evalCode == EVAL_CROSSCHAIN_IMPORT || p.evalCode == EVAL_CURRENCY_DEFINITION) &&
                         p.vData.size())
@@ -4846,6 +6697,9 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
                 //printf("%s: reserve reward taken: %s\n", __func__, reserveRewardTaken.ToUniValue().write(1,2).c_str());
             }
 
+            if (fBlockStatsIndex)
+                AddBlockStatsTx(blockStats, tx, rtxd, nTxFee);
+
             if (fAddressIndex) {
                 for (unsigned int k = 0; k < tx.vout.size(); k++) {
                     const CTxOut &out = tx.vout[k];
@@ -4923,6 +6777,36 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
                 }
             }
 
+            if (fReserveTransferIndex) {
+                for (unsigned int k = 0; k < tx.vout.size(); k++) {
+                    CReserveTransferIndexEntry newTransfer;
+                    if (GetReserveTransferIndexEntry(tx.vout[k], txhash, k, nHeight, newTransfer)) {
+                        createdTransfers.push_back(newTransfer);
+                    }
+                }
+            }
+
+            if (fIdentityStateIndex) {
+                for (unsigned int k = 0; k < tx.vout.size(); k++) {
+                    CIdentityStateIndexEntry identityState;
+                    CIdentityCommitmentIndexEntry identityCommitment;
+                    if (GetIdentityStateIndexEntry(tx.vout[k], txhash, i, k, nHeight, identityState)) {
+                        identityStates.push_back(identityState);
+                    } else if (GetIdentityCommitmentIndexEntry(tx.vout[k], txhash, i, k, nHeight, identityCommitment)) {
+                        identityCommitments.push_back(identityCommitment);
+                    }
+                }
+            }
+
+            if (fKVIndex) {
+                for (unsigned int k = 0; k < tx.vout.size(); k++) {
+                    CKVIndexEntry kvEntry;
+                    if (komodo_kvindexentry(tx.vout[k], txhash, i, k, nHeight, latestKV, kvEntry)) {
+                        kvEntries.push_back(kvEntry);
+                    }
+                }
+            }
+
             CTxUndo undoDummy;
             if (i > 0) {
                 blockundo.vtxundo.push_back(CTxUndo());
@@ -4941,8 +6825,9 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
                 sapling_tree.append(outputDescription.cm);
             }
 
+            pos.nTxSize = ::GetSerializeSize(tx, SER_DISK, CLIENT_VERSION);
             vPos.push_back(std::make_pair(tx.GetHash(), pos));
-            pos.nTxOffset += ::GetSerializeSize(tx, SER_DISK, CLIENT_VERSION);
+            pos.nTxOffset += pos.nTxSize;
         }
 
         // we don't allow orphaned arbs
@@ -5119,6 +7004,13 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         return state.DoS(100, false);
     int64_t nTime2 = GetTimeMicros(); nTimeVerify += nTime2 - nTimeStart;
     LogPrint("bench", "    - Verify %u txins: %.2fms (%.3fms/txin) [%.2fs]\n", nInputs - 1, 0.001 * (nTime2 - nTimeStart), nInputs <= 1 ? 0 : 0.001 * (nTime2 - nTimeStart) / (nInputs-1), nTimeVerify * 0.000001);
+    if (!fJustCheck)
+    {
+        nTimeCheckBlock += nTimeCheckBlockEnd - nTimeCheckBlockStart;
+        nTimePrechecks += nTimeBlockPrechecks;
+        nTimeInputs += (nTime1 - nTimeStart) - nTimeBlockPrechecks;
+        nTimeScripts += nTime2 - nTime1;
+    }
 
     if (fJustCheck)
         return true;
@@ -5128,9 +7020,10 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     {
         if (pindex->GetUndoPos().IsNull()) {
             CDiskBlockPos pos;
-            if (!FindUndoPos(state, pindex->nFile, pos, ::GetSerializeSize(blockundo, SER_DISK, CLIENT_VERSION) + 40))
+            CDiskRecord undoRecord(blockundo);
+            if (!FindUndoPos(state, pindex->nFile, pos, undoRecord.size() + 40))
                 return error("ConnectBlock(): FindUndoPos failed");
-            if (!UndoWriteToDisk(blockundo, pos, pindex->pprev->GetBlockHash(), chainparams.MessageStart()))
+            if (!UndoWriteToDisk(blockundo, undoRecord, pos, pindex->pprev->GetBlockHash(), chainparams.MessageStart()))
                 return AbortNode(state, "Failed to write undo data");
 
             // update nUndoPos in block index
@@ -5167,31 +7060,41 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
             return AbortNode(state, "Failed to write address unspent index");
         }
+
+        // unlike the address index writes, which are repeated below, balance updates are applied exactly once
+        if (fAddressBalanceIndex && IndexCoversHeight(BACKGROUND_INDEX_ADDRESSBALANCE, pindex->GetHeight())) {
+            std::vector<CAddressBalanceDbEntry> balanceDeltas;
+            GetAddressBalanceDeltas(block, blockundo, addressIndex, balanceDeltas);
+            if (!pblocktree->UpdateAddressBalanceIndex(balanceDeltas, false)) {
+                return AbortNode(state, "Failed to write address balance index");
+            }
+        }
     }
 
     if (fSpentIndex)
         if (!pblocktree->UpdateSpentIndex(spentIndex))
             return AbortNode(state, "Failed to write transaction index");
 
-    if (fTimestampIndex) {
-        unsigned int logicalTS = pindex->nTime;
-        unsigned int prevLogicalTS = 0;
+    if (fReserveTransferIndex)
+        if (!pblocktree->UpdateReserveTransferIndex(createdTransfers, spentTransfers, false))
+            return AbortNode(state, "Failed to write reserve transfer index");
 
-        // retrieve logical timestamp of the previous block
-        if (pindex->pprev)
-            if (!pblocktree->ReadTimestampBlockIndex(pindex->pprev->GetBlockHash(), prevLogicalTS))
-                LogPrintf("%s: Failed to read previous block's logical timestamp\n", __func__);
+    if (fIdentityStateIndex)
+        if (!pblocktree->UpdateIdentityStateIndex(identityStates, identityCommitments, false))
+            return AbortNode(state, "Failed to write identity state index");
 
-        if (logicalTS <= prevLogicalTS) {
-            logicalTS = prevLogicalTS + 1;
-            //LogPrintf("%s: Previous logical timestamp is newer Actual[%d] prevLogical[%d] Logical[%d]\n", __func__, pindex->nTime, prevLogicalTS, logicalTS);
-        }
+    if (fKVIndex)
+        if (!pblocktree->UpdateKVIndex(kvEntries, false))
+            return AbortNode(state, "Failed to write key value index");
 
-        if (!pblocktree->WriteTimestampIndex(CTimestampIndexKey(logicalTS, pindex->GetBlockHash())))
-            return AbortNode(state, "Failed to write timestamp index");
+    // identities created or updated in this block are no longer current in the lookup cache
+    for (const CTransaction &tx : block.vtx)
+        CIdentity::InvalidateLookupCache(tx);
 
-        if (!pblocktree->WriteTimestampBlockIndex(CTimestampBlockIndexKey(pindex->GetBlockHash()), CTimestampBlockIndexValue(logicalTS)))
-            return AbortNode(state, "Failed to write blockhash index");
+    // while the timestamp index is built in the background, the builder writes the entries of new blocks
+    if (fTimestampIndex && IndexCoversHeight(BACKGROUND_INDEX_TIMESTAMP, pindex->GetHeight())) {
+        if (!WriteBlockTimestampIndex(pindex))
+            return AbortNode(state, "Failed to write timestamp index");
     }
 
     // START insightexplorer
@@ -5208,28 +7111,40 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
             return AbortNode(state, "Failed to write spent index");
         }
     }
-    if (fTimestampIndex) {
-        unsigned int logicalTS = pindex->nTime;
-        unsigned int prevLogicalTS = 0;
-
-        // retrieve logical timestamp of the previous block
-        if (pindex->pprev)
-            if (!pblocktree->ReadTimestampBlockIndex(pindex->pprev->GetBlockHash(), prevLogicalTS))
-                LogPrintf("%s: Failed to read previous block's logical timestamp\n", __func__);
-
-        if (logicalTS <= prevLogicalTS) {
-            logicalTS = prevLogicalTS + 1;
-            //LogPrintf("%s: Previous logical timestamp is newer Actual[%d] prevLogical[%d] Logical[%d]\n", __func__, pindex->nTime, prevLogicalTS, logicalTS);
+    if (fBlockDeltaIndex) {
+        CBlockDeltaSummary deltaSummary;
+        GetBlockDeltaSummary(block, blockundo, deltaSummary);
+        if (!pblocktree->WriteBlockDeltaSummary(pindex->GetBlockHash(), deltaSummary)) {
+            return AbortNode(state, "Failed to write block delta summary");
         }
-
-        if (!pblocktree->WriteTimestampIndex(CTimestampIndexKey(logicalTS, pindex->GetBlockHash())))
+    }
+    // entries are keyed by block hash like the filters, so those of disconnected blocks are left in place
+    if (fBlockStatsIndex) {
+        blockStats.nSize = ::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION);
+        if (!pblocktree->WriteBlockStats(pindex->GetBlockHash(), blockStats))
+            return AbortNode(state, "Failed to write block stats index");
+    }
+    // while the block filter index is built in the background, the builder writes the filters of new blocks
+    if (fBlockFilterIndex && IndexCoversHeight(BACKGROUND_INDEX_BLOCKFILTER, pindex->GetHeight())) {
+        if (!WriteBlockFilterIndex(CBlockFilter(block, blockundo), pindex))
+            return AbortNode(state, "Failed to write block filter index");
+    }
+    // the source of a stake may already be spent when its block is pruned, so it is marked to be retained then
+    if (fPruneMode && fPruneProofs && block.IsVerusPOSBlock()) {
+        if (!pblocktree->WritePrunedStakeSource(block.vtx.back().vin[0].prevout.hash))
+            return AbortNode(state, "Failed to write pruned stake source");
+    }
+    // while the timestamp index is built in the background, the builder writes the entries of new blocks
+    if (fTimestampIndex && IndexCoversHeight(BACKGROUND_INDEX_TIMESTAMP, pindex->GetHeight())) {
+        if (!WriteBlockTimestampIndex(pindex))
             return AbortNode(state, "Failed to write timestamp index");
-
-        if (!pblocktree->WriteTimestampBlockIndex(CTimestampBlockIndexKey(pindex->GetBlockHash()), CTimestampBlockIndexValue(logicalTS)))
-            return AbortNode(state, "Failed to write blockhash index");
     }
     // END insightexplorer
 
+    // blocks reconnected by VerifyDB on a scratch view are not applied
+    if (fUTXOStats && pindex->pprev == chainActive.Tip())
+        UpdateUTXOSetStats(block, blockundo, pindex, false);
+
     if (newThisChain.IsValid())
     {
         ConnectedChains.UpdateCachedCurrency(newThisChain, nHeight + 1);
@@ -5242,6 +7157,11 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 
     int64_t nTime3 = GetTimeMicros(); nTimeIndex += nTime3 - nTime2;
     LogPrint("bench", "    - Index writing: %.2fms [%.2fs]\n", 0.001 * (nTime3 - nTime2), nTimeIndex * 0.000001);
+    if (LogAcceptCategory("bench")) {
+        uint64_t identityCacheHits, identityCacheMisses, identityCacheEvictions;
+        CIdentity::IdentityLookupCache.GetStats(identityCacheHits, identityCacheMisses, identityCacheEvictions);
+        LogPrint("bench", "    - Identity lookup cache: %u entries, %lu hits, %lu misses, %lu evictions\n", (unsigned int)CIdentity::IdentityLookupCache.size(), identityCacheHits, identityCacheMisses, identityCacheEvictions);
+    }
 
     // Watch for changes to the previous coinbase transaction.
     static uint256 hashPrevBestCoinBase;
@@ -5346,9 +7266,12 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
                     return AbortNode(state, "Failed to write to block index database");
                 }
             }
-            // Finally remove any pruned files
-            if (fFlushForPrune)
+            // Finally remove any pruned files, once no coin database write from an earlier flush can still need them
+            if (fFlushForPrune) {
+                if (!pcoinsTip->SyncWrites())
+                    return AbortNode(state, "Failed to write to coin database");
                 UnlinkPrunedFiles(setFilesToPrune);
+            }
             nLastWrite = nNow;
         }
         // Flush best chain related state. This can only be done if the blocks / block index write was also done.
@@ -5363,6 +7286,12 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
             // Flush the chainstate (which may refer to block index entries).
             if (!pcoinsTip->Flush())
                 return AbortNode(state, "Failed to write to coin database");
+            // the statistics are only used at startup if the coins database holds the block they were written at
+            if (fUTXOStats && !WriteUTXOSetStats(pcoinsTip->GetBestBlock()))
+                return AbortNode(state, "Failed to write UTXO set statistics");
+            // With -backgroundflush the write may still be running. Explicit flushes, such as at shutdown, wait for it.
+            if (mode == FLUSH_STATE_ALWAYS && !pcoinsTip->SyncWrites())
+                return AbortNode(state, "Failed to write to coin database");
             nLastFlush = nNow;
         }
         if ((mode == FLUSH_STATE_ALWAYS || mode == FLUSH_STATE_PERIODIC) && nNow > nLastSetChain + (int64_t)DATABASE_WRITE_INTERVAL * 1000000) {
@@ -5381,6 +7310,34 @@ void FlushStateToDisk() {
     FlushStateToDisk(state, FLUSH_STATE_ALWAYS);
 }
 
+bool WriteChainMMR()
+{
+    LOCK(cs_main);
+    boost::filesystem::path mmrPath = GetDataDir() / CHAIN_MMR_FILENAME;
+    boost::filesystem::path mmrPathNew = mmrPath.string() + ".new";
+    try
+    {
+        {
+            CAutoFile mmrFile(fopen(mmrPathNew.string().c_str(), "wb"), SER_DISK, CLIENT_VERSION);
+            if (mmrFile.IsNull())
+            {
+                return error("%s: failed to open %s", __func__, mmrPathNew.string());
+            }
+            chainActive.WriteMMR(mmrFile);
+            FileCommit(mmrFile.Get());
+        }
+        if (!RenameOver(mmrPathNew, mmrPath))
+        {
+            return error("%s: failed to rename %s", __func__, mmrPathNew.string());
+        }
+    }
+    catch (const std::exception &e)
+    {
+        return error("%s: failed to write chain MMR: %s", __func__, e.what());
+    }
+    return true;
+}
+
 void PruneAndFlush() {
     CValidationState state;
     fCheckForPruning = true;
@@ -5388,8 +7345,35 @@ void PruneAndFlush() {
 }
 
 /** Update chainActive and related internal data structures. */
+// the read snapshot of the current tip, dropped on each tip change and taken again when next asked for
+static CCriticalSection cs_chainReadSnapshot;
+static std::shared_ptr<const CChainReadSnapshot> chainReadSnapshot;
+
+void ResetChainReadSnapshot()
+{
+    LOCK(cs_chainReadSnapshot);
+    chainReadSnapshot.reset();
+}
+
+std::shared_ptr<const CChainReadSnapshot> GetChainReadSnapshot()
+{
+    {
+        LOCK(cs_chainReadSnapshot);
+        if (chainReadSnapshot)
+            return chainReadSnapshot;
+    }
+
+    // the tip and the indexes only change together under cs_main, so a snapshot taken holding it sees both as of one tip
+    LOCK2(cs_main, cs_chainReadSnapshot);
+    if (!chainReadSnapshot)
+        chainReadSnapshot = std::make_shared<const CChainReadSnapshot>(chainActive.LastTip(),
+                                                                       pblocktree ? pblocktree->GetIndexSnapshot() : nullptr);
+    return chainReadSnapshot;
+}
+
 void static UpdateTip(CBlockIndex *pindexNew, const CChainParams& chainParams) {
     chainActive.SetTip(pindexNew);
+    ResetChainReadSnapshot();
 
     // New best block
     nTimeBestReceived = GetTime();
@@ -5437,10 +7421,102 @@ void static UpdateTip(CBlockIndex *pindexNew, const CChainParams& chainParams) {
     }
 }
 
-/**
- * Disconnect chainActive's tip. You probably want to call mempool.removeForReorg and
- * mempool.removeWithoutBranchId after this, with cs_main held.
- */
+/**
+ * Disconnect chainActive's tip. You probably want to call mempool.removeForReorg and
+ * mempool.removeWithoutBranchId after this, with cs_main held.
+ */
+// resurrect the mempool transactions of a disconnected block
+static void ResurrectDisconnectedTransactions(CBlock &block, const CBlockIndex *pindexDelete, const CChainParams& chainparams)
+{
+    for (int i = 0; i < block.vtx.size(); i++)
+    {
+        // ignore validation errors in resurrected transactions
+        CTransaction &tx = block.vtx[i];
+        CValidationState stateDummy;
+
+        // don't keep coinbase, staking, invalid transactions, or arbitrage only transfers
+        if (!(tx.IsCoinBase() || ((i == (block.vtx.size() - 1)) && block.IsVerusPOSBlock())))
+        {
+            bool isArbitrageOnly = false;
+            for (auto &oneOut : tx.vout)
+            {
+                COptCCParams p;
+                CReserveTransfer rt;
+                if (oneOut.scriptPubKey.IsPayToCryptoCondition(p) &&
+                    p.evalCode == EVAL_RESERVE_TRANSFER &&
+                    p.vData.size() &&
+                    (rt = p.vData[0]).IsValid() && rt.IsArbitrageOnly())
+                {
+                    isArbitrageOnly = true;
+                    break;
+                }
+            }
+            if (isArbitrageOnly)
+            {
+                continue;
+            }
+            AcceptToMemoryPool(mempool, stateDummy, tx, true, true, NULL);
+        }
+        // if this is a staking tx, and we are on Verus Sapling with nothing at stake solution,
+        // save staking tx as a possible cheat
+        else if (((i == (block.vtx.size() - 1)) && block.IsVerusPOSBlock()) && chainparams.GetConsensus().NetworkUpgradeActive(pindexDelete->GetHeight(), Consensus::UPGRADE_SAPLING))
+        {
+            CTxHolder txh = CTxHolder(block.vtx[i], pindexDelete->GetHeight());
+            cheatList.Add(txh);
+        }
+    }
+}
+
+// let wallets know the transactions of a disconnected block went from 1-confirmed to 0-confirmed or conflicted, and
+// update their cached incremental witnesses with the trees after it
+static void SyncDisconnectedBlockWithWallets(const CBlock &block, const CBlockIndex *pindexDelete,
+                                             const SproutMerkleTree &sproutTree, const SaplingMerkleTree &saplingTree)
+{
+    for (int i = 0; i < block.vtx.size(); i++)
+    {
+        const CTransaction &tx = block.vtx[i];
+        //if ((i == (block.vtx.size() - 1)) && ((ASSETCHAINS_LWMAPOS && block.IsVerusPOSBlock()) || (ASSETCHAINS_STAKED != 0 && (komodo_isPoS((CBlock *)&block) != 0))))
+        if ((i == (block.vtx.size() - 1)) && (ASSETCHAINS_STAKED != 0 && (komodo_isPoS((CBlock *)&block) != 0)))
+        {
+            EraseFromWallets(tx.GetHash());
+        }
+        else
+        {
+            SyncWithWallets(tx, NULL);
+        }
+    }
+    GetMainSignals().ChainTip(pindexDelete, &block, sproutTree, saplingTree, false);
+}
+
+// do not disconnect a notarized tip
+static bool IsNotarizedTip(const CBlock &block, const CBlockIndex *pindexDelete)
+{
+    uint256 notarizedhash;
+
+    CProofRoot confirmedRoot = ConnectedChains.FinalizedChainRoot();
+
+    if (confirmedRoot.IsValid())
+    {
+        notarizedhash = confirmedRoot.blockHash;
+    }
+
+    if ( block.GetHash() == notarizedhash )
+    {
+        fprintf(stderr,"DisconnectTip trying to disconnect notarized block at ht.%d\n",(int32_t)pindexDelete->GetHeight());
+        return true;
+    }
+    return false;
+}
+
+static void ResetDisconnectedBlockIndex(CBlockIndex *pindexDelete)
+{
+    pindexDelete->segid = -2;
+    pindexDelete->newcoins = 0;
+    pindexDelete->zfunds = 0;
+    pindexDelete->maturity = 0;
+    pindexDelete->immature = 0;
+}
+
 bool static DisconnectTip(CValidationState &state, const CChainParams& chainparams, bool fBare = false)
 {
     CBlockIndex *pindexDelete = chainActive.Tip();
@@ -5450,24 +7526,8 @@ bool static DisconnectTip(CValidationState &state, const CChainParams& chainpara
     if (!ReadBlockFromDisk(block, pindexDelete, chainparams.GetConsensus(), 1))
         return AbortNode(state, "Failed to read block");
 
-    // do not disconnect a notarized tip
-    {
-        int32_t prevMoMheight;
-        uint256 notarizedhash;
-
-        CProofRoot confirmedRoot = ConnectedChains.FinalizedChainRoot();
-
-        if (confirmedRoot.IsValid())
-        {
-            notarizedhash = confirmedRoot.blockHash;
-        }
-
-        if ( block.GetHash() == notarizedhash )
-        {
-            fprintf(stderr,"DisconnectTip trying to disconnect notarized block at ht.%d\n",(int32_t)pindexDelete->GetHeight());
-            return(false);
-        }
-    }
+    if (IsNotarizedTip(block, pindexDelete))
+        return(false);
 
     // Apply the block atomically to the chain state.
     uint256 sproutAnchorBeforeDisconnect = pcoinsTip->GetBestAnchor(SPROUT);
@@ -5480,12 +7540,9 @@ bool static DisconnectTip(CValidationState &state, const CChainParams& chainpara
             return error("DisconnectTip(): DisconnectBlock %s failed", pindexDelete->GetBlockHash().ToString());
         assert(view.Flush());
         DisconnectNotarisations(block);
+        EraseCachedTransactions(block);
     }
-    pindexDelete->segid = -2;
-    pindexDelete->newcoins = 0;
-    pindexDelete->zfunds = 0;
-    pindexDelete->maturity = 0;
-    pindexDelete->immature = 0;
+    ResetDisconnectedBlockIndex(pindexDelete);
 
     LogPrint("bench", "- Disconnect block: %.2fms\n", (GetTimeMicros() - nStart) * 0.001);
     uint256 sproutAnchorAfterDisconnect = pcoinsTip->GetBestAnchor(SPROUT);
@@ -5495,44 +7552,7 @@ bool static DisconnectTip(CValidationState &state, const CChainParams& chainpara
         return false;
 
     if (!fBare) {
-        // resurrect mempool transactions from the disconnected block.
-        for (int i = 0; i < block.vtx.size(); i++)
-        {
-            // ignore validation errors in resurrected transactions
-            CTransaction &tx = block.vtx[i];
-            CValidationState stateDummy;
-
-            // don't keep coinbase, staking, invalid transactions, or arbitrage only transfers
-            if (!(tx.IsCoinBase() || ((i == (block.vtx.size() - 1)) && block.IsVerusPOSBlock())))
-            {
-                bool isArbitrageOnly = false;
-                for (auto &oneOut : tx.vout)
-                {
-                    COptCCParams p;
-                    CReserveTransfer rt;
-                    if (oneOut.scriptPubKey.IsPayToCryptoCondition(p) &&
-                        p.evalCode == EVAL_RESERVE_TRANSFER &&
-                        p.vData.size() &&
-                        (rt = p.vData[0]).IsValid() && rt.IsArbitrageOnly())
-                    {
-                        isArbitrageOnly = true;
-                        break;
-                    }
-                }
-                if (isArbitrageOnly)
-                {
-                    continue;
-                }
-                AcceptToMemoryPool(mempool, stateDummy, tx, true, true, NULL);
-            }
-            // if this is a staking tx, and we are on Verus Sapling with nothing at stake solution,
-            // save staking tx as a possible cheat
-            else if (((i == (block.vtx.size() - 1)) && block.IsVerusPOSBlock()) && chainparams.GetConsensus().NetworkUpgradeActive(pindexDelete->GetHeight(), Consensus::UPGRADE_SAPLING))
-            {
-                CTxHolder txh = CTxHolder(block.vtx[i], pindexDelete->GetHeight());
-                cheatList.Add(txh);
-            }
-        }
+        ResurrectDisconnectedTransactions(block, pindexDelete, chainparams);
         if (sproutAnchorBeforeDisconnect != sproutAnchorAfterDisconnect) {
             // The anchor may not change between block disconnects,
             // in which case we don't want to evict from the mempool yet!
@@ -5553,31 +7573,198 @@ bool static DisconnectTip(CValidationState &state, const CChainParams& chainpara
     SaplingMerkleTree newSaplingTree;
     assert(pcoinsTip->GetSproutAnchorAt(pcoinsTip->GetBestAnchor(SPROUT), newSproutTree));
     assert(pcoinsTip->GetSaplingAnchorAt(pcoinsTip->GetBestAnchor(SAPLING), newSaplingTree));
-    // Let wallets know transactions went from 1-confirmed to
-    // 0-confirmed or conflicted:
-    for (int i = 0; i < block.vtx.size(); i++)
+    SyncDisconnectedBlockWithWallets(block, pindexDelete, newSproutTree, newSaplingTree);
+    return true;
+}
+
+// blocks read ahead and disconnected together by DisconnectTips
+static const size_t DISCONNECT_BATCH_SIZE = 32;
+
+/**
+ * Disconnect chainActive's tip until pindexFork is the tip, DISCONNECT_BATCH_SIZE blocks at a time. The blocks and
+ * undo data of a batch are read in parallel, and the index entries they erase or restore are written together once
+ * the batch is disconnected, followed by the wallet updates of its blocks. The mempool is updated once, after the
+ * last block, starting with the transactions of the oldest block so they are accepted before those spending them.
+ * Like DisconnectTip, this stops at a notarized block, returning false.
+ */
+static bool DisconnectTips(CValidationState &state, const CChainParams& chainparams, const CBlockIndex *pindexFork, bool fBare = false)
+{
+    AssertLockHeld(cs_main);
+    const Consensus::Params &consensusParams = chainparams.GetConsensus();
+
+    // the anchors of the tips that were disconnected, and the blocks whose transactions go back to the mempool
+    std::set<uint256> sproutAnchors, saplingAnchors;
+    std::vector<std::pair<CBlock, CBlockIndex *>> disconnected;
+    bool fResult = true;
+
+    while (fResult && chainActive.Tip() && chainActive.Tip() != pindexFork)
     {
-        CTransaction &tx = block.vtx[i];
-        //if ((i == (block.vtx.size() - 1)) && ((ASSETCHAINS_LWMAPOS && block.IsVerusPOSBlock()) || (ASSETCHAINS_STAKED != 0 && (komodo_isPoS((CBlock *)&block) != 0))))
-        if ((i == (block.vtx.size() - 1)) && (ASSETCHAINS_STAKED != 0 && (komodo_isPoS((CBlock *)&block) != 0)))
+        std::vector<CBlockIndex *> batch;
+        for (CBlockIndex *pindex = chainActive.Tip();
+             pindex && pindex != pindexFork && batch.size() < DISCONNECT_BATCH_SIZE;
+             pindex = pindex->pprev)
         {
-            EraseFromWallets(tx.GetHash());
+            batch.push_back(pindex);
         }
-        else
+
+        // the hash of each block read is checked against its index, which was validated when it was connected
+        std::vector<CBlock> blocks(batch.size());
+        std::vector<CBlockUndo> blockUndos(batch.size());
+        PrefetchBlockData(std::vector<const CBlockIndex *>(batch.begin(), batch.end()), true);
+        if (!RunInParallel(batch.size(), [&batch, &blocks, &blockUndos, &consensusParams](size_t i)
+            {
+                CDiskBlockPos pos = batch[i]->GetUndoPos();
+                return ReadBlockFromDisk(blocks[i], batch[i], consensusParams, false) &&
+                       batch[i]->pprev &&
+                       !pos.IsNull() &&
+                       UndoReadFromDisk(blockUndos[i], pos, batch[i]->pprev->GetBlockHash());
+            }))
         {
-            SyncWithWallets(tx, NULL);
+            return AbortNode(state, "Failed to read block");
+        }
+
+        CDisconnectedIndexes indexes;
+        std::vector<std::pair<SproutMerkleTree, SaplingMerkleTree>> trees;
+        int64_t nStart = GetTimeMicros();
+        for (size_t i = 0; i < batch.size(); i++)
+        {
+            CBlockIndex *pindexDelete = batch[i];
+            const CBlock &block = blocks[i];
+            if (IsNotarizedTip(block, pindexDelete))
+            {
+                fResult = false;
+                break;
+            }
+
+            sproutAnchors.insert(pcoinsTip->GetBestAnchor(SPROUT));
+            saplingAnchors.insert(pcoinsTip->GetBestAnchor(SAPLING));
+            {
+                CCoinsViewCache view(pcoinsTip);
+                if (DisconnectBlock(block, state, pindexDelete, view, chainparams, true, &blockUndos[i], &indexes) != DISCONNECT_OK)
+                {
+                    fResult = error("DisconnectTips(): DisconnectBlock %s failed", pindexDelete->GetBlockHash().ToString());
+                    break;
+                }
+                assert(view.Flush());
+                DisconnectNotarisations(block);
+                EraseCachedTransactions(block);
+            }
+            ResetDisconnectedBlockIndex(pindexDelete);
+            UpdateTip(pindexDelete->pprev, chainparams);
+
+            SproutMerkleTree newSproutTree;
+            SaplingMerkleTree newSaplingTree;
+            assert(pcoinsTip->GetSproutAnchorAt(pcoinsTip->GetBestAnchor(SPROUT), newSproutTree));
+            assert(pcoinsTip->GetSaplingAnchorAt(pcoinsTip->GetBestAnchor(SAPLING), newSaplingTree));
+            trees.push_back(std::make_pair(newSproutTree, newSaplingTree));
+        }
+        LogPrint("bench", "- Disconnect %u blocks: %.2fms\n", (unsigned int)trees.size(), (GetTimeMicros() - nStart) * 0.001);
+
+        // the blocks that were disconnected are written and sent to wallets, even when the batch stopped early
+        if (!indexes.Write(state))
+            return false;
+        // unwind any consensus upgrades that may have been removed in the batch
+        ConnectedChains.CheckOracleUpgrades();
+        for (size_t i = 0; i < trees.size(); i++)
+        {
+            SyncDisconnectedBlockWithWallets(blocks[i], batch[i], trees[i].first, trees[i].second);
+        }
+        if (!fBare)
+        {
+            for (size_t i = 0; i < trees.size(); i++)
+            {
+                disconnected.push_back(std::make_pair(std::move(blocks[i]), batch[i]));
+            }
         }
+
+        // Write the chain state to disk, if necessary.
+        if (!FlushStateToDisk(state, FLUSH_STATE_IF_NEEDED))
+            return false;
     }
-    // Update cached incremental witnesses
-    GetMainSignals().ChainTip(pindexDelete, &block, newSproutTree, newSaplingTree, false);
-    return true;
+
+    if (!fBare && disconnected.size())
+    {
+        for (auto it = disconnected.rbegin(); it != disconnected.rend(); it++)
+        {
+            ResurrectDisconnectedTransactions(it->first, it->second, chainparams);
+        }
+        // The anchor may not change between block disconnects,
+        // in which case we don't want to evict from the mempool yet!
+        sproutAnchors.erase(pcoinsTip->GetBestAnchor(SPROUT));
+        saplingAnchors.erase(pcoinsTip->GetBestAnchor(SAPLING));
+        for (const uint256 &anchor : sproutAnchors)
+        {
+            mempool.removeWithAnchor(anchor, SPROUT);
+        }
+        for (const uint256 &anchor : saplingAnchors)
+        {
+            mempool.removeWithAnchor(anchor, SAPLING);
+        }
+    }
+    return fResult;
 }
 
 static int64_t nTimeReadFromDisk = 0;
 static int64_t nTimeConnectTotal = 0;
 static int64_t nTimeFlush = 0;
 static int64_t nTimeChainState = 0;
+static int64_t nTimeWallet = 0;
 static int64_t nTimePostConnect = 0;
+static int64_t nBlocksConnected = 0;
+static int64_t nTransactionsConnected = 0;
+
+const char * const validationPhaseNames[VALIDATION_PHASE_COUNT] =
+{
+    "read", "deserialize", "checkblock", "prechecks", "inputs", "scripts", "index", "callbacks", "flush", "chainstate",
+    "wallet", "postconnect", "total"
+};
+
+// the time each block connected to the tip spent in each phase, and the totals when they were last reset
+static CDBLatencyHistogram validationPhaseHistograms[VALIDATION_PHASE_COUNT];
+static CBlockConnectTimes validationStatsBase;
+static int64_t nValidationStatsStart = GetTime();
+
+/**
+ * Reads the coins spent by a block into the coins cache with several readers at once, so that ConnectBlock
+ * finds them in memory instead of waiting on one database read after another on a cold cache.
+ */
+static void PrefetchBlockInputs(const CBlock &block, CCoinsViewCache &coins)
+{
+    int nThreads = std::max(0, std::min((int)GetArg("-inputprefetchthreads", DEFAULT_INPUT_PREFETCH_THREADS), MAX_INPUT_PREFETCH_THREADS));
+    if (!nThreads)
+    {
+        return;
+    }
+
+    int64_t nTimeStart = GetTimeMicros();
+
+    // outputs created in this block are never on disk yet
+    std::set<uint256> blockTxes;
+    for (const CTransaction &tx : block.vtx)
+    {
+        blockTxes.insert(tx.GetHash());
+    }
+
+    std::vector<uint256> prevTxes;
+    for (const CTransaction &tx : block.vtx)
+    {
+        if (tx.IsCoinBase())
+        {
+            continue;
+        }
+        for (const CTxIn &txin : tx.vin)
+        {
+            if (!blockTxes.count(txin.prevout.hash))
+            {
+                prevTxes.push_back(txin.prevout.hash);
+            }
+        }
+    }
+
+    size_t nRead = coins.PrefetchCoins(prevTxes, nThreads);
+    LogPrint("bench", "  - Prefetch %u of %u inputs: %.2fms\n", (unsigned int)nRead, (unsigned int)prevTxes.size(), (GetTimeMicros() - nTimeStart) * 0.001);
+}
+
 
 /**
  * Connect a new block to chainActive. pblock is either NULL or a pointer to a CBlock
@@ -5587,9 +7774,11 @@ static int64_t nTimePostConnect = 0;
 bool static ConnectTip(CValidationState& state, const CChainParams& chainparams, CBlockIndex* pindexNew, const CBlock* pblock)
 {
     assert(pindexNew->pprev == chainActive.Tip());
-    // Read block from disk.
+    CBlockConnectTimes connectStart = GetBlockConnectTimes();
+    // Read block from disk. only one tip is connected at a time, and the block isn't used after, so each read
+    // overwrites the last block read, reusing its memory
     int64_t nTime1 = GetTimeMicros();
-    CBlock block;
+    static CBlock block;
     if (!pblock) {
         if (!ReadBlockFromDisk(block, pindexNew, chainparams.GetConsensus(), 1))
             return AbortNode(state, "Failed to read block");
@@ -5606,9 +7795,13 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
     int64_t nTime2 = GetTimeMicros(); nTimeReadFromDisk += nTime2 - nTime1;
     int64_t nTime3;
     LogPrint("bench", "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * 0.001, nTimeReadFromDisk * 0.000001);
+    PrefetchBlockInputs(*pblock, *pcoinsTip);
     {
         CCoinsViewCache view(pcoinsTip);
+        TRACE3(validation, block_connect_start, pindexNew->GetBlockHash().begin(), pindexNew->GetHeight(), pblock->vtx.size());
         bool rv = ConnectBlock(*pblock, state, pindexNew, view, chainparams, false, true);
+        TRACE5(validation, block_connect_end, pindexNew->GetBlockHash().begin(), pindexNew->GetHeight(), pblock->vtx.size(),
+               rv, GetTimeMicros() - nTime2);
         KOMODO_CONNECTING = -1;
         GetMainSignals().BlockChecked(*pblock, state);
         if (!rv) {
@@ -5617,6 +7810,8 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
             return error("ConnectTip(): ConnectBlock %s failed", pindexNew->GetBlockHash().ToString());
         }
         mapBlockSource.erase(pindexNew->GetBlockHash());
+        // the transaction index now points into this block, even for transactions cached from another
+        EraseCachedTransactions(*pblock);
         nTime3 = GetTimeMicros(); nTimeConnectTotal += nTime3 - nTime2;
         LogPrint("bench", "  - Connect total: %.2fms [%.2fs]\n", (nTime3 - nTime2) * 0.001, nTimeConnectTotal * 0.000001);
         assert(view.Flush());
@@ -5643,6 +7838,7 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
 
     // Tell wallet about transactions that went from mempool
     // to conflicted:
+    int64_t nTimeWalletStart = GetTimeMicros();
     BOOST_FOREACH(const CTransaction &tx, txConflicted) {
         SyncWithWallets(tx, NULL);
     }
@@ -5653,11 +7849,21 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
 
     // Update cached incremental witnesses
     GetMainSignals().ChainTip(pindexNew, pblock, oldSproutTree, oldSaplingTree, true);
+    int64_t nTimeWalletBlock = GetTimeMicros() - nTimeWalletStart; nTimeWallet += nTimeWalletBlock;
+    LogPrint("bench", "  - Wallet notifications: %.2fms [%.2fs]\n", nTimeWalletBlock * 0.001, nTimeWallet * 0.000001);
 
     EnforceNodeDeprecation(pindexNew->GetHeight());
 
-    int64_t nTime6 = GetTimeMicros(); nTimePostConnect += nTime6 - nTime5; nTimeTotal += nTime6 - nTime1;
-    LogPrint("bench", "  - Connect postprocess: %.2fms [%.2fs]\n", (nTime6 - nTime5) * 0.001, nTimePostConnect * 0.000001);
+    int64_t nTime6 = GetTimeMicros(); nTimePostConnect += nTime6 - nTime5 - nTimeWalletBlock; nTimeTotal += nTime6 - nTime1;
+    nBlocksConnected++;
+    nTransactionsConnected += pblock->vtx.size();
+    LogPrint("bench", "  - Connect postprocess: %.2fms [%.2fs]\n", (nTime6 - nTime5 - nTimeWalletBlock) * 0.001, nTimePostConnect * 0.000001);
+
+    CBlockConnectTimes blockTimes = GetBlockConnectTimes() - connectStart;
+    for (int phase = 0; phase < VALIDATION_PHASE_COUNT; phase++)
+    {
+        validationPhaseHistograms[phase].Add(blockTimes.GetPhase((ValidationPhase)phase));
+    }
     LogPrint("bench", "- Connect block: %.2fms [%.2fs]\n", (nTime6 - nTime1) * 0.001, nTimeTotal * 0.000001);
     if ( KOMODO_LONGESTCHAIN != 0 && pindexNew->GetHeight() >= KOMODO_LONGESTCHAIN )
         KOMODO_INSYNC = 1;
@@ -5668,6 +7874,226 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
     return true;
 }
 
+CBlockConnectTimes CBlockConnectTimes::operator-(const CBlockConnectTimes &rhs) const
+{
+    CBlockConnectTimes ret;
+    ret.nBlocks = nBlocks - rhs.nBlocks;
+    ret.nTransactions = nTransactions - rhs.nTransactions;
+    ret.nRead = nRead - rhs.nRead;
+    ret.nDeserialize = nDeserialize - rhs.nDeserialize;
+    ret.nCheckBlock = nCheckBlock - rhs.nCheckBlock;
+    ret.nPrechecks = nPrechecks - rhs.nPrechecks;
+    ret.nInputs = nInputs - rhs.nInputs;
+    ret.nScripts = nScripts - rhs.nScripts;
+    ret.nIndex = nIndex - rhs.nIndex;
+    ret.nCallbacks = nCallbacks - rhs.nCallbacks;
+    ret.nFlush = nFlush - rhs.nFlush;
+    ret.nChainState = nChainState - rhs.nChainState;
+    ret.nWallet = nWallet - rhs.nWallet;
+    ret.nPostConnect = nPostConnect - rhs.nPostConnect;
+    ret.nTotal = nTotal - rhs.nTotal;
+    return ret;
+}
+
+int64_t CBlockConnectTimes::GetPhase(ValidationPhase phase) const
+{
+    switch (phase)
+    {
+        case VALIDATION_PHASE_READ: return nRead;
+        case VALIDATION_PHASE_DESERIALIZE: return nDeserialize;
+        case VALIDATION_PHASE_CHECKBLOCK: return nCheckBlock;
+        case VALIDATION_PHASE_PRECHECKS: return nPrechecks;
+        case VALIDATION_PHASE_INPUTS: return nInputs;
+        case VALIDATION_PHASE_SCRIPTS: return nScripts;
+        case VALIDATION_PHASE_INDEX: return nIndex;
+        case VALIDATION_PHASE_CALLBACKS: return nCallbacks;
+        case VALIDATION_PHASE_FLUSH: return nFlush;
+        case VALIDATION_PHASE_CHAINSTATE: return nChainState;
+        case VALIDATION_PHASE_WALLET: return nWallet;
+        case VALIDATION_PHASE_POSTCONNECT: return nPostConnect;
+        case VALIDATION_PHASE_TOTAL: return nTotal;
+        default: return 0;
+    }
+}
+
+UniValue CBlockConnectTimes::ToUniValue() const
+{
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("blocks", nBlocks);
+    ret.pushKV("transactions", nTransactions);
+
+    // milliseconds spent in each phase
+    UniValue phases(UniValue::VOBJ);
+    for (int phase = 0; phase < VALIDATION_PHASE_TOTAL; phase++)
+    {
+        phases.pushKV(validationPhaseNames[phase], GetPhase((ValidationPhase)phase) * 0.001);
+    }
+    ret.pushKV("phases", phases);
+    ret.pushKV("total", nTotal * 0.001);
+    ret.pushKV("msperblock", nBlocks ? nTotal * 0.001 / nBlocks : 0.0);
+    ret.pushKV("blockspersecond", nTotal ? nBlocks * 1000000.0 / nTotal : 0.0);
+    return ret;
+}
+
+CBlockConnectTimes GetBlockConnectTimes()
+{
+    AssertLockHeld(cs_main);
+    CBlockConnectTimes ret;
+    ret.nBlocks = nBlocksConnected;
+    ret.nTransactions = nTransactionsConnected;
+    ret.nRead = nTimeReadFromDisk;
+    ret.nCheckBlock = nTimeCheckBlock;
+    ret.nPrechecks = nTimePrechecks;
+    ret.nInputs = nTimeInputs;
+    ret.nScripts = nTimeScripts;
+    ret.nIndex = nTimeIndex;
+    ret.nCallbacks = nTimeCallbacks;
+    ret.nFlush = nTimeFlush;
+    ret.nChainState = nTimeChainState;
+    ret.nWallet = nTimeWallet;
+    ret.nPostConnect = nTimePostConnect;
+    ret.nTotal = nTimeTotal;
+    return ret;
+}
+
+CValidationStats GetValidationStats()
+{
+    AssertLockHeld(cs_main);
+    CValidationStats ret;
+    ret.nStartTime = nValidationStatsStart;
+    ret.totals = GetBlockConnectTimes() - validationStatsBase;
+    for (int phase = 0; phase < VALIDATION_PHASE_COUNT; phase++)
+    {
+        ret.phases[phase] = validationPhaseHistograms[phase].GetStats();
+    }
+    return ret;
+}
+
+void ResetValidationStats()
+{
+    AssertLockHeld(cs_main);
+    validationStatsBase = GetBlockConnectTimes();
+    nValidationStatsStart = GetTime();
+    for (auto &histogram : validationPhaseHistograms)
+    {
+        histogram.Reset();
+    }
+}
+
+std::string GetValidationMetrics()
+{
+    std::string strOut;
+    strOut += "# HELP verus_validation_phase_seconds Time each block connected to the tip spent in each phase of validation\n";
+    strOut += "# TYPE verus_validation_phase_seconds histogram\n";
+    for (int phase = 0; phase < VALIDATION_PHASE_COUNT; phase++)
+    {
+        CDBLatencyStats stats = validationPhaseHistograms[phase].GetStats();
+        std::string strLabels = strprintf("phase=\"%s\"", validationPhaseNames[phase]);
+        // the histogram buckets are cumulative, the last of ours only has the +Inf bound
+        uint64_t nCumulative = 0;
+        for (int i = 0; i < CDBLatencyStats::BUCKETS - 1; i++)
+        {
+            nCumulative += stats.buckets[i];
+            strOut += strprintf("verus_validation_phase_seconds_bucket{%s,le=\"%g\"} %u\n", strLabels, ((int64_t)1 << i) / 1e6, nCumulative);
+        }
+        strOut += strprintf("verus_validation_phase_seconds_bucket{%s,le=\"+Inf\"} %u\n", strLabels, stats.nCount);
+        strOut += strprintf("verus_validation_phase_seconds_sum{%s} %.6f\n", strLabels, stats.nTotalMicros / 1e6);
+        strOut += strprintf("verus_validation_phase_seconds_count{%s} %u\n", strLabels, stats.nCount);
+    }
+    return strOut;
+}
+
+// reads the block record at pos into ss without deserializing it, decompressing it if it is stored compressed
+static bool ReadBlockRecordFromDisk(const CDiskBlockPos &pos, CDataStream &ss)
+{
+    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return error("%s: OpenBlockFile failed for %s", __func__, pos.ToString());
+
+    try {
+        std::unique_ptr<CDataStream> pRecord = ReadCompressedDiskRecord(filein);
+        if (pRecord)
+        {
+            ss = std::move(*pRecord);
+            return true;
+        }
+        if (fseek(filein.Get(), -4, SEEK_CUR))
+            return error("%s: fseek failed for %s", __func__, pos.ToString());
+        unsigned int nSize;
+        filein >> nSize;
+        if (nSize > MAX_BLOCKFILE_SIZE)
+            return error("%s: invalid record size at %s", __func__, pos.ToString());
+        std::vector<char> record(nSize);
+        filein.read(record.data(), nSize);
+        ss.write(record.data(), nSize);
+    }
+    catch (const std::exception& e) {
+        return error("%s: I/O error - %s at %s", __func__, e.what(), pos.ToString());
+    }
+    return true;
+}
+
+bool ReplayBlocks(CValidationState &state, const CChainParams &chainparams, int nBlocks, int nPasses, std::vector<CBlockConnectTimes> &passTimes)
+{
+    AssertLockHeld(cs_main);
+    if (nBlocks <= 0 || nBlocks >= chainActive.Height())
+        return state.Error("replay-range-invalid");
+
+    CBlockIndex *pindexTip = chainActive.Tip();
+    std::vector<CBlockIndex *> vConnect;
+    for (CBlockIndex *pindex = pindexTip; vConnect.size() < (size_t)nBlocks; pindex = pindex->pprev)
+    {
+        vConnect.push_back(pindex);
+    }
+    std::reverse(vConnect.begin(), vConnect.end());
+
+    CBlock block;
+    for (int pass = 0; pass < nPasses; pass++)
+    {
+        // bare disconnects, so the transactions of the range are not resurrected into the mempool each pass
+        for (int i = 0; i < nBlocks; i++)
+        {
+            if (!DisconnectTip(state, chainparams, true))
+                return error("%s: unable to disconnect block %s", __func__, chainActive.Tip()->GetBlockHash().GetHex());
+        }
+
+        CBlockConnectTimes passStart = GetBlockConnectTimes();
+        int64_t nTimeRead = 0, nTimeDeserialize = 0;
+        for (CBlockIndex *pindex : vConnect)
+        {
+            CDataStream ss(SER_DISK, CLIENT_VERSION);
+            int64_t nTime1 = GetTimeMicros();
+            if (!ReadBlockRecordFromDisk(pindex->GetBlockPos(), ss))
+                return AbortNode(state, "Failed to read block");
+            int64_t nTime2 = GetTimeMicros();
+            block.SetNullForReuse();
+            try {
+                ss >> block;
+            }
+            catch (const std::exception& e) {
+                return AbortNode(state, strprintf("Failed to deserialize block: %s", e.what()));
+            }
+            int64_t nTime3 = GetTimeMicros();
+            nTimeRead += nTime2 - nTime1;
+            nTimeDeserialize += nTime3 - nTime2;
+
+            if (block.GetHash() != pindex->GetBlockHash())
+                return error("%s: block read from %s does not match index for %s", __func__, pindex->GetBlockPos().ToString(), pindex->ToString());
+            if (!ConnectTip(state, chainparams, pindex, &block))
+                return false;
+        }
+
+        // the block is passed to ConnectTip, so its read counter only holds the loading of the commitment trees
+        CBlockConnectTimes passTime = GetBlockConnectTimes() - passStart;
+        passTime.nRead += nTimeRead;
+        passTime.nDeserialize = nTimeDeserialize;
+        passTime.nTotal += nTimeRead + nTimeDeserialize;
+        passTimes.push_back(passTime);
+        LogPrint("bench", "Replay pass %d of %d blocks: %.2fms (%.3fms/block)\n", pass + 1, nBlocks, passTime.nTotal * 0.001, passTime.nTotal * 0.001 / nBlocks);
+    }
+    return true;
+}
+
 /**
  * Return the tip of the chain with the most work in it, that isn't
  * known to be invalid (it's however far from certain to be valid).
@@ -5839,8 +8265,8 @@ static bool ActivateBestChainStep(CValidationState& state, const CChainParams& c
     // Disconnect active blocks which are no longer in the best chain.
     bool fBlocksDisconnected = false;
 
-    while (chainActive.Tip() && chainActive.Tip() != pindexFork) {
-        if (!DisconnectTip(state, chainparams))
+    if (chainActive.Tip() && chainActive.Tip() != pindexFork) {
+        if (!DisconnectTips(state, chainparams, pindexFork))
             return false;
         fBlocksDisconnected = true;
     }
@@ -6061,10 +8487,10 @@ bool ReconsiderBlock(CValidationState& state, CBlockIndex *pindex) {
     return true;
 }
 
-CBlockIndex* AddToBlockIndex(const CBlockHeader& block)
+CBlockIndex* AddToBlockIndex(const CBlockHeader& block, const uint256 *pBlockHash=NULL)
 {
     // Check for duplicate
-    uint256 hash = block.GetHash();
+    uint256 hash = pBlockHash ? *pBlockHash : block.GetHash();
     //printf("Hash of new index entry: %s\n\n", hash.GetHex().c_str());
 
     BlockMap::iterator it = mapBlockIndex.find(hash);
@@ -6430,12 +8856,14 @@ bool CheckBlock(int32_t *futureblockp,int32_t height,CBlockIndex *pindex,const C
     {
         uint256 entropyHash;
         entropyHash = chainActive.GetVerusEntropyHash(height);
-        if (isPBaaS && block.GetBlockMMRRoot() != BlockMMView(block.GetBlockMMRTree(entropyHash)).GetRoot())
+
+        // this block is not yet valid, so don't use or fill the tree cache for its hash
+        if (isPBaaS && block.GetBlockMMRRoot() != BlockMMView(block.BuildBlockMMRTree(entropyHash)).GetRoot())
         {
-            LogPrint("notarization", "%s: block.GetBlockMMRRoot(): %s\nBlockMMView(block.GetBlockMMRTree(entropyHash)).GetRoot(): %s\n",
+            LogPrint("notarization", "%s: block.GetBlockMMRRoot(): %s\nBlockMMView(block.BuildBlockMMRTree(entropyHash)).GetRoot(): %s\n",
                         __func__,
                         block.GetBlockMMRRoot().GetHex().c_str(),
-                        BlockMMView(block.GetBlockMMRTree(entropyHash)).GetRoot().GetHex().c_str());
+                        BlockMMView(block.BuildBlockMMRTree(entropyHash)).GetRoot().GetHex().c_str());
             return state.Error("CheckBlock Merkle Mountain Range (MMR) root mismatch");
         }
     }
@@ -6514,10 +8942,10 @@ bool CheckBlock(int32_t *futureblockp,int32_t height,CBlockIndex *pindex,const C
 
 bool ContextualCheckBlockHeader(
     const CBlockHeader& block, CValidationState& state,
-    const CChainParams& chainParams, CBlockIndex * const pindexPrev)
+    const CChainParams& chainParams, CBlockIndex * const pindexPrev, const uint256 *pBlockHash)
 {
     const Consensus::Params& consensusParams = chainParams.GetConsensus();
-    uint256 hash = block.GetHash();
+    uint256 hash = pBlockHash ? *pBlockHash : block.GetHash();
     if (hash == consensusParams.hashGenesisBlock)
         return true;
 
@@ -6727,20 +9155,20 @@ bool ContextualCheckBlock(
     return true;
 }
 
-static bool AcceptBlockHeader(int32_t *futureblockp,const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex=NULL)
+static bool AcceptBlockHeader(int32_t *futureblockp,const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex=NULL, const uint256 *pBlockHash=NULL)
 {
     static uint256 zero;
     AssertLockHeld(cs_main);
 
     // Check for duplicate
-    uint256 hash = block.GetHash();
+    uint256 hash = pBlockHash ? *pBlockHash : block.GetHash();
     BlockMap::iterator miSelf = mapBlockIndex.find(hash);
     CBlockIndex *pindex = NULL;
     if (miSelf != mapBlockIndex.end())
     {
         // Block header is already known.
         if ( (pindex = miSelf->second) == 0 )
-            miSelf->second = pindex = AddToBlockIndex(block);
+            miSelf->second = pindex = AddToBlockIndex(block, &hash);
         if (ppindex)
             *ppindex = pindex;
         if ( pindex != 0 && pindex->nStatus & BLOCK_FAILED_MASK )
@@ -6788,7 +9216,7 @@ static bool AcceptBlockHeader(int32_t *futureblockp,const CBlockHeader& block, C
         if ( (pindexPrev->nStatus & BLOCK_FAILED_MASK) )
             return state.DoS(100, error("%s: prev block invalid", __func__), REJECT_INVALID, "bad-prevblk");
     }
-    if (!ContextualCheckBlockHeader(block, state, chainparams, pindexPrev))
+    if (!ContextualCheckBlockHeader(block, state, chainparams, pindexPrev, &hash))
     {
         //fprintf(stderr,"AcceptBlockHeader ContextualCheckBlockHeader failed\n");
         LogPrintf("AcceptBlockHeader ContextualCheckBlockHeader failed\n");
@@ -6796,7 +9224,7 @@ static bool AcceptBlockHeader(int32_t *futureblockp,const CBlockHeader& block, C
     }
     if (pindex == NULL)
     {
-        if ( (pindex= AddToBlockIndex(block)) != 0 )
+        if ( (pindex= AddToBlockIndex(block, &hash)) != 0 )
         {
             miSelf = mapBlockIndex.find(hash);
             if (miSelf != mapBlockIndex.end())
@@ -6877,15 +9305,22 @@ static bool AcceptBlock(int32_t *futureblockp, const CBlock& block, CValidationS
     int nHeight = pindex->GetHeight();
     // Write block to history file
     try {
-        unsigned int nBlockSize = ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
         CDiskBlockPos blockPos;
         if (dbp != NULL)
+        {
+            // the block is already on disk, possibly compressed, and the file only needs to cover its record
             blockPos = *dbp;
-        if (!FindBlockPos(state, blockPos, nBlockSize+8, nHeight, block.GetBlockTime(), dbp != NULL))
-            return error("AcceptBlock(): FindBlockPos failed");
-        if (dbp == NULL)
-            if (!WriteBlockToDisk(block, blockPos, chainparams.MessageStart()))
+            if (!FindBlockPos(state, blockPos, GetDiskRecordSize(blockPos, ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION)) + 8, nHeight, block.GetBlockTime(), true))
+                return error("AcceptBlock(): FindBlockPos failed");
+        }
+        else
+        {
+            CDiskRecord blockRecord(block);
+            if (!FindBlockPos(state, blockPos, blockRecord.size() + 8, nHeight, block.GetBlockTime(), false))
+                return error("AcceptBlock(): FindBlockPos failed");
+            if (!WriteBlockToDisk(blockRecord, blockPos, chainparams.MessageStart()))
                 AbortNode(state, "Failed to write block");
+        }
         if (!ReceivedBlockTransactions(block, state, chainparams, pindex, blockPos))
             return error("AcceptBlock(): ReceivedBlockTransactions failed");
     } catch (const std::runtime_error& e) {
@@ -7136,19 +9571,116 @@ void PruneOneBlockFile(const int fileNumber)
         }
     }
 
-    vinfoBlockFile[fileNumber].SetNull();
-    setDirtyFileInfo.insert(fileNumber);
-}
-
+    vinfoBlockFile[fileNumber].SetNull();
+    setDirtyFileInfo.insert(fileNumber);
+}
+
+
+void UnlinkPrunedFiles(std::set<int>& setFilesToPrune)
+{
+    for (set<int>::iterator it = setFilesToPrune.begin(); it != setFilesToPrune.end(); ++it) {
+        CDiskBlockPos pos(*it, 0);
+        boost::filesystem::remove(GetBlockPosFilename(pos, "blk"));
+        boost::filesystem::remove(GetBlockPosFilename(pos, "rev"));
+        LogPrintf("Prune: %s deleted blk/rev (%05u)\n", __func__, *it);
+    }
+}
+
+// the PBaaS objects that notarizations, imports and identities are proven with, which is everything from currency
+// definitions through notary signatures except plain reserve outputs
+static bool IsProofRetainedOutput(const CTxOut &txout)
+{
+    COptCCParams p;
+    return txout.scriptPubKey.IsPayToCryptoCondition(p) &&
+           p.IsValid() &&
+           p.evalCode >= EVAL_CURRENCY_DEFINITION &&
+           p.evalCode <= EVAL_NOTARY_SIGNATURE &&
+           p.evalCode != EVAL_RESERVE_OUTPUT;
+}
+
+/* With -pruneproofs, store what the blocks of a file about to be pruned need to prove the transactions kept from
+   them. Those are the coinbases and stakes, transactions with PBaaS outputs, transactions with outputs unspent, which
+   may still become stake sources, and transactions already spent by a stake. Blocks off the active chain are not kept */
+static bool StorePrunedProofs(const int fileNumber)
+{
+    const Consensus::Params &consensusParams = Params().GetConsensus();
+    std::vector<const CBlockIndex *> blockIndexes;
+    for (BlockMap::iterator it = mapBlockIndex.begin(); it != mapBlockIndex.end(); ++it)
+    {
+        CBlockIndex *pindex = it->second;
+        if (pindex && pindex->nFile == fileNumber && (pindex->nStatus & BLOCK_HAVE_DATA) && chainActive.Contains(pindex))
+        {
+            blockIndexes.push_back(pindex);
+        }
+    }
+
+    // blocks are read and hashed in parallel, a chunk at a time so the file is never held in memory at once
+    const size_t nChunkSize = 64;
+    for (size_t start = 0; start < blockIndexes.size(); start += nChunkSize)
+    {
+        size_t count = std::min(nChunkSize, blockIndexes.size() - start);
+        std::vector<CBlock> blocks(count);
+        std::vector<std::pair<uint256, CPrunedBlockProofs>> blockProofs(count);
+        PrefetchBlockData(std::vector<const CBlockIndex *>(blockIndexes.begin() + start, blockIndexes.begin() + start + count), false);
+        if (!RunInParallel(count, [&](size_t i)
+            {
+                const CBlockIndex *pindex = blockIndexes[start + i];
+                if (!ReadBlockFromDisk(blocks[i], pindex, consensusParams, false))
+                {
+                    return false;
+                }
+                CPrunedBlockProofs &proofs = blockProofs[i].second;
+                BlockMMRange blockMMR(blocks[i].BuildBlockMMRTree(uint256()));
+                proofs.nTx = blocks[i].vtx.size();
+                for (size_t j = 0; j < blockMMR.size(); j++)
+                {
+                    proofs.mmrLeaves.push_back(blockMMR[j].hash);
+                }
+                for (const CTransaction &tx : blocks[i].vtx)
+                {
+                    proofs.txids.push_back(tx.GetHash());
+                }
+                blockProofs[i].first = pindex->GetBlockHash();
+                return true;
+            }))
+        {
+            return error("%s: could not read the blocks of file %05u", __func__, fileNumber);
+        }
 
-void UnlinkPrunedFiles(std::set<int>& setFilesToPrune)
-{
-    for (set<int>::iterator it = setFilesToPrune.begin(); it != setFilesToPrune.end(); ++it) {
-        CDiskBlockPos pos(*it, 0);
-        boost::filesystem::remove(GetBlockPosFilename(pos, "blk"));
-        boost::filesystem::remove(GetBlockPosFilename(pos, "rev"));
-        LogPrintf("Prune: %s deleted blk/rev (%05u)\n", __func__, *it);
+        std::vector<std::pair<uint256, std::pair<uint256, CTransaction>>> retainedTxs;
+        std::vector<uint256> retainedStakeSources;
+        for (size_t i = 0; i < count; i++)
+        {
+            const CBlock &block = blocks[i];
+            CPrunedBlockProofs &proofs = blockProofs[i].second;
+            bool isPOS = block.IsVerusPOSBlock();
+            for (uint32_t j = 0; j < block.vtx.size(); j++)
+            {
+                const CTransaction &tx = block.vtx[j];
+                bool isStakeSource = pblocktree->HavePrunedStakeSource(proofs.txids[j]);
+                bool retain = j == 0 ||
+                              (isPOS && j == block.vtx.size() - 1) ||
+                              isStakeSource ||
+                              std::any_of(tx.vout.begin(), tx.vout.end(), IsProofRetainedOutput) ||
+                              pcoinsTip->HaveCoins(proofs.txids[j]);
+                if (!retain)
+                {
+                    continue;
+                }
+                proofs.retained.push_back(j);
+                retainedTxs.push_back(std::make_pair(proofs.txids[j], std::make_pair(blockProofs[i].first, tx)));
+                if (isStakeSource)
+                {
+                    retainedStakeSources.push_back(proofs.txids[j]);
+                }
+            }
+        }
+        if (!pblocktree->WritePrunedProofs(blockProofs, retainedTxs, retainedStakeSources))
+        {
+            return error("%s: could not write the proof data of file %05u", __func__, fileNumber);
+        }
     }
+    return true;
 }
 
 /* Calculate the block/rev files that should be deleted to remain under target*/
@@ -7184,6 +9716,11 @@ void FindFilesToPrune(std::set<int>& setFilesToPrune, uint64_t nPruneAfterHeight
             if (vinfoBlockFile[fileNumber].nHeightLast > nLastBlockWeCanPrune)
                 continue;
 
+            if (fPruneProofs && !StorePrunedProofs(fileNumber)) {
+                LogPrintf("Prune: could not store the proof data of blk/rev (%05u), it is kept\n", fileNumber);
+                break;
+            }
+
             PruneOneBlockFile(fileNumber);
             // Queue up the files for removal
             setFilesToPrune.insert(fileNumber);
@@ -7225,7 +9762,9 @@ FILE* OpenDiskFile(const CDiskBlockPos &pos, const char *prefix, bool fReadOnly)
     }
     if ( pos.nFile < sizeof(didinit)/sizeof(*didinit) && didinit[pos.nFile] == 0 && strcmp(prefix,(char *)"blk") == 0 )
     {
-        komodo_prefetch(file);
+        // the OS reads the file into its cache in the background where it takes the hint, rather than this thread
+        if (!AdviseFileWillNeed(file, 0, 0))
+            komodo_prefetch(file);
         didinit[pos.nFile] = 1;
     }
     if (pos.nPos) {
@@ -7246,6 +9785,67 @@ FILE* OpenUndoFile(const CDiskBlockPos &pos, bool fReadOnly) {
     return OpenDiskFile(pos, "rev", fReadOnly);
 }
 
+// hints the ranges of one file to the OS, each ending at the next position when that is no more than a block away
+static void PrefetchFileRanges(const CDiskBlockPos &firstPos, const char *prefix, std::vector<unsigned int> &positions)
+{
+    boost::filesystem::path path = GetBlockPosFilename(firstPos, prefix);
+    FILE *file = fopen(path.string().c_str(), "rb");
+    if (!file)
+    {
+        return;
+    }
+    std::sort(positions.begin(), positions.end());
+    int64_t rangeStart = -1, rangeEnd = -1;
+    for (size_t i = 0; i < positions.size(); i++)
+    {
+        int64_t start = std::max((int64_t)positions[i] - BLOCK_PREFETCH_HEADER_BYTES, (int64_t)0);
+        int64_t end = positions[i] + BLOCK_PREFETCH_BYTES;
+        if (i + 1 < positions.size() && positions[i + 1] - positions[i] <= MAX_BLOCK_SIZE)
+        {
+            end = positions[i + 1];
+        }
+        if (rangeEnd < start)
+        {
+            if (rangeEnd > rangeStart && !AdviseFileWillNeed(file, rangeStart, rangeEnd - rangeStart))
+            {
+                fclose(file);
+                return;
+            }
+            rangeStart = start;
+        }
+        rangeEnd = std::max(rangeEnd, end);
+    }
+    if (rangeEnd > rangeStart)
+    {
+        AdviseFileWillNeed(file, rangeStart, rangeEnd - rangeStart);
+    }
+    fclose(file);
+}
+
+void PrefetchBlockData(const std::vector<const CBlockIndex *> &indexes, bool fUndo)
+{
+    std::map<int, std::vector<unsigned int>> blockPositions, undoPositions;
+    for (const CBlockIndex *pindex : indexes)
+    {
+        if (pindex->nStatus & BLOCK_HAVE_DATA)
+        {
+            blockPositions[pindex->nFile].push_back(pindex->nDataPos);
+        }
+        if (fUndo && (pindex->nStatus & BLOCK_HAVE_UNDO))
+        {
+            undoPositions[pindex->nFile].push_back(pindex->nUndoPos);
+        }
+    }
+    for (auto &onePositions : blockPositions)
+    {
+        PrefetchFileRanges(CDiskBlockPos(onePositions.first, 0), "blk", onePositions.second);
+    }
+    for (auto &onePositions : undoPositions)
+    {
+        PrefetchFileRanges(CDiskBlockPos(onePositions.first, 0), "rev", onePositions.second);
+    }
+}
+
 boost::filesystem::path GetBlockPosFilename(const CDiskBlockPos &pos, const char *prefix)
 {
     return GetDataDir() / "blocks" / strprintf("%s%05u.dat", prefix, pos.nFile);
@@ -7274,6 +9874,164 @@ CBlockIndex * InsertBlockIndex(uint256 hash)
     return pindexNew;
 }
 
+size_t GetBlockIndexMemoryUsage()
+{
+    AssertLockHeld(cs_main);
+    size_t usage = memusage::DynamicUsage(mapBlockIndex);
+    for (const auto &entry : mapBlockIndex)
+    {
+        if (entry.second)
+        {
+            usage += memusage::MallocUsage(sizeof(CBlockIndex)) + entry.second->nSolution.DynamicMemoryUsage();
+        }
+    }
+    return usage;
+}
+
+// number of active chain blocks the index builder takes at once. block and undo data for them are read in parallel
+static const int INDEX_BUILD_BATCH_SIZE = 64;
+
+// fills in indexes that were enabled on an existing database, walking the active chain from the height each is
+// complete through while new blocks keep being connected. blocks above the build height are left to the builder
+// until it catches up with the tip, after which ConnectBlock and DisconnectBlock maintain the index as usual
+void ThreadBuildIndexes()
+{
+    const Consensus::Params &consensusParams = Params().GetConsensus();
+
+    for (int i = 0; i < BACKGROUND_INDEX_COUNT; i++)
+    {
+        BackgroundIndex index = (BackgroundIndex)i;
+        while (true)
+        {
+            boost::this_thread::interruption_point();
+
+            std::vector<CBlockIndex *> blocks;
+            {
+                LOCK(cs_main);
+                if (!fIndexBuilding[i] || !BackgroundIndexEnabled(index))
+                {
+                    break;
+                }
+                if (nIndexBuildHeight[i] >= chainActive.Height())
+                {
+                    LogPrintf("%s: %s is complete through height %d\n", __func__, BACKGROUND_INDEX_NAMES[i], nIndexBuildHeight[i]);
+                    fIndexBuilding[i] = false;
+                    pblocktree->EraseIndexBuildHeight(BACKGROUND_INDEX_NAMES[i]);
+                    break;
+                }
+                for (int height = nIndexBuildHeight[i] + 1; height <= chainActive.Height() && blocks.size() < (size_t)INDEX_BUILD_BATCH_SIZE; height++)
+                {
+                    blocks.push_back(chainActive[height]);
+                }
+            }
+
+            // balance deltas and filters are derived from block and undo data, which is read and processed without holding cs_main
+            std::vector<std::vector<CAddressBalanceDbEntry>> blockDeltas(blocks.size());
+            std::vector<CBlockFilter> blockFilters(blocks.size());
+            PrefetchBlockData(std::vector<const CBlockIndex *>(blocks.begin(), blocks.end()), true);
+            if (index == BACKGROUND_INDEX_ADDRESSBALANCE &&
+                !RunInParallel(blocks.size(), [&blocks, &blockDeltas, &consensusParams](size_t j)
+                {
+                    const CBlockIndex *pindex = blocks[j];
+                    // the genesis block's transactions are never connected
+                    if (!pindex->pprev)
+                    {
+                        return true;
+                    }
+                    CBlock block;
+                    CBlockUndo blockUndo;
+                    CDiskBlockPos undoPos = pindex->GetUndoPos();
+                    if (!(pindex->nStatus & BLOCK_HAVE_DATA) || undoPos.IsNull() ||
+                        !ReadBlockFromDisk(block, pindex, consensusParams, false) ||
+                        !UndoReadFromDisk(blockUndo, undoPos, pindex->pprev->GetBlockHash()) ||
+                        blockUndo.vtxundo.size() + 1 != block.vtx.size())
+                    {
+                        return false;
+                    }
+                    std::vector<CAddressIndexDbEntry> addressIndex;
+                    GetBlockAddressIndex(block, blockUndo, pindex->GetHeight(), addressIndex);
+                    GetAddressBalanceDeltas(block, blockUndo, addressIndex, blockDeltas[j]);
+                    return true;
+                }))
+            {
+                LogPrintf("%s: unable to read block or undo data above height %d, %s remains incomplete until -reindex\n",
+                          __func__, nIndexBuildHeight[i], BACKGROUND_INDEX_NAMES[i]);
+                break;
+            }
+            if (index == BACKGROUND_INDEX_BLOCKFILTER &&
+                !RunInParallel(blocks.size(), [&blocks, &blockFilters, &consensusParams](size_t j)
+                {
+                    const CBlockIndex *pindex = blocks[j];
+                    CBlock block;
+                    CBlockUndo blockUndo;
+                    if (!(pindex->nStatus & BLOCK_HAVE_DATA) || !ReadBlockFromDisk(block, pindex, consensusParams, false))
+                    {
+                        return false;
+                    }
+                    // the genesis block has no undo data, as it spends nothing
+                    if (pindex->pprev)
+                    {
+                        CDiskBlockPos undoPos = pindex->GetUndoPos();
+                        if (undoPos.IsNull() ||
+                            !UndoReadFromDisk(blockUndo, undoPos, pindex->pprev->GetBlockHash()) ||
+                            blockUndo.vtxundo.size() + 1 != block.vtx.size())
+                        {
+                            return false;
+                        }
+                    }
+                    blockFilters[j] = CBlockFilter(block, blockUndo);
+                    return true;
+                }))
+            {
+                LogPrintf("%s: unable to read block or undo data above height %d, %s remains incomplete until -reindex\n",
+                          __func__, nIndexBuildHeight[i], BACKGROUND_INDEX_NAMES[i]);
+                break;
+            }
+
+            LOCK(cs_main);
+            int lastHeight = nIndexBuildHeight[i];
+            for (size_t j = 0; j < blocks.size(); j++)
+            {
+                CBlockIndex *pindex = blocks[j];
+                int height = pindex->GetHeight();
+
+                // after a reorg, blocks no longer on the active chain are left for the next batch to replace
+                if (!fIndexBuilding[i] || height != nIndexBuildHeight[i] + 1 || chainActive[height] != pindex)
+                {
+                    break;
+                }
+
+                bool fWritten = true;
+                if (index == BACKGROUND_INDEX_TIMESTAMP)
+                {
+                    fWritten = !pindex->pprev || WriteBlockTimestampIndex(pindex);
+                }
+                else if (index == BACKGROUND_INDEX_BLOCKFILTER)
+                {
+                    // headers are chained in height order, each from the one just written for its parent
+                    fWritten = WriteBlockFilterIndex(blockFilters[j], pindex);
+                }
+                else
+                {
+                    fWritten = pblocktree->UpdateAddressBalanceIndex(blockDeltas[j], false, &height);
+                }
+                if (!fWritten)
+                {
+                    LogPrintf("%s: failed to write %s at height %d\n", __func__, BACKGROUND_INDEX_NAMES[i], height);
+                    return;
+                }
+                nIndexBuildHeight[i] = height;
+            }
+
+            // timestamp and filter index entries can be written again safely, so their progress is only recorded once per batch
+            if (index != BACKGROUND_INDEX_ADDRESSBALANCE && nIndexBuildHeight[i] != lastHeight)
+            {
+                pblocktree->WriteIndexBuildHeight(BACKGROUND_INDEX_NAMES[i], nIndexBuildHeight[i]);
+            }
+        }
+    }
+}
+
 //void komodo_pindex_init(CBlockIndex *pindex,int32_t height);
 
 bool static LoadBlockIndexDB()
@@ -7297,10 +10055,31 @@ bool static LoadBlockIndexDB()
     //fprintf(stderr,"load blockindexDB paired %u\n",(uint32_t)time(NULL));
     sort(vSortedByHeight.begin(), vSortedByHeight.end());
     //fprintf(stderr,"load blockindexDB sorted %u\n",(uint32_t)time(NULL));
-    BOOST_FOREACH(const PAIRTYPE(int, CBlockIndex*)& item, vSortedByHeight)
+
+    // the proof of each block depends only on its own header, so compute them on all cores before the sequential pass
+    std::vector<CChainPower> vBlockProofs(vSortedByHeight.size(), CChainPower(0));
     {
-        CBlockIndex* pindex = item.second;
-        pindex->chainPower = (pindex->pprev ? CChainPower(pindex) + pindex->pprev->chainPower : CChainPower(pindex)) + GetBlockProof(*pindex);
+        size_t nThreads = std::max(GetNumCores(), 1);
+        size_t nPerThread = (vSortedByHeight.size() + nThreads - 1) / nThreads;
+        boost::thread_group proofThreads;
+        for (size_t begin = 0; begin < vSortedByHeight.size(); begin += nPerThread)
+        {
+            size_t end = std::min(begin + nPerThread, vSortedByHeight.size());
+            proofThreads.create_thread([&vSortedByHeight, &vBlockProofs, begin, end]()
+            {
+                for (size_t i = begin; i < end; i++)
+                {
+                    vBlockProofs[i] = GetBlockProof(*vSortedByHeight[i].second);
+                }
+            });
+        }
+        proofThreads.join_all();
+    }
+
+    for (size_t nSorted = 0; nSorted < vSortedByHeight.size(); nSorted++)
+    {
+        CBlockIndex* pindex = vSortedByHeight[nSorted].second;
+        pindex->chainPower = (pindex->pprev ? CChainPower(pindex) + pindex->pprev->chainPower : CChainPower(pindex)) + vBlockProofs[nSorted];
         // We can link the chain of blocks for which we've received transactions at some point.
         // Pruned nodes may have deleted the block.
         if (pindex->nTx > 0) {
@@ -7422,10 +10201,45 @@ bool static LoadBlockIndexDB()
     pblocktree->ReadFlag("conversionindex", fConversionIndex);
     LogPrintf("%s: conversion index %s\n", __func__, fConversionIndex ? "enabled" : "disabled");
 
+    // databases created before the reserve transfer index are used without it until they are reindexed
+    pblocktree->ReadFlag("reservetransferindex", fReserveTransferIndex);
+    LogPrintf("%s: reserve transfer index %s\n", __func__, fReserveTransferIndex ? "enabled" : "disabled");
+    pblocktree->ReadFlag("identitystateindex", fIdentityStateIndex);
+    LogPrintf("%s: identity state index %s\n", __func__, fIdentityStateIndex ? "enabled" : "disabled");
+    if (fIdentityStateIndex)
+        CIdentity::LoadExistenceFilter();
+    pblocktree->ReadFlag("kvindex", fKVIndex);
+    LogPrintf("%s: key value index %s\n", __func__, fKVIndex ? "enabled" : "disabled");
+
     // Check whether we have an address index
     pblocktree->ReadFlag("addressindex", fAddressIndex);
     LogPrintf("%s: address index %s\n", __func__, fAddressIndex ? "enabled" : "disabled");
 
+    // address index keys are compact in new databases, and existing ones are converted when -compactaddressindex is set
+    bool fCompactAddressIndex = false, fAddressIndexMigration = false;
+    pblocktree->ReadFlag("compactaddressindex", fCompactAddressIndex);
+    if (!fCompactAddressIndex && fAddressIndex && mapArgs.count("-compactaddressindex") &&
+        GetBoolArg("-compactaddressindex", DEFAULT_COMPACT_ADDRESS_INDEX))
+    {
+        fCompactAddressIndex = true;
+        pblocktree->WriteFlag("compactaddressindex", true);
+        pblocktree->WriteFlag("addressindexmigration", true);
+    }
+    pblocktree->SetCompactAddressIndex(fCompactAddressIndex);
+    if (pblocktree->ReadFlag("addressindexmigration", fAddressIndexMigration) && fAddressIndexMigration)
+    {
+        uiInterface.InitMessage(_("Converting address index..."));
+        if (!pblocktree->MigrateAddressIndex())
+            return error("%s: failed to convert the address index", __func__);
+        if (!ShutdownRequested())
+            pblocktree->WriteFlag("addressindexmigration", false);
+    }
+    LogPrintf("%s: address index keys are %s\n", __func__, fCompactAddressIndex ? "compact" : "in the original format");
+
+    // balances are read from the full address history on databases created before the balance index
+    pblocktree->ReadFlag("addressbalanceindex", fAddressBalanceIndex);
+    LogPrintf("%s: address balance index %s\n", __func__, fAddressBalanceIndex ? "enabled" : "disabled");
+
     // Check whether we have a timestamp index
     pblocktree->ReadFlag("timestampindex", fTimestampIndex);
     LogPrintf("%s: timestamp index %s\n", __func__, fTimestampIndex ? "enabled" : "disabled");
@@ -7443,7 +10257,10 @@ bool static LoadBlockIndexDB()
         fAddressIndex = fInsightExplorer;
         fSpentIndex = fInsightExplorer;
     }
-    fTimestampIndex = fInsightExplorer;
+    fTimestampIndex = fTimestampIndex || fInsightExplorer;
+
+    // indexes enabled on an existing database may still be filled in by the background index builder
+    LoadIndexBuildState();
 
     // Fill in-memory data
     BOOST_FOREACH(const PAIRTYPE(uint256, CBlockIndex*)& item, mapBlockIndex)
@@ -7465,7 +10282,18 @@ bool static LoadBlockIndexDB()
     if (it == mapBlockIndex.end())
         return true;
 
-    chainActive.SetTip(it->second);
+    // reuse the chain MMR saved at the last shutdown where it still matches the chain
+    boost::filesystem::path mmrPath = GetDataDir() / CHAIN_MMR_FILENAME;
+    CAutoFile mmrFile(fopen(mmrPath.string().c_str(), "rb"), SER_DISK, CLIENT_VERSION);
+    if (!mmrFile.IsNull())
+    {
+        uint64_t nLoaded = chainActive.SetTipWithMMR(it->second, mmrFile);
+        LogPrintf("%s: loaded chain MMR for %lu of %lu blocks from %s\n", __func__, nLoaded, chainActive.size(), mmrPath.string());
+    }
+    else
+    {
+        chainActive.SetTip(it->second);
+    }
 
     // Set hashFinalSproutRoot for the end of best chain
     it->second->hashFinalSproutRoot = pcoinsTip->GetBestAnchor(SPROUT);
@@ -7664,9 +10492,9 @@ bool RewindBlockIndex(const CChainParams& chainparams, bool& clearWitnessCaches)
     }
 
     CValidationState state;
-    CBlockIndex* pindex = chainActive.Tip();
-    while (chainActive.Height() >= nHeight) {
-        if (fPruneMode && !(chainActive.Tip()->nStatus & BLOCK_HAVE_DATA)) {
+    CBlockIndex* pindexRewindTo = chainActive.Tip();
+    while (pindexRewindTo && pindexRewindTo->GetHeight() >= nHeight) {
+        if (fPruneMode && !(pindexRewindTo->nStatus & BLOCK_HAVE_DATA)) {
             // If pruning, don't try rewinding past the HAVE_DATA point;
             // since older blocks can't be served anyway, there's
             // no need to walk further, and trying to DisconnectTip()
@@ -7674,8 +10502,11 @@ bool RewindBlockIndex(const CChainParams& chainparams, bool& clearWitnessCaches)
             // of the blockchain).
             break;
         }
-        if (!DisconnectTip(state, chainparams, true)) {
-            return error("RewindBlockIndex: unable to disconnect block at height %i", pindex->GetHeight());
+        pindexRewindTo = pindexRewindTo->pprev;
+    }
+    if (pindexRewindTo != chainActive.Tip()) {
+        if (!DisconnectTips(state, chainparams, pindexRewindTo, true)) {
+            return error("RewindBlockIndex: unable to disconnect block at height %i", chainActive.Tip()->GetHeight());
         }
         // Occasionally flush state to disk.
         if (!FlushStateToDisk(state, FLUSH_STATE_PERIODIC))
@@ -7789,6 +10620,7 @@ void UnloadBlockIndex()
     LOCK(cs_main);
     setBlockIndexCandidates.clear();
     chainActive.SetTip(NULL);
+    ResetChainReadSnapshot();
     pindexBestInvalid = NULL;
     pindexBestHeader = NULL;
     mempool.clear();
@@ -7857,6 +10689,11 @@ bool InitBlockIndex(const CChainParams& chainparams)
     // Use the provided setting for -addressindex in the new database
     fAddressIndex = true;
     pblocktree->WriteFlag("addressindex", fAddressIndex);
+    bool fCompactAddressIndex = GetBoolArg("-compactaddressindex", DEFAULT_COMPACT_ADDRESS_INDEX);
+    pblocktree->WriteFlag("compactaddressindex", fCompactAddressIndex);
+    pblocktree->SetCompactAddressIndex(fCompactAddressIndex);
+    fAddressBalanceIndex = true;
+    pblocktree->WriteFlag("addressbalanceindex", fAddressBalanceIndex);
 
     // Use the provided setting for -timestampindex in the new database
     fTimestampIndex = GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX);
@@ -7864,6 +10701,14 @@ bool InitBlockIndex(const CChainParams& chainparams)
 
     fSpentIndex = true;
     pblocktree->WriteFlag("spentindex", fSpentIndex);
+
+    fReserveTransferIndex = true;
+    pblocktree->WriteFlag("reservetransferindex", fReserveTransferIndex);
+    fIdentityStateIndex = true;
+    pblocktree->WriteFlag("identitystateindex", fIdentityStateIndex);
+    CIdentity::LoadExistenceFilter();
+    fKVIndex = true;
+    pblocktree->WriteFlag("kvindex", fKVIndex);
     fprintf(stderr,"fAddressIndex.%d/%d fSpentIndex.%d/%d\n",fAddressIndex,DEFAULT_ADDRESSINDEX,fSpentIndex,DEFAULT_SPENTINDEX);
     LogPrintf("Initializing databases...\n");
 
@@ -7872,12 +10717,12 @@ bool InitBlockIndex(const CChainParams& chainparams)
         try {
             CBlock &block = const_cast<CBlock&>(chainparams.GenesisBlock());
             // Start new block file
-            unsigned int nBlockSize = ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
+            CDiskRecord blockRecord(block);
             CDiskBlockPos blockPos;
             CValidationState state;
-            if (!FindBlockPos(state, blockPos, nBlockSize+8, 0, block.GetBlockTime()))
+            if (!FindBlockPos(state, blockPos, blockRecord.size() + 8, 0, block.GetBlockTime()))
                 return error("LoadBlockIndex(): FindBlockPos failed");
-            if (!WriteBlockToDisk(block, blockPos, chainparams.MessageStart()))
+            if (!WriteBlockToDisk(blockRecord, blockPos, chainparams.MessageStart()))
                 return error("LoadBlockIndex(): writing genesis block to disk failed");
             CBlockIndex *pindex = AddToBlockIndex(block);
             if ( pindex == 0 )
@@ -7896,21 +10741,40 @@ bool InitBlockIndex(const CChainParams& chainparams)
     return true;
 }
 
-bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskBlockPos *dbp)
+/**
+ * Locates, deserializes and hashes the blocks of one block file ahead of the thread that connects them, so
+ * that disk reads and header hashing overlap with validation during -reindex and -loadblock. At most
+ * nMaxQueue blocks are held waiting at any time. With nMaxQueue == 0, blocks are read inline by Next().
+ */
+class CBlockFilePrefetcher
 {
-    // Map of disk positions for blocks with unknown parent (only used for reindex)
-    static std::multimap<uint256, CDiskBlockPos> mapBlocksUnknownParent;
-    int64_t nStart = GetTimeMillis();
+public:
+    struct CPrefetchedBlock
+    {
+        std::shared_ptr<CBlock> block;
+        uint256 hash;
+        uint64_t nPos;
+    };
 
-    int nLoaded = 0;
-    try {
-        // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
-        //CBufferedFile blkdat(fileIn, 2*MAX_BLOCK_SIZE, MAX_BLOCK_SIZE+8, SER_DISK, CLIENT_VERSION);
-        CBufferedFile blkdat(fileIn, 32*MAX_BLOCK_SIZE, MAX_BLOCK_SIZE+8, SER_DISK, CLIENT_VERSION);
-        uint64_t nRewind = blkdat.GetPos();
-        while (!blkdat.eof()) {
-            boost::this_thread::interruption_point();
+private:
+    const CChainParams &chainparams;
+    CBufferedFile blkdat;
+    uint64_t nRewind;
+    size_t nMaxQueue;
 
+    boost::mutex cs;
+    boost::condition_variable condAvailable;
+    boost::condition_variable condSpace;
+    std::deque<CPrefetchedBlock> queue;
+    bool fFinished;
+    bool fStop;
+    boost::thread readerThread;
+
+    // reads the next block in the file, returns false when there are no more blocks to read
+    bool ReadNext(CPrefetchedBlock &out)
+    {
+        while (!blkdat.eof())
+        {
             blkdat.SetPos(nRewind);
             nRewind++; // start one byte further next time, in case of failure
             blkdat.SetLimit(); // remove former limit
@@ -7925,25 +10789,152 @@ bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskB
                     continue;
                 // read size
                 blkdat >> nSize;
-                if (nSize < 80 || nSize > MAX_BLOCK_SIZE)
+                if ((nSize & ~BLOCKFILE_RECORD_COMPRESSED) < ((nSize & BLOCKFILE_RECORD_COMPRESSED) ? 4 : 80) ||
+                    (nSize & ~BLOCKFILE_RECORD_COMPRESSED) > MAX_BLOCK_SIZE)
                     continue;
             } catch (const std::exception&) {
                 // no valid block header found; don't complain
-                break;
+                return false;
             }
             try {
                 // read block
                 uint64_t nBlockPos = blkdat.GetPos();
+                std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+                if (nSize & BLOCKFILE_RECORD_COMPRESSED)
+                {
+                    std::vector<unsigned char> compressed(nSize & ~BLOCKFILE_RECORD_COMPRESSED);
+                    blkdat.read((char *)compressed.data(), compressed.size());
+                    *DecompressDiskRecord(compressed, MAX_BLOCK_SIZE) >> *pblock;
+                }
+                else
+                {
+                    blkdat.SetLimit(nBlockPos + nSize);
+                    blkdat.SetPos(nBlockPos);
+                    blkdat >> *pblock;
+                }
+                nRewind = blkdat.GetPos();
+
+                out.hash = pblock->GetHash();
+                out.nPos = nBlockPos;
+                out.block = pblock;
+                return true;
+            } catch (const std::exception& e) {
+                LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
+            }
+        }
+        return false;
+    }
+
+    void ThreadRead()
+    {
+        RenameThread("verus-loadblkrd");
+        try {
+            CPrefetchedBlock next;
+            while (ReadNext(next))
+            {
+                boost::unique_lock<boost::mutex> lock(cs);
+                while (!fStop && queue.size() >= nMaxQueue)
+                {
+                    condSpace.wait(lock);
+                }
+                if (fStop)
+                {
+                    break;
+                }
+                queue.push_back(next);
+                condAvailable.notify_one();
+            }
+        } catch (const boost::thread_interrupted&) {
+        } catch (const std::exception& e) {
+            LogPrintf("%s: Error reading block file - %s\n", __func__, e.what());
+        }
+        boost::unique_lock<boost::mutex> lock(cs);
+        fFinished = true;
+        condAvailable.notify_one();
+    }
+
+public:
+    // takes over fileIn, which is closed by the CBufferedFile destructor
+    CBlockFilePrefetcher(const CChainParams &params, FILE *fileIn, size_t maxQueue) :
+        chainparams(params),
+        blkdat(fileIn, 32*MAX_BLOCK_SIZE, MAX_BLOCK_SIZE+8, SER_DISK, CLIENT_VERSION),
+        nMaxQueue(maxQueue),
+        fFinished(false),
+        fStop(false)
+    {
+        nRewind = blkdat.GetPos();
+        if (nMaxQueue)
+        {
+            readerThread = boost::thread(boost::bind(&CBlockFilePrefetcher::ThreadRead, this));
+        }
+    }
+
+    ~CBlockFilePrefetcher()
+    {
+        if (readerThread.joinable())
+        {
+            {
+                boost::unique_lock<boost::mutex> lock(cs);
+                fStop = true;
+                condSpace.notify_all();
+            }
+            boost::this_thread::disable_interruption noInterrupt;
+            readerThread.join();
+        }
+    }
+
+    // returns the next block of the file in file order, or false when the file is exhausted
+    bool Next(CPrefetchedBlock &out)
+    {
+        if (!nMaxQueue)
+        {
+            return ReadNext(out);
+        }
+        boost::unique_lock<boost::mutex> lock(cs);
+        while (queue.empty() && !fFinished)
+        {
+            condAvailable.wait(lock);
+        }
+        if (queue.empty())
+        {
+            return false;
+        }
+        out = queue.front();
+        queue.pop_front();
+        condSpace.notify_one();
+        return true;
+    }
+};
+
+bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskBlockPos *dbp)
+{
+    // Map of disk positions for blocks with unknown parent (only used for reindex)
+    static std::multimap<uint256, CDiskBlockPos> mapBlocksUnknownParent;
+    int64_t nStart = GetTimeMillis();
+
+    int nPrefetch = std::max(0, std::min((int)GetArg("-reindexprefetch", DEFAULT_REINDEX_PREFETCH), MAX_REINDEX_PREFETCH));
+
+    // the file is read once from start to end, so the OS may read further ahead and drop what was read sooner
+    AdviseFileSequential(fileIn);
+
+    int nLoaded = 0;
+    try {
+        // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
+        CBlockFilePrefetcher prefetcher(chainparams, fileIn, nPrefetch);
+        CBlockFilePrefetcher::CPrefetchedBlock next;
+        while (true) {
+            boost::this_thread::interruption_point();
+
+            if (!prefetcher.Next(next))
+                break;
+
+            try {
                 if (dbp)
-                    dbp->nPos = nBlockPos;
-                blkdat.SetLimit(nBlockPos + nSize);
-                blkdat.SetPos(nBlockPos);
-                CBlock block;
-                blkdat >> block;
-                nRewind = blkdat.GetPos();
+                    dbp->nPos = next.nPos;
+                CBlock &block = *next.block;
 
                 // detect out of order blocks, and store them for later
-                uint256 hash = block.GetHash();
+                uint256 hash = next.hash;
                 if (hash != chainparams.GetConsensus().hashGenesisBlock && mapBlockIndex.find(block.hashPrevBlock) == mapBlockIndex.end()) {
                     LogPrint("reindex", "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
                              block.hashPrevBlock.ToString());
@@ -8314,9 +11305,9 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
             boost::this_thread::interruption_point();
             it++;
 
-            if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK)
+            if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK || inv.type == MSG_CMPCT_BLOCK)
             {
-                LogPrint("getdata", "%s: inv %s\n", __func__, inv.type == MSG_BLOCK ? "MSG_BLOCK" : "MSG_FILTERED_BLOCK");
+                LogPrint("getdata", "%s: inv %s\n", __func__, inv.type == MSG_BLOCK ? "MSG_BLOCK" : inv.type == MSG_CMPCT_BLOCK ? "MSG_CMPCT_BLOCK" : "MSG_FILTERED_BLOCK");
 
                 bool send = false;
                 BlockMap::iterator mi = mapBlockIndex.find(inv.hash);
@@ -8343,9 +11334,21 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                 {
                     LogPrint("getdata", "%s: is send\n", __func__);
 
+                    int nSendVersion = pfrom->GetSendVersion();
+                    bool fTip = mi->second == chainActive.Tip();
+                    bool fCompact = inv.type == MSG_CMPCT_BLOCK && mi->second->GetHeight() >= chainActive.Height() - MAX_CMPCTBLOCK_DEPTH;
+
                     // Send block from disk
                     CBlock block;
-                    if (!ReadBlockFromDisk(block, (*mi).second, consensusParams, 1))
+                    if (fTip && inv.type == MSG_BLOCK && tipBlockMessage.Matches(inv.hash, nSendVersion))
+                    {
+                        pfrom->PushSharedMessage("block", tipBlockMessage.msg);
+                    }
+                    else if (fTip && fCompact && tipCompactBlockMessage.Matches(inv.hash, nSendVersion))
+                    {
+                        pfrom->PushSharedMessage("cmpctblock", tipCompactBlockMessage.msg);
+                    }
+                    else if (!ReadBlockFromDisk(block, (*mi).second, consensusParams, 1))
                     {
                         assert(!"cannot load block from disk");
                     }
@@ -8358,7 +11361,39 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                             //for (z=31; z>=0; z--)
                             //    fprintf(stderr,"%02x",((uint8_t *)&hash)[z]);
                             //fprintf(stderr," send block %d\n",komodo_block2height(&block));
-                            pfrom->PushMessage("block", block);
+                            if (fTip)
+                            {
+                                tipBlockMessage.hash = inv.hash;
+                                tipBlockMessage.nVersion = nSendVersion;
+                                tipBlockMessage.msg = CNode::MakeSharedMessage("block", nSendVersion, block);
+                                pfrom->PushSharedMessage("block", tipBlockMessage.msg);
+                            }
+                            else
+                            {
+                                pfrom->PushMessage("block", block);
+                            }
+                        }
+                        else if (inv.type == MSG_CMPCT_BLOCK)
+                        {
+                            // a peer far behind gains nothing from its mempool, so deep blocks are sent in full
+                            if (fCompact && fTip)
+                            {
+                                if (!pMostRecentCompactBlock || pMostRecentCompactBlock->header.GetHash() != inv.hash)
+                                    pMostRecentCompactBlock = std::make_shared<const CBlockHeaderAndShortTxIDs>(block);
+                                tipCompactBlockMessage.hash = inv.hash;
+                                tipCompactBlockMessage.nVersion = nSendVersion;
+                                tipCompactBlockMessage.msg = CNode::MakeSharedMessage("cmpctblock", nSendVersion, *pMostRecentCompactBlock);
+                                pfrom->PushSharedMessage("cmpctblock", tipCompactBlockMessage.msg);
+                            }
+                            else if (fCompact)
+                            {
+                                CBlockHeaderAndShortTxIDs cmpctblock(block);
+                                pfrom->PushMessage("cmpctblock", cmpctblock);
+                            }
+                            else
+                            {
+                                pfrom->PushMessage("block", block);
+                            }
                         }
                         else // MSG_FILTERED_BLOCK)
                         {
@@ -8524,6 +11559,192 @@ void static ProcessOrphanTx(const CChainParams& chainparams, std::set<uint256>&
     }
 }
 
+/**
+ * Computes the hashes of a batch of received block headers, split across all cores. Each header is hashed
+ * independently, so this is safe to run without cs_main.
+ */
+static void GetBlockHeaderHashes(const std::vector<CBlockHeader> &headers, std::vector<uint256> &hashes)
+{
+    // below this many headers per thread, starting threads costs more than it saves
+    static const size_t MIN_HEADERS_PER_THREAD = 64;
+
+    hashes.resize(headers.size());
+
+    size_t nThreads = std::min((size_t)std::max(GetNumCores(), 1), headers.size() / MIN_HEADERS_PER_THREAD);
+    if (nThreads <= 1)
+    {
+        for (size_t i = 0; i < headers.size(); i++)
+        {
+            hashes[i] = headers[i].GetHash();
+        }
+        return;
+    }
+
+    size_t nPerThread = (headers.size() + nThreads - 1) / nThreads;
+    boost::thread_group hashThreads;
+    for (size_t t = 0; t < nThreads; t++)
+    {
+        size_t begin = t * nPerThread, end = std::min(begin + nPerThread, headers.size());
+        hashThreads.create_thread([&headers, &hashes, begin, end]()
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                hashes[i] = headers[i].GetHash();
+            }
+        });
+    }
+    hashThreads.join_all();
+}
+
+// processes a block from a peer, whether sent in full or rebuilt from a cmpctblock, and rejects it back to the peer if it
+// is invalid. a peer whose block becomes our tip is asked to send its next blocks as cmpctblock
+void static ProcessReceivedBlock(CNode* pfrom, const string& strCommand, CBlock& block, bool forceProcessing, const CChainParams& chainparams)
+{
+    uint256 hash = block.GetHash();
+    CValidationState state;
+    ProcessNewBlock(0, 0, state, chainparams, pfrom, &block, forceProcessing, NULL);
+    int nDoS;
+    if (state.IsInvalid(nDoS)) {
+        pfrom->PushMessage("reject", strCommand, state.GetRejectCode(),
+                           state.GetRejectReason().substr(0, MAX_REJECT_MESSAGE_LENGTH), hash);
+        if (nDoS > 0) {
+            LOCK(cs_main);
+            Misbehaving(pfrom->GetId(), nDoS);
+        }
+    }
+    else if (!IsInitialBlockDownload(chainparams))
+    {
+        LOCK(cs_main);
+        if (chainActive.Tip() && chainActive.Tip()->GetBlockHash() == hash)
+            MaybeSetPeerAsAnnouncingHeaderAndIDs(pfrom);
+    }
+}
+
+// finds the hashes of the blocks a BIP157 request covers, from the start height through its stop block. a request for
+// an unknown filter type or block, or over too many blocks, disconnects the peer as BIP157 specifies
+static bool GetCFRequestBlocks(CNode* pfrom, uint8_t filterType, uint32_t nStartHeight, const uint256 &stopHash, uint32_t nMaxBlocks,
+                               std::vector<uint256> &blockHashes)
+{
+    LOCK(cs_main);
+    BlockMap::iterator mi = mapBlockIndex.find(stopHash);
+    if (filterType != BLOCK_FILTER_BASIC || mi == mapBlockIndex.end() || !mi->second ||
+        nStartHeight > (uint32_t)mi->second->GetHeight() || mi->second->GetHeight() - nStartHeight >= nMaxBlocks)
+    {
+        LogPrint("net", "invalid compact filter request from peer=%d, disconnecting\n", pfrom->id);
+        pfrom->fDisconnect = true;
+        return false;
+    }
+    const CBlockIndex *pindexStop = mi->second;
+    blockHashes.resize(pindexStop->GetHeight() - nStartHeight + 1);
+    for (const CBlockIndex *pindex = pindexStop; pindex && pindex->GetHeight() >= (int)nStartHeight; pindex = pindex->pprev)
+    {
+        blockHashes[pindex->GetHeight() - nStartHeight] = pindex->GetBlockHash();
+    }
+    return true;
+}
+
+// reads the index entries of the blocks, without cs_main. blocks above the height a background build has reached
+// have no entries yet, and then the request goes unanswered
+static bool ReadCFEntries(CNode* pfrom, const std::vector<uint256> &blockHashes, std::vector<CBlockFilterIndexEntry> &entries)
+{
+    entries.resize(blockHashes.size());
+    for (size_t i = 0; i < blockHashes.size(); i++)
+    {
+        if (!GetBlockFilter(blockHashes[i], entries[i]))
+        {
+            LogPrint("net", "no compact filter for block %s requested by peer=%d\n", blockHashes[i].ToString(), pfrom->id);
+            return false;
+        }
+    }
+    return true;
+}
+
+void static ProcessGetCFilters(CNode* pfrom, CDataStream& vRecv)
+{
+    uint8_t filterType;
+    uint32_t nStartHeight;
+    uint256 stopHash;
+    vRecv >> filterType >> nStartHeight >> stopHash;
+
+    std::vector<uint256> blockHashes;
+    std::vector<CBlockFilterIndexEntry> entries;
+    if (!GetCFRequestBlocks(pfrom, filterType, nStartHeight, stopHash, MAX_GETCFILTERS_SIZE, blockHashes) ||
+        !ReadCFEntries(pfrom, blockHashes, entries))
+    {
+        return;
+    }
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        pfrom->PushMessage("cfilter", filterType, blockHashes[i], entries[i].filter);
+    }
+}
+
+void static ProcessGetCFHeaders(CNode* pfrom, CDataStream& vRecv)
+{
+    uint8_t filterType;
+    uint32_t nStartHeight;
+    uint256 stopHash;
+    vRecv >> filterType >> nStartHeight >> stopHash;
+
+    // the header before the range is sent with the filter hashes, so the block below the start is looked up as well
+    std::vector<uint256> blockHashes;
+    std::vector<CBlockFilterIndexEntry> entries;
+    uint32_t nFirstHeight = nStartHeight ? nStartHeight - 1 : 0;
+    if (!GetCFRequestBlocks(pfrom, filterType, nFirstHeight, stopHash, MAX_GETCFHEADERS_SIZE + (nStartHeight ? 1 : 0), blockHashes) ||
+        !ReadCFEntries(pfrom, blockHashes, entries))
+    {
+        return;
+    }
+    uint256 prevHeader;
+    if (nStartHeight)
+    {
+        prevHeader = entries.front().header;
+        entries.erase(entries.begin());
+    }
+    std::vector<uint256> filterHashes;
+    filterHashes.reserve(entries.size());
+    for (const CBlockFilterIndexEntry &entry : entries)
+    {
+        filterHashes.push_back(entry.filterHash);
+    }
+    pfrom->PushMessage("cfheaders", filterType, stopHash, prevHeader, filterHashes);
+}
+
+void static ProcessGetCFCheckpt(CNode* pfrom, CDataStream& vRecv)
+{
+    uint8_t filterType;
+    uint256 stopHash;
+    vRecv >> filterType >> stopHash;
+
+    std::vector<uint256> checkpointHashes;
+    {
+        LOCK(cs_main);
+        BlockMap::iterator mi = mapBlockIndex.find(stopHash);
+        if (filterType != BLOCK_FILTER_BASIC || mi == mapBlockIndex.end() || !mi->second)
+        {
+            LogPrint("net", "invalid compact filter checkpoint request from peer=%d, disconnecting\n", pfrom->id);
+            pfrom->fDisconnect = true;
+            return;
+        }
+        for (int height = CFCHECKPT_INTERVAL; height <= mi->second->GetHeight(); height += CFCHECKPT_INTERVAL)
+        {
+            checkpointHashes.push_back(mi->second->GetAncestor(height)->GetBlockHash());
+        }
+    }
+    std::vector<CBlockFilterIndexEntry> entries;
+    if (!ReadCFEntries(pfrom, checkpointHashes, entries))
+    {
+        return;
+    }
+    std::vector<uint256> headers;
+    headers.reserve(entries.size());
+    for (const CBlockFilterIndexEntry &entry : entries)
+    {
+        headers.push_back(entry.header);
+    }
+    pfrom->PushMessage("cfcheckpt", filterType, stopHash, headers);
+}
+
 bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv, int64_t nTimeReceived)
 {
     const CChainParams& chainparams = Params();
@@ -8716,6 +11937,99 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             LOCK(cs_main);
             State(pfrom->GetId())->fCurrentlyConnected = true;
         }
+
+        // tell the peer we can relay compact blocks, it is only asked to push them to us once it has given us a tip.
+        // older peers ignore the unknown message
+        pfrom->PushMessage("sendcmpct", false, COMPACT_BLOCKS_VERSION);
+
+        if (GetBoolArg("-txreconciliation", DEFAULT_TXRECONCILIATION))
+            pfrom->PushMessage("sendrecon", TXRECONCILIATION_VERSION, pfrom->nReconSalt);
+    }
+
+
+    else if (strCommand == "sendrecon")
+    {
+        uint32_t nReconVersion = 0;
+        uint64_t nPeerSalt = 0;
+        vRecv >> nReconVersion >> nPeerSalt;
+        if (nReconVersion == TXRECONCILIATION_VERSION && GetBoolArg("-txreconciliation", DEFAULT_TXRECONCILIATION)) {
+            LOCK(pfrom->cs_inventory);
+            if (!pfrom->fTxReconciliation) {
+                pfrom->SetReconciliationSalt(nPeerSalt);
+                LogPrint("net", "transaction reconciliation enabled with peer=%d\n", pfrom->id);
+            }
+        }
+    }
+
+
+    else if (strCommand == "reconcil")
+    {
+        // the short IDs of transactions the peer would otherwise have sent us in an inv, we answer with those we miss
+        std::vector<uint32_t> vShortIDs;
+        vRecv >> vShortIDs;
+        if (vShortIDs.size() > MAX_INV_SZ)
+        {
+            Misbehaving(pfrom->GetId(), 20);
+            return error("message reconcil size() = %u", vShortIDs.size());
+        }
+        if (!pfrom->fTxReconciliation || pfrom->fInbound)
+            return true;
+
+        std::vector<uint256> vMempoolHashes;
+        mempool.queryHashes(vMempoolHashes);
+        std::unordered_set<uint32_t> setHave;
+        setHave.reserve(vMempoolHashes.size());
+        for (const uint256 &hash : vMempoolHashes)
+            setHave.insert(pfrom->GetReconShortID(hash));
+
+        // a transaction whose short ID collides with one in our mempool is not asked for, and reaches us from another peer
+        std::vector<uint32_t> vWanted;
+        for (uint32_t shortID : vShortIDs) {
+            if (!setHave.count(shortID))
+                vWanted.push_back(shortID);
+        }
+        if (!vWanted.empty())
+            pfrom->PushMessage("reqrecon", vWanted);
+    }
+
+
+    else if (strCommand == "reqrecon")
+    {
+        std::vector<uint32_t> vWanted;
+        vRecv >> vWanted;
+        if (vWanted.size() > MAX_INV_SZ)
+        {
+            Misbehaving(pfrom->GetId(), 20);
+            return error("message reqrecon size() = %u", vWanted.size());
+        }
+        if (!pfrom->fTxReconciliation || !pfrom->fInbound)
+            return true;
+
+        {
+            LOCK(pfrom->cs_inventory);
+            for (uint32_t shortID : vWanted) {
+                std::map<uint32_t, uint256>::iterator it = pfrom->mapReconOffered.find(shortID);
+                if (it != pfrom->mapReconOffered.end()) {
+                    pfrom->vRecvGetData.push_back(CInv(MSG_TX, it->second));
+                    pfrom->mapReconOffered.erase(it);
+                }
+            }
+        }
+        // served as if the peer had sent a getdata for them
+        ProcessGetData(pfrom, chainparams.GetConsensus());
+    }
+
+
+    else if (strCommand == "sendcmpct")
+    {
+        bool fAnnounceUsingCMPCTBLOCK = false;
+        uint64_t nCMPCTBLOCKVersion = 0;
+        vRecv >> fAnnounceUsingCMPCTBLOCK >> nCMPCTBLOCKVersion;
+        if (nCMPCTBLOCKVersion == COMPACT_BLOCKS_VERSION) {
+            LOCK(cs_main);
+            State(pfrom->GetId())->fSupportsCompactBlocks = true;
+            State(pfrom->GetId())->fPreferHeaderAndIDs = fAnnounceUsingCMPCTBLOCK;
+        }
     }
 
 
@@ -9084,6 +12398,24 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
     }
 
 
+    // BIP157 compact block filters, served only when advertised with -peerblockfilters
+    else if (strCommand == "getcfilters" || strCommand == "getcfheaders" || strCommand == "getcfcheckpt")
+    {
+        if (!(nLocalServices & NODE_COMPACT_FILTERS))
+        {
+            LogPrint("net", "%s requested from peer=%d without -peerblockfilters, disconnecting\n", strCommand, pfrom->id);
+            pfrom->fDisconnect = true;
+            return true;
+        }
+        if (strCommand == "getcfilters")
+            ProcessGetCFilters(pfrom, vRecv);
+        else if (strCommand == "getcfheaders")
+            ProcessGetCFHeaders(pfrom, vRecv);
+        else
+            ProcessGetCFCheckpt(pfrom, vRecv);
+    }
+
+
     else if (strCommand == "tx" && !IsInitialBlockDownload(chainparams))
     {
         // Stop processing the transaction early if
@@ -9252,6 +12584,10 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             ReadCompactSize(vRecv); // ignore tx count; assume it is 0.
         }
 
+        // hash all headers in parallel before taking cs_main, the accepting loop below is then sequential
+        std::vector<uint256> headerHashes;
+        GetBlockHeaderHashes(headers, headerHashes);
+
         LOCK(cs_main);
 
         if (nCount == 0) {
@@ -9268,11 +12604,12 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         // (Allow disabling optimization in case there are unexpected problems.)
         bool hasNewHeaders = true;
         if (GetBoolArg("-optimize-getheaders", false) && IsInitialBlockDownload(chainparams)) {
-            hasNewHeaders = (mapBlockIndex.count(headers.back().GetHash()) == 0);
+            hasNewHeaders = (mapBlockIndex.count(headerHashes.back()) == 0);
         }
 
         CBlockIndex *pindexLast = NULL;
-        BOOST_FOREACH(const CBlockHeader& header, headers) {
+        for (unsigned int n = 0; n < nCount; n++) {
+            const CBlockHeader& header = headers[n];
             /*
             auto lastIndex = mapBlockIndex.find(header.hashPrevBlock);
             auto thisIndex = mapBlockIndex.find(header.GetHash());
@@ -9329,7 +12666,7 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
                 return error("non-continuous headers sequence");
             }
             int32_t futureblock;
-            if (!AcceptBlockHeader(&futureblock, header, state, chainparams, &pindexLast)) {
+            if (!AcceptBlockHeader(&futureblock, header, state, chainparams, &pindexLast, &headerHashes[n])) {
                 int nDoS;
                 if (state.IsInvalid(nDoS) && (futureblock == 0 || nDoS >= 100))
                 {
@@ -9370,22 +12707,179 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         CInv inv(MSG_BLOCK, block.GetHash());
         LogPrint("net", "received block %s peer=%d\n", inv.hash.ToString(), pfrom->id);
 
-        CValidationState state;
+        {
+            LOCK(cs_main);
+            UpdateBlockDownloadStats(pfrom->GetId(), inv.hash, ::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION));
+        }
+
         // Process all blocks from whitelisted peers, even if not requested,
         // unless we're still syncing with the network.
         // Such an unrequested block may still be processed, subject to the
         // conditions in AcceptBlock().
         bool forceProcessing = pfrom->fWhitelisted && !IsInitialBlockDownload(chainparams);
-        ProcessNewBlock(0, 0, state, chainparams, pfrom, &block, forceProcessing, NULL);
-        int nDoS;
-        if (state.IsInvalid(nDoS)) {
-            pfrom->PushMessage("reject", strCommand, state.GetRejectCode(),
-                               state.GetRejectReason().substr(0, MAX_REJECT_MESSAGE_LENGTH), inv.hash);
-            if (nDoS > 0) {
-                LOCK(cs_main);
-                Misbehaving(pfrom->GetId(), nDoS);
+        ProcessReceivedBlock(pfrom, strCommand, block, forceProcessing, chainparams);
+    }
+
+
+    else if (strCommand == "cmpctblock" && !fImporting && !fReindex) // Ignore blocks received while importing
+    {
+        CBlockHeaderAndShortTxIDs cmpctblock;
+        vRecv >> cmpctblock;
+
+        uint256 hash = cmpctblock.header.GetHash();
+        LogPrint("net", "received cmpctblock %s peer=%d\n", hash.ToString(), pfrom->id);
+
+        CBlock block;
+        bool fBlockReconstructed = false;
+        {
+            LOCK(cs_main);
+
+            if (mapBlockIndex.count(cmpctblock.header.hashPrevBlock) == 0) {
+                // the header cannot be checked without its parent, catch up on headers and let the normal download follow
+                if (!IsInitialBlockDownload(chainparams))
+                    pfrom->PushMessage("getheaders", chainActive.GetLocator(pindexBestHeader), uint256());
+                return true;
+            }
+
+            CBlockIndex *pindex = NULL;
+            CValidationState state;
+            int32_t futureblock = 0;
+            if (!AcceptBlockHeader(&futureblock, cmpctblock.header, state, chainparams, &pindex, &hash)) {
+                int nDoS;
+                if (state.IsInvalid(nDoS) && (futureblock == 0 || nDoS >= 100)) {
+                    Misbehaving(pfrom->GetId(), nDoS);
+                    return error("invalid header received in cmpctblock");
+                }
+                return true;
+            }
+            UpdateBlockAvailability(pfrom->GetId(), hash);
+
+            // only a block that would extend our tip is rebuilt, any other is left to the normal download once its header
+            // is known
+            if ((pindex->nStatus & BLOCK_HAVE_DATA) || pindex->pprev != chainActive.Tip() || IsInitialBlockDownload(chainparams))
+                return true;
+
+            map<uint256, pair<NodeId, list<QueuedBlock>::iterator> >::iterator itInFlight = mapBlocksInFlight.find(hash);
+            if (itInFlight != mapBlocksInFlight.end() && itInFlight->second.second->partialBlock) {
+                // already being completed, from this peer or another
+                return true;
+            }
+
+            std::shared_ptr<PartiallyDownloadedBlock> partialBlock = std::make_shared<PartiallyDownloadedBlock>(&mempool);
+            ReadStatus status = partialBlock->InitData(cmpctblock);
+            if (status == READ_STATUS_INVALID) {
+                Misbehaving(pfrom->GetId(), 100);
+                return error("invalid cmpctblock %s received from peer=%d", hash.ToString(), pfrom->id);
+            }
+            if (status == READ_STATUS_FAILED) {
+                vector<CInv> vInv(1, CInv(MSG_BLOCK, hash));
+                pfrom->PushMessage("getdata", vInv);
+                MarkBlockAsInFlight(pfrom->GetId(), hash, chainparams.GetConsensus(), pindex);
+                return true;
+            }
+
+            BlockTransactionsRequest req;
+            for (size_t i = 0; i < cmpctblock.BlockTxCount(); i++) {
+                if (!partialBlock->IsTxAvailable(i))
+                    req.indexes.push_back(i);
+            }
+
+            if (req.indexes.empty()) {
+                std::vector<CTransaction> vtxMissing;
+                status = partialBlock->FillBlock(block, vtxMissing);
+                if (status == READ_STATUS_OK) {
+                    fBlockReconstructed = true;
+                } else {
+                    vector<CInv> vInv(1, CInv(MSG_BLOCK, hash));
+                    pfrom->PushMessage("getdata", vInv);
+                    MarkBlockAsInFlight(pfrom->GetId(), hash, chainparams.GetConsensus(), pindex);
+                    return true;
+                }
+            } else {
+                req.blockhash = hash;
+                MarkBlockAsInFlight(pfrom->GetId(), hash, chainparams.GetConsensus(), pindex)->partialBlock = partialBlock;
+                pfrom->PushMessage("getblocktxn", req);
+            }
+        }
+
+        // a block that extends our tip is processed even when it was pushed to us unrequested
+        if (fBlockReconstructed)
+            ProcessReceivedBlock(pfrom, strCommand, block, true, chainparams);
+    }
+
+
+    else if (strCommand == "getblocktxn")
+    {
+        BlockTransactionsRequest req;
+        vRecv >> req;
+
+        LOCK(cs_main);
+
+        BlockMap::iterator mi = mapBlockIndex.find(req.blockhash);
+        if (mi == mapBlockIndex.end() || !(mi->second->nStatus & BLOCK_HAVE_DATA)) {
+            LogPrint("net", "peer=%d sent getblocktxn for block %s that we don't have\n", pfrom->id, req.blockhash.ToString());
+            return true;
+        }
+
+        if (mi->second->GetHeight() < chainActive.Height() - MAX_BLOCKTXN_DEPTH) {
+            // too deep to be a block the peer is completing, serve it in full like a getdata would
+            pfrom->vRecvGetData.push_back(CInv(MSG_BLOCK, req.blockhash));
+            ProcessGetData(pfrom, chainparams.GetConsensus());
+            return true;
+        }
+
+        CBlock block;
+        if (!ReadBlockFromDisk(block, mi->second, chainparams.GetConsensus(), 1))
+            return error("%s: cannot load block %s from disk", __func__, req.blockhash.ToString());
+
+        BlockTransactions resp(req);
+        for (size_t i = 0; i < req.indexes.size(); i++) {
+            if (req.indexes[i] >= block.vtx.size()) {
+                Misbehaving(pfrom->GetId(), 100);
+                return error("peer=%d sent us a getblocktxn with out-of-bounds tx indices", pfrom->id);
+            }
+            resp.txn[i] = block.vtx[req.indexes[i]];
+        }
+        pfrom->PushMessage("blocktxn", resp);
+    }
+
+
+    else if (strCommand == "blocktxn" && !fImporting && !fReindex) // Ignore blocks received while importing
+    {
+        BlockTransactions resp;
+        vRecv >> resp;
+
+        CBlock block;
+        bool fBlockRead = false;
+        {
+            LOCK(cs_main);
+
+            map<uint256, pair<NodeId, list<QueuedBlock>::iterator> >::iterator itInFlight = mapBlocksInFlight.find(resp.blockhash);
+            if (itInFlight == mapBlocksInFlight.end() || !itInFlight->second.second->partialBlock ||
+                itInFlight->second.first != pfrom->GetId()) {
+                LogPrint("net", "peer=%d sent us blocktxn for block %s we weren't expecting\n", pfrom->id, resp.blockhash.ToString());
+                return true;
+            }
+
+            std::shared_ptr<PartiallyDownloadedBlock> partialBlock = itInFlight->second.second->partialBlock;
+            ReadStatus status = partialBlock->FillBlock(block, resp.txn);
+            if (status == READ_STATUS_INVALID) {
+                MarkBlockAsReceived(resp.blockhash);
+                Misbehaving(pfrom->GetId(), 100);
+                return error("peer=%d sent us invalid compact block/non-matching block transactions", pfrom->id);
+            } else if (status == READ_STATUS_FAILED) {
+                // most likely a short ID collision with our mempool, the block stays in flight from this peer in full
+                itInFlight->second.second->partialBlock.reset();
+                vector<CInv> vInv(1, CInv(MSG_BLOCK, resp.blockhash));
+                pfrom->PushMessage("getdata", vInv);
+            } else {
+                UpdateBlockDownloadStats(pfrom->GetId(), resp.blockhash, ::GetSerializeSize(resp, SER_NETWORK, PROTOCOL_VERSION));
+                fBlockRead = true;
             }
         }
+
+        if (fBlockRead)
+            ProcessReceivedBlock(pfrom, strCommand, block, true, chainparams);
     }
 
     // This asymmetric behavior for inbound and outbound connections was introduced
@@ -9631,7 +13125,7 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
 }
 
 // requires LOCK(cs_vRecvMsg)
-bool ProcessMessages(CNode* pfrom)
+bool ProcessMessages(CNode* pfrom, MessageLane lane)
 {
     const CChainParams& chainparams = Params();
     //if (fDebug)
@@ -9647,12 +13141,15 @@ bool ProcessMessages(CNode* pfrom)
     //
     bool fOk = true;
 
-    if (!pfrom->vRecvGetData.empty())
-        ProcessGetData(pfrom, chainparams.GetConsensus());
+    if (lane == MSG_LANE_GENERAL)
+    {
+        if (!pfrom->vRecvGetData.empty())
+            ProcessGetData(pfrom, chainparams.GetConsensus());
 
-    if (!pfrom->orphan_work_set.empty()) {
-        LOCK(cs_main);
-        ProcessOrphanTx(chainparams, pfrom->orphan_work_set);
+        if (!pfrom->orphan_work_set.empty()) {
+            LOCK(cs_main);
+            ProcessOrphanTx(chainparams, pfrom->orphan_work_set);
+        }
     }
 
     // this maintains the order of responses
@@ -9677,6 +13174,10 @@ bool ProcessMessages(CNode* pfrom)
         if (!msg.complete())
             break;
 
+        // a message of the other lane is left to its thread, and the messages after it wait for it
+        if (GetMessageLane(msg.hdr.GetCommand()) != lane)
+            break;
+
         // at this point, any failure means we can delete the current message
         it++;
 
@@ -9718,6 +13219,7 @@ bool ProcessMessages(CNode* pfrom)
         {
             //printf("processing message: %s, from %s\n", strCommand.c_str(), pfrom->addr.ToString().c_str());
             std::vector<unsigned char> storedMessage(vRecv.begin(), vRecv.end());
+            TRACE4(net, inbound_message, pfrom->id, pfrom->addrName.c_str(), strCommand.c_str(), nMessageSize);
             fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime);
             //if (!fRet)
             //{
@@ -9917,6 +13419,28 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
             }
             vInv.reserve(std::max<size_t>(pto->vInventoryBlockToSend.size(), INVENTORY_BROADCAST_MAX));
 
+            // a new tip is pushed as cmpctblock to peers that asked for it, everything else is announced with inv
+            if (state.fPreferHeaderAndIDs && pto->vInventoryBlockToSend.size() == 1 &&
+                chainActive.Tip() && pto->vInventoryBlockToSend.back() == chainActive.Tip()->GetBlockHash()) {
+                if (!pMostRecentCompactBlock || pMostRecentCompactBlock->header.GetHash() != chainActive.Tip()->GetBlockHash()) {
+                    CBlock block;
+                    if (ReadBlockFromDisk(block, chainActive.Tip(), consensusParams, 1))
+                        pMostRecentCompactBlock = std::make_shared<const CBlockHeaderAndShortTxIDs>(block);
+                }
+                if (pMostRecentCompactBlock && pMostRecentCompactBlock->header.GetHash() == chainActive.Tip()->GetBlockHash()) {
+                    // every announcing peer gets the same bytes, so the message is serialized once per tip
+                    const uint256 &hashTip = chainActive.Tip()->GetBlockHash();
+                    int nSendVersion = pto->GetSendVersion();
+                    if (!tipCompactBlockMessage.Matches(hashTip, nSendVersion)) {
+                        tipCompactBlockMessage.hash = hashTip;
+                        tipCompactBlockMessage.nVersion = nSendVersion;
+                        tipCompactBlockMessage.msg = CNode::MakeSharedMessage("cmpctblock", nSendVersion, *pMostRecentCompactBlock);
+                    }
+                    pto->PushSharedMessage("cmpctblock", tipCompactBlockMessage.msg);
+                    pto->vInventoryBlockToSend.clear();
+                }
+            }
+
             // Add blocks
             for (const uint256& hash : pto->vInventoryBlockToSend) {
                 vInv.push_back(CInv(MSG_BLOCK, hash));
@@ -9958,6 +13482,10 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
                 // No reason to drain out at many times the network's capacity,
                 // especially since we have many peers and some will draw much shorter delays.
                 unsigned int nRelayedTransactions = 0;
+                // inbound peers that reconcile get short IDs instead of inv, outbound peers are still flooded so that
+                // transactions keep propagating as fast as before
+                bool fReconcile = pto->fTxReconciliation && pto->fInbound;
+                std::vector<uint32_t> vReconShortIDs;
                 LOCK(pto->cs_filter);
                 while (!vInvTx.empty() && nRelayedTransactions < INVENTORY_BROADCAST_MAX) {
                     // Fetch the top element from the heap
@@ -9982,7 +13510,15 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
                     if (pto->pfilter && !pto->pfilter->IsRelevantAndUpdate(txForInv)) continue;
 
                     // Send
-                    vInv.push_back(inv);
+                    if (fReconcile) {
+                        if (vReconShortIDs.empty())
+                            pto->mapReconOffered.clear();
+                        uint32_t shortID = pto->GetReconShortID(hash);
+                        pto->mapReconOffered[shortID] = hash;
+                        vReconShortIDs.push_back(shortID);
+                    } else {
+                        vInv.push_back(inv);
+                    }
                     nRelayedTransactions++;
                     {
                         // Expire old relay messages
@@ -10003,6 +13539,8 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
                     }
                     pto->AddKnownTxId(hash);
                 }
+                if (!vReconShortIDs.empty())
+                    pto->PushMessage("reconcil", vReconShortIDs);
             }
         }
         if (!vInv.empty())
@@ -10046,16 +13584,38 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
         // Message: getdata (blocks)
         //
         vector<CInv> vGetData;
-        if (!pto->fDisconnect && !pto->fClient && (fFetch || !IsInitialBlockDownload(Params())) && state.nBlocksInFlight < MAX_BLOCKS_IN_TRANSIT_PER_PEER) {
+        int nBlocksInTransitLimit = GetBlocksInTransitLimit(&state);
+        if (!pto->fDisconnect && !pto->fClient && (fFetch || !IsInitialBlockDownload(Params())) && state.nBlocksInFlight < nBlocksInTransitLimit) {
             vector<CBlockIndex*> vToDownload;
             NodeId staller = -1;
-            FindNextBlocksToDownload(pto->GetId(), MAX_BLOCKS_IN_TRANSIT_PER_PEER - state.nBlocksInFlight, vToDownload, staller);
+            CBlockIndex *pindexStalled = NULL;
+            FindNextBlocksToDownload(pto->GetId(), nBlocksInTransitLimit - state.nBlocksInFlight, vToDownload, staller, pindexStalled);
             for (CBlockIndex *pindex : vToDownload) {
-                vGetData.push_back(CInv(MSG_BLOCK, pindex->GetBlockHash()));
+                // the next block on our tip is most likely made of transactions we already have
+                bool fCompact = state.fSupportsCompactBlocks && pindex->pprev == chainActive.Tip() && !IsInitialBlockDownload(Params());
+                vGetData.push_back(CInv(fCompact ? MSG_CMPCT_BLOCK : MSG_BLOCK, pindex->GetBlockHash()));
                 MarkBlockAsInFlight(pto->GetId(), pindex->GetBlockHash(), Params().GetConsensus(), pindex);
                 LogPrint("net", "Requesting block %s (%d) peer=%d\n", pindex->GetBlockHash().ToString(),
                     pindex->GetHeight(), pto->id);
             }
+            if (staller != -1 && pindexStalled != NULL && vToDownload.empty()) {
+                // the window can't move until the staller delivers this block. once it is well past the staller's usual
+                // response time, ask this peer for it instead, which also clears the staller's stall before it is dropped
+                CNodeState *stallerState = State(staller);
+                map<uint256, pair<NodeId, list<QueuedBlock>::iterator> >::iterator itInFlight = mapBlocksInFlight.find(pindexStalled->GetBlockHash());
+                int64_t nReassignAfter = stallerState->nBlocksDownloaded ?
+                    std::max<int64_t>(4 * stallerState->nBlockResponseTime, 500000) : 1000000 * BLOCK_STALLING_TIMEOUT;
+                if (itInFlight != mapBlocksInFlight.end() && itInFlight->second.first == staller &&
+                    std::max(itInFlight->second.second->nTime, stallerState->nLastBlockReceived) < nNow - nReassignAfter &&
+                    (state.nBlocksDownloaded == 0 || stallerState->nBlocksDownloaded == 0 ||
+                     state.nBlockResponseTime < stallerState->nBlockResponseTime)) {
+                    LogPrint("net", "Reassigning stalled block %s (%d) from peer=%d to peer=%d\n", pindexStalled->GetBlockHash().ToString(),
+                        pindexStalled->GetHeight(), staller, pto->id);
+                    vGetData.push_back(CInv(MSG_BLOCK, pindexStalled->GetBlockHash()));
+                    MarkBlockAsInFlight(pto->GetId(), pindexStalled->GetBlockHash(), Params().GetConsensus(), pindexStalled);
+                    staller = -1;
+                }
+            }
             if (state.nBlocksInFlight == 0 && staller != -1) {
                 if (State(staller)->nStallingSince == 0) {
                     State(staller)->nStallingSince = nNow;
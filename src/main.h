@@ -32,10 +32,14 @@
 #include "cheatcatcher.h"
 #include "addressindex.h"
 #include "timestampindex.h"
+#include "blockdeltaindex.h"
+#include "blockfilter.h"
+#include "prunedproofs.h"
 
 #include <algorithm>
 #include <exception>
 #include <map>
+#include <memory>
 #include <set>
 #include <stdint.h>
 #include <string>
@@ -49,11 +53,13 @@ class CBlockTreeDB;
 class CBloomFilter;
 class CChainParams;
 class CInv;
+class CEvalBlockContext;
 class CScriptCheck;
 class CValidationInterface;
 class CValidationState;
 class PrecomputedTransactionData;
 
+struct CBlockStats;
 struct CNodeStateStats;
 #define DEFAULT_MEMPOOL_EXPIRY 1
 #define _COINBASE_MATURITY 100
@@ -96,8 +102,32 @@ static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
 static const int MAX_SCRIPTCHECK_THREADS = 16;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
-/** Number of blocks that can be requested at any given time from a single peer. */
+/** -reindexprefetch default (number of blocks read and deserialized ahead of the block being connected) */
+static const int DEFAULT_REINDEX_PREFETCH = 16;
+/** Maximum number of blocks read ahead when importing or reindexing */
+static const int MAX_REINDEX_PREFETCH = 256;
+/** Bytes hinted to the OS for the last block of a file hinted by PrefetchBlockData, and for the header before each */
+static const int64_t BLOCK_PREFETCH_BYTES = 256 * 1024;
+static const int64_t BLOCK_PREFETCH_HEADER_BYTES = 8;
+/** -inputprefetchthreads default (number of threads reading the coins spent by a block before it is connected) */
+static const int DEFAULT_INPUT_PREFETCH_THREADS = 4;
+/** Maximum number of threads reading coins ahead of ConnectBlock */
+static const int MAX_INPUT_PREFETCH_THREADS = 32;
+/** File in the data directory holding the chain MMR saved at shutdown */
+static const char * const CHAIN_MMR_FILENAME = "chainmmr.dat";
+/** Default for -compressblocks, compressing the records written to blk?????.dat and rev?????.dat files */
+static const bool DEFAULT_COMPRESS_BLOCK_FILES = false;
+/** Set in the size of a block or undo file record that is stored compressed */
+static const unsigned int BLOCKFILE_RECORD_COMPRESSED = 0x80000000;
+/** Default for -backgroundflush, writing flushed coins on a background thread */
+static const bool DEFAULT_BACKGROUND_FLUSH = false;
+/** Number of blocks that can be requested at any given time from a peer we have not yet measured. */
 static const int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 16;
+/** Bounds of the number of blocks in flight from a peer once its block response time has been measured. */
+static const int MIN_BLOCKS_IN_TRANSIT_PER_PEER = 2;
+static const int MAX_ADAPTIVE_BLOCKS_IN_TRANSIT_PER_PEER = 64;
+/** Microseconds of block deliveries we keep queued at each peer, at its measured response time. */
+static const int64_t BLOCK_DOWNLOAD_QUEUE_TARGET = 4 * 1000000;
 /** Timeout in seconds during which a peer must stall block download progress before being disconnected. */
 static const unsigned int BLOCK_STALLING_TIMEOUT = 2;
 /** Number of headers sent in one getheaders result. We rely on the assumption that if a peer sends
@@ -129,12 +159,23 @@ static const unsigned int INVENTORY_BROADCAST_INTERVAL = 5;
 /** Maximum number of inventory items to send per transmission.
  *  Limits the impact of low-fee transaction floods. */
 static const unsigned int INVENTORY_BROADCAST_MAX = 7 * INVENTORY_BROADCAST_INTERVAL;
+/** Default for -txreconciliation, offering transactions to inbound peers by short ID instead of by inv */
+static const bool DEFAULT_TXRECONCILIATION = false;
+/** Version of the reconciliation messages, sent in sendrecon */
+static const uint32_t TXRECONCILIATION_VERSION = 1;
+/** Default for -persistmempool, which saves the mempool on shutdown and reloads it at startup */
+static const bool DEFAULT_PERSIST_MEMPOOL = true;
 
 //static const bool DEFAULT_ADDRESSINDEX = false;
 //static const bool DEFAULT_SPENTINDEX = false;
 #define DEFAULT_ADDRESSINDEX (GetArg("-ac_cc",0) != 0 || GetArg("-ac_ccactivate",0) != 0)
 #define DEFAULT_SPENTINDEX (GetArg("-ac_cc",0) != 0 || GetArg("-ac_ccactivate",0) != 0)
 static const bool DEFAULT_TIMESTAMPINDEX = false;
+static const bool DEFAULT_BLOCKDELTAINDEX = true;
+static const bool DEFAULT_BLOCKFILTERINDEX = false;
+static const bool DEFAULT_BLOCKSTATSINDEX = false;
+static const bool DEFAULT_PEERBLOCKFILTERS = false;
+static const bool DEFAULT_COMPACT_ADDRESS_INDEX = true;
 static const unsigned int DEFAULT_DB_MAX_OPEN_FILES = 1000;
 static const bool DEFAULT_DB_COMPRESSION = true;
 
@@ -157,6 +198,8 @@ extern CCriticalSection cs_main;
 extern CTxMemPool mempool;
 typedef boost::unordered_map<uint256, CBlockIndex*, BlockHasher> BlockMap;
 extern BlockMap mapBlockIndex;
+/** Approximate heap bytes of mapBlockIndex and the block index entries, with their solutions. Requires cs_main. */
+size_t GetBlockIndexMemoryUsage();
 extern uint64_t nLastBlockTx;
 extern uint64_t nLastBlockSize;
 extern const std::string verusDataSignaturePrefix;
@@ -171,6 +214,18 @@ extern bool fTxIndex;
 extern bool fIdIndex;
 extern bool fConversionIndex;
 
+// index reserve transfers by the currency they are imported into, in the block tree database and mempool
+extern bool fReserveTransferIndex;
+
+// index every confirmed state of each identity by identity ID and height, in the block tree database
+extern bool fIdentityStateIndex;
+
+// index key value updates by the hash of their key and height, in the block tree database, in place of the komodo_kv map
+extern bool fKVIndex;
+
+// keep a running native and reserve currency balance for each address, in the block tree database
+extern bool fAddressBalanceIndex;
+
 // START insightexplorer
 extern bool fInsightExplorer;
 
@@ -187,11 +242,57 @@ extern bool fSpentIndex;
 // Maintain a full timestamp index, used to query for blocks within a time range
 extern bool fTimestampIndex;
 
+// Store a summary of the address deltas of each connected block, used to answer getblockdeltas
+extern bool fBlockDeltaIndex;
+
 // END insightexplorer
 
+// Maintain the BIP158 compact filter of each connected block, served to light clients over P2P and RPC
+extern bool fBlockFilterIndex;
+
+// Store the transaction, fee, PBaaS and shielded statistics of each connected block, used to answer getblockstats
+extern bool fBlockStatsIndex;
+
+/** Indexes that can be enabled on an existing database and are then filled in by a background thread, instead of
+    requiring -reindex. While one is building, blocks above its build height are left to the builder. */
+enum BackgroundIndex
+{
+    BACKGROUND_INDEX_TIMESTAMP = 0,
+    BACKGROUND_INDEX_ADDRESSBALANCE = 1,
+    BACKGROUND_INDEX_BLOCKFILTER = 2,
+    BACKGROUND_INDEX_COUNT = 3
+};
+
+//! -backgroundindex default
+static const bool DEFAULT_BACKGROUND_INDEX = true;
+
+const char *BackgroundIndexName(BackgroundIndex index);
+/** Mark an index to be built in the background, called for an existing database before its block index is loaded */
+bool StartIndexBuild(BackgroundIndex index);
+/** Whether the background index builder is still filling in the index */
+bool IsIndexBuilding(BackgroundIndex index);
+/** Whether the index includes the active chain block at this height, while a background build may still be running */
+bool IndexCoversHeight(BackgroundIndex index, int height);
+/** Enabled state and build progress of each background index */
+UniValue GetIndexBuildStatus();
+/** Run the background index builder */
+void ThreadBuildIndexes();
+
 extern bool fIsBareMultisigStd;
 extern bool fCheckBlockIndex;
 extern bool fCheckpointsEnabled;
+/** Whether new block and undo file records are written compressed (-compressblocks) */
+extern bool fCompressBlockFiles;
+/** Block hash whose ancestors we will assume to have valid scripts, signatures and proofs (-assumevalid) */
+extern uint256 hashAssumeValid;
+/** Number of blocks connected since startup with script, signature and proof checks skipped by -assumevalid or -assumenotarized */
+extern uint64_t nAssumeValidSkipped;
+/** Height, block hash and chain MMR root of a notarization of this chain confirmed on its root chain (-assumenotarized) */
+extern int nAssumeNotarizedHeight;
+extern uint256 hashAssumeNotarizedBlock;
+extern uint256 hashAssumeNotarizedMMRRoot;
+/** The -assumenotarized block, once our headers up to it match its chain MMR root, or NULL */
+const CBlockIndex *GetAssumeNotarizedAnchor();
 // TODO: remove this flag by structuring our code such that
 // it is unneeded for testing
 extern bool fCoinbaseEnforcedProtectionEnabled;
@@ -211,6 +312,9 @@ static const uint64_t nMinDiskSpace = 52428800;
 extern bool fHavePruned;
 /** True if we're running in -prune mode. */
 extern bool fPruneMode;
+/** True if pruned blocks keep the proof material of their PBaaS transactions, with -pruneproofs. */
+extern bool fPruneProofs;
+static const bool DEFAULT_PRUNE_PROOFS = true;
 /** Number of MiB of block files that we're trying to stay below. */
 extern uint64_t nPruneTarget;
 /** Block files containing a block-height within MIN_BLOCKS_TO_KEEP of chainActive.Tip() will not be pruned. */
@@ -250,6 +354,18 @@ bool CheckDiskSpace(uint64_t nAdditionalBytes = 0);
 FILE* OpenBlockFile(const CDiskBlockPos &pos, bool fReadOnly = false);
 /** Open an undo file (rev?????.dat) */
 FILE* OpenUndoFile(const CDiskBlockPos &pos, bool fReadOnly = false);
+/**
+ * Asks the OS to start reading the blocks, and their undo data if fUndo, into its cache before a batch of them is read
+ * on several threads, so the reads overlap on the disk instead of each waiting its turn. A hint only, where a block
+ * is larger than the range hinted for it or the OS takes no hints, the rest is read as it would be without it.
+ */
+void PrefetchBlockData(const std::vector<const CBlockIndex *> &indexes, bool fUndo);
+/**
+ * Reads the size of the block or undo file record that file is positioned at. If the record is stored compressed,
+ * returns a stream of its decompressed data, leaving file after the record, otherwise returns null and leaves file
+ * at the record, so either format can be read.
+ */
+std::unique_ptr<CDataStream> ReadCompressedDiskRecord(CAutoFile &file);
 /** Translation to a filesystem path */
 boost::filesystem::path GetBlockPosFilename(const CDiskBlockPos &pos, const char *prefix);
 /** Import blocks from an external file */
@@ -260,8 +376,8 @@ bool InitBlockIndex(const CChainParams& chainparams);
 bool LoadBlockIndex();
 /** Unload database information */
 void UnloadBlockIndex();
-/** Process protocol messages received from a given node */
-bool ProcessMessages(CNode* pfrom);
+/** Process protocol messages received from a given node that belong to the given message handler lane */
+bool ProcessMessages(CNode* pfrom, MessageLane lane);
 /**
  * Send queued protocol messages to be sent to a give node.
  *
@@ -284,6 +400,25 @@ std::string GetWarnings(const std::string& strFor);
 /** Retrieve a transaction (from memory pool, or from disk, if possible) */
 bool GetTransaction(const uint256 &hash, CTransaction &tx, const Consensus::Params& params, uint256 &hashBlock, bool fAllowSlow = false);
 bool GetTransaction(const uint256 &hash, CTransaction &tx, uint256 &hashBlock, bool fAllowSlow = false);
+/**
+ * Retrieve a serialized transaction like GetTransaction. One in the block files whose tx index entry has its size is
+ * copied from there without being deserialized. The block file is read without cs_main
+ */
+bool GetRawTransaction(const uint256 &hash, std::vector<unsigned char> &rawTx, uint256 &hashBlock, bool fAllowSlow = false);
+/** Number of confirmed transactions read from disk by GetTransaction and myGetTransaction that are kept in memory */
+static const int DEFAULT_TX_CACHE_SIZE = 5000;
+/** Resize the cache of confirmed transactions, 0 disables it */
+void SetTransactionCacheSize(int nEntries);
+struct CTransactionCacheStats
+{
+    uint64_t nEntries;
+    int nCapacity;
+    uint64_t nHits;
+    uint64_t nMisses;
+    uint64_t nEvictions;
+    size_t nMemoryUsage;
+};
+CTransactionCacheStats GetTransactionCacheStats();
 /** Find the best known block, and make it the tip of the block chain */
 bool ActivateBestChain(CValidationState& state, const CChainParams& chainparams, const CBlock* pblock = NULL);
 CAmount GetBlockSubsidy(int nHeight, const Consensus::Params& consensusParams);
@@ -318,6 +453,8 @@ bool GetNodeStateStats(NodeId nodeid, CNodeStateStats &stats);
 void Misbehaving(NodeId nodeid, int howmuch);
 /** Flush all state, indexes and buffers to disk. */
 void FlushStateToDisk();
+/** Save the upper layers of the active chain's MMR, so that the next start does not recompute them */
+bool WriteChainMMR();
 /** Prune block files and flush state to disk. */
 void PruneAndFlush();
 
@@ -326,7 +463,19 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransa
                         bool* pfMissingInputs, bool fRejectAbsurdFee=false, int dosLevel=-1);
 bool AcceptToMemoryPoolInt(CTxMemPool& pool, CValidationState &state, const CTransaction &tx, bool fLimitFree, bool fLimitDust,
                            bool* pfMissingInputs, bool fRejectAbsurdFee=false, int dosLevel=-1, int32_t simHeight = 0,
-                           int expireThreshold=TX_EXPIRING_SOON_THRESHOLD);
+                           int expireThreshold=TX_EXPIRING_SOON_THRESHOLD, bool fContextFreeChecked=false,
+                           int64_t nAcceptTime=0);
+/** Add many transactions to the memory pool. Their context free checks, proofs and plain signatures are verified in
+    parallel without holding cs_main, then each is accepted in order under a short lock, so later transactions
+    may spend earlier ones. Call without cs_main held. Returns the number accepted **/
+size_t AcceptToMemoryPoolBatch(CTxMemPool& pool, const std::vector<CTransaction> &txs, std::vector<CValidationState> &states,
+                               std::vector<unsigned char> &accepted, std::vector<unsigned char> &missingInputs,
+                               bool fLimitFree, bool fLimitDust, const std::vector<unsigned char> &rejectAbsurdFee,
+                               const std::vector<int64_t> &acceptTimes=std::vector<int64_t>());
+/** Write the mempool and its prioritisations to mempool.dat, so they survive a restart **/
+bool DumpMempool();
+/** Reload and revalidate the transactions of mempool.dat, keeping the times they first entered the mempool **/
+bool LoadMempool();
 
 
 struct CNodeStateStats {
@@ -334,6 +483,10 @@ struct CNodeStateStats {
     int nSyncHeight;
     int nCommonHeight;
     std::vector<int> vHeightInFlight;
+    int nBlocksInTransitLimit;
+    int nBlocksDownloaded;
+    int64_t nBlockResponseTime;
+    double dBlockBytesPerSec;
 };
 
 CAmount GetMinRelayFee(const CTransaction& tx, unsigned int nBytes, bool fAllowFree);
@@ -458,12 +611,20 @@ private:
     ScriptError error;
     PrecomputedTransactionData *txdata;
     std::map<uint160, std::pair<int, std::vector<std::vector<unsigned char>>>> idMap;
+    const CEvalBlockContext *pBlockContext;
+    bool fSaplingCheck;                 // checks the Sapling proofs and signatures of ptxTo instead of an input
+    uint256 saplingSigHash;
 
 public:
-    CScriptCheck(): amount(0), ptxTo(0), nIn(0), nFlags(0), cacheStore(false), consensusBranchId(0), error(SCRIPT_ERR_UNKNOWN_ERROR) {}
+    CScriptCheck(): amount(0), ptxTo(0), nIn(0), nFlags(0), cacheStore(false), consensusBranchId(0), error(SCRIPT_ERR_UNKNOWN_ERROR), pBlockContext(nullptr), fSaplingCheck(false) {}
     CScriptCheck(const CCoins& txFromIn, const CTransaction& txToIn, unsigned int nInIn, unsigned int nFlagsIn, bool cacheIn, uint32_t consensusBranchIdIn, PrecomputedTransactionData* txdataIn) :
         scriptPubKey(CCoinsViewCache::GetSpendFor(&txFromIn, txToIn.vin[nInIn])), amount(txFromIn.vout[txToIn.vin[nInIn].prevout.n].nValue),
-        ptxTo(&txToIn), nIn(nInIn), nFlags(nFlagsIn), cacheStore(cacheIn), consensusBranchId(consensusBranchIdIn), error(SCRIPT_ERR_UNKNOWN_ERROR), txdata(txdataIn) { }
+        ptxTo(&txToIn), nIn(nInIn), nFlags(nFlagsIn), cacheStore(cacheIn), consensusBranchId(consensusBranchIdIn), error(SCRIPT_ERR_UNKNOWN_ERROR), txdata(txdataIn), pBlockContext(nullptr),
+        fSaplingCheck(false) { }
+    // a check of the Sapling spends, outputs and binding signature of a transaction, which records them in the Sapling proof cache
+    CScriptCheck(const CTransaction& txToIn, const uint256 &saplingSigHashIn) :
+        amount(0), ptxTo(&txToIn), nIn(0), nFlags(0), cacheStore(true), consensusBranchId(0), error(SCRIPT_ERR_UNKNOWN_ERROR), txdata(nullptr), pBlockContext(nullptr),
+        fSaplingCheck(true), saplingSigHash(saplingSigHashIn) { }
 
     bool operator()();
 
@@ -478,23 +639,66 @@ public:
         std::swap(error, check.error);
         std::swap(txdata, check.txdata);
         std::swap(idMap, check.idMap);
+        std::swap(pBlockContext, check.pBlockContext);
+        std::swap(fSaplingCheck, check.fSaplingCheck);
+        std::swap(saplingSigHash, check.saplingSigHash);
     }
 
     void SetIDMap(const std::map<uint160, std::pair<int, std::vector<std::vector<unsigned char>>>> &map) { idMap = map; }
+    void SetBlockContext(const CEvalBlockContext *pBlockContextIn) { pBlockContext = pBlockContextIn; }
 
     ScriptError GetScriptError() const { return error; }
 };
 
+/** The index scans and transaction disk reads of one thread, which the RPC server diffs around each call */
+struct CThreadReadStats
+{
+    uint64_t nIndexScans = 0;
+    uint64_t nIndexRows = 0;            // entries returned by the scans
+    int64_t nIndexScanMicros = 0;
+    uint64_t nTxReads = 0;              // GetTransaction calls that went to disk
+    int64_t nTxReadMicros = 0;
+};
+const CThreadReadStats &GetThreadReadStats();
+
 bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes);
 bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
-bool GetAddressIndex(const uint160& addressHash, int type, std::vector<CAddressIndexDbEntry> &addressIndex, int start = 0, int end = 0);
-bool GetAddressUnspent(const uint160& addressHash, int type, std::vector<CAddressUnspentDbEntry>& unspentOutputs);
+// look up many spent index entries at once, the mempool first. found[i] tells whether values[i] was filled in
+size_t GetSpentIndex(const std::vector<CSpentIndexKey> &keys, std::vector<CSpentIndexValue> &values, std::vector<unsigned char> &found);
+bool GetAddressIndex(const uint160& addressHash, int type, std::vector<CAddressIndexDbEntry> &addressIndex, int start = 0, int end = 0,
+                     unsigned int maxCount = 0, const CAddressIndexKey *pAfter = nullptr);
+bool GetAddressUnspent(const uint160& addressHash, int type, std::vector<CAddressUnspentDbEntry>& unspentOutputs,
+                       unsigned int maxCount = 0, const CAddressUnspentKey *pAfter = nullptr, const CDBSnapshot *pSnapshot = nullptr);
+// read several addresses with one index iterator each, in parallel. address index entries are merged into chain order
+bool GetAddressIndex(const std::vector<std::pair<uint160, int>> &addresses, std::vector<CAddressIndexDbEntry> &addressIndex,
+                     int start = 0, int end = 0);
+bool GetAddressUnspent(const std::vector<std::pair<uint160, int>> &addresses, std::vector<CAddressUnspentDbEntry> &unspentOutputs,
+                       const CDBSnapshot *pSnapshot = nullptr);
+bool GetAddressBalance(const uint160& addressHash, int type, CAddressBalanceValue &balance);
+// the output deltas getblockdeltas reports for one transaction
+void GetBlockDeltaOutputs(const CTransaction &tx, std::vector<CBlockDeltaOutput> &outputs);
+bool GetBlockDeltaSummary(const uint256 &blockHash, CBlockDeltaSummary &summary);
+// the filter and filter header of a block, if it is in the block filter index
+bool GetBlockFilter(const uint256 &blockHash, CBlockFilterIndexEntry &entry);
+// the statistics of a block, if it is in the block stats index
+bool GetBlockStats(const uint256 &blockHash, CBlockStats &stats);
+
+/** Number of serialized Sapling trees kept in memory by their root for getsaplingtree and z_gettreestate */
+static const int SAPLING_TREE_STATE_CACHE_SIZE = 20000;
+/**
+ * The serialized Sapling trees with each of the roots, null for a root with no anchor in the coins database. Returns
+ * false if any was missing. Takes cs_main only to read the trees that are not cached.
+ */
+bool GetSaplingTreeStates(const std::vector<uint256> &roots, std::vector<std::shared_ptr<const std::vector<unsigned char>>> &states);
 
 /** Functions for disk access for blocks */
 bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart);
 bool ReadBlockFromDisk(int32_t height, CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams, bool checkPOW);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams, bool checkPOW);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
+/** Reads a block to build proofs from. A block pruned with -pruneproofs is rebuilt from its proof material, with only
+ *  the transactions that were retained in it, so a proof of any other transaction fails to find it. */
+bool ReadBlockForProof(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
 
 /** Functions for validating blocks and updating the block tree */
 
@@ -518,7 +722,7 @@ bool CheckBlock(int32_t *futureblockp,int32_t height,CBlockIndex *pindex,const C
  *  By "context", we mean only the previous block headers, but not the UTXO
  *  set; UTXO-related validity checks are done in ConnectBlock(). */
 bool ContextualCheckBlockHeader(const CBlockHeader& block, CValidationState& state,
-                                const CChainParams& chainparams, CBlockIndex *pindexPrev);
+                                const CChainParams& chainparams, CBlockIndex *pindexPrev, const uint256 *pBlockHash=NULL);
 bool ContextualCheckBlock(const CBlock& block, CValidationState& state,
                           const CChainParams& chainparams, CBlockIndex *pindexPrev);
 
@@ -563,6 +767,76 @@ bool InvalidateBlock(CValidationState& state, const CChainParams& chainparams, C
 /** Remove invalidity status from a block and its descendants. */
 bool ReconsiderBlock(CValidationState& state, CBlockIndex *pindex);
 
+/** The phases of connecting a block to the tip, as reported by getvalidationstats */
+enum ValidationPhase
+{
+    VALIDATION_PHASE_READ,
+    VALIDATION_PHASE_DESERIALIZE,
+    VALIDATION_PHASE_CHECKBLOCK,
+    VALIDATION_PHASE_PRECHECKS,
+    VALIDATION_PHASE_INPUTS,
+    VALIDATION_PHASE_SCRIPTS,
+    VALIDATION_PHASE_INDEX,
+    VALIDATION_PHASE_CALLBACKS,
+    VALIDATION_PHASE_FLUSH,
+    VALIDATION_PHASE_CHAINSTATE,
+    VALIDATION_PHASE_WALLET,
+    VALIDATION_PHASE_POSTCONNECT,
+    VALIDATION_PHASE_TOTAL,
+    VALIDATION_PHASE_COUNT
+};
+
+extern const char * const validationPhaseNames[VALIDATION_PHASE_COUNT];
+
+/** Time spent in each phase of connecting blocks to the tip, in microseconds */
+struct CBlockConnectTimes
+{
+    int64_t nBlocks = 0;
+    int64_t nTransactions = 0;
+    int64_t nRead = 0;          // reading block records from disk, including decompression
+    int64_t nDeserialize = 0;   // only measured for blocks read by ReplayBlocks
+    int64_t nCheckBlock = 0;
+    int64_t nPrechecks = 0;     // contextual transaction checks and the PBaaS duplicate definition and export checks
+    int64_t nInputs = 0;        // the remainder of the transaction loop: coins, shielded requirements and fees
+    int64_t nScripts = 0;       // waiting for script and crypto-condition checks after the transaction loop
+    int64_t nIndex = 0;
+    int64_t nCallbacks = 0;
+    int64_t nFlush = 0;
+    int64_t nChainState = 0;
+    int64_t nWallet = 0;        // wallet notifications of the block's transactions and the new tip
+    int64_t nPostConnect = 0;
+    int64_t nTotal = 0;
+
+    CBlockConnectTimes operator-(const CBlockConnectTimes &rhs) const;
+    int64_t GetPhase(ValidationPhase phase) const;
+    UniValue ToUniValue() const;
+};
+
+/** The totals of each phase over all blocks connected to the tip since startup. Requires cs_main. */
+CBlockConnectTimes GetBlockConnectTimes();
+
+/** Histograms of the time each block connected to the tip spent in each phase, with the totals of the phases */
+struct CValidationStats
+{
+    int64_t nStartTime;         // startup or the last reset
+    CBlockConnectTimes totals;
+    CDBLatencyStats phases[VALIDATION_PHASE_COUNT];
+};
+
+/** The validation statistics since startup or the last ResetValidationStats. Both require cs_main. */
+CValidationStats GetValidationStats();
+void ResetValidationStats();
+
+/** The per block histograms of each validation phase, as Prometheus metrics */
+std::string GetValidationMetrics();
+
+/**
+ * Disconnects the top nBlocks blocks of the active chain and connects them again from their block files, nPasses
+ * times, returning the time spent in each phase of each pass, for repeatable measurements of validation on a range
+ * of real blocks. The chain is back at its original tip after each pass that succeeds. Requires cs_main.
+ */
+bool ReplayBlocks(CValidationState &state, const CChainParams &chainparams, int nBlocks, int nPasses, std::vector<CBlockConnectTimes> &passTimes);
+
 /** The currently-connected chain of blocks (protected by cs_main). */
 extern CChain chainActive;
 
@@ -572,6 +846,39 @@ extern CCoinsViewCache *pcoinsTip;
 /** Global variable that points to the active block tree (protected by cs_main) */
 extern CBlockTreeDB *pblocktree;
 
+/**
+ * The active chain and the indexes as of one tip, for read-only RPCs that then need no cs_main while they read and
+ * build their replies. Block index entries are never freed while running and their ancestry never changes, so the
+ * chain is walked from the tip, and the indexes are read through a database snapshot taken with that tip.
+ */
+class CChainReadSnapshot
+{
+public:
+    const CBlockIndex *pTip;
+    std::shared_ptr<const CDBSnapshot> indexSnapshot;
+
+    CChainReadSnapshot(const CBlockIndex *pTipIn, const std::shared_ptr<const CDBSnapshot> &indexSnapshotIn) :
+        pTip(pTipIn), indexSnapshot(indexSnapshotIn) {}
+
+    int Height() const { return pTip ? pTip->GetHeight() : -1; }
+
+    const CBlockIndex *operator[](int nHeight) const
+    {
+        if (!pTip || nHeight < 0 || nHeight > pTip->GetHeight())
+            return nullptr;
+        return pTip->GetAncestor(nHeight);
+    }
+
+    bool Contains(const CBlockIndex *pindex) const { return pindex && (*this)[pindex->GetHeight()] == pindex; }
+
+    const CBlockIndex *Next(const CBlockIndex *pindex) const { return Contains(pindex) ? (*this)[pindex->GetHeight() + 1] : nullptr; }
+};
+
+/** The read snapshot of the current tip, taken by the first caller after each tip change. Never null */
+std::shared_ptr<const CChainReadSnapshot> GetChainReadSnapshot();
+/** Drop the read snapshot, it holds a snapshot of the index database, which must be released before that is closed */
+void ResetChainReadSnapshot();
+
 /**
  * Return the spend height, which is one more than the inputs.GetBestBlock().
  * While checking, GetBestBlock() refers to the parent block. (protected by cs_main)
@@ -5,8 +5,12 @@
 #ifndef BITCOIN_MEMUSAGE_H
 #define BITCOIN_MEMUSAGE_H
 
+#include "prevector.h"
+#include "support/allocators/pool.h"
+
 #include <stdlib.h>
 
+#include <list>
 #include <map>
 #include <set>
 #include <vector>
@@ -70,6 +74,15 @@ private:
     X x;
 };
 
+template<typename X>
+struct stl_list_node
+{
+private:
+    void* next;
+    void* prev;
+    X x;
+};
+
 struct stl_shared_counter
 {
     /* Various platforms use different sized counters here.
@@ -91,6 +104,12 @@ static inline size_t DynamicUsage(const prevector<N, X, S, D>& v)
     return MallocUsage(v.allocated_memory());
 }
 
+template<typename X, typename Y>
+static inline size_t DynamicUsage(const std::list<X, Y>& l)
+{
+    return MallocUsage(sizeof(stl_list_node<X>)) * l.size();
+}
+
 template<typename X, typename Y>
 static inline size_t DynamicUsage(const std::set<X, Y>& s)
 {
@@ -151,6 +170,15 @@ static inline size_t DynamicUsage(const boost::unordered_map<X, Y, Z>& m)
     return MallocUsage(sizeof(boost_unordered_node<std::pair<const X, Y> >)) * m.size() + MallocUsage(sizeof(void*) * m.bucket_count());
 }
 
+/** Maps on a PoolResource use whole chunks, however many nodes are live, plus the list entry tracking each chunk. */
+template<typename X, typename Y, typename Z, typename E, std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES>
+static inline size_t DynamicUsage(const boost::unordered_map<X, Y, Z, E, PoolAllocator<std::pair<const X, Y>, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES> >& m)
+{
+    const auto *resource = m.get_allocator().resource();
+    size_t chunkUsage = MallocUsage(resource->ChunkSizeBytes()) + MallocUsage(sizeof(void*) * 3);
+    return chunkUsage * resource->NumAllocatedChunks() + MallocUsage(sizeof(void*) * m.bucket_count());
+}
+
 }
 
 #endif
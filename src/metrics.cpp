@@ -6,6 +6,7 @@
 
 #include "chainparams.h"
 #include "checkpoints.h"
+#include "dbwrapper.h"
 #include "main.h"
 #include "timedata.h"
 #include "ui_interface.h"
@@ -16,6 +17,8 @@
 
 #include <boost/thread.hpp>
 #include <boost/thread/synchronized_value.hpp>
+#include <algorithm>
+#include <list>
 #include <string>
 #ifdef _WIN32
 #include <io.h>
@@ -162,6 +165,241 @@ double GetLocalSolPS()
         return miningTimer.rate(solutionTargetChecks);
 }
 
+// threads numbered past this share the counters of lower numbered ones
+static const int MAX_MINER_THREAD_STATS = 256;
+
+// accepted blocks this far below the tip are settled, as confirmed or orphaned, and no longer checked
+static const int MINED_BLOCK_SETTLE_DEPTH = 100;
+
+struct CMinerThreadCounters
+{
+    std::atomic<uint64_t> nHashes;
+    std::atomic<int64_t> nMicros;
+    std::atomic<int64_t> nLastActive;
+
+    CMinerThreadCounters() : nHashes(0), nMicros(0), nLastActive(0) {}
+};
+
+struct CTrackedMinedBlock
+{
+    uint256 hash;
+    int nHeight;
+    bool fStake;
+};
+
+static CMinerThreadCounters minerThreadCounters[MAX_MINER_THREAD_STATS];
+static std::atomic<int> nMinerThreadSlots(0);
+static CDBLatencyHistogram templateAgeHistograms[2];
+static std::atomic<uint64_t> nStakeEvaluations(0), nStakeCandidates(0), nStakeHits(0), nStakesFound(0);
+static CDBLatencyHistogram stakeLatencyHistogram;
+
+// guards the block outcomes, the unsettled blocks and the hash kernel. taken after cs_main
+static CCriticalSection cs_miningStats;
+static int64_t nMiningStatsStart = GetTime();
+static std::string strMinerHashKernel;
+static uint64_t minedOutcomes[2][MINED_OUTCOME_COUNT];
+static uint64_t nMinedConfirmed[2], nMinedOrphaned[2];
+static std::list<CTrackedMinedBlock> unsettledMinedBlocks;
+
+void StartMinerThreadStats(int threadNum)
+{
+    CMinerThreadCounters &counters = minerThreadCounters[threadNum % MAX_MINER_THREAD_STATS];
+    counters.nHashes = 0;
+    counters.nMicros = 0;
+    counters.nLastActive = GetTime();
+    // threads start concurrently, so raise the count of reported slots without lowering what another has set
+    int nSlots = nMinerThreadSlots.load(), nNeeded = std::min(threadNum + 1, MAX_MINER_THREAD_STATS);
+    while (nSlots < nNeeded && !nMinerThreadSlots.compare_exchange_weak(nSlots, nNeeded))
+    {
+    }
+}
+
+void RecordMinerHashes(int threadNum, uint64_t nHashes, int64_t nMicros)
+{
+    CMinerThreadCounters &counters = minerThreadCounters[threadNum % MAX_MINER_THREAD_STATS];
+    counters.nHashes += nHashes;
+    counters.nMicros += nMicros;
+    counters.nLastActive = GetTime();
+}
+
+void SetMinerHashKernel(const std::string &strKernel)
+{
+    LOCK(cs_miningStats);
+    strMinerHashKernel = strKernel;
+}
+
+void RecordMinedBlock(const uint256 &hash, int nHeight, bool fStake, MinedBlockOutcome outcome, int64_t nTemplateAgeMicros)
+{
+    templateAgeHistograms[fStake].Add(nTemplateAgeMicros);
+    LOCK(cs_miningStats);
+    minedOutcomes[fStake][outcome]++;
+    if (outcome == MINED_ACCEPTED)
+    {
+        unsettledMinedBlocks.push_back({hash, nHeight, fStake});
+    }
+}
+
+void RecordStakeEvaluation(uint64_t nCandidates, uint64_t nHits, bool fFound, int64_t nMicros)
+{
+    nStakeEvaluations++;
+    nStakeCandidates += nCandidates;
+    nStakeHits += nHits;
+    if (fFound)
+    {
+        nStakesFound++;
+    }
+    stakeLatencyHistogram.Add(nMicros);
+}
+
+CMiningStats GetMiningStats()
+{
+    CMiningStats stats;
+    for (int i = 0; i < nMinerThreadSlots.load(); i++)
+    {
+        const CMinerThreadCounters &counters = minerThreadCounters[i];
+        stats.threads.push_back({i, counters.nHashes.load(), counters.nMicros.load(), counters.nLastActive.load()});
+    }
+    stats.nStakeEvaluations = nStakeEvaluations;
+    stats.nStakeCandidates = nStakeCandidates;
+    stats.nStakeHits = nStakeHits;
+    stats.nStakesFound = nStakesFound;
+    stats.stakeLatency = stakeLatencyHistogram.GetStats();
+
+    LOCK2(cs_main, cs_miningStats);
+    stats.nStartTime = nMiningStatsStart;
+    stats.strHashKernel = strMinerHashKernel;
+
+    // settle blocks that are deep enough, and count those of the rest that have been reorganized out of the chain
+    uint64_t nUnsettledOrphans[2] = {0, 0};
+    int nTipHeight = chainActive.Height();
+    for (auto it = unsettledMinedBlocks.begin(); it != unsettledMinedBlocks.end(); )
+    {
+        BlockMap::iterator mi = mapBlockIndex.find(it->hash);
+        bool fInChain = mi != mapBlockIndex.end() && chainActive.Contains(mi->second);
+        if (nTipHeight - it->nHeight >= MINED_BLOCK_SETTLE_DEPTH)
+        {
+            (fInChain ? nMinedConfirmed : nMinedOrphaned)[it->fStake]++;
+            it = unsettledMinedBlocks.erase(it);
+            continue;
+        }
+        if (!fInChain)
+        {
+            nUnsettledOrphans[it->fStake]++;
+        }
+        it++;
+    }
+
+    CMinedBlockStats *pBlockStats[2] = {&stats.pow, &stats.pos};
+    for (int fStake = 0; fStake < 2; fStake++)
+    {
+        CMinedBlockStats &blockStats = *pBlockStats[fStake];
+        std::copy(minedOutcomes[fStake], minedOutcomes[fStake] + MINED_OUTCOME_COUNT, blockStats.outcomes);
+        blockStats.nConfirmed = nMinedConfirmed[fStake];
+        blockStats.nOrphaned = nMinedOrphaned[fStake] + nUnsettledOrphans[fStake];
+        blockStats.templateAge = templateAgeHistograms[fStake].GetStats();
+    }
+    return stats;
+}
+
+void ResetMiningStats()
+{
+    for (int i = 0; i < MAX_MINER_THREAD_STATS; i++)
+    {
+        minerThreadCounters[i].nHashes = 0;
+        minerThreadCounters[i].nMicros = 0;
+    }
+    nStakeEvaluations = 0;
+    nStakeCandidates = 0;
+    nStakeHits = 0;
+    nStakesFound = 0;
+    stakeLatencyHistogram.Reset();
+
+    LOCK(cs_miningStats);
+    nMiningStatsStart = GetTime();
+    for (int fStake = 0; fStake < 2; fStake++)
+    {
+        templateAgeHistograms[fStake].Reset();
+        std::fill(minedOutcomes[fStake], minedOutcomes[fStake] + MINED_OUTCOME_COUNT, 0);
+        nMinedConfirmed[fStake] = 0;
+        nMinedOrphaned[fStake] = 0;
+    }
+    unsettledMinedBlocks.clear();
+}
+
+static std::string LatencyHistogramMetrics(const std::string &strName, const std::string &strLabels, const CDBLatencyStats &stats)
+{
+    std::string strOut;
+    std::string strPrefix = strLabels.empty() ? "" : strLabels + ",";
+    // the histogram buckets are cumulative, the last of ours only has the +Inf bound
+    uint64_t nCumulative = 0;
+    for (int i = 0; i < CDBLatencyStats::BUCKETS - 1; i++)
+    {
+        nCumulative += stats.buckets[i];
+        strOut += strprintf("%s_bucket{%sle=\"%g\"} %u\n", strName, strPrefix, ((int64_t)1 << i) / 1e6, nCumulative);
+    }
+    strOut += strprintf("%s_bucket{%sle=\"+Inf\"} %u\n", strName, strPrefix, stats.nCount);
+    strOut += strprintf("%s_sum%s %.6f\n", strName, strLabels.empty() ? "" : "{" + strLabels + "}", stats.nTotalMicros / 1e6);
+    strOut += strprintf("%s_count%s %u\n", strName, strLabels.empty() ? "" : "{" + strLabels + "}", stats.nCount);
+    return strOut;
+}
+
+std::string GetMiningMetrics()
+{
+    static const char *outcomeNames[MINED_OUTCOME_COUNT] = {"accepted", "stale", "rejected"};
+    CMiningStats stats = GetMiningStats();
+    std::string strOut;
+
+    strOut += "# HELP verus_miner_hashes_total Hashes computed by each mining thread since it started\n";
+    strOut += "# TYPE verus_miner_hashes_total counter\n";
+    for (const CMinerThreadStats &thread : stats.threads)
+    {
+        strOut += strprintf("verus_miner_hashes_total{thread=\"%d\"} %u\n", thread.nThread, thread.nHashes);
+    }
+    strOut += "# HELP verus_miner_hashing_seconds_total Time each mining thread spent hashing since it started\n";
+    strOut += "# TYPE verus_miner_hashing_seconds_total counter\n";
+    for (const CMinerThreadStats &thread : stats.threads)
+    {
+        strOut += strprintf("verus_miner_hashing_seconds_total{thread=\"%d\"} %.6f\n", thread.nThread, thread.nMicros / 1e6);
+    }
+    if (!stats.strHashKernel.empty())
+    {
+        strOut += "# HELP verus_miner_hash_kernel The hash function the mining threads use\n";
+        strOut += "# TYPE verus_miner_hash_kernel gauge\n";
+        strOut += strprintf("verus_miner_hash_kernel{kernel=\"%s\"} 1\n", stats.strHashKernel);
+    }
+
+    strOut += "# HELP verus_mined_blocks_total Blocks this node mined or staked, by what became of them when submitted\n";
+    strOut += "# TYPE verus_mined_blocks_total counter\n";
+    strOut += "# HELP verus_mined_blocks_orphaned Accepted blocks of this node that are no longer in the active chain\n";
+    strOut += "# TYPE verus_mined_blocks_orphaned gauge\n";
+    const CMinedBlockStats *pBlockStats[2] = {&stats.pow, &stats.pos};
+    for (int fStake = 0; fStake < 2; fStake++)
+    {
+        const char *strType = fStake ? "pos" : "pow";
+        for (int outcome = 0; outcome < MINED_OUTCOME_COUNT; outcome++)
+        {
+            strOut += strprintf("verus_mined_blocks_total{type=\"%s\",outcome=\"%s\"} %u\n",
+                                strType, outcomeNames[outcome], pBlockStats[fStake]->outcomes[outcome]);
+        }
+        strOut += strprintf("verus_mined_blocks_orphaned{type=\"%s\"} %u\n", strType, pBlockStats[fStake]->nOrphaned);
+    }
+    strOut += "# HELP verus_mined_template_age_seconds Time from taking a block template to submitting the block solved on it\n";
+    strOut += "# TYPE verus_mined_template_age_seconds histogram\n";
+    strOut += LatencyHistogramMetrics("verus_mined_template_age_seconds", "type=\"pow\"", stats.pow.templateAge);
+    strOut += LatencyHistogramMetrics("verus_mined_template_age_seconds", "type=\"pos\"", stats.pos.templateAge);
+
+    strOut += "# HELP verus_stake_candidates_total Outputs hashed looking for a winning stake\n";
+    strOut += "# TYPE verus_stake_candidates_total counter\n";
+    strOut += strprintf("verus_stake_candidates_total %u\n", stats.nStakeCandidates);
+    strOut += "# HELP verus_stake_found_total Stake evaluations that found a stake to use\n";
+    strOut += "# TYPE verus_stake_found_total counter\n";
+    strOut += strprintf("verus_stake_found_total %u\n", stats.nStakesFound);
+    strOut += "# HELP verus_stake_evaluation_seconds Time to look for a winning stake for one block\n";
+    strOut += "# TYPE verus_stake_evaluation_seconds histogram\n";
+    strOut += LatencyHistogramMetrics("verus_stake_evaluation_seconds", "", stats.stakeLatency);
+    return strOut;
+}
+
 int EstimateNetHeight(const Consensus::Params& params, int currentHeadersHeight, int64_t currentHeadersTime)
 {
     int64_t now = GetAdjustedTime();
@@ -420,6 +658,33 @@ int printMetrics(size_t cols, bool mining)
     return lines;
 }
 
+int printDatabaseStats(size_t cols)
+{
+    std::vector<CDBStats> allStats = CDBWrapper::GetAllStats();
+    if (allStats.empty()) {
+        return 0;
+    }
+
+    int lines = 2;
+    std::cout << _("Databases") << ":" << std::endl;
+    for (const CDBStats &stats : allStats) {
+        uint64_t nLookups = stats.nCacheHits + stats.nCacheMisses;
+        std::string strStats = "- " + strprintf(_("%s: read p50 <%dus p99 <%dus, commit p99 <%dus, cache hits %d%%, %u write stalls, %.1f MiB to compact"),
+                                                stats.name,
+                                                stats.latency[DBOP_READ].Percentile(0.5),
+                                                stats.latency[DBOP_READ].Percentile(0.99),
+                                                stats.latency[DBOP_BATCH].Percentile(0.99),
+                                                nLookups ? (int)(stats.nCacheHits * 100 / nLookups) : 0,
+                                                stats.nWriteStalls,
+                                                stats.nPendingCompactionBytes / 1048576.0);
+        std::cout << strStats << std::endl;
+        lines += 1 + (strStats.size() / cols);
+    }
+    std::cout << std::endl;
+
+    return lines;
+}
+
 int printMessageBox(size_t cols)
 {
     boost::strict_lock_ptr<std::list<std::string>> u = messageBox.synchronize();
@@ -561,6 +826,9 @@ void ThreadShowMetricsScreen()
             lines += printMiningStatus(mining);
         }
         lines += printMetrics(cols, mining);
+        if (loaded) {
+            lines += printDatabaseStats(cols);
+        }
         lines += printMessageBox(cols);
         lines += printInitMessage();
 
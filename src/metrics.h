@@ -4,10 +4,12 @@
 
 #include "uint256.h"
 #include "consensus/params.h"
+#include "dbwrapper.h"
 
 #include <atomic>
 #include <mutex>
 #include <string>
+#include <vector>
 
 struct AtomicCounter {
     std::atomic<uint64_t> value;
@@ -83,6 +85,62 @@ extern PerfCounterTimer miningTimer;
 
 void TrackMinedBlock(uint256 hash);
 
+/** What became of a block this node mined or staked when it was submitted */
+enum MinedBlockOutcome
+{
+    MINED_ACCEPTED,         // accepted, though it may be orphaned later
+    MINED_STALE,            // the tip moved before the block was submitted
+    MINED_REJECTED,         // not accepted by validation
+    MINED_OUTCOME_COUNT
+};
+
+struct CMinerThreadStats
+{
+    int nThread;
+    uint64_t nHashes;
+    int64_t nMicros;                // spent hashing
+    int64_t nLastActive;            // when the thread last reported hashes, in seconds since epoch
+};
+
+/** Blocks of one kind, mined or staked, submitted by this node */
+struct CMinedBlockStats
+{
+    uint64_t outcomes[MINED_OUTCOME_COUNT];
+    uint64_t nConfirmed;            // accepted and in the active chain, well below the tip
+    uint64_t nOrphaned;             // accepted and no longer in the active chain
+    CDBLatencyStats templateAge;    // microseconds from taking the block template to submitting the block
+
+    CMinedBlockStats() : outcomes(), nConfirmed(0), nOrphaned(0) {}
+};
+
+/** Live mining and staking telemetry, for getminingstats and the metrics endpoint */
+struct CMiningStats
+{
+    int64_t nStartTime;             // startup or the last reset, in seconds since epoch
+    std::string strHashKernel;      // the hash function the miner threads last chose
+    std::vector<CMinerThreadStats> threads;
+    CMinedBlockStats pow;
+    CMinedBlockStats pos;
+    uint64_t nStakeEvaluations;     // blocks for which the wallet looked for a winning stake
+    uint64_t nStakeCandidates;      // outputs hashed over those blocks
+    uint64_t nStakeHits;            // outputs that met the target and were checked further
+    uint64_t nStakesFound;          // evaluations that found a stake to use
+    CDBLatencyStats stakeLatency;   // microseconds per evaluation
+
+    CMiningStats() : nStartTime(0), nStakeEvaluations(0), nStakeCandidates(0), nStakeHits(0), nStakesFound(0) {}
+};
+
+void StartMinerThreadStats(int threadNum);
+void RecordMinerHashes(int threadNum, uint64_t nHashes, int64_t nMicros);
+void SetMinerHashKernel(const std::string &strKernel);
+void RecordMinedBlock(const uint256 &hash, int nHeight, bool fStake, MinedBlockOutcome outcome, int64_t nTemplateAgeMicros);
+void RecordStakeEvaluation(uint64_t nCandidates, uint64_t nHits, bool fFound, int64_t nMicros);
+/** Takes cs_main, to find which of the accepted blocks have been orphaned */
+CMiningStats GetMiningStats();
+void ResetMiningStats();
+/** The mining stats in the Prometheus text format */
+std::string GetMiningMetrics();
+
 void MarkStartTime();
 double GetLocalSolPS();
 int EstimateNetHeight(const Consensus::Params& params, int currentBlockHeight, int64_t currentBlockTime);
@@ -109,6 +109,61 @@ public:
     }
 };
 
+//
+// The per transaction evaluation that CreateNewBlock does while building its priority heap, including contextual
+// checks, reserve transfer destination lookups, conversion fee estimates and arbitrage tracking, depends only on
+// the transaction and the block we are building on. We keep those results for each mempool transaction, so that
+// each new template only evaluates transactions that entered the mempool since the last one. The entire cache is
+// dropped on a tip change, and entries for transactions that have left the mempool are dropped on the next template.
+// Access is protected by cs_main and mempool.cs, which CreateNewBlock holds while using it.
+//
+class CTemplateTxEvaluation
+{
+public:
+    bool fRemove;                                       // transaction should be removed from the mempool
+    CAmount delayedFee;                                 // native fee estimated from conversions on import
+    std::vector<std::pair<bool, CUTXORef>> arbOutputs;  // arbitrage only outputs, added (true) or spent by an import (false)
+
+    CTemplateTxEvaluation() : fRemove(false), delayedFee(0) {}
+};
+
+class CTemplateTxCache
+{
+public:
+    uint256 prevBlockHash;
+    std::map<uint256, CTemplateTxEvaluation> evaluations;
+
+    // returns true if the cache was reset for a new tip
+    bool CheckTip(const uint256 &blockHash)
+    {
+        if (blockHash != prevBlockHash)
+        {
+            prevBlockHash = blockHash;
+            evaluations.clear();
+            return true;
+        }
+        return false;
+    }
+
+    // remove all evaluations for transactions not in the set passed
+    void Prune(const std::set<uint256> &currentTxes)
+    {
+        for (auto it = evaluations.begin(); it != evaluations.end(); )
+        {
+            if (!currentTxes.count(it->first))
+            {
+                it = evaluations.erase(it);
+            }
+            else
+            {
+                it++;
+            }
+        }
+    }
+};
+
+static CTemplateTxCache templateTxCache;
+
 void UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev)
 {
     pblock->nTime = ConnectedChains.GetNextBlockTime(pindexPrev);
@@ -156,9 +211,9 @@ int32_t komodo_notaryvin(CMutableTransaction &txNew,uint8_t *notarypub33);
 UniValue getminingdistribution(const UniValue& params, bool fHelp);
 
 // for PoW: don't update MMR if the merkle root, prev MMR && time haven't changed
-LRUCache<std::tuple<uint256, uint256, uint32_t>, uint256> powBlockMMRLRU(200);
+ShardedLRUCache<std::tuple<uint256, uint256, uint32_t>, uint256> powBlockMMRLRU(200);
 // for PoS: don't update MMR if the merkle root, prev MMR && entropy hash component haven't changed
-LRUCache<std::tuple<uint256, uint256, uint256>, uint256> posBlockMMRLRU(200);
+ShardedLRUCache<std::tuple<uint256, uint256, uint256>, uint256> posBlockMMRLRU(200);
 void IncrementExtraNonce(CBlock* pblock, CBlockIndex* pindexPrev, unsigned int &nExtraNonce, bool buildMerkle, uint32_t *pSaveBits)
 {
     uint32_t nHeight = pindexPrev->GetHeight() + 1;
@@ -2889,6 +2944,18 @@ CBlockTemplate* CreateNewBlock(const CChainParams& chainparams, const std::vecto
         std::list<CTransaction> txesToRemove;
         std::set<CUTXORef> orphanArbs;
 
+        // a new tip invalidates all prior evaluations
+        if (templateTxCache.CheckTip(pindexPrev->GetBlockHash()))
+        {
+            LogPrint("createblock", "%s: new tip, full template rebuild at height %d\n", __func__, nHeight);
+        }
+        std::set<uint256> currentTemplateTxes;
+
+        // a transaction is ranked by fee at the best rate of a package it belongs to, so that children can pay for their
+        // parents, and once a parent is in the block, its children are released at that same rate
+        std::map<uint256, CFeeRate> packageRates;
+        mempool.GetPackageFeeRates(packageRates);
+
         // now add transactions from the mem pool to the priority heap
         for (CTxMemPool::indexed_transaction_set::iterator mi = mempool.mapTx.begin();
              mi != mempool.mapTx.end(); ++mi)
@@ -2906,31 +2973,23 @@ CBlockTemplate* CreateNewBlock(const CChainParams& chainparams, const std::vecto
             {
                 continue;
             }
-            if (tx.IsCoinBase() ||
-                IsExpiredTx(tx, nHeight) ||
-                (mi->GetHeight() != nHeight &&
-                 !ContextualCheckTransaction(tx, state, Params(), nHeight, 0)))
-            {
-                txesToRemove.push_back(tx);
-                continue;
-            }
-
-            COrphan* porphan = NULL;
-            double dPriority = 0;
-            CAmount nTotalIn = 0;
-            CCurrencyValueMap totalReserveIn;
-            bool fMissingInputs = false;
             CReserveTransactionDescriptor rtxd;
             bool isReserve = mempool.IsKnownReserveTransaction(hash, rtxd);
 
-            CAmount delayedFee = 0;
-            if (isReserve)
+            // only evaluate transactions we have not already seen on this tip
+            currentTemplateTxes.insert(hash);
+            auto evalIt = templateTxCache.evaluations.find(hash);
+            if (evalIt == templateTxCache.evaluations.end())
             {
-                nTotalIn += rtxd.nativeIn;
-                totalReserveIn = rtxd.ReserveInputMap();
-                assert(!totalReserveIn.valueMap.count(ASSETCHAINS_CHAINID));
-
-                if (rtxd.IsReserveTransfer() || rtxd.IsImport())
+                CTemplateTxEvaluation txEval;
+                if (tx.IsCoinBase() ||
+                    IsExpiredTx(tx, nHeight) ||
+                    (mi->GetHeight() != nHeight &&
+                     !ContextualCheckTransaction(tx, state, Params(), nHeight, 0)))
+                {
+                    txEval.fRemove = true;
+                }
+                else if (isReserve && (rtxd.IsReserveTransfer() || rtxd.IsImport()))
                 {
                     for (int j = 0; j < tx.vout.size(); j++)
                     {
@@ -2960,7 +3019,7 @@ CBlockTemplate* CreateNewBlock(const CChainParams& chainparams, const std::vecto
                                 {
                                     for (auto &oneRef : arbTxOuts)
                                     {
-                                        orphanArbs.erase(oneRef);
+                                        txEval.arbOutputs.push_back(std::make_pair(false, oneRef));
                                     }
                                 }
                             }
@@ -2977,7 +3036,7 @@ CBlockTemplate* CreateNewBlock(const CChainParams& chainparams, const std::vecto
                                 {
                                     if (rt.IsArbitrageOnly())
                                     {
-                                        orphanArbs.insert(CUTXORef(tx.GetHash(), j));
+                                        txEval.arbOutputs.push_back(std::make_pair(true, CUTXORef(tx.GetHash(), j)));
                                     }
                                     uint160 destCurrencyID = rt.GetImportCurrency();
                                     CCurrencyDefinition destCurrency = ConnectedChains.GetCachedCurrency(destCurrencyID);
@@ -2993,7 +3052,7 @@ CBlockTemplate* CreateNewBlock(const CChainParams& chainparams, const std::vecto
                                             printf("%s: invalid or inaccessible destination currency/system in reserve transfer in output %d on tx: %s\n", __func__, j, jsonTx.write(1,2).c_str());
                                             LogPrintf("%s: invalid or inaccessible destination currency/system in reserve transfer in output %d on tx: %s\n", __func__, j, jsonTx.write(1,2).c_str());
                                         }
-                                        txesToRemove.push_back(tx);
+                                        txEval.fRemove = true;
                                         continue;
                                     }
 
@@ -3010,7 +3069,7 @@ CBlockTemplate* CreateNewBlock(const CChainParams& chainparams, const std::vecto
                                                 printf("%s: invalid or inaccessible second leg destination system in reserve transfer in output %d on tx: %s\n", __func__, j, jsonTx.write(1,2).c_str());
                                                 LogPrintf("%s: invalid or inaccessible second leg destination system in reserve transfer in output %d on tx: %s\n", __func__, j, jsonTx.write(1,2).c_str());
                                             }
-                                            txesToRemove.push_back(tx);
+                                            txEval.fRemove = true;
                                             continue;
                                         }
                                     }
@@ -3024,7 +3083,7 @@ CBlockTemplate* CreateNewBlock(const CChainParams& chainparams, const std::vecto
                                         CCurrencyValueMap delayedFees = rt.CalculateFee();
                                         if (delayedFees.valueMap.count(ASSETCHAINS_CHAINID))
                                         {
-                                            delayedFee += delayedFees.valueMap[ASSETCHAINS_CHAINID];
+                                            txEval.delayedFee += delayedFees.valueMap[ASSETCHAINS_CHAINID];
                                             delayedFees.valueMap.erase(ASSETCHAINS_CHAINID);
                                         }
                                         if (delayedFees.valueMap.size())
@@ -3032,7 +3091,7 @@ CBlockTemplate* CreateNewBlock(const CChainParams& chainparams, const std::vecto
                                             CCoinbaseCurrencyState pricingState = ConnectedChains.GetCurrencyState(destCurrency, nHeight);
                                             for (auto &oneCurFee : delayedFees.valueMap)
                                             {
-                                                delayedFee += pricingState.ReserveToNativeRaw(
+                                                txEval.delayedFee += pricingState.ReserveToNativeRaw(
                                                                     oneCurFee.second,
                                                                     pricingState.TargetConversionPrice(oneCurFee.first, ASSETCHAINS_CHAINID));
                                             }
@@ -3043,6 +3102,40 @@ CBlockTemplate* CreateNewBlock(const CChainParams& chainparams, const std::vecto
                         }
                     }
                 }
+                evalIt = templateTxCache.evaluations.insert(std::make_pair(hash, txEval)).first;
+            }
+            const CTemplateTxEvaluation &txEval = evalIt->second;
+
+            for (auto &oneArbOut : txEval.arbOutputs)
+            {
+                if (oneArbOut.first)
+                {
+                    orphanArbs.insert(oneArbOut.second);
+                }
+                else
+                {
+                    orphanArbs.erase(oneArbOut.second);
+                }
+            }
+
+            if (txEval.fRemove)
+            {
+                txesToRemove.push_back(tx);
+                continue;
+            }
+
+            COrphan* porphan = NULL;
+            double dPriority = 0;
+            CAmount nTotalIn = 0;
+            CCurrencyValueMap totalReserveIn;
+            bool fMissingInputs = false;
+
+            CAmount delayedFee = txEval.delayedFee;
+            if (isReserve)
+            {
+                nTotalIn += rtxd.nativeIn;
+                totalReserveIn = rtxd.ReserveInputMap();
+                assert(!totalReserveIn.valueMap.count(ASSETCHAINS_CHAINID));
             }
 
             for (int inNum = 0; inNum < tx.vin.size(); inNum++)
@@ -3156,6 +3249,11 @@ CBlockTemplate* CreateNewBlock(const CChainParams& chainparams, const std::vecto
             mempool.ApplyDeltas(hash, dPriority, nDeltaValueIn);
 
             CFeeRate feeRate((nFeeValueIn + delayedFee) - tx.GetValueOut(), nTxSize);
+            auto packageRateIt = packageRates.find(hash);
+            if (packageRateIt != packageRates.end() && feeRate < packageRateIt->second)
+            {
+                feeRate = packageRateIt->second;
+            }
 
             if (porphan)
             {
@@ -3169,6 +3267,8 @@ CBlockTemplate* CreateNewBlock(const CChainParams& chainparams, const std::vecto
             }
         }
 
+        templateTxCache.Prune(currentTemplateTxes);
+
         std::set<uint256> arbTxOrphans;
         for (auto &oneOrphanArb : orphanArbs)
         {
@@ -3968,12 +4068,15 @@ void komodo_broadcast(const CBlock *pblock,int32_t limit)
     //fprintf(stderr,"finished broadcast new block t.%u\n",(uint32_t)time(NULL));
 }
 
-static bool ProcessBlockFound(CBlock* pblock, CWallet& wallet, CReserveKey& reservekey)
+// nTemplateTime is when the block's template was taken, in microseconds, for the mining stats
+static bool ProcessBlockFound(CBlock* pblock, CWallet& wallet, CReserveKey& reservekey, int64_t nTemplateTime)
 #else
-static bool ProcessBlockFound(CBlock* pblock)
+static bool ProcessBlockFound(CBlock* pblock, int64_t nTemplateTime)
 #endif // ENABLE_WALLET
 {
     int32_t height = chainActive.LastTip()->GetHeight()+1;
+    bool fStake = pblock->IsVerusPOSBlock();
+    int64_t nTemplateAge = GetTimeMicros() - nTemplateTime;
     //LogPrintf("%s\n", pblock->ToString());
     LogPrintf("generated %s height.%d\n", FormatMoney(pblock->vtx[0].vout[0].nValue), height);
 
@@ -3991,6 +4094,7 @@ static bool ProcessBlockFound(CBlock* pblock)
                 fprintf(stderr,"%02x",((uint8_t *)&hash)[i]);
             fprintf(stderr," <- chainTip (stale)\n");
 
+            RecordMinedBlock(pblock->GetHash(), height, fStake, MINED_STALE, nTemplateAge);
             return error("VerusMiner: generated block is stale");
         }
     }
@@ -4017,9 +4121,13 @@ static bool ProcessBlockFound(CBlock* pblock)
     // Process this block (almost) the same as if we had received it from another node
     CValidationState state;
     if (!ProcessNewBlock(1, chainActive.LastTip()->GetHeight()+1, state, Params(), NULL, pblock, true, NULL))
+    {
+        RecordMinedBlock(pblock->GetHash(), height, fStake, MINED_REJECTED, nTemplateAge);
         return error("VerusMiner: ProcessNewBlock, block not accepted");
+    }
 
     TrackMinedBlock(pblock->GetHash());
+    RecordMinedBlock(pblock->GetHash(), height, fStake, MINED_ACCEPTED, nTemplateAge);
     komodo_broadcast(pblock,16);
     return true;
 }
@@ -4171,6 +4279,7 @@ void static VerusStaker(CWallet *pwallet)
             // get height locally for consistent reporting
             int32_t newHeight = Mining_height;
 
+            int64_t nTemplateTime = GetTimeMicros();
             if (newHeight > VERUS_MIN_STAKEAGE)
                 ptr = CreateNewBlockWithKey(reservekey, newHeight, true);
 
@@ -4257,7 +4366,7 @@ void static VerusStaker(CWallet *pwallet)
 
             UpdateTime(pblock, consensusParams, pindexPrev);
 
-            if (ProcessBlockFound(pblock, *pwallet, reservekey))
+            if (ProcessBlockFound(pblock, *pwallet, reservekey, nTemplateTime))
             {
                 LogPrintf("Using %s algorithm:\n", ASSETCHAINS_ALGORITHMS[ASSETCHAINS_ALGO]);
                 LogPrintf("Staked block found  \n  hash: %s  \ntarget: %s\n", pblock->GetHash().GetHex(), hashTarget.GetHex());
@@ -4308,21 +4417,30 @@ void static VerusStaker(CWallet *pwallet)
 typedef bool (*minefunction)(CBlockHeader &bh, CVerusHashV2bWriter &vhw, uint256 &finalHash, uint256 &target, uint64_t start, uint64_t *count);
 bool mine_verus_v2(CBlockHeader &bh, CVerusHashV2bWriter &vhw, uint256 &finalHash, uint256 &target, uint64_t start, uint64_t *count);
 bool mine_verus_v2_port(CBlockHeader &bh, CVerusHashV2bWriter &vhw, uint256 &finalHash, uint256 &target, uint64_t start, uint64_t *count);
+bool mine_verus_v2_4x(CBlockHeader &bh, CVerusHashV2bWriter &vhw, uint256 &finalHash, uint256 &target, uint64_t start, uint64_t *count);
+bool mine_verus_v2_8x(CBlockHeader &bh, CVerusHashV2bWriter &vhw, uint256 &finalHash, uint256 &target, uint64_t start, uint64_t *count);
 
-void static BitcoinMiner_noeq(CWallet *pwallet)
+void static BitcoinMiner_noeq(CWallet *pwallet, int threadNum)
 #else
-void static BitcoinMiner_noeq()
+void static BitcoinMiner_noeq(int threadNum)
 #endif
 {
     LogPrintf("%s miner started\n", ASSETCHAINS_ALGORITHMS[ASSETCHAINS_ALGO]);
     RenameThread("verushash-miner");
 
+    // pin before this thread allocates its hash keys, so they are first touched on the NUMA node of its core
+    if (GetBoolArg("-minerthreadaffinity", false) && !SetThreadCoreAffinity(threadNum))
+    {
+        LogPrintf("%s: unable to set core affinity for mining thread %d\n", __func__, threadNum);
+    }
+
 #ifdef ENABLE_WALLET
     // Each thread has its own key
     CReserveKey reservekey(pwallet);
 #endif
 
     miningTimer.clear();
+    StartMinerThreadStats(threadNum);
 
     const CChainParams& chainparams = Params();
     // Each thread has its own counter
@@ -4452,6 +4570,8 @@ void static BitcoinMiner_noeq()
                 pblock = &pblocktemplate->block;
             }
 
+            // when this thread took the template, which another thread may have made earlier
+            int64_t nTemplateTime = GetTimeMicros();
             uint32_t savebits;
             savebits = pblock->nBits;
 
@@ -4577,6 +4697,25 @@ void static BitcoinMiner_noeq()
             minefunction mine_verus;
             mine_verus = IsCPUVerusOptimized() ? &mine_verus_v2 : &mine_verus_v2_port;
 
+            // multi-lane hashing is only available for VerusHash 2.2 on optimized CPUs
+            // the single lane kernel is the AES one when the CPU has it, multi-lane kernels are chosen at startup
+            std::string strKernel = IsCPUVerusOptimized() ? "aes" : "portable";
+            if (IsCPUVerusOptimized() && vclh.verusclhashfunction == &verusclhash_sv2_2)
+            {
+                switch (GetArg("-minerlanes", 1))
+                {
+                    case VERUSHASH_LANES_4X:
+                        mine_verus = &mine_verus_v2_4x;
+                        strKernel = std::string(GetVerusCLHashKernelName()) + "-4x";
+                        break;
+                    case VERUSHASH_LANES_8X:
+                        mine_verus = &mine_verus_v2_8x;
+                        strKernel = std::string(GetVerusCLHashKernelName()) + "-8x";
+                        break;
+                }
+            }
+            SetMinerHashKernel(strKernel);
+
             while (true)
             {
                 uint256 hashResult = uint256();
@@ -4639,8 +4778,10 @@ void static BitcoinMiner_noeq()
                 else
                 {
                     // check NONCEMASK at a time
+                    int64_t nRoundStart = GetTimeMicros();
                     for (uint64_t i = 0; i < count; i++)
                     {
+                        nRoundStart = GetTimeMicros();
                         // this is the actual mining loop, which enables us to drop out and queue a header anytime we earn a block that is good enough for a
                         // merge mined block, but not our own
                         bool blockFound;
@@ -4743,9 +4884,9 @@ void static BitcoinMiner_noeq()
 #endif
                             printf("\n");
 #ifdef ENABLE_WALLET
-                            ProcessBlockFound(pblock, *pwallet, reservekey);
+                            ProcessBlockFound(pblock, *pwallet, reservekey, nTemplateTime);
 #else
-                            ProcessBlockFound(pblock);
+                            ProcessBlockFound(pblock, nTemplateTime);
 #endif
                             SetThreadPriority(THREAD_PRIORITY_LOWEST);
                             break;
@@ -4756,11 +4897,13 @@ void static BitcoinMiner_noeq()
                             // if we haven't broken out and will not drop through, update hashcount
                             {
                                 miningTimer += totalDone;
+                                RecordMinerHashes(threadNum, totalDone, GetTimeMicros() - nRoundStart);
                             }
                         }
                     }
 
                     miningTimer += totalDone;
+                    RecordMinerHashes(threadNum, totalDone, GetTimeMicros() - nRoundStart);
                 }
 
                 // Check for stop or if block needs to be rebuilt
@@ -4889,9 +5032,9 @@ void static BitcoinMiner_noeq()
 
         for (int i = 0; i < nThreads; i++) {
 #ifdef ENABLE_WALLET
-            minerThreads->create_thread(boost::bind(&BitcoinMiner_noeq, pwallet));
+            minerThreads->create_thread(boost::bind(&BitcoinMiner_noeq, pwallet, i));
 #else
-            minerThreads->create_thread(&BitcoinMiner_noeq);
+            minerThreads->create_thread(boost::bind(&BitcoinMiner_noeq, i));
 #endif
         }
     }
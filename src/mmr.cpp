@@ -7,6 +7,7 @@
  */
 
 #include "mmr.h"
+#include "crypto/blake2b_mb.h"
 
 // just used for setting breakpoints that may be hard to set and printing messages
 void ErrorAndBP(std::string msg)
@@ -15,6 +16,49 @@ void ErrorAndBP(std::string msg)
     LogPrintf("%s\n", msg.c_str());
 }
 
+template <>
+void CMMRNode<CBLAKE2bWriter>::CreateParentNodes(const CMMRNode<CBLAKE2bWriter> *pChildren, size_t count, CMMRNode<CBLAKE2bWriter> *pParents)
+{
+    // each pair of children is the 64 byte message of its parent
+    static_assert(sizeof(CMMRNode<CBLAKE2bWriter>) == BLAKE2B_MB_OUTPUT_SIZE, "MMR nodes must be exactly one hash");
+    Blake2b256Personal64(BLAKE2Bpersonal, (const unsigned char *)pChildren, (unsigned char *)pParents, count);
+}
+
+template <>
+void CMMRPowerNode<CBLAKE2bWriter>::CreateParentNodes(const CMMRPowerNode<CBLAKE2bWriter> *pChildren, size_t count, CMMRPowerNode<CBLAKE2bWriter> *pParents)
+{
+    if (!count)
+    {
+        return;
+    }
+
+    // hash all child pairs to get the pre hashes, then each pre hash with its power, as in CreateParentNode
+    std::vector<uint256> messages(count << 1);
+    std::vector<uint256> preHashes(count);
+    for (size_t i = 0; i < (count << 1); i++)
+    {
+        messages[i] = pChildren[i].hash;
+    }
+    Blake2b256Personal64(BLAKE2Bpersonal, messages[0].begin(), preHashes[0].begin(), count);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const CMMRPowerNode<CBLAKE2bWriter> &left = pChildren[i << 1], &right = pChildren[(i << 1) + 1];
+        arith_uint256 work = left.Work() + right.Work();
+        arith_uint256 stake = left.Stake() + right.Stake();
+        assert((work << 128 >> 128) == work && (stake << 128 >> 128) == stake);
+
+        pParents[i].power = ArithToUint256(stake << 128 | work);
+        messages[i << 1] = preHashes[i];
+        messages[(i << 1) + 1] = pParents[i].power;
+    }
+    Blake2b256Personal64(BLAKE2Bpersonal, messages[0].begin(), preHashes[0].begin(), count);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        pParents[i].hash = preHashes[i];
+    }
+}
 
 CMultiPartProof::CMultiPartProof(const std::vector<CMMRProof> &chunkVec) : CMerkleBranchBase(BRANCH_MULTIPART)
 {
@@ -96,6 +140,16 @@ void CMMRProof::DeleteProofSequenceEntry(int index)
                 delete (CMultiPartProof *)pProof;
                 break;
             }
+            case CMerkleBranchBase::BRANCH_MMRBLAKE_NODE_MULTILEAF:
+            {
+                delete (CMMRNodeMultiBranch *)pProof;
+                break;
+            }
+            case CMerkleBranchBase::BRANCH_MMRBLAKE_POWERNODE_MULTILEAF:
+            {
+                delete (CMMRPowerNodeMultiBranch *)pProof;
+                break;
+            }
             default:
             {
                 ErrorAndBP("ERROR: likely double-free or memory corruption, unrecognized object in proof sequence");
@@ -140,6 +194,16 @@ void CMMRProof::DeleteProofSequence()
                 delete (CMultiPartProof *)pProof;
                 break;
             }
+            case CMerkleBranchBase::BRANCH_MMRBLAKE_NODE_MULTILEAF:
+            {
+                delete (CMMRNodeMultiBranch *)pProof;
+                break;
+            }
+            case CMerkleBranchBase::BRANCH_MMRBLAKE_POWERNODE_MULTILEAF:
+            {
+                delete (CMMRPowerNodeMultiBranch *)pProof;
+                break;
+            }
             default:
             {
                 ErrorAndBP("ERROR: likely double-free or memory corruption, unrecognized object in proof sequence");
@@ -190,6 +254,22 @@ const CMMRProof &CMMRProof::operator<<(const CMultiPartProof &append)
     return *this;
 }
 
+const CMMRProof &CMMRProof::operator<<(const CMMRNodeMultiBranch &append)
+{
+    CMerkleBranchBase *pNewProof = new CMMRNodeMultiBranch(append);
+    pNewProof->branchType = CMerkleBranchBase::BRANCH_MMRBLAKE_NODE_MULTILEAF;
+    proofSequence.push_back(pNewProof);
+    return *this;
+}
+
+const CMMRProof &CMMRProof::operator<<(const CMMRPowerNodeMultiBranch &append)
+{
+    CMerkleBranchBase *pNewProof = new CMMRPowerNodeMultiBranch(append);
+    pNewProof->branchType = CMerkleBranchBase::BRANCH_MMRBLAKE_POWERNODE_MULTILEAF;
+    proofSequence.push_back(pNewProof);
+    return *this;
+}
+
 uint160 CMMRProof::GetNativeAddress() const
 {
     uint160 retAddress;
@@ -230,10 +310,15 @@ bool CMMRProof::CheckStorageKey(uint32_t height) const
     return false;
 }
 
-uint256 CMMRProof::CheckProof(uint256 hash, bool optimized) const
+// checks the branches from begin to end, each proving the result of the one before
+static uint256 CheckProofSequence(std::vector<CMerkleBranchBase *>::const_iterator begin,
+                                  std::vector<CMerkleBranchBase *>::const_iterator end,
+                                  uint256 hash,
+                                  bool optimized)
 {
-    for (auto &pProof : proofSequence)
+    for (auto it = begin; it != end; it++)
     {
+        CMerkleBranchBase *pProof = *it;
         switch(pProof->branchType)
         {
             case CMerkleBranchBase::BRANCH_BTC:
@@ -259,11 +344,135 @@ uint256 CMMRProof::CheckProof(uint256 hash, bool optimized) const
                 LogPrint("crosschain", "Result from ETHBranch check: %s\n", hash.GetHex().c_str());
                 break;
             }
+            case CMerkleBranchBase::BRANCH_MMRBLAKE_NODE_MULTILEAF:
+            case CMerkleBranchBase::BRANCH_MMRBLAKE_POWERNODE_MULTILEAF:
+            {
+                // proves more than one hash, see CheckMultiLeafProof
+                return uint256();
+            }
         }
     }
     return hash;
 }
 
+uint256 CMMRProof::CheckProof(uint256 hash, bool optimized) const
+{
+    return CheckProofSequence(proofSequence.begin(), proofSequence.end(), hash, optimized);
+}
+
+uint256 CMMRProof::CheckMultiLeafProof(const std::vector<uint256> &leafHashes, bool optimized) const
+{
+    if (!proofSequence.size())
+    {
+        return uint256();
+    }
+
+    uint256 hash;
+    switch(proofSequence[0]->branchType)
+    {
+        case CMerkleBranchBase::BRANCH_MMRBLAKE_NODE_MULTILEAF:
+        {
+            hash = ((CMMRNodeMultiBranch *)proofSequence[0])->SafeCheck(leafHashes);
+            break;
+        }
+        case CMerkleBranchBase::BRANCH_MMRBLAKE_POWERNODE_MULTILEAF:
+        {
+            hash = ((CMMRPowerNodeMultiBranch *)proofSequence[0])->SafeCheck(leafHashes);
+            break;
+        }
+        default:
+        {
+            return uint256();
+        }
+    }
+
+    if (hash.IsNull())
+    {
+        return hash;
+    }
+
+    // the rest of the sequence proves the root of the multi-leaf branch
+    return CheckProofSequence(proofSequence.begin() + 1, proofSequence.end(), hash, optimized);
+}
+
+CMMRViewShape::CMMRViewShape(uint64_t mmvSize)
+{
+    for (sizes.push_back(mmvSize), mmvSize >>= 1; mmvSize; mmvSize >>= 1)
+    {
+        sizes.push_back(mmvSize);
+    }
+
+    for (uint32_t ht = 0; ht < sizes.size(); ht++)
+    {
+        // if we're at the top or the layer above us is smaller than 1/2 the size of this layer, rounded up, we are a peak
+        if (sizes[ht] && (ht == ((uint32_t)sizes.size() - 1) || (sizes[ht] & 1)))
+        {
+            peakLayers.insert(peakLayers.begin(), ht);
+        }
+    }
+
+    // with an odd number of elements below, the edge passes through
+    for (uint64_t layerSize = peakLayers.size(); layerSize; layerSize = (layerSize == 1) ? 0 : (layerSize >> 1) + (layerSize & 1))
+    {
+        peakMerkleSizes.push_back(layerSize);
+    }
+}
+
+CMMRNodeRef CMMRViewShape::Root() const
+{
+    if (peakMerkleSizes.size() <= 1)
+    {
+        return peakLayers.size() ? CMMRNodeRef(false, peakLayers[0], sizes[peakLayers[0]] - 1) : CMMRNodeRef();
+    }
+    return CMMRNodeRef(true, peakMerkleSizes.size() - 1, 0);
+}
+
+void CMMRViewShape::LeafSpan(const CMMRNodeRef &node, uint64_t &begin, uint64_t &end) const
+{
+    if (node.inPeakMerkle)
+    {
+        // from the start of the first peak under this node to the end of the last
+        uint64_t firstPeak = node.index << node.layer;
+        uint64_t lastPeak = std::min((node.index + 1) << node.layer, (uint64_t)peakLayers.size()) - 1;
+        uint64_t ignore;
+        LeafSpan(CMMRNodeRef(false, peakLayers[firstPeak], sizes[peakLayers[firstPeak]] - 1), begin, ignore);
+        LeafSpan(CMMRNodeRef(false, peakLayers[lastPeak], sizes[peakLayers[lastPeak]] - 1), ignore, end);
+    }
+    else
+    {
+        begin = node.index << node.layer;
+        end = std::min((node.index + 1) << node.layer, sizes[0]);
+    }
+}
+
+int CMMRViewShape::Children(const CMMRNodeRef &node, CMMRNodeRef &left, CMMRNodeRef &right) const
+{
+    if (!node.inPeakMerkle)
+    {
+        if (!node.layer)
+        {
+            return 0;
+        }
+        left = CMMRNodeRef(false, node.layer - 1, node.index << 1);
+        right = CMMRNodeRef(false, node.layer - 1, (node.index << 1) + 1);
+        return 2;
+    }
+
+    // peak merkle layer 0 nodes are the peaks in the mountain range
+    uint32_t childLayer = node.layer - 1;
+    uint64_t leftIndex = node.index << 1;
+    auto childRef = [this, childLayer](uint64_t index) {
+        return childLayer ? CMMRNodeRef(true, childLayer, index) : CMMRNodeRef(false, peakLayers[index], sizes[peakLayers[index]] - 1);
+    };
+    left = childRef(leftIndex);
+    if (leftIndex + 1 < peakMerkleSizes[childLayer])
+    {
+        right = childRef(leftIndex + 1);
+        return 2;
+    }
+    return 1;
+}
+
 // return the index that would be generated for an mmv of the indicated size at the specified position
 uint64_t CMerkleBranchBase::GetMMRProofIndex(uint64_t pos, uint64_t mmvSize, int extrahashes)
 {
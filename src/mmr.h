@@ -20,11 +20,15 @@
 #define MMR_H
 
 #include <vector>
+#include <algorithm>
+#include <memory>
+#include <mutex>
 #include <univalue.h>
 
 
 #include "streams.h"
 #include "hash.h"
+#include "memusage.h"
 #include "arith_uint256.h"
 
 
@@ -75,6 +79,15 @@ public:
         return CMMRNode(hw.GetHash());
     }
 
+    // create the parents of count consecutive left, right pairs of nodes
+    static void CreateParentNodes(const CMMRNode *pChildren, size_t count, CMMRNode *pParents)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            pParents[i] = pChildren[i << 1].CreateParentNode(pChildren[(i << 1) + 1]);
+        }
+    }
+
     std::vector<uint256> GetProofHash(const CMMRNode &opposite) const
     {
         return {hash};
@@ -90,6 +103,10 @@ public:
         return 0;
     }
 };
+// BLAKE2b parents of a row are hashed together with the multi-buffer kernels
+template <>
+void CMMRNode<CBLAKE2bWriter>::CreateParentNodes(const CMMRNode<CBLAKE2bWriter> *pChildren, size_t count, CMMRNode<CBLAKE2bWriter> *pParents);
+
 typedef CMMRNode<CBLAKE2bWriter> CDefaultMMRNode;
 typedef CMMRNode<CKeccack256Writer> CDefaultETHNode;
 
@@ -158,6 +175,15 @@ public:
         return CMMRPowerNode(hw.GetHash(), nodePower);
     }
 
+    // create the parents of count consecutive left, right pairs of nodes
+    static void CreateParentNodes(const CMMRPowerNode *pChildren, size_t count, CMMRPowerNode *pParents)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            pParents[i] = pChildren[i << 1].CreateParentNode(pChildren[(i << 1) + 1]);
+        }
+    }
+
     std::vector<uint256> GetProofHash(const CMMRPowerNode &proving) const
     {
         return {hash, ArithToUint256((Stake() + proving.Stake()) << 128 | (Work() + proving.Work()))};
@@ -171,6 +197,9 @@ public:
         return 1;
     }
 };
+template <>
+void CMMRPowerNode<CBLAKE2bWriter>::CreateParentNodes(const CMMRPowerNode<CBLAKE2bWriter> *pChildren, size_t count, CMMRPowerNode<CBLAKE2bWriter> *pParents);
+
 typedef CMMRPowerNode<CBLAKE2bWriter> CDefaultMMRPowerNode;
 
 template <typename NODE_TYPE, int CHUNK_SHIFT = 9>
@@ -227,6 +256,38 @@ public:
         // printf("nodes.size(): %lu\n", nodes.size());
     }
 
+    // the most parents hashed in one call to NODE_TYPE::CreateParentNodes
+    static inline uint64_t parentBatchSize()
+    {
+        return 256;
+    }
+
+    // add the parents of every pair of nodes in the layer below that does not have one yet. when a layer is
+    // extended by many nodes at once, this hashes them in batches rather than one parent at a time
+    template <typename CHILD_LAYER>
+    void AddParents(const CHILD_LAYER &children)
+    {
+        uint64_t newSize = children.size() >> 1;
+        std::vector<NODE_TYPE> childNodes;
+        std::vector<NODE_TYPE> parentNodes;
+        while (vSize < newSize)
+        {
+            uint64_t first = vSize;
+            uint64_t count = std::min(newSize - first, parentBatchSize());
+            childNodes.resize(count << 1);
+            parentNodes.resize(count);
+            for (uint64_t i = 0; i < (count << 1); i++)
+            {
+                childNodes[i] = children[(first << 1) + i];
+            }
+            NODE_TYPE::CreateParentNodes(childNodes.data(), count, parentNodes.data());
+            for (auto &parent : parentNodes)
+            {
+                push_back(parent);
+            }
+        }
+    }
+
     void clear()
     {
         nodes.clear();
@@ -264,6 +325,16 @@ public:
     {
         printf("vSize: %lu, first vector size: %lu\n", vSize, vSize ? nodes[0].size() : vSize);
     }
+
+    size_t DynamicMemoryUsage() const
+    {
+        size_t usage = memusage::DynamicUsage(nodes);
+        for (auto &chunk : nodes)
+        {
+            usage += memusage::DynamicUsage(chunk);
+        }
+        return usage;
+    }
 };
 
 // NODE_TYPE must have a default constructor
@@ -301,6 +372,7 @@ public:
     void push_back(NODE_TYPE node) { vSize++; }
     void clear() { vSize = 0; }
     void resize(uint64_t newSize) { vSize = newSize; }
+    size_t DynamicMemoryUsage() const { return 0; }
 };
 
 class CMerkleBranchBase
@@ -314,7 +386,9 @@ public:
         BRANCH_MMRBLAKE_POWERNODE = 3,
         BRANCH_ETH = 4,
         BRANCH_MULTIPART = 5,
-        BRANCH_LAST = 5
+        BRANCH_MMRBLAKE_NODE_MULTILEAF = 6,
+        BRANCH_MMRBLAKE_POWERNODE_MULTILEAF = 7,
+        BRANCH_LAST = 7
     };
 
     uint8_t branchType;
@@ -419,6 +493,211 @@ public:
 typedef CMMRBranch<CBLAKE2bWriter> CMMRNodeBranch;
 typedef CMMRBranch<CBLAKE2bWriter, CMMRPowerNode<CBLAKE2bWriter>> CMMRPowerNodeBranch;
 
+// a node of the tree that proves elements of a merkle mountain view, either a node of the mountain range or of the
+// merkle tree over its peaks. the peaks themselves are always referred to as the mountain range nodes they are, so
+// a node in the peak merkle is always above layer 0
+class CMMRNodeRef
+{
+public:
+    bool inPeakMerkle;
+    uint32_t layer;
+    uint64_t index;
+
+    CMMRNodeRef(bool InPeakMerkle=false, uint32_t Layer=0, uint64_t Index=0) : inPeakMerkle(InPeakMerkle), layer(Layer), index(Index) {}
+};
+
+// the shape of the tree over a merkle mountain view of a specific size, which both the prover and verifier of a
+// multi-leaf proof walk in the same order
+class CMMRViewShape
+{
+public:
+    std::vector<uint64_t> sizes;            // size of each layer of the mountain range
+    std::vector<uint32_t> peakLayers;       // mountain range layer of each peak, from the largest on the left
+    std::vector<uint64_t> peakMerkleSizes;  // size of each layer of the peak merkle, the first being the peaks
+
+    CMMRViewShape(uint64_t mmvSize);
+
+    CMMRNodeRef Root() const;
+
+    // the positions of the elements under a node, from begin up to but not including end
+    void LeafSpan(const CMMRNodeRef &node, uint64_t &begin, uint64_t &end) const;
+
+    // returns the number of children of a node. the last node of an odd sized peak merkle layer passes through
+    // to the next layer unhashed, so it has only the left child
+    int Children(const CMMRNodeRef &node, CMMRNodeRef &left, CMMRNodeRef &right) const;
+
+    // walk the part of the tree that leads to the sorted, unique positions from first to last, depth first, left
+    // before right. subtrees with no positions are not entered
+    template <typename VISITOR>
+    bool Walk(const CMMRNodeRef &node, const uint64_t *first, const uint64_t *last, VISITOR &visitor, uint256 &hash) const
+    {
+        if (first == last)
+        {
+            return visitor.Pruned(node, hash);
+        }
+
+        CMMRNodeRef left, right;
+        int nChildren = Children(node, left, right);
+        if (nChildren == 0)
+        {
+            return visitor.Leaf(*first, hash);
+        }
+        if (nChildren == 1)
+        {
+            return Walk(left, first, last, visitor, hash);
+        }
+
+        uint64_t leftBegin, leftEnd;
+        LeafSpan(left, leftBegin, leftEnd);
+        const uint64_t *mid = std::lower_bound(first, last, leftEnd);
+
+        uint256 leftHash, rightHash;
+        return Walk(left, first, mid, visitor, leftHash) &&
+               Walk(right, mid, last, visitor, rightHash) &&
+               visitor.Parent(node, left, right, leftHash, rightHash, mid != last, hash);
+    }
+};
+
+// proves a set of elements of one merkle mountain view together. each hash that more than one of them would need
+// in a separate CMMRBranch is present only once, and hashes that can be calculated from the proven elements are
+// not present at all. the branch holds, in the order of a depth first walk of the view's tree, the hash of each
+// subtree without proven elements, the extra hashes of each proven leaf, and the extra hashes of each node above them
+template <typename HASHALGOWRITER=CBLAKE2bWriter, typename NODETYPE=CDefaultMMRNode>
+class CMMRMultiBranch : public CMerkleBranchBase
+{
+public:
+    uint32_t nSize;                 // size of the entire MMR, which is used to determine the correct paths
+    std::vector<uint32_t> nIndexes; // indexes of the proven elements, in ascending order
+    std::vector<uint256> branch;    // hashes not calculated from the proven elements
+
+    CMMRMultiBranch() : nSize(0) {}
+    CMMRMultiBranch(BRANCH_TYPE type) : CMerkleBranchBase(type), nSize(0) {}
+    CMMRMultiBranch(BRANCH_TYPE type, uint32_t size, const std::vector<uint32_t> &indexes, const std::vector<uint256> &b) :
+        CMerkleBranchBase(type), nSize(size), nIndexes(indexes), branch(b) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(*(CMerkleBranchBase *)this);
+        READWRITE(VARINT(nSize));
+
+        // indexes are ascending, so only the difference from the prior one is stored
+        uint32_t count = nIndexes.size();
+        READWRITE(VARINT(count));
+        if (ser_action.ForRead())
+        {
+            nIndexes.clear();
+            for (uint32_t i = 0, lastIndex = 0; i < count; i++)
+            {
+                uint32_t delta;
+                READWRITE(VARINT(delta));
+                lastIndex += delta;
+                nIndexes.push_back(lastIndex);
+            }
+        }
+        else
+        {
+            for (uint32_t i = 0; i < count; i++)
+            {
+                uint32_t delta = i ? nIndexes[i] - nIndexes[i - 1] : nIndexes[i];
+                READWRITE(VARINT(delta));
+            }
+        }
+        READWRITE(branch);
+    }
+
+    class CVerifier
+    {
+    public:
+        const CMMRMultiBranch &multiBranch;
+        const std::vector<uint256> &leafHashes;
+        size_t nextHash;
+        size_t nextLeaf;
+
+        CVerifier(const CMMRMultiBranch &MultiBranch, const std::vector<uint256> &LeafHashes) :
+            multiBranch(MultiBranch), leafHashes(LeafHashes), nextHash(0), nextLeaf(0) {}
+
+        bool AddExtraHashes(uint256 &hash)
+        {
+            for (int i = 0; i < NODETYPE::GetExtraHashCount(); i++)
+            {
+                if (nextHash >= multiBranch.branch.size())
+                {
+                    return false;
+                }
+                HASHALGOWRITER hw(SER_GETHASH, 0);
+                hw << hash;
+                hw << multiBranch.branch[nextHash++];
+                hash = hw.GetHash();
+            }
+            return true;
+        }
+
+        bool Pruned(const CMMRNodeRef &node, uint256 &hash)
+        {
+            if (nextHash >= multiBranch.branch.size())
+            {
+                return false;
+            }
+            hash = multiBranch.branch[nextHash++];
+            return true;
+        }
+
+        bool Leaf(uint64_t pos, uint256 &hash)
+        {
+            hash = leafHashes[nextLeaf++];
+            return AddExtraHashes(hash);
+        }
+
+        bool Parent(const CMMRNodeRef &node, const CMMRNodeRef &left, const CMMRNodeRef &right,
+                    const uint256 &leftHash, const uint256 &rightHash, bool rightProven, uint256 &hash)
+        {
+            // non canonical, as in CMMRBranch. a hash may be equal to the node on its left, but never on the right
+            if (rightProven && leftHash == rightHash)
+            {
+                return false;
+            }
+            HASHALGOWRITER hw(SER_GETHASH, 0);
+            hw << leftHash;
+            hw << rightHash;
+            hash = hw.GetHash();
+            return AddExtraHashes(hash);
+        }
+    };
+
+    // returns the root of the view for the hashes of the elements in nIndexes, in the same order, or null if the
+    // proof does not fit them
+    uint256 SafeCheck(const std::vector<uint256> &leafHashes) const
+    {
+        if (!nIndexes.size() || leafHashes.size() != nIndexes.size() || nIndexes.back() >= nSize)
+        {
+            return uint256();
+        }
+
+        std::vector<uint64_t> positions(nIndexes.begin(), nIndexes.end());
+        for (int i = 1; i < positions.size(); i++)
+        {
+            if (positions[i] <= positions[i - 1])
+            {
+                return uint256();
+            }
+        }
+
+        CMMRViewShape shape(nSize);
+        CVerifier verifier(*this, leafHashes);
+        uint256 hash;
+        if (!shape.Walk(shape.Root(), &positions[0], &positions[0] + positions.size(), verifier, hash) ||
+            verifier.nextHash != branch.size())
+        {
+            return uint256();
+        }
+        return hash;
+    }
+};
+typedef CMMRMultiBranch<CBLAKE2bWriter> CMMRNodeMultiBranch;
+typedef CMMRMultiBranch<CBLAKE2bWriter, CMMRPowerNode<CBLAKE2bWriter>> CMMRPowerNodeMultiBranch;
+
 
 // by default, this is compatible with normal merkle proofs with the existing
 // block merkle roots. different hash algorithms may be selected for performance,
@@ -565,7 +844,7 @@ public:
     }
 
     std::vector<unsigned char> verifyAccountProof();
-    std::vector<unsigned char> verifyProof(uint256& rootHash,std::vector<unsigned char> key,std::vector<std::vector<unsigned char>>& proof);
+    std::vector<unsigned char> verifyProof(const uint256 &rootHash, const std::vector<unsigned char> &key, const std::vector<std::vector<unsigned char>> &proof);
     uint256 verifyStorageProof(uint256 hash, bool optimizedProof);
     bool verifyStorageValue(std::vector<unsigned char> testStorageValue);
     bool CheckStorageKeyHash(uint32_t height) const; 
@@ -602,6 +881,14 @@ typedef CPATRICIABranch<> CETHPATRICIABranch;
 
 class RLP {
 public:
+    // a string item of an RLP encoding, which points into the encoded bytes and does not own them
+    struct rlpItem {
+        const unsigned char *data;
+        size_t size;
+        rlpItem() : data(nullptr), size(0) {}
+        rlpItem(const unsigned char *Data, size_t Size) : data(Data), size(Size) {}
+        std::vector<unsigned char> toVector() const { return std::vector<unsigned char>(data, data + size); }
+    };
     struct rlpDecoded {
         std::vector<std::vector<unsigned char>> data;
         std::vector<unsigned char> remainder; 
@@ -610,12 +897,17 @@ public:
     RLP(bool Optimized=true) : optimized(Optimized){};
     std::vector<unsigned char> encodeLength(int length,int offset);
     std::vector<unsigned char> encodeLength_deprecated(int length,int offset);
-    std::vector<unsigned char> encode(std::vector<unsigned char> input);
-    std::vector<unsigned char> encode(std::vector<std::vector<unsigned char>> input);
-    rlpDecoded decode(std::vector<unsigned char> inputBytes);
-    rlpDecoded decode(std::string inputString);
+    std::vector<unsigned char> encode(const std::vector<unsigned char> &input);
+    std::vector<unsigned char> encode(const std::vector<std::vector<unsigned char>> &input);
+
+    // decodes one item from inputBytes without copying, appending it, or all strings of a list and of any lists
+    // nested in it, to items. returns the offset at which the remainder starts
+    static size_t decodeItems(const unsigned char *inputBytes, size_t size, std::vector<rlpItem> &items);
+    rlpDecoded decode(const std::vector<unsigned char> &inputBytes);
+    rlpDecoded decode(const std::string &inputString);
 };
 
+// a view of a decoded Patricia trie node, which points into the proof bytes of the node
 class TrieNode {
 public: 
     enum nodeType{
@@ -623,24 +915,34 @@ public:
         LEAF,
         EXTENSION
     };
-    nodeType type;
-    std::vector<std::vector<unsigned char>> raw;
-    std::vector<unsigned char> key;
-    std::vector<unsigned char> value;
 
-    TrieNode(std::vector<std::vector<unsigned char>> rawNode) {
-        raw = rawNode;
-        type = setType();
-        setKey();
-        setValue();
-    }
+    // nibbles start through end - 1 of a byte array, high nibble first
+    struct nibbleView {
+        const unsigned char *data;
+        size_t start, end;
+        nibbleView() : data(nullptr), start(0), end(0) {}
+        nibbleView(const unsigned char *Data, size_t Start, size_t End) : data(Data), start(Start), end(End) {}
+        size_t size() const { return end - start; }
+        unsigned char operator[](size_t i) const
+        {
+            size_t n = start + i;
+            return (n & 1) ? data[n >> 1] & 0xf : data[n >> 1] >> 4;
+        }
+        // returns the number of in order matching nibbles
+        size_t matchingLength(const nibbleView &other) const
+        {
+            size_t i, maxLength = std::min(size(), other.size());
+            for (i = 0; i < maxLength && (*this)[i] == other[i]; i++) {}
+            return i;
+        }
+    };
 
-private: 
-    nodeType setType();
-    void setKey();
-    void setValue();
-};
+    nodeType type;
+    nibbleView key;
+    RLP::rlpItem value;
 
+    TrieNode(const std::vector<RLP::rlpItem> &rawNode);
+};
 
 // This class is used to break proofs into multiple parts and still store them in a CMMRProof object
 // that can be used to make a multipart CPartialTransactionProof
@@ -741,6 +1043,8 @@ public:
                         CMerkleBranchBase *pobj;
                         CETHPATRICIABranch *pETHBranch;
                         CMultiPartProof *pMultiProofBranch;
+                        CMMRNodeMultiBranch *pNodeMultiBranch;
+                        CMMRPowerNodeMultiBranch *pPowerNodeMultiBranch;
                     };
 
                     // non-error exception comes from the first try on each object. after this, it is an error
@@ -793,6 +1097,24 @@ public:
                             }
                             break;
                         }
+                        case CMerkleBranchBase::BRANCH_MMRBLAKE_NODE_MULTILEAF:
+                        {
+                            pNodeMultiBranch = new CMMRNodeMultiBranch();
+                            if (pNodeMultiBranch)
+                            {
+                                READWRITE(*pNodeMultiBranch);
+                            }
+                            break;
+                        }
+                        case CMerkleBranchBase::BRANCH_MMRBLAKE_POWERNODE_MULTILEAF:
+                        {
+                            pPowerNodeMultiBranch = new CMMRPowerNodeMultiBranch();
+                            if (pPowerNodeMultiBranch)
+                            {
+                                READWRITE(*pPowerNodeMultiBranch);
+                            }
+                            break;
+                        }
                         default:
                         {
                             printf("%s: ERROR: default case - proof sequence is likely corrupt, code %d\n", __func__, branchType);
@@ -856,6 +1178,16 @@ public:
                         READWRITE(*(CMultiPartProof *)pProof);
                         break;
                     }
+                    case CMerkleBranchBase::BRANCH_MMRBLAKE_NODE_MULTILEAF:
+                    {
+                        READWRITE(*(CMMRNodeMultiBranch *)pProof);
+                        break;
+                    }
+                    case CMerkleBranchBase::BRANCH_MMRBLAKE_POWERNODE_MULTILEAF:
+                    {
+                        READWRITE(*(CMMRPowerNodeMultiBranch *)pProof);
+                        break;
+                    }
                     default:
                     {
                         error = true;
@@ -873,16 +1205,158 @@ public:
     const CMMRProof &operator<<(const CMMRPowerNodeBranch &append);
     const CMMRProof &operator<<(const CETHPATRICIABranch &append);
     const CMMRProof &operator<<(const CMultiPartProof &append);
+    const CMMRProof &operator<<(const CMMRNodeMultiBranch &append);
+    const CMMRProof &operator<<(const CMMRPowerNodeMultiBranch &append);
     bool IsMultiPart() const
     {
         return proofSequence.size() == 1 && proofSequence[0]->branchType == CMerkleBranchBase::BRANCH_MULTIPART;
     }
     uint256 CheckProof(uint256 checkHash, bool optimized=true) const;
+    // for a proof that starts with a multi-leaf branch, returns the root of the whole sequence for the hashes of
+    // the elements proven by that branch, in the order of its indexes
+    uint256 CheckMultiLeafProof(const std::vector<uint256> &leafHashes, bool optimized=true) const;
     uint160 GetNativeAddress() const;
     bool CheckStorageKey(uint32_t height) const;
     UniValue ToUniValue() const;
 };
 
+// the peaks of a view of a merkle mountain range and the merkle tree over them, which are all that a view needs
+// beyond the layers of the range itself. once calculated this never changes, so it is shared by all views of the
+// same size until the range is truncated below that size
+template <typename NODE_TYPE>
+class CMerkleMountainPeaks
+{
+public:
+    std::vector<NODE_TYPE> peaks;                   // peaks, from the largest mountain to the smallest
+    std::vector<std::vector<NODE_TYPE>> peakMerkle; // layers of the peak merkle, with the root as the only entry of the last
+
+    CMerkleMountainPeaks() {}
+    CMerkleMountainPeaks(std::vector<NODE_TYPE> &&Peaks) : peaks(std::move(Peaks))
+    {
+        uint32_t layerNum = 0, layerSize = peaks.size();
+        if (!layerSize)
+        {
+            return;
+        }
+
+        // with an odd number of elements below, the edge passes through
+        for (bool passThrough = (layerSize & 1); layerNum == 0 || layerSize > 1; passThrough = (layerSize & 1), layerNum++)
+        {
+            peakMerkle.push_back(std::vector<NODE_TYPE>());
+
+            uint64_t i;
+            uint32_t layerIndex = layerNum ? layerNum - 1 : 0;      // layerNum is base 1
+
+            for (i = 0; i < (layerSize >> 1); i++)
+            {
+                if (layerNum)
+                {
+                    peakMerkle.back().push_back(peakMerkle[layerIndex][i << 1].CreateParentNode(peakMerkle[layerIndex][(i << 1) + 1]));
+                }
+                else
+                {
+                    peakMerkle.back().push_back(peaks[i << 1].CreateParentNode(peaks[(i << 1) + 1]));
+                }
+            }
+            if (passThrough)
+            {
+                if (layerNum)
+                {
+                    // pass the end of the prior layer through
+                    peakMerkle.back().push_back(peakMerkle[layerIndex].back());
+                }
+                else
+                {
+                    peakMerkle.back().push_back(peaks.back());
+                }
+            }
+            // each entry in the next layer should be either combined two of the prior layer, or a duplicate of the prior layer's end
+            layerSize = peakMerkle.back().size();
+        }
+    }
+};
+
+// the most recently used peak states of a mountain range, by view size, so that views of the same size, such as
+// repeated proofs against one notarization height, do not each recalculate them. it belongs to one range and is
+// not carried over when a range is copied
+template <typename NODE_TYPE>
+class CMerkleMountainPeakCache
+{
+public:
+    typedef std::shared_ptr<const CMerkleMountainPeaks<NODE_TYPE>> PeaksPtr;
+    static const size_t MAX_ENTRIES = 32;
+
+    CMerkleMountainPeakCache() {}
+    CMerkleMountainPeakCache(const CMerkleMountainPeakCache &) {}
+    CMerkleMountainPeakCache &operator=(const CMerkleMountainPeakCache &)
+    {
+        Clear();
+        return *this;
+    }
+
+    PeaksPtr Get(uint64_t viewSize)
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        for (auto it = entries.begin(); it != entries.end(); it++)
+        {
+            if (it->first == viewSize)
+            {
+                // move to the front, so the least recently used ones are evicted first
+                std::pair<uint64_t, PeaksPtr> entry = *it;
+                entries.erase(it);
+                entries.insert(entries.begin(), entry);
+                return entry.second;
+            }
+        }
+        return PeaksPtr();
+    }
+
+    void Put(uint64_t viewSize, const PeaksPtr &peaks)
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        for (auto it = entries.begin(); it != entries.end(); it++)
+        {
+            if (it->first == viewSize)
+            {
+                entries.erase(it);
+                break;
+            }
+        }
+        entries.insert(entries.begin(), std::make_pair(viewSize, peaks));
+        if (entries.size() > MAX_ENTRIES)
+        {
+            entries.pop_back();
+        }
+    }
+
+    // drop all peaks of views larger than the new size of the range. views that still hold them keep their copy
+    void Truncate(uint64_t newSize)
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        for (auto it = entries.begin(); it != entries.end(); )
+        {
+            if (it->first > newSize)
+            {
+                it = entries.erase(it);
+            }
+            else
+            {
+                it++;
+            }
+        }
+    }
+
+    void Clear()
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        entries.clear();
+    }
+
+private:
+    std::mutex cs;
+    std::vector<std::pair<uint64_t, PeaksPtr>> entries;
+};
+
 // an in memory MMR is represented by a vector of vectors of hashes, each being a layer of nodes of the binary tree, with the lowest layer
 // being the leaf nodes, and the layers above representing full layers in a mountain or when less than half the length of the layer below,
 // representing a peak.
@@ -892,6 +1366,7 @@ class CMerkleMountainRange
 public:
     std::vector<LAYER_TYPE> upperNodes;
     LAYER0_TYPE layer0;
+    mutable CMerkleMountainPeakCache<NODE_TYPE> peakCache;
 
     CMerkleMountainRange() {}
     CMerkleMountainRange(const LAYER0_TYPE &Layer0) : layer0(Layer0) {}
@@ -944,6 +1419,39 @@ public:
         return layer0.size() - 1;
     }
 
+    // add the parents of any leaves that were added to layer0 without them, such as by resizing an overlay layer0,
+    // one whole layer at a time
+    void AddParentNodes()
+    {
+        for (uint32_t height = 0; (height ? upperNodes[height - 1].size() : layer0.size()) > 1; height++)
+        {
+            if (height == upperNodes.size())
+            {
+                upperNodes.resize(upperNodes.size() + 1);
+            }
+            if (height)
+            {
+                upperNodes[height].AddParents(upperNodes[height - 1]);
+            }
+            else
+            {
+                upperNodes[height].AddParents(layer0);
+            }
+        }
+    }
+
+    // add a number of leaf nodes and return the index of the last one. this is much faster than adding them one
+    // at a time, as the new nodes of each layer are hashed together
+    uint64_t Add(const std::vector<NODE_TYPE> &leaves)
+    {
+        for (auto &leaf : leaves)
+        {
+            layer0.push_back(leaf);
+        }
+        AddParentNodes();
+        return layer0.size() - 1;
+    }
+
     // add a default node
     uint64_t Add()
     {
@@ -1011,6 +1519,8 @@ public:
         uint64_t curSize = size();
         if (newSize < curSize)
         {
+            peakCache.Truncate(newSize);
+
             uint64_t maxSize = size();
             if (newSize > maxSize)
             {
@@ -1033,6 +1543,25 @@ public:
             }
         }
     }
+
+    // remove all nodes, including any that were set directly rather than added
+    void Clear()
+    {
+        peakCache.Clear();
+        upperNodes.clear();
+        layer0.clear();
+    }
+
+    // the memory held by the layers, not counting the peak cache, which is bounded
+    size_t DynamicMemoryUsage() const
+    {
+        size_t usage = memusage::DynamicUsage(upperNodes) + layer0.DynamicMemoryUsage();
+        for (auto &layer : upperNodes)
+        {
+            usage += layer.DynamicMemoryUsage();
+        }
+        return usage;
+    }
 };
 
 // a view of a merkle mountain range with the size of the range set to a specific position that is less than or equal
@@ -1043,10 +1572,9 @@ class CMerkleMountainView
 public:
     const CMerkleMountainRange<NODE_TYPE, LAYER_TYPE, LAYER0_TYPE> &mmr; // the underlying mountain range, which provides the hash vectors
     std::vector<uint64_t> sizes;                    // sizes that we will use as proxies for the size of each vector at each height
-    std::vector<NODE_TYPE> peaks;                   // peaks
-    std::vector<std::vector<NODE_TYPE>> peakMerkle; // cached layers for the peak merkle if needed
+    std::shared_ptr<const CMerkleMountainPeaks<NODE_TYPE>> peakState; // peaks and peak merkle, shared with other views of this size
 
-    CMerkleMountainView(const CMerkleMountainRange<NODE_TYPE, LAYER_TYPE, LAYER0_TYPE> &mountainRange, uint64_t viewSize=0) : mmr(mountainRange), peaks(), peakMerkle()
+    CMerkleMountainView(const CMerkleMountainRange<NODE_TYPE, LAYER_TYPE, LAYER0_TYPE> &mountainRange, uint64_t viewSize=0) : mmr(mountainRange)
     {
         uint64_t maxSize = mountainRange.size();
         if (viewSize > maxSize || viewSize == 0)
@@ -1083,6 +1611,12 @@ public:
             sizes.push_back(viewSize);
             viewSize >>= 1;
         }
+
+        // a copy of the same size shares the peaks that are already calculated
+        if (size() == mountainView.size())
+        {
+            peakState = mountainView.peakState;
+        }
     }
 
     // how many elements are stored in this view
@@ -1094,13 +1628,17 @@ public:
 
     void CalcPeaks(bool force = false)
     {
-        // if we don't yet have calculated peaks, calculate them
-        if (force || (peaks.size() == 0 && size() != 0))
+        // if we don't yet have calculated peaks, get them from the range if another view of this size has
+        // calculated them, or calculate them once and share them
+        if (force || !peakState)
         {
-            // reset the peak merkle tree, in case this is forced
-            peaks.clear();
-            peakMerkle.clear();
-            for (int ht = 0; ht < sizes.size(); ht++)
+            if (!force && size() != 0 && (peakState = mmr.peakCache.Get(size())))
+            {
+                return;
+            }
+
+            std::vector<NODE_TYPE> peaks;
+            for (int ht = 0; ht < sizes.size() && size() != 0; ht++)
             {
                 // if we're at the top or the layer above us is smaller than 1/2 the size of this layer, rounded up, we are a peak
                 if (ht == (sizes.size() - 1) || sizes[ht + 1] < ((sizes[ht] + 1) >> 1))
@@ -1108,6 +1646,11 @@ public:
                     peaks.insert(peaks.begin(), mmr.GetNode(ht, sizes[ht] - 1));
                 }
             }
+            peakState = std::make_shared<const CMerkleMountainPeaks<NODE_TYPE>>(std::move(peaks));
+            if (size() != 0)
+            {
+                mmr.peakCache.Put(size(), peakState);
+            }
         }
     }
 
@@ -1115,9 +1658,9 @@ public:
     {
         if (newSize != size())
         {
+            // other views may still be using the old peaks, so we only let go of them
             sizes.clear();
-            peaks.clear();
-            peakMerkle.clear();
+            peakState.reset();
 
             uint64_t maxSize = mmr.size();
             if (newSize > maxSize)
@@ -1144,60 +1687,13 @@ public:
     const std::vector<NODE_TYPE> &GetPeaks()
     {
         CalcPeaks();
-        return peaks;
+        return peakState->peaks;
     }
 
     uint256 GetRoot()
     {
-        uint256 rootHash;
-
-        if (size() > 0 && peakMerkle.size() == 0)
-        {
-            // get peaks and hash to a root
-            CalcPeaks();
-
-            uint32_t layerNum = 0, layerSize = peaks.size();
-            // with an odd number of elements below, the edge passes through
-            for (bool passThrough = (layerSize & 1); layerNum == 0 || layerSize > 1; passThrough = (layerSize & 1), layerNum++)
-            {
-                peakMerkle.push_back(std::vector<NODE_TYPE>());
-
-                uint64_t i;
-                uint32_t layerIndex = layerNum ? layerNum - 1 : 0;      // layerNum is base 1
-
-                for (i = 0; i < (layerSize >> 1); i++)
-                {
-                    if (layerNum)
-                    {
-                        peakMerkle.back().push_back(peakMerkle[layerIndex][i << 1].CreateParentNode(peakMerkle[layerIndex][(i << 1) + 1]));
-                    }
-                    else
-                    {
-                        peakMerkle.back().push_back(peaks[i << 1].CreateParentNode(peaks[(i << 1) + 1]));
-                    }
-                }
-                if (passThrough)
-                {
-                    if (layerNum)
-                    {
-                        // pass the end of the prior layer through
-                        peakMerkle.back().push_back(peakMerkle[layerIndex].back());
-                    }
-                    else
-                    {
-                        peakMerkle.back().push_back(peaks.back());
-                    }
-                }
-                // each entry in the next layer should be either combined two of the prior layer, or a duplicate of the prior layer's end
-                layerSize = peakMerkle.back().size();
-            }
-            rootHash = peakMerkle.back()[0].hash;
-        }
-        else if (peakMerkle.size() > 0)
-        {
-            rootHash = peakMerkle.back()[0].hash;
-        }
-        return rootHash;
+        CalcPeaks();
+        return peakState->peakMerkle.size() ? peakState->peakMerkle.back()[0].hash : uint256();
     }
 
     const NODE_TYPE *GetRootNode()
@@ -1206,7 +1702,7 @@ public:
         uint256 root = GetRoot();
         if (!root.IsNull())
         {
-            return &(peakMerkle.back()[0]);
+            return &(peakState->peakMerkle.back()[0]);
         }
         else
         {
@@ -1247,6 +1743,8 @@ public:
         {
             // just make sure the peakMerkle tree is calculated
             GetRoot();
+            const std::vector<NODE_TYPE> &peaks = peakState->peaks;
+            const std::vector<std::vector<NODE_TYPE>> &peakMerkle = peakState->peakMerkle;
 
             // if we have leaf information, add it
             std::vector<uint256> toAdd = mmr.layer0[pos].GetLeafHash();
@@ -1355,6 +1853,86 @@ public:
         return false;
     }
 
+    uint8_t GetMultiLeafBranchType(const CDefaultMMRNode &overload)
+    {
+        return CMerkleBranchBase::BRANCH_MMRBLAKE_NODE_MULTILEAF;
+    }
+
+    uint8_t GetMultiLeafBranchType(const CDefaultMMRPowerNode &overload)
+    {
+        return CMerkleBranchBase::BRANCH_MMRBLAKE_POWERNODE_MULTILEAF;
+    }
+
+    // walks the tree of this view for a multi-leaf proof, adding the hashes the verifier cannot calculate
+    class CMultiLeafProver
+    {
+    public:
+        CMerkleMountainView &mmv;
+        std::vector<uint256> &branch;
+
+        CMultiLeafProver(CMerkleMountainView &MMV, std::vector<uint256> &Branch) : mmv(MMV), branch(Branch) {}
+
+        NODE_TYPE GetNode(const CMMRNodeRef &node) const
+        {
+            return node.inPeakMerkle ? mmv.peakState->peakMerkle[node.layer - 1][node.index] : mmv.mmr.GetNode(node.layer, node.index);
+        }
+
+        bool Pruned(const CMMRNodeRef &node, uint256 &hash)
+        {
+            hash = GetNode(node).hash;
+            branch.push_back(hash);
+            return true;
+        }
+
+        bool Leaf(uint64_t pos, uint256 &hash)
+        {
+            NODE_TYPE leaf = mmv.mmr.GetNode(0, pos);
+            std::vector<uint256> toAdd = leaf.GetLeafHash();
+            branch.insert(branch.end(), toAdd.begin(), toAdd.end());
+            hash = leaf.hash;
+            return true;
+        }
+
+        bool Parent(const CMMRNodeRef &node, const CMMRNodeRef &left, const CMMRNodeRef &right,
+                    const uint256 &leftHash, const uint256 &rightHash, bool rightProven, uint256 &hash)
+        {
+            // the first proof hash is the hash of the sibling, which the verifier calculates
+            std::vector<uint256> proofHashes = GetNode(left).GetProofHash(GetNode(right));
+            branch.insert(branch.end(), proofHashes.begin() + 1, proofHashes.end());
+            hash = GetNode(node).hash;
+            return true;
+        }
+    };
+
+    // return one proof of all elements at "positions", which is smaller than a separate proof of each, as their
+    // paths to the root share nodes
+    bool GetMultiLeafProof(CMMRProof &retProof, std::vector<uint64_t> positions)
+    {
+        std::sort(positions.begin(), positions.end());
+        positions.erase(std::unique(positions.begin(), positions.end()), positions.end());
+        if (!positions.size() || positions.back() >= size())
+        {
+            return false;
+        }
+
+        CalcPeaks();
+
+        CMMRMultiBranch<HASHALGOWRITER, NODE_TYPE> retBranch;
+        CMultiLeafProver prover(*this, retBranch.branch);
+        CMMRViewShape shape(size());
+        uint256 rootHash;
+        if (!shape.Walk(shape.Root(), &positions[0], &positions[0] + positions.size(), prover, rootHash))
+        {
+            return false;
+        }
+
+        retBranch.branchType = GetMultiLeafBranchType(NODE_TYPE());
+        retBranch.nSize = size();
+        retBranch.nIndexes.insert(retBranch.nIndexes.end(), positions.begin(), positions.end());
+        retProof << retBranch;
+        return true;
+    }
+
     // return a vector of the bits, either 1 or 0 in each byte, to represent both the size
     // of the proof by the size of the vector, and the expected bit in each position for the given
     // position in a Merkle Mountain View of the specified size
@@ -15,6 +15,7 @@
 #include "clientversion.h"
 #include "primitives/transaction.h"
 #include "scheduler.h"
+#include "trace.h"
 #include "ui_interface.h"
 #include "crypto/common.h"
 #include "tls/utiltls.h"
@@ -24,6 +25,11 @@
 #else
 #include <fcntl.h>
 #endif
+#if defined(HAVE_SYS_EPOLL_H)
+#include <sys/epoll.h>
+#elif defined(HAVE_SYS_EVENT_H)
+#include <sys/event.h>
+#endif
 
 #include <boost/filesystem.hpp>
 #include <boost/thread.hpp>
@@ -92,6 +98,7 @@ uint64_t nLocalHostNonce = 0;
 static std::vector<ListenSocket> vhListenSocket;
 CAddrMan addrman;
 int nMaxConnections = DEFAULT_MAX_PEER_CONNECTIONS;
+SocketEventsMode nSocketEventsMode = DEFAULT_SOCKETEVENTS;
 bool fAddressesInitialized = false;
 TLSManager tlsmanager = TLSManager();
 std::atomic<bool> fNetworkActive = { true };
@@ -361,6 +368,25 @@ uint64_t CNode::nTotalBytesRecv = 0;
 uint64_t CNode::nTotalBytesSent = 0;
 CCriticalSection CNode::cs_totalBytesRecv;
 CCriticalSection CNode::cs_totalBytesSent;
+CCriticalSection CNode::cs_totalMessageTypes;
+CNetMessageTypeStatsMap CNode::mapTotalSentByType;
+CNetMessageTypeStatsMap CNode::mapTotalRecvByType;
+
+const std::string NET_MESSAGE_TYPE_OTHER = "other";
+
+// every message type this node sends or processes
+static const std::set<std::string> setNetMessageTypes = {
+    "addr", "alert", "block", "blocktxn", "cfcheckpt", "cfheaders", "cfilter", "cmpctblock", "filteradd", "filterclear",
+    "filterload", "getaddr", "getblocks", "getblocktxn", "getcfcheckpt", "getcfheaders", "getcfilters", "getdata",
+    "getheaders", "headers", "inv", "mempool", "merkleblock", "notfound", "ping", "pong", "reconcil", "reject",
+    "reqrecon", "sendcmpct", "sendrecon", "tx", "verack", "version"
+};
+
+const std::string &GetNetMessageTypeKey(const std::string &command)
+{
+    std::set<std::string>::const_iterator it = setNetMessageTypes.find(command);
+    return it == setNetMessageTypes.end() ? NET_MESSAGE_TYPE_OTHER : *it;
+}
 
 CNode* FindNode(const CNetAddr& ip)
 {
@@ -424,8 +450,8 @@ CNode* ConnectNode(CAddress addrConnect, const char *pszDest)
     if (pszDest ? ConnectSocketByName(addrConnect, hSocket, pszDest, Params().GetDefaultPort(), nConnectTimeout, &proxyConnectionFailed) :
                   ConnectSocket(addrConnect, hSocket, nConnectTimeout, &proxyConnectionFailed))
     {
-        if (!IsSelectableSocket(hSocket)) {
-            LogPrintf("Cannot create connection: non-selectable socket created (fd >= FD_SETSIZE ?)\n");
+        if (!IsPollableSocket(hSocket)) {
+            LogPrintf("Cannot create connection: non-selectable socket created (fd >= FD_SETSIZE with -socketevents=select ?)\n");
             CloseSocket(hSocket);
             return NULL;
         }
@@ -752,6 +778,12 @@ void CNode::copyStats(CNodeStats &stats)
     stats.m_addr_processed = m_addr_processed.load();
     stats.m_addr_rate_limited = m_addr_rate_limited.load();
 
+    {
+        LOCK(cs_msgTypeStats);
+        stats.mapSentByType = mapSentByType;
+        stats.mapRecvByType = mapRecvByType;
+    }
+
     // Leave string empty if addrLocal invalid (not filled in yet)
     stats.addrLocal = addrLocal.IsValid() ? addrLocal.ToString() : "";
 
@@ -795,7 +827,8 @@ bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes)
 
         if (msg.complete()) {
             msg.nTime = GetTimeMicros();
-            messageHandlerCondition.notify_one();
+            RecordMessageRecv(msg.hdr.GetCommand(), msg.hdr.nMessageSize + CMessageHeader::HEADER_SIZE);
+            messageHandlerCondition.notify_all();
         }
     }
 
@@ -853,11 +886,12 @@ int CNetMessage::readData(const char *pch, unsigned int nBytes)
 // requires LOCK(cs_vSend)
 void SocketSendData(CNode *pnode)
 {
-    std::deque<CSerializeData>::iterator it = pnode->vSendMsg.begin();
+    std::deque<CSharedMessage>::iterator it = pnode->vSendMsg.begin();
+    std::deque<int64_t>::iterator itQueueTime = pnode->vSendMsgQueueTime.begin();
 
     while (it != pnode->vSendMsg.end())
     {
-        const CSerializeData &data = *it;
+        const CSerializeData &data = **it;
         assert(data.size() > pnode->nSendOffset);
 
         bool bIsSSL = false;
@@ -873,6 +907,9 @@ void SocketSendData(CNode *pnode)
 
             bIsSSL = (pnode->ssl != NULL);
 
+            // cleared before the write, so that a writable event arriving while it blocks is never overwritten
+            pnode->fSocketWritable = false;
+
             if (bIsSSL)
             {
                 ERR_clear_error(); // clear the error queue, otherwise we may be reading an old error that occurred previously in the current thread
@@ -893,9 +930,12 @@ void SocketSendData(CNode *pnode)
             pnode->RecordBytesSent(nBytes);
             if (pnode->nSendOffset == data.size())
             {
+                pnode->fSocketWritable = true;
                 pnode->nSendOffset = 0;
                 pnode->nSendSize -= data.size();
+                pnode->RecordMessageSent(data, GetTimeMicros() - *itQueueTime);
                 it++;
+                itQueueTime++;
             }
             else
             {
@@ -944,6 +984,7 @@ void SocketSendData(CNode *pnode)
         assert(pnode->nSendSize == 0);
     }
     pnode->vSendMsg.erase(pnode->vSendMsg.begin(), it);
+    pnode->vSendMsgQueueTime.erase(pnode->vSendMsgQueueTime.begin(), itQueueTime);
 }
 
 static list<CNode*> vNodesDisconnected;
@@ -1134,6 +1175,39 @@ static bool AttemptToEvictConnection(bool fPreferNewConnection) {
     return true;
 }
 
+static void AddInboundNode(SOCKET hSocket, const CAddress& addr, SSL* ssl, bool whitelisted, bool fSocketEventsAdded = false)
+{
+    CNode* pnode = new CNode(hSocket, addr, "", true, ssl);
+    pnode->AddRef();
+    pnode->fWhitelisted = whitelisted;
+    pnode->fSocketEventsAdded = fSocketEventsAdded;
+
+    LogPrint("net", "connection from %s accepted\n", addr.ToString());
+
+    {
+        LOCK(cs_vNodes);
+        vNodes.push_back(pnode);
+    }
+}
+
+#if defined(USE_TLS)
+// an inbound TLS handshake in progress. it is stepped by ThreadSocketHandler on every pass instead of being waited for,
+// so that a slow or silent client holds up neither the socket loop nor other connections
+struct CPendingTLSAccept
+{
+    SOCKET hSocket;
+    SSL* ssl;
+    CAddress addr;
+    bool fWhitelisted;
+    bool fFallbackNonTLS;
+    bool fSocketEventsAdded;
+    int64_t nStart;
+};
+
+// only used by ThreadSocketHandler
+static std::list<CPendingTLSAccept> lPendingTLSAccepts;
+#endif // USE_TLS
+
 static void AcceptConnection(const ListenSocket& hListenSocket) {
     struct sockaddr_storage sockaddr;
     socklen_t len = sizeof(sockaddr);
@@ -1163,6 +1237,15 @@ static void AcceptConnection(const ListenSocket& hListenSocket) {
             }
         }
     }
+#if defined(USE_TLS)
+    // connections still in their handshake count as well, or a burst of them could exceed the limits
+    BOOST_FOREACH(const CPendingTLSAccept& pending, lPendingTLSAccepts)
+    {
+        nInbound++;
+        if (pending.addr == addr)
+            nInboundThisIP++;
+    }
+#endif
 
     if (hSocket == INVALID_SOCKET)
     {
@@ -1172,7 +1255,7 @@ static void AcceptConnection(const ListenSocket& hListenSocket) {
         return;
     }
 
-    if (!IsSelectableSocket(hSocket))
+    if (!IsPollableSocket(hSocket))
     {
         LogPrintf("connection from %s dropped: non-selectable socket\n", addr.ToString());
         CloseSocket(hSocket);
@@ -1213,12 +1296,12 @@ static void AcceptConnection(const ListenSocket& hListenSocket) {
     setsockopt(hSocket, IPPROTO_TCP, TCP_NODELAY, (void*)&set, sizeof(int));
 #endif
 
-SSL *ssl = NULL;
-
 SetSocketNonBlocking(hSocket, true);
 
 #ifdef USE_TLS
 /* TCP connection is ready. Do server side SSL. */
+bool bUseTLS = true;
+bool bTlsEnforcement = true;
 if (CNode::GetTlsFallbackNonTls())
 {
     LOCK(cs_vNonTLSNodesInbound);
@@ -1227,38 +1310,12 @@ if (CNode::GetTlsFallbackNonTls())
 
     NODE_ADDR nodeAddr(addr.ToStringIP());
 
-    bool bUseTLS = !GetBoolArg("-tlsdisable", false);
-    bool bTlsEnforcement = bUseTLS && (GetBoolArg("-tlsenforcement", true) || GetArg("-tlsenforcement", "") == "1");
+    bUseTLS = !GetBoolArg("-tlsdisable", false);
+    bTlsEnforcement = bUseTLS && (GetBoolArg("-tlsenforcement", true) || GetArg("-tlsenforcement", "") == "1");
     bUseTLS = bUseTLS && (find(vNonTLSNodesInbound.begin(),
                             vNonTLSNodesInbound.end(),
                             nodeAddr) == vNonTLSNodesInbound.end());
-    unsigned long err_code = 0;
-    if (bUseTLS)
-    {
-        ssl = tlsmanager.accept( hSocket, addr, err_code);
-        if(!ssl)
-        {
-            if (err_code == TLSManager::SELECT_TIMEDOUT)
-            {
-                // can fail also for timeout in select on fd, that is not a ssl error and we should not
-                // consider this node as non TLS
-                LogPrint("tls", "%s():%d - Connection from %s timedout\n", __func__, __LINE__, addr.ToStringIP());
-            }
-            else
-            {
-                //Do not allow unencrypted connection if TLS Enforcement is set
-                if (!bTlsEnforcement) {
-                    // Further reconnection will be made in non-TLS (unencrypted) mode
-                    vNonTLSNodesInbound.push_back(NODE_ADDR(addr.ToStringIP(), GetTimeMillis()));
-                    LogPrint("tls", "%s():%d - err_code %x, adding connection from %s vNonTLSNodesInbound list (sz=%d)\n",
-                        __func__, __LINE__, err_code, addr.ToStringIP(), vNonTLSNodesInbound.size());
-                }
-            }
-            CloseSocket(hSocket);
-            return;
-        }
-    }
-    else
+    if (!bUseTLS)
     {
         LogPrintf ("TLS: Connection from %s will be unencrypted\n", addr.ToStringIP());
 
@@ -1271,47 +1328,88 @@ if (CNode::GetTlsFallbackNonTls())
                 vNonTLSNodesInbound.end());
     }
 }
-else
+
+if (bUseTLS)
 {
+    // the handshake is stepped by ThreadSocketHandler, see ProcessPendingTLSAccepts
     unsigned long err_code = 0;
-    ssl = tlsmanager.accept( hSocket, addr, err_code);
-    if(!ssl)
+    SSL *ssl = tlsmanager.startAccept(hSocket, addr, err_code);
+    if (!ssl)
     {
         LogPrint("tls", "%s():%d - err_code %x, failure accepting connection from %s\n",
             __func__, __LINE__, err_code, addr.ToStringIP());
         CloseSocket(hSocket);
         return;
     }
+    CPendingTLSAccept pending;
+    pending.hSocket = hSocket;
+    pending.ssl = ssl;
+    pending.addr = addr;
+    pending.fWhitelisted = whitelisted;
+    pending.fFallbackNonTLS = CNode::GetTlsFallbackNonTls() && !bTlsEnforcement;
+    pending.fSocketEventsAdded = false;
+    pending.nStart = GetTimeMillis();
+    lPendingTLSAccepts.push_back(pending);
+    return;
 }
+#endif // USE_TLS
 
-// certificate validation is disabled by default
-if (CNode::GetTlsValidate())
-{
-    if (ssl && !ValidatePeerCertificate(ssl))
-    {
-        LogPrintf ("TLS: ERROR: Wrong client certificate from %s. Connection will be closed.\n", addr.ToString());
-
-        SSL_shutdown(ssl);
-        CloseSocket(hSocket);
-        SSL_free(ssl);
-        return;
-    }
+    AddInboundNode(hSocket, addr, NULL, whitelisted);
 }
-#endif // USE_TLS
 
-    CNode* pnode = new CNode(hSocket, addr, "", true, ssl);
-    pnode->AddRef();
-    pnode->fWhitelisted = whitelisted;
+#if defined(USE_TLS)
+static void ProcessPendingTLSAccepts()
+{
+    std::list<CPendingTLSAccept>::iterator it = lPendingTLSAccepts.begin();
+    while (it != lPendingTLSAccepts.end())
+    {
+        unsigned long err_code = 0;
+        int ret = tlsmanager.continueHandshake(SSL_ACCEPT, it->ssl, it->addr, err_code);
+        if (ret == 0 && GetTimeMillis() - it->nStart < DEFAULT_CONNECT_TIMEOUT)
+        {
+            it++;
+            continue;
+        }
 
-    LogPrint("net", "connection from %s accepted\n", addr.ToString());
+        if (ret == 1)
+        {
+            // certificate validation is disabled by default
+            if (CNode::GetTlsValidate() && !ValidatePeerCertificate(it->ssl))
+            {
+                LogPrintf ("TLS: ERROR: Wrong client certificate from %s. Connection will be closed.\n", it->addr.ToString());
 
-    {
-        LOCK(cs_vNodes);
-        vNodes.push_back(pnode);
+                SSL_shutdown(it->ssl);
+                CloseSocket(it->hSocket);
+                SSL_free(it->ssl);
+            }
+            else
+            {
+                AddInboundNode(it->hSocket, it->addr, it->ssl, it->fWhitelisted, it->fSocketEventsAdded);
+            }
+        }
+        else
+        {
+            if (ret == 0)
+            {
+                // can fail also for timeout in select on fd, that is not a ssl error and we should not
+                // consider this node as non TLS
+                LogPrint("tls", "%s():%d - Connection from %s timedout\n", __func__, __LINE__, it->addr.ToStringIP());
+            }
+            else if (it->fFallbackNonTLS)
+            {
+                // Further reconnection will be made in non-TLS (unencrypted) mode
+                LOCK(cs_vNonTLSNodesInbound);
+                vNonTLSNodesInbound.push_back(NODE_ADDR(it->addr.ToStringIP(), GetTimeMillis()));
+                LogPrint("tls", "%s():%d - err_code %x, adding connection from %s vNonTLSNodesInbound list (sz=%d)\n",
+                    __func__, __LINE__, err_code, it->addr.ToStringIP(), vNonTLSNodesInbound.size());
+            }
+            SSL_free(it->ssl);
+            CloseSocket(it->hSocket);
+        }
+        it = lPendingTLSAccepts.erase(it);
     }
 }
 
-#if defined(USE_TLS)
 void ThreadNonTLSPoolsCleaner()
 {
     while (true)
@@ -1324,9 +1422,198 @@ void ThreadNonTLSPoolsCleaner()
 
 #endif // USE_TLS
 
+bool ParseSocketEventsMode(const std::string& strMode, SocketEventsMode& mode)
+{
+    if (strMode == "select")
+        mode = SOCKETEVENTS_SELECT;
+#if defined(HAVE_SYS_EPOLL_H)
+    else if (strMode == "epoll")
+        mode = SOCKETEVENTS_EPOLL;
+#endif
+#if defined(HAVE_SYS_EVENT_H)
+    else if (strMode == "kqueue")
+        mode = SOCKETEVENTS_KQUEUE;
+#endif
+    else
+        return false;
+    return true;
+}
+
+std::string SocketEventsModeName(SocketEventsMode mode)
+{
+    switch (mode)
+    {
+        case SOCKETEVENTS_EPOLL:
+            return "epoll";
+        case SOCKETEVENTS_KQUEUE:
+            return "kqueue";
+        default:
+            return "select";
+    }
+}
+
+bool IsPollableSocket(SOCKET hSocket)
+{
+    return nSocketEventsMode != SOCKETEVENTS_SELECT || IsSelectableSocket(hSocket);
+}
+
+// readiness notification for ThreadSocketHandler through epoll or kqueue, a descriptor is watched until it is closed
+class CSocketEvents
+{
+private:
+    int hEvents;
+
+public:
+    enum
+    {
+        EVENT_RECV = 1,
+        EVENT_SEND = 2,
+        EVENT_ERROR = 4,
+    };
+
+    CSocketEvents(SocketEventsMode mode) : hEvents(-1)
+    {
+#if defined(HAVE_SYS_EPOLL_H)
+        if (mode == SOCKETEVENTS_EPOLL)
+            hEvents = epoll_create1(EPOLL_CLOEXEC);
+#elif defined(HAVE_SYS_EVENT_H)
+        if (mode == SOCKETEVENTS_KQUEUE)
+            hEvents = kqueue();
+#endif
+    }
+
+    ~CSocketEvents()
+    {
+#if defined(HAVE_SYS_EPOLL_H) || defined(HAVE_SYS_EVENT_H)
+        if (hEvents >= 0)
+            close(hEvents);
+#endif
+    }
+
+    bool IsValid() const
+    {
+        return hEvents >= 0;
+    }
+
+    // an edge triggered socket is only reported again after new data or buffer space arrives
+    bool Add(SOCKET hSocket, bool fEdgeTriggered)
+    {
+#if defined(HAVE_SYS_EPOLL_H)
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = fEdgeTriggered ? (EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET) : EPOLLIN;
+        ev.data.fd = hSocket;
+        return epoll_ctl(hEvents, EPOLL_CTL_ADD, hSocket, &ev) == 0;
+#elif defined(HAVE_SYS_EVENT_H)
+        struct kevent ev[2];
+        EV_SET(&ev[0], hSocket, EVFILT_READ, EV_ADD | (fEdgeTriggered ? EV_CLEAR : 0), 0, 0, NULL);
+        EV_SET(&ev[1], hSocket, EVFILT_WRITE, EV_ADD | EV_CLEAR, 0, 0, NULL);
+        return kevent(hEvents, ev, fEdgeTriggered ? 2 : 1, NULL, 0, NULL) == 0;
+#else
+        return false;
+#endif
+    }
+
+    // waits up to nTimeout milliseconds and returns the sockets that have events with what happened on each
+    int Wait(int64_t nTimeout, std::vector<std::pair<SOCKET, int>>& vEvents)
+    {
+        vEvents.clear();
+#if defined(HAVE_SYS_EPOLL_H)
+        struct epoll_event events[MAX_SOCKET_EVENTS];
+        int nEvents = epoll_wait(hEvents, events, MAX_SOCKET_EVENTS, (int)nTimeout);
+        for (int i = 0; i < nEvents; i++)
+        {
+            int nFlags = 0;
+            if (events[i].events & EPOLLIN)
+                nFlags |= EVENT_RECV;
+            if (events[i].events & EPOLLOUT)
+                nFlags |= EVENT_SEND;
+            if (events[i].events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP))
+                nFlags |= EVENT_ERROR;
+            vEvents.push_back(std::make_pair((SOCKET)events[i].data.fd, nFlags));
+        }
+#elif defined(HAVE_SYS_EVENT_H)
+        struct kevent events[MAX_SOCKET_EVENTS];
+        struct timespec ts;
+        ts.tv_sec = nTimeout / 1000;
+        ts.tv_nsec = (nTimeout % 1000) * 1000000;
+        int nEvents = kevent(hEvents, NULL, 0, events, MAX_SOCKET_EVENTS, &ts);
+        for (int i = 0; i < nEvents; i++)
+        {
+            int nFlags = 0;
+            if (events[i].filter == EVFILT_READ)
+                nFlags |= EVENT_RECV;
+            if (events[i].filter == EVFILT_WRITE)
+                nFlags |= EVENT_SEND;
+            if (events[i].flags & (EV_EOF | EV_ERROR))
+                nFlags |= EVENT_ERROR;
+            vEvents.push_back(std::make_pair((SOCKET)events[i].ident, nFlags));
+        }
+#else
+        int nEvents = SOCKET_ERROR;
+#endif
+        if (nEvents < 0 && WSAGetLastError() == WSAEINTR)
+            return 0;
+        return nEvents;
+    }
+};
+
+// which way a peer socket should be serviced by ThreadSocketHandler
+static void GetSocketInterest(CNode* pnode, bool& fWantRecv, bool& fWantSend)
+{
+    // Implement the following logic:
+    // * If there is data to send, select() for sending data. As this only
+    //   happens when optimistic write failed, we choose to first drain the
+    //   write buffer in this case before receiving more. This avoids
+    //   needlessly queueing received data, if the remote peer is not themselves
+    //   receiving data. This means properly utilizing TCP flow control signaling.
+    // * Otherwise, if there is no (complete) message in the receive buffer,
+    //   or there is space left in the buffer, select() for receiving data.
+    // * (if neither of the above applies, there is certainly one message
+    //   in the receiver buffer ready to be processed).
+    // Together, that means that at least one of the following is always possible,
+    // so we don't deadlock:
+    // * We send some data.
+    // * We wait for data to be received (and disconnect after timeout).
+    // * We process a message in the buffer (message handler thread).
+    fWantRecv = fWantSend = false;
+    {
+        TRY_LOCK(pnode->cs_vSend, lockSend);
+        if (lockSend && !pnode->vSendMsg.empty()) {
+            fWantSend = true;
+            return;
+        }
+    }
+    {
+        TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
+        if (lockRecv && (
+            pnode->vRecvMsg.empty() || !pnode->vRecvMsg.front().complete() ||
+            pnode->GetTotalRecvSize() <= ReceiveFloodSize()))
+            fWantRecv = true;
+    }
+}
+
 void ThreadSocketHandler()
 {
     unsigned int nPrevNodeCount = 0;
+
+    CSocketEvents socketEvents(nSocketEventsMode);
+    if (nSocketEventsMode != SOCKETEVENTS_SELECT)
+    {
+        if (!socketEvents.IsValid())
+        {
+            LogPrintf("socket events: cannot create %s instance (%s), falling back to select\n",
+                SocketEventsModeName(nSocketEventsMode), NetworkErrorString(WSAGetLastError()));
+            nSocketEventsMode = SOCKETEVENTS_SELECT;
+        }
+        else
+        {
+            // listening sockets stay level triggered, one connection is accepted per wait
+            BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket)
+                if (!socketEvents.Add(hListenSocket.socket, false))
+                    LogPrintf("socket events: cannot watch listening socket: %s\n", NetworkErrorString(WSAGetLastError()));
+        }
+    }
     while (true)
     {
         //
@@ -1405,76 +1692,138 @@ void ThreadSocketHandler()
         FD_ZERO(&fdsetRecv);
         FD_ZERO(&fdsetSend);
         FD_ZERO(&fdsetError);
-        SOCKET hSocketMax = 0;
-        bool have_fds = false;
-
-        BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket) {
-            FD_SET(hListenSocket.socket, &fdsetRecv);
-            hSocketMax = max(hSocketMax, hListenSocket.socket);
-            have_fds = true;
-        }
+        std::set<SOCKET> setListenReady;
 
+        if (nSocketEventsMode == SOCKETEVENTS_SELECT)
         {
-            LOCK(cs_vNodes);
-            BOOST_FOREACH(CNode* pnode, vNodes)
-            {
-                LOCK(pnode->cs_hSocket);
+            SOCKET hSocketMax = 0;
+            bool have_fds = false;
 
-                if (pnode->hSocket == INVALID_SOCKET)
-                    continue;
+            BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket) {
+                FD_SET(hListenSocket.socket, &fdsetRecv);
+                hSocketMax = max(hSocketMax, hListenSocket.socket);
+                have_fds = true;
+            }
 
-                FD_SET(pnode->hSocket, &fdsetError);
-                hSocketMax = max(hSocketMax, pnode->hSocket);
+#if defined(USE_TLS)
+            BOOST_FOREACH(const CPendingTLSAccept& pending, lPendingTLSAccepts) {
+                FD_SET(pending.hSocket, &fdsetRecv);
+                hSocketMax = max(hSocketMax, pending.hSocket);
                 have_fds = true;
+            }
+#endif
 
-                // Implement the following logic:
-                // * If there is data to send, select() for sending data. As this only
-                //   happens when optimistic write failed, we choose to first drain the
-                //   write buffer in this case before receiving more. This avoids
-                //   needlessly queueing received data, if the remote peer is not themselves
-                //   receiving data. This means properly utilizing TCP flow control signaling.
-                // * Otherwise, if there is no (complete) message in the receive buffer,
-                //   or there is space left in the buffer, select() for receiving data.
-                // * (if neither of the above applies, there is certainly one message
-                //   in the receiver buffer ready to be processed).
-                // Together, that means that at least one of the following is always possible,
-                // so we don't deadlock:
-                // * We send some data.
-                // * We wait for data to be received (and disconnect after timeout).
-                // * We process a message in the buffer (message handler thread).
+            {
+                LOCK(cs_vNodes);
+                BOOST_FOREACH(CNode* pnode, vNodes)
                 {
-                    TRY_LOCK(pnode->cs_vSend, lockSend);
-                    if (lockSend && !pnode->vSendMsg.empty()) {
-                        FD_SET(pnode->hSocket, &fdsetSend);
+                    LOCK(pnode->cs_hSocket);
+
+                    if (pnode->hSocket == INVALID_SOCKET)
                         continue;
-                    }
+
+                    FD_SET(pnode->hSocket, &fdsetError);
+                    hSocketMax = max(hSocketMax, pnode->hSocket);
+                    have_fds = true;
+
+                    bool fWantRecv, fWantSend;
+                    GetSocketInterest(pnode, fWantRecv, fWantSend);
+                    if (fWantSend)
+                        FD_SET(pnode->hSocket, &fdsetSend);
+                    else if (fWantRecv)
+                        FD_SET(pnode->hSocket, &fdsetRecv);
                 }
+            }
+
+            int nSelect = select(have_fds ? hSocketMax + 1 : 0,
+                                 &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+            boost::this_thread::interruption_point();
+
+            if (nSelect == SOCKET_ERROR)
+            {
+                if (have_fds)
                 {
-                    TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
-                    if (lockRecv && (
-                        pnode->vRecvMsg.empty() || !pnode->vRecvMsg.front().complete() ||
-                        pnode->GetTotalRecvSize() <= ReceiveFloodSize()))
-                        FD_SET(pnode->hSocket, &fdsetRecv);
+                    int nErr = WSAGetLastError();
+                    LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
+                    for (unsigned int i = 0; i <= hSocketMax; i++)
+                        FD_SET(i, &fdsetRecv);
                 }
+                FD_ZERO(&fdsetSend);
+                FD_ZERO(&fdsetError);
+                MilliSleep(timeout.tv_usec/1000);
             }
+
+            BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket)
+                if (hListenSocket.socket != INVALID_SOCKET && FD_ISSET(hListenSocket.socket, &fdsetRecv))
+                    setListenReady.insert(hListenSocket.socket);
         }
+        else
+        {
+            // peer sockets are registered once, edge triggered, and their readiness is kept in the node until a recv
+            // or send would block. nothing is done per idle peer but looking at those two flags
+            std::map<SOCKET, CNode*> mapSocketNodes;
+            bool fReady = false;
+            {
+                LOCK(cs_vNodes);
+                BOOST_FOREACH(CNode* pnode, vNodes)
+                {
+                    LOCK(pnode->cs_hSocket);
 
-        int nSelect = select(have_fds ? hSocketMax + 1 : 0,
-                             &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
-        boost::this_thread::interruption_point();
+                    if (pnode->hSocket == INVALID_SOCKET)
+                        continue;
 
-        if (nSelect == SOCKET_ERROR)
-        {
-            if (have_fds)
+                    if (!pnode->fSocketEventsAdded)
+                    {
+                        pnode->fSocketEventsAdded = true;
+                        if (!socketEvents.Add(pnode->hSocket, true))
+                        {
+                            LogPrintf("socket events: cannot watch socket of peer=%d: %s\n", pnode->id, NetworkErrorString(WSAGetLastError()));
+                            pnode->fDisconnect = true;
+                            continue;
+                        }
+                    }
+                    mapSocketNodes[pnode->hSocket] = pnode;
+
+                    bool fWantRecv, fWantSend;
+                    GetSocketInterest(pnode, fWantRecv, fWantSend);
+                    if ((fWantRecv && pnode->fSocketReadable) || (fWantSend && pnode->fSocketWritable))
+                        fReady = true;
+                }
+            }
+
+#if defined(USE_TLS)
+            // handshakes are stepped on every pass, their events only wake the loop up
+            BOOST_FOREACH(CPendingTLSAccept& pending, lPendingTLSAccepts)
+            {
+                if (!pending.fSocketEventsAdded)
+                    pending.fSocketEventsAdded = socketEvents.Add(pending.hSocket, true);
+            }
+#endif
+
+            // don't sleep when a peer can already be serviced
+            std::vector<std::pair<SOCKET, int>> vEvents;
+            if (socketEvents.Wait(fReady ? 0 : timeout.tv_usec/1000, vEvents) == SOCKET_ERROR)
+            {
+                LogPrintf("socket events error %s\n", NetworkErrorString(WSAGetLastError()));
+                MilliSleep(timeout.tv_usec/1000);
+            }
+            boost::this_thread::interruption_point();
+
+            for (const std::pair<SOCKET, int>& event : vEvents)
             {
-                int nErr = WSAGetLastError();
-                LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
-                for (unsigned int i = 0; i <= hSocketMax; i++)
-                    FD_SET(i, &fdsetRecv);
+                std::map<SOCKET, CNode*>::iterator it = mapSocketNodes.find(event.first);
+                if (it == mapSocketNodes.end())
+                {
+                    if (event.second & CSocketEvents::EVENT_RECV)
+                        setListenReady.insert(event.first);
+                    continue;
+                }
+                // an error or hangup is picked up by the next recv
+                if (event.second & (CSocketEvents::EVENT_RECV | CSocketEvents::EVENT_ERROR))
+                    it->second->fSocketReadable = true;
+                if (event.second & CSocketEvents::EVENT_SEND)
+                    it->second->fSocketWritable = true;
             }
-            FD_ZERO(&fdsetSend);
-            FD_ZERO(&fdsetError);
-            MilliSleep(timeout.tv_usec/1000);
         }
 
         //
@@ -1482,11 +1831,14 @@ void ThreadSocketHandler()
         //
         BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket)
         {
-            if (hListenSocket.socket != INVALID_SOCKET && FD_ISSET(hListenSocket.socket, &fdsetRecv))
+            if (hListenSocket.socket != INVALID_SOCKET && setListenReady.count(hListenSocket.socket))
             {
                 AcceptConnection(hListenSocket);
             }
         }
+#if defined(USE_TLS)
+        ProcessPendingTLSAccepts();
+#endif
 
         //
         // Service each socket
@@ -1502,8 +1854,19 @@ void ThreadSocketHandler()
         {
             boost::this_thread::interruption_point();
 
-            if (tlsmanager.threadSocketHandler(pnode,fdsetRecv,fdsetSend,fdsetError)==-1){
-                continue;
+            if (nSocketEventsMode == SOCKETEVENTS_SELECT)
+            {
+                if (tlsmanager.threadSocketHandler(pnode,fdsetRecv,fdsetSend,fdsetError)==-1){
+                    continue;
+                }
+            }
+            else
+            {
+                bool fWantRecv, fWantSend;
+                GetSocketInterest(pnode, fWantRecv, fWantSend);
+                if (tlsmanager.threadSocketHandler(pnode, fWantRecv && pnode->fSocketReadable, fWantSend && pnode->fSocketWritable, false)==-1){
+                    continue;
+                }
             }
 
             //
@@ -1853,7 +2216,15 @@ bool OpenNetworkConnection(const CAddress& addrConnect, CSemaphoreGrant *grantOu
 }
 
 
-void ThreadMessageHandler()
+MessageLane GetMessageLane(const std::string& strCommand)
+{
+    if (strCommand == "block" || strCommand == "headers" || strCommand == "cmpctblock" || strCommand == "blocktxn")
+        return MSG_LANE_BLOCKS;
+    return MSG_LANE_GENERAL;
+}
+
+// each lane visits every peer in turn and processes at most one message of it per pass
+static void MessageHandlerLoop(MessageLane lane)
 {
     boost::mutex condition_mutex;
     boost::unique_lock<boost::mutex> lock(condition_mutex);
@@ -1892,12 +2263,14 @@ void ThreadMessageHandler()
                 TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
                 if (lockRecv)
                 {
-                    if (!g_signals.ProcessMessages(pnode))
+                    if (!g_signals.ProcessMessages(pnode, lane))
                         pnode->CloseSocketDisconnect();
 
                     if (pnode->nSendSize < SendBufferSize())
                     {
-                        if (!pnode->vRecvGetData.empty() || (!pnode->vRecvMsg.empty() && pnode->vRecvMsg[0].complete()))
+                        if ((lane == MSG_LANE_GENERAL && !pnode->vRecvGetData.empty()) ||
+                            (!pnode->vRecvMsg.empty() && pnode->vRecvMsg[0].complete() &&
+                             GetMessageLane(pnode->vRecvMsg[0].hdr.GetCommand()) == lane))
                         {
                             fSleep = false;
                         }
@@ -1906,6 +2279,9 @@ void ThreadMessageHandler()
             }
             boost::this_thread::interruption_point();
 
+            if (lane != MSG_LANE_GENERAL)
+                continue;
+
             // Send messages
             {
                 TRY_LOCK(pnode->cs_vSend, lockSend);
@@ -1932,6 +2308,16 @@ void ThreadMessageHandler()
     }
 }
 
+void ThreadMessageHandler()
+{
+    MessageHandlerLoop(MSG_LANE_GENERAL);
+}
+
+void ThreadBlockMessageHandler()
+{
+    MessageHandlerLoop(MSG_LANE_BLOCKS);
+}
+
 
 bool BindListenPort(const CService &addrBind, string& strError, bool fWhitelisted)
 {
@@ -1955,7 +2341,7 @@ bool BindListenPort(const CService &addrBind, string& strError, bool fWhiteliste
         LogPrintf("%s\n", strError);
         return false;
     }
-    if (!IsSelectableSocket(hListenSocket))
+    if (!IsPollableSocket(hListenSocket))
     {
         strError = "Error: Couldn't create a listenable socket for incoming connections";
         LogPrintf("%s\n", strError);
@@ -2149,6 +2535,7 @@ void StartNode(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     // Process messages
     threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "msghand", &ThreadMessageHandler));
+    threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "blockhand", &ThreadBlockMessageHandler));
 
     #if defined(USE_TLS)
         if (CNode::GetTlsFallbackNonTls())
@@ -2159,7 +2546,7 @@ void StartNode(boost::thread_group& threadGroup, CScheduler& scheduler)
     #endif
 
     // Dump network addresses
-    scheduler.scheduleEvery(&DumpAddresses, DUMP_ADDRESSES_INTERVAL);
+    scheduler.scheduleEvery(&DumpAddresses, DUMP_ADDRESSES_INTERVAL, CScheduler::TaskOptions("dumpaddresses", CScheduler::PRIORITY_LOW, "peers.dat"));
 }
 
 bool StopNode()
@@ -2257,6 +2644,38 @@ uint64_t CNode::GetTotalBytesSent()
     return nTotalBytesSent;
 }
 
+void CNode::RecordMessageRecv(const std::string &command, uint64_t bytes)
+{
+    const std::string &key = GetNetMessageTypeKey(command);
+    {
+        LOCK(cs_msgTypeStats);
+        mapRecvByType[key].Add(bytes);
+    }
+    LOCK(cs_totalMessageTypes);
+    mapTotalRecvByType[key].Add(bytes);
+}
+
+void CNode::RecordMessageSent(const CSerializeData &msg, int64_t queueMicros)
+{
+    // the command is the NUL padded field that follows the message start in the header
+    const char *pCommand = &msg[MESSAGE_START_SIZE];
+    const std::string &key = GetNetMessageTypeKey(std::string(pCommand, strnlen(pCommand, CMessageHeader::COMMAND_SIZE)));
+    queueMicros = std::max(queueMicros, (int64_t)0);
+    {
+        LOCK(cs_msgTypeStats);
+        mapSentByType[key].Add(msg.size(), queueMicros);
+    }
+    LOCK(cs_totalMessageTypes);
+    mapTotalSentByType[key].Add(msg.size(), queueMicros);
+}
+
+void CNode::GetTotalMessageTypeStats(CNetMessageTypeStatsMap &sent, CNetMessageTypeStatsMap &recv)
+{
+    LOCK(cs_totalMessageTypes);
+    sent = mapTotalSentByType;
+    recv = mapTotalRecvByType;
+}
+
 void CNode::Fuzz(int nChance)
 {
     if (!fSuccessfullyConnected) return; // Don't fuzz initial handshake
@@ -2423,6 +2842,9 @@ CNode::CNode(SOCKET hSocketIn, const CAddress& addrIn, const std::string& addrNa
     nRefCount = 0;
     nSendSize = 0;
     nSendOffset = 0;
+    fSocketReadable = true;
+    fSocketWritable = true;
+    fSocketEventsAdded = false;
     hashContinue = uint256();
     nStartingHeight = -1;
     fGetAddr = false;
@@ -2431,6 +2853,9 @@ CNode::CNode(SOCKET hSocketIn, const CAddress& addrIn, const std::string& addrNa
     nNextAddrSend = 0;
     nNextInvSend = 0;
     fSentAddr = false;
+    fTxReconciliation = false;
+    nReconSalt = GetRand(std::numeric_limits<uint64_t>::max());
+    nReconK0 = nReconK1 = 0;
     pfilter = new CBloomFilter();
     nPingNonceSent = 0;
     nPingUsecStart = 0;
@@ -2556,6 +2981,17 @@ void CNode::AskFor(const CInv& inv)
     mapAskFor.insert(std::make_pair(nRequestTime, inv));
 }
 
+void CNode::SetReconciliationSalt(uint64_t nPeerSalt)
+{
+    // both sides hash the two salts in the same order, so they arrive at the same keys
+    CHashWriter ss(SER_GETHASH, 0);
+    ss << std::string("Tx Relay Salting") << std::min(nReconSalt, nPeerSalt) << std::max(nReconSalt, nPeerSalt);
+    uint256 hash = ss.GetHash();
+    nReconK0 = ReadLE64(hash.begin());
+    nReconK1 = ReadLE64(hash.begin() + 8);
+    fTxReconciliation = true;
+}
+
 void CNode::BeginMessage(const char* pszCommand) EXCLUSIVE_LOCK_FUNCTION(cs_vSend)
 {
     ENTER_CRITICAL_SECTION(cs_vSend);
@@ -2592,28 +3028,64 @@ void CNode::EndMessage() UNLOCK_FUNCTION(cs_vSend)
         LEAVE_CRITICAL_SECTION(cs_vSend);
         return;
     }
+    unsigned int nSize = FinalizeMessage(ssSend);
+    LogPrint("net", "(%d bytes) peer=%d\n", nSize, id);
+
+    // queued messages are never modified, so each one sits in a shared buffer, see MakeSharedMessage
+    std::shared_ptr<CSerializeData> pmsg = std::make_shared<CSerializeData>();
+    ssSend.GetAndClear(*pmsg);
+    QueueMessage(pmsg);
+
+    LEAVE_CRITICAL_SECTION(cs_vSend);
+}
+
+// requires LOCK(cs_vSend)
+void CNode::QueueMessage(const CSharedMessage& msg)
+{
+    bool fEmpty = vSendMsg.empty();
+    vSendMsg.push_back(msg);
+    vSendMsgQueueTime.push_back(GetTimeMicros());
+    nSendSize += msg->size();
+    TRACE4(net, outbound_message, id, addrName.c_str(), msg->data() + MESSAGE_START_SIZE, msg->size());
+
+    // If write queue empty, attempt "optimistic write"
+    if (fEmpty)
+        SocketSendData(this);
+}
+
+unsigned int CNode::FinalizeMessage(CDataStream& ss)
+{
     // Set the size
-    unsigned int nSize = ssSend.size() - CMessageHeader::HEADER_SIZE;
-    WriteLE32((uint8_t*)&ssSend[CMessageHeader::MESSAGE_SIZE_OFFSET], nSize);
+    unsigned int nSize = ss.size() - CMessageHeader::HEADER_SIZE;
+    WriteLE32((uint8_t*)&ss[CMessageHeader::MESSAGE_SIZE_OFFSET], nSize);
 
     // Set the checksum
-    uint256 hash = Hash(ssSend.begin() + CMessageHeader::HEADER_SIZE, ssSend.end());
+    uint256 hash = Hash(ss.begin() + CMessageHeader::HEADER_SIZE, ss.end());
     unsigned int nChecksum = 0;
     memcpy(&nChecksum, &hash, sizeof(nChecksum));
-    assert(ssSend.size () >= CMessageHeader::CHECKSUM_OFFSET + sizeof(nChecksum));
-    memcpy((char*)&ssSend[CMessageHeader::CHECKSUM_OFFSET], &nChecksum, sizeof(nChecksum));
-
-    LogPrint("net", "(%d bytes) peer=%d\n", nSize, id);
+    assert(ss.size () >= CMessageHeader::CHECKSUM_OFFSET + sizeof(nChecksum));
+    memcpy((char*)&ss[CMessageHeader::CHECKSUM_OFFSET], &nChecksum, sizeof(nChecksum));
+    return nSize;
+}
 
-    std::deque<CSerializeData>::iterator it = vSendMsg.insert(vSendMsg.end(), CSerializeData());
-    ssSend.GetAndClear(*it);
-    nSendSize += (*it).size();
+void CNode::BeginSharedMessage(CDataStream& ss, const char* pszCommand)
+{
+    ss << CMessageHeader(Params().MessageStart(), pszCommand, 0);
+}
 
-    // If write queue empty, attempt "optimistic write"
-    if (it == vSendMsg.begin())
-        SocketSendData(this);
+CSharedMessage CNode::EndSharedMessage(CDataStream& ss)
+{
+    FinalizeMessage(ss);
+    std::shared_ptr<CSerializeData> pmsg = std::make_shared<CSerializeData>();
+    ss.GetAndClear(*pmsg);
+    return pmsg;
+}
 
-    LEAVE_CRITICAL_SECTION(cs_vSend);
+void CNode::PushSharedMessage(const char* pszCommand, const CSharedMessage& msg)
+{
+    LOCK(cs_vSend);
+    LogPrint("net", "sending: %s (%d bytes, shared) peer=%d\n", SanitizeString(pszCommand), msg->size() - CMessageHeader::HEADER_SIZE, id);
+    QueueMessage(msg);
 }
 
 int64_t PoissonNextSend(int64_t nNow, int average_interval_seconds) {
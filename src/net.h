@@ -21,6 +21,8 @@
 #include "utiltime.h"
 #include "primitives/transaction.h"
 
+#include <algorithm>
+#include <atomic>
 #include <deque>
 #include <stdint.h>
 
@@ -79,6 +81,29 @@ static const unsigned int DEFAULT_MAX_PEER_CONNECTIONS = 384;
 static const int NETWORK_UPGRADE_PEER_PREFERENCE_BLOCK_PERIOD = 24 * 24 * 3;
 /** Default for blocks only*/
 static const bool DEFAULT_BLOCKSONLY = false;
+/** The most socket events collected by one wait of ThreadSocketHandler, any more are picked up by the next */
+static const int MAX_SOCKET_EVENTS = 1024;
+
+/** How ThreadSocketHandler waits on its sockets, select is limited to descriptors below FD_SETSIZE */
+enum SocketEventsMode
+{
+    SOCKETEVENTS_SELECT,
+    SOCKETEVENTS_EPOLL,
+    SOCKETEVENTS_KQUEUE,
+};
+
+#if defined(HAVE_SYS_EPOLL_H)
+static const SocketEventsMode DEFAULT_SOCKETEVENTS = SOCKETEVENTS_EPOLL;
+#elif defined(HAVE_SYS_EVENT_H)
+static const SocketEventsMode DEFAULT_SOCKETEVENTS = SOCKETEVENTS_KQUEUE;
+#else
+static const SocketEventsMode DEFAULT_SOCKETEVENTS = SOCKETEVENTS_SELECT;
+#endif
+
+bool ParseSocketEventsMode(const std::string& strMode, SocketEventsMode& mode);
+std::string SocketEventsModeName(SocketEventsMode mode);
+// false for a socket ThreadSocketHandler cannot wait on in the current mode
+bool IsPollableSocket(SOCKET hSocket);
 
 unsigned int ReceiveFloodSize();
 unsigned int SendBufferSize();
@@ -125,11 +150,24 @@ struct CombinerAll
     }
 };
 
+/**
+ * The message handler thread a message is processed on. Blocks and headers can take seconds to validate, so they have a
+ * thread of their own and transactions, pings and addresses of all other peers keep flowing meanwhile. A peer's messages
+ * are still processed in the order they arrived, the other lane waits while the peer's next message is not its own.
+ */
+enum MessageLane
+{
+    MSG_LANE_GENERAL,
+    MSG_LANE_BLOCKS,
+};
+
+MessageLane GetMessageLane(const std::string& strCommand);
+
 // Signals for message handling
 struct CNodeSignals
 {
     boost::signals2::signal<int ()> GetHeight;
-    boost::signals2::signal<bool (CNode*), CombinerAll> ProcessMessages;
+    boost::signals2::signal<bool (CNode*, MessageLane), CombinerAll> ProcessMessages;
     boost::signals2::signal<bool (CNode*, bool), CombinerAll> SendMessages;
     boost::signals2::signal<void (NodeId, const CNode*)> InitializeNode;
     boost::signals2::signal<void (NodeId)> FinalizeNode;
@@ -173,9 +211,13 @@ extern uint64_t nLocalHostNonce;
 extern CAddrMan addrman;
 /** Maximum number of connections to simultaneously allow (aka connection slots) */
 extern int nMaxConnections;
+extern SocketEventsMode nSocketEventsMode;
 
 extern std::vector<CNode*> vNodes;
 extern CCriticalSection cs_vNodes;
+// a fully serialized message, header included, which may be queued to several peers at once
+typedef std::shared_ptr<const CSerializeData> CSharedMessage;
+
 /** Relay map, protected by cs_main. */
 typedef std::map<uint256, std::shared_ptr<const CTransaction>> MapRelay;
 extern MapRelay mapRelay;
@@ -203,6 +245,31 @@ struct LocalServiceInfo {
 extern CCriticalSection cs_mapLocalHost;
 extern std::map<CNetAddr, LocalServiceInfo> mapLocalHost;
 
+// the messages and bytes, headers included, sent or received of one message type. messages are counted as sent
+// once their last byte is written to the socket, and the queue times of sent messages are from being queued until
+// then
+struct CNetMessageTypeStats
+{
+    uint64_t nMessages = 0;
+    uint64_t nBytes = 0;
+    uint64_t nQueueMicros = 0;
+    uint64_t nMaxQueueMicros = 0;
+
+    void Add(uint64_t bytes, int64_t queueMicros = 0)
+    {
+        nMessages++;
+        nBytes += bytes;
+        nQueueMicros += queueMicros;
+        nMaxQueueMicros = std::max(nMaxQueueMicros, (uint64_t)queueMicros);
+    }
+};
+
+// keyed by message type. types this node does not send or process are all counted under NET_MESSAGE_TYPE_OTHER, so
+// a peer cannot grow the map with made up commands
+typedef std::map<std::string, CNetMessageTypeStats> CNetMessageTypeStatsMap;
+extern const std::string NET_MESSAGE_TYPE_OTHER;
+const std::string &GetNetMessageTypeKey(const std::string &command);
+
 class CNodeStats
 {
 public:
@@ -227,6 +294,8 @@ public:
     std::string addrLocal;
     uint64_t m_addr_processed{0};
     uint64_t m_addr_rate_limited{0};
+    CNetMessageTypeStatsMap mapSentByType;
+    CNetMessageTypeStatsMap mapRecvByType;
 };
 
 
@@ -289,15 +358,27 @@ public:
     size_t nSendSize; // total size of all vSendMsg entries
     size_t nSendOffset; // offset inside the first vSendMsg already sent
     uint64_t nSendBytes;
-    std::deque<CSerializeData> vSendMsg;
+    std::deque<CSharedMessage> vSendMsg;
+    std::deque<int64_t> vSendMsgQueueTime; // time in microseconds each vSendMsg entry was queued
     CCriticalSection cs_vSend;
 
+    // whether the socket may still be read from or written to without blocking, as last reported by edge triggered
+    // socket events. a flag is only cleared once a recv or send would block, since no new event comes until then
+    std::atomic<bool> fSocketReadable;
+    std::atomic<bool> fSocketWritable;
+    bool fSocketEventsAdded; // only used by ThreadSocketHandler
+
     std::deque<CInv> vRecvGetData;
     std::deque<CNetMessage> vRecvMsg;
     CCriticalSection cs_vRecvMsg;
     uint64_t nRecvBytes;
     int nRecvVersion;
 
+    // traffic by message type, only ever locked last, since it is copied by copyStats while cs_vNodes is held
+    CCriticalSection cs_msgTypeStats;
+    CNetMessageTypeStatsMap mapSentByType;
+    CNetMessageTypeStatsMap mapRecvByType;
+
     int64_t nLastSend;
     int64_t nLastRecv;
     int64_t nTimeConnected;
@@ -401,6 +482,14 @@ public:
     int64_t nNextInvSend;
     std::multimap<int64_t, CInv> mapAskFor;
 
+    // Transaction reconciliation, set up once both sides sent sendrecon. Transactions for an inbound peer that
+    // reconciles are offered by short ID in a reconcil message instead of by inv.
+    bool fTxReconciliation;
+    uint64_t nReconSalt;
+    uint64_t nReconK0, nReconK1;
+    // short IDs offered in our last reconcil, until the peer asks for the ones it is missing. Requires cs_inventory.
+    std::map<uint32_t, uint256> mapReconOffered;
+
     // Ping time measurement:
     // The pong reply we're expecting, or 0 if no pong expected.
     std::atomic<uint64_t> nPingNonceSent;
@@ -424,6 +513,9 @@ private:
     static CCriticalSection cs_totalBytesSent;
     static uint64_t nTotalBytesRecv;
     static uint64_t nTotalBytesSent;
+    static CCriticalSection cs_totalMessageTypes;
+    static CNetMessageTypeStatsMap mapTotalSentByType;
+    static CNetMessageTypeStatsMap mapTotalRecvByType;
 
     CNode(const CNode&);
     void operator=(const CNode&);
@@ -546,6 +638,13 @@ public:
 
     void AskFor(const CInv& inv);
 
+    // combines our salt with the peer's into the short ID keys of this connection
+    void SetReconciliationSalt(uint64_t nPeerSalt);
+    uint32_t GetReconShortID(const uint256& txid) const
+    {
+        return (uint32_t)SipHashUint256(nReconK0, nReconK1, txid);
+    }
+
     // TODO: Document the postcondition of this function.  Is cs_vSend locked?
     void BeginMessage(const char* pszCommand) EXCLUSIVE_LOCK_FUNCTION(cs_vSend);
 
@@ -555,6 +654,37 @@ public:
     // TODO: Document the precondition of this function.  Is cs_vSend locked?
     void EndMessage() UNLOCK_FUNCTION(cs_vSend);
 
+    // requires LOCK(cs_vSend)
+    void QueueMessage(const CSharedMessage& msg);
+
+    // fills in the size and checksum of a serialized message, returns the payload size
+    static unsigned int FinalizeMessage(CDataStream& ss);
+    static void BeginSharedMessage(CDataStream& ss, const char* pszCommand);
+    static CSharedMessage EndSharedMessage(CDataStream& ss);
+
+    /**
+     * Serializes a complete message, header and checksum included, into a buffer that can be queued to any number of
+     * peers with PushSharedMessage. A block relayed to every peer is then serialized and hashed once rather than
+     * once per peer, and all peers' send queues reference the same memory until the last of them has sent it.
+     */
+    template<typename T1>
+    static CSharedMessage MakeSharedMessage(const char* pszCommand, int nVersion, const T1& a1)
+    {
+        CDataStream ss(SER_NETWORK, nVersion);
+        BeginSharedMessage(ss, pszCommand);
+        ss << a1;
+        return EndSharedMessage(ss);
+    }
+
+    // queues a message made by MakeSharedMessage, which must have been serialized with this peer's send version
+    void PushSharedMessage(const char* pszCommand, const CSharedMessage& msg);
+
+    int GetSendVersion()
+    {
+        LOCK(cs_vSend);
+        return ssSend.GetVersion();
+    }
+
     void PushVersion();
 
 
@@ -769,6 +899,11 @@ public:
     static uint64_t GetTotalBytesRecv();
     static uint64_t GetTotalBytesSent();
 
+    // a complete message, header included, that was received or was written to the socket after its queue time
+    void RecordMessageRecv(const std::string &command, uint64_t bytes);
+    void RecordMessageSent(const CSerializeData &msg, int64_t queueMicros);
+    static void GetTotalMessageTypeStats(CNetMessageTypeStatsMap &sent, CNetMessageTypeStatsMap &recv);
+
     // returns the value of the tlsfallbacknontls and tlsvalidate flags set at zend startup (see init.cpp)
     static bool GetTlsFallbackNonTls();
     static bool GetTlsValidate();
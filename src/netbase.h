@@ -207,5 +207,10 @@ bool SetSocketNonBlocking(SOCKET& hSocket, bool fNonBlocking);
  * Convert milliseconds to a struct timeval for e.g. select.
  */
 struct timeval MillisToTimeval(int64_t nTimeout);
+/**
+ * Wait up to nTimeout milliseconds for a socket to become readable, or writable if fWrite is set. Returns a positive
+ * value when it is, 0 on timeout and SOCKET_ERROR on failure, like select, but works for any descriptor number.
+ */
+int WaitForSocket(SOCKET hSocket, bool fWrite, int64_t nTimeout);
 
 #endif // BITCOIN_NETBASE_H
@@ -0,0 +1,159 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "notificationqueue.h"
+
+#include "util.h"
+#include "utiltime.h"
+
+#include <list>
+
+static CCriticalSection cs_notificationQueues;
+static std::list<CNotificationQueue *> notificationQueues;
+
+CNotificationQueue::CNotificationQueue(const std::string &Name) :
+    name(Name), fRunning(false), nQueued(0), nSent(0), nDropped(0), nBlocked(0), nBlockedMicros(0), nMaxDepth(0)
+{
+    nMaxSize = std::max((int64_t)1, GetArg("-notificationqueuesize", DEFAULT_NOTIFICATION_QUEUE_SIZE));
+    std::string strPolicy = GetArg("-notificationqueuepolicy", DEFAULT_NOTIFICATION_QUEUE_POLICY);
+    if (strPolicy != "block" && strPolicy != "drop")
+    {
+        LogPrintf("Unknown -notificationqueuepolicy %s, using %s\n", strPolicy, DEFAULT_NOTIFICATION_QUEUE_POLICY);
+        strPolicy = DEFAULT_NOTIFICATION_QUEUE_POLICY;
+    }
+    fDrop = strPolicy == "drop";
+
+    LOCK(cs_notificationQueues);
+    notificationQueues.push_back(this);
+}
+
+CNotificationQueue::~CNotificationQueue()
+{
+    Stop();
+
+    LOCK(cs_notificationQueues);
+    notificationQueues.remove(this);
+}
+
+void CNotificationQueue::Start()
+{
+    boost::unique_lock<boost::mutex> lock(cs);
+    if (fRunning)
+    {
+        return;
+    }
+    fRunning = true;
+    thread = boost::thread(&CNotificationQueue::Run, this);
+}
+
+void CNotificationQueue::Stop()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        if (!fRunning)
+        {
+            return;
+        }
+        fRunning = false;
+        cvNotEmpty.notify_all();
+        cvNotFull.notify_all();
+    }
+    thread.join();
+}
+
+bool CNotificationQueue::Push(const std::function<void()> &notification)
+{
+    boost::unique_lock<boost::mutex> lock(cs);
+    if (!fRunning)
+    {
+        return false;
+    }
+    if (queue.size() >= nMaxSize)
+    {
+        if (fDrop)
+        {
+            if (!nDropped++)
+            {
+                LogPrintf("%s notification queue is full, dropping notifications\n", name);
+            }
+            return false;
+        }
+        int64_t nStart = GetTimeMicros();
+        nBlocked++;
+        while (queue.size() >= nMaxSize && fRunning)
+        {
+            cvNotFull.wait(lock);
+        }
+        nBlockedMicros += GetTimeMicros() - nStart;
+        if (!fRunning)
+        {
+            return false;
+        }
+    }
+    queue.push_back(notification);
+    nQueued++;
+    nMaxDepth = std::max(nMaxDepth, queue.size());
+    cvNotEmpty.notify_one();
+    return true;
+}
+
+void CNotificationQueue::Run()
+{
+    RenameThread(("verus-" + name).c_str());
+
+    boost::unique_lock<boost::mutex> lock(cs);
+    while (true)
+    {
+        while (queue.empty() && fRunning)
+        {
+            cvNotEmpty.wait(lock);
+        }
+        if (queue.empty())
+        {
+            break;
+        }
+        std::function<void()> notification = std::move(queue.front());
+        queue.pop_front();
+        cvNotFull.notify_one();
+
+        lock.unlock();
+        try
+        {
+            notification();
+        }
+        catch (const std::exception &e)
+        {
+            LogPrintf("%s notification failed: %s\n", name, e.what());
+        }
+        lock.lock();
+        nSent++;
+    }
+}
+
+UniValue CNotificationQueue::GetInfo()
+{
+    boost::unique_lock<boost::mutex> lock(cs);
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("policy", fDrop ? "drop" : "block"));
+    ret.push_back(Pair("maxsize", (uint64_t)nMaxSize));
+    ret.push_back(Pair("depth", (uint64_t)queue.size()));
+    ret.push_back(Pair("maxdepth", (uint64_t)nMaxDepth));
+    ret.push_back(Pair("queued", nQueued));
+    ret.push_back(Pair("sent", nSent));
+    ret.push_back(Pair("dropped", nDropped));
+    ret.push_back(Pair("blocked", nBlocked));
+    ret.push_back(Pair("blockedms", nBlockedMicros / 1000));
+    return ret;
+}
+
+UniValue GetNotificationQueueInfo()
+{
+    UniValue ret(UniValue::VOBJ);
+    LOCK(cs_notificationQueues);
+    for (auto pQueue : notificationQueues)
+    {
+        ret.push_back(Pair(pQueue->GetName(), pQueue->GetInfo()));
+    }
+    return ret;
+}
@@ -0,0 +1,71 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_NOTIFICATIONQUEUE_H
+#define BITCOIN_NOTIFICATIONQUEUE_H
+
+#include "sync.h"
+
+#include <deque>
+#include <functional>
+#include <stdint.h>
+#include <string>
+
+#include <boost/thread.hpp>
+
+#include <univalue.h>
+
+/** Notifications waiting to be sent at which a notification queue is full */
+static const int64_t DEFAULT_NOTIFICATION_QUEUE_SIZE = 10000;
+/** What a full notification queue does with the next notification, "block" or "drop" */
+static const char *const DEFAULT_NOTIFICATION_QUEUE_POLICY = "block";
+
+/**
+ * Sends the notifications of the ZMQ and AMQP publishers on a thread of its own, so that validation only waits for a
+ * notification to be queued. When the queue is full, the validation thread either waits until there is room again or
+ * drops the notification, as set by -notificationqueuepolicy. Notifications are sent in the order they are queued.
+ */
+class CNotificationQueue
+{
+public:
+    CNotificationQueue(const std::string &Name);
+    ~CNotificationQueue();
+
+    void Start();
+    // sends what is queued before returning
+    void Stop();
+
+    // returns false if the notification was dropped
+    bool Push(const std::function<void()> &notification);
+
+    UniValue GetInfo();
+
+    std::string GetName() const { return name; }
+
+private:
+    const std::string name;
+    size_t nMaxSize;
+    bool fDrop;
+
+    CWaitableCriticalSection cs;
+    CConditionVariable cvNotEmpty;
+    CConditionVariable cvNotFull;
+    std::deque<std::function<void()>> queue;
+    bool fRunning;
+    boost::thread thread;
+
+    uint64_t nQueued;
+    uint64_t nSent;
+    uint64_t nDropped;
+    uint64_t nBlocked;              // notifications that waited for room
+    int64_t nBlockedMicros;         // time validation spent waiting for room
+    size_t nMaxDepth;
+
+    void Run();
+};
+
+/** The state of every notification queue, for getnotificationinfo */
+UniValue GetNotificationQueueInfo();
+
+#endif // BITCOIN_NOTIFICATIONQUEUE_H
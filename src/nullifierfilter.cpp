@@ -0,0 +1,50 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "nullifierfilter.h"
+
+#include "crypto/common.h"
+
+#include <algorithm>
+
+CNullifierFilter::CNullifierFilter(uint64_t nNullifiers) :
+    nCapacity(std::max(nNullifiers * 2, MIN_CAPACITY)), nCount(0), vBits((nCapacity * BITS_PER_NULLIFIER + 63) / 64)
+{
+}
+
+// double hashing with two independent words of the nullifier, the second made odd so it never repeats a position
+void CNullifierFilter::Insert(const uint256 &nf)
+{
+    if (vBits.empty())
+    {
+        return;
+    }
+    uint64_t nBits = vBits.size() * 64;
+    uint64_t h1 = ReadLE64(nf.begin()), h2 = ReadLE64(nf.begin() + 8) | 1;
+    for (int i = 0; i < NUM_HASHES; i++)
+    {
+        uint64_t bit = (h1 + i * h2) % nBits;
+        vBits[bit >> 6] |= (uint64_t)1 << (bit & 63);
+    }
+    nCount++;
+}
+
+bool CNullifierFilter::MayContain(const uint256 &nf) const
+{
+    if (vBits.empty())
+    {
+        return true;
+    }
+    uint64_t nBits = vBits.size() * 64;
+    uint64_t h1 = ReadLE64(nf.begin()), h2 = ReadLE64(nf.begin() + 8) | 1;
+    for (int i = 0; i < NUM_HASHES; i++)
+    {
+        uint64_t bit = (h1 + i * h2) % nBits;
+        if (!(vBits[bit >> 6] & ((uint64_t)1 << (bit & 63))))
+        {
+            return false;
+        }
+    }
+    return true;
+}
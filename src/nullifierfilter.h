@@ -0,0 +1,57 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_NULLIFIERFILTER_H
+#define BITCOIN_NULLIFIERFILTER_H
+
+#include "serialize.h"
+#include "uint256.h"
+
+#include <stdint.h>
+#include <vector>
+
+/** Whether to keep a filter over the nullifiers of the coins database, see -nullifierfilter */
+static const bool DEFAULT_NULLIFIER_FILTER = true;
+
+/**
+ * A bloom filter over the Sprout and Sapling nullifiers of the coins database. Nearly every nullifier looked up is not
+ * spent, and the filter answers those without reading the database. Nullifiers are uniformly distributed hashes, so
+ * their own bits index the filter. Nullifiers erased by disconnected blocks stay in the filter, which only makes
+ * later lookups of them read the database.
+ */
+class CNullifierFilter
+{
+public:
+    // 10 bits and 7 bit positions for each nullifier are about a 1% false positive rate at capacity
+    static const uint64_t BITS_PER_NULLIFIER = 10;
+    static const int NUM_HASHES = 7;
+    static const uint64_t MIN_CAPACITY = 1 << 20;
+
+    CNullifierFilter() : nCapacity(0), nCount(0) {}
+    // sized for twice the nullifiers it is built with, so it keeps its rate while the set grows
+    explicit CNullifierFilter(uint64_t nNullifiers);
+
+    void Insert(const uint256 &nf);
+    bool MayContain(const uint256 &nf) const;
+
+    uint64_t GetCapacity() const { return nCapacity; }
+    uint64_t GetCount() const { return nCount; }
+    bool IsFull() const { return nCount > nCapacity; }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(nCapacity);
+        READWRITE(nCount);
+        READWRITE(vBits);
+    }
+
+private:
+    uint64_t nCapacity;
+    uint64_t nCount;
+    std::vector<uint64_t> vBits;
+};
+
+#endif // BITCOIN_NULLIFIERFILTER_H
@@ -74,11 +74,12 @@ public:
 /** Reply structure for request_done to fill in */
 struct HTTPReply
 {
-    HTTPReply(): status(0), error(-1) {}
+    HTTPReply(struct event_base *eventBase=nullptr): status(0), error(-1), base(eventBase) {}
 
     int status;
     int error;
     std::string body;
+    struct event_base *base;
 };
 
 const char *http_errorstring(int code)
@@ -107,6 +108,12 @@ static void http_request_done(struct evhttp_request *req, void *ctx)
 {
     HTTPReply *reply = static_cast<HTTPReply*>(ctx);
 
+    // connections are kept alive after the reply, so we must stop the loop ourselves rather than wait for it to run dry
+    if (reply->base)
+    {
+        event_base_loopbreak(reply->base);
+    }
+
     if (req == NULL) {
         /* If req is NULL, it means an error occurred while connecting: the
          * error code will have been passed to http_error_cb.
@@ -157,23 +164,91 @@ static CCrossChainRPCData LoadFromConfig(std::string name)
     return ret;
 }
 
-// credentials for now are "user:password"
-UniValue RPCCall(const string& strMethod, const UniValue& params, const string credentials, int port, const string host, int timeout)
+// a keep-alive connection to another daemon, with the event base that drives it
+class CRPCConnection
 {
-    // Used for inter-daemon communicatoin to enable merge mining and notarization without a client
-    //
+public:
+    raii_event_base base;
+    raii_evhttp_connection evcon;
+
+    CRPCConnection(const std::string &host, int port) :
+        base(obtain_event_base()), evcon(obtain_evhttp_connection_base(base.get(), host, port)) {}
+};
+
+// pools the connections to each daemon we call, so that notary and root chain calls reuse their connections
+// rather than opening a new one per call, and limits the number of calls in flight to any one daemon
+class CRPCConnectionPool
+{
+private:
+    CWaitableCriticalSection cs;
+    CConditionVariable cond;
+    std::map<std::pair<std::string, int>, std::vector<std::unique_ptr<CRPCConnection>>> idleConnections;
+    std::map<std::pair<std::string, int>, int> activeConnections;
+
+public:
+    std::unique_ptr<CRPCConnection> Acquire(const std::string &host, int port)
+    {
+        std::pair<std::string, int> endpoint(host, port);
+        int maxConnections = std::max((int)GetArg("-notaryrpcconnections", DEFAULT_NOTARY_RPC_CONNECTIONS), 1);
+        boost::unique_lock<boost::mutex> lock(cs);
+        while (activeConnections[endpoint] >= maxConnections)
+        {
+            cond.wait(lock);
+        }
+        activeConnections[endpoint]++;
+        std::vector<std::unique_ptr<CRPCConnection>> &idle = idleConnections[endpoint];
+        if (idle.size())
+        {
+            std::unique_ptr<CRPCConnection> conn = std::move(idle.back());
+            idle.pop_back();
+            lock.unlock();
+            // let the connection notice if the server closed it while idle, so the next request reconnects
+            event_base_loop(conn->base.get(), EVLOOP_NONBLOCK);
+            return conn;
+        }
+        lock.unlock();
+        try
+        {
+            return std::unique_ptr<CRPCConnection>(new CRPCConnection(host, port));
+        }
+        catch (...)
+        {
+            Release(host, port, std::unique_ptr<CRPCConnection>());
+            throw;
+        }
+    }
+
+    // connections that failed are closed by passing an empty pointer
+    void Release(const std::string &host, int port, std::unique_ptr<CRPCConnection> conn)
+    {
+        std::pair<std::string, int> endpoint(host, port);
+        boost::unique_lock<boost::mutex> lock(cs);
+        activeConnections[endpoint]--;
+        if (conn)
+        {
+            idleConnections[endpoint].push_back(std::move(conn));
+        }
+        cond.notify_one();
+    }
+};
 
-    // Obtain event base
-    raii_event_base base = obtain_event_base();
+static CRPCConnectionPool RPCConnectionPool;
 
-    // Synchronously look up hostname
-    raii_evhttp_connection evcon = obtain_evhttp_connection_base(base.get(), host, port);
-    evhttp_connection_set_timeout(evcon.get(), timeout);
+// posts one JSON-RPC request or batch of requests and returns the body of the reply
+static std::string RPCPost(const std::string &strRequest, const string &credentials, int port, const string &host, int timeout)
+{
+    // Used for inter-daemon communicatoin to enable merge mining and notarization without a client
+    //
+    std::unique_ptr<CRPCConnection> conn = RPCConnectionPool.Acquire(host, port);
+    evhttp_connection_set_timeout(conn->evcon.get(), timeout);
 
-    HTTPReply response;
+    HTTPReply response(conn->base.get());
     raii_evhttp_request req = obtain_evhttp_request(http_request_done, (void*)&response);
     if (req == NULL)
+    {
+        RPCConnectionPool.Release(host, port, std::move(conn));
         throw std::runtime_error("create http request failed");
+    }
 #if LIBEVENT_VERSION_NUMBER >= 0x02010300
     evhttp_request_set_error_cb(req.get(), http_error_cb);
 #endif
@@ -181,22 +256,25 @@ UniValue RPCCall(const string& strMethod, const UniValue& params, const string c
     struct evkeyvalq* output_headers = evhttp_request_get_output_headers(req.get());
     assert(output_headers);
     evhttp_add_header(output_headers, "Host", host.c_str());
-    evhttp_add_header(output_headers, "Connection", "close");
+    evhttp_add_header(output_headers, "Connection", "keep-alive");
     evhttp_add_header(output_headers, "Authorization", (std::string("Basic ") + EncodeBase64(credentials)).c_str());
 
     // Attach request data
-    std::string strRequest = JSONRPCRequest(strMethod, params, 1);
     struct evbuffer* output_buffer = evhttp_request_get_output_buffer(req.get());
     assert(output_buffer);
     evbuffer_add(output_buffer, strRequest.data(), strRequest.size());
 
-    int r = evhttp_make_request(evcon.get(), req.get(), EVHTTP_REQ_POST, "/");
+    int r = evhttp_make_request(conn->evcon.get(), req.get(), EVHTTP_REQ_POST, "/");
     req.release(); // ownership moved to evcon in above call
     if (r != 0) {
+        RPCConnectionPool.Release(host, port, std::unique_ptr<CRPCConnection>());
         throw CConnectionFailed("send http request failed");
     }
 
-    event_base_dispatch(base.get());
+    event_base_dispatch(conn->base.get());
+
+    // only connections that completed their last request are reused
+    RPCConnectionPool.Release(host, port, response.status == 0 ? std::unique_ptr<CRPCConnection>() : std::move(conn));
 
     if (response.status == 0)
         throw CConnectionFailed(strprintf("couldn't connect to server: %s (code %d)\n(make sure server is running and you are connecting to the correct RPC port)", http_errorstring(response.error), response.error));
@@ -207,9 +285,17 @@ UniValue RPCCall(const string& strMethod, const UniValue& params, const string c
     else if (response.body.empty())
         throw std::runtime_error("no response from server");
 
+    return response.body;
+}
+
+// credentials for now are "user:password"
+UniValue RPCCall(const string& strMethod, const UniValue& params, const string credentials, int port, const string host, int timeout)
+{
+    std::string responseBody = RPCPost(JSONRPCRequest(strMethod, params, 1), credentials, port, host, timeout);
+
     // Parse reply
     UniValue valReply(UniValue::VSTR);
-    if (!valReply.read(response.body))
+    if (!valReply.read(responseBody))
         throw std::runtime_error("couldn't parse reply from server");
     const UniValue& reply = valReply.get_obj();
     if (reply.empty())
@@ -218,44 +304,118 @@ UniValue RPCCall(const string& strMethod, const UniValue& params, const string c
     return reply;
 }
 
-UniValue RPCCallRoot(const string& strMethod, const UniValue& params, int timeout)
+std::vector<UniValue> RPCCallBatch(const std::vector<std::pair<std::string, UniValue>> &calls, const string credentials, int port, const string host, int timeout)
 {
-    string host, credentials;
-    int port;
-    map<string, string> settings;
-    map<string, vector<string>> settingsmulti;
+    std::vector<UniValue> replies(calls.size());
+    if (!calls.size())
+    {
+        return replies;
+    }
 
-    if (PBAAS_HOST != "" && PBAAS_PORT != 0)
+    // the id of each request is its index, since the server may reply in any order
+    std::string strRequest = "[";
+    for (int i = 0; i < calls.size(); i++)
     {
-        return RPCCall(strMethod, params, PBAAS_USERPASS, PBAAS_PORT, PBAAS_HOST);
+        std::string oneRequest = JSONRPCRequest(calls[i].first, calls[i].second, i);
+        while (oneRequest.size() && oneRequest.back() == '\n')
+        {
+            oneRequest.pop_back();
+        }
+        strRequest += (i ? "," : "") + oneRequest;
     }
-    else if ((_IsVerusActive() &&
-              ReadConfigFile("veth", settings, settingsmulti)) ||
-             (!_IsVerusActive() &&
-              ReadConfigFile(PBAAS_TESTMODE ? "vrsctest" : "VRSC", settings, settingsmulti)))
+    strRequest += "]\n";
+
+    std::string responseBody = RPCPost(strRequest, credentials, port, host, timeout);
+
+    UniValue valReply(UniValue::VARR);
+    if (!valReply.read(responseBody) || !valReply.isArray())
+        throw std::runtime_error("couldn't parse batch reply from server");
+
+    for (int i = 0; i < valReply.size(); i++)
+    {
+        const UniValue &oneReply = valReply[i];
+        UniValue id = find_value(oneReply, "id");
+        if (oneReply.isObject() && id.isNum() && id.get_int() >= 0 && id.get_int() < calls.size())
+        {
+            replies[id.get_int()] = oneReply;
+        }
+    }
+    for (auto &oneReply : replies)
+    {
+        if (oneReply.isNull())
+        {
+            throw std::runtime_error("expected batch reply to have a result, error and id for each request");
+        }
+    }
+    return replies;
+}
+
+// get the connection parameters of the root chain daemon, from the command line or its configuration file
+static bool GetRootRPCConnection(std::string &credentials, int &port, std::string &host)
+{
+    map<string, string> settings;
+    map<string, vector<string>> settingsmulti;
+
+    if (PBAAS_HOST == "" || PBAAS_PORT == 0)
     {
-        // the Ethereum bridge, "VETH", serves as the root currency to VRSC and for Rinkeby to VRSCTEST
-        auto userIt = settingsmulti.find("-rpcuser");
-        auto passIt = settingsmulti.find("-rpcpassword");
-        auto portIt = settingsmulti.find("-rpcport");
-        auto hostIt = settingsmulti.find("-rpchost");
-        if (userIt != settingsmulti.end() &&
-            passIt != settingsmulti.end() &&
-            portIt != settingsmulti.end())
+        if ((_IsVerusActive() &&
+             ReadConfigFile("veth", settings, settingsmulti)) ||
+            (!_IsVerusActive() &&
+             ReadConfigFile(PBAAS_TESTMODE ? "vrsctest" : "VRSC", settings, settingsmulti)))
         {
-            PBAAS_USERPASS = userIt->second[0] + ":" + passIt->second[0];
-            PBAAS_PORT = atoi(portIt->second[0]);
-            PBAAS_HOST = hostIt != settingsmulti.end() ? hostIt->second[0] : "127.0.0.1";
-            if (!PBAAS_HOST.size())
+            // the Ethereum bridge, "VETH", serves as the root currency to VRSC and for Rinkeby to VRSCTEST
+            auto userIt = settingsmulti.find("-rpcuser");
+            auto passIt = settingsmulti.find("-rpcpassword");
+            auto portIt = settingsmulti.find("-rpcport");
+            auto hostIt = settingsmulti.find("-rpchost");
+            if (userIt != settingsmulti.end() &&
+                passIt != settingsmulti.end() &&
+                portIt != settingsmulti.end())
             {
-                PBAAS_HOST = "127.0.0.1";
+                PBAAS_USERPASS = userIt->second[0] + ":" + passIt->second[0];
+                PBAAS_PORT = atoi(portIt->second[0]);
+                PBAAS_HOST = hostIt != settingsmulti.end() ? hostIt->second[0] : "127.0.0.1";
+                if (!PBAAS_HOST.size())
+                {
+                    PBAAS_HOST = "127.0.0.1";
+                }
             }
-            return RPCCall(strMethod, params, credentials, port, host, timeout);
+        }
+        if (PBAAS_HOST == "" || PBAAS_PORT == 0)
+        {
+            return false;
         }
     }
+    credentials = PBAAS_USERPASS;
+    port = PBAAS_PORT;
+    host = PBAAS_HOST;
+    return true;
+}
+
+UniValue RPCCallRoot(const string& strMethod, const UniValue& params, int timeout)
+{
+    string host, credentials;
+    int port;
+
+    if (GetRootRPCConnection(credentials, port, host))
+    {
+        return RPCCall(strMethod, params, credentials, port, host, timeout);
+    }
     return UniValue(UniValue::VNULL);
 }
 
+std::vector<UniValue> RPCCallRootBatch(const std::vector<std::pair<std::string, UniValue>> &calls, int timeout)
+{
+    string host, credentials;
+    int port;
+
+    if (GetRootRPCConnection(credentials, port, host))
+    {
+        return RPCCallBatch(calls, credentials, port, host, timeout);
+    }
+    return std::vector<UniValue>(calls.size());
+}
+
 UniValue CCrossChainRPCData::ToUniValue() const
 {
     UniValue obj(UniValue::VOBJ);
@@ -287,14 +447,13 @@ CNodeData::CNodeData(std::string netAddr, std::string paymentAddr) :
 
 const std::map<std::string, CCurrencyDefinition::EHashTypes> &CIdentitySignature::HashTypeStringMap()
 {
-    static std::map<std::string, CCurrencyDefinition::EHashTypes> hashTypeMap;
-    if (!hashTypeMap.size())
-    {
-        hashTypeMap["sha256"] = CCurrencyDefinition::EHashTypes::HASH_SHA256;
-        hashTypeMap["blake2b"] = CCurrencyDefinition::EHashTypes::HASH_BLAKE2BMMR;
-        hashTypeMap["keccak256"] = CCurrencyDefinition::EHashTypes::HASH_KECCAK;
-        hashTypeMap["sha256D"] = CCurrencyDefinition::EHashTypes::HASH_SHA256D;
-    }
+    // initialized once, on first use by any thread
+    static const std::map<std::string, CCurrencyDefinition::EHashTypes> hashTypeMap({
+        {"sha256", CCurrencyDefinition::EHashTypes::HASH_SHA256},
+        {"blake2b", CCurrencyDefinition::EHashTypes::HASH_BLAKE2BMMR},
+        {"keccak256", CCurrencyDefinition::EHashTypes::HASH_KECCAK},
+        {"sha256D", CCurrencyDefinition::EHashTypes::HASH_SHA256D}
+    });
     return hashTypeMap;
 }
 
@@ -456,6 +615,26 @@ uint256 CIdentitySignature::IdentitySignatureHash(const std::vector<uint160> &vd
     return retVal;
 }
 
+static const int SIGNATURE_RECOVERY_CACHE_SIZE = 20000;
+static LRUCache<uint256, uint160> signatureRecoveryCache(SIGNATURE_RECOVERY_CACHE_SIZE, 0.1, true);
+
+bool CIdentitySignature::RecoverSignatureKeyID(const uint256 &signatureHash, const std::vector<unsigned char> &sig, uint160 &keyID)
+{
+    uint256 entry;
+    CSHA256().Write(signatureHash.begin(), signatureHash.size()).Write(sig.data(), sig.size()).Finalize(entry.begin());
+
+    // failed recoveries are cached as a null key ID
+    if (signatureRecoveryCache.Get(entry, keyID))
+    {
+        return !keyID.IsNull();
+    }
+
+    CPubKey checkKey;
+    keyID = checkKey.RecoverCompact(signatureHash, sig) ? uint160(checkKey.GetID()) : uint160();
+    signatureRecoveryCache.Put(entry, keyID);
+    return !keyID.IsNull();
+}
+
 CIdentitySignature::ESignatureVerification CIdentitySignature::CheckSignature(const CIdentity &signingID,
                                                                               const std::vector<uint160> &vdxfCodes,
                                                                               const std::vector<std::string> &vdxfCodeNames,
@@ -465,7 +644,6 @@ CIdentitySignature::ESignatureVerification CIdentitySignature::CheckSignature(co
                                                                               const uint256 &msgHash,
                                                                               std::vector<std::vector<unsigned char>> *pDupSigs) const
 {
-    CPubKey checkKey;
     std::set<uint160> keys;
     std::set<uint160> idKeys;
     for (auto &oneKey : signingID.primaryAddresses)
@@ -485,11 +663,11 @@ CIdentitySignature::ESignatureVerification CIdentitySignature::CheckSignature(co
         {
             return SIGNATURE_INVALID;
         }
-        if (!checkKey.RecoverCompact(signatureHash, oneSig))
+        uint160 checkKeyID;
+        if (!RecoverSignatureKeyID(signatureHash, oneSig, checkKeyID))
         {
             return SIGNATURE_INVALID;
         }
-        uint160 checkKeyID = checkKey.GetID();
 
         if (!idKeys.count(checkKeyID))
         {
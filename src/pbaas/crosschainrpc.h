@@ -23,8 +23,10 @@
 #include "boost/algorithm/string.hpp"
 #include "pbaas/vdxf.h"
 #include "utilstrencodings.h"
+#include "flatmap.h"
 
 static const int DEFAULT_RPC_TIMEOUT=900;
+static const int DEFAULT_NOTARY_RPC_CONNECTIONS=4;
 static const uint32_t PBAAS_VERSION = 1;
 static const uint32_t PBAAS_VERSION_INVALID = 0;
 
@@ -137,7 +139,15 @@ UniValue RPCCall(const std::string& strMethod,
                  const std::string host="127.0.0.1",
                  int timeout=DEFAULT_RPC_TIMEOUT);
 
+// sends all calls as one JSON-RPC batch and returns the reply to each call in the order of the calls
+std::vector<UniValue> RPCCallBatch(const std::vector<std::pair<std::string, UniValue>> &calls,
+                                   const std::string credentials="user:pass",
+                                   int port=27486,
+                                   const std::string host="127.0.0.1",
+                                   int timeout=DEFAULT_RPC_TIMEOUT);
+
 UniValue RPCCallRoot(const std::string& strMethod, const UniValue& params, int timeout=DEFAULT_RPC_TIMEOUT);
+std::vector<UniValue> RPCCallRootBatch(const std::vector<std::pair<std::string, UniValue>> &calls, int timeout=DEFAULT_RPC_TIMEOUT);
 
 class CNodeData
 {
@@ -387,7 +397,8 @@ extern int64_t AmountFromValueNoErr(const UniValue& value);
 class CCurrencyValueMap
 {
 public:
-    std::map<uint160, int64_t> valueMap;
+    // almost all maps hold one to four currencies, which are stored inline without allocation
+    flatmap<4, uint160, int64_t> valueMap;
 
     CCurrencyValueMap() {}
     CCurrencyValueMap(const CCurrencyValueMap &operand) : valueMap(operand.valueMap) {}
@@ -1468,6 +1479,10 @@ public:
                                           const uint256 &msgHash,
                                           std::vector<std::vector<unsigned char>> *pDupSigs=nullptr) const;
 
+    // recovers the ID of the key that made a compact signature of signatureHash. since the result depends only on the
+    // hash and signature, not identity state, recent recoveries are kept in a bounded cache and reused on repeat checks
+    static bool RecoverSignatureKeyID(const uint256 &signatureHash, const std::vector<unsigned char> &sig, uint160 &keyID);
+
     uint32_t Version()
     {
         return version;
@@ -8,36 +8,17 @@
 #include "utilstrencodings.h"
 #include "uint256.h"
 #include "mmr.h"
+#include "lrucache.h"
 #include <inttypes.h>
 
+// trie nodes that have matched their hashes. a proof node that is byte for byte the same as one of these does not need
+// to be hashed again, which saves most of the work for the upper nodes shared by storage proofs of the same account
+static LRUCache<uint256, std::shared_ptr<const std::vector<unsigned char>>> verifiedTrieNodeCache(10000, 0.1, true);
+
 /**
  * Helper functions
  * **/
 
-std::string string_to_hex(const std::string& input)
-{
-    static const char hex_digits[] = "0123456789ABCDEF";
-
-    std::string output;
-    output.reserve(input.length() * 2);
-    for (unsigned char c : input)
-    {
-        output.push_back(hex_digits[c >> 4]);
-        output.push_back(hex_digits[c & 15]);
-    }
-    return output;
-}
-
-std::string bytes_to_hex(const std::vector<unsigned char> &in)
-{
-    std::vector<unsigned char>::const_iterator from = in.cbegin();
-    std::vector<unsigned char>::const_iterator to = in.cend();
-    std::ostringstream oss;
-    for (; from != to; ++from)
-       oss << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(*from);
-    return oss.str();
-}
-
 std::vector<unsigned char> uint64_to_vec_BE(uint64_t input){
 
     std::vector<unsigned char> bytes;
@@ -48,58 +29,22 @@ std::vector<unsigned char> uint64_to_vec_BE(uint64_t input){
     std::reverse(bytes.begin(), bytes.end());
     return bytes;
 }
-/**
- * Returns the number of in order matching nibbles between the 2 arrays
- **/
-int matchingNibbleLength(std::vector<unsigned char> nibble1,std::vector<unsigned char> nibble2){
-    int i;
-    for(i = 0;nibble1[i] == nibble2[i] && nibble1.size() > i;i++){}
-    return i;
-}
-
-std::vector<unsigned char> toNibbles(std::vector<unsigned char> data){
-    //convert the unsigned char to a hex string the hex string back to a vector of unsigned char
-    std::string tempString = bytes_to_hex(data);
-    std::vector<unsigned char> output(tempString.begin(),tempString.end());
-    return output;
-}
-
-std::vector<unsigned char> toNibbles(std::string data){
-    //convert the unsigned char to a hex string the hex string back to a vector of unsigned char
-    //string tempString = bytes_to_hex(data);
-    //check if its an even length if not add a 0 on the front
-    if(data.length()%2 != 0){
-        data = "0" + data;
-    }
-    std::vector<unsigned char> output(data.begin(),data.end());
-    return output;
-}
-
-TrieNode::nodeType TrieNode::setType(){
-    if(raw.size() == 17) return BRANCH;
-    else if(raw.size() == 2){
-        std::vector<unsigned char> nodeKey = toNibbles(raw[0]);
-        //is the key a terminator
-        if(nodeKey[0] > 1) return LEAF;
-        return EXTENSION;
-    }
-    return BRANCH;
-}
-void TrieNode::setKey(){
-    if(type != BRANCH && raw[0].size() > 0){
-        std::vector<unsigned char> inProgressKey = toNibbles(raw[0]);
-        int adjustment = 0;
-        if (int(inProgressKey[0]) % 2) {
-            adjustment = 1;
-        } else {
-            adjustment = 2;
+TrieNode::TrieNode(const std::vector<RLP::rlpItem> &rawNode) : type(BRANCH)
+{
+    // nodes with two items are leaves or extensions, which are checked the same way. anything else is a branch
+    if (rawNode.size() == 2)
+    {
+        type = LEAF;
+        const RLP::rlpItem &hpKey = rawNode[0];
+        if (hpKey.size)
+        {
+            // the hex prefix flag nibble has always been checked as a hex digit character, on which a through f
+            // have the opposite parity to their values. only 0 through 3 are valid, but the check is kept as it was
+            unsigned char flag = hpKey.data[0] >> 4;
+            size_t adjustment = ((flag < 10 ? flag : flag + 1) & 1) ? 1 : 2;
+            key = nibbleView(hpKey.data, adjustment, hpKey.size << 1);
         }
-        key = std::vector<unsigned char>(inProgressKey.begin() + adjustment,inProgressKey.end());
-    }
-}
-void TrieNode::setValue(){
-    if(type != BRANCH){
-        value = raw[1];
+        value = rawNode[1];
     }
 }
 
@@ -159,7 +104,7 @@ std::vector<unsigned char> RLP::encodeLength_deprecated(int length,int offset){
 }
 
 
-std::vector<unsigned char> RLP::encode(std::vector<unsigned char> input){
+std::vector<unsigned char> RLP::encode(const std::vector<unsigned char> &input){
     std::vector<unsigned char> output;
     if(input.size() == 1 && input[0] < 128 ) return input;
     else {
@@ -169,7 +114,7 @@ std::vector<unsigned char> RLP::encode(std::vector<unsigned char> input){
         }
     }
 
-std::vector<unsigned char> RLP::encode(std::vector<std::vector<unsigned char>> input){
+std::vector<unsigned char> RLP::encode(const std::vector<std::vector<unsigned char>> &input){
     std::vector<unsigned char> encoded;
     std::vector<unsigned char> inProgress;
     for(int i = 0; i < input.size(); i++){
@@ -181,205 +126,222 @@ std::vector<unsigned char> RLP::encode(std::vector<std::vector<unsigned char>> i
     return output;
 }
 
-RLP::rlpDecoded RLP::decode(std::vector<unsigned char> inputBytes){
+// reads a big endian length of lengthSize bytes, which must be followed by at least that many bytes of data
+static size_t decodeRLPLength(const unsigned char *lengthBytes, size_t lengthSize, size_t available)
+{
+    if (lengthSize > available)
+    {
+        throw std::invalid_argument("invalid rlp: length is larger than the data");
+    }
+    size_t length = 0;
+    for (size_t i = 0; i < lengthSize; i++)
+    {
+        length = (length << 8) | lengthBytes[i];
+        if (length > available)
+        {
+            throw std::invalid_argument("invalid rlp: length is larger than the data");
+        }
+    }
+    return length;
+}
 
-    std::vector<unsigned char> inProgress;
-    std::vector<std::vector <unsigned char>>  decoded;
+size_t RLP::decodeItems(const unsigned char *inputBytes, size_t size, std::vector<rlpItem> &items)
+{
+    if (!size)
+    {
+        throw std::invalid_argument("invalid rlp: no data");
+    }
     unsigned char firstByte = inputBytes[0];
-    rlpDecoded output;
-    unsigned int length = 0;
-
-    std::vector<unsigned char> innerRemainder;
 
-    if(firstByte <= 0x7f) {
+    if (firstByte <= 0x7f)
+    {
         // the data is a string if the range of the first byte(i.e. prefix) is [0x00, 0x7f],
-        //and the string is the first byte itself exactly;
-        inProgress.push_back(firstByte);
-        output.data.push_back(inProgress);
-        inputBytes.erase(inputBytes.begin());
-        output.remainder = inputBytes;
-
-    } else if (firstByte <= 0xb7) {
-        //the data is a string if the range of the first byte is [0x80, 0xb7], and the string whose
-        //length is equal to the first byte minus 0x80 follows the first byte;
-        length = (int)(firstByte - 0x7f);
-        if (firstByte == 0x80) {
-            inProgress = std::vector<unsigned char>();
-        } else {
-            //teh byte std::vector removing the first byte
-            inProgress = std::vector<unsigned char>(inputBytes.begin()+1,inputBytes.begin() + length);
-            //input.slice(1, length);
-            //for (auto const& c : inProgress)
-            //    std::cout << c << ' ';
+        // and the string is the first byte itself exactly
+        items.push_back(rlpItem(inputBytes, 1));
+        return 1;
+    }
+    else if (firstByte <= 0xb7)
+    {
+        // the data is a string if the range of the first byte is [0x80, 0xb7], and the string whose
+        // length is equal to the first byte minus 0x80 follows the first byte
+        size_t length = firstByte - 0x80;
+        if (length >= size)
+        {
+            throw std::invalid_argument("invalid RLP");
         }
-        if (length == 2 && inProgress[0] < 0x80) {
+        if (length == 1 && inputBytes[1] < 0x80)
+        {
             throw std::invalid_argument("invalid rlp encoding: byte must be less 0x80");
         }
-        output.data.push_back(inProgress);
-        output.remainder = std::vector<unsigned char>(inputBytes.begin()+length,inputBytes.end());
-        return output;
-    } else if(firstByte <= 0xbf){
-        //the data is a string if the range of the first byte is [0xb8, 0xbf], and the length of the string
-        //whose length in bytes is equal to the first byte minus 0xb7 follows the first byte, and the string
-        //follows the length of the string;
-        int dataLength = (int)(firstByte - 0xb6);
-        //calculate the length from the string and convert the hexbytes to an int
-        std::string lengthString = string_to_hex(std::string(inputBytes.begin()+1,inputBytes.begin() + dataLength));
-        //boost::algorithm::hex(inputBytes.begin()+1,inputBytes.begin() + dataLength, back_inserter(lengthString));
-        length = std::stoi(lengthString, nullptr, 16);
-        // inProgress = std::std::vector<unsigned char>(inputBytes.begin() + length,inputBytes.begin() + length + dataLength );
-        std::vector<unsigned char>inProgress(inputBytes.begin() + dataLength,inputBytes.begin() + length + dataLength);
-        if(inProgress.size() < length){
+        items.push_back(rlpItem(inputBytes + 1, length));
+        return 1 + length;
+    }
+    else if (firstByte <= 0xbf)
+    {
+        // the data is a string if the range of the first byte is [0xb8, 0xbf], and the length of the string
+        // whose length in bytes is equal to the first byte minus 0xb7 follows the first byte, and the string
+        // follows the length of the string
+        size_t lengthSize = firstByte - 0xb7;
+        size_t length = decodeRLPLength(inputBytes + 1, lengthSize, size - 1);
+        if (length > size - 1 - lengthSize)
+        {
             throw std::invalid_argument("invalid RLP");
         }
-        output.data.push_back(inProgress);
-        output.remainder = std::vector<unsigned char>(inputBytes.begin() + dataLength + length,inputBytes.end());
-        return output;
-    } else if(firstByte <= 0xf7){
-        length = (int)(firstByte - 0xbf);
-        std::vector<unsigned char> innerRemainder;
-        innerRemainder = std::vector<unsigned char>(inputBytes.begin() + 1,inputBytes.begin() + length);
-        //need to recurse
-        rlpDecoded innerRLP;
-        while(innerRemainder.size()){
-            innerRLP = decode(innerRemainder);
-            //loop through the returned data array and push back each element
-            for(std::size_t i=0; i<innerRLP.data.size(); ++i)  {
-                decoded.push_back(innerRLP.data[i]);
-            }
-            innerRemainder = innerRLP.remainder;
+        items.push_back(rlpItem(inputBytes + 1 + lengthSize, length));
+        return 1 + lengthSize + length;
+    }
+
+    // lists, whose items are added in order, including the items of any nested lists
+    size_t lengthSize = 0, length;
+    if (firstByte <= 0xf7)
+    {
+        length = firstByte - 0xc0;
+        if (length >= size)
+        {
+            throw std::invalid_argument("invalid rlp: total length is larger than the data");
         }
-        output.data = decoded;
-        output.remainder = std::vector<unsigned char>(inputBytes.begin()+length,inputBytes.end());
-        return output;
-    } else {
-        int dataLength = (int)(firstByte - 0xf6);
-        std::string testBytes(inputBytes.begin(),inputBytes.end()); //not used
-        std::string lengthString(inputBytes.begin()+1,inputBytes.begin() + dataLength);
-        lengthString = string_to_hex(lengthString);
-        //boost::algorithm::hex(inputBytes.begin()+1,inputBytes.begin() + dataLength, back_inserter(lengthString));
-
-        length = std::stoul(lengthString, nullptr, 16);
-        int totalLength = dataLength + length;
-        if(totalLength > inputBytes.size()) {
+    }
+    else
+    {
+        lengthSize = firstByte - 0xf7;
+        length = decodeRLPLength(inputBytes + 1, lengthSize, size - 1);
+        if (length > size - 1 - lengthSize)
+        {
             throw std::invalid_argument("invalid rlp: total length is larger than the data");
         }
-        innerRemainder = std::vector<unsigned char>(inputBytes.begin() + dataLength,inputBytes.begin() + totalLength);
-
-        if(innerRemainder.size() == 0){
+        if (!length)
+        {
             throw std::invalid_argument("invalid rlp: List has an invalid length");
         }
-        while(innerRemainder.size()){
-            rlpDecoded innerRLP = decode(innerRemainder);
-            //loop through the returned data array and push back each element
-            for(std::size_t i=0; i<innerRLP.data.size(); ++i)  {
-                decoded.push_back(innerRLP.data[i]);
-            }
-            innerRemainder = innerRLP.remainder;
+    }
+
+    const unsigned char *payload = inputBytes + 1 + lengthSize;
+    for (size_t offset = 0; offset < length; )
+    {
+        offset += decodeItems(payload + offset, length - offset, items);
+        if (offset > length)
+        {
+            throw std::invalid_argument("invalid rlp: item is larger than its list");
         }
-        output.data = decoded;
-        output.remainder = std::vector<unsigned char>(inputBytes.begin()+length,inputBytes.end());
-        return output;
     }
 
-    return output;
+    // the remainder of a long list has always been taken from its payload length rather than its total length.
+    // that only matters for long lists nested in other lists, which valid trie nodes do not have
+    return lengthSize ? length : 1 + length;
+}
+
+RLP::rlpDecoded RLP::decode(const std::vector<unsigned char> &inputBytes)
+{
+    std::vector<rlpItem> items;
+    size_t remainderOffset = decodeItems(inputBytes.data(), inputBytes.size(), items);
 
+    rlpDecoded output;
+    output.data.reserve(items.size());
+    for (auto &oneItem : items)
+    {
+        output.data.push_back(oneItem.toVector());
+    }
+    output.remainder = std::vector<unsigned char>(inputBytes.begin() + remainderOffset, inputBytes.end());
+    return output;
 }
 
-RLP::rlpDecoded RLP::decode(std::string inputString){
+RLP::rlpDecoded RLP::decode(const std::string &inputString){
     std::vector<unsigned char> inputBytes = ParseHex(inputString);
     return decode(inputBytes);
 }
 
 template<>
-std::vector<unsigned char> CETHPATRICIABranch::verifyProof(uint256& rootHash,std::vector<unsigned char> key,std::vector<std::vector<unsigned char>>& proof){
-
+std::vector<unsigned char> CETHPATRICIABranch::verifyProof(const uint256 &rootHash, const std::vector<unsigned char> &key, const std::vector<std::vector<unsigned char>> &proof)
+{
+    // nodes are decoded in place, and the key is walked one nibble at a time, so nothing is copied until the value
+    // is returned
     uint256 wantedHash = rootHash;
-    RLP rlp;
+    TrieNode::nibbleView keyNibbles(key.data(), 0, key.size() << 1);
+    size_t keyPos = 0;
+    std::vector<RLP::rlpItem> items, embeddedItems;
+    items.reserve(17);
 
-    key = toNibbles(key);
     //loop through each element in the proof
     for(std::size_t i=0; i< proof.size(); ++i)  {
 
         //check to see if the hash of the node matches the expected hash
-        CKeccack256Writer writer;
-        writer.write((const char *)proof[i].data(), proof[i].size());
+        std::shared_ptr<const std::vector<unsigned char>> pVerifiedNode;
+        if (!verifiedTrieNodeCache.Get(wantedHash, pVerifiedNode) || *pVerifiedNode != proof[i])
+        {
+            CKeccack256Writer writer;
+            writer.write((const char *)proof[i].data(), proof[i].size());
 
-        if(writer.GetHash() != wantedHash){
-            std::string error("Bad proof node: i=");
-            error += std::to_string(i);
-            throw std::invalid_argument(error);
+            if(writer.GetHash() != wantedHash){
+                std::string error("Bad proof node: i=");
+                error += std::to_string(i);
+                throw std::invalid_argument(error);
+            }
+            verifiedTrieNodeCache.Put(wantedHash, std::make_shared<const std::vector<unsigned char>>(proof[i]));
         }
-        //create a trie node
-        TrieNode node(rlp.decode(proof[i]).data);
-        std::vector<unsigned char> child;
+
+        items.clear();
+        RLP::decodeItems(proof[i].data(), proof[i].size(), items);
+        TrieNode node(items);
+        RLP::rlpItem child;
+        size_t keyLeft = keyNibbles.size() - keyPos;
+
         if(node.type == node.BRANCH) {
-            if(key.size() == 0) {
+            if(keyLeft == 0) {
                 if(i != proof.size() -1){
                     throw std::invalid_argument(std::string("Additional nodes at end of proof (branch)"));
                 }
-                return node.value;
+                return node.value.toVector();
             }
 
-            int keyIndex = HexDigit(key[0]);
-
-            child = node.raw[keyIndex];
-            //remove the first nibble of the key as we move up the std::vector
-            key = std::vector<unsigned char>(key.begin()+1,key.end());
+            unsigned char keyIndex = keyNibbles[keyPos];
+            if (keyIndex >= items.size())
+            {
+                throw std::invalid_argument(std::string("Branch node is missing the key's child"));
+            }
+            child = items[keyIndex];
+            //remove the first nibble of the key as we move down the trie
+            keyPos++;
+            keyLeft--;
 
-            if(child.size() == 2){
-                //MIGHT NOT NEED TO DECODE THIS HERE
-                //RLP::rlpDecoded decodedEmbeddedNode = rlp.decode(child).data;
-                TrieNode embeddedNode(rlp.decode(child).data);
+            if(child.size == 2){
+                embeddedItems.clear();
+                RLP::decodeItems(child.data, child.size, embeddedItems);
+                TrieNode embeddedNode(embeddedItems);
 
                 if(i != proof.size() -1){
                     throw std::invalid_argument(std::string("Additional nodes at end of proof (embeddedNode)"));
                 }
 
-                if(matchingNibbleLength(node.key,key)!= node.key.size()){
-                    throw std::invalid_argument(std::string("Key length does not match with the proof one (embeddedNode)"));
-                }
-
-                //check that the embedded node key matches the relevant portion of the node key
-
-                key = std::vector<unsigned char>(key.begin() + embeddedNode.key.size(),key.end());
-                if(key.size() !=0){
+                // a branch has no key of its own, so only the length of the embedded node key is checked against the
+                // rest of the key
+                if(embeddedNode.key.size() != keyLeft){
                     throw std::invalid_argument(std::string("Key does not match with the proof one (embeddedNode)"));
                 }
 
-                return embeddedNode.value;
-            } else {
-                uint256 tmp_child;
-                memcpy(&tmp_child,&child.at(0),child.size());
-                wantedHash = tmp_child;
+                return embeddedNode.value.toVector();
             }
-        } else if(node.type == node.EXTENSION || node.type == node.LEAF){
-            if(matchingNibbleLength(node.key,key) != node.key.size()){
+        } else {
+            if(node.key.matchingLength(TrieNode::nibbleView(key.data(), keyPos, keyNibbles.end)) != node.key.size()){
                 throw std::invalid_argument(std::string("Key does not match with the proof one (embeddedNode)"));
             }
             child = node.value;
-            key = std::vector<unsigned char>(key.begin() + node.key.size(),key.end());
+            keyPos += node.key.size();
+            keyLeft -= node.key.size();
 
-            if (key.size() == 0 || child.size() == 17 && key.size() == 1) {
-                // The value is in an embedded branch. Extract it.
-                if (child.size() == 17) {
-                    //child = child[key[0]][1];
-                    //key = std::vector<unsigned char>(key.begin() + 1,key.end());
-                }
+            if (keyLeft == 0 || child.size == 17 && keyLeft == 1) {
                 if (i != proof.size() - 1) {
                     throw std::invalid_argument(std::string("Additional nodes at end of proof (extention|leaf)"));
                 }
-                return child;
-            } else {
-                uint256 tmp_child;
-                memcpy(&tmp_child,&child.at(0),child.size());
-                wantedHash = tmp_child;
+                return child.toVector();
             }
-
-        } else {
-                throw std::invalid_argument(std::string("Invalid node type"));
         }
 
+        if (child.size == 0 || child.size > wantedHash.size())
+        {
+            throw std::invalid_argument(std::string("Invalid child node hash"));
+        }
+        wantedHash.SetNull();
+        memcpy(wantedHash.begin(), child.data, child.size);
     }
     return {0};
 }
@@ -400,6 +362,7 @@ std::vector<unsigned char> CETHPATRICIABranch::verifyAccountProof()
 
         //As we dont have the state root from the Notaries, spoof the state root to pass for first RLP loop check
         stateRoot =  stateroot_hasher.GetHash();
+
         return verifyProof(stateRoot,address_hash,proofdata.proof_branch);
     }catch(const std::invalid_argument& e){
 
@@ -425,14 +388,20 @@ uint256 CETHPATRICIABranch::verifyStorageProof(uint256 ccExporthash, bool optimi
         uint256 key_hash = key_hasher.GetHash();
         std::vector<unsigned char> storageProofKey_vec(key_hash.begin(),key_hash.end());
         std::vector<unsigned char> storageValue = verifyProof(storageHash,storageProofKey_vec,storageProof.proof_branch);
-        RLP::rlpDecoded decodedValue = rlp.decode(bytes_to_hex(storageValue));
+        std::vector<RLP::rlpItem> decodedValue;
+        RLP::decodeItems(storageValue.data(), storageValue.size(), decodedValue);
 
-        while(decodedValue.data[0].size() < 32)
+        if(decodedValue.empty())
         {
-            decodedValue.data[0].insert(decodedValue.data[0].begin(), 0x00); //proofs can be truncated on the left.
+            throw std::invalid_argument(std::string("RLP Storage Value is empty"));
         }
 
-        if(ccExporthash_vec != decodedValue.data[0])
+        //proofs can be truncated on the left, so the value matches if it is the hash without leading zeros
+        const RLP::rlpItem &value = decodedValue[0];
+        size_t leadingZeros = ccExporthash_vec.size() - std::min(value.size, ccExporthash_vec.size());
+        if(value.size > ccExporthash_vec.size() ||
+           std::any_of(ccExporthash_vec.begin(), ccExporthash_vec.begin() + leadingZeros, [](unsigned char c) { return c != 0; }) ||
+           memcmp(ccExporthash_vec.data() + leadingZeros, value.data, value.size))
         {
             throw std::invalid_argument(std::string("RLP Storage Value does not match"));
         }
@@ -13,10 +13,12 @@
  *
  *
  */
+#include "cc/eval.h"
 #include "main.h"
 #include "pbaas/pbaas.h"
 #include "pbaas/notarization.h"
 #include "identity.h"
+#include "trace.h"
 #include "txdb.h"
 
 extern CTxMemPool mempool;
@@ -148,11 +150,109 @@ bool CIdentity::IsInvalidMutation(const CIdentity &newIdentity, uint32_t height,
     return false;
 }
 
-LRUCache<std::pair<uint256, CIdentityID>, std::tuple<CIdentity, uint32_t, CTxIn>> CIdentity::IdentityLookupCache(6000);
+ShardedLRUCache<CIdentityID, std::tuple<CIdentity, uint32_t, CTxIn>> CIdentity::IdentityLookupCache(CIdentity::DEFAULT_LOOKUP_CACHE_SIZE, 0.1, true);
+
+// incremented on every invalidation, so a lookup that raced with a block being connected or disconnected does not
+// put the state it read before the block into the cache
+static CCriticalSection cs_identityLookupCache;
+static uint64_t identityLookupCacheGeneration = 0;
+
+// bloom filter of the IDs of all identities in the identity state index. identity IDs are already uniformly distributed
+// hashes of their normalized names, so the bit positions are taken directly from the ID. an ID not in the filter is not
+// in the index, which answers most lookups of unregistered names, such as during registration, without a seek.
+static CCriticalSection cs_identityExistenceFilter;
+static std::vector<uint64_t> identityExistenceFilter;
+static bool identityExistenceFilterLoaded = false;
+
+static const int IDENTITY_EXISTENCE_FILTER_BITS_PER_ID = 16;
+static const size_t IDENTITY_EXISTENCE_FILTER_MIN_IDS = 1 << 20;
+
+static void AddToIdentityExistenceFilter(const CIdentityID &idID)
+{
+    AssertLockHeld(cs_identityExistenceFilter);
+    if (!identityExistenceFilter.size())
+    {
+        return;
+    }
+    uint64_t nBits = identityExistenceFilter.size() * 64;
+    for (int i = 0; i < 5; i++)
+    {
+        uint64_t bit = ReadLE32(idID.begin() + (i << 2)) % nBits;
+        identityExistenceFilter[bit >> 6] |= ((uint64_t)1 << (bit & 63));
+    }
+}
+
+static bool IdentityExistenceFilterContains(const CIdentityID &idID)
+{
+    AssertLockHeld(cs_identityExistenceFilter);
+    uint64_t nBits = identityExistenceFilter.size() * 64;
+    for (int i = 0; i < 5; i++)
+    {
+        uint64_t bit = ReadLE32(idID.begin() + (i << 2)) % nBits;
+        if (!(identityExistenceFilter[bit >> 6] & ((uint64_t)1 << (bit & 63))))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CIdentity::LoadExistenceFilter()
+{
+    std::vector<uint160> identityIDs;
+    if (!fIdentityStateIndex || !pblocktree->ReadIdentityStateIndexIDs(identityIDs))
+    {
+        return false;
+    }
+
+    // leave room to grow, as the filter is not resized while running
+    size_t filterIDs = std::max(identityIDs.size() << 1, IDENTITY_EXISTENCE_FILTER_MIN_IDS);
+
+    LOCK(cs_identityExistenceFilter);
+    identityExistenceFilter.assign((filterIDs * IDENTITY_EXISTENCE_FILTER_BITS_PER_ID) >> 6, 0);
+    for (auto &oneID : identityIDs)
+    {
+        AddToIdentityExistenceFilter(oneID);
+    }
+    identityExistenceFilterLoaded = true;
+    LogPrintf("%s: loaded %lu identities into identity existence filter\n", __func__, identityIDs.size());
+    return true;
+}
+
+bool CIdentity::MayExist(const CIdentityID &idID)
+{
+    LOCK(cs_identityExistenceFilter);
+    return !identityExistenceFilterLoaded || IdentityExistenceFilterContains(idID);
+}
+
+void CIdentity::InvalidateLookupCache(const CTransaction &tx)
+{
+    for (auto &oneOut : tx.vout)
+    {
+        COptCCParams p;
+        CIdentity identity;
+        if (oneOut.scriptPubKey.IsPayToCryptoCondition(p) &&
+            p.IsValid() &&
+            p.evalCode == EVAL_IDENTITY_PRIMARY &&
+            p.vData.size() &&
+            (identity = CIdentity(p.vData[0])).IsValid())
+        {
+            {
+                LOCK(cs_identityLookupCache);
+                identityLookupCacheGeneration++;
+                IdentityLookupCache.Erase(identity.GetID());
+            }
+
+            // also called on disconnect, where adding the ID is harmless, since the filter may have false positives
+            LOCK(cs_identityExistenceFilter);
+            AddToIdentityExistenceFilter(identity.GetID());
+        }
+    }
+}
 
 CIdentity CIdentity::LookupIdentity(const CIdentityID &nameID, uint32_t height, uint32_t *pHeightOut, CTxIn *pIdTxIn, bool checkMempool)
 {
-    LOCK(mempool.cs);
+    LOCK_UNLESS_BLOCK_CHECK(mempool.cs);
 
     CIdentity ret;
 
@@ -175,25 +275,31 @@ CIdentity CIdentity::LookupIdentity(const CIdentityID &nameID, uint32_t height,
     CTxIn &idTxIn = *pIdTxIn;
 
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>> unspentOutputs, unspentNewIDX;
-    std::vector<std::pair<CInputDescriptor, uint32_t>> unspentInputs;
 
     uint160 keyID(CCrossChainRPCData::GetConditionID(nameID, EVAL_IDENTITY_PRIMARY));
 
+    uint64_t cacheGeneration;
+    {
+        LOCK(cs_identityLookupCache);
+        cacheGeneration = identityLookupCacheGeneration;
+    }
+
     if ((!height || height > chainActive.Height()) && checkMempool)
     {
-        ConnectedChains.GetUnspentByIndex(keyID, unspentInputs);
-        // if we got it from the mempool, don't check view
-        if (unspentInputs.size() && !unspentInputs[0].second)
+        // the mempool keeps the latest pending state of each identity, if we got it from there, don't check view
+        COutPoint pendingOutput;
+        CScript pendingScript;
+        if (mempool.getPendingIdentity(nameID, pendingOutput, pendingScript))
         {
             COptCCParams p;
-            if (unspentInputs[0].first.scriptPubKey.IsPayToCryptoCondition(p) &&
+            if (pendingScript.IsPayToCryptoCondition(p) &&
                 p.IsValid() &&
                 p.evalCode == EVAL_IDENTITY_PRIMARY &&
-                (ret = CIdentity(unspentInputs[0].first.scriptPubKey)).IsValid())
+                (ret = CIdentity(pendingScript)).IsValid())
             {
                 if (ret.GetID() == nameID)
                 {
-                    idTxIn = CTxIn(unspentInputs[0].first.txIn.prevout.hash, unspentInputs[0].first.txIn.prevout.n);
+                    idTxIn = CTxIn(pendingOutput.hash, pendingOutput.n);
                     *pHeightOut = -1;
                 }
                 else
@@ -204,22 +310,38 @@ CIdentity CIdentity::LookupIdentity(const CIdentityID &nameID, uint32_t height,
                 return ret;
             }
         }
-        unspentInputs.clear();
     }
-    // TODO: NEXTRELEASE - uncomment cache code
-    /* else if (height)
+
+    // the latest confirmed state is also the state as of any height at or above the one it was confirmed at
+    bool latestState = !height || height >= chainActive.Height();
+    std::tuple<CIdentity, uint32_t, CTxIn> cachedIdentity;
+    if (IdentityLookupCache.Get(nameID, cachedIdentity) && (latestState || std::get<1>(cachedIdentity) <= height))
     {
-        std::tuple<CIdentity, uint32_t, CTxIn> cachedIdentity;
-        if (std::get<0>(cachedIdentity = IdentityLookupCache.Get({chainActive[height > chainActive.Height() ? chainActive.Height() : height]->GetBlockHash(), nameID})).IsValid())
+        *pHeightOut = std::get<1>(cachedIdentity);
+        idTxIn = std::get<2>(cachedIdentity);
+        ret = std::get<0>(cachedIdentity);
+        return ret;
+    }
+    TRACE2(identity, cache_miss, nameID.begin(), height);
+
+    if (fIdentityStateIndex)
+    {
+        // the identity index holds every confirmed state of each identity, so one seek finds the state as of any height
+        CIdentityStateIndexEntry indexEntry;
+        if (MayExist(nameID) &&
+            pblocktree->ReadIdentityStateIndex(nameID, (height > chainActive.Height()) ? 0 : height, indexEntry))
         {
-            *pHeightOut = std::get<1>(cachedIdentity);
-            idTxIn = std::get<2>(cachedIdentity);
-            ret = std::get<0>(cachedIdentity);
-            return ret;
+            ret = indexEntry.second.second;
+            idTxIn = CTxIn(indexEntry.second.first, indexEntry.first.index);
+            *pHeightOut = indexEntry.first.height;
         }
-    } */
-
-    if (unspentOutputs.size() || GetAddressUnspent(keyID, CScript::P2IDX, unspentNewIDX) && GetAddressUnspent(keyID, CScript::P2PKH, unspentOutputs))
+        else
+        {
+            ret = CIdentity();
+            idTxIn = CTxIn();
+        }
+    }
+    else if (unspentOutputs.size() || GetAddressUnspent(keyID, CScript::P2IDX, unspentNewIDX) && GetAddressUnspent(keyID, CScript::P2PKH, unspentOutputs))
     {
         // combine searches into 1 vector
         unspentOutputs.insert(unspentOutputs.begin(), unspentNewIDX.begin(), unspentNewIDX.end());
@@ -285,7 +407,7 @@ CIdentity CIdentity::LookupIdentity(const CIdentityID &nameID, uint32_t height,
                     CTransaction idTx;
                     uint256 blkHash;
                     COptCCParams p;
-                    LOCK(mempool.cs);
+                    LOCK_UNLESS_BLOCK_CHECK(mempool.cs);
                     if (!addressIndex[i].first.spending &&
                         (addressIndex[i].first.blockHeight == 1 || addressIndex[i].first.txindex > txIndex) &&    // always select the latest in a block, if there can be more than one
                         myGetTransaction(addressIndex[i].first.txhash, idTx, blkHash) &&
@@ -309,15 +431,119 @@ CIdentity CIdentity::LookupIdentity(const CIdentityID &nameID, uint32_t height,
         }
     }
 
-    // TODO: NEXTRELEASE - uncomment cache code
-    /* if (height && !(height > chainActive.Height() && checkMempool))
+    if (latestState && ret.IsValid())
     {
-        IdentityLookupCache.Put({chainActive[height > chainActive.Height() ? chainActive.Height() : height]->GetBlockHash(), nameID}, {ret, *pHeightOut, idTxIn});
-    } */
+        LOCK(cs_identityLookupCache);
+        if (cacheGeneration == identityLookupCacheGeneration)
+        {
+            IdentityLookupCache.Put(nameID, std::make_tuple(ret, *pHeightOut, idTxIn));
+        }
+    }
 
     return ret;
 }
 
+// looks up many identities in one pass. with the identity state index, all that are not cached or ruled out by the
+// existence filter are read with one index iterator, otherwise each is looked up on its own. identities that are not
+// found are not in the result.
+std::map<CIdentityID, std::tuple<CIdentity, uint32_t, CTxIn>>
+CIdentity::LookupIdentityBatch(const std::vector<CIdentityID> &nameIDs, uint32_t height, bool checkMempool)
+{
+    std::map<CIdentityID, std::tuple<CIdentity, uint32_t, CTxIn>> retMap;
+
+    LOCK_UNLESS_BLOCK_CHECK(mempool.cs);
+
+    bool latestState = !height || height >= chainActive.Height();
+
+    // the mempool is only checked one at a time, so the same rules as a single lookup apply
+    if (!fIdentityStateIndex || (checkMempool && (!height || height > chainActive.Height())))
+    {
+        for (auto &oneID : nameIDs)
+        {
+            uint32_t heightOut;
+            CTxIn idTxIn;
+            CIdentity oneIdentity = LookupIdentity(oneID, height, &heightOut, &idTxIn, checkMempool);
+            if (oneIdentity.IsValid())
+            {
+                retMap[oneID] = std::make_tuple(oneIdentity, heightOut, idTxIn);
+            }
+        }
+        return retMap;
+    }
+
+    uint64_t cacheGeneration;
+    {
+        LOCK(cs_identityLookupCache);
+        cacheGeneration = identityLookupCacheGeneration;
+    }
+
+    std::vector<uint160> toRead;
+    for (auto &oneID : nameIDs)
+    {
+        std::tuple<CIdentity, uint32_t, CTxIn> cachedIdentity;
+        if (retMap.count(oneID))
+        {
+            continue;
+        }
+        if (IdentityLookupCache.Get(oneID, cachedIdentity) && (latestState || std::get<1>(cachedIdentity) <= height))
+        {
+            retMap[oneID] = cachedIdentity;
+        }
+        else if (MayExist(oneID))
+        {
+            toRead.push_back(oneID);
+        }
+    }
+
+    std::vector<CIdentityStateIndexEntry> indexEntries;
+    if (toRead.size() &&
+        pblocktree->ReadIdentityStateIndex(toRead, (height > chainActive.Height()) ? 0 : height, indexEntries))
+    {
+        LOCK(cs_identityLookupCache);
+        for (auto &oneEntry : indexEntries)
+        {
+            auto oneResult = std::make_tuple(oneEntry.second.second, oneEntry.first.height, CTxIn(oneEntry.second.first, oneEntry.first.index));
+            retMap[oneEntry.first.identityID] = oneResult;
+            if (latestState && cacheGeneration == identityLookupCacheGeneration)
+            {
+                IdentityLookupCache.Put(oneEntry.first.identityID, oneResult);
+            }
+        }
+    }
+    return retMap;
+}
+
+bool GetIdentityStateIndexEntry(const CTxOut &out, const uint256 &txHash, unsigned int txIndex, unsigned int outNum, unsigned int height, CIdentityStateIndexEntry &entry)
+{
+    COptCCParams p;
+    CIdentity identity;
+    if (out.scriptPubKey.IsPayToCryptoCondition(p) &&
+        p.IsValid() &&
+        p.evalCode == EVAL_IDENTITY_PRIMARY &&
+        (identity = CIdentity(out.scriptPubKey)).IsValid())
+    {
+        entry = CIdentityStateIndexEntry(CIdentityStateIndexKey(identity.GetID(), height, txIndex, outNum), std::make_pair(txHash, identity));
+        return true;
+    }
+    return false;
+}
+
+bool GetIdentityCommitmentIndexEntry(const CTxOut &out, const uint256 &txHash, unsigned int txIndex, unsigned int outNum, unsigned int height, CIdentityCommitmentIndexEntry &entry)
+{
+    COptCCParams p;
+    CCommitmentHash ch;
+    if (out.scriptPubKey.IsPayToCryptoCondition(p) &&
+        p.IsValid() &&
+        p.evalCode == EVAL_IDENTITY_COMMITMENT &&
+        p.vData.size() &&
+        !(ch = CCommitmentHash(p.vData[0])).hash.IsNull())
+    {
+        entry = CIdentityCommitmentIndexEntry(CIdentityCommitmentIndexKey(ch.hash, height, txIndex, outNum), txHash);
+        return true;
+    }
+    return false;
+}
+
 std::vector<std::tuple<CIdentity, uint256, uint32_t, CUTXORef, CPartialTransactionProof>>
 CIdentity::LookupIdentities(const CIdentityID &nameID,
                             uint32_t gteHeight,
@@ -450,6 +676,9 @@ CIdentity::LookupIdentities(const CIdentityID &nameID,
     return retVal;
 }
 
+static std::multimap<uint160, std::tuple<std::vector<unsigned char>, uint256, uint32_t, CUTXORef, CPartialTransactionProof>>
+AggregateIdentityMultimap(const std::vector<std::tuple<CIdentity, uint256, uint32_t, CUTXORef, CPartialTransactionProof>> &identityHistory);
+
 std::multimap<uint160, std::tuple<std::vector<unsigned char>, uint256, uint32_t, CUTXORef, CPartialTransactionProof>>
 CIdentity::GetAggregatedIdentityMultimap(const uint160 &idID,
                                          uint32_t startHeight,
@@ -461,9 +690,6 @@ CIdentity::GetAggregatedIdentityMultimap(const uint160 &idID,
                                          bool keepDeleted,
                                          bool sorted)
 {
-    std::multimap<uint160, std::tuple<std::vector<unsigned char>, uint256, uint32_t, CUTXORef, CPartialTransactionProof>>
-        retMap;
-
     std::vector<uint160> indexKeys;
     if (!indexKey.IsNull())
     {
@@ -480,7 +706,16 @@ CIdentity::GetAggregatedIdentityMultimap(const uint160 &idID,
         }
     }
 
-    auto identityHistory = LookupIdentities(idID, startHeight, endHeight, checkMempool, getProofs, proofHeight, indexKeys, sorted);
+    return AggregateIdentityMultimap(LookupIdentities(idID, startHeight, endHeight, checkMempool, getProofs, proofHeight, indexKeys, sorted));
+}
+
+// replays the content multimaps of identity states in order, including removal actions, into one multimap
+static std::multimap<uint160, std::tuple<std::vector<unsigned char>, uint256, uint32_t, CUTXORef, CPartialTransactionProof>>
+AggregateIdentityMultimap(const std::vector<std::tuple<CIdentity, uint256, uint32_t, CUTXORef, CPartialTransactionProof>> &identityHistory)
+{
+    std::multimap<uint160, std::tuple<std::vector<unsigned char>, uint256, uint32_t, CUTXORef, CPartialTransactionProof>>
+        retMap;
+
     for (auto &oneIdentity : identityHistory)
     {
         for (auto it = std::get<0>(oneIdentity).contentMultiMap.begin(); it != std::get<0>(oneIdentity).contentMultiMap.end(); it++)
@@ -488,18 +723,12 @@ CIdentity::GetAggregatedIdentityMultimap(const uint160 &idID,
             if (it->first == CVDXF_Data::ContentMultiMapRemoveKey() &&
                 it->second.size())
             {
-                CDataStream ss(it->second, PROTOCOL_VERSION, SER_DISK);
-                uint160 objTypeKey;
-                uint32_t serVersion;
-                size_t serSize;
+                // decode the removal in place, without copying the entry into a stream first
+                CVDXFObjectView removeView(it->second);
                 CContentMultiMapRemove removeAction;
 
-                ss >> objTypeKey;
-                ss >> VARINT(serVersion);
-                ss >> VARINT(serSize);
-                ss >> removeAction;
-
-                if (objTypeKey != CVDXF_Data::ContentMultiMapRemoveKey() ||
+                if (removeView.key != CVDXF_Data::ContentMultiMapRemoveKey() ||
+                    !removeView.GetObject(removeAction) ||
                     !removeAction.IsValid())
                 {
                     continue;
@@ -567,7 +796,63 @@ CIdentity::GetIdentityContentByKey(const uint160 &idID,
         LogPrintf("%s: vdxfKey: %s, idID: %s, lookupKey: %s\n", __func__, EncodeDestination(CIdentityID(vdxfKey)).c_str(), EncodeDestination(CIdentityID(idID)).c_str(), EncodeDestination(CIdentityID(lookupKey)).c_str());
     }
 
-    auto aggregatedMap = GetAggregatedIdentityMultimap(idID, startHeight, endHeight, checkMempool, getProofs, proofHeight, lookupKey, keepDeleted, sorted);
+    std::multimap<uint160, std::tuple<std::vector<unsigned char>, uint256, uint32_t, CUTXORef, CPartialTransactionProof>> aggregatedMap;
+    if (fIdentityStateIndex)
+    {
+        // read only the states with content under this key or removal actions from the content index, without loading
+        // their transactions unless we need proofs
+        std::vector<uint160> contentKeys({vdxfKey});
+        std::vector<uint160> indexKeys({lookupKey});
+        if (!keepDeleted)
+        {
+            contentKeys.push_back(CVDXF_Data::ContentMultiMapRemoveKey());
+            indexKeys.push_back(CCrossChainRPCData::GetConditionID(CVDXF_Data::MultiMapKey(), CCrossChainRPCData::GetConditionID(CVDXF_Data::ContentMultiMapRemoveKey(), idID)));
+        }
+
+        std::vector<CIdentityStateIndexEntry> indexEntries;
+        if (!pblocktree->ReadIdentityContentIndex(idID, contentKeys, indexEntries, startHeight, endHeight))
+        {
+            LogPrintf("%s: unable to read identity content index for %s\n", __func__, EncodeDestination(CIdentityID(idID)).c_str());
+            return std::vector<std::tuple<std::vector<unsigned char>, uint256, uint32_t, CUTXORef, CPartialTransactionProof>>();
+        }
+
+        std::vector<std::tuple<CIdentity, uint256, uint32_t, CUTXORef, CPartialTransactionProof>> identityHistory;
+        for (auto &oneEntry : indexEntries)
+        {
+            CBlockIndex *pIndex = chainActive[oneEntry.first.height];
+            if (!pIndex)
+            {
+                continue;
+            }
+            CPartialTransactionProof entryProof;
+            CTransaction identityTx;
+            uint256 blkHash;
+            if (getProofs && myGetTransaction(oneEntry.second.first, identityTx, blkHash))
+            {
+                entryProof = CPartialTransactionProof(identityTx,
+                                                      std::vector<int>(),
+                                                      std::vector<int>({(int)oneEntry.first.index}),
+                                                      pIndex,
+                                                      proofHeight);
+            }
+            identityHistory.push_back({oneEntry.second.second,
+                                       pIndex->GetBlockHash(),
+                                       oneEntry.first.height,
+                                       CUTXORef(oneEntry.second.first, oneEntry.first.index),
+                                       entryProof});
+        }
+        if (checkMempool)
+        {
+            // with a height range beyond the chain, only mempool entries are returned
+            auto mempoolIdentities = LookupIdentities(idID, chainActive.Height() + 1, chainActive.Height() + 1, true, false, 0, indexKeys, sorted);
+            identityHistory.insert(identityHistory.end(), mempoolIdentities.begin(), mempoolIdentities.end());
+        }
+        aggregatedMap = AggregateIdentityMultimap(identityHistory);
+    }
+    else
+    {
+        aggregatedMap = GetAggregatedIdentityMultimap(idID, startHeight, endHeight, checkMempool, getProofs, proofHeight, lookupKey, keepDeleted, sorted);
+    }
 
     std::vector<std::tuple<std::vector<unsigned char>, uint256, uint32_t, CUTXORef, CPartialTransactionProof>> retVec;
     auto keyRange = aggregatedMap.equal_range(vdxfKey);
@@ -1513,7 +1798,7 @@ bool ValidateSpendingIdentityReservation(const CTransaction &tx, int32_t outNum,
     CCoinsView dummy;
     CCoinsViewCache view(&dummy);
 
-    LOCK(mempool.cs);
+    LOCK_UNLESS_BLOCK_CHECK(mempool.cs);
 
     CCoinsViewMemPool viewMemPool(pcoinsTip, mempool);
     view.SetBackend(viewMemPool);
@@ -1852,7 +2137,7 @@ bool PrecheckIdentityReservation(const CTransaction &tx, int32_t outNum, CValida
 
     // get output and determine which kind of reservation it is
     COptCCParams p;
-    if (tx.vout[outNum].scriptPubKey.IsPayToCryptoCondition(p) &&
+    if (tx.IsPayToCryptoCondition(outNum, p) &&
         p.IsValid() &&
         p.version >= p.VERSION_V3 &&
         p.vData.size() > 1)
@@ -2266,7 +2551,7 @@ bool PrecheckIdentityCommitment(const CTransaction &tx, int32_t outNum, CValidat
 
     if (advancedIdentity && !isPBaaS)
     {
-        if (tx.vout[outNum].scriptPubKey.IsPayToCryptoCondition(p) &&
+        if (tx.IsPayToCryptoCondition(outNum, p) &&
             p.IsValid() &&
             p.version >= COptCCParams::VERSION_V3 &&
             p.vData.size() > 1 &&
@@ -2308,7 +2593,7 @@ bool PrecheckIdentityCommitment(const CTransaction &tx, int32_t outNum, CValidat
     }
     else if (isPBaaS)
     {
-        if (tx.vout[outNum].scriptPubKey.IsPayToCryptoCondition(p) &&
+        if (tx.IsPayToCryptoCondition(outNum, p) &&
             p.IsValid() &&
             p.version >= COptCCParams::VERSION_V3 &&
             p.vData.size() > 1)
@@ -3429,7 +3714,7 @@ bool ValidateIdentityCommitment(struct CCcontract_info *cp, Eval* eval, const CT
     CTransaction sourceTx;
     uint256 blkHash;
 
-    LOCK(mempool.cs);
+    LOCK_UNLESS_BLOCK_CHECK(mempool.cs);
     if (myGetTransaction(spendingTx.vin[nIn].prevout.hash, sourceTx, blkHash))
     {
         COptCCParams p;
@@ -391,7 +391,11 @@ public:
     };
 
     static const int MAX_NAME_LEN = 64;
-    static LRUCache<std::pair<uint256, CIdentityID>, std::tuple<CIdentity, uint32_t, CTxIn>> IdentityLookupCache;
+    static const int DEFAULT_LOOKUP_CACHE_SIZE = 6000;
+
+    // latest confirmed state of each identity, with its height and output. entries are erased when a block that
+    // creates an output of the identity is connected or disconnected, so they stay valid across blocks
+    static ShardedLRUCache<CIdentityID, std::tuple<CIdentity, uint32_t, CTxIn>> IdentityLookupCache;
 
     uint160 parent;                         // parent in the sense of name. this could be a currency or chain.
     uint160 systemID;                       // system that this ID is homed to, enabling separate parent and system
@@ -797,6 +801,10 @@ public:
                                 bool keepDeleted=false,
                                 bool sorted=false);
     static CIdentity LookupIdentity(const CIdentityID &nameID, uint32_t height=0, uint32_t *pHeightOut=nullptr, CTxIn *pTxIn=nullptr, bool checkMempool=false);
+    static std::map<CIdentityID, std::tuple<CIdentity, uint32_t, CTxIn>> LookupIdentityBatch(const std::vector<CIdentityID> &nameIDs, uint32_t height=0, bool checkMempool=false);
+    static void InvalidateLookupCache(const CTransaction &tx);
+    static bool LoadExistenceFilter();
+    static bool MayExist(const CIdentityID &idID);
     static CIdentity LookupFirstIdentity(const CIdentityID &idID, uint32_t *pHeightOut=nullptr, CTxIn *idTxIn=nullptr, CTransaction *pidTx=nullptr);
 
     CIdentity RevocationAuthority() const
@@ -990,6 +998,19 @@ public:
         return retVal;
     }
 
+    // keys by which the identity reverse index finds this identity from its primary addresses and authorities
+    std::set<uint160> ReverseIndexKeys() const
+    {
+        std::set<uint160> retVal;
+        for (auto &oneDest : primaryAddresses)
+        {
+            retVal.insert(IdentityPrimaryAddressKey(oneDest));
+        }
+        retVal.insert(IdentityRevocationKey(revocationAuthority));
+        retVal.insert(IdentityRecoveryKey(recoveryAuthority));
+        return retVal;
+    }
+
     static bool GetIdentityOutsByPrimaryAddress(const CTxDestination &address, std::map<uint160, std::pair<std::pair<CAddressIndexKey, CAmount>, CIdentity>> &identities, uint32_t start=0, uint32_t end=0);
     static bool GetIdentityOutsWithRevocationID(const CIdentityID &idID, std::map<uint160, std::pair<std::pair<CAddressIndexKey, CAmount>, CIdentity>> &identities, uint32_t start=0, uint32_t end=0);
     static bool GetIdentityOutsWithRecoveryID(const CIdentityID &idID, std::map<uint160, std::pair<std::pair<CAddressIndexKey, CAmount>, CIdentity>> &identities, uint32_t start=0, uint32_t end=0);
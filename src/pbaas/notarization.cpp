@@ -500,6 +500,46 @@ CIdentitySignature::ESignatureVerification CNotaryEvidence::SignRejected(const s
     }
 }
 
+// signatures of one signature block are checked in parallel once there are at least this many
+static const int MIN_PARALLEL_NOTARY_SIGNATURES = 4;
+
+// checks the signatures of all notaries in one signature block that have a valid, unrevoked identity, which are given
+// in the same order as the signatures. the checks only depend on the identity, so they run in parallel
+static void CheckNotarySignatureBlock(const CNotarySignature &sigBlock,
+                                      const std::vector<CIdentity> &sigIdentities,
+                                      const std::vector<uint160> &vdxfCodes,
+                                      const uint256 &outputUTXOHash,
+                                      const uint160 &systemID,
+                                      const uint256 &objHash,
+                                      std::vector<CIdentitySignature::ESignatureVerification> &results,
+                                      std::vector<std::vector<std::vector<unsigned char>>> &dupSigs)
+{
+    std::vector<const CIdentitySignature *> idSigs;
+    idSigs.reserve(sigBlock.signatures.size());
+    for (auto &oneIDSig : sigBlock.signatures)
+    {
+        idSigs.push_back(&oneIDSig.second);
+    }
+    results.assign(idSigs.size(), CIdentitySignature::SIGNATURE_INVALID);
+    dupSigs.assign(idSigs.size(), std::vector<std::vector<unsigned char>>());
+
+    RunInParallel(idSigs.size(), [&](size_t i)
+    {
+        if (sigIdentities[i].IsValid() && !sigIdentities[i].IsRevoked())
+        {
+            results[i] = idSigs[i]->CheckSignature(sigIdentities[i],
+                                                   vdxfCodes,
+                                                   std::vector<std::string>(),
+                                                   std::vector<uint256>({outputUTXOHash}),
+                                                   systemID,
+                                                   "",
+                                                   objHash,
+                                                   &dupSigs[i]);
+        }
+        return true;
+    }, MIN_PARALLEL_NOTARY_SIGNATURES);
+}
+
 CNotaryEvidence::EStates CNotaryEvidence::CheckSignatureConfirmation(const uint256 &objHash,
                                                                      CCurrencyDefinition::EHashTypes hashType,
                                                                      const std::set<uint160> &notarySet,
@@ -546,6 +586,18 @@ CNotaryEvidence::EStates CNotaryEvidence::CheckSignatureConfirmation(const uint2
     // for every height, we check and merge
     uint32_t lastHeight = 0;
 
+    // each notary identity is looked up only once for all of its signatures at the same height
+    std::map<std::pair<CIdentityID, uint32_t>, CIdentity> signingIdentities;
+    auto getSigningIdentity = [&signingIdentities](const CIdentityID &idID, uint32_t lookupHeight) -> const CIdentity &
+    {
+        auto it = signingIdentities.find(std::make_pair(idID, lookupHeight));
+        if (it == signingIdentities.end())
+        {
+            it = signingIdentities.insert(std::make_pair(std::make_pair(idID, lookupHeight), CIdentity::LookupIdentity(idID, lookupHeight))).first;
+        }
+        return it->second;
+    };
+
     for (auto &oneSigBlock : notarySignatures)
     {
         // we only care up to signing height
@@ -567,21 +619,42 @@ CNotaryEvidence::EStates CNotaryEvidence::CheckSignatureConfirmation(const uint2
             notarySetConfirms.clear();
         }
 
+        // look up the identities of all notaries that signed this block, then check their signatures together
+        std::vector<CIdentity> sigIdentities;
+        sigIdentities.reserve(oneSigBlock.signatures.size());
+        for (auto &oneIDSig : oneSigBlock.signatures)
+        {
+            sigIdentities.push_back(!notarySet.count(oneIDSig.first) ?
+                                        CIdentity() :
+                                        getSigningIdentity(oneIDSig.first,
+                                                           (oneSigBlock.IsConfirmed() && oneSigBlock.systemID != ASSETCHAINS_CHAINID) ?
+                                                                checkHeight :
+                                                                oneIDSig.second.blockHeight));
+        }
+        std::vector<CIdentitySignature::ESignatureVerification> sigResults;
+        std::vector<std::vector<std::vector<unsigned char>>> sigDupSigs;
+        CheckNotarySignatureBlock(oneSigBlock,
+                                  sigIdentities,
+                                  std::vector<uint160>({oneSigBlock.IsConfirmed() ? NotaryConfirmedKey() : NotaryRejectedKey()}),
+                                  outputUTXOHash,
+                                  systemID,
+                                  objHash,
+                                  sigResults,
+                                  sigDupSigs);
+        size_t nextSigNum = 0;
+
         if (oneSigBlock.IsConfirmed())
         {
             for (auto &oneIDSig : oneSigBlock.signatures)
             {
+                size_t sigNum = nextSigNum++;
                 if (!notarySet.count(oneIDSig.first))
                 {
                     LogPrint("notarization", "%s: unauthorized notary identity: %s\n", __func__, EncodeDestination(oneIDSig.first).c_str());
                     continue;
                 }
 
-                CIdentity sigIdentity;
-
-                sigIdentity = CIdentity::LookupIdentity(oneIDSig.first, oneSigBlock.systemID == ASSETCHAINS_CHAINID ?
-                                                                                    oneIDSig.second.blockHeight :
-                                                                                    checkHeight);
+                const CIdentity &sigIdentity = sigIdentities[sigNum];
 
                 if (!sigIdentity.IsValid())
                 {
@@ -596,15 +669,8 @@ CNotaryEvidence::EStates CNotaryEvidence::CheckSignatureConfirmation(const uint2
                     continue;
                 }
 
-                std::vector<std::vector<unsigned char>> dupSigs;
-                CIdentitySignature::ESignatureVerification result = oneIDSig.second.CheckSignature(sigIdentity,
-                                                                                                   std::vector<uint160>({NotaryConfirmedKey()}),
-                                                                                                   std::vector<std::string>(),
-                                                                                                   std::vector<uint256>({outputUTXOHash}),
-                                                                                                   systemID,
-                                                                                                   "",
-                                                                                                   objHash,
-                                                                                                   &dupSigs);
+                const std::vector<std::vector<unsigned char>> &dupSigs = sigDupSigs[sigNum];
+                CIdentitySignature::ESignatureVerification result = sigResults[sigNum];
 
                 for (auto &oneDup : dupSigs)
                 {
@@ -649,13 +715,14 @@ CNotaryEvidence::EStates CNotaryEvidence::CheckSignatureConfirmation(const uint2
         {
             for (auto &oneIDSig : oneSigBlock.signatures)
             {
+                size_t sigNum = nextSigNum++;
                 if (!notarySet.count(oneIDSig.first))
                 {
                     LogPrint("notarization", "%s: unauthorized notary identity for rejection: %s\n", __func__, EncodeDestination(oneIDSig.first).c_str());
                     return EStates::STATE_INVALID;
                 }
 
-                CIdentity sigIdentity = CIdentity::LookupIdentity(oneIDSig.first, oneIDSig.second.blockHeight);
+                const CIdentity &sigIdentity = sigIdentities[sigNum];
                 if (!sigIdentity.IsValid())
                 {
                     LogPrint("notarization", "%s: invalid notary identity for rejection: %s\n", __func__, EncodeDestination(oneIDSig.first).c_str());
@@ -669,15 +736,8 @@ CNotaryEvidence::EStates CNotaryEvidence::CheckSignatureConfirmation(const uint2
                     continue;
                 }
 
-                std::vector<std::vector<unsigned char>> dupSigs;
-                CIdentitySignature::ESignatureVerification result = oneIDSig.second.CheckSignature(sigIdentity,
-                                                                                                   std::vector<uint160>({NotaryRejectedKey()}),
-                                                                                                   std::vector<std::string>(),
-                                                                                                   std::vector<uint256>({outputUTXOHash}),
-                                                                                                   systemID,
-                                                                                                   "",
-                                                                                                   objHash,
-                                                                                                   &dupSigs);
+                const std::vector<std::vector<unsigned char>> &dupSigs = sigDupSigs[sigNum];
+                CIdentitySignature::ESignatureVerification result = sigResults[sigNum];
 
                 for (auto &oneDup : dupSigs)
                 {
@@ -762,13 +822,13 @@ CPBaaSNotarization::CPBaaSNotarization(const CScript &scriptPubKey) :
                     notarizationHeight(0),
                     prevHeight(0)
 {
-    COptCCParams p;
-    if (scriptPubKey.IsPayToCryptoCondition(p) &&
+    COptCCParamsView p(scriptPubKey);
+    if (p.IsPayToCryptoCondition() &&
         p.IsValid() &&
         (p.evalCode == EVAL_ACCEPTEDNOTARIZATION || p.evalCode == EVAL_EARNEDNOTARIZATION) &&
         p.vData.size())
     {
-        ::FromVector(p.vData[0], *this);
+        ::FromSpan(p.vData[0].pBegin, p.vData[0].pEnd, *this);
     }
 }
 
@@ -793,7 +853,7 @@ CPBaaSNotarization::CPBaaSNotarization(const CTransaction &tx, int32_t *pOutIdx)
     for (int i = 0; i < tx.vout.size(); i++)
     {
         COptCCParams p;
-        if (tx.vout[i].scriptPubKey.IsPayToCryptoCondition(p) &&
+        if (tx.IsPayToCryptoCondition(i, p) &&
             p.IsValid() &&
             (p.evalCode == EVAL_ACCEPTEDNOTARIZATION || p.evalCode == EVAL_EARNEDNOTARIZATION) &&
             p.vData.size())
@@ -939,19 +999,30 @@ int CPBaaSNotarization::GetNumCheckpoints(int heightChange)
              (heightChange / blocksPerCheckpoint + ((heightChange % blocksPerCheckpoint) >= NUM_BLOCKS_PER_PROOF_RANGE ? 0 : -1));
 }
 
+// the proof root of a block depends only on the block and its ancestors, so it is cached by block hash
+static LRUCache<uint256, CProofRoot> proofRootCache(1000, 0.1, true);
+
 CProofRoot CProofRoot::GetProofRoot(uint32_t blockHeight)
 {
     if (blockHeight > chainActive.Height())
     {
         return CProofRoot(1, VERSION_INVALID);
     }
+    uint256 blockHash = chainActive[blockHeight]->GetBlockHash();
+    CProofRoot retVal;
+    if (proofRootCache.Get(blockHash, retVal))
+    {
+        return retVal;
+    }
     auto mmv = chainActive.GetMMV();
     mmv.resize(blockHeight + 1);
-    return CProofRoot(ASSETCHAINS_CHAINID,
-                      blockHeight,
-                      mmv.GetRoot(),
-                      chainActive[blockHeight]->GetBlockHash(),
-                      chainActive[blockHeight]->chainPower.CompactChainPower());
+    retVal = CProofRoot(ASSETCHAINS_CHAINID,
+                        blockHeight,
+                        mmv.GetRoot(),
+                        blockHash,
+                        chainActive[blockHeight]->chainPower.CompactChainPower());
+    proofRootCache.Put(blockHash, retVal);
+    return retVal;
 }
 
 CNotaryEvidence::CNotaryEvidence(const CTransaction &tx, int outputNum, int &afterEvidence, uint8_t EvidenceType) :
@@ -972,17 +1043,25 @@ CNotaryEvidence::CNotaryEvidence(const CTransaction &tx, int outputNum, int &aft
         if (IsMultipartProof())
         {
             COptCCParams eP;
-            CNotaryEvidence supplementalEvidence;
             std::vector<CNotaryEvidence> partsVector({*this});
+
+            // check each following output's header before decoding it, so the output that ends the parts is not decoded
             while (tx.vout.size() > afterEvidence &&
                 tx.vout[afterEvidence++].scriptPubKey.IsPayToCryptoCondition(eP) &&
                 eP.IsValid() &&
                 eP.evalCode == EVAL_NOTARY_EVIDENCE &&
-                eP.vData.size() &&
-                (supplementalEvidence = CNotaryEvidence(eP.vData[0])).IsValid() &&
-                supplementalEvidence.IsMultipartProof() &&
-                supplementalEvidence.evidence.chainObjects.size() == 1)
+                eP.vData.size())
             {
+                CNotaryEvidenceView partView(eP.vData[0]);
+                if (!partView.IsValid() || !partView.IsMultipartProof())
+                {
+                    break;
+                }
+                CNotaryEvidence supplementalEvidence = partView.GetNotaryEvidence();
+                if (!supplementalEvidence.IsValid())
+                {
+                    break;
+                }
                 partsVector.push_back(supplementalEvidence);
             }
             *this = CNotaryEvidence(partsVector);
@@ -1856,13 +1935,13 @@ bool CPBaaSNotarization::NextNotarizationInfo(const CCurrencyDefinition &sourceS
 
 CObjectFinalization::CObjectFinalization(const CScript &script) : version(VERSION_INVALID)
 {
-    COptCCParams p;
-    if (script.IsPayToCryptoCondition(p) && p.IsValid())
+    COptCCParamsView p(script);
+    if (p.IsPayToCryptoCondition() && p.IsValid())
     {
         if ((p.evalCode == EVAL_FINALIZE_NOTARIZATION || p.evalCode == EVAL_FINALIZE_EXPORT) &&
             p.vData.size())
         {
-            *this = CObjectFinalization(p.vData[0]);
+            ::FromSpan(p.vData[0].pBegin, p.vData[0].pEnd, *this);
         }
     }
 }
@@ -1926,7 +2005,7 @@ CObjectFinalization::CObjectFinalization(const CTransaction &tx, uint32_t *pEcod
     for (int i = 0; i < tx.vout.size(); i++)
     {
         COptCCParams p;
-        if (tx.vout[i].scriptPubKey.IsPayToCryptoCondition(p) && p.IsValid())
+        if (tx.IsPayToCryptoCondition(i, p) && p.IsValid())
         {
             if (p.evalCode == EVAL_FINALIZE_NOTARIZATION || p.evalCode == EVAL_FINALIZE_EXPORT)
             {
@@ -2494,9 +2573,9 @@ bool CChainNotarizationData::CorrelatedFinalizationSpends(const std::vector<std:
 // Whether this is an earned notarization or accepted, it retrieves the prior notarization on the chain
 // for accepted notarizations, there must be valid proof of the prior notarization for it to correctly return the prior
 // notarization
-std::tuple<uint32_t, CTransaction, CUTXORef, CPBaaSNotarization> GetPriorReferencedNotarization(const CTransaction &tx,
-                                                                                                int32_t notarizationOut,
-                                                                                                const CPBaaSNotarization &notarization)
+static std::tuple<uint32_t, CTransaction, CUTXORef, CPBaaSNotarization> GetPriorReferencedNotarizationUncached(const CTransaction &tx,
+                                                                                                               int32_t notarizationOut,
+                                                                                                               const CPBaaSNotarization &notarization)
 {
     std::tuple<uint32_t, CTransaction, CUTXORef, CPBaaSNotarization> retVal({0, CTransaction(), CUTXORef(), CPBaaSNotarization()});
 
@@ -2720,6 +2799,51 @@ std::tuple<uint32_t, CTransaction, CUTXORef, CPBaaSNotarization> GetPriorReferen
     return retVal;
 }
 
+// both lookups below depend only on their arguments, the active chain, and the mempool, so their results are kept
+// until the tip or mempool changes, as the notary loop and import validation repeat them for the same currencies
+static LRUCache<std::tuple<uint256, int32_t, uint256, uint256, unsigned int>, std::tuple<uint32_t, CTransaction, CUTXORef, CPBaaSNotarization>>
+    priorReferencedNotarizationCache(1000, 0.1, true);
+static LRUCache<std::tuple<uint160, uint32_t, uint256, unsigned int>, std::tuple<uint32_t, CUTXORef, CPBaaSNotarization>>
+    lastConfirmedNotarizationCache(1000, 0.1, true);
+
+std::tuple<uint32_t, CTransaction, CUTXORef, CPBaaSNotarization> GetPriorReferencedNotarization(const CTransaction &tx,
+                                                                                                int32_t notarizationOut,
+                                                                                                const CPBaaSNotarization &notarization)
+{
+    LOCK(mempool.cs);
+    CBlockIndex *pTip = chainActive.LastTip();
+    if (!pTip)
+    {
+        return GetPriorReferencedNotarizationUncached(tx, notarizationOut, notarization);
+    }
+
+    std::tuple<uint32_t, CTransaction, CUTXORef, CPBaaSNotarization> retVal;
+    auto cacheKey = std::make_tuple(tx.GetHash(), notarizationOut, SerializeHash(notarization), pTip->GetBlockHash(), mempool.GetTransactionsUpdated());
+    if (priorReferencedNotarizationCache.Get(cacheKey, retVal))
+    {
+        return retVal;
+    }
+    retVal = GetPriorReferencedNotarizationUncached(tx, notarizationOut, notarization);
+    std::get<4>(cacheKey) = mempool.GetTransactionsUpdated();
+    priorReferencedNotarizationCache.Put(cacheKey, retVal);
+    return retVal;
+}
+
+// the notarizations that a fraud proof depends upon must all be in the active chain, so the evaluation of evidence is
+// cached along with the blocks of those notarizations, and is reused only as long as all of those blocks remain in the chain.
+// a result that failed to find any of those notarizations in the chain may change as the chain grows, and is not cached
+static LRUCache<std::tuple<uint256, uint160, uint256, uint256, bool>, std::tuple<CProofRoot, bool, CProofRoot, std::vector<uint256>>>
+    challengeEvidenceCache(500, 0.1, true);
+
+static CProofRoot IsValidChallengeEvidenceUncached(const CProofRoot &defaultProofRoot,
+                                                   const CNotaryEvidence &e,
+                                                   const uint256 &entropyHash,
+                                                   bool &invalidates,
+                                                   CProofRoot &challengeStartRoot,
+                                                   uint32_t height,
+                                                   std::vector<uint256> &dependentBlocks,
+                                                   bool &chainLookupFailed);
+
 CProofRoot IsValidChallengeEvidence(const CCurrencyDefinition &externalSystem,
                                     const CProofRoot &defaultProofRoot,
                                     const CNotaryEvidence &e,
@@ -2732,8 +2856,57 @@ CProofRoot IsValidChallengeEvidence(const CCurrencyDefinition &externalSystem,
     {
         return CProofRoot();
     }
+
+    std::tuple<uint256, uint160, uint256, uint256, bool> cacheKey(SerializeHash(e),
+                                                                  externalSystem.GetID(),
+                                                                  SerializeHash(defaultProofRoot),
+                                                                  entropyHash,
+                                                                  ConnectedChains.IsEnhancedNotarizationOrder(height));
+    std::tuple<CProofRoot, bool, CProofRoot, std::vector<uint256>> cachedResult;
+    if (challengeEvidenceCache.Get(cacheKey, cachedResult))
+    {
+        bool dependenciesInChain = true;
+        for (auto &oneBlockHash : std::get<3>(cachedResult))
+        {
+            auto blockIt = mapBlockIndex.find(oneBlockHash);
+            if (blockIt == mapBlockIndex.end() || !chainActive.Contains(blockIt->second))
+            {
+                dependenciesInChain = false;
+                break;
+            }
+        }
+        if (dependenciesInChain)
+        {
+            invalidates = std::get<1>(cachedResult);
+            challengeStartRoot = std::get<2>(cachedResult);
+            return std::get<0>(cachedResult);
+        }
+    }
+
+    std::vector<uint256> dependentBlocks;
+    bool chainLookupFailed = false;
+    CProofRoot retVal = IsValidChallengeEvidenceUncached(defaultProofRoot, e, entropyHash, invalidates, challengeStartRoot,
+                                                         height, dependentBlocks, chainLookupFailed);
+    if (!chainLookupFailed)
+    {
+        challengeEvidenceCache.Put(cacheKey, std::make_tuple(retVal, invalidates, challengeStartRoot, dependentBlocks));
+    }
+    return retVal;
+}
+
+static CProofRoot IsValidChallengeEvidenceUncached(const CProofRoot &defaultProofRoot,
+                                                   const CNotaryEvidence &e,
+                                                   const uint256 &entropyHash,
+                                                   bool &invalidates,
+                                                   CProofRoot &challengeStartRoot,
+                                                   uint32_t height,
+                                                   std::vector<uint256> &dependentBlocks,
+                                                   bool &chainLookupFailed)
+{
     bool validCounterEvidence = false;
     invalidates = false;
+    chainLookupFailed = false;
+    challengeStartRoot = CProofRoot(CProofRoot::TYPE_PBAAS, CProofRoot::VERSION_INVALID);
 
     // challenges to earned or accepted notarizations only differ in
     // the polarity of notarizations mirrored or not and each chain's
@@ -2864,11 +3037,16 @@ CProofRoot IsValidChallengeEvidence(const CCurrencyDefinition &externalSystem,
 
                 BlockMap::iterator priorIdx, skippedIdx, challengedIdx;
 
-                if (proofComponent->objectType == CHAINOBJ_EVIDENCEDATA &&
-                    ((CChainObject<CEvidenceData> *)proofComponent)->object.vdxfd == CVDXF_Data::UTXORefKey() &&
-                    ((CChainObject<CEvidenceData> *)proofComponent)->object.dataVec.size() &&
-                    (notarizationTxRef = CUTXORef(((CChainObject<CEvidenceData> *)proofComponent)->object.dataVec)).IsValid() &&
-                    myGetTransaction(notarizationTxRef.hash, skippedTx, skippedBlkHash) &&
+                if (!(proofComponent->objectType == CHAINOBJ_EVIDENCEDATA &&
+                      ((CChainObject<CEvidenceData> *)proofComponent)->object.vdxfd == CVDXF_Data::UTXORefKey() &&
+                      ((CChainObject<CEvidenceData> *)proofComponent)->object.dataVec.size() &&
+                      (notarizationTxRef = CUTXORef(((CChainObject<CEvidenceData> *)proofComponent)->object.dataVec)).IsValid()))
+                {
+                    proofState = EXPECT_NOTHING;
+                }
+                // each of the notarizations referenced must be found and in the active chain. they may be
+                // in the mempool or not yet connected, so failing to find one is not a final result
+                else if (myGetTransaction(notarizationTxRef.hash, skippedTx, skippedBlkHash) &&
                     !skippedBlkHash.IsNull() &&
                     (skippedIdx = mapBlockIndex.find(skippedBlkHash)) != mapBlockIndex.end() &&
                     chainActive.Contains(skippedIdx->second) &&
@@ -2894,10 +3072,12 @@ CProofRoot IsValidChallengeEvidence(const CCurrencyDefinition &externalSystem,
                     priorNotarization.proofRoots.count(defaultProofRoot.systemID) &&
                     priorNotarization.proofRoots[defaultProofRoot.systemID].rootHeight < skippedNotarization.proofRoots[defaultProofRoot.systemID].rootHeight)
                 {
+                    dependentBlocks = std::vector<uint256>({skippedIdx->first, challengedIdx->first, priorIdx->first});
                     proofState = EXPECT_SKIPPED_HEADERREF_PROOF;
                 }
                 else
                 {
+                    chainLookupFailed = true;
                     proofState = EXPECT_NOTHING;
                 }
                 break;
@@ -2936,10 +3116,10 @@ int32_t CPBaaSNotarization::GetAdjustedNotarizationModuloExp(int64_t notarizatio
                                                              int64_t notarizationsBeforeModuloExtension,
                                                              int64_t notarizationCount)
 {
-    auto resetIt = ConnectedChains.activeUpgradesByKey.find(ConnectedChains.ResetNotarizationModuloKey());
+    int64_t resetHeight = ConnectedChains.GetUpgradeActivations()->UpgradeHeight(CUpgradeActivations::RESET_NOTARIZATION_MODULO, 0);
     int64_t heightChange = std::max((int64_t)0,
                             untilHeight -
-                                std::max(resetIt == ConnectedChains.activeUpgradesByKey.end() ? (int64_t)0 : resetIt->second.upgradeBlockHeight, fromHeight));
+                                std::max(resetHeight, fromHeight));
 
     if (heightChange <= GetBlocksBeforeModuloExtension(notarizationBlockModulo) && notarizationCount <= notarizationsBeforeModuloExtension)
     {
@@ -2974,7 +3154,7 @@ std::vector<unsigned char> CreatePoSBlockProof(ChainMerkleMountainView &mmrView,
     }
 
     // get map and MMR for stake source transaction
-    CTransactionMap txMap(stakeSource);
+    const CTransactionMap &txMap = stakeSource.GetTransactionMap();
     TransactionMMView txView(txMap.transactionMMR);
     uint256 txRoot = txView.GetRoot();
 
@@ -2986,7 +3166,7 @@ std::vector<unsigned char> CreatePoSBlockProof(ChainMerkleMountainView &mmrView,
     // through the block MMR, and since we don't cache the new MMR proof for transactions yet, we need the block to create the proof.
     // when we switch to the new MMR in place of a merkle tree, we can keep that in the wallet as well
     CBlock block;
-    if (!ReadBlockFromDisk(block, chainActive[sourceBlockNum], Params().GetConsensus(), false))
+    if (!ReadBlockForProof(block, chainActive[sourceBlockNum], Params().GetConsensus()))
     {
         LogPrintf("%s: ERROR: could not read block number  %u from disk\n", __func__, sourceBlockNum);
         return emptyVec;
@@ -3040,7 +3220,7 @@ std::vector<unsigned char> CreatePoSBlockProof(ChainMerkleMountainView &mmrView,
     if (posSourceInfo)
     {
         CBlock entropyBlock1;
-        if (!ReadBlockFromDisk(entropyBlock1, chainActive[pastBlockHeight1], Params().GetConsensus(), false))
+        if (!ReadBlockForProof(entropyBlock1, chainActive[pastBlockHeight1], Params().GetConsensus()))
         {
             LogPrintf("%s: ERROR: could not read block number %u from disk for entropy component 1\n", __func__, pastBlockHeight1);
             return emptyVec;
@@ -3061,7 +3241,7 @@ std::vector<unsigned char> CreatePoSBlockProof(ChainMerkleMountainView &mmrView,
     if (posSourceInfo)
     {
         CBlock entropyBlock2;
-        if (!ReadBlockFromDisk(entropyBlock2, chainActive[pastBlockHeight2], Params().GetConsensus(), false))
+        if (!ReadBlockForProof(entropyBlock2, chainActive[pastBlockHeight2], Params().GetConsensus()))
         {
             LogPrintf("%s: ERROR: could not read block number %u from disk for entropy component 1\n", __func__, pastBlockHeight2);
             return emptyVec;
@@ -3220,7 +3400,7 @@ CPBaaSNotarization IsValidPrimaryChainEvidence(const CCurrencyDefinition &extern
                     case CHAINOBJ_CROSSCHAINPROOF:
                     {
                         // check for challenge roots
-                        CCrossChainProof ccProof = ((CChainObject<CCrossChainProof> *)proofComponent)->object;
+                        const CCrossChainProof &ccProof = ((CChainObject<CCrossChainProof> *)proofComponent)->object;
                         if (crossChainProofCount++ < 2 &&
                             ccProof.chainObjects.size() &&
                             ccProof.chainObjects[0]->objectType == CHAINOBJ_EVIDENCEDATA &&
@@ -4420,7 +4600,7 @@ CPBaaSNotarization IsValidPrimaryChainEvidence(const CCurrencyDefinition &extern
 
 // gets the last confirmed notarization for a particular currency confirmed on or before a particular height
 // do not use for heights more than 10 blocks before the tip
-std::tuple<uint32_t, CUTXORef, CPBaaSNotarization> GetLastConfirmedNotarization(uint160 curID, uint32_t height)
+static std::tuple<uint32_t, CUTXORef, CPBaaSNotarization> GetLastConfirmedNotarizationUncached(uint160 curID, uint32_t height)
 {
     std::vector<std::pair<uint32_t, CInputDescriptor>> unspentFinalizations;
 
@@ -4685,6 +4865,29 @@ std::tuple<uint32_t, CUTXORef, CPBaaSNotarization> GetLastConfirmedNotarization(
     return retVal;
 }
 
+std::tuple<uint32_t, CUTXORef, CPBaaSNotarization> GetLastConfirmedNotarization(uint160 curID, uint32_t height)
+{
+    LOCK(mempool.cs);
+    CBlockIndex *pTip = chainActive.LastTip();
+    if (!pTip)
+    {
+        return GetLastConfirmedNotarizationUncached(curID, height);
+    }
+
+    std::tuple<uint32_t, CUTXORef, CPBaaSNotarization> retVal;
+    auto cacheKey = std::make_tuple(curID, height, pTip->GetBlockHash(), mempool.GetTransactionsUpdated());
+    if (lastConfirmedNotarizationCache.Get(cacheKey, retVal))
+    {
+        return retVal;
+    }
+    retVal = GetLastConfirmedNotarizationUncached(curID, height);
+
+    // the lookup may remove invalid finalizations from the mempool, which would otherwise make its result stale at once
+    std::get<3>(cacheKey) = mempool.GetTransactionsUpdated();
+    lastConfirmedNotarizationCache.Put(cacheKey, retVal);
+    return retVal;
+}
+
 bool IsScriptTooLargeToSpend(const CScript &script)
 {
     COptCCParams p;
@@ -4718,10 +4921,10 @@ bool CPBaaSNotarization::CreateAcceptedNotarization(const CCurrencyDefinition &e
 
     // if we are paused on cross-chain, return error until enabled
     if ((externalSystem.IsPBaaSChain() &&
-         (ConnectedChains.activeUpgradesByKey.count(ConnectedChains.DisableDeFiKey()) ||
-          ConnectedChains.activeUpgradesByKey.count(ConnectedChains.DisablePBaaSCrossChainKey()))) ||
+         (ConnectedChains.HasUpgrade(CUpgradeActivations::DISABLE_DEFI) ||
+          ConnectedChains.HasUpgrade(CUpgradeActivations::DISABLE_PBAAS_CROSS_CHAIN))) ||
         (externalSystem.IsGateway() &&
-         ConnectedChains.activeUpgradesByKey.count(ConnectedChains.DisableGatewayCrossChainKey())))
+         ConnectedChains.HasUpgrade(CUpgradeActivations::DISABLE_GATEWAY_CROSS_CHAIN)))
     {
         return state.Error(errorPrefix + "cross-chain temporarily disabled for security alert by notification oracle " + PBAAS_DEFAULT_NOTIFICATION_ORACLE);
     }
@@ -5569,6 +5772,7 @@ std::vector<__uint128_t> GetBlockCommitments(uint32_t fromHeight, uint32_t toHei
     if (chainActive.Height() >= toHeight)
     {
         auto blockRanges = CPBaaSNotarization::GetBlockCommitmentRanges(fromHeight, toHeight, entropy);
+        bool logCommitments = LogAcceptCategory("notarization") && LogAcceptCategory("verbose");
 
         // commit to prior blocks nTime, nBits, stakeBits, & work or stake power component for up to 256 blocks prior or back,
         // to the last notarization, whichever comes first, enabling later random verification of subset
@@ -5581,14 +5785,15 @@ std::vector<__uint128_t> GetBlockCommitments(uint32_t fromHeight, uint32_t toHei
             int64_t loopLimit = oneRange.first;
             for (int64_t blockNum = oneRange.second; blockNum >= loopLimit; (blockNum--, currentOffset--))
             {
-                bool isPosBlock = chainActive[blockNum]->IsVerusPOSBlock();
-                __uint128_t bigCommitmentNum((uint32_t)chainActive[blockNum]->nTime);
-                bigCommitmentNum = (bigCommitmentNum << 32) | (uint32_t)chainActive[blockNum]->nBits;
-                bigCommitmentNum = (bigCommitmentNum << 32) | (uint32_t)chainActive[blockNum]->GetVerusPOSTarget();
+                const CBlockIndex *pindex = chainActive[blockNum];
+                bool isPosBlock = pindex->IsVerusPOSBlock();
+                __uint128_t bigCommitmentNum((uint32_t)pindex->nTime);
+                bigCommitmentNum = (bigCommitmentNum << 32) | (uint32_t)pindex->nBits;
+                bigCommitmentNum = (bigCommitmentNum << 32) | (uint32_t)pindex->GetVerusPOSTarget();
                 bigCommitmentNum = (bigCommitmentNum << 32) | ((uint32_t)(blockNum << 1) | (uint32_t)isPosBlock);
                 blockCommitmentsSmall[currentOffset] = bigCommitmentNum;
 
-                if (LogAcceptCategory("notarization") && LogAcceptCategory("verbose"))
+                if (logCommitments)
                 {
                     LogPrintf("%s: reading small commitments\n", __func__);
                     auto commitmentVec = UnpackBlockCommitment(blockCommitmentsSmall[currentOffset]);
@@ -5615,7 +5820,7 @@ bool ProvePosBlock(uint32_t lastProofRootHeight, const CBlockIndex *pindex, CNot
     // might exaggerate power of an attacking chain
     CBlock posBlock;
 
-    if (!ReadBlockFromDisk(posBlock, pindex, Params().GetConsensus(), false))
+    if (!ReadBlockForProof(posBlock, pindex, Params().GetConsensus()))
     {
         LogPrintf("%s: ERROR: could not read PoS block from disk, LIKELY DUE TO CORRUPT LOCAL STATE, BOOTSTRAP OR RESYNC RECOMMENDED\n", __func__);
         return state.Error("invalid crosschain notarization data");
@@ -5668,7 +5873,7 @@ bool ProvePosBlock(uint32_t lastProofRootHeight, const CBlockIndex *pindex, CNot
     // get what's needed to prove the preheader of the block after closest entropy header
     // to get a proven MMR root of that height from the prev MMR root
     CBlock blockAfterEntropy;
-    if (!ReadBlockFromDisk(blockAfterEntropy, chainActive[heightAfterFirstEntropy], Params().GetConsensus(), false))
+    if (!ReadBlockForProof(blockAfterEntropy, chainActive[heightAfterFirstEntropy], Params().GetConsensus()))
     {
         LogPrintf("%s: ERROR: could not read block after entropy height from disk, LIKELY DUE TO CORRUPT LOCAL STATE, BOOTSTRAP OR RESYNC RECOMMENDED\n", __func__);
         return state.Error("Invalid post entropy block data");
@@ -5947,8 +6152,8 @@ bool CPBaaSNotarization::CreateEarnedNotarization(const CRPCChainData &externalS
     std::string errorPrefix(strprintf("%s: ", __func__));
 
     // if we are paused on cross-chain, return error until enabled
-    if (ConnectedChains.activeUpgradesByKey.count(ConnectedChains.DisableDeFiKey()) ||
-        ConnectedChains.activeUpgradesByKey.count(ConnectedChains.DisablePBaaSCrossChainKey()))
+    if (ConnectedChains.HasUpgrade(CUpgradeActivations::DISABLE_DEFI) ||
+        ConnectedChains.HasUpgrade(CUpgradeActivations::DISABLE_PBAAS_CROSS_CHAIN))
     {
         return state.Error(errorPrefix + "cross-chain functions temporarily disabled for security alert by notification oracle " + PBAAS_DEFAULT_NOTIFICATION_ORACLE);
     }
@@ -6011,7 +6216,16 @@ bool CPBaaSNotarization::CreateEarnedNotarization(const CRPCChainData &externalS
 
     bool logNotarization = LogAcceptCategory("earnednotarizations");
 
+    UniValue notarizationParams(UniValue::VARR);
+    notarizationParams.push_back(EncodeDestination(CIdentityID(ASSETCHAINS_CHAINID)));
+    notarizationParams.push_back(true);
+    notarizationParams.push_back(true);
+
+    // neither call depends on the other, so we make both in one round trip to the notary
+    std::vector<std::pair<std::string, UniValue>> notaryCalls({{"getbestproofroot", params}, {"getnotarizationdata", notarizationParams}});
+
     UniValue bestProofRootResult;
+    UniValue notarizationResult;
     try
     {
         if (logNotarization)
@@ -6019,39 +6233,22 @@ bool CPBaaSNotarization::CreateEarnedNotarization(const CRPCChainData &externalS
             LogPrintf("calling getbestproofroot with params: %s\n", params.write(1,2).c_str());
             printf("calling getbestproofroot with params: %s\n", params.write(1,2).c_str());
         }
-        bestProofRootResult = find_value(RPCCallRoot("getbestproofroot", params), "result");
+        std::vector<UniValue> notaryResults = RPCCallRootBatch(notaryCalls);
+        bestProofRootResult = find_value(notaryResults[0], "result");
+        notarizationResult = find_value(notaryResults[1], "result");
         if (logNotarization)
         {
             LogPrintf("result from getbestproofroot: %s\n", bestProofRootResult.write(1,2).c_str());
             printf("result from getbestproofroot: %s\n", bestProofRootResult.write(1,2).c_str());
-        }
-    } catch (exception e)
-    {
-        if (logNotarization)
-        {
-            LogPrintf("exception from getbestproofroot: %s\n", e.what());
-        }
-        bestProofRootResult = NullUniValue;
-    }
-
-    UniValue notarizationResult;
-    params = UniValue(UniValue::VARR);
-    params.push_back(EncodeDestination(CIdentityID(ASSETCHAINS_CHAINID)));
-    params.push_back(true);
-    params.push_back(true);
-    try
-    {
-        notarizationResult = find_value(RPCCallRoot("getnotarizationdata", params), "result");
-        if (logNotarization)
-        {
             LogPrintf("result from getnotarizationdata: %s\n", notarizationResult.write(1,2).c_str());
         }
     } catch (exception e)
     {
         if (logNotarization)
         {
-            LogPrintf("exception from getnotarizationdata: %s\n", e.what());
+            LogPrintf("exception from getbestproofroot and getnotarizationdata: %s\n", e.what());
         }
+        bestProofRootResult = NullUniValue;
         notarizationResult = NullUniValue;
     }
 
@@ -9923,7 +10120,7 @@ bool ValidateAcceptedNotarization(struct CCcontract_info *cp, Eval* eval, const
         COptCCParams p;
         CPBaaSNotarization nextPbn;
         CObjectFinalization of;
-        if (tx.vout[i].scriptPubKey.IsPayToCryptoCondition(p) &&
+        if (tx.IsPayToCryptoCondition(i, p) &&
             p.IsValid() &&
             p.evalCode == EVAL_ACCEPTEDNOTARIZATION &&
             p.vData.size() &&
@@ -10055,7 +10252,7 @@ bool PreCheckAcceptedOrEarnedNotarization(const CTransaction &tx, int32_t outNum
 
     COptCCParams p;
     CPBaaSNotarization currentNotarization;
-    if (!(tx.vout[outNum].scriptPubKey.IsPayToCryptoCondition(p) &&
+    if (!(tx.IsPayToCryptoCondition(outNum, p) &&
           p.IsValid() &&
           (p.evalCode == EVAL_ACCEPTEDNOTARIZATION || p.evalCode == EVAL_EARNEDNOTARIZATION) &&
           p.vData.size() &&
@@ -10121,7 +10318,7 @@ bool PreCheckAcceptedOrEarnedNotarization(const CTransaction &tx, int32_t outNum
         }
         COptCCParams dupP;
         CPBaaSNotarization dupNotarization;
-        if (tx.vout[i].scriptPubKey.IsPayToCryptoCondition(dupP) &&
+        if (tx.IsPayToCryptoCondition(i, dupP) &&
             dupP.IsValid() &&
             (dupP.evalCode == EVAL_ACCEPTEDNOTARIZATION || dupP.evalCode == EVAL_EARNEDNOTARIZATION) &&
             dupP.vData.size() &&
@@ -10539,7 +10736,7 @@ bool PreCheckAcceptedOrEarnedNotarization(const CTransaction &tx, int32_t outNum
         }
         else
         {
-            if (ConnectedChains.activeUpgradesByKey.count(ConnectedChains.DisableDeFiKey()))
+            if (ConnectedChains.HasUpgrade(CUpgradeActivations::DISABLE_DEFI))
             {
                 if (LogAcceptCategory("defi"))
                 {
@@ -10642,7 +10839,7 @@ bool PreCheckAcceptedOrEarnedNotarization(const CTransaction &tx, int32_t outNum
                         hashType = (CCurrencyDefinition::EHashTypes)(notarySignatures[0].signatures.begin()->second.hashType);
                     }
 
-                    if (ConnectedChains.activeUpgradesByKey.count(ConnectedChains.DisablePBaaSCrossChainKey()))
+                    if (ConnectedChains.HasUpgrade(CUpgradeActivations::DISABLE_PBAAS_CROSS_CHAIN))
                     {
                         if (LogAcceptCategory("defi"))
                         {
@@ -10651,7 +10848,7 @@ bool PreCheckAcceptedOrEarnedNotarization(const CTransaction &tx, int32_t outNum
                         return state.Error("Cross-chain functions temporarily disabled for security alert by notification oracle. Notarization rejected " + currentNotarization.ToUniValue().write(1,2));
                     }
                     else if (curDef.IsGateway() &&
-                             ConnectedChains.activeUpgradesByKey.count(ConnectedChains.DisableGatewayCrossChainKey()))
+                             ConnectedChains.HasUpgrade(CUpgradeActivations::DISABLE_GATEWAY_CROSS_CHAIN))
                     {
                         if (LogAcceptCategory("defi"))
                         {
@@ -10796,7 +10993,7 @@ bool PreCheckAcceptedOrEarnedNotarization(const CTransaction &tx, int32_t outNum
     return true;
 }
 
-LRUCache<CUTXORef, std::tuple<uint256, CTransaction, std::vector<std::pair<CObjectFinalization, CNotaryEvidence>>>> finalizationEvidenceCache(100, 0.3);
+LRUCache<CUTXORef, std::tuple<uint256, CTransaction, std::vector<std::pair<CObjectFinalization, CNotaryEvidence>>>> finalizationEvidenceCache(100, 0.3, true);
 
 // get and aggregate all evidence from a finalization
 std::vector<std::pair<CObjectFinalization, CNotaryEvidence>>
@@ -11007,7 +11204,7 @@ bool PreCheckNotaryEvidence(const CTransaction &tx, int32_t outNum, CValidationS
 {
     COptCCParams p;
     CNotaryEvidence currentEvidence;
-    if (!(tx.vout[outNum].scriptPubKey.IsPayToCryptoCondition(p) &&
+    if (!(tx.IsPayToCryptoCondition(outNum, p) &&
           p.IsValid() &&
           p.evalCode == EVAL_NOTARY_EVIDENCE &&
           p.vData.size() &&
@@ -11032,7 +11229,7 @@ bool PreCheckNotaryEvidence(const CTransaction &tx, int32_t outNum, CValidationS
             CNotaryEvidence multiEvidence;
             int multiStart = (outNum - ((CChainObject<CEvidenceData> *)(currentEvidence.evidence.chainObjects[0]))->object.md.index);
             if (multiStart >= 0 &&
-                tx.vout[multiStart].scriptPubKey.IsPayToCryptoCondition(multiP) &&
+                tx.IsPayToCryptoCondition(multiStart, multiP) &&
                 multiP.IsValid() &&
                 multiP.evalCode == EVAL_NOTARY_EVIDENCE &&
                 multiP.vData.size() &&
@@ -11286,7 +11483,7 @@ bool PreCheckFinalizeNotarization(const CTransaction &tx, int32_t outNum, CValid
     // ensure that we never accept an invalid proofroot for this chain in a notarization
     COptCCParams p;
     CObjectFinalization currentFinalization;
-    if (!(tx.vout[outNum].scriptPubKey.IsPayToCryptoCondition(p) &&
+    if (!(tx.IsPayToCryptoCondition(outNum, p) &&
           p.IsValid() &&
           p.evalCode == EVAL_FINALIZE_NOTARIZATION &&
           p.vData.size() &&
@@ -11333,7 +11530,7 @@ bool PreCheckFinalizeNotarization(const CTransaction &tx, int32_t outNum, CValid
         }
         COptCCParams dupP;
         CObjectFinalization dupOf;
-        if (tx.vout[i].scriptPubKey.IsPayToCryptoCondition(dupP) &&
+        if (tx.IsPayToCryptoCondition(i, dupP) &&
             dupP.IsValid() &&
             dupP.evalCode == EVAL_FINALIZE_NOTARIZATION &&
             dupP.vData.size() &&
@@ -11777,7 +11974,9 @@ bool PreCheckFinalizeNotarization(const CTransaction &tx, int32_t outNum, CValid
                     return state.Error("Insufficient notary confirms and/or blocks to confirm notarization with given evidence");
                 }
 
-                // if we get here, store the verified proof root of this chain as notarized
+                // if we get here, store the verified proof root of this chain as notarized. eval checks of earlier
+                // transactions of the block may be reading the notary systems on the script check threads
+                LOCK(ConnectedChains.cs_mergemining);
                 ConnectedChains.notarySystems[notarization.currencyID].lastConfirmedNotarization = notarization;
                 // we should persist this notarization off-chain as a checkpoint
             }
@@ -12048,7 +12247,7 @@ bool PreCheckFinalizeNotarization(const CTransaction &tx, int32_t outNum, CValid
                     CTransaction outTx;
                     uint256 blockHash;
                     CObjectFinalization outOF;
-                    if (tx.vout[oneOutNum].scriptPubKey.IsPayToCryptoCondition(outP) &&
+                    if (tx.IsPayToCryptoCondition(oneOutNum, outP) &&
                         outP.IsValid() &&
                         outP.evalCode == EVAL_FINALIZE_NOTARIZATION &&
                         outP.vData.size() &&
@@ -12186,7 +12385,7 @@ bool ValidateEarnedNotarization(struct CCcontract_info *cp, Eval* eval, const CT
         COptCCParams p;
         CObjectFinalization of;
         CPBaaSNotarization nextPbn;
-        if (tx.vout[i].scriptPubKey.IsPayToCryptoCondition(p) &&
+        if (tx.IsPayToCryptoCondition(i, p) &&
             p.IsValid() &&
             (p.evalCode == EVAL_FINALIZE_NOTARIZATION &&
             p.vData.size() &&
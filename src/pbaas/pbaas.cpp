@@ -14,7 +14,9 @@
 #include "main.h"
 #include "rpc/pbaasrpc.h"
 #include "timedata.h"
+#include "trace.h"
 #include "transaction_builder.h"
+#include "txdb.h"
 #include "deprecation.h"
 #include "cc/StakeGuard.h"
 #include "consensus/upgrades.h"
@@ -508,7 +510,7 @@ bool PrecheckCrossChainImport(const CTransaction &tx, int32_t outNum, CValidatio
     bool isPostSync = chainActive.Height() > (height - 1);
     bool deepCheckImportProof = !(isPreSync || isPostSync);
 
-    if (!isPreSync && ConnectedChains.activeUpgradesByKey.count(ConnectedChains.DisableDeFiKey()))
+    if (!isPreSync && ConnectedChains.HasUpgrade(CUpgradeActivations::DISABLE_DEFI))
     {
         if (LogAcceptCategory("defi"))
         {
@@ -526,7 +528,7 @@ bool PrecheckCrossChainImport(const CTransaction &tx, int32_t outNum, CValidatio
     std::vector<CReserveTransfer> reserveTransfers;
 
     int32_t sysOutNum = -1, notarizationOut = -1, evidenceOutStart = -1, evidenceOutEnd = -1;
-    if (tx.vout[outNum].scriptPubKey.IsPayToCryptoCondition(p) &&
+    if (tx.IsPayToCryptoCondition(outNum, p) &&
         p.IsValid() &&
         p.evalCode == EVAL_CROSSCHAIN_IMPORT &&
         p.vData.size() > 1 &&
@@ -555,7 +557,7 @@ bool PrecheckCrossChainImport(const CTransaction &tx, int32_t outNum, CValidatio
         {
             COptCCParams dupP;
             CCrossChainImport dupCCI;
-            if (tx.vout[i].scriptPubKey.IsPayToCryptoCondition(dupP) &&
+            if (tx.IsPayToCryptoCondition(i, dupP) &&
                 dupP.IsValid() &&
                 dupP.evalCode == EVAL_CROSSCHAIN_IMPORT &&
                 dupP.vData.size() &&
@@ -948,7 +950,7 @@ bool PrecheckCrossChainImport(const CTransaction &tx, int32_t outNum, CValidatio
                         {
                             if (!isPreSync)
                             {
-                                if (ConnectedChains.activeUpgradesByKey.count(ConnectedChains.DisablePBaaSCrossChainKey()))
+                                if (ConnectedChains.HasUpgrade(CUpgradeActivations::DISABLE_PBAAS_CROSS_CHAIN))
                                 {
                                     if (LogAcceptCategory("defi"))
                                     {
@@ -965,7 +967,7 @@ bool PrecheckCrossChainImport(const CTransaction &tx, int32_t outNum, CValidatio
                                         return state.Error("Invalid source system in import or system not found");
                                     }
                                     if (sourceSystem.IsGateway() &&
-                                        ConnectedChains.activeUpgradesByKey.count(ConnectedChains.DisableGatewayCrossChainKey()))
+                                        ConnectedChains.HasUpgrade(CUpgradeActivations::DISABLE_GATEWAY_CROSS_CHAIN))
                                     {
                                         if (LogAcceptCategory("defi"))
                                         {
@@ -1422,7 +1424,7 @@ bool PrecheckCrossChainExport(const CTransaction &tx, int32_t outNum, CValidatio
 
     bool isPreSync = chainActive.Height() < (height - 1);
 
-    if (!isPreSync && ConnectedChains.activeUpgradesByKey.count(ConnectedChains.DisableDeFiKey()))
+    if (!isPreSync && ConnectedChains.HasUpgrade(CUpgradeActivations::DISABLE_DEFI))
     {
         if (LogAcceptCategory("defi"))
         {
@@ -1431,7 +1433,7 @@ bool PrecheckCrossChainExport(const CTransaction &tx, int32_t outNum, CValidatio
         return state.Error("All DeFi functions temporarily disabled for security alert by notification oracle. Export rejected.");
     }
 
-    if (!(tx.vout[outNum].scriptPubKey.IsPayToCryptoCondition(p) &&
+    if (!(tx.IsPayToCryptoCondition(outNum, p) &&
           p.IsValid() &&
           p.evalCode == EVAL_CROSSCHAIN_EXPORT &&
           p.vData.size() &&
@@ -1464,7 +1466,7 @@ bool PrecheckCrossChainExport(const CTransaction &tx, int32_t outNum, CValidatio
     {
         COptCCParams dupP;
         CCrossChainExport dupCCX;
-        if (tx.vout[i].scriptPubKey.IsPayToCryptoCondition(dupP) &&
+        if (tx.IsPayToCryptoCondition(i, dupP) &&
             dupP.IsValid() &&
             dupP.evalCode == EVAL_CROSSCHAIN_EXPORT &&
             dupP.vData.size() &&
@@ -1871,7 +1873,7 @@ bool PrecheckCrossChainExport(const CTransaction &tx, int32_t outNum, CValidatio
             {
                 return state.Error("Invalid destination system in export or system not found");
             }
-            if (destSystem.systemID != ASSETCHAINS_CHAINID && ConnectedChains.activeUpgradesByKey.count(ConnectedChains.DisablePBaaSCrossChainKey()))
+            if (destSystem.systemID != ASSETCHAINS_CHAINID && ConnectedChains.HasUpgrade(CUpgradeActivations::DISABLE_PBAAS_CROSS_CHAIN))
             {
                 if (LogAcceptCategory("defi"))
                 {
@@ -1880,7 +1882,7 @@ bool PrecheckCrossChainExport(const CTransaction &tx, int32_t outNum, CValidatio
                 return state.Error("All crosschain exports temporarily disabled for security alert by notification oracle - export rejected.");
             }
             if (destSystem.IsGateway() &&
-                ConnectedChains.activeUpgradesByKey.count(ConnectedChains.DisableGatewayCrossChainKey()))
+                ConnectedChains.HasUpgrade(CUpgradeActivations::DISABLE_GATEWAY_CROSS_CHAIN))
             {
                 if (LogAcceptCategory("defi"))
                 {
@@ -1970,7 +1972,7 @@ bool PrecheckCrossChainExport(const CTransaction &tx, int32_t outNum, CValidatio
         {
             COptCCParams p;
             CReserveDeposit rd;
-            if (tx.vout[i].scriptPubKey.IsPayToCryptoCondition(p) &&
+            if (tx.IsPayToCryptoCondition(i, p) &&
                 p.IsValid() &&
                 p.evalCode == EVAL_RESERVE_DEPOSIT &&
                 p.vData.size() &&
@@ -2105,7 +2107,7 @@ bool ValidateFinalizeExport(struct CCcontract_info *cp, Eval* eval, const CTrans
 
         for (i = 0; i < tx.vout.size(); i++)
         {
-            if (tx.vout[i].scriptPubKey.IsPayToCryptoCondition(p) &&
+            if (tx.IsPayToCryptoCondition(i, p) &&
                 p.IsValid() &&
                 p.evalCode == EVAL_CROSSCHAIN_IMPORT &&
                 p.vData.size() &&
@@ -2140,7 +2142,7 @@ bool PreCheckFinalizeExport(const CTransaction &tx, int32_t outNum, CValidationS
     // the currency or a same-chain export to be spent by the matching import
     COptCCParams p;
     CObjectFinalization of;
-    if (!(tx.vout[outNum].scriptPubKey.IsPayToCryptoCondition(p) &&
+    if (!(tx.IsPayToCryptoCondition(outNum, p) &&
           p.IsValid() &&
           p.IsEvalPKOut() &&
           p.vData.size() &&
@@ -2170,7 +2172,7 @@ bool PreCheckFinalizeExport(const CTransaction &tx, int32_t outNum, CValidationS
         }
         COptCCParams dupP;
         CObjectFinalization dupOf;
-        if (tx.vout[i].scriptPubKey.IsPayToCryptoCondition(dupP) &&
+        if (tx.IsPayToCryptoCondition(i, dupP) &&
             dupP.IsValid() &&
             dupP.evalCode == EVAL_FINALIZE_EXPORT &&
             dupP.vData.size() &&
@@ -2330,7 +2332,11 @@ bool verusCheckPOSBlock(int32_t slowflag, const CBlock *pblock, int32_t height)
                     CPOSNonce nonce = pblock->nNonce;
 
                     //printf("before nNonce: %s, height: %d\n", pblock->nNonce.GetHex().c_str(), height);
-                    validHash = pblock->GetRawVerusPOSHash(rawHash, height);
+                    // with the new enforcement, the raw hash was already computed and valid to get here
+                    if (!newPOSEnforcement)
+                    {
+                        validHash = pblock->GetRawVerusPOSHash(rawHash, height);
+                    }
 
                     hash = UintToArith256(tx.GetVerusPOSHash(&nonce, voutNum, height, pastHash));
 
@@ -2425,7 +2431,7 @@ bool verusCheckPOSBlock(int32_t slowflag, const CBlock *pblock, int32_t height)
                                         std::map<uint160, int> reserveDepositReserves;
 
                                         COptCCParams ccp;
-                                        if (tx.vout[voutNum].scriptPubKey.IsPayToCryptoCondition(ccp) &&
+                                        if (tx.IsPayToCryptoCondition(voutNum, ccp) &&
                                             ccp.IsValid() &&
                                             ccp.evalCode == EVAL_RESERVE_DEPOSIT)
                                         {
@@ -2663,18 +2669,20 @@ bool ValidateNotaryEvidence(struct CCcontract_info *cp, Eval* eval, const CTrans
     // if it's an import proof, we need to be spent to the next import
     if (thisEvidence.type == thisEvidence.TYPE_MULTIPART_DATA)
     {
-        CNotaryEvidence oneEvidencePart;
-
         int i;
         for (i = tx.vin[nIn].prevout.n - 1; i >= 0; i--)
         {
+            // only the header of each part is needed to find the first one
             if (std::get<2>(sourceTx).vout[i].scriptPubKey.IsPayToCryptoCondition(p) &&
                 p.evalCode == EVAL_NOTARY_EVIDENCE &&
-                p.vData.size() &&
-                (oneEvidencePart = CNotaryEvidence(p.vData[0])).IsValid() &&
-                oneEvidencePart.type == oneEvidencePart.TYPE_MULTIPART_DATA)
+                p.vData.size())
             {
-                continue;
+                CNotaryEvidenceView oneEvidencePart(p.vData[0]);
+                if (oneEvidencePart.IsValid() &&
+                    oneEvidencePart.type == CNotaryEvidence::TYPE_MULTIPART_DATA)
+                {
+                    continue;
+                }
             }
             break;
         }
@@ -2872,7 +2880,7 @@ bool ValidateReserveTransfer(struct CCcontract_info *cp, Eval* eval, const CTran
         for (int i = 0; i < tx.vout.size(); i++)
         {
             COptCCParams exportP;
-            if (tx.vout[i].scriptPubKey.IsPayToCryptoCondition(exportP) &&
+            if (tx.IsPayToCryptoCondition(i, exportP) &&
                 exportP.IsValid() &&
                 exportP.evalCode == EVAL_CROSSCHAIN_EXPORT &&
                 exportP.vData.size() > 1 &&
@@ -3001,7 +3009,7 @@ bool ValidateReserveDeposit(struct CCcontract_info *cp, Eval* eval, const CTrans
     for (importOutNum = 0; importOutNum < tx.vout.size(); importOutNum++)
     {
         COptCCParams p;
-        if (tx.vout[importOutNum].scriptPubKey.IsPayToCryptoCondition(p) &&
+        if (tx.IsPayToCryptoCondition(importOutNum, p) &&
             p.IsValid() &&
             p.evalCode == EVAL_CROSSCHAIN_IMPORT &&
             p.vData.size() &&
@@ -3056,7 +3064,7 @@ bool ValidateReserveDeposit(struct CCcontract_info *cp, Eval* eval, const CTrans
         COptCCParams p;
         importOutNum--;        // set i to the actual import
         if (!(importOutNum >= 0 &&
-              tx.vout[importOutNum].scriptPubKey.IsPayToCryptoCondition(p) &&
+              tx.IsPayToCryptoCondition(importOutNum, p) &&
               p.IsValid() &&
               p.evalCode == EVAL_CROSSCHAIN_IMPORT &&
               p.vData.size() &&
@@ -3332,7 +3340,7 @@ bool ValidateReserveDeposit(struct CCcontract_info *cp, Eval* eval, const CTrans
         {
             COptCCParams p;
             CReserveDeposit rd;
-            if (tx.vout[i].scriptPubKey.IsPayToCryptoCondition(p) &&
+            if (tx.IsPayToCryptoCondition(i, p) &&
                 p.IsValid() &&
                 p.evalCode == EVAL_RESERVE_DEPOSIT &&
                 p.vData.size() &&
@@ -3597,12 +3605,12 @@ std::vector<CBaseChainObject *> RetrieveOpRetArray(const CScript &opRetScript)
 
 CCrossChainExport::CCrossChainExport(const CScript &script)
 {
-    COptCCParams p;
-    if (script.IsPayToCryptoCondition(p) &&
+    COptCCParamsView p(script);
+    if (p.IsPayToCryptoCondition() &&
         p.IsValid() &&
         p.evalCode == EVAL_CROSSCHAIN_EXPORT)
     {
-        FromVector(p.vData[0], *this);
+        FromSpan(p.vData[0].pBegin, p.vData[0].pEnd, *this);
     }
 }
 
@@ -3674,7 +3682,7 @@ CCrossChainExport::CCrossChainExport(const CTransaction &tx, int32_t *pCCXOutput
     for (int i = 0; i < tx.vout.size(); i++)
     {
         COptCCParams p;
-        if (tx.vout[i].scriptPubKey.IsPayToCryptoCondition(p) &&
+        if (tx.IsPayToCryptoCondition(i, p) &&
             p.IsValid() &&
             p.evalCode == EVAL_CROSSCHAIN_EXPORT)
         {
@@ -3688,12 +3696,12 @@ CCrossChainExport::CCrossChainExport(const CTransaction &tx, int32_t *pCCXOutput
 CCurrencyDefinition::CCurrencyDefinition(const CScript &scriptPubKey)
 {
     nVersion = PBAAS_VERSION_INVALID;
-    COptCCParams p;
-    if (scriptPubKey.IsPayToCryptoCondition(p) && p.IsValid())
+    COptCCParamsView p(scriptPubKey);
+    if (p.IsPayToCryptoCondition() && p.IsValid())
     {
         if (p.evalCode == EVAL_CURRENCY_DEFINITION && p.vData.size())
         {
-            FromVector(p.vData[0], *this);
+            FromSpan(p.vData[0].pBegin, p.vData[0].pEnd, *this);
         }
     }
 }
@@ -3892,7 +3900,7 @@ bool PrecheckCurrencyDefinition(const CTransaction &tx, int32_t outNum, CValidat
 
     CCurrencyDefinition newCurrency;
     COptCCParams currencyOptParams;
-    if (!(tx.vout[outNum].scriptPubKey.IsPayToCryptoCondition(currencyOptParams) &&
+    if (!(tx.IsPayToCryptoCondition(outNum, currencyOptParams) &&
           currencyOptParams.IsValid() &&
           currencyOptParams.evalCode == EVAL_CURRENCY_DEFINITION &&
           currencyOptParams.vData.size() > 1 &&
@@ -4852,7 +4860,7 @@ bool PrecheckReserveTransfer(const CTransaction &tx, int32_t outNum, CValidation
     uint32_t chainHeight = chainActive.Height();
     bool haveFullChain = height <= chainHeight + 1;
 
-    if (haveFullChain && ConnectedChains.activeUpgradesByKey.count(ConnectedChains.DisableDeFiKey()))
+    if (haveFullChain && ConnectedChains.HasUpgrade(CUpgradeActivations::DISABLE_DEFI))
     {
         if (LogAcceptCategory("defi"))
         {
@@ -4861,7 +4869,7 @@ bool PrecheckReserveTransfer(const CTransaction &tx, int32_t outNum, CValidation
         return state.Error("DeFi functions temporarily disabled for security alert by notification oracle. Reserve transfer rejected " + rt.ToUniValue().write(1,2));
     }
 
-    if (tx.vout[outNum].scriptPubKey.IsPayToCryptoCondition(p) &&
+    if (tx.IsPayToCryptoCondition(outNum, p) &&
         p.IsValid() &&
         p.evalCode == EVAL_RESERVE_TRANSFER &&
         p.vData.size() &&
@@ -5014,7 +5022,7 @@ bool PrecheckReserveTransfer(const CTransaction &tx, int32_t outNum, CValidation
         {
             if (haveFullChain)
             {
-                if (ConnectedChains.activeUpgradesByKey.count(ConnectedChains.DisablePBaaSCrossChainKey()))
+                if (ConnectedChains.HasUpgrade(CUpgradeActivations::DISABLE_PBAAS_CROSS_CHAIN))
                 {
                     if (LogAcceptCategory("defi"))
                     {
@@ -5022,7 +5030,7 @@ bool PrecheckReserveTransfer(const CTransaction &tx, int32_t outNum, CValidation
                     }
                     return false;
                 }
-                if (systemDest.IsGateway() && ConnectedChains.activeUpgradesByKey.count(ConnectedChains.DisableGatewayCrossChainKey()))
+                if (systemDest.IsGateway() && ConnectedChains.HasUpgrade(CUpgradeActivations::DISABLE_GATEWAY_CROSS_CHAIN))
                 {
                     if (LogAcceptCategory("defi"))
                     {
@@ -5206,7 +5214,7 @@ bool PrecheckReserveTransfer(const CTransaction &tx, int32_t outNum, CValidation
         {
             COptCCParams importP;
             CCrossChainImport cci;
-            if (tx.vout[loop].scriptPubKey.IsPayToCryptoCondition(importP) &&
+            if (tx.IsPayToCryptoCondition(loop, importP) &&
                 importP.IsValid() &&
                 importP.evalCode == EVAL_CROSSCHAIN_IMPORT &&
                 importP.vData.size() &&
@@ -5742,7 +5750,12 @@ bool CConnectedChains::AddMergedBlock(CPBaaSMergeMinedChainData &blkData)
         target.SetCompact(blkData.block.nBits);
 
         mergeMinedChains.insert(make_pair(cID, blkData));
-        mergeMinedTargets.insert(make_pair(target, &(mergeMinedChains[cID])));
+
+        // precompute the commitment that a merge mined header must have to win this block, so
+        // we don't need to serialize and hash the pre-header of each chain for every solution
+        CPBaaSMergeMinedChainData &chainData = mergeMinedChains[cID];
+        chainData.hashPreHeader = CPBaaSBlockHeader(cID, CPBaaSPreHeader(chainData.block)).hashPreHeader;
+        mergeMinedTargets.insert(make_pair(target, &chainData));
         dirty = true;
         dirtygbt = true;
         nextBlockTimeUpdateRequired = true;
@@ -5894,7 +5907,6 @@ uint32_t CConnectedChains::GetNextBlockTime(const CBlockIndex *pindexPrev)
 // matching blocks to be found
 vector<pair<string, UniValue>> CConnectedChains::SubmitQualifiedBlocks()
 {
-    std::set<uint160> inHeader;
     bool submissionFound;
     CPBaaSMergeMinedChainData chainData;
     vector<pair<string, UniValue>>  results;
@@ -5912,25 +5924,32 @@ vector<pair<string, UniValue>> CConnectedChains::SubmitQualifiedBlocks()
             // common, merge mined headers for notarization, drop out on any submission
             for (auto headerIt = qualifiedHeaders.begin(); !submissionFound && headerIt != qualifiedHeaders.end(); headerIt = qualifiedHeaders.begin())
             {
-                // add the PBaaS chain ids from this header to a set for search
+                // add the PBaaS chain ids and commitments from this header to a map for search
+                std::map<uint160, uint256> inHeader;
                 for (uint32_t i = 0; headerIt->second.GetPBaaSHeader(pbh, i); i++)
                 {
-                    inHeader.insert(pbh.chainID);
+                    inHeader.insert(std::make_pair(pbh.chainID, pbh.hashPreHeader));
                 }
 
+                // once PBaaS is active, all pre-header data comes from each chain's block, so the precomputed
+                // commitment of each chain can be compared directly
+                bool precomputedCommitments = CConstVerusSolutionVector::GetDescriptor(headerIt->second.nSolution).version >= CActivationHeight::ACTIVATE_PBAAS;
+
                 uint160 chainID;
                 // now look through all targets that are equal to or above the hash of this header
                 for (auto chainIt = mergeMinedTargets.lower_bound(headerIt->first); !submissionFound && chainIt != mergeMinedTargets.end(); chainIt++)
                 {
                     chainID = chainIt->second->GetID();
-                    if (inHeader.count(chainID))
+                    auto commitmentIt = inHeader.find(chainID);
+                    if (commitmentIt != inHeader.end() &&
+                        (!precomputedCommitments || commitmentIt->second == chainIt->second->hashPreHeader))
                     {
                         // first, check that the winning header matches the block that is there
                         CPBaaSPreHeader preHeader(chainIt->second->block);
                         preHeader.SetBlockData(headerIt->second);
 
                         // check if the block header matches the block's specific data, only then can we create a submission from this block
-                        if (headerIt->second.CheckNonCanonicalData(chainID))
+                        if (precomputedCommitments || headerIt->second.CheckNonCanonicalData(chainID))
                         {
                             // save block as is, remove the block from merged headers, replace header, and submit
                             chainData = *chainIt->second;
@@ -6181,13 +6200,23 @@ bool CConnectedChains::CheckVerusPBaaSAvailable()
         try
         {
             UniValue params(UniValue::VARR);
-            chainInfo = find_value(RPCCallRoot("getinfo", params), "result");
+
+            // the notary chain definition is only requested if it was not launched from here, in the same round trip
+            bool localDefinition = FirstNotaryChain().chainDefinition.launchSystemID == ASSETCHAINS_CHAINID;
+            std::vector<std::pair<std::string, UniValue>> infoCalls({{"getinfo", params}});
+            if (!localDefinition)
+            {
+                UniValue currencyParams(UniValue::VARR);
+                currencyParams.push_back(EncodeDestination(CIdentityID(FirstNotaryChain().chainDefinition.GetID())));
+                infoCalls.push_back({"getcurrency", currencyParams});
+            }
+            std::vector<UniValue> infoResults = RPCCallRootBatch(infoCalls);
+            chainInfo = find_value(infoResults[0], "result");
             if (!chainInfo.isNull())
             {
-                params.push_back(EncodeDestination(CIdentityID(FirstNotaryChain().chainDefinition.GetID())));
-                chainDef = FirstNotaryChain().chainDefinition.launchSystemID == ASSETCHAINS_CHAINID ?
+                chainDef = localDefinition ?
                             FirstNotaryChain().chainDefinition.ToUniValue() :
-                            find_value(RPCCallRoot("getcurrency", params), "result");
+                            find_value(infoResults[1], "result");
 
                 if (!chainDef.isNull() && CheckVerusPBaaSAvailable(chainInfo, chainDef))
                 {
@@ -6247,6 +6276,10 @@ bool CConnectedChains::IsNotaryAvailable(bool callToCheck)
         // if we aren't checking, we consider unavailable no contact in the last two minutes
         return FirstNotaryChain().IsValid() && (GetTime() - FirstNotaryChain().LastConnectionTime() < (120));
     }
+    if (notaryMonitorRunning && boost::this_thread::get_id() != notaryMonitorThreadID)
+    {
+        return notaryAvailable && FirstNotaryChain().IsValid();
+    }
     return !(FirstNotaryChain().rpcHost.empty() || FirstNotaryChain().rpcPort == 0 || FirstNotaryChain().rpcUserPass.empty()) &&
            CheckVerusPBaaSAvailable();
 }
@@ -6282,6 +6315,71 @@ std::string VersionString(uint32_t version)
     return ("v" + std::to_string(version >> 24) + "." + std::to_string((version >> 16) & 0xff) + "." + std::to_string((version >> 8) & 0xff) + ((version & 0xff) ? "-" + std::to_string(version & 0xff) : ""));
 }
 
+CUpgradeActivations::CUpgradeActivations(const std::map<uint160, CUpgradeDescriptor> &upgrades, uint32_t daemonVersion) :
+    upgradesByKey(upgrades), present(0), needsNewerDaemon(0), heights(), times()
+{
+    for (auto &oneUpgrade : upgradesByKey)
+    {
+        int slot = GetSlot(oneUpgrade.first);
+        if (slot >= 0)
+        {
+            present |= 1 << slot;
+            heights[slot] = oneUpgrade.second.upgradeBlockHeight;
+            times[slot] = oneUpgrade.second.upgradeTargetTime;
+            if (oneUpgrade.second.minDaemonVersion > daemonVersion)
+            {
+                needsNewerDaemon |= 1 << slot;
+            }
+        }
+    }
+}
+
+int CUpgradeActivations::GetSlot(const uint160 &upgradeID)
+{
+    static const uint160 slotKeys[NUM_UPGRADE_SLOTS] = {
+        CConnectedChains::DisableDeFiKey(),
+        CConnectedChains::DisablePBaaSCrossChainKey(),
+        CConnectedChains::DisableGatewayCrossChainKey(),
+        CConnectedChains::ResetNotarizationModuloKey(),
+        CConnectedChains::ForceIdentityUpgradeKey(),
+        CConnectedChains::ForceIdentityUnlockKey(),
+        CConnectedChains::PreconvertReserveTransferPrecheckKey(),
+        CConnectedChains::ImportPreconvertReserveTransferPrecheckKey(),
+        CConnectedChains::PBaaSCrossChainProofUpgradeKey(),
+        CConnectedChains::MagicNumberFixKey(),
+        CConnectedChains::EnableOptimizedETHProofKey(),
+        CConnectedChains::PBaaSUpgradeKey()
+    };
+    for (int i = 0; i < NUM_UPGRADE_SLOTS; i++)
+    {
+        if (slotKeys[i] == upgradeID)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool CUpgradeActivations::SameUpgrades(const std::map<uint160, CUpgradeDescriptor> &upgrades) const
+{
+    if (upgrades.size() != upgradesByKey.size())
+    {
+        return false;
+    }
+    for (auto it = upgrades.begin(), lastIt = upgradesByKey.begin(); it != upgrades.end(); it++, lastIt++)
+    {
+        if (it->first != lastIt->first ||
+            it->second.version != lastIt->second.version ||
+            it->second.minDaemonVersion != lastIt->second.minDaemonVersion ||
+            it->second.upgradeBlockHeight != lastIt->second.upgradeBlockHeight ||
+            it->second.upgradeTargetTime != lastIt->second.upgradeTargetTime)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
 void CConnectedChains::CheckOracleUpgrades()
 {
     uint32_t height = chainActive.LastTip() && chainActive.Height() ? chainActive.Height() : 0;
@@ -6444,12 +6542,25 @@ void CConnectedChains::CheckOracleUpgrades()
             KOMODO_STOPAT = stoppingIt->second.upgradeBlockHeight - 1;
         }
     }
+
+    // checks made during validation read the snapshot, which is only rebuilt when the oracle changes the upgrades
+    if (!GetUpgradeActivations()->SameUpgrades(activeUpgradesByKey))
+    {
+        std::atomic_store(&upgradeActivations, std::make_shared<const CUpgradeActivations>(activeUpgradesByKey, GetVerusVersion()));
+    }
 }
 
 bool CConnectedChains::IsUpgradeActive(const uint160 &upgradeID, uint32_t blockHeight, uint32_t blockTime) const
 {
-    auto it = activeUpgradesByKey.find(upgradeID);
-    if (it != activeUpgradesByKey.end())
+    std::shared_ptr<const CUpgradeActivations> activations = GetUpgradeActivations();
+    int slot = CUpgradeActivations::GetSlot(upgradeID);
+    if (slot >= 0 && !((activations->needsNewerDaemon >> slot) & 1))
+    {
+        return activations->IsActive(slot, blockHeight, blockTime);
+    }
+
+    auto it = activations->upgradesByKey.find(upgradeID);
+    if (it != activations->upgradesByKey.end())
     {
         if (it->second.minDaemonVersion > GetVerusVersion())
         {
@@ -6586,9 +6697,9 @@ bool CConnectedChains::ForceIdentityUpgrade(uint32_t height) const
         return true;
     }
 
-    auto iiuIt = ConnectedChains.activeUpgradesByKey.find(ConnectedChains.ForceIdentityUpgradeKey());
-    if (iiuIt != ConnectedChains.activeUpgradesByKey.end() &&
-        height >= iiuIt->second.upgradeBlockHeight)
+    std::shared_ptr<const CUpgradeActivations> activations = GetUpgradeActivations();
+    if (activations->HasUpgrade(CUpgradeActivations::FORCE_IDENTITY_UPGRADE) &&
+        height >= activations->heights[CUpgradeActivations::FORCE_IDENTITY_UPGRADE])
     {
         return true;
     }
@@ -6605,9 +6716,9 @@ bool CConnectedChains::ForceIdentityUnlock(uint32_t height) const
         return true;
     }
 
-    auto iiuIt = ConnectedChains.activeUpgradesByKey.find(ConnectedChains.ForceIdentityUnlockKey());
-    if (iiuIt != ConnectedChains.activeUpgradesByKey.end() &&
-        height >= iiuIt->second.upgradeBlockHeight)
+    std::shared_ptr<const CUpgradeActivations> activations = GetUpgradeActivations();
+    if (activations->HasUpgrade(CUpgradeActivations::FORCE_IDENTITY_UNLOCK) &&
+        height >= activations->heights[CUpgradeActivations::FORCE_IDENTITY_UNLOCK])
     {
         return true;
     }
@@ -6633,11 +6744,7 @@ bool CConnectedChains::DoPreconvertReserveTransferPrecheck(uint32_t height) cons
     uint32_t triggerHeight = IsVerusMainnetActive() ? 3050060 : (vARRRChainID() != ASSETCHAINS_CHAINID ? 67000 : 0);
     if (IsVerusMainnetActive() || vARRRChainID() == ASSETCHAINS_CHAINID)
     {
-        auto iiuIt = ConnectedChains.activeUpgradesByKey.find(ConnectedChains.PreconvertReserveTransferPrecheckKey());
-        if (iiuIt != ConnectedChains.activeUpgradesByKey.end())
-        {
-            triggerHeight = iiuIt->second.upgradeBlockHeight;
-        }
+        triggerHeight = GetUpgradeActivations()->UpgradeHeight(CUpgradeActivations::PRECONVERT_RESERVE_TRANSFER_PRECHECK, triggerHeight);
         return height >= triggerHeight;
     }
     return true;
@@ -6649,11 +6756,7 @@ bool CConnectedChains::DoImportPreconvertReserveTransferPrecheck(uint32_t height
 
     if (IsVerusMainnetActive() || vARRRChainID() == ASSETCHAINS_CHAINID)
     {
-        auto iiuIt = ConnectedChains.activeUpgradesByKey.find(ConnectedChains.ImportPreconvertReserveTransferPrecheckKey());
-        if (iiuIt != ConnectedChains.activeUpgradesByKey.end())
-        {
-            triggerHeight = iiuIt->second.upgradeBlockHeight;
-        }
+        triggerHeight = GetUpgradeActivations()->UpgradeHeight(CUpgradeActivations::IMPORT_PRECONVERT_RESERVE_TRANSFER_PRECHECK, triggerHeight);
         return height < triggerHeight;
     }
     return false;
@@ -6673,8 +6776,7 @@ bool CConnectedChains::IsEnhancedNotarizationOrder(uint32_t height) const
 
 bool CConnectedChains::CrossChainPBaaSProofFix(const uint160 &sysID, uint32_t height) const
 {
-    auto oracleProofFix = activeUpgradesByKey.find(CConnectedChains::PBaaSCrossChainProofUpgradeKey());
-    uint32_t fixHeight = oracleProofFix == activeUpgradesByKey.end() ? PBAAS_CROSS_CHAIN_PROOF_FIX_HEIGHT : oracleProofFix->second.upgradeBlockHeight;
+    uint32_t fixHeight = GetUpgradeActivations()->UpgradeHeight(CUpgradeActivations::PBAAS_CROSS_CHAIN_PROOF, PBAAS_CROSS_CHAIN_PROOF_FIX_HEIGHT);
     if (sysID == VERUS_CHAINID && !PBAAS_TESTMODE)
     {
         return height > 2549420; // This was the Verus PBaaS activation height
@@ -6754,8 +6856,7 @@ int CConnectedChains::IsUpgrade01Active(int64_t height) const
 
 uint32_t CConnectedChains::GetChainBranchId(const uint160 &sysID, int height, const Consensus::Params& params) const
 {
-    auto oracleProofFix = activeUpgradesByKey.find(CConnectedChains::PBaaSCrossChainProofUpgradeKey());
-    uint32_t fixHeight = oracleProofFix == activeUpgradesByKey.end() ? PBAAS_CROSS_CHAIN_PROOF_FIX_HEIGHT : oracleProofFix->second.upgradeBlockHeight;
+    uint32_t fixHeight = GetUpgradeActivations()->UpgradeHeight(CUpgradeActivations::PBAAS_CROSS_CHAIN_PROOF, PBAAS_CROSS_CHAIN_PROOF_FIX_HEIGHT);
     if (sysID == VERUS_CHAINID && !PBAAS_TESTMODE)
     {
         return CurrentEpochBranchId(height, params);
@@ -7008,6 +7109,7 @@ CCoinbaseCurrencyState CConnectedChains::GetCurrencyState(CCurrencyDefinition &c
     CCoinbaseCurrencyState currencyState;
 
     bool setCache = true;
+    bool setIndex = false;
 
     blockHash = chainActive[std::min(chainActive.Height(), height)]->GetBlockHash();
     currencyState = currencyStateCache.Get({chainID, blockHash, loadPendingTransfers});
@@ -7015,6 +7117,7 @@ CCoinbaseCurrencyState CConnectedChains::GetCurrencyState(CCurrencyDefinition &c
     {
         return currencyState;
     }
+    TRACE2(pbaas, currency_state_cache_miss, chainID.begin(), height);
     std::vector<CAddressIndexDbEntry> notarizationIndex;
 
     if ((IsVerusActive() || height == 0) && chainID == ASSETCHAINS_CHAINID)
@@ -7026,6 +7129,18 @@ CCoinbaseCurrencyState CConnectedChains::GetCurrencyState(CCurrencyDefinition &c
     // if this is a token on this chain, it will be simply notarized
     else if (curDef.SystemOrGatewayID() == ASSETCHAINS_CHAINID || (curDef.launchSystemID == ASSETCHAINS_CHAINID && curDef.startBlock > height))
     {
+        // unless pending pre-launch conversions are added, the state only depends on the chain up to height,
+        // so it is persisted in the currency state index and only calculated once per block
+        if (height <= chainActive.Height())
+        {
+            if (pblocktree->ReadCurrencyStateIndex(chainID, height, loadPendingTransfers, blockHash, currencyState))
+            {
+                currencyStateCache.Put({chainID, blockHash, loadPendingTransfers}, currencyState);
+                return currencyState;
+            }
+            setIndex = true;
+        }
+
         // get the last notarization in the height range for this currency, which is valid by definition for a token
         CPBaaSNotarization notarization;
         notarization.GetLastNotarization(chainID, curDefHeight, height);
@@ -7052,6 +7167,7 @@ CCoinbaseCurrencyState CConnectedChains::GetCurrencyState(CCurrencyDefinition &c
             currencyState.SetPrelaunch(true);
             if (loadPendingTransfers)
             {
+                setIndex = false;
                 currencyState = AddPrelaunchConversions(curDef,
                                                         currencyState,
                                                         notarization.IsValid() && !notarization.IsDefinitionNotarization() ?
@@ -7171,6 +7287,10 @@ CCoinbaseCurrencyState CConnectedChains::GetCurrencyState(CCurrencyDefinition &c
     if (setCache && currencyState.IsValid())
     {
         currencyStateCache.Put({chainID, blockHash, loadPendingTransfers}, currencyState);
+        if (setIndex && !pblocktree->WriteCurrencyStateIndex(chainID, height, loadPendingTransfers, blockHash, currencyState))
+        {
+            LogPrintf("%s: failed to write currency state index for %s at height %d\n", __func__, EncodeDestination(CIdentityID(chainID)).c_str(), height);
+        }
     }
     return currencyState;
 }
@@ -7206,8 +7326,13 @@ bool CConnectedChains::SetLatestMiningOutputs(const std::vector<CTxOut> &minerOu
 CCurrencyDefinition CConnectedChains::GetCachedCurrency(const uint160 &currencyID)
 {
     CCurrencyDefinition currencyDef = currencyDefCache.Get(currencyID);
+    if (currencyDef.IsValid())
+    {
+        return currencyDef;
+    }
+    TRACE1(pbaas, currency_def_cache_miss, currencyID.begin());
     int32_t defHeight;
-    if (!currencyDef.IsValid() && !GetCurrencyDefinition(currencyID, currencyDef, &defHeight, true))
+    if (!GetCurrencyDefinition(currencyID, currencyDef, &defHeight, true))
     {
         return currencyDef;
     }
@@ -7230,6 +7355,64 @@ CCurrencyDefinition CConnectedChains::UpdateCachedCurrency(const CCurrencyDefini
     return currencyDef;
 }
 
+bool CConnectedChains::GetCurrencyConverters(const uint160 &reserveID, std::map<uint160, std::pair<CCurrencyDefinition, CCoinbaseCurrencyState>> &converters)
+{
+    LOCK(cs_main);
+
+    // the converters of a reserve only change when a block is connected or disconnected, so they are found once
+    // for each tip, and until then, lookups are served from the cache
+    uint256 tipHash = chainActive.LastTip() ? chainActive.LastTip()->GetBlockHash() : uint256();
+    std::pair<uint256, std::map<uint160, std::pair<CCurrencyDefinition, CCoinbaseCurrencyState>>> cached = converterCache.Get(reserveID);
+    if (!tipHash.IsNull() && cached.first == tipHash)
+    {
+        converters = cached.second;
+        return true;
+    }
+
+    std::vector<CAddressUnspentDbEntry> fractionalNotarizations;
+    if (!GetAddressUnspent(CCoinbaseCurrencyState::IndexConverterKey(reserveID), CScript::P2IDX, fractionalNotarizations))
+    {
+        LogPrintf("%s: Error reading unspent index\n", __func__);
+        return false;
+    }
+
+    converters.clear();
+    for (auto &oneNotarization : fractionalNotarizations)
+    {
+        CPBaaSNotarization pbn(oneNotarization.second.script);
+        if (!pbn.IsValid())
+        {
+            LogPrintf("%s: Cannot read currency notarization in transaction %s\n", __func__, oneNotarization.first.txhash.GetHex().c_str());
+            return false;
+        }
+        if (converters.count(pbn.currencyID) ||
+            !(pbn.currencyState.IsLaunchConfirmed() && pbn.currencyState.IsLaunchCompleteMarker()))
+        {
+            continue;
+        }
+
+        CCurrencyDefinition oneCur = GetCachedCurrency(pbn.currencyID);
+        if (!oneCur.IsValid())
+        {
+            LogPrintf("%s: Cannot get currency definition for currency %s\n", __func__, EncodeDestination(CIdentityID(pbn.currencyID)).c_str());
+            return false;
+        }
+
+        CCoinbaseCurrencyState oneState = GetCurrencyState(pbn.currencyID, chainActive.Height(), true);
+        if (!(oneState.IsValid() && oneState.IsLaunchConfirmed() && oneState.IsLaunchCompleteMarker()))
+        {
+            continue;
+        }
+        converters.insert(std::make_pair(pbn.currencyID, std::make_pair(oneCur, oneState)));
+    }
+
+    if (!tipHash.IsNull())
+    {
+        converterCache.Put(reserveID, std::make_pair(tipHash, converters));
+    }
+    return true;
+}
+
 // this must be protected with main lock
 std::string CConnectedChains::GetFriendlyCurrencyName(const uint160 &currencyID, bool addVerus)
 {
@@ -7272,6 +7455,24 @@ std::string CConnectedChains::GetFriendlyCurrencyName(const uint160 &currencyID,
 }
 
 std::string CConnectedChains::GetFriendlyIdentityName(const std::string &name, const uint160 &parentCurrencyID, bool addVerus)
+{
+    // an ID is the hash of its name and parent, so a name that was found never changes. one whose parent is not yet
+    // known is looked up again
+    std::tuple<std::string, uint160, bool> cacheKey(name, parentCurrencyID, addVerus);
+    std::string friendlyName;
+    if (friendlyNameCache.Get(cacheKey, friendlyName))
+    {
+        return friendlyName;
+    }
+    friendlyName = GetUncachedFriendlyIdentityName(name, parentCurrencyID, addVerus);
+    if (!friendlyName.empty())
+    {
+        friendlyNameCache.Put(cacheKey, friendlyName);
+    }
+    return friendlyName;
+}
+
+std::string CConnectedChains::GetUncachedFriendlyIdentityName(const std::string &name, const uint160 &parentCurrencyID, bool addVerus)
 {
     uint160 parent;
     std::string cleanName = CleanName(name, parent, false, true);
@@ -7363,7 +7564,7 @@ bool CConnectedChains::GetUnspentCurrencyExports(const CCoinsViewCache &view,
 CPartialTransactionProof::CPartialTransactionProof(const CTransaction tx, const std::vector<int32_t> &inputNums, const std::vector<int32_t> &outputNums, const CBlockIndex *pIndex, uint32_t proofAtHeight)
 {
     // get map and MMR for transaction
-    CTransactionMap txMap(tx);
+    const CTransactionMap &txMap = tx.GetTransactionMap();
     TransactionMMView txView(txMap.transactionMMR);
     uint256 txRoot = txView.GetRoot();
 
@@ -7383,7 +7584,7 @@ CPartialTransactionProof::CPartialTransactionProof(const CTransaction tx, const
     // through the block MMR, and since we don't cache the new MMR proof for transactions yet, we need the block to create the proof.
     // when we switch to the new MMR in place of a merkle tree, we can keep that in the wallet as well
     CBlock block;
-    if (!ReadBlockFromDisk(block, pIndex, Params().GetConsensus(), false))
+    if (!ReadBlockForProof(block, pIndex, Params().GetConsensus()))
     {
         LogPrintf("%s: ERROR: could not read block number %u from disk\n", __func__, pIndex->GetHeight());
         version = VERSION_INVALID;
@@ -7489,6 +7690,9 @@ bool CConnectedChains::GetExportProofs(uint32_t height,
     return true;
 }
 
+// confirmed reserve deposit outputs of a currency, keyed by deposit index key and the best block of the coins view
+static LRUCache<std::pair<uint160, uint256>, std::vector<CAddressUnspentDbEntry>> reserveDepositCache(500, 0.1, true);
+
 bool CConnectedChains::GetReserveDeposits(const uint160 &currencyID, const CCoinsViewCache &view, std::vector<CInputDescriptor> &reserveDeposits)
 {
     std::vector<CAddressUnspentDbEntry> confirmedUTXOs;
@@ -7498,28 +7702,54 @@ bool CConnectedChains::GetReserveDeposits(const uint160 &currencyID, const CCoin
 
     CCoins coin;
 
+    // the unspent index already holds the script and value of each confirmed deposit and is updated as blocks are
+    // connected and disconnected, so deposits are read from it directly, and only once for every block, since
+    // import creation reads the same currency's deposits for each export it processes
     uint160 depositIndexKey = CReserveDeposit::ReserveDepositIndexKey(currencyID);
-    if (!GetAddressUnspent(depositIndexKey, CScript::P2IDX, confirmedUTXOs) ||
-        !mempool.getAddressIndex(std::vector<std::pair<uint160, int32_t>>({{depositIndexKey, CScript::P2IDX}}), unconfirmedUTXOs))
+    std::pair<uint160, uint256> cacheKey(depositIndexKey, view.GetBestBlock());
+    if ((cacheKey.second.IsNull() || !reserveDepositCache.Get(cacheKey, confirmedUTXOs)) &&
+        !GetAddressUnspent(depositIndexKey, CScript::P2IDX, confirmedUTXOs))
     {
         LogPrintf("%s: Cannot read address indexes\n", __func__);
         return false;
     }
-    std::vector<std::pair<CInputDescriptor, uint32_t>> outputs;
-    if (GetUnspentByIndex(depositIndexKey, outputs))
+    if (!cacheKey.second.IsNull())
     {
-        for (auto &oneOutput : outputs)
+        reserveDepositCache.Put(cacheKey, confirmedUTXOs);
+    }
+    if (!mempool.getAddressIndex(std::vector<std::pair<uint160, int32_t>>({{depositIndexKey, CScript::P2IDX}}), unconfirmedUTXOs))
+    {
+        LogPrintf("%s: Cannot read mempool address index\n", __func__);
+        return false;
+    }
+
+    std::set<COutPoint> spentInMempool;
+    auto memPoolOuts = mempool.FilterUnspent(unconfirmedUTXOs, spentInMempool);
+
+    auto addDeposit = [&](const uint256 &txHash, uint32_t outNum, const CScript &scriptPubKey, CAmount nValue)
+    {
+        COptCCParams p;
+        if (!mempool.mapNextTx.count(COutPoint(txHash, outNum)) &&
+            view.GetCoins(txHash, coin) &&
+            coin.IsAvailable(outNum) &&
+            scriptPubKey.IsPayToCryptoCondition(p) && p.IsValid() && p.evalCode == EVAL_RESERVE_DEPOSIT)
         {
-            COptCCParams p;
-            if (!mempool.mapNextTx.count(COutPoint(oneOutput.first.txIn.prevout.hash, oneOutput.first.txIn.prevout.n)) &&
-                view.GetCoins(oneOutput.first.txIn.prevout.hash, coin) &&
-                coin.IsAvailable(oneOutput.first.txIn.prevout.n) &&
-                oneOutput.first.scriptPubKey.IsPayToCryptoCondition(p) && p.IsValid() && p.evalCode == EVAL_RESERVE_DEPOSIT)
-            {
-                reserveDeposits.push_back(CInputDescriptor(oneOutput.first.scriptPubKey, oneOutput.first.nValue,
-                                                            CTxIn(oneOutput.first.txIn.prevout.hash, oneOutput.first.txIn.prevout.n)));
-            }
+            reserveDeposits.push_back(CInputDescriptor(scriptPubKey, nValue, CTxIn(txHash, outNum)));
         }
+    };
+
+    reserveDeposits.reserve(reserveDeposits.size() + confirmedUTXOs.size() + memPoolOuts.size());
+    for (auto &oneConfirmed : confirmedUTXOs)
+    {
+        if (!spentInMempool.count(COutPoint(oneConfirmed.first.txhash, oneConfirmed.first.index)))
+        {
+            addDeposit(oneConfirmed.first.txhash, oneConfirmed.first.index, oneConfirmed.second.script, oneConfirmed.second.satoshis);
+        }
+    }
+    for (auto &oneUnconfirmed : memPoolOuts)
+    {
+        const CTransaction &oneTx = mempool.mapTx.find(oneUnconfirmed.first.txhash)->GetTx();
+        addDeposit(oneUnconfirmed.first.txhash, oneUnconfirmed.first.index, oneTx.vout[oneUnconfirmed.first.index].scriptPubKey, oneUnconfirmed.second.amount);
     }
     return true;
 }
@@ -7573,6 +7803,25 @@ bool CConnectedChains::GetUnspentByIndex(const uint160 &indexID, std::vector<std
     return true;
 }
 
+bool GetReserveTransferIndexEntry(const CTxOut &out, const uint256 &txHash, unsigned int outNum, unsigned int height, CReserveTransferIndexEntry &entry)
+{
+    COptCCParams p;
+    CReserveTransfer rt;
+    uint160 destCID;
+    if (out.scriptPubKey.IsPayToCryptoCondition(p) &&
+        p.evalCode == EVAL_RESERVE_TRANSFER &&
+        p.vData.size() > 1 &&
+        (rt = CReserveTransfer(p.vData[0])).IsValid() &&
+        COptCCParams(p.vData[1]).IsValid() &&
+        !(destCID = rt.GetImportCurrency()).IsNull())
+    {
+        entry = CReserveTransferIndexEntry(CReserveTransferIndexKey(destCID, height, txHash, outNum),
+                                           std::make_pair(CInputDescriptor(out.scriptPubKey, out.nValue, CTxIn(txHash, outNum)), rt));
+        return true;
+    }
+    return false;
+}
+
 // given a set of provable exports to this chain from either this chain or another chain or system,
 // create a set of import transactions
 bool CConnectedChains::CreateLatestImports(const CCurrencyDefinition &sourceSystemDef,                      // transactions imported from system
@@ -7590,7 +7839,7 @@ bool CConnectedChains::CreateLatestImports(const CCurrencyDefinition &sourceSyst
         return false;
     }
 
-    if (ConnectedChains.activeUpgradesByKey.count(ConnectedChains.DisableDeFiKey()))
+    if (ConnectedChains.HasUpgrade(CUpgradeActivations::DISABLE_DEFI))
     {
         if (LogAcceptCategory("defi"))
         {
@@ -7598,7 +7847,7 @@ bool CConnectedChains::CreateLatestImports(const CCurrencyDefinition &sourceSyst
         }
         return false;
     }
-    if (sourceSystemDef.SystemOrGatewayID() != ASSETCHAINS_CHAINID && ConnectedChains.activeUpgradesByKey.count(ConnectedChains.DisablePBaaSCrossChainKey()))
+    if (sourceSystemDef.SystemOrGatewayID() != ASSETCHAINS_CHAINID && ConnectedChains.HasUpgrade(CUpgradeActivations::DISABLE_PBAAS_CROSS_CHAIN))
     {
         if (LogAcceptCategory("crosschainimports"))
         {
@@ -7606,7 +7855,7 @@ bool CConnectedChains::CreateLatestImports(const CCurrencyDefinition &sourceSyst
         }
         return false;
     }
-    if (sourceSystemDef.IsGateway() && ConnectedChains.activeUpgradesByKey.count(ConnectedChains.DisableGatewayCrossChainKey()))
+    if (sourceSystemDef.IsGateway() && ConnectedChains.HasUpgrade(CUpgradeActivations::DISABLE_GATEWAY_CROSS_CHAIN))
     {
         if (LogAcceptCategory("crosschainimports"))
         {
@@ -7658,10 +7907,28 @@ bool CConnectedChains::CreateLatestImports(const CCurrencyDefinition &sourceSyst
 
     uint160 failedCurrencyDest;
 
-    for (auto &oneIT : exports)
+    // checking an export proof only hashes the proof itself and is independent of chain state and of every other
+    // export, so all proofs are checked in parallel up front, and only the imports are made one after the other
+    std::vector<CTransaction> exportTxes(exports.size());
+    std::vector<uint256> exportProofRoots(exports.size());
+    if (useProofs)
     {
+        bool optimizeETHProof = ConnectedChains.ShouldOptimizeETHProof();
+        RunInParallel(exports.size(), [&exports, &exportTxes, &exportProofRoots, optimizeETHProof](size_t i)
+        {
+            if (exports[i].first.second.IsValid())
+            {
+                exportProofRoots[i] = exports[i].first.second.CheckPartialTransaction(exportTxes[i], nullptr, optimizeETHProof);
+            }
+            return true;
+        });
+    }
+
+    for (size_t exportNum = 0; exportNum < exports.size(); exportNum++)
+    {
+        auto &oneIT = exports[exportNum];
         uint256 blkHash;
-        CTransaction exportTx;
+        CTransaction &exportTx = exportTxes[exportNum];
 
         if (useProofs)
         {
@@ -7671,7 +7938,7 @@ bool CConnectedChains::CreateLatestImports(const CCurrencyDefinition &sourceSyst
                 continue;
             }
 
-            if (proofNotarization.proofRoots[sourceSystemID].stateRoot != oneIT.first.second.CheckPartialTransaction(exportTx, nullptr, ConnectedChains.ShouldOptimizeETHProof()))
+            if (proofNotarization.proofRoots[sourceSystemID].stateRoot != exportProofRoots[exportNum])
             {
                 LogPrintf("%s: export tx %s fails verification\n", __func__, oneIT.first.first.txIn.prevout.hash.GetHex().c_str());
                 continue;
@@ -9018,70 +9285,108 @@ bool CConnectedChains::GetSystemExports(const uint160 &systemID,
 }
 
 // get the launch notarization for a specific chain
+// a currency's launch notarization does not change once it is mined, so the output found is cached and used for as long as its
+// block remains in the active chain. proofs of it are cached by the block they are made relative to.
+static LRUCache<uint160, std::tuple<CTransaction, uint32_t, uint256>> launchNotarizationCache(500, 0.1, true);
+static LRUCache<std::tuple<uint256, uint32_t, uint32_t, uint256>, CPartialTransactionProof> launchNotarizationProofCache(500, 0.1, true);
+
 bool CConnectedChains::GetLaunchNotarization(const CCurrencyDefinition &curDef,
                                              std::pair<CInputDescriptor, CPartialTransactionProof> &notarizationRef,
                                              CPBaaSNotarization &launchNotarization,
                                              CPBaaSNotarization &notaryNotarization)
 {
-    std::vector<std::pair<CAddressIndexKey, CAmount>> addressIndex;
     uint160 currencyID = curDef.GetID();
-    bool retVal = false;
 
-    // get all export transactions including and since this one up to the confirmed cross-notarization
-    if (GetAddressIndex(CCrossChainRPCData::GetConditionID(currencyID, CPBaaSNotarization::LaunchNotarizationKey()),
-                        CScript::P2IDX,
-                        addressIndex))
+    std::tuple<CTransaction, uint32_t, uint256> launchOutput;
+    BlockMap::iterator blockIt;
+    if (!(launchNotarizationCache.Get(currencyID, launchOutput) &&
+          (blockIt = mapBlockIndex.find(std::get<2>(launchOutput))) != mapBlockIndex.end() &&
+          chainActive.Contains(blockIt->second)))
     {
-        for (auto &idx : addressIndex)
+        std::get<2>(launchOutput).SetNull();
+
+        // get all export transactions including and since this one up to the confirmed cross-notarization
+        std::vector<std::pair<CAddressIndexKey, CAmount>> addressIndex;
+        if (GetAddressIndex(CCrossChainRPCData::GetConditionID(currencyID, CPBaaSNotarization::LaunchNotarizationKey()),
+                            CScript::P2IDX,
+                            addressIndex))
         {
-            uint256 blkHash;
-            CTransaction notarizationTx;
-            if (!idx.first.spending && myGetTransaction(idx.first.txhash, notarizationTx, blkHash))
+            for (auto &idx : addressIndex)
             {
-                CChainNotarizationData cnd;
-                if ((launchNotarization = CPBaaSNotarization(notarizationTx.vout[idx.first.index].scriptPubKey)).IsValid() &&
-                     (notaryNotarization.IsValid() || (notaryNotarization = launchNotarization).IsValid()))
+                uint256 blkHash;
+                CTransaction notarizationTx;
+                if (!idx.first.spending &&
+                    myGetTransaction(idx.first.txhash, notarizationTx, blkHash) &&
+                    CPBaaSNotarization(notarizationTx.vout[idx.first.index].scriptPubKey).IsValid())
                 {
-                    auto blockIt = mapBlockIndex.find(blkHash);
-                    if (blockIt != mapBlockIndex.end() &&
-                        chainActive.Contains(blockIt->second))
+                    auto oneBlockIt = mapBlockIndex.find(blkHash);
+                    if (oneBlockIt != mapBlockIndex.end() &&
+                        chainActive.Contains(oneBlockIt->second))
                     {
-                        std::vector<int> inputNums, outputNums;
-                        if (launchNotarization.IsBlockOneNotarization() && launchNotarization.currencyID == ConnectedChains.ThisChain().launchSystemID)
-                        {
-                            // get entire coinbase proof
-                            inputNums.push_back(0);
-                            outputNums.resize(notarizationTx.vout.size());
-                            for (int outNum = 0; outNum < outputNums.size(); outNum++)
-                            {
-                                outputNums[outNum] = outNum;
-                            }
-                        }
-                        else
-                        {
-                            outputNums.push_back((int)idx.first.index);
-                        }
-                        notarizationRef.first = CInputDescriptor(notarizationTx.vout[idx.first.index].scriptPubKey,
-                                                                 notarizationTx.vout[idx.first.index].nValue,
-                                                                 CTxIn(idx.first.txhash, idx.first.index));
-
-                        uint32_t proofHeight = std::max((uint32_t)blockIt->second->GetHeight(), notaryNotarization.proofRoots[ASSETCHAINS_CHAINID].rootHeight);
-                        if (notaryNotarization.proofRoots[ASSETCHAINS_CHAINID].rootHeight != proofHeight)
-                        {
-                            notaryNotarization.proofRoots[ASSETCHAINS_CHAINID] = CProofRoot::GetProofRoot(proofHeight);
-                        }
-                        notarizationRef.second = CPartialTransactionProof(notarizationTx,
-                                                                          inputNums,
-                                                                          outputNums,
-                                                                          blockIt->second,
-                                                                          proofHeight);
-                        retVal = true;
+                        launchOutput = std::make_tuple(notarizationTx, (uint32_t)idx.first.index, blkHash);
                     }
                 }
             }
         }
+        if (std::get<2>(launchOutput).IsNull())
+        {
+            return false;
+        }
+        launchNotarizationCache.Put(currencyID, launchOutput);
+        blockIt = mapBlockIndex.find(std::get<2>(launchOutput));
     }
-    return retVal;
+
+    const CTransaction &notarizationTx = std::get<0>(launchOutput);
+    uint32_t notarizationOut = std::get<1>(launchOutput);
+
+    launchNotarization = CPBaaSNotarization(notarizationTx.vout[notarizationOut].scriptPubKey);
+    if (!notaryNotarization.IsValid())
+    {
+        notaryNotarization = launchNotarization;
+    }
+
+    std::vector<int> inputNums, outputNums;
+    if (launchNotarization.IsBlockOneNotarization() && launchNotarization.currencyID == ConnectedChains.ThisChain().launchSystemID)
+    {
+        // get entire coinbase proof
+        inputNums.push_back(0);
+        outputNums.resize(notarizationTx.vout.size());
+        for (int outNum = 0; outNum < outputNums.size(); outNum++)
+        {
+            outputNums[outNum] = outNum;
+        }
+    }
+    else
+    {
+        outputNums.push_back((int)notarizationOut);
+    }
+    notarizationRef.first = CInputDescriptor(notarizationTx.vout[notarizationOut].scriptPubKey,
+                                             notarizationTx.vout[notarizationOut].nValue,
+                                             CTxIn(notarizationTx.GetHash(), notarizationOut));
+
+    uint32_t proofHeight = std::max((uint32_t)blockIt->second->GetHeight(), notaryNotarization.proofRoots[ASSETCHAINS_CHAINID].rootHeight);
+    if (notaryNotarization.proofRoots[ASSETCHAINS_CHAINID].rootHeight != proofHeight)
+    {
+        notaryNotarization.proofRoots[ASSETCHAINS_CHAINID] = CProofRoot::GetProofRoot(proofHeight);
+    }
+
+    std::tuple<uint256, uint32_t, uint32_t, uint256> proofKey(notarizationTx.GetHash(),
+                                                              notarizationOut,
+                                                              proofHeight,
+                                                              proofHeight <= chainActive.Height() ? chainActive[proofHeight]->GetBlockHash() : uint256());
+    if (std::get<3>(proofKey).IsNull() || !launchNotarizationProofCache.Get(proofKey, notarizationRef.second))
+    {
+        notarizationRef.second = CPartialTransactionProof(notarizationTx,
+                                                          inputNums,
+                                                          outputNums,
+                                                          blockIt->second,
+                                                          proofHeight);
+        if (!std::get<3>(proofKey).IsNull())
+        {
+            launchNotarizationProofCache.Put(proofKey, notarizationRef.second);
+        }
+    }
+    return true;
 }
 
 // get the exports to a specific system from this chain, starting from a specific height up to a specific height
@@ -10288,7 +10593,7 @@ void CConnectedChains::AggregateChainTransfers(const CTransferDestination &feeRe
         LOCK(cs_main);
 
         // if we are paused on cross-chain, return error until enabled
-        if (ConnectedChains.activeUpgradesByKey.count(ConnectedChains.DisableDeFiKey()))
+        if (ConnectedChains.HasUpgrade(CUpgradeActivations::DISABLE_DEFI))
         {
             if (LogAcceptCategory("defi"))
             {
@@ -10457,7 +10762,7 @@ void CConnectedChains::AggregateChainTransfers(const CTransferDestination &feeRe
 
                 bool isSameChain = destDef.SystemOrGatewayID() == thisChainID;
 
-                if (!isSameChain && ConnectedChains.activeUpgradesByKey.count(ConnectedChains.DisablePBaaSCrossChainKey()))
+                if (!isSameChain && ConnectedChains.HasUpgrade(CUpgradeActivations::DISABLE_PBAAS_CROSS_CHAIN))
                 {
                     if (LogAcceptCategory("crosschainexports"))
                     {
@@ -10465,7 +10770,7 @@ void CConnectedChains::AggregateChainTransfers(const CTransferDestination &feeRe
                     }
                     continue;
                 }
-                if (systemDef.IsGateway() && ConnectedChains.activeUpgradesByKey.count(ConnectedChains.DisableGatewayCrossChainKey()))
+                if (systemDef.IsGateway() && ConnectedChains.HasUpgrade(CUpgradeActivations::DISABLE_GATEWAY_CROSS_CHAIN))
                 {
                     if (LogAcceptCategory("crosschainexports"))
                     {
@@ -10891,6 +11196,7 @@ void CConnectedChains::SignAndCommitImportTransactions(const CTransaction &lastI
         }
         lastHash = _tx.GetHash();
         CTransaction tx = newTx;
+        PrecomputedTransactionData txdata(tx);
 
         // sign the transaction and submit
         bool signSuccess = false;
@@ -10918,7 +11224,7 @@ void CConnectedChains::SignAndCommitImportTransactions(const CTransaction &lastI
                 outputScript = coins.vout[tx.vin[i].prevout.n].scriptPubKey;
             }
 
-            signSuccess = ProduceSignature(TransactionSignatureCreator(nullptr, &tx, i, value, SIGHASH_ALL), outputScript, sigdata, consensusBranchId);
+            signSuccess = ProduceSignature(TransactionSignatureCreator(nullptr, &tx, i, value, SIGHASH_ALL, &txdata), outputScript, sigdata, consensusBranchId);
 
             if (!signSuccess)
             {
@@ -11723,6 +12029,52 @@ void CConnectedChains::SubmissionThreadStub()
     ConnectedChains.SubmissionThread();
 }
 
+// keeps the status of the notary chain or Ethereum bridge current, so the miner, staker, submission and import loops
+// read it at once instead of each calling the notary every time through. the daemons have no way to push their
+// status, so the notary is polled here, once for all of them, over the pooled keep-alive RPC connection
+void CConnectedChains::NotaryMonitorThread()
+{
+    notaryMonitorThreadID = boost::this_thread::get_id();
+    try
+    {
+        while (true)
+        {
+            bool available = false;
+            if (FirstNotaryChain().IsValid())
+            {
+                available = IsNotaryAvailable(true);
+            }
+            else if (_IsVerusActive() &&
+                     CConstVerusSolutionVector::GetVersionByHeight(chainActive.Height()) >= CActivationHeight::ACTIVATE_PBAAS)
+            {
+                // until the Ethereum bridge is defined and configured, each check looks for it
+                available = ConfigureEthBridge(true);
+            }
+            notaryAvailable = available;
+            lastNotaryCheck = GetTime();
+            if (!notaryMonitorRunning)
+            {
+                notaryMonitorRunning = true;
+                LogPrint("crosschain", "%s: notary monitor started, notary %s\n", __func__, available ? "available" : "not available");
+            }
+
+            MilliSleep((available ? NOTARY_MONITOR_INTERVAL : NOTARY_MONITOR_RETRY_INTERVAL) * 1000);
+        }
+    }
+    catch (const boost::thread_interrupted&)
+    {
+        notaryMonitorRunning = false;
+        LogPrintf("Notary monitor thread terminated\n");
+        throw;
+    }
+}
+
+void CConnectedChains::NotaryMonitorThreadStub()
+{
+    RenameThread("verus-notarymon");
+    ConnectedChains.NotaryMonitorThread();
+}
+
 void CConnectedChains::QueueEarnedNotarization(CBlock &blk, int32_t txIndex, int32_t height)
 {
     // called after winning a block that contains an earned notarization
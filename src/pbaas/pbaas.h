@@ -14,6 +14,8 @@
 #ifndef PBAAS_H
 #define PBAAS_H
 
+#include <atomic>
+#include <memory>
 #include <vector>
 #include <univalue.h>
 
@@ -46,6 +48,9 @@ static const uint32_t PBAAS_NODESPERNOTARIZATION = 2;       // number of nodes t
 static const int64_t PBAAS_MINNOTARIZATIONOUTPUT = 10000;   // enough for one fee worth to finalization and notarization thread
 static const int32_t PBAAS_MINSTARTBLOCKDELTA = 20;         // minimum number of blocks to wait for starting a chain after definition
 static const int32_t PBAAS_MAXPRIORBLOCKS = 16;             // maximum prior block commitments to include in prior blocks chain object
+static const bool DEFAULT_NOTARY_MONITOR = true;            // -notarymonitor, check the notary chain or bridge in the background
+static const int NOTARY_MONITOR_INTERVAL = 2;               // seconds between checks of a notary that answered, keeping its block time current
+static const int NOTARY_MONITOR_RETRY_INTERVAL = 5;         // seconds between checks of a notary that did not
 static const uint32_t PBAAS_CROSS_CHAIN_PROOF_FIX_HEIGHT = 3143920;
 static const uint32_t PBAAS_BLOCK_ONE_ID_UPGRADE_FIX_HEIGHT = 3173198;
 static const uint32_t PBAAS_PROMOTE_EXCHANGE_RATE_HEIGHT = 3173568;
@@ -106,6 +111,59 @@ public:
     }
 };
 
+// the active upgrades compiled by CheckOracleUpgrades into an immutable snapshot, which is replaced only when the upgrades
+// change. the upgrades that consensus checks test for each output have fixed slots, so those checks are bit tests and
+// height compares instead of map lookups
+class CUpgradeActivations
+{
+public:
+    enum EUpgradeSlots {
+        DISABLE_DEFI = 0,
+        DISABLE_PBAAS_CROSS_CHAIN = 1,
+        DISABLE_GATEWAY_CROSS_CHAIN = 2,
+        RESET_NOTARIZATION_MODULO = 3,
+        FORCE_IDENTITY_UPGRADE = 4,
+        FORCE_IDENTITY_UNLOCK = 5,
+        PRECONVERT_RESERVE_TRANSFER_PRECHECK = 6,
+        IMPORT_PRECONVERT_RESERVE_TRANSFER_PRECHECK = 7,
+        PBAAS_CROSS_CHAIN_PROOF = 8,
+        MAGIC_NUMBER_FIX = 9,
+        ENABLE_OPTIMIZED_ETH_PROOF = 10,
+        PBAAS_UPGRADE = 11,
+        NUM_UPGRADE_SLOTS = 12
+    };
+
+    std::map<uint160, CUpgradeDescriptor> upgradesByKey;
+    uint32_t present;                       // one bit for each slot with an upgrade
+    uint32_t needsNewerDaemon;              // slots whose upgrade needs a newer daemon, left to the map to warn and stop
+    uint32_t heights[NUM_UPGRADE_SLOTS];
+    uint32_t times[NUM_UPGRADE_SLOTS];
+
+    CUpgradeActivations() : present(0), needsNewerDaemon(0), heights(), times() {}
+    CUpgradeActivations(const std::map<uint160, CUpgradeDescriptor> &upgrades, uint32_t daemonVersion);
+
+    // slot of an upgrade ID, or -1 if it has none
+    static int GetSlot(const uint160 &upgradeID);
+    bool SameUpgrades(const std::map<uint160, CUpgradeDescriptor> &upgrades) const;
+
+    bool HasUpgrade(int slot) const
+    {
+        return (present >> slot) & 1;
+    }
+
+    // the oracle height of an upgrade, or the default height when there is no upgrade in the slot
+    uint32_t UpgradeHeight(int slot, uint32_t defaultHeight) const
+    {
+        return HasUpgrade(slot) ? heights[slot] : defaultHeight;
+    }
+
+    bool IsActive(int slot, uint32_t blockHeight, uint32_t blockTime) const
+    {
+        return HasUpgrade(slot) &&
+               ((heights[slot] && blockHeight >= heights[slot]) || (times[slot] && blockTime >= times[slot]));
+    }
+};
+
 class CInputDescriptor
 {
 public:
@@ -120,7 +178,7 @@ public:
 
     template <typename Stream, typename Operation>
     inline void SerializationOp(Stream& s, Operation ser_action) {
-        READWRITE(scriptPubKey);
+        READWRITE(*(CScriptBase*)(&scriptPubKey));
         READWRITE(nValue);
         READWRITE(txIn);
     }
@@ -182,6 +240,7 @@ class CPBaaSMergeMinedChainData : public CRPCChainData
 {
 public:
     CBlock          block;                  // full block to submit upon winning header
+    uint256         hashPreHeader;          // commitment to this block in a merge mined header, set when added, not serialized
 
     CPBaaSMergeMinedChainData() {}
     CPBaaSMergeMinedChainData(CCurrencyDefinition &chainDef, std::string host, int32_t port, std::string userPass, CBlock &blk) :
@@ -960,9 +1019,12 @@ public:
     bool nextBlockTimeUpdateRequired;
 
     std::map<uint160, CUpgradeDescriptor> activeUpgradesByKey;
+    std::shared_ptr<const CUpgradeActivations> upgradeActivations;  // published from activeUpgradesByKey by CheckOracleUpgrades
 
-    LRUCache<uint160, CCurrencyDefinition> currencyDefCache;        // protected by cs_main, so doesn't need sync
-    LRUCache<std::tuple<uint160, uint256, bool>, CCoinbaseCurrencyState> currencyStateCache; // cached currency states @ heights + updated flag
+    ShardedLRUCache<uint160, CCurrencyDefinition> currencyDefCache;        // read by the script check threads of a block at once
+    ShardedLRUCache<std::tuple<uint160, uint256, bool>, CCoinbaseCurrencyState> currencyStateCache; // cached currency states @ heights + updated flag
+    LRUCache<uint160, std::pair<uint256, std::map<uint160, std::pair<CCurrencyDefinition, CCoinbaseCurrencyState>>>> converterCache; // launched fractionals holding a reserve @ tip hash
+    ShardedLRUCache<std::tuple<std::string, uint160, bool>, std::string> friendlyNameCache; // friendly identity names by name, parent and addVerus
 
     // make earned notarizations for one or more notary chains
     std::map<uint160, CNotarySystemInfo> notarySystems;
@@ -988,9 +1050,18 @@ public:
     CCriticalSection cs_mergemining;
     CSemaphore sem_submitthread;
 
+    // while the notary monitor runs, it alone calls the notary chain or bridge to check it, and IsNotaryAvailable(true)
+    // returns the status it last found without waiting on RPC
+    std::atomic<bool> notaryMonitorRunning;
+    std::atomic<bool> notaryAvailable;
+    std::atomic<int64_t> lastNotaryCheck;
+    boost::thread::id notaryMonitorThreadID;
+
     CConnectedChains() :
-        currencyDefCache(3000, 0.1F, false),
-        currencyStateCache(1000, 0.1F, false),
+        currencyDefCache(3000, 0.1F, true),
+        currencyStateCache(1000, 0.1F, true),
+        converterCache(1000, 0.1F, true),
+        friendlyNameCache(10000, 0, true),
         lastBlockHeight(0),
         readyToStart(false),
         earnedNotarizationHeight(0),
@@ -1000,8 +1071,12 @@ public:
         saveBits(0),
         lastSubmissionFailed(false),
         sem_submitthread(0),
+        notaryMonitorRunning(false),
+        notaryAvailable(false),
+        lastNotaryCheck(0),
         nextBlockTime(0),
-        nextBlockTimeUpdateRequired(0) {}
+        nextBlockTimeUpdateRequired(0),
+        upgradeActivations(std::make_shared<const CUpgradeActivations>()) {}
 
     uint32_t SetNextBlockTime(uint32_t NextBlockTime);
     uint32_t GetNextBlockTime(const CBlockIndex *pindexPrev);
@@ -1020,6 +1095,8 @@ public:
 
     void SubmissionThread();
     static void SubmissionThreadStub();
+    void NotaryMonitorThread();
+    static void NotaryMonitorThreadStub();
     std::vector<std::pair<std::string, UniValue>> SubmitQualifiedBlocks();
 
     void QueueNewBlockHeader(CBlockHeader &bh);
@@ -1047,8 +1124,12 @@ public:
     std::string GetFriendlyCurrencyName(const uint160 &currencyID, bool addVerus=false);
     std::string GetFriendlyIdentityName(const CIdentity &identity, bool addVerus=false);
     std::string GetFriendlyIdentityName(const std::string &name, const uint160 &parentCurrencyID, bool addVerus=false);
+    std::string GetUncachedFriendlyIdentityName(const std::string &name, const uint160 &parentCurrencyID, bool addVerus=false);
     CCurrencyDefinition UpdateCachedCurrency(const CCurrencyDefinition &currentCurrency, uint32_t height);
 
+    // returns all launched fractional currencies that hold the given reserve, with their currency states at the tip
+    bool GetCurrencyConverters(const uint160 &reserveID, std::map<uint160, std::pair<CCurrencyDefinition, CCoinbaseCurrencyState>> &converters);
+
     bool GetLastImport(const uint160 &currencyID,
                        CTransaction &lastImport,
                        int32_t &outputNum);
@@ -1212,10 +1293,18 @@ public:
     bool CheckVerusPBaaSAvailable(UniValue &chainInfo, UniValue &chainDef);
     bool CheckVerusPBaaSAvailable();      // may use RPC to call Verus
     bool IsVerusPBaaSAvailable();
-    bool IsNotaryAvailable(bool callToCheck=false);
+    bool IsNotaryAvailable(bool callToCheck=false); // with callToCheck, may use RPC unless the notary monitor is running
     bool ConfigureEthBridge(bool callToCheck=false);
     void CheckOracleUpgrades();
     bool IsUpgradeActive(const uint160 &upgradeID, uint32_t blockHeight=UINT32_MAX, uint32_t blockTime=UINT32_MAX) const;
+    std::shared_ptr<const CUpgradeActivations> GetUpgradeActivations() const
+    {
+        return std::atomic_load(&upgradeActivations);
+    }
+    bool HasUpgrade(int slot) const
+    {
+        return GetUpgradeActivations()->HasUpgrade(slot);
+    }
     uint32_t GetZeroViaHeight(bool getVerusHeight) const;
     uint32_t GetOptimizedETHProofHeight(bool getVerusHeight=false) const;
     bool ShouldOptimizeETHProof() const;
@@ -1444,17 +1533,18 @@ CTxOut MakeCC1of1Vout(uint8_t evalcode, CAmount nValue, CPubKey pk, std::vector<
 {
     assert(vDest.size() < 256);
 
-    CTxOut vout;
     CC *payoutCond = MakeCCcond1(evalcode, pk);
-    vout = CTxOut(nValue, CCPubKey(payoutCond));
+    CScript scriptPubKey = CCPubKey(payoutCond);
     cc_free(payoutCond);
 
-    std::vector<std::vector<unsigned char>> vvch({::AsVector((const TOBJ)obj)});
-    COptCCParams vParams = COptCCParams(COptCCParams::VERSION_V2, evalcode, 1, (uint8_t)(vDest.size()), vDest, vvch);
+    std::vector<std::vector<unsigned char>> vvch;
+    vvch.push_back(::AsVector(obj));
+    std::vector<unsigned char> vParamsData = COptCCParams(COptCCParams::VERSION_V2, evalcode, 1, (uint8_t)(vDest.size()), vDest, std::move(vvch)).AsVector();
 
-    // add the object to the end of the script
-    vout.scriptPubKey << vParams.AsVector() << OP_DROP;
-    return(vout);
+    // add the object to the end of the script, sized once for it, then move the script into the output
+    scriptPubKey.reserve(scriptPubKey.size() + vParamsData.size() + MAX_CC_PUSH_OVERHEAD);
+    scriptPubKey << vParamsData << OP_DROP;
+    return CTxOut(nValue, std::move(scriptPubKey));
 }
 
 template <typename TOBJ>
@@ -1484,13 +1574,13 @@ CTxOut MakeCC1ofAnyVout(uint8_t evalcode, CAmount nValue, std::vector<CTxDestina
         }
     }
 
-    CTxOut vout;
     CC *payoutCond = MakeCCcondAny(evalcode, vDest);
-    vout = CTxOut(nValue, CCPubKey(payoutCond));
+    CScript scriptPubKey = CCPubKey(payoutCond);
     cc_free(payoutCond);
 
-    std::vector<std::vector<unsigned char>> vvch({::AsVector((const TOBJ)obj)});
-    COptCCParams vParams = COptCCParams(COptCCParams::VERSION_V2, evalcode, 0, (uint8_t)(vDest.size()), vDest, vvch);
+    std::vector<std::vector<unsigned char>> vvch;
+    vvch.push_back(::AsVector(obj));
+    std::vector<unsigned char> vParamsData = COptCCParams(COptCCParams::VERSION_V2, evalcode, 0, (uint8_t)(vDest.size()), vDest, std::move(vvch)).AsVector();
 
     for (auto dest : vDest)
     {
@@ -1502,9 +1592,10 @@ CTxOut MakeCC1ofAnyVout(uint8_t evalcode, CAmount nValue, std::vector<CTxDestina
         }
     }
 
-    // add the object to the end of the script
-    vout.scriptPubKey << vParams.AsVector() << OP_DROP;
-    return(vout);
+    // add the object to the end of the script, sized once for it, then move the script into the output
+    scriptPubKey.reserve(scriptPubKey.size() + vParamsData.size() + MAX_CC_PUSH_OVERHEAD);
+    scriptPubKey << vParamsData << OP_DROP;
+    return CTxOut(nValue, std::move(scriptPubKey));
 }
 
 template <typename TOBJ>
@@ -18,7 +18,7 @@
 #include <random>
 
 LRUCache<CUTXORef, std::tuple<int, CCrossChainExport, CPBaaSNotarization, std::vector<CReserveTransfer>, CCurrencyDefinition::EProofProtocol>>
-    CCrossChainExport::exportInfoCache(200, 0.1F, false);
+    CCrossChainExport::exportInfoCache(200, 0.1F, true);
 
 // calculate fees required in one currency to pay in another
 CAmount CReserveTransfer::CalculateTransferFee(const CTransferDestination &destination, uint32_t flags)
@@ -92,13 +92,13 @@ CCurrencyValueMap CReserveTransfer::CalculateFee() const
 
 CCrossChainImport::CCrossChainImport(const CScript &script)
 {
-    COptCCParams p;
-    if (IsPayToCryptoCondition(script, p) && p.IsValid())
+    COptCCParamsView p(script);
+    if (p.IsPayToCryptoCondition() && p.IsValid())
     {
         // always take the first for now
         if (p.evalCode == EVAL_CROSSCHAIN_IMPORT && p.vData.size())
         {
-            FromVector(p.vData[0], *this);
+            FromSpan(p.vData[0].pBegin, p.vData[0].pEnd, *this);
         }
     }
 }
@@ -352,7 +352,7 @@ bool GetNotarizationFromOutput(const CTransaction tx, int32_t outNum, CValidatio
 {
     COptCCParams p;
     if (!(tx.vout.size() > outNum &&
-          tx.vout[outNum].scriptPubKey.IsPayToCryptoCondition(p) &&
+          tx.IsPayToCryptoCondition(outNum, p) &&
           p.IsValid() &&
           (p.evalCode == EVAL_ACCEPTEDNOTARIZATION || p.evalCode == EVAL_EARNEDNOTARIZATION) &&
           p.vData.size() &&
@@ -1276,7 +1276,8 @@ CCrossChainImport CCrossChainImport::GetPriorImportFromSystem(const CTransaction
     return cci;
 }
 
-LRUCache<std::tuple<uint256, uint32_t, uint32_t, CUTXORef, uint160, uint160>, CCurrencyValueMap> priorConversionCache;
+// reached by import validation on the script check threads of a block, see CEvalBlockContext
+LRUCache<std::tuple<uint256, uint32_t, uint32_t, CUTXORef, uint160, uint160>, CCurrencyValueMap> priorConversionCache(1000, 0.1F, true);
 
 // returns the best conversion prices for all currencies in a currency converter over a period of time to go from any currency in
 // the converter to the fee currency.
@@ -1884,26 +1885,35 @@ CCoinbaseCurrencyState::CCoinbaseCurrencyState(const UniValue &obj) : CCurrencyS
     }
 }
 
+// both formulas are pure functions of their integer arguments, and the same layers are priced repeatedly in
+// import validation, block template creation and conversion estimates, so results are cached
+static LRUCache<std::tuple<CAmount, CAmount, CAmount, int32_t>, CAmount> fractionalOutCache(10000, 0.1, true);
+static LRUCache<std::tuple<CAmount, CAmount, CAmount, int32_t>, CAmount> reserveOutCache(10000, 0.1, true);
+
 CAmount CalculateFractionalOut(CAmount NormalizedReserveIn, CAmount Supply, CAmount NormalizedReserve, int32_t reserveRatio)
 {
-    static cpp_dec_float_50 one("1");
-    static cpp_dec_float_50 bigSatoshi("100000000");
-    cpp_dec_float_50 reservein(std::to_string(NormalizedReserveIn));
-    reservein = reservein / bigSatoshi;
-    cpp_dec_float_50 supply(std::to_string((Supply ? Supply : 1)));
-    supply = supply / bigSatoshi;
-    cpp_dec_float_50 reserve(std::to_string(NormalizedReserve ? NormalizedReserve : 1));
-    reserve = reserve / bigSatoshi;
-    cpp_dec_float_50 ratio(std::to_string(reserveRatio));
-    ratio = ratio / bigSatoshi;
-
-    //printf("reservein: %s\nsupply: %s\nreserve: %s\nratio: %s\n\n", reservein.str().c_str(), supply.str().c_str(), reserve.str().c_str(), ratio.str().c_str());
+    static cpp_dec_float_50 one(1);
+    static cpp_dec_float_50 bigSatoshi(SATOSHIDEN);
 
     int64_t fractionalOut = 0;
 
     // first check if anything to buy
     if (NormalizedReserveIn)
     {
+        std::tuple<CAmount, CAmount, CAmount, int32_t> cacheKey(NormalizedReserveIn, Supply, NormalizedReserve, reserveRatio);
+        if (fractionalOutCache.Get(cacheKey, fractionalOut))
+        {
+            return fractionalOut;
+        }
+
+        // integers are exact in cpp_dec_float_50, so constructing from them directly is identical to parsing them
+        cpp_dec_float_50 reservein = cpp_dec_float_50(NormalizedReserveIn) / bigSatoshi;
+        cpp_dec_float_50 supply = cpp_dec_float_50(Supply ? Supply : 1) / bigSatoshi;
+        cpp_dec_float_50 reserve = cpp_dec_float_50(NormalizedReserve ? NormalizedReserve : 1) / bigSatoshi;
+        cpp_dec_float_50 ratio = cpp_dec_float_50(reserveRatio) / bigSatoshi;
+
+        //printf("reservein: %s\nsupply: %s\nreserve: %s\nratio: %s\n\n", reservein.str().c_str(), supply.str().c_str(), reserve.str().c_str(), ratio.str().c_str());
+
         cpp_dec_float_50 supplyout = bigSatoshi * (supply * (pow((reservein / reserve) + one, ratio) - one));
         //printf("supplyout: %s\n", supplyout.str(0, std::ios_base::fmtflags::_S_fixed).c_str());
 
@@ -1911,30 +1921,34 @@ CAmount CalculateFractionalOut(CAmount NormalizedReserveIn, CAmount Supply, CAmo
         {
             return -1;
         }
+        fractionalOutCache.Put(cacheKey, fractionalOut);
     }
     return fractionalOut;
 }
 
 CAmount CalculateReserveOut(CAmount FractionalIn, CAmount Supply, CAmount NormalizedReserve, int32_t reserveRatio)
 {
-    static cpp_dec_float_50 one("1");
-    static cpp_dec_float_50 bigSatoshi("100000000");
-    cpp_dec_float_50 fractionalin(std::to_string(FractionalIn));
-    fractionalin = fractionalin / bigSatoshi;
-    cpp_dec_float_50 supply(std::to_string((Supply ? Supply : 1)));
-    supply = supply / bigSatoshi;
-    cpp_dec_float_50 reserve(std::to_string(NormalizedReserve ? NormalizedReserve : 1));
-    reserve = reserve / bigSatoshi;
-    cpp_dec_float_50 ratio(std::to_string(reserveRatio));
-    ratio = ratio / bigSatoshi;
-
-    //printf("fractionalin: %s\nsupply: %s\nreserve: %s\nratio: %s\n\n", fractionalin.str().c_str(), supply.str().c_str(), reserve.str().c_str(), ratio.str().c_str());
+    static cpp_dec_float_50 one(1);
+    static cpp_dec_float_50 bigSatoshi(SATOSHIDEN);
 
     int64_t reserveOut = 0;
 
     // first check if anything to buy
     if (FractionalIn)
     {
+        std::tuple<CAmount, CAmount, CAmount, int32_t> cacheKey(FractionalIn, Supply, NormalizedReserve, reserveRatio);
+        if (reserveOutCache.Get(cacheKey, reserveOut))
+        {
+            return reserveOut;
+        }
+
+        cpp_dec_float_50 fractionalin = cpp_dec_float_50(FractionalIn) / bigSatoshi;
+        cpp_dec_float_50 supply = cpp_dec_float_50(Supply ? Supply : 1) / bigSatoshi;
+        cpp_dec_float_50 reserve = cpp_dec_float_50(NormalizedReserve ? NormalizedReserve : 1) / bigSatoshi;
+        cpp_dec_float_50 ratio = cpp_dec_float_50(reserveRatio) / bigSatoshi;
+
+        //printf("fractionalin: %s\nsupply: %s\nreserve: %s\nratio: %s\n\n", fractionalin.str().c_str(), supply.str().c_str(), reserve.str().c_str(), ratio.str().c_str());
+
         cpp_dec_float_50 reserveout = bigSatoshi * (reserve * (one - pow(one - (fractionalin / supply), (one / ratio))));
         //printf("reserveout: %s\n", reserveout.str(0, std::ios_base::fmtflags::_S_fixed).c_str());
 
@@ -1942,6 +1956,7 @@ CAmount CalculateReserveOut(CAmount FractionalIn, CAmount Supply, CAmount Normal
         {
             assert(false);
         }
+        reserveOutCache.Put(cacheKey, reserveOut);
     }
     return reserveOut;
 }
@@ -2030,8 +2045,8 @@ std::vector<CAmount> CCurrencyState::ConvertAmounts(const std::vector<CAmount> &
                                                     std::vector<std::vector<CAmount>> const *pCrossConversions,
                                                     std::vector<CAmount> *pViaPrices) const
 {
-    static arith_uint256 bigSatoshi(SATOSHIDEN);
-
+    // all products and quotients below are calculated with MultiplyDivide, whose 128 bit results are identical to
+    // the arith_uint256 calculations they replace, with the same conversions of each operand to 64 or 32 bits
     int32_t numCurrencies = currencies.size();
     std::vector<CAmount> inputReserves = _inputReserves;
     std::vector<CAmount> inputFractional = _inputFractional;
@@ -2157,8 +2172,6 @@ std::vector<CAmount> CCurrencyState::ConvertAmounts(const std::vector<CAmount> &
     // aggregate amounts of ins and outs across all currencies expressed in fractional values in both directions first buy/sell, then sell/buy
     std::map<uint160, std::pair<CAmount, CAmount>> fractionalInMap, fractionalOutMap;
 
-    arith_uint256 bigSupply(supply);
-
     int32_t totalReserveWeight = 0;
     int32_t maxReserveRatio = 0;
 
@@ -2180,21 +2193,17 @@ std::vector<CAmount> CCurrencyState::ConvertAmounts(const std::vector<CAmount> &
     }
 
     // it is currently an error to have > 100% reserve ratio currency
-    if (totalReserveWeight > bigSatoshi)
+    if ((uint64_t)totalReserveWeight > (uint64_t)SATOSHIDEN)
     {
         LogPrintf("%s: total currency backing weight exceeds 100%\n", __func__);
         return initialRates;
     }
 
-    arith_uint256 bigMaxReserveRatio = arith_uint256(maxReserveRatio);
-    arith_uint256 bigTotalReserveWeight = arith_uint256(totalReserveWeight);
-
     // reduce each currency change to a net inflow or outflow of fractional currency and
     // store both negative and positive in structures sorted by the net amount, adjusted
     // by the difference of the ratio between the weights of each currency
     for (int64_t i = 0; i < numCurrencies; i++)
     {
-        arith_uint256 weight(weights[i]);
         //printf("%s: %ld\n", __func__, ReserveToNative(inputReserves[i], i));
         CAmount asNative = ReserveToNative(inputReserves[i], i, promoteExchangeRate);
         // if overflow
@@ -2205,28 +2214,28 @@ std::vector<CAmount> CCurrencyState::ConvertAmounts(const std::vector<CAmount> &
         }
         CAmount netFractional = inputFractional[i] - asNative;
         int64_t deltaRatio;
-        arith_uint256 bigDeltaRatio;
+        unsigned __int128 bigDeltaRatio;
         if (netFractional > 0)
         {
-            bigDeltaRatio = ((arith_uint256(netFractional) * bigMaxReserveRatio) / weight);
+            bigDeltaRatio = MultiplyDivide(netFractional, maxReserveRatio, weights[i]);
             if (bigDeltaRatio > INT64_MAX)
             {
                 failed = true;
                 break;
             }
-            deltaRatio = bigDeltaRatio.GetLow64();
+            deltaRatio = (uint64_t)bigDeltaRatio;
             fractionalIn.insert(std::make_pair(deltaRatio, std::make_pair(netFractional, currencies[i])));
         }
         else if (netFractional < 0)
         {
             netFractional = -netFractional;
-            bigDeltaRatio = ((arith_uint256(netFractional) * bigMaxReserveRatio) / weight);
+            bigDeltaRatio = MultiplyDivide(netFractional, maxReserveRatio, weights[i]);
             if (bigDeltaRatio > INT64_MAX)
             {
                 failed = true;
                 break;
             }
-            deltaRatio = bigDeltaRatio.GetLow64();
+            deltaRatio = (uint64_t)bigDeltaRatio;
             fractionalOut.insert(std::make_pair(deltaRatio, std::make_pair(netFractional, currencies[i])));
         }
     }
@@ -2261,7 +2270,7 @@ std::vector<CAmount> CCurrencyState::ConvertAmounts(const std::vector<CAmount> &
         {
             // reverse the calculation from layer height to amount for this currency, based on currency weight
             int32_t weight = weights[reserveMap[it->second.second]];
-            CAmount curAmt = ((arith_uint256(layerHeight) * arith_uint256(weight) / bigMaxReserveRatio)).GetLow64();
+            CAmount curAmt = (uint64_t)MultiplyDivide(layerHeight, weight, maxReserveRatio);
             it->second.first -= curAmt;
 
             if (it->second.first < 0)
@@ -2287,13 +2296,13 @@ std::vector<CAmount> CCurrencyState::ConvertAmounts(const std::vector<CAmount> &
         for (auto it = outFIT; it != fractionalOut.end(); it++)
         {
             int32_t weight = weights[reserveMap[it->second.second]];
-            arith_uint256 bigCurAmt = ((arith_uint256(layerHeight) * arith_uint256(weight) / bigMaxReserveRatio));
+            unsigned __int128 bigCurAmt = MultiplyDivide(layerHeight, weight, maxReserveRatio);
             if (bigCurAmt > INT64_MAX)
             {
                 LogPrintf("%s: OVERFLOW in calculating changes in currency\n", __func__);
                 return initialRates;
             }
-            CAmount curAmt = bigCurAmt.GetLow64();
+            CAmount curAmt = (uint64_t)bigCurAmt;
             it->second.first -= curAmt;
             if (it->second.first < 0)
             {
@@ -2323,8 +2332,7 @@ std::vector<CAmount> CCurrencyState::ConvertAmounts(const std::vector<CAmount> &
         //
         // calculate a fractional buy at the total layer ratio for the amount specified
         // and divide the value according to the relative weight of each currency, adding to each entry of fractionalOutMap
-        arith_uint256 bigLayerWeight = arith_uint256(layer.first);
-        CAmount totalLayerReserves = ((bigSupply * bigLayerWeight) / bigSatoshi).GetLow64() + addNormalizedReserves;
+        CAmount totalLayerReserves = (uint64_t)MultiplyDivide(supply, layer.first, SATOSHIDEN) + addNormalizedReserves;
         addNormalizedReserves += layer.second.first;
         CAmount newSupply = CalculateFractionalOut(layer.second.first, supply + addSupply, totalLayerReserves, layer.first);
         if (newSupply < 0)
@@ -2332,12 +2340,11 @@ std::vector<CAmount> CCurrencyState::ConvertAmounts(const std::vector<CAmount> &
             LogPrintf("%s: currency supply OVERFLOW\n", __func__);
             return initialRates;
         }
-        arith_uint256 bigNewSupply(newSupply);
         addSupply += newSupply;
         for (auto &id : layer.second.second)
         {
             auto idIT = fractionalOutMap.find(id);
-            CAmount newSupplyForCurrency = ((bigNewSupply * weights[reserveMap[id]]) / bigLayerWeight).GetLow64();
+            CAmount newSupplyForCurrency = (uint64_t)MultiplyDivide(newSupply, (uint32_t)weights[reserveMap[id]], layer.first);
 
             // initialize or add to the new supply for this currency
             if (idIT == fractionalOutMap.end())
@@ -2377,11 +2384,9 @@ std::vector<CAmount> CCurrencyState::ConvertAmounts(const std::vector<CAmount> &
     for (auto &layer : fractionalLayersIn)
     {
         // first calculate sell before-buy, then after-buy
-        arith_uint256 bigLayerWeight(layer.first);
-
         // before-buy starting point
-        CAmount totalLayerReservesBB = ((bigSupply * bigLayerWeight) / bigSatoshi).GetLow64() + addNormalizedReservesBB;
-        CAmount totalLayerReservesAB = ((arith_uint256(supplyAfterBuy) * bigLayerWeight) / bigSatoshi).GetLow64() + addNormalizedReservesAB;
+        CAmount totalLayerReservesBB = (uint64_t)MultiplyDivide(supply, layer.first, SATOSHIDEN) + addNormalizedReservesBB;
+        CAmount totalLayerReservesAB = (uint64_t)MultiplyDivide(supplyAfterBuy, layer.first, SATOSHIDEN) + addNormalizedReservesAB;
 
         CAmount newNormalizedReserveBB = CalculateReserveOut(layer.second.first, supply + addSupply, totalLayerReservesBB + addNormalizedReservesBB, layer.first);
         CAmount newNormalizedReserveAB = CalculateReserveOut(layer.second.first, supplyAfterBuy + addSupply, totalLayerReservesAB + addNormalizedReservesAB, layer.first);
@@ -2394,8 +2399,8 @@ std::vector<CAmount> CCurrencyState::ConvertAmounts(const std::vector<CAmount> &
         for (auto &id : layer.second.second)
         {
             auto idIT = fractionalInMap.find(id);
-            CAmount newReservesForCurrencyBB = ((arith_uint256(newNormalizedReserveBB) * arith_uint256(weights[reserveMap[id]])) / bigLayerWeight).GetLow64();
-            CAmount newReservesForCurrencyAB = ((arith_uint256(newNormalizedReserveAB) * arith_uint256(weights[reserveMap[id]])) / bigLayerWeight).GetLow64();
+            CAmount newReservesForCurrencyBB = (uint64_t)MultiplyDivide(newNormalizedReserveBB, weights[reserveMap[id]], layer.first);
+            CAmount newReservesForCurrencyAB = (uint64_t)MultiplyDivide(newNormalizedReserveAB, weights[reserveMap[id]], layer.first);
 
             // initialize or add to the new supply for this currency
             if (idIT == fractionalInMap.end())
@@ -2452,11 +2457,9 @@ std::vector<CAmount> CCurrencyState::ConvertAmounts(const std::vector<CAmount> &
     // now calculate buy after sell
     for (auto &layer : fractionalLayersOut)
     {
-        arith_uint256 bigLayerWeight = arith_uint256(layer.first);
-        CAmount totalLayerReserves = ((arith_uint256(supplyAfterSell) * bigLayerWeight) / bigSatoshi).GetLow64() + addNormalizedReserves;
+        CAmount totalLayerReserves = (uint64_t)MultiplyDivide(supplyAfterSell, layer.first, SATOSHIDEN) + addNormalizedReserves;
         addNormalizedReserves += layer.second.first;
         CAmount newSupply = CalculateFractionalOut(layer.second.first, supplyAfterSell + addSupply, totalLayerReserves, layer.first);
-        arith_uint256 bigNewSupply(newSupply);
         addSupply += newSupply;
         for (auto &id : layer.second.second)
         {
@@ -2470,7 +2473,7 @@ std::vector<CAmount> CCurrencyState::ConvertAmounts(const std::vector<CAmount> &
                 return initialRates;
             }
 
-            idIT->second.second += ((bigNewSupply * weights[reserveMap[id]]) / bigLayerWeight).GetLow64();
+            idIT->second.second += (uint64_t)MultiplyDivide(newSupply, (uint32_t)weights[reserveMap[id]], layer.first);
         }
     }
 
@@ -2497,8 +2500,7 @@ std::vector<CAmount> CCurrencyState::ConvertAmounts(const std::vector<CAmount> &
 
         if (fractionalOutIT != fractionalOutMap.end())
         {
-            arith_uint256 bigFractionDelta(fractionalOutIT->second.first);
-            fractionDelta = ((bigFractionDelta + arith_uint256(fractionalOutIT->second.second)) >> 1).GetLow64();
+            fractionDelta = (uint64_t)(((unsigned __int128)(uint64_t)fractionalOutIT->second.first + (uint64_t)fractionalOutIT->second.second) >> 1);
 
             if (inputFraction + fractionDelta <= 0)
             {
@@ -2509,7 +2511,7 @@ std::vector<CAmount> CCurrencyState::ConvertAmounts(const std::vector<CAmount> &
             }
 
             fractionalSizes[i] += fractionDelta;
-            rates[i] = ((arith_uint256(inputReserve) * bigSatoshi) / arith_uint256(fractionalSizes[i])).GetLow64();
+            rates[i] = (uint64_t)MultiplyDivide(inputReserve, SATOSHIDEN, fractionalSizes[i]);
 
             // add the new reserve and supply to the currency
             newState.supply = newState.AddToSupply(fractionDelta);
@@ -2519,8 +2521,7 @@ std::vector<CAmount> CCurrencyState::ConvertAmounts(const std::vector<CAmount> &
         }
         else if (fractionalInIT != fractionalInMap.end())
         {
-            arith_uint256 bigReserveDelta(fractionalInIT->second.first);
-            CAmount adjustedReserveDelta = NativeToReserve(((bigReserveDelta + arith_uint256(fractionalInIT->second.second)) >> 1).GetLow64(), i, promoteExchangeRate);
+            CAmount adjustedReserveDelta = NativeToReserve((uint64_t)(((unsigned __int128)(uint64_t)fractionalInIT->second.first + (uint64_t)fractionalInIT->second.second) >> 1), i, promoteExchangeRate);
             reserveSizes[i] += adjustedReserveDelta;
 
             if (inputFraction <= 0)
@@ -2531,7 +2532,7 @@ std::vector<CAmount> CCurrencyState::ConvertAmounts(const std::vector<CAmount> &
                 return initialRates;
             }
 
-            rates[i] = ((arith_uint256(reserveSizes[i]) * bigSatoshi) / arith_uint256(inputFraction)).GetLow64();
+            rates[i] = (uint64_t)MultiplyDivide(reserveSizes[i], SATOSHIDEN, inputFraction);
 
             // subtract the fractional and reserve that has left the currency
             newState.supply = newState.AddToSupply(-inputFraction);
@@ -2830,7 +2831,7 @@ CReserveTransactionDescriptor::CReserveTransactionDescriptor(const CTransaction
     {
         COptCCParams p;
 
-        if (tx.vout[i].scriptPubKey.IsPayToCryptoCondition(p) && p.IsValid())
+        if (tx.IsPayToCryptoCondition(i, p) && p.IsValid())
         {
             switch (p.evalCode)
             {
@@ -2978,7 +2979,7 @@ CReserveTransactionDescriptor::CReserveTransactionDescriptor(const CTransaction
                         COptCCParams tempP;
                         for (int j = 0; j < tx.vout.size(); j++)
                         {
-                            if (tx.vout[j].scriptPubKey.IsPayToCryptoCondition(tempP) &&
+                            if (tx.IsPayToCryptoCondition(j, tempP) &&
                                 tempP.IsValid() &&
                                 tempP.evalCode == EVAL_CURRENCY_DEFINITION &&
                                 tempP.vData.size() &&
@@ -4187,7 +4188,9 @@ bool CReserveTransactionDescriptor::AddReserveTransferImportOutputs(const CCurre
                                                                     const uint256 &entropy,
                                                                     bool finalValidation)
 {
-    std::vector<CTxOut> vOldOutputs = vOutputs;
+    // outputs are only ever appended here, so if we need to start over, we truncate to the outputs we were passed
+    size_t nOldOutputs = vOutputs.size();
+    vOutputs.reserve(nOldOutputs + exportObjects.size() + importCurrencyDef.preAllocation.size() + 4);
 
     CReserveTransactionDescriptor checkPointThis = *this;
 
@@ -4225,6 +4228,27 @@ bool CReserveTransactionDescriptor::AddReserveTransferImportOutputs(const CCurre
 
     uint160 importCurrencyID = importCurrencyDef.GetID();
 
+    // currency definitions looked up for transfers are kept for the whole import, since most transfers in an
+    // import refer to the same few currencies, and each cache lookup returns a new copy of the definition
+    // currencies that are not found are looked up again each time, as they always were
+    std::map<uint160, CCurrencyDefinition> importCurrencyCache;
+    CCurrencyDefinition notFoundCurrency;
+    auto getCachedCurrency = [&importCurrencyCache, &notFoundCurrency](const uint160 &currencyID) -> const CCurrencyDefinition &
+    {
+        auto it = importCurrencyCache.find(currencyID);
+        if (it != importCurrencyCache.end())
+        {
+            return it->second;
+        }
+        CCurrencyDefinition currencyDef = ConnectedChains.GetCachedCurrency(currencyID);
+        if (!currencyDef.IsValid())
+        {
+            notFoundCurrency = currencyDef;
+            return notFoundCurrency;
+        }
+        return importCurrencyCache.insert(std::make_pair(currencyID, currencyDef)).first->second;
+    };
+
     // this matrix tracks n-way currency conversion
     // each entry contains the original amount of the row's (dim 0) currency to be converted to the currency position of its column
     int32_t numCurrencies = importCurrencyDef.currencies.size();
@@ -4340,12 +4364,11 @@ bool CReserveTransactionDescriptor::AddReserveTransferImportOutputs(const CCurre
         }
 
         //printf("currency transfer #%d:\n%s\n", i, curTransfer.ToUniValue().write(1,2).c_str());
-        CCurrencyDefinition _currencyDest;
         const CCurrencyDefinition &currencyDest = curTransfer.IsRefund() ?
-                                                    (_currencyDest = ConnectedChains.GetCachedCurrency(curTransfer.FirstCurrency())) :
+                                                    getCachedCurrency(curTransfer.FirstCurrency()) :
                                                     (importCurrencyID == curTransfer.destCurrencyID) ?
                                                     importCurrencyDef :
-                                                    (_currencyDest = ConnectedChains.GetCachedCurrency(curTransfer.destCurrencyID));
+                                                    getCachedCurrency(curTransfer.destCurrencyID);
 
         if (!currencyDest.IsValid())
         {
@@ -4865,7 +4888,7 @@ bool CReserveTransactionDescriptor::AddReserveTransferImportOutputs(const CCurre
                     }
 
                     // convert fees to next destination native, if necessary/possible
-                    CCurrencyDefinition curNextDest = ConnectedChains.GetCachedCurrency(curTransfer.destination.gatewayID);
+                    const CCurrencyDefinition &curNextDest = getCachedCurrency(curTransfer.destination.gatewayID);
                     uint160 nextDestSysID = curNextDest.IsGateway() ? curNextDest.gatewayID : curNextDest.systemID;
 
                     // if it's already in the correct currency, nothing to do, otherwise convert if we can
@@ -5337,7 +5360,7 @@ bool CReserveTransactionDescriptor::AddReserveTransferImportOutputs(const CCurre
                                     currencyDest.IsFractional() &&
                                     currencyIndexMap.count(curTransfer.FirstCurrency());
 
-                CCurrencyDefinition sourceCurrency = ConnectedChains.GetCachedCurrency(curTransfer.FirstCurrency());
+                const CCurrencyDefinition &sourceCurrency = getCachedCurrency(curTransfer.FirstCurrency());
 
                 if (!sourceCurrency.IsValid())
                 {
@@ -5508,7 +5531,7 @@ bool CReserveTransactionDescriptor::AddReserveTransferImportOutputs(const CCurre
                          (!isFractional || curTransfer.IsBurnChangeWeight() || !importCurrencyDef.GetCurrenciesMap().count(curTransfer.FirstCurrency()))) ||
                          !(isFractional || importCurrencyDef.IsToken()))
                     {
-                        CCurrencyDefinition sourceCurrency = ConnectedChains.GetCachedCurrency(curTransfer.FirstCurrency());
+                        const CCurrencyDefinition &sourceCurrency = getCachedCurrency(curTransfer.FirstCurrency());
                         printf("%s: Attempting to burn %s, which is either not a token or fractional currency or not the import currency %s\n", __func__, sourceCurrency.name.c_str(), importCurrencyDef.name.c_str());
                         LogPrintf("%s: Attempting to burn %s, which is either not a token or fractional currency or not the import currency %s\n", __func__, sourceCurrency.name.c_str(), importCurrencyDef.name.c_str());
                         return false;
@@ -5817,7 +5840,8 @@ bool CReserveTransactionDescriptor::AddReserveTransferImportOutputs(const CCurre
                 {
                     // unless all conversions are already refunded, refund them all and try again
                     std::vector<CReserveTransfer> refundedExports;
-                    for (auto oneTransfer : exportObjects)
+                    refundedExports.reserve(exportObjects.size());
+                    for (auto &oneTransfer : exportObjects)
                     {
                         if (oneTransfer.IsRefund())
                         {
@@ -5829,7 +5853,7 @@ bool CReserveTransactionDescriptor::AddReserveTransferImportOutputs(const CCurre
                         }
                     }
                     // reset vOutputs to what they were before processing and recurse once
-                    vOutputs = vOldOutputs;
+                    vOutputs.resize(nOldOutputs);
                     importedCurrency.valueMap.clear();
                     gatewayDepositsIn.valueMap.clear();
                     spentCurrencyOut.valueMap.clear();
@@ -6348,7 +6372,7 @@ bool CReserveTransactionDescriptor::AddReserveTransferImportOutputs(const CCurre
             recursiveCurrencyState.SetRefunding(true);
 
             // reset vOutputs to what they were before processing and recurse once
-            vOutputs = vOldOutputs;
+            vOutputs.resize(nOldOutputs);
             importedCurrency.valueMap.clear();
             gatewayDepositsIn.valueMap.clear();
             spentCurrencyOut.valueMap.clear();
@@ -6373,7 +6397,8 @@ bool CReserveTransactionDescriptor::AddReserveTransferImportOutputs(const CCurre
             // unless all conversions are already refunded, refund them all and try again
             bool notRefund = false;
             std::vector<CReserveTransfer> refundedExports;
-            for (auto oneTransfer : exportObjects)
+            refundedExports.reserve(exportObjects.size());
+            for (auto &oneTransfer : exportObjects)
             {
                 if (oneTransfer.IsRefund())
                 {
@@ -6388,7 +6413,7 @@ bool CReserveTransactionDescriptor::AddReserveTransferImportOutputs(const CCurre
             if (notRefund)
             {
                 // reset vOutputs to what they were before processing and recurse once
-                vOutputs = vOldOutputs;
+                vOutputs.resize(nOldOutputs);
                 importedCurrency.valueMap.clear();
                 gatewayDepositsIn.valueMap.clear();
                 spentCurrencyOut.valueMap.clear();
@@ -7420,7 +7445,7 @@ bool PrecheckReserveDeposit(const CTransaction &tx, int32_t outNum, CValidationS
     // do a basic sanity check that this reserve transfer's values are consistent
     COptCCParams p;
     CReserveDeposit rd;
-    if (tx.vout[outNum].scriptPubKey.IsPayToCryptoCondition(p) &&
+    if (tx.IsPayToCryptoCondition(outNum, p) &&
         p.IsValid() &&
         p.evalCode == EVAL_RESERVE_DEPOSIT &&
         p.vData.size() &&
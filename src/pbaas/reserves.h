@@ -1209,6 +1209,11 @@ public:
     }
 };
 
+// supply created by buying with NormalizedReserveIn, and reserve released by selling FractionalIn, of a fractional layer
+// with the combined reserve ratio reserveRatio
+CAmount CalculateFractionalOut(CAmount NormalizedReserveIn, CAmount Supply, CAmount NormalizedReserve, int32_t reserveRatio);
+CAmount CalculateReserveOut(CAmount FractionalIn, CAmount Supply, CAmount NormalizedReserve, int32_t reserveRatio);
+
 class CCurrencyState
 {
 public:
@@ -1318,6 +1323,17 @@ public:
         return cpp_dec_float_50(std::to_string(weights[reserveIndex])) / cpp_dec_float_50("100000000");
     }
 
+    // exact equivalent of (arith_uint256(a) * arith_uint256(b)) / arith_uint256(c) for the 64 bit operands of conversion
+    // calculations, whose products always fit in 128 bits, including throwing on division by zero
+    static unsigned __int128 MultiplyDivide(uint64_t a, uint64_t b, uint64_t c)
+    {
+        if (!c)
+        {
+            throw uint_error("Division by zero");
+        }
+        return ((unsigned __int128)a * b) / c;
+    }
+
     template<typename cpp_dec_float_type>
     static bool to_int64(const cpp_dec_float_type &input, int64_t &outval)
     {
@@ -193,6 +193,31 @@ void FromVector(const std::vector<unsigned char> &vch, SERIALIZABLE &obj, bool *
     }
 }
 
+// reads an object in place from a byte range, without copying the bytes into a stream first. objects that serialize
+// through templates that also write to the stream when reading, such as chain objects, still need FromVector
+template <typename SERIALIZABLE>
+void FromSpan(const unsigned char *pBegin, const unsigned char *pEnd, SERIALIZABLE &obj, bool *pSuccess=nullptr)
+{
+    CSpanReader s(pBegin, pEnd, SER_NETWORK, PROTOCOL_VERSION);
+    if (pSuccess)
+    {
+        *pSuccess = false;
+    }
+    try
+    {
+        s >> obj;
+        if (pSuccess)
+        {
+            *pSuccess = true;
+        }
+    }
+    catch(const std::exception& e)
+    {
+        //printf("%s\n", e.what());
+        LogPrint("serialization", "%s\n", e.what());
+    }
+}
+
 class CVDXF
 {
 public:
@@ -250,6 +275,101 @@ public:
     UniValue ToUniValue() const;
 };
 
+// non-owning view of one serialized, VDXF tagged object, which is a key, a version, a length, and the object itself.
+// only the header is decoded. the payload stays in the caller's buffer until it is decoded on request, so callers that
+// only need the key or version of large content do not copy it. the buffer must outlive the view.
+class CVDXFObjectView
+{
+public:
+    enum ESizeEncoding
+    {
+        SIZE_VARINT = 0,            // tagged objects in content multimaps and structured data, VARINT length
+        SIZE_COMPACTSIZE = 1        // CVDXF_Data and CVDXFDataRef, which serialize their payload as a vector
+    };
+
+    uint160 key;
+    uint32_t version;
+    const unsigned char *pPayload;
+    size_t payloadSize;
+
+    CVDXFObjectView() : version(CVDXF::VERSION_INVALID), pPayload(nullptr), payloadSize(0) {}
+
+    CVDXFObjectView(const unsigned char *pBegin, const unsigned char *pEnd, ESizeEncoding sizeEncoding=SIZE_VARINT) :
+        version(CVDXF::VERSION_INVALID), pPayload(nullptr), payloadSize(0)
+    {
+        CSpanReader s(pBegin, pEnd, SER_DISK, PROTOCOL_VERSION);
+        try
+        {
+            uint64_t objSize;
+            s >> key;
+            s >> VARINT(version);
+            if (sizeEncoding == SIZE_COMPACTSIZE)
+            {
+                objSize = ReadCompactSize(s);
+            }
+            else
+            {
+                s >> VARINT(objSize);
+            }
+            if (objSize <= s.size())
+            {
+                pPayload = s.cur();
+                payloadSize = objSize;
+            }
+        }
+        catch(const std::exception& e)
+        {
+            LogPrint("serialization", "%s\n", e.what());
+        }
+    }
+
+    CVDXFObjectView(const std::vector<unsigned char> &vch, ESizeEncoding sizeEncoding=SIZE_VARINT) :
+        CVDXFObjectView(vch.data(), vch.data() + vch.size(), sizeEncoding) {}
+
+    bool IsValid() const
+    {
+        return pPayload != nullptr && !key.IsNull() && version >= CVDXF::FIRST_VERSION && version <= CVDXF::LAST_VERSION;
+    }
+
+    // first byte after this object, where a following object in the same buffer would start
+    const unsigned char *end() const
+    {
+        return pPayload + payloadSize;
+    }
+
+    // decodes the payload in place as a specific object type
+    template <typename SERIALIZABLE>
+    bool GetObject(SERIALIZABLE &obj) const
+    {
+        if (!IsValid())
+        {
+            return false;
+        }
+        CSpanReader s(pPayload, pPayload + payloadSize, SER_DISK, PROTOCOL_VERSION);
+        try
+        {
+            s >> obj;
+        }
+        catch(const std::exception& e)
+        {
+            LogPrint("serialization", "%s\n", e.what());
+            return false;
+        }
+        return true;
+    }
+
+    // view of a tagged object nested at the start of this object's payload, decoded only when requested
+    CVDXFObjectView GetNested(ESizeEncoding sizeEncoding=SIZE_VARINT) const
+    {
+        return IsValid() ? CVDXFObjectView(pPayload, pPayload + payloadSize, sizeEncoding) : CVDXFObjectView();
+    }
+
+    std::vector<unsigned char> GetPayload() const
+    {
+        return IsValid() ? std::vector<unsigned char>(pPayload, pPayload + payloadSize) : std::vector<unsigned char>();
+    }
+};
+
 // VDXF data that describes an encrypted chunk of data
 class CVDXF_Data : public CVDXF
 {
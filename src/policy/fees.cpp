@@ -23,32 +23,39 @@ void TxConfirmStats::Initialize(std::vector<double>& defaultBuckets,
     }
 
     confAvg.resize(maxConfirms);
-    curBlockConf.resize(maxConfirms);
     unconfTxs.resize(maxConfirms);
     for (unsigned int i = 0; i < maxConfirms; i++) {
         confAvg[i].resize(buckets.size());
-        curBlockConf[i].resize(buckets.size());
         unconfTxs[i].resize(buckets.size());
     }
 
     oldUnconfTxs.resize(buckets.size());
-    curBlockTxCt.resize(buckets.size());
     txCtAvg.resize(buckets.size());
-    curBlockVal.resize(buckets.size());
     avg.resize(buckets.size());
+    scale = 1;
 }
 
-// Zero out the data for the current block
+// Start the current block, which decays all moving averages by growing their scale
 void TxConfirmStats::ClearCurrent(unsigned int nBlockHeight)
 {
     for (unsigned int j = 0; j < buckets.size(); j++) {
         oldUnconfTxs[j] += unconfTxs[nBlockHeight%unconfTxs.size()][j];
         unconfTxs[nBlockHeight%unconfTxs.size()][j] = 0;
-        for (unsigned int i = 0; i < curBlockConf.size(); i++)
-            curBlockConf[i][j] = 0;
-        curBlockTxCt[j] = 0;
-        curBlockVal[j] = 0;
     }
+    scale /= decay;
+}
+
+void TxConfirmStats::Normalize()
+{
+    if (scale == 1)
+        return;
+    for (unsigned int j = 0; j < buckets.size(); j++) {
+        for (unsigned int i = 0; i < confAvg.size(); i++)
+            confAvg[i][j] /= scale;
+        avg[j] /= scale;
+        txCtAvg[j] /= scale;
+    }
+    scale = 1;
 }
 
 unsigned int TxConfirmStats::FindBucketIndex(double val)
@@ -70,21 +77,18 @@ void TxConfirmStats::Record(int blocksToConfirm, double val)
     if (blocksToConfirm < 1)
         return;
     unsigned int bucketindex = FindBucketIndex(val);
-    for (size_t i = blocksToConfirm; i <= curBlockConf.size(); i++) {
-        curBlockConf[i - 1][bucketindex]++;
+    for (size_t i = blocksToConfirm; i <= confAvg.size(); i++) {
+        confAvg[i - 1][bucketindex] += scale;
     }
-    curBlockTxCt[bucketindex]++;
-    curBlockVal[bucketindex] += val;
+    txCtAvg[bucketindex] += scale;
+    avg[bucketindex] += val * scale;
 }
 
 void TxConfirmStats::UpdateMovingAverages()
 {
-    for (unsigned int j = 0; j < buckets.size(); j++) {
-        for (unsigned int i = 0; i < confAvg.size(); i++)
-            confAvg[i][j] = confAvg[i][j] * decay + curBlockConf[i][j];
-        avg[j] = avg[j] * decay + curBlockVal[j];
-        txCtAvg[j] = txCtAvg[j] * decay + curBlockTxCt[j];
-    }
+    // with the default decay this rescales about every 35000 blocks, well before precision suffers
+    if (scale > 1e30)
+        Normalize();
 }
 
 // returns -1 on error conditions
@@ -122,8 +126,8 @@ double TxConfirmStats::EstimateMedianVal(int confTarget, double sufficientTxVal,
     // Start counting from highest(default) or lowest fee/pri transactions
     for (int bucket = startbucket; bucket >= 0 && bucket <= maxbucketindex; bucket += step) {
         curFarBucket = bucket;
-        nConf += confAvg[confTarget - 1][bucket];
-        totalNum += txCtAvg[bucket];
+        nConf += confAvg[confTarget - 1][bucket] / scale;
+        totalNum += txCtAvg[bucket] / scale;
         for (unsigned int confct = confTarget; confct < GetMaxConfirms(); confct++)
             extraNum += unconfTxs[(nBlockHeight - confct)%bins][bucket];
         extraNum += oldUnconfTxs[bucket];
@@ -188,6 +192,7 @@ double TxConfirmStats::EstimateMedianVal(int confTarget, double sufficientTxVal,
 
 void TxConfirmStats::Write(CAutoFile& fileout)
 {
+    Normalize();
     fileout << decay;
     fileout << buckets;
     fileout << avg;
@@ -234,17 +239,11 @@ void TxConfirmStats::Read(CAutoFile& filein)
     avg = fileAvg;
     confAvg = fileConfAvg;
     txCtAvg = fileTxCtAvg;
+    scale = 1;
     bucketMap.clear();
 
-    // Resize the current block variables which aren't stored in the data file
+    // Resize the mempool counts which aren't stored in the data file
     // to match the number of confirms and buckets
-    curBlockConf.resize(maxConfirms);
-    for (unsigned int i = 0; i < maxConfirms; i++) {
-        curBlockConf[i].resize(buckets.size());
-    }
-    curBlockTxCt.resize(buckets.size());
-    curBlockVal.resize(buckets.size());
-
     unconfTxs.resize(maxConfirms);
     for (unsigned int i = 0; i < maxConfirms; i++) {
         unconfTxs[i].resize(buckets.size());
@@ -295,6 +294,18 @@ void TxConfirmStats::removeTx(unsigned int entryHeight, unsigned int nBestSeenHe
     }
 }
 
+void TxConfirmStats::RestoreTx(unsigned int entryHeight, unsigned int nBestSeenHeight, unsigned int bucketindex)
+{
+    // the same slot removeTx will take it from
+    int blocksAgo = nBestSeenHeight == 0 ? 0 : (int)nBestSeenHeight - (int)entryHeight;
+    if (blocksAgo < 0)
+        return;
+    if (blocksAgo >= (int)unconfTxs.size())
+        oldUnconfTxs[bucketindex]++;
+    else
+        unconfTxs[entryHeight % unconfTxs.size()][bucketindex]++;
+}
+
 void CBlockPolicyEstimator::removeTx(uint256 hash)
 {
     std::map<uint256, TxStatsInfo>::iterator pos = mapMemPoolTxs.find(hash);
@@ -309,18 +320,43 @@ void CBlockPolicyEstimator::removeTx(uint256 hash)
 
     if (stats != NULL)
         stats->removeTx(entryHeight, nBestSeenHeight, bucketIndex);
+    for (auto &reserveBucket : pos->second.reserveBuckets)
+        GetReserveFeeStats(reserveBucket.first).removeTx(entryHeight, nBestSeenHeight, reserveBucket.second);
     mapMemPoolTxs.erase(hash);
 }
 
+void CBlockPolicyEstimator::removeUnknownTxs(const std::vector<uint256>& vMempoolHashes)
+{
+    std::set<uint256> mempoolHashes(vMempoolHashes.begin(), vMempoolHashes.end());
+    std::vector<uint256> unknown;
+    for (auto &tracked : mapMemPoolTxs) {
+        if (!mempoolHashes.count(tracked.first))
+            unknown.push_back(tracked.first);
+    }
+    for (auto &hash : unknown)
+        removeTx(hash);
+    if (unknown.size())
+        LogPrint("estimatefee", "Blockpolicy stopped tracking %u restored transactions no longer in the mempool\n", unknown.size());
+}
+
+TxConfirmStats &CBlockPolicyEstimator::GetReserveFeeStats(const uint160& currencyID)
+{
+    auto it = reserveFeeStats.find(currencyID);
+    if (it == reserveFeeStats.end()) {
+        it = reserveFeeStats.insert(std::make_pair(currencyID, TxConfirmStats())).first;
+        it->second.Initialize(vFeeBuckets, MAX_BLOCK_CONFIRMS, DEFAULT_DECAY, "ReserveFeeRate");
+    }
+    return it->second;
+}
+
 CBlockPolicyEstimator::CBlockPolicyEstimator(const CFeeRate& _minRelayFee)
     : nBestSeenHeight(0)
 {
     minTrackedFee = _minRelayFee < CFeeRate(MIN_FEERATE) ? CFeeRate(MIN_FEERATE) : _minRelayFee;
-    std::vector<double> vfeelist;
     for (double bucketBoundary = minTrackedFee.GetFeePerK(); bucketBoundary <= MAX_FEERATE; bucketBoundary *= FEE_SPACING) {
-        vfeelist.push_back(bucketBoundary);
+        vFeeBuckets.push_back(bucketBoundary);
     }
-    feeStats.Initialize(vfeelist, MAX_BLOCK_CONFIRMS, DEFAULT_DECAY, "FeeRate");
+    feeStats.Initialize(vFeeBuckets, MAX_BLOCK_CONFIRMS, DEFAULT_DECAY, "FeeRate");
 
     minTrackedPriority = AllowFreeThreshold() < MIN_PRIORITY ? MIN_PRIORITY : AllowFreeThreshold();
     std::vector<double> vprilist;
@@ -407,7 +443,24 @@ void CBlockPolicyEstimator::processTransaction(const CTxMemPoolEntry& entry, boo
     LogPrint("estimatefee", "\n");
 }
 
-void CBlockPolicyEstimator::processBlockTx(unsigned int nBlockHeight, const CTxMemPoolEntry& entry)
+void CBlockPolicyEstimator::processReserveTransaction(const uint256& hash, const std::map<uint160, CAmount>& reserveFees, size_t nTxSize)
+{
+    // only transactions processTransaction accepted as data points have their entry height set
+    std::map<uint256, TxStatsInfo>::iterator pos = mapMemPoolTxs.find(hash);
+    if (pos == mapMemPoolTxs.end() || pos->second.blockHeight == 0 || !pos->second.reserveBuckets.empty())
+        return;
+
+    for (auto &oneFee : reserveFees) {
+        if (oneFee.second <= 0)
+            continue;
+        CFeeRate feeRate(oneFee.second, nTxSize);
+        unsigned int bucketIndex = GetReserveFeeStats(oneFee.first).NewTx(pos->second.blockHeight, (double)feeRate.GetFeePerK());
+        pos->second.reserveBuckets.push_back(std::make_pair(oneFee.first, bucketIndex));
+    }
+}
+
+void CBlockPolicyEstimator::processBlockTx(unsigned int nBlockHeight, const CTxMemPoolEntry& entry,
+                                           const std::map<uint160, CAmount>& reserveFees)
 {
     if (!entry.WasClearAtEntry()) {
         // This transaction depended on other transactions in the mempool to
@@ -442,10 +495,17 @@ void CBlockPolicyEstimator::processBlockTx(unsigned int nBlockHeight, const CTxM
     else if (isFeeDataPoint(feeRate, curPri)) {
         feeStats.Record(blocksToConfirm, (double)feeRate.GetFeePerK());
     }
+
+    // fees paid in reserve currencies are estimated on their own, whatever the native fee was
+    for (auto &oneFee : reserveFees) {
+        if (oneFee.second > 0)
+            GetReserveFeeStats(oneFee.first).Record(blocksToConfirm, (double)CFeeRate(oneFee.second, entry.GetTxSize()).GetFeePerK());
+    }
 }
 
 void CBlockPolicyEstimator::processBlock(unsigned int nBlockHeight,
-                                         std::vector<CTxMemPoolEntry>& entries, bool fCurrentEstimate)
+                                         std::vector<CTxMemPoolEntry>& entries,
+                                         const std::vector<std::map<uint160, CAmount>>& reserveFees, bool fCurrentEstimate)
 {
     if (nBlockHeight <= nBestSeenHeight) {
         // Ignore side chains and re-orgs; assuming they are random
@@ -486,17 +546,21 @@ void CBlockPolicyEstimator::processBlock(unsigned int nBlockHeight,
     else
         feeUnlikely = CFeeRate(feeUnlikelyEst);
 
-    // Clear the current block states
+    // Start the current block states
     feeStats.ClearCurrent(nBlockHeight);
     priStats.ClearCurrent(nBlockHeight);
+    for (auto &oneStats : reserveFeeStats)
+        oneStats.second.ClearCurrent(nBlockHeight);
 
-    // Repopulate the current block states
+    // Record the transactions of this block
+    static const std::map<uint160, CAmount> noReserveFees;
     for (unsigned int i = 0; i < entries.size(); i++)
-        processBlockTx(nBlockHeight, entries[i]);
+        processBlockTx(nBlockHeight, entries[i], i < reserveFees.size() ? reserveFees[i] : noReserveFees);
 
-    // Update all exponential averages with the current block states
     feeStats.UpdateMovingAverages();
     priStats.UpdateMovingAverages();
+    for (auto &oneStats : reserveFeeStats)
+        oneStats.second.UpdateMovingAverages();
 
     LogPrint("estimatefee", "Blockpolicy after updating estimates for %u confirmed entries, new mempool map size %u\n",
              entries.size(), mapMemPoolTxs.size());
@@ -516,6 +580,20 @@ CFeeRate CBlockPolicyEstimator::estimateFee(int confTarget)
     return CFeeRate(median);
 }
 
+CFeeRate CBlockPolicyEstimator::estimateReserveFee(const uint160& currencyID, int confTarget)
+{
+    auto it = reserveFeeStats.find(currencyID);
+    if (it == reserveFeeStats.end() || confTarget <= 0 || (unsigned int)confTarget > it->second.GetMaxConfirms())
+        return CFeeRate(0);
+
+    double median = it->second.EstimateMedianVal(confTarget, SUFFICIENT_FEETXS, MIN_SUCCESS_PCT, true, nBestSeenHeight);
+
+    if (median < 0)
+        return CFeeRate(0);
+
+    return CFeeRate(median);
+}
+
 double CBlockPolicyEstimator::estimatePriority(int confTarget)
 {
     // Return failure if trying to analyze a target we're not tracking
@@ -530,6 +608,21 @@ void CBlockPolicyEstimator::Write(CAutoFile& fileout)
     fileout << nBestSeenHeight;
     feeStats.Write(fileout);
     priStats.Write(fileout);
+
+    // appended to the original format, which older versions stop reading before
+    fileout << (uint64_t)reserveFeeStats.size();
+    for (auto &oneStats : reserveFeeStats) {
+        fileout << oneStats.first;
+        oneStats.second.Write(fileout);
+    }
+
+    // the mempool transactions being tracked, so that a mempool saved at shutdown is still counted from the
+    // height its transactions first arrived at
+    fileout << (uint64_t)mapMemPoolTxs.size();
+    for (auto &tracked : mapMemPoolTxs) {
+        uint8_t statsType = tracked.second.stats == &feeStats ? 1 : tracked.second.stats == &priStats ? 2 : 0;
+        fileout << tracked.first << statsType << tracked.second.blockHeight << tracked.second.bucketIndex << tracked.second.reserveBuckets;
+    }
 }
 
 void CBlockPolicyEstimator::Read(CAutoFile& filein)
@@ -539,4 +632,48 @@ void CBlockPolicyEstimator::Read(CAutoFile& filein)
     feeStats.Read(filein);
     priStats.Read(filein);
     nBestSeenHeight = nFileBestSeenHeight;
+
+    // files written before reserve currency estimates end here
+    std::map<uint160, TxConfirmStats> fileReserveFeeStats;
+    std::map<uint256, TxStatsInfo> fileMemPoolTxs;
+    try {
+        uint64_t nCount;
+        filein >> nCount;
+        for (uint64_t i = 0; i < nCount; i++) {
+            uint160 currencyID;
+            filein >> currencyID;
+            fileReserveFeeStats[currencyID].Read(filein);
+        }
+
+        filein >> nCount;
+        for (uint64_t i = 0; i < nCount; i++) {
+            uint256 hash;
+            uint8_t statsType;
+            TxStatsInfo info;
+            filein >> hash >> statsType >> info.blockHeight >> info.bucketIndex >> info.reserveBuckets;
+            info.stats = statsType == 1 ? &feeStats : statsType == 2 ? &priStats : NULL;
+            if (info.stats && info.bucketIndex >= info.stats->GetBucketCount())
+                throw std::runtime_error("Corrupt estimates file. Mempool transaction bucket out of range");
+            for (auto &reserveBucket : info.reserveBuckets) {
+                auto it = fileReserveFeeStats.find(reserveBucket.first);
+                if (it == fileReserveFeeStats.end() || reserveBucket.second >= it->second.GetBucketCount())
+                    throw std::runtime_error("Corrupt estimates file. Mempool transaction reserve bucket out of range");
+            }
+            fileMemPoolTxs[hash] = info;
+        }
+    } catch (const std::ios_base::failure&) {
+        LogPrint("estimatefee", "Reading estimates: no reserve currency or mempool data\n");
+        return;
+    }
+
+    reserveFeeStats = fileReserveFeeStats;
+    mapMemPoolTxs = fileMemPoolTxs;
+    for (auto &tracked : mapMemPoolTxs) {
+        if (tracked.second.stats != NULL)
+            tracked.second.stats->RestoreTx(tracked.second.blockHeight, nBestSeenHeight, tracked.second.bucketIndex);
+        for (auto &reserveBucket : tracked.second.reserveBuckets)
+            reserveFeeStats[reserveBucket.first].RestoreTx(tracked.second.blockHeight, nBestSeenHeight, reserveBucket.second);
+    }
+    LogPrint("estimatefee", "Reading estimates: %u reserve currencies, %u mempool transactions tracked\n",
+             reserveFeeStats.size(), mapMemPoolTxs.size());
 }
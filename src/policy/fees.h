@@ -64,6 +64,12 @@ class CTxMemPoolEntry;
  * the number of transactions we've seen in that fee bucket when calculating
  * an estimate for any number of confirmations below the number of blocks
  * they've been outstanding.
+ *
+ * The moving averages are kept multiplied by a scale that grows by 1/decay
+ * every block, so a new block only adds its own transactions rather than
+ * decaying every counter, and the values are only rescaled when that scale
+ * grows large.  Transactions paying fees in reserve currencies are tracked the
+ * same way, with one set of fee rate buckets per currency.
  */
 
 /** Decay of .998 is a half-life of 346 blocks or about 2.4 days */
@@ -91,20 +97,14 @@ private:
     // Count the total # of txs in each bucket
     // Track the historical moving average of this total over blocks
     std::vector<double> txCtAvg;
-    // and calcuate the total for the current block to update the moving average
-    std::vector<int> curBlockTxCt;
 
     // Count the total # of txs confirmed within Y blocks in each bucket
     // Track the historical moving average of theses totals over blocks
     std::vector<std::vector<double> > confAvg; // confAvg[Y][X]
-    // and calcuate the totals for the current block to update the moving averages
-    std::vector<std::vector<int> > curBlockConf; // curBlockConf[Y][X]
 
     // Sum the total priority/fee of all txs in each bucket
     // Track the historical moving average of this total over blocks
     std::vector<double> avg;
-    // and calculate the total for the current block to update the moving average
-    std::vector<double> curBlockVal;
 
     // Combine the conf counts with tx counts to calculate the confirmation % for each Y,X
     // Combine the total value with the tx counts to calculate the avg fee/priority per bucket
@@ -112,6 +112,13 @@ private:
     std::string dataTypeString;
     double decay = DEFAULT_DECAY;
 
+    // txCtAvg, confAvg and avg hold the moving averages multiplied by scale. each block divides scale by decay
+    // instead of multiplying every average by it, and transactions of the block are recorded with weight scale
+    double scale = 1;
+
+    /** Divide the averages by scale and reset it to 1 */
+    void Normalize();
+
     // Mempool counts of outstanding transactions
     // For each bucket X, track the number of transactions in the mempool
     // that are unconfirmed for each possible confirmation value Y
@@ -132,11 +139,11 @@ public:
      */
     void Initialize(std::vector<double>& defaultBuckets, unsigned int maxConfirms, double decay, std::string dataTypeString);
 
-    /** Clear the state of the curBlock variables to start counting for the new block */
+    /** Start counting for a new block, the averages decay by one block */
     void ClearCurrent(unsigned int nBlockHeight);
 
     /**
-     * Record a new transaction data point in the current block stats
+     * Record a new transaction data point in the moving averages of the current block
      * @param blocksToConfirm the number of blocks it took this transaction to confirm
      * @param val either the fee or the priority when entered of the transaction
      * @warning blocksToConfirm is 1-based and has to be >= 1
@@ -150,8 +157,11 @@ public:
     void removeTx(unsigned int entryHeight, unsigned int nBestSeenHeight,
                   unsigned int bucketIndex);
 
-    /** Update our estimates by decaying our historical moving average and updating
-        with the data gathered from the current block */
+    /** Count a mempool transaction restored from the estimates file as outstanding again */
+    void RestoreTx(unsigned int entryHeight, unsigned int nBestSeenHeight,
+                   unsigned int bucketIndex);
+
+    /** Finish the current block, rescaling the moving averages if the scale has grown too large */
     void UpdateMovingAverages();
 
     /**
@@ -171,6 +181,9 @@ public:
     /** Return the max number of confirms we're tracking */
     unsigned int GetMaxConfirms() { return confAvg.size(); }
 
+    /** Return the number of buckets, including the implicit last one */
+    unsigned int GetBucketCount() { return buckets.size(); }
+
     /** Write state of estimation data to a file*/
     void Write(CAutoFile& fileout);
 
@@ -224,16 +237,25 @@ public:
     /** Create new BlockPolicyEstimator and initialize stats tracking classes with default values */
     CBlockPolicyEstimator(const CFeeRate& minRelayFee);
 
-    /** Process all the transactions that have been included in a block */
+    /** Process all the transactions that have been included in a block, reserveFees holds the fees each
+        entry paid in reserve currencies */
     void processBlock(unsigned int nBlockHeight,
-                      std::vector<CTxMemPoolEntry>& entries, bool fCurrentEstimate);
+                      std::vector<CTxMemPoolEntry>& entries,
+                      const std::vector<std::map<uint160, CAmount>>& reserveFees, bool fCurrentEstimate);
 
     /** Process a transaction confirmed in a block*/
-    void processBlockTx(unsigned int nBlockHeight, const CTxMemPoolEntry& entry);
+    void processBlockTx(unsigned int nBlockHeight, const CTxMemPoolEntry& entry,
+                        const std::map<uint160, CAmount>& reserveFees);
 
     /** Process a transaction accepted to the mempool*/
     void processTransaction(const CTxMemPoolEntry& entry, bool fCurrentEstimate);
 
+    /** Track the reserve currency fees of a mempool transaction already passed to processTransaction */
+    void processReserveTransaction(const uint256& hash, const std::map<uint160, CAmount>& reserveFees, size_t nTxSize);
+
+    /** Stop tracking transactions restored from the estimates file that did not return to the mempool */
+    void removeUnknownTxs(const std::vector<uint256>& vMempoolHashes);
+
     /** Remove a transaction from the mempool tracking stats*/
     void removeTx(uint256 hash);
 
@@ -246,6 +268,9 @@ public:
     /** Return a fee estimate */
     CFeeRate estimateFee(int confTarget);
 
+    /** Return a fee estimate for fees paid in a reserve currency, in that currency */
+    CFeeRate estimateReserveFee(const uint160& currencyID, int confTarget);
+
     /** Return a priority estimate */
     double estimatePriority(int confTarget);
 
@@ -264,6 +289,7 @@ private:
         TxConfirmStats *stats;
         unsigned int blockHeight;
         unsigned int bucketIndex;
+        std::vector<std::pair<uint160, unsigned int>> reserveBuckets; // currency and bucket of each reserve fee
         TxStatsInfo() : stats(NULL), blockHeight(0), bucketIndex(0) {}
     };
 
@@ -273,6 +299,12 @@ private:
     /** Classes to track historical data on transaction confirmations */
     TxConfirmStats feeStats, priStats;
 
+    /** Fee rate buckets, also used for each reserve currency */
+    std::vector<double> vFeeBuckets;
+    /** Historical data on transactions paying fees in each reserve currency */
+    std::map<uint160, TxConfirmStats> reserveFeeStats;
+    TxConfirmStats &GetReserveFeeStats(const uint160& currencyID);
+
     /** Breakpoints to help determine whether a transaction was confirmed by priority or Fee */
     CFeeRate feeLikely, feeUnlikely;
     double priLikely, priUnlikely;
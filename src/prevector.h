@@ -252,6 +252,15 @@ public:
         }
     }
 
+    prevector(prevector<N, T, Size, Diff>&& other) noexcept : _size(0) {
+        swap(other);
+    }
+
+    prevector& operator=(prevector<N, T, Size, Diff>&& other) noexcept {
+        swap(other);
+        return *this;
+    }
+
     prevector& operator=(const prevector<N, T, Size, Diff>& other) {
         if (&other == this) {
             return *this;
@@ -419,7 +428,7 @@ public:
         return *item_ptr(size() - 1);
     }
 
-    void swap(prevector<N, T, Size, Diff>& other) {
+    void swap(prevector<N, T, Size, Diff>& other) noexcept {
         if (_size & other._size & 1) {
             std::swap(_union.capacity, other._union.capacity);
             std::swap(_union.indirect, other._union.indirect);
@@ -10,6 +10,10 @@
 #include "utilstrencodings.h"
 #include "crypto/common.h"
 #include "mmr.h"
+#include "lrucache.h"
+
+#include <atomic>
+#include <boost/thread.hpp>
 
 extern uint32_t ASSETCHAINS_ALGO, ASSETCHAINS_VERUSHASH;
 extern uint160 ASSETCHAINS_CHAINID;
@@ -435,7 +439,10 @@ uint256 CBlockHeader::GetVerusEntropyHashComponent(int32_t height) const
     return GetHash();
 }
 
-uint256 BuildMerkleTree(bool* fMutated, const std::vector<uint256> leaves,
+// adds the levels above the leaves already at the start of vMerkleTree
+static uint256 BuildMerkleLevels(bool* fMutated, size_t nLeaves, std::vector<uint256> &vMerkleTree);
+
+uint256 BuildMerkleTree(bool* fMutated, const std::vector<uint256> &leaves,
         std::vector<uint256> &vMerkleTree)
 {
     /* WARNING! If you're reading this because you're learning about crypto
@@ -476,21 +483,29 @@ uint256 BuildMerkleTree(bool* fMutated, const std::vector<uint256> leaves,
 
     vMerkleTree.clear();
     vMerkleTree.reserve(leaves.size() * 2 + 16); // Safe upper bound for the number of total nodes.
-    for (std::vector<uint256>::const_iterator it(leaves.begin()); it != leaves.end(); ++it)
-        vMerkleTree.push_back(*it);
+    vMerkleTree.insert(vMerkleTree.end(), leaves.begin(), leaves.end());
+    return BuildMerkleLevels(fMutated, leaves.size(), vMerkleTree);
+}
+
+static uint256 BuildMerkleLevels(bool* fMutated, size_t nLeaves, std::vector<uint256> &vMerkleTree)
+{
     int j = 0;
     bool mutated = false;
-    for (int nSize = leaves.size(); nSize > 1; nSize = (nSize + 1) / 2)
+    for (int nSize = nLeaves; nSize > 1; nSize = (nSize + 1) / 2)
     {
-        for (int i = 0; i < nSize; i += 2)
-        {
-            int i2 = std::min(i+1, nSize-1);
-            if (i2 == i + 1 && i2 + 1 == nSize && vMerkleTree[j+i] == vMerkleTree[j+i2]) {
-                // Two identical hashes at the end of the list at a particular level.
-                mutated = true;
-            }
-            vMerkleTree.push_back(Hash(BEGIN(vMerkleTree[j+i]),  END(vMerkleTree[j+i]),
-                                       BEGIN(vMerkleTree[j+i2]), END(vMerkleTree[j+i2])));
+        if (!(nSize & 1) && vMerkleTree[j+nSize-2] == vMerkleTree[j+nSize-1]) {
+            // Two identical hashes at the end of the list at a particular level.
+            mutated = true;
+        }
+
+        // the pairs of a level are consecutive, so they are hashed together, and an odd last hash with itself
+        static_assert(sizeof(uint256) == CSHA256::OUTPUT_SIZE, "merkle tree hashes must be packed");
+        size_t nLevel = vMerkleTree.size();
+        vMerkleTree.resize(nLevel + (nSize + 1) / 2);
+        SHA256D64(vMerkleTree[nLevel].begin(), vMerkleTree[j].begin(), nSize / 2);
+        if (nSize & 1) {
+            vMerkleTree.back() = Hash(BEGIN(vMerkleTree[j+nSize-1]), END(vMerkleTree[j+nSize-1]),
+                                      BEGIN(vMerkleTree[j+nSize-1]), END(vMerkleTree[j+nSize-1]));
         }
         j += nSize;
     }
@@ -503,9 +518,11 @@ uint256 BuildMerkleTree(bool* fMutated, const std::vector<uint256> leaves,
 
 uint256 CBlock::BuildMerkleTree(bool* fMutated) const
 {
-    std::vector<uint256> leaves;
-    for (int i=0; i<vtx.size(); i++) leaves.push_back(vtx[i].GetHash());
-    return ::BuildMerkleTree(fMutated, leaves, vMerkleTree);
+    // the txids were hashed when the transactions were made or read, so they are the leaves without a copy
+    vMerkleTree.clear();
+    vMerkleTree.reserve(vtx.size() * 2 + 16);
+    for (int i=0; i<vtx.size(); i++) vMerkleTree.push_back(vtx[i].GetHash());
+    return BuildMerkleLevels(fMutated, vtx.size(), vMerkleTree);
 }
 
 
@@ -586,6 +603,13 @@ CDefaultMMRNode CBlock::GetMMRNode(int index) const
 }
 
 
+// blocks with at least this many transactions hash their transaction MMR leaves on multiple threads
+static const size_t MIN_PARALLEL_MMR_TRANSACTIONS = 64;
+static const size_t MIN_MMR_TRANSACTIONS_PER_THREAD = 16;
+
+// block transaction MMRs of recent proofs, by block hash and entropy hash, as proofs of one block come in bunches
+static LRUCache<std::pair<uint256, uint256>, std::shared_ptr<const BlockMMRange>> blockMMRTreeCache(32, 0.25, true);
+
 // This creates the MMR tree for the block, which replaces the merkle tree used today
 // while enabling a proof of the transaction hash as well as parts of the transaction
 // such as inputs, outputs, shielded spends and outputs, transaction header info, etc.
@@ -597,12 +621,48 @@ BlockMMRange CBlock::BuildBlockMMRTree(const uint256 &entropyHash) const
     // for now, we will duplicate the merkle tree and enable proof of an element within a transaction using the MMR.
     // at some point, we should replace the txid with a fully hashed transaction tree and deprecate standard
     // txids altogether.
-    BlockMMRange mmRange(BlockMMRNodeLayer(*this));
-    for (auto &tx : vtx)
+    // hashing the map of each transaction is nearly all of the work, so do that on multiple threads for large blocks
+    std::vector<CDefaultMMRNode> txNodes(vtx.size());
+    int nThreads = vtx.size() >= MIN_PARALLEL_MMR_TRANSACTIONS ?
+                    std::min(GetNumCores(), (int)(vtx.size() / MIN_MMR_TRANSACTIONS_PER_THREAD)) : 1;
+    bool hashed = false;
+    if (nThreads > 1)
     {
-        mmRange.Add(tx.GetDefaultMMRNode());
+        std::atomic<size_t> nextTx(0);
+        std::atomic<bool> failed(false);
+        boost::thread_group hashThreads;
+        for (int i = 0; i < nThreads; i++)
+        {
+            hashThreads.create_thread([this, &txNodes, &nextTx, &failed]() {
+                try
+                {
+                    for (size_t txIdx = nextTx++; txIdx < vtx.size() && !failed; txIdx = nextTx++)
+                    {
+                        txNodes[txIdx] = vtx[txIdx].GetDefaultMMRNode();
+                    }
+                }
+                catch (const std::exception &e)
+                {
+                    failed = true;
+                }
+            });
+        }
+        hashThreads.join_all();
+
+        // if anything went wrong, hash again below, so any exception is thrown on this thread
+        hashed = !failed;
+    }
+    if (!hashed)
+    {
+        for (int i = 0; i < vtx.size(); i++)
+        {
+            txNodes[i] = vtx[i].GetDefaultMMRNode();
+        }
     }
 
+    BlockMMRange mmRange;
+    mmRange.Add(txNodes);
+
     if (IsAdvancedHeader() != 0)
     {
         // add one additional object to the block MMR that contains
@@ -620,7 +680,18 @@ BlockMMRange CBlock::BuildBlockMMRTree(const uint256 &entropyHash) const
 
 BlockMMRange CBlock::GetBlockMMRTree(const uint256 &entropyHash) const
 {
-    return BuildBlockMMRTree(entropyHash);
+    if (pStoredMMRTree)
+    {
+        return *pStoredMMRTree;
+    }
+    std::pair<uint256, uint256> cacheKey(GetHash(), entropyHash);
+    std::shared_ptr<const BlockMMRange> pTree;
+    if (!blockMMRTreeCache.Get(cacheKey, pTree))
+    {
+        pTree = std::make_shared<const BlockMMRange>(BuildBlockMMRTree(entropyHash));
+        blockMMRTreeCache.Put(cacheKey, pTree);
+    }
+    return *pTree;
 }
 
 CPartialTransactionProof CBlock::GetPartialTransactionProof(const CTransaction &tx, int txIndex, const std::vector<std::pair<int16_t, int16_t>> &partIndexes, const uint256 &entropyHash) const
@@ -641,7 +712,7 @@ CPartialTransactionProof CBlock::GetPartialTransactionProof(const CTransaction &
             return CPartialTransactionProof();
         }
 
-        CTransactionMap txMap(tx);
+        const CTransactionMap &txMap = tx.GetTransactionMap();
         TransactionMMView txMMV(txMap.transactionMMR);
 
         for (auto &partIdx : partIndexes)
@@ -720,11 +791,41 @@ std::string CBlock::ToString() const
     return s.str();
 }
 
+// evidence, challenges and finalizations prove the same headers again and again, so the root each check of a header
+// proof results in is kept, keyed by a hash of the check, the hash checked, the height and the whole proof. a key
+// must cover every byte the result depends on, and serializing and hashing a proof of a block in a chain of a few
+// million takes about a sixth of the time of copying and checking it, see HeaderProofCached and HeaderProofUncached
+static const int HEADER_PROOF_CACHE_SIZE = 4096;
+static ShardedLRUCache<uint256, uint256> headerProofCache(HEADER_PROOF_CACHE_SIZE, 0, true);
+
+enum EHeaderProofCheck
+{
+    HEADER_PROOF_MMR_ROOT = 1,
+    HEADER_PROOF_BLOCK_HASH = 2,
+    HEADER_AND_PROOF_MMR_ROOT = 3,
+    HEADER_AND_PROOF_BLOCK_HASH = 4
+};
+
+template <typename ProofType>
+static uint256 HeaderProofCacheKey(EHeaderProofCheck check, const ProofType &proof, const uint256 &checkHash, int32_t blockHeight)
+{
+    CHashWriter hw(SER_GETHASH, PROTOCOL_VERSION);
+    hw << (uint8_t)check << checkHash << blockHeight << proof;
+    return hw.GetHash();
+}
+
 // a block header proof validates the block MMR root, which is used
 // for proving down to the transaction sub-component. the first value
 // hashed against is the block hash, which enables proving the block hash as well
 uint256 CBlockHeaderProof::ValidateBlockMMRRoot(const uint256 &checkHash, int32_t blockHeight) const
 {
+    uint256 cacheKey = HeaderProofCacheKey(HEADER_PROOF_MMR_ROOT, *this, checkHash, blockHeight);
+    uint256 cachedRoot;
+    if (headerProofCache.Get(cacheKey, cachedRoot))
+    {
+        return cachedRoot;
+    }
+
     CBlockHeaderProof bhp = *this;
     // if this proof has a blockproofbridge, replace it with an MMR proof bridge
     if (bhp.headerProof.proofSequence.size() > 1)
@@ -733,13 +834,24 @@ uint256 CBlockHeaderProof::ValidateBlockMMRRoot(const uint256 &checkHash, int32_
     }
     uint256 hash = mmrBridge.SafeCheck(checkHash);
     hash = bhp.headerProof.CheckProof(hash);
-    return blockHeight == GetBlockHeight() ? hash : uint256();
+    hash = blockHeight == GetBlockHeight() ? hash : uint256();
+    headerProofCache.Put(cacheKey, hash);
+    return hash;
 }
 
 uint256 CBlockHeaderProof::ValidateBlockHash(const uint256 &checkHash, int blockHeight) const
 {
+    uint256 cacheKey = HeaderProofCacheKey(HEADER_PROOF_BLOCK_HASH, *this, checkHash, blockHeight);
+    uint256 cachedHash;
+    if (headerProofCache.Get(cacheKey, cachedHash))
+    {
+        return cachedHash;
+    }
+
     uint256 hash = headerProof.CheckProof(checkHash);
-    return blockHeight == GetBlockHeight() ? hash : uint256();
+    hash = blockHeight == GetBlockHeight() ? hash : uint256();
+    headerProofCache.Put(cacheKey, hash);
+    return hash;
 }
 
 // a block header proof validates the block MMR root, which is used
@@ -747,6 +859,13 @@ uint256 CBlockHeaderProof::ValidateBlockHash(const uint256 &checkHash, int block
 // hashed against is the block hash, which enables proving the block hash as well
 uint256 CBlockHeaderAndProof::ValidateBlockMMRRoot(const uint256 &checkHash, int32_t blockHeight) const
 {
+    uint256 cacheKey = HeaderProofCacheKey(HEADER_AND_PROOF_MMR_ROOT, *this, checkHash, blockHeight);
+    uint256 cachedRoot;
+    if (headerProofCache.Get(cacheKey, cachedRoot))
+    {
+        return cachedRoot;
+    }
+
     CBlockHeaderAndProof bhp = *this;
     // if this proof has a blockproofbridge, replace it with an MMR proof bridge
     if (bhp.headerProof.proofSequence.size() > 1)
@@ -755,7 +874,9 @@ uint256 CBlockHeaderAndProof::ValidateBlockMMRRoot(const uint256 &checkHash, int
     }
     uint256 hash = blockHeader.MMRProofBridge().SafeCheck(checkHash);
     hash = bhp.headerProof.CheckProof(hash);
-    return blockHeight == GetBlockHeight() ? hash : uint256();
+    hash = blockHeight == GetBlockHeight() ? hash : uint256();
+    headerProofCache.Put(cacheKey, hash);
+    return hash;
 }
 
 UniValue BlockHeaderToUni(const CBlockHeader &block)
@@ -799,6 +920,13 @@ UniValue BlockHeaderToUni(const CBlockHeader &block)
 
 uint256 CBlockHeaderAndProof::ValidateBlockHash(const uint256 &checkHash, int blockHeight) const
 {
+    uint256 cacheKey = HeaderProofCacheKey(HEADER_AND_PROOF_BLOCK_HASH, *this, checkHash, blockHeight);
+    uint256 cachedHash;
+    if (headerProofCache.Get(cacheKey, cachedHash))
+    {
+        return cachedHash;
+    }
+
     uint256 hash = headerProof.CheckProof(checkHash);
 
     if (LogAcceptCategory("notarization") && LogAcceptCategory("verbose"))
@@ -813,7 +941,9 @@ uint256 CBlockHeaderAndProof::ValidateBlockHash(const uint256 &checkHash, int bl
             blockHeader.GetHash().GetHex().c_str(),
             (blockHeight == GetBlockHeight() && checkHash == blockHeader.GetHash() ? hash : uint256()).GetHex().c_str());
     }
-    return blockHeight == GetBlockHeight() && checkHash == blockHeader.GetHash() ? hash : uint256();
+    hash = blockHeight == GetBlockHeight() && checkHash == blockHeader.GetHash() ? hash : uint256();
+    headerProofCache.Put(cacheKey, hash);
+    return hash;
 }
 
 // used to span multiple outputs if a cross-chain proof becomes too big for just one
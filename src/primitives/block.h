@@ -405,9 +405,8 @@ class CNetworkBlockHeader : public CBlockHeader
 
 // for the MMRs for each block
 class CBlock;
-typedef COverlayNodeLayer<CDefaultMMRNode, CBlock> BlockMMRNodeLayer;
-typedef CMerkleMountainRange<CDefaultMMRNode, CChunkedLayer<CDefaultMMRNode, 2>, BlockMMRNodeLayer> BlockMMRange;
-typedef CMerkleMountainView<CDefaultMMRNode, CChunkedLayer<CDefaultMMRNode, 2>, BlockMMRNodeLayer> BlockMMView;
+typedef CMerkleMountainRange<CDefaultMMRNode, CChunkedLayer<CDefaultMMRNode, 2>> BlockMMRange;
+typedef CMerkleMountainView<CDefaultMMRNode, CChunkedLayer<CDefaultMMRNode, 2>> BlockMMView;
 
 class CBlock : public CBlockHeader
 {
@@ -417,6 +416,9 @@ public:
 
     // memory only
     mutable std::vector<uint256> vMerkleTree;
+    // memory only, set for a block rebuilt from its pruned proof data, whose transactions that were not retained
+    // are empty placeholders. GetBlockMMRTree then returns this tree instead of hashing the transactions
+    std::shared_ptr<const BlockMMRange> pStoredMMRTree;
 
     CBlock()
     {
@@ -442,6 +444,16 @@ public:
         CBlockHeader::SetNull();
         vtx.clear();
         vMerkleTree.clear();
+        pStoredMMRTree.reset();
+    }
+
+    // like SetNull, but keeps the transactions for the next block unserialized into this one to overwrite in place,
+    // which reuses the memory they hold
+    void SetNullForReuse()
+    {
+        CBlockHeader::SetNull();
+        vMerkleTree.clear();
+        pStoredMMRTree.reset();
     }
 
     CBlockHeader GetBlockHeader() const
@@ -465,6 +477,9 @@ public:
     uint32_t GetHeight() const;
     uint256 BuildMerkleTree(bool* mutated = NULL) const;
     BlockMMRange BuildBlockMMRTree(const uint256 &entropyHash) const;
+
+    // same as BuildBlockMMRTree, but reuses the tree of a recent call for this block hash. only for blocks
+    // that have been validated, as the block hash alone does not commit to the transactions of an invalid block
     BlockMMRange GetBlockMMRTree(const uint256 &entropyHash) const;
 
     // get transaction node from the block
@@ -478,7 +493,7 @@ public:
 };
 
 
-uint256 BuildMerkleTree(bool* fMutated, const std::vector<uint256> leaves,
+uint256 BuildMerkleTree(bool* fMutated, const std::vector<uint256> &leaves,
         std::vector<uint256> &vMerkleTree);
 
 std::vector<uint256> GetMerkleBranch(int nIndex, int nLeaves, const std::vector<uint256> &vMerkleTree);
@@ -1273,6 +1288,70 @@ public:
     }
 };
 
+// non-owning view of a serialized CEvidenceData, which decodes its descriptor and leaves its data in the
+// caller's buffer, so checks of the type or key of large evidence do not copy it
+class CEvidenceDataView
+{
+public:
+    uint32_t version;
+    uint32_t type;
+    CEvidenceData::CMultiPartDescriptor md;     // only for multipart data
+    uint160 vdxfd;                              // only for non-multipart types
+    const unsigned char *pData;
+    size_t dataSize;
+
+    CEvidenceDataView() : version(CEvidenceData::VERSION_INVALID), type(CEvidenceData::TYPE_INVALID), pData(nullptr), dataSize(0) {}
+
+    // reads from the current position of the reader and leaves it after the evidence data
+    CEvidenceDataView(CSpanReader &s) : version(CEvidenceData::VERSION_INVALID), type(CEvidenceData::TYPE_INVALID), pData(nullptr), dataSize(0)
+    {
+        try
+        {
+            // version is serialized twice, matching CEvidenceData
+            s >> VARINT(version);
+            s >> VARINT(version);
+            if (version >= CEvidenceData::VERSION_FIRST && version <= CEvidenceData::VERSION_LAST)
+            {
+                s >> VARINT(type);
+                if (type == CEvidenceData::TYPE_MULTIPART_DATA)
+                {
+                    s >> md;
+                }
+                else
+                {
+                    s >> vdxfd;
+                }
+                uint64_t vecSize = ReadCompactSize(s);
+                if (vecSize <= s.size())
+                {
+                    pData = s.cur();
+                    dataSize = vecSize;
+                    s.ignore(vecSize);
+                }
+            }
+        }
+        catch(const std::exception& e)
+        {
+            LogPrint("serialization", "%s\n", e.what());
+            version = CEvidenceData::VERSION_INVALID;
+        }
+    }
+
+    bool IsValid() const
+    {
+        return pData != nullptr &&
+               version >= CEvidenceData::VERSION_FIRST &&
+               version <= CEvidenceData::VERSION_LAST &&
+               type >= CEvidenceData::TYPE_FIRST_VALID &&
+               type <= CEvidenceData::TYPE_LAST_VALID;
+    }
+
+    std::vector<unsigned char> GetData() const
+    {
+        return pData ? std::vector<unsigned char>(pData, pData + dataSize) : std::vector<unsigned char>();
+    }
+};
+
 // each notarization will have an opret object that contains various kind of proof of the notarization itself
 // as well as recent POW and POS headers and entropy sources.
 class CCrossChainProof
@@ -2410,6 +2489,96 @@ public:
     }
 };
 
+// non-owning view of a serialized CNotaryEvidence, which decodes its fixed header and the header of the first
+// evidence object, leaving the evidence itself in the caller's buffer until it is requested. this lets
+// validation walk multipart evidence outputs without decoding and copying every part.
+class CNotaryEvidenceView
+{
+public:
+    uint8_t version;
+    uint8_t type;
+    uint160 systemID;
+    CUTXORef output;
+    uint8_t state;
+
+    uint32_t evidenceVersion;
+    int32_t evidenceObjectCount;
+    uint16_t firstObjectType;
+    CEvidenceDataView firstEvidenceData;        // only if the first object is CHAINOBJ_EVIDENCEDATA
+
+    const unsigned char *pBegin;
+    const unsigned char *pEnd;
+
+    CNotaryEvidenceView(const std::vector<unsigned char> &asVector) :
+        version(CNotaryEvidence::VERSION_INVALID),
+        type(CNotaryEvidence::TYPE_INVALID),
+        state(CNotaryEvidence::STATE_INVALID),
+        evidenceVersion(CCrossChainProof::VERSION_INVALID),
+        evidenceObjectCount(0),
+        firstObjectType(CHAINOBJ_INVALID),
+        pBegin(asVector.data()),
+        pEnd(asVector.data() + asVector.size())
+    {
+        CSpanReader s(pBegin, pEnd, SER_NETWORK, PROTOCOL_VERSION);
+        try
+        {
+            s >> version;
+            s >> type;
+            s >> systemID;
+            s >> output;
+            s >> state;
+            s >> evidenceVersion;
+            s >> VARINT(evidenceObjectCount);
+            if (evidenceObjectCount > 0)
+            {
+                s >> firstObjectType;
+                if (firstObjectType == CHAINOBJ_EVIDENCEDATA)
+                {
+                    firstEvidenceData = CEvidenceDataView(s);
+                }
+            }
+        }
+        catch(const std::exception& e)
+        {
+            LogPrint("serialization", "%s\n", e.what());
+            version = CNotaryEvidence::VERSION_INVALID;
+        }
+    }
+
+    bool IsValid() const
+    {
+        return version >= CNotaryEvidence::VERSION_FIRST &&
+               version <= CNotaryEvidence::VERSION_LAST &&
+               !systemID.IsNull() &&
+               output.IsValid();
+    }
+
+    bool IsMultipartProof() const
+    {
+        return evidenceObjectCount == 1 &&
+               firstObjectType == CHAINOBJ_EVIDENCEDATA &&
+               firstEvidenceData.IsValid() &&
+               firstEvidenceData.type == CEvidenceData::TYPE_MULTIPART_DATA;
+    }
+
+    // fully decodes the evidence this views
+    CNotaryEvidence GetNotaryEvidence() const
+    {
+        CNotaryEvidence retVal(CNotaryEvidence::TYPE_INVALID, CNotaryEvidence::VERSION_INVALID);
+        CDataStream s((const char *)pBegin, (const char *)pEnd, SER_NETWORK, PROTOCOL_VERSION);
+        try
+        {
+            s >> retVal;
+        }
+        catch(const std::exception& e)
+        {
+            LogPrint("serialization", "%s\n", e.what());
+            retVal.version = CNotaryEvidence::VERSION_INVALID;
+        }
+        return retVal;
+    }
+};
+
 class CPBaaSEvidenceRef
 {
 public:
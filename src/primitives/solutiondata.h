@@ -9,6 +9,7 @@
 #include "uint256.h"
 #include "arith_uint256.h"
 #include "hash.h"
+#include "memusage.h"
 #include "nonce.h"
 #include "streams.h"
 #include <univalue.h>
@@ -663,6 +664,12 @@ class CCompactSolutionVector
             return _size;
         }
 
+        // heap bytes of the compressed solution
+        size_t DynamicMemoryUsage() const
+        {
+            return memusage::DynamicUsage(vch) + memusage::DynamicUsage(ofsAndRepeat);
+        }
+
         std::vector<unsigned char> nSolution() const
         {
             if (!ofsAndRepeat.size())
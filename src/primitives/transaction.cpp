@@ -147,14 +147,14 @@ std::string SaplingOutPoint::ToString() const
 CTxIn::CTxIn(COutPoint prevoutIn, CScript scriptSigIn, uint32_t nSequenceIn)
 {
     prevout = prevoutIn;
-    scriptSig = scriptSigIn;
+    scriptSig = std::move(scriptSigIn);
     nSequence = nSequenceIn;
 }
 
 CTxIn::CTxIn(uint256 hashPrevTx, uint32_t nOut, CScript scriptSigIn, uint32_t nSequenceIn)
 {
     prevout = COutPoint(hashPrevTx, nOut);
-    scriptSig = scriptSigIn;
+    scriptSig = std::move(scriptSigIn);
     nSequence = nSequenceIn;
 }
 
@@ -179,6 +179,12 @@ CTxOut::CTxOut(const CAmount& nValueIn, const CScript &scriptPubKeyIn)
     scriptPubKey = scriptPubKeyIn;
 }
 
+CTxOut::CTxOut(const CAmount& nValueIn, CScript &&scriptPubKeyIn)
+{
+    nValue = nValueIn;
+    scriptPubKey = std::move(scriptPubKeyIn);
+}
+
 uint256 CTxOut::GetHash() const
 {
     return SerializeHash(*this);
@@ -279,6 +285,77 @@ CTransactionMap::CTransactionMap(const CTransaction &tx)
 void CTransaction::UpdateHash() const
 {
     *const_cast<uint256*>(&hash) = SerializeHash(*this);
+    outputCCParams.Clear();
+    transactionMap.Clear();
+}
+
+const CTransactionMap &CTransactionMapCache::Get(const CTransaction &tx) const
+{
+    std::shared_ptr<const CTransactionMap> built = std::atomic_load(&txMap);
+    if (built)
+    {
+        return *built;
+    }
+
+    // if another thread stored its map first, that one is kept, so that references to it stay valid
+    std::shared_ptr<const CTransactionMap> expected;
+    built = std::make_shared<const CTransactionMap>(tx);
+    if (!std::atomic_compare_exchange_strong(&txMap, &expected, built))
+    {
+        built = expected;
+    }
+    return *built;
+}
+
+const CTransactionMap &CTransaction::GetTransactionMap() const
+{
+    return transactionMap.Get(*this);
+}
+
+const CTxOutCCParamsCache::Outputs &CTxOutCCParamsCache::Get(const std::vector<CTxOut> &vout) const
+{
+    std::shared_ptr<const Outputs> parsed = std::atomic_load(&outputs);
+    if (parsed)
+    {
+        return *parsed;
+    }
+
+    auto newParsed = std::make_shared<Outputs>(vout.size());
+    for (int i = 0; i < vout.size(); i++)
+    {
+        (*newParsed)[i].fIsCC = vout[i].scriptPubKey.IsPayToCryptoCondition((*newParsed)[i].p);
+    }
+
+    // if another thread stored its parse first, that one is kept, so that references to it stay valid
+    std::shared_ptr<const Outputs> expected;
+    parsed = newParsed;
+    if (!std::atomic_compare_exchange_strong(&outputs, &expected, parsed))
+    {
+        parsed = expected;
+    }
+    return *parsed;
+}
+
+bool CTransaction::IsPayToCryptoCondition(int voutNum, COptCCParams &p) const
+{
+    const COptCCParams *pParams = GetOutputCCParams(voutNum);
+    if (!pParams)
+    {
+        p = COptCCParams();
+        return false;
+    }
+    p = *pParams;
+    return true;
+}
+
+const COptCCParams *CTransaction::GetOutputCCParams(int voutNum) const
+{
+    if (voutNum < 0 || voutNum >= vout.size())
+    {
+        return nullptr;
+    }
+    const CTxOutCCParamsCache::COutputParams &output = outputCCParams.Get(vout)[voutNum];
+    return output.fIsCC ? &output.p : nullptr;
 }
 
 CTransaction::CTransaction() : nVersion(CTransaction::SPROUT_MIN_CURRENT_VERSION), fOverwintered(false), nVersionGroupId(0), nExpiryHeight(0), vin(), vout(), nLockTime(0), valueBalance(0), vShieldedSpend(), vShieldedOutput(), vJoinSplit(), joinSplitPubKey(), joinSplitSig(), bindingSig() { }
@@ -331,13 +408,15 @@ CTransaction& CTransaction::operator=(const CTransaction &tx) {
     *const_cast<joinsplit_sig_t*>(&joinSplitSig) = tx.joinSplitSig;
     *const_cast<binding_sig_t*>(&bindingSig) = tx.bindingSig;
     *const_cast<uint256*>(&hash) = tx.hash;
+    outputCCParams = tx.outputCCParams;
+    transactionMap = tx.transactionMap;
     return *this;
 }
 
 
 uint256 CTransaction::GetMMRRoot() const
 {
-    CTransactionMap txMap(*this);
+    const CTransactionMap &txMap = GetTransactionMap();
     return TransactionMMView(txMap.transactionMMR, txMap.transactionMMR.size()).GetRoot();
 }
 
@@ -350,8 +429,7 @@ CDefaultMMRNode CTransaction::GetDefaultMMRNode() const
 
 TransactionMMRange CTransaction::GetTransactionMMR() const
 {
-    CTransactionMap txMap(*this);
-    return txMap.transactionMMR;
+    return GetTransactionMap().transactionMMR;
 }
 
 
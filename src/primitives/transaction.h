@@ -24,6 +24,8 @@
 #endif
 
 #include <array>
+#include <atomic>
+#include <memory>
 
 #include <boost/variant.hpp>
 
@@ -423,6 +425,9 @@ public:
     std::string ToString() const;
 };
 
+template<>
+struct is_unserialized_in_place<CTxIn> : std::true_type {};
+
 /** An output of a transaction.  It contains the public key that the next input
  * must be able to sign with to claim it.
  */
@@ -438,6 +443,7 @@ public:
     }
 
     CTxOut(const CAmount& nValueIn, const CScript &scriptPubKeyIn);
+    CTxOut(const CAmount& nValueIn, CScript &&scriptPubKeyIn);
 
     ADD_SERIALIZE_METHODS;
 
@@ -500,6 +506,9 @@ public:
     std::string ToString() const;
 };
 
+template<>
+struct is_unserialized_in_place<CTxOut> : std::true_type {};
+
 // Overwinter version group id
 static constexpr uint32_t OVERWINTER_VERSION_GROUP_ID = 0x03C48270;
 static_assert(OVERWINTER_VERSION_GROUP_ID != 0, "version group id must be non-zero as specified in ZIP 202");
@@ -509,10 +518,58 @@ static constexpr uint32_t SAPLING_VERSION_GROUP_ID = 0x892F2085;
 static_assert(SAPLING_VERSION_GROUP_ID != 0, "version group id must be non-zero as specified in ZIP 202");
 
 struct CMutableTransaction;
+class CTransactionMap;
 
 typedef CMerkleMountainRange<CDefaultMMRNode, CChunkedLayer<CDefaultMMRNode, 2>> TransactionMMRange;
 typedef CMerkleMountainView<CDefaultMMRNode, CChunkedLayer<CDefaultMMRNode, 2>> TransactionMMView;
 
+/** Memory only cache of the crypto-condition parameters of each output of a transaction, parsed on first use */
+class CTxOutCCParamsCache
+{
+public:
+    struct COutputParams
+    {
+        bool fIsCC;
+        COptCCParams p;
+    };
+    typedef std::vector<COutputParams> Outputs;
+
+    CTxOutCCParamsCache() {}
+    CTxOutCCParamsCache(const CTxOutCCParamsCache &other) : outputs(std::atomic_load(&other.outputs)) {}
+    CTxOutCCParamsCache &operator=(const CTxOutCCParamsCache &other)
+    {
+        std::atomic_store(&outputs, std::atomic_load(&other.outputs));
+        return *this;
+    }
+
+    void Clear() const { std::atomic_store(&outputs, std::shared_ptr<const Outputs>()); }
+    const Outputs &Get(const std::vector<CTxOut> &vout) const;
+
+private:
+    // once stored, outputs is only replaced by Clear or assignment, which also change the transaction
+    mutable std::shared_ptr<const Outputs> outputs;
+};
+
+/** Memory only cache of the component hashes and MMR of a transaction, built on first use */
+class CTransactionMapCache
+{
+public:
+    CTransactionMapCache() {}
+    CTransactionMapCache(const CTransactionMapCache &other) : txMap(std::atomic_load(&other.txMap)) {}
+    CTransactionMapCache &operator=(const CTransactionMapCache &other)
+    {
+        std::atomic_store(&txMap, std::atomic_load(&other.txMap));
+        return *this;
+    }
+
+    void Clear() const { std::atomic_store(&txMap, std::shared_ptr<const CTransactionMap>()); }
+    const CTransactionMap &Get(const CTransaction &tx) const;
+
+private:
+    // as with the output parameters, only replaced by Clear or assignment, which also change the transaction
+    mutable std::shared_ptr<const CTransactionMap> txMap;
+};
+
 /** The basic transaction that is broadcasted on the network and contained in
  * blocks.  A transaction can contain multiple inputs and outputs.
  */
@@ -521,6 +578,8 @@ class CTransaction
 private:
     /** Memory only. */
     const uint256 hash;
+    CTxOutCCParamsCache outputCCParams;
+    CTransactionMapCache transactionMap;
     void UpdateHash() const;
 
 protected:
@@ -597,6 +656,18 @@ public:
             READWRITE(header);
             *const_cast<bool*>(&fOverwintered) = header >> 31;
             *const_cast<int32_t*>(&this->nVersion) = header & 0x7FFFFFFF;
+
+            // this may be unserialized over another transaction, so what the format leaves out is reset to how a
+            // new one has it
+            *const_cast<uint32_t*>(&nVersionGroupId) = 0;
+            *const_cast<uint32_t*>(&nExpiryHeight) = 0;
+            *const_cast<CAmount*>(&valueBalance) = 0;
+            const_cast<std::vector<SpendDescription>*>(&vShieldedSpend)->clear();
+            const_cast<std::vector<OutputDescription>*>(&vShieldedOutput)->clear();
+            const_cast<std::vector<JSDescription>*>(&vJoinSplit)->clear();
+            *const_cast<uint256*>(&joinSplitPubKey) = uint256();
+            const_cast<joinsplit_sig_t*>(&joinSplitSig)->fill(0);
+            const_cast<binding_sig_t*>(&bindingSig)->fill(0);
         } else {
             header = GetHeader();
             READWRITE(header);
@@ -664,8 +735,21 @@ public:
         return header;
     }
 
+    /**
+     * Same as vout[voutNum].scriptPubKey.IsPayToCryptoCondition(p), but each output is only parsed once for as long as
+     * the transaction is not assigned to or deserialized into
+     */
+    bool IsPayToCryptoCondition(int voutNum, COptCCParams &p) const;
+
+    /** The parsed parameters of a crypto-condition output, or nullptr, valid as long as the transaction is unchanged */
+    const COptCCParams *GetOutputCCParams(int voutNum) const;
+
     // returns an MMR node for the block merkle mountain range
     TransactionMMRange GetTransactionMMR() const;
+
+    // the hashes of the header, inputs, outputs and shielded components and the MMR over them, which are only
+    // computed once for a transaction
+    const CTransactionMap &GetTransactionMap() const;
     CDefaultMMRNode GetDefaultMMRNode() const;
     uint256 GetMMRRoot() const;
 
@@ -801,6 +885,9 @@ public:
     std::string ToString() const;
 };
 
+template<>
+struct is_unserialized_in_place<CTransaction> : std::true_type {};
+
 /** A mutable version of CTransaction. */
 struct CMutableTransaction
 {
@@ -1031,7 +1118,7 @@ public:
     CTransactionMap(const CTransaction &tx);
 
     // returns -1 if element is not found
-    int32_t GetElementIndex(int16_t elementType, int16_t indexInType)
+    int32_t GetElementIndex(int16_t elementType, int16_t indexInType) const
     {
         auto it = elementHashMap.find(std::make_pair(elementType, indexInType));
         if (it != elementHashMap.end())
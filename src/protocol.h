@@ -75,6 +75,9 @@ enum {
     // Zcash nodes used to support this by default, without advertising this bit,
     // but no longer do as of protocol version 170004 (= NO_BLOOM_VERSION)
     NODE_BLOOM = (1 << 2),
+    // NODE_COMPACT_FILTERS means the node serves the BIP157 compact filters of its blocks, which light clients
+    // match themselves instead of having the node match a bloom filter against each block for them
+    NODE_COMPACT_FILTERS = (1 << 6),
 
     // Bits 24-31 are reserved for temporary experiments. Just pick a bit that
     // isn't getting used, or one not being used much, and notify the
@@ -154,6 +157,8 @@ enum {
     // Nodes may always request a MSG_FILTERED_BLOCK in a getdata, however,
     // MSG_FILTERED_BLOCK should not appear in any invs except as a part of getdata.
     MSG_FILTERED_BLOCK,
+    // only sent in a getdata to peers that negotiated compact blocks with sendcmpct, asks for a cmpctblock
+    MSG_CMPCT_BLOCK,
 };
 
 #endif // BITCOIN_PROTOCOL_H
@@ -0,0 +1,39 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef VERUS_PRUNEDPROOFS_H
+#define VERUS_PRUNEDPROOFS_H
+
+#include "serialize.h"
+#include "uint256.h"
+
+#include <vector>
+
+// what a pruned block keeps so the transactions retained from it can still be proven, with -prune and -pruneproofs.
+// the leaves of the block MMR and the txids of the merkle tree are enough to make the proof of any transaction in the
+// block, and the retained transactions themselves are stored by txid, so they are also found without the block.
+// the header is not kept, as it is still in the block index
+struct CPrunedBlockProofs
+{
+    uint32_t nTx;
+    // leaf hashes of the block MMR, including the pre header leaf of blocks with an advanced header
+    std::vector<uint256> mmrLeaves;
+    std::vector<uint256> txids;
+    // positions in the block of the transactions that were retained
+    std::vector<uint32_t> retained;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(VARINT(nTx));
+        READWRITE(mmrLeaves);
+        READWRITE(txids);
+        READWRITE(retained);
+    }
+
+    CPrunedBlockProofs() : nTx(0) {}
+};
+
+#endif // VERUS_PRUNEDPROOFS_H
@@ -0,0 +1,114 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_RESERVETRANSFERINDEX_H
+#define BITCOIN_RESERVETRANSFERINDEX_H
+
+#include "uint256.h"
+#include "serialize.h"
+
+#include <utility>
+
+class CInputDescriptor;
+class CReserveTransfer;
+class CTxOut;
+
+// reserve transfers are keyed by the currency they are imported into first, then height, so all transfers
+// to one export target in a range of blocks can be read with one seek
+struct CReserveTransferIndexIteratorKey {
+    uint160 currencyID;
+    unsigned int height;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 24;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        currencyID.Serialize(s);
+        ser_writedata32be(s, height);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        currencyID.Unserialize(s);
+        height = ser_readdata32be(s);
+    }
+
+    CReserveTransferIndexIteratorKey(const uint160 &id, unsigned int nHeight) {
+        currencyID = id;
+        height = nHeight;
+    }
+
+    CReserveTransferIndexIteratorKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        currencyID.SetNull();
+        height = 0;
+    }
+};
+
+struct CReserveTransferIndexKey {
+    uint160 currencyID;
+    unsigned int height;
+    uint256 txhash;
+    unsigned int index;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 60;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        currencyID.Serialize(s);
+        ser_writedata32be(s, height);
+        txhash.Serialize(s);
+        ser_writedata32be(s, index);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        currencyID.Unserialize(s);
+        height = ser_readdata32be(s);
+        txhash.Unserialize(s);
+        index = ser_readdata32be(s);
+    }
+
+    CReserveTransferIndexKey(const uint160 &id, unsigned int nHeight, const uint256 &hash, unsigned int nIndex) {
+        currencyID = id;
+        height = nHeight;
+        txhash = hash;
+        index = nIndex;
+    }
+
+    CReserveTransferIndexKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        currencyID.SetNull();
+        height = 0;
+        txhash.SetNull();
+        index = 0;
+    }
+};
+
+struct CReserveTransferIndexKeyCompare
+{
+    bool operator()(const CReserveTransferIndexKey& a, const CReserveTransferIndexKey& b) const {
+        if (a.currencyID != b.currencyID)
+            return a.currencyID < b.currencyID;
+        if (a.height != b.height)
+            return a.height < b.height;
+        if (a.txhash != b.txhash)
+            return a.txhash < b.txhash;
+        return a.index < b.index;
+    }
+};
+
+// the value of each entry is the output and its decoded transfer, so no transaction needs to be loaded to use it
+typedef std::pair<CReserveTransferIndexKey, std::pair<CInputDescriptor, CReserveTransfer>> CReserveTransferIndexEntry;
+
+// returns true and fills in the entry if this output is a valid reserve transfer
+bool GetReserveTransferIndexEntry(const CTxOut &out, const uint256 &txHash, unsigned int outNum, unsigned int height, CReserveTransferIndexEntry &entry);
+
+#endif // BITCOIN_RESERVETRANSFERINDEX_H
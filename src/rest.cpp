@@ -8,7 +8,11 @@
 #include "primitives/transaction.h"
 #include "main.h"
 #include "httpserver.h"
+#include "key_io.h"
 #include "rpc/server.h"
+#include "rpc/pbaasrpc.h"
+#include "pbaas/identity.h"
+#include "pbaas/pbaas.h"
 #include "streams.h"
 #include "sync.h"
 #include "txmempool.h"
@@ -18,11 +22,15 @@
 #include <boost/algorithm/string.hpp>
 #include <boost/dynamic_bitset.hpp>
 
+#include <functional>
+
 #include <univalue.h>
 
 using namespace std;
 
 static const size_t MAX_GETUTXOS_OUTPOINTS = 15; //allow a max of 15 outpoints to be queried at once
+static const int REST_IMMUTABLE_DEPTH = 10; // replies bound to a height at least this far below the tip are cached for good
+static const int REST_TIP_MAX_AGE = 10; // seconds that proxies may keep replies that follow the tip
 
 enum RetFormat {
     RF_UNDEF,
@@ -62,7 +70,6 @@ extern UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex,
 extern UniValue mempoolInfoToJSON();
 extern UniValue mempoolToJSON(bool fVerbose = false);
 extern UniValue blockheaderToJSON(const CBlockIndex* blockindex);
-void ScriptPubKeyToJSON(const CScript& scriptPubKey, UniValue& out, bool fIncludeHex, bool fIncludeAsm=true);
 
 static bool RESTERR(HTTPRequest* req, enum HTTPStatusCode status, string message)
 {
@@ -190,6 +197,72 @@ static bool rest_headers(HTTPRequest* req,
     return true; // continue to process further HTTP reqs on this cxn
 }
 
+// PBaaS names may contain '.', so the format is only taken from after the last one, and the rest is split on '/'
+static enum RetFormat ParsePathAndFormat(vector<string>& path, const string& strURIPart)
+{
+    size_t formatPos = strURIPart.rfind('.');
+    vector<string> params;
+    const RetFormat rf = formatPos == string::npos ? RF_UNDEF : ParseDataFormat(params, "." + strURIPart.substr(formatPos + 1));
+    boost::split(path, strURIPart.substr(0, formatPos), boost::is_any_of("/"));
+    return rf;
+}
+
+// parses an optional height path element, which may not be above the tip, since what is there is not yet known
+static bool ParseBoundHeight(HTTPRequest* req, const vector<string>& path, size_t index, int32_t tipHeight, int32_t& height)
+{
+    height = -1;
+    if (path.size() <= index)
+        return true;
+    if (!ParseInt32(path[index], &height) || height < 0)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid height: " + path[index]);
+    if (height > tipHeight)
+        return RESTERR(req, HTTP_NOT_FOUND, "Height " + path[index] + " is above the tip");
+    return true;
+}
+
+// a reply bound to a height deep enough not to be reorganized away never changes, so proxies may keep it. one that
+// follows the tip, boundHeight < 0, is only kept for a few seconds
+static void WriteCacheControl(HTTPRequest* req, int32_t boundHeight, int32_t tipHeight)
+{
+    if (boundHeight >= 0 && boundHeight <= tipHeight - REST_IMMUTABLE_DEPTH)
+        req->WriteHeader("Cache-Control", "public, max-age=31536000, immutable");
+    else
+        req->WriteHeader("Cache-Control", strprintf("public, max-age=%d", REST_TIP_MAX_AGE));
+}
+
+// writes an object in its serialized form for .bin and .hex, only the JSON reply is built from a UniValue
+template <typename T>
+static bool WriteObjectReply(HTTPRequest* req, enum RetFormat rf, const T& obj, const std::function<UniValue()>& toJSON)
+{
+    switch (rf) {
+    case RF_BINARY: {
+        CDataStream ssObj(SER_NETWORK, PROTOCOL_VERSION);
+        ssObj << obj;
+        req->WriteHeader("Content-Type", "application/octet-stream");
+        req->WriteReply(HTTP_OK, ssObj.str());
+        return true;
+    }
+
+    case RF_HEX: {
+        CDataStream ssObj(SER_NETWORK, PROTOCOL_VERSION);
+        ssObj << obj;
+        req->WriteHeader("Content-Type", "text/plain");
+        req->WriteReply(HTTP_OK, HexStr(ssObj.begin(), ssObj.end()) + "\n");
+        return true;
+    }
+
+    case RF_JSON: {
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, toJSON().write() + "\n");
+        return true;
+    }
+
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+}
+
 static bool rest_block(HTTPRequest* req,
                        const std::string& strURIPart,
                        bool showTxDetails)
@@ -354,33 +427,244 @@ static bool rest_tx(HTTPRequest* req, const std::string& strURIPart)
     if (!ParseHashStr(hashStr, hash))
         return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + hashStr);
 
-    CTransaction tx;
     uint256 hashBlock = uint256();
+
+    // the binary and hex forms are copied from the block file where they can be, without deserializing the transaction
+    if (rf == RF_BINARY || rf == RF_HEX) {
+        std::vector<unsigned char> rawTx;
+        if (!GetRawTransaction(hash, rawTx, hashBlock, true))
+            return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+        if (rf == RF_BINARY) {
+            req->WriteHeader("Content-Type", "application/octet-stream");
+            req->WriteReply(HTTP_OK, std::string(rawTx.begin(), rawTx.end()));
+        } else {
+            req->WriteHeader("Content-Type", "text/plain");
+            req->WriteReply(HTTP_OK, HexStr(rawTx.begin(), rawTx.end()) + "\n");
+        }
+        return true;
+    }
+
+    CTransaction tx;
     if (!GetTransaction(hash, tx, Params().GetConsensus(), hashBlock, true))
         return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
 
-    CDataStream ssTx(SER_NETWORK, PROTOCOL_VERSION);
-    ssTx << tx;
+    switch (rf) {
+    case RF_JSON: {
+        UniValue objTx(UniValue::VOBJ);
+        TxToJSON(tx, hashBlock, objTx);
+        string strJSON = objTx.write() + "\n";
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, strJSON);
+        return true;
+    }
+
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+
+    // not reached
+    return true; // continue to process further HTTP reqs on this cxn
+}
+
+// returns a currency definition as it was defined on chain. the URI is /rest/currency/<currency>.<ext>
+static bool rest_currency(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+
+    vector<string> path;
+    const RetFormat rf = ParsePathAndFormat(path, strURIPart);
+    if (rf == RF_UNDEF)
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    if (path.size() != 1 || path[0].empty())
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid URI format. Expected /rest/currency/<currency>.<ext>");
+
+    CCurrencyDefinition currencyDef;
+    int32_t defHeight = -1, tipHeight;
+    {
+        LOCK(cs_main);
+        tipHeight = chainActive.Height();
+        uint160 currencyID = ValidateCurrencyName(path[0]);
+        if (currencyID.IsNull() || !GetCurrencyDefinition(currencyID, currencyDef, &defHeight) || !currencyDef.IsValid())
+            return RESTERR(req, HTTP_NOT_FOUND, path[0] + " not found");
+    }
+
+    // a definition never changes once it is confirmed
+    WriteCacheControl(req, defHeight, tipHeight);
+    return WriteObjectReply(req, rf, currencyDef, [&currencyDef]() { return currencyDef.ToUniValue(); });
+}
+
+// returns the state of a currency at a height, or at the tip. the URI is /rest/currencystate/<currency>[/<height>].<ext>
+static bool rest_currencystate(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+
+    vector<string> path;
+    const RetFormat rf = ParsePathAndFormat(path, strURIPart);
+    if (rf == RF_UNDEF)
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    if (path.empty() || path.size() > 2 || path[0].empty())
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid URI format. Expected /rest/currencystate/<currency>/<height>.<ext>");
+
+    CCoinbaseCurrencyState currencyState;
+    int32_t height, tipHeight;
+    {
+        LOCK2(cs_main, mempool.cs);
+        tipHeight = chainActive.Height();
+        if (!ParseBoundHeight(req, path, 1, tipHeight, height))
+            return false;
+        uint160 currencyID = ValidateCurrencyName(path[0], true);
+        if (currencyID.IsNull())
+            return RESTERR(req, HTTP_NOT_FOUND, path[0] + " not found");
+        currencyState = ConnectedChains.GetCurrencyState(currencyID, height < 0 ? tipHeight : height);
+        if (!currencyState.IsValid())
+            return RESTERR(req, HTTP_NOT_FOUND, "No currency state for " + path[0]);
+    }
+
+    WriteCacheControl(req, height, tipHeight);
+    return WriteObjectReply(req, rf, currencyState, [&currencyState]() { return currencyState.ToUniValue(); });
+}
+
+// returns an identity as of a height, or at the tip. the URI is /rest/identity/<name@ or i-address>[/<height>].<ext>
+static bool rest_identity(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+
+    vector<string> path;
+    const RetFormat rf = ParsePathAndFormat(path, strURIPart);
+    if (rf == RF_UNDEF)
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    if (path.empty() || path.size() > 2 || path[0].empty())
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid URI format. Expected /rest/identity/<identity>/<height>.<ext>");
+
+    CTxDestination idDest = DecodeDestination(path[0]);
+    if (idDest.which() != COptCCParams::ADDRTYPE_ID)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid identity: " + path[0]);
+
+    CIdentity identity;
+    CTxIn idTxIn;
+    uint32_t idHeight = 0;
+    int32_t height, tipHeight;
+    {
+        LOCK(cs_main);
+        tipHeight = chainActive.Height();
+        if (!ParseBoundHeight(req, path, 1, tipHeight, height))
+            return false;
+        identity = CIdentity::LookupIdentity(CIdentityID(GetDestinationID(idDest)), height < 0 ? tipHeight : height, &idHeight, &idTxIn);
+        if (!identity.IsValid())
+            return RESTERR(req, HTTP_NOT_FOUND, path[0] + " not found");
+    }
+
+    WriteCacheControl(req, height, tipHeight);
+    return WriteObjectReply(req, rf, identity, [&]() {
+        UniValue ret(UniValue::VOBJ);
+        ret.pushKV("identity", identity.ToUniValue());
+        ret.pushKV("status", identity.IsRevoked() ? "revoked" : "active");
+        ret.pushKV("blockheight", (int64_t)idHeight);
+        ret.pushKV("txid", idTxIn.prevout.hash.GetHex());
+        ret.pushKV("vout", (int32_t)idTxIn.prevout.n);
+        return ret;
+    });
+}
+
+// returns the notarizations of a currency or system, from its last confirmed notarization, as getnotarizationdata does.
+// the URI is /rest/notarizations/<currency>.<ext>
+static bool rest_notarizations(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+
+    vector<string> path;
+    const RetFormat rf = ParsePathAndFormat(path, strURIPart);
+    if (rf == RF_UNDEF)
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    if (path.size() != 1 || path[0].empty())
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid URI format. Expected /rest/notarizations/<currency>.<ext>");
+
+    CChainNotarizationData nData;
+    int32_t tipHeight;
+    {
+        LOCK2(cs_main, mempool.cs);
+        tipHeight = chainActive.Height();
+        uint160 currencyID = ValidateCurrencyName(path[0], true);
+        if (currencyID.IsNull())
+            return RESTERR(req, HTTP_NOT_FOUND, path[0] + " not found");
+        if (!GetNotarizationData(currencyID, nData))
+            return RESTERR(req, HTTP_NOT_FOUND, "No notarizations for " + path[0]);
+    }
+
+    // notarizations are confirmed and pruned as the chain moves, so this follows the tip
+    WriteCacheControl(req, -1, tipHeight);
+    return WriteObjectReply(req, rf, nData, [&nData]() { return nData.ToUniValue(); });
+}
+
+// returns exports to a currency or system, as they are serialized on chain with their proofs and transfers, for relayers
+// that pass them to submitimports on another system. the URI is /rest/exports/<currency>[/<heightstart>[/<heightend>]].<ext>
+static bool rest_exports(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+
+    vector<string> path;
+    const RetFormat rf = ParsePathAndFormat(path, strURIPart);
+    if (path.empty() || path.size() > 3 || path[0].empty())
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid URI format. Expected /rest/exports/<currency>/<heightstart>/<heightend>.<ext>");
+
+    int32_t heightStart = 0, heightEnd = -1;
+    if ((path.size() > 1 && (!ParseInt32(path[1], &heightStart) || heightStart < 0)) ||
+        (path.size() > 2 && (!ParseInt32(path[2], &heightEnd) || heightEnd < 0)))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid height");
+
+    int32_t tipHeight;
+    {
+        LOCK(cs_main);
+        tipHeight = chainActive.Height();
+    }
+
+    std::vector<CExportForRelay> exports;
+    try {
+        exports = GetExportsForRelay(path[0], heightStart, heightEnd);
+    } catch (const UniValue& objError) {
+        return RESTERR(req, HTTP_BAD_REQUEST, find_value(objError, "message").get_str());
+    } catch (const std::exception& e) {
+        return RESTERR(req, HTTP_INTERNAL_SERVER_ERROR, e.what());
+    }
+
+    // exports and their proofs only stop changing with an end height, since new ones follow the tip without it
+    if (rf != RF_UNDEF)
+        WriteCacheControl(req, heightEnd > tipHeight ? -1 : heightEnd, tipHeight);
 
     switch (rf) {
     case RF_BINARY: {
-        string binaryTx = ssTx.str();
+        CDataStream ssExports(SER_NETWORK, PROTOCOL_VERSION);
+        ssExports << exports;
+        string binaryExports = ssExports.str();
         req->WriteHeader("Content-Type", "application/octet-stream");
-        req->WriteReply(HTTP_OK, binaryTx);
+        req->WriteReply(HTTP_OK, binaryExports);
         return true;
     }
 
     case RF_HEX: {
-        string strHex = HexStr(ssTx.begin(), ssTx.end()) + "\n";
+        // one serialized export per line, each of which can be passed to submitimports as is
+        string strHex;
+        for (auto &oneExport : exports) {
+            CDataStream ssExport(SER_NETWORK, PROTOCOL_VERSION);
+            ssExport << oneExport;
+            strHex += HexStr(ssExport.begin(), ssExport.end()) + "\n";
+        }
         req->WriteHeader("Content-Type", "text/plain");
         req->WriteReply(HTTP_OK, strHex);
         return true;
     }
 
     case RF_JSON: {
-        UniValue objTx(UniValue::VOBJ);
-        TxToJSON(tx, hashBlock, objTx);
-        string strJSON = objTx.write() + "\n";
+        UniValue exportsArr(UniValue::VARR);
+        for (auto &oneExport : exports)
+            exportsArr.push_back(ExportForRelayToUniValue(oneExport));
+        string strJSON = exportsArr.write() + "\n";
         req->WriteHeader("Content-Type", "application/json");
         req->WriteReply(HTTP_OK, strJSON);
         return true;
@@ -603,6 +887,11 @@ static const struct {
       {"/rest/mempool/contents", rest_mempool_contents},
       {"/rest/headers/", rest_headers},
       {"/rest/getutxos", rest_getutxos},
+      {"/rest/exports/", rest_exports},
+      {"/rest/currency/", rest_currency},
+      {"/rest/currencystate/", rest_currencystate},
+      {"/rest/identity/", rest_identity},
+      {"/rest/notarizations/", rest_notarizations},
 };
 
 bool StartREST()
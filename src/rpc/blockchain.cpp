@@ -4,20 +4,24 @@
 // file COPYING or https://www.opensource.org/licenses/mit-license.php .
 
 #include "amount.h"
+#include "blockstats.h"
 #include "chain.h"
 #include "chainparams.h"
 #include "checkpoints.h"
 #include "crosschain.h"
 #include "base58.h"
 #include "consensus/validation.h"
+#include "dbwrapper.h"
 #include "cc/eval.h"
 #include "key_io.h"
 #include "main.h"
 #include "primitives/transaction.h"
+#include "rpc/jsonstream.h"
 #include "rpc/server.h"
 #include "streams.h"
 #include "sync.h"
 #include "util.h"
+#include "utxostats.h"
 #include "script/script.h"
 #include "script/script_error.h"
 #include "script/sign.h"
@@ -29,10 +33,16 @@
 
 #include <univalue.h>
 
+#include <exception>
 #include <regex>
 
+#include <boost/thread.hpp>
+
 using namespace std;
 
+// blocks with fewer transactions than this have their transaction details written on the calling thread
+static const size_t PARALLEL_TX_JSON_MIN_TRANSACTIONS = 16;
+
 extern void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry);
 int32_t komodo_longestchain();
 
@@ -169,7 +179,8 @@ UniValue blockheaderToJSON(const CBlockIndex* blockindex)
     return result;
 }
 
-UniValue blockToDeltasJSON(const CBlock& block, const CBlockIndex* blockindex)
+// renders getblockdeltas from the header and delta summary of a block
+static UniValue blockDeltasToJSON(const CBlockHeader& block, const CBlockDeltaSummary& summary, const CBlockIndex* blockindex)
 {
     UniValue result(UniValue::VOBJ);
     result.push_back(Pair("hash", block.GetHash().GetHex()));
@@ -181,7 +192,7 @@ UniValue blockToDeltasJSON(const CBlock& block, const CBlockIndex* blockindex)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block is an orphan");
     }
     result.push_back(Pair("confirmations", confirmations));
-    result.push_back(Pair("size", (int)::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION)));
+    result.push_back(Pair("size", (int)summary.nSize));
     result.push_back(Pair("height", blockindex->GetHeight()));
     result.push_back(Pair("version", block.nVersion));
     result.push_back(Pair("merkleroot", block.hashMerkleRoot.GetHex()));
@@ -189,89 +200,40 @@ UniValue blockToDeltasJSON(const CBlock& block, const CBlockIndex* blockindex)
 
     UniValue deltas(UniValue::VARR);
 
-    for (unsigned int i = 0; i < block.vtx.size(); i++) {
-        const CTransaction &tx = block.vtx[i];
-        const uint256 txhash = tx.GetHash();
+    for (unsigned int i = 0; i < summary.txs.size(); i++) {
+        const CBlockDeltaTx &deltaTx = summary.txs[i];
 
         UniValue entry(UniValue::VOBJ);
-        entry.push_back(Pair("txid", txhash.GetHex()));
+        entry.push_back(Pair("txid", deltaTx.txid.GetHex()));
         entry.push_back(Pair("index", (int)i));
 
         UniValue inputs(UniValue::VARR);
-
-        if (!tx.IsCoinBase()) {
-
-            for (size_t j = 0; j < tx.vin.size(); j++) {
-                const CTxIn input = tx.vin[j];
-
-                UniValue delta(UniValue::VOBJ);
-
-                CSpentIndexValue spentInfo;
-                CSpentIndexKey spentKey(input.prevout.hash, input.prevout.n);
-
-                if (GetSpentIndex(spentKey, spentInfo)) {
-                    if (spentInfo.addressType == 1) {
-                        delta.push_back(Pair("address", CBitcoinAddress(CKeyID(spentInfo.addressHash)).ToString()));
-                    }
-                    else if (spentInfo.addressType == 2)  {
-                        delta.push_back(Pair("address", CBitcoinAddress(CScriptID(spentInfo.addressHash)).ToString()));
-                    }
-                    else {
-                        continue;
-                    }
-                    delta.push_back(Pair("satoshis", -1 * spentInfo.satoshis));
-                    delta.push_back(Pair("index", (int)j));
-                    delta.push_back(Pair("prevtxid", input.prevout.hash.GetHex()));
-                    delta.push_back(Pair("prevout", (int)input.prevout.n));
-
-                    inputs.push_back(delta);
-                } else {
-                    throw JSONRPCError(RPC_INTERNAL_ERROR, "Spent information not available");
-                }
-
-            }
+        for (const CBlockDeltaInput &input : deltaTx.inputs) {
+            uint160 addressHash = input.addressHash;
+            UniValue delta(UniValue::VOBJ);
+            delta.push_back(Pair("address", CBitcoinAddress(DestFromAddressHash(input.addressType, addressHash)).ToString()));
+            delta.push_back(Pair("satoshis", -1 * input.satoshis));
+            delta.push_back(Pair("index", (int)input.index));
+            delta.push_back(Pair("prevtxid", input.prevTxid.GetHex()));
+            delta.push_back(Pair("prevout", (int)input.prevOut));
+            inputs.push_back(delta);
         }
-
         entry.push_back(Pair("inputs", inputs));
 
         UniValue outputs(UniValue::VARR);
-
-        for (unsigned int k = 0; k < tx.vout.size(); k++) {
-            const CTxOut &out = tx.vout[k];
-
+        for (const CBlockDeltaOutput &output : deltaTx.outputs) {
+            uint160 addressHash = output.addressHash;
             UniValue delta(UniValue::VOBJ);
-
-            if (out.scriptPubKey.IsPayToScriptHash()) {
-                vector<unsigned char> hashBytes(out.scriptPubKey.begin()+2, out.scriptPubKey.begin()+22);
-                delta.push_back(Pair("address", CBitcoinAddress(CScriptID(uint160(hashBytes))).ToString()));
-
-            }
-            else if (out.scriptPubKey.IsPayToPublicKeyHash()) {
-                vector<unsigned char> hashBytes(out.scriptPubKey.begin()+3, out.scriptPubKey.begin()+23);
-                delta.push_back(Pair("address", CBitcoinAddress(CKeyID(uint160(hashBytes))).ToString()));
+            if (output.addressType != CScript::UNKNOWN) {
+                delta.push_back(Pair("address", CBitcoinAddress(DestFromAddressHash(output.addressType, addressHash)).ToString()));
             }
-            else if (out.scriptPubKey.IsPayToPublicKey() || out.scriptPubKey.IsPayToCryptoCondition()) {
-                CTxDestination address;
-                if (ExtractDestination(out.scriptPubKey, address))
-                {
-                    //vector<unsigned char> hashBytes(out.scriptPubKey.begin()+1, out.scriptPubKey.begin()+34);
-                    //xxx delta.push_back(Pair("address", CBitcoinAddress(CKeyID(uint160(hashBytes))).ToString()));
-                    delta.push_back(Pair("address", CBitcoinAddress(address).ToString()));
-                }
-            }
-            else {
-                continue;
-            }
-
-            delta.push_back(Pair("satoshis", out.nValue));
-            delta.push_back(Pair("index", (int)k));
-
+            delta.push_back(Pair("satoshis", output.satoshis));
+            delta.push_back(Pair("index", (int)output.index));
             outputs.push_back(delta);
         }
-
         entry.push_back(Pair("outputs", outputs));
-        deltas.push_back(entry);
 
+        deltas.push_back(entry);
     }
     result.push_back(Pair("deltas", deltas));
     result.push_back(Pair("time", block.GetBlockTime()));
@@ -297,7 +259,104 @@ UniValue blockToDeltasJSON(const CBlock& block, const CBlockIndex* blockindex)
     return result;
 }
 
-UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false)
+
+// builds the delta summary of a block that was connected without one, looking up its inputs in the spent index
+UniValue blockToDeltasJSON(const CBlock& block, const CBlockIndex* blockindex)
+{
+    // look up the spent information of all inputs at once, in key order
+    std::vector<CSpentIndexKey> spentKeys;
+    for (const CTransaction &tx : block.vtx) {
+        if (!tx.IsCoinBase()) {
+            for (const CTxIn &input : tx.vin) {
+                spentKeys.push_back(CSpentIndexKey(input.prevout.hash, input.prevout.n));
+            }
+        }
+    }
+    std::vector<CSpentIndexValue> spentInfos;
+    std::vector<unsigned char> spentFound;
+    GetSpentIndex(spentKeys, spentInfos, spentFound);
+    size_t nextSpent = 0;
+
+    CBlockDeltaSummary summary;
+    summary.nSize = ::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION);
+    summary.txs.resize(block.vtx.size());
+    for (unsigned int i = 0; i < block.vtx.size(); i++) {
+        const CTransaction &tx = block.vtx[i];
+        CBlockDeltaTx &deltaTx = summary.txs[i];
+        deltaTx.txid = tx.GetHash();
+
+        if (!tx.IsCoinBase()) {
+            for (size_t j = 0; j < tx.vin.size(); j++) {
+                const CSpentIndexValue &spentInfo = spentInfos[nextSpent];
+                if (!spentFound[nextSpent++]) {
+                    throw JSONRPCError(RPC_INTERNAL_ERROR, "Spent information not available");
+                }
+                if (spentInfo.addressType == CScript::P2PKH || spentInfo.addressType == CScript::P2SH) {
+                    deltaTx.inputs.push_back(CBlockDeltaInput(spentInfo.addressType, spentInfo.addressHash, spentInfo.satoshis, j,
+                                                              tx.vin[j].prevout.hash, tx.vin[j].prevout.n));
+                }
+            }
+        }
+        GetBlockDeltaOutputs(tx, deltaTx.outputs);
+    }
+
+    return blockDeltasToJSON(block, summary, blockindex);
+}
+
+// the details of each transaction of a block, in block order. those of large blocks are written in parallel, and as
+// with script checks, the workers rely on cs_main being held by this thread while it waits for them, so they must
+// never take it themselves
+static std::vector<UniValue> BlockTransactionsToJSON(const CBlock& block)
+{
+    AssertLockHeld(cs_main);
+    std::vector<UniValue> txs(block.vtx.size(), UniValue(UniValue::VOBJ));
+    size_t nThreads = block.vtx.size() < PARALLEL_TX_JSON_MIN_TRANSACTIONS ?
+                        1 :
+                        std::min((size_t)std::max(GetNumCores(), 1), block.vtx.size());
+    if (nThreads <= 1)
+    {
+        for (size_t i = 0; i < block.vtx.size(); i++)
+        {
+            TxToJSON(block.vtx[i], uint256(), txs[i]);
+        }
+        return txs;
+    }
+
+    size_t nPerThread = (block.vtx.size() + nThreads - 1) / nThreads;
+    std::vector<std::exception_ptr> errors(nThreads);
+    boost::thread_group jsonThreads;
+    for (size_t begin = 0, t = 0; begin < block.vtx.size(); begin += nPerThread, t++)
+    {
+        size_t end = std::min(begin + nPerThread, block.vtx.size());
+        jsonThreads.create_thread([&block, &txs, &errors, begin, end, t]()
+        {
+            try
+            {
+                for (size_t i = begin; i < end; i++)
+                {
+                    TxToJSON(block.vtx[i], uint256(), txs[i]);
+                }
+            }
+            catch (...)
+            {
+                errors[t] = std::current_exception();
+            }
+        });
+    }
+    jsonThreads.join_all();
+
+    for (auto &error : errors)
+    {
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+    return txs;
+}
+
+// with a read snapshot, confirmations and the next block are as of its tip, otherwise cs_main must be held
+UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails, const CChainReadSnapshot *pSnapshot)
 {
     UniValue result(UniValue::VOBJ);
     int32_t height = blockindex->GetHeight();
@@ -346,8 +405,8 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool tx
 
     int confirmations = -1;
     // Only report confirmations if the block is on the main chain
-    if (chainActive.Contains(blockindex))
-        confirmations = chainActive.Height() - blockindex->GetHeight() + 1;
+    if (pSnapshot ? pSnapshot->Contains(blockindex) : chainActive.Contains(blockindex))
+        confirmations = (pSnapshot ? pSnapshot->Height() : chainActive.Height()) - blockindex->GetHeight() + 1;
     result.push_back(Pair("confirmations", confirmations));
     result.push_back(Pair("size", (int)::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION)));
     result.push_back(Pair("height", blockindex->GetHeight()));
@@ -356,15 +415,13 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool tx
     result.push_back(Pair("segid", (int64_t)blockindex->segid));
     result.push_back(Pair("finalsaplingroot", block.hashFinalSaplingRoot.GetHex()));
     UniValue txs(UniValue::VARR);
-    BOOST_FOREACH(const CTransaction&tx, block.vtx)
+    if (txDetails)
     {
-        if(txDetails)
-        {
-            UniValue objTx(UniValue::VOBJ);
-            TxToJSON(tx, uint256(), objTx);
-            txs.push_back(objTx);
-        }
-        else
+        txs.push_backV(BlockTransactionsToJSON(block));
+    }
+    else
+    {
+        BOOST_FOREACH(const CTransaction&tx, block.vtx)
             txs.push_back(tx.GetHash().GetHex());
     }
     result.push_back(Pair("tx", txs));
@@ -385,12 +442,17 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool tx
 
     if (blockindex->pprev)
         result.push_back(Pair("previousblockhash", blockindex->pprev->GetBlockHash().GetHex()));
-    CBlockIndex *pnext = chainActive.Next(blockindex);
+    const CBlockIndex *pnext = pSnapshot ? pSnapshot->Next(blockindex) : chainActive.Next(blockindex);
     if (pnext)
         result.push_back(Pair("nextblockhash", pnext->GetBlockHash().GetHex()));
     return result;
 }
 
+UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false)
+{
+    return blockToJSON(block, blockindex, txDetails, nullptr);
+}
+
 UniValue getblockcount(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() != 0)
@@ -460,6 +522,34 @@ bool myIsutxo_spentinmempool(uint256 txid,int32_t vout)
     return(false);
 }
 
+// the verbose getrawmempool entry of one transaction, requires mempool.cs
+static UniValue mempoolEntryToJSON(const CTxMemPoolEntry& e)
+{
+    UniValue info(UniValue::VOBJ);
+    info.push_back(Pair("size", (int)e.GetTxSize()));
+    info.push_back(Pair("fee", ValueFromAmount(e.GetFee())));
+    info.push_back(Pair("time", e.GetTime()));
+    info.push_back(Pair("height", (int)e.GetHeight()));
+    info.push_back(Pair("startingpriority", e.GetPriority(e.GetHeight())));
+    info.push_back(Pair("currentpriority", e.GetPriority(chainActive.Height())));
+    const CTransaction& tx = e.GetTx();
+    set<string> setDepends;
+    BOOST_FOREACH(const CTxIn& txin, tx.vin)
+    {
+        if (mempool.exists(txin.prevout.hash))
+            setDepends.insert(txin.prevout.hash.ToString());
+    }
+
+    UniValue depends(UniValue::VARR);
+    BOOST_FOREACH(const string& dep, setDepends)
+    {
+        depends.push_back(dep);
+    }
+
+    info.push_back(Pair("depends", depends));
+    return info;
+}
+
 UniValue mempoolToJSON(bool fVerbose = false)
 {
     if (fVerbose)
@@ -468,30 +558,7 @@ UniValue mempoolToJSON(bool fVerbose = false)
         UniValue o(UniValue::VOBJ);
         BOOST_FOREACH(const CTxMemPoolEntry& e, mempool.mapTx)
         {
-            const uint256& hash = e.GetTx().GetHash();
-            UniValue info(UniValue::VOBJ);
-            info.push_back(Pair("size", (int)e.GetTxSize()));
-            info.push_back(Pair("fee", ValueFromAmount(e.GetFee())));
-            info.push_back(Pair("time", e.GetTime()));
-            info.push_back(Pair("height", (int)e.GetHeight()));
-            info.push_back(Pair("startingpriority", e.GetPriority(e.GetHeight())));
-            info.push_back(Pair("currentpriority", e.GetPriority(chainActive.Height())));
-            const CTransaction& tx = e.GetTx();
-            set<string> setDepends;
-            BOOST_FOREACH(const CTxIn& txin, tx.vin)
-            {
-                if (mempool.exists(txin.prevout.hash))
-                    setDepends.insert(txin.prevout.hash.ToString());
-            }
-
-            UniValue depends(UniValue::VARR);
-            BOOST_FOREACH(const string& dep, setDepends)
-            {
-                depends.push_back(dep);
-            }
-
-            info.push_back(Pair("depends", depends));
-            o.push_back(Pair(hash.ToString(), info));
+            o.push_back(Pair(e.GetTx().GetHash().ToString(), mempoolEntryToJSON(e)));
         }
         return o;
     }
@@ -510,17 +577,24 @@ UniValue mempoolToJSON(bool fVerbose = false)
 
 UniValue getrawmempool(const UniValue& params, bool fHelp)
 {
-    if (fHelp || params.size() > 1)
+    if (fHelp || params.size() > 2)
         throw runtime_error(
-            "getrawmempool ( verbose )\n"
+            "getrawmempool ( verbose mempool_sequence )\n"
             "\nReturns all transaction ids in memory pool as a json array of string transaction ids.\n"
             "\nArguments:\n"
             "1. verbose           (boolean, optional, default=false) true for a json object, false for array of transaction ids\n"
+            "2. mempool_sequence  (boolean, optional, default=false) with verbose false, also return the mempool sequence,\n"
+            "                     which getmempoolchanges returns the changes since\n"
             "\nResult: (for verbose = false):\n"
             "[                     (json array of string)\n"
             "  \"transactionid\"     (string) The transaction id\n"
             "  ,...\n"
             "]\n"
+            "\nResult: (for verbose = false and mempool_sequence = true):\n"
+            "{\n"
+            "  \"txids\" : [\"transactionid\", ...],   (json array of string) The transaction ids\n"
+            "  \"mempool_sequence\" : n                (numeric) The mempool sequence of this list\n"
+            "}\n"
             "\nResult: (for verbose = true):\n"
             "{                           (json object)\n"
             "  \"transactionid\" : {       (json object)\n"
@@ -537,6 +611,7 @@ UniValue getrawmempool(const UniValue& params, bool fHelp)
             "}\n"
             "\nExamples\n"
             + HelpExampleCli("getrawmempool", "true")
+            + HelpExampleCli("getrawmempool", "false true")
             + HelpExampleRpc("getrawmempool", "true")
         );
 
@@ -546,9 +621,127 @@ UniValue getrawmempool(const UniValue& params, bool fHelp)
     if (params.size() > 0)
         fVerbose = params[0].get_bool();
 
+    bool fSequence = false;
+    if (params.size() > 1)
+        fSequence = params[1].get_bool();
+
+    if (fSequence)
+    {
+        if (fVerbose)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Verbose results cannot contain mempool sequence values");
+
+        // the list and its sequence are read under the same lock, so no change falls between them
+        LOCK(mempool.cs);
+        UniValue result(UniValue::VOBJ);
+        result.push_back(Pair("txids", mempoolToJSON(false)));
+        result.push_back(Pair("mempool_sequence", (uint64_t)mempool.GetSequence()));
+        return result;
+    }
+
     return mempoolToJSON(fVerbose);
 }
 
+UniValue getmempoolchanges(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() < 1 || params.size() > 2)
+        throw runtime_error(
+            "getmempoolchanges mempool_sequence ( verbose )\n"
+            "\nReturns the transactions added to and removed from the memory pool since a mempool sequence returned by\n"
+            "getrawmempool or by an earlier call, so a copy of the mempool can be kept without reading all of it each time.\n"
+            "A transaction both added and removed since then is in neither list. Only the most recent changes are kept,\n"
+            "and if those since mempool_sequence are not, getrawmempool must be called again.\n"
+            "\nArguments:\n"
+            "1. mempool_sequence  (numeric, required) the mempool sequence the changes are since\n"
+            "2. verbose           (boolean, optional, default=false) true to describe each added transaction as getrawmempool does\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"added\" : [\"transactionid\", ...] | { \"transactionid\" : {...}, ... },  (array or object) transactions added\n"
+            "  \"removed\" : [\"transactionid\", ...],     (json array of string) transactions removed, mined or replaced\n"
+            "  \"mempool_sequence\" : n                  (numeric) the mempool sequence to ask for the next changes since\n"
+            "}\n"
+            "\nExamples\n"
+            + HelpExampleCli("getmempoolchanges", "1234")
+            + HelpExampleRpc("getmempoolchanges", "1234, true")
+        );
+
+    int64_t sequence = params[0].get_int64();
+    if (sequence < 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid mempool sequence");
+
+    bool fVerbose = false;
+    if (params.size() > 1)
+        fVerbose = params[1].get_bool();
+
+    LOCK2(cs_main, mempool.cs);
+    std::vector<uint256> added, removed;
+    if (!mempool.GetChangesSince(sequence, added, removed))
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Changes since this mempool sequence are no longer kept, call getrawmempool with mempool_sequence true");
+
+    UniValue result(UniValue::VOBJ);
+    if (fVerbose)
+    {
+        UniValue addedObj(UniValue::VOBJ);
+        for (const uint256 &hash : added)
+        {
+            CTxMemPool::indexed_transaction_set::const_iterator it = mempool.mapTx.find(hash);
+            if (it != mempool.mapTx.end())
+                addedObj.push_back(Pair(hash.ToString(), mempoolEntryToJSON(*it)));
+        }
+        result.push_back(Pair("added", addedObj));
+    }
+    else
+    {
+        UniValue addedArr(UniValue::VARR);
+        for (const uint256 &hash : added)
+            addedArr.push_back(hash.ToString());
+        result.push_back(Pair("added", addedArr));
+    }
+    UniValue removedArr(UniValue::VARR);
+    for (const uint256 &hash : removed)
+        removedArr.push_back(hash.ToString());
+    result.push_back(Pair("removed", removedArr));
+    result.push_back(Pair("mempool_sequence", (uint64_t)mempool.GetSequence()));
+    return result;
+}
+
+// getrawmempool with each transaction written as it is described, rather than as one tree with the whole mempool
+static void getrawmempool_stream(const UniValue& params, CJSONStreamWriter& out)
+{
+    if (params.size() > 2)
+        getrawmempool(params, true);
+
+    bool fVerbose = false;
+    if (params.size() > 0)
+        fVerbose = params[0].get_bool();
+
+    // the mempool sequence form is small, and is only one more value than the transaction ids
+    if (params.size() > 1 && params[1].get_bool())
+    {
+        out.Value(getrawmempool(params, false));
+        return;
+    }
+
+    if (!fVerbose)
+    {
+        vector<uint256> vtxid;
+        mempool.queryHashes(vtxid);
+        out.BeginArray();
+        BOOST_FOREACH(const uint256& hash, vtxid)
+            out.Value(hash.ToString());
+        out.EndArray();
+        return;
+    }
+
+    LOCK2(cs_main, mempool.cs);
+    out.BeginObject();
+    BOOST_FOREACH(const CTxMemPoolEntry& e, mempool.mapTx)
+    {
+        out.Key(e.GetTx().GetHash().ToString());
+        out.Value(mempoolEntryToJSON(e));
+    }
+    out.EndObject();
+}
+
 UniValue getblockdeltas(const UniValue& params, bool fHelp)
 {
     std::string enableArg = "insightexplorer";
@@ -622,6 +815,10 @@ UniValue getblockdeltas(const UniValue& params, bool fHelp)
     CBlock block;
     CBlockIndex* pblockindex = mapBlockIndex[hash];
 
+    CBlockDeltaSummary summary;
+    if (GetBlockDeltaSummary(hash, summary))
+        return blockDeltasToJSON(pblockindex->GetBlockHeader(), summary, pblockindex);
+
     if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
         throw JSONRPCError(RPC_INTERNAL_ERROR, "Block not available (pruned data)");
 
@@ -631,6 +828,205 @@ UniValue getblockdeltas(const UniValue& params, bool fHelp)
     return blockToDeltasJSON(block, pblockindex);
 }
 
+UniValue getblockfilter(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() < 1 || params.size() > 2)
+        throw runtime_error(
+            "getblockfilter \"blockhash\" ( \"filtertype\" )\n"
+            "\nReturns the BIP158 compact filter of a block and its filter header, with -blockfilterindex.\n"
+            "The filter also holds the destination and identity IDs of the crypto-condition outputs the block\n"
+            "creates or spends.\n"
+            "\nArguments:\n"
+            "1. \"blockhash\"       (string, required) The block hash\n"
+            "2. \"filtertype\"      (string, optional, default=\"basic\") The filter type, only \"basic\" is supported\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"filter\": \"hex\",     (string) the serialized filter\n"
+            "  \"header\": \"hash\"     (string) the filter header, which commits to the filters of all earlier blocks\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getblockfilter", "00227e566682aebd6a7a5b772c96d7a999cadaebeaf1ce96f4191a3aad58b00b")
+            + HelpExampleRpc("getblockfilter", "\"00227e566682aebd6a7a5b772c96d7a999cadaebeaf1ce96f4191a3aad58b00b\"")
+        );
+
+    if (!fBlockFilterIndex)
+        throw JSONRPCError(RPC_MISC_ERROR, "Block filter index is not enabled, restart with -blockfilterindex");
+    if (params.size() > 1 && params[1].get_str() != "basic")
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Unknown filtertype");
+
+    uint256 hash(uint256S(params[0].get_str()));
+    {
+        LOCK(cs_main);
+        if (mapBlockIndex.count(hash) == 0)
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+    }
+
+    CBlockFilterIndexEntry entry;
+    if (!GetBlockFilter(hash, entry)) {
+        if (IsIndexBuilding(BACKGROUND_INDEX_BLOCKFILTER))
+            throw JSONRPCError(RPC_IN_WARMUP, "Block filter index is still being built, see getindexinfo for its progress");
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No filter for this block, it has not been connected");
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("filter", HexStr(entry.filter)));
+    ret.push_back(Pair("header", entry.header.GetHex()));
+    return ret;
+}
+
+// most blocks one getblockstats call reports
+static const int MAX_GETBLOCKSTATS_RANGE = 10000;
+
+static void blockStatsToJSON(const CBlockStats &stats, UniValue &result)
+{
+    result.push_back(Pair("txs", (uint64_t)stats.nTx));
+    result.push_back(Pair("size", (uint64_t)stats.nSize));
+    result.push_back(Pair("ins", (uint64_t)stats.nInputs));
+    result.push_back(Pair("outs", (uint64_t)stats.nOutputs));
+    result.push_back(Pair("total_out", ValueFromAmount(stats.nTotalOut)));
+    result.push_back(Pair("totalfee", ValueFromAmount(stats.nFees)));
+    result.push_back(Pair("minfee", ValueFromAmount(stats.nMinFee)));
+    result.push_back(Pair("maxfee", ValueFromAmount(stats.nMaxFee)));
+    result.push_back(Pair("reservefees", stats.reserveFees.ToUniValue()));
+    result.push_back(Pair("reservetransfers", (uint64_t)stats.nReserveTransfers));
+    result.push_back(Pair("conversions", (uint64_t)stats.nConversions));
+    result.push_back(Pair("imports", (uint64_t)stats.nImports));
+    result.push_back(Pair("exports", (uint64_t)stats.nExports));
+    result.push_back(Pair("identityregistrations", (uint64_t)stats.nIdentityRegistrations));
+    result.push_back(Pair("identityupdates", (uint64_t)stats.nIdentityUpdates));
+    result.push_back(Pair("currencydefinitions", (uint64_t)stats.nCurrencyDefinitions));
+    result.push_back(Pair("notarizations", (uint64_t)stats.nNotarizations));
+    result.push_back(Pair("shieldedtxs", (uint64_t)stats.nShieldedTxs));
+    result.push_back(Pair("shieldedspends", (uint64_t)stats.nShieldedSpends));
+    result.push_back(Pair("shieldedoutputs", (uint64_t)stats.nShieldedOutputs));
+    result.push_back(Pair("joinsplits", (uint64_t)stats.nJoinSplits));
+}
+
+// sums the statistics of a range, the minimum and maximum fees being those of the whole range. fHaveFees is set once
+// a block with a transaction other than its coinbase has been added
+static void AddBlockStats(CBlockStats &totals, const CBlockStats &stats, bool &fHaveFees)
+{
+    if (stats.nTx > 1)
+    {
+        totals.nMinFee = fHaveFees ? std::min(totals.nMinFee, stats.nMinFee) : stats.nMinFee;
+        totals.nMaxFee = std::max(totals.nMaxFee, stats.nMaxFee);
+        fHaveFees = true;
+    }
+    totals.nTx += stats.nTx;
+    totals.nSize += stats.nSize;
+    totals.nInputs += stats.nInputs;
+    totals.nOutputs += stats.nOutputs;
+    totals.nTotalOut += stats.nTotalOut;
+    totals.nFees += stats.nFees;
+    totals.reserveFees += stats.reserveFees;
+    totals.nReserveTransfers += stats.nReserveTransfers;
+    totals.nConversions += stats.nConversions;
+    totals.nImports += stats.nImports;
+    totals.nExports += stats.nExports;
+    totals.nIdentityRegistrations += stats.nIdentityRegistrations;
+    totals.nIdentityUpdates += stats.nIdentityUpdates;
+    totals.nCurrencyDefinitions += stats.nCurrencyDefinitions;
+    totals.nNotarizations += stats.nNotarizations;
+    totals.nShieldedTxs += stats.nShieldedTxs;
+    totals.nShieldedSpends += stats.nShieldedSpends;
+    totals.nShieldedOutputs += stats.nShieldedOutputs;
+    totals.nJoinSplits += stats.nJoinSplits;
+}
+
+UniValue getblockstats(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() < 1 || params.size() > 2)
+        throw runtime_error(
+            "getblockstats startheight ( endheight )\n"
+            "\nReturns the statistics of each block of the active chain from startheight through endheight, and their totals,\n"
+            "with -blockstatsindex. They are stored as each block is connected, so no block is read.\n"
+            "\nArguments:\n"
+            "1. startheight     (numeric, required) The height of the first block, at least 1\n"
+            "2. endheight       (numeric, optional, default=startheight) The height of the last block, at most " + std::to_string(MAX_GETBLOCKSTATS_RANGE) + " blocks after the first\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"blocks\": [\n"
+            "    {\n"
+            "      \"height\": n,                  (numeric) The height of the block\n"
+            "      \"blockhash\": \"hash\",          (string) The block hash\n"
+            "      \"time\": n,                    (numeric) The block time\n"
+            "      \"txs\": n,                     (numeric) The number of transactions, including the coinbase\n"
+            "      \"size\": n,                    (numeric) The size of the block in bytes\n"
+            "      \"ins\": n,                     (numeric) The number of transparent inputs\n"
+            "      \"outs\": n,                    (numeric) The number of transparent outputs\n"
+            "      \"total_out\": n,               (numeric) The transparent native value out, excluding the coinbase\n"
+            "      \"totalfee\": n,                (numeric) The native fees of the transactions\n"
+            "      \"minfee\": n,                  (numeric) The lowest native fee of a transaction other than the coinbase\n"
+            "      \"maxfee\": n,                  (numeric) The highest native fee of a transaction other than the coinbase\n"
+            "      \"reservefees\": {...},         (object) The fees paid in other currencies, by currency ID\n"
+            "      \"reservetransfers\": n,        (numeric) The reserve transfer outputs\n"
+            "      \"conversions\": n,             (numeric) The reserve transfers that convert or preconvert\n"
+            "      \"imports\": n,                 (numeric) The import transactions\n"
+            "      \"exports\": n,                 (numeric) The export transactions\n"
+            "      \"identityregistrations\": n,   (numeric) The transactions that define identities\n"
+            "      \"identityupdates\": n,         (numeric) The other transactions that update identities\n"
+            "      \"currencydefinitions\": n,     (numeric) The transactions that define currencies\n"
+            "      \"notarizations\": n,           (numeric) The notarization and chain connection transactions\n"
+            "      \"shieldedtxs\": n,             (numeric) The transactions with any Sapling spend or output or JoinSplit\n"
+            "      \"shieldedspends\": n,          (numeric) The Sapling spends\n"
+            "      \"shieldedoutputs\": n,         (numeric) The Sapling outputs\n"
+            "      \"joinsplits\": n               (numeric) The JoinSplits\n"
+            "    }, ...\n"
+            "  ],\n"
+            "  \"totals\": {...}                (object) The sums of the statistics of the blocks, and their lowest and highest fees\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getblockstats", "1000 2000")
+            + HelpExampleRpc("getblockstats", "1000, 2000")
+        );
+
+    if (!fBlockStatsIndex)
+        throw JSONRPCError(RPC_MISC_ERROR, "Block stats index is not enabled, restart with -blockstatsindex");
+
+    int startHeight = params[0].get_int();
+    int endHeight = params.size() > 1 ? params[1].get_int() : startHeight;
+    if (startHeight < 1 || endHeight < startHeight)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid range, startheight must be at least 1 and no greater than endheight");
+    if (endHeight - startHeight >= MAX_GETBLOCKSTATS_RANGE)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Range too large, at most %d blocks are reported at once", MAX_GETBLOCKSTATS_RANGE));
+
+    std::vector<std::pair<uint256, int64_t>> blocks;
+    {
+        LOCK(cs_main);
+        if (endHeight > chainActive.Height())
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
+        for (int height = startHeight; height <= endHeight; height++)
+        {
+            blocks.push_back(std::make_pair(chainActive[height]->GetBlockHash(), (int64_t)chainActive[height]->nTime));
+        }
+    }
+
+    UniValue blocksUni(UniValue::VARR);
+    CBlockStats totals;
+    bool fHaveFees = false;
+    for (size_t i = 0; i < blocks.size(); i++)
+    {
+        CBlockStats stats;
+        if (!GetBlockStats(blocks[i].first, stats))
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, strprintf("No stats for the block at height %d, it was connected before -blockstatsindex was enabled", startHeight + (int)i));
+        AddBlockStats(totals, stats, fHaveFees);
+
+        UniValue oneBlock(UniValue::VOBJ);
+        oneBlock.push_back(Pair("height", startHeight + (int)i));
+        oneBlock.push_back(Pair("blockhash", blocks[i].first.GetHex()));
+        oneBlock.push_back(Pair("time", blocks[i].second));
+        blockStatsToJSON(stats, oneBlock);
+        blocksUni.push_back(oneBlock);
+    }
+
+    UniValue totalsUni(UniValue::VOBJ);
+    blockStatsToJSON(totals, totalsUni);
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("blocks", blocksUni));
+    ret.push_back(Pair("totals", totalsUni));
+    return ret;
+}
+
 UniValue getblockhashes(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() < 2)
@@ -679,6 +1075,10 @@ UniValue getblockhashes(const UniValue& params, bool fHelp)
         }
     }
 
+    if (fTimestampIndex && IsIndexBuilding(BACKGROUND_INDEX_TIMESTAMP)) {
+        throw JSONRPCError(RPC_IN_WARMUP, "Timestamp index is still being built, see getindexinfo for its progress");
+    }
+
     std::vector<std::pair<uint256, unsigned int> > blockHashes;
 
     if (fActiveOnly)
@@ -821,10 +1221,9 @@ UniValue z_gettreestate(const UniValue& params, bool fHelp)
         sapling_commitments.pushKV("finalRoot", pindex->hashFinalSaplingRoot.GetHex());
         bool need_skiphash = false;
         SaplingMerkleTree tree;
-        if (pcoinsTip->GetSaplingAnchorAt(pindex->hashFinalSaplingRoot, tree)) {
-            CDataStream s(SER_NETWORK, PROTOCOL_VERSION);
-            s << tree;
-            sapling_commitments.pushKV("finalState", HexStr(s.begin(), s.end()));
+        std::vector<std::shared_ptr<const std::vector<unsigned char>>> treeStates;
+        if (GetSaplingTreeStates(std::vector<uint256>(1, pindex->hashFinalSaplingRoot), treeStates)) {
+            sapling_commitments.pushKV("finalState", HexStr(*treeStates[0]));
         } else {
             // Set skipHash to the most recent block that has a finalState.
             const CBlockIndex* pindex_skip = pindex->pprev;
@@ -980,29 +1379,123 @@ UniValue getblockheader(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getblockheader", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\"")
         );
 
-    LOCK(cs_main);
+    LOCK(cs_main);
+
+    std::string strHash = params[0].get_str();
+    uint256 hash(uint256S(strHash));
+
+    bool fVerbose = true;
+    if (params.size() > 1)
+        fVerbose = params[1].get_bool();
+
+    if (mapBlockIndex.count(hash) == 0)
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+
+    CBlockIndex* pblockindex = mapBlockIndex[hash];
+
+    if (!fVerbose)
+    {
+        CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
+        ssBlock << pblockindex->GetBlockHeader();
+        std::string strHex = HexStr(ssBlock.begin(), ssBlock.end());
+        return strHex;
+    }
+
+    return blockheaderToJSON(pblockindex);
+}
+
+// finds and reads the block a getblock call asks for, cs_main is only held to look it up
+static void ReadRequestedBlock(const UniValue& params, const CChainReadSnapshot& snapshot,
+                               CBlock& block, CBlockIndex*& pblockindex, int& verbosity)
+{
+    std::string strHash = params[0].get_str();
+
+    // If height is supplied, find the hash
+    if (strHash.size() < (2 * sizeof(uint256))) {
+        // std::stoi allows characters, whereas we want to be strict
+        regex r("[[:digit:]]+");
+        if (!regex_match(strHash, r)) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid block height parameter");
+        }
+
+        int nHeight = -1;
+        try {
+            nHeight = std::stoi(strHash);
+        }
+        catch (const std::exception &e) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid block height parameter");
+        }
+
+        if (nHeight < 0 || nHeight > snapshot.Height()) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
+        }
+        strHash = snapshot[nHeight]->GetBlockHash().GetHex();
+    }
+
+    uint256 hash(uint256S(strHash));
+
+    verbosity = 1;
+    if (params.size() > 1) {
+        if(params[1].isNum()) {
+            verbosity = params[1].get_int();
+        } else {
+            verbosity = params[1].get_bool() ? 1 : 0;
+        }
+    }
+
+    if (verbosity < 0 || verbosity > 2) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Verbosity must be in range from 0 to 2");
+    }
 
-    std::string strHash = params[0].get_str();
-    uint256 hash(uint256S(strHash));
+    CDiskBlockPos blockPos;
+    {
+        LOCK(cs_main);
+        BlockMap::iterator mi = mapBlockIndex.find(hash);
+        if (mi == mapBlockIndex.end() || !mi->second)
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+        pblockindex = mi->second;
 
-    bool fVerbose = true;
-    if (params.size() > 1)
-        fVerbose = params[1].get_bool();
+        if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Block not available (pruned data)");
+        blockPos = pblockindex->GetBlockPos();
+    }
 
-    if (mapBlockIndex.count(hash) == 0)
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+    if (!ReadBlockFromDisk(pblockindex->GetHeight(), block, blockPos, Params().GetConsensus(), 1) ||
+        block.GetHash() != pblockindex->GetBlockHash())
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
+}
 
-    CBlockIndex* pblockindex = mapBlockIndex[hash];
+// the getblock result at verbosity 1 or 2
+static UniValue RequestedBlockToJSON(const CBlock& block, CBlockIndex* pblockindex, int verbosity, const CChainReadSnapshot& snapshot)
+{
+    UniValue blockUni;
+    if (verbosity >= 2)
+    {
+        // transaction details look up the coins view and block index
+        LOCK(cs_main);
+        blockUni = blockToJSON(block, pblockindex, true, &snapshot);
+    }
+    else
+    {
+        blockUni = blockToJSON(block, pblockindex, false, &snapshot);
+    }
 
-    if (!fVerbose)
     {
-        CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
-        ssBlock << pblockindex->GetBlockHeader();
-        std::string strHex = HexStr(ssBlock.begin(), ssBlock.end());
-        return strHex;
+        LOCK(cs_main);
+        blockUni.pushKV("proofroot", CProofRoot::GetProofRoot(pblockindex->GetHeight()).ToUniValue());
+    }
+    if (CConstVerusSolutionVector::GetVersionByHeight(pblockindex->GetHeight()) >= CActivationHeight::ACTIVATE_PBAAS_HEADER)
+    {
+        blockUni.pushKV("prevmmrroot", block.GetPrevMMRRoot().GetHex());
     }
+    return blockUni;
+}
 
-    return blockheaderToJSON(pblockindex);
+static std::string BlockToHex(const CBlock& block)
+{
+    CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
+    ssBlock << block;
+    return HexStr(ssBlock.begin(), ssBlock.end());
 }
 
 UniValue getblock(const UniValue& params, bool fHelp)
@@ -1053,102 +1546,130 @@ UniValue getblock(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getblock", "12800")
         );
 
-    LOCK(cs_main);
-
-    std::string strHash = params[0].get_str();
-
-    // If height is supplied, find the hash
-    if (strHash.size() < (2 * sizeof(uint256))) {
-        // std::stoi allows characters, whereas we want to be strict
-        regex r("[[:digit:]]+");
-        if (!regex_match(strHash, r)) {
-            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid block height parameter");
-        }
-
-        int nHeight = -1;
-        try {
-            nHeight = std::stoi(strHash);
-        }
-        catch (const std::exception &e) {
-            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid block height parameter");
-        }
-
-        if (nHeight < 0 || nHeight > chainActive.Height()) {
-            throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
-        }
-        strHash = chainActive[nHeight]->GetBlockHash().GetHex();
-    }
+    // the block is found, read and described without cs_main, against the chain as of one tip
+    std::shared_ptr<const CChainReadSnapshot> snapshot = GetChainReadSnapshot();
 
-    uint256 hash(uint256S(strHash));
+    CBlock block;
+    CBlockIndex* pblockindex;
+    int verbosity;
+    ReadRequestedBlock(params, *snapshot, block, pblockindex, verbosity);
 
-    int verbosity = 1;
-    if (params.size() > 1) {
-        if(params[1].isNum()) {
-            verbosity = params[1].get_int();
-        } else {
-            verbosity = params[1].get_bool() ? 1 : 0;
-        }
-    }
+    if (verbosity == 0)
+        return BlockToHex(block);
+    return RequestedBlockToJSON(block, pblockindex, verbosity, *snapshot);
+}
 
-    if (verbosity < 0 || verbosity > 2) {
-        throw JSONRPCError(RPC_INVALID_PARAMETER, "Verbosity must be in range from 0 to 2");
-    }
+// getblock with its transactions written one at a time, rather than as one tree with the whole block
+static void getblock_stream(const UniValue& params, CJSONStreamWriter& out)
+{
+    if (params.size() < 1 || params.size() > 2)
+        getblock(params, true);
 
-    if (mapBlockIndex.count(hash) == 0)
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+    std::shared_ptr<const CChainReadSnapshot> snapshot = GetChainReadSnapshot();
 
     CBlock block;
-    CBlockIndex* pblockindex = mapBlockIndex[hash];
-
-    if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
-        throw JSONRPCError(RPC_INTERNAL_ERROR, "Block not available (pruned data)");
-
-    if(!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus(), 1))
-        throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
+    CBlockIndex* pblockindex;
+    int verbosity;
+    ReadRequestedBlock(params, *snapshot, block, pblockindex, verbosity);
 
-    if (verbosity == 0)
+    if (verbosity < 2)
     {
-        CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
-        ssBlock << block;
-        std::string strHex = HexStr(ssBlock.begin(), ssBlock.end());
-        return strHex;
+        out.Value(verbosity == 0 ? UniValue(BlockToHex(block)) : RequestedBlockToJSON(block, pblockindex, verbosity, *snapshot));
+        return;
     }
-    UniValue blockUni = blockToJSON(block, pblockindex, verbosity >= 2);
-    if (pblockindex)
+
+    // the verbosity 1 result, with its transaction ids replaced by the transactions as they are written
+    UniValue blockUni = RequestedBlockToJSON(block, pblockindex, 1, *snapshot);
+    const std::vector<std::string>& keys = blockUni.getKeys();
+    const std::vector<UniValue>& values = blockUni.getValues();
+    out.BeginObject();
+    for (size_t i = 0; i < keys.size(); i++)
     {
-        blockUni.pushKV("proofroot", CProofRoot::GetProofRoot(pblockindex->GetHeight()).ToUniValue());
-        if (CConstVerusSolutionVector::GetVersionByHeight(pblockindex->GetHeight()) >= CActivationHeight::ACTIVATE_PBAAS_HEADER)
+        out.Key(keys[i]);
+        if (keys[i] != "tx")
         {
-            blockUni.pushKV("prevmmrroot", block.GetPrevMMRRoot().GetHex());
+            out.Value(values[i]);
+            continue;
         }
+        std::vector<UniValue> txs;
+        {
+            LOCK(cs_main);
+            txs = BlockTransactionsToJSON(block);
+        }
+        out.BeginArray();
+        for (const UniValue& objTx : txs)
+        {
+            out.Value(objTx);
+        }
+        out.EndArray();
     }
-    return blockUni;
+    out.EndObject();
 }
 
 UniValue gettxoutsetinfo(const UniValue& params, bool fHelp)
 {
-    if (fHelp || params.size() != 0)
+    if (fHelp || params.size() > 1)
         throw runtime_error(
-            "gettxoutsetinfo\n"
+            "gettxoutsetinfo ( \"hash_type\" )\n"
             "\nReturns statistics about the unspent transaction output set.\n"
-            "Note this call may take some time.\n"
+            "Note this call may take some time, unless hash_type is muhash.\n"
+            "\nArguments:\n"
+            "1. \"hash_type\"      (string, optional, default=legacy) \"legacy\" scans the coins database, \"muhash\" returns\n"
+            "                      the statistics maintained with -utxostats, with a rolling hash of the set\n"
             "\nResult:\n"
             "{\n"
             "  \"height\":n,     (numeric) The current block height (index)\n"
             "  \"bestblock\": \"hex\",   (string) the best block hash hex\n"
-            "  \"transactions\": n,      (numeric) The number of transactions\n"
+            "  \"transactions\": n,      (numeric) The number of transactions, legacy only\n"
             "  \"txouts\": n,            (numeric) The number of output transactions\n"
-            "  \"bytes_serialized\": n,  (numeric) The serialized size\n"
-            "  \"hash_serialized\": \"hash\",   (string) The serialized hash\n"
-            "  \"total_amount\": x.xxx          (numeric) The total amount\n"
+            "  \"bytes_serialized\": n,  (numeric) The serialized size, legacy only\n"
+            "  \"hash_serialized\": \"hash\",   (string) The serialized hash, legacy only\n"
+            "  \"muhash\": \"hash\",      (string) The hash of the set of outputs, muhash only\n"
+            "  \"total_amount\": x.xxx,         (numeric) The total amount\n"
+            "  \"currencies\": {        (object) Per reserve currency, muhash only\n"
+            "    \"currencyid\": {\"amount\": x.xxx, \"txouts\": n}\n"
+            "  }\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("gettxoutsetinfo", "")
+            + HelpExampleCli("gettxoutsetinfo", "\"muhash\"")
             + HelpExampleRpc("gettxoutsetinfo", "")
         );
 
     UniValue ret(UniValue::VOBJ);
 
+    std::string hashType = params.size() > 0 ? params[0].get_str() : "legacy";
+    if (hashType == "muhash") {
+        CUTXOSetStats utxoStats;
+        if (!GetUTXOSetStats(utxoStats))
+            throw JSONRPCError(RPC_MISC_ERROR, fUTXOStats ? "UTXO set statistics are still being rebuilt" : "UTXO set statistics require -utxostats");
+
+        int nHeight = 0;
+        {
+            LOCK(cs_main);
+            BlockMap::iterator it = mapBlockIndex.find(utxoStats.hashBlock);
+            if (it != mapBlockIndex.end())
+                nHeight = it->second->GetHeight();
+        }
+        ret.push_back(Pair("height", (int64_t)nHeight));
+        ret.push_back(Pair("bestblock", utxoStats.hashBlock.GetHex()));
+        ret.push_back(Pair("txouts", utxoStats.nTransactionOutputs));
+        ret.push_back(Pair("muhash", utxoStats.GetSetHash().GetHex()));
+        ret.push_back(Pair("total_amount", ValueFromAmount(utxoStats.nTotalAmount)));
+        UniValue currencies(UniValue::VOBJ);
+        for (auto &oneCount : utxoStats.reserveOutputs) {
+            auto amountIt = utxoStats.reserves.valueMap.find(oneCount.first);
+            UniValue currency(UniValue::VOBJ);
+            currency.push_back(Pair("amount", ValueFromAmount(amountIt == utxoStats.reserves.valueMap.end() ? 0 : amountIt->second)));
+            currency.push_back(Pair("txouts", oneCount.second));
+            currencies.push_back(Pair(EncodeDestination(CIdentityID(oneCount.first)), currency));
+        }
+        ret.push_back(Pair("currencies", currencies));
+        return ret;
+    }
+    if (hashType != "legacy")
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "hash_type must be legacy or muhash");
+
     CCoinsStats stats;
     FlushStateToDisk();
     if (pcoinsTip->GetStats(stats)) {
@@ -1163,6 +1684,80 @@ UniValue gettxoutsetinfo(const UniValue& params, bool fHelp)
     return ret;
 }
 
+UniValue dumpchainstate(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+            "dumpchainstate \"filename\"\n"
+            "\nWrites a snapshot of the chainstate, all unspent transaction outputs, Sprout and Sapling anchors and nullifiers\n"
+            "as of the current best block, to a file that a new node can load at startup with -loadchainstate.\n"
+            "The snapshot ends with a hash of its contents, which is checked when it is loaded.\n"
+            "Note this call may take some time.\n"
+            "\nArguments:\n"
+            "1. \"filename\"    (string, required) the file to write, relative to the data directory if not absolute. It must not exist.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"filename\": \"path\",   (string) the full path of the snapshot written\n"
+            "  \"height\":n,             (numeric) the height of the snapshot's block\n"
+            "  \"bestblock\": \"hex\",     (string) the hash of the snapshot's block\n"
+            "  \"coins\": n,             (numeric) the number of transactions with unspent outputs\n"
+            "  \"anchors\": n,           (numeric) the number of Sprout and Sapling anchors\n"
+            "  \"nullifiers\": n,        (numeric) the number of Sprout and Sapling nullifiers\n"
+            "  \"hash\": \"hex\"           (string) the hash committing to the snapshot contents\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("dumpchainstate", "\"chainstate.snapshot\"")
+            + HelpExampleRpc("dumpchainstate", "\"chainstate.snapshot\"")
+        );
+
+    boost::filesystem::path path = boost::filesystem::absolute(params[0].get_str(), GetDataDir());
+    if (boost::filesystem::exists(path))
+    {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, path.string() + " already exists");
+    }
+
+    // write to a temporary file and only rename it to the requested name once complete
+    boost::filesystem::path tmpPath = path.string() + ".incomplete";
+    CAutoFile file(fopen(tmpPath.string().c_str(), "wb"), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull())
+    {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Cannot open " + tmpPath.string() + " for writing");
+    }
+
+    CCoinsSnapshotInfo info;
+    FlushStateToDisk();
+    bool written;
+    try {
+        written = pcoinsTip->WriteSnapshot(file, ASSETCHAINS_CHAINID, info);
+    } catch (const std::exception &e) {
+        LogPrintf("%s: %s\n", __func__, e.what());
+        written = false;
+    }
+    file.fclose();
+    if (!written || !RenameOver(tmpPath, path))
+    {
+        boost::filesystem::remove(tmpPath);
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to write chainstate snapshot");
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("filename", path.string()));
+    {
+        LOCK(cs_main);
+        BlockMap::iterator it = mapBlockIndex.find(info.hashBlock);
+        if (it != mapBlockIndex.end() && it->second)
+        {
+            ret.push_back(Pair("height", (int64_t)it->second->GetHeight()));
+        }
+    }
+    ret.push_back(Pair("bestblock", info.hashBlock.GetHex()));
+    ret.push_back(Pair("coins", (uint64_t)info.nCoins));
+    ret.push_back(Pair("anchors", (uint64_t)info.nAnchors));
+    ret.push_back(Pair("nullifiers", (uint64_t)info.nNullifiers));
+    ret.push_back(Pair("hash", info.hashSnapshot.GetHex()));
+    return ret;
+}
+
 #include "komodo_defs.h"
 #include "komodo_structs.h"
 
@@ -1177,16 +1772,21 @@ int32_t komodo_notaries(uint8_t pubkeys[64][33],int32_t height,uint32_t timestam
 char *bitcoin_address(char *coinaddr,uint8_t addrtype,uint8_t *pubkey_or_rmd160,int32_t len);
 int32_t komodo_minerids(uint8_t *minerids,int32_t height,int32_t width);
 int32_t komodo_kvsearch(uint256 *refpubkeyp,int32_t current_height,uint32_t *flagsp,int32_t *heightp,uint8_t value[IGUANA_MAXSCRIPTSIZE],uint8_t *key,int32_t keylen);
+int32_t komodo_kvduration(uint32_t flags);
 
 UniValue kvsearch(const UniValue& params, bool fHelp)
 {
     UniValue ret(UniValue::VOBJ); uint32_t flags; uint8_t value[IGUANA_MAXSCRIPTSIZE*8],key[IGUANA_MAXSCRIPTSIZE*8]; int32_t duration,j,height,valuesize,keylen; uint256 refpubkey; static uint256 zeroes;
-    if (fHelp || params.size() != 1 )
+    if (fHelp || params.size() < 1 || params.size() > 3 )
         throw runtime_error(
-            "kvsearch key\n"
+            "kvsearch key ( count beforeheight )\n"
             "\nSearch for a key stored via the kvupdate command. This feature is only available for asset chains.\n"
             "\nArguments:\n"
             "1. key                      (string, required) search the chain for this key\n"
+            "2. count                    (numeric, optional) also return up to this many updates of the key, newest first,\n"
+            "                            which needs the key value index\n"
+            "3. beforeheight             (numeric, optional) only return updates below this height, which is the height of\n"
+            "                            the last update returned to get the next page\n"
             "\nResult:\n"
             "{\n"
             "  \"coin\": \"xxxxx\",          (string) chain the key is stored on\n"
@@ -1199,9 +1799,21 @@ UniValue kvsearch(const UniValue& params, bool fHelp)
             "  \"flags\": x                  (numeric) 1 if the key was created with a password; 0 otherwise.\n"
             "  \"value\": \"xxxxx\",         (string) stored value\n"
             "  \"valuesize\": xxxxx          (string) amount of characters stored\n"
+            "  \"history\": [                (array) with count, the updates of the key\n"
+            "    {\n"
+            "      \"txid\": \"xxxxx\",         (string) transaction of the update\n"
+            "      \"owner\": \"xxxxx\",        (string) owner of the key after the update\n"
+            "      \"height\": xxxxx,          (numeric) height of the update\n"
+            "      \"expiration\": xxxxx,      (numeric) height the update expires\n"
+            "      \"expired\": true|false,    (bool) whether the update has expired\n"
+            "      \"flags\": x,               (numeric) flags of the update\n"
+            "      \"value\": \"xxxxx\"         (string) value of the key after the update\n"
+            "    }, ...\n"
+            "  ]\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("kvsearch", "examplekey")
+            + HelpExampleCli("kvsearch", "examplekey 10")
             + HelpExampleRpc("kvsearch", "examplekey")
         );
     LOCK(cs_main);
@@ -1223,12 +1835,41 @@ UniValue kvsearch(const UniValue& params, bool fHelp)
                 if ( memcmp(&zeroes,&refpubkey,sizeof(refpubkey)) != 0 )
                     ret.push_back(Pair("owner",refpubkey.GetHex()));
                 ret.push_back(Pair("height",height));
-                duration = ((flags >> 2) + 1) * KOMODO_KVDURATION;
+                duration = komodo_kvduration(flags);
                 ret.push_back(Pair("expiration", (int64_t)(height+duration)));
                 ret.push_back(Pair("flags",(int64_t)flags));
                 ret.push_back(Pair("value",val));
                 ret.push_back(Pair("valuesize",valuesize));
             } else ret.push_back(Pair("error",(char *)"cant find key"));
+            if ( params.size() > 1 )
+            {
+                int32_t count = params[1].get_int(), beforeheight = params.size() > 2 ? params[2].get_int() : 0;
+                std::vector<CKVIndexEntry> entries;
+                if ( !fKVIndex )
+                    throw JSONRPCError(RPC_INVALID_PARAMETER, "Update history requires the key value index, which needs -reindex to be built");
+                if ( count <= 0 || beforeheight < 0 )
+                    throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid count or beforeheight");
+                if ( !pblocktree->ReadKVIndex(Hash(key,key+keylen),entries,count,beforeheight) )
+                    throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to read key value index");
+                UniValue history(UniValue::VARR);
+                for (auto &oneEntry : entries)
+                {
+                    if ( oneEntry.second.key != std::vector<uint8_t>(key,key+keylen) )
+                        continue;
+                    UniValue oneUpdate(UniValue::VOBJ);
+                    duration = komodo_kvduration(oneEntry.second.flags);
+                    oneUpdate.push_back(Pair("txid",oneEntry.second.txid.GetHex()));
+                    if ( !oneEntry.second.owner.IsNull() )
+                        oneUpdate.push_back(Pair("owner",oneEntry.second.owner.GetHex()));
+                    oneUpdate.push_back(Pair("height",(int64_t)oneEntry.first.height));
+                    oneUpdate.push_back(Pair("expiration",(int64_t)oneEntry.first.height + duration));
+                    oneUpdate.push_back(Pair("expired",chainActive.LastTip()->GetHeight() > (int64_t)oneEntry.first.height + duration));
+                    oneUpdate.push_back(Pair("flags",(int64_t)oneEntry.second.flags));
+                    oneUpdate.push_back(Pair("value",std::string(oneEntry.second.value.begin(),oneEntry.second.value.end())));
+                    history.push_back(oneUpdate);
+                }
+                ret.push_back(Pair("history",history));
+            }
         } else ret.push_back(Pair("error",(char *)"key too big"));
     } else ret.push_back(Pair("error",(char *)"null key"));
     return ret;
@@ -1650,6 +2291,14 @@ UniValue getblockchaininfo(const UniValue& params, bool fHelp)
             "  \"difficulty\": xxxxxx,     (numeric) the current difficulty\n"
             "  \"verificationprogress\": xxxx, (numeric) estimate of verification progress [0..1]\n"
             "  \"chainwork\": \"xxxx\"     (string) total amount of work in active chain, in hexadecimal\n"
+            "  \"assumevalid\": \"xxxx\",  (string, optional) the -assumevalid block hash, if set\n"
+            "  \"assumenotarized\": {      (object, optional) the -assumenotarized proof root, if set\n"
+            "    \"height\": xxxxxx,        (numeric) the height of the notarized block\n"
+            "    \"blockhash\": \"xxxx\",    (string) the hash of the notarized block\n"
+            "    \"stateroot\": \"xxxx\",    (string) the chain MMR root the notarization committed to\n"
+            "    \"verified\": true|false  (boolean) whether our headers up to the block match the state root\n"
+            "  },\n"
+            "  \"assumevalidskipped\": xxxxxx, (numeric) blocks connected since startup without script, signature and proof checks because of -assumevalid or -assumenotarized\n"
             "  \"size_on_disk\": xxxxxx,       (numeric) the estimated size of the block and undo files on disk\n"
             "  \"commitments\": xxxxxx,    (numeric) the current number of note commitments in the commitment tree\n"
             "  \"softforks\": [            (array) status of softforks in progress\n"
@@ -1705,6 +2354,20 @@ UniValue getblockchaininfo(const UniValue& params, bool fHelp)
     {
         obj.push_back(Pair("chainstake",        chainActive.LastTip()->chainPower.chainStake.GetHex()));
     }
+    if (!hashAssumeValid.IsNull())
+    {
+        obj.push_back(Pair("assumevalid",       hashAssumeValid.GetHex()));
+    }
+    if (!hashAssumeNotarizedBlock.IsNull())
+    {
+        UniValue anchor(UniValue::VOBJ);
+        anchor.push_back(Pair("height",         nAssumeNotarizedHeight));
+        anchor.push_back(Pair("blockhash",      hashAssumeNotarizedBlock.GetHex()));
+        anchor.push_back(Pair("stateroot",      hashAssumeNotarizedMMRRoot.GetHex()));
+        anchor.push_back(Pair("verified",       GetAssumeNotarizedAnchor() != nullptr));
+        obj.push_back(Pair("assumenotarized",   anchor));
+    }
+    obj.push_back(Pair("assumevalidskipped",    nAssumeValidSkipped));
     obj.push_back(Pair("pruned",                fPruneMode));
     obj.push_back(Pair("size_on_disk",          CalculateCurrentUsage()));
 
@@ -1892,6 +2555,242 @@ UniValue getmempoolinfo(const UniValue& params, bool fHelp)
     return mempoolInfoToJSON();
 }
 
+UniValue getproofcacheinfo(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getproofcacheinfo\n"
+            "\nReturns details on the shared cache of chain MMR proof branches used by block header and merkle proofs.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"entries\": xxxxx             (numeric) Current number of cached branches\n"
+            "  \"maxentries\": xxxxx          (numeric) Number of branches at which the cache evicts the least recently used\n"
+            "  \"hits\": xxxxx                (numeric) Proofs served from the cache since startup\n"
+            "  \"misses\": xxxxx              (numeric) Proofs generated and added to the cache since startup\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getproofcacheinfo", "")
+            + HelpExampleRpc("getproofcacheinfo", "")
+        );
+
+    return chainProofCache.ToUniValue();
+}
+
+UniValue getindexinfo(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getindexinfo\n"
+            "\nReturns the state of indexes that can be built in the background after being enabled on an existing database.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"name\": {                    (object) One entry for each index\n"
+            "    \"enabled\": true|false       (boolean) Whether the index is enabled\n"
+            "    \"synced\": true|false        (boolean) Whether the index is complete and can be queried\n"
+            "    \"builtheight\": n            (numeric, only while building) Height through which the index is complete\n"
+            "    \"progress\": xxxx            (numeric, only while building) Fraction of active chain blocks indexed\n"
+            "  },\n"
+            "  ...\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getindexinfo", "")
+            + HelpExampleRpc("getindexinfo", "")
+        );
+
+    return GetIndexBuildStatus();
+}
+
+UniValue DBLatencyToJSON(const CDBLatencyStats &latency, bool fVerbose)
+{
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("count", (uint64_t)latency.nCount));
+    result.push_back(Pair("averageus", latency.nCount ? (double)latency.nTotalMicros / latency.nCount : 0.0));
+    result.push_back(Pair("p50us", latency.Percentile(0.5)));
+    result.push_back(Pair("p90us", latency.Percentile(0.9)));
+    result.push_back(Pair("p99us", latency.Percentile(0.99)));
+    if (fVerbose) {
+        UniValue buckets(UniValue::VARR);
+        for (uint64_t nBucket : latency.buckets)
+            buckets.push_back((uint64_t)nBucket);
+        result.push_back(Pair("buckets", buckets));
+    }
+    return result;
+}
+
+UniValue getdbstats(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() > 1)
+        throw runtime_error(
+            "getdbstats ( verbose )\n"
+            "\nReturns LevelDB statistics and operation latencies of each open database, to help size -dbcache and disks.\n"
+            "\nArguments:\n"
+            "1. verbose   (boolean, optional, default=false) Include the leveldb.stats text and the latency buckets\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"name\": {                         (object) One entry for each database, named by its location in the data directory\n"
+            "    \"levels\": [                     (array) Tables at each level\n"
+            "      { \"files\": n, \"bytes\": n }\n"
+            "      ,...\n"
+            "    ],\n"
+            "    \"pendingcompactionbytes\": n,    (numeric) Bytes to compact before every level is under its size target\n"
+            "    \"writestalls\": n,               (numeric) Writes that had to wait for a memtable flush or level 0 compaction\n"
+            "    \"writebuffersize\": n,           (numeric) Bytes of writes buffered in memory before a table is written\n"
+            "    \"cache\": {                      (object) Block cache\n"
+            "      \"size\": n,                    (numeric) Capacity in bytes\n"
+            "      \"usage\": n,                   (numeric) Bytes held\n"
+            "      \"hits\": n,                    (numeric) Block lookups served from the cache\n"
+            "      \"misses\": n,                  (numeric) Block lookups read from disk\n"
+            "      \"hitrate\": x.xxx              (numeric) Fraction of lookups served from the cache\n"
+            "    },\n"
+            "    \"latency\": {                    (object) Latencies since startup of \"read\", \"write\" and \"batch\" commits\n"
+            "      \"read\": {\n"
+            "        \"count\": n,                 (numeric) Operations\n"
+            "        \"averageus\": x.xxx,         (numeric) Average in microseconds\n"
+            "        \"p50us\": n,                 (numeric) Microseconds that half the operations took less than, to a power of two\n"
+            "        \"p90us\": n,                 (numeric) The same for 90% of operations\n"
+            "        \"p99us\": n,                 (numeric) The same for 99% of operations\n"
+            "        \"buckets\": [ n, ... ]       (array, verbose only) Operations below 1, 2, 4... microseconds, the last all slower\n"
+            "      },\n"
+            "      ...\n"
+            "    },\n"
+            "    \"leveldbstats\": \"...\"         (string, verbose only) LevelDB's own compaction statistics\n"
+            "  },\n"
+            "  ...\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getdbstats", "")
+            + HelpExampleCli("getdbstats", "true")
+            + HelpExampleRpc("getdbstats", "true")
+        );
+
+    bool fVerbose = params.size() > 0 && params[0].get_bool();
+    static const char *opNames[DBOP_COUNT] = {"read", "write", "batch"};
+
+    UniValue result(UniValue::VOBJ);
+    for (const CDBStats &stats : CDBWrapper::GetAllStats()) {
+        UniValue db(UniValue::VOBJ);
+        UniValue levels(UniValue::VARR);
+        for (size_t i = 0; i < stats.levelFiles.size(); i++) {
+            UniValue level(UniValue::VOBJ);
+            level.push_back(Pair("files", stats.levelFiles[i]));
+            level.push_back(Pair("bytes", (uint64_t)stats.levelBytes[i]));
+            levels.push_back(level);
+        }
+        db.push_back(Pair("levels", levels));
+        db.push_back(Pair("pendingcompactionbytes", (uint64_t)stats.nPendingCompactionBytes));
+        db.push_back(Pair("writestalls", (uint64_t)stats.nWriteStalls));
+        db.push_back(Pair("writebuffersize", (uint64_t)stats.nWriteBufferSize));
+
+        UniValue cache(UniValue::VOBJ);
+        uint64_t nLookups = stats.nCacheHits + stats.nCacheMisses;
+        cache.push_back(Pair("size", (uint64_t)stats.nCacheSize));
+        cache.push_back(Pair("usage", (uint64_t)stats.nCacheUsage));
+        cache.push_back(Pair("hits", (uint64_t)stats.nCacheHits));
+        cache.push_back(Pair("misses", (uint64_t)stats.nCacheMisses));
+        cache.push_back(Pair("hitrate", nLookups ? (double)stats.nCacheHits / nLookups : 0.0));
+        db.push_back(Pair("cache", cache));
+
+        UniValue latency(UniValue::VOBJ);
+        for (int op = 0; op < DBOP_COUNT; op++)
+            latency.push_back(Pair(opNames[op], DBLatencyToJSON(stats.latency[op], fVerbose)));
+        db.push_back(Pair("latency", latency));
+        if (fVerbose)
+            db.push_back(Pair("leveldbstats", stats.strLevelDBStats));
+
+        result.push_back(Pair(stats.name, db));
+    }
+    return result;
+}
+
+UniValue getvalidationstats(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() > 2)
+        throw runtime_error(
+            "getvalidationstats ( verbose reset )\n"
+            "\nReturns the time spent in each phase of connecting blocks to the tip, in total and as histograms of each block,\n"
+            "and the times of smart transaction validation by eval code, since startup or the last reset.\n"
+            "\nArguments:\n"
+            "1. verbose   (boolean, optional, default=false) Include the histogram buckets\n"
+            "2. reset     (boolean, optional, default=false) Start collecting again after returning the current statistics\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"since\": n,                      (numeric) Time of startup or the last reset, in seconds since epoch\n"
+            "  \"totals\": {                      (object) Totals over all blocks connected\n"
+            "    \"blocks\": n,\n"
+            "    \"transactions\": n,\n"
+            "    \"phases\": { \"read\": x.xxx, ... }, (object) Milliseconds in each phase\n"
+            "    \"total\": x.xxx,                 (numeric) Milliseconds connecting blocks\n"
+            "    \"msperblock\": x.xxx,\n"
+            "    \"blockspersecond\": x.xxx\n"
+            "  },\n"
+            "  \"perblock\": {                    (object) Histograms of the microseconds each block spent in each phase: read,\n"
+            "                                     deserialize, checkblock, prechecks (transaction and PBaaS), inputs, scripts\n"
+            "                                     (scripts and crypto-conditions), index, callbacks, flush, chainstate, wallet,\n"
+            "                                     postconnect, and the total\n"
+            "    \"read\": {\n"
+            "      \"count\": n,                   (numeric) Blocks\n"
+            "      \"averageus\": x.xxx,           (numeric) Average in microseconds\n"
+            "      \"p50us\": n,                   (numeric) Microseconds that half the blocks took less than, to a power of two\n"
+            "      \"p90us\": n,                   (numeric) The same for 90% of blocks\n"
+            "      \"p99us\": n,                   (numeric) The same for 99% of blocks\n"
+            "      \"buckets\": [ n, ... ]         (array, verbose only) Blocks below 1, 2, 4... microseconds, the last all slower\n"
+            "    },\n"
+            "    ...\n"
+            "  },\n"
+            "  \"evals\": [                       (array) Each eval code that has been validated or prechecked\n"
+            "    {\n"
+            "      \"eval\": \"name\",              (string) The eval code\n"
+            "      \"check\": \"validate\",         (string) \"validate\" for spends, \"precheck\" for outputs\n"
+            "      \"failures\": n,                (numeric) Checks that failed\n"
+            "      \"latency\": { ... }            (object) As for each phase, per check\n"
+            "    }, ...\n"
+            "  ]\n"
+            "}\n"
+            "\nEval codes are checked for blocks, the mempool and block templates, the phases only for blocks connected to the tip.\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getvalidationstats", "")
+            + HelpExampleCli("getvalidationstats", "false true")
+            + HelpExampleRpc("getvalidationstats", "false, true")
+        );
+
+    bool fVerbose = params.size() > 0 && params[0].get_bool();
+    bool fReset = params.size() > 1 && params[1].get_bool();
+
+    CValidationStats stats;
+    std::vector<CCEvalStats> evalStats;
+    {
+        LOCK(cs_main);
+        stats = GetValidationStats();
+        evalStats = GetCCEvalStats();
+        if (fReset)
+        {
+            ResetValidationStats();
+            ResetCCEvalStats();
+        }
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("since", stats.nStartTime));
+    result.push_back(Pair("totals", stats.totals.ToUniValue()));
+
+    UniValue perBlock(UniValue::VOBJ);
+    for (int phase = 0; phase < VALIDATION_PHASE_COUNT; phase++)
+        perBlock.push_back(Pair(validationPhaseNames[phase], DBLatencyToJSON(stats.phases[phase], fVerbose)));
+    result.push_back(Pair("perblock", perBlock));
+
+    UniValue evals(UniValue::VARR);
+    for (const CCEvalStats &eval : evalStats) {
+        UniValue evalObj(UniValue::VOBJ);
+        evalObj.push_back(Pair("eval", EvalToStr((EvalCode)eval.evalCode)));
+        evalObj.push_back(Pair("check", eval.fPrecheck ? "precheck" : "validate"));
+        evalObj.push_back(Pair("failures", (uint64_t)eval.nFailures));
+        evalObj.push_back(Pair("latency", DBLatencyToJSON(eval.times, fVerbose)));
+        evals.push_back(evalObj);
+    }
+    result.push_back(Pair("evals", evals));
+    return result;
+}
+
 UniValue invalidateblock(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() != 1)
@@ -1969,6 +2868,80 @@ UniValue reconsiderblock(const UniValue& params, bool fHelp)
     return NullUniValue;
 }
 
+UniValue replayblocks(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() < 1 || params.size() > 2)
+        throw runtime_error(
+            "replayblocks count ( passes )\n"
+            "\nDisconnects the top count blocks of the active chain and connects them again from the block files, passes times,\n"
+            "timing each phase of validation, to compare validation changes on the same range of real blocks. A node started\n"
+            "from a chainstate snapshot made with dumpchainstate and given the block files above it replays the same range every run.\n"
+            "Wallets and indexes see each pass as a reorganization. The node does not process other blocks until the call returns.\n"
+            "\nArguments:\n"
+            "1. count    (numeric, required) the number of blocks below the tip to replay\n"
+            "2. passes   (numeric, optional, default=1) the number of times to replay them\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"startheight\": n,      (numeric) the height of the first block replayed\n"
+            "  \"endheight\": n,        (numeric) the height of the tip, the last block replayed\n"
+            "  \"passes\": [            (array) the times of each pass\n"
+            "    {\n"
+            "      \"blocks\": n,       (numeric) the number of blocks connected\n"
+            "      \"transactions\": n, (numeric) the number of transactions in them\n"
+            "      \"phases\": {        (object) milliseconds spent reading, deserializing, in CheckBlock, in transaction and\n"
+            "                             PBaaS prechecks, inputs, scripts and crypto-conditions, index writes, callbacks,\n"
+            "                             cache flushes, chainstate writes, wallet notifications and post connect processing\n"
+            "        \"read\": x.xxx, ...\n"
+            "      },\n"
+            "      \"total\": x.xxx,    (numeric) milliseconds to connect the blocks\n"
+            "      \"msperblock\": x.xxx,\n"
+            "      \"blockspersecond\": x.xxx\n"
+            "    }, ...\n"
+            "  ]\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("replayblocks", "1000 3")
+            + HelpExampleRpc("replayblocks", "1000, 3")
+        );
+
+    int nBlocks = params[0].get_int();
+    int nPasses = params.size() > 1 ? params[1].get_int() : 1;
+    if (nBlocks <= 0 || nPasses <= 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "count and passes must be positive");
+
+    CValidationState state;
+    std::vector<CBlockConnectTimes> passTimes;
+    bool fReplayed;
+    int nTipHeight;
+
+    {
+        LOCK(cs_main);
+        nTipHeight = chainActive.Height();
+        if (nBlocks >= nTipHeight)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "count must be less than the height of the active chain");
+        fReplayed = ReplayBlocks(state, Params(), nBlocks, nPasses, passTimes);
+    }
+
+    if (!fReplayed)
+    {
+        // reconnect whatever a failed pass left disconnected
+        CValidationState activateState;
+        ActivateBestChain(activateState, Params());
+        throw JSONRPCError(RPC_DATABASE_ERROR, state.GetRejectReason().empty() ? "replay failed, see debug.log" : state.GetRejectReason());
+    }
+
+    UniValue passes(UniValue::VARR);
+    for (auto &passTime : passTimes)
+    {
+        passes.push_back(passTime.ToUniValue());
+    }
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("startheight", nTipHeight - nBlocks + 1);
+    ret.pushKV("endheight", nTipHeight);
+    ret.pushKV("passes", passes);
+    return ret;
+}
+
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         okSafeMode
   //  --------------------- ------------------------  -----------------------  ----------
@@ -1983,22 +2956,35 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getchaintxstats",        &getchaintxstats,        true  },
     { "blockchain",         "getdifficulty",          &getdifficulty,          true  },
     { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         true  },
+    { "blockchain",         "getindexinfo",           &getindexinfo,           true  },
+    { "blockchain",         "getdbstats",             &getdbstats,             true  },
+    { "blockchain",         "getvalidationstats",     &getvalidationstats,     true  },
+    { "blockchain",         "getproofcacheinfo",      &getproofcacheinfo,      true  },
     { "blockchain",         "getrawmempool",          &getrawmempool,          true  },
+    { "blockchain",         "getmempoolchanges",      &getmempoolchanges,      true  },
     { "blockchain",         "gettxout",               &gettxout,               true  },
     { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true  },
+    { "blockchain",         "dumpchainstate",         &dumpchainstate,         true  },
     { "blockchain",         "verifychain",            &verifychain,            true  },
 
     // insightexplorer
     { "blockchain",         "getblockdeltas",         &getblockdeltas,         false },
     { "blockchain",         "getblockhashes",         &getblockhashes,         true  },
+    { "blockchain",         "getblockfilter",         &getblockfilter,         true  },
+    { "blockchain",         "getblockstats",          &getblockstats,          true  },
 
     /* Not shown in help */
     { "hidden",             "invalidateblock",        &invalidateblock,        true  },
     { "hidden",             "reconsiderblock",        &reconsiderblock,        true  },
+    { "hidden",             "replayblocks",           &replayblocks,           true  },
 };
 
 void RegisterBlockchainRPCCommands(CRPCTable &tableRPC)
 {
     for (unsigned int vcidx = 0; vcidx < ARRAYLEN(commands); vcidx++)
         tableRPC.appendCommand(commands[vcidx].name, &commands[vcidx]);
+
+    // results that can be far larger than the rest of a reply are written as they are made
+    tableRPC.appendStreamingActor("getblock", &getblock_stream);
+    tableRPC.appendStreamingActor("getrawmempool", &getrawmempool_stream);
 }
@@ -1688,6 +1688,8 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "signrawtransaction", 1 },
     { "signrawtransaction", 2 },
     { "sendrawtransaction", 1 },
+    { "sendrawtransactions", 0 },
+    { "sendrawtransactions", 1 },
     { "fundrawtransaction", 1 },
     { "estimateconversion", 0 },
     { "gettxout", 1 },
@@ -1699,8 +1701,13 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "importaddress", 2 },
     { "verifychain", 0 },
     { "verifychain", 1 },
+    { "replayblocks", 0 },
+    { "replayblocks", 1 },
     { "keypoolrefill", 0 },
     { "getrawmempool", 0 },
+    { "getrawmempool", 1 },
+    { "getmempoolchanges", 0 },
+    { "getmempoolchanges", 1 },
     { "estimatefee", 0 },
     { "estimatepriority", 0 },
     { "prioritisetransaction", 1 },
@@ -1714,15 +1721,26 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "getaddressutxos", 0},
     { "getaddressmempool", 0},
     { "getblockhashes", 0},
+    { "getblockstats", 0},
+    { "getblockstats", 1},
     { "getblockhashes", 1},
     { "getblockhashes", 2},
     { "getblockdeltas", 0},
+    { "getdbstats", 0},
+    { "getlockstats", 0},
+    { "getlockstats", 1},
+    { "getslowrpccalls", 0},
+    { "getvalidationstats", 0},
+    { "getvalidationstats", 1},
+    { "getminingstats", 0},
+    { "getminingstats", 1},
     { "zcrawjoinsplit", 1 },
     { "zcrawjoinsplit", 2 },
     { "zcrawjoinsplit", 3 },
     { "zcrawjoinsplit", 4 },
     { "zcbenchmark", 1 },
     { "zcbenchmark", 2 },
+    { "zcbenchmark", 3 },
     { "getblocksubsidy", 0},
     { "z_listaddresses", 0},
     { "z_listreceivedbyaddress", 1},
@@ -1752,6 +1770,7 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "notaries", 2 },
     { "minerids", 1 },
     { "kvsearch", 1 },
+    { "kvsearch", 2 },
     { "kvupdate", 4 },
     { "z_importkey", 2 },
     { "z_importviewingkey", 2 },
@@ -1792,6 +1811,9 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "signdata", 0},
     { "decryptdata", 0},
     { "verifysignature", 0},
+    { "getidentities", 0},
+    { "getidentities", 1},
+    { "getidentities", 2},
     { "getidentitieswithaddress", 0},
     { "getidentitieswithrevocation", 0},
     { "getidentitieswithrecovery", 0},
@@ -0,0 +1,64 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "rpc/jsonstream.h"
+
+#include <stdexcept>
+
+void CJSONStreamWriter::BeforeValue()
+{
+    if (fAfterKey) {
+        fAfterKey = false;
+        return;
+    }
+    if (!vHasMembers.empty()) {
+        if (vHasMembers.back())
+            buffer += ',';
+        vHasMembers.back() = true;
+    }
+}
+
+void CJSONStreamWriter::Open(char c)
+{
+    BeforeValue();
+    buffer += c;
+    vHasMembers.push_back(false);
+}
+
+void CJSONStreamWriter::Close(char c)
+{
+    if (vHasMembers.empty())
+        throw std::logic_error("CJSONStreamWriter: close without open");
+    vHasMembers.pop_back();
+    buffer += c;
+    MaybeFlush();
+}
+
+void CJSONStreamWriter::Key(const std::string& key)
+{
+    if (fAfterKey)
+        throw std::logic_error("CJSONStreamWriter: key without value");
+    BeforeValue();
+    // a string value is written with its JSON escaping
+    buffer += UniValue(key).write();
+    buffer += ':';
+    fAfterKey = true;
+}
+
+void CJSONStreamWriter::Value(const UniValue& value)
+{
+    BeforeValue();
+    buffer += value.write();
+    MaybeFlush();
+}
+
+void CJSONStreamWriter::Flush()
+{
+    if (buffer.empty())
+        return;
+    if (!sink(buffer))
+        throw std::runtime_error("client disconnected");
+    nSent += buffer.size();
+    buffer.clear();
+}
@@ -0,0 +1,69 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_RPCJSONSTREAM_H
+#define BITCOIN_RPCJSONSTREAM_H
+
+#include <string>
+#include <vector>
+
+#include <boost/function.hpp>
+
+#include <univalue.h>
+
+/** Output is handed to the sink once this much of it is buffered */
+static const size_t DEFAULT_JSON_STREAM_CHUNK_SIZE = 256 * 1024;
+
+/**
+ * Writes a JSON document in parts, so that a large RPC reply is sent while it is being made rather than built as one
+ * UniValue tree and then one string. Structure is written with Begin/End and Key calls, and any value, usually one
+ * element of a large array or object, with Value. Buffered output goes to the sink in chunks, the sink returns false
+ * when the client has gone, and the writer then throws to stop the call.
+ */
+class CJSONStreamWriter
+{
+public:
+    typedef boost::function<bool(const std::string&)> Sink;
+
+    CJSONStreamWriter(const Sink& sinkIn, size_t nChunkSizeIn = DEFAULT_JSON_STREAM_CHUNK_SIZE) :
+        sink(sinkIn), nChunkSize(nChunkSizeIn), fAfterKey(false), nSent(0) {}
+
+    void BeginObject() { Open('{'); }
+    void EndObject() { Close('}'); }
+    void BeginArray() { Open('['); }
+    void EndArray() { Close(']'); }
+
+    /** Key of the next member of the current object */
+    void Key(const std::string& key);
+    /** A complete value, as an array element, or as the value of the last key */
+    void Value(const UniValue& value);
+
+    /** Hand everything buffered to the sink */
+    void Flush();
+
+    /** Bytes handed to the sink so far, while this is 0 nothing has been sent and the call can still fail cleanly */
+    size_t Sent() const { return nSent; }
+    /** Output not yet handed to the sink */
+    const std::string& Buffered() const { return buffer; }
+
+private:
+    Sink sink;
+    size_t nChunkSize;
+    std::string buffer;
+    // whether each open object or array has a member yet, so the next one is preceded by a comma
+    std::vector<bool> vHasMembers;
+    bool fAfterKey;
+    size_t nSent;
+
+    void BeforeValue();
+    void Open(char c);
+    void Close(char c);
+    void MaybeFlush()
+    {
+        if (buffer.size() >= nChunkSize)
+            Flush();
+    }
+};
+
+#endif // BITCOIN_RPCJSONSTREAM_H
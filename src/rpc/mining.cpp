@@ -412,6 +412,7 @@ UniValue getmininginfo(const UniValue& params, bool fHelp)
             "  \"numthreads\": n            (numeric) Number of CPU threads mining\n"
             "  \"mergemining\": n           (numeric) Number of blockchains we are merge mining with\n"
             "  \"mergeminedchains\": []     (optional, list of names) Blockchain names that are being merge mined with this blockchain\n"
+            "  \"verushashkernel\": \"xxxx\"  (string) VerusHash implementation used for multi-lane mining (portable, aes, vaes-avx2, vaes-avx512)\n"
 #endif
             "}\n"
             "\nExamples:\n"
@@ -534,6 +535,7 @@ UniValue getmininginfo(const UniValue& params, bool fHelp)
     bool mergeMining = mining && (!IsVerusActive() || (IsVerusActive() && chains.size()));
     int numChains = mergeMining ? (IsVerusActive() ? chains.size() + 1 : 1) : 0;
     obj.push_back(Pair("numthreads",       (int64_t)KOMODO_MININGTHREADS));
+    obj.push_back(Pair("verushashkernel",  GetVerusCLHashKernelName()));
     obj.push_back(Pair("mergemining",      numChains));
     if (numChains)
     {
@@ -548,6 +550,111 @@ UniValue getmininginfo(const UniValue& params, bool fHelp)
     return obj;
 }
 
+static UniValue MinedBlockStatsToJSON(const CMinedBlockStats &stats, bool fVerbose)
+{
+    UniValue result(UniValue::VOBJ);
+    uint64_t nSolved = stats.outcomes[MINED_ACCEPTED] + stats.outcomes[MINED_STALE] + stats.outcomes[MINED_REJECTED];
+    result.push_back(Pair("solved", nSolved));
+    result.push_back(Pair("accepted", stats.outcomes[MINED_ACCEPTED]));
+    result.push_back(Pair("stale", stats.outcomes[MINED_STALE]));
+    result.push_back(Pair("rejected", stats.outcomes[MINED_REJECTED]));
+    result.push_back(Pair("orphaned", stats.nOrphaned));
+    result.push_back(Pair("confirmed", stats.nConfirmed));
+    result.push_back(Pair("stalerate", nSolved ? (double)stats.outcomes[MINED_STALE] / nSolved : 0.0));
+    result.push_back(Pair("orphanrate", stats.outcomes[MINED_ACCEPTED] ? (double)stats.nOrphaned / stats.outcomes[MINED_ACCEPTED] : 0.0));
+    result.push_back(Pair("templateage", DBLatencyToJSON(stats.templateAge, fVerbose)));
+    return result;
+}
+
+UniValue getminingstats(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() > 2)
+        throw runtime_error(
+            "getminingstats ( verbose reset )\n"
+            "\nReturns live mining and staking telemetry since startup or the last reset: the hash rate of each mining\n"
+            "thread, the hash kernel in use, how long block templates were worked on, how many stake candidates were\n"
+            "evaluated per block and how long that took, and the stale and orphan rates of mined and staked blocks.\n"
+            "Blocks are only counted when this node's own miner or staker submits them.\n"
+            "\nArguments:\n"
+            "1. verbose      (boolean, optional, default=false) Include the buckets of each histogram\n"
+            "2. reset        (boolean, optional, default=false) Clear the statistics after returning them\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"since\": n,                   (numeric) Time of startup or the last reset, in seconds since epoch\n"
+            "  \"hashkernel\": \"xxxx\",         (string) The VerusHash kernel the mining threads last chose\n"
+            "  \"localhashps\": x.xxx,         (numeric) Hashes per second of all threads, as in getmininginfo\n"
+            "  \"threads\": [                  (array) Each mining thread that has run\n"
+            "    {\n"
+            "      \"thread\": n,              (numeric) The thread number\n"
+            "      \"hashes\": n,              (numeric) Hashes since the thread started\n"
+            "      \"hashps\": x.xxx,          (numeric) Hashes per second while hashing\n"
+            "      \"lastactive\": n           (numeric) When the thread last reported hashes, in seconds since epoch\n"
+            "    }, ...\n"
+            "  ],\n"
+            "  \"pow\": {                      (object) Blocks mined by this node\n"
+            "    \"solved\": n,                (numeric) Blocks solved\n"
+            "    \"accepted\": n,              (numeric) Of those, accepted\n"
+            "    \"stale\": n,                 (numeric) Found after the tip moved, so never submitted\n"
+            "    \"rejected\": n,              (numeric) Not accepted by validation\n"
+            "    \"orphaned\": n,              (numeric) Accepted, then reorganized out of the active chain\n"
+            "    \"confirmed\": n,             (numeric) Accepted and in the active chain 100 blocks below the tip\n"
+            "    \"stalerate\": x.xxx,         (numeric) Stale blocks per block solved\n"
+            "    \"orphanrate\": x.xxx,        (numeric) Orphaned blocks per block accepted\n"
+            "    \"templateage\": { ... }      (object) Microseconds from taking the template to submitting the block,\n"
+            "                                as count, averageus and p50us, p90us and p99us\n"
+            "  },\n"
+            "  \"pos\": { ... },               (object) The same for blocks staked by this node, solved when a stake is found\n"
+            "  \"staking\": {\n"
+            "    \"evaluations\": n,           (numeric) Blocks for which the wallet looked for a winning stake\n"
+            "    \"candidates\": n,            (numeric) Eligible outputs hashed over those blocks\n"
+            "    \"candidatesperblock\": x.xxx,\n"
+            "    \"hits\": n,                  (numeric) Outputs that met the target and were checked further\n"
+            "    \"found\": n,                 (numeric) Evaluations that found a stake to use\n"
+            "    \"latency\": { ... }          (object) Microseconds per evaluation, as for templateage\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getminingstats", "")
+            + HelpExampleCli("getminingstats", "false true")
+            + HelpExampleRpc("getminingstats", "")
+        );
+
+    bool fVerbose = params.size() > 0 && params[0].get_bool();
+    bool fReset = params.size() > 1 && params[1].get_bool();
+
+    CMiningStats stats = GetMiningStats();
+    if (fReset)
+        ResetMiningStats();
+
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("since", stats.nStartTime));
+    result.push_back(Pair("hashkernel", stats.strHashKernel));
+    result.push_back(Pair("localhashps", GetLocalSolPS()));
+    UniValue threads(UniValue::VARR);
+    for (const CMinerThreadStats &thread : stats.threads)
+    {
+        UniValue oneThread(UniValue::VOBJ);
+        oneThread.push_back(Pair("thread", thread.nThread));
+        oneThread.push_back(Pair("hashes", thread.nHashes));
+        oneThread.push_back(Pair("hashps", thread.nMicros ? thread.nHashes * 1e6 / thread.nMicros : 0.0));
+        oneThread.push_back(Pair("lastactive", thread.nLastActive));
+        threads.push_back(oneThread);
+    }
+    result.push_back(Pair("threads", threads));
+    result.push_back(Pair("pow", MinedBlockStatsToJSON(stats.pow, fVerbose)));
+    result.push_back(Pair("pos", MinedBlockStatsToJSON(stats.pos, fVerbose)));
+
+    UniValue staking(UniValue::VOBJ);
+    staking.push_back(Pair("evaluations", stats.nStakeEvaluations));
+    staking.push_back(Pair("candidates", stats.nStakeCandidates));
+    staking.push_back(Pair("candidatesperblock", stats.nStakeEvaluations ? (double)stats.nStakeCandidates / stats.nStakeEvaluations : 0.0));
+    staking.push_back(Pair("hits", stats.nStakeHits));
+    staking.push_back(Pair("found", stats.nStakesFound));
+    staking.push_back(Pair("latency", DBLatencyToJSON(stats.stakeLatency, fVerbose)));
+    result.push_back(Pair("staking", staking));
+    return result;
+}
+
 
 // NOTE: Unlike wallet RPC (which use BTC values), mining RPCs follow GBT (BIP 22) in using satoshi amounts
 UniValue prioritisetransaction(const UniValue& params, bool fHelp)
@@ -674,6 +781,18 @@ UniValue getminingdistribution(const UniValue& params, bool fHelp)
     return distributionObj;
 }
 
+// total fees of all transactions in the mempool, used to decide whether a fee change is worth new work
+static CAmount MempoolTotalFees()
+{
+    CAmount totalFees = 0;
+    LOCK(mempool.cs);
+    for (auto &oneEntry : mempool.mapTx)
+    {
+        totalFees += oneEntry.GetFee();
+    }
+    return totalFees;
+}
+
 UniValue getblocktemplate(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() > 1)
@@ -695,7 +814,10 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
             "       \"capabilities\":[      (array, optional) A list of strings\n"
             "           \"support\"         (string) client side supported feature, 'longpoll', 'coinbasetxn', 'coinbasevalue', 'proposal', 'serverlist', 'workid'\n"
             "           ,...\n"
-            "         ]\n"
+            "         ],\n"
+            "       \"longpollid\":\"id\"     (string, optional) wait until the tip changes or transactions are updated\n"
+            "       \"minfeechange\":n      (numeric, optional) with longpollid, only return on a transaction update if mempool fees changed by at least this amount\n"
+            "       \"templateid\":\"id\"     (string, optional) templateid of a template already held, to receive only the transactions that changed\n"
             "     }\n"
             "\n"
 
@@ -735,6 +857,11 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
             "  \"curtime\" : ttt,                  (numeric) current timestamp in seconds since epoch (Jan 1 1970 GMT)\n"
             "  \"bits\" : \"xxx\",                 (string) compressed target of next block\n"
             "  \"height\" : n                      (numeric) The height of the next block\n"
+            "  \"templateid\" : \"xxxx\",           (string) Identifies the transaction set of this template\n"
+            "  \"coinbasemerklebranch\" : [...],   (array) Merkle branch of the coinbase, to update the merkle root when only the coinbase changes\n"
+            "  \"delta\" : true|false,             (boolean) If true, \"transactions\" is replaced by the changes from the requested templateid\n"
+            "  \"transactionsadded\" : [...],      (array, delta only) Transactions not in the requested template, in the same form as \"transactions\"\n"
+            "  \"transactionsremoved\" : [...],    (array, delta only) Hashes of transactions in the requested template that are no longer included\n"
             "}\n"
 
             "\nExamples:\n"
@@ -757,6 +884,8 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
 
     std::string strMode = "template";
     UniValue lpval = NullUniValue;
+    CAmount minFeeChange = 0;
+    std::string heldTemplateID;
 
     // TODO: Re-enable coinbasevalue once a specification has been written
     bool coinbasetxn = true;
@@ -776,6 +905,13 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
             throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid mode");
         lpval = find_value(oparam, "longpollid");
 
+        const UniValue &feeChangeVal = find_value(oparam, "minfeechange");
+        if (!feeChangeVal.isNull())
+        {
+            minFeeChange = AmountFromValue(feeChangeVal);
+        }
+        heldTemplateID = uni_get_str(find_value(oparam, "templateid"));
+
         if (strMode == "proposal")
         {
             const UniValue& dataval = find_value(oparam, "data");
@@ -827,6 +963,7 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
     //   throw JSONRPCError(RPC_CLIENT_IN_INITIAL_DOWNLOAD, "Zcash is downloading blocks...");
 
     static unsigned int nTransactionsUpdatedLast;
+    static CAmount nMempoolFeesLast;
 
     if (!lpval.isNull())
     {
@@ -860,8 +997,9 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
             {
                 if (!cvBlockChange.timed_wait(lock, checktxtime))
                 {
-                    // Timeout: Check transactions for update
-                    if (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLastLP)
+                    // Timeout: Check transactions for update, and if requested, whether the update is worth new work
+                    if (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLastLP &&
+                        (!minFeeChange || std::abs(MempoolTotalFees() - nMempoolFeesLast) >= minFeeChange))
                         break;
                     checktxtime += boost::posix_time::seconds(10);
                 }
@@ -878,6 +1016,13 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
     static CBlockIndex* pindexPrev;
     static int64_t nStart;
     static CBlockTemplate* pblocktemplate;
+
+    // transaction sets of the most recent templates, so that miners who already hold one can get only the changes
+    static const int MAX_RECENT_TEMPLATES = 8;
+    static uint64_t nTemplateSequence;
+    static std::map<std::string, std::vector<uint256>> mapRecentTemplateTxes;
+    static std::deque<std::string> recentTemplateIDs;
+    static std::string curTemplateID;
     if (pindexPrev != chainActive.LastTip() ||
         (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast && GetTime() - nStart > 5))
     {
@@ -948,9 +1093,35 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
 
         // Need to update only after we know CreateNewBlock succeeded
         pindexPrev = pindexPrevNew;
+        nMempoolFeesLast = MempoolTotalFees();
+
+        curTemplateID = pindexPrev->GetBlockHash().GetHex() + i64tostr(++nTemplateSequence);
+        std::vector<uint256> &templateTxes = mapRecentTemplateTxes[curTemplateID];
+        for (int j = 1; j < pblocktemplate->block.vtx.size(); j++)
+        {
+            templateTxes.push_back(pblocktemplate->block.vtx[j].GetHash());
+        }
+        recentTemplateIDs.push_back(curTemplateID);
+        if (recentTemplateIDs.size() > MAX_RECENT_TEMPLATES)
+        {
+            mapRecentTemplateTxes.erase(recentTemplateIDs.front());
+            recentTemplateIDs.pop_front();
+        }
     }
     CBlock* pblock = &pblocktemplate->block; // pointer for convenience
 
+    // if the caller holds a recent template on the same tip, we only send the transactions that changed
+    std::set<uint256> heldTxes;
+    bool sendDelta = false;
+    if (!heldTemplateID.empty() &&
+        heldTemplateID.substr(0, 64) == pindexPrev->GetBlockHash().GetHex() &&
+        mapRecentTemplateTxes.count(heldTemplateID))
+    {
+        const std::vector<uint256> &held = mapRecentTemplateTxes[heldTemplateID];
+        heldTxes.insert(held.begin(), held.end());
+        sendDelta = true;
+    }
+
     int64_t Mining_height = (int64_t)(pindexPrev->GetHeight()+1);
 
     // pickup/remove any new/deleted headers
@@ -1007,10 +1178,16 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
             entry.push_back(Pair("coinbasevalue", nReward));
             entry.push_back(Pair("required", true));
             txCoinbase = entry;
-        } else
+        } else if (!sendDelta || !heldTxes.erase(txHash))
             transactions.push_back(entry);
     }
 
+    UniValue removedTransactions(UniValue::VARR);
+    for (auto &oneRemoved : heldTxes)
+    {
+        removedTransactions.push_back(oneRemoved.GetHex());
+    }
+
     UniValue aux(UniValue::VOBJ);
     aux.push_back(Pair("flags", HexStr(COINBASE_FLAGS.begin(), COINBASE_FLAGS.end())));
 
@@ -1034,7 +1211,26 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
     {
         result.push_back(Pair("solution", HexBytes(pblock->nSolution.data(), pblock->nSolution.size())));
     }
-    result.push_back(Pair("transactions", transactions));
+    result.push_back(Pair("templateid", curTemplateID));
+    result.push_back(Pair("delta", sendDelta));
+    if (sendDelta)
+    {
+        result.push_back(Pair("transactionsadded", transactions));
+        result.push_back(Pair("transactionsremoved", removedTransactions));
+    }
+    else
+    {
+        result.push_back(Pair("transactions", transactions));
+    }
+
+    UniValue coinbaseBranch(UniValue::VARR);
+    pblock->BuildMerkleTree();
+    for (auto &oneNode : pblock->GetMerkleBranch(0))
+    {
+        coinbaseBranch.push_back(oneNode.GetHex());
+    }
+    result.push_back(Pair("coinbasemerklebranch", coinbaseBranch));
+
     if (coinbasetxn) {
         assert(txCoinbase.isObject());
         result.push_back(Pair("coinbasetxn", txCoinbase));
@@ -1181,29 +1377,48 @@ UniValue submitblock(const UniValue& params, bool fHelp)
 
 UniValue estimatefee(const UniValue& params, bool fHelp)
 {
-    if (fHelp || params.size() != 1)
+    if (fHelp || params.size() < 1 || params.size() > 2)
         throw runtime_error(
-            "estimatefee nblocks\n"
+            "estimatefee nblocks ( \"currency\" )\n"
             "\nEstimates the approximate fee per kilobyte\n"
             "needed for a transaction to begin confirmation\n"
             "within nblocks blocks.\n"
             "\nArguments:\n"
             "1. nblocks     (numeric)\n"
+            "2. \"currency\"  (string, optional) a reserve currency to pay the fee in, the estimate is in that currency\n"
             "\nResult:\n"
             "n :    (numeric) estimated fee-per-kilobyte\n"
             "\n"
             "minimum fee is returned if not enough transactions and\n"
-            "blocks have been observed to make an estimate.\n"
+            "blocks have been observed to make an estimate, or -1 for\n"
+            "a reserve currency without enough data.\n"
             "\nExample:\n"
             + HelpExampleCli("estimatefee", "6")
+            + HelpExampleCli("estimatefee", "6 \"currencyname\"")
             );
 
-    RPCTypeCheck(params, boost::assign::list_of(UniValue::VNUM));
+    RPCTypeCheck(params, boost::assign::list_of(UniValue::VNUM)(UniValue::VSTR));
 
     int nBlocks = params[0].get_int();
     if (nBlocks < 1)
         nBlocks = 1;
 
+    if (params.size() > 1)
+    {
+        uint160 currencyID = ValidateCurrencyName(params[1].get_str(), true);
+        if (currencyID.IsNull())
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid currency " + params[1].get_str());
+        if (currencyID != ASSETCHAINS_CHAINID)
+        {
+            CFeeRate reserveFeeRate = mempool.estimateReserveFee(currencyID, nBlocks);
+            if (reserveFeeRate == CFeeRate(0))
+            {
+                return -1.0;
+            }
+            return ValueFromAmount(reserveFeeRate.GetFeePerK());
+        }
+    }
+
     CFeeRate feeRate = mempool.estimateFee(nBlocks);
     if (feeRate == CFeeRate(0))
     {
@@ -1275,6 +1490,7 @@ static const CRPCCommand commands[] =
     { "mining",             "getnetworksolps",        &getnetworksolps,        true  },
     { "mining",             "getnetworkhashps",       &getnetworkhashps,       true  },
     { "mining",             "getmininginfo",          &getmininginfo,          true  },
+    { "mining",             "getminingstats",         &getminingstats,         true  },
     { "mining",             "prioritisetransaction",  &prioritisetransaction,  true  },
     { "mining",             "setminingdistribution",  &setminingdistribution,  true  },
     { "mining",             "getminingdistribution",  &getminingdistribution,  true  },
@@ -10,10 +10,14 @@
 #include "main.h"
 #include "net.h"
 #include "netbase.h"
+#include "notificationqueue.h"
 #include "rpc/server.h"
+#include "scheduler.h"
+#include "subscriptionindex.h"
 #include "timedata.h"
 #include "txmempool.h"
 #include "util.h"
+#include "utxostats.h"
 #include "../version.h"
 #include "pbaas/crosschainrpc.h"
 #ifdef ENABLE_WALLET
@@ -23,6 +27,9 @@
 #include "tls/utiltls.h"
 
 #include <stdint.h>
+#ifdef __linux__
+#include <unistd.h>
+#endif
 
 #include <boost/assign/list_of.hpp>
 
@@ -369,6 +376,11 @@ UniValue coinsupply(const UniValue& params, bool fHelp)
             "  \"supply\" : \"777.0\",           (float) The transparent coin supply\n"
             "  \"zfunds\" : \"0.777\",           (float) The shielded coin supply (in zaddrs)\n"
             "  \"total\" :  \"777.777\",         (float) The total coin supply, i.e. sum of supply + zfunds\n"
+            "  \"utxos\" : {                   (object) With -utxostats at the tip, the unspent outputs at this height\n"
+            "    \"txouts\" : n,                (integer) The number of unspent outputs\n"
+            "    \"amount\" : \"777.0\",        (float) The native coins they hold\n"
+            "    \"reserves\" : {...}           (object) The reserve currencies they hold\n"
+            "  }\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("coinsupply", "420")
@@ -393,6 +405,21 @@ UniValue coinsupply(const UniValue& params, bool fHelp)
             result.push_back(Pair("immature", ValueFromAmount(immature)));
             result.push_back(Pair("zfunds", ValueFromAmount(zfunds)));
             result.push_back(Pair("total", ValueFromAmount(zfunds + supply)));
+
+            // the supply is summed from the issuance of each block, the unspent outputs are only known at the tip
+            CUTXOSetStats utxoStats;
+            if (GetUTXOSetStats(utxoStats))
+            {
+                LOCK(cs_main);
+                if (chainActive[height] && chainActive[height]->GetBlockHash() == utxoStats.hashBlock)
+                {
+                    UniValue utxos(UniValue::VOBJ);
+                    utxos.push_back(Pair("txouts", utxoStats.nTransactionOutputs));
+                    utxos.push_back(Pair("amount", ValueFromAmount(utxoStats.nTotalAmount)));
+                    utxos.push_back(Pair("reserves", utxoStats.reserves.ToUniValue()));
+                    result.push_back(Pair("utxos", utxos));
+                }
+            }
         } else result.push_back(Pair("error", "couldnt calculate supply"));
     } else {
         result.push_back(Pair("error", "invalid height"));
@@ -897,10 +924,10 @@ CIdentitySignature::ESignatureVerification CheckBasicIDSignature(uint256 msgHash
         std::set<uint160> signatureKeyIDs;
         for (auto &oneSig : signature.signatures)
         {
-            CPubKey pubkey;
-            if (pubkey.RecoverCompact(msgHash, oneSig))
+            uint160 keyID;
+            if (CIdentitySignature::RecoverSignatureKeyID(msgHash, oneSig, keyID))
             {
-                signatureKeyIDs.insert(pubkey.GetID());
+                signatureKeyIDs.insert(keyID);
             }
         }
 
@@ -1728,6 +1755,46 @@ bool getAddressesFromParams(const UniValue& params, std::vector<std::pair<uint16
     return true;
 }
 
+// reads "limit" and "cursor" from a paged address query, returning true if the query is paged. the cursor is the hex
+// serialized index key of the last entry of the previous page, and reading resumes after it, at the address it belongs to
+template <typename INDEXKEY>
+static bool GetAddressPageParams(const UniValue& params,
+                                 const std::vector<std::pair<uint160, int> > &addresses,
+                                 int64_t &limit,
+                                 INDEXKEY &cursorKey,
+                                 bool &hasCursor,
+                                 size_t &firstAddress)
+{
+    limit = 0;
+    hasCursor = false;
+    firstAddress = 0;
+    if (!params[0].isObject()) {
+        return false;
+    }
+
+    limit = uni_get_int64(find_value(params[0].get_obj(), "limit"));
+    if (limit < 0) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "limit must not be negative");
+    }
+    std::string cursorStr = uni_get_str(find_value(params[0].get_obj(), "cursor"));
+    if (!cursorStr.empty()) {
+        bool success = false;
+        if (IsHex(cursorStr)) {
+            ::FromVector(ParseHex(cursorStr), cursorKey, &success);
+        }
+        for (; success && firstAddress < addresses.size(); firstAddress++) {
+            if (addresses[firstAddress].first == cursorKey.hashBytes && addresses[firstAddress].second == (int)cursorKey.type) {
+                break;
+            }
+        }
+        if (!success || firstAddress == addresses.size()) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor: " + cursorStr);
+        }
+        hasCursor = true;
+    }
+    return limit || hasCursor;
+}
+
 bool heightSort(std::pair<CAddressUnspentKey, CAddressUnspentValue> a,
                 std::pair<CAddressUnspentKey, CAddressUnspentValue> b) {
     return a.second.blockHeight < b.second.blockHeight;
@@ -1739,16 +1806,12 @@ bool timestampSort(std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> a,
 }
 
 
-void CurrencyValuesAndNames(UniValue &output, bool spending, const CScript &script, CAmount satoshis, bool friendlyNames=false);
-void CurrencyValuesAndNames(UniValue &output, bool spending, const CScript &script, CAmount satoshis, bool friendlyNames)
+void CurrencyValuesAndNames(UniValue &output, const CCurrencyValueMap &reserveValues, CAmount satoshis, bool friendlyNames=false);
+void CurrencyValuesAndNames(UniValue &output, const CCurrencyValueMap &reserveValues, CAmount satoshis, bool friendlyNames)
 {
     if (CConstVerusSolutionVector::GetVersionByHeight(chainActive.Height()) >= CActivationHeight::ACTIVATE_PBAAS)
     {
-        CCurrencyValueMap reserves = script.ReserveOutValue();
-        if (spending)
-        {
-            reserves = reserves * -1;
-        }
+        CCurrencyValueMap reserves = reserveValues;
         if (satoshis)
         {
             reserves.valueMap[ASSETCHAINS_CHAINID] = satoshis;
@@ -1775,6 +1838,17 @@ void CurrencyValuesAndNames(UniValue &output, bool spending, const CScript &scri
     }
 }
 
+void CurrencyValuesAndNames(UniValue &output, bool spending, const CScript &script, CAmount satoshis, bool friendlyNames=false);
+void CurrencyValuesAndNames(UniValue &output, bool spending, const CScript &script, CAmount satoshis, bool friendlyNames)
+{
+    CCurrencyValueMap reserves = script.ReserveOutValue();
+    if (spending)
+    {
+        reserves = reserves * -1;
+    }
+    CurrencyValuesAndNames(output, reserves, satoshis, friendlyNames);
+}
+
 void CurrencyValuesAndNames(UniValue &output, bool spending, const CTransaction &tx, int index, CAmount satoshis, bool friendlyNames=false);
 void CurrencyValuesAndNames(UniValue &output, bool spending, const CTransaction &tx, int index, CAmount satoshis, bool friendlyNames)
 {
@@ -1939,13 +2013,12 @@ UniValue AddressMemPoolUni(const std::vector<std::pair<uint160, int>> &addresses
         delta.push_back(Pair("index", (int)it->first.index));
         delta.push_back(Pair("satoshis", it->second.amount));
         delta.push_back(Pair("spending", (bool)it->first.spending));
-        if (!it->first.txhash.IsNull() && (it->first.txhash == curTx.GetHash() || mempool.lookup(it->first.txhash, curTx)))
+        // reserve values are kept with each delta, so only output details need the transaction
+        CurrencyValuesAndNames(delta, it->second.reserves, it->second.amount, friendlyNames);
+        if (verbosity && it->first.spending && !it->first.txhash.IsNull() &&
+            (it->first.txhash == curTx.GetHash() || mempool.lookup(it->first.txhash, curTx)))
         {
-            CurrencyValuesAndNames(delta, it->first.spending, curTx, it->first.index, it->second.amount, friendlyNames);
-            if (verbosity && it->first.spending)
-            {
-                GetDeltaOutputDetails(delta, curTx);
-            }
+            GetDeltaOutputDetails(delta, curTx);
         }
         delta.push_back(Pair("timestamp", it->second.time));
         if (it->second.amount < 0) {
@@ -1972,6 +2045,7 @@ UniValue getaddressmempool(const UniValue& params, bool fHelp)
             "    ]\n"
             "  \"friendlynames\"    (boolean) Include additional array of friendly names keyed by currency i-addresses\n"
             "  \"verbosity\"        (number) (default == 0), if 1, include output information for spends, including all reserve amounts and destinations\n"
+            "  \"summary\"          (boolean, optional default=false) Return only the net mempool change of each address\n"
             "}\n"
             "\nResult:\n"
             "[\n"
@@ -1985,6 +2059,8 @@ UniValue getaddressmempool(const UniValue& params, bool fHelp)
             "    \"prevout\"  (string) The previous transaction output index (if spending)\n"
             "  }\n"
             "]\n"
+            "with \"summary\", one entry for each address with mempool activity, with its \"address\", net \"satoshis\"\n"
+            "and, after PBaaS activation, net \"currencyvalues\"\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddressmempool", "'{\"addresses\": [\"RY5LccmGiX9bUHYGtSWQouNy1yFhc5rM87\"]}'")
             + HelpExampleRpc("getaddressmempool", "{\"addresses\": [\"RY5LccmGiX9bUHYGtSWQouNy1yFhc5rM87\"]}")
@@ -2000,15 +2076,42 @@ UniValue getaddressmempool(const UniValue& params, bool fHelp)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
-    if (verbosity || friendlyNames)
+    // deltas are copied out under the mempool lock, which is only held further to read spending transactions, and
+    // friendly names are the only reason to hold cs_main, so polling does not wait on transaction acceptance
+    if (uni_get_bool(find_value(params[0].get_obj(), "summary")))
+    {
+        std::map<std::pair<uint160, int>, std::pair<CAmount, CCurrencyValueMap>> totals;
+        mempool.getAddressTotals(addresses, totals);
+
+        CCriticalBlock mainLock(friendlyNames ? &cs_main : nullptr, "cs_main", __FILE__, __LINE__);
+        for (auto &oneAddress : addresses)
+        {
+            auto totalIt = totals.find(oneAddress);
+            if (totalIt == totals.end())
+            {
+                continue;
+            }
+            std::string address;
+            if (!getAddressFromIndex(oneAddress.second, oneAddress.first, address)) {
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
+            }
+            UniValue addressTotal(UniValue::VOBJ);
+            addressTotal.push_back(Pair("address", address));
+            addressTotal.push_back(Pair("satoshis", totalIt->second.first));
+            CurrencyValuesAndNames(addressTotal, totalIt->second.second, totalIt->second.first, friendlyNames);
+            result.push_back(addressTotal);
+            totals.erase(totalIt);
+        }
+    }
+    else if (verbosity)
     {
         LOCK2(cs_main, mempool.cs);
         result = AddressMemPoolUni(addresses, friendlyNames, verbosity);
     }
     else
     {
-        LOCK(mempool.cs);
-        result = AddressMemPoolUni(addresses, false, 0);
+        CCriticalBlock mainLock(friendlyNames ? &cs_main : nullptr, "cs_main", __FILE__, __LINE__);
+        result = AddressMemPoolUni(addresses, friendlyNames, 0);
     }
     return result;
 }
@@ -2029,6 +2132,8 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp)
             "  \"chaininfo\"    (boolean) Include chain info with results\n"
             "  \"friendlynames\" (boolean, optional default=false) Include additional array of friendly names keyed by currency i-addresses\n"
             "  \"verbosity\"    (number) (default == 0), if 1, include output information for spends, including all reserve amounts and destinations\n"
+            "  \"limit\"        (number, optional) Return at most this many outputs, in index order rather than by height\n"
+            "  \"cursor\"       (string, optional) \"nextcursor\" from the previous page, to continue after it\n"
             "}\n"
             "\nResult\n"
             "[\n"
@@ -2041,6 +2146,7 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp)
             "    \"satoshis\"  (number) The number of satoshis of the output\n"
             "  }\n"
             "]\n"
+            "with \"limit\" or \"cursor\", an object with this array as \"utxos\" and, if there are more, \"nextcursor\"\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddressutxos", "'{\"addresses\": [\"RY5LccmGiX9bUHYGtSWQouNy1yFhc5rM87\"]}'")
             + HelpExampleRpc("getaddressutxos", "{\"addresses\": [\"RY5LccmGiX9bUHYGtSWQouNy1yFhc5rM87\"]}")
@@ -2055,20 +2161,53 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
-    LOCK(cs_main);
+    int64_t limit;
+    CAddressUnspentKey cursorKey;
+    bool hasCursor;
+    size_t firstAddress;
+    bool paged = GetAddressPageParams(params, addresses, limit, cursorKey, hasCursor, firstAddress);
+
+    // the index is read and the reply built without cs_main, as of the tip the snapshot was taken with
+    std::shared_ptr<const CChainReadSnapshot> snapshot = GetChainReadSnapshot();
+    const CDBSnapshot *pIndexSnapshot = snapshot->indexSnapshot.get();
 
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
 
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (!GetAddressUnspent((*it).first, (*it).second, unspentOutputs)) {
+    if (!paged && addresses.size() > 1) {
+        if (!GetAddressUnspent(addresses, unspentOutputs, pIndexSnapshot)) {
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
         }
+        firstAddress = addresses.size();
     }
 
-    std::sort(unspentOutputs.begin(), unspentOutputs.end(), heightSort);
+    // when paged, read one more than the limit to know whether there is another page
+    for (size_t i = firstAddress; i < addresses.size() && (!limit || unspentOutputs.size() <= limit); i++) {
+        if (!GetAddressUnspent(addresses[i].first,
+                               addresses[i].second,
+                               unspentOutputs,
+                               limit ? limit + 1 - unspentOutputs.size() : 0,
+                               (hasCursor && i == firstAddress) ? &cursorKey : nullptr,
+                               pIndexSnapshot)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+        }
+    }
+
+    std::string nextCursor;
+    if (limit && unspentOutputs.size() > limit) {
+        unspentOutputs.resize(limit);
+        nextCursor = HexStr(::AsVector(unspentOutputs.back().first));
+    }
+
+    // pages stay in index order, so that they can be continued
+    if (!paged) {
+        std::sort(unspentOutputs.begin(), unspentOutputs.end(), heightSort);
+    }
 
     UniValue utxos(UniValue::VARR);
 
+    // friendly names look up currency definitions
+    CCriticalBlock mainLock(friendlyNames ? &cs_main : nullptr, "cs_main", __FILE__, __LINE__);
+
     for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++) {
         UniValue output(UniValue::VOBJ);
 
@@ -2113,20 +2252,24 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp)
         }
         output.push_back(Pair("satoshis", it->second.satoshis));
         output.push_back(Pair("height", it->second.blockHeight));
-        if (chainActive.Height() >= it->second.blockHeight)
+        if (snapshot->Height() >= it->second.blockHeight)
         {
-            output.push_back(Pair("blocktime", chainActive[it->second.blockHeight]->GetBlockTime()));
+            output.push_back(Pair("blocktime", (*snapshot)[it->second.blockHeight]->GetBlockTime()));
         }
         utxos.push_back(output);
     }
 
-    if (includeChainInfo) {
+    if (includeChainInfo || paged) {
         UniValue result(UniValue::VOBJ);
         result.push_back(Pair("utxos", utxos));
 
-        LOCK(cs_main);
-        result.push_back(Pair("hash", chainActive.LastTip()->GetBlockHash().GetHex()));
-        result.push_back(Pair("height", (int)chainActive.Height()));
+        if (includeChainInfo) {
+            result.push_back(Pair("hash", snapshot->pTip->GetBlockHash().GetHex()));
+            result.push_back(Pair("height", snapshot->Height()));
+        }
+        if (!nextCursor.empty()) {
+            result.push_back(Pair("nextcursor", nextCursor));
+        }
         return result;
     } else {
         return utxos;
@@ -2151,6 +2294,8 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
             "  \"chaininfo\" (boolean) Include chain info in results, only applies if start and end specified\n"
             "  \"friendlynames\" (boolean) Include additional array of friendly names keyed by currency i-addresses\n"
             "  \"verbosity\" (number) (default == 0), if 1, include output information for spends, including all reserve amounts and destinations\n"
+            "  \"limit\" (number, optional) Return at most this many changes\n"
+            "  \"cursor\" (string, optional) \"nextcursor\" from the previous page, to continue after it\n"
             "}\n"
             "\nResult:\n"
             "[\n"
@@ -2162,6 +2307,7 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
             "    \"address\"  (string) The base58check encoded address\n"
             "  }\n"
             "]\n"
+            "with \"limit\" or \"cursor\", an object with this array as \"deltas\" and, if there are more, \"nextcursor\"\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddressdeltas", "'{\"addresses\": [\"RY5LccmGiX9bUHYGtSWQouNy1yFhc5rM87\"]}'")
             + HelpExampleRpc("getaddressdeltas", "{\"addresses\": [\"RY5LccmGiX9bUHYGtSWQouNy1yFhc5rM87\"]}")
@@ -2195,20 +2341,38 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
+    int64_t limit;
+    CAddressIndexKey cursorKey;
+    bool hasCursor;
+    size_t firstAddress;
+    bool paged = GetAddressPageParams(params, addresses, limit, cursorKey, hasCursor, firstAddress);
+
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    std::string nextCursor;
 
     {
         LOCK(cs_main);
-        for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-            if (start > 0 && end > 0) {
-                if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
-                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-                }
-            } else {
-                if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
-                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-                }
+        if (!paged && addresses.size() > 1) {
+            if (!GetAddressIndex(addresses, addressIndex, start, end)) {
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
             }
+            firstAddress = addresses.size();
+        }
+        // when paged, read one more than the limit to know whether there is another page
+        for (size_t i = firstAddress; i < addresses.size() && (!limit || addressIndex.size() <= limit); i++) {
+            if (!GetAddressIndex(addresses[i].first,
+                                 addresses[i].second,
+                                 addressIndex,
+                                 start,
+                                 end,
+                                 limit ? limit + 1 - addressIndex.size() : 0,
+                                 (hasCursor && i == firstAddress) ? &cursorKey : nullptr)) {
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+            }
+        }
+        if (limit && addressIndex.size() > limit) {
+            addressIndex.resize(limit);
+            nextCursor = HexStr(::AsVector(addressIndex.back().first));
         }
     }
 
@@ -2275,11 +2439,16 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
         result.push_back(Pair("deltas", deltas));
         result.push_back(Pair("start", startInfo));
         result.push_back(Pair("end", endInfo));
-
-        return result;
+    } else if (paged) {
+        result.push_back(Pair("deltas", deltas));
     } else {
         return deltas;
     }
+
+    if (!nextCursor.empty()) {
+        result.push_back(Pair("nextcursor", nextCursor));
+    }
+    return result;
 }
 
 UniValue getaddressbalance(const UniValue& params, bool fHelp)
@@ -2319,20 +2488,33 @@ UniValue getaddressbalance(const UniValue& params, bool fHelp)
 
     LOCK2(cs_main, mempool.cs);
 
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (!GetAddressIndex((*it).first, (*it).second, addressIndex, 0, asOfBlock)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-        }
-    }
-
-    CTransaction curTx;
-
     CAmount balance = 0;
     CAmount received = 0;
 
     CCurrencyValueMap reserveBalance;
     CCurrencyValueMap reserveReceived;
 
+    // current balances come from the running totals when they are indexed, and from the address history otherwise,
+    // including while the balance index is being built in the background
+    bool useBalanceIndex = fAddressBalanceIndex && asOfBlock <= 0 && !IsIndexBuilding(BACKGROUND_INDEX_ADDRESSBALANCE);
+
+    if (useBalanceIndex) {
+        for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+            CAddressBalanceValue addressBalance;
+            if (!GetAddressBalance((*it).first, (*it).second, addressBalance)) {
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+            }
+            balance += addressBalance.balance;
+            received += addressBalance.received;
+            reserveBalance += addressBalance.reserveBalance;
+            reserveReceived += addressBalance.reserveReceived;
+        }
+    } else if (!GetAddressIndex(addresses, addressIndex, 0, asOfBlock)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+    }
+
+    CTransaction curTx;
+
     for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
         uint256 blockHash;
         if (!it->first.txhash.IsNull() && (it->first.txhash == curTx.GetHash() || myGetTransaction(it->first.txhash, curTx, blockHash)))
@@ -2475,12 +2657,16 @@ UniValue getaddresstxids(const UniValue& params, bool fHelp)
             "    ]\n"
             "  \"start\" (number) The start block height\n"
             "  \"end\" (number) The end block height\n"
+            "  \"limit\" (number, optional) Read at most this many address index entries, so a transaction with several\n"
+            "          entries for the address may end one page and begin the next\n"
+            "  \"cursor\" (string, optional) \"nextcursor\" from the previous page, to continue after it\n"
             "}\n"
             "\nResult:\n"
             "[\n"
             "  \"transactionid\"  (string) The transaction id\n"
             "  ,...\n"
             "]\n"
+            "with \"limit\" or \"cursor\", an object with this array as \"txids\" and, if there are more, \"nextcursor\"\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddresstxids", "'{\"addresses\": [\"RY5LccmGiX9bUHYGtSWQouNy1yFhc5rM87\"]}'")
             + HelpExampleRpc("getaddresstxids", "{\"addresses\": [\"RY5LccmGiX9bUHYGtSWQouNy1yFhc5rM87\"]}")
@@ -2503,20 +2689,43 @@ UniValue getaddresstxids(const UniValue& params, bool fHelp)
         }
     }
 
+    int64_t limit;
+    CAddressIndexKey cursorKey;
+    bool hasCursor;
+    size_t firstAddress;
+    bool paged = GetAddressPageParams(params, addresses, limit, cursorKey, hasCursor, firstAddress);
+
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
 
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (start > 0 && end > 0) {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        } else {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
+    if (!paged && addresses.size() > 1) {
+        if (!GetAddressIndex(addresses, addressIndex, start, end)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
         }
+        firstAddress = addresses.size();
     }
 
+    // when paged, read one more than the limit to know whether there is another page
+    for (size_t i = firstAddress; i < addresses.size() && (!limit || addressIndex.size() <= limit); i++) {
+        if (!GetAddressIndex(addresses[i].first,
+                             addresses[i].second,
+                             addressIndex,
+                             start,
+                             end,
+                             limit ? limit + 1 - addressIndex.size() : 0,
+                             (hasCursor && i == firstAddress) ? &cursorKey : nullptr)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+        }
+    }
+
+    std::string nextCursor;
+    if (limit && addressIndex.size() > limit) {
+        addressIndex.resize(limit);
+        nextCursor = HexStr(::AsVector(addressIndex.back().first));
+    }
+
+    // entries from several addresses are already merged into chain order, except for pages, which are read address by address
+    bool sortTxids = paged && addresses.size() > 1;
+
     std::set<std::pair<int, std::string> > txids;
     UniValue result(UniValue::VARR);
 
@@ -2524,7 +2733,7 @@ UniValue getaddresstxids(const UniValue& params, bool fHelp)
         int height = it->first.blockHeight;
         std::string txid = it->first.txhash.GetHex();
 
-        if (addresses.size() > 1) {
+        if (sortTxids) {
             txids.insert(std::make_pair(height, txid));
         } else {
             if (txids.insert(std::make_pair(height, txid)).second) {
@@ -2533,12 +2742,20 @@ UniValue getaddresstxids(const UniValue& params, bool fHelp)
         }
     }
 
-    if (addresses.size() > 1) {
+    if (sortTxids) {
         for (std::set<std::pair<int, std::string> >::const_iterator it=txids.begin(); it!=txids.end(); it++) {
             result.push_back(it->second);
         }
     }
 
+    if (paged) {
+        UniValue pageResult(UniValue::VOBJ);
+        pageResult.push_back(Pair("txids", result));
+        if (!nextCursor.empty()) {
+            pageResult.push_back(Pair("nextcursor", nextCursor));
+        }
+        return pageResult;
+    }
     return result;
 }
 
@@ -2627,11 +2844,460 @@ UniValue processupgradedata(const UniValue& params, bool fHelp)
     return retVal;
 }
 
+static void ParseSubscriptionKeys(const UniValue& obj, const std::string& strField, std::set<uint160>& keys)
+{
+    UniValue values = find_value(obj, strField);
+    if (values.isNull())
+        return;
+    if (!values.isArray())
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strField + " must be an array");
+
+    for (int i = 0; i < values.size(); i++)
+    {
+        std::string strKey = uni_get_str(values[i]);
+        uint160 key;
+        if (strField == "currencies")
+        {
+            LOCK(cs_main);
+            key = ValidateCurrencyName(strKey, true);
+        }
+        else
+        {
+            CTxDestination dest = DecodeDestination(strKey);
+            if (strField == "addresses" ? IsValidDestination(dest) : dest.which() == COptCCParams::ADDRTYPE_ID)
+                key = GetDestinationID(dest);
+        }
+        if (key.IsNull())
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid entry in " + strField + ": " + strKey);
+        keys.insert(key);
+    }
+}
+
+UniValue subscribe(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1 || !params[0].isObject())
+        throw runtime_error(
+            "subscribe {\"addresses\":[...], \"identities\":[...], \"currencies\":[...], \"vdxfkeys\":[...], \"blocks\":bool}\n"
+            "\nCreates a subscription to transactions that pay to or spend from the given addresses, update the given identities,\n"
+            "define, hold or convert the given currencies, or are indexed by the given VDXF keys, and optionally to connected and\n"
+            "disconnected blocks. Events are then collected with waitforsubscriptionevents.\n"
+            "\nArguments:\n"
+            "{\n"
+            "  \"addresses\"     (array, optional) transparent addresses or IDs\n"
+            "  \"identities\"    (array, optional) identity names or i-addresses\n"
+            "  \"currencies\"    (array, optional) currency names or i-addresses\n"
+            "  \"vdxfkeys\"      (array, optional) VDXF keys as i-addresses\n"
+            "  \"blocks\"        (bool, optional, default=false) also report connected and disconnected blocks\n"
+            "}\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"subscriptionid\"  (string) passed to waitforsubscriptionevents and unsubscribe\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("subscribe", "'{\"identities\":[\"alice@\"], \"blocks\":true}'")
+            + HelpExampleRpc("subscribe", "{\"identities\":[\"alice@\"], \"blocks\":true}")
+        );
+
+    if (!pSubscriptionIndex)
+        throw JSONRPCError(RPC_MISC_ERROR, "Subscriptions are disabled, start with -maxsubscriptions above 0");
+
+    std::set<uint160> keys;
+    ParseSubscriptionKeys(params[0], "addresses", keys);
+    ParseSubscriptionKeys(params[0], "identities", keys);
+    ParseSubscriptionKeys(params[0], "currencies", keys);
+    ParseSubscriptionKeys(params[0], "vdxfkeys", keys);
+    bool fBlocks = uni_get_bool(find_value(params[0], "blocks"));
+    if (keys.size() > MAX_SUBSCRIPTION_KEYS)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("At most %u keys may be subscribed to at once", MAX_SUBSCRIPTION_KEYS));
+    if (keys.empty() && !fBlocks)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Nothing to subscribe to");
+
+    uint256 id = pSubscriptionIndex->Subscribe(keys, fBlocks);
+    if (id.IsNull())
+        throw JSONRPCError(RPC_OUT_OF_MEMORY, "Too many subscriptions");
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("subscriptionid", id.GetHex());
+    return ret;
+}
+
+static std::string SubscriptionEventTypeName(SubscriptionEventType type)
+{
+    switch (type)
+    {
+        case SUBSCRIPTION_EVENT_MEMPOOL:
+            return "mempool";
+        case SUBSCRIPTION_EVENT_CONFIRMED:
+            return "confirmed";
+        case SUBSCRIPTION_EVENT_BLOCK_CONNECTED:
+            return "blockconnected";
+        case SUBSCRIPTION_EVENT_BLOCK_DISCONNECTED:
+            return "blockdisconnected";
+    }
+    return "unknown";
+}
+
+UniValue waitforsubscriptionevents(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() < 1 || params.size() > 3)
+        throw runtime_error(
+            "waitforsubscriptionevents \"subscriptionid\" (acknowledged) (timeout)\n"
+            "\nReturns the events of a subscription after the acknowledged sequence number, waiting up to timeout seconds if\n"
+            "there are none yet. Events up to the acknowledged one are dropped, so a client passes the last sequence number it\n"
+            "has processed on each call. A subscription that is not polled for -subscriptiontimeout seconds is removed.\n"
+            "\nArguments:\n"
+            "1. \"subscriptionid\"  (string, required) as returned by subscribe\n"
+            "2. acknowledged        (number, optional, default=0) last sequence number processed\n"
+            "3. timeout             (number, optional, default=30) seconds to wait for events, at most " + std::to_string(MAX_SUBSCRIPTION_WAIT) + "\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"overflowed\": bool   (bool) true if events were dropped unacknowledged since the last call, state should be reloaded\n"
+            "  \"events\": [\n"
+            "    {\n"
+            "      \"sequence\": n     (number) sequence number of this event\n"
+            "      \"type\": \"xxx\"     (string) mempool, confirmed, blockconnected or blockdisconnected\n"
+            "      \"txid\": \"hash\"    (string) the matching transaction, for mempool and confirmed events\n"
+            "      \"blockhash\": \"hash\" (string) the block of a confirmed transaction or block event\n"
+            "      \"height\": n       (number) height of that block\n"
+            "      \"matched\": [...]  (array) hashes in hex of the subscribed addresses, identities, currencies or keys matched\n"
+            "    }, ...\n"
+            "  ]\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("waitforsubscriptionevents", "\"subscriptionid\" 12 30")
+            + HelpExampleRpc("waitforsubscriptionevents", "\"subscriptionid\", 12, 30")
+        );
+
+    if (!pSubscriptionIndex)
+        throw JSONRPCError(RPC_MISC_ERROR, "Subscriptions are disabled, start with -maxsubscriptions above 0");
+
+    uint256 id = ParseHashV(params[0], "subscriptionid");
+    int64_t nAcknowledged = params.size() > 1 ? uni_get_int64(params[1]) : 0;
+    int nTimeout = params.size() > 2 ? uni_get_int(params[2]) : 30;
+    if (nAcknowledged < 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid acknowledged sequence number");
+    nTimeout = std::max(0, std::min(nTimeout, MAX_SUBSCRIPTION_WAIT));
+
+    std::vector<CSubscriptionEvent> events;
+    bool fOverflowed = false;
+    if (!pSubscriptionIndex->WaitForEvents(id, nAcknowledged, nTimeout, events, fOverflowed))
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Unknown or expired subscription");
+
+    UniValue eventsArr(UniValue::VARR);
+    for (auto& event : events)
+    {
+        UniValue oneEvent(UniValue::VOBJ);
+        oneEvent.pushKV("sequence", (int64_t)event.nSequence);
+        oneEvent.pushKV("type", SubscriptionEventTypeName(event.type));
+        if (event.type == SUBSCRIPTION_EVENT_MEMPOOL || event.type == SUBSCRIPTION_EVENT_CONFIRMED)
+        {
+            oneEvent.pushKV("txid", event.hash.GetHex());
+            if (event.type == SUBSCRIPTION_EVENT_CONFIRMED)
+                oneEvent.pushKV("blockhash", event.blockHash.GetHex());
+        }
+        else
+        {
+            oneEvent.pushKV("blockhash", event.hash.GetHex());
+        }
+        if (event.nHeight >= 0)
+            oneEvent.pushKV("height", event.nHeight);
+        if (!event.vMatched.empty())
+        {
+            UniValue matched(UniValue::VARR);
+            for (auto& key : event.vMatched)
+                matched.push_back(key.GetHex());
+            oneEvent.pushKV("matched", matched);
+        }
+        eventsArr.push_back(oneEvent);
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("overflowed", fOverflowed);
+    ret.pushKV("events", eventsArr);
+    return ret;
+}
+
+UniValue unsubscribe(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+            "unsubscribe \"subscriptionid\"\n"
+            "\nRemoves a subscription and any of its events not yet collected.\n"
+            "\nArguments:\n"
+            "1. \"subscriptionid\"  (string, required) as returned by subscribe\n"
+            "\nResult:\n"
+            "true|false           (bool) false if there was no such subscription\n"
+            "\nExamples:\n"
+            + HelpExampleCli("unsubscribe", "\"subscriptionid\"")
+            + HelpExampleRpc("unsubscribe", "\"subscriptionid\"")
+        );
+
+    if (!pSubscriptionIndex)
+        throw JSONRPCError(RPC_MISC_ERROR, "Subscriptions are disabled, start with -maxsubscriptions above 0");
+
+    return pSubscriptionIndex->Unsubscribe(ParseHashV(params[0], "subscriptionid"));
+}
+
+UniValue getnotificationinfo(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getnotificationinfo\n"
+            "\nReturns the state of the queues that ZMQ and AMQP notifications are sent from.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"name\": {                    (object) One entry for each enabled queue, \"zmq\" or \"amqp\"\n"
+            "    \"policy\": \"block|drop\"      (string) What is done with a notification when the queue is full\n"
+            "    \"maxsize\": n                (numeric) Notifications waiting at which the queue is full\n"
+            "    \"depth\": n                  (numeric) Notifications waiting to be sent\n"
+            "    \"maxdepth\": n               (numeric) Most notifications that have been waiting at once\n"
+            "    \"queued\": n                 (numeric) Notifications queued since startup\n"
+            "    \"sent\": n                   (numeric) Notifications sent since startup\n"
+            "    \"dropped\": n                (numeric) Notifications dropped because the queue was full\n"
+            "    \"blocked\": n                (numeric) Notifications that validation waited to queue\n"
+            "    \"blockedms\": n              (numeric) Milliseconds validation spent waiting for room\n"
+            "  },\n"
+            "  ...\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getnotificationinfo", "")
+            + HelpExampleRpc("getnotificationinfo", "")
+        );
+
+    return GetNotificationQueueInfo();
+}
+
+UniValue getschedulerinfo(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getschedulerinfo\n"
+            "\nReturns the state of the scheduler that runs periodic background tasks, and the runtimes of its tasks.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"threads\": n                  (numeric) Threads servicing the queue\n"
+            "  \"queued\": n                   (numeric) Tasks waiting to run\n"
+            "  \"tasks\": {\n"
+            "    \"name\": {                    (object) One entry for each task that has run or is running\n"
+            "      \"runs\": n                 (numeric) Times the task has finished\n"
+            "      \"running\": n              (numeric) Instances of the task running now\n"
+            "      \"totalms\": n.nnn          (numeric) Milliseconds spent running the task\n"
+            "      \"averagems\": n.nnn        (numeric) Average milliseconds per run\n"
+            "      \"maxms\": n.nnn            (numeric) Longest run in milliseconds\n"
+            "      \"lastms\": n.nnn           (numeric) Last run in milliseconds\n"
+            "      \"maxdelayms\": n.nnn       (numeric) Longest a run started after it was due, in milliseconds\n"
+            "    },\n"
+            "    ...\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getschedulerinfo", "")
+            + HelpExampleRpc("getschedulerinfo", "")
+        );
+
+    CScheduler *pscheduler = GetMainScheduler();
+    if (!pscheduler)
+        throw JSONRPCError(RPC_IN_WARMUP, "Scheduler not started");
+
+    int nThreads = 0;
+    boost::chrono::system_clock::time_point first, last;
+    size_t nQueued = pscheduler->getQueueInfo(first, last);
+    std::map<std::string, CScheduler::TaskStats> taskStats = pscheduler->getTaskStats(nThreads);
+
+    UniValue ret(UniValue::VOBJ), tasks(UniValue::VOBJ);
+    ret.push_back(Pair("threads", nThreads));
+    ret.push_back(Pair("queued", (uint64_t)nQueued));
+    for (auto &oneTask : taskStats) {
+        const CScheduler::TaskStats &stats = oneTask.second;
+        UniValue oneStats(UniValue::VOBJ);
+        oneStats.push_back(Pair("runs", stats.nRuns));
+        oneStats.push_back(Pair("running", stats.nRunning));
+        oneStats.push_back(Pair("totalms", stats.nTotalMicros / 1000.0));
+        oneStats.push_back(Pair("averagems", stats.nRuns ? stats.nTotalMicros / 1000.0 / stats.nRuns : 0.0));
+        oneStats.push_back(Pair("maxms", stats.nMaxMicros / 1000.0));
+        oneStats.push_back(Pair("lastms", stats.nLastMicros / 1000.0));
+        oneStats.push_back(Pair("maxdelayms", stats.nMaxDelayMicros / 1000.0));
+        tasks.push_back(Pair(oneTask.first, oneStats));
+    }
+    ret.push_back(Pair("tasks", tasks));
+    return ret;
+}
+
+// the resident set size of this process from /proc, or 0 where that is not available
+static uint64_t GetResidentMemory()
+{
+#ifdef __linux__
+    uint64_t nPages = 0, nResidentPages = 0;
+    std::ifstream statm("/proc/self/statm");
+    if (statm >> nPages >> nResidentPages)
+        return nResidentPages * (uint64_t)sysconf(_SC_PAGESIZE);
+#endif
+    return 0;
+}
+
+UniValue getmemoryinfo(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getmemoryinfo\n"
+            "\nReturns the approximate heap memory, in bytes, held by the caches and major structures of the daemon.\n"
+            "Entries of the PBaaS caches and wallet note witnesses are counted at their serialized size, and a\n"
+            "message queued to several peers is counted once for each of them.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"coinscache\": n,          (numeric) The coins cache of the chain tip\n"
+            "  \"mempool\": n,             (numeric) The memory pool with its indexes\n"
+            "  \"blockindex\": n,          (numeric) mapBlockIndex and its entries, with their solutions\n"
+            "  \"chainmmr\": n,            (numeric) The layers of the merkle mountain range of the active chain\n"
+            "  \"currencydefcache\": n,    (numeric) The currency definition cache\n"
+            "  \"currencystatecache\": n,  (numeric) The currency state cache\n"
+            "  \"identitycache\": n,       (numeric) The identity lookup cache\n"
+            "  \"txcache\": n,             (numeric) The cache of confirmed transactions read from disk\n"
+            "  \"wallettx\": n,            (numeric) The wallet transactions and their note data, without witnesses\n"
+            "  \"walletwitnesses\": n,     (numeric) The witnesses of the wallet notes\n"
+            "  \"netsend\": n,             (numeric) Messages queued to be sent to peers\n"
+            "  \"netrecv\": n,             (numeric) Messages received from peers and not yet processed\n"
+            "  \"leveldbcache\": n,        (numeric) The block caches of the LevelDB databases in use\n"
+            "  \"leveldbwritebuffer\": n,  (numeric) The configured write buffers of the LevelDB databases\n"
+            "  \"total\": n,               (numeric) The sum of the above\n"
+            "  \"resident\": n             (numeric) The resident set size of the process, where it is known\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getmemoryinfo", "")
+            + HelpExampleRpc("getmemoryinfo", "")
+        );
+
+    UniValue ret(UniValue::VOBJ);
+    uint64_t nTotal = 0;
+    auto addUsage = [&](const std::string &name, size_t usage) {
+        ret.push_back(Pair(name, (uint64_t)usage));
+        nTotal += usage;
+    };
+
+    {
+        LOCK(cs_main);
+        addUsage("coinscache", pcoinsTip ? pcoinsTip->DynamicMemoryUsage() : 0);
+        addUsage("mempool", mempool.DynamicMemoryUsage());
+        addUsage("blockindex", GetBlockIndexMemoryUsage());
+        addUsage("chainmmr", chainActive.GetMMR().DynamicMemoryUsage());
+    }
+
+    // the keys of these caches are fixed size, so only their values hold memory outside of the cache nodes
+    addUsage("currencydefcache", ConnectedChains.currencyDefCache.DynamicMemoryUsage(
+        [](const uint160 &key, const CCurrencyDefinition &value) {
+            return ::GetSerializeSize(value, SER_DISK, PROTOCOL_VERSION);
+        }));
+    addUsage("currencystatecache", ConnectedChains.currencyStateCache.DynamicMemoryUsage(
+        [](const std::tuple<uint160, uint256, bool> &key, const CCoinbaseCurrencyState &value) {
+            return ::GetSerializeSize(value, SER_DISK, PROTOCOL_VERSION);
+        }));
+    addUsage("identitycache", CIdentity::IdentityLookupCache.DynamicMemoryUsage(
+        [](const CIdentityID &key, const std::tuple<CIdentity, uint32_t, CTxIn> &value) {
+            return ::GetSerializeSize(std::get<0>(value), SER_DISK, PROTOCOL_VERSION) +
+                   memusage::DynamicUsage(std::get<2>(value).scriptSig);
+        }));
+    addUsage("txcache", GetTransactionCacheStats().nMemoryUsage);
+
+    size_t nWalletTxUsage = 0, nWitnessUsage = 0;
+#ifdef ENABLE_WALLET
+    if (pwalletMain)
+    {
+        LOCK2(cs_main, pwalletMain->cs_wallet);
+        pwalletMain->GetMemoryUsage(nWalletTxUsage, nWitnessUsage);
+    }
+#endif
+    addUsage("wallettx", nWalletTxUsage);
+    addUsage("walletwitnesses", nWitnessUsage);
+
+    size_t nSendUsage = 0, nRecvUsage = 0;
+    {
+        LOCK(cs_vNodes);
+        for (CNode *pnode : vNodes)
+        {
+            {
+                LOCK(pnode->cs_vSend);
+                nSendUsage += pnode->nSendSize;
+            }
+            {
+                LOCK(pnode->cs_vRecvMsg);
+                nRecvUsage += pnode->GetTotalRecvSize();
+            }
+        }
+    }
+    addUsage("netsend", nSendUsage);
+    addUsage("netrecv", nRecvUsage);
+
+    size_t nLevelDBCache = 0, nLevelDBWriteBuffer = 0;
+    for (const CDBStats &stats : CDBWrapper::GetAllStats())
+    {
+        nLevelDBCache += stats.nCacheUsage;
+        nLevelDBWriteBuffer += stats.nWriteBufferSize;
+    }
+    addUsage("leveldbcache", nLevelDBCache);
+    addUsage("leveldbwritebuffer", nLevelDBWriteBuffer);
+
+    ret.push_back(Pair("total", nTotal));
+    ret.push_back(Pair("resident", GetResidentMemory()));
+    return ret;
+}
+
+static UniValue CacheStatsToJSON(uint64_t nEntries, int nCapacity, uint64_t nHits, uint64_t nMisses, uint64_t nEvictions)
+{
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("entries", nEntries));
+    ret.push_back(Pair("capacity", nCapacity));
+    ret.push_back(Pair("hits", nHits));
+    ret.push_back(Pair("misses", nMisses));
+    ret.push_back(Pair("evictions", nEvictions));
+    ret.push_back(Pair("hitrate", nHits + nMisses ? (double)nHits / (nHits + nMisses) : 0.0));
+    return ret;
+}
+
+UniValue getcacheinfo(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getcacheinfo\n"
+            "\nReturns the hit rates since startup of the in memory caches that validation and the PBaaS RPCs read through.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"txcache\": {              (object) Confirmed transactions read from disk, see -txcachesize\n"
+            "    \"entries\": n,           (numeric) Entries held\n"
+            "    \"capacity\": n,          (numeric) The most entries it holds, 0 when disabled\n"
+            "    \"hits\": n,              (numeric) Lookups found in the cache\n"
+            "    \"misses\": n,            (numeric) Lookups that were not\n"
+            "    \"evictions\": n,         (numeric) Entries removed to make room for newer ones\n"
+            "    \"hitrate\": x.xxx        (numeric) Fraction of lookups found in the cache\n"
+            "  },\n"
+            "  \"identitycache\": {...},   (object) Identity lookups, see -identitycachesize\n"
+            "  \"currencydefcache\": {...},  (object) Currency definitions\n"
+            "  \"currencystatecache\": {...} (object) Currency states at each height\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getcacheinfo", "")
+            + HelpExampleRpc("getcacheinfo", "")
+        );
+
+    UniValue ret(UniValue::VOBJ);
+    CTransactionCacheStats txStats = GetTransactionCacheStats();
+    ret.push_back(Pair("txcache", CacheStatsToJSON(txStats.nEntries, txStats.nCapacity, txStats.nHits, txStats.nMisses, txStats.nEvictions)));
+
+    uint64_t nHits, nMisses, nEvictions;
+    CIdentity::IdentityLookupCache.GetStats(nHits, nMisses, nEvictions);
+    ret.push_back(Pair("identitycache", CacheStatsToJSON(CIdentity::IdentityLookupCache.size(), CIdentity::IdentityLookupCache.capacity(), nHits, nMisses, nEvictions)));
+    ConnectedChains.currencyDefCache.GetStats(nHits, nMisses, nEvictions);
+    ret.push_back(Pair("currencydefcache", CacheStatsToJSON(ConnectedChains.currencyDefCache.size(), ConnectedChains.currencyDefCache.capacity(), nHits, nMisses, nEvictions)));
+    ConnectedChains.currencyStateCache.GetStats(nHits, nMisses, nEvictions);
+    ret.push_back(Pair("currencystatecache", CacheStatsToJSON(ConnectedChains.currencyStateCache.size(), ConnectedChains.currencyStateCache.capacity(), nHits, nMisses, nEvictions)));
+    return ret;
+}
 
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         okSafeMode
   //  --------------------- ------------------------  -----------------------  ----------
     { "control",            "getinfo",                &getinfo,                true  }, /* uses wallet if enabled */
+    { "control",            "getmemoryinfo",          &getmemoryinfo,          true  }, /* uses wallet if enabled */
+    { "control",            "getcacheinfo",           &getcacheinfo,           true  },
     { "util",               "validateaddress",        &validateaddress,        true  }, /* uses wallet if enabled */
     { "util",               "z_validateaddress",      &z_validateaddress,      true  }, /* uses wallet if enabled */
     { "util",               "createmultisig",         &createmultisig,         true  },
@@ -2653,6 +3319,13 @@ static const CRPCCommand commands[] =
     { "blockchain",         "processupgradedata",     &processupgradedata,     true },
     // END insightexplorer
 
+    { "subscriptions",      "subscribe",              &subscribe,              true  },
+    { "subscriptions",      "waitforsubscriptionevents", &waitforsubscriptionevents, true },
+    { "subscriptions",      "unsubscribe",            &unsubscribe,            true  },
+
+    { "control",            "getnotificationinfo",    &getnotificationinfo,    true  },
+    { "control",            "getschedulerinfo",       &getschedulerinfo,       true  },
+
     /* Not shown in help */
     { "hidden",             "setmocktime",            &setmocktime,            true  },
 };
@@ -63,6 +63,24 @@ UniValue ping(const UniValue& params, bool fHelp)
     return NullUniValue;
 }
 
+static UniValue MessageTypeStatsToJSON(const CNetMessageTypeStatsMap &stats, bool fSent)
+{
+    UniValue ret(UniValue::VOBJ);
+    for (const std::pair<const std::string, CNetMessageTypeStats> &entry : stats)
+    {
+        UniValue obj(UniValue::VOBJ);
+        obj.push_back(Pair("messages", entry.second.nMessages));
+        obj.push_back(Pair("bytes", entry.second.nBytes));
+        if (fSent)
+        {
+            obj.push_back(Pair("avgqueuems", entry.second.nMessages ? entry.second.nQueueMicros / (entry.second.nMessages * 1000.0) : 0.0));
+            obj.push_back(Pair("maxqueuems", entry.second.nMaxQueueMicros / 1000.0));
+        }
+        ret.push_back(Pair(entry.first, obj));
+    }
+    return ret;
+}
+
 void CopyNodeStats(std::vector<CNodeStats>& vstats)
 {
     vstats.clear();
@@ -109,7 +127,22 @@ UniValue getpeerinfo(const UniValue& params, bool fHelp)
             "    \"inflight\": [\n"
             "       n,                        (numeric) The heights of blocks we're currently asking from this peer\n"
             "       ...\n"
-            "    ]\n"
+            "    ],\n"
+            "    \"inflight_limit\": n,       (numeric) The number of blocks we currently allow in flight from this peer\n"
+            "    \"blocks_downloaded\": n,    (numeric) The number of requested blocks this peer has delivered\n"
+            "    \"block_response_time\": n,  (numeric) The average time in seconds this peer took to deliver a requested block\n"
+            "    \"block_download_rate\": n,  (numeric) The average rate in bytes per second this peer delivered blocks at\n"
+            "    \"sentbytype\": {            (object) Messages written to this peer by message type, headers included\n"
+            "      \"type\": {\n"
+            "        \"messages\": n,           (numeric) The number of messages\n"
+            "        \"bytes\": n,              (numeric) Their total size in bytes\n"
+            "        \"avgqueuems\": n,         (numeric) The average time in milliseconds from being queued until written\n"
+            "        \"maxqueuems\": n          (numeric) The longest such time in milliseconds\n"
+            "      }, ...\n"
+            "    },\n"
+            "    \"recvbytype\": {            (object) Messages received from this peer by message type, as \"messages\" and \"bytes\"\n"
+            "      ...\n"
+            "    }\n"
             "  }\n"
             "  ,...\n"
             "]\n"
@@ -161,10 +194,16 @@ UniValue getpeerinfo(const UniValue& params, bool fHelp)
                 heights.push_back(height);
             }
             obj.push_back(Pair("inflight", heights));
+            obj.push_back(Pair("inflight_limit", statestats.nBlocksInTransitLimit));
+            obj.push_back(Pair("blocks_downloaded", statestats.nBlocksDownloaded));
+            obj.push_back(Pair("block_response_time", statestats.nBlockResponseTime / 1000000.0));
+            obj.push_back(Pair("block_download_rate", statestats.dBlockBytesPerSec));
         }
         obj.pushKV("addr_processed", stats.m_addr_processed);
         obj.pushKV("addr_rate_limited", stats.m_addr_rate_limited);
         obj.push_back(Pair("whitelisted", stats.fWhitelisted));
+        obj.push_back(Pair("sentbytype", MessageTypeStatsToJSON(stats.mapSentByType, true)));
+        obj.push_back(Pair("recvbytype", MessageTypeStatsToJSON(stats.mapRecvByType, false)));
 
         ret.push_back(obj);
     }
@@ -412,7 +451,13 @@ UniValue getnettotals(const UniValue& params, bool fHelp)
             "{\n"
             "  \"totalbytesrecv\": n,   (numeric) Total bytes received\n"
             "  \"totalbytessent\": n,   (numeric) Total bytes sent\n"
-            "  \"timemillis\": t        (numeric) Total cpu time\n"
+            "  \"timemillis\": t,       (numeric) Total cpu time\n"
+            "  \"sentbytype\": {        (object) Messages written to all peers by message type, as in getpeerinfo\n"
+            "    ...\n"
+            "  },\n"
+            "  \"recvbytype\": {        (object) Messages received from all peers by message type, as in getpeerinfo\n"
+            "    ...\n"
+            "  }\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getnettotals", "")
@@ -423,6 +468,10 @@ UniValue getnettotals(const UniValue& params, bool fHelp)
     obj.push_back(Pair("totalbytesrecv", CNode::GetTotalBytesRecv()));
     obj.push_back(Pair("totalbytessent", CNode::GetTotalBytesSent()));
     obj.push_back(Pair("timemillis", GetTimeMillis()));
+    CNetMessageTypeStatsMap mapSent, mapRecv;
+    CNode::GetTotalMessageTypeStats(mapSent, mapRecv);
+    obj.push_back(Pair("sentbytype", MessageTypeStatsToJSON(mapSent, true)));
+    obj.push_back(Pair("recvbytype", MessageTypeStatsToJSON(mapRecv, false)));
     return obj;
 }
 
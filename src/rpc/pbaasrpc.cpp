@@ -31,6 +31,7 @@
 #include <stdint.h>
 
 #include <boost/assign/list_of.hpp>
+#include <boost/thread.hpp>
 
 #include <univalue.h>
 
@@ -198,7 +199,7 @@ bool GetCurrencyDefinition(const uint160 &chainID, CCurrencyDefinition &chainDef
                         COptCCParams p;
                         CPBaaSNotarization pbn;
 
-                        if (tx.vout[i].scriptPubKey.IsPayToCryptoCondition(p) &&
+                        if (tx.IsPayToCryptoCondition(i, p) &&
                             p.IsValid() &&
                             (p.evalCode == EVAL_ACCEPTEDNOTARIZATION || p.evalCode == EVAL_EARNEDNOTARIZATION) &&
                             p.vData.size() &&
@@ -890,7 +891,7 @@ void GetCurrencyDefinitions(const uint160 &systemIDQualifier,
                     COptCCParams p;
                     CPBaaSNotarization pbn;
 
-                    if (tx.vout[i].scriptPubKey.IsPayToCryptoCondition(p) &&
+                    if (tx.IsPayToCryptoCondition(i, p) &&
                         p.IsValid() &&
                         (p.evalCode == EVAL_ACCEPTEDNOTARIZATION || p.evalCode == EVAL_EARNEDNOTARIZATION) &&
                         p.vData.size() &&
@@ -927,7 +928,7 @@ std::pair<std::vector<CReserveTransfer>, std::vector<std::vector<int>>> GetReser
     for (int i = outNum; i >= 0; i--)
     {
         receivedP = COptCCParams();
-        if (tx.vout[i].scriptPubKey.IsPayToCryptoCondition(receivedP) &&
+        if (tx.IsPayToCryptoCondition(i, receivedP) &&
             receivedP.IsValid() &&
             receivedP.evalCode == EVAL_CROSSCHAIN_IMPORT &&
             receivedP.vData.size() &&
@@ -1800,6 +1801,9 @@ std::string ConvertAlternateRepresentations(const std::string &paramStr)
     return paramStr;
 }
 
+// offer transaction, its input transaction, and the block hash of the input, keyed by the transaction that posted the offer
+static LRUCache<uint256, std::tuple<CTransaction, CTransaction, uint256>> ChainOfferCache(10000, 0.1, true);
+
 bool GetOpRetChainOffer(const CTransaction &postedTx,
                         CTransaction &offerTx,
                         CTransaction &inputToOfferTx,
@@ -1808,6 +1812,24 @@ bool GetOpRetChainOffer(const CTransaction &postedTx,
                         bool getExpired,
                         uint256 &offerBlockHash)
 {
+    // once an offer is posted, the offer and its input transactions never change, so only whether the offered
+    // input is still unspent and whether the offer has expired are checked again for an offer decoded before
+    std::tuple<CTransaction, CTransaction, uint256> cachedOffer;
+    if (ChainOfferCache.Get(postedTx.GetHash(), cachedOffer))
+    {
+        const CTransaction &cachedOfferTx = std::get<0>(cachedOffer);
+        CSpentIndexKey cachedSpentKey(cachedOfferTx.vin[0].prevout.hash, cachedOfferTx.vin[0].prevout.n);
+        CSpentIndexValue cachedSpentValue;
+        if (!GetSpentIndex(cachedSpentKey, cachedSpentValue) &&
+            ((getExpired && cachedOfferTx.nExpiryHeight <= height) || (getUnexpired && cachedOfferTx.nExpiryHeight > height)))
+        {
+            offerTx = cachedOfferTx;
+            inputToOfferTx = std::get<1>(cachedOffer);
+            offerBlockHash = std::get<2>(cachedOffer);
+            return true;
+        }
+    }
+
     std::vector<CBaseChainObject *> opRetArray;
     CPartialTransactionProof offerTxProof;
     bool isPartial = false, incompleteTx = false;
@@ -1838,6 +1860,11 @@ bool GetOpRetChainOffer(const CTransaction &postedTx,
         ((getExpired && offerTx.nExpiryHeight <= height) || (getUnexpired && offerTx.nExpiryHeight > height)) &&
         myGetTransaction(offerTx.vin[0].prevout.hash, inputToOfferTx, offerBlockHash))
     {
+        // an input still in the mempool has no block hash yet, so it is only cached once mined
+        if (!offerBlockHash.IsNull())
+        {
+            ChainOfferCache.Put(postedTx.GetHash(), std::make_tuple(offerTx, inputToOfferTx, offerBlockHash));
+        }
         return true;
     }
     else if (getExpired &&
@@ -3066,58 +3093,26 @@ UniValue getpendingtransfers(const UniValue& params, bool fHelp)
     return NullUniValue;
 }
 
-UniValue getexports(const UniValue& params, bool fHelp)
+std::vector<CExportForRelay> GetExportsForRelay(const std::string &currencyName, int64_t heightStart, int64_t heightEnd)
 {
-    if (fHelp || params.size() < 1 || params.size() > 3)
-    {
-        throw runtime_error(
-            "getexports \"chainname\" (heightstart) (heightend)\n"
-            "\nReturns pending export transfers to the specified currency from start height to end height if specified\n"
-
-            "\nArguments\n"
-            "\"chainname\"                      (string, required)  name/ID of the currency to look for. no parameter returns current chain\n"
-            "\"heightstart\"                    (int, optional)     default=0 only return exports at or above this height\n"
-            "\"heightend\"                      (int, optional)     dedfault=maxheight only return exports below or at this height\n"
-
-            "\nResult:\n"
-            "  [{\n"
-            "     \"height\": n,"
-            "     \"txid\": \"hexid\","
-            "     \"txoutnum\": n,"
-            "     \"partialtransactionproof\": \"hexstr\","             // proof's are relative to the heightend, if specified. if not, they are invalid
-            "     \"transfers\": [{transfer1}, {transfer2},...]"
-            "  }, ...]\n"
-
-            "\nExamples:\n"
-            + HelpExampleCli("getexports", "\"chainname\" (heightstart) (heightend)")
-            + HelpExampleRpc("getexports", "\"chainname\" (heightstart) (heightend)")
-        );
-    }
-
-    CheckPBaaSAPIsValid();
-
     LOCK2(cs_main, mempool.cs);
 
     uint160 currencyID;
     CCurrencyDefinition curDef;
     std::vector<std::pair<std::pair<CInputDescriptor, CPartialTransactionProof>, std::vector<CReserveTransfer>>> exports;
 
-    if ((currencyID = ValidateCurrencyName(uni_get_str(params[0]), true, &curDef)).IsNull())
+    if ((currencyID = ValidateCurrencyName(currencyName, true, &curDef)).IsNull())
     {
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid chain name or chain ID");
     }
 
-    uint32_t fromHeight = 0, toHeight = INT32_MAX;
+    uint32_t fromHeight = heightStart, toHeight = INT32_MAX;
     uint32_t proofHeight = 0;
     uint32_t nHeight = chainActive.Height();
 
-    if (params.size() > 1)
-    {
-        fromHeight = uni_get_int64(params[1]);
-    }
-    if (params.size() > 2)
+    if (heightEnd >= 0)
     {
-        toHeight = uni_get_int64(params[2]);
+        toHeight = heightEnd;
         proofHeight = toHeight != 0 && (toHeight < nHeight) ? toHeight : nHeight;
         toHeight = proofHeight;
     }
@@ -3132,11 +3127,9 @@ UniValue getexports(const UniValue& params, bool fHelp)
         ConnectedChains.GetCurrencyExports(currencyID, exports, fromHeight, toHeight);
     }
 
-    UniValue retVal(UniValue::VARR);
-
+    std::vector<CExportForRelay> retVal;
     for (auto &oneExport : exports)
     {
-        UniValue oneObj(UniValue::VOBJ);
         CTransaction tx;
         uint256 blkHash;
         if (!myGetTransaction(oneExport.first.first.txIn.prevout.hash, tx, blkHash) || blkHash.IsNull())
@@ -3148,46 +3141,72 @@ UniValue getexports(const UniValue& params, bool fHelp)
         {
             throw JSONRPCError(RPC_INTERNAL_ERROR, "transaction for export not found in main block index");
         }
-        oneObj.push_back(Pair("height", indexIt->second->GetHeight()));
-        oneObj.push_back(Pair("txid", oneExport.first.first.txIn.prevout.hash.GetHex()));
-        oneObj.push_back(Pair("txoutnum", (int64_t)oneExport.first.first.txIn.prevout.n));
-        CCrossChainExport ccx(oneExport.first.first.scriptPubKey);
-        oneObj.push_back(Pair("exportinfo", ccx.ToUniValue()));
-        if (oneExport.first.second.IsValid())
-        {
-            oneObj.push_back(Pair("partialtransactionproof", oneExport.first.second.ToUniValue()));
-        }
+        retVal.push_back(CExportForRelay(indexIt->second->GetHeight(), oneExport));
+    }
+    return retVal;
+}
 
-        UniValue transferArr(UniValue::VARR);
-        for (auto &oneTransfer : oneExport.second)
-        {
-            /* // check serialization discrepancies
-            if (oneTransfer.IsCurrencyExport() && oneTransfer.destination.TypeNoFlags() == oneTransfer.destination.DEST_REGISTERCURRENCY)
-            {
-                CCurrencyDefinition exportDef = CCurrencyDefinition(oneTransfer.destination.destination);
-                CCurrencyDefinition curDef = ConnectedChains.GetCachedCurrency(exportDef.GetID());
-                auto exportDefVec = ::AsVector(exportDef);
-                auto onChainDefVec = ::AsVector(curDef);
-                auto translatedDefVec = ::AsVector(CCurrencyDefinition(exportDef.ToUniValue()));
-                if (exportDefVec != onChainDefVec || onChainDefVec != translatedDefVec)
-                {
-                    printf("Exported currency:\n%s\nOn-chain currency:\n%s\nSerialized export:\n%s\nSerialized on-chain:\n%s\nSerialized translated:\n%s\n",
-                        exportDef.ToUniValue().write(1,2).c_str(),
-                        curDef.ToUniValue().write(1,2).c_str(),
-                        HexBytes(&(exportDefVec[0]), exportDefVec.size()).c_str(),
-                        HexBytes(&(onChainDefVec[0]), onChainDefVec.size()).c_str(),
-                        HexBytes(&(translatedDefVec[0]), translatedDefVec.size()).c_str());
-                }
-                auto transferVec = ::AsVector(oneTransfer);
-                printf("ReserveTransfer:\n%s\nSerialized:\n%s\n", oneTransfer.ToUniValue().write(1,2).c_str(), HexBytes(&(transferVec[0]), transferVec.size()).c_str());
-            } //*/
-            transferArr.push_back(oneTransfer.ToUniValue());
-        }
-        oneObj.push_back(Pair("transfers", transferArr));
+UniValue ExportForRelayToUniValue(const CExportForRelay &oneExport)
+{
+    UniValue oneObj(UniValue::VOBJ);
+    oneObj.push_back(Pair("height", (int64_t)oneExport.first));
+    oneObj.push_back(Pair("txid", oneExport.second.first.first.txIn.prevout.hash.GetHex()));
+    oneObj.push_back(Pair("txoutnum", (int64_t)oneExport.second.first.first.txIn.prevout.n));
+    CCrossChainExport ccx(oneExport.second.first.first.scriptPubKey);
+    oneObj.push_back(Pair("exportinfo", ccx.ToUniValue()));
+    if (oneExport.second.first.second.IsValid())
+    {
+        oneObj.push_back(Pair("partialtransactionproof", oneExport.second.first.second.ToUniValue()));
+    }
+
+    UniValue transferArr(UniValue::VARR);
+    for (auto &oneTransfer : oneExport.second.second)
+    {
+        transferArr.push_back(oneTransfer.ToUniValue());
+    }
+    oneObj.push_back(Pair("transfers", transferArr));
+    return oneObj;
+}
+
+UniValue getexports(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() < 1 || params.size() > 3)
+    {
+        throw runtime_error(
+            "getexports \"chainname\" (heightstart) (heightend)\n"
+            "\nReturns pending export transfers to the specified currency from start height to end height if specified\n"
+
+            "\nArguments\n"
+            "\"chainname\"                      (string, required)  name/ID of the currency to look for. no parameter returns current chain\n"
+            "\"heightstart\"                    (int, optional)     default=0 only return exports at or above this height\n"
+            "\"heightend\"                      (int, optional)     dedfault=maxheight only return exports below or at this height\n"
+
+            "\nResult:\n"
+            "  [{\n"
+            "     \"height\": n,"
+            "     \"txid\": \"hexid\","
+            "     \"txoutnum\": n,"
+            "     \"partialtransactionproof\": \"hexstr\","             // proof's are relative to the heightend, if specified. if not, they are invalid
+            "     \"transfers\": [{transfer1}, {transfer2},...]"
+            "  }, ...]\n"
 
-        retVal.push_back(oneObj);
+            "\nExamples:\n"
+            + HelpExampleCli("getexports", "\"chainname\" (heightstart) (heightend)")
+            + HelpExampleRpc("getexports", "\"chainname\" (heightstart) (heightend)")
+        );
     }
 
+    CheckPBaaSAPIsValid();
+
+    std::vector<CExportForRelay> exports = GetExportsForRelay(uni_get_str(params[0]),
+                                                              params.size() > 1 ? uni_get_int64(params[1]) : 0,
+                                                              params.size() > 2 ? uni_get_int64(params[2]) : -1);
+
+    UniValue retVal(UniValue::VARR);
+    for (auto &oneExport : exports)
+    {
+        retVal.push_back(ExportForRelayToUniValue(oneExport));
+    }
     return retVal;
 }
 
@@ -3212,7 +3231,7 @@ UniValue submitimports(const UniValue& params, bool fHelp)
             "       \"txoutnum\": n,\n"                                 // export tx out num on the other system
             "       \"partialtransactionproof\": \"hexstr\",\n"         // transaction proof, relative to the specified notarization
             "       \"transfers\": [{transfer1}, {transfer2},...]\n"    // all reserve transfers for this export
-            "    }, ...]\n"
+            "    } | {\"hex\": \"hexstr\"}, ...]\n"                     // or one export, serialized as returned by /rest/exports/
             "  }\n"
 
             "\nResult:\n"
@@ -3283,40 +3302,107 @@ UniValue submitimports(const UniValue& params, bool fHelp)
         throw JSONRPCError(RPC_INVALID_PARAMETER, "parameters must include valid exports to import");
     }
 
+    auto proofRootIt = lastConfirmed.proofRoots.find(sourceSystemID);
+    if (proofRootIt == lastConfirmed.proofRoots.end())
+    {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid export 1 from " + uni_get_str(params[0]));
+    }
+
+    std::vector<uint256> exportTxIds(exportsUni.size());
+    std::vector<int32_t> exportTxOutNums(exportsUni.size());
+    std::vector<CPartialTransactionProof> txProofs(exportsUni.size());
+    std::vector<std::vector<CReserveTransfer>> serializedTransfers(exportsUni.size());
+    std::vector<unsigned char> isSerialized(exportsUni.size(), false);
     for (int i = 0; i < exportsUni.size(); i++)
     {
-        // create one import at a time
-        uint256 exportTxId = uint256S(uni_get_str(find_value(exportsUni[i], "txid")));
-        int32_t exportTxOutNum = uni_get_int(find_value(exportsUni[i], "txoutnum"));
-        CPartialTransactionProof txProof = CPartialTransactionProof(find_value(exportsUni[i], "partialtransactionproof"));
-        UniValue transferArrUni = find_value(exportsUni[i], "transfers");
-        if (exportTxId.IsNull() ||
-            exportTxOutNum == -1 ||
-            !transferArrUni.isArray())
+        // an export may be passed in the serialized form that the REST exports endpoint returns, without any JSON conversion
+        std::string exportHex = uni_get_str(find_value(exportsUni[i], "hex"));
+        if (!exportHex.empty())
+        {
+            CExportForRelay oneExport;
+            if (!IsHex(exportHex))
+            {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid export from " + uni_get_str(params[0]));
+            }
+            std::vector<unsigned char> exportBytes(ParseHex(exportHex));
+            CDataStream ss(exportBytes, SER_NETWORK, PROTOCOL_VERSION);
+            try
+            {
+                ss >> oneExport;
+            }
+            catch (const std::exception &e)
+            {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid serialized export from " + uni_get_str(params[0]));
+            }
+            exportTxIds[i] = oneExport.second.first.first.txIn.prevout.hash;
+            exportTxOutNums[i] = oneExport.second.first.first.txIn.prevout.n;
+            txProofs[i] = oneExport.second.first.second;
+            serializedTransfers[i] = oneExport.second.second;
+            isSerialized[i] = true;
+            if (exportTxIds[i].IsNull())
+            {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid export from " + uni_get_str(params[0]));
+            }
+            continue;
+        }
+
+        exportTxIds[i] = uint256S(uni_get_str(find_value(exportsUni[i], "txid")));
+        exportTxOutNums[i] = uni_get_int(find_value(exportsUni[i], "txoutnum"));
+        txProofs[i] = CPartialTransactionProof(find_value(exportsUni[i], "partialtransactionproof"));
+        if (exportTxIds[i].IsNull() ||
+            exportTxOutNums[i] == -1 ||
+            !find_value(exportsUni[i], "transfers").isArray())
         {
             throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid export from " + uni_get_str(params[0]));
         }
+    }
 
-        CTransaction exportTx;
-        uint256 blkHash;
-        auto proofRootIt = lastConfirmed.proofRoots.find(sourceSystemID);
-        if (!(txProof.IsValid() &&
-            !txProof.GetPartialTransaction(exportTx).IsNull() &&
-            exportTxId == txProof.TransactionHash() &&
-            proofRootIt != lastConfirmed.proofRoots.end() &&
-            proofRootIt->second.stateRoot == txProof.CheckPartialTransaction(exportTx) &&
-            exportTx.vout.size() > exportTxOutNum))
+    // proofs of a large backlog of exports are checked in parallel, since each only depends on its own proof
+    std::vector<CTransaction> exportTxes(exportsUni.size());
+    std::vector<unsigned char> proofsValid(exportsUni.size(), false);
+    {
+        uint256 stateRoot = proofRootIt->second.stateRoot;
+        RunInParallel(txProofs.size(), [&txProofs, &exportTxIds, &exportTxOutNums, &exportTxes, &proofsValid, stateRoot](size_t i)
+        {
+            proofsValid[i] = txProofs[i].IsValid() &&
+                             !txProofs[i].GetPartialTransaction(exportTxes[i]).IsNull() &&
+                             exportTxIds[i] == txProofs[i].TransactionHash() &&
+                             stateRoot == txProofs[i].CheckPartialTransaction(exportTxes[i]) &&
+                             exportTxes[i].vout.size() > exportTxOutNums[i];
+            return true;
+        });
+    }
+
+    for (int i = 0; i < exportsUni.size(); i++)
+    {
+        if (!proofsValid[i])
         {
             throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid export 1 from " + uni_get_str(params[0]));
         }
 
+        const CTransaction &exportTx = exportTxes[i];
+        uint256 exportTxId = exportTxIds[i];
+        int32_t exportTxOutNum = exportTxOutNums[i];
+        UniValue transferArrUni = find_value(exportsUni[i], "transfers");
+
         std::pair<std::pair<CInputDescriptor, CPartialTransactionProof>, std::vector<CReserveTransfer>> oneExport =
             std::make_pair(std::make_pair(CInputDescriptor(exportTx.vout[exportTxOutNum].scriptPubKey,
                                             exportTx.vout[exportTxOutNum].nValue,
                                             CTxIn(exportTxId, exportTxOutNum)),
-                                            txProof),
+                                            txProofs[i]),
                             std::vector<CReserveTransfer>());
 
+        if (isSerialized[i])
+        {
+            oneExport.second = serializedTransfers[i];
+            for (auto &oneTransfer : oneExport.second)
+            {
+                if (!oneTransfer.IsValid())
+                {
+                    throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid reserve transfers from export of " + uni_get_str(params[0]));
+                }
+            }
+        }
         for (int j = 0; j < transferArrUni.size(); j++)
         {
             oneExport.second.push_back(CReserveTransfer(transferArrUni[j]));
@@ -3813,16 +3899,32 @@ bool GetChainTransfers(multimap<uint160, std::pair<CInputDescriptor, CReserveTra
 
     LOCK2(cs_main, mempool.cs);
 
-    if (!GetAddressIndex(CReserveTransfer::ReserveTransferKey(),
-                         CScript::P2IDX,
-                         addressIndex,
-                         start,
-                         end))
+    // transfers to one currency are read with their decoded transfers from the reserve transfer index, when available
+    std::vector<CReserveTransferIndexEntry> indexedTransfers;
+    bool useIndex = fReserveTransferIndex && !nofilter;
+
+    if (useIndex && !pblocktree->ReadReserveTransferIndex(chainFilter, indexedTransfers, start, end))
+    {
+        return false;
+    }
+    else if (!useIndex && !GetAddressIndex(CReserveTransfer::ReserveTransferKey(),
+                                        CScript::P2IDX,
+                                        addressIndex,
+                                        start,
+                                        end))
     {
         return false;
     }
     else
     {
+        for (auto &oneTransfer : indexedTransfers)
+        {
+            if ((oneTransfer.second.second.flags & flags) == flags)
+            {
+                inputDescriptors.insert(make_pair(chainFilter, oneTransfer.second));
+            }
+        }
+
         for (auto it = addressIndex.begin(); it != addressIndex.end(); it++)
         {
             CTransaction ntx;
@@ -3932,11 +4034,19 @@ bool GetChainTransfersUnspentBy(std::multimap<std::pair<uint32_t, uint160>, std:
         }
     }
 
-    if (!GetAddressIndex(CReserveTransfer::ReserveTransferKey(),
-                         CScript::P2IDX,
-                         addressIndex,
-                         start,
-                         end))
+    // transfers to one currency are read with their decoded transfers from the reserve transfer index, when available
+    std::vector<CReserveTransferIndexEntry> indexedTransfers;
+    bool useIndex = fReserveTransferIndex && !nofilter;
+
+    if (useIndex && !pblocktree->ReadReserveTransferIndex(chainFilter, indexedTransfers, start, end))
+    {
+        return false;
+    }
+    else if (!useIndex && !GetAddressIndex(CReserveTransfer::ReserveTransferKey(),
+                                        CScript::P2IDX,
+                                        addressIndex,
+                                        start,
+                                        end))
     {
         return false;
     }
@@ -3944,6 +4054,20 @@ bool GetChainTransfersUnspentBy(std::multimap<std::pair<uint32_t, uint160>, std:
     {
         // This call does not include outputs that were mined in as spent at the
         // end height requested
+        for (auto &oneTransfer : indexedTransfers)
+        {
+            CSpentIndexValue spentInfo;
+            CSpentIndexKey spentKey(oneTransfer.first.txhash, oneTransfer.first.index);
+            if ((oneTransfer.second.second.flags & flags) != flags ||
+                (GetSpentIndex(spentKey, spentInfo) &&
+                 !spentInfo.IsNull() &&
+                 spentInfo.blockHeight < unspentBy))
+            {
+                continue;
+            }
+            inputDescriptors.insert(std::make_pair(std::make_pair(oneTransfer.first.height, chainFilter), oneTransfer.second));
+        }
+
         for (auto it = addressIndex.begin(); it != addressIndex.end(); it++)
         {
             CTransaction ntx;
@@ -4082,11 +4206,19 @@ bool GetChainTransfersBetween(std::multimap<std::pair<uint32_t, uint160>, std::p
         }
     }
 
-    if (!GetAddressIndex(CReserveTransfer::ReserveTransferKey(),
-                         CScript::P2IDX,
-                         addressIndex,
-                         start,
-                         end))
+    // transfers to one currency are read with their decoded transfers from the reserve transfer index, when available
+    std::vector<CReserveTransferIndexEntry> indexedTransfers;
+    bool useIndex = fReserveTransferIndex && !nofilter;
+
+    if (useIndex && !pblocktree->ReadReserveTransferIndex(chainFilter, indexedTransfers, start, end))
+    {
+        return false;
+    }
+    else if (!useIndex && !GetAddressIndex(CReserveTransfer::ReserveTransferKey(),
+                                        CScript::P2IDX,
+                                        addressIndex,
+                                        start,
+                                        end))
     {
         return false;
     }
@@ -4094,6 +4226,14 @@ bool GetChainTransfersBetween(std::multimap<std::pair<uint32_t, uint160>, std::p
     {
         // This call does not include outputs that were mined in as spent at the
         // end height requested
+        for (auto &oneTransfer : indexedTransfers)
+        {
+            if ((oneTransfer.second.second.flags & flags) == flags)
+            {
+                inputDescriptors.insert(std::make_pair(std::make_pair(oneTransfer.first.height, chainFilter), oneTransfer.second));
+            }
+        }
+
         for (auto it = addressIndex.begin(); it != addressIndex.end(); it++)
         {
             CTransaction ntx;
@@ -4152,22 +4292,29 @@ bool GetChainTransfersBetween(std::multimap<std::pair<uint32_t, uint160>, std::p
     }
 }
 
+// decoded unspent transfer outputs as of a tip, in index order. the confirmed set only changes with the tip, so
+// export aggregation, which calls this for every block template, only decodes the transfers of each new block once
+static LRUCache<uint256, std::vector<std::pair<uint160, ChainTransferData>>> unspentChainTransfersCache(2, 0.5, true);
+
 // returns all unspent chain transfer outputs with an optional chainFilter. if the chainFilter is not
 // NULL, only transfers to that chain are returned
 bool GetUnspentChainTransfers(std::multimap<uint160, ChainTransferData> &inputDescriptors, uint160 chainFilter)
 {
     bool nofilter = chainFilter.IsNull();
 
-    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
-
     LOCK(cs_main);
 
-    if (!GetAddressUnspent(CReserveTransfer::ReserveTransferKey(), CScript::P2IDX, unspentOutputs))
-    {
-        return false;
-    }
-    else
+    uint256 tipHash = chainActive.LastTip() ? chainActive.LastTip()->GetBlockHash() : uint256();
+    std::vector<std::pair<uint160, ChainTransferData>> allTransfers;
+
+    if (tipHash.IsNull() || !unspentChainTransfersCache.Get(tipHash, allTransfers))
     {
+        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
+        if (!GetAddressUnspent(CReserveTransfer::ReserveTransferKey(), CScript::P2IDX, unspentOutputs))
+        {
+            return false;
+        }
+
         CCoins coins;
         CCoinsView dummy;
         CCoinsViewCache view(&dummy);
@@ -4184,8 +4331,7 @@ bool GetUnspentChainTransfers(std::multimap<uint160, ChainTransferData> &inputDe
             {
                 if (coins.IsAvailable(it->first.index))
                 {
-                    // if this is a transfer output, optionally to this chain, add it to the input vector
-                    // chain filter was applied in index search
+                    // if this is a transfer output, add it to the input vector
                     COptCCParams p;
                     COptCCParams m;
                     CReserveTransfer rt;
@@ -4196,15 +4342,14 @@ bool GetUnspentChainTransfers(std::multimap<uint160, ChainTransferData> &inputDe
                         p.version >= p.VERSION_V3 &&
                         (m = COptCCParams(p.vData.back())).IsValid() &&
                         (rt = CReserveTransfer(p.vData[0])).IsValid() &&
-                        !(destCID = ((rt.flags & rt.IMPORT_TO_SOURCE) ? rt.FirstCurrency() : rt.destCurrencyID)).IsNull() &&
-                        (nofilter || destCID == chainFilter))
+                        !(destCID = ((rt.flags & rt.IMPORT_TO_SOURCE) ? rt.FirstCurrency() : rt.destCurrencyID)).IsNull())
                     {
-                        inputDescriptors.insert(make_pair(destCID,
-                                                          ChainTransferData(coins.nHeight,
-                                                                            CInputDescriptor(coins.vout[it->first.index].scriptPubKey,
+                        allTransfers.push_back(make_pair(destCID,
+                                                         ChainTransferData(coins.nHeight,
+                                                                           CInputDescriptor(coins.vout[it->first.index].scriptPubKey,
                                                                                             coins.vout[it->first.index].nValue,
                                                                                             CTxIn(COutPoint(it->first.txhash, it->first.index))),
-                                                                            rt)));
+                                                                           rt)));
                     }
                 }
             }
@@ -4213,8 +4358,20 @@ bool GetUnspentChainTransfers(std::multimap<uint160, ChainTransferData> &inputDe
                 LogPrint("crosschainexports", "%s: cannot retrieve transaction %s from height %u\n", __func__, it->first.txhash.GetHex().c_str(), it->second.blockHeight);
             }
         }
-        return true;
+        if (!tipHash.IsNull())
+        {
+            unspentChainTransfersCache.Put(tipHash, allTransfers);
+        }
     }
+
+    for (auto &oneTransfer : allTransfers)
+    {
+        if (nofilter || oneTransfer.first == chainFilter)
+        {
+            inputDescriptors.insert(oneTransfer);
+        }
+    }
+    return true;
 }
 
 // returns all unspent chain transfer outputs, * including from the mempool *
@@ -4225,6 +4382,38 @@ bool GetUnspentChainTransfers(std::vector<ChainTransferData> &inputDescriptors,
     LOCK(cs_main);
     LOCK2(smartTransactionCS, mempool.cs);
 
+    if (fReserveTransferIndex)
+    {
+        // the pending transfer index only holds unspent transfers to this currency, so no other transfers or
+        // transactions need to be loaded. they are returned in the same order as the address index would return them.
+        std::vector<CReserveTransferIndexEntry> pendingTransfers, mempoolTransfers;
+        if (!pblocktree->ReadReserveTransferIndex(chainID, pendingTransfers, 0, 0, true) ||
+            !mempool.getReserveTransferIndex(chainID, mempoolTransfers))
+        {
+            return false;
+        }
+        std::sort(pendingTransfers.begin(), pendingTransfers.end(),
+                  [](const CReserveTransferIndexEntry &a, const CReserveTransferIndexEntry &b)
+                  {
+                      return a.first.txhash < b.first.txhash || (a.first.txhash == b.first.txhash && a.first.index < b.first.index);
+                  });
+        pendingTransfers.insert(pendingTransfers.end(), mempoolTransfers.begin(), mempoolTransfers.end());
+
+        for (auto &oneTransfer : pendingTransfers)
+        {
+            COptCCParams p;
+            if (!mempool.mapNextTx.count(oneTransfer.second.first.txIn.prevout) &&
+                oneTransfer.second.first.scriptPubKey.IsPayToCryptoCondition(p) &&
+                p.IsValid() &&
+                p.version >= p.VERSION_V3 &&
+                COptCCParams(p.vData.back()).IsValid())
+            {
+                inputDescriptors.push_back(ChainTransferData(oneTransfer.first.height, oneTransfer.second.first, oneTransfer.second.second));
+            }
+        }
+        return true;
+    }
+
     if (!ConnectedChains.GetUnspentByIndex(CReserveTransfer::ReserveTransferKey(), unspentOutputs))
     {
         return false;
@@ -4907,6 +5096,8 @@ UniValue getlaunchinfo(const UniValue& params, bool fHelp)
     return retVal;
 }
 
+static LRUCache<std::tuple<uint256, unsigned int, uint256>, UniValue> BestProofRootCache(200, 0.1, true);
+
 UniValue getbestproofroot(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() != 1 || params[0].getKeys().size() < 2)
@@ -4983,7 +5174,16 @@ UniValue getbestproofroot(const UniValue& params, bool fHelp)
 
     LOCK(cs_main);
 
+    // notaries poll this repeatedly with the same roots, so the result is reused until the tip or mempool changes
+    std::string requestStr = params[0].write();
+    std::tuple<uint256, unsigned int, uint256> cacheKey(chainActive.LastTip() ? chainActive.LastTip()->GetBlockHash() : uint256(),
+                                                        mempool.GetTransactionsUpdated(),
+                                                        Hash(requestStr.begin(), requestStr.end()));
     UniValue retVal(UniValue::VOBJ);
+    if (BestProofRootCache.Get(cacheKey, retVal))
+    {
+        return retVal;
+    }
 
     // no notarization can be considered confirmed by another chain or system, if it has not already been first confirmed
     // by the first notary of this one. any confirmed proof root must map to a confirmed notarization on this chain that is
@@ -5123,6 +5323,7 @@ UniValue getbestproofroot(const UniValue& params, bool fHelp)
     retVal.pushKV("currencystates", lastConfirmedRoot.IsValid() ? confirmedCurrencyStatesUni : currencyStatesUni);
     retVal.pushKV("latestcurrencystates", currencyStatesUni);
 
+    BestProofRootCache.Put(cacheKey, retVal);
     return retVal;
 }
 
@@ -6143,30 +6344,26 @@ bool FundTransparentTransactionBuilder(CWallet *pwallet, TransactionBuilder &tb,
     return true;
 }
 
-UniValue submitacceptednotarization(const UniValue& params, bool fHelp)
+// an object parameter may also be passed as a hex string of the serialized object, which is decoded directly instead
+// of being converted from JSON, for notarizations with large evidence. returns an invalid object if it does not decode
+template <typename SERIALIZABLE>
+static SERIALIZABLE ObjectFromParam(const UniValue &param)
 {
-    if (fHelp || params.size() != 2)
+    if (!param.isStr())
     {
-        throw runtime_error(
-            "submitacceptednotarization \"{earnednotarization}\" \"{notaryevidence}\"\n"
-            "\nFinishes an almost complete notarization transaction based on the notary chain and the current wallet or pubkey.\n"
-            "If successful in submitting the transaction based on all rules, a transaction ID is returned, otherwise, NULL.\n"
-
-            "\nArguments\n"
-            "\"earnednotarization\"             (object, required) notarization earned on the other system, which is the basis for this\n"
-            "\"notaryevidence\"                 (object, required) evidence and notary signatures validating the notarization\n"
-
-            "\nResult:\n"
-            "txid                               (hexstring) transaction ID of submitted transaction\n"
-
-            "\nExamples:\n"
-            + HelpExampleCli("submitacceptednotarization", "\"{earnednotarization}\" \"{notaryevidence}\"")
-            + HelpExampleRpc("submitacceptednotarization", "\"{earnednotarization}\" \"{notaryevidence}\"")
-        );
+        return SERIALIZABLE(param);
     }
+    SERIALIZABLE obj;
+    bool success = false;
+    if (IsHex(param.get_str()))
+    {
+        ::FromVector(ParseHex(param.get_str()), obj, &success);
+    }
+    return success ? obj : SERIALIZABLE();
+}
 
-    CheckPBaaSAPIsValid();
-
+static UniValue SubmitAcceptedNotarization(const UniValue &earnedNotarizationUni, const UniValue &notaryEvidenceUni)
+{
     if (VERUS_NOTARYID.IsNull())
     {
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Set \"-notaryid=idname@\" on startup to submit and earn from notarization transactions");
@@ -6180,7 +6377,7 @@ UniValue submitacceptednotarization(const UniValue& params, bool fHelp)
     CCurrencyDefinition chainDef;
     int32_t chainDefHeight;
 
-    /* CPBaaSNotarization checkPbn(params[0]);
+    /* CPBaaSNotarization checkPbn(earnedNotarizationUni);
     printf("%s: checknotarization before:\n%s\n", __func__, checkPbn.ToUniValue().write(1,2).c_str());
     checkPbn.SetMirror();
     printf("%s: checknotarization mirrored:\n%s\n", __func__, checkPbn.ToUniValue().write(1,2).c_str());
@@ -6192,7 +6389,7 @@ UniValue submitacceptednotarization(const UniValue& params, bool fHelp)
     {
         LOCK2(cs_main, pwalletMain->cs_wallet);
         LOCK(mempool.cs);
-        if (!(pbn = CPBaaSNotarization(params[0])).IsValid() ||
+        if (!(pbn = ObjectFromParam<CPBaaSNotarization>(earnedNotarizationUni)).IsValid() ||
             !pbn.SetMirror() ||
             !GetCurrencyDefinition(pbn.currencyID, chainDef, &chainDefHeight) ||
             chainDef.systemID == ASSETCHAINS_CHAINID ||
@@ -6201,13 +6398,13 @@ UniValue submitacceptednotarization(const UniValue& params, bool fHelp)
             throw JSONRPCError(RPC_INVALID_PARAMETER, "invalid earned notarization");
         }
 
-        if (!(evidence = CNotaryEvidence(params[1])).IsValid() ||
+        if (!(evidence = ObjectFromParam<CNotaryEvidence>(notaryEvidenceUni)).IsValid() ||
             evidence.systemID != pbn.currencyID)
         {
             if (LogAcceptCategory("notarization"))
             {
-                printf("%s: invalid evidence %s\nfrom param: %s\n", __func__, evidence.ToUniValue().write(1,2).c_str(), params[1].write(1,2).c_str());
-                LogPrintf("%s: invalid evidence %s\nfrom param: %s\n", __func__, evidence.ToUniValue().write(1,2).c_str(), params[1].write(1,2).c_str());
+                printf("%s: invalid evidence %s\nfrom param: %s\n", __func__, evidence.ToUniValue().write(1,2).c_str(), notaryEvidenceUni.write(1,2).c_str());
+                LogPrintf("%s: invalid evidence %s\nfrom param: %s\n", __func__, evidence.ToUniValue().write(1,2).c_str(), notaryEvidenceUni.write(1,2).c_str());
             }
             throw JSONRPCError(RPC_INVALID_PARAMETER, "insufficient notarization evidence");
         }
@@ -6285,22 +6482,87 @@ UniValue submitacceptednotarization(const UniValue& params, bool fHelp)
     return NullUniValue;
 }
 
-// this must be called after all initial contributions are updated in the currency definition.
-CCoinbaseCurrencyState GetInitialCurrencyState(const CCurrencyDefinition &chainDef)
+UniValue submitacceptednotarization(const UniValue& params, bool fHelp)
 {
-    bool isFractional = chainDef.IsFractional();
-    CCurrencyState cState;
-    uint160 cID = chainDef.GetID();
+    if (fHelp || !(params.size() == 2 || (params.size() == 1 && params[0].isArray())))
+    {
+        throw runtime_error(
+            "submitacceptednotarization \"{earnednotarization}\" \"{notaryevidence}\"\n"
+            "submitacceptednotarization '[{\"earnednotarization\":{earnednotarization}, \"notaryevidence\":{notaryevidence}}, ...]'\n"
+            "\nFinishes an almost complete notarization transaction based on the notary chain and the current wallet or pubkey.\n"
+            "If successful in submitting the transaction based on all rules, a transaction ID is returned, otherwise, NULL.\n"
+            "If called with an array of notarizations, each is submitted in order, and the result of each is returned.\n"
 
-    // calculate contributions and conversions
-    const std::vector<CAmount> reserveFees(chainDef.currencies.size());
-    std::vector<int64_t> conversions = chainDef.conversions;
+            "\nArguments\n"
+            "\"earnednotarization\"             (object, required) notarization earned on the other system, which is the basis for this\n"
+            "\"notaryevidence\"                 (object, required) evidence and notary signatures validating the notarization\n"
+            "                                   either may instead be a hex string of the serialized object, which is not parsed as JSON\n"
 
-    CAmount nativeFees = 0;
-    if (isFractional)
+            "\nResult:\n"
+            "txid                               (hexstring) transaction ID of submitted transaction\n"
+            "or, for an array of notarizations:\n"
+            "[{\"txid\":\"hexstr\"} | {\"error\":\"message\"}, ...] (array) result of each notarization, in the order submitted\n"
+
+            "\nExamples:\n"
+            + HelpExampleCli("submitacceptednotarization", "\"{earnednotarization}\" \"{notaryevidence}\"")
+            + HelpExampleRpc("submitacceptednotarization", "\"{earnednotarization}\" \"{notaryevidence}\"")
+        );
+    }
+
+    CheckPBaaSAPIsValid();
+
+    if (params.size() == 2)
     {
-        cState = CCurrencyState(cID,
-                                chainDef.currencies,
+        return SubmitAcceptedNotarization(params[0], params[1]);
+    }
+
+    // each notarization may build on the one before it, so they are added to the mempool in order
+    UniValue retVal(UniValue::VARR);
+    for (int i = 0; i < params[0].size(); i++)
+    {
+        UniValue oneResult(UniValue::VOBJ);
+        try
+        {
+            UniValue txid = SubmitAcceptedNotarization(find_value(params[0][i], "earnednotarization"),
+                                                       find_value(params[0][i], "notaryevidence"));
+            if (txid.isNull())
+            {
+                oneResult.pushKV("error", "failed to add notarization transaction to mempool");
+            }
+            else
+            {
+                oneResult.pushKV("txid", txid);
+            }
+        }
+        catch (const UniValue &objError)
+        {
+            oneResult.pushKV("error", find_value(objError, "message"));
+        }
+        catch (const std::exception &e)
+        {
+            oneResult.pushKV("error", e.what());
+        }
+        retVal.push_back(oneResult);
+    }
+    return retVal;
+}
+
+// this must be called after all initial contributions are updated in the currency definition.
+CCoinbaseCurrencyState GetInitialCurrencyState(const CCurrencyDefinition &chainDef)
+{
+    bool isFractional = chainDef.IsFractional();
+    CCurrencyState cState;
+    uint160 cID = chainDef.GetID();
+
+    // calculate contributions and conversions
+    const std::vector<CAmount> reserveFees(chainDef.currencies.size());
+    std::vector<int64_t> conversions = chainDef.conversions;
+
+    CAmount nativeFees = 0;
+    if (isFractional)
+    {
+        cState = CCurrencyState(cID,
+                                chainDef.currencies,
                                 chainDef.weights,
                                 std::vector<int64_t>(chainDef.currencies.size(), 0),
                                 chainDef.initialFractionalSupply,
@@ -6340,17 +6602,6 @@ CCoinbaseCurrencyState GetInitialCurrencyState(const CCurrencyDefinition &chainD
     return retVal;
 }
 
-std::vector<CAddressUnspentDbEntry> GetFractionalNotarizationsForReserve(const uint160 &currencyID)
-{
-    std::vector<CAddressUnspentDbEntry> fractionalNotarizations;
-    CIndexID indexKey = CCoinbaseCurrencyState::IndexConverterKey(currencyID);
-    if (!GetAddressUnspent(indexKey, CScript::P2IDX, fractionalNotarizations))
-    {
-        LogPrintf("%s: Error reading unspent index\n", __func__);
-    }
-    return fractionalNotarizations;
-}
-
 // calculate the amount necessary for conversion, starting from the currency state & given a max slippage and price target to be less than or equal to
 // if we can't meet slippage or target price, we return 0
 CAmount GetNecessaryAmountForConversion(const CCurrencyDefinition &destSystem,
@@ -6667,60 +6918,50 @@ UniValue getcurrencyconverters(const UniValue& params, bool fHelp)
         }
     }
 
-    // get all currencies that contain all specified reserves in our fractionalsFound set
-    // use latest notarizations of the currencies to do so
-    std::vector<CAddressUnspentDbEntry> activeFractionals;
-    std::set<int32_t> toRemove;
-    if ((activeFractionals = GetFractionalNotarizationsForReserve(toCurID)).size() &&
-        reserves.size())
+    // get all launched currencies that contain all specified reserves from the converter index
+    // of the target currency, with their currency states at the tip
+    std::map<uint160, std::pair<CCurrencyDefinition, CCoinbaseCurrencyState>> activeFractionals;
+    if (!ConnectedChains.GetCurrencyConverters(toCurID, activeFractionals))
+    {
+        throw JSONRPCError(RPC_DESERIALIZATION_ERROR, "Cannot read currency converters for " + EncodeDestination(CIdentityID(toCurID)));
+    }
+    if (activeFractionals.size() && reserves.size())
     {
-        auto resIt = reserves.begin();
-        for (int i = 0; i < activeFractionals.size(); i++)
+        std::set<uint160> toRemove;
+        for (auto &oneFractional : activeFractionals)
         {
-            CPBaaSNotarization pbn(activeFractionals[i].second.script);
-            if (!pbn.IsValid())
+            auto curMap = oneFractional.second.second.GetReserveMap();
+            if (checkIntersect)
             {
-                throw JSONRPCError(RPC_DESERIALIZATION_ERROR, "Cannot read currency notarization in transaction " + activeFractionals[i].first.txhash.GetHex());
-            }
-            if (!(pbn.currencyState.IsLaunchConfirmed() && pbn.currencyState.IsLaunchCompleteMarker()))
-            {
-                toRemove.insert(i);
+                for (auto it = reserves.begin(); it != reserves.end(); it++)
+                {
+                    if (it->first != oneFractional.first && !curMap.count(it->first))
+                    {
+                        toRemove.insert(oneFractional.first);
+                        break;
+                    }
+                }
             }
             else
             {
-                auto curMap = pbn.currencyState.GetReserveMap();
-                if (checkIntersect)
+                bool foundReserve = false;
+                for (auto it = reserves.begin(); it != reserves.end(); it++)
                 {
-                    for (auto it = resIt; it != reserves.end(); it++)
+                    if (it->first == oneFractional.first || curMap.count(it->first))
                     {
-                        if (it->first != pbn.currencyState.GetID() && !curMap.count(it->first))
-                        {
-                            toRemove.insert(i);
-                            break;
-                        }
+                        foundReserve = true;
+                        break;
                     }
                 }
-                else
+                if (!foundReserve)
                 {
-                    bool foundReserve = false;
-                    for (auto it = resIt; it != reserves.end(); it++)
-                    {
-                        if (it->first == pbn.currencyState.GetID() || curMap.count(it->first))
-                        {
-                            foundReserve = true;
-                            break;
-                        }
-                    }
-                    if (!foundReserve)
-                    {
-                        toRemove.insert(i);
-                    }
+                    toRemove.insert(oneFractional.first);
                 }
             }
         }
-        for (auto oneIdx = toRemove.rbegin(); oneIdx != toRemove.rend(); oneIdx++)
+        for (auto &oneID : toRemove)
         {
-            activeFractionals.erase(activeFractionals.begin() + *oneIdx);
+            activeFractionals.erase(oneID);
         }
     }
 
@@ -6802,30 +7043,14 @@ UniValue getcurrencyconverters(const UniValue& params, bool fHelp)
         }
     }
 
-    for (int i = 0; i < activeFractionals.size(); i++)
+    for (auto &oneFractional : activeFractionals)
     {
-        CPBaaSNotarization pbn(activeFractionals[i].second.script);
-        CCurrencyDefinition oneCur;
         // if we already have it, move on
-        if (converterCurrencyOptions.count(pbn.currencyID))
-        {
-            continue;
-        }
-        if (reserves.count(pbn.currencyID))
-        {
-            oneCur = reserves[pbn.currencyID].first;
-        }
-        else if (!GetCurrencyDefinition(pbn.currencyID, oneCur))
-        {
-            throw JSONRPCError(RPC_INVALID_PARAMETER, "Cannot get currency definition for currency " + EncodeDestination(CIdentityID(pbn.currencyID)));
-        }
-
-        CCoinbaseCurrencyState oneState = ConnectedChains.GetCurrencyState(pbn.currencyID, chainActive.Height(), true);
-        if (!(oneState.IsValid() && oneState.IsLaunchConfirmed() && oneState.IsLaunchCompleteMarker()))
+        if (converterCurrencyOptions.count(oneFractional.first))
         {
             continue;
         }
-        converterCurrencyOptions[pbn.currencyID] = {oneCur, oneState, std::map<uint160, CAmount>()};
+        converterCurrencyOptions[oneFractional.first] = {oneFractional.second.first, oneFractional.second.second, std::map<uint160, CAmount>()};
     }
 
     // now, if we don't have any narrowing, return the converters we have with > 1000 native currency,
@@ -6931,228 +7156,412 @@ UniValue getcurrencyconverters(const UniValue& params, bool fHelp)
     return ret;
 }
 
-UniValue estimateconversion(const UniValue& params, bool fHelp)
+// parses one conversion to estimate into the reserve transfer that would make it, and returns the fractional currency
+// that converts it in fractionalCurrency. must be called with cs_main held
+static CReserveTransfer GetConversionToEstimate(const UniValue &uniTransfer, uint32_t nHeight, bool preConvert, CCurrencyDefinition &fractionalCurrency)
 {
-    if (fHelp || params.size() != 1)
+    CCurrencyDefinition &thisChain = ConnectedChains.ThisChain();
+    bool toFractional = false;
+    bool reserveToReserve = false;
+
+    auto rawCurrencyStr = uni_get_str(find_value(uniTransfer, "currency"));
+    auto currencyStr = TrimSpaces(rawCurrencyStr, true);
+    CAmount sourceAmount = AmountFromValue(find_value(uniTransfer, "amount"));
+    auto rawConvertToStr = uni_get_str(find_value(uniTransfer, "convertto"));
+    auto convertToStr = TrimSpaces(rawConvertToStr, true);
+    auto rawViaStr = uni_get_str(find_value(uniTransfer, "via"));
+    auto viaStr = TrimSpaces(rawViaStr, true);
+
+    if (rawCurrencyStr != currencyStr ||
+        rawConvertToStr != convertToStr ||
+        rawViaStr != viaStr)
     {
-        throw runtime_error(
-            "estimateconversion '{\"currency\":\"name\",\"convertto\":\"name\",\"amount\":n} | [array of conversions using one basket]'\n"
-            "\nThis estimates conversion from one currency to another, taking into account pending conversions, fees and slippage.\n"
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "all currency names used must be valid with no leading or trailing spaces");
+    }
 
-            "\nArguments (may be one object or an array of such objects):\n"
-            "1. {\n"
-            "      \"currency\": \"name\"       (string, required)  Name of the source currency to send in this output, defaults to\n"
-            "                                                       native of chain\n"
-            "      \"amount\":amount            (numeric, required) The numeric amount of currency, denominated in source currency\n"
-            "      \"convertto\":\"name\",      (string, optional)  Valid currency to convert to, either a reserve of a fractional, or fractional\n"
-            "      \"preconvert\":\"false\",    (bool,  optional)   Convert to currency at market price (default=false), only works if\n"
-            "                                                       transaction is mined before start of currency\n"
-            "      \"via\":\"name\",            (string, optional)  If source and destination currency are reserves, via is a common fractional\n"
-            "                                                       to convert through\n"
-            "   }\n"
 
-            "\nResult (if parameters were an array, the first four return values are returned 1:1 for objects passed in an array named \"conversions\"):\n"
-            "   {\n"
-            "      \"inputcurrencyid\": iaddress                    i-address of source currency\n"
-            "      \"netinputamount\": value                        net amount in, after conversion fees in source currency\n"
-            "      \"outputcurrencyid\": iaddress                   i-address of destination currency\n"
-            "      \"estimatedcurrencyout\": value                  estimated amount out in destination currency\n"
-            "      \"estimatedcurrencystate\": object               Estimation of all currency values, including prices and changes\n"
-            "   }\n"
+    CCurrencyDefinition sourceCurrencyDef;
+    uint160 sourceCurrencyID;
+    if (currencyStr != "")
+    {
+        sourceCurrencyID = ValidateCurrencyName(currencyStr, true, &sourceCurrencyDef);
+        if (sourceCurrencyID.IsNull())
+        {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "If source currency is specified, it must be valid.");
+        }
+    }
+    else
+    {
+        sourceCurrencyDef = thisChain;
+        sourceCurrencyID = sourceCurrencyDef.GetID();
+        currencyStr = thisChain.name;
+    }
 
-            "\nExamples:\n"
-            + HelpExampleCli("estimateconversion", "'{\"currency\":\"name\",\"convertto\":\"name\",\"amount\":n}'")
-            + HelpExampleRpc("estimateconversion", "'{\"currency\":\"name\",\"convertto\":\"name\",\"amount\":n}'")
-        );
+    CCurrencyDefinition convertToCurrencyDef;
+    uint160 convertToCurrencyID;
+
+    if (convertToStr == "")
+    {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Must specify a \"convertto\" currency for conversion estimation");
+    }
+    else
+    {
+        convertToCurrencyID = ValidateCurrencyName(convertToStr, true, &convertToCurrencyDef);
+        if (convertToCurrencyID == sourceCurrencyID)
+        {
+            convertToCurrencyID.SetNull();
+            convertToCurrencyDef = CCurrencyDefinition();
+        }
+        else if (convertToCurrencyID.IsNull())
+        {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid \"convertto\" currency " + convertToStr + " specified");
+        }
     }
 
-    CheckPBaaSAPIsValid();
+    CCurrencyDefinition secondCurrencyDef;
+    uint160 secondCurrencyID;
+    if (viaStr != "")
+    {
+        secondCurrencyID = ValidateCurrencyName(viaStr, true, &secondCurrencyDef);
+        std::map<uint160, int32_t> viaIdxMap = secondCurrencyDef.GetCurrenciesMap();
+        if (secondCurrencyID.IsNull() ||
+            sourceCurrencyID.IsNull() ||
+            convertToCurrencyID.IsNull() ||
+            secondCurrencyID == sourceCurrencyID ||
+            secondCurrencyID == convertToCurrencyID ||
+            sourceCurrencyID == convertToCurrencyID ||
+            !viaIdxMap.count(sourceCurrencyID) ||
+            !viaIdxMap.count(convertToCurrencyID))
+        {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "To specify a fractional currency converter, \"currency\" and \"convertto\" must both be reserves of \"via\"");
+        }
+        if (preConvert)
+        {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Cannot combine reserve to reserve conversion with preconversion");
+        }
+        CCurrencyDefinition tempDef = convertToCurrencyDef;
+        convertToCurrencyDef = secondCurrencyDef;
+        secondCurrencyDef = tempDef;
+        convertToCurrencyID = convertToCurrencyDef.GetID();
+        secondCurrencyID = secondCurrencyDef.GetID();
+    }
 
-    if (!params[0].isArray() && !params[0].isObject())
+    // if this is reserve to reserve "via" another currency, ensure that both "from" and "to" are reserves of the "via" currency
+    if (secondCurrencyDef.IsValid())
     {
-        throw JSONRPCError(RPC_INVALID_PARAMETER, "First parameter must be either a JSON object or array of objects.");
+        std::map<uint160, int32_t> checkMap = convertToCurrencyDef.GetCurrenciesMap();
+        if (!checkMap.count(sourceCurrencyID) || !checkMap.count(secondCurrencyID))
+        {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "If \"via\" is specified, it must be a fractional currency with reserves of both source and \"convertto\" currency");
+        }
+        reserveToReserve = true;
+        fractionalCurrency = convertToCurrencyDef;
     }
+    else
+    {
+        // figure out if fractional to reserve, reserve to fractional, or error
+        toFractional = convertToCurrencyDef.GetCurrenciesMap().count(sourceCurrencyID);
 
-    std::map<uint160, std::vector<CReserveTransfer>> currencyConversions;
+        if (toFractional)
+        {
+            fractionalCurrency = convertToCurrencyDef;
+        }
+        else if (!sourceCurrencyDef.GetCurrenciesMap().count(convertToCurrencyID))
+        {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Source currency cannot be converted to destination");
+        }
+        else
+        {
+            fractionalCurrency = sourceCurrencyDef;
+        }
+    }
 
-    UniValue uniTransfers = params[0];
-    if (uniTransfers.isObject())
+    if (!fractionalCurrency.IsFractional() && (!preConvert || fractionalCurrency.startBlock <= nHeight))
     {
-        uniTransfers = UniValue(UniValue::VARR);
-        uniTransfers.push_back(params[0]);
+        throw JSONRPCError(RPC_INVALID_PARAMETER, fractionalCurrency.name + " must be a fractional currency or prior to start block to estimate a conversion price");
     }
 
-    CCurrencyDefinition fractionalCurrency;
-    bool preConvert = false;
+    uint32_t flags = CReserveTransfer::VALID;
+    if (!convertToStr.empty())
+    {
+        flags += CReserveTransfer::CONVERT;
+        if (preConvert)
+        {
+            if (!secondCurrencyID.IsNull())
+            {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "cannot preconvert and also convert reserve to reserve");
+            }
+            flags += CReserveTransfer::PRECONVERT;
+        }
+        if (reserveToReserve)
+        {
+            flags += CReserveTransfer::RESERVE_TO_RESERVE;
+        }
+        else if (!toFractional)
+        {
+            flags += CReserveTransfer::IMPORT_TO_SOURCE;
+        }
+    }
 
-    UniValue retVal(UniValue::VOBJ);
-    CCoinbaseCurrencyState currencyState;
+    CReserveTransfer checkTransfer(flags,
+                                sourceCurrencyID,
+                                sourceAmount,
+                                ASSETCHAINS_CHAINID,
+                                ConnectedChains.ThisChain().GetTransactionTransferFee(),
+                                convertToCurrencyID,
+                                DestinationToTransferDestination(CKeyID(convertToCurrencyID)),
+                                secondCurrencyID);
+
+    return checkTransfer;
+}
+
+// gets the last notarization of a fractional currency and all pending conversion transactions, and returns the currency state
+// after the pending conversions and any extra conversions are processed. must be called with cs_main held
+static CCoinbaseCurrencyState GetEstimatedCurrencyState(CCurrencyDefinition &fractionalCurrency,
+                                                        uint32_t nHeight,
+                                                        bool preConvert,
+                                                        const std::vector<CReserveTransfer> &extraConversions)
+{
+    CPBaaSNotarization notarization;
+    uint160 fractionalCurrencyID = fractionalCurrency.GetID();
+
+    CUTXORef lastUnspentUTXO;
+    CTransaction lastUnspentTx;
+
+    if (fractionalCurrency.systemID == ASSETCHAINS_CHAINID)
+    {
+        notarization.GetLastUnspentNotarization(fractionalCurrencyID,
+                                                lastUnspentUTXO.hash,
+                                                *((int32_t *)&lastUnspentUTXO.n),
+                                                &lastUnspentTx);
+    }
+    else
+    {
+        if (preConvert && fractionalCurrency.launchSystemID != ASSETCHAINS_CHAINID)
+        {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Can only preconvert to currencies launching on the current chain");
+        }
+        CChainNotarizationData cnd;
+        if (GetNotarizationData(fractionalCurrencyID, cnd))
+        {
+            notarization = cnd.vtx[cnd.forks[cnd.bestChain].back()].second;
+        }
+    }
+
+    if (!notarization.IsValid())
+    {
+        throw JSONRPCError(RPC_TRANSACTION_ERROR, "Cannot find valid notarization for " + fractionalCurrency.name);
+    }
+
+    return ConnectedChains.AddPendingConversions(fractionalCurrency,
+                                                 notarization,
+                                                 notarization.notarizationHeight,
+                                                 nHeight,
+                                                 0,
+                                                 extraConversions);
+}
+
+// estimates many independent conversions, which may each use a different fractional currency. the state of each
+// fractional currency is loaded once with cs_main held, and all conversions are calculated after it is released
+static UniValue EstimateConversionBatch(const UniValue &uniTransfers)
+{
+    std::vector<std::pair<uint160, CReserveTransfer>> conversions;
+    std::map<uint160, CCoinbaseCurrencyState> currencyStates;
+    bool promoteExchangeRate;
 
     {
         LOCK(cs_main);
         uint32_t nHeight = chainActive.Height();
+        promoteExchangeRate = ConnectedChains.IsPromoteExchangeRate(nHeight + 1);
 
+        conversions.reserve(uniTransfers.size());
         for (int i = 0; i < uniTransfers.size(); i++)
         {
-            bool isVerusActive = IsVerusActive();
-            CCurrencyDefinition &thisChain = ConnectedChains.ThisChain();
-            uint160 thisChainID = thisChain.GetID();
-            bool toFractional = false;
-            bool reserveToReserve = false;
-
-            auto rawCurrencyStr = uni_get_str(find_value(uniTransfers[i], "currency"));
-            auto currencyStr = TrimSpaces(rawCurrencyStr, true);
-            CAmount sourceAmount = AmountFromValue(find_value(uniTransfers[i], "amount"));
-            auto rawConvertToStr = uni_get_str(find_value(uniTransfers[i], "convertto"));
-            auto convertToStr = TrimSpaces(rawConvertToStr, true);
-            auto rawViaStr = uni_get_str(find_value(uniTransfers[i], "via"));
-            auto viaStr = TrimSpaces(rawViaStr, true);
-
-            bool tmpPreConvert = uni_get_bool(find_value(uniTransfers[i], "preconvert"));
-            if (currencyConversions.size() && tmpPreConvert != preConvert)
+            if (uni_get_bool(find_value(uniTransfers[i], "preconvert")))
             {
-                throw JSONRPCError(RPC_INVALID_PARAMETER, "Estimated conversions cannot be a mixture of pre and normal conversions");
-            }
-
-            if (rawCurrencyStr != currencyStr ||
-                rawConvertToStr != convertToStr ||
-                rawViaStr != viaStr)
-            {
-                throw JSONRPCError(RPC_INVALID_PARAMETER, "all currency names used must be valid with no leading or trailing spaces");
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Preconversions cannot be estimated in batch mode");
             }
 
+            CCurrencyDefinition fractionalCurrency;
+            CReserveTransfer oneTransfer = GetConversionToEstimate(uniTransfers[i], nHeight, false, fractionalCurrency);
 
-            CCurrencyDefinition sourceCurrencyDef;
-            uint160 sourceCurrencyID;
-            if (currencyStr != "")
+            uint160 importCurrencyID = oneTransfer.GetImportCurrency();
+            if (!currencyStates.count(importCurrencyID))
             {
-                sourceCurrencyID = ValidateCurrencyName(currencyStr, true, &sourceCurrencyDef);
-                if (sourceCurrencyID.IsNull())
+                CCoinbaseCurrencyState oneState = GetEstimatedCurrencyState(fractionalCurrency, nHeight, false, std::vector<CReserveTransfer>());
+                if (!oneState.IsValid())
                 {
-                    throw JSONRPCError(RPC_INVALID_PARAMETER, "If source currency is specified, it must be valid.");
+                    throw JSONRPCError(RPC_TRANSACTION_ERROR, "Cannot process conversion parameters for " + fractionalCurrency.name);
                 }
+                currencyStates.insert(std::make_pair(importCurrencyID, oneState));
             }
-            else
-            {
-                sourceCurrencyDef = thisChain;
-                sourceCurrencyID = sourceCurrencyDef.GetID();
-                currencyStr = thisChain.name;
-            }
+            conversions.push_back(std::make_pair(importCurrencyID, oneTransfer));
+        }
+    }
 
-            CCurrencyDefinition convertToCurrencyDef;
-            uint160 convertToCurrencyID;
+    UniValue retVal(UniValue::VOBJ);
+    UniValue retArr(UniValue::VARR);
+    for (auto &oneConversion : conversions)
+    {
+        const CCoinbaseCurrencyState &currencyState = currencyStates[oneConversion.first];
+        const CReserveTransfer &oneTransfer = oneConversion.second;
+        std::map<uint160, int32_t> reserveMap = currencyState.GetReserveMap();
+        int32_t numCurrencies = currencyState.currencies.size();
+
+        CAmount conversionFee = CReserveTransactionDescriptor::CalculateConversionFeeNoMin(oneTransfer.FirstValue());
+        if (oneTransfer.IsReserveToReserve())
+        {
+            conversionFee = conversionFee << 1;
+        }
+        CAmount startingAmount = oneTransfer.FirstValue() - conversionFee;
 
-            if (convertToStr == "")
+        // each conversion is priced as if it were the only one added to its currency's pending conversions
+        std::vector<CAmount> reservesIn(numCurrencies), fractionalIn(numCurrencies);
+        std::vector<std::vector<CAmount>> crossConversions(numCurrencies, std::vector<CAmount>(numCurrencies));
+        if (oneTransfer.IsImportToSource())
+        {
+            fractionalIn[reserveMap[oneTransfer.destCurrencyID]] = startingAmount;
+        }
+        else
+        {
+            reservesIn[reserveMap[oneTransfer.FirstCurrency()]] = startingAmount;
+            if (oneTransfer.IsReserveToReserve())
             {
-                throw JSONRPCError(RPC_INVALID_PARAMETER, "Must specify a \"convertto\" currency for conversion estimation");
+                crossConversions[reserveMap[oneTransfer.FirstCurrency()]][reserveMap[oneTransfer.secondReserveID]] = startingAmount;
             }
-            else
+        }
+
+        CCurrencyState newState;
+        CValidationState state;
+        std::vector<CAmount> viaPrices;
+        std::vector<CAmount> prices = currencyState.ConvertAmounts(reservesIn,
+                                                                   fractionalIn,
+                                                                   newState,
+                                                                   promoteExchangeRate,
+                                                                   state,
+                                                                   &crossConversions,
+                                                                   &viaPrices);
+
+        UniValue retObj(UniValue::VOBJ);
+        retObj.pushKV("currencyid", EncodeDestination(CIdentityID(oneConversion.first)));
+        retObj.pushKV("inputcurrencyid", EncodeDestination(CIdentityID(oneTransfer.FirstCurrency())));
+        retObj.pushKV("netinputamount", ValueFromAmount(startingAmount));
+        retObj.pushKV("outputcurrencyid", EncodeDestination(CIdentityID(oneTransfer.IsReserveToReserve() ? oneTransfer.secondReserveID : oneTransfer.destCurrencyID)));
+
+        if (state.IsError() || !newState.IsValid() || prices.size() != numCurrencies)
+        {
+            retObj.pushKV("error", "Cannot convert with the latest currency state");
+            retArr.push_back(retObj);
+            continue;
+        }
+
+        CAmount amountOut = 0;
+        if (oneTransfer.IsImportToSource())
+        {
+            amountOut = currencyState.NativeToReserveRaw(startingAmount, prices[reserveMap[oneTransfer.destCurrencyID]]);
+        }
+        else
+        {
+            amountOut = currencyState.ReserveToNativeRaw(startingAmount, prices[reserveMap[oneTransfer.FirstCurrency()]]);
+            if (oneTransfer.IsReserveToReserve())
             {
-                convertToCurrencyID = ValidateCurrencyName(convertToStr, true, &convertToCurrencyDef);
-                if (convertToCurrencyID == sourceCurrencyID)
-                {
-                    convertToCurrencyID.SetNull();
-                    convertToCurrencyDef = CCurrencyDefinition();
-                }
-                else if (convertToCurrencyID.IsNull())
-                {
-                    throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid \"convertto\" currency " + convertToStr + " specified");
-                }
+                amountOut = viaPrices.size() == numCurrencies ?
+                    currencyState.NativeToReserveRaw(amountOut, viaPrices[reserveMap[oneTransfer.secondReserveID]]) : 0;
             }
+        }
+        retObj.pushKV("estimatedcurrencyout", ValueFromAmount(amountOut));
+        retArr.push_back(retObj);
+    }
+    retVal.pushKV("conversions", retArr);
+
+    UniValue stateObj(UniValue::VOBJ);
+    for (auto &oneState : currencyStates)
+    {
+        stateObj.pushKV(EncodeDestination(CIdentityID(oneState.first)), oneState.second.ToUniValue());
+    }
+    retVal.pushKV("currencystates", stateObj);
+    return retVal;
+}
+
+UniValue estimateconversion(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() < 1 || params.size() > 2)
+    {
+        throw runtime_error(
+            "estimateconversion '{\"currency\":\"name\",\"convertto\":\"name\",\"amount\":n} | [array of conversions using one basket]' (batch)\n"
+            "\nThis estimates conversion from one currency to another, taking into account pending conversions, fees and slippage.\n"
+
+            "\nArguments (may be one object or an array of such objects):\n"
+            "1. {\n"
+            "      \"currency\": \"name\"       (string, required)  Name of the source currency to send in this output, defaults to\n"
+            "                                                       native of chain\n"
+            "      \"amount\":amount            (numeric, required) The numeric amount of currency, denominated in source currency\n"
+            "      \"convertto\":\"name\",      (string, optional)  Valid currency to convert to, either a reserve of a fractional, or fractional\n"
+            "      \"preconvert\":\"false\",    (bool,  optional)   Convert to currency at market price (default=false), only works if\n"
+            "                                                       transaction is mined before start of currency\n"
+            "      \"via\":\"name\",            (string, optional)  If source and destination currency are reserves, via is a common fractional\n"
+            "                                                       to convert through\n"
+            "   }\n"
+            "2. \"batch\"                     (bool, optional)    If true, the first parameter is an array of independent conversions, which may\n"
+            "                                                       use different baskets. each is estimated against its basket's state after\n"
+            "                                                       pending conversions as the only new conversion, and results are returned in\n"
+            "                                                       \"conversions\", with each basket's state in \"currencystates\"\n"
+
+            "\nResult (if parameters were an array, the first four return values are returned 1:1 for objects passed in an array named \"conversions\"):\n"
+            "   {\n"
+            "      \"inputcurrencyid\": iaddress                    i-address of source currency\n"
+            "      \"netinputamount\": value                        net amount in, after conversion fees in source currency\n"
+            "      \"outputcurrencyid\": iaddress                   i-address of destination currency\n"
+            "      \"estimatedcurrencyout\": value                  estimated amount out in destination currency\n"
+            "      \"estimatedcurrencystate\": object               Estimation of all currency values, including prices and changes\n"
+            "   }\n"
+
+            "\nExamples:\n"
+            + HelpExampleCli("estimateconversion", "'{\"currency\":\"name\",\"convertto\":\"name\",\"amount\":n}'")
+            + HelpExampleRpc("estimateconversion", "'{\"currency\":\"name\",\"convertto\":\"name\",\"amount\":n}'")
+        );
+    }
+
+    CheckPBaaSAPIsValid();
 
-            CCurrencyDefinition secondCurrencyDef;
-            uint160 secondCurrencyID;
-            if (viaStr != "")
-            {
-                secondCurrencyID = ValidateCurrencyName(viaStr, true, &secondCurrencyDef);
-                std::map<uint160, int32_t> viaIdxMap = secondCurrencyDef.GetCurrenciesMap();
-                if (secondCurrencyID.IsNull() ||
-                    sourceCurrencyID.IsNull() ||
-                    convertToCurrencyID.IsNull() ||
-                    secondCurrencyID == sourceCurrencyID ||
-                    secondCurrencyID == convertToCurrencyID ||
-                    sourceCurrencyID == convertToCurrencyID ||
-                    !viaIdxMap.count(sourceCurrencyID) ||
-                    !viaIdxMap.count(convertToCurrencyID))
-                {
-                    throw JSONRPCError(RPC_INVALID_PARAMETER, "To specify a fractional currency converter, \"currency\" and \"convertto\" must both be reserves of \"via\"");
-                }
-                if (preConvert)
-                {
-                    throw JSONRPCError(RPC_INVALID_PARAMETER, "Cannot combine reserve to reserve conversion with preconversion");
-                }
-                CCurrencyDefinition tempDef = convertToCurrencyDef;
-                convertToCurrencyDef = secondCurrencyDef;
-                secondCurrencyDef = tempDef;
-                convertToCurrencyID = convertToCurrencyDef.GetID();
-                secondCurrencyID = secondCurrencyDef.GetID();
-            }
+    if (!params[0].isArray() && !params[0].isObject())
+    {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "First parameter must be either a JSON object or array of objects.");
+    }
 
-            // if this is reserve to reserve "via" another currency, ensure that both "from" and "to" are reserves of the "via" currency
-            if (secondCurrencyDef.IsValid())
-            {
-                std::map<uint160, int32_t> checkMap = convertToCurrencyDef.GetCurrenciesMap();
-                if (!checkMap.count(sourceCurrencyID) || !checkMap.count(secondCurrencyID))
-                {
-                    throw JSONRPCError(RPC_INVALID_PARAMETER, "If \"via\" is specified, it must be a fractional currency with reserves of both source and \"convertto\" currency");
-                }
-                reserveToReserve = true;
-                fractionalCurrency = convertToCurrencyDef;
-            }
-            else
-            {
-                // figure out if fractional to reserve, reserve to fractional, or error
-                toFractional = convertToCurrencyDef.GetCurrenciesMap().count(sourceCurrencyID);
+    std::map<uint160, std::vector<CReserveTransfer>> currencyConversions;
 
-                if (toFractional)
-                {
-                    fractionalCurrency = convertToCurrencyDef;
-                }
-                else if (!sourceCurrencyDef.GetCurrenciesMap().count(convertToCurrencyID))
-                {
-                    throw JSONRPCError(RPC_INVALID_PARAMETER, "Source currency cannot be converted to destination");
-                }
-                else
-                {
-                    fractionalCurrency = sourceCurrencyDef;
-                }
-            }
+    UniValue uniTransfers = params[0];
+    if (uniTransfers.isObject())
+    {
+        uniTransfers = UniValue(UniValue::VARR);
+        uniTransfers.push_back(params[0]);
+    }
 
-            if (!fractionalCurrency.IsFractional() && (!preConvert || fractionalCurrency.startBlock <= nHeight))
-            {
-                throw JSONRPCError(RPC_INVALID_PARAMETER, fractionalCurrency.name + " must be a fractional currency or prior to start block to estimate a conversion price");
-            }
+    if (params.size() > 1 && uni_get_bool(params[1]))
+    {
+        return EstimateConversionBatch(uniTransfers);
+    }
 
-            uint32_t flags = CReserveTransfer::VALID;
-            if (!convertToStr.empty())
+    CCurrencyDefinition fractionalCurrency;
+    bool preConvert = false;
+
+    UniValue retVal(UniValue::VOBJ);
+    CCoinbaseCurrencyState currencyState;
+
+    {
+        LOCK(cs_main);
+        uint32_t nHeight = chainActive.Height();
+
+        for (int i = 0; i < uniTransfers.size(); i++)
+        {
+            bool tmpPreConvert = uni_get_bool(find_value(uniTransfers[i], "preconvert"));
+            if (currencyConversions.size() && tmpPreConvert != preConvert)
             {
-                flags += CReserveTransfer::CONVERT;
-                if (preConvert)
-                {
-                    if (!secondCurrencyID.IsNull())
-                    {
-                        throw JSONRPCError(RPC_INVALID_PARAMETER, "cannot preconvert and also convert reserve to reserve");
-                    }
-                    flags += CReserveTransfer::PRECONVERT;
-                }
-                if (reserveToReserve)
-                {
-                    flags += CReserveTransfer::RESERVE_TO_RESERVE;
-                }
-                else if (!toFractional)
-                {
-                    flags += CReserveTransfer::IMPORT_TO_SOURCE;
-                }
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Estimated conversions cannot be a mixture of pre and normal conversions");
             }
 
-            CReserveTransfer checkTransfer(flags,
-                                        sourceCurrencyID,
-                                        sourceAmount,
-                                        ASSETCHAINS_CHAINID,
-                                        ConnectedChains.ThisChain().GetTransactionTransferFee(),
-                                        convertToCurrencyID,
-                                        DestinationToTransferDestination(CKeyID(convertToCurrencyID)),
-                                        secondCurrencyID);
+            CReserveTransfer checkTransfer = GetConversionToEstimate(uniTransfers[i], nHeight, preConvert, fractionalCurrency);
 
             uint160 importCurrencyID = checkTransfer.GetImportCurrency();
             if (currencyConversions.size() && !currencyConversions.count(importCurrencyID))
@@ -7162,45 +7571,8 @@ UniValue estimateconversion(const UniValue& params, bool fHelp)
             currencyConversions[importCurrencyID].push_back(checkTransfer);
         }
 
-        // now, get last notarization and all pending conversion transactions, calculate new conversions, including the new one to estimate and
-        // return results
-        CPBaaSNotarization notarization;
-        uint160 fractionalCurrencyID = fractionalCurrency.GetID();
-
-        CUTXORef lastUnspentUTXO;
-        CTransaction lastUnspentTx;
-
-        if (fractionalCurrency.systemID == ASSETCHAINS_CHAINID)
-        {
-            notarization.GetLastUnspentNotarization(fractionalCurrencyID,
-                                                    lastUnspentUTXO.hash,
-                                                    *((int32_t *)&lastUnspentUTXO.n),
-                                                    &lastUnspentTx);
-        }
-        else
-        {
-            if (preConvert && fractionalCurrency.launchSystemID != ASSETCHAINS_CHAINID)
-            {
-                throw JSONRPCError(RPC_INVALID_PARAMETER, "Can only preconvert to currencies launching on the current chain");
-            }
-            CChainNotarizationData cnd;
-            if (GetNotarizationData(fractionalCurrencyID, cnd))
-            {
-                notarization = cnd.vtx[cnd.forks[cnd.bestChain].back()].second;
-            }
-        }
-
-        if (!notarization.IsValid())
-        {
-            throw JSONRPCError(RPC_TRANSACTION_ERROR, "Cannot find valid notarization for " + fractionalCurrency.name);
-        }
-
-        currencyState = ConnectedChains.AddPendingConversions(fractionalCurrency,
-                                                                notarization,
-                                                                notarization.notarizationHeight,
-                                                                nHeight,
-                                                                0,
-                                                                currencyConversions.begin()->second);
+        // now, calculate new conversions, including the new one to estimate and return results
+        currencyState = GetEstimatedCurrencyState(fractionalCurrency, nHeight, preConvert, currencyConversions.begin()->second);
     }
 
     if (!currencyState.IsValid())
@@ -8202,6 +8574,7 @@ UniValue makeoffer(const UniValue& params, bool fHelp)
                 }
                 ovk = ovkForShieldingFromTaddr(seed);
 
+                ZC_WaitForParams();
                 saplingOutputCtx = librustzcash_sapling_proving_ctx_init();
                 auto note = libzcash::SaplingNote(*saplingAddress, destinationAmount);
                 OutputDescriptionInfo output(ovk, note, hexMemo);
@@ -9112,6 +9485,7 @@ UniValue takeoffer(const UniValue& params, bool fHelp)
                 pwalletMain->GetSaplingNoteWitnesses(notes, witnesses, anchor);
             }
 
+            ZC_WaitForParams();
             saplingSpendCtx = librustzcash_sapling_proving_ctx_init();
 
             // Add Sapling spends
@@ -9200,6 +9574,7 @@ UniValue takeoffer(const UniValue& params, bool fHelp)
     }
 
     CTransaction txConst(mtx);
+    PrecomputedTransactionData txdata(txConst);
     UniValue vErrors(UniValue::VARR);
 
     // Sign what we can
@@ -9245,9 +9620,9 @@ UniValue takeoffer(const UniValue& params, bool fHelp)
         const CAmount& amount = coins->vout[txin.prevout.n].nValue;
 
         SignatureData sigdata;
-        ProduceSignature(MutableTransactionSignatureCreator(pwalletMain, &mtx, i, amount, prevPubKey), prevPubKey, sigdata, consensusBranchId);
+        ProduceSignature(TransactionSignatureCreator(pwalletMain, &txConst, i, amount, prevPubKey, INT32_MAX, SIGHASH_ALL, &txdata), prevPubKey, sigdata, consensusBranchId);
 
-        TransactionSignatureChecker checker(&txConst, i, amount);
+        TransactionSignatureChecker checker(&txConst, i, amount, txdata);
         sigdata = CombineSignatures(prevPubKey, checker, sigdata, DataFromTransaction(txConst, i), consensusBranchId);
 
         UpdateTransaction(mtx, i, sigdata);
@@ -12270,6 +12645,7 @@ UniValue refundfailedlaunch(const UniValue& params, bool fHelp)
         LOCK2(cs_main, mempool.cs);
 
         CMutableTransaction newTx(tx);
+        PrecomputedTransactionData txdata(tx);
 
         // sign the transaction and submit
         bool signSuccess;
@@ -12298,7 +12674,7 @@ UniValue refundfailedlaunch(const UniValue& params, bool fHelp)
                 outputScript = coins.vout[tx.vin[i].prevout.n].scriptPubKey;
             }
 
-            signSuccess = ProduceSignature(TransactionSignatureCreator(pwalletMain, &tx, i, value, SIGHASH_ALL), outputScript, sigdata, consensusBranchId);
+            signSuccess = ProduceSignature(TransactionSignatureCreator(pwalletMain, &tx, i, value, SIGHASH_ALL, &txdata), outputScript, sigdata, consensusBranchId);
 
             if (!signSuccess)
             {
@@ -12818,24 +13194,37 @@ UniValue getsaplingtree(const UniValue& params, bool fHelp)
 
     UniValue ret(UniValue::VARR);
 
-    LOCK(cs_main);
-    CCoinsViewCache view(pcoinsTip);
-    SaplingMerkleTree tree;
+    // the blocks are looked up under the lock, their trees mostly come from the tree state cache without it
+    std::vector<int> heights;
+    std::vector<uint256> hashes, roots;
+    uint64_t tipTime;
+    {
+        LOCK(cs_main);
+        for (int i = start; i <= end && i <= chainActive.Height(); i += step)
+        {
+            CBlockIndex &blkIndex = *(chainActive[i]);
+            heights.push_back(blkIndex.GetHeight());
+            hashes.push_back(blkIndex.GetBlockHash());
+            roots.push_back(blkIndex.hashFinalSaplingRoot);
+        }
+        tipTime = chainActive.LastTip()->nTime;
+    }
+
+    std::vector<std::shared_ptr<const std::vector<unsigned char>>> treeStates;
+    GetSaplingTreeStates(roots, treeStates);
 
     std::string networkIDName = EncodeDestination(CIdentityID(ASSETCHAINS_CHAINID));
 
-    for (int i = start; i <= end; i += step)
+    for (size_t i = 0; i < heights.size(); i++)
     {
-        CBlockIndex &blkIndex = *(chainActive[i]);
-        if (view.GetSaplingAnchorAt(blkIndex.hashFinalSaplingRoot, tree))
+        if (treeStates[i])
         {
             UniValue entry(UniValue::VOBJ);
             entry.push_back(Pair("network", networkIDName));
-            entry.push_back(Pair("height", blkIndex.GetHeight()));
-            entry.push_back(Pair("hash", blkIndex.GetBlockHash().GetHex()));
-            entry.push_back(Pair("time", (uint64_t)chainActive.LastTip()->nTime));
-            std::vector<unsigned char> treeBytes = ::AsVector(tree);
-            entry.push_back(Pair("tree", HexBytes(treeBytes.data(), treeBytes.size())));
+            entry.push_back(Pair("height", heights[i]));
+            entry.push_back(Pair("hash", hashes[i].GetHex()));
+            entry.push_back(Pair("time", tipTime));
+            entry.push_back(Pair("tree", HexBytes(treeStates[i]->data(), treeStates[i]->size())));
             ret.push_back(entry);
         }
     }
@@ -14573,7 +14962,8 @@ UniValue registeridentity(const UniValue& params, bool fHelp)
 
             "\nArguments\n"
             "{\n"
-            "    \"txid\" : \"hexid\",          (hex)    the transaction ID of the name commitment for this ID name\n"
+            "    \"txid\" : \"hexid\",          (hex)    the transaction ID of the name commitment for this ID name, optional\n"
+            "                                        if the node has an identity state index, which finds it from the reservation\n"
             "    \"namereservation\" :\n"
             "    {\n"
             "        \"name\": \"namestr\",     (string) the unique name in this commitment\n"
@@ -14631,6 +15021,28 @@ UniValue registeridentity(const UniValue& params, bool fHelp)
         reservation = CNameReservation(nameResUni, CVDXF::HasExplicitParent(rawName) ? uint160() : ASSETCHAINS_CHAINID);
     }
 
+    // without a commitment transaction ID, find the latest confirmed, unspent commitment output for this reservation
+    if (txid.IsNull() && fIdentityStateIndex && (advReservation.IsValid() || reservation.IsValid()))
+    {
+        std::vector<CIdentityCommitmentIndexEntry> commitments;
+        uint256 commitmentHash = advReservation.IsValid() ? advReservation.GetCommitment().hash : reservation.GetCommitment().hash;
+        if (pblocktree->ReadIdentityCommitmentIndex(commitmentHash, commitments))
+        {
+            LOCK(mempool.cs);
+            for (auto it = commitments.rbegin(); it != commitments.rend(); it++)
+            {
+                CCoins coins;
+                if (pcoinsTip->GetCoins(it->second, coins) &&
+                    coins.IsAvailable(it->first.index) &&
+                    !mempool.mapNextTx.count(COutPoint(it->second, it->first.index)))
+                {
+                    txid = it->second;
+                    break;
+                }
+            }
+        }
+    }
+
     UniValue rawID = find_value(params[0], "identity");
 
     int idVersion;
@@ -16594,6 +17006,119 @@ UniValue getidentity(const UniValue& params, bool fHelp)
     }
 }
 
+UniValue getidentities(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() < 1 || params.size() > 3)
+    {
+        throw runtime_error(
+            "getidentities [\"name@ || iid\",...] (height) (compact)\n"
+            "\nLooks up many identities in one call, as getidentity does for one.\n"
+
+            "\nArguments\n"
+            "    [\"name@ || iid\",...]                (array, required) names followed by \"@\" or i-addresses of identities\n"
+            "    \"height\"                             (number, optional) default=current height, return identities as of this height, if -1 include mempool\n"
+            "    \"compact\"                            (bool, optional) default=true, if true, identities are returned without their content maps\n"
+
+            "\nResult:\n"
+            "[                                        (array) one entry for each requested identity, in request order\n"
+            "  {\n"
+            "    \"requested\" : \"name@ || iid\",      (string) the name or ID as it was requested\n"
+            "    \"found\" : true || false,            (bool) false if the name or ID is invalid, or the identity does not exist\n"
+            "    \"friendlyname\" : \"name@\",          (string) only if found\n"
+            "    \"identity\" : {...},                 (object) only if found\n"
+            "    \"status\" : \"active\" || \"revoked\",  (string) only if found\n"
+            "    \"blockheight\" : n,                  (number) height of the identity state, -1 if it is in the mempool\n"
+            "    \"txid\" : \"hexid\",                  (string) transaction with the identity state\n"
+            "    \"vout\" : n                          (number) output of the identity state\n"
+            "  },\n"
+            "  ...\n"
+            "]\n"
+
+            "\nExamples:\n"
+            + HelpExampleCli("getidentities", "'[\"name@\",\"othername@\"]'")
+            + HelpExampleRpc("getidentities", "[\"name@\",\"othername@\"]")
+        );
+    }
+
+    CheckIdentityAPIsValid();
+
+    if (!params[0].isArray())
+    {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "First parameter must be an array of friendly names or identity addresses");
+    }
+
+    bool compact = params.size() > 2 ? uni_get_bool(params[2], true) : true;
+
+    std::vector<CIdentityID> requestedIDs;
+    for (int i = 0; i < params[0].size(); i++)
+    {
+        CTxDestination idID = DecodeDestination(uni_get_str(params[0][i]));
+        requestedIDs.push_back(idID.which() == COptCCParams::ADDRTYPE_ID ? CIdentityID(GetDestinationID(idID)) : CIdentityID());
+    }
+
+    LOCK(cs_main);
+
+    uint32_t lteHeight = chainActive.Height();
+    bool useMempool = false;
+    if (params.size() > 1)
+    {
+        uint32_t tmpHeight = uni_get_int64(params[1]);
+        if (tmpHeight > 0 && lteHeight > tmpHeight)
+        {
+            lteHeight = tmpHeight;
+        }
+        else if (tmpHeight == -1)
+        {
+            lteHeight = chainActive.Height() + 1;
+            useMempool = true;
+        }
+    }
+
+    std::vector<CIdentityID> lookupIDs;
+    for (auto &oneID : requestedIDs)
+    {
+        if (!oneID.IsNull())
+        {
+            lookupIDs.push_back(oneID);
+        }
+    }
+
+    std::map<CIdentityID, std::tuple<CIdentity, uint32_t, CTxIn>> foundIdentities = CIdentity::LookupIdentityBatch(lookupIDs, lteHeight, useMempool);
+
+    UniValue ret(UniValue::VARR);
+    for (int i = 0; i < requestedIDs.size(); i++)
+    {
+        UniValue oneResult(UniValue::VOBJ);
+        oneResult.pushKV("requested", params[0][i]);
+
+        uint160 parent;
+        auto foundIt = requestedIDs[i].IsNull() ? foundIdentities.end() : foundIdentities.find(requestedIDs[i]);
+        if (foundIt != foundIdentities.end() &&
+            std::get<0>(foundIt->second).name == CleanName(std::get<0>(foundIt->second).name, parent))
+        {
+            CIdentity identity = std::get<0>(foundIt->second);
+            oneResult.pushKV("found", true);
+            oneResult.pushKV("friendlyname", ConnectedChains.GetFriendlyIdentityName(identity));
+            oneResult.pushKV("status", identity.IsRevoked() ? "revoked" : "active");
+            if (compact)
+            {
+                identity.contentMap.clear();
+                identity.contentMultiMap.clear();
+            }
+            oneResult.pushKV("identity", identity.ToUniValue());
+            oneResult.pushKV("blockheight", (int64_t)(int32_t)std::get<1>(foundIt->second));
+            oneResult.pushKV("txid", std::get<2>(foundIt->second).prevout.hash.GetHex());
+            oneResult.pushKV("vout", (int32_t)std::get<2>(foundIt->second).prevout.n);
+        }
+        else
+        {
+            oneResult.pushKV("found", false);
+        }
+        ret.push_back(oneResult);
+    }
+    return ret;
+}
+
 bool CConnectedChains::GetNotaryCurrencies(const CRPCChainData notaryChain,
                                            const std::set<uint160> &currencyIDs,
                                            std::map<uint160, std::pair<CCurrencyDefinition, CPBaaSNotarization>> &currencyDefs,
@@ -16767,10 +17292,10 @@ bool CConnectedChains::GetNotaryIDs(const CRPCChainData notaryChain,
 
 UniValue getidentityhistory(const UniValue& params, bool fHelp)
 {
-    if (fHelp || params.size() < 1 || params.size() > 5)
+    if (fHelp || params.size() < 1 || params.size() > 7)
     {
         throw runtime_error(
-            "getidentityhistory \"name@ || iid\" (heightstart) (heightend) (txproofs) (txproofheight)\n"
+            "getidentityhistory \"name@ || iid\" (heightstart) (heightend) (txproofs) (txproofheight) (pagesize) (\"cursor\")\n"
             "\n\n"
 
             "\nArguments\n"
@@ -16780,8 +17305,13 @@ UniValue getidentityhistory(const UniValue& params, bool fHelp)
             "                                                               inclusive. -1 means also return values from the mempool.\n"
             "    \"txproofs\"                           (bool, optional) default=false, if true, returns proof of ID\n"
             "    \"txproofheight\"                      (number, optional) default=\"height\", height from which to generate a proof\n"
+            "    \"pagesize\"                           (number, optional) default=0 which means all, maximum number of confirmed history\n"
+            "                                                               entries to return. requires the identity state index\n"
+            "    \"cursor\"                             (string, optional) \"nextcursor\" from the previous page, to continue after it\n"
 
             "\nResult:\n"
+            "    \"history\"                            (array) identity revisions in chain order, followed by mempool revisions on the last page\n"
+            "    \"nextcursor\"                         (string) present if there are more entries, pass as \"cursor\" to get the next page\n"
 
             "\nExamples:\n"
             + HelpExampleCli("getidentityhistory", "\"name@\"")
@@ -16832,6 +17362,30 @@ UniValue getidentityhistory(const UniValue& params, bool fHelp)
         txProofHeight = lteHeight;
     }
 
+    int64_t pageSize = params.size() > 5 ? uni_get_int64(params[5]) : 0;
+    std::string cursorStr = params.size() > 6 ? uni_get_str(params[6]) : "";
+    if (pageSize < 0)
+    {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "pagesize must not be negative");
+    }
+    if ((pageSize || !cursorStr.empty()) && !fIdentityStateIndex)
+    {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Paged identity history requires the identity state index. Restart with -reindex to build it.");
+    }
+    CIdentityStateIndexKey cursorKey;
+    if (!cursorStr.empty())
+    {
+        bool success = false;
+        if (IsHex(cursorStr))
+        {
+            ::FromVector(ParseHex(cursorStr), cursorKey, &success);
+        }
+        if (!success || cursorKey.identityID != GetDestinationID(idID))
+        {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor: " + cursorStr);
+        }
+    }
+
     CTxIn idTxIn;
 
     CIdentity identity;
@@ -16885,7 +17439,58 @@ UniValue getidentityhistory(const UniValue& params, bool fHelp)
         ret.push_back(Pair("txid", idTxIn.prevout.hash.GetHex()));
         ret.push_back(Pair("vout", (int32_t)idTxIn.prevout.n));
 
-        auto identities = CIdentity::LookupIdentities(GetDestinationID(idID), gteHeight, lteHeight, useMempool, txProof, txProofHeight, std::vector<uint160>(), true);
+        std::vector<std::tuple<CIdentity, uint256, uint32_t, CUTXORef, CPartialTransactionProof>> identities;
+        std::string nextCursor;
+
+        if (fIdentityStateIndex)
+        {
+            // read only the requested page of confirmed history from the index, and load transactions only for proofs
+            std::vector<CIdentityStateIndexEntry> indexEntries;
+            if (!pblocktree->ReadIdentityStateIndex(identityID,
+                                                   indexEntries,
+                                                   gteHeight,
+                                                   std::min(lteHeight, (uint32_t)chainActive.Height()),
+                                                   pageSize ? pageSize + 1 : 0,
+                                                   cursorStr.empty() ? nullptr : &cursorKey))
+            {
+                throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to read identity state index");
+            }
+            if (pageSize && indexEntries.size() > pageSize)
+            {
+                indexEntries.resize(pageSize);
+                nextCursor = HexStr(::AsVector(indexEntries.back().first));
+            }
+            for (auto &oneEntry : indexEntries)
+            {
+                CBlockIndex *pIndex = chainActive[oneEntry.first.height];
+                CPartialTransactionProof entryProof;
+                CTransaction identityTx;
+                uint256 blkHash;
+                if (txProof && pIndex && myGetTransaction(oneEntry.second.first, identityTx, blkHash))
+                {
+                    entryProof = CPartialTransactionProof(identityTx,
+                                                          std::vector<int>(),
+                                                          std::vector<int>({(int)oneEntry.first.index}),
+                                                          pIndex,
+                                                          txProofHeight);
+                }
+                identities.push_back({oneEntry.second.second,
+                                      pIndex ? pIndex->GetBlockHash() : uint256(),
+                                      oneEntry.first.height,
+                                      CUTXORef(oneEntry.second.first, oneEntry.first.index),
+                                      entryProof});
+            }
+            if (useMempool && nextCursor.empty())
+            {
+                // with a height range beyond the chain, only mempool entries are returned
+                auto mempoolIdentities = CIdentity::LookupIdentities(identityID, chainActive.Height() + 1, chainActive.Height() + 1, true);
+                identities.insert(identities.end(), mempoolIdentities.begin(), mempoolIdentities.end());
+            }
+        }
+        else
+        {
+            identities = CIdentity::LookupIdentities(GetDestinationID(idID), gteHeight, lteHeight, useMempool, txProof, txProofHeight, std::vector<uint160>(), true);
+        }
 
         UniValue identityArrUni(UniValue::VARR);
         for (auto &oneIdentity : identities)
@@ -16902,6 +17507,10 @@ UniValue getidentityhistory(const UniValue& params, bool fHelp)
             identityArrUni.push_back(identityDescr);
         }
         ret.pushKV("history", identityArrUni);
+        if (!nextCursor.empty())
+        {
+            ret.pushKV("nextcursor", nextCursor);
+        }
         return ret;
     }
     else
@@ -17037,20 +17646,39 @@ UniValue getidentitycontent(const UniValue& params, bool fHelp)
         ret.push_back(Pair("txid", idTxIn.prevout.hash.GetHex()));
         ret.push_back(Pair("vout", (int32_t)idTxIn.prevout.n));
 
-        auto contentMap = CIdentity::GetAggregatedIdentityMultimap(identityID,
-                                                                   gteHeight,
-                                                                   lteHeight,
-                                                                   useMempool,
-                                                                   txProof,
-                                                                   txProofHeight,
-                                                                   vdxfKey,
-                                                                   keepDeleted);
-
-        // put the aggregated content map in the ID before rendering
         identity.contentMultiMap.clear();
-        for (auto oneMapEntry : contentMap)
+        if (!vdxfKey.IsNull() && fIdentityStateIndex)
+        {
+            // with the content index, the content under one VDXF key is read directly
+            auto keyContent = CIdentity::GetIdentityContentByKey(identityID,
+                                                                 vdxfKey,
+                                                                 gteHeight,
+                                                                 lteHeight,
+                                                                 useMempool,
+                                                                 txProof,
+                                                                 txProofHeight,
+                                                                 keepDeleted);
+            for (auto &oneEntry : keyContent)
+            {
+                identity.contentMultiMap.insert(std::make_pair(vdxfKey, std::get<0>(oneEntry)));
+            }
+        }
+        else
         {
-            identity.contentMultiMap.insert(std::make_pair(oneMapEntry.first, std::get<0>(oneMapEntry.second)));
+            auto contentMap = CIdentity::GetAggregatedIdentityMultimap(identityID,
+                                                                       gteHeight,
+                                                                       lteHeight,
+                                                                       useMempool,
+                                                                       txProof,
+                                                                       txProofHeight,
+                                                                       vdxfKey,
+                                                                       keepDeleted);
+
+            // put the aggregated content map in the ID before rendering
+            for (auto oneMapEntry : contentMap)
+            {
+                identity.contentMultiMap.insert(std::make_pair(oneMapEntry.first, std::get<0>(oneMapEntry.second)));
+            }
         }
         ret.push_back(Pair("identity", identity.ToUniValue()));
     }
@@ -17129,7 +17757,7 @@ UniValue listidentities(const UniValue& params, bool fHelp)
                 uint160 parent;
                 if (identity.second.IsValid() && identity.second.name == CleanName(identity.second.name, parent))
                 {
-                    oneIdentity = CIdentity::LookupIdentity(identity.first.idID, 0, &oneIdentityHeight);
+                    oneIdentity = pwalletMain->GetCurrentIdentityState(identity.first.idID, &oneIdentityHeight);
 
                     if (!oneIdentity.IsValid())
                     {
@@ -17168,7 +17796,7 @@ UniValue listidentities(const UniValue& params, bool fHelp)
                 uint160 parent;
                 if (identity.second.IsValid() && identity.second.name == CleanName(identity.second.name, parent))
                 {
-                    oneIdentity = CIdentity::LookupIdentity(identity.first.idID, 0, &oneIdentityHeight);
+                    oneIdentity = pwalletMain->GetCurrentIdentityState(identity.first.idID, &oneIdentityHeight);
 
                     if (!oneIdentity.IsValid())
                     {
@@ -17205,7 +17833,7 @@ UniValue listidentities(const UniValue& params, bool fHelp)
                 uint160 parent;
                 if (identity.second.IsValid() && identity.second.name == CleanName(identity.second.name, parent))
                 {
-                    oneIdentity = CIdentity::LookupIdentity(identity.first.idID, 0, &oneIdentityHeight);
+                    oneIdentity = pwalletMain->GetCurrentIdentityState(identity.first.idID, &oneIdentityHeight);
 
                     if (!oneIdentity.IsValid())
                     {
@@ -17243,6 +17871,94 @@ UniValue listidentities(const UniValue& params, bool fHelp)
     }
 }
 
+// answers getidentitieswith... queries from the identity reverse index, without loading any transactions. without a limit,
+// the result is the array of one output per identity that the address index path returns. with a limit, every qualifying
+// identity output is returned in chain order, one page at a time.
+static UniValue IdentitiesWithReverseKey(const UniValue &query, const uint160 &reverseKey)
+{
+    uint32_t fromHeight = uni_get_int64(find_value(query, "fromheight"));
+    uint32_t toHeight = uni_get_int64(find_value(query, "toheight"));
+    bool unspentOnly = uni_get_bool(find_value(query, "unspent"));
+    int64_t limit = uni_get_int64(find_value(query, "limit"));
+    std::string cursorStr = uni_get_str(find_value(query, "cursor"));
+
+    if (limit < 0)
+    {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "limit must not be negative");
+    }
+    CIdentityStateIndexKey cursorKey;
+    if (!cursorStr.empty())
+    {
+        bool success = false;
+        if (IsHex(cursorStr))
+        {
+            ::FromVector(ParseHex(cursorStr), cursorKey, &success);
+        }
+        if (!success)
+        {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor: " + cursorStr);
+        }
+    }
+
+    std::vector<CIdentityStateIndexEntry> entries;
+    if (!pblocktree->ReadIdentityReverseIndex(reverseKey,
+                                             entries,
+                                             fromHeight,
+                                             toHeight,
+                                             unspentOnly,
+                                             limit ? limit + 1 : 0,
+                                             cursorStr.empty() ? nullptr : &cursorKey))
+    {
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to read identity reverse index");
+    }
+
+    UniValue identitiesUni(UniValue::VARR);
+    if (!limit && cursorStr.empty())
+    {
+        std::map<uint160, CIdentityStateIndexEntry> identities;
+        for (auto &oneEntry : entries)
+        {
+            identities.insert(std::make_pair(oneEntry.first.identityID, oneEntry));
+        }
+        for (auto &oneIdentity : identities)
+        {
+            UniValue idUni = oneIdentity.second.second.second.ToUniValue();
+            idUni.pushKV("txout", CUTXORef(oneIdentity.second.second.first, oneIdentity.second.first.index).ToUniValue());
+            identitiesUni.push_back(idUni);
+        }
+        return identitiesUni;
+    }
+
+    std::string nextCursor;
+    if (limit && entries.size() > limit)
+    {
+        entries.resize(limit);
+        nextCursor = HexStr(::AsVector(entries.back().first));
+    }
+    for (auto &oneEntry : entries)
+    {
+        UniValue idUni = oneEntry.second.second.ToUniValue();
+        idUni.pushKV("txout", CUTXORef(oneEntry.second.first, oneEntry.first.index).ToUniValue());
+        idUni.pushKV("height", (int64_t)oneEntry.first.height);
+        identitiesUni.push_back(idUni);
+    }
+    UniValue retVal(UniValue::VOBJ);
+    retVal.pushKV("identities", identitiesUni);
+    if (!nextCursor.empty())
+    {
+        retVal.pushKV("nextcursor", nextCursor);
+    }
+    return retVal;
+}
+
+static void CheckIdentityReverseIndexQuery(const UniValue &query)
+{
+    if (!find_value(query, "limit").isNull() || !find_value(query, "cursor").isNull())
+    {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "\"limit\" and \"cursor\" require the identity state index. Restart with -reindex to build it.");
+    }
+}
+
 UniValue getidentitieswithaddress(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() != 1)
@@ -17257,6 +17973,8 @@ UniValue getidentitieswithaddress(const UniValue& params, bool fHelp)
             "    \"fromheight\":n               (number, optional, default=0) Search for qualified identities modified from this height forward only\n"
             "    \"toheight\":n                 (number, optional, default=0) Search for qualified identities only up until this height (0 == no limit)\n"
             "    \"unspent\":bool               (bool, optional, default=false) if true, this will only return active ID UTXOs as of the current block height\n"
+            "    \"limit\":n                    (number, optional, default=0) if set, return at most this many identity outputs in chain order\n"
+            "    \"cursor\":\"hex\"               (string, optional) \"nextcursor\" from the previous page, to continue after it\n"
             "}\n"
 
             "\nResult:\n"
@@ -17264,6 +17982,8 @@ UniValue getidentitieswithaddress(const UniValue& params, bool fHelp)
             "  {identityobject},                (object) identity with additional member \"txout\" with txhash and output index\n"
             "  ...\n"
             "]\n"
+            "with \"limit\" or \"cursor\", an object with \"identities\", the array of matching identities with their \"height\",\n"
+            "and, if there are more, \"nextcursor\" to pass as \"cursor\" for the next page. these require the identity state index.\n"
 
             "\nExamples:\n"
             + HelpExampleCli("getidentitieswithaddress", "\'{\"address\":\"validprimaryaddress\",\"fromheight\":height, \"toheight\":height, \"unspent\":false}\'")
@@ -17272,7 +17992,7 @@ UniValue getidentitieswithaddress(const UniValue& params, bool fHelp)
     }
 
     CheckIdentityAPIsValid();
-    if (!fIdIndex)
+    if (!fIdIndex && !fIdentityStateIndex)
     {
         throw JSONRPCError(RPC_INVALID_PARAMS, "getidentitieswithaddress requires -idindex=1 when starting the daemon\n");
     }
@@ -17284,6 +18004,12 @@ UniValue getidentitieswithaddress(const UniValue& params, bool fHelp)
     {
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "no valid PKH or PK address\n");
     }
+
+    if (fIdentityStateIndex)
+    {
+        return IdentitiesWithReverseKey(params[0], CIdentity::IdentityPrimaryAddressKey(addressDest));
+    }
+    CheckIdentityReverseIndexQuery(params[0]);
     uint32_t fromHeight = uni_get_int64(find_value(params[0], "fromheight"));
     uint32_t toHeight = uni_get_int64(find_value(params[0], "toheight"));
 
@@ -17334,6 +18060,8 @@ UniValue getidentitieswithrevocation(const UniValue& params, bool fHelp)
             "    \"fromheight\":n               (number, optional, default=0) Search for qualified identities modified from this height forward only\n"
             "    \"toheight\":n                 (number, optional, default=0) Search for qualified identities only up until this height (0 == no limit)\n"
             "    \"unspent\":bool               (bool, optional, default=false) if true, this will only return active ID UTXOs as of the current block height\n"
+            "    \"limit\":n                    (number, optional, default=0) if set, return at most this many identity outputs in chain order\n"
+            "    \"cursor\":\"hex\"               (string, optional) \"nextcursor\" from the previous page, to continue after it\n"
             "}\n"
 
             "\nResult:\n"
@@ -17341,6 +18069,8 @@ UniValue getidentitieswithrevocation(const UniValue& params, bool fHelp)
             "  {identityobject},                (object) identity with additional member \"txout\" with txhash and output index\n"
             "  ...\n"
             "]\n"
+            "with \"limit\" or \"cursor\", an object with \"identities\", the array of matching identities with their \"height\",\n"
+            "and, if there are more, \"nextcursor\" to pass as \"cursor\" for the next page. these require the identity state index.\n"
 
             "\nExamples:\n"
             + HelpExampleCli("getidentitieswithrevocation", "\'{\"identityid\":\"idori-address\",\"fromheight\":height,\"toheight\":height,\"unspent\":false}\'")
@@ -17349,7 +18079,7 @@ UniValue getidentitieswithrevocation(const UniValue& params, bool fHelp)
     }
 
     CheckIdentityAPIsValid();
-    if (!fIdIndex)
+    if (!fIdIndex && !fIdentityStateIndex)
     {
         throw JSONRPCError(RPC_INVALID_PARAMS, "getidentitieswithrevocation requires -idindex=1 when starting the daemon\n");
     }
@@ -17364,6 +18094,12 @@ UniValue getidentitieswithrevocation(const UniValue& params, bool fHelp)
 
     CIdentityID idID = GetDestinationID(addressDest);
 
+    if (fIdentityStateIndex)
+    {
+        return IdentitiesWithReverseKey(params[0], CIdentity::IdentityRevocationKey(idID));
+    }
+    CheckIdentityReverseIndexQuery(params[0]);
+
     uint32_t fromHeight = uni_get_int64(find_value(params[0], "fromheight"));
     uint32_t toHeight = uni_get_int64(find_value(params[0], "toheight"));
 
@@ -17414,6 +18150,8 @@ UniValue getidentitieswithrecovery(const UniValue& params, bool fHelp)
             "    \"fromheight\":n               (number, optional, default=0) Search for qualified identities modified from this height forward only\n"
             "    \"toheight\":n                 (number, optional, default=0) Search for qualified identities only up until this height (0 == no limit)\n"
             "    \"unspent\":bool               (bool, optional, default=false) if true, this will only return active ID UTXOs as of the current block height\n"
+            "    \"limit\":n                    (number, optional, default=0) if set, return at most this many identity outputs in chain order\n"
+            "    \"cursor\":\"hex\"               (string, optional) \"nextcursor\" from the previous page, to continue after it\n"
             "}\n"
 
             "\nResult:\n"
@@ -17421,6 +18159,8 @@ UniValue getidentitieswithrecovery(const UniValue& params, bool fHelp)
             "  {identityobject},                (object) identity with additional member \"txout\" with txhash and output index\n"
             "  ...\n"
             "]\n"
+            "with \"limit\" or \"cursor\", an object with \"identities\", the array of matching identities with their \"height\",\n"
+            "and, if there are more, \"nextcursor\" to pass as \"cursor\" for the next page. these require the identity state index.\n"
 
             "\nExamples:\n"
             + HelpExampleCli("getidentitieswithrecovery", "\'{\"identityid\":\"idori-address\",\"fromheight\":height,\"toheight\":height,\"unspent\":false}\'")
@@ -17429,7 +18169,7 @@ UniValue getidentitieswithrecovery(const UniValue& params, bool fHelp)
     }
 
     CheckIdentityAPIsValid();
-    if (!fIdIndex)
+    if (!fIdIndex && !fIdentityStateIndex)
     {
         throw JSONRPCError(RPC_INVALID_PARAMS, "getidentitieswithrecovery requires -idindex=1 when starting the daemon\n");
     }
@@ -17444,6 +18184,12 @@ UniValue getidentitieswithrecovery(const UniValue& params, bool fHelp)
 
     CIdentityID idID = GetDestinationID(addressDest);
 
+    if (fIdentityStateIndex)
+    {
+        return IdentitiesWithReverseKey(params[0], CIdentity::IdentityRecoveryKey(idID));
+    }
+    CheckIdentityReverseIndexQuery(params[0]);
+
     uint32_t fromHeight = uni_get_int64(find_value(params[0], "fromheight"));
     uint32_t toHeight = uni_get_int64(find_value(params[0], "toheight"));
 
@@ -17935,6 +18681,7 @@ static const CRPCCommand commands[] =
     { "identity",     "setidentitytimelock",          &setidentitytimelock,    true  },
     { "identity",     "recoveridentity",              &recoveridentity,        true  },
     { "identity",     "getidentity",                  &getidentity,            true  },
+    { "identity",     "getidentities",                &getidentities,          true  },
     { "identity",     "getidentityhistory",           &getidentityhistory,     true  },
     { "identity",     "getidentitycontent",           &getidentitycontent,     true  },
     { "identity",     "listidentities",               &listidentities,         true  },
@@ -38,6 +38,13 @@ bool GetChainTransfersBetween(std::multimap<std::pair<uint32_t, uint160>, std::p
 bool GetUnspentChainTransfers(std::multimap<uint160, ChainTransferData> &inputDescriptors, uint160 chainFilter = uint160());
 bool GetUnspentChainTransfers(std::vector<ChainTransferData> &inputDescriptors, uint160 chainID);
 
+// an export with its height, in the form returned by getexports and accepted by submitimports
+typedef std::pair<uint32_t, std::pair<std::pair<CInputDescriptor, CPartialTransactionProof>, std::vector<CReserveTransfer>>> CExportForRelay;
+
+// returns the exports to a currency or system between heights, with proofs relative to heightEnd, or no end height if heightEnd < 0
+std::vector<CExportForRelay> GetExportsForRelay(const std::string &currencyName, int64_t heightStart, int64_t heightEnd);
+UniValue ExportForRelayToUniValue(const CExportForRelay &oneExport);
+
 std::multimap<std::tuple<int, uint160, uint160, int64_t, int64_t>, std::pair<std::pair<int, CCurrencyValueMap>, std::pair<CInputDescriptor, CTransaction>>>
 GetOfferMap(const uint160 &currencyOrId, bool isCurrency, bool acceptOnlyCurrency, bool acceptOnlyId, const std::set<uint160> &currencyOrIdFilter);
 
@@ -524,6 +524,16 @@ UniValue getrawtransaction(const UniValue& params, bool fHelp)
     if (params.size() > 1)
         fVerbose = (params[1].get_int() != 0);
 
+    // the hex is copied from the block file where it can be, without building and reserializing the transaction
+    if (!fVerbose)
+    {
+        std::vector<unsigned char> rawTx;
+        uint256 hashBlock;
+        if (!GetRawTransaction(hash, rawTx, hashBlock, true))
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available about transaction");
+        return HexStr(rawTx.begin(), rawTx.end());
+    }
+
     LOCK(cs_main);
 
     CTransaction tx;
@@ -1272,6 +1282,7 @@ UniValue signrawtransaction(const UniValue& params, bool fHelp)
     // Use CTransaction for the constant parts of the
     // transaction to avoid rehashing.
     const CTransaction txConst(mergedTx);
+    PrecomputedTransactionData txdata(txConst);
     // Sign what we can:
     for (unsigned int i = 0; i < mergedTx.vin.size(); i++) {
         CTxIn& txin = mergedTx.vin[i];
@@ -1286,9 +1297,9 @@ UniValue signrawtransaction(const UniValue& params, bool fHelp)
         SignatureData sigdata;
         // Only sign SIGHASH_SINGLE if there's a corresponding output:
         if (!fHashSingle || (i < mergedTx.vout.size()))
-            ProduceSignature(MutableTransactionSignatureCreator(&keystore, &mergedTx, i, amount, prevPubKey, INT32_MAX, nHashType), prevPubKey, sigdata, consensusBranchId);
+            ProduceSignature(TransactionSignatureCreator(&keystore, &txConst, i, amount, prevPubKey, INT32_MAX, nHashType, &txdata), prevPubKey, sigdata, consensusBranchId);
 
-        TransactionSignatureChecker checker(&txConst, i, amount);
+        TransactionSignatureChecker checker(&txConst, i, amount, txdata);
 
         // ... and merge in other signatures:
         BOOST_FOREACH(const CMutableTransaction& txv, txVariants) {
@@ -1398,6 +1409,127 @@ UniValue sendrawtransaction(const UniValue& params, bool fHelp)
     return hashTx.GetHex();
 }
 
+UniValue sendrawtransactions(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() < 1 || params.size() > 2)
+        throw runtime_error(
+            "sendrawtransactions [\"hexstring\",...] ( allowhighfees )\n"
+            "\nSubmits a batch of raw transactions (serialized, hex-encoded) to local node and network. Proofs and signatures\n"
+            "of the batch are verified in parallel, then the transactions are accepted in order, so later ones may spend earlier ones.\n"
+            "\nArguments:\n"
+            "1. [\"hexstring\",...] (array, required) The hex strings of the raw transactions\n"
+            "2. allowhighfees    (boolean, optional, default=false) Allow high fees\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"txid\" : \"hash\",      (string) The transaction hash in hex\n"
+            "    \"accepted\" : true|false, (boolean) If the transaction is in the mempool or block chain\n"
+            "    \"error\" : \"reason\"     (string, optional) Why the transaction was rejected\n"
+            "  }, ...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("sendrawtransactions", "\"[\\\"signedhex\\\",\\\"signedhex\\\"]\"") +
+            "\nAs a json rpc call\n"
+            + HelpExampleRpc("sendrawtransactions", "[\"signedhex\",\"signedhex\"]")
+        );
+
+    RPCTypeCheck(params, boost::assign::list_of(UniValue::VARR)(UniValue::VBOOL));
+
+    UniValue hexTxs = params[0].get_array();
+    std::vector<CTransaction> txs(hexTxs.size());
+    for (int i = 0; i < hexTxs.size(); i++)
+    {
+        if (!hexTxs[i].isStr() || !DecodeHexTx(txs[i], hexTxs[i].get_str()))
+            throw JSONRPCError(RPC_DESERIALIZATION_ERROR, strprintf("TX decode failed for transaction %d", i));
+    }
+
+    // transactions already known are reported without being submitted again
+    std::vector<UniValue> results(txs.size(), UniValue(UniValue::VOBJ));
+    std::vector<CTransaction> toSubmit;
+    std::vector<int> submitIndex;
+    std::vector<unsigned char> rejectAbsurdFee;
+    {
+        LOCK(cs_main);
+        int nextBlockHeight = chainActive.Height() + 1;
+        bool fOverwinter = Params().GetConsensus().NetworkUpgradeActive(nextBlockHeight, Consensus::UPGRADE_OVERWINTER);
+        for (int i = 0; i < txs.size(); i++)
+        {
+            const CTransaction &tx = txs[i];
+            uint256 hashTx = tx.GetHash();
+            results[i].push_back(Pair("txid", hashTx.GetHex()));
+
+            const CCoins* existingCoins = pcoinsTip->AccessCoins(hashTx);
+            if (existingCoins && existingCoins->nHeight < 1000000000)
+            {
+                results[i].push_back(Pair("accepted", true));
+                results[i].push_back(Pair("error", "transaction already in block chain"));
+                continue;
+            }
+            if (mempool.exists(hashTx))
+            {
+                results[i].push_back(Pair("accepted", true));
+                RelayTransaction(tx);
+                continue;
+            }
+
+            // DoS mitigation: reject transactions expiring soon
+            if (tx.nExpiryHeight > 0 && fOverwinter && nextBlockHeight + TX_EXPIRING_SOON_THRESHOLD > tx.nExpiryHeight)
+            {
+                results[i].push_back(Pair("accepted", false));
+                results[i].push_back(Pair("error", strprintf("tx-expiring-soon: expiryheight is %d but should be at least %d to avoid transaction expiring soon",
+                                                             tx.nExpiryHeight,
+                                                             nextBlockHeight + TX_EXPIRING_SOON_THRESHOLD)));
+                continue;
+            }
+
+            bool fOverrideFees = false;
+            for (auto &oneOut : tx.vout)
+            {
+                if (CCurrencyDefinition(oneOut.scriptPubKey).IsValid())
+                {
+                    fOverrideFees = true;
+                }
+            }
+            if (params.size() > 1)
+            {
+                fOverrideFees = params[1].get_bool();
+            }
+            toSubmit.push_back(tx);
+            submitIndex.push_back(i);
+            rejectAbsurdFee.push_back(!fOverrideFees);
+        }
+    }
+
+    std::vector<CValidationState> states;
+    std::vector<unsigned char> accepted, missingInputs;
+    AcceptToMemoryPoolBatch(mempool, toSubmit, states, accepted, missingInputs, false, false, rejectAbsurdFee);
+
+    for (int j = 0; j < toSubmit.size(); j++)
+    {
+        UniValue &result = results[submitIndex[j]];
+        result.push_back(Pair("accepted", (bool)accepted[j]));
+        if (accepted[j])
+        {
+            RelayTransaction(toSubmit[j]);
+        }
+        else if (states[j].IsInvalid())
+        {
+            result.push_back(Pair("error", strprintf("%i: %s", states[j].GetRejectCode(), states[j].GetRejectReason())));
+        }
+        else
+        {
+            result.push_back(Pair("error", missingInputs[j] ? std::string("Missing inputs") : states[j].GetRejectReason()));
+        }
+    }
+
+    UniValue ret(UniValue::VARR);
+    for (auto &oneResult : results)
+    {
+        ret.push_back(oneResult);
+    }
+    return ret;
+}
+
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         okSafeMode
   //  --------------------- ------------------------  -----------------------  ----------
@@ -1406,6 +1538,7 @@ static const CRPCCommand commands[] =
     { "rawtransactions",    "decoderawtransaction",   &decoderawtransaction,   true  },
     { "rawtransactions",    "decodescript",           &decodescript,           true  },
     { "rawtransactions",    "sendrawtransaction",     &sendrawtransaction,     false },
+    { "rawtransactions",    "sendrawtransactions",    &sendrawtransactions,    false },
     { "rawtransactions",    "signrawtransaction",     &signrawtransaction,     false }, /* uses wallet if enabled */
 
     { "blockchain",         "gettxoutproof",          &gettxoutproof,          true  },
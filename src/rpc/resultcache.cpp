@@ -0,0 +1,249 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "rpc/resultcache.h"
+
+#include "hash.h"
+#include "init.h"
+#include "main.h"
+#include "sync.h"
+#include "util.h"
+#include "utilstrencodings.h"
+
+#include <list>
+#include <unordered_map>
+
+#include <boost/algorithm/string.hpp>
+
+namespace {
+
+struct CRPCCacheEntry
+{
+    // the result as JSON, split where the confirmations of a block or header go, since those change with every block
+    std::string strPrefix;
+    std::string strSuffix;
+    bool fConfirmations;
+    int nConfirmationsHeight;
+    int nHeight;                            // height the call is bound to
+    uint256 blockHash;                      // block at that height when the result was cached
+    std::string strETag;
+    std::list<std::string>::iterator lruIt;
+
+    size_t Size(const std::string& strKey) const { return strKey.size() * 2 + strPrefix.size() + strSuffix.size() + strETag.size() + 128; }
+};
+
+CCriticalSection cs_rpcResultCache;
+std::unordered_map<std::string, CRPCCacheEntry> mapRPCResultCache;
+std::list<std::string> lruRPCResultCache;           // most recently used first
+size_t nRPCResultCacheBytes = 0;
+
+int nRPCCacheDepth = DEFAULT_RPC_CACHE_DEPTH;
+size_t nRPCCacheMaxBytes = 0;
+
+std::string GetCacheKey(const std::string& strMethod, const UniValue& params)
+{
+    return strMethod + "\n" + params.write();
+}
+
+void EraseEntry(std::unordered_map<std::string, CRPCCacheEntry>::iterator it)
+{
+    AssertLockHeld(cs_rpcResultCache);
+    nRPCResultCacheBytes -= it->second.Size(it->first);
+    lruRPCResultCache.erase(it->second.lruIt);
+    mapRPCResultCache.erase(it);
+}
+
+// a height parameter given as a number, or as the last height of a "start,end[,step]" range
+bool ParseHeightParam(const UniValue& param, int& nHeight, bool fRange)
+{
+    if (param.isNum()) {
+        nHeight = param.get_int();
+        return true;
+    }
+    if (!param.isStr())
+        return false;
+
+    std::vector<std::string> vParts;
+    boost::split(vParts, param.get_str(), boost::is_any_of(","));
+    if (vParts.empty() || vParts.size() > 3 || (!fRange && vParts.size() > 1))
+        return false;
+    return ParseInt32(vParts[vParts.size() > 1 ? 1 : 0], &nHeight);
+}
+
+int GetBlockParamHeight(const UniValue& param)
+{
+    if (param.isNum())
+        return param.get_int();
+    if (!param.isStr())
+        return -1;
+    std::string strBlock = param.get_str();
+    if (strBlock.size() != 64 || !IsHex(strBlock)) {
+        int nHeight;
+        return ParseInt32(strBlock, &nHeight) ? nHeight : -1;
+    }
+
+    // a block that is not in the active chain is not bound to its height
+    LOCK(cs_main);
+    BlockMap::iterator it = mapBlockIndex.find(uint256S(strBlock));
+    if (it == mapBlockIndex.end() || !chainActive.Contains(it->second))
+        return -1;
+    return it->second->GetHeight();
+}
+
+} // namespace
+
+void InitRPCResultCache()
+{
+    nRPCCacheDepth = std::max((int64_t)1, GetArg("-rpccachedepth", DEFAULT_RPC_CACHE_DEPTH));
+    nRPCCacheMaxBytes = std::max((int64_t)0, GetArg("-rpccachesize", DEFAULT_RPC_CACHE_SIZE)) << 20;
+    ClearRPCResultCache();
+}
+
+int GetRPCCallBoundHeight(const std::string& strMethod, const UniValue& params)
+{
+    int nHeight = -1;
+    if (strMethod == "getblock" || strMethod == "getblockheader") {
+        if (params.size() > 0)
+            nHeight = GetBlockParamHeight(params[0]);
+    } else if (strMethod == "getcurrencystate") {
+        if (params.size() < 2 || !ParseHeightParam(params[1], nHeight, true))
+            return -1;
+    } else if (strMethod == "getidentity") {
+#ifdef ENABLE_WALLET
+        // whether this wallet can spend or sign for the identity is part of the result, and that changes with the wallet
+        if (pwalletMain)
+            return -1;
+#endif
+        if (params.size() < 2 || !ParseHeightParam(params[1], nHeight, false) || nHeight <= 0)
+            return -1;
+        int nProofHeight;
+        if (params.size() > 3 && ParseHeightParam(params[3], nProofHeight, false))
+            nHeight = std::max(nHeight, nProofHeight);
+    } else if (strMethod == "getnotarizationproofs") {
+        // every challenge must name the heights it is proven at
+        if (params.size() != 1 || !params[0].isArray() || !params[0].size())
+            return -1;
+        static const char* const heightKeys[] = {"proveheight", "atheight", "fromheight", "toheight"};
+        for (size_t i = 0; i < params[0].size(); i++) {
+            bool fHasHeight = false;
+            for (const char* key : heightKeys) {
+                UniValue oneHeight = find_value(params[0][i], key);
+                int nOneHeight;
+                if (!oneHeight.isNull()) {
+                    if (!ParseHeightParam(oneHeight, nOneHeight, false) || nOneHeight < 0)
+                        return -1;
+                    nHeight = std::max(nHeight, nOneHeight);
+                    fHasHeight = true;
+                }
+            }
+            if (!fHasHeight)
+                return -1;
+        }
+    }
+    return nHeight;
+}
+
+bool IsRPCCallCacheable(const std::string& strMethod, const UniValue& params)
+{
+    if (!nRPCCacheMaxBytes)
+        return false;
+    int nHeight = GetRPCCallBoundHeight(strMethod, params);
+    return nHeight >= 0 && nHeight <= GetChainReadSnapshot()->Height() - nRPCCacheDepth;
+}
+
+bool LookupRPCResult(const std::string& strMethod, const UniValue& params, CRPCCachedResult& cached)
+{
+    if (!nRPCCacheMaxBytes)
+        return false;
+
+    std::string strKey = GetCacheKey(strMethod, params);
+    std::shared_ptr<const CChainReadSnapshot> chain = GetChainReadSnapshot();
+
+    LOCK(cs_rpcResultCache);
+    auto it = mapRPCResultCache.find(strKey);
+    if (it == mapRPCResultCache.end())
+        return false;
+
+    // a reorganization that reached the bound block makes the result stale
+    const CBlockIndex* pindex = (*chain)[it->second.nHeight];
+    if (!pindex || pindex->GetBlockHash() != it->second.blockHash || it->second.nHeight > chain->Height() - nRPCCacheDepth) {
+        EraseEntry(it);
+        return false;
+    }
+
+    lruRPCResultCache.splice(lruRPCResultCache.begin(), lruRPCResultCache, it->second.lruIt);
+    cached.strResult = it->second.strPrefix;
+    if (it->second.fConfirmations)
+        cached.strResult += std::to_string(chain->Height() - it->second.nConfirmationsHeight + 1);
+    cached.strResult += it->second.strSuffix;
+    cached.strETag = it->second.strETag;
+    return true;
+}
+
+std::string StoreRPCResult(const std::string& strMethod, const UniValue& params, const UniValue& result)
+{
+    if (!nRPCCacheMaxBytes)
+        return std::string();
+
+    int nHeight = GetRPCCallBoundHeight(strMethod, params);
+    std::shared_ptr<const CChainReadSnapshot> chain = GetChainReadSnapshot();
+    const CBlockIndex* pindex = nHeight >= 0 && nHeight <= chain->Height() - nRPCCacheDepth ? (*chain)[nHeight] : nullptr;
+    if (!pindex)
+        return std::string();
+
+    std::string strKey = GetCacheKey(strMethod, params);
+    CRPCCacheEntry entry;
+    entry.strPrefix = result.write();
+    entry.fConfirmations = false;
+    entry.nConfirmationsHeight = 0;
+    entry.nHeight = nHeight;
+    entry.blockHash = pindex->GetBlockHash();
+
+    // block results are written with their confirmations first, so the first match is the block's own
+    if ((strMethod == "getblock" || strMethod == "getblockheader") && result.isObject()) {
+        const UniValue& blockHeight = find_value(result, "height");
+        size_t nPos = entry.strPrefix.find("\"confirmations\":");
+        if (nPos != std::string::npos && blockHeight.isNum()) {
+            nPos += strlen("\"confirmations\":");
+            size_t nEnd = entry.strPrefix.find_first_of(",}", nPos);
+            if (nEnd == std::string::npos)
+                return std::string();
+            entry.strSuffix = entry.strPrefix.substr(nEnd);
+            entry.strPrefix.resize(nPos);
+            entry.fConfirmations = true;
+            entry.nConfirmationsHeight = blockHeight.get_int();
+        }
+    }
+
+    // a result with confirmations only stays the same in everything else, which makes its tag a weak one
+    uint256 etagHash = Hash(strKey.begin(), strKey.end(), entry.blockHash.begin(), entry.blockHash.end());
+    entry.strETag = std::string(entry.fConfirmations ? "W/" : "") + "\"" + etagHash.GetHex().substr(0, 32) + "\"";
+
+    // a result too large to leave room for others is not worth evicting them for
+    size_t nSize = entry.Size(strKey);
+    if (nSize > nRPCCacheMaxBytes / 8)
+        return std::string();
+
+    LOCK(cs_rpcResultCache);
+    auto it = mapRPCResultCache.find(strKey);
+    if (it != mapRPCResultCache.end())
+        EraseEntry(it);
+    while (!lruRPCResultCache.empty() && nRPCResultCacheBytes + nSize > nRPCCacheMaxBytes)
+        EraseEntry(mapRPCResultCache.find(lruRPCResultCache.back()));
+
+    lruRPCResultCache.push_front(strKey);
+    entry.lruIt = lruRPCResultCache.begin();
+    nRPCResultCacheBytes += nSize;
+    std::string strETag = entry.strETag;
+    mapRPCResultCache.emplace(strKey, std::move(entry));
+    return strETag;
+}
+
+void ClearRPCResultCache()
+{
+    LOCK(cs_rpcResultCache);
+    mapRPCResultCache.clear();
+    lruRPCResultCache.clear();
+    nRPCResultCacheBytes = 0;
+}
@@ -0,0 +1,45 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_RPC_RESULTCACHE_H
+#define BITCOIN_RPC_RESULTCACHE_H
+
+#include <stdint.h>
+#include <string>
+
+#include <univalue.h>
+
+/** Results of calls bound to a height at least this many blocks below the tip are cached */
+static const int DEFAULT_RPC_CACHE_DEPTH = 10;
+/** Size of the RPC result cache in MiB, 0 disables it */
+static const int64_t DEFAULT_RPC_CACHE_SIZE = 64;
+
+/** A cached result as JSON, with the ETag that names it for HTTP clients */
+struct CRPCCachedResult
+{
+    std::string strResult;
+    std::string strETag;
+};
+
+/** Reads -rpccachedepth and -rpccachesize */
+void InitRPCResultCache();
+
+/**
+ * Height that the result of a call is bound to, if it is a call to one of the methods whose result only depends on
+ * the chain up to a height given by its parameters, or -1
+ */
+int GetRPCCallBoundHeight(const std::string& strMethod, const UniValue& params);
+
+/** True if the call is bound to a height deep enough below the tip for its result to be cached */
+bool IsRPCCallCacheable(const std::string& strMethod, const UniValue& params);
+
+/** Finds the result of an earlier identical call, if the block it is bound to is still in the active chain */
+bool LookupRPCResult(const std::string& strMethod, const UniValue& params, CRPCCachedResult& cached);
+
+/** Caches the result of a call if it is cacheable, returns its ETag or an empty string */
+std::string StoreRPCResult(const std::string& strMethod, const UniValue& params, const UniValue& result);
+
+void ClearRPCResultCache();
+
+#endif // BITCOIN_RPC_RESULTCACHE_H
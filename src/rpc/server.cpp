@@ -5,8 +5,11 @@
 
 #include "rpc/server.h"
 
+#include "dbwrapper.h" // for CDBLatencyHistogram
+#include "httpserver.h"
 #include "init.h"
 #include "key_io.h"
+#include "main.h" // for GetThreadReadStats
 #include "random.h"
 #include "sync.h"
 #include "ui_interface.h"
@@ -14,7 +17,10 @@
 #include "utilstrencodings.h"
 #include "asyncrpcqueue.h"
 
+#include <atomic>
+#include <deque>
 #include <memory>
+#include <set>
 
 #include <univalue.h>
 
@@ -249,6 +255,469 @@ UniValue stop(const UniValue& params, bool fHelp)
     return buf;
 }
 
+UniValue getrpcqueueinfo(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getrpcqueueinfo\n"
+            "\nReturns the state of the RPC work queue of each priority class.\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"class\": \"xxxx\",       (string) critical, normal or heavy\n"
+            "    \"depth\": n,            (numeric) calls waiting for a worker\n"
+            "    \"maxdepth\": n,         (numeric) calls that may wait before more are rejected\n"
+            "    \"running\": n,          (numeric) calls being executed\n"
+            "    \"maxrunning\": n,       (numeric) calls of this class that may execute at once\n"
+            "    \"processed\": n,        (numeric) calls completed since startup\n"
+            "    \"rejected\": n,         (numeric) calls rejected with a full queue since startup\n"
+            "    \"avgwaitms\": x.xxx,    (numeric) average time calls waited for a worker, in milliseconds\n"
+            "    \"maxwaitms\": x.xxx     (numeric) longest time a call waited for a worker, in milliseconds\n"
+            "  }\n"
+            "  ,...\n"
+            "]\n"
+            "\nThe last entry, of class async, is the queue of operations such as z_sendmany and sendcurrency, and has only\n"
+            "depth, running, maxrunning (its workers, see -rpcasyncthreads) and processed.\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getrpcqueueinfo", "")
+            + HelpExampleRpc("getrpcqueueinfo", "")
+        );
+
+    UniValue ret(UniValue::VARR);
+    BOOST_FOREACH (const HTTPWorkQueueStats& stats, GetHTTPWorkQueueStats()) {
+        UniValue obj(UniValue::VOBJ);
+        obj.push_back(Pair("class", stats.strClass));
+        obj.push_back(Pair("depth", (uint64_t)stats.nDepth));
+        obj.push_back(Pair("maxdepth", (uint64_t)stats.nMaxDepth));
+        obj.push_back(Pair("running", stats.nRunning));
+        obj.push_back(Pair("maxrunning", stats.nMaxRunning));
+        obj.push_back(Pair("processed", stats.nProcessed));
+        obj.push_back(Pair("rejected", stats.nRejected));
+        int64_t nStarted = stats.nProcessed + stats.nRunning;
+        obj.push_back(Pair("avgwaitms", nStarted ? (double)stats.nTotalWaitMicros / nStarted / 1000 : 0.0));
+        obj.push_back(Pair("maxwaitms", (double)stats.nMaxWaitMicros / 1000));
+        ret.push_back(obj);
+    }
+
+    std::shared_ptr<AsyncRPCQueue> q = getAsyncRPCQueue();
+    UniValue async(UniValue::VOBJ);
+    async.push_back(Pair("class", "async"));
+    async.push_back(Pair("depth", (uint64_t)q->getOperationCount()));
+    async.push_back(Pair("running", (uint64_t)q->getNumberOfExecutingOperations()));
+    async.push_back(Pair("maxrunning", (uint64_t)q->getNumberOfWorkers()));
+    async.push_back(Pair("processed", q->getNumberOfFinishedOperations()));
+    ret.push_back(async);
+    return ret;
+}
+
+static const char* const rpcPhaseNames[RPC_PHASE_COUNT] = {"queue", "lockwait", "execute", "serialize"};
+
+/** Counts and latency histograms of the calls to one method */
+struct CRPCMethodRecorder
+{
+    std::atomic<uint64_t> nCalls;
+    std::atomic<uint64_t> nErrors;
+    CDBLatencyHistogram phases[RPC_PHASE_COUNT];
+
+    CRPCMethodRecorder() : nCalls(0), nErrors(0) {}
+};
+
+static CCriticalSection cs_rpcStats;
+// only ever grows, by the methods in the table, so recorders are used without the lock once found
+static std::map<std::string, std::unique_ptr<CRPCMethodRecorder>> mapRPCStats;
+
+static CRPCMethodRecorder& GetRPCRecorder(const std::string& method)
+{
+    LOCK(cs_rpcStats);
+    std::unique_ptr<CRPCMethodRecorder>& pRecorder = mapRPCStats[method];
+    if (!pRecorder)
+        pRecorder.reset(new CRPCMethodRecorder());
+    return *pRecorder;
+}
+
+void RecordRPCPhase(const std::string& method, RPCCallPhase phase, int64_t nMicros)
+{
+    if (tableRPC[method])
+        GetRPCRecorder(method).phases[phase].Add(nMicros);
+}
+
+/** A call that took longer than -rpcslowcallms, with where its time went */
+struct CRPCSlowCall
+{
+    std::string strMethod;
+    std::string strParams;
+    int64_t nTime;
+    bool fSucceeded;
+    int64_t nMicros;
+    int64_t nLockWaitMicros;
+    CThreadReadStats reads;
+};
+
+static std::atomic<int64_t> nRPCSlowCallMicros(0);
+static CCriticalSection cs_rpcSlowCalls;
+static std::deque<CRPCSlowCall> rpcSlowCalls; // newest first
+static const size_t MAX_RPC_SLOW_CALLS = 100;
+static const size_t MAX_RPC_SLOW_CALL_PARAMS = 256;
+
+// methods whose parameters may hold keys, passphrases or data to be signed or decrypted
+static const std::set<std::string> setRPCSensitiveMethods = {
+    "convertpassphrase", "decryptdata", "dumpprivkey", "dumpwallet", "encryptwallet", "importprivkey", "importwallet",
+    "signdata", "signfile", "signmessage", "signrawtransaction", "walletpassphrase", "walletpassphrasechange",
+    "z_exportkey", "z_exportviewingkey", "z_exportwallet", "z_importkey", "z_importviewingkey", "z_importwallet"
+};
+
+static std::string RedactRPCParams(const std::string& method, const UniValue& params)
+{
+    if (setRPCSensitiveMethods.count(method))
+        return strprintf("(%u parameters redacted)", params.size());
+    std::string strParams = params.write();
+    if (strParams.size() > MAX_RPC_SLOW_CALL_PARAMS)
+        strParams = strParams.substr(0, MAX_RPC_SLOW_CALL_PARAMS) + "...";
+    return strParams;
+}
+
+static void RecordRPCSlowCall(CRPCSlowCall& call)
+{
+    LogPrintf("slow RPC call %s %.3fms%s: lockwait %.3fms, %u index scans of %u rows %.3fms, %u transaction reads %.3fms, params %s\n",
+              call.strMethod, call.nMicros / 1000.0, call.fSucceeded ? "" : " (error)", call.nLockWaitMicros / 1000.0,
+              call.reads.nIndexScans, call.reads.nIndexRows, call.reads.nIndexScanMicros / 1000.0,
+              call.reads.nTxReads, call.reads.nTxReadMicros / 1000.0, call.strParams);
+    LOCK(cs_rpcSlowCalls);
+    rpcSlowCalls.push_front(std::move(call));
+    if (rpcSlowCalls.size() > MAX_RPC_SLOW_CALLS)
+        rpcSlowCalls.pop_back();
+}
+
+/** Times one call of a method, from its construction to its destruction, counting it as an error unless Succeeded */
+class CRPCCallTimer
+{
+private:
+    CRPCMethodRecorder& recorder;
+    const std::string& strMethod;
+    const UniValue& params;
+    int64_t nStart;
+    int64_t nLockWaitStart;
+    CThreadReadStats readsStart;
+    bool fSucceeded;
+
+public:
+    CRPCCallTimer(const std::string& method, const UniValue& paramsIn) : recorder(GetRPCRecorder(method)), strMethod(method),
+                                                                        params(paramsIn), nStart(GetTimeMicros()),
+                                                                        nLockWaitStart(GetThreadLockWaitMicros()),
+                                                                        readsStart(GetThreadReadStats()), fSucceeded(false) {}
+    ~CRPCCallTimer()
+    {
+        int64_t nMicros = GetTimeMicros() - nStart;
+        int64_t nLockWaitMicros = GetThreadLockWaitMicros() - nLockWaitStart;
+        recorder.phases[RPC_PHASE_EXECUTE].Add(nMicros);
+        recorder.phases[RPC_PHASE_LOCKWAIT].Add(nLockWaitMicros);
+        recorder.nCalls++;
+        if (!fSucceeded)
+            recorder.nErrors++;
+
+        int64_t nSlowMicros = nRPCSlowCallMicros.load(std::memory_order_relaxed);
+        if (nSlowMicros && nMicros >= nSlowMicros) {
+            const CThreadReadStats& reads = GetThreadReadStats();
+            CRPCSlowCall call;
+            call.strMethod = strMethod;
+            call.strParams = RedactRPCParams(strMethod, params);
+            call.nTime = GetTime();
+            call.fSucceeded = fSucceeded;
+            call.nMicros = nMicros;
+            call.nLockWaitMicros = nLockWaitMicros;
+            call.reads.nIndexScans = reads.nIndexScans - readsStart.nIndexScans;
+            call.reads.nIndexRows = reads.nIndexRows - readsStart.nIndexRows;
+            call.reads.nIndexScanMicros = reads.nIndexScanMicros - readsStart.nIndexScanMicros;
+            call.reads.nTxReads = reads.nTxReads - readsStart.nTxReads;
+            call.reads.nTxReadMicros = reads.nTxReadMicros - readsStart.nTxReadMicros;
+            RecordRPCSlowCall(call);
+        }
+    }
+    void Succeeded() { fSucceeded = true; }
+};
+
+static std::vector<std::pair<std::string, const CRPCMethodRecorder*>> GetRPCRecorders()
+{
+    LOCK(cs_rpcStats);
+    std::vector<std::pair<std::string, const CRPCMethodRecorder*>> recorders;
+    for (const auto& entry : mapRPCStats)
+        recorders.push_back(std::make_pair(entry.first, entry.second.get()));
+    return recorders;
+}
+
+std::string GetRPCMetrics()
+{
+    std::vector<std::pair<std::string, const CRPCMethodRecorder*>> recorders = GetRPCRecorders();
+    std::string strOut;
+
+    strOut += "# HELP verus_rpc_calls_total RPC calls completed, by method\n";
+    strOut += "# TYPE verus_rpc_calls_total counter\n";
+    for (const auto& entry : recorders)
+        strOut += strprintf("verus_rpc_calls_total{method=\"%s\"} %u\n", entry.first, entry.second->nCalls.load());
+
+    strOut += "# HELP verus_rpc_errors_total RPC calls that returned an error, by method\n";
+    strOut += "# TYPE verus_rpc_errors_total counter\n";
+    for (const auto& entry : recorders)
+        strOut += strprintf("verus_rpc_errors_total{method=\"%s\"} %u\n", entry.first, entry.second->nErrors.load());
+
+    strOut += "# HELP verus_rpc_phase_seconds Time spent in each phase of RPC calls, by method\n";
+    strOut += "# TYPE verus_rpc_phase_seconds histogram\n";
+    for (const auto& entry : recorders) {
+        for (int phase = 0; phase < RPC_PHASE_COUNT; phase++) {
+            CDBLatencyStats stats = entry.second->phases[phase].GetStats();
+            if (!stats.nCount)
+                continue;
+            std::string strLabels = strprintf("method=\"%s\",phase=\"%s\"", entry.first, rpcPhaseNames[phase]);
+            // the histogram buckets are cumulative, the last of ours only has the +Inf bound
+            uint64_t nCumulative = 0;
+            for (int i = 0; i < CDBLatencyStats::BUCKETS - 1; i++) {
+                nCumulative += stats.buckets[i];
+                strOut += strprintf("verus_rpc_phase_seconds_bucket{%s,le=\"%g\"} %u\n", strLabels, ((int64_t)1 << i) / 1e6, nCumulative);
+            }
+            strOut += strprintf("verus_rpc_phase_seconds_bucket{%s,le=\"+Inf\"} %u\n", strLabels, stats.nCount);
+            strOut += strprintf("verus_rpc_phase_seconds_sum{%s} %.6f\n", strLabels, stats.nTotalMicros / 1e6);
+            strOut += strprintf("verus_rpc_phase_seconds_count{%s} %u\n", strLabels, stats.nCount);
+        }
+    }
+
+    std::vector<HTTPWorkQueueStats> queues = GetHTTPWorkQueueStats();
+    strOut += "# HELP verus_rpc_queue_depth RPC calls waiting for a worker, by priority class\n";
+    strOut += "# TYPE verus_rpc_queue_depth gauge\n";
+    for (const HTTPWorkQueueStats& queue : queues)
+        strOut += strprintf("verus_rpc_queue_depth{class=\"%s\"} %u\n", queue.strClass, queue.nDepth);
+    strOut += "# HELP verus_rpc_queue_rejected_total RPC calls rejected with a full work queue, by priority class\n";
+    strOut += "# TYPE verus_rpc_queue_rejected_total counter\n";
+    for (const HTTPWorkQueueStats& queue : queues)
+        strOut += strprintf("verus_rpc_queue_rejected_total{class=\"%s\"} %u\n", queue.strClass, queue.nRejected);
+
+    std::shared_ptr<AsyncRPCQueue> q = getAsyncRPCQueue();
+    strOut += "# HELP verus_rpc_async_queue_depth Async operations waiting for a worker\n";
+    strOut += "# TYPE verus_rpc_async_queue_depth gauge\n";
+    strOut += strprintf("verus_rpc_async_queue_depth %u\n", q->getOperationCount());
+    strOut += "# HELP verus_rpc_async_running Async operations being executed\n";
+    strOut += "# TYPE verus_rpc_async_running gauge\n";
+    strOut += strprintf("verus_rpc_async_running %u\n", q->getNumberOfExecutingOperations());
+    strOut += "# HELP verus_rpc_async_workers Async operation workers\n";
+    strOut += "# TYPE verus_rpc_async_workers gauge\n";
+    strOut += strprintf("verus_rpc_async_workers %u\n", q->getNumberOfWorkers());
+    strOut += "# HELP verus_rpc_async_processed_total Async operations run since startup\n";
+    strOut += "# TYPE verus_rpc_async_processed_total counter\n";
+    strOut += strprintf("verus_rpc_async_processed_total %u\n", q->getNumberOfFinishedOperations());
+    return strOut;
+}
+
+static UniValue LockStatsToJSON(const CLockSiteStats& stats)
+{
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("contentions", (uint64_t)stats.nContentions));
+    result.push_back(Pair("waitms", stats.nWaitMicros / 1000.0));
+    result.push_back(Pair("maxwaitms", stats.nMaxWaitMicros / 1000.0));
+    result.push_back(Pair("avgwaitus", stats.nContentions ? (double)stats.nWaitMicros / stats.nContentions : 0.0));
+    result.push_back(Pair("sampledholds", (uint64_t)stats.nSampledHolds));
+    result.push_back(Pair("avgholdus", stats.nSampledHolds ? (double)stats.nHoldMicros / stats.nSampledHolds : 0.0));
+    result.push_back(Pair("maxholdus", (uint64_t)stats.nMaxHoldMicros));
+    return result;
+}
+
+UniValue getlockstats(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() > 2)
+        throw runtime_error(
+            "getlockstats ( count reset )\n"
+            "\nReturns how long threads have waited for each lock and how long it is held, by lock and by the place it is taken,\n"
+            "since startup or the last reset. Waits are timed only when another thread holds the lock. Hold times are timed\n"
+            "for one in every -lockholdsample acquisitions.\n"
+            "\nArguments:\n"
+            "1. count   (numeric, optional, default=20) The number of sites to return, those with the most total wait first\n"
+            "2. reset   (boolean, optional, default=false) Clear the counters after returning them\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"holdsampleinterval\": n,     (numeric) One acquisition in this many has its hold time sampled, 0 for none\n"
+            "  \"locks\": {                   (object) The sites of each lock, by the name it is locked with, most total wait first\n"
+            "    \"name\": {\n"
+            "      \"contentions\": n,        (numeric) Acquisitions that waited for another thread\n"
+            "      \"waitms\": x.xxx,         (numeric) Total milliseconds waited\n"
+            "      \"maxwaitms\": x.xxx,      (numeric) The longest wait, in milliseconds\n"
+            "      \"avgwaitus\": x.xxx,      (numeric) The average wait, in microseconds\n"
+            "      \"sampledholds\": n,       (numeric) Acquisitions whose hold time was sampled\n"
+            "      \"avgholdus\": x.xxx,      (numeric) The average sampled hold, in microseconds\n"
+            "      \"maxholdus\": n           (numeric) The longest sampled hold, in microseconds\n"
+            "    }, ...\n"
+            "  },\n"
+            "  \"sites\": [                   (array) The sites with the most total wait\n"
+            "    {\n"
+            "      \"lock\": \"name\",          (string) The name the lock is taken with\n"
+            "      \"site\": \"file:line\",     (string) Where it is taken\n"
+            "      ...                        The same counters as for each lock\n"
+            "    }, ...\n"
+            "  ]\n"
+            "}\n"
+            "\nLocks of different objects taken at the same place, such as those of each cache, are counted together.\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getlockstats", "")
+            + HelpExampleCli("getlockstats", "50 true")
+            + HelpExampleRpc("getlockstats", "50, true")
+        );
+
+    int nCount = params.size() > 0 ? params[0].get_int() : 20;
+    if (nCount < 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "count must not be negative");
+    std::vector<CLockSiteStats> sites = GetLockSiteStats();
+    if (params.size() > 1 && params[1].get_bool())
+        ResetLockSiteStats();
+
+    auto moreWait = [](const CLockSiteStats& a, const CLockSiteStats& b) { return a.nWaitMicros > b.nWaitMicros; };
+
+    std::map<std::string, CLockSiteStats> mapLocks;
+    for (const CLockSiteStats& site : sites) {
+        auto it = mapLocks.find(site.strName);
+        if (it == mapLocks.end()) {
+            mapLocks[site.strName] = site;
+            continue;
+        }
+        CLockSiteStats& lock = it->second;
+        lock.nContentions += site.nContentions;
+        lock.nWaitMicros += site.nWaitMicros;
+        lock.nMaxWaitMicros = std::max(lock.nMaxWaitMicros, site.nMaxWaitMicros);
+        lock.nSampledHolds += site.nSampledHolds;
+        lock.nHoldMicros += site.nHoldMicros;
+        lock.nMaxHoldMicros = std::max(lock.nMaxHoldMicros, site.nMaxHoldMicros);
+    }
+    std::vector<CLockSiteStats> locks;
+    for (const auto& entry : mapLocks)
+        locks.push_back(entry.second);
+    std::stable_sort(locks.begin(), locks.end(), moreWait);
+    std::stable_sort(sites.begin(), sites.end(), moreWait);
+
+    UniValue locksObj(UniValue::VOBJ);
+    for (const CLockSiteStats& lock : locks)
+        locksObj.push_back(Pair(lock.strName, LockStatsToJSON(lock)));
+
+    UniValue sitesArr(UniValue::VARR);
+    for (size_t i = 0; i < sites.size() && i < (size_t)nCount; i++) {
+        UniValue site(UniValue::VOBJ);
+        site.push_back(Pair("lock", sites[i].strName));
+        site.push_back(Pair("site", strprintf("%s:%d", sites[i].strFile, sites[i].nLine)));
+        site.pushKVs(LockStatsToJSON(sites[i]));
+        sitesArr.push_back(site);
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("holdsampleinterval", GetLockHoldSampleInterval()));
+    ret.push_back(Pair("locks", locksObj));
+    ret.push_back(Pair("sites", sitesArr));
+    return ret;
+}
+
+UniValue getrpcstats(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getrpcstats\n"
+            "\nReturns call counts and latencies of each RPC method called since startup.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"method\": {\n"
+            "    \"calls\": n,           (numeric) calls completed\n"
+            "    \"errors\": n,          (numeric) calls that returned an error\n"
+            "    \"phase\": {            (object) for each of queue, lockwait, execute and serialize\n"
+            "      \"count\": n,         (numeric) calls timed in this phase\n"
+            "      \"totalms\": x.xxx,   (numeric) total time in milliseconds\n"
+            "      \"avgms\": x.xxx,     (numeric) average time in milliseconds\n"
+            "      \"p50ms\": x.xxx,     (numeric) upper bound of the median, in milliseconds\n"
+            "      \"p99ms\": x.xxx      (numeric) upper bound of the 99th percentile, in milliseconds\n"
+            "    }, ...\n"
+            "  }, ...\n"
+            "}\n"
+            "\nqueue and serialize are timed for single calls over HTTP, lockwait is time waiting for locks other threads hold.\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getrpcstats", "")
+            + HelpExampleRpc("getrpcstats", "")
+        );
+
+    UniValue ret(UniValue::VOBJ);
+    for (const auto& entry : GetRPCRecorders()) {
+        UniValue method(UniValue::VOBJ);
+        method.push_back(Pair("calls", (uint64_t)entry.second->nCalls));
+        method.push_back(Pair("errors", (uint64_t)entry.second->nErrors));
+        for (int phase = 0; phase < RPC_PHASE_COUNT; phase++) {
+            CDBLatencyStats stats = entry.second->phases[phase].GetStats();
+            UniValue phaseObj(UniValue::VOBJ);
+            phaseObj.push_back(Pair("count", stats.nCount));
+            phaseObj.push_back(Pair("totalms", stats.nTotalMicros / 1000.0));
+            phaseObj.push_back(Pair("avgms", stats.nCount ? stats.nTotalMicros / 1000.0 / stats.nCount : 0.0));
+            phaseObj.push_back(Pair("p50ms", stats.Percentile(0.5) / 1000.0));
+            phaseObj.push_back(Pair("p99ms", stats.Percentile(0.99) / 1000.0));
+            method.push_back(Pair(rpcPhaseNames[phase], phaseObj));
+        }
+        ret.push_back(Pair(entry.first, method));
+    }
+    return ret;
+}
+
+UniValue getslowrpccalls(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() > 1)
+        throw runtime_error(
+            "getslowrpccalls ( reset )\n"
+            "\nReturns the most recent calls, up to " + std::to_string(MAX_RPC_SLOW_CALLS) + ", that took at least -rpcslowcallms to execute,\n"
+            "newest first, with where their time went. Each is also written to the debug log. Calls are only recorded when\n"
+            "-rpcslowcallms is set.\n"
+            "\nArguments:\n"
+            "1. reset   (boolean, optional, default=false) Clear the recorded calls after returning them\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"method\": \"name\",        (string) The method called\n"
+            "    \"params\": \"json\",        (string) The parameters, truncated, or redacted for methods that may take keys\n"
+            "    \"time\": ttt,             (numeric) When the call finished, in seconds since epoch\n"
+            "    \"error\": true|false,     (boolean) Whether the call returned an error\n"
+            "    \"ms\": x.xxx,             (numeric) The time it took to execute, in milliseconds\n"
+            "    \"lockwaitms\": x.xxx,     (numeric) Of that, the time waiting for locks other threads held\n"
+            "    \"indexscans\": n,         (numeric) Address, spent, timestamp and balance index reads\n"
+            "    \"indexrows\": n,          (numeric) The entries those reads returned\n"
+            "    \"indexscanms\": x.xxx,    (numeric) The time spent in those reads, lock waits in them included\n"
+            "    \"txreads\": n,            (numeric) Transactions looked up on disk, rather than in the mempool\n"
+            "    \"txreadms\": x.xxx,       (numeric) The time spent in those lookups\n"
+            "    \"otherms\": x.xxx         (numeric) The rest, mostly computation and building the result\n"
+            "  }\n"
+            "  ,...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getslowrpccalls", "")
+            + HelpExampleRpc("getslowrpccalls", "")
+        );
+
+    std::deque<CRPCSlowCall> calls;
+    {
+        LOCK(cs_rpcSlowCalls);
+        calls = rpcSlowCalls;
+        if (params.size() > 0 && params[0].get_bool())
+            rpcSlowCalls.clear();
+    }
+
+    UniValue ret(UniValue::VARR);
+    for (const CRPCSlowCall& call : calls) {
+        UniValue obj(UniValue::VOBJ);
+        obj.push_back(Pair("method", call.strMethod));
+        obj.push_back(Pair("params", call.strParams));
+        obj.push_back(Pair("time", call.nTime));
+        obj.push_back(Pair("error", !call.fSucceeded));
+        obj.push_back(Pair("ms", call.nMicros / 1000.0));
+        obj.push_back(Pair("lockwaitms", call.nLockWaitMicros / 1000.0));
+        obj.push_back(Pair("indexscans", call.reads.nIndexScans));
+        obj.push_back(Pair("indexrows", call.reads.nIndexRows));
+        obj.push_back(Pair("indexscanms", call.reads.nIndexScanMicros / 1000.0));
+        obj.push_back(Pair("txreads", call.reads.nTxReads));
+        obj.push_back(Pair("txreadms", call.reads.nTxReadMicros / 1000.0));
+        // index reads take their locks inside them, so their waits are in both lockwaitms and indexscanms
+        int64_t nOther = call.nMicros - std::max(call.nLockWaitMicros, call.reads.nIndexScanMicros) - call.reads.nTxReadMicros;
+        obj.push_back(Pair("otherms", std::max(nOther, (int64_t)0) / 1000.0));
+        ret.push_back(obj);
+    }
+    return ret;
+}
+
 /**
  * Call Table
  */
@@ -258,6 +727,10 @@ static const CRPCCommand vRPCCommands[] =
     /* Overall control/query calls */
     { "control",            "help",                   &help,                   true  },
     { "control",            "stop",                   &stop,                   true  },
+    { "control",            "getrpcqueueinfo",        &getrpcqueueinfo,        true  },
+    { "control",            "getrpcstats",            &getrpcstats,            true  },
+    { "control",            "getslowrpccalls",        &getslowrpccalls,        true  },
+    { "control",            "getlockstats",           &getlockstats,           true  },
 
     /* P2P networking */
     { "network",            "getnetworkinfo",         &getnetworkinfo,         true  },
@@ -281,16 +754,23 @@ static const CRPCCommand vRPCCommands[] =
     { "blockchain",         "getblock",               &getblock,               true  },
     { "blockchain",         "getblockdeltas",         &getblockdeltas,         false },
     { "blockchain",         "getblockhashes",         &getblockhashes,         true  },
+    { "blockchain",         "getblockfilter",         &getblockfilter,         true  },
+    { "blockchain",         "getblockstats",          &getblockstats,          true  },
     { "blockchain",         "getblockhash",           &getblockhash,           true  },
     { "blockchain",         "getblockheader",         &getblockheader,         true  },
     { "blockchain",         "getchaintips",           &getchaintips,           true  },
     { "blockchain",         "getdifficulty",          &getdifficulty,          true  },
+    { "blockchain",         "getindexinfo",           &getindexinfo,           true  },
+    { "blockchain",         "getdbstats",             &getdbstats,             true  },
     { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         true  },
+    { "blockchain",         "getproofcacheinfo",      &getproofcacheinfo,      true  },
     { "blockchain",         "getrawmempool",          &getrawmempool,          true  },
+    { "blockchain",         "getmempoolchanges",      &getmempoolchanges,      true  },
     { "blockchain",         "gettxout",               &gettxout,               true  },
     { "blockchain",         "gettxoutproof",          &gettxoutproof,          true  },
     { "blockchain",         "verifytxoutproof",       &verifytxoutproof,       true  },
     { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true  },
+    { "blockchain",         "dumpchainstate",         &dumpchainstate,         true  },
     { "blockchain",         "verifychain",            &verifychain,            true  },
     { "blockchain",         "getspentinfo",           &getspentinfo,           false },
     //{ "blockchain",         "paxprice",               &paxprice,               true  },
@@ -338,6 +818,7 @@ static const CRPCCommand vRPCCommands[] =
     { "rawtransactions",    "decodescript",           &decodescript,           true  },
     { "rawtransactions",    "getrawtransaction",      &getrawtransaction,      true  },
     { "rawtransactions",    "sendrawtransaction",     &sendrawtransaction,     false },
+    { "rawtransactions",    "sendrawtransactions",    &sendrawtransactions,    false },
     { "rawtransactions",    "signrawtransaction",     &signrawtransaction,     false }, /* uses wallet if enabled */
 #ifdef ENABLE_WALLET
     { "rawtransactions",    "fundrawtransaction",     &fundrawtransaction,     false },
@@ -573,26 +1054,37 @@ bool CRPCTable::appendCommand(const std::string& name, const CRPCCommand* pcmd)
     return true;
 }
 
+bool CRPCTable::appendStreamingActor(const std::string& name, rpcstreamfn_type actor)
+{
+    if (IsRPCRunning() || !mapCommands.count(name))
+        return false;
+
+    mapStreamingActors[name] = actor;
+    return true;
+}
+
+static void StartRPCBatchThreads();
+static void StopRPCBatchThreads();
+
 bool StartRPC()
 {
     LogPrint("rpc", "Starting RPC\n");
     fRPCRunning = true;
     g_rpcSignals.Started();
 
-    // Launch one async rpc worker.  The ability to launch multiple workers is not recommended at present and thus the option is disabled.
-    getAsyncRPCQueue()->addWorker();
-/*
-    int n = GetArg("-rpcasyncthreads", 1);
-    if (n<1) {
-        LogPrintf("ERROR: Invalid value %d for -rpcasyncthreads.  Must be at least 1.\n", n);
-        strerr = strprintf(_("An error occurred while setting up the Async RPC threads, invalid parameter value of %d (must be at least 1)."), n);
-        uiInterface.ThreadSafeMessageBox(strerr, "", CClientUIInterface::MSG_ERROR);
-        StartShutdown();
-        return;
-    }
+    InitRPCResultCache();
+    StartRPCBatchThreads();
+    nRPCSlowCallMicros = std::max(GetArg("-rpcslowcallms", 0), (int64_t)0) * 1000;
+
+    // z_sendmany and sendcurrency lock the inputs they select, so operations may run in parallel. each Sapling proof
+    // already uses every core, so more than one worker mainly helps when many operations are queued at once.
+    int n = GetArg("-rpcasyncthreads", DEFAULT_RPC_ASYNC_THREADS);
+    if (n <= 0)
+        n = GetNumCores();
+    n = std::max(1, std::min(n, MAX_RPC_ASYNC_THREADS));
     for (int i = 0; i < n; i++)
         getAsyncRPCQueue()->addWorker();
-*/
+    LogPrint("rpc", "Started %d async RPC workers\n", n);
     return true;
 }
 
@@ -607,6 +1099,7 @@ void StopRPC()
 {
     LogPrint("rpc", "Stopping RPC\n");
     deadlineTimers.clear();
+    StopRPCBatchThreads();
     g_rpcSignals.Stopped();
 
     // Tells async queue to cancel all operations and shutdown.
@@ -700,16 +1193,179 @@ static UniValue JSONRPCExecOne(const UniValue& req)
     return rpc_result;
 }
 
+/**
+ * Methods that only read state, so that the calls to them within a batch may run at once. Anything else is a barrier:
+ * it runs alone, after every call before it and before every call after it, so a batch still behaves as if run in order.
+ * -rpcbatchserial=<method> takes a method out of this set.
+ */
+static std::set<std::string> setParallelBatchMethods;
+
+static void InitParallelBatchMethods()
+{
+    static const char* const methods[] = {
+        "getrawtransaction", "decoderawtransaction", "decodescript", "gettxout", "getspentinfo",
+        "getblock", "getblockheader", "getblockhash", "getblockcount", "getbestblockhash", "getblockdeltas",
+        "getblockhashes", "getblockfilter", "getblockstats", "getblockchaininfo", "getdifficulty", "getinfo",
+        "getmempoolinfo", "getrawmempool", "getmempoolchanges",
+        "getaddressbalance", "getaddressutxos", "getaddressdeltas", "getaddresstxids", "getaddressmempool",
+        "getidentity", "getcurrency", "getcurrencystate", "getcurrencyconverters", "getnotarizationdata",
+        "validateaddress", "estimatefee", "estimatepriority"
+    };
+    setParallelBatchMethods.clear();
+    BOOST_FOREACH (const char* method, methods)
+        setParallelBatchMethods.insert(method);
+    BOOST_FOREACH (const std::string& method, mapMultiArgs["-rpcbatchserial"])
+        setParallelBatchMethods.erase(method);
+}
+
+static bool IsParallelBatchCall(const UniValue& req)
+{
+    if (!req.isObject())
+        return false;
+    const UniValue& method = find_value(req.get_obj(), "method");
+    return method.isStr() && setParallelBatchMethods.count(method.get_str());
+}
+
+/** A run of parallel calls of a batch, shared by the HTTP worker and the batch threads helping it */
+struct CBatchRun
+{
+    const UniValue& vReq;
+    std::vector<UniValue>& vResults;
+    size_t nEnd;
+    std::atomic<size_t> nNext;
+    boost::mutex cs;
+    boost::condition_variable cond;
+    size_t nDone;
+
+    CBatchRun(const UniValue& vReqIn, std::vector<UniValue>& vResultsIn, size_t nBegin, size_t nEndIn) :
+        vReq(vReqIn), vResults(vResultsIn), nEnd(nEndIn), nNext(nBegin), nDone(0) {}
+
+    // runs calls until there are none left
+    void Work()
+    {
+        size_t nRan = 0;
+        for (size_t i; (i = nNext++) < nEnd; nRan++)
+            vResults[i] = JSONRPCExecOne(vReq[i]);
+        if (nRan) {
+            boost::unique_lock<boost::mutex> lock(cs);
+            nDone += nRan;
+            cond.notify_all();
+        }
+    }
+};
+
+/** Bounded pool of the threads that help HTTP workers with batches */
+static class CRPCBatchPool
+{
+    boost::mutex cs;
+    boost::condition_variable cond;
+    std::deque<std::shared_ptr<CBatchRun>> queue;
+    boost::thread_group threads;
+    bool fRunning = false;
+    int nThreads = 0;
+
+    void Run()
+    {
+        while (true) {
+            std::shared_ptr<CBatchRun> run;
+            {
+                boost::unique_lock<boost::mutex> lock(cs);
+                while (fRunning && queue.empty())
+                    cond.wait(lock);
+                if (!fRunning)
+                    return;
+                run = queue.front();
+                queue.pop_front();
+            }
+            run->Work();
+        }
+    }
+
+public:
+    void Start(int n)
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        fRunning = true;
+        nThreads = n;
+        for (int i = 0; i < n; i++)
+            threads.create_thread(boost::bind(&TraceThread<boost::function<void()> >, "rpcbatch",
+                                              boost::function<void()>(boost::bind(&CRPCBatchPool::Run, this))));
+    }
+
+    void Stop()
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(cs);
+            fRunning = false;
+            queue.clear();
+            cond.notify_all();
+        }
+        threads.join_all();
+        nThreads = 0;
+    }
+
+    int Size() const { return nThreads; }
+
+    // asks up to nHelpers threads to work on a run, they find nothing left to do if the caller got there first
+    void Help(const std::shared_ptr<CBatchRun>& run, int nHelpers)
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        if (!fRunning)
+            return;
+        for (int i = 0; i < nHelpers; i++)
+            queue.push_back(run);
+        cond.notify_all();
+    }
+} batchPool;
+
+static void StartRPCBatchThreads()
+{
+    InitParallelBatchMethods();
+    batchPool.Start(std::max((int)GetArg("-rpcbatchthreads", DEFAULT_RPC_BATCH_THREADS), 0));
+}
+
+static void StopRPCBatchThreads()
+{
+    batchPool.Stop();
+}
+
 std::string JSONRPCExecBatch(const UniValue& vReq)
 {
+    std::vector<UniValue> vResults(vReq.size());
+    for (size_t reqIdx = 0; reqIdx < vReq.size(); )
+    {
+        size_t nEnd = reqIdx;
+        if (batchPool.Size() > 0)
+            while (nEnd < vReq.size() && IsParallelBatchCall(vReq[nEnd]))
+                nEnd++;
+
+        if (nEnd - reqIdx < 2)
+        {
+            vResults[reqIdx] = JSONRPCExecOne(vReq[reqIdx]);
+            reqIdx++;
+            continue;
+        }
+
+        // results go to their own slots, so the reply keeps the order of the requests
+        std::shared_ptr<CBatchRun> run = std::make_shared<CBatchRun>(vReq, vResults, reqIdx, nEnd);
+        batchPool.Help(run, std::min((int)(nEnd - reqIdx - 1), batchPool.Size()));
+        run->Work();
+        {
+            boost::unique_lock<boost::mutex> lock(run->cs);
+            while (run->nDone < nEnd - reqIdx)
+                run->cond.wait(lock);
+        }
+        reqIdx = nEnd;
+    }
+
     UniValue ret(UniValue::VARR);
-    for (size_t reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
-        ret.push_back(JSONRPCExecOne(vReq[reqIdx]));
+    for (size_t reqIdx = 0; reqIdx < vResults.size(); reqIdx++)
+        ret.push_back(vResults[reqIdx]);
 
     return ret.write() + "\n";
 }
 
-UniValue CRPCTable::execute(const std::string &strMethod, const UniValue &params) const
+const CRPCCommand* CRPCTable::prepareExecute(const std::string &strMethod, const UniValue &params) const
 {
     // Return immediately if in warmup
     {
@@ -735,11 +1391,70 @@ UniValue CRPCTable::execute(const std::string &strMethod, const UniValue &params
     LogPrint("rpcrequests", "command %s, params:\n%s\n", strMethod.c_str(), params.write(1,2).c_str());
 
     g_rpcSignals.PreCommand(*pcmd);
+    return pcmd;
+}
+
+UniValue CRPCTable::execute(const std::string &strMethod, const UniValue &params, std::string *pETag) const
+{
+    const CRPCCommand *pcmd = prepareExecute(strMethod, params);
+    CRPCCallTimer timer(strMethod, params);
+
+    CRPCCachedResult cached;
+    if (LookupRPCResult(strMethod, params, cached))
+    {
+        UniValue result;
+        result.read(cached.strResult);
+        timer.Succeeded();
+        if (pETag)
+            *pETag = cached.strETag;
+        return result;
+    }
 
     try
     {
         // Execute
-        return pcmd->actor(params, false);
+        UniValue result = pcmd->actor(params, false);
+        timer.Succeeded();
+        std::string strETag = StoreRPCResult(strMethod, params, result);
+        if (pETag)
+            *pETag = strETag;
+        return result;
+    }
+    catch (const std::exception& e)
+    {
+        throw JSONRPCError(RPC_MISC_ERROR, e.what());
+    }
+
+    g_rpcSignals.PostCommand(*pcmd);
+}
+
+bool CRPCTable::executeCached(const std::string &strMethod, const UniValue &params, CRPCCachedResult &cached) const
+{
+    prepareExecute(strMethod, params);
+    CRPCCallTimer timer(strMethod, params);
+    if (!LookupRPCResult(strMethod, params, cached))
+        return false;
+    timer.Succeeded();
+    return true;
+}
+
+rpcstreamfn_type CRPCTable::streamingActor(const std::string &strMethod) const
+{
+    std::map<std::string, rpcstreamfn_type>::const_iterator it = mapStreamingActors.find(strMethod);
+    return it == mapStreamingActors.end() ? NULL : it->second;
+}
+
+void CRPCTable::executeStreaming(const std::string &strMethod, const UniValue &params, CJSONStreamWriter &out) const
+{
+    const CRPCCommand *pcmd = prepareExecute(strMethod, params);
+    rpcstreamfn_type actor = streamingActor(strMethod);
+    assert(actor);
+    CRPCCallTimer timer(strMethod, params);
+
+    try
+    {
+        actor(params, out);
+        timer.Succeeded();
     }
     catch (const std::exception& e)
     {
@@ -8,6 +8,7 @@
 
 #include "amount.h"
 #include "rpc/protocol.h"
+#include "rpc/resultcache.h"
 #include "uint256.h"
 
 #include <list>
@@ -20,6 +21,27 @@
 
 #include <univalue.h>
 
+/** Parts of an RPC call whose latency is recorded for each method */
+enum RPCCallPhase
+{
+    RPC_PHASE_QUEUE,        //!< waiting in the HTTP work queue
+    RPC_PHASE_LOCKWAIT,     //!< waiting for locks other threads hold, mostly cs_main, while executing
+    RPC_PHASE_EXECUTE,      //!< running the method, lock waits included
+    RPC_PHASE_SERIALIZE,    //!< writing the reply
+    RPC_PHASE_COUNT
+};
+
+/** Record the latency of one phase of a call, for methods in the table */
+void RecordRPCPhase(const std::string& method, RPCCallPhase phase, int64_t nMicros);
+/** Call counts and latencies of each method, and the work queues, in the Prometheus text format */
+std::string GetRPCMetrics();
+
+/** Threads that run the read-only calls of a JSON-RPC batch alongside the HTTP worker, 0 runs batches serially */
+static const int DEFAULT_RPC_BATCH_THREADS = 4;
+/** Workers that run async operations such as z_sendmany, 0 or less starts one per core */
+static const int DEFAULT_RPC_ASYNC_THREADS = 1;
+static const int MAX_RPC_ASYNC_THREADS = 64;
+
 class AsyncRPCQueue;
 class CRPCCommand;
 
@@ -120,6 +142,13 @@ void RPCRunLater(const std::string& name, boost::function<void(void)> func, int6
 
 typedef UniValue(*rpcfn_type)(const UniValue& params, bool fHelp);
 
+class CJSONStreamWriter;
+/**
+ * A method that writes its result to a stream rather than returning it, for results too large to build in full.
+ * It should check its parameters and throw before writing anything, so that errors are still reported normally.
+ */
+typedef void(*rpcstreamfn_type)(const UniValue& params, CJSONStreamWriter& out);
+
 class CRPCCommand
 {
 public:
@@ -136,6 +165,9 @@ class CRPCTable
 {
 private:
     std::map<std::string, const CRPCCommand*> mapCommands;
+    std::map<std::string, rpcstreamfn_type> mapStreamingActors;
+
+    const CRPCCommand* prepareExecute(const std::string &method, const UniValue &params) const;
 public:
     CRPCTable();
     const CRPCCommand* operator[](const std::string& name) const;
@@ -148,7 +180,22 @@ public:
      * @returns Result of the call.
      * @throws an exception (UniValue) when an error happens.
      */
-    UniValue execute(const std::string &method, const UniValue &params) const;
+    UniValue execute(const std::string &method, const UniValue &params, std::string *pETag=nullptr) const;
+
+    /**
+     * Find the cached result of an earlier identical call, for calls bound to a height deep enough below the tip.
+     * The call is counted as if it was executed.
+     */
+    bool executeCached(const std::string &method, const UniValue &params, CRPCCachedResult &cached) const;
+
+    /** The streaming form of a method, or NULL if it only has the plain one */
+    rpcstreamfn_type streamingActor(const std::string &method) const;
+
+    /**
+     * Execute the streaming form of a method, writing its result to out.
+     * @throws an exception (UniValue) when an error happens, possibly after part of the result was written.
+     */
+    void executeStreaming(const std::string &method, const UniValue &params, CJSONStreamWriter &out) const;
 
 
     /**
@@ -157,6 +204,12 @@ public:
      * Commands cannot be overwritten (returns false).
      */
     bool appendCommand(const std::string& name, const CRPCCommand* pcmd);
+
+    /**
+     * Add a streaming form of a command that is already in the table, used for single requests over HTTP.
+     * Batches and other callers still use the plain form.
+     */
+    bool appendStreamingActor(const std::string& name, rpcstreamfn_type actor);
 };
 
 extern CRPCTable tableRPC;
@@ -179,6 +232,10 @@ extern std::string HelpRequiringPassphrase();
 extern std::string HelpExampleCli(const std::string& methodname, const std::string& args);
 extern std::string HelpExampleRpc(const std::string& methodname, const std::string& args);
 
+struct CDBLatencyStats;
+/** count, average and percentiles of a latency histogram, with its buckets if verbose. in blockchain.cpp */
+extern UniValue DBLatencyToJSON(const CDBLatencyStats &latency, bool fVerbose);
+
 extern void EnsureWalletIsUnlocked();
 
 bool StartRPC();
@@ -360,6 +417,7 @@ extern UniValue decodescript(const UniValue& params, bool fHelp);
 extern UniValue fundrawtransaction(const UniValue& params, bool fHelp);
 extern UniValue signrawtransaction(const UniValue& params, bool fHelp);
 extern UniValue sendrawtransaction(const UniValue& params, bool fHelp);
+extern UniValue sendrawtransactions(const UniValue& params, bool fHelp);
 extern UniValue gettxoutproof(const UniValue& params, bool fHelp);
 extern UniValue verifytxoutproof(const UniValue& params, bool fHelp);
 
@@ -368,13 +426,20 @@ extern UniValue getbestblockhash(const UniValue& params, bool fHelp);
 extern UniValue getdifficulty(const UniValue& params, bool fHelp);
 extern UniValue settxfee(const UniValue& params, bool fHelp);
 extern UniValue getmempoolinfo(const UniValue& params, bool fHelp);
+extern UniValue getproofcacheinfo(const UniValue& params, bool fHelp);
+extern UniValue getindexinfo(const UniValue& params, bool fHelp);
+extern UniValue getdbstats(const UniValue& params, bool fHelp);
 extern UniValue getrawmempool(const UniValue& params, bool fHelp);
+extern UniValue getmempoolchanges(const UniValue& params, bool fHelp);
 extern UniValue getblockhashes(const UniValue& params, bool fHelp);
 extern UniValue getblockdeltas(const UniValue& params, bool fHelp);
+extern UniValue getblockfilter(const UniValue& params, bool fHelp);
+extern UniValue getblockstats(const UniValue& params, bool fHelp);
 extern UniValue getblockhash(const UniValue& params, bool fHelp);
 extern UniValue getblockheader(const UniValue& params, bool fHelp);
 extern UniValue getblock(const UniValue& params, bool fHelp);
 extern UniValue gettxoutsetinfo(const UniValue& params, bool fHelp);
+extern UniValue dumpchainstate(const UniValue& params, bool fHelp);
 extern UniValue gettxout(const UniValue& params, bool fHelp);
 extern UniValue verifychain(const UniValue& params, bool fHelp);
 extern UniValue getchaintips(const UniValue& params, bool fHelp);
@@ -6,6 +6,7 @@
 
 #include "reverselock.h"
 
+#include <algorithm>
 #include <assert.h>
 #include <utility>
 
@@ -34,34 +35,55 @@ void CScheduler::serviceQueue()
                 // Wait until there is something to do.
                 newTaskScheduled.wait(lock);
             }
+            if (shouldStop())
+                continue;
 
-            // Wait until either there is a new task, or until
-            // the time of the first item on the queue:
+            // The task to run is the first due task of the highest priority
+            // whose domain is not held by a task running in another thread
+            boost::chrono::system_clock::time_point now = boost::chrono::system_clock::now();
+            auto next = taskQueue.end();
+            for (auto it = taskQueue.begin(); it != taskQueue.end() && it->first <= now; ++it) {
+                if (!it->second.options.domain.empty() && busyDomains.count(it->second.options.domain))
+                    continue;
+                if (next == taskQueue.end() || it->second.options.priority > next->second.options.priority)
+                    next = it;
+            }
 
-            // Some boost versions have a conflicting overload of wait_until that returns void.
+            // Otherwise wait until there is a new task, a domain is released,
+            // or the first task that is not due yet is. Some boost versions
+            // have a conflicting overload of wait_until that returns void.
             // Explicitly use a template here to avoid hitting that overload.
-            while (!shouldStop() && !taskQueue.empty())
-            {
-                auto copy = taskQueue.begin()->first;
-                if (newTaskScheduled.wait_until<>(lock, copy) == boost::cv_status::timeout) {
-                    break;
-                }
+            if (next == taskQueue.end()) {
+                auto firstLater = taskQueue.upper_bound(now);
+                if (firstLater == taskQueue.end())
+                    newTaskScheduled.wait(lock);
+                else
+                    newTaskScheduled.wait_until<>(lock, firstLater->first);
+                continue;
             }
 
-            // If there are multiple threads, the queue can empty while we're waiting (another
-            // thread may service the task we were waiting on).
-            if (shouldStop() || taskQueue.empty())
-                continue;
+            Task task = next->second;
+            int64_t nDelayMicros = boost::chrono::duration_cast<boost::chrono::microseconds>(now - next->first).count();
+            taskQueue.erase(next);
 
-            Function f = taskQueue.begin()->second;
-            taskQueue.erase(taskQueue.begin());
+            const std::string strName = task.options.name.empty() ? "unnamed" : task.options.name;
+            TaskStats &stats = taskStats[strName];
+            stats.nRunning++;
+            stats.nMaxDelayMicros = std::max(stats.nMaxDelayMicros, nDelayMicros);
+            if (!task.options.domain.empty())
+                busyDomains.insert(task.options.domain);
 
-            {
+            boost::chrono::steady_clock::time_point taskStart = boost::chrono::steady_clock::now();
+            try {
                 // Unlock before calling f, so it can reschedule itself or another task
                 // without deadlocking:
                 reverse_lock<boost::unique_lock<boost::mutex> > rlock(lock);
-                f();
+                task.f();
+            } catch (...) {
+                finishTask(task, strName, taskStart);
+                throw;
             }
+            finishTask(task, strName, taskStart);
         } catch (...) {
             --nThreadsServicingQueue;
             throw;
@@ -70,6 +92,23 @@ void CScheduler::serviceQueue()
     --nThreadsServicingQueue;
 }
 
+void CScheduler::finishTask(const Task &task, const std::string &strName, boost::chrono::steady_clock::time_point taskStart)
+{
+    int64_t nMicros = boost::chrono::duration_cast<boost::chrono::microseconds>(boost::chrono::steady_clock::now() - taskStart).count();
+    TaskStats &stats = taskStats[strName];
+    stats.nRunning--;
+    stats.nRuns++;
+    stats.nTotalMicros += nMicros;
+    stats.nLastMicros = nMicros;
+    stats.nMaxMicros = std::max(stats.nMaxMicros, nMicros);
+
+    // A task that was due may have been waiting for this domain
+    if (!task.options.domain.empty()) {
+        busyDomains.erase(task.options.domain);
+        newTaskScheduled.notify_all();
+    }
+}
+
 void CScheduler::stop(bool drain)
 {
     {
@@ -82,29 +121,33 @@ void CScheduler::stop(bool drain)
     newTaskScheduled.notify_all();
 }
 
-void CScheduler::schedule(CScheduler::Function f, boost::chrono::system_clock::time_point t)
+void CScheduler::schedule(CScheduler::Function f, boost::chrono::system_clock::time_point t, const TaskOptions &options)
 {
     {
         boost::unique_lock<boost::mutex> lock(newTaskMutex);
-        taskQueue.insert(std::make_pair(t, f));
+        Task task;
+        task.f = f;
+        task.options = options;
+        taskQueue.insert(std::make_pair(t, task));
     }
-    newTaskScheduled.notify_one();
+    // A thread waiting for a domain would not run the new task, so wake them all
+    newTaskScheduled.notify_all();
 }
 
-void CScheduler::scheduleFromNow(CScheduler::Function f, int64_t deltaSeconds)
+void CScheduler::scheduleFromNow(CScheduler::Function f, int64_t deltaSeconds, const TaskOptions &options)
 {
-    schedule(f, boost::chrono::system_clock::now() + boost::chrono::seconds(deltaSeconds));
+    schedule(f, boost::chrono::system_clock::now() + boost::chrono::seconds(deltaSeconds), options);
 }
 
-static void Repeat(CScheduler* s, CScheduler::Function f, int64_t deltaSeconds)
+static void Repeat(CScheduler* s, CScheduler::Function f, int64_t deltaSeconds, const CScheduler::TaskOptions &options)
 {
     f();
-    s->scheduleFromNow(boost::bind(&Repeat, s, f, deltaSeconds), deltaSeconds);
+    s->scheduleFromNow(boost::bind(&Repeat, s, f, deltaSeconds, options), deltaSeconds, options);
 }
 
-void CScheduler::scheduleEvery(CScheduler::Function f, int64_t deltaSeconds)
+void CScheduler::scheduleEvery(CScheduler::Function f, int64_t deltaSeconds, const TaskOptions &options)
 {
-    scheduleFromNow(boost::bind(&Repeat, this, f, deltaSeconds), deltaSeconds);
+    scheduleFromNow(boost::bind(&Repeat, this, f, deltaSeconds, options), deltaSeconds, options);
 }
 
 size_t CScheduler::getQueueInfo(boost::chrono::system_clock::time_point &first,
@@ -118,3 +161,10 @@ size_t CScheduler::getQueueInfo(boost::chrono::system_clock::time_point &first,
     }
     return result;
 }
+
+std::map<std::string, CScheduler::TaskStats> CScheduler::getTaskStats(int &nThreads) const
+{
+    boost::unique_lock<boost::mutex> lock(newTaskMutex);
+    nThreads = nThreadsServicingQueue;
+    return taskStats;
+}
@@ -14,6 +14,11 @@
 #include <boost/chrono/chrono.hpp>
 #include <boost/thread.hpp>
 #include <map>
+#include <set>
+#include <string>
+
+/** Number of threads servicing the scheduler queue */
+static const int DEFAULT_SCHEDULER_THREADS = 2;
 
 //
 // Simple class for background tasks that should be run
@@ -26,6 +31,10 @@
 // s->scheduleFromNow(boost::bind(Class::func, this, argument), 3);
 // boost::thread* t = new boost::thread(boost::bind(CScheduler::serviceQueue, s));
 //
+// Any number of threads can run serviceQueue. Tasks that are due run in order of priority, then time, and tasks that
+// share a serialization domain never run at the same time, so tasks that use the same state can be given a domain
+// instead of a lock that would hold up the other workers.
+//
 // ... then at program shutdown, clean up the thread running serviceQueue:
 // t->interrupt();
 // t->join();
@@ -41,18 +50,47 @@ public:
 
     typedef boost::function<void(void)> Function;
 
+    enum Priority {
+        PRIORITY_LOW = 0,
+        PRIORITY_NORMAL = 1,
+        PRIORITY_HIGH = 2
+    };
+
+    // what a task is reported as, how it is ordered among the tasks that are due, and the domain it is serialized in,
+    // if any
+    struct TaskOptions {
+        std::string name;
+        Priority priority;
+        std::string domain;
+
+        TaskOptions(const std::string &strName=std::string(), Priority nPriority=PRIORITY_NORMAL, const std::string &strDomain=std::string()) :
+            name(strName), priority(nPriority), domain(strDomain) {}
+    };
+
+    // runtimes of the tasks with one name, in microseconds. delay is how long after their time they started.
+    struct TaskStats {
+        uint64_t nRuns;
+        int64_t nTotalMicros;
+        int64_t nMaxMicros;
+        int64_t nLastMicros;
+        int64_t nMaxDelayMicros;
+        int nRunning;
+
+        TaskStats() : nRuns(0), nTotalMicros(0), nMaxMicros(0), nLastMicros(0), nMaxDelayMicros(0), nRunning(0) {}
+    };
+
     // Call func at/after time t
-    void schedule(Function f, boost::chrono::system_clock::time_point t);
+    void schedule(Function f, boost::chrono::system_clock::time_point t, const TaskOptions &options=TaskOptions());
 
     // Convenience method: call f once deltaSeconds from now
-    void scheduleFromNow(Function f, int64_t deltaSeconds);
+    void scheduleFromNow(Function f, int64_t deltaSeconds, const TaskOptions &options=TaskOptions());
 
     // Another convenience method: call f approximately
     // every deltaSeconds forever, starting deltaSeconds from now.
     // To be more precise: every time f is finished, it
     // is rescheduled to run deltaSeconds later. If you
     // need more accurate scheduling, don't use this method.
-    void scheduleEvery(Function f, int64_t deltaSeconds);
+    void scheduleEvery(Function f, int64_t deltaSeconds, const TaskOptions &options=TaskOptions());
 
     // To keep things as simple as possible, there is no unschedule.
 
@@ -70,14 +108,26 @@ public:
     size_t getQueueInfo(boost::chrono::system_clock::time_point &first,
                         boost::chrono::system_clock::time_point &last) const;
 
+    // Returns the runtimes of the tasks run so far by name, and the number
+    // of threads servicing the queue
+    std::map<std::string, TaskStats> getTaskStats(int &nThreads) const;
+
 private:
-    std::multimap<boost::chrono::system_clock::time_point, Function> taskQueue;
+    struct Task {
+        Function f;
+        TaskOptions options;
+    };
+
+    std::multimap<boost::chrono::system_clock::time_point, Task> taskQueue;
+    std::set<std::string> busyDomains;
+    std::map<std::string, TaskStats> taskStats;
     boost::condition_variable newTaskScheduled;
     mutable boost::mutex newTaskMutex;
     int nThreadsServicingQueue;
     bool stopRequested;
     bool stopWhenEmpty;
     bool shouldStop() { return stopRequested || (stopWhenEmpty && taskQueue.empty()); }
+    void finishTask(const Task &task, const std::string &strName, boost::chrono::steady_clock::time_point taskStart);
 };
 
 #endif
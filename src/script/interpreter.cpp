@@ -1349,7 +1349,7 @@ uint256 SignatureHash(
     return ss.GetHash();
 }
 
-TransactionSignatureChecker::TransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, const std::map<uint160, std::pair<int, std::vector<std::vector<unsigned char>>>> *pIdMap) : txTo(txToIn), nIn(nInIn), amount(amountIn), txdata(NULL)
+TransactionSignatureChecker::TransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, const std::map<uint160, std::pair<int, std::vector<std::vector<unsigned char>>>> *pIdMap) : txTo(txToIn), nIn(nInIn), amount(amountIn), txdata(NULL), fSighashCached(false)
 {
     if (pIdMap)
     {
@@ -1362,7 +1362,7 @@ TransactionSignatureChecker::TransactionSignatureChecker(const CTransaction* txT
     }
 }
 
-TransactionSignatureChecker::TransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, const PrecomputedTransactionData& txdataIn, const std::map<uint160, std::pair<int, std::vector<std::vector<unsigned char>>>> *pIdMap) : txTo(txToIn), nIn(nInIn), amount(amountIn), txdata(&txdataIn)
+TransactionSignatureChecker::TransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, const PrecomputedTransactionData& txdataIn, const std::map<uint160, std::pair<int, std::vector<std::vector<unsigned char>>>> *pIdMap) : txTo(txToIn), nIn(nInIn), amount(amountIn), txdata(&txdataIn), fSighashCached(false)
 {
     if (pIdMap)
     {
@@ -1434,7 +1434,13 @@ std::map<uint160, pair<int, std::vector<std::vector<unsigned char>>>> BaseSignat
     return idAddresses;
 }
 
-TransactionSignatureChecker::TransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, const CScript *pScriptPubKeyIn, const CKeyStore *pKeyStore, uint32_t spendHeight) : txTo(txToIn), nIn(nInIn), amount(amountIn), txdata(NULL), idMapSet(false)
+TransactionSignatureChecker::TransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, const CScript *pScriptPubKeyIn, const CKeyStore *pKeyStore, uint32_t spendHeight) :
+    TransactionSignatureChecker(txToIn, nInIn, amountIn, (const PrecomputedTransactionData *)NULL, pScriptPubKeyIn, pKeyStore, spendHeight) {}
+
+TransactionSignatureChecker::TransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, const PrecomputedTransactionData& txdataIn, const CScript *pScriptPubKeyIn, const CKeyStore *pKeyStore, uint32_t spendHeight) :
+    TransactionSignatureChecker(txToIn, nInIn, amountIn, &txdataIn, pScriptPubKeyIn, pKeyStore, spendHeight) {}
+
+TransactionSignatureChecker::TransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, const PrecomputedTransactionData* txdataIn, const CScript *pScriptPubKeyIn, const CKeyStore *pKeyStore, uint32_t spendHeight) : txTo(txToIn), nIn(nInIn), amount(amountIn), txdata(txdataIn), idMapSet(false), fSighashCached(false)
 {
     if (pScriptPubKeyIn && pKeyStore)
     {
@@ -1442,12 +1448,18 @@ TransactionSignatureChecker::TransactionSignatureChecker(const CTransaction* txT
     }
 }
 
-TransactionSignatureChecker::TransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, const PrecomputedTransactionData& txdataIn, const CScript *pScriptPubKeyIn, const CKeyStore *pKeyStore, uint32_t spendHeight) : txTo(txToIn), nIn(nInIn), amount(amountIn), txdata(NULL), idMapSet(false)
+uint256 TransactionSignatureChecker::GetSignatureHash(const CScript& scriptCode, int nHashType, uint32_t consensusBranchId) const
 {
-    if (pScriptPubKeyIn && pKeyStore)
+    if (fSighashCached && sighashType == nHashType && sighashBranchId == consensusBranchId && sighashScriptCode == scriptCode)
     {
-        SetIDMap(ExtractIDMap(*pScriptPubKeyIn, *pKeyStore, spendHeight, true));
+        return sighashCached;
     }
+    sighashCached = SignatureHash(scriptCode, *txTo, nIn, nHashType, amount, consensusBranchId, this->txdata);
+    sighashScriptCode = scriptCode;
+    sighashType = nHashType;
+    sighashBranchId = consensusBranchId;
+    fSighashCached = true;
+    return sighashCached;
 }
 
 bool TransactionSignatureChecker::VerifySignature(
@@ -1475,7 +1487,7 @@ bool TransactionSignatureChecker::CheckSig(
 
     uint256 sighash;
     try {
-        sighash = SignatureHash(scriptCode, *txTo, nIn, nHashType, amount, consensusBranchId, this->txdata);
+        sighash = GetSignatureHash(scriptCode, nHashType, consensusBranchId);
     } catch (logic_error ex) {
         return false;
     }
@@ -1765,7 +1777,7 @@ int TransactionSignatureChecker::CheckCryptoCondition(
 
     uint256 sighash;
     try {
-        sighash = SignatureHash(signScript, *txTo, nIn, nHashType, amount, consensusBranchId, this->txdata);
+        sighash = GetSignatureHash(signScript, nHashType, consensusBranchId);
     } catch (logic_error ex) {
         cc_free(cond);
         return 0;
@@ -1776,11 +1788,18 @@ int TransactionSignatureChecker::CheckCryptoCondition(
         return ((TransactionSignatureChecker*)checker)->CheckEvalCondition(cond, fulfilled);
     };
 
+    // eval conditions are always checked, but signatures that were already verified for this fulfillment are not
+    bool sigsVerified = IsVerifiedFulfillment(condBinary, ffillBin, sighash);
+
     //fprintf(stderr,"non-checker path\n");
     out = cc_verify(cond, (const unsigned char*)&sighash, 32, 0,
-                    condBinary.data(), condBinary.size(), eval, (void*)this, true);
+                    condBinary.data(), condBinary.size(), eval, (void*)this, !sigsVerified);
 
     //fprintf(stderr,"out.%d from cc_verify\n",(int32_t)out);
+    if (out == 1 && !sigsVerified)
+    {
+        SetVerifiedFulfillment(condBinary, ffillBin, sighash);
+    }
     cc_free(cond);
     return out;
 }
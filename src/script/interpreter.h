@@ -168,6 +168,14 @@ protected:
     std::map<uint160, std::pair<int, std::vector<std::vector<unsigned char>>>> idMap;
     bool idMapSet;
 
+    // the last signature hash computed for this input, since the signatures of all keys and conditions of an input
+    // nearly always sign the same script code with the same hash type
+    mutable bool fSighashCached;
+    mutable CScript sighashScriptCode;
+    mutable int sighashType;
+    mutable uint32_t sighashBranchId;
+    mutable uint256 sighashCached;
+
     virtual bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const;
 
 public:
@@ -175,6 +183,11 @@ public:
     TransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, const PrecomputedTransactionData& txdataIn, const std::map<uint160, std::pair<int, std::vector<std::vector<unsigned char>>>> *pIdMap);
     TransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, const CScript *pScriptPubKeyIn=nullptr, const CKeyStore *pKeyStore=nullptr, uint32_t spendHeight=INT32_MAX);
     TransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, const PrecomputedTransactionData& txdataIn, const CScript *pScriptPubKeyIn=nullptr, const CKeyStore *pKeyStore=nullptr, uint32_t spendHeight=INT32_MAX);
+    TransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, const PrecomputedTransactionData* txdataIn, const CScript *pScriptPubKeyIn, const CKeyStore *pKeyStore, uint32_t spendHeight);
+
+    // SignatureHash for this input, with the transaction's precomputed data if it has any, and cached for the next call
+    uint256 GetSignatureHash(const CScript& scriptCode, int nHashType, uint32_t consensusBranchId) const;
+
     bool CheckSig(const std::vector<unsigned char>& scriptSig, const std::vector<unsigned char>& vchPubKey, const CScript& scriptCode, uint32_t consensusBranchId) const;
     bool CheckLockTime(const CScriptNum& nLockTime) const;
     void SetIDMap(const std::map<uint160, std::pair<int, std::vector<std::vector<unsigned char>>>> &map)
@@ -193,6 +206,13 @@ public:
         const CScript& scriptCode,
         uint32_t consensusBranchId) const;
     virtual int CheckEvalCondition(const CC *cond, int fulfilled) const;
+
+    // signatures of a fulfillment of this condition that are known to be valid for sighash need not be verified again
+    virtual bool IsVerifiedFulfillment(const std::vector<unsigned char>& condBin, const std::vector<unsigned char>& ffillBin, const uint256& sighash) const
+    {
+        return false;
+    }
+    virtual void SetVerifiedFulfillment(const std::vector<unsigned char>& condBin, const std::vector<unsigned char>& ffillBin, const uint256& sighash) const {}
 };
 
 class MutableTransactionSignatureChecker : public TransactionSignatureChecker
@@ -685,7 +685,6 @@ bool CScript::IsInstantSpendOrUnspendable() const
 
 bool CScript::IsPayToCryptoCondition(COptCCParams &ccParams, bool doSizeCheck) const
 {
-    CScript subScript;
     std::vector<std::vector<unsigned char>> vParams;
 
     if (!size() || (doSizeCheck && size() > MAX_SCRIPT_SIZE))
@@ -693,14 +692,14 @@ bool CScript::IsPayToCryptoCondition(COptCCParams &ccParams, bool doSizeCheck) c
         return false;
     }
 
-    if (IsPayToCryptoCondition(&subScript, vParams))
+    if (IsPayToCryptoCondition((CScript *)NULL, vParams))
     {
         if (!vParams.empty())
         {
             ccParams = COptCCParams(vParams[0]);
             for (int i = 1; i < vParams.size(); i++)
             {
-                ccParams.vData.push_back(vParams[i]);
+                ccParams.vData.push_back(std::move(vParams[i]));
             }
         }
         else
@@ -714,6 +713,211 @@ bool CScript::IsPayToCryptoCondition(COptCCParams &ccParams, bool doSizeCheck) c
     return false;
 }
 
+// same as CScript::GetOp2, except that it returns where the pushed data is in the script rather than copying it
+static bool GetOpSpan(const unsigned char *&pc, const unsigned char *pend, opcodetype &opcodeRet, const unsigned char *&pData, unsigned int &nSize)
+{
+    opcodeRet = OP_INVALIDOPCODE;
+    pData = pc;
+    nSize = 0;
+    if (pend - pc < 1)
+        return false;
+    unsigned int opcode = *pc++;
+
+    if (opcode <= OP_PUSHDATA4)
+    {
+        if (opcode < OP_PUSHDATA1)
+        {
+            nSize = opcode;
+        }
+        else if (opcode == OP_PUSHDATA1)
+        {
+            if (pend - pc < 1)
+                return false;
+            nSize = *pc++;
+        }
+        else if (opcode == OP_PUSHDATA2)
+        {
+            if (pend - pc < 2)
+                return false;
+            nSize = ReadLE16(pc);
+            pc += 2;
+        }
+        else if (opcode == OP_PUSHDATA4)
+        {
+            if (pend - pc < 4)
+                return false;
+            nSize = ReadLE32(pc);
+            pc += 4;
+        }
+        if ((size_t)(pend - pc) < nSize)
+        {
+            nSize = 0;
+            return false;
+        }
+        pData = pc;
+        pc += nSize;
+    }
+
+    opcodeRet = (opcodetype)opcode;
+    return true;
+}
+
+// the pushes of OP_0 to OP_16 are read as one byte of their value, which is not in the script
+static const unsigned char smallIntPushes[17] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16};
+
+// one push of a parameter list, as CScript::GetBalancedData and COptCCParams read them, false if it is not a push
+static bool GetPushSpan(opcodetype opcode, const unsigned char *pData, unsigned int nSize, std::vector<COptCCParamsView::CDataSpan> &vSpans)
+{
+    if (opcode == OP_0)
+    {
+        vSpans.push_back(COptCCParamsView::CDataSpan(smallIntPushes, smallIntPushes + 1));
+    }
+    else if (opcode >= OP_1 && opcode <= OP_16)
+    {
+        int value = (opcode - OP_1) + 1;
+        vSpans.push_back(COptCCParamsView::CDataSpan(smallIntPushes + value, smallIntPushes + value + 1));
+    }
+    else if (opcode > 0 && opcode <= OP_PUSHDATA4 && nSize > 0)
+    {
+        vSpans.push_back(COptCCParamsView::CDataSpan(pData, pData + nSize));
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+COptCCParamsView::COptCCParamsView(const CScript &script, bool doSizeCheck) : version(0), evalCode(0), m(0), n(0), fIsCC(false)
+{
+    if (!script.size() || (doSizeCheck && script.size() > MAX_SCRIPT_SIZE))
+    {
+        return;
+    }
+
+    // the same layout as CScript::IsPayToCryptoCondition(CScript *, std::vector<std::vector<unsigned char>> &)
+    const unsigned char *pc = &script[0];
+    const unsigned char *pend = pc + script.size();
+    const unsigned char *pCondition, *pData;
+    unsigned int nConditionSize, nSize;
+    opcodetype opcode;
+
+    if (!GetOpSpan(pc, pend, opcode, pCondition, nConditionSize) ||
+        !(opcode > OP_0 && opcode < OP_PUSHDATA1) ||
+        !GetOpSpan(pc, pend, opcode, pData, nSize) ||
+        opcode != OP_CHECKCRYPTOCONDITION)
+    {
+        return;
+    }
+
+    std::vector<CDataSpan> vParams;
+    int netPushes = 0;
+    while (pc < pend)
+    {
+        if (!GetOpSpan(pc, pend, opcode, pData, nSize))
+        {
+            return;
+        }
+        if (opcode == OP_DROP)
+        {
+            if (--netPushes < 0)
+            {
+                return;
+            }
+        }
+        else
+        {
+            netPushes++;
+            if (!GetPushSpan(opcode, pData, nSize, vParams))
+            {
+                return;
+            }
+        }
+    }
+    if (netPushes != 0)
+    {
+        return;
+    }
+
+    fIsCC = true;
+    vParams.push_back(CDataSpan(pCondition, pCondition + nConditionSize));
+    ParseParams(vParams[0]);
+    vData.insert(vData.end(), vParams.begin() + 1, vParams.end());
+}
+
+// same checks as COptCCParams(const std::vector<unsigned char> &)
+void COptCCParamsView::ParseParams(const CDataSpan &params)
+{
+    if (params.size() <= 1)
+    {
+        return;
+    }
+
+    const unsigned char *pc = params.pBegin;
+    std::vector<CDataSpan> data;
+    const unsigned char *pData;
+    unsigned int nSize;
+    opcodetype opcode;
+
+    while (pc < params.pEnd)
+    {
+        if (GetOpSpan(pc, params.pEnd, opcode, pData, nSize) && !GetPushSpan(opcode, pData, nSize, data))
+        {
+            return;
+        }
+    }
+    if (pc != params.pEnd || !data.size() || data[0].size() != 4)
+    {
+        return;
+    }
+
+    version = data[0].pBegin[0];
+    evalCode = data[0].pBegin[1];
+    m = data[0].pBegin[2];
+    n = data[0].pBegin[3];
+    if (version == 0 || version > COptCCParams::VERSION_V3 || m > n || ((version < COptCCParams::VERSION_V3 && n < 1) || n > 4) ||
+        (version < COptCCParams::VERSION_V3 ? data.size() <= n : data.size() < n))
+    {
+        version = 0;
+        return;
+    }
+
+    int i;
+    int limit = n == data.size() ? n : n + 1;
+    for (i = 1; i < limit; i++)
+    {
+        const CDataSpan &key = data[i];
+        bool validKey;
+        if (key.size() == 20)
+        {
+            validKey = true;
+        }
+        else if (key.size() == 33)
+        {
+            validKey = CPubKey(key.pBegin, key.pEnd).IsValid();
+        }
+        else if (version > COptCCParams::VERSION_V2 && (key.size() == 21 || key.size() == 34))
+        {
+            // an invalid public key of a typed destination is skipped, as COptCCParams skips it, not rejected
+            validKey = key.pBegin[0] == COptCCParams::ADDRTYPE_PK ? key.size() == 34 :
+                       (key.pBegin[0] == COptCCParams::ADDRTYPE_PKH ||
+                        key.pBegin[0] == COptCCParams::ADDRTYPE_SH ||
+                        key.pBegin[0] == COptCCParams::ADDRTYPE_ID ||
+                        key.pBegin[0] == COptCCParams::ADDRTYPE_INDEX) && key.size() == 21;
+        }
+        else
+        {
+            validKey = false;
+        }
+        if (!validKey)
+        {
+            version = 0;
+            return;
+        }
+    }
+    vData.insert(vData.end(), data.begin() + i, data.end());
+}
+
 bool CScript::IsPayToCryptoCondition(CScript *ccSubScript, std::vector<std::vector<unsigned char>> &vParams, COptCCParams &optParams) const
 {
     if (IsPayToCryptoCondition(ccSubScript, vParams))
@@ -439,6 +439,9 @@ CIdentity TransferDestinationToIdentity(const CTransferDestination &dest);
 CCurrencyDefinition TransferDestinationToCurrency(const CTransferDestination &dest);
 std::vector<CTransferDestination> DestinationsToTransferDestinations(const std::vector<CTxDestination> &dests);
 
+// the most a push of crypto-condition parameters and the opcode after it add to a script beyond the parameters
+static const unsigned int MAX_CC_PUSH_OVERHEAD = 6;
+
 class COptCCParams
 {
 public:
@@ -465,6 +468,8 @@ public:
 
     COptCCParams(uint8_t ver, uint8_t code, uint8_t _m, uint8_t _n, const std::vector<CTxDestination> &vkeys, const std::vector<std::vector<unsigned char>> &vdata) :
         version(ver), evalCode(code), m(_m), n(_n), vKeys(vkeys), vData(vdata) {}
+    COptCCParams(uint8_t ver, uint8_t code, uint8_t _m, uint8_t _n, const std::vector<CTxDestination> &vkeys, std::vector<std::vector<unsigned char>> &&vdata) :
+        version(ver), evalCode(code), m(_m), n(_n), vKeys(vkeys), vData(std::move(vdata)) {}
 
     COptCCParams(const std::vector<unsigned char> &vch);
 
@@ -481,6 +486,44 @@ public:
     bool IsEvalPKOut() const;
 };
 
+/**
+ * Read only view of the crypto-condition parameters of a script, which points into the script rather than copying
+ * its pushes, for reading the object of an output without first copying it out of the script several times. The
+ * script must outlive the view. For any script, version, evalCode, m, n and vData are the same as those of the
+ * COptCCParams from CScript::IsPayToCryptoCondition, and keys are only checked, not kept.
+ */
+class COptCCParamsView
+{
+public:
+    struct CDataSpan
+    {
+        const unsigned char *pBegin;
+        const unsigned char *pEnd;
+
+        CDataSpan(const unsigned char *pBeginIn, const unsigned char *pEndIn) : pBegin(pBeginIn), pEnd(pEndIn) {}
+        size_t size() const { return pEnd - pBegin; }
+        std::vector<unsigned char> AsVector() const { return std::vector<unsigned char>(pBegin, pEnd); }
+    };
+
+    uint8_t version;
+    uint8_t evalCode;
+    uint8_t m, n;
+    std::vector<CDataSpan> vData;
+
+    COptCCParamsView() : version(0), evalCode(0), m(0), n(0), fIsCC(false) {}
+    COptCCParamsView(const CScript &script, bool doSizeCheck=true);
+
+    // true if the script is a crypto-condition, whether or not its parameters are valid
+    bool IsPayToCryptoCondition() const { return fIsCC; }
+
+    // same as COptCCParams::IsValid() without strict checks
+    bool IsValid() const { return version == COptCCParams::VERSION_V1 || version == COptCCParams::VERSION_V2 || version == COptCCParams::VERSION_V3; }
+
+private:
+    bool fIsCC;
+    void ParseParams(const CDataSpan &params);
+};
+
 // This is for STAKEGUARD2, which is versioned and enables staking the reserve of a reserve currency
 // chain, where this native currency is a reserve of a native currency that is being notarized into
 // this chain.
@@ -580,6 +623,9 @@ public:
 
     CScript() { }
     CScript(const CScript& b) : CScriptBase(b.begin(), b.end()) { }
+    CScript(CScript&& b) noexcept : CScriptBase(std::move(b)) { }
+    CScript& operator=(const CScript& b) = default;
+    CScript& operator=(CScript&& b) noexcept = default;
     CScript(const_iterator pbegin, const_iterator pend) : CScriptBase(pbegin, pend) { }
     CScript(std::vector<unsigned char>::const_iterator pbegin, std::vector<unsigned char>::const_iterator pend) : CScriptBase(pbegin, pend) { }
     CScript(const unsigned char* pbegin, const unsigned char* pend) : CScriptBase(pbegin, pend) { }
@@ -8,6 +8,7 @@
 #include "script/cc.h"
 #include "cc/eval.h"
 
+#include "crypto/sha256.h"
 #include "pubkey.h"
 #include "random.h"
 #include "uint256.h"
@@ -105,6 +106,62 @@ public:
     }
 };
 
+/**
+ * Crypto-condition fulfillments whose signatures were found valid, to avoid verifying the secp256k1 and ed25519
+ * signatures of every smart transaction spend twice (once when accepted into memory pool, and again when accepted
+ * into the block chain). Eval conditions are not covered and are always checked.
+ */
+class CFulfillmentCache
+{
+private:
+    //! Entries are SHA256(nonce || signature hash || condition binary || fulfillment binary)
+    uint256 nonce;
+    std::set<uint256> setValid;
+    boost::shared_mutex cs_fulfillmentcache;
+
+public:
+    CFulfillmentCache()
+    {
+        GetRandBytes(nonce.begin(), 32);
+    }
+
+    uint256 ComputeEntry(const uint256 &hash, const std::vector<unsigned char> &condBin, const std::vector<unsigned char> &ffillBin)
+    {
+        uint256 entry;
+        CSHA256().Write(nonce.begin(), 32).Write(hash.begin(), 32).Write(condBin.data(), condBin.size()).Write(ffillBin.data(), ffillBin.size()).Finalize(entry.begin());
+        return entry;
+    }
+
+    bool Get(const uint256 &entry)
+    {
+        boost::shared_lock<boost::shared_mutex> lock(cs_fulfillmentcache);
+        return setValid.count(entry) != 0;
+    }
+
+    void Set(const uint256 &entry)
+    {
+        // nearly all PBaaS, identity and reserve transactions are smart transactions, so this shares the
+        // size limit of the signature cache
+        int64_t nMaxCacheSize = GetArg("-maxservercheckersize", 50000);
+        if (nMaxCacheSize <= 0) return;
+
+        boost::unique_lock<boost::shared_mutex> lock(cs_fulfillmentcache);
+
+        while (static_cast<int64_t>(setValid.size()) > nMaxCacheSize)
+        {
+            // evict a random entry
+            std::set<uint256>::iterator it = setValid.lower_bound(GetRandHash());
+            if (it == setValid.end())
+                it = setValid.begin();
+            setValid.erase(it);
+        }
+
+        setValid.insert(entry);
+    }
+};
+
+CFulfillmentCache fulfillmentCache;
+
 }
 
 // uses blockchain lookup
@@ -224,6 +281,17 @@ bool ServerTransactionSignatureChecker::VerifySignature(const std::vector<unsign
     return true;
 }
 
+bool ServerTransactionSignatureChecker::IsVerifiedFulfillment(const std::vector<unsigned char>& condBin, const std::vector<unsigned char>& ffillBin, const uint256& sighash) const
+{
+    return fulfillmentCache.Get(fulfillmentCache.ComputeEntry(sighash, condBin, ffillBin));
+}
+
+void ServerTransactionSignatureChecker::SetVerifiedFulfillment(const std::vector<unsigned char>& condBin, const std::vector<unsigned char>& ffillBin, const uint256& sighash) const
+{
+    if (store)
+        fulfillmentCache.Set(fulfillmentCache.ComputeEntry(sighash, condBin, ffillBin));
+}
+
 /*
  * The reason that these functions are here is that the what used to be the
  * CachingTransactionSignatureChecker, now the ServerTransactionSignatureChecker,
@@ -236,5 +304,5 @@ bool ServerTransactionSignatureChecker::VerifySignature(const std::vector<unsign
 int ServerTransactionSignatureChecker::CheckEvalCondition(const CC *cond, int fulfilled) const
 {
     //fprintf(stderr,"call RunCCeval from ServerTransactionSignatureChecker::CheckEvalCondition\n");
-    return RunCCEval(cond, *txTo, nIn, fulfilled != 0);
+    return RunCCEval(cond, *txTo, nIn, fulfilled != 0, pBlockContext);
 }
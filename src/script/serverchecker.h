@@ -10,22 +10,29 @@
 
 #include <vector>
 
+class CEvalBlockContext;
 class CPubKey;
 
 class ServerTransactionSignatureChecker : public TransactionSignatureChecker
 {
 private:
     bool store;
+    const CEvalBlockContext *pBlockContext;
 
 public:
-    ServerTransactionSignatureChecker(const CTransaction* txToIn, unsigned int nIn, const CAmount& amount, bool storeIn, const PrecomputedTransactionData& txdataIn) : TransactionSignatureChecker(txToIn, nIn, amount, txdataIn), store(storeIn) { idMapSet = true; }
-    ServerTransactionSignatureChecker(const CTransaction* txToIn, unsigned int nIn, const CAmount& amount, bool storeIn) : TransactionSignatureChecker(txToIn, nIn, amount), store(storeIn) { idMapSet = true; }
+    ServerTransactionSignatureChecker(const CTransaction* txToIn, unsigned int nIn, const CAmount& amount, bool storeIn, const PrecomputedTransactionData& txdataIn) : TransactionSignatureChecker(txToIn, nIn, amount, txdataIn), store(storeIn), pBlockContext(nullptr) { idMapSet = true; }
+    ServerTransactionSignatureChecker(const CTransaction* txToIn, unsigned int nIn, const CAmount& amount, bool storeIn) : TransactionSignatureChecker(txToIn, nIn, amount), store(storeIn), pBlockContext(nullptr) { idMapSet = true; }
 
     static std::map<uint160, std::pair<int, std::vector<std::vector<unsigned char>>>> ExtractIDMap(const CScript &scriptPubKeyIn, uint32_t spendHeight, bool isStake);
     bool CanValidateIDs() const { return true; }
 
+    /** Eval conditions are checked as part of the given block, see CEvalBlockContext */
+    void SetBlockContext(const CEvalBlockContext *pBlockContextIn) { pBlockContext = pBlockContextIn; }
+
     bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const;
     int CheckEvalCondition(const CC *cond, int fulfilled) const;
+    bool IsVerifiedFulfillment(const std::vector<unsigned char>& condBin, const std::vector<unsigned char>& ffillBin, const uint256& sighash) const;
+    void SetVerifiedFulfillment(const std::vector<unsigned char>& condBin, const std::vector<unsigned char>& ffillBin, const uint256& sighash) const;
 };
 
 #endif // BITCOIN_SCRIPT_SERVERCHECKER_H
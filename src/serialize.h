@@ -20,6 +20,7 @@
 #include <stdint.h>
 #include <string>
 #include <string.h>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -43,6 +44,14 @@ static const unsigned int MAX_SIZE = 0x02000000;
 struct deserialize_type {};
 constexpr deserialize_type deserialize {};
 
+/**
+ * Types whose Unserialize sets every member are marked with this. A vector of them is unserialized into the
+ * elements it already holds, which keeps the memory those own, rather than into new ones, so reading blocks into
+ * the same CBlock one after another doesn't allocate and free each transaction, input, output and script again.
+ */
+template<typename T>
+struct is_unserialized_in_place : std::false_type {};
+
 /**
  * Used to bypass the rule against non-const reference to temporary
  * where it makes sense with wrappers such as CFlatData or CTxDB
@@ -759,10 +768,23 @@ void Unserialize_impl(Stream& is, std::vector<T, A>& v, const unsigned char&)
 template<typename Stream, typename T, typename A, typename V>
 void Unserialize_impl(Stream& is, std::vector<T, A>& v, const V&)
 {
-    v.clear();
     unsigned int nSize = ReadCompactSize(is);
     unsigned int i = 0;
     unsigned int nMid = 0;
+    if (is_unserialized_in_place<T>::value)
+    {
+        if (v.size() > nSize)
+            v.resize(nSize);
+        // growing while the held elements are read would copy them, more than that is still only added in steps
+        v.reserve(std::min(nSize, (unsigned int)(v.size() + 5000000 / sizeof(T))));
+        nMid = v.size();
+        for (; i < nMid; i++)
+            Unserialize(is, v[i]);
+    }
+    else
+    {
+        v.clear();
+    }
     while (nMid < nSize)
     {
         nMid += 5000000 / sizeof(T);
@@ -69,6 +69,68 @@ OverrideStream<S> WithVersion(S* s, int nVersion)
     return OverrideStream<S>(s, s->GetType(), nVersion);
 }
 
+/** Minimal read-only stream over a byte range that it does not own.
+ *
+ * >> reads unformatted data in place, without copying the underlying bytes into a stream buffer first.
+ * The caller must keep the range alive for the lifetime of the reader.
+ */
+class CSpanReader
+{
+private:
+    const int nType;
+    const int nVersion;
+
+    const unsigned char *pbegin;
+    const unsigned char *pcur;
+    const unsigned char *pend;
+
+public:
+    CSpanReader(const unsigned char *pbeginIn, const unsigned char *pendIn, int nTypeIn, int nVersionIn) :
+        nType(nTypeIn), nVersion(nVersionIn), pbegin(pbeginIn), pcur(pbeginIn), pend(pendIn) {}
+
+    CSpanReader(const std::vector<unsigned char> &vch, int nTypeIn, int nVersionIn) :
+        nType(nTypeIn), nVersion(nVersionIn), pbegin(vch.data()), pcur(vch.data()), pend(vch.data() + vch.size()) {}
+
+    template<typename T>
+    CSpanReader& operator>>(T& obj)
+    {
+        // Unserialize from this stream
+        ::Unserialize(*this, obj);
+        return (*this);
+    }
+
+    void read(char* pch, size_t nSize)
+    {
+        if (nSize > size())
+        {
+            throw std::ios_base::failure("CSpanReader::read(): end of data");
+        }
+        if (nSize)
+        {
+            memcpy(pch, pcur, nSize);
+        }
+        pcur += nSize;
+    }
+
+    void ignore(size_t nSize)
+    {
+        if (nSize > size())
+        {
+            throw std::ios_base::failure("CSpanReader::ignore(): end of data");
+        }
+        pcur += nSize;
+    }
+
+    const unsigned char *begin() const { return pbegin; }
+    const unsigned char *cur() const { return pcur; }
+    const unsigned char *end() const { return pend; }
+    size_t size() const { return pend - pcur; }
+    bool empty() const { return pcur == pend; }
+
+    int GetVersion() const { return nVersion; }
+    int GetType() const { return nType; }
+};
+
 /** Double ended buffer combining vector and stream-like interfaces.
  *
  * >> and << read and write unformatted data using the above serialization templates.
@@ -0,0 +1,308 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "subscriptionindex.h"
+
+#include "main.h"
+#include "pbaas/identity.h"
+#include "pbaas/pbaas.h"
+#include "pbaas/reserves.h"
+#include "random.h"
+#include "rpc/server.h"
+#include "txmempool.h"
+#include "util.h"
+#include "utiltime.h"
+
+#include <boost/thread/thread_time.hpp>
+
+CSubscriptionIndex* pSubscriptionIndex = NULL;
+
+// mempool transactions whose spent keys are remembered for when they are confirmed
+static const size_t MAX_PENDING_INPUT_KEYS = 50000;
+
+void GetSubscriptionKeys(const CTxOut& out, std::set<uint160>& keys)
+{
+    COptCCParams p;
+    if (!out.scriptPubKey.IsPayToCryptoCondition(p))
+    {
+        if (out.scriptPubKey.GetType() != CScript::UNKNOWN)
+            keys.insert(out.scriptPubKey.AddressHash());
+        return;
+    }
+
+    for (auto& dest : p.IsValid() ? p.GetDestinations() : out.scriptPubKey.GetDestinations())
+    {
+        if (dest.which() != COptCCParams::ADDRTYPE_INVALID)
+            keys.insert(GetDestinationID(dest));
+    }
+    if (!p.IsValid())
+        return;
+
+    switch (p.evalCode)
+    {
+        case EVAL_IDENTITY_PRIMARY:
+        {
+            CIdentity identity(out.scriptPubKey);
+            if (identity.IsValid())
+                keys.insert(identity.GetID());
+            break;
+        }
+        case EVAL_CURRENCY_DEFINITION:
+        {
+            CCurrencyDefinition currencyDef(out.scriptPubKey);
+            if (currencyDef.IsValid())
+                keys.insert(currencyDef.GetID());
+            break;
+        }
+        case EVAL_EARNEDNOTARIZATION:
+        case EVAL_ACCEPTEDNOTARIZATION:
+        {
+            CPBaaSNotarization notarization(out.scriptPubKey);
+            if (notarization.IsValid())
+                keys.insert(notarization.currencyID);
+            break;
+        }
+        case EVAL_CROSSCHAIN_IMPORT:
+        {
+            CCrossChainImport cci(out.scriptPubKey);
+            if (cci.IsValid())
+                keys.insert(cci.importCurrencyID);
+            break;
+        }
+        case EVAL_CROSSCHAIN_EXPORT:
+        {
+            CCrossChainExport ccx(out.scriptPubKey);
+            if (ccx.IsValid())
+                keys.insert(ccx.destCurrencyID);
+            break;
+        }
+    }
+
+    for (auto& oneCurrency : out.scriptPubKey.ReserveOutValue().valueMap)
+        keys.insert(oneCurrency.first);
+}
+
+CSubscriptionIndex::CSubscriptionIndex(unsigned int nMaxSubscriptionsIn, unsigned int nMaxQueueIn, int64_t nTimeoutIn) :
+    nMaxSubscriptions(nMaxSubscriptionsIn), nMaxQueue(nMaxQueueIn), nTimeout(nTimeoutIn), fInterrupted(false)
+{
+}
+
+uint256 CSubscriptionIndex::Subscribe(const std::set<uint160>& keys, bool fBlocks)
+{
+    boost::unique_lock<boost::mutex> lock(cs);
+    ExpireSubscriptions();
+    if (mapSubscriptions.size() >= nMaxSubscriptions)
+        return uint256();
+
+    uint256 id = GetRandHash();
+    CSubscription& subscription = mapSubscriptions[id];
+    subscription.keys = keys;
+    subscription.fBlocks = fBlocks;
+    subscription.nSequence = 0;
+    subscription.fOverflowed = false;
+    subscription.nLastPoll = GetTime();
+    subscription.nWaiting = 0;
+
+    for (auto& key : keys)
+        mapKeySubscribers[key].insert(id);
+    if (fBlocks)
+        setBlockSubscribers.insert(id);
+    return id;
+}
+
+bool CSubscriptionIndex::Unsubscribe(const uint256& id)
+{
+    boost::unique_lock<boost::mutex> lock(cs);
+    return RemoveSubscription(id);
+}
+
+bool CSubscriptionIndex::RemoveSubscription(const uint256& id)
+{
+    auto it = mapSubscriptions.find(id);
+    if (it == mapSubscriptions.end())
+        return false;
+
+    for (auto& key : it->second.keys)
+    {
+        auto keyIt = mapKeySubscribers.find(key);
+        keyIt->second.erase(id);
+        if (keyIt->second.empty())
+            mapKeySubscribers.erase(keyIt);
+    }
+    setBlockSubscribers.erase(id);
+    mapSubscriptions.erase(it);
+
+    // a poll waiting on this subscription returns that it is gone
+    cvEvents.notify_all();
+    return true;
+}
+
+void CSubscriptionIndex::ExpireSubscriptions()
+{
+    int64_t nExpired = GetTime() - nTimeout;
+    std::vector<uint256> vExpired;
+    for (auto& entry : mapSubscriptions)
+    {
+        if (!entry.second.nWaiting && entry.second.nLastPoll < nExpired)
+            vExpired.push_back(entry.first);
+    }
+    for (auto& id : vExpired)
+    {
+        LogPrint("rpc", "%s: dropping subscription %s, not polled for %d seconds\n", __func__, id.GetHex(), nTimeout);
+        RemoveSubscription(id);
+    }
+}
+
+bool CSubscriptionIndex::WaitForEvents(const uint256& id, uint64_t nAcknowledged, int nWaitSeconds,
+                                       std::vector<CSubscriptionEvent>& events, bool& fOverflowed)
+{
+    boost::unique_lock<boost::mutex> lock(cs);
+    auto it = mapSubscriptions.find(id);
+    if (it == mapSubscriptions.end())
+        return false;
+
+    std::deque<CSubscriptionEvent>& queue = it->second.events;
+    while (!queue.empty() && queue.front().nSequence <= nAcknowledged)
+        queue.pop_front();
+
+    boost::system_time deadline = boost::get_system_time() + boost::posix_time::seconds(nWaitSeconds);
+    it->second.nWaiting++;
+    while (it->second.events.empty() && !fInterrupted && IsRPCRunning())
+    {
+        if (!cvEvents.timed_wait(lock, deadline))
+            break;
+        // the subscription may have been removed while waiting
+        if ((it = mapSubscriptions.find(id)) == mapSubscriptions.end())
+            return false;
+    }
+    it->second.nWaiting--;
+    it->second.nLastPoll = GetTime();
+
+    size_t nEvents = std::min(it->second.events.size(), (size_t)MAX_SUBSCRIPTION_REPLY_EVENTS);
+    events.assign(it->second.events.begin(), it->second.events.begin() + nEvents);
+    fOverflowed = it->second.fOverflowed;
+    it->second.fOverflowed = false;
+    return true;
+}
+
+size_t CSubscriptionIndex::Size()
+{
+    boost::unique_lock<boost::mutex> lock(cs);
+    return mapSubscriptions.size();
+}
+
+void CSubscriptionIndex::Interrupt()
+{
+    boost::unique_lock<boost::mutex> lock(cs);
+    fInterrupted = true;
+    cvEvents.notify_all();
+}
+
+void CSubscriptionIndex::AddEvent(CSubscription& subscription, CSubscriptionEvent event)
+{
+    if (subscription.events.size() >= nMaxQueue)
+    {
+        subscription.events.pop_front();
+        subscription.fOverflowed = true;
+    }
+    event.nSequence = ++subscription.nSequence;
+    subscription.events.push_back(event);
+}
+
+void CSubscriptionIndex::SyncTransaction(const CTransaction &tx, const CBlock *pblock)
+{
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        if (mapKeySubscribers.empty())
+            return;
+    }
+
+    uint256 txid = tx.GetHash();
+    std::set<uint160> keys;
+    for (auto& out : tx.vout)
+        GetSubscriptionKeys(out, keys);
+
+    // the outputs a transaction spends are only in the coins view before it is confirmed, so the keys found then
+    // are kept for when it is
+    std::set<uint160> inputKeys;
+    int nHeight = -1;
+    if (!pblock)
+    {
+        if (!tx.IsCoinBase())
+        {
+            LOCK2(cs_main, mempool.cs);
+            CCoinsViewMemPool view(pcoinsTip, mempool);
+            for (auto& in : tx.vin)
+            {
+                CCoins coins;
+                if (view.GetCoins(in.prevout.hash, coins) && coins.IsAvailable(in.prevout.n))
+                    GetSubscriptionKeys(coins.vout[in.prevout.n], inputKeys);
+            }
+        }
+    }
+    else
+    {
+        LOCK(cs_main);
+        nHeight = chainActive.Height();
+    }
+
+    boost::unique_lock<boost::mutex> lock(cs);
+    if (!pblock)
+    {
+        if (mapPendingInputKeys.size() >= MAX_PENDING_INPUT_KEYS)
+            mapPendingInputKeys.erase(mapPendingInputKeys.begin());
+        if (!inputKeys.empty())
+            mapPendingInputKeys[txid] = std::vector<uint160>(inputKeys.begin(), inputKeys.end());
+    }
+    else
+    {
+        auto pendingIt = mapPendingInputKeys.find(txid);
+        if (pendingIt != mapPendingInputKeys.end())
+        {
+            inputKeys.insert(pendingIt->second.begin(), pendingIt->second.end());
+            mapPendingInputKeys.erase(pendingIt);
+        }
+    }
+    keys.insert(inputKeys.begin(), inputKeys.end());
+
+    std::map<uint256, std::vector<uint160>> matches;
+    for (auto& key : keys)
+    {
+        auto keyIt = mapKeySubscribers.find(key);
+        if (keyIt == mapKeySubscribers.end())
+            continue;
+        for (auto& id : keyIt->second)
+            matches[id].push_back(key);
+    }
+    if (matches.empty())
+        return;
+
+    for (auto& match : matches)
+    {
+        CSubscriptionEvent event;
+        event.type = pblock ? SUBSCRIPTION_EVENT_CONFIRMED : SUBSCRIPTION_EVENT_MEMPOOL;
+        event.hash = txid;
+        if (pblock)
+            event.blockHash = pblock->GetHash();
+        event.nHeight = nHeight;
+        event.vMatched = match.second;
+        AddEvent(mapSubscriptions[match.first], event);
+    }
+    cvEvents.notify_all();
+}
+
+void CSubscriptionIndex::ChainTip(const CBlockIndex *pindex, const CBlock *pblock, SproutMerkleTree sproutTree, SaplingMerkleTree saplingTree, bool added)
+{
+    boost::unique_lock<boost::mutex> lock(cs);
+    if (setBlockSubscribers.empty())
+        return;
+
+    CSubscriptionEvent event;
+    event.type = added ? SUBSCRIPTION_EVENT_BLOCK_CONNECTED : SUBSCRIPTION_EVENT_BLOCK_DISCONNECTED;
+    event.hash = pindex->GetBlockHash();
+    event.nHeight = pindex->GetHeight();
+    for (auto& id : setBlockSubscribers)
+        AddEvent(mapSubscriptions[id], event);
+    cvEvents.notify_all();
+}
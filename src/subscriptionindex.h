@@ -0,0 +1,122 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_SUBSCRIPTIONINDEX_H
+#define BITCOIN_SUBSCRIPTIONINDEX_H
+
+#include "sync.h"
+#include "uint256.h"
+#include "validationinterface.h"
+
+#include <deque>
+#include <map>
+#include <set>
+#include <vector>
+
+class CTxOut;
+
+/** Subscriptions kept at once, 0 disables them */
+static const unsigned int DEFAULT_MAX_SUBSCRIPTIONS = 1000;
+/** Addresses, identities, currencies and VDXF keys one subscription may name */
+static const unsigned int MAX_SUBSCRIPTION_KEYS = 10000;
+/** Events kept for a subscription until they are acknowledged, older ones are dropped past this */
+static const unsigned int DEFAULT_SUBSCRIPTION_QUEUE = 10000;
+/** Seconds a subscription is kept without being polled */
+static const int64_t DEFAULT_SUBSCRIPTION_TIMEOUT = 300;
+/** Longest a poll of a subscription may wait for events, in seconds */
+static const int MAX_SUBSCRIPTION_WAIT = 60;
+/** Most events returned by one poll */
+static const unsigned int MAX_SUBSCRIPTION_REPLY_EVENTS = 1000;
+
+enum SubscriptionEventType
+{
+    SUBSCRIPTION_EVENT_MEMPOOL,             // a matching transaction entered, or returned to, the mempool
+    SUBSCRIPTION_EVENT_CONFIRMED,           // a matching transaction was connected in a block
+    SUBSCRIPTION_EVENT_BLOCK_CONNECTED,
+    SUBSCRIPTION_EVENT_BLOCK_DISCONNECTED
+};
+
+struct CSubscriptionEvent
+{
+    uint64_t nSequence;
+    SubscriptionEventType type;
+    uint256 hash;                           // txid, or the block hash of a block event
+    uint256 blockHash;                      // block of a confirmed transaction
+    int nHeight;                            // -1 for mempool events
+    std::vector<uint160> vMatched;          // subscribed keys the transaction matched
+
+    CSubscriptionEvent() : nSequence(0), type(SUBSCRIPTION_EVENT_MEMPOOL), nHeight(-1) {}
+};
+
+/**
+ * Pushes chain and mempool events to subscribers, so that clients tracking many addresses, identities, currencies or
+ * VDXF keys wait for what changes rather than polling for it. Transactions are matched through an index from every
+ * subscribed key to its subscriptions, so the cost of a transaction is its number of keys, not the number of
+ * subscriptions.
+ */
+class CSubscriptionIndex : public CValidationInterface
+{
+public:
+    CSubscriptionIndex(unsigned int nMaxSubscriptionsIn, unsigned int nMaxQueueIn, int64_t nTimeoutIn);
+
+    /** Returns the ID of a new subscription, or null if there are already as many as allowed */
+    uint256 Subscribe(const std::set<uint160>& keys, bool fBlocks);
+    bool Unsubscribe(const uint256& id);
+
+    /**
+     * Drops the events of a subscription up to nAcknowledged, then waits up to nWaitSeconds for any after it.
+     * fOverflowed is set if events were dropped before being acknowledged since the last poll.
+     */
+    bool WaitForEvents(const uint256& id, uint64_t nAcknowledged, int nWaitSeconds,
+                       std::vector<CSubscriptionEvent>& events, bool& fOverflowed);
+
+    size_t Size();
+
+    /** Wakes all waiting polls, which then return at once */
+    void Interrupt();
+
+protected:
+    // CValidationInterface
+    void SyncTransaction(const CTransaction &tx, const CBlock *pblock);
+    void ChainTip(const CBlockIndex *pindex, const CBlock *pblock, SproutMerkleTree sproutTree, SaplingMerkleTree saplingTree, bool added);
+
+private:
+    struct CSubscription
+    {
+        std::set<uint160> keys;
+        bool fBlocks;
+        uint64_t nSequence;
+        bool fOverflowed;
+        int64_t nLastPoll;
+        int nWaiting;
+        std::deque<CSubscriptionEvent> events;
+    };
+
+    // these are called with cs held
+    bool RemoveSubscription(const uint256& id);
+    void AddEvent(CSubscription& subscription, CSubscriptionEvent event);
+    void ExpireSubscriptions();
+
+    const unsigned int nMaxSubscriptions;
+    const unsigned int nMaxQueue;
+    const int64_t nTimeout;
+
+    CWaitableCriticalSection cs;
+    CConditionVariable cvEvents;
+    bool fInterrupted;
+    std::map<uint256, CSubscription> mapSubscriptions;
+    std::map<uint160, std::set<uint256>> mapKeySubscribers;
+    std::set<uint256> setBlockSubscribers;
+
+    // keys of the outputs spent by mempool transactions, which are gone from the coins view once they are confirmed
+    std::map<uint256, std::vector<uint160>> mapPendingInputKeys;
+};
+
+/** Every key an output can be subscribed to by: its destinations and index keys, the identity, currency or system it
+ *  defines or updates, and the currencies it holds */
+void GetSubscriptionKeys(const CTxOut& out, std::set<uint160>& keys);
+
+extern CSubscriptionIndex* pSubscriptionIndex;
+
+#endif // BITCOIN_SUBSCRIPTIONINDEX_H
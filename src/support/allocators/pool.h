@@ -0,0 +1,223 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_SUPPORT_ALLOCATORS_POOL_H
+#define BITCOIN_SUPPORT_ALLOCATORS_POOL_H
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+ * A memory resource for node based containers with many small allocations of the same few sizes, such as the
+ * nodes of the coins cache maps. Memory is carved out of large chunks, and freed blocks go onto a free list for
+ * their size, so there is no per allocation malloc overhead and nodes of one map lie close together.
+ *
+ * Allocations larger than MAX_BLOCK_SIZE_BYTES or with a stricter alignment than ALIGN_BYTES, such as bucket
+ * arrays, go to ::operator new. Chunks are only returned when the resource is destroyed, so owners that shrink
+ * drastically, like a coins cache after a flush, should recreate it.
+ *
+ * Not thread safe.
+ */
+template <std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES>
+class PoolResource final
+{
+    static_assert(ALIGN_BYTES > 0, "ALIGN_BYTES must be nonzero");
+    static_assert((ALIGN_BYTES & (ALIGN_BYTES - 1)) == 0, "ALIGN_BYTES must be a power of two");
+
+    // a freed block, linked into the free list of its size
+    struct ListNode
+    {
+        ListNode *m_next;
+        explicit ListNode(ListNode *next) : m_next(next) {}
+    };
+    static_assert(std::is_trivially_destructible<ListNode>::value, "make sure we don't need to manually call a destructor");
+
+    // every block is a multiple of this size, and large and aligned enough to hold a ListNode once freed
+    static constexpr std::size_t ELEM_ALIGN_BYTES = std::max(alignof(ListNode), ALIGN_BYTES);
+    static_assert((ELEM_ALIGN_BYTES & (ELEM_ALIGN_BYTES - 1)) == 0, "ELEM_ALIGN_BYTES must be a power of two");
+    static_assert(sizeof(ListNode) <= ELEM_ALIGN_BYTES, "units of size ELEM_SIZE_ALIGN need to be able to store a ListNode");
+    static_assert((MAX_BLOCK_SIZE_BYTES & (ELEM_ALIGN_BYTES - 1)) == 0, "MAX_BLOCK_SIZE_BYTES needs to be a multiple of the alignment");
+
+    const std::size_t m_chunk_size_bytes;
+
+    // all chunks ever allocated, freed in the destructor
+    std::list<std::byte *> m_allocated_chunks{};
+
+    // one free list for each block size, in units of ELEM_ALIGN_BYTES
+    std::array<ListNode *, MAX_BLOCK_SIZE_BYTES / ELEM_ALIGN_BYTES + 1> m_free_lists{};
+
+    // the unused remainder of the newest chunk
+    std::byte *m_available_memory_it = nullptr;
+    std::byte *m_available_memory_end = nullptr;
+
+    static constexpr std::size_t NumElemAlignBytes(std::size_t bytes)
+    {
+        return (bytes + ELEM_ALIGN_BYTES - 1) / ELEM_ALIGN_BYTES + (bytes == 0);
+    }
+
+    static constexpr bool IsFreeListUsable(std::size_t bytes, std::size_t alignment)
+    {
+        return alignment <= ELEM_ALIGN_BYTES && bytes <= MAX_BLOCK_SIZE_BYTES;
+    }
+
+    void PlacementAddToList(void *p, ListNode *&node)
+    {
+        node = new (p) ListNode{node};
+    }
+
+    // put the remainder of the current chunk on the free lists, then start a new chunk
+    void AllocateChunk()
+    {
+        if (m_available_memory_end != m_available_memory_it)
+        {
+            const std::size_t remaining_available_bytes = m_available_memory_end - m_available_memory_it;
+            PlacementAddToList(m_available_memory_it, m_free_lists[remaining_available_bytes / ELEM_ALIGN_BYTES]);
+        }
+
+        void *storage = ::operator new(m_chunk_size_bytes, std::align_val_t{ELEM_ALIGN_BYTES});
+        m_available_memory_it = new (storage) std::byte[m_chunk_size_bytes];
+        m_available_memory_end = m_available_memory_it + m_chunk_size_bytes;
+        m_allocated_chunks.emplace_back(m_available_memory_it);
+    }
+
+public:
+    explicit PoolResource(std::size_t chunk_size_bytes)
+        : m_chunk_size_bytes(NumElemAlignBytes(chunk_size_bytes) * ELEM_ALIGN_BYTES)
+    {
+        assert(m_chunk_size_bytes >= MAX_BLOCK_SIZE_BYTES);
+        AllocateChunk();
+    }
+
+    PoolResource() : PoolResource(262144) {}
+
+    PoolResource(const PoolResource &) = delete;
+    PoolResource &operator=(const PoolResource &) = delete;
+    PoolResource(PoolResource &&) = delete;
+    PoolResource &operator=(PoolResource &&) = delete;
+
+    ~PoolResource()
+    {
+        for (std::byte *chunk : m_allocated_chunks)
+        {
+            ::operator delete ((void *)chunk, std::align_val_t{ELEM_ALIGN_BYTES});
+        }
+    }
+
+    void *Allocate(std::size_t bytes, std::size_t alignment)
+    {
+        if (IsFreeListUsable(bytes, alignment))
+        {
+            const std::size_t num_alignments = NumElemAlignBytes(bytes);
+            if (m_free_lists[num_alignments] != nullptr)
+            {
+                // reuse a freed block of this size
+                ListNode *node = m_free_lists[num_alignments];
+                m_free_lists[num_alignments] = node->m_next;
+                return node;
+            }
+
+            const std::size_t round_bytes = num_alignments * ELEM_ALIGN_BYTES;
+            if (round_bytes > (std::size_t)(m_available_memory_end - m_available_memory_it))
+            {
+                AllocateChunk();
+            }
+            void *p = m_available_memory_it;
+            m_available_memory_it += round_bytes;
+            return p;
+        }
+
+        return ::operator new (bytes, std::align_val_t{alignment});
+    }
+
+    void Deallocate(void *p, std::size_t bytes, std::size_t alignment) noexcept
+    {
+        if (IsFreeListUsable(bytes, alignment))
+        {
+            PlacementAddToList(p, m_free_lists[NumElemAlignBytes(bytes)]);
+        }
+        else
+        {
+            ::operator delete (p, std::align_val_t{alignment});
+        }
+    }
+
+    std::size_t NumAllocatedChunks() const
+    {
+        return m_allocated_chunks.size();
+    }
+
+    size_t ChunkSizeBytes() const
+    {
+        return m_chunk_size_bytes;
+    }
+};
+
+/**
+ * Allocator that gets its memory from a PoolResource, which must outlive every container using it.
+ */
+template <class T, std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES = alignof(T)>
+class PoolAllocator
+{
+    PoolResource<MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES> *m_resource;
+
+    template <typename U, std::size_t M, std::size_t A>
+    friend class PoolAllocator;
+
+public:
+    using value_type = T;
+    using ResourceType = PoolResource<MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>;
+
+    PoolAllocator(ResourceType *resource) noexcept : m_resource(resource) {}
+
+    PoolAllocator(const PoolAllocator &other) noexcept = default;
+    PoolAllocator &operator=(const PoolAllocator &other) noexcept = default;
+
+    template <class U>
+    PoolAllocator(const PoolAllocator<U, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES> &other) noexcept : m_resource(other.resource()) {}
+
+    // containers rebind the allocator to their node and bucket types, which all share the resource
+    template <typename U>
+    struct rebind
+    {
+        using other = PoolAllocator<U, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>;
+    };
+
+    T *allocate(size_t n)
+    {
+        return static_cast<T *>(m_resource->Allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T *p, size_t n) noexcept
+    {
+        m_resource->Deallocate(p, n * sizeof(T), alignof(T));
+    }
+
+    ResourceType *resource() const noexcept
+    {
+        return m_resource;
+    }
+};
+
+template <class T1, class T2, std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES>
+bool operator==(const PoolAllocator<T1, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES> &a,
+                const PoolAllocator<T2, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES> &b) noexcept
+{
+    return a.resource() == b.resource();
+}
+
+template <class T1, class T2, std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES>
+bool operator!=(const PoolAllocator<T1, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES> &a,
+                const PoolAllocator<T2, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES> &b) noexcept
+{
+    return !(a == b);
+}
+
+#endif // BITCOIN_SUPPORT_ALLOCATORS_POOL_H
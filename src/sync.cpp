@@ -12,6 +12,95 @@
 #include <boost/foreach.hpp>
 #include <boost/thread.hpp>
 
+static thread_local int64_t nThreadLockWaitMicros = 0;
+
+int64_t GetThreadLockWaitMicros()
+{
+    return nThreadLockWaitMicros;
+}
+
+void AddThreadLockWait(int64_t nMicros)
+{
+    nThreadLockWaitMicros += nMicros;
+}
+
+// sites are only ever added, to the front, so the list can be read while other threads add to it
+static std::atomic<CLockSite*> pLockSites(nullptr);
+
+static std::atomic<int> nLockHoldSampleInterval(DEFAULT_LOCK_HOLD_SAMPLE_INTERVAL);
+static thread_local uint32_t nThreadLockAcquisitions = 0;
+
+static void UpdateMax(std::atomic<uint64_t> &nMax, uint64_t nValue)
+{
+    uint64_t nPrior = nMax.load(std::memory_order_relaxed);
+    while (nValue > nPrior && !nMax.compare_exchange_weak(nPrior, nValue, std::memory_order_relaxed))
+        ;
+}
+
+CLockSite::CLockSite(const char *pszNameIn, const char *pszFileIn, int nLineIn) :
+    pszName(pszNameIn), pszFile(pszFileIn), nLine(nLineIn), nContentions(0), nWaitMicros(0), nMaxWaitMicros(0),
+    nSampledHolds(0), nHoldMicros(0), nMaxHoldMicros(0), pNext(pLockSites.load())
+{
+    while (!pLockSites.compare_exchange_weak(pNext, this))
+        ;
+}
+
+void CLockSite::AddWait(int64_t nMicros)
+{
+    uint64_t nWait = std::max(nMicros, (int64_t)0);
+    nContentions.fetch_add(1, std::memory_order_relaxed);
+    nWaitMicros.fetch_add(nWait, std::memory_order_relaxed);
+    UpdateMax(nMaxWaitMicros, nWait);
+}
+
+void CLockSite::AddHold(int64_t nMicros)
+{
+    uint64_t nHold = std::max(nMicros, (int64_t)0);
+    nSampledHolds.fetch_add(1, std::memory_order_relaxed);
+    nHoldMicros.fetch_add(nHold, std::memory_order_relaxed);
+    UpdateMax(nMaxHoldMicros, nHold);
+}
+
+void SetLockHoldSampleInterval(int nInterval)
+{
+    nLockHoldSampleInterval = std::max(nInterval, 0);
+}
+
+int GetLockHoldSampleInterval()
+{
+    return nLockHoldSampleInterval;
+}
+
+bool SampleLockHold()
+{
+    int nInterval = nLockHoldSampleInterval.load(std::memory_order_relaxed);
+    return nInterval && ++nThreadLockAcquisitions % nInterval == 0;
+}
+
+std::vector<CLockSiteStats> GetLockSiteStats()
+{
+    std::vector<CLockSiteStats> ret;
+    for (const CLockSite *pSite = pLockSites.load(); pSite; pSite = pSite->pNext)
+    {
+        ret.push_back({pSite->pszName, pSite->pszFile, pSite->nLine, pSite->nContentions, pSite->nWaitMicros,
+                       pSite->nMaxWaitMicros, pSite->nSampledHolds, pSite->nHoldMicros, pSite->nMaxHoldMicros});
+    }
+    return ret;
+}
+
+void ResetLockSiteStats()
+{
+    for (CLockSite *pSite = pLockSites.load(); pSite; pSite = pSite->pNext)
+    {
+        pSite->nContentions = 0;
+        pSite->nWaitMicros = 0;
+        pSite->nMaxWaitMicros = 0;
+        pSite->nSampledHolds = 0;
+        pSite->nHoldMicros = 0;
+        pSite->nMaxHoldMicros = 0;
+    }
+}
+
 #ifdef DEBUG_LOCKCONTENTION
 void PrintLockContention(const char* pszName, const char* pszFile, int nLine)
 {
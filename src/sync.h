@@ -7,6 +7,11 @@
 #define BITCOIN_SYNC_H
 
 #include "threadsafety.h"
+#include "utiltime.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
 
 #undef __cpuid
 #include <boost/thread/condition_variable.hpp>
@@ -100,24 +105,86 @@ void static inline AssertLockHeldInternal(const char* pszName, const char* pszFi
 void PrintLockContention(const char* pszName, const char* pszFile, int nLine);
 #endif
 
+/** Microseconds this thread has spent waiting for locks held by other threads, for attributing lock waits to RPC calls */
+int64_t GetThreadLockWaitMicros();
+void AddThreadLockWait(int64_t nMicros);
+
+/**
+ * Contention counters of one place in the source that takes a lock, for all of the locks it takes. Each is a static
+ * at its LOCK, created the first time that runs and never destroyed, so counting needs no lookup. Waits are only timed
+ * when the lock is contended, and hold times are timed for one in every -lockholdsample acquisitions.
+ */
+class CLockSite
+{
+public:
+    const char *pszName;
+    const char *pszFile;
+    int nLine;
+    std::atomic<uint64_t> nContentions;
+    std::atomic<uint64_t> nWaitMicros;
+    std::atomic<uint64_t> nMaxWaitMicros;
+    std::atomic<uint64_t> nSampledHolds;
+    std::atomic<uint64_t> nHoldMicros;
+    std::atomic<uint64_t> nMaxHoldMicros;
+    CLockSite *pNext;
+
+    CLockSite(const char *pszNameIn, const char *pszFileIn, int nLineIn);
+    void AddWait(int64_t nMicros);
+    void AddHold(int64_t nMicros);
+};
+
+/** A copy of the counters of one lock site */
+struct CLockSiteStats
+{
+    std::string strName;
+    std::string strFile;
+    int nLine;
+    uint64_t nContentions;
+    uint64_t nWaitMicros;
+    uint64_t nMaxWaitMicros;
+    uint64_t nSampledHolds;
+    uint64_t nHoldMicros;
+    uint64_t nMaxHoldMicros;
+};
+
+static const int DEFAULT_LOCK_HOLD_SAMPLE_INTERVAL = 64;
+
+/** Take one in nInterval acquisitions as a sample of hold times, 0 for none */
+void SetLockHoldSampleInterval(int nInterval);
+int GetLockHoldSampleInterval();
+/** Whether the calling thread's next acquisition has its hold time sampled */
+bool SampleLockHold();
+
+/** The counters of every lock site that has been reached, and clearing them */
+std::vector<CLockSiteStats> GetLockSiteStats();
+void ResetLockSiteStats();
+
 /** Wrapper around boost::unique_lock<Mutex> */
 template <typename Mutex>
 class SCOPED_LOCKABLE CMutexLock
 {
 private:
     boost::unique_lock<Mutex> lock;
+    CLockSite* pSite;
+    int64_t nHoldStart;
 
     void Enter(const char* pszName, const char* pszFile, int nLine)
     {
         EnterCritical(pszName, pszFile, nLine, (void*)(lock.mutex()));
-#ifdef DEBUG_LOCKCONTENTION
         if (!lock.try_lock()) {
+#ifdef DEBUG_LOCKCONTENTION
             PrintLockContention(pszName, pszFile, nLine);
 #endif
+            // only a contended lock is timed, so an uncontended one costs no clock reads
+            int64_t nStart = GetTimeMicros();
             lock.lock();
-#ifdef DEBUG_LOCKCONTENTION
+            int64_t nWait = GetTimeMicros() - nStart;
+            AddThreadLockWait(nWait);
+            if (pSite)
+                pSite->AddWait(nWait);
         }
-#endif
+        if (pSite && SampleLockHold())
+            nHoldStart = GetTimeMicros();
     }
 
     bool TryEnter(const char* pszName, const char* pszFile, int nLine)
@@ -126,11 +193,13 @@ private:
         lock.try_lock();
         if (!lock.owns_lock())
             LeaveCritical();
+        else if (pSite && SampleLockHold())
+            nHoldStart = GetTimeMicros();
         return lock.owns_lock();
     }
 
 public:
-    CMutexLock(Mutex& mutexIn, const char* pszName, const char* pszFile, int nLine, bool fTry = false) EXCLUSIVE_LOCK_FUNCTION(mutexIn) : lock(mutexIn, boost::defer_lock)
+    CMutexLock(Mutex& mutexIn, const char* pszName, const char* pszFile, int nLine, bool fTry = false, CLockSite* pSiteIn = nullptr) EXCLUSIVE_LOCK_FUNCTION(mutexIn) : lock(mutexIn, boost::defer_lock), pSite(pSiteIn), nHoldStart(0)
     {
         if (fTry)
             TryEnter(pszName, pszFile, nLine);
@@ -138,7 +207,7 @@ public:
             Enter(pszName, pszFile, nLine);
     }
 
-    CMutexLock(Mutex* pmutexIn, const char* pszName, const char* pszFile, int nLine, bool fTry = false) EXCLUSIVE_LOCK_FUNCTION(pmutexIn)
+    CMutexLock(Mutex* pmutexIn, const char* pszName, const char* pszFile, int nLine, bool fTry = false, CLockSite* pSiteIn = nullptr) EXCLUSIVE_LOCK_FUNCTION(pmutexIn) : pSite(pSiteIn), nHoldStart(0)
     {
         if (!pmutexIn) return;
 
@@ -151,8 +220,11 @@ public:
 
     ~CMutexLock() UNLOCK_FUNCTION()
     {
-        if (lock.owns_lock())
+        if (lock.owns_lock()) {
             LeaveCritical();
+            if (nHoldStart)
+                pSite->AddHold(GetTimeMicros() - nHoldStart);
+        }
     }
 
     operator bool()
@@ -163,9 +235,12 @@ public:
 
 typedef CMutexLock<CCriticalSection> CCriticalBlock;
 
-#define LOCK(cs) CCriticalBlock criticalblock(cs, #cs, __FILE__, __LINE__)
-#define LOCK2(cs1, cs2) CCriticalBlock criticalblock1(cs1, #cs1, __FILE__, __LINE__), criticalblock2(cs2, #cs2, __FILE__, __LINE__)
-#define TRY_LOCK(cs, name) CCriticalBlock name(cs, #cs, __FILE__, __LINE__, true)
+// the counters of the lock site where this is expanded
+#define LOCK_SITE(cs) ([]() -> CLockSite* { static CLockSite site(#cs, __FILE__, __LINE__); return &site; }())
+
+#define LOCK(cs) CCriticalBlock criticalblock(cs, #cs, __FILE__, __LINE__, false, LOCK_SITE(cs))
+#define LOCK2(cs1, cs2) CCriticalBlock criticalblock1(cs1, #cs1, __FILE__, __LINE__, false, LOCK_SITE(cs1)), criticalblock2(cs2, #cs2, __FILE__, __LINE__, false, LOCK_SITE(cs2))
+#define TRY_LOCK(cs, name) CCriticalBlock name(cs, #cs, __FILE__, __LINE__, true, LOCK_SITE(cs))
 
 #define ENTER_CRITICAL_SECTION(cs)                            \
     {                                                         \
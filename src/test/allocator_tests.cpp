@@ -4,6 +4,7 @@
 
 #include "util.h"
 
+#include "support/allocators/pool.h"
 #include "support/allocators/secure.h"
 #include "test/test_bitcoin.h"
 
@@ -117,4 +118,39 @@ BOOST_AUTO_TEST_CASE(test_LockedPageManagerBase)
     BOOST_CHECK((last_unlock_len & (test_page_size-1)) == 0); // always unlock entire pages
 }
 
+BOOST_AUTO_TEST_CASE(pool_resource)
+{
+    PoolResource<64, 8> resource(1024);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 1U);
+
+    // freed blocks are reused for allocations of the same size
+    void *a = resource.Allocate(24, 8);
+    void *b = resource.Allocate(24, 8);
+    BOOST_CHECK(a != b);
+    resource.Deallocate(a, 24, 8);
+    BOOST_CHECK(resource.Allocate(20, 8) == a);
+
+    // new chunks are only started when the current one is used up
+    for (int i = 0; i < 64; i++)
+    {
+        resource.Allocate(64, 8);
+    }
+    BOOST_CHECK(resource.NumAllocatedChunks() > 1);
+
+    // blocks too large for the pool come from the heap and do not start chunks
+    size_t nChunks = resource.NumAllocatedChunks();
+    void *large = resource.Allocate(4096, 8);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), nChunks);
+    resource.Deallocate(large, 4096, 8);
+
+    // containers share the resource through rebound allocators
+    std::map<int, int, std::less<int>, PoolAllocator<std::pair<const int, int>, 64, 8> > m(std::less<int>(), &resource);
+    for (int i = 0; i < 1000; i++)
+    {
+        m[i] = i;
+    }
+    BOOST_CHECK_EQUAL(m.size(), 1000U);
+    BOOST_CHECK_EQUAL(m[500], 500);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,113 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "blockfilter.h"
+
+#include "hash.h"
+#include "primitives/block.h"
+#include "random.h"
+#include "script/script.h"
+#include "undo.h"
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockfilter_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(gcsfilter_match)
+{
+    CGCSFilter::ElementSet included, excluded;
+    for (int i = 0; i < 100; i++)
+    {
+        CGCSFilter::Element element1(32), element2(32);
+        GetRandBytes(element1.data(), element1.size());
+        GetRandBytes(element2.data(), element2.size());
+        included.insert(element1);
+        excluded.insert(element2);
+    }
+
+    CGCSFilter filter(0, 0, included);
+    BOOST_CHECK_EQUAL(filter.GetN(), 100);
+    for (const CGCSFilter::Element &element : included)
+    {
+        BOOST_CHECK(filter.Match(element));
+    }
+    BOOST_CHECK(filter.MatchAny(included));
+
+    // false positives are possible but rare with M = 784931
+    int nFalsePositives = 0;
+    for (const CGCSFilter::Element &element : excluded)
+    {
+        nFalsePositives += filter.Match(element);
+    }
+    BOOST_CHECK(nFalsePositives < 3);
+
+    // a filter decoded from its encoding with the same keys matches the same elements
+    CGCSFilter decoded(0, 0, filter.GetEncoded());
+    BOOST_CHECK_EQUAL(decoded.GetN(), 100);
+    BOOST_CHECK(decoded.MatchAny(included));
+    BOOST_CHECK(decoded.Match(*included.rbegin()));
+}
+
+BOOST_AUTO_TEST_CASE(gcsfilter_empty)
+{
+    CGCSFilter filter;
+    BOOST_CHECK_EQUAL(filter.GetN(), 0);
+    BOOST_CHECK_EQUAL(filter.GetEncoded().size(), 1);
+    BOOST_CHECK(!filter.Match(CGCSFilter::Element(20, 1)));
+
+    CGCSFilter built(1, 2, CGCSFilter::ElementSet());
+    BOOST_CHECK(built.GetEncoded() == filter.GetEncoded());
+}
+
+BOOST_AUTO_TEST_CASE(blockfilter_elements)
+{
+    CScript paid = CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 1) << OP_EQUALVERIFY << OP_CHECKSIG;
+    CScript spent = CScript() << OP_HASH160 << std::vector<unsigned char>(20, 2) << OP_EQUAL;
+    CScript data = CScript() << OP_RETURN << std::vector<unsigned char>(8, 3);
+
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].prevout.SetNull();
+    coinbase.vout.resize(2);
+    coinbase.vout[0].scriptPubKey = paid;
+    coinbase.vout[1].scriptPubKey = data;
+
+    CMutableTransaction spend;
+    spend.vin.resize(1);
+    spend.vin[0].prevout.hash = GetRandHash();
+    spend.vout.resize(1);
+    spend.vout[0].scriptPubKey = paid;
+
+    CBlock block;
+    block.vtx.push_back(CTransaction(coinbase));
+    block.vtx.push_back(CTransaction(spend));
+    CBlockUndo blockUndo;
+    blockUndo.vtxundo.resize(1);
+    blockUndo.vtxundo[0].vprevout.push_back(CTxInUndo(CTxOut(1, spent)));
+
+    CGCSFilter::ElementSet elements = CBlockFilter::GetElements(block, blockUndo);
+    BOOST_CHECK_EQUAL(elements.size(), 2);
+    BOOST_CHECK(elements.count(CGCSFilter::Element(paid.begin(), paid.end())));
+    BOOST_CHECK(elements.count(CGCSFilter::Element(spent.begin(), spent.end())));
+    BOOST_CHECK(!elements.count(CGCSFilter::Element(data.begin(), data.end())));
+
+    CBlockFilter blockFilter(block, blockUndo);
+    BOOST_CHECK(blockFilter.GetBlockHash() == block.GetHash());
+    BOOST_CHECK(blockFilter.GetFilter().Match(CGCSFilter::Element(spent.begin(), spent.end())));
+
+    // the filter read back from its encoding hashes and chains the same way
+    CBlockFilter readBack(block.GetHash(), blockFilter.GetEncoded());
+    BOOST_CHECK(readBack.GetFilter().Match(CGCSFilter::Element(paid.begin(), paid.end())));
+    uint256 prevHeader = GetRandHash();
+    uint256 filterHash = blockFilter.GetHash();
+    BOOST_CHECK(readBack.ComputeHeader(prevHeader) == Hash(filterHash.begin(), filterHash.end(), prevHeader.begin(), prevHeader.end()));
+
+    CBlockFilterIndexEntry entry(blockFilter, prevHeader);
+    BOOST_CHECK(entry.filter == blockFilter.GetEncoded());
+    BOOST_CHECK(entry.filterHash == filterHash);
+    BOOST_CHECK(entry.header == blockFilter.ComputeHeader(prevHeader));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,132 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "cc/CCinclude.h"
+#include "cc/eval.h"
+#include "cc/utils.h"
+#include "main.h"
+#include "pbaas/pbaas.h"
+#include "pbaas/reserves.h"
+#include "random.h"
+#include "script/cc.h"
+
+#include "test/test_bitcoin.h"
+
+#include <atomic>
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+
+extern LRUCache<std::tuple<uint256, uint32_t, uint32_t, CUTXORef, uint160, uint160>, CCurrencyValueMap> priorConversionCache;
+
+BOOST_FIXTURE_TEST_SUITE(cceval_tests, TestingSetup)
+
+// the PBaaS eval codes whose validators reach the shared currency, export, transfer and conversion caches
+static const uint8_t PARALLEL_EVAL_CODES[] = { EVAL_CURRENCYSTATE, EVAL_RESERVE_DEPOSIT, EVAL_CROSSCHAIN_EXPORT,
+                                               EVAL_CROSSCHAIN_IMPORT, EVAL_IDENTITY_PRIMARY, EVAL_FINALIZE_EXPORT };
+
+// runs an eval check of each transaction for each code on nThreads threads, the way the script check threads of a
+// block run them with its context
+static std::vector<char> RunEvals(const std::vector<CTransaction> &txs, const CEvalBlockContext *pContext, int nThreads)
+{
+    size_t nCodes = sizeof(PARALLEL_EVAL_CODES);
+    std::vector<char> results(txs.size() * nCodes, 0);
+    std::atomic<size_t> next(0);
+    boost::thread_group threads;
+    for (int t = 0; t < nThreads; t++)
+    {
+        threads.create_thread([&]()
+        {
+            for (size_t i = next++; i < results.size(); i = next++)
+            {
+                uint8_t evalCode = PARALLEL_EVAL_CODES[i % nCodes];
+                CC *cond = CCNewEval(E_MARSHAL(ss << evalCode));
+                results[i] = RunCCEval(cond, txs[i / nCodes], 0, true, pContext);
+                cc_free(cond);
+            }
+        });
+    }
+    threads.join_all();
+    return results;
+}
+
+BOOST_AUTO_TEST_CASE(parallel_block_evals)
+{
+    std::vector<CTransaction> txs;
+    for (int i = 0; i < 32; i++)
+    {
+        CMutableTransaction mtx;
+        mtx.vin.resize(2);
+        mtx.vin[0].prevout = COutPoint(GetRandHash(), 0);
+        mtx.vin[1].prevout = COutPoint(GetRandHash(), 1);
+        mtx.vout.resize(sizeof(PARALLEL_EVAL_CODES));
+        for (size_t j = 0; j < mtx.vout.size(); j++)
+        {
+            CC *cond = MakeCCcond1(PARALLEL_EVAL_CODES[j], CPubKey(ParseHex("02f7e8a5fbc5bb3bb0161bc5dddd5dbc5deb5d20e1e53bd7b2b31648077aac8b3f")));
+            mtx.vout[j].scriptPubKey = CCPubKey(cond);
+            mtx.vout[j].nValue = j * COIN;
+            cc_free(cond);
+        }
+        txs.push_back(CTransaction(mtx));
+    }
+
+    // ConnectBlock holds cs_main while the checks of its block run, so a validator that took it would hang here
+    LOCK(cs_main);
+    CEvalBlockContext context(chainActive.Tip());
+    std::vector<char> serial = RunEvals(txs, nullptr, 1);
+    for (int run = 0; run < 4; run++)
+    {
+        BOOST_CHECK(RunEvals(txs, &context, 8) == serial);
+    }
+}
+
+// each cache a validator can reach from a script check thread is read and written by several at once
+BOOST_AUTO_TEST_CASE(validator_caches_concurrent)
+{
+    std::vector<uint256> hashes;
+    for (int i = 0; i < 64; i++)
+    {
+        hashes.push_back(GetRandHash());
+    }
+
+    std::atomic<int> nMismatches(0);
+    boost::thread_group threads;
+    for (int t = 0; t < 8; t++)
+    {
+        threads.create_thread([&hashes, &nMismatches, t]()
+        {
+            for (int i = 0; i < 2000; i++)
+            {
+                const uint256 &hash = hashes[(i * 7 + t) % hashes.size()];
+                uint32_t n = i % 5;
+
+                std::tuple<uint256, CInputDescriptor, CReserveTransfer> transfer;
+                if (reserveTransferCache.Get({hash, n}, transfer) && std::get<0>(transfer) != hash)
+                {
+                    nMismatches++;
+                }
+                reserveTransferCache.Put({hash, n}, std::make_tuple(hash, CInputDescriptor(), CReserveTransfer()));
+
+                std::tuple<int, CCrossChainExport, CPBaaSNotarization, std::vector<CReserveTransfer>, CCurrencyDefinition::EProofProtocol> exportInfo;
+                if (CCrossChainExport::exportInfoCache.Get(CUTXORef(hash, n), exportInfo) && std::get<0>(exportInfo) != (int)n)
+                {
+                    nMismatches++;
+                }
+                CCrossChainExport::exportInfoCache.Put(CUTXORef(hash, n), std::make_tuple((int)n, CCrossChainExport(), CPBaaSNotarization(),
+                                                       std::vector<CReserveTransfer>(), CCurrencyDefinition::PROOF_PBAASMMR));
+
+                auto conversionKey = std::make_tuple(hash, n, n + 1, CUTXORef(hash, n), uint160(), uint160());
+                CCurrencyValueMap conversion;
+                if (priorConversionCache.Get(conversionKey, conversion) && conversion.valueMap[uint160()] != (int64_t)n)
+                {
+                    nMismatches++;
+                }
+                priorConversionCache.Put(conversionKey, CCurrencyValueMap(std::vector<uint160>({uint160()}), std::vector<int64_t>({(int64_t)n})));
+            }
+        });
+    }
+    threads.join_all();
+    BOOST_CHECK_EQUAL(nMismatches.load(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
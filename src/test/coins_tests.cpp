@@ -10,6 +10,8 @@
 #include "test/test_bitcoin.h"
 #include "consensus/validation.h"
 #include "main.h"
+#include "nullifierfilter.h"
+#include "txdb.h"
 #include "undo.h"
 #include "primitives/transaction.h"
 #include "pubkey.h"
@@ -248,6 +250,26 @@ public:
     }
 };
 
+// a coins database that can check its contents while the changes of a background flush are still being written
+class CCoinsViewDBBackgroundTest : public CCoinsViewDB
+{
+public:
+    CCoinsViewDBBackgroundTest() : CCoinsViewDB(1 << 20, true) {}
+
+    // runs check with the writer unable to finish, and returns false if the write had already finished
+    template <typename CHECK>
+    bool WhilePending(CHECK check)
+    {
+        LOCK(cs_pendingWrite);
+        if (!pendingWrite)
+        {
+            return false;
+        }
+        check();
+        return true;
+    }
+};
+
 }
 
 uint256 appendRandomSproutCommitment(SproutMerkleTree &tree)
@@ -1091,4 +1113,144 @@ BOOST_AUTO_TEST_CASE(ccoins_serialization)
     }
 }
 
+BOOST_AUTO_TEST_CASE(nullifier_filter)
+{
+    std::vector<uint256> spent, unspent;
+    for (int i = 0; i < 5000; i++)
+    {
+        spent.push_back(GetRandHash());
+        unspent.push_back(GetRandHash());
+    }
+
+    // an empty filter cannot rule anything out
+    CNullifierFilter empty;
+    BOOST_CHECK(empty.MayContain(spent[0]));
+
+    CNullifierFilter filter(spent.size());
+    BOOST_CHECK_EQUAL(filter.GetCapacity(), CNullifierFilter::MIN_CAPACITY);
+    for (const uint256 &nf : spent)
+    {
+        filter.Insert(nf);
+    }
+    BOOST_CHECK_EQUAL(filter.GetCount(), spent.size());
+    BOOST_CHECK(!filter.IsFull());
+    for (const uint256 &nf : spent)
+    {
+        BOOST_CHECK(filter.MayContain(nf));
+    }
+    int nFalsePositives = 0;
+    for (const uint256 &nf : unspent)
+    {
+        nFalsePositives += filter.MayContain(nf);
+    }
+    BOOST_CHECK(nFalsePositives < 10);
+
+    // the filter read back from the database answers the same
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << filter;
+    CNullifierFilter readBack;
+    ss >> readBack;
+    BOOST_CHECK_EQUAL(readBack.GetCount(), filter.GetCount());
+    BOOST_CHECK(readBack.MayContain(spent[1234]));
+}
+
+// the coins, nullifiers and anchors of a flush written in the background read the same while it is being written,
+// as it is written, and once it is in the database
+BOOST_FIXTURE_TEST_CASE(background_flush_reads, TestingSetup)
+{
+    const int nCoins = 2000, nRounds = 10;
+    CCoinsViewDBBackgroundTest db;
+    std::vector<uint256> txids, blocks, roots;
+    for (int i = 0; i < nCoins; i++)
+    {
+        txids.push_back(GetRandHash());
+    }
+    TxWithNullifiers toggled;
+    std::vector<TxWithNullifiers> spentInRound(nRounds + 1);
+    SaplingMerkleTree tree;
+
+    // in each round every coin changes value, and a different fifth of them is spent
+    auto coinValue = [](int i, int round) { return (CAmount)(i + 1) * 100 + round; };
+    auto coinSpent = [](int i, int round) { return (i + round) % 5 == 0; };
+
+    auto checkRound = [&](int round)
+    {
+        std::vector<CCoins> many;
+        std::vector<unsigned char> found;
+        db.GetCoinsMany(txids, many, found, 2);
+        for (int i = 0; i < nCoins; i++)
+        {
+            CCoins coins;
+            bool fSpent = coinSpent(i, round);
+            BOOST_CHECK_EQUAL(db.GetCoins(txids[i], coins), !fSpent);
+            BOOST_CHECK_EQUAL(db.HaveCoins(txids[i]), !fSpent);
+            BOOST_CHECK_EQUAL(found[i], !fSpent);
+            if (!fSpent)
+            {
+                BOOST_CHECK_EQUAL(coins.vout[0].nValue, coinValue(i, round));
+                BOOST_CHECK_EQUAL(many[i].vout[0].nValue, coinValue(i, round));
+            }
+        }
+        BOOST_CHECK_EQUAL(db.GetNullifier(toggled.sproutNullifier, SPROUT), !(round & 1));
+        BOOST_CHECK_EQUAL(db.GetNullifier(toggled.saplingNullifier, SAPLING), !(round & 1));
+        BOOST_CHECK(db.GetNullifier(spentInRound[round].saplingNullifier, SAPLING));
+        SaplingMerkleTree readTree;
+        BOOST_CHECK(db.GetSaplingAnchorAt(roots[round], readTree));
+        BOOST_CHECK(readTree.root() == roots[round]);
+        BOOST_CHECK(db.GetBestAnchor(SAPLING) == roots[round]);
+        BOOST_CHECK(db.GetBestBlock() == blocks[round]);
+    };
+
+    // round 0 is written synchronously, and is what every later round changes
+    int nPending = 0;
+    for (int round = 0; round <= nRounds; round++)
+    {
+        {
+            CCoinsViewCache cache(&db);
+            for (int i = 0; i < nCoins; i++)
+            {
+                CCoinsModifier coins = cache.ModifyCoins(txids[i]);
+                if (coinSpent(i, round))
+                {
+                    coins->Clear();
+                }
+                else
+                {
+                    coins->nVersion = 1;
+                    coins->nHeight = round + 1;
+                    coins->vout.assign(1, CTxOut(coinValue(i, round), CScript() << OP_TRUE));
+                }
+            }
+            cache.SetNullifiers(toggled.tx, !(round & 1));
+            cache.SetNullifiers(spentInRound[round].tx, true);
+            tree.append(GetRandHash());
+            roots.push_back(tree.root());
+            cache.PushAnchor(tree);
+            blocks.push_back(GetRandHash());
+            cache.SetBestBlock(blocks.back());
+            BOOST_CHECK(cache.Flush());
+        }
+
+        if (db.WhilePending([&]() { checkRound(round); }))
+        {
+            nPending++;
+        }
+        checkRound(round);
+        if (!round)
+        {
+            db.SetBackgroundWrites(true);
+        }
+    }
+    BOOST_CHECK(nPending > 0);
+
+    BOOST_CHECK(db.SyncWrites());
+    BOOST_CHECK(!db.WhilePending([]() {}));
+    checkRound(nRounds);
+    for (int round = 0; round <= nRounds; round++)
+    {
+        BOOST_CHECK(db.GetNullifier(spentInRound[round].sproutNullifier, SPROUT));
+        BOOST_CHECK(db.GetSaplingAnchorAt(roots[round], tree));
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
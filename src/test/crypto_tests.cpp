@@ -8,6 +8,8 @@
 #include "crypto/sha512.h"
 #include "crypto/hmac_sha256.h"
 #include "crypto/hmac_sha512.h"
+#include "crypto/muhash.h"
+#include "hash.h"
 #include "random.h"
 #include "utilstrencodings.h"
 #include "test/test_bitcoin.h"
@@ -131,6 +133,22 @@ BOOST_AUTO_TEST_CASE(sha256_testvectors) {
     TestSHA256(test1, "a316d55510b49662420f49d145d42fb83f31ef8dc016aa4e32df049991a91e26");
 }
 
+BOOST_AUTO_TEST_CASE(sha256d64)
+{
+    // every count up to past two of the widest batches, so that each kernel and the remainder are used
+    for (int count = 0; count <= 20; count++) {
+        std::vector<unsigned char> in(64 * count), out(32 * count);
+        for (auto &c : in) {
+            c = insecure_rand();
+        }
+        SHA256D64(out.data(), in.data(), count);
+        for (int i = 0; i < count; i++) {
+            uint256 expected = Hash(in.begin() + 64 * i, in.begin() + 64 * (i + 1));
+            BOOST_CHECK(std::equal(out.begin() + 32 * i, out.begin() + 32 * (i + 1), expected.begin()));
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE(sha512_testvectors) {
     TestSHA512("",
                "cf83e1357eefb8bdf1542850d66d8007d620e4050b5715dc83f4a921d36ce9ce"
@@ -248,4 +266,44 @@ BOOST_AUTO_TEST_CASE(hmac_sha512_testvectors) {
                    "b6022cac3c4982b10d5eeb55c3e4de15134676fb6de0446065c97440fa8c6a58");
 }
 
+static MuHash3072 MuHashFromInt(unsigned char i)
+{
+    unsigned char data[32] = {i, 0};
+    MuHash3072 hash;
+    hash.Insert(data, sizeof(data));
+    return hash;
+}
+
+static uint256 MuHashFinal(const MuHash3072 &hash)
+{
+    uint256 out;
+    hash.Finalize(out.begin());
+    return out;
+}
+
+BOOST_AUTO_TEST_CASE(muhash_tests)
+{
+    MuHash3072 acc = MuHashFromInt(0);
+    acc *= MuHashFromInt(1);
+    acc /= MuHashFromInt(2);
+    BOOST_CHECK_EQUAL(MuHashFinal(acc).GetHex(), "10d312b100cbd32ada024a6646e40d3482fcff103668d2625f10002a607d5863");
+
+    // the same set built in another order, with an element added and removed again, and restored from its state
+    unsigned char data[3][32] = {{0}, {1}, {2}};
+    MuHash3072 set01 = MuHashFromInt(0), other;
+    set01 *= MuHashFromInt(1);
+    other.Insert(data[2], 32).Insert(data[1], 32).Remove(data[2], 32).Insert(data[0], 32);
+    BOOST_CHECK(MuHashFinal(other) == MuHashFinal(set01));
+
+    unsigned char num[Num3072::BYTE_SIZE], den[Num3072::BYTE_SIZE];
+    other.GetState(num, den);
+    MuHash3072 restored;
+    restored.SetState(num, den);
+    BOOST_CHECK(MuHashFinal(restored) == MuHashFinal(other));
+
+    MuHash3072 empty, emptied = MuHashFromInt(5);
+    emptied /= MuHashFromInt(5);
+    BOOST_CHECK(MuHashFinal(empty) == MuHashFinal(emptied));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
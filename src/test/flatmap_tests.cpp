@@ -0,0 +1,191 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include <map>
+#include "flatmap.h"
+#include "random.h"
+#include "uint256.h"
+
+#include "serialize.h"
+#include "streams.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(FlatmapTests, TestingSetup)
+
+template<unsigned int N, typename K, typename V>
+class flatmap_tester {
+    typedef std::map<K, V> realtype;
+    realtype real_map;
+
+    typedef flatmap<N, K, V> flattype;
+    flattype flat_map;
+
+    // the elements of std::map have a const key
+    static bool same(const typename realtype::value_type& real, const typename flattype::value_type& flat) {
+        return real.first == flat.first && real.second == flat.second;
+    }
+
+    void test() {
+        const flattype& const_flat_map = flat_map;
+        BOOST_CHECK_EQUAL(real_map.size(), flat_map.size());
+        BOOST_CHECK_EQUAL(real_map.empty(), flat_map.empty());
+        BOOST_CHECK(std::equal(real_map.begin(), real_map.end(), flat_map.begin(), same));
+        BOOST_CHECK(std::equal(real_map.begin(), real_map.end(), const_flat_map.begin(), same));
+        BOOST_CHECK(const_flat_map.end() - const_flat_map.begin() == (ptrdiff_t)real_map.size());
+        BOOST_CHECK(flattype(real_map) == flat_map);
+        flattype copied(flat_map);
+        BOOST_CHECK(copied == flat_map);
+        BOOST_CHECK(!(copied != flat_map));
+
+        CDataStream ss1(SER_DISK, 0);
+        CDataStream ss2(SER_DISK, 0);
+        ss1 << real_map;
+        ss2 << flat_map;
+        BOOST_CHECK_EQUAL(ss1.size(), ss2.size());
+        BOOST_CHECK(std::equal(ss1.begin(), ss1.end(), ss2.begin()));
+        flattype read_map;
+        ss2 >> read_map;
+        BOOST_CHECK(read_map == flat_map);
+    }
+
+public:
+    void insert(const K& key, const V& value) {
+        std::pair<typename realtype::iterator, bool> real_result = real_map.insert(std::make_pair(key, value));
+        std::pair<typename flattype::iterator, bool> flat_result = flat_map.insert(std::make_pair(key, value));
+        BOOST_CHECK_EQUAL(real_result.second, flat_result.second);
+        BOOST_CHECK(same(*real_result.first, *flat_result.first));
+        test();
+    }
+
+    void update(const K& key, const V& value) {
+        real_map[key] = value;
+        flat_map[key] = value;
+        test();
+    }
+
+    // reads through operator[], which adds the key with a default value when it is missing
+    void read(const K& key) {
+        BOOST_CHECK(real_map[key] == flat_map[key]);
+        test();
+    }
+
+    void erase(const K& key) {
+        BOOST_CHECK_EQUAL(real_map.erase(key), flat_map.erase(key));
+        test();
+    }
+
+    void erase_at(size_t position) {
+        typename realtype::iterator real_it = real_map.begin();
+        std::advance(real_it, position);
+        real_it = real_map.erase(real_it);
+        typename flattype::iterator flat_it = flat_map.erase(flat_map.begin() + position);
+        BOOST_CHECK_EQUAL(real_it == real_map.end(), flat_it == flat_map.end());
+        if (real_it != real_map.end() && flat_it != flat_map.end()) {
+            BOOST_CHECK(same(*real_it, *flat_it));
+        }
+        test();
+    }
+
+    void find(const K& key) {
+        const flattype& const_flat_map = flat_map;
+        typename realtype::iterator real_it = real_map.find(key);
+        BOOST_CHECK_EQUAL(real_it == real_map.end(), flat_map.find(key) == flat_map.end());
+        BOOST_CHECK_EQUAL(real_it == real_map.end(), const_flat_map.find(key) == const_flat_map.end());
+        if (real_it != real_map.end()) {
+            BOOST_CHECK(same(*real_it, *flat_map.find(key)));
+        }
+        BOOST_CHECK_EQUAL(real_map.count(key), flat_map.count(key));
+        BOOST_CHECK_EQUAL(std::distance(real_map.begin(), real_map.lower_bound(key)),
+                          flat_map.lower_bound(key) - flat_map.begin());
+    }
+
+    // a stream of pairs in any order and with repeated keys reads as std::map reads it, keeping the first value of
+    // each key
+    void unserialize(const std::vector<std::pair<K, V>>& items) {
+        CDataStream ss(SER_DISK, 0);
+        WriteCompactSize(ss, items.size());
+        for (const std::pair<K, V>& item : items) {
+            ss << item;
+        }
+        CDataStream ss2(ss);
+        ss >> real_map;
+        ss2 >> flat_map;
+        test();
+    }
+
+    void clear() {
+        real_map.clear();
+        flat_map.clear();
+        test();
+    }
+
+    size_t size() {
+        return real_map.size();
+    }
+};
+
+template<unsigned int N, typename K, typename V, typename RandomKey>
+static void FlatmapRandomTest(RandomKey randomKey)
+{
+    for (int j = 0; j < 64; j++) {
+        flatmap_tester<N, K, V> test;
+        for (int i = 0; i < 1024; i++) {
+            int r = insecure_rand();
+            // the map fills until inserts are mostly of keys already there, and shrinks back through N as often
+            if ((r % 4) == 0) {
+                test.insert(randomKey(), insecure_rand());
+            }
+            if (((r >> 2) % 4) == 1) {
+                test.erase(randomKey());
+            }
+            if (test.size() > 0 && ((r >> 4) % 8) == 2) {
+                test.erase_at(insecure_rand() % test.size());
+            }
+            if (((r >> 7) % 4) == 3) {
+                test.update(randomKey(), insecure_rand());
+            }
+            if (((r >> 9) % 16) == 4) {
+                test.read(randomKey());
+            }
+            if (((r >> 13) % 2) == 0) {
+                test.find(randomKey());
+            }
+            if (((r >> 15) % 32) == 6) {
+                std::vector<std::pair<K, V>> items;
+                int num = insecure_rand() % (2 * N + 3);
+                for (int k = 0; k < num; k++) {
+                    items.push_back(std::make_pair(randomKey(), (V)insecure_rand()));
+                }
+                test.unserialize(items);
+            }
+            if (((r >> 20) % 256) == 7) {
+                test.clear();
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(FlatmapTestInt)
+{
+    // few enough keys that the map regularly holds all of them, and many more than the 4 held without the heap
+    FlatmapRandomTest<4, int, int64_t>([]() { return (int)(insecure_rand() % 13); });
+    FlatmapRandomTest<1, int, int64_t>([]() { return (int)(insecure_rand() % 5); });
+}
+
+BOOST_AUTO_TEST_CASE(FlatmapTestCurrencies)
+{
+    // as the currency value maps use it
+    std::vector<uint160> currencies;
+    for (int i = 0; i < 9; i++) {
+        uint160 currency;
+        GetRandBytes(currency.begin(), currency.size());
+        currencies.push_back(currency);
+    }
+    FlatmapRandomTest<4, uint160, int64_t>([&currencies]() { return currencies[insecure_rand() % currencies.size()]; });
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -257,4 +257,21 @@ BOOST_AUTO_TEST_CASE(zs_address_test)
     }
 }
 
+BOOST_AUTO_TEST_CASE(destination_encoding_cache)
+{
+    CKeyID keyID = DecodeSecret(strSecret1C).GetPubKey().GetID();
+    std::string mainAddress = EncodeDestination(keyID);
+    BOOST_CHECK_EQUAL(EncodeDestination(keyID), mainAddress);
+    BOOST_CHECK(DecodeDestination(mainAddress) == CTxDestination(keyID));
+
+    // the same ID as another type of destination is encoded separately
+    BOOST_CHECK(EncodeDestination(CScriptID(keyID)) != mainAddress);
+    BOOST_CHECK(DecodeDestination(EncodeDestination(CIdentityID(keyID))) == CTxDestination(CIdentityID(keyID)));
+
+    SelectParams(CBaseChainParams::REGTEST);
+    BOOST_CHECK(DecodeDestination(EncodeDestination(keyID)) == CTxDestination(keyID));
+    SelectParams(CBaseChainParams::MAIN);
+    BOOST_CHECK_EQUAL(EncodeDestination(keyID), mainAddress);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -157,6 +157,48 @@ BOOST_AUTO_TEST_CASE(MempoolIndexingTest)
     BOOST_CHECK(it == pool.mapTx.get<1>().end());
 }
 
+BOOST_AUTO_TEST_CASE(MempoolSequenceChanges)
+{
+    CTxMemPool pool(CFeeRate(0));
+    TestMemPoolEntryHelper entry;
+    std::list<CTransaction> removed;
+    std::vector<uint256> added, removedHashes;
+
+    CMutableTransaction txs[3];
+    for (int i = 0; i < 3; i++)
+    {
+        txs[i].vout.resize(1);
+        txs[i].vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        txs[i].vout[0].nValue = (i + 1) * COIN;
+    }
+
+    pool.addUnchecked(txs[0].GetHash(), entry.FromTx(txs[0]));
+    uint64_t sequence = pool.GetSequence();
+    BOOST_CHECK_EQUAL(sequence, 1);
+
+    // tx1 is added, tx0 is removed, and tx2 is added and removed again, which is no change at all
+    pool.addUnchecked(txs[1].GetHash(), entry.FromTx(txs[1]));
+    pool.addUnchecked(txs[2].GetHash(), entry.FromTx(txs[2]));
+    pool.remove(txs[2], removed, false);
+    pool.remove(txs[0], removed, false);
+    BOOST_CHECK_EQUAL(pool.GetSequence(), 5);
+
+    BOOST_CHECK(pool.GetChangesSince(sequence, added, removedHashes));
+    BOOST_CHECK_EQUAL(added.size(), 1);
+    BOOST_CHECK(added[0] == txs[1].GetHash());
+    BOOST_CHECK_EQUAL(removedHashes.size(), 1);
+    BOOST_CHECK(removedHashes[0] == txs[0].GetHash());
+
+    BOOST_CHECK(pool.GetChangesSince(pool.GetSequence(), added, removedHashes));
+    BOOST_CHECK(added.empty() && removedHashes.empty());
+
+    // a sequence ahead of the pool, or before it was cleared, has to read the whole mempool again
+    BOOST_CHECK(!pool.GetChangesSince(pool.GetSequence() + 1, added, removedHashes));
+    pool.clear();
+    BOOST_CHECK(!pool.GetChangesSince(sequence, added, removedHashes));
+    BOOST_CHECK(pool.GetChangesSince(pool.GetSequence(), added, removedHashes));
+}
+
 BOOST_AUTO_TEST_CASE(RemoveWithoutBranchId) {
     CTxMemPool pool(CFeeRate(0));
     TestMemPoolEntryHelper entry;
@@ -212,6 +254,48 @@ BOOST_AUTO_TEST_CASE(RemoveWithoutBranchId) {
     BOOST_CHECK_EQUAL(pool.size(), 0);
 }
 
+BOOST_AUTO_TEST_CASE(RemoveExpiredAndWithAnchor) {
+    CTxMemPool pool(CFeeRate(0));
+    TestMemPoolEntryHelper entry;
+    uint256 anchor = GetRandHash();
+
+    // transactions expiring at heights 1 to 10, of which the even ones spend from the anchor
+    for (auto i = 1; i < 11; i++) {
+        CMutableTransaction tx = CMutableTransaction();
+        tx.vout.resize(1);
+        tx.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        tx.vout[0].nValue = i * COIN;
+        tx.nExpiryHeight = i;
+        if (i % 2 == 0) {
+            tx.vShieldedSpend.resize(1);
+            tx.vShieldedSpend[0].anchor = anchor;
+        }
+        pool.addUnchecked(tx.GetHash(), entry.FromTx(tx));
+    }
+    // and one that never expires
+    CMutableTransaction txNoExpiry = CMutableTransaction();
+    txNoExpiry.vout.resize(1);
+    txNoExpiry.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    txNoExpiry.vout[0].nValue = 100 * COIN;
+    pool.addUnchecked(txNoExpiry.GetHash(), entry.FromTx(txNoExpiry));
+    BOOST_CHECK_EQUAL(pool.size(), 11);
+
+    // a transaction expires in the blocks above its expiry height
+    pool.removeExpired(5);
+    BOOST_CHECK_EQUAL(pool.size(), 7);
+    pool.removeExpired(5);
+    BOOST_CHECK_EQUAL(pool.size(), 7);
+
+    pool.removeWithAnchor(GetRandHash(), SAPLING);
+    BOOST_CHECK_EQUAL(pool.size(), 7);
+    pool.removeWithAnchor(anchor, SAPLING);
+    BOOST_CHECK_EQUAL(pool.size(), 4);
+
+    pool.removeExpired(1000);
+    BOOST_CHECK_EQUAL(pool.size(), 1);
+    BOOST_CHECK(pool.exists(txNoExpiry.GetHash()));
+}
+
 // Test that nCheckFrequency is set correctly when calling setSanityCheck().
 // https://github.com/zcash/zcash/issues/3134
 BOOST_AUTO_TEST_CASE(SetSanityCheck) {
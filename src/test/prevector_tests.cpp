@@ -149,6 +149,13 @@ public:
         pre_vector.shrink_to_fit();
         test();
     }
+
+    void move() {
+        pretype moved(std::move(pre_vector));
+        BOOST_CHECK(pre_vector.empty());
+        pre_vector = std::move(moved);
+        test();
+    }
 };
 
 BOOST_AUTO_TEST_CASE(PrevectorTestInt)
@@ -210,6 +217,9 @@ BOOST_AUTO_TEST_CASE(PrevectorTestInt)
             if (((r >> 21) & 512) == 12) {
                 test.assign(insecure_rand() % 32, insecure_rand());
             }
+            if (((r >> 15) % 32) == 13) {
+                test.move();
+            }
         }
     }
 }
@@ -109,4 +109,58 @@ BOOST_AUTO_TEST_CASE(manythreads)
     BOOST_CHECK_EQUAL(counterSum, 200);
 }
 
+static void orderedTask(boost::mutex& mutex, std::vector<int>& order, int n)
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    order.push_back(n);
+}
+
+static void domainTask(boost::mutex& mutex, int& running, int& maxRunning)
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        maxRunning = std::max(maxRunning, ++running);
+    }
+    MicroSleep(1000);
+    boost::unique_lock<boost::mutex> lock(mutex);
+    running--;
+}
+
+BOOST_AUTO_TEST_CASE(priorities_and_domains)
+{
+    // Due tasks run highest priority first, then in time order
+    CScheduler orderedTasks;
+    boost::mutex orderMutex;
+    std::vector<int> order;
+    boost::chrono::system_clock::time_point past = boost::chrono::system_clock::now() - boost::chrono::seconds(1);
+    orderedTasks.schedule(boost::bind(&orderedTask, boost::ref(orderMutex), boost::ref(order), 3), past, CScheduler::TaskOptions("low", CScheduler::PRIORITY_LOW));
+    orderedTasks.schedule(boost::bind(&orderedTask, boost::ref(orderMutex), boost::ref(order), 1), past + boost::chrono::milliseconds(1), CScheduler::TaskOptions("high", CScheduler::PRIORITY_HIGH));
+    orderedTasks.schedule(boost::bind(&orderedTask, boost::ref(orderMutex), boost::ref(order), 2), past, CScheduler::TaskOptions("normal"));
+    orderedTasks.stop(true);
+    boost::thread orderedThread(boost::bind(&CScheduler::serviceQueue, &orderedTasks));
+    orderedThread.join();
+    BOOST_CHECK(order == std::vector<int>({1, 2, 3}));
+
+    int nThreads = -1;
+    std::map<std::string, CScheduler::TaskStats> stats = orderedTasks.getTaskStats(nThreads);
+    BOOST_CHECK_EQUAL(nThreads, 0);
+    BOOST_CHECK_EQUAL(stats.size(), 3);
+    BOOST_CHECK_EQUAL(stats["high"].nRuns, 1);
+    BOOST_CHECK_EQUAL(stats["high"].nRunning, 0);
+
+    // Tasks that share a domain never run at once, however many threads there are
+    CScheduler domainTasks;
+    boost::mutex domainMutex;
+    int running = 0, maxRunning = 0;
+    for (int i = 0; i < 10; i++)
+        domainTasks.scheduleFromNow(boost::bind(&domainTask, boost::ref(domainMutex), boost::ref(running), boost::ref(maxRunning)), 0, CScheduler::TaskOptions("domain", CScheduler::PRIORITY_NORMAL, "shared"));
+    boost::thread_group domainThreads;
+    for (int i = 0; i < 4; i++)
+        domainThreads.create_thread(boost::bind(&CScheduler::serviceQueue, &domainTasks));
+    domainTasks.stop(true);
+    domainThreads.join_all();
+    BOOST_CHECK_EQUAL(maxRunning, 1);
+    BOOST_CHECK_EQUAL(domainTasks.getTaskStats(nThreads)["domain"].nRuns, 10);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
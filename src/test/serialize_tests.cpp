@@ -417,4 +417,46 @@ BOOST_AUTO_TEST_CASE(class_methods)
     BOOST_CHECK(methodtest3 == methodtest4);
 }
 
+BOOST_AUTO_TEST_CASE(vector_in_place)
+{
+    CMutableTransaction saplingTx;
+    saplingTx.fOverwintered = true;
+    saplingTx.nVersionGroupId = SAPLING_VERSION_GROUP_ID;
+    saplingTx.nVersion = SAPLING_TX_VERSION;
+    saplingTx.nExpiryHeight = 100;
+    saplingTx.valueBalance = 5;
+    saplingTx.vin.resize(2);
+    saplingTx.vin[0].scriptSig = CScript() << std::vector<unsigned char>(100, 1);
+    saplingTx.vout.resize(3);
+    saplingTx.vout[1].scriptPubKey = CScript() << std::vector<unsigned char>(60, 2);
+    saplingTx.vShieldedOutput.resize(1);
+    saplingTx.bindingSig.fill(3);
+
+    CMutableTransaction legacyTx;
+    legacyTx.nVersion = 1;
+    legacyTx.vin.resize(1);
+    legacyTx.vout.resize(1);
+    legacyTx.vout[0].scriptPubKey = CScript() << OP_TRUE;
+
+    // fewer, smaller transactions over more that hold more
+    std::vector<CTransaction> held = {CTransaction(saplingTx), CTransaction(saplingTx)};
+    std::vector<CTransaction> legacy = {CTransaction(legacyTx)};
+    CDataStream ss(SER_DISK, PROTOCOL_VERSION);
+    ss << legacy;
+    ss >> held;
+    BOOST_CHECK_EQUAL(held.size(), 1);
+    BOOST_CHECK(held[0].GetHash() == legacy[0].GetHash());
+    BOOST_CHECK(held[0].vin == legacy[0].vin && held[0].vout == legacy[0].vout);
+    BOOST_CHECK(!held[0].fOverwintered && held[0].nVersionGroupId == 0 && held[0].nExpiryHeight == 0);
+    BOOST_CHECK(held[0].valueBalance == 0 && held[0].vShieldedOutput.empty() && held[0].bindingSig == legacy[0].bindingSig);
+
+    // and more over fewer
+    std::vector<CTransaction> sapling = {CTransaction(saplingTx), CTransaction(legacyTx), CTransaction(saplingTx)};
+    ss << sapling;
+    ss >> held;
+    BOOST_CHECK_EQUAL(held.size(), 3);
+    for (size_t i = 0; i < sapling.size(); i++)
+        BOOST_CHECK(held[i].GetHash() == sapling[i].GetHash());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -182,6 +182,61 @@ int tlsCertVerificationCallback(int preverify_ok, X509_STORE_CTX* chainContext)
      */
     return 1;
 }
+// client sessions by peer address, so that reconnecting to a peer resumes its session from a ticket instead of doing
+// a full handshake with certificate exchange and verification. tickets are single use, each resumption brings a new one
+static const size_t MAX_TLS_SESSIONS = 1000;
+static CCriticalSection cs_tlsSessions;
+static std::map<std::string, SSL_SESSION*> mapTLSSessions;
+static std::deque<std::string> vTLSSessionsOrder;
+static int nSessionKeyIndex = -1;
+
+static void tlsFreeSessionKey(void* parent, void* ptr, CRYPTO_EX_DATA* ad, int idx, long argl, void* argp)
+{
+    delete (std::string*)ptr;
+}
+
+// takes ownership of a new client session when the server sends a ticket
+static int tlsNewSessionCallback(SSL* ssl, SSL_SESSION* session)
+{
+    const std::string* pstrKey = (const std::string*)SSL_get_ex_data(ssl, nSessionKeyIndex);
+    if (!pstrKey || !SSL_SESSION_is_resumable(session))
+        return 0;
+
+    LOCK(cs_tlsSessions);
+    std::map<std::string, SSL_SESSION*>::iterator it = mapTLSSessions.find(*pstrKey);
+    if (it != mapTLSSessions.end())
+    {
+        SSL_SESSION_free(it->second);
+        it->second = session;
+        return 1;
+    }
+    while (mapTLSSessions.size() >= MAX_TLS_SESSIONS && !vTLSSessionsOrder.empty())
+    {
+        std::map<std::string, SSL_SESSION*>::iterator itOldest = mapTLSSessions.find(vTLSSessionsOrder.front());
+        if (itOldest != mapTLSSessions.end())
+        {
+            SSL_SESSION_free(itOldest->second);
+            mapTLSSessions.erase(itOldest);
+        }
+        vTLSSessionsOrder.pop_front();
+    }
+    mapTLSSessions[*pstrKey] = session;
+    vTLSSessionsOrder.push_back(*pstrKey);
+    return 1;
+}
+
+// removes the session cached for a peer, the caller owns the reference returned
+static SSL_SESSION* tlsTakeSession(const std::string& strKey)
+{
+    LOCK(cs_tlsSessions);
+    std::map<std::string, SSL_SESSION*>::iterator it = mapTLSSessions.find(strKey);
+    if (it == mapTLSSessions.end())
+        return NULL;
+    SSL_SESSION* session = it->second;
+    mapTLSSessions.erase(it);
+    vTLSSessionsOrder.erase(std::remove(vTLSSessionsOrder.begin(), vTLSSessionsOrder.end(), strKey), vTLSSessionsOrder.end());
+    return session;
+}
 /**
  * @brief Wait for a given SSL connection event.
  *
@@ -291,14 +346,8 @@ int TLSManager::waitFor(SSLConnectionRoutine eRoutine, SOCKET hSocket, SSL* ssl,
             break;
         }
 
-        fd_set socketSet;
-        FD_ZERO(&socketSet);
-        FD_SET(hSocket, &socketSet);
-
-        struct timeval timeout = {timeoutSec, 0};
-
         if (sslErr == SSL_ERROR_WANT_READ) {
-            int result = select(hSocket + 1, &socketSet, NULL, NULL, &timeout);
+            int result = WaitForSocket(hSocket, false, timeoutSec * 1000);
             if (result == 0) {
                 LogPrint("tls", "TLS: ERROR: %s: %s():%d - WANT_READ timeout on %s\n", __FILE__, __func__, __LINE__,
                     (eRoutine == SSL_CONNECT ? "SSL_CONNECT" :
@@ -313,7 +362,7 @@ int TLSManager::waitFor(SSLConnectionRoutine eRoutine, SOCKET hSocket, SSL* ssl,
                 break;
             }
         } else {
-            int result = select(hSocket + 1, NULL, &socketSet, NULL, &timeout);
+            int result = WaitForSocket(hSocket, true, timeoutSec * 1000);
             if (result == 0) {
                 LogPrint("tls", "TLS: ERROR: %s: %s():%d - WANT_WRITE timeout on %s\n", __FILE__, __func__, __LINE__,
                     (eRoutine == SSL_CONNECT ? "SSL_CONNECT" :
@@ -351,6 +400,15 @@ SSL* TLSManager::connect(SOCKET hSocket, const CAddress& addrConnect, unsigned l
 
     if ((ssl = SSL_new(tls_ctx_client))) {
         if (SSL_set_fd(ssl, hSocket)) {
+            std::string strKey = addrConnect.ToStringIPPort();
+            SSL_set_ex_data(ssl, nSessionKeyIndex, new std::string(strKey));
+            SSL_SESSION* session = tlsTakeSession(strKey);
+            if (session)
+            {
+                SSL_set_session(ssl, session);
+                SSL_SESSION_free(session);
+            }
+
             int ret = TLSManager::waitFor(SSL_CONNECT, hSocket, ssl, (DEFAULT_CONNECT_TIMEOUT / 1000), err_code);
             if (ret == 1)
             {
@@ -368,8 +426,9 @@ SSL* TLSManager::connect(SOCKET hSocket, const CAddress& addrConnect, unsigned l
 
 
     if (bConnectedTLS) {
-        LogPrintf("TLS: connection to %s has been established (tlsv = %s 0x%04x / ssl = %s 0x%x ). Using cipher: %s\n",
-            addrConnect.ToString(), SSL_get_version(ssl), SSL_version(ssl), OpenSSL_version(OPENSSL_VERSION), OpenSSL_version_num(), SSL_get_cipher(ssl));
+        LogPrintf("TLS: connection to %s has been established (tlsv = %s 0x%04x / ssl = %s 0x%x ). Using cipher: %s, session %s\n",
+            addrConnect.ToString(), SSL_get_version(ssl), SSL_version(ssl), OpenSSL_version(OPENSSL_VERSION), OpenSSL_version_num(), SSL_get_cipher(ssl),
+            SSL_session_reused(ssl) ? "resumed" : "new");
     } else {
         LogPrint("tls","TLS: %s: %s():%d - TLS connection to %s failed (err_code 0x%X)\n",
             __FILE__, __func__, __LINE__, addrConnect.ToString(), err_code);
@@ -445,6 +504,19 @@ SSL_CTX* TLSManager::initCtx(
 
             LogPrintf("TLS: %s: %s():%d - setting dh callback\n", __FILE__, __func__, __LINE__);
             SSL_CTX_set_tmp_dh_callback(tlsCtx, tmp_dh_callback);
+
+            // stateless session tickets let reconnecting peers resume, a session id context is required for that
+            // when peer certificates are requested. one ticket is enough, every resumption issues a new one
+            static const unsigned char sessionIdContext[] = "p2p";
+            SSL_CTX_set_session_id_context(tlsCtx, sessionIdContext, sizeof(sessionIdContext) - 1);
+            SSL_CTX_set_session_cache_mode(tlsCtx, SSL_SESS_CACHE_SERVER);
+            SSL_CTX_set_num_tickets(tlsCtx, 1);
+        }
+        else
+        {
+            // sessions are kept in our own cache by peer address, see tlsNewSessionCallback
+            SSL_CTX_set_session_cache_mode(tlsCtx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+            SSL_CTX_sess_set_new_cb(tlsCtx, tlsNewSessionCallback);
         }
 
         // Fix for Secure Client-Initiated Renegotiation DoS threat
@@ -531,28 +603,24 @@ bool TLSManager::prepareCredentials()
     return bPrepared;
 }
 /**
- * @brief accept a TLS connection
+ * @brief start accepting a TLS connection, the handshake is then stepped with continueHandshake
  *
- * @param hSocket the TLS socket.
+ * @param hSocket the non-blocking socket of the connection.
  * @param addr incoming address.
- * @param tls_ctx_server TLS server context.
  * @return SSL* returns pointer to the ssl object if successful, otherwise returns NULL
  */
-SSL* TLSManager::accept(SOCKET hSocket, const CAddress& addr, unsigned long& err_code)
+SSL* TLSManager::startAccept(SOCKET hSocket, const CAddress& addr, unsigned long& err_code)
 {
     LogPrint("tls", "TLS: accepting connection from %s (tid = %X)\n", addr.ToString(), pthread_self());
 
     err_code = 0;
     SSL* ssl = NULL;
-    bool bAcceptedTLS = false;
 
     if ((ssl = SSL_new(tls_ctx_server))) {
-        if (SSL_set_fd(ssl, hSocket)) {
-            int ret = TLSManager::waitFor(SSL_ACCEPT, hSocket, ssl, (DEFAULT_CONNECT_TIMEOUT / 1000), err_code);
-            if (ret == 1)
-            {
-                bAcceptedTLS = true;
-            }
+        if (!SSL_set_fd(ssl, hSocket)) {
+            err_code = ERR_get_error();
+            SSL_free(ssl);
+            ssl = NULL;
         }
     }
     else
@@ -563,26 +631,39 @@ SSL* TLSManager::accept(SOCKET hSocket, const CAddress& addr, unsigned long& err
             __FILE__, __func__, __LINE__, error_str);
     }
 
-    if (bAcceptedTLS) {
-        LogPrintf("TLS: connection from %s has been accepted (tlsv = %s 0x%04x / ssl = %s 0x%x ). Using cipher: %s\n",
-            addr.ToString(), SSL_get_version(ssl), SSL_version(ssl), OpenSSL_version(OPENSSL_VERSION), OpenSSL_version_num(), SSL_get_cipher(ssl));
-
-        STACK_OF(SSL_CIPHER) *sk = SSL_get_ciphers(ssl);
-        for (int i = 0; i < sk_SSL_CIPHER_num(sk); i++) {
-            const SSL_CIPHER *c = sk_SSL_CIPHER_value(sk, i);
-            LogPrint("tls", "TLS: supporting cipher: %s\n", SSL_CIPHER_get_name(c));
-        }
-    } else {
-        LogPrint("tls","TLS: %s: %s():%d - TLS connection from %s failed (err_code 0x%X)\n",
-            __FILE__, __func__, __LINE__, addr.ToString(), err_code);
-
-        if (ssl) {
-            SSL_free(ssl);
-            ssl = NULL;
-        }
+    return ssl;
+}
+/**
+ * @brief take one non-blocking step of a handshake, as far as the data that has arrived allows
+ *
+ * @param eRoutine SSL_ACCEPT or SSL_CONNECT.
+ * @param ssl pointer to an SSL instance.
+ * @param addr the peer address, for logging.
+ * @return int returns 1 when the handshake completed, 0 when it waits for the peer and -1 when it failed.
+ */
+int TLSManager::continueHandshake(SSLConnectionRoutine eRoutine, SSL* ssl, const CAddress& addr, unsigned long& err_code)
+{
+    err_code = 0;
+    ERR_clear_error();
+    int retOp = (eRoutine == SSL_CONNECT) ? SSL_connect(ssl) : SSL_accept(ssl);
+
+    if (retOp == 1) {
+        LogPrintf("TLS: connection %s %s has been %s (tlsv = %s 0x%04x / ssl = %s 0x%x ). Using cipher: %s, session %s\n",
+            eRoutine == SSL_CONNECT ? "to" : "from", addr.ToString(), eRoutine == SSL_CONNECT ? "established" : "accepted",
+            SSL_get_version(ssl), SSL_version(ssl), OpenSSL_version(OPENSSL_VERSION), OpenSSL_version_num(), SSL_get_cipher(ssl),
+            SSL_session_reused(ssl) ? "resumed" : "new");
+        return 1;
     }
 
-    return ssl;
+    int sslErr = SSL_get_error(ssl, retOp);
+    if (sslErr == SSL_ERROR_WANT_READ || sslErr == SSL_ERROR_WANT_WRITE)
+        return 0;
+
+    err_code = ERR_get_error();
+    const char* error_str = ERR_error_string(err_code, NULL);
+    LogPrint("tls", "TLS: %s: %s():%d - TLS connection %s %s failed, sslErr[0x%x], err_code 0x%X: %s\n",
+        __FILE__, __func__, __LINE__, eRoutine == SSL_CONNECT ? "to" : "from", addr.ToString(), sslErr, err_code, error_str);
+    return -1;
 }
 /**
  * @brief Determines whether a string exists in the non-TLS address pool.
@@ -638,9 +719,6 @@ void TLSManager::cleanNonTLSPool(std::vector<NODE_ADDR>& vPool, CCriticalSection
  */
 int TLSManager::threadSocketHandler(CNode* pnode, fd_set& fdsetRecv, fd_set& fdsetSend, fd_set& fdsetError)
 {
-    //
-    // Receive
-    //
     bool recvSet = false, sendSet = false, errorSet = false;
 
     {
@@ -654,6 +732,30 @@ int TLSManager::threadSocketHandler(CNode* pnode, fd_set& fdsetRecv, fd_set& fds
         errorSet = FD_ISSET(pnode->hSocket, &fdsetError);
     }
 
+    return threadSocketHandler(pnode, recvSet, sendSet, errorSet);
+}
+
+/**
+ * @brief Handles send and recieve functionality in TLS Sockets, once it is known which way the socket is ready.
+ *
+ * @param pnode reference to the CNode object.
+ * @param recvSet the socket is readable
+ * @param sendSet the socket is writable
+ * @param errorSet the socket has an error pending
+ * @return int returns -1 when socket is invalid. returns 0 otherwise.
+ */
+int TLSManager::threadSocketHandler(CNode* pnode, bool recvSet, bool sendSet, bool errorSet)
+{
+    //
+    // Receive
+    //
+    {
+        LOCK(pnode->cs_hSocket);
+
+        if (pnode->hSocket == INVALID_SOCKET)
+            return -1;
+    }
+
     if (recvSet || errorSet) {
         TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
         if (lockRecv) {
@@ -736,11 +838,17 @@ int TLSManager::threadSocketHandler(CNode* pnode, fd_set& fdsetRecv, fd_set& fds
                                 __FILE__, __func__, __LINE__, nRet, error_str);
 
                         } else {
+                            // with edge triggered socket events the socket is only read again once more data arrives
+                            if (nRet == SSL_ERROR_WANT_READ)
+                                pnode->fSocketReadable = false;
+
                             // preventive measure from exhausting CPU usage
                             //
                             MilliSleep(1); // 1 msec
                         }
                     } else {
+                        if (nRet == WSAEWOULDBLOCK)
+                            pnode->fSocketReadable = false;
                         if (nRet != WSAEWOULDBLOCK && nRet != WSAEMSGSIZE && nRet != WSAEINTR && nRet != WSAEINPROGRESS) {
                             if (!pnode->fDisconnect)
                                 LogPrint("tls","TSL: ERROR: socket recv %s\n", NetworkErrorString(nRet));
@@ -804,6 +912,8 @@ bool TLSManager::initialize()
     for (fs::path dir : trustedDirs)
         LogPrintf("TLS: trusted directory '%s' will be used\n", dir.string().c_str());
 
+    nSessionKeyIndex = SSL_get_ex_new_index(0, NULL, NULL, NULL, tlsFreeSessionKey);
+
     // Initialization of the server and client contexts
     //
     if ((tls_ctx_server = TLSManager::initCtx(SERVER_CONTEXT, privKeyFile, certFile, trustedDirs)))
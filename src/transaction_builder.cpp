@@ -438,6 +438,7 @@ TransactionBuilderResult TransactionBuilder::Build(bool throwTxWithPartialSig)
     // Sapling spends and outputs
     //
 
+    ZC_WaitForParams();
     auto ctx = librustzcash_sapling_proving_ctx_init();
 
     // Create Sapling SpendDescriptions
@@ -598,11 +599,12 @@ TransactionBuilderResult TransactionBuilder::Build(bool throwTxWithPartialSig)
     // Transparent signatures
     bool throwPartialSig = false;
     CTransaction txNewConst(mtx);
+    PrecomputedTransactionData txdata(txNewConst);
     for (int nIn = 0; nIn < mtx.vin.size(); nIn++) {
         auto tIn = tIns[nIn];
         SignatureData sigdata;
         bool signSuccess = ProduceSignature(
-            TransactionSignatureCreator(keystore, &txNewConst, nIn, tIn.value, tIn.scriptPubKey), tIn.scriptPubKey, sigdata, consensusBranchId);
+            TransactionSignatureCreator(keystore, &txNewConst, nIn, tIn.value, tIn.scriptPubKey, INT32_MAX, SIGHASH_ALL, &txdata), tIn.scriptPubKey, sigdata, consensusBranchId);
 
         if (!signSuccess) {
             UniValue jsonTx(UniValue::VOBJ);
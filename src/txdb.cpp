@@ -5,15 +5,23 @@
 
 #include "txdb.h"
 
+#include "blockstats.h"
 #include "chainparams.h"
 #include "hash.h"
+#include "init.h"
 #include "main.h"
 #include "pow.h"
 #include "uint256.h"
 #include "core_io.h"
+#include "currencystateindex.h"
+#include "pbaas/pbaas.h"
+#include "pbaas/reserves.h"
+#include "utxostats.h"
 
 #include <stdint.h>
 
+#include <boost/filesystem.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <boost/thread.hpp>
 
 using namespace std;
@@ -28,11 +36,31 @@ static const char DB_COINS = 'c';
 static const char DB_BLOCK_FILES = 'f';
 static const char DB_TXINDEX = 't';
 static const char DB_ADDRESSINDEX = 'd';
+static const char DB_ADDRESSINDEXCOMPACT = 'D';
+static const char DB_BLOCKTXNUMBER = 'N';
 static const char DB_ADDRESSUNSPENTINDEX = 'u';
+static const char DB_ADDRESSBALANCEINDEX = 'g';
 static const char DB_TIMESTAMPINDEX = 'S';
 static const char DB_BLOCKHASHINDEX = 'z';
 static const char DB_SPENTINDEX = 'p';
+static const char DB_BLOCKDELTAS = 'e';
+static const char DB_BLOCKFILTERINDEX = 'C';
+static const char DB_BLOCKSTATS = 'w';
+static const char DB_PRUNEDBLOCKPROOFS = 'P';
+static const char DB_PRUNEDTX = 'q';
+static const char DB_PRUNEDSTAKESOURCE = 'Q';
 static const char DB_BLOCK_INDEX = 'b';
+static const char DB_CURRENCYSTATEINDEX = 'y';
+// entries of the currency state index are cached results of GetCurrencyState. this is increased whenever the
+// serialization or the calculation of the states changes, so those of an older version are discarded on startup
+static const uint32_t CURRENCY_STATE_INDEX_VERSION = 1;
+static const char DB_RESERVETRANSFERINDEX = 'x';
+static const char DB_PENDINGTRANSFERINDEX = 'X';
+static const char DB_IDENTITYSTATEINDEX = 'j';
+static const char DB_IDENTITYREVERSEINDEX = 'J';
+static const char DB_IDENTITYCONTENTINDEX = 'k';
+static const char DB_IDENTITYCOMMITMENTINDEX = 'm';
+static const char DB_KVINDEX = 'K';
 
 static const char DB_BEST_BLOCK = 'B';
 static const char DB_BEST_SPROUT_ANCHOR = 'a';
@@ -40,19 +68,157 @@ static const char DB_BEST_SAPLING_ANCHOR = 'z';
 static const char DB_FLAG = 'F';
 static const char DB_REINDEX_FLAG = 'R';
 static const char DB_LAST_BLOCK = 'l';
+static const char DB_INDEXBUILDHEIGHT = 'H';
+static const char DB_UTXOSTATS = 'U';
+static const char DB_NULLIFIER_FILTER = 'n';
 
 // Zcash defines are slightly different - commenting rather than removing
 // in case there is ever a related error
 //static const char DB_TIMESTAMPINDEX = 'T';
 //static const char DB_BLOCKHASHINDEX = 'h';
 
-CCoinsViewDB::CCoinsViewDB(std::string dbName, size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / dbName, nCacheSize, fMemory, fWipe) {
+CCoinsViewDB::CCoinsViewDB(std::string dbName, size_t nCacheSize, bool fMemory, bool fWipe) :
+    db(GetDataDir() / dbName, nCacheSize, fMemory, fWipe), fBackgroundWrites(false), fPendingWriteFailed(false),
+    fBuildingNullifierFilter(false) {
 }
 
-CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe) 
+CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) :
+    db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe), fBackgroundWrites(false), fPendingWriteFailed(false),
+    fBuildingNullifierFilter(false)
 {
 }
 
+CCoinsViewDB::~CCoinsViewDB()
+{
+    WaitForPendingWrite();
+    nullifierFilterThread.interrupt();
+    nullifierFilterThread.join();
+
+    // persist the filter with the block it is complete for, so the next start only reads it back
+    LOCK(cs_nullifierFilter);
+    if (pnullifierFilter)
+    {
+        try
+        {
+            db.Write(DB_NULLIFIER_FILTER, std::make_pair(GetBestBlock(), *pnullifierFilter), true);
+        }
+        catch (const std::exception &e)
+        {
+            LogPrintf("%s: unable to write nullifier filter: %s\n", __func__, e.what());
+        }
+    }
+}
+
+void CCoinsViewDB::StartNullifierFilter()
+{
+    std::pair<uint256, CNullifierFilter> stored;
+    try
+    {
+        if (db.Read(DB_NULLIFIER_FILTER, stored) && !stored.first.IsNull() && stored.first == GetBestBlock() && !stored.second.IsFull())
+        {
+            LOCK(cs_nullifierFilter);
+            pnullifierFilter.reset(new CNullifierFilter(std::move(stored.second)));
+            LogPrintf("Loaded nullifier filter of %u nullifiers at block %s\n", pnullifierFilter->GetCount(), stored.first.GetHex());
+            return;
+        }
+    }
+    catch (const std::exception &e)
+    {
+        LogPrintf("%s: unable to read nullifier filter, rebuilding it: %s\n", __func__, e.what());
+    }
+
+    {
+        LOCK(cs_nullifierFilter);
+        fBuildingNullifierFilter = true;
+    }
+    nullifierFilterThread = boost::thread(&CCoinsViewDB::BuildNullifierFilter, this);
+}
+
+// every nullifier flushed after the build starts is also kept in vBuildNullifiers, so the ones the scan misses are
+// still added
+void CCoinsViewDB::BuildNullifierFilter()
+{
+    RenameThread("verus-nullfilter");
+
+    std::vector<uint256> nullifiers;
+    try
+    {
+        boost::scoped_ptr<CDBIterator> pcursor(db.NewIterator());
+        for (char dbChar : {DB_NULLIFIER, DB_SAPLING_NULLIFIER})
+        {
+            for (pcursor->Seek(dbChar); pcursor->Valid(); pcursor->Next())
+            {
+                boost::this_thread::interruption_point();
+                std::pair<char, uint256> key;
+                if (pcursor->GetKeySize() != 33 || !pcursor->GetKey(key) || key.first != dbChar)
+                {
+                    break;
+                }
+                nullifiers.push_back(key.second);
+            }
+        }
+    }
+    catch (const boost::thread_interrupted &)
+    {
+        LOCK(cs_nullifierFilter);
+        fBuildingNullifierFilter = false;
+        vBuildNullifiers.clear();
+        return;
+    }
+    catch (const std::exception &e)
+    {
+        LogPrintf("%s: unable to read nullifiers, looking them all up in the database: %s\n", __func__, e.what());
+        LOCK(cs_nullifierFilter);
+        fBuildingNullifierFilter = false;
+        vBuildNullifiers.clear();
+        return;
+    }
+
+    LOCK(cs_nullifierFilter);
+    std::unique_ptr<CNullifierFilter> filter(new CNullifierFilter(nullifiers.size() + vBuildNullifiers.size()));
+    for (const uint256 &nf : nullifiers)
+    {
+        filter->Insert(nf);
+    }
+    for (const uint256 &nf : vBuildNullifiers)
+    {
+        filter->Insert(nf);
+    }
+    vBuildNullifiers.clear();
+    fBuildingNullifierFilter = false;
+    pnullifierFilter = std::move(filter);
+    LogPrintf("Built nullifier filter of %u nullifiers\n", pnullifierFilter->GetCount());
+}
+
+void CCoinsViewDB::AddNullifiersToFilter(const CNullifiersMap &mapNullifiers)
+{
+    LOCK(cs_nullifierFilter);
+    if (!pnullifierFilter && !fBuildingNullifierFilter)
+    {
+        return;
+    }
+    for (const auto &nullifier : mapNullifiers)
+    {
+        if ((nullifier.second.flags & CNullifiersCacheEntry::DIRTY) && nullifier.second.entered)
+        {
+            if (pnullifierFilter)
+            {
+                pnullifierFilter->Insert(nullifier.first);
+            }
+            else
+            {
+                vBuildNullifiers.push_back(nullifier.first);
+            }
+        }
+    }
+}
+
+bool CCoinsViewDB::NullifierMayExist(const uint256 &nf) const
+{
+    LOCK(cs_nullifierFilter);
+    return !pnullifierFilter || pnullifierFilter->MayContain(nf);
+}
+
 
 bool CCoinsViewDB::GetSproutAnchorAt(const uint256 &rt, SproutMerkleTree &tree) const {
     if (rt == SproutMerkleTree::empty_root()) {
@@ -61,6 +227,22 @@ bool CCoinsViewDB::GetSproutAnchorAt(const uint256 &rt, SproutMerkleTree &tree)
         return true;
     }
 
+    {
+        LOCK(cs_pendingWrite);
+        if (pendingWrite)
+        {
+            auto it = pendingWrite->sproutAnchors.find(rt);
+            if (it != pendingWrite->sproutAnchors.end())
+            {
+                if (it->second.entered)
+                {
+                    tree = it->second.tree;
+                }
+                return it->second.entered;
+            }
+        }
+    }
+
     bool read = db.Read(make_pair(DB_SPROUT_ANCHOR, rt), tree);
 
     return read;
@@ -73,6 +255,22 @@ bool CCoinsViewDB::GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree
         return true;
     }
 
+    {
+        LOCK(cs_pendingWrite);
+        if (pendingWrite)
+        {
+            auto it = pendingWrite->saplingAnchors.find(rt);
+            if (it != pendingWrite->saplingAnchors.end())
+            {
+                if (it->second.entered)
+                {
+                    tree = it->second.tree;
+                }
+                return it->second.entered;
+            }
+        }
+    }
+
     bool read = db.Read(make_pair(DB_SAPLING_ANCHOR, rt), tree);
 
     return read;
@@ -91,18 +289,110 @@ bool CCoinsViewDB::GetNullifier(const uint256 &nf, ShieldedType type) const {
         default:
             throw runtime_error("Unknown shielded type");
     }
+
+    {
+        LOCK(cs_pendingWrite);
+        if (pendingWrite)
+        {
+            const CNullifiersMap &pendingNullifiers = type == SPROUT ? pendingWrite->sproutNullifiers : pendingWrite->saplingNullifiers;
+            auto it = pendingNullifiers.find(nf);
+            if (it != pendingNullifiers.end())
+            {
+                return it->second.entered;
+            }
+        }
+    }
+    if (!NullifierMayExist(nf))
+    {
+        return false;
+    }
     return db.Read(make_pair(dbChar, nf), spent);
 }
 
 bool CCoinsViewDB::GetCoins(const uint256 &txid, CCoins &coins) const {
+    {
+        LOCK(cs_pendingWrite);
+        if (pendingWrite)
+        {
+            auto it = pendingWrite->coins.find(txid);
+            if (it != pendingWrite->coins.end())
+            {
+                // pruned entries are erased from the database
+                if (it->second.coins.IsPruned())
+                {
+                    return false;
+                }
+                coins = it->second.coins;
+                return true;
+            }
+        }
+    }
     return db.Read(make_pair(DB_COINS, txid), coins);
 }
 
+size_t CCoinsViewDB::GetCoinsMany(const std::vector<uint256> &txids, std::vector<CCoins> &coins, std::vector<unsigned char> &found, int nThreads) const {
+    size_t nFound = 0;
+    coins.assign(txids.size(), CCoins());
+    found.assign(txids.size(), 0);
+
+    // entries still waiting to be written shadow the database
+    std::vector<size_t> dbIndex;
+    std::vector<std::pair<char, uint256>> dbKeys;
+    {
+        LOCK(cs_pendingWrite);
+        for (size_t i = 0; i < txids.size(); i++) {
+            if (pendingWrite) {
+                auto it = pendingWrite->coins.find(txids[i]);
+                if (it != pendingWrite->coins.end()) {
+                    if (!it->second.coins.IsPruned()) {
+                        coins[i] = it->second.coins;
+                        found[i] = 1;
+                        nFound++;
+                    }
+                    continue;
+                }
+            }
+            dbIndex.push_back(i);
+            dbKeys.push_back(make_pair(DB_COINS, txids[i]));
+        }
+    }
+
+    std::vector<CCoins> dbCoins;
+    std::vector<unsigned char> dbFound;
+    db.ReadMany(dbKeys, dbCoins, dbFound, nThreads);
+    for (size_t j = 0; j < dbIndex.size(); j++) {
+        if (dbFound[j]) {
+            coins[dbIndex[j]].swap(dbCoins[j]);
+            found[dbIndex[j]] = 1;
+            nFound++;
+        }
+    }
+    return nFound;
+}
+
 bool CCoinsViewDB::HaveCoins(const uint256 &txid) const {
+    {
+        LOCK(cs_pendingWrite);
+        if (pendingWrite)
+        {
+            auto it = pendingWrite->coins.find(txid);
+            if (it != pendingWrite->coins.end())
+            {
+                return !it->second.coins.IsPruned();
+            }
+        }
+    }
     return db.Exists(make_pair(DB_COINS, txid));
 }
 
 uint256 CCoinsViewDB::GetBestBlock() const {
+    {
+        LOCK(cs_pendingWrite);
+        if (pendingWrite && !pendingWrite->hashBlock.IsNull())
+        {
+            return pendingWrite->hashBlock;
+        }
+    }
     uint256 hashBestChain;
     if (!db.Read(DB_BEST_BLOCK, hashBestChain))
         return uint256();
@@ -111,7 +401,19 @@ uint256 CCoinsViewDB::GetBestBlock() const {
 
 uint256 CCoinsViewDB::GetBestAnchor(ShieldedType type) const {
     uint256 hashBestAnchor;
-    
+
+    {
+        LOCK(cs_pendingWrite);
+        if (pendingWrite)
+        {
+            hashBestAnchor = type == SPROUT ? pendingWrite->hashSproutAnchor : pendingWrite->hashSaplingAnchor;
+            if (!hashBestAnchor.IsNull())
+            {
+                return hashBestAnchor;
+            }
+        }
+    }
+
     switch (type) {
         case SPROUT:
             if (!db.Read(DB_BEST_SPROUT_ANCHOR, hashBestAnchor))
@@ -170,6 +472,53 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins,
                               CAnchorsSaplingMap &mapSaplingAnchors,
                               CNullifiersMap &mapSproutNullifiers,
                               CNullifiersMap &mapSaplingNullifiers) {
+    // nullifiers are in the filter before they can be read from the database
+    AddNullifiersToFilter(mapSproutNullifiers);
+    AddNullifiersToFilter(mapSaplingNullifiers);
+
+    if (fBackgroundWrites)
+    {
+        // only one flush is written at a time, which bounds the memory held by pending writes to one flush
+        if (!WaitForPendingWrite())
+        {
+            return false;
+        }
+
+        std::unique_ptr<CPendingWrite> pending(new CPendingWrite());
+        size_t count = 0;
+        size_t changed = 0;
+        for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();)
+        {
+            if (it->second.flags & CCoinsCacheEntry::DIRTY)
+            {
+                CCoinsCacheEntry &entry = pending->coins[it->first];
+                entry.coins.swap(it->second.coins);
+                entry.flags = CCoinsCacheEntry::DIRTY;
+                changed++;
+            }
+            count++;
+            CCoinsMap::iterator itOld = it++;
+            mapCoins.erase(itOld);
+        }
+        pending->sproutAnchors.swap(mapSproutAnchors);
+        pending->saplingAnchors.swap(mapSaplingAnchors);
+        pending->sproutNullifiers.swap(mapSproutNullifiers);
+        pending->saplingNullifiers.swap(mapSaplingNullifiers);
+        pending->hashBlock = hashBlock;
+        pending->hashSproutAnchor = hashSproutAnchor;
+        pending->hashSaplingAnchor = hashSaplingAnchor;
+
+        LogPrint("coindb", "Committing %u changed transactions (out of %u) to coin database in the background...\n", (unsigned int)changed, (unsigned int)count);
+
+        LOCK(cs_pendingWriteThread);
+        {
+            LOCK(cs_pendingWrite);
+            pendingWrite = std::move(pending);
+        }
+        pendingWriteThread = boost::thread(&CCoinsViewDB::WritePending, this);
+        return true;
+    }
+
     CDBBatch batch(db);
     size_t count = 0;
     size_t changed = 0;
@@ -203,7 +552,162 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins,
     return db.WriteBatch(batch);
 }
 
-CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe, bool compression, int maxOpenFiles) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe, compression, maxOpenFiles) {
+template<typename Map, typename MapEntry, typename Tree>
+static void WritePendingAnchors(CDBBatch& batch, const Map& mapToUse, const char& dbChar)
+{
+    for (const auto &anchor : mapToUse)
+    {
+        if (anchor.second.flags & MapEntry::DIRTY)
+        {
+            if (!anchor.second.entered)
+            {
+                batch.Erase(make_pair(dbChar, anchor.first));
+            }
+            else if (anchor.first != Tree::empty_root())
+            {
+                batch.Write(make_pair(dbChar, anchor.first), anchor.second.tree);
+            }
+        }
+    }
+}
+
+static void WritePendingNullifiers(CDBBatch& batch, const CNullifiersMap& mapToUse, const char& dbChar)
+{
+    for (const auto &nullifier : mapToUse)
+    {
+        if (nullifier.second.flags & CNullifiersCacheEntry::DIRTY)
+        {
+            if (!nullifier.second.entered)
+            {
+                batch.Erase(make_pair(dbChar, nullifier.first));
+            }
+            else
+            {
+                batch.Write(make_pair(dbChar, nullifier.first), true);
+            }
+        }
+    }
+}
+
+// writes pendingWrite as one batch, like a synchronous BatchWrite, and only drops it once the batch is in the
+// database, so that readers can never miss its changes
+void CCoinsViewDB::WritePending()
+{
+    RenameThread("verus-coinsflush");
+
+    const CPendingWrite &pending = *pendingWrite;
+    bool fOk = false;
+    try
+    {
+        CDBBatch batch(db);
+        for (const auto &entry : pending.coins)
+        {
+            if (entry.second.coins.IsPruned())
+            {
+                batch.Erase(make_pair(DB_COINS, entry.first));
+            }
+            else
+            {
+                batch.Write(make_pair(DB_COINS, entry.first), entry.second.coins);
+            }
+        }
+
+        WritePendingAnchors<CAnchorsSproutMap, CAnchorsSproutCacheEntry, SproutMerkleTree>(batch, pending.sproutAnchors, DB_SPROUT_ANCHOR);
+        WritePendingAnchors<CAnchorsSaplingMap, CAnchorsSaplingCacheEntry, SaplingMerkleTree>(batch, pending.saplingAnchors, DB_SAPLING_ANCHOR);
+
+        WritePendingNullifiers(batch, pending.sproutNullifiers, DB_NULLIFIER);
+        WritePendingNullifiers(batch, pending.saplingNullifiers, DB_SAPLING_NULLIFIER);
+
+        if (!pending.hashBlock.IsNull())
+            batch.Write(DB_BEST_BLOCK, pending.hashBlock);
+        if (!pending.hashSproutAnchor.IsNull())
+            batch.Write(DB_BEST_SPROUT_ANCHOR, pending.hashSproutAnchor);
+        if (!pending.hashSaplingAnchor.IsNull())
+            batch.Write(DB_BEST_SAPLING_ANCHOR, pending.hashSaplingAnchor);
+
+        fOk = db.WriteBatch(batch);
+    }
+    catch (const std::exception &e)
+    {
+        LogPrintf("%s: error writing to coin database: %s\n", __func__, e.what());
+    }
+
+    LOCK(cs_pendingWrite);
+    if (fOk)
+    {
+        LogPrint("coindb", "Committed %u changed transactions to coin database\n", (unsigned int)pending.coins.size());
+        pendingWrite.reset();
+    }
+    else
+    {
+        // keep serving the changes from memory, the next flush reports the failure
+        fPendingWriteFailed = true;
+    }
+}
+
+bool CCoinsViewDB::WaitForPendingWrite() const
+{
+    {
+        LOCK(cs_pendingWriteThread);
+        if (pendingWriteThread.joinable())
+        {
+            pendingWriteThread.join();
+        }
+    }
+    LOCK(cs_pendingWrite);
+    return !fPendingWriteFailed;
+}
+
+bool CCoinsViewDB::SyncWrites()
+{
+    return WaitForPendingWrite();
+}
+
+// an existing data directory keeps the layout it was created with, so -separateindexdb only takes effect on a new
+// block index or when it is being wiped for a reindex
+static bool UseSeparateIndexDB(bool fMemory, bool fWipe)
+{
+    if (fMemory)
+    {
+        return false;
+    }
+    if (fWipe || !boost::filesystem::exists(GetDataDir() / "blocks" / "index"))
+    {
+        return GetBoolArg("-separateindexdb", DEFAULT_SEPARATE_INDEX_DB);
+    }
+    return boost::filesystem::exists(GetDataDir() / "blocks" / "indexes");
+}
+
+// when no index cache size is given, the index database gets three quarters of the cache, since the
+// address and spent indexes are far larger and more frequently read than the block index itself
+static size_t IndexDBCacheSize(size_t nCacheSize, size_t nIndexCacheSize)
+{
+    size_t nIndexCache = nIndexCacheSize ? nIndexCacheSize : (nCacheSize / 4) * 3;
+    return std::min(nIndexCache, (nCacheSize / 4) * 3);
+}
+
+CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe, bool compression, int maxOpenFiles, size_t nIndexCacheSize) :
+    CBlockTreeDB(UseSeparateIndexDB(fMemory, fWipe), nCacheSize, fMemory, fWipe, compression, maxOpenFiles, nIndexCacheSize) {
+}
+
+CBlockTreeDB::CBlockTreeDB(bool fSeparateIndexes, size_t nCacheSize, bool fMemory, bool fWipe, bool compression, int maxOpenFiles, size_t nIndexCacheSize) :
+    CDBWrapper(GetDataDir() / "blocks" / "index",
+               fSeparateIndexes ? nCacheSize - IndexDBCacheSize(nCacheSize, nIndexCacheSize) : nCacheSize,
+               fMemory, fWipe, compression, maxOpenFiles), fCompactAddressIndex(false) {
+    boost::filesystem::path indexPath = GetDataDir() / "blocks" / "indexes";
+    if (fSeparateIndexes) {
+        size_t nIndexCache = IndexDBCacheSize(nCacheSize, nIndexCacheSize);
+        int bloomBits = GetArg("-indexdbbloombits", DEFAULT_INDEX_DB_BLOOM_BITS);
+        size_t blockSize = std::max(GetArg("-indexdbblocksize", DEFAULT_INDEX_DB_BLOCK_SIZE), (int64_t)1024);
+        size_t writeBufferSize = std::max(GetArg("-indexdbwritebuffer", 0), (int64_t)0) << 20;
+        LogPrintf("Using separate index database at %s, cache %.1fMiB, bloom bits %d, block size %u\n",
+                  indexPath.string(), nIndexCache * (1.0 / 1024 / 1024), bloomBits, (unsigned int)blockSize);
+        pindexdb.reset(new CDBWrapper(indexPath, nIndexCache, fMemory, fWipe, compression, maxOpenFiles,
+                                      bloomBits, blockSize, writeBufferSize));
+    } else if (fWipe && !fMemory && boost::filesystem::exists(indexPath)) {
+        LogPrintf("Removing separate index database at %s\n", indexPath.string());
+        boost::filesystem::remove_all(indexPath);
+    }
 }
 
 bool CBlockTreeDB::ReadBlockFileInfo(int nFile, CBlockFileInfo &info) {
@@ -227,6 +731,9 @@ bool CBlockTreeDB::ReadLastBlockFile(int &nFile) {
 }
 
 bool CCoinsViewDB::GetStats(CCoinsStats &stats) const {
+    if (!WaitForPendingWrite())
+        return error("CCoinsViewDB::GetStats() : coin database write failed");
+
     /* It seems that there are no "const iterators" for LevelDB.  Since we
        only need read operations on it, use a const-cast to get around
        that restriction.  */
@@ -272,6 +779,364 @@ bool CCoinsViewDB::GetStats(CCoinsStats &stats) const {
     return true;
 }
 
+bool CCoinsViewDB::GetUTXOSetStats(CUTXOSetStats &stats, const CDBSnapshot &snapshot) const {
+    boost::scoped_ptr<CDBIterator> pcursor(const_cast<CDBWrapper*>(&db)->NewIterator(snapshot, false));
+
+    stats = CUTXOSetStats();
+    char bestKey;
+    pcursor->Seek(DB_BEST_BLOCK);
+    if (!pcursor->Valid() || pcursor->GetKeySize() != 1 || !pcursor->GetKey(bestKey) || bestKey != DB_BEST_BLOCK ||
+        !pcursor->GetValue(stats.hashBlock))
+        stats.hashBlock.SetNull();
+
+    for (pcursor->Seek(DB_COINS); pcursor->Valid(); pcursor->Next()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, uint256> key;
+        CCoins coins;
+        if (!pcursor->GetKey(key) || key.first != DB_COINS)
+            break;
+        if (!pcursor->GetValue(coins))
+            return error("CCoinsViewDB::GetUTXOSetStats() : unable to read value");
+        for (unsigned int i = 0; i < coins.vout.size(); i++)
+            stats.AddOutput(key.second, i, coins.vout[i]);
+    }
+    return true;
+}
+
+static const uint32_t COINS_SNAPSHOT_MAGIC = 0x73736376;   // "vcss"
+static const uint32_t COINS_SNAPSHOT_VERSION = 1;
+static const unsigned char COINS_SNAPSHOT_END = 0;
+// number of records loaded from a snapshot between database writes
+static const uint64_t COINS_SNAPSHOT_BATCH_SIZE = 100000;
+
+/**
+ * Serializes snapshot data to a file and hashes exactly the bytes written, so that the hash at the end of the
+ * snapshot commits to everything before it.
+ */
+class CSnapshotWriter
+{
+private:
+    CAutoFile &file;
+    CHashWriter hw;
+
+public:
+    CSnapshotWriter(CAutoFile &fileIn) : file(fileIn), hw(SER_GETHASH, PROTOCOL_VERSION) {}
+
+    int GetType() const { return file.GetType(); }
+    int GetVersion() const { return file.GetVersion(); }
+
+    void write(const char *pch, size_t nSize)
+    {
+        file.write(pch, nSize);
+        hw.write(pch, nSize);
+    }
+
+    template<typename T>
+    CSnapshotWriter& operator<<(const T& obj)
+    {
+        ::Serialize(*this, obj);
+        return (*this);
+    }
+
+    uint256 GetHash() { return hw.GetHash(); }
+};
+
+/** Reads snapshot data written by CSnapshotWriter, hashing exactly the bytes read */
+class CSnapshotReader
+{
+private:
+    CAutoFile &file;
+    CHashWriter hw;
+
+public:
+    CSnapshotReader(CAutoFile &fileIn) : file(fileIn), hw(SER_GETHASH, PROTOCOL_VERSION) {}
+
+    int GetType() const { return file.GetType(); }
+    int GetVersion() const { return file.GetVersion(); }
+
+    void read(char *pch, size_t nSize)
+    {
+        file.read(pch, nSize);
+        hw.write(pch, nSize);
+    }
+
+    void ignore(size_t nSize)
+    {
+        char data[1024];
+        while (nSize > 0)
+        {
+            size_t nNow = std::min<size_t>(nSize, sizeof(data));
+            read(data, nNow);
+            nSize -= nNow;
+        }
+    }
+
+    template<typename T>
+    CSnapshotReader& operator>>(T& obj)
+    {
+        ::Unserialize(*this, obj);
+        return (*this);
+    }
+
+    uint256 GetHash() { return hw.GetHash(); }
+};
+
+/**
+ * Snapshot format, version 1:
+ *   magic, version, chain ID, best block, best Sprout anchor, best Sapling anchor
+ *   records of (type, key[, value]), where type is a coins database key prefix for coins, anchors or nullifiers
+ *   end marker, number of coins, anchors and nullifiers
+ *   hash of all of the above
+ */
+bool CCoinsViewDB::WriteSnapshot(CAutoFile &file, const uint160 &chainID, CCoinsSnapshotInfo &info) const
+{
+    // the snapshot is read from the database alone
+    if (!WaitForPendingWrite())
+    {
+        return error("%s: coin database write failed", __func__);
+    }
+
+    // a LevelDB iterator reads from an implicit snapshot of the database, so the best block, anchors and records written
+    // are consistent with each other, even if blocks are connected and flushed while this runs
+    boost::scoped_ptr<CDBIterator> pcursor(const_cast<CDBWrapper*>(&db)->NewIterator());
+
+    auto readBest = [&pcursor](char dbChar, uint256 &value)
+    {
+        char key;
+        pcursor->Seek(dbChar);
+        return pcursor->Valid() && pcursor->GetKeySize() == 1 && pcursor->GetKey(key) && key == dbChar && pcursor->GetValue(value);
+    };
+
+    info = CCoinsSnapshotInfo();
+    if (!readBest(DB_BEST_BLOCK, info.hashBlock) || info.hashBlock.IsNull())
+    {
+        return error("%s: no best block in coins database", __func__);
+    }
+    if (!readBest(DB_BEST_SPROUT_ANCHOR, info.hashSproutAnchor))
+    {
+        info.hashSproutAnchor = SproutMerkleTree::empty_root();
+    }
+    if (!readBest(DB_BEST_SAPLING_ANCHOR, info.hashSaplingAnchor))
+    {
+        info.hashSaplingAnchor = SaplingMerkleTree::empty_root();
+    }
+
+    CSnapshotWriter writer(file);
+    writer << COINS_SNAPSHOT_MAGIC << COINS_SNAPSHOT_VERSION << chainID << info.hashBlock << info.hashSproutAnchor << info.hashSaplingAnchor;
+
+    for (pcursor->SeekToFirst(); pcursor->Valid(); pcursor->Next())
+    {
+        boost::this_thread::interruption_point();
+        std::pair<char, uint256> key;
+        if (pcursor->GetKeySize() != 33 || !pcursor->GetKey(key))
+        {
+            continue;
+        }
+        unsigned char recordType = key.first;
+        switch (key.first)
+        {
+            case DB_COINS:
+            {
+                CCoins coins;
+                if (!pcursor->GetValue(coins))
+                {
+                    return error("%s: unable to read coins %s", __func__, key.second.GetHex());
+                }
+                writer << recordType << key.second << coins;
+                info.nCoins++;
+                break;
+            }
+            case DB_SPROUT_ANCHOR:
+            {
+                SproutMerkleTree tree;
+                if (!pcursor->GetValue(tree))
+                {
+                    return error("%s: unable to read Sprout anchor %s", __func__, key.second.GetHex());
+                }
+                writer << recordType << key.second << tree;
+                info.nAnchors++;
+                break;
+            }
+            case DB_SAPLING_ANCHOR:
+            {
+                SaplingMerkleTree tree;
+                if (!pcursor->GetValue(tree))
+                {
+                    return error("%s: unable to read Sapling anchor %s", __func__, key.second.GetHex());
+                }
+                writer << recordType << key.second << tree;
+                info.nAnchors++;
+                break;
+            }
+            case DB_NULLIFIER:
+            case DB_SAPLING_NULLIFIER:
+            {
+                writer << recordType << key.second;
+                info.nNullifiers++;
+                break;
+            }
+        }
+    }
+
+    writer << COINS_SNAPSHOT_END << info.nCoins << info.nAnchors << info.nNullifiers;
+    info.hashSnapshot = writer.GetHash();
+    file << info.hashSnapshot;
+    return true;
+}
+
+/**
+ * Reads a whole snapshot, verifying its header and hash, and if pbatchdb is not NULL, writes its contents to pbatchdb.
+ */
+static bool ReadCoinsSnapshot(const boost::filesystem::path &path, const uint160 &chainID, CCoinsSnapshotInfo &info, CDBWrapper *pbatchdb, std::string &strError)
+{
+    CAutoFile file(fopen(path.string().c_str(), "rb"), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull())
+    {
+        strError = strprintf("cannot open chainstate snapshot %s", path.string());
+        return false;
+    }
+
+    try {
+        CSnapshotReader reader(file);
+        uint32_t magic, version;
+        uint160 snapshotChainID;
+        reader >> magic >> version;
+        if (magic != COINS_SNAPSHOT_MAGIC || version != COINS_SNAPSHOT_VERSION)
+        {
+            strError = strprintf("%s is not a version %u chainstate snapshot", path.string(), COINS_SNAPSHOT_VERSION);
+            return false;
+        }
+        reader >> snapshotChainID;
+        if (snapshotChainID != chainID)
+        {
+            strError = "chainstate snapshot is for a different chain";
+            return false;
+        }
+
+        CCoinsSnapshotInfo readInfo;
+        reader >> readInfo.hashBlock >> readInfo.hashSproutAnchor >> readInfo.hashSaplingAnchor;
+
+        std::unique_ptr<CDBBatch> pbatch(pbatchdb ? new CDBBatch(*pbatchdb) : NULL);
+        uint64_t nBatched = 0;
+        while (true)
+        {
+            boost::this_thread::interruption_point();
+            unsigned char recordType;
+            uint256 key;
+            reader >> recordType;
+            if (recordType == COINS_SNAPSHOT_END)
+            {
+                break;
+            }
+            reader >> key;
+            switch (recordType)
+            {
+                case DB_COINS:
+                {
+                    CCoins coins;
+                    reader >> coins;
+                    if (pbatch)
+                        pbatch->Write(make_pair(DB_COINS, key), coins);
+                    readInfo.nCoins++;
+                    break;
+                }
+                case DB_SPROUT_ANCHOR:
+                {
+                    SproutMerkleTree tree;
+                    reader >> tree;
+                    if (pbatch)
+                        pbatch->Write(make_pair(DB_SPROUT_ANCHOR, key), tree);
+                    readInfo.nAnchors++;
+                    break;
+                }
+                case DB_SAPLING_ANCHOR:
+                {
+                    SaplingMerkleTree tree;
+                    reader >> tree;
+                    if (pbatch)
+                        pbatch->Write(make_pair(DB_SAPLING_ANCHOR, key), tree);
+                    readInfo.nAnchors++;
+                    break;
+                }
+                case DB_NULLIFIER:
+                case DB_SAPLING_NULLIFIER:
+                {
+                    if (pbatch)
+                        pbatch->Write(make_pair((char)recordType, key), true);
+                    readInfo.nNullifiers++;
+                    break;
+                }
+                default:
+                {
+                    strError = strprintf("invalid record type %u in chainstate snapshot", recordType);
+                    return false;
+                }
+            }
+            if (pbatch && ++nBatched >= COINS_SNAPSHOT_BATCH_SIZE)
+            {
+                if (!pbatchdb->WriteBatch(*pbatch))
+                {
+                    strError = "error writing chainstate snapshot to the coins database";
+                    return false;
+                }
+                pbatch.reset(new CDBBatch(*pbatchdb));
+                nBatched = 0;
+            }
+        }
+
+        uint64_t nCoins, nAnchors, nNullifiers;
+        reader >> nCoins >> nAnchors >> nNullifiers;
+        readInfo.hashSnapshot = reader.GetHash();
+
+        uint256 hashCommitted;
+        file >> hashCommitted;
+        if (hashCommitted != readInfo.hashSnapshot ||
+            nCoins != readInfo.nCoins ||
+            nAnchors != readInfo.nAnchors ||
+            nNullifiers != readInfo.nNullifiers)
+        {
+            strError = "chainstate snapshot is corrupt, its contents do not match its hash";
+            return false;
+        }
+
+        // the best block is written last, so that an interrupted load leaves no best block and is loaded again
+        if (pbatch)
+        {
+            pbatch->Write(DB_BEST_SPROUT_ANCHOR, readInfo.hashSproutAnchor);
+            pbatch->Write(DB_BEST_SAPLING_ANCHOR, readInfo.hashSaplingAnchor);
+            pbatch->Write(DB_BEST_BLOCK, readInfo.hashBlock);
+            if (!pbatchdb->WriteBatch(*pbatch, true))
+            {
+                strError = "error writing chainstate snapshot to the coins database";
+                return false;
+            }
+        }
+        info = readInfo;
+    } catch (const std::exception &e) {
+        strError = strprintf("error reading chainstate snapshot: %s", e.what());
+        return false;
+    }
+    return true;
+}
+
+bool CCoinsViewDB::LoadSnapshot(const boost::filesystem::path &path, const uint160 &chainID, CCoinsSnapshotInfo &info, std::string &strError)
+{
+    if (!db.IsEmpty())
+    {
+        strError = "a chainstate snapshot can only be loaded into an empty coins database";
+        return false;
+    }
+
+    // verify the whole snapshot before writing any of it
+    if (!ReadCoinsSnapshot(path, chainID, info, NULL, strError))
+    {
+        return false;
+    }
+    LogPrintf("Verified chainstate snapshot %s at block %s, %lu coins, %lu anchors, %lu nullifiers\n",
+              path.string(), info.hashBlock.GetHex(), info.nCoins, info.nAnchors, info.nNullifiers);
+    return ReadCoinsSnapshot(path, chainID, info, &db, strError);
+}
+
 bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo) {
     CDBBatch batch(*this);
     for (std::vector<std::pair<int, const CBlockFileInfo*> >::const_iterator it=fileInfo.begin(); it != fileInfo.end(); it++) {
@@ -304,11 +1169,92 @@ bool CBlockTreeDB::WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos>
 }
 
 bool CBlockTreeDB::ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value) {
-    return Read(make_pair(DB_SPENTINDEX, key), value);
+    return IndexDB().Read(make_pair(DB_SPENTINDEX, key), value);
+}
+
+size_t CBlockTreeDB::ReadSpentIndex(const std::vector<CSpentIndexKey> &keys, std::vector<CSpentIndexValue> &values, std::vector<unsigned char> &found) {
+    std::vector<std::pair<char, CSpentIndexKey>> dbKeys;
+    dbKeys.reserve(keys.size());
+    for (const CSpentIndexKey &key : keys)
+        dbKeys.push_back(make_pair(DB_SPENTINDEX, key));
+    return IndexDB().ReadMany(dbKeys, values, found);
+}
+
+bool CBlockTreeDB::WriteBlockDeltaSummary(const uint256 &blockHash, const CBlockDeltaSummary &summary) {
+    return IndexDB().Write(make_pair(DB_BLOCKDELTAS, blockHash), summary);
+}
+
+bool CBlockTreeDB::ReadBlockDeltaSummary(const uint256 &blockHash, CBlockDeltaSummary &summary) {
+    return IndexDB().Read(make_pair(DB_BLOCKDELTAS, blockHash), summary);
+}
+
+bool CBlockTreeDB::EraseBlockDeltaSummary(const uint256 &blockHash) {
+    return IndexDB().Erase(make_pair(DB_BLOCKDELTAS, blockHash));
+}
+
+// entries are keyed by block hash and stay correct when their block is disconnected, so they are never erased
+bool CBlockTreeDB::WriteBlockFilter(const uint256 &blockHash, const CBlockFilterIndexEntry &entry) {
+    return IndexDB().Write(make_pair(DB_BLOCKFILTERINDEX, blockHash), entry);
+}
+
+bool CBlockTreeDB::ReadBlockFilter(const uint256 &blockHash, CBlockFilterIndexEntry &entry) {
+    return IndexDB().Read(make_pair(DB_BLOCKFILTERINDEX, blockHash), entry);
+}
+
+// like the filters, entries are keyed by block hash and never erased
+bool CBlockTreeDB::WriteBlockStats(const uint256 &blockHash, const CBlockStats &stats) {
+    return IndexDB().Write(make_pair(DB_BLOCKSTATS, blockHash), stats);
+}
+
+bool CBlockTreeDB::ReadBlockStats(const uint256 &blockHash, CBlockStats &stats) {
+    return IndexDB().Read(make_pair(DB_BLOCKSTATS, blockHash), stats);
+}
+
+bool CBlockTreeDB::WritePrunedProofs(const std::vector<std::pair<uint256, CPrunedBlockProofs>> &blocks,
+                                     const std::vector<std::pair<uint256, std::pair<uint256, CTransaction>>> &txs,
+                                     const std::vector<uint256> &retainedStakeSources) {
+    CDBBatch batch(IndexDB());
+    for (const auto &block : blocks)
+        batch.Write(make_pair(DB_PRUNEDBLOCKPROOFS, block.first), block.second);
+    for (const auto &tx : txs)
+        batch.Write(make_pair(DB_PRUNEDTX, tx.first), tx.second);
+    // once retained, a stake source no longer needs its mark
+    for (const uint256 &txid : retainedStakeSources)
+        batch.Erase(make_pair(DB_PRUNEDSTAKESOURCE, txid));
+    return IndexDB().WriteBatch(batch, true);
+}
+
+bool CBlockTreeDB::ReadPrunedBlockProofs(const uint256 &blockHash, CPrunedBlockProofs &proofs) {
+    return IndexDB().Read(make_pair(DB_PRUNEDBLOCKPROOFS, blockHash), proofs);
+}
+
+bool CBlockTreeDB::ReadPrunedTransaction(const uint256 &txid, CTransaction &tx, uint256 &blockHash) {
+    std::pair<uint256, CTransaction> entry;
+    if (!IndexDB().Read(make_pair(DB_PRUNEDTX, txid), entry))
+        return false;
+    blockHash = entry.first;
+    tx = entry.second;
+    return true;
+}
+
+bool CBlockTreeDB::WritePrunedStakeSource(const uint256 &txid) {
+    return IndexDB().Write(make_pair(DB_PRUNEDSTAKESOURCE, txid), '1');
+}
+
+bool CBlockTreeDB::HavePrunedStakeSource(const uint256 &txid) {
+    return IndexDB().Exists(make_pair(DB_PRUNEDSTAKESOURCE, txid));
+}
+
+bool CBlockTreeDB::WriteUTXOSetStats(const CUTXOSetStats &stats) {
+    return Write(DB_UTXOSTATS, stats);
+}
+
+bool CBlockTreeDB::ReadUTXOSetStats(CUTXOSetStats &stats) {
+    return Read(DB_UTXOSTATS, stats);
 }
 
 bool CBlockTreeDB::UpdateSpentIndex(const std::vector<CSpentIndexDbEntry> &vect) {
-    CDBBatch batch(*this);
+    CDBBatch batch(IndexDB());
     for (std::vector<CSpentIndexDbEntry>::const_iterator it=vect.begin(); it!=vect.end(); it++) {
         if (it->second.IsNull()) {
             batch.Erase(make_pair(DB_SPENTINDEX, it->first));
@@ -316,11 +1262,11 @@ bool CBlockTreeDB::UpdateSpentIndex(const std::vector<CSpentIndexDbEntry> &vect)
             batch.Write(make_pair(DB_SPENTINDEX, it->first), it->second);
         }
     }
-    return WriteBatch(batch);
+    return IndexDB().WriteBatch(batch);
 }
 
 bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<CAddressUnspentDbEntry> &vect) {
-    CDBBatch batch(*this);
+    CDBBatch batch(IndexDB());
     for (std::vector<CAddressUnspentDbEntry>::const_iterator it=vect.begin(); it!=vect.end(); it++) {
         if (it->second.IsNull()) {
             batch.Erase(make_pair(DB_ADDRESSUNSPENTINDEX, it->first));
@@ -328,16 +1274,44 @@ bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<CAddressUnspentDb
             batch.Write(make_pair(DB_ADDRESSUNSPENTINDEX, it->first), it->second);
         }
     }
-    return WriteBatch(batch);
+    return IndexDB().WriteBatch(batch);
 }
 
-bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type, std::vector<CAddressUnspentDbEntry> &unspentOutputs)
+// when pAfter is an entry of this address, reading continues after it, and at most maxCount entries, if nonzero, are added
+bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type, std::vector<CAddressUnspentDbEntry> &unspentOutputs,
+                                           unsigned int maxCount, const CAddressUnspentKey *pAfter, const CDBSnapshot *pSnapshot)
 {
-    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    boost::scoped_ptr<CDBIterator> pcursor(pSnapshot ? IndexDB().NewIterator(*pSnapshot, false) : IndexDB().NewIterator());
+    return ReadAddressUnspentIndex(pcursor.get(), addressHash, type, unspentOutputs, maxCount, pAfter);
+}
+
+bool CBlockTreeDB::ReadAddressUnspentIndex(const std::vector<std::pair<uint160, int>> &addresses,
+                                           std::vector<std::vector<CAddressUnspentDbEntry>> &unspentOutputs,
+                                           const CDBSnapshot *pSnapshot)
+{
+    // addresses given in key order only ever move this cursor forward, and the blocks it reads are kept
+    // in the cache for the next address
+    boost::scoped_ptr<CDBIterator> pcursor(pSnapshot ? IndexDB().NewIterator(*pSnapshot, true) : IndexDB().NewIterator(true));
+    unspentOutputs.resize(addresses.size());
+    for (size_t i = 0; i < addresses.size(); i++) {
+        if (!ReadAddressUnspentIndex(pcursor.get(), addresses[i].first, addresses[i].second, unspentOutputs[i]))
+            return false;
+    }
+    return true;
+}
 
-    pcursor->Seek(make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorKey(type, addressHash)));
+bool CBlockTreeDB::ReadAddressUnspentIndex(CDBIterator *pcursor, uint160 addressHash, int type, std::vector<CAddressUnspentDbEntry> &unspentOutputs,
+                                           unsigned int maxCount, const CAddressUnspentKey *pAfter)
+{
+    if (pAfter && pAfter->type == (unsigned int)type && pAfter->hashBytes == addressHash) {
+        pcursor->Seek(make_pair(DB_ADDRESSUNSPENTINDEX, *pAfter));
+    } else {
+        pAfter = nullptr;
+        pcursor->Seek(make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorKey(type, addressHash)));
+    }
 
-    while (pcursor->Valid()) {
+    unsigned int count = 0;
+    while (pcursor->Valid() && (!maxCount || count < maxCount)) {
         boost::this_thread::interruption_point();
         try {
             CDataStream ssKey(SER_DISK, CLIENT_VERSION);
@@ -347,10 +1321,15 @@ bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type, std::v
             CAddressUnspentKey indexKey = keyObj.second;
 
             if (chType == DB_ADDRESSUNSPENTINDEX && indexKey.hashBytes == addressHash) {
+                if (pAfter && indexKey.txhash == pAfter->txhash && indexKey.index == pAfter->index) {
+                    pcursor->Next();
+                    continue;
+                }
                 try {
                     CAddressUnspentValue nValue;
                     pcursor->GetValue(nValue);
                     unspentOutputs.push_back(make_pair(indexKey, nValue));
+                    count++;
                     pcursor->Next();
                 } catch (const std::exception& e) {
                     return error("failed to get address unspent value");
@@ -365,34 +1344,204 @@ bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type, std::v
     return true;
 }
 
+// only the currency launch index key is given heights offset from those of its blocks, so only its compact keys
+// carry their txid instead of referring to the transaction by its number in the block
+static uint160 LaunchIndexKeyID()
+{
+    return CCrossChainRPCData::GetConditionID(ASSETCHAINS_CHAINID, CCurrencyDefinition::CurrencyLaunchKey());
+}
+
+static void WriteCompactAddressIndexEntry(CDBBatch &batch, const CAddressIndexDbEntry &entry, const uint160 &launchKeyID) {
+    bool fTxid = entry.first.hashBytes == launchKeyID;
+    batch.Write(make_pair(DB_ADDRESSINDEXCOMPACT, CAddressIndexCompactKey(entry.first, fTxid)), entry.second);
+    if (!fTxid) {
+        batch.Write(make_pair(DB_BLOCKTXNUMBER, CBlockTxNumberKey(entry.first.blockHeight, entry.first.txindex)), entry.first.txhash);
+    }
+}
+
 bool CBlockTreeDB::WriteAddressIndex(const std::vector<CAddressIndexDbEntry> &vect) {
-    CDBBatch batch(*this);
+    CDBBatch batch(IndexDB());
+    if (fCompactAddressIndex) {
+        uint160 launchKeyID = LaunchIndexKeyID();
+        for (std::vector<CAddressIndexDbEntry>::const_iterator it=vect.begin(); it!=vect.end(); it++)
+            WriteCompactAddressIndexEntry(batch, *it, launchKeyID);
+        return IndexDB().WriteBatch(batch);
+    }
     for (std::vector<CAddressIndexDbEntry>::const_iterator it=vect.begin(); it!=vect.end(); it++)
         batch.Write(make_pair(DB_ADDRESSINDEX, it->first), it->second);
-    return WriteBatch(batch);
+    return IndexDB().WriteBatch(batch);
 }
 
+// all entries of a transaction are erased together when its block is disconnected, so its tx number goes with them
 bool CBlockTreeDB::EraseAddressIndex(const std::vector<CAddressIndexDbEntry> &vect) {
-    CDBBatch batch(*this);
+    CDBBatch batch(IndexDB());
+    if (fCompactAddressIndex) {
+        uint160 launchKeyID = LaunchIndexKeyID();
+        for (std::vector<CAddressIndexDbEntry>::const_iterator it=vect.begin(); it!=vect.end(); it++) {
+            bool fTxid = it->first.hashBytes == launchKeyID;
+            batch.Erase(make_pair(DB_ADDRESSINDEXCOMPACT, CAddressIndexCompactKey(it->first, fTxid)));
+            if (!fTxid) {
+                batch.Erase(make_pair(DB_BLOCKTXNUMBER, CBlockTxNumberKey(it->first.blockHeight, it->first.txindex)));
+            }
+        }
+        return IndexDB().WriteBatch(batch);
+    }
     for (std::vector<CAddressIndexDbEntry>::const_iterator it=vect.begin(); it!=vect.end(); it++)
         batch.Erase(make_pair(DB_ADDRESSINDEX, it->first));
-    return WriteBatch(batch);
+    return IndexDB().WriteBatch(batch);
+}
+
+bool CBlockTreeDB::ReadCompactAddressIndex(
+        uint160 addressHash, int type,
+        std::vector<CAddressIndexDbEntry> &addressIndex,
+        int start, int end, unsigned int maxCount, const CAddressIndexKey *pAfter)
+{
+    boost::scoped_ptr<CDBIterator> pcursor(IndexDB().NewIterator());
+
+    if (pAfter && pAfter->type == (unsigned int)type && pAfter->hashBytes == addressHash &&
+        (!(start > 0 && end > 0) || pAfter->blockHeight >= start)) {
+        pcursor->Seek(make_pair(DB_ADDRESSINDEXCOMPACT, CAddressIndexCompactHeightKey(type, addressHash, pAfter->blockHeight)));
+    } else if (start > 0 && end > 0) {
+        pAfter = nullptr;
+        pcursor->Seek(make_pair(DB_ADDRESSINDEXCOMPACT, CAddressIndexCompactHeightKey(type, addressHash, start)));
+    } else {
+        pAfter = nullptr;
+        pcursor->Seek(make_pair(DB_ADDRESSINDEXCOMPACT, CAddressIndexIteratorKey(type, addressHash)));
+    }
+
+    // entries of a transaction are adjacent, so its txid is looked up once
+    CBlockTxNumberKey lastTxNumber(-1, 0);
+    uint256 lastTxid;
+
+    // entries before pAfter at its height are skipped, and so is pAfter itself
+    bool fPastAfter = pAfter == nullptr;
+
+    unsigned int count = 0;
+    while (pcursor->Valid() && (!maxCount || count < maxCount)) {
+        boost::this_thread::interruption_point();
+        try {
+            pair<char, CAddressIndexCompactKey> keyObj;
+            pcursor->GetKey(keyObj);
+            char chType = keyObj.first;
+            CAddressIndexKey &indexKey = keyObj.second.key;
+
+            if (chType != DB_ADDRESSINDEXCOMPACT || indexKey.hashBytes != addressHash || indexKey.type != (unsigned int)type) {
+                break;
+            }
+            if (end > 0 && indexKey.blockHeight > end) {
+                break;
+            }
+            if (!keyObj.second.fTxid) {
+                if (indexKey.blockHeight != lastTxNumber.blockHeight || indexKey.txindex != lastTxNumber.txindex) {
+                    lastTxNumber = CBlockTxNumberKey(indexKey.blockHeight, indexKey.txindex);
+                    if (!IndexDB().Read(make_pair(DB_BLOCKTXNUMBER, lastTxNumber), lastTxid)) {
+                        return error("failed to get txid of address index entry at height %d, tx %u", indexKey.blockHeight, indexKey.txindex);
+                    }
+                }
+                indexKey.txhash = lastTxid;
+            }
+            if (!fPastAfter) {
+                if (indexKey.blockHeight == pAfter->blockHeight && indexKey.txindex == pAfter->txindex &&
+                    indexKey.txhash == pAfter->txhash && indexKey.index == pAfter->index && indexKey.spending == pAfter->spending) {
+                    fPastAfter = true;
+                }
+                pcursor->Next();
+                continue;
+            }
+            try {
+                CAmount nValue;
+                pcursor->GetValue(nValue);
+
+                addressIndex.push_back(make_pair(indexKey, nValue));
+                count++;
+                pcursor->Next();
+            } catch (const std::exception& e) {
+                return error("failed to get address index value");
+            }
+        } catch (const std::exception& e) {
+            break;
+        }
+    }
+
+    return true;
+}
+
+// rewrites an address index of the original format in the compact format, a batch at a time with old entries erased
+// in the same batch, so an interrupted migration continues where it stopped
+bool CBlockTreeDB::MigrateAddressIndex()
+{
+    const size_t MIGRATE_BATCH_ENTRIES = 10000;
+    uint160 launchKeyID = LaunchIndexKeyID();
+    boost::scoped_ptr<CDBIterator> pcursor(IndexDB().NewIterator());
+    pcursor->Seek(DB_ADDRESSINDEX);
+
+    CDBBatch batch(IndexDB());
+    size_t batchEntries = 0;
+    uint64_t totalEntries = 0;
+
+    LogPrintf("%s: converting the address index to the compact format\n", __func__);
+    while (pcursor->Valid()) {
+        if (ShutdownRequested()) {
+            LogPrintf("%s: interrupted after %lu entries, migration continues at the next start\n", __func__, totalEntries);
+            return IndexDB().WriteBatch(batch);
+        }
+        pair<char, CAddressIndexKey> keyObj;
+        CAmount nValue;
+        if (!pcursor->GetKey(keyObj) || keyObj.first != DB_ADDRESSINDEX) {
+            break;
+        }
+        if (!pcursor->GetValue(nValue)) {
+            return error("%s: failed to read address index value", __func__);
+        }
+        WriteCompactAddressIndexEntry(batch, make_pair(keyObj.second, nValue), launchKeyID);
+        batch.Erase(keyObj);
+        pcursor->Next();
+
+        totalEntries++;
+        if (++batchEntries >= MIGRATE_BATCH_ENTRIES) {
+            if (!IndexDB().WriteBatch(batch)) {
+                return error("%s: failed to write compact address index", __func__);
+            }
+            batch.Clear();
+            batchEntries = 0;
+            if (totalEntries % (MIGRATE_BATCH_ENTRIES * 100) == 0) {
+                LogPrintf("%s: converted %lu entries\n", __func__, totalEntries);
+            }
+        }
+    }
+    if (!IndexDB().WriteBatch(batch)) {
+        return error("%s: failed to write compact address index", __func__);
+    }
+    LogPrintf("%s: converted %lu address index entries\n", __func__, totalEntries);
+    return true;
 }
 
+// when pAfter is an entry of this address in range, reading continues after it, and at most maxCount entries, if nonzero,
+// are added
 bool CBlockTreeDB::ReadAddressIndex(
         uint160 addressHash, int type,
         std::vector<CAddressIndexDbEntry> &addressIndex,
-        int start, int end)
+        int start, int end, unsigned int maxCount, const CAddressIndexKey *pAfter)
 {
-    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    if (fCompactAddressIndex) {
+        return ReadCompactAddressIndex(addressHash, type, addressIndex, start, end, maxCount, pAfter);
+    }
 
-    if (start > 0 && end > 0) {
+    boost::scoped_ptr<CDBIterator> pcursor(IndexDB().NewIterator());
+
+    if (pAfter && pAfter->type == (unsigned int)type && pAfter->hashBytes == addressHash &&
+        (!(start > 0 && end > 0) || pAfter->blockHeight >= start)) {
+        pcursor->Seek(make_pair(DB_ADDRESSINDEX, *pAfter));
+    } else if (start > 0 && end > 0) {
+        pAfter = nullptr;
         pcursor->Seek(make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(type, addressHash, start)));
     } else {
+        pAfter = nullptr;
         pcursor->Seek(make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey(type, addressHash)));
     }
 
-    while (pcursor->Valid()) {
+    unsigned int count = 0;
+    while (pcursor->Valid() && (!maxCount || count < maxCount)) {
         boost::this_thread::interruption_point();
         try {
             pair<char, CAddressIndexKey> keyObj;
@@ -404,11 +1553,17 @@ bool CBlockTreeDB::ReadAddressIndex(
                 if (end > 0 && indexKey.blockHeight > end) {
                     break;
                 }
+                if (pAfter && indexKey.blockHeight == pAfter->blockHeight && indexKey.txindex == pAfter->txindex &&
+                    indexKey.txhash == pAfter->txhash && indexKey.index == pAfter->index && indexKey.spending == pAfter->spending) {
+                    pcursor->Next();
+                    continue;
+                }
                 try {
                     CAmount nValue;
                     pcursor->GetValue(nValue);
 
                     addressIndex.push_back(make_pair(indexKey, nValue));
+                    count++;
                     pcursor->Next();
                 } catch (const std::exception& e) {
                     return error("failed to get address index value");
@@ -424,13 +1579,47 @@ bool CBlockTreeDB::ReadAddressIndex(
     return true;
 }
 
+// if pBuildHeight is set, the height through which a background build of the index is complete is written in the
+// same batch, so an interrupted build never applies a block's deltas twice
+bool CBlockTreeDB::UpdateAddressBalanceIndex(const std::vector<CAddressBalanceDbEntry> &deltas, bool disconnect, const int *pBuildHeight) {
+    CDBBatch batch(IndexDB());
+    if (pBuildHeight) {
+        batch.Write(make_pair(DB_INDEXBUILDHEIGHT, std::string("addressbalanceindex")), *pBuildHeight);
+    }
+    for (std::vector<CAddressBalanceDbEntry>::const_iterator it=deltas.begin(); it!=deltas.end(); it++) {
+        CAddressBalanceValue balance;
+        if (!IndexDB().Read(make_pair(DB_ADDRESSBALANCEINDEX, it->first), balance)) {
+            balance.SetNull();
+        }
+        if (disconnect) {
+            balance -= it->second;
+        } else {
+            balance += it->second;
+        }
+        // an address is only back to nothing when its first receipt is disconnected
+        if (balance.IsNull()) {
+            batch.Erase(make_pair(DB_ADDRESSBALANCEINDEX, it->first));
+        } else {
+            batch.Write(make_pair(DB_ADDRESSBALANCEINDEX, it->first), balance);
+        }
+    }
+    return IndexDB().WriteBatch(batch);
+}
+
+bool CBlockTreeDB::ReadAddressBalanceIndex(uint160 addressHash, int type, CAddressBalanceValue &balance) {
+    if (!IndexDB().Read(make_pair(DB_ADDRESSBALANCEINDEX, CAddressIndexIteratorKey(type, addressHash)), balance)) {
+        balance.SetNull();
+    }
+    return true;
+}
+
 bool getAddressFromIndex(const int &type, const uint160 &hash, std::string &address);
 
 UniValue CBlockTreeDB::Snapshot(int top)
 {
     int64_t total = 0; int64_t totalAddresses = 0; std::string address;
     int64_t utxos = 0; int64_t ignoredAddresses;
-    boost::scoped_ptr<CDBIterator> iter(NewIterator());
+    boost::scoped_ptr<CDBIterator> iter(IndexDB().NewIterator());
     std::map <std::string, CAmount> addressAmounts;
     std::vector <std::pair<CAmount, std::string>> vaddr;
     UniValue result(UniValue::VOBJ);
@@ -561,14 +1750,14 @@ UniValue CBlockTreeDB::Snapshot(int top)
 }
 
 bool CBlockTreeDB::WriteTimestampIndex(const CTimestampIndexKey &timestampIndex) {
-    CDBBatch batch(*this);
+    CDBBatch batch(IndexDB());
     batch.Write(make_pair(DB_TIMESTAMPINDEX, timestampIndex), 0);
-    return WriteBatch(batch);
+    return IndexDB().WriteBatch(batch);
 }
 
 bool CBlockTreeDB::ReadTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes)
 {
-    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    boost::scoped_ptr<CDBIterator> pcursor(IndexDB().NewIterator());
 
     pcursor->Seek(make_pair(DB_TIMESTAMPINDEX, CTimestampIndexIteratorKey(low)));
 
@@ -602,21 +1791,434 @@ bool CBlockTreeDB::ReadTimestampIndex(const unsigned int &high, const unsigned i
 }
 
 bool CBlockTreeDB::WriteTimestampBlockIndex(const CTimestampBlockIndexKey &blockhashIndex, const CTimestampBlockIndexValue &logicalts) {
-    CDBBatch batch(*this);
+    CDBBatch batch(IndexDB());
     batch.Write(make_pair(DB_BLOCKHASHINDEX, blockhashIndex), logicalts);
-    return WriteBatch(batch);
+    return IndexDB().WriteBatch(batch);
 }
 
 bool CBlockTreeDB::ReadTimestampBlockIndex(const uint256 &hash, unsigned int &ltimestamp) {
 
     CTimestampBlockIndexValue(lts);
-    if (!Read(std::make_pair(DB_BLOCKHASHINDEX, hash), lts))
+    if (!IndexDB().Read(std::make_pair(DB_BLOCKHASHINDEX, hash), lts))
 	    return false;
 
     ltimestamp = lts.ltimestamp;
     return true;
 }
 
+// currency states are stored with the hash of the block they were calculated at, and entries of blocks that
+// are no longer on the active chain are ignored, even if they were not erased on disconnect
+bool CBlockTreeDB::ReadCurrencyStateIndex(const uint160 &currencyID, int height, bool pendingTransfers, const uint256 &blockHash, CCoinbaseCurrencyState &currencyState) {
+    std::pair<uint256, CCoinbaseCurrencyState> value;
+    if (!Read(make_pair(DB_CURRENCYSTATEINDEX, CCurrencyStateIndexKey(height, currencyID, pendingTransfers)), value) ||
+        value.first != blockHash)
+        return false;
+    currencyState = value.second;
+    return true;
+}
+
+bool CBlockTreeDB::WriteCurrencyStateIndex(const uint160 &currencyID, int height, bool pendingTransfers, const uint256 &blockHash, const CCoinbaseCurrencyState &currencyState) {
+    return Write(make_pair(DB_CURRENCYSTATEINDEX, CCurrencyStateIndexKey(height, currencyID, pendingTransfers)), make_pair(blockHash, currencyState));
+}
+
+bool CBlockTreeDB::EraseCurrencyStateIndex(int height) {
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    CDBBatch batch(*this);
+
+    pcursor->Seek(make_pair(DB_CURRENCYSTATEINDEX, CCurrencyStateIndexIteratorKey(height)));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, CCurrencyStateIndexKey> key;
+        if (pcursor->GetKey(key) && key.first == DB_CURRENCYSTATEINDEX && key.second.height == (unsigned int)height) {
+            batch.Erase(key);
+            pcursor->Next();
+        } else {
+            break;
+        }
+    }
+    return WriteBatch(batch);
+}
+
+// every reserve transfer stays in the reserve transfer index, and is in the pending transfer index until it is spent.
+// disconnecting restores the transfers spent in the block before removing those it created.
+bool CBlockTreeDB::UpdateReserveTransferIndex(const std::vector<CReserveTransferIndexEntry> &created, const std::vector<CReserveTransferIndexEntry> &spent, bool disconnect) {
+    CDBBatch batch(*this);
+    if (disconnect) {
+        for (auto &oneTransfer : spent)
+            batch.Write(make_pair(DB_PENDINGTRANSFERINDEX, oneTransfer.first), oneTransfer.second);
+        for (auto &oneTransfer : created) {
+            batch.Erase(make_pair(DB_RESERVETRANSFERINDEX, oneTransfer.first));
+            batch.Erase(make_pair(DB_PENDINGTRANSFERINDEX, oneTransfer.first));
+        }
+    } else {
+        for (auto &oneTransfer : created) {
+            batch.Write(make_pair(DB_RESERVETRANSFERINDEX, oneTransfer.first), oneTransfer.second);
+            batch.Write(make_pair(DB_PENDINGTRANSFERINDEX, oneTransfer.first), oneTransfer.second);
+        }
+        for (auto &oneTransfer : spent)
+            batch.Erase(make_pair(DB_PENDINGTRANSFERINDEX, oneTransfer.first));
+    }
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::ReadReserveTransferIndex(const uint160 &currencyID, std::vector<CReserveTransferIndexEntry> &transfers, int start, int end, bool pendingOnly) {
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    char dbType = pendingOnly ? DB_PENDINGTRANSFERINDEX : DB_RESERVETRANSFERINDEX;
+
+    pcursor->Seek(make_pair(dbType, CReserveTransferIndexIteratorKey(currencyID, (start > 0 && end > 0) ? start : 0)));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, CReserveTransferIndexKey> key;
+        if (!pcursor->GetKey(key) || key.first != dbType || key.second.currencyID != currencyID ||
+            (end > 0 && key.second.height > (unsigned int)end)) {
+            break;
+        }
+        std::pair<CInputDescriptor, CReserveTransfer> value;
+        if (!pcursor->GetValue(value)) {
+            return error("failed to get reserve transfer index value");
+        }
+        transfers.push_back(make_pair(key.second, value));
+        pcursor->Next();
+    }
+    return true;
+}
+
+// identities cannot be destroyed, so the latest entry for an identity is always its unspent output, and one index serves
+// both the current state and the history of every identity. the reverse and content index entries of each state are kept
+// with it.
+bool CBlockTreeDB::UpdateIdentityStateIndex(const std::vector<CIdentityStateIndexEntry> &identities, const std::vector<CIdentityCommitmentIndexEntry> &commitments, bool disconnect) {
+    CDBBatch batch(*this);
+    for (auto &oneCommitment : commitments) {
+        if (disconnect)
+            batch.Erase(make_pair(DB_IDENTITYCOMMITMENTINDEX, oneCommitment.first));
+        else
+            batch.Write(make_pair(DB_IDENTITYCOMMITMENTINDEX, oneCommitment.first), oneCommitment.second);
+    }
+    for (auto &oneIdentity : identities) {
+        const CIdentityStateIndexKey &key = oneIdentity.first;
+        if (disconnect)
+            batch.Erase(make_pair(DB_IDENTITYSTATEINDEX, key));
+        else
+            batch.Write(make_pair(DB_IDENTITYSTATEINDEX, key), oneIdentity.second);
+        for (auto &oneReverseKey : oneIdentity.second.second.ReverseIndexKeys()) {
+            CIdentityReverseIndexKey reverseKey(oneReverseKey, key.height, key.txindex, key.index);
+            if (disconnect)
+                batch.Erase(make_pair(DB_IDENTITYREVERSEINDEX, reverseKey));
+            else
+                batch.Write(make_pair(DB_IDENTITYREVERSEINDEX, reverseKey), key.identityID);
+        }
+        const auto &contentMultiMap = oneIdentity.second.second.contentMultiMap;
+        for (auto it = contentMultiMap.begin(); it != contentMultiMap.end(); it = contentMultiMap.upper_bound(it->first)) {
+            CIdentityContentIndexKey contentKey(key.identityID, it->first, key.height, key.txindex, key.index);
+            if (disconnect)
+                batch.Erase(make_pair(DB_IDENTITYCONTENTINDEX, contentKey));
+            else
+                batch.Write(make_pair(DB_IDENTITYCONTENTINDEX, contentKey), true);
+        }
+    }
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::UpdateKVIndex(const std::vector<CKVIndexEntry> &entries, bool disconnect) {
+    CDBBatch batch(*this);
+    for (auto &oneEntry : entries) {
+        if (disconnect)
+            batch.Erase(make_pair(DB_KVINDEX, oneEntry.first));
+        else
+            batch.Write(make_pair(DB_KVINDEX, oneEntry.first), oneEntry.second);
+    }
+    return WriteBatch(batch);
+}
+
+// reads the latest update of the key at or below height, or the latest overall if height is 0
+bool CBlockTreeDB::ReadKVIndex(const uint256 &keyHash, unsigned int height, CKVIndexEntry &entry) {
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(make_pair(DB_KVINDEX, CKVIndexIteratorKey(keyHash, height ? height + 1 : UINT_MAX)));
+    if (pcursor->Valid()) {
+        pcursor->Prev();
+    } else {
+        pcursor->SeekToLast();
+    }
+
+    std::pair<char, CKVIndexKey> key;
+    if (!pcursor->Valid() || !pcursor->GetKey(key) || key.first != DB_KVINDEX || key.second.keyHash != keyHash) {
+        return false;
+    }
+    CKVIndexValue value;
+    if (!pcursor->GetValue(value)) {
+        return error("failed to get key value index value");
+    }
+    entry = make_pair(key.second, value);
+    return true;
+}
+
+// reads the updates of the key below beforeHeight (0 for all), newest first. a page ends with all of the updates at the
+// height of its last one, so the next page can start below that height without missing any.
+bool CBlockTreeDB::ReadKVIndex(const uint256 &keyHash, std::vector<CKVIndexEntry> &entries, unsigned int maxCount, unsigned int beforeHeight) {
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(make_pair(DB_KVINDEX, CKVIndexIteratorKey(keyHash, beforeHeight ? beforeHeight : UINT_MAX)));
+    if (pcursor->Valid()) {
+        pcursor->Prev();
+    } else {
+        pcursor->SeekToLast();
+    }
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, CKVIndexKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_KVINDEX || key.second.keyHash != keyHash ||
+            (maxCount && entries.size() >= maxCount && key.second.height != entries.back().first.height)) {
+            break;
+        }
+        CKVIndexValue value;
+        if (!pcursor->GetValue(value)) {
+            return error("failed to get key value index value");
+        }
+        entries.push_back(make_pair(key.second, value));
+        pcursor->Prev();
+    }
+    return true;
+}
+
+// reads the latest entry for the identity at or below height, or the latest overall if height is 0
+bool CBlockTreeDB::ReadIdentityStateIndex(const uint160 &identityID, unsigned int height, CIdentityStateIndexEntry &identity) {
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(make_pair(DB_IDENTITYSTATEINDEX, CIdentityStateIndexIteratorKey(identityID, height ? height + 1 : UINT_MAX)));
+    if (pcursor->Valid()) {
+        pcursor->Prev();
+    } else {
+        pcursor->SeekToLast();
+    }
+
+    std::pair<char, CIdentityStateIndexKey> key;
+    if (!pcursor->Valid() || !pcursor->GetKey(key) || key.first != DB_IDENTITYSTATEINDEX || key.second.identityID != identityID) {
+        return false;
+    }
+    std::pair<uint256, CIdentity> value;
+    if (!pcursor->GetValue(value)) {
+        return error("failed to get identity state index value");
+    }
+    identity = make_pair(key.second, value);
+    return true;
+}
+
+// reads up to maxCount entries (0 for all) in chain order, starting after the entry pAfter, if specified, so history can
+// be read in pages without loading all of it
+bool CBlockTreeDB::ReadIdentityStateIndex(const uint160 &identityID, std::vector<CIdentityStateIndexEntry> &identities, int start, int end, unsigned int maxCount, const CIdentityStateIndexKey *pAfter) {
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    if (pAfter && pAfter->identityID == identityID && (start <= 0 || pAfter->height >= (unsigned int)start)) {
+        pcursor->Seek(make_pair(DB_IDENTITYSTATEINDEX, *pAfter));
+    } else {
+        pAfter = nullptr;
+        pcursor->Seek(make_pair(DB_IDENTITYSTATEINDEX, CIdentityStateIndexIteratorKey(identityID, start > 0 ? start : 0)));
+    }
+
+    while (pcursor->Valid() && (!maxCount || identities.size() < maxCount)) {
+        boost::this_thread::interruption_point();
+        std::pair<char, CIdentityStateIndexKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_IDENTITYSTATEINDEX || key.second.identityID != identityID ||
+            (end > 0 && key.second.height > (unsigned int)end)) {
+            break;
+        }
+        if (pAfter && key.second.height == pAfter->height && key.second.txindex == pAfter->txindex && key.second.index == pAfter->index) {
+            pcursor->Next();
+            continue;
+        }
+        std::pair<uint256, CIdentity> value;
+        if (!pcursor->GetValue(value)) {
+            return error("failed to get identity state index value");
+        }
+        identities.push_back(make_pair(key.second, value));
+        pcursor->Next();
+    }
+    return true;
+}
+
+// reads the latest entry at or below height of each identity, which are read in key order with one iterator. identities
+// that are not found have no entry.
+bool CBlockTreeDB::ReadIdentityStateIndex(std::vector<uint160> identityIDs, unsigned int height, std::vector<CIdentityStateIndexEntry> &identities) {
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    std::sort(identityIDs.begin(), identityIDs.end());
+    identityIDs.erase(std::unique(identityIDs.begin(), identityIDs.end()), identityIDs.end());
+
+    for (auto &identityID : identityIDs) {
+        boost::this_thread::interruption_point();
+        pcursor->Seek(make_pair(DB_IDENTITYSTATEINDEX, CIdentityStateIndexIteratorKey(identityID, height ? height + 1 : UINT_MAX)));
+        if (pcursor->Valid()) {
+            pcursor->Prev();
+        } else {
+            pcursor->SeekToLast();
+        }
+
+        std::pair<char, CIdentityStateIndexKey> key;
+        if (!pcursor->Valid() || !pcursor->GetKey(key) || key.first != DB_IDENTITYSTATEINDEX || key.second.identityID != identityID) {
+            continue;
+        }
+        std::pair<uint256, CIdentity> value;
+        if (!pcursor->GetValue(value)) {
+            return error("failed to get identity state index value");
+        }
+        identities.push_back(make_pair(key.second, value));
+    }
+    return true;
+}
+
+// reads the ID of every identity in the index, seeking past all states of each identity after reading its first one
+bool CBlockTreeDB::ReadIdentityStateIndexIDs(std::vector<uint160> &identityIDs) {
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(make_pair(DB_IDENTITYSTATEINDEX, CIdentityStateIndexIteratorKey()));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, CIdentityStateIndexKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_IDENTITYSTATEINDEX) {
+            break;
+        }
+        identityIDs.push_back(key.second.identityID);
+        pcursor->Seek(make_pair(DB_IDENTITYSTATEINDEX, CIdentityStateIndexIteratorKey(key.second.identityID, UINT_MAX)));
+    }
+    return true;
+}
+
+// reads all outputs in the chain with a name commitment of this hash, in chain order
+bool CBlockTreeDB::ReadIdentityCommitmentIndex(const uint256 &commitmentHash, std::vector<CIdentityCommitmentIndexEntry> &commitments) {
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(make_pair(DB_IDENTITYCOMMITMENTINDEX, CIdentityCommitmentIndexIteratorKey(commitmentHash)));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, CIdentityCommitmentIndexKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_IDENTITYCOMMITMENTINDEX || key.second.commitmentHash != commitmentHash) {
+            break;
+        }
+        uint256 txHash;
+        if (!pcursor->GetValue(txHash)) {
+            return error("failed to get identity commitment index value");
+        }
+        commitments.push_back(make_pair(key.second, txHash));
+        pcursor->Next();
+    }
+    return true;
+}
+
+// reads the identity states of one identity that have content under any of the VDXF keys, in chain order
+bool CBlockTreeDB::ReadIdentityContentIndex(const uint160 &identityID, const std::vector<uint160> &vdxfKeys, std::vector<CIdentityStateIndexEntry> &identities, int start, int end) {
+    std::set<std::tuple<unsigned int, unsigned int, unsigned int>> positions;
+
+    for (auto &oneKey : vdxfKeys) {
+        boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+        pcursor->Seek(make_pair(DB_IDENTITYCONTENTINDEX, CIdentityContentIndexIteratorKey(identityID, oneKey, start > 0 ? start : 0)));
+
+        while (pcursor->Valid()) {
+            boost::this_thread::interruption_point();
+            std::pair<char, CIdentityContentIndexKey> key;
+            if (!pcursor->GetKey(key) || key.first != DB_IDENTITYCONTENTINDEX || key.second.identityID != identityID || key.second.vdxfKey != oneKey ||
+                (end > 0 && key.second.height > (unsigned int)end)) {
+                break;
+            }
+            positions.insert(std::make_tuple(key.second.height, key.second.txindex, key.second.index));
+            pcursor->Next();
+        }
+    }
+
+    for (auto &onePosition : positions) {
+        CIdentityStateIndexKey stateKey(identityID, std::get<0>(onePosition), std::get<1>(onePosition), std::get<2>(onePosition));
+        std::pair<uint256, CIdentity> value;
+        if (!Read(make_pair(DB_IDENTITYSTATEINDEX, stateKey), value)) {
+            return error("failed to get identity state for content index entry");
+        }
+        identities.push_back(make_pair(stateKey, value));
+    }
+    return true;
+}
+
+// reads the identity states with a reverse index key in chain order, with the same paging as ReadIdentityStateIndex.
+// if currentOnly is true, only states that are still the latest state of their identity are returned.
+bool CBlockTreeDB::ReadIdentityReverseIndex(const uint160 &reverseKey, std::vector<CIdentityStateIndexEntry> &identities, int start, int end, bool currentOnly, unsigned int maxCount, const CIdentityStateIndexKey *pAfter) {
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    if (pAfter && (start <= 0 || pAfter->height >= (unsigned int)start)) {
+        pcursor->Seek(make_pair(DB_IDENTITYREVERSEINDEX, CIdentityReverseIndexKey(reverseKey, pAfter->height, pAfter->txindex, pAfter->index)));
+    } else {
+        pAfter = nullptr;
+        pcursor->Seek(make_pair(DB_IDENTITYREVERSEINDEX, CIdentityReverseIndexIteratorKey(reverseKey, start > 0 ? start : 0)));
+    }
+
+    while (pcursor->Valid() && (!maxCount || identities.size() < maxCount)) {
+        boost::this_thread::interruption_point();
+        std::pair<char, CIdentityReverseIndexKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_IDENTITYREVERSEINDEX || key.second.reverseKey != reverseKey ||
+            (end > 0 && key.second.height > (unsigned int)end)) {
+            break;
+        }
+        if (pAfter && key.second.height == pAfter->height && key.second.txindex == pAfter->txindex && key.second.index == pAfter->index) {
+            pcursor->Next();
+            continue;
+        }
+        uint160 identityID;
+        if (!pcursor->GetValue(identityID)) {
+            return error("failed to get identity reverse index value");
+        }
+        CIdentityStateIndexKey stateKey(identityID, key.second.height, key.second.txindex, key.second.index);
+        CIdentityStateIndexEntry currentState;
+        if (currentOnly) {
+            if (!ReadIdentityStateIndex(identityID, 0, currentState)) {
+                return error("failed to get current identity state for reverse index entry");
+            }
+            if (currentState.first.height != stateKey.height ||
+                currentState.first.txindex != stateKey.txindex ||
+                currentState.first.index != stateKey.index) {
+                pcursor->Next();
+                continue;
+            }
+            identities.push_back(currentState);
+        } else {
+            std::pair<uint256, CIdentity> value;
+            if (!Read(make_pair(DB_IDENTITYSTATEINDEX, stateKey), value)) {
+                return error("failed to get identity state for reverse index entry");
+            }
+            identities.push_back(make_pair(stateKey, value));
+        }
+        pcursor->Next();
+    }
+    return true;
+}
+
+bool CBlockTreeDB::CheckCurrencyStateIndexVersion() {
+    uint32_t nVersion = 0;
+    if (Read(std::make_pair(DB_FLAG, std::string("currencystateindexversion")), nVersion) &&
+        nVersion == CURRENCY_STATE_INDEX_VERSION)
+        return true;
+
+    // the keys are erased as stored, since those of another version may not read as this one's
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    CDBBatch batch(*this);
+    size_t nErased = 0;
+    pcursor->Seek(DB_CURRENCYSTATEINDEX);
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::string key = pcursor->GetKeyBytes();
+        if (key.empty() || key[0] != DB_CURRENCYSTATEINDEX)
+            break;
+        batch.Erase(CFlatData(&key[0], &key[0] + key.size()));
+        nErased++;
+        pcursor->Next();
+    }
+    batch.Write(std::make_pair(DB_FLAG, std::string("currencystateindexversion")), CURRENCY_STATE_INDEX_VERSION);
+    if (nErased)
+        LogPrintf("Erased %u currency state index entries of version %u\n", nErased, nVersion);
+    return WriteBatch(batch, true);
+}
+
 bool CBlockTreeDB::WriteFlag(const std::string &name, bool fValue) {
     return Write(std::make_pair(DB_FLAG, name), fValue ? '1' : '0');
 }
@@ -629,6 +2231,19 @@ bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
     return true;
 }
 
+// an index with a build height is being filled in by the background index builder, and is complete through that height
+bool CBlockTreeDB::WriteIndexBuildHeight(const std::string &name, int height) {
+    return IndexDB().Write(std::make_pair(DB_INDEXBUILDHEIGHT, name), height);
+}
+
+bool CBlockTreeDB::ReadIndexBuildHeight(const std::string &name, int &height) {
+    return IndexDB().Read(std::make_pair(DB_INDEXBUILDHEIGHT, name), height);
+}
+
+bool CBlockTreeDB::EraseIndexBuildHeight(const std::string &name) {
+    return IndexDB().Erase(std::make_pair(DB_INDEXBUILDHEIGHT, name));
+}
+
 void komodo_index2pubkey33(uint8_t *pubkey33,CBlockIndex *pindex,int32_t height);
 
 bool CBlockTreeDB::blockOnchainActive(const uint256 &hash) {
@@ -642,75 +2257,137 @@ bool CBlockTreeDB::blockOnchainActive(const uint256 &hash) {
     return true;
 }
 
+// deserializes a block index record and hashes its header, which is most of the cost of loading the block index
+static bool DecodeBlockIndexRecord(const std::string &value, CDiskBlockIndex &diskindex, uint256 &hash)
+{
+    // fields missing from the record must keep their defaults
+    diskindex = CDiskBlockIndex();
+    try
+    {
+        CDataStream ssValue(value.data(), value.data() + value.size(), SER_DISK, CLIENT_VERSION);
+        ssValue >> diskindex;
+    }
+    catch (const std::exception &e)
+    {
+        return false;
+    }
+    hash = diskindex.GetBlockHash();
+    return true;
+}
+
 bool CBlockTreeDB::LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256&)> insertBlockIndex)
 {
+    // records are read from LevelDB in batches on this thread. while one batch is read, the previous one is
+    // deserialized and hashed on all cores, and only inserting into the block index remains sequential
+    static const size_t LOAD_BATCH_SIZE = 4096;
+
     boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
 
     pcursor->Seek(make_pair(DB_BLOCK_INDEX, uint256()));
 
+    // the hash each record is stored under is kept to check it against the hash of the header read from the record
+    auto readBatch = [&pcursor](std::vector<std::string> &values, std::vector<uint256> &keyHashes)
+    {
+        values.clear();
+        keyHashes.clear();
+        while (values.size() < LOAD_BATCH_SIZE && pcursor->Valid())
+        {
+            std::pair<char, uint256> key;
+            if (!pcursor->GetKey(key) || key.first != DB_BLOCK_INDEX)
+            {
+                break;
+            }
+            values.push_back(pcursor->GetValueBytes());
+            keyHashes.push_back(key.second);
+            pcursor->Next();
+        }
+    };
+
+    size_t nThreads = std::max(GetNumCores(), 1);
+    std::vector<std::string> values, nextValues;
+    std::vector<uint256> keyHashes, nextKeyHashes;
+    std::vector<CDiskBlockIndex> diskindexes(LOAD_BATCH_SIZE);
+    std::vector<uint256> hashes(LOAD_BATCH_SIZE);
+    std::vector<unsigned char> decoded(LOAD_BATCH_SIZE);
+
     // Load mapBlockIndex
-    while (pcursor->Valid()) {
+    for (readBatch(values, keyHashes); !values.empty(); values.swap(nextValues), keyHashes.swap(nextKeyHashes))
+    {
+        // not while decoding, the threads use this frame
         boost::this_thread::interruption_point();
-        std::pair<char, uint256> key;
-        if (pcursor->GetKey(key) && key.first == DB_BLOCK_INDEX) {
-            CDiskBlockIndex diskindex;
-            if (pcursor->GetValue(diskindex)) {
-                // Construct block index object
-#ifdef VERUSHASHDEBUG
-                if (diskindex.nVersion == CBlockHeader::VERUS_V2)
-                {
-                    printf("VerusHash 2.0 block header: %s\n", diskindex.ToString().c_str());
-                }
-#endif
-                CBlockIndex* pindexNew    = insertBlockIndex(diskindex.GetBlockHash());
-                pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
-                pindexNew->SetHeight(diskindex.GetHeight());
-                pindexNew->nFile          = diskindex.nFile;
-                pindexNew->nDataPos       = diskindex.nDataPos;
-                pindexNew->nUndoPos       = diskindex.nUndoPos;
-                pindexNew->hashSproutAnchor     = diskindex.hashSproutAnchor;
-                pindexNew->nVersion       = diskindex.nVersion;
-                pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
-                pindexNew->hashFinalSaplingRoot   = diskindex.hashFinalSaplingRoot;
-                pindexNew->nTime          = diskindex.nTime;
-                pindexNew->nBits          = diskindex.nBits;
-                pindexNew->nNonce         = diskindex.nNonce;
-                pindexNew->nSolution      = diskindex.nSolution;
-                pindexNew->nStatus        = diskindex.nStatus;
-                pindexNew->nCachedBranchId = diskindex.nCachedBranchId;
-                pindexNew->nTx            = diskindex.nTx;
-                pindexNew->nSproutValue   = diskindex.nSproutValue;
-                pindexNew->nSaplingValue  = diskindex.nSaplingValue;
-
-                // Consistency checks
-                auto header = pindexNew->GetBlockHeader();
-                uint256 hash = header.GetHash();
-                if (diskindex.hashPrev.IsNull() && hash != Params().consensus.hashGenesisBlock)
-                {
-                    return error("LoadBlockIndex(): prior block hash NULL on non-genesis block: %s\n", diskindex.ToString());
-                }
-
-                if (hash != pindexNew->GetBlockHash())
+        {
+            size_t nPerThread = (values.size() + nThreads - 1) / nThreads;
+            boost::thread_group decodeThreads;
+            for (size_t begin = 0; begin < values.size(); begin += nPerThread)
+            {
+                size_t end = std::min(begin + nPerThread, values.size());
+                decodeThreads.create_thread([&values, &diskindexes, &hashes, &decoded, begin, end]()
                 {
-                    printf("Error -- hashes don't match.\nheader.GetHash: %s\nGetBlockHash(): %s\non disk: %s\nin memory: %s\n",
-                           hash.GetHex().c_str(), pindexNew->GetBlockHash().GetHex().c_str(), diskindex.ToString().c_str(),  pindexNew->ToString().c_str());
-                    return error("LoadBlockIndex(): block header inconsistency detected: on-disk = %s, in-memory = %s",
-                                 diskindex.ToString(),  pindexNew->ToString());
-                }
+                    for (size_t i = begin; i < end; i++)
+                    {
+                        decoded[i] = DecodeBlockIndexRecord(values[i], diskindexes[i], hashes[i]);
+                    }
+                });
+            }
+            readBatch(nextValues, nextKeyHashes);
+            decodeThreads.join_all();
+        }
 
-                if ( 0 ) // POW will be checked before any block is connected
-                {
-                    uint8_t pubkey33[33];
-                    komodo_index2pubkey33(pubkey33,pindexNew,pindexNew->GetHeight());
-                    if (!CheckProofOfWork(header,pubkey33,pindexNew->GetHeight(),Params().GetConsensus()))
-                        return error("LoadBlockIndex(): CheckProofOfWork failed: %s", pindexNew->ToString());
-                }
-                pcursor->Next();
-            } else {
+        for (size_t i = 0; i < values.size(); i++)
+        {
+            if (!decoded[i])
+            {
                 return error("LoadBlockIndex() : failed to read value");
             }
-        } else {
-            break;
+
+            const CDiskBlockIndex &diskindex = diskindexes[i];
+
+            // Consistency checks. a record must be stored under the hash of its own header, and only the genesis
+            // block may have no prior block
+            if (hashes[i] != keyHashes[i])
+            {
+                return error("LoadBlockIndex(): block index record stored under %s has header hash %s: %s",
+                             keyHashes[i].GetHex(), hashes[i].GetHex(), diskindex.ToString());
+            }
+            if (diskindex.hashPrev.IsNull() && hashes[i] != Params().consensus.hashGenesisBlock)
+            {
+                return error("LoadBlockIndex(): prior block hash NULL on non-genesis block: %s\n", diskindex.ToString());
+            }
+
+            // Construct block index object
+#ifdef VERUSHASHDEBUG
+            if (diskindex.nVersion == CBlockHeader::VERUS_V2)
+            {
+                printf("VerusHash 2.0 block header: %s\n", diskindex.ToString().c_str());
+            }
+#endif
+            CBlockIndex* pindexNew    = insertBlockIndex(hashes[i]);
+            pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
+            pindexNew->SetHeight(diskindex.GetHeight());
+            pindexNew->nFile          = diskindex.nFile;
+            pindexNew->nDataPos       = diskindex.nDataPos;
+            pindexNew->nUndoPos       = diskindex.nUndoPos;
+            pindexNew->hashSproutAnchor     = diskindex.hashSproutAnchor;
+            pindexNew->nVersion       = diskindex.nVersion;
+            pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
+            pindexNew->hashFinalSaplingRoot   = diskindex.hashFinalSaplingRoot;
+            pindexNew->nTime          = diskindex.nTime;
+            pindexNew->nBits          = diskindex.nBits;
+            pindexNew->nNonce         = diskindex.nNonce;
+            pindexNew->nSolution      = diskindex.nSolution;
+            pindexNew->nStatus        = diskindex.nStatus;
+            pindexNew->nCachedBranchId = diskindex.nCachedBranchId;
+            pindexNew->nTx            = diskindex.nTx;
+            pindexNew->nSproutValue   = diskindex.nSproutValue;
+            pindexNew->nSaplingValue  = diskindex.nSaplingValue;
+
+            if ( 0 ) // POW will be checked before any block is connected
+            {
+                uint8_t pubkey33[33];
+                komodo_index2pubkey33(pubkey33,pindexNew,pindexNew->GetHeight());
+                if (!CheckProofOfWork(pindexNew->GetBlockHeader(),pubkey33,pindexNew->GetHeight(),Params().GetConsensus()))
+                    return error("LoadBlockIndex(): CheckProofOfWork failed: %s", pindexNew->ToString());
+            }
         }
     }
 
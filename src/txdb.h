@@ -9,14 +9,21 @@
 #include "coins.h"
 #include "dbwrapper.h"
 #include "chain.h"
+#include "identitystateindex.h"
+#include "kvindex.h"
+#include "nullifierfilter.h"
+#include "reservetransferindex.h"
+#include "sync.h"
 
 #include <map>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 #include <univalue.h>
 
 #include <boost/function.hpp>
+#include <boost/thread.hpp>
 
 class CBlockIndex;
 struct CDiskTxPos;
@@ -25,8 +32,14 @@ struct CAddressUnspentValue;
 struct CAddressIndexKey;
 struct CAddressIndexIteratorKey;
 struct CAddressIndexIteratorHeightKey;
+struct CAddressBalanceValue;
 struct CSpentIndexKey;
 struct CSpentIndexValue;
+struct CBlockDeltaSummary;
+struct CBlockStats;
+struct CBlockFilterIndexEntry;
+struct CPrunedBlockProofs;
+struct CUTXOSetStats;
 struct CTimestampIndexKey;
 struct CTimestampIndexIteratorKey;
 struct CTimestampBlockIndexKey;
@@ -34,6 +47,7 @@ struct CTimestampBlockIndexValue;
 
 typedef std::pair<CAddressUnspentKey, CAddressUnspentValue> CAddressUnspentDbEntry;
 typedef std::pair<CAddressIndexKey, CAmount> CAddressIndexDbEntry;
+typedef std::pair<CAddressIndexIteratorKey, CAddressBalanceValue> CAddressBalanceDbEntry;
 typedef std::pair<CSpentIndexKey, CSpentIndexValue> CSpentIndexDbEntry;
 
 class uint256;
@@ -44,20 +58,39 @@ static const int64_t nDefaultDbCache = 450;
 static const int64_t nMaxDbCache = sizeof(void*) > 4 ? 16384 : 1024;
 //! min. -dbcache in (MiB)
 static const int64_t nMinDbCache = 4;
+//! -separateindexdb default
+static const bool DEFAULT_SEPARATE_INDEX_DB = false;
+//! -indexdbbloombits default
+static const int DEFAULT_INDEX_DB_BLOOM_BITS = 10;
+//! -indexdbblocksize default (bytes)
+static const int64_t DEFAULT_INDEX_DB_BLOCK_SIZE = 16384;
 
 struct CDiskTxPos : public CDiskBlockPos
 {
     unsigned int nTxOffset; // after header
+    unsigned int nTxSize;   // serialized size, 0 in entries written before it was stored
 
-    ADD_SERIALIZE_METHODS;
+    // the size follows the offset only in entries that have it, so entries of either form are read, and a tx index
+    // written before the size was stored needs no reindex
+    template <typename Stream>
+    void Serialize(Stream& s) const {
+        ::Serialize(s, *(const CDiskBlockPos*)this);
+        ::Serialize(s, VARINT(nTxOffset));
+        if (nTxSize)
+            ::Serialize(s, VARINT(nTxSize));
+    }
 
-    template <typename Stream, typename Operation>
-    inline void SerializationOp(Stream& s, Operation ser_action) {
-        READWRITE(*(CDiskBlockPos*)this);
-        READWRITE(VARINT(nTxOffset));
+    // only ever read from a database value, which ends with the entry
+    template <typename Stream>
+    void Unserialize(Stream& s) {
+        ::Unserialize(s, *(CDiskBlockPos*)this);
+        ::Unserialize(s, VARINT(nTxOffset));
+        nTxSize = 0;
+        if (!s.empty())
+            ::Unserialize(s, VARINT(nTxSize));
     }
 
-    CDiskTxPos(const CDiskBlockPos &blockIn, unsigned int nTxOffsetIn) : CDiskBlockPos(blockIn.nFile, blockIn.nPos), nTxOffset(nTxOffsetIn) {
+    CDiskTxPos(const CDiskBlockPos &blockIn, unsigned int nTxOffsetIn) : CDiskBlockPos(blockIn.nFile, blockIn.nPos), nTxOffset(nTxOffsetIn), nTxSize(0) {
     }
 
     CDiskTxPos() {
@@ -67,6 +100,7 @@ struct CDiskTxPos : public CDiskBlockPos
     void SetNull() {
         CDiskBlockPos::SetNull();
         nTxOffset = 0;
+        nTxSize = 0;
     }
 };
 
@@ -76,13 +110,62 @@ class CCoinsViewDB : public CCoinsView
 protected:
     CDBWrapper db;
     CCoinsViewDB(std::string dbName, size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+    // the changes of one flush, kept readable in memory while they are written in the background
+    struct CPendingWrite
+    {
+        CCoinsMapMemoryResource coinsResource;
+        CCoinsMap coins;
+        CAnchorsSproutMap sproutAnchors;
+        CAnchorsSaplingMap saplingAnchors;
+        CNullifiersMap sproutNullifiers;
+        CNullifiersMap saplingNullifiers;
+        uint256 hashBlock;
+        uint256 hashSproutAnchor;
+        uint256 hashSaplingAnchor;
+
+        CPendingWrite() : coins(0, CCoinsKeyHasher(), std::equal_to<uint256>(), CCoinsMapAllocator(&coinsResource)) {}
+    };
+
+    bool fBackgroundWrites;
+
+    // pendingWrite is not modified while its write runs. the writer reads it without the lock, readers hold
+    // cs_pendingWrite, which also guards replacing it and fPendingWriteFailed
+    mutable CCriticalSection cs_pendingWrite;
+    std::unique_ptr<CPendingWrite> pendingWrite;
+    bool fPendingWriteFailed;
+
+    // guards starting and joining the writer
+    mutable CCriticalSection cs_pendingWriteThread;
+    mutable boost::thread pendingWriteThread;
+
+    void WritePending();
+    bool WaitForPendingWrite() const;
+
+    // the nullifier filter is built on a background thread, and until it is set every lookup reads the database.
+    // cs_nullifierFilter guards the filter and the nullifiers written while it is built, which are added once it is
+    mutable CCriticalSection cs_nullifierFilter;
+    std::unique_ptr<CNullifierFilter> pnullifierFilter;
+    bool fBuildingNullifierFilter;
+    std::vector<uint256> vBuildNullifiers;
+    boost::thread nullifierFilterThread;
+
+    void BuildNullifierFilter();
+    void AddNullifiersToFilter(const CNullifiersMap &mapNullifiers);
+    bool NullifierMayExist(const uint256 &nf) const;
+
 public:
     CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    ~CCoinsViewDB();
+
+    //! Return from BatchWrite once the changes are taken over, and write them to disk on a background thread
+    void SetBackgroundWrites(bool fEnable) { fBackgroundWrites = fEnable; }
 
     bool GetSproutAnchorAt(const uint256 &rt, SproutMerkleTree &tree) const;
     bool GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree) const;
     bool GetNullifier(const uint256 &nf, ShieldedType type) const;
     bool GetCoins(const uint256 &txid, CCoins &coins) const;
+    size_t GetCoinsMany(const std::vector<uint256> &txids, std::vector<CCoins> &coins, std::vector<unsigned char> &found, int nThreads) const;
     bool HaveCoins(const uint256 &txid) const;
     uint256 GetBestBlock() const;
     uint256 GetBestAnchor(ShieldedType type) const;
@@ -95,16 +178,44 @@ public:
                     CNullifiersMap &mapSproutNullifiers,
                     CNullifiersMap &mapSaplingNullifiers);
     bool GetStats(CCoinsStats &stats) const;
+    //! Compute the UTXO set statistics of a snapshot of the database, as of the best block in it
+    bool GetUTXOSetStats(CUTXOSetStats &stats, const CDBSnapshot &snapshot) const;
+    std::shared_ptr<const CDBSnapshot> GetSnapshot() const { return db.GetSnapshot(); }
+    bool WriteSnapshot(CAutoFile &file, const uint160 &chainID, CCoinsSnapshotInfo &info) const;
+    bool SupportsConcurrentReads() const { return true; }
+    bool SyncWrites();
+
+    //! Verify a snapshot written by WriteSnapshot and load it into this database, which must be empty
+    bool LoadSnapshot(const boost::filesystem::path &path, const uint160 &chainID, CCoinsSnapshotInfo &info, std::string &strError);
+
+    //! Use the nullifier filter written at the last shutdown if it is as of the best block, or build it in the
+    //! background. Call once, after any snapshot is loaded and before blocks are connected
+    void StartNullifierFilter();
 };
 
 /** Access to the block database (blocks/index/) */
+class CCoinbaseCurrencyState;
+
 class CBlockTreeDB : public CDBWrapper
 {
 public:
-    CBlockTreeDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool compression = true, int maxOpenFiles = 1000);
+    CBlockTreeDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool compression = true, int maxOpenFiles = 1000, size_t nIndexCacheSize = 0);
 private:
+    CBlockTreeDB(bool fSeparateIndexes, size_t nCacheSize, bool fMemory, bool fWipe, bool compression, int maxOpenFiles, size_t nIndexCacheSize);
     CBlockTreeDB(const CBlockTreeDB&);
     void operator=(const CBlockTreeDB&);
+
+    // when -separateindexdb is in effect, the address, unspent, spent and timestamp indexes live in
+    // their own database under blocks/indexes, which is tuned for their small keys and prefix scans
+    std::unique_ptr<CDBWrapper> pindexdb;
+    CDBWrapper &IndexDB() { return pindexdb ? *pindexdb : *this; }
+
+    // address index entries are kept in the compact key format, see CAddressIndexCompactKey
+    bool fCompactAddressIndex;
+    bool ReadCompactAddressIndex(uint160 addressHash, int type, std::vector<CAddressIndexDbEntry> &addressIndex, int start, int end, unsigned int maxCount, const CAddressIndexKey *pAfter);
+
+    bool ReadAddressUnspentIndex(CDBIterator *pcursor, uint160 addressHash, int type, std::vector<CAddressUnspentDbEntry> &vect,
+                                 unsigned int maxCount = 0, const CAddressUnspentKey *pAfter = nullptr);
 public:
     bool WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo);
     bool EraseBatchSync(const std::vector<const CBlockIndex*>& blockinfo);
@@ -115,18 +226,69 @@ public:
     bool ReadTxIndex(const uint256 &txid, CDiskTxPos &pos);
     bool WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> > &list);
     bool ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
+    //! look up many spent index entries in one sorted pass, found[i] tells whether values[i] was filled in
+    size_t ReadSpentIndex(const std::vector<CSpentIndexKey> &keys, std::vector<CSpentIndexValue> &values, std::vector<unsigned char> &found);
     bool UpdateSpentIndex(const std::vector<CSpentIndexDbEntry> &vect);
+    bool WriteBlockDeltaSummary(const uint256 &blockHash, const CBlockDeltaSummary &summary);
+    bool ReadBlockDeltaSummary(const uint256 &blockHash, CBlockDeltaSummary &summary);
+    bool EraseBlockDeltaSummary(const uint256 &blockHash);
+    bool WriteBlockFilter(const uint256 &blockHash, const CBlockFilterIndexEntry &entry);
+    bool ReadBlockFilter(const uint256 &blockHash, CBlockFilterIndexEntry &entry);
+    bool WriteBlockStats(const uint256 &blockHash, const CBlockStats &stats);
+    bool ReadBlockStats(const uint256 &blockHash, CBlockStats &stats);
+    //! stores the proof data of the blocks of a block file about to be pruned, with the transactions retained from them
+    bool WritePrunedProofs(const std::vector<std::pair<uint256, CPrunedBlockProofs>> &blocks,
+                           const std::vector<std::pair<uint256, std::pair<uint256, CTransaction>>> &txs,
+                           const std::vector<uint256> &retainedStakeSources);
+    bool ReadPrunedBlockProofs(const uint256 &blockHash, CPrunedBlockProofs &proofs);
+    bool ReadPrunedTransaction(const uint256 &txid, CTransaction &tx, uint256 &blockHash);
+    //! marks a transaction spent by a stake, which is retained when its block is pruned
+    bool WritePrunedStakeSource(const uint256 &txid);
+    bool HavePrunedStakeSource(const uint256 &txid);
+    bool WriteUTXOSetStats(const CUTXOSetStats &stats);
+    bool ReadUTXOSetStats(CUTXOSetStats &stats);
     bool UpdateAddressUnspentIndex(const std::vector<CAddressUnspentDbEntry> &vect);
-    bool ReadAddressUnspentIndex(uint160 addressHash, int type, std::vector<CAddressUnspentDbEntry> &vect);
+    bool ReadAddressUnspentIndex(uint160 addressHash, int type, std::vector<CAddressUnspentDbEntry> &vect, unsigned int maxCount = 0,
+                                 const CAddressUnspentKey *pAfter = nullptr, const CDBSnapshot *pSnapshot = nullptr);
+    //! read the unspent outputs of each address with one cursor, addresses should be sorted by type then hash
+    bool ReadAddressUnspentIndex(const std::vector<std::pair<uint160, int>> &addresses, std::vector<std::vector<CAddressUnspentDbEntry>> &vect,
+                                 const CDBSnapshot *pSnapshot = nullptr);
+    //! snapshot of the database the spent, address and other indexes are kept in, for reads with no cs_main
+    std::shared_ptr<const CDBSnapshot> GetIndexSnapshot() { return IndexDB().GetSnapshot(); }
     bool WriteAddressIndex(const std::vector<CAddressIndexDbEntry> &vect);
     bool EraseAddressIndex(const std::vector<CAddressIndexDbEntry> &vect);
-    bool ReadAddressIndex(uint160 addressHash, int type, std::vector<CAddressIndexDbEntry> &addressIndex, int start = 0, int end = 0);
+    bool ReadAddressIndex(uint160 addressHash, int type, std::vector<CAddressIndexDbEntry> &addressIndex, int start = 0, int end = 0, unsigned int maxCount = 0, const CAddressIndexKey *pAfter = nullptr);
+    void SetCompactAddressIndex(bool fCompact) { fCompactAddressIndex = fCompact; }
+    bool MigrateAddressIndex();
+    bool UpdateAddressBalanceIndex(const std::vector<CAddressBalanceDbEntry> &deltas, bool disconnect, const int *pBuildHeight = nullptr);
+    bool ReadAddressBalanceIndex(uint160 addressHash, int type, CAddressBalanceValue &balance);
     bool WriteTimestampIndex(const CTimestampIndexKey &timestampIndex);
     bool ReadTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &vect);
     bool WriteTimestampBlockIndex(const CTimestampBlockIndexKey &blockhashIndex, const CTimestampBlockIndexValue &logicalts);
     bool ReadTimestampBlockIndex(const uint256 &hash, unsigned int &logicalTS);
+    bool ReadCurrencyStateIndex(const uint160 &currencyID, int height, bool pendingTransfers, const uint256 &blockHash, CCoinbaseCurrencyState &currencyState);
+    bool WriteCurrencyStateIndex(const uint160 &currencyID, int height, bool pendingTransfers, const uint256 &blockHash, const CCoinbaseCurrencyState &currencyState);
+    bool EraseCurrencyStateIndex(int height);
+    //! erase the currency state index if it was written by another version of it
+    bool CheckCurrencyStateIndexVersion();
+    bool UpdateReserveTransferIndex(const std::vector<CReserveTransferIndexEntry> &created, const std::vector<CReserveTransferIndexEntry> &spent, bool disconnect);
+    bool ReadReserveTransferIndex(const uint160 &currencyID, std::vector<CReserveTransferIndexEntry> &transfers, int start = 0, int end = 0, bool pendingOnly = false);
+    bool UpdateIdentityStateIndex(const std::vector<CIdentityStateIndexEntry> &identities, const std::vector<CIdentityCommitmentIndexEntry> &commitments, bool disconnect);
+    bool ReadIdentityStateIndex(const uint160 &identityID, unsigned int height, CIdentityStateIndexEntry &identity);
+    bool ReadIdentityStateIndex(std::vector<uint160> identityIDs, unsigned int height, std::vector<CIdentityStateIndexEntry> &identities);
+    bool ReadIdentityStateIndexIDs(std::vector<uint160> &identityIDs);
+    bool ReadIdentityCommitmentIndex(const uint256 &commitmentHash, std::vector<CIdentityCommitmentIndexEntry> &commitments);
+    bool ReadIdentityStateIndex(const uint160 &identityID, std::vector<CIdentityStateIndexEntry> &identities, int start = 0, int end = 0, unsigned int maxCount = 0, const CIdentityStateIndexKey *pAfter = nullptr);
+    bool ReadIdentityContentIndex(const uint160 &identityID, const std::vector<uint160> &vdxfKeys, std::vector<CIdentityStateIndexEntry> &identities, int start = 0, int end = 0);
+    bool ReadIdentityReverseIndex(const uint160 &reverseKey, std::vector<CIdentityStateIndexEntry> &identities, int start = 0, int end = 0, bool currentOnly = false, unsigned int maxCount = 0, const CIdentityStateIndexKey *pAfter = nullptr);
+    bool UpdateKVIndex(const std::vector<CKVIndexEntry> &entries, bool disconnect);
+    bool ReadKVIndex(const uint256 &keyHash, unsigned int height, CKVIndexEntry &entry);
+    bool ReadKVIndex(const uint256 &keyHash, std::vector<CKVIndexEntry> &entries, unsigned int maxCount, unsigned int beforeHeight = 0);
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
+    bool WriteIndexBuildHeight(const std::string &name, int height);
+    bool ReadIndexBuildHeight(const std::string &name, int &height);
+    bool EraseIndexBuildHeight(const std::string &name);
     bool LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256&)> insertBlockIndex);
     bool blockOnchainActive(const uint256 &hash);
     UniValue Snapshot(int top);
@@ -8,8 +8,10 @@
 #include "clientversion.h"
 #include "consensus/consensus.h"
 #include "consensus/validation.h"
+#include "crypto/common.h"
 #include "main.h"
 #include "policy/fees.h"
+#include "random.h"
 #include "streams.h"
 #include "timedata.h"
 #include "util.h"
@@ -29,6 +31,7 @@ CTxMemPoolEntry::CTxMemPoolEntry():
     hadNoDependencies(false), spendsCoinbase(false), hasReserve(false), feeDelta(0)
 {
     nHeight = MEMPOOL_HEIGHT;
+    SetPackageState(1, 0, 0, 1, 0, 0);
 }
 
 CTxMemPoolEntry::CTxMemPoolEntry(const CTransaction& _tx, const CAmount& _nFee,
@@ -43,6 +46,7 @@ CTxMemPoolEntry::CTxMemPoolEntry(const CTransaction& _tx, const CAmount& _nFee,
     nModSize = _tx.CalculateModifiedSize(nTxSize);
     nUsageSize = RecursiveDynamicUsage(*tx) + memusage::DynamicUsage(tx);
     feeRate = CFeeRate(nFee, nTxSize);
+    SetPackageState(1, nTxSize, GetModifiedFee(), 1, nTxSize, GetModifiedFee());
 }
 
 CTxMemPoolEntry::CTxMemPoolEntry(const CTxMemPoolEntry& other)
@@ -61,6 +65,31 @@ CTxMemPoolEntry::GetPriority(unsigned int currentHeight) const
     return dResult;
 }
 
+void CTxMemPoolEntry::UpdateAncestorState(int64_t modifySize, CAmount modifyFee, int64_t modifyCount)
+{
+    nSizeWithAncestors += modifySize;
+    nModFeesWithAncestors += modifyFee;
+    nCountWithAncestors += modifyCount;
+}
+
+void CTxMemPoolEntry::UpdateDescendantState(int64_t modifySize, CAmount modifyFee, int64_t modifyCount)
+{
+    nSizeWithDescendants += modifySize;
+    nModFeesWithDescendants += modifyFee;
+    nCountWithDescendants += modifyCount;
+}
+
+void CTxMemPoolEntry::SetPackageState(uint64_t countAncestors, uint64_t sizeAncestors, CAmount feesAncestors,
+                                      uint64_t countDescendants, uint64_t sizeDescendants, CAmount feesDescendants)
+{
+    nCountWithAncestors = countAncestors;
+    nSizeWithAncestors = sizeAncestors;
+    nModFeesWithAncestors = feesAncestors;
+    nCountWithDescendants = countDescendants;
+    nSizeWithDescendants = sizeDescendants;
+    nModFeesWithDescendants = feesDescendants;
+}
+
 CTxMemPool::CTxMemPool(const CFeeRate& _minRelayFee) :
     nTransactionsUpdated(0)
 {
@@ -92,6 +121,192 @@ bool CTxMemPool::CompareDepthAndScore(const uint256& hasha, const uint256& hashb
     return CompareTxMemPoolEntryByScore()(*i, *j);
 }
 
+void CTxMemPool::GetPackageFeeRates(std::map<uint256, CFeeRate> &packageRates) const
+{
+    LOCK(cs);
+    packageRates.clear();
+
+    // walking entries from the best ancestor fee rate down, the first package to reach an entry is its best one
+    auto &byAncestorFee = mapTx.get<2>();
+    for (auto it = byAncestorFee.begin(); it != byAncestorFee.end(); it++)
+    {
+        CFeeRate packageRate(it->GetModFeesWithAncestors(), it->GetSizeWithAncestors());
+        packageRates.insert(std::make_pair(it->GetTx().GetHash(), packageRate));
+        if (it->GetCountWithAncestors() > 1)
+        {
+            setEntries ancestors;
+            CalculateAncestors(mapTx.project<0>(it), ancestors);
+            for (auto &oneAncestor : ancestors)
+            {
+                packageRates.insert(std::make_pair(oneAncestor->GetTx().GetHash(), packageRate));
+            }
+        }
+    }
+}
+
+void CTxMemPool::CalculateAncestors(txiter entryit, setEntries &ancestors) const
+{
+    std::vector<txiter> toVisit(1, entryit);
+    while (toVisit.size())
+    {
+        txiter it = toVisit.back();
+        toVisit.pop_back();
+        for (const txiter &parent : mapLinks.find(it)->second.parents)
+        {
+            if (ancestors.insert(parent).second)
+            {
+                toVisit.push_back(parent);
+            }
+        }
+    }
+}
+
+void CTxMemPool::CalculateDescendants(txiter entryit, setEntries &descendants) const
+{
+    std::vector<txiter> toVisit(1, entryit);
+    while (toVisit.size())
+    {
+        txiter it = toVisit.back();
+        toVisit.pop_back();
+        for (const txiter &child : mapLinks.find(it)->second.children)
+        {
+            if (descendants.insert(child).second)
+            {
+                toVisit.push_back(child);
+            }
+        }
+    }
+}
+
+void CTxMemPool::RecalculatePackageState(txiter entryit)
+{
+    CTxMemPoolEntry state(*entryit);
+    uint64_t countAncestors = 1, sizeAncestors = entryit->GetTxSize(), countDescendants = 1, sizeDescendants = entryit->GetTxSize();
+    CAmount feesAncestors = entryit->GetModifiedFee(), feesDescendants = entryit->GetModifiedFee();
+
+    setEntries ancestors, descendants;
+    CalculateAncestors(entryit, ancestors);
+    CalculateDescendants(entryit, descendants);
+    for (auto &oneAncestor : ancestors)
+    {
+        countAncestors++;
+        sizeAncestors += oneAncestor->GetTxSize();
+        feesAncestors += oneAncestor->GetModifiedFee();
+    }
+    for (auto &oneDescendant : descendants)
+    {
+        countDescendants++;
+        sizeDescendants += oneDescendant->GetTxSize();
+        feesDescendants += oneDescendant->GetModifiedFee();
+    }
+    state.SetPackageState(countAncestors, sizeAncestors, feesAncestors, countDescendants, sizeDescendants, feesDescendants);
+    mapTx.modify(entryit, set_package_state(state));
+}
+
+void CTxMemPool::addPackageLinks(txiter entryit)
+{
+    const CTransaction &tx = entryit->GetTx();
+    TxLinks &links = mapLinks[entryit];
+    if (!tx.IsCoinImport())
+    {
+        for (const CTxIn &txin : tx.vin)
+        {
+            txiter parentit = mapTx.find(txin.prevout.hash);
+            if (parentit != mapTx.end())
+            {
+                links.parents.insert(parentit);
+            }
+        }
+    }
+
+    // children already in the mempool are only found when a transaction from a disconnected block comes back
+    for (auto it = mapNextTx.lower_bound(COutPoint(tx.GetHash(), 0)); it != mapNextTx.end() && it->first.hash == tx.GetHash(); it++)
+    {
+        txiter childit = mapTx.find(it->second.ptx->GetHash());
+        if (childit != mapTx.end())
+        {
+            links.children.insert(childit);
+        }
+    }
+
+    for (const txiter &parent : links.parents)
+    {
+        mapLinks[parent].children.insert(entryit);
+    }
+    for (const txiter &child : links.children)
+    {
+        mapLinks[child].parents.insert(entryit);
+    }
+
+    setEntries ancestors;
+    CalculateAncestors(entryit, ancestors);
+    if (links.children.empty())
+    {
+        // the usual case, a new transaction only joins the packages of its ancestors
+        for (const txiter &oneAncestor : ancestors)
+        {
+            mapTx.modify(oneAncestor, update_descendant_state(entryit->GetTxSize(), entryit->GetModifiedFee(), 1));
+        }
+        RecalculatePackageState(entryit);
+        return;
+    }
+
+    setEntries descendants;
+    CalculateDescendants(entryit, descendants);
+    RecalculatePackageState(entryit);
+    for (const txiter &oneAncestor : ancestors)
+    {
+        RecalculatePackageState(oneAncestor);
+    }
+    for (const txiter &oneDescendant : descendants)
+    {
+        RecalculatePackageState(oneDescendant);
+    }
+}
+
+void CTxMemPool::removePackageLinks(txiter entryit, std::set<uint256> &staleEntries)
+{
+    setEntries ancestors, descendants;
+    CalculateAncestors(entryit, ancestors);
+    CalculateDescendants(entryit, descendants);
+
+    if (ancestors.size() && descendants.size())
+    {
+        // removing a transaction from the middle of a package splits it, so what remains is recalculated once unlinked
+        for (const txiter &oneEntry : ancestors)
+        {
+            staleEntries.insert(oneEntry->GetTx().GetHash());
+        }
+        for (const txiter &oneEntry : descendants)
+        {
+            staleEntries.insert(oneEntry->GetTx().GetHash());
+        }
+    }
+    else
+    {
+        for (const txiter &oneAncestor : ancestors)
+        {
+            mapTx.modify(oneAncestor, update_descendant_state(-(int64_t)entryit->GetTxSize(), -entryit->GetModifiedFee(), -1));
+        }
+        for (const txiter &oneDescendant : descendants)
+        {
+            mapTx.modify(oneDescendant, update_ancestor_state(-(int64_t)entryit->GetTxSize(), -entryit->GetModifiedFee(), -1));
+        }
+    }
+
+    auto linksIt = mapLinks.find(entryit);
+    for (const txiter &parent : linksIt->second.parents)
+    {
+        mapLinks[parent].children.erase(entryit);
+    }
+    for (const txiter &child : linksIt->second.children)
+    {
+        mapLinks[child].parents.erase(entryit);
+    }
+    mapLinks.erase(linksIt);
+    staleEntries.erase(entryit->GetTx().GetHash());
+}
+
 void CTxMemPool::pruneSpent(const uint256 &hashTx, CCoins &coins)
 {
     LOCK(cs);
@@ -124,10 +339,22 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry,
     // Used by main.cpp AcceptToMemoryPool(), which DOES do
     // all the appropriate checks.
     LOCK(cs);
-    mapTx.insert(entry);
-    const CTransaction& tx = mapTx.find(hash)->GetTx();
+    txiter newit = mapTx.insert(entry).first;
+    const CTransaction& tx = newit->GetTx();
+
+    // prioritisations made before the transaction arrived count toward its package
+    auto deltaIt = mapDeltas.find(hash);
+    if (deltaIt != mapDeltas.end() && deltaIt->second.second)
+    {
+        mapTx.modify(newit, update_fee_delta(deltaIt->second.second));
+    }
+    addPackageLinks(newit);
+    addPendingIndexes(tx);
+    addRemovalIndexes(tx);
+
     mapRecentlyAddedTx[tx.GetHash()] = &tx;
     nRecentlyAddedSequence += 1;
+    LogSequenceChange(hash, true);
     if (!tx.IsCoinImport()) {
         for (unsigned int i = 0; i < tx.vin.size(); i++)
             mapNextTx[tx.vin[i].prevout] = CInPoint(&tx, i);
@@ -148,6 +375,31 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry,
     return true;
 }
 
+CMempoolAddressHasher::CMempoolAddressHasher() : salt(GetRandHash()) {}
+
+size_t CMempoolAddressHasher::operator()(const std::pair<int, uint160> &address) const
+{
+    uint256 key;
+    memcpy(key.begin(), address.second.begin(), address.second.size());
+    WriteLE32(key.begin() + address.second.size(), address.first);
+    return key.GetHash(salt);
+}
+
+// adds a delta to its address' bucket, skipping duplicates, as when an output lists the same destination twice
+void CTxMemPool::insertAddressDelta(const CMempoolAddressDeltaKey &key, const CMempoolAddressDelta &delta, std::vector<CMempoolAddressDeltaKey> &inserted)
+{
+    auto &deltas = mapAddress[std::make_pair(key.type, key.addressBytes)];
+    for (auto &oneDelta : deltas)
+    {
+        if (oneDelta.first.txhash == key.txhash && oneDelta.first.index == key.index && oneDelta.first.spending == key.spending)
+        {
+            return;
+        }
+    }
+    deltas.push_back(std::make_pair(key, delta));
+    inserted.push_back(key);
+}
+
 void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewCache &view)
 {
     LOCK(cs);
@@ -175,6 +427,7 @@ void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewC
 
                 uint32_t nHeight = chainActive.Height();
                 std::map<uint160, uint32_t> heightOffsets = p.GetIndexHeightOffsets(chainActive.Height());
+                CCurrencyValueMap prevReserves = prevout.ReserveOutValue() * -1;
 
                 for (auto dest : dests)
                 {
@@ -184,9 +437,8 @@ void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewC
                         if (!(dest.which() == COptCCParams::ADDRTYPE_INDEX && heightOffsets.count(destID) && heightOffsets[destID] != nHeight))
                         {
                             CMempoolAddressDeltaKey key(AddressTypeFromDest(dest), destID, txhash, j, 1);
-                            CMempoolAddressDelta delta(entry.GetTime(), prevout.nValue * -1, input.prevout.hash, input.prevout.n);
-                            mapAddress.insert(make_pair(key, delta));
-                            inserted.push_back(key);
+                            CMempoolAddressDelta delta(entry.GetTime(), prevout.nValue * -1, input.prevout.hash, input.prevout.n, prevReserves);
+                            insertAddressDelta(key, delta, inserted);
                         }
                     }
                 }
@@ -199,8 +451,7 @@ void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewC
 
                 CMempoolAddressDeltaKey key(type, prevout.scriptPubKey.AddressHash(), txhash, j, 1);
                 CMempoolAddressDelta delta(entry.GetTime(), prevout.nValue * -1, input.prevout.hash, input.prevout.n);
-                mapAddress.insert(make_pair(key, delta));
-                inserted.push_back(key);
+                insertAddressDelta(key, delta, inserted);
             }
         }
     }
@@ -223,6 +474,7 @@ void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewC
 
             uint32_t nHeight = chainActive.Height();
             std::map<uint160, uint32_t> heightOffsets = p.GetIndexHeightOffsets(nHeight);
+            CCurrencyValueMap outReserves = out.ReserveOutValue();
 
             for (auto dest : dests)
             {
@@ -232,8 +484,7 @@ void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewC
                     if (!(dest.which() == COptCCParams::ADDRTYPE_INDEX && heightOffsets.count(destID) && heightOffsets[destID] > nHeight))
                     {
                         CMempoolAddressDeltaKey key(AddressTypeFromDest(dest), GetDestinationID(dest), txhash, j, 0);
-                        mapAddress.insert(make_pair(key, CMempoolAddressDelta(entry.GetTime(), out.nValue)));
-                        inserted.push_back(key);
+                        insertAddressDelta(key, CMempoolAddressDelta(entry.GetTime(), out.nValue, outReserves), inserted);
                     }
                 }
             }
@@ -245,8 +496,7 @@ void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewC
                 continue;
 
             CMempoolAddressDeltaKey key(type, out.scriptPubKey.AddressHash(), txhash, j, 0);
-            mapAddress.insert(make_pair(key, CMempoolAddressDelta(entry.GetTime(), out.nValue)));
-            inserted.push_back(key);
+            insertAddressDelta(key, CMempoolAddressDelta(entry.GetTime(), out.nValue), inserted);
         }
     }
     mapAddressInserted.insert(make_pair(txhash, inserted));
@@ -256,15 +506,34 @@ bool CTxMemPool::getAddressIndex(const std::vector<std::pair<uint160, int> > &ad
 {
     LOCK(cs);
     for (std::vector<std::pair<uint160, int> >::const_iterator it = addresses.begin(); it != addresses.end(); it++) {
-        auto ait = mapAddress.lower_bound(CMempoolAddressDeltaKey((*it).second, (*it).first));
-        while (ait != mapAddress.end() && (*ait).first.addressBytes == (*it).first && (*ait).first.type == (*it).second) {
-            results.push_back(*ait);
-            ait++;
+        auto ait = mapAddress.find(std::make_pair((*it).second, (*it).first));
+        if (ait != mapAddress.end()) {
+            results.insert(results.end(), ait->second.begin(), ait->second.end());
         }
     }
     return true;
 }
 
+// net native and reserve currency change in the mempool of each requested address that has any, under one lock
+bool CTxMemPool::getAddressTotals(const std::vector<std::pair<uint160, int> > &addresses, std::map<std::pair<uint160, int>, std::pair<CAmount, CCurrencyValueMap>> &totals)
+{
+    LOCK(cs);
+    for (std::vector<std::pair<uint160, int> >::const_iterator it = addresses.begin(); it != addresses.end(); it++) {
+        auto ait = mapAddress.find(std::make_pair((*it).second, (*it).first));
+        if (ait == mapAddress.end() || totals.count(*it)) {
+            continue;
+        }
+        std::pair<CAmount, CCurrencyValueMap> &total = totals[*it];
+        total.first = 0;
+        for (auto &oneDelta : ait->second) {
+            total.first += oneDelta.second.amount;
+            total.second += oneDelta.second.reserves;
+        }
+        total.second = total.second.CanonicalMap();
+    }
+    return true;
+}
+
 std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta>> CTxMemPool::FilterUnspent(const std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta>> &memPoolOutputs,
                                                                                                 std::set<COutPoint> &spentTxOuts)
 {
@@ -306,9 +575,23 @@ bool CTxMemPool::removeAddressIndex(const uint256 txhash)
     auto it = mapAddressInserted.find(txhash);
 
     if (it != mapAddressInserted.end()) {
-        std::vector<CMempoolAddressDeltaKey> keys = (*it).second;
-        for (std::vector<CMempoolAddressDeltaKey>::iterator mit = keys.begin(); mit != keys.end(); mit++) {
-            mapAddress.erase(*mit);
+        const std::vector<CMempoolAddressDeltaKey> &keys = (*it).second;
+        for (std::vector<CMempoolAddressDeltaKey>::const_iterator mit = keys.begin(); mit != keys.end(); mit++) {
+            auto ait = mapAddress.find(std::make_pair(mit->type, mit->addressBytes));
+            if (ait == mapAddress.end()) {
+                continue;
+            }
+            auto &deltas = ait->second;
+            deltas.erase(std::remove_if(deltas.begin(), deltas.end(),
+                                        [&mit](const std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> &oneDelta) {
+                                            return oneDelta.first.txhash == mit->txhash &&
+                                                   oneDelta.first.index == mit->index &&
+                                                   oneDelta.first.spending == mit->spending;
+                                        }),
+                         deltas.end());
+            if (deltas.empty()) {
+                mapAddress.erase(ait);
+            }
         }
         mapAddressInserted.erase(it);
     }
@@ -363,11 +646,64 @@ bool CTxMemPool::removeSpentIndex(const uint256 txhash)
     return true;
 }
 
+// mempool transfers are keyed with a height of 0, and their outputs are taken from the mempool transactions when read
+void CTxMemPool::addReserveTransferIndex(const CTxMemPoolEntry &entry)
+{
+    LOCK(cs);
+    const CTransaction& tx = entry.GetTx();
+    uint256 txhash = tx.GetHash();
+    std::vector<CReserveTransferIndexKey> inserted;
+
+    for (unsigned int k = 0; k < tx.vout.size(); k++) {
+        CReserveTransferIndexEntry oneTransfer;
+        if (GetReserveTransferIndexEntry(tx.vout[k], txhash, k, 0, oneTransfer)) {
+            mapReserveTransfers.insert(make_pair(oneTransfer.first, oneTransfer.second.second));
+            inserted.push_back(oneTransfer.first);
+        }
+    }
+    if (inserted.size()) {
+        mapReserveTransfersInserted.insert(make_pair(txhash, inserted));
+    }
+}
+
+bool CTxMemPool::getReserveTransferIndex(const uint160 &currencyID, std::vector<CReserveTransferIndexEntry> &transfers)
+{
+    LOCK(cs);
+    for (auto it = mapReserveTransfers.lower_bound(CReserveTransferIndexKey(currencyID, 0, uint256(), 0));
+         it != mapReserveTransfers.end() && it->first.currencyID == currencyID;
+         it++) {
+        auto txIt = mapTx.find(it->first.txhash);
+        if (txIt == mapTx.end()) {
+            continue;
+        }
+        const CTxOut &out = txIt->GetTx().vout[it->first.index];
+        transfers.push_back(make_pair(it->first,
+                                      make_pair(CInputDescriptor(out.scriptPubKey, out.nValue, CTxIn(it->first.txhash, it->first.index)), it->second)));
+    }
+    return true;
+}
+
+bool CTxMemPool::removeReserveTransferIndex(const uint256 txhash)
+{
+    LOCK(cs);
+    auto it = mapReserveTransfersInserted.find(txhash);
+
+    if (it != mapReserveTransfersInserted.end()) {
+        for (auto &oneKey : it->second) {
+            mapReserveTransfers.erase(oneKey);
+        }
+        mapReserveTransfersInserted.erase(it);
+    }
+
+    return true;
+}
+
 void CTxMemPool::remove(const CTransaction &origTx, std::list<CTransaction>& removed, bool fRecursive)
 {
     // Remove transaction from memory pool
     {
         LOCK(cs);
+        std::set<uint256> stalePackages;
         std::deque<uint256> txToRemove;
         txToRemove.push_back(origTx.GetHash());
         if (fRecursive && !mapTx.count(origTx.GetHash())) {
@@ -398,6 +734,8 @@ void CTxMemPool::remove(const CTransaction &origTx, std::list<CTransaction>& rem
                 }
             }
             mapRecentlyAddedTx.erase(hash);
+            removePendingIndexes(tx);
+            removeRemovalIndexes(tx);
             BOOST_FOREACH(const CTxIn& txin, tx.vin)
                 mapNextTx.erase(txin.prevout);
             BOOST_FOREACH(const JSDescription& joinsplit, tx.vJoinSplit) {
@@ -409,17 +747,30 @@ void CTxMemPool::remove(const CTransaction &origTx, std::list<CTransaction>& rem
                 mapSaplingNullifiers.erase(spendDescription.nullifier);
             }
             removed.push_back(tx);
-            totalTxSize -= mapTx.find(hash)->GetTxSize();
-            cachedInnerUsage -= mapTx.find(hash)->DynamicMemoryUsage();
-            mapTx.erase(hash);
+            txiter removeit = mapTx.find(hash);
+            totalTxSize -= removeit->GetTxSize();
+            cachedInnerUsage -= removeit->DynamicMemoryUsage();
+            removePackageLinks(removeit, stalePackages);
+            mapTx.erase(removeit);
             nTransactionsUpdated++;
+            LogSequenceChange(hash, false);
             minerPolicyEstimator->removeTx(hash);
             if (fAddressIndex)
                 removeAddressIndex(hash);
             if (fSpentIndex)
                 removeSpentIndex(hash);
+            if (fReserveTransferIndex)
+                removeReserveTransferIndex(hash);
             ClearPrioritisation(tx.GetHash());
         }
+        for (auto &oneHash : stalePackages)
+        {
+            txiter staleit = mapTx.find(oneHash);
+            if (staleit != mapTx.end())
+            {
+                RecalculatePackageState(staleit);
+            }
+        }
     }
 }
 
@@ -581,56 +932,82 @@ void CTxMemPool::removeWithAnchor(const uint256 &invalidRoot, ShieldedType type)
     // from that root -- almost as though they were spending coinbases
     // which are no longer valid to spend due to coinbase maturity.
     LOCK(cs);
-    list<CTransaction> transactionsToRemove;
+    std::map<uint256, std::set<uint256>> *pAnchors;
+    switch (type) {
+        case SPROUT:
+            pAnchors = &mapSproutAnchors;
+        break;
+        case SAPLING:
+            pAnchors = &mapSaplingAnchors;
+        break;
+        default:
+            throw runtime_error("Unknown shielded type");
+        break;
+    }
 
-    for (indexed_transaction_set::const_iterator it = mapTx.begin(); it != mapTx.end(); it++) {
-        const CTransaction& tx = it->GetTx();
-        switch (type) {
-            case SPROUT:
-                BOOST_FOREACH(const JSDescription& joinsplit, tx.vJoinSplit) {
-                    if (joinsplit.anchor == invalidRoot) {
-                        transactionsToRemove.push_back(tx);
-                        break;
-                    }
-                }
-            break;
-            case SAPLING:
-                BOOST_FOREACH(const SpendDescription& spendDescription, tx.vShieldedSpend) {
-                    if (spendDescription.anchor == invalidRoot) {
-                        transactionsToRemove.push_back(tx);
-                        break;
-                    }
-                }
-            break;
-            default:
-                throw runtime_error("Unknown shielded type");
-            break;
+    auto anchorIt = pAnchors->find(invalidRoot);
+    if (anchorIt == pAnchors->end()) {
+        return;
+    }
+    // removing a transaction erases it and its descendants from the anchor index, so the hashes are copied first
+    std::set<uint256> txToRemove = anchorIt->second;
+    for (const uint256 &hash : txToRemove) {
+        txiter it = mapTx.find(hash);
+        if (it != mapTx.end()) {
+            list<CTransaction> removed;
+            remove(CTransaction(it->GetTx()), removed, true);
         }
     }
+}
 
-    BOOST_FOREACH(const CTransaction& tx, transactionsToRemove) {
-        list<CTransaction> removed;
-        remove(tx, removed, true);
+void CTxMemPool::addRemovalIndexes(const CTransaction &tx)
+{
+    uint256 txHash = tx.GetHash();
+    if (tx.IsCoinBase()) {
+        mapExpiry[0].insert(txHash);
+    } else if (tx.nExpiryHeight != 0) {
+        mapExpiry[tx.nExpiryHeight].insert(txHash);
+    }
+    for (const JSDescription &joinsplit : tx.vJoinSplit) {
+        mapSproutAnchors[joinsplit.anchor].insert(txHash);
+    }
+    for (const SpendDescription &spendDescription : tx.vShieldedSpend) {
+        mapSaplingAnchors[spendDescription.anchor].insert(txHash);
     }
 }
 
-bool CTxMemPool::checkNameConflicts(const CTransaction &tx, std::list<CTransaction> &conflicting)
+template <typename KEY>
+static void EraseIndexedHash(std::map<KEY, std::set<uint256>> &index, const KEY &key, const uint256 &hash)
 {
-    LOCK(cs);
+    auto it = index.find(key);
+    if (it != index.end() && it->second.erase(hash) && it->second.empty()) {
+        index.erase(it);
+    }
+}
 
-    // easy way to check if there are any transactions in the memory pool that define the name specified but are not the same as tx
-    conflicting.clear();
+void CTxMemPool::removeRemovalIndexes(const CTransaction &tx)
+{
+    uint256 txHash = tx.GetHash();
+    if (tx.IsCoinBase()) {
+        EraseIndexedHash(mapExpiry, (uint32_t)0, txHash);
+    } else if (tx.nExpiryHeight != 0) {
+        EraseIndexedHash(mapExpiry, tx.nExpiryHeight, txHash);
+    }
+    for (const JSDescription &joinsplit : tx.vJoinSplit) {
+        EraseIndexedHash(mapSproutAnchors, joinsplit.anchor, txHash);
+    }
+    for (const SpendDescription &spendDescription : tx.vShieldedSpend) {
+        EraseIndexedHash(mapSaplingAnchors, spendDescription.anchor, txHash);
+    }
+}
 
-    // first, be sure that this is a name definition. if so, it will have both a definition and reservation output. if it is a name definition,
-    // our only concern is whether or not there is a conflicting definition in the mempool. we assume that a check for any conflicting definition
-    // in the blockchain has already taken place.
-    CIdentity identity;
+// the IDs of names a transaction reserves and of currencies it defines
+static void GetNewNamesAndCurrencies(const CTransaction &tx, std::set<uint160> &newIDs, std::set<uint160> &newCurrencies)
+{
     CNameReservation reservation;
     CAdvancedNameReservation advNameRes;
     CCurrencyDefinition newCurDef;
-    std::set<uint160> newIDs;
-    std::set<uint160> newCurrencies;
-    for (auto output : tx.vout)
+    for (auto &output : tx.vout)
     {
         COptCCParams p;
         if (output.scriptPubKey.IsPayToCryptoCondition(p) && p.IsValid() && p.version >= p.VERSION_V3 && p.vData.size())
@@ -666,58 +1043,154 @@ bool CTxMemPool::checkNameConflicts(const CTransaction &tx, std::list<CTransacti
             }
         }
     }
+}
 
-    // first, look for ID conflicts, any new ID that matches should be removed
-    for (auto &oneIDID : newIDs)
+void CTxMemPool::addPendingIndexes(const CTransaction &tx)
+{
+    uint256 txHash = tx.GetHash();
+    for (auto &txin : tx.vin)
+    {
+        auto idOutIt = mapIdentityOutputs.find(txin.prevout);
+        if (idOutIt != mapIdentityOutputs.end())
+        {
+            mapPendingIdentities[idOutIt->second].erase(txin.prevout);
+        }
+    }
+    for (int i = 0; i < tx.vout.size(); i++)
     {
-        std::vector<std::pair<uint160, int>> addresses =
-            std::vector<std::pair<uint160, int>>({{CCrossChainRPCData::GetConditionID(oneIDID, EVAL_IDENTITY_RESERVATION), CScript::P2IDX},
-                                                  {CCrossChainRPCData::GetConditionID(oneIDID, EVAL_IDENTITY_ADVANCEDRESERVATION), CScript::P2IDX}});
-        std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta>> results;
-        if (mempool.getAddressIndex(addresses, results) && results.size())
+        COptCCParams p;
+        CIdentity identity;
+        if (tx.IsPayToCryptoCondition(i, p) &&
+            p.IsValid() &&
+            p.evalCode == EVAL_IDENTITY_PRIMARY &&
+            (identity = CIdentity(tx.vout[i].scriptPubKey)).IsValid())
         {
-            std::map<uint256, std::pair<CTransaction, int>> txesAndSources;   // first hash is transaction of input of prior identity or commitment output in the mempool, second pair is tx and ID output num if identity
+            COutPoint idOutput(txHash, i);
+            mapIdentityOutputs[idOutput] = identity.GetID();
+            // a transaction from a disconnected block may already be spent by one in the mempool
+            if (!mapNextTx.count(idOutput))
+            {
+                mapPendingIdentities[identity.GetID()].insert(idOutput);
+            }
+        }
+    }
 
-            uint256 txHash = tx.GetHash();
-            CNameReservation conflictingRes;
-            for (auto r : results)
+    std::set<uint160> newIDs, newCurrencies;
+    GetNewNamesAndCurrencies(tx, newIDs, newCurrencies);
+    for (auto &oneID : newIDs)
+    {
+        mapPendingNames[oneID].insert(txHash);
+    }
+    for (auto &oneID : newCurrencies)
+    {
+        mapPendingCurrencies[oneID].insert(txHash);
+    }
+}
+
+void CTxMemPool::removePendingIndexes(const CTransaction &tx)
+{
+    uint256 txHash = tx.GetHash();
+    for (auto &txin : tx.vin)
+    {
+        // an identity output still in the mempool is the latest pending state again
+        auto idOutIt = mapIdentityOutputs.find(txin.prevout);
+        if (idOutIt != mapIdentityOutputs.end())
+        {
+            mapPendingIdentities[idOutIt->second].insert(txin.prevout);
+        }
+    }
+    for (int i = 0; i < tx.vout.size(); i++)
+    {
+        auto idOutIt = mapIdentityOutputs.find(COutPoint(txHash, i));
+        if (idOutIt != mapIdentityOutputs.end())
+        {
+            auto pendingIt = mapPendingIdentities.find(idOutIt->second);
+            if (pendingIt != mapPendingIdentities.end())
             {
-                if (r.first.txhash == txHash)
-                {
-                    continue;
-                }
-                CTransaction mpTx;
-                if (lookup(r.first.txhash, mpTx))
+                pendingIt->second.erase(idOutIt->first);
+                if (pendingIt->second.empty())
                 {
-                    conflicting.push_back(mpTx);
+                    mapPendingIdentities.erase(pendingIt);
                 }
             }
+            mapIdentityOutputs.erase(idOutIt);
+        }
+    }
+
+    std::set<uint160> newIDs, newCurrencies;
+    GetNewNamesAndCurrencies(tx, newIDs, newCurrencies);
+    for (auto &oneID : newIDs)
+    {
+        auto it = mapPendingNames.find(oneID);
+        if (it != mapPendingNames.end() && it->second.erase(txHash) && it->second.empty())
+        {
+            mapPendingNames.erase(it);
+        }
+    }
+    for (auto &oneID : newCurrencies)
+    {
+        auto it = mapPendingCurrencies.find(oneID);
+        if (it != mapPendingCurrencies.end() && it->second.erase(txHash) && it->second.empty())
+        {
+            mapPendingCurrencies.erase(it);
         }
     }
+}
+
+bool CTxMemPool::getPendingIdentity(const uint160 &identityID, COutPoint &idOutput, CScript &idScript) const
+{
+    LOCK(cs);
+    auto pendingIt = mapPendingIdentities.find(identityID);
+    if (pendingIt == mapPendingIdentities.end() || pendingIt->second.empty())
+    {
+        return false;
+    }
+    idOutput = *pendingIt->second.begin();
+    idScript = mapTx.find(idOutput.hash)->GetTx().vout[idOutput.n].scriptPubKey;
+    return true;
+}
+
+bool CTxMemPool::checkNameConflicts(const CTransaction &tx, std::list<CTransaction> &conflicting)
+{
+    LOCK(cs);
+
+    // easy way to check if there are any transactions in the memory pool that define the name specified but are not the same as tx
+    conflicting.clear();
 
+    // first, be sure that this is a name definition. if so, it will have both a definition and reservation output. if it is a name definition,
+    // our only concern is whether or not there is a conflicting definition in the mempool. we assume that a check for any conflicting definition
+    // in the blockchain has already taken place.
+    std::set<uint160> newIDs;
+    std::set<uint160> newCurrencies;
+    GetNewNamesAndCurrencies(tx, newIDs, newCurrencies);
+
+    // any other transaction in the mempool that reserves one of the same names or defines one of the same currencies conflicts
+    uint256 txHash = tx.GetHash();
+    std::set<uint256> conflictingTxes;
+    for (auto &oneIDID : newIDs)
+    {
+        auto it = mapPendingNames.find(oneIDID);
+        if (it != mapPendingNames.end())
+        {
+            conflictingTxes.insert(it->second.begin(), it->second.end());
+        }
+    }
     for (auto &oneCurID : newCurrencies)
     {
-        std::vector<std::pair<uint160, int>> addresses =
-            std::vector<std::pair<uint160, int>>({{CCrossChainRPCData::GetConditionID(oneCurID, CCurrencyDefinition::CurrencyDefinitionKey()), CScript::P2IDX}});
-        std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta>> results;
-        if (mempool.getAddressIndex(addresses, results) && results.size())
+        auto it = mapPendingCurrencies.find(oneCurID);
+        if (it != mapPendingCurrencies.end())
         {
-            std::map<uint256, std::pair<CTransaction, int>> txesAndSources;   // first hash is transaction of input of prior identity or commitment output in the mempool, second pair is tx and ID output num if identity
+            conflictingTxes.insert(it->second.begin(), it->second.end());
+        }
+    }
+    conflictingTxes.erase(txHash);
 
-            uint256 txHash = tx.GetHash();
-            CNameReservation conflictingRes;
-            for (auto r : results)
-            {
-                if (r.first.txhash == txHash)
-                {
-                    continue;
-                }
-                CTransaction mpTx;
-                if (lookup(r.first.txhash, mpTx))
-                {
-                    conflicting.push_back(mpTx);
-                }
-            }
+    for (auto &oneHash : conflictingTxes)
+    {
+        CTransaction mpTx;
+        if (lookup(oneHash, mpTx))
+        {
+            conflicting.push_back(mpTx);
         }
     }
 
@@ -780,17 +1253,18 @@ extern char ASSETCHAINS_SYMBOL[];
 
 void CTxMemPool::removeExpired(unsigned int nBlockHeight)
 {
-    CBlockIndex *tipindex;
-    // Remove expired txs and leftover coinbases from the mempool
+    // Remove expired txs and leftover coinbases from the mempool, which are those indexed below the block height
     LOCK(cs);
     list<CTransaction> transactionsToRemove;
-    for (indexed_transaction_set::const_iterator it = mapTx.begin(); it != mapTx.end(); it++)
+    for (auto expiryIt = mapExpiry.begin(); expiryIt != mapExpiry.end() && expiryIt->first < nBlockHeight; expiryIt++)
     {
-        const CTransaction& tx = it->GetTx();
-        tipindex = chainActive.LastTip();
-        if (tx.IsCoinBase() || IsExpiredTx(tx, nBlockHeight))
+        for (const uint256 &hash : expiryIt->second)
         {
-            transactionsToRemove.push_back(tx);
+            txiter it = mapTx.find(hash);
+            if (it != mapTx.end())
+            {
+                transactionsToRemove.push_back(it->GetTx());
+            }
         }
     }
     for (const CTransaction& tx : transactionsToRemove) {
@@ -808,13 +1282,24 @@ void CTxMemPool::removeForBlock(const std::vector<CTransaction>& vtx, unsigned i
 {
     LOCK(cs);
     std::vector<CTxMemPoolEntry> entries;
+    std::vector<std::map<uint160, CAmount>> reserveFees;
     BOOST_FOREACH(const CTransaction& tx, vtx)
     {
         uint256 hash = tx.GetHash();
 
         indexed_transaction_set::iterator i = mapTx.find(hash);
         if (i != mapTx.end())
+        {
             entries.push_back(*i);
+            // the reserve descriptor goes with the transaction as it is removed below
+            auto reserveIt = mapReserveTransactions.find(hash);
+            reserveFees.push_back(std::map<uint160, CAmount>());
+            if (reserveIt != mapReserveTransactions.end())
+            {
+                CCurrencyValueMap fees = reserveIt->second.ReserveFees();
+                reserveFees.back().insert(fees.valueMap.begin(), fees.valueMap.end());
+            }
+        }
     }
     BOOST_FOREACH(const CTransaction& tx, vtx)
     {
@@ -824,7 +1309,7 @@ void CTxMemPool::removeForBlock(const std::vector<CTransaction>& vtx, unsigned i
         ClearPrioritisation(tx.GetHash());
     }
     // After the txs in the new block have been removed from the mempool, update policy estimates
-    minerPolicyEstimator->processBlock(nBlockHeight, entries, fCurrentEstimate);
+    minerPolicyEstimator->processBlock(nBlockHeight, entries, reserveFees, fCurrentEstimate);
 }
 
 /**
@@ -852,11 +1337,75 @@ void CTxMemPool::removeWithoutBranchId(uint32_t nMemPoolBranchId)
 void CTxMemPool::clear()
 {
     LOCK(cs);
+    mapLinks.clear();
+    mapIdentityOutputs.clear();
+    mapPendingIdentities.clear();
+    mapPendingNames.clear();
+    mapPendingCurrencies.clear();
+    mapExpiry.clear();
+    mapSproutAnchors.clear();
+    mapSaplingAnchors.clear();
     mapTx.clear();
     mapNextTx.clear();
     totalTxSize = 0;
     cachedInnerUsage = 0;
     ++nTransactionsUpdated;
+
+    // what was removed is not logged, so every poller reads the mempool again
+    ++nMempoolSequence;
+    nSequenceLogStart = nMempoolSequence;
+    sequenceLog.clear();
+}
+
+void CTxMemPool::LogSequenceChange(const uint256 &hash, bool fAdded)
+{
+    nMempoolSequence++;
+    sequenceLog.push_back(std::make_pair(hash, fAdded));
+    if (sequenceLog.size() > MEMPOOL_SEQUENCE_LOG_SIZE)
+    {
+        sequenceLog.pop_front();
+        nSequenceLogStart++;
+    }
+}
+
+bool CTxMemPool::GetChangesSince(uint64_t sequence, std::vector<uint256> &added, std::vector<uint256> &removed)
+{
+    LOCK(cs);
+    added.clear();
+    removed.clear();
+    if (sequence < nSequenceLogStart || sequence > nMempoolSequence)
+    {
+        return false;
+    }
+
+    // the first and last change of each transaction since sequence tell whether it was in the mempool then and is now
+    std::map<uint256, std::pair<bool, bool>> firstAndLast;
+    for (size_t i = sequence - nSequenceLogStart; i < sequenceLog.size(); i++)
+    {
+        auto it = firstAndLast.find(sequenceLog[i].first);
+        if (it == firstAndLast.end())
+        {
+            firstAndLast.insert(std::make_pair(sequenceLog[i].first, std::make_pair(sequenceLog[i].second, sequenceLog[i].second)));
+        }
+        else
+        {
+            it->second.second = sequenceLog[i].second;
+        }
+    }
+    for (auto &oneTx : firstAndLast)
+    {
+        bool wasIn = !oneTx.second.first;
+        bool isIn = oneTx.second.second;
+        if (isIn && !wasIn)
+        {
+            added.push_back(oneTx.first);
+        }
+        else if (wasIn && !isIn)
+        {
+            removed.push_back(oneTx.first);
+        }
+    }
+    return true;
 }
 
 void CTxMemPool::check(const CCoinsViewCache *pcoins) const
@@ -883,6 +1432,30 @@ void CTxMemPool::check(const CCoinsViewCache *pcoins) const
         innerUsage += it->DynamicMemoryUsage();
         const CTransaction& tx = it->GetTx();
         bool fDependsWait = false;
+
+        // the incrementally kept package state must match the packages its links give
+        setEntries ancestors, descendants;
+        CalculateAncestors(it, ancestors);
+        CalculateDescendants(it, descendants);
+        uint64_t sizeAncestors = it->GetTxSize(), sizeDescendants = it->GetTxSize();
+        CAmount feesAncestors = it->GetModifiedFee(), feesDescendants = it->GetModifiedFee();
+        for (const txiter &oneAncestor : ancestors)
+        {
+            sizeAncestors += oneAncestor->GetTxSize();
+            feesAncestors += oneAncestor->GetModifiedFee();
+        }
+        for (const txiter &oneDescendant : descendants)
+        {
+            sizeDescendants += oneDescendant->GetTxSize();
+            feesDescendants += oneDescendant->GetModifiedFee();
+        }
+        assert(it->GetCountWithAncestors() == ancestors.size() + 1);
+        assert(it->GetSizeWithAncestors() == sizeAncestors);
+        assert(it->GetModFeesWithAncestors() == feesAncestors);
+        assert(it->GetCountWithDescendants() == descendants.size() + 1);
+        assert(it->GetSizeWithDescendants() == sizeDescendants);
+        assert(it->GetModFeesWithDescendants() == feesDescendants);
+
         BOOST_FOREACH(const CTxIn &txin, tx.vin) {
             // Check that every mempool transaction's inputs refer to available coins, or other mempool tx's.
             indexed_transaction_set::const_iterator it2 = mapTx.find(txin.prevout.hash);
@@ -1038,6 +1611,20 @@ CFeeRate CTxMemPool::estimateFee(int nBlocks) const
     LOCK(cs);
     return minerPolicyEstimator->estimateFee(nBlocks);
 }
+CFeeRate CTxMemPool::estimateReserveFee(const uint160 &currencyID, int nBlocks) const
+{
+    LOCK(cs);
+    return minerPolicyEstimator->estimateReserveFee(currencyID, nBlocks);
+}
+
+void CTxMemPool::PruneFeeEstimates()
+{
+    std::vector<uint256> vHashes;
+    LOCK(cs);
+    queryHashes(vHashes);
+    minerPolicyEstimator->removeUnknownTxs(vHashes);
+}
+
 double CTxMemPool::estimatePriority(int nBlocks) const
 {
     LOCK(cs);
@@ -1086,6 +1673,25 @@ void CTxMemPool::PrioritiseTransaction(const uint256 &hash, const string strHash
         std::pair<double, CAmount> &deltas = mapDeltas[hash];
         deltas.first += dPriorityDelta;
         deltas.second += nFeeDelta;
+
+        txiter it = mapTx.find(hash);
+        if (it != mapTx.end() && nFeeDelta)
+        {
+            mapTx.modify(it, update_fee_delta(deltas.second));
+            setEntries ancestors, descendants;
+            CalculateAncestors(it, ancestors);
+            CalculateDescendants(it, descendants);
+            mapTx.modify(it, update_ancestor_state(0, nFeeDelta, 0));
+            mapTx.modify(it, update_descendant_state(0, nFeeDelta, 0));
+            for (const txiter &oneAncestor : ancestors)
+            {
+                mapTx.modify(oneAncestor, update_descendant_state(0, nFeeDelta, 0));
+            }
+            for (const txiter &oneDescendant : descendants)
+            {
+                mapTx.modify(oneDescendant, update_ancestor_state(0, nFeeDelta, 0));
+            }
+        }
     }
     if (fDebug)
     {
@@ -1104,6 +1710,12 @@ void CTxMemPool::ApplyDeltas(const uint256 hash, double &dPriorityDelta, CAmount
     nFeeDelta += deltas.second;
 }
 
+void CTxMemPool::GetDeltas(std::map<uint256, std::pair<double, CAmount> > &deltas) const
+{
+    LOCK(cs);
+    deltas = mapDeltas;
+}
+
 void CTxMemPool::ClearPrioritisation(const uint256 hash)
 {
     LOCK(cs);
@@ -1119,10 +1731,12 @@ bool CTxMemPool::PrioritiseReserveTransaction(const CReserveTransactionDescripto
     if (txDesc.IsValid())
     {
         mapReserveTransactions[hash] = txDesc;
+        CCurrencyValueMap reserveFees = txDesc.ReserveFees();
+        minerPolicyEstimator->processReserveTransaction(hash, std::map<uint160, CAmount>(reserveFees.valueMap.begin(), reserveFees.valueMap.end()),
+                                                        ::GetSerializeSize(*txDesc.ptx, SER_NETWORK, PROTOCOL_VERSION));
         CAmount feeDelta = txDesc.NativeFees();
         if (!IsVerusActive())
         {
-            CCurrencyValueMap reserveFees = txDesc.ReserveFees();
             auto it = reserveFees.valueMap.find(VERUS_CHAINID);
             if (it != reserveFees.valueMap.end())
             {
@@ -1246,6 +1860,6 @@ bool CCoinsViewMemPool::HaveCoins(const uint256 &txid) const {
 
 size_t CTxMemPool::DynamicMemoryUsage() const {
     LOCK(cs);
-    // Estimate the overhead of mapTx to be 6 pointers + an allocation, as no exact formula for boost::multi_index_contained is implemented.
-    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 6 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(mapDeltas) + cachedInnerUsage;
+    // Estimate the overhead of mapTx to be 9 pointers + an allocation, as no exact formula for boost::multi_index_contained is implemented.
+    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 9 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapLinks) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(mapDeltas) + cachedInnerUsage;
 }
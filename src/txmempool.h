@@ -6,7 +6,9 @@
 #ifndef BITCOIN_TXMEMPOOL_H
 #define BITCOIN_TXMEMPOOL_H
 
+#include <deque>
 #include <list>
+#include <unordered_map>
 
 #include "addressindex.h"
 #include "spentindex.h"
@@ -22,6 +24,7 @@
 #include "boost/multi_index/ordered_index.hpp"
 
 #include "pbaas/reserves.h"
+#include "reservetransferindex.h"
 
 class CAutoFile;
 
@@ -40,6 +43,9 @@ inline bool AllowFree(double dPriority)
 /** Fake height value used in CCoins to signify they are only in the memory pool (since 0.8) */
 static const unsigned int MEMPOOL_HEIGHT = 0x7FFFFFFF;
 
+/** Most recent mempool additions and removals kept, so a poller can catch up from the changes since its last poll */
+static const size_t MEMPOOL_SEQUENCE_LOG_SIZE = 100000;
+
 /**
  * CTxMemPool stores these:
  */
@@ -61,6 +67,14 @@ private:
     int64_t feeDelta;          //!< Used for determining the priority of the transaction for mining in a block
     uint32_t nBranchId; //! Branch ID this transaction is known to commit to, cached for efficiency
 
+    // package state, including this transaction, over its in-mempool ancestors and descendants
+    uint64_t nCountWithAncestors;
+    uint64_t nSizeWithAncestors;
+    CAmount nModFeesWithAncestors;
+    uint64_t nCountWithDescendants;
+    uint64_t nSizeWithDescendants;
+    CAmount nModFeesWithDescendants;
+
 public:
     CTxMemPoolEntry(const CTransaction& _tx, const CAmount& _nFee,
                     int64_t _nTime, double _dPriority, unsigned int _nHeight,
@@ -83,6 +97,19 @@ public:
 
     bool GetSpendsCoinbase() const { return spendsCoinbase; }
     uint32_t GetValidatedBranchId() const { return nBranchId; }
+
+    // adjusts the package state by the size, modified fees and count of transactions entering or leaving it
+    void UpdateAncestorState(int64_t modifySize, CAmount modifyFee, int64_t modifyCount);
+    void UpdateDescendantState(int64_t modifySize, CAmount modifyFee, int64_t modifyCount);
+    void SetPackageState(uint64_t countAncestors, uint64_t sizeAncestors, CAmount feesAncestors,
+                         uint64_t countDescendants, uint64_t sizeDescendants, CAmount feesDescendants);
+
+    uint64_t GetCountWithAncestors() const { return nCountWithAncestors; }
+    uint64_t GetSizeWithAncestors() const { return nSizeWithAncestors; }
+    CAmount GetModFeesWithAncestors() const { return nModFeesWithAncestors; }
+    uint64_t GetCountWithDescendants() const { return nCountWithDescendants; }
+    uint64_t GetSizeWithDescendants() const { return nSizeWithDescendants; }
+    CAmount GetModFeesWithDescendants() const { return nModFeesWithDescendants; }
 };
 
 struct update_fee_delta
@@ -95,6 +122,46 @@ private:
     int64_t feeDelta;
 };
 
+struct update_ancestor_state
+{
+    update_ancestor_state(int64_t _modifySize, CAmount _modifyFee, int64_t _modifyCount) :
+        modifySize(_modifySize), modifyFee(_modifyFee), modifyCount(_modifyCount) { }
+
+    void operator() (CTxMemPoolEntry &e) { e.UpdateAncestorState(modifySize, modifyFee, modifyCount); }
+
+private:
+    int64_t modifySize;
+    CAmount modifyFee;
+    int64_t modifyCount;
+};
+
+struct update_descendant_state
+{
+    update_descendant_state(int64_t _modifySize, CAmount _modifyFee, int64_t _modifyCount) :
+        modifySize(_modifySize), modifyFee(_modifyFee), modifyCount(_modifyCount) { }
+
+    void operator() (CTxMemPoolEntry &e) { e.UpdateDescendantState(modifySize, modifyFee, modifyCount); }
+
+private:
+    int64_t modifySize;
+    CAmount modifyFee;
+    int64_t modifyCount;
+};
+
+struct set_package_state
+{
+    set_package_state(const CTxMemPoolEntry &_state) : state(_state) { }
+
+    void operator() (CTxMemPoolEntry &e)
+    {
+        e.SetPackageState(state.GetCountWithAncestors(), state.GetSizeWithAncestors(), state.GetModFeesWithAncestors(),
+                          state.GetCountWithDescendants(), state.GetSizeWithDescendants(), state.GetModFeesWithDescendants());
+    }
+
+private:
+    const CTxMemPoolEntry &state;
+};
+
 // extracts a TxMemPoolEntry's transaction hash
 struct mempoolentry_txid
 {
@@ -108,7 +175,7 @@ struct mempoolentry_txid
 class CompareTxMemPoolEntryByFee
 {
 public:
-    bool operator()(const CTxMemPoolEntry& a, const CTxMemPoolEntry& b)
+    bool operator()(const CTxMemPoolEntry& a, const CTxMemPoolEntry& b) const
     {
         if (a.GetFeeRate() == b.GetFeeRate())
             return a.GetTime() < b.GetTime();
@@ -134,6 +201,24 @@ public:
     }
 };
 
+/** \class CompareTxMemPoolEntryByAncestorFee
+ *
+ *  Sort by the modified fee rate of the entry together with its in-mempool ancestors, in descending order
+ */
+class CompareTxMemPoolEntryByAncestorFee
+{
+public:
+    bool operator()(const CTxMemPoolEntry& a, const CTxMemPoolEntry& b) const
+    {
+        double f1 = (double)a.GetModFeesWithAncestors() * b.GetSizeWithAncestors();
+        double f2 = (double)b.GetModFeesWithAncestors() * a.GetSizeWithAncestors();
+        if (f1 == f2) {
+            return a.GetTx().GetHash() < b.GetTx().GetHash();
+        }
+        return f1 > f2;
+    }
+};
+
 class CBlockPolicyEstimator;
 
 /** An inpoint - a combination of a transaction and an index n into its vin */
@@ -165,6 +250,18 @@ struct TxMempoolInfo
     CFeeRate feeRate;
 };
 
+/** Salted hash of an (address type, address) pair for the mempool address index. */
+class CMempoolAddressHasher
+{
+private:
+    uint256 salt;
+
+public:
+    CMempoolAddressHasher();
+
+    size_t operator()(const std::pair<int, uint160> &address) const;
+};
+
 /**
  * CTxMemPool stores valid-according-to-the-current-best-chain
  * transactions that may be included in the next block.
@@ -189,6 +286,14 @@ private:
     uint64_t nRecentlyAddedSequence = 0;
     uint64_t nNotifiedSequence = 0;
 
+    // the mempool sequence counts every addition and removal. the change with each sequence after nSequenceLogStart is
+    // kept in sequenceLog, true when the transaction was added
+    uint64_t nMempoolSequence = 0;
+    uint64_t nSequenceLogStart = 0;
+    std::deque<std::pair<uint256, bool>> sequenceLog;
+
+    void LogSequenceChange(const uint256 &hash, bool fAdded);
+
     std::map<uint256, const CTransaction*> mapSproutNullifiers;
     std::map<uint256, const CTransaction*> mapSaplingNullifiers;
 
@@ -207,6 +312,11 @@ public:
             boost::multi_index::ordered_non_unique<
                 boost::multi_index::identity<CTxMemPoolEntry>,
                 CompareTxMemPoolEntryByFee
+            >,
+            // sorted by fee rate of the entry with its ancestors
+            boost::multi_index::ordered_non_unique<
+                boost::multi_index::identity<CTxMemPoolEntry>,
+                CompareTxMemPoolEntryByAncestorFee
             >
         >
     > indexed_transaction_set;
@@ -214,11 +324,57 @@ public:
     mutable CCriticalSection cs;
     indexed_transaction_set mapTx;
 
+    typedef indexed_transaction_set::nth_index<0>::type::iterator txiter;
+    struct CompareIteratorByHash {
+        bool operator()(const txiter &a, const txiter &b) const {
+            return a->GetTx().GetHash() < b->GetTx().GetHash();
+        }
+    };
+    typedef std::set<txiter, CompareIteratorByHash> setEntries;
+
 private:
-    std::map<CMempoolAddressDeltaKey, CMempoolAddressDelta, CMempoolAddressDeltaKeyCompare> mapAddress;
+    // deltas are bucketed by (address type, address), so a lookup only touches the deltas of the requested addresses
+    std::unordered_map<std::pair<int, uint160>, std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta>>, CMempoolAddressHasher> mapAddress;
     std::map<uint256, std::vector<CMempoolAddressDeltaKey> > mapAddressInserted;
     std::map<CSpentIndexKey, CSpentIndexValue, CSpentIndexKeyCompare> mapSpent;
     std::map<uint256, std::vector<CSpentIndexKey>> mapSpentInserted;
+    std::map<CReserveTransferIndexKey, CReserveTransfer, CReserveTransferIndexKeyCompare> mapReserveTransfers;
+    std::map<uint256, std::vector<CReserveTransferIndexKey>> mapReserveTransfersInserted;
+
+    void insertAddressDelta(const CMempoolAddressDeltaKey &key, const CMempoolAddressDelta &delta, std::vector<CMempoolAddressDeltaKey> &inserted);
+
+    // in-mempool parents and children of each entry, from which package state is kept
+    struct TxLinks {
+        setEntries parents;
+        setEntries children;
+    };
+    typedef std::map<txiter, TxLinks, CompareIteratorByHash> txlinksMap;
+    txlinksMap mapLinks;
+
+    // identity outputs of mempool transactions by outpoint, and for each identity those not yet spent in the mempool,
+    // which is its latest pending state. new names and currency definitions map to the transactions that define them
+    std::map<COutPoint, uint160> mapIdentityOutputs;
+    std::map<uint160, std::set<COutPoint>> mapPendingIdentities;
+    std::map<uint160, std::set<uint256>> mapPendingNames;
+    std::map<uint160, std::set<uint256>> mapPendingCurrencies;
+
+    void addPendingIndexes(const CTransaction &tx);
+    void removePendingIndexes(const CTransaction &tx);
+
+    // transactions by expiry height, with any coinbase at 0, and by the shielded anchors they spend from, so removing
+    // the transactions expired by a block or spending from a disconnected anchor only visits those transactions
+    std::map<uint32_t, std::set<uint256>> mapExpiry;
+    std::map<uint256, std::set<uint256>> mapSproutAnchors;
+    std::map<uint256, std::set<uint256>> mapSaplingAnchors;
+
+    void addRemovalIndexes(const CTransaction &tx);
+    void removeRemovalIndexes(const CTransaction &tx);
+
+    void CalculateAncestors(txiter entryit, setEntries &ancestors) const;
+    void CalculateDescendants(txiter entryit, setEntries &descendants) const;
+    void RecalculatePackageState(txiter entryit);
+    void addPackageLinks(txiter entryit);
+    void removePackageLinks(txiter entryit, std::set<uint256> &staleEntries);
 
 public:
     std::map<COutPoint, CInPoint> mapNextTx;
@@ -238,6 +394,7 @@ public:
     bool addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry, bool fCurrentEstimate = true);
     void addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewCache &view);
     bool getAddressIndex(const std::vector<std::pair<uint160, int> > &addresses, std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > &results);
+    bool getAddressTotals(const std::vector<std::pair<uint160, int> > &addresses, std::map<std::pair<uint160, int>, std::pair<CAmount, CCurrencyValueMap>> &totals);
     static std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta>> FilterUnspent(const std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta>> &memPoolOutputs,
                                                                                                std::set<COutPoint> &spentOutputs);
 
@@ -246,10 +403,16 @@ public:
     void addSpentIndex(const CTxMemPoolEntry &entry, const CCoinsViewCache &view);
     bool getSpentIndex(const CSpentIndexKey &key, CSpentIndexValue &value);
     bool removeSpentIndex(const uint256 txhash);
+
+    void addReserveTransferIndex(const CTxMemPoolEntry &entry);
+    bool getReserveTransferIndex(const uint160 &currencyID, std::vector<CReserveTransferIndexEntry> &transfers);
+    bool removeReserveTransferIndex(const uint256 txhash);
     void remove(const CTransaction &tx, std::list<CTransaction>& removed, bool fRecursive = false);
     void removeWithAnchor(const uint256 &invalidRoot, ShieldedType type);
     void removeForReorg(const CCoinsViewCache *pcoins, unsigned int nMemPoolHeight, int flags);
     bool checkNameConflicts(const CTransaction &tx, std::list<CTransaction> &conflicting);
+    // the identity output of the latest identity update in the mempool, if there is one
+    bool getPendingIdentity(const uint160 &identityID, COutPoint &idOutput, CScript &idScript) const;
     void removeConflicts(const CTransaction &tx, std::list<CTransaction>& removed);
     void removeExpired(unsigned int nBlockHeight);
     void removeForBlock(const std::vector<CTransaction>& vtx, unsigned int nBlockHeight,
@@ -271,14 +434,33 @@ public:
     bool PrioritiseReserveTransaction(const CReserveTransactionDescriptor &txDesc);
     bool IsKnownReserveTransaction(const uint256 &hash, CReserveTransactionDescriptor &txDesc);  // know to be reserve transaction, get descriptor, update mempool
     void ApplyDeltas(const uint256 hash, double &dPriorityDelta, CAmount &nFeeDelta);
+    void GetDeltas(std::map<uint256, std::pair<double, CAmount> > &deltas) const;
     void ClearPrioritisation(const uint256 hash);
     bool CompareDepthAndScore(const uint256& hasha, const uint256& hashb);
+    /**
+     * For every entry, the best fee rate of a package that includes it, which is that of the transaction with the highest
+     * ancestor fee rate among the entry and its descendants. A parent paid for by its children gets its children's rate.
+     */
+    void GetPackageFeeRates(std::map<uint256, CFeeRate> &packageRates) const;
 
     bool nullifierExists(const uint256& nullifier, ShieldedType type) const;
 
     void NotifyRecentlyAdded();
     bool IsFullyNotified();
 
+    uint64_t GetSequence()
+    {
+        LOCK(cs);
+        return nMempoolSequence;
+    }
+
+    /**
+     * The transactions in the mempool now that were not at sequence, and those that were and are not now. Returns false
+     * if the changes since sequence are no longer all kept, or sequence is ahead of this mempool, when a poller has to
+     * read the whole mempool again.
+     */
+    bool GetChangesSince(uint64_t sequence, std::vector<uint256> &added, std::vector<uint256> &removed);
+
     unsigned long size()
     {
         LOCK(cs);
@@ -305,9 +487,15 @@ public:
     /** Estimate fee rate needed to get into the next nBlocks */
     CFeeRate estimateFee(int nBlocks) const;
 
+    /** Estimate the fee rate, in a reserve currency, needed to get into the next nBlocks when paying fees in it */
+    CFeeRate estimateReserveFee(const uint160 &currencyID, int nBlocks) const;
+
     /** Estimate priority needed to get into the next nBlocks */
     double estimatePriority(int nBlocks) const;
 
+    /** Stop estimating from transactions read with the fee estimates that are not in the mempool */
+    void PruneFeeEstimates();
+
     /** Write/Read estimates to disk */
     bool WriteFeeEstimates(CAutoFile& fileout) const;
     bool ReadFeeEstimates(CAutoFile& filein);
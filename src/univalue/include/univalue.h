@@ -47,7 +47,8 @@ public:
         std::string s(val_);
         setStr(s);
     }
-    ~UniValue() {}
+    // no destructor is declared, so the compiler's moves are used when a
+    // vector of values grows, rather than deep copies of each subtree
 
     void clear();
 
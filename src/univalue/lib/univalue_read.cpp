@@ -114,8 +114,6 @@ enum jtokentype getJsonToken(string& tokenVal, unsigned int& consumed,
     case '8':
     case '9': {
         // part 1: int
-        string numStr;
-
         const char *first = raw;
 
         const char *firstDigit = first;
@@ -124,49 +122,39 @@ enum jtokentype getJsonToken(string& tokenVal, unsigned int& consumed,
         if ((*firstDigit == '0') && json_isdigit(firstDigit[1]))
             return JTOK_ERR;
 
-        numStr += *raw;                       // copy first char
-        raw++;
+        raw++;                                // skip first char
 
         if ((*first == '-') && (raw < end) && (!json_isdigit(*raw)))
             return JTOK_ERR;
 
-        while (raw < end && json_isdigit(*raw)) {  // copy digits
-            numStr += *raw;
+        while (raw < end && json_isdigit(*raw))  // skip digits
             raw++;
-        }
 
         // part 2: frac
         if (raw < end && *raw == '.') {
-            numStr += *raw;                   // copy .
-            raw++;
+            raw++;                            // skip .
 
             if (raw >= end || !json_isdigit(*raw))
                 return JTOK_ERR;
-            while (raw < end && json_isdigit(*raw)) { // copy digits
-                numStr += *raw;
+            while (raw < end && json_isdigit(*raw)) // skip digits
                 raw++;
-            }
         }
 
         // part 3: exp
         if (raw < end && (*raw == 'e' || *raw == 'E')) {
-            numStr += *raw;                   // copy E
-            raw++;
+            raw++;                            // skip E
 
-            if (raw < end && (*raw == '-' || *raw == '+')) { // copy +/-
-                numStr += *raw;
+            if (raw < end && (*raw == '-' || *raw == '+')) // skip +/-
                 raw++;
-            }
 
             if (raw >= end || !json_isdigit(*raw))
                 return JTOK_ERR;
-            while (raw < end && json_isdigit(*raw)) { // copy digits
-                numStr += *raw;
+            while (raw < end && json_isdigit(*raw)) // skip digits
                 raw++;
-            }
         }
 
-        tokenVal = numStr;
+        // the number is copied once, as it was scanned
+        tokenVal.assign(first, raw);
         consumed = (raw - rawStart);
         return JTOK_NUMBER;
         }
@@ -174,7 +162,21 @@ enum jtokentype getJsonToken(string& tokenVal, unsigned int& consumed,
     case '"': {
         raw++;                                // skip "
 
-        string valStr;
+        // fast path: a run of printable 7-bit ASCII with no escapes, such as
+        // hex data or an address, is copied at once and needs no UTF-8 checks
+        const char *first = raw;
+        while (raw < end && (unsigned char)*raw >= 0x20 &&
+               (unsigned char)*raw < 0x80 && *raw != '"' && *raw != '\\')
+            raw++;
+        if (raw < end && *raw == '"') {
+            tokenVal.assign(first, raw);
+            raw++;                            // skip "
+            consumed = (raw - rawStart);
+            return JTOK_STRING;
+        }
+
+        // otherwise the run is kept and the rest is filtered one char at a time
+        string valStr(first, raw);
         JSONUTF8StringFilter writer(valStr);
 
         while (raw < end) {
@@ -228,7 +230,7 @@ enum jtokentype getJsonToken(string& tokenVal, unsigned int& consumed,
 
         if (!writer.finalize())
             return JTOK_ERR;
-        tokenVal = valStr;
+        tokenVal.swap(valStr);
         consumed = (raw - rawStart);
         return JTOK_STRING;
         }
@@ -403,14 +405,15 @@ bool UniValue::read(const char *raw, size_t size)
             }
 
         case JTOK_NUMBER: {
-            UniValue tmpVal(VNUM, tokenVal);
             if (!stack.size()) {
-                *this = tmpVal;
+                *this = UniValue(VNUM, tokenVal);
                 break;
             }
 
+            // the token is swapped into the new value rather than copied
             UniValue *top = stack.back();
-            top->values.push_back(tmpVal);
+            top->values.push_back(UniValue(VNUM));
+            top->values.back().val.swap(tokenVal);
 
             setExpect(NOT_VALUE);
             break;
@@ -419,17 +422,18 @@ bool UniValue::read(const char *raw, size_t size)
         case JTOK_STRING: {
             if (expect(OBJ_NAME)) {
                 UniValue *top = stack.back();
-                top->keys.push_back(tokenVal);
+                top->keys.push_back(string());
+                top->keys.back().swap(tokenVal);
                 clearExpect(OBJ_NAME);
                 setExpect(COLON);
             } else {
-                UniValue tmpVal(VSTR, tokenVal);
                 if (!stack.size()) {
-                    *this = tmpVal;
+                    *this = UniValue(VSTR, tokenVal);
                     break;
                 }
                 UniValue *top = stack.back();
-                top->values.push_back(tmpVal);
+                top->values.push_back(UniValue(VSTR));
+                top->values.back().val.swap(tokenVal);
             }
 
             setExpect(NOT_VALUE);
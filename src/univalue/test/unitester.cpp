@@ -156,6 +156,25 @@ void unescape_unicode_test()
     f_assert(val[0].get_str() == "\xf0\x9d\x85\xa1");
 }
 
+void string_run_test()
+{
+    UniValue val;
+    bool testResult;
+    // Plain ASCII, copied in one run
+    testResult = val.read("{\"hex\":\"0a1b2c\",\"n\":-12.5e3}");
+    f_assert(testResult);
+    f_assert(val["hex"].get_str() == "0a1b2c");
+    f_assert(val["n"].getValStr() == "-12.5e3");
+    // ASCII runs followed by an escape and by UTF-8 keep the run
+    testResult = val.read("[\"abc\\ndef\", \"abc\xc6\x91" "def\"]");
+    f_assert(testResult);
+    f_assert(val[0].get_str() == "abc\ndef");
+    f_assert(val[1].get_str() == "abc\xc6\x91" "def");
+    // A control character after an ASCII run is still rejected
+    testResult = val.read("[\"abc\x01\"]");
+    f_assert(!testResult);
+}
+
 int main (int argc, char *argv[])
 {
     for (unsigned int fidx = 0; fidx < ARRAY_SIZE(filenames); fidx++) {
@@ -163,6 +182,7 @@ int main (int argc, char *argv[])
     }
 
     unescape_unicode_test();
+    string_run_test();
 
     return test_failed ? 1 : 0;
 }
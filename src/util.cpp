@@ -19,6 +19,7 @@
 #include "key_io.h"
 
 #include <stdarg.h>
+#include <set>
 #include <sstream>
 #include <vector>
 #include <stdio.h>
@@ -38,6 +39,10 @@
 
 #define _POSIX_C_SOURCE 200112L
 
+// for thread affinity
+#include <pthread.h>
+#include <sched.h>
+
 #endif // __linux__
 
 #include <algorithm>
@@ -727,6 +732,29 @@ const boost::filesystem::path &ZC_GetParamsDir()
     return path;
 }
 
+static boost::mutex csParamsLoading;
+static boost::condition_variable condParamsLoaded;
+static bool fParamsLoading = false;
+
+void ZC_SetParamsLoading(bool fLoading)
+{
+    boost::unique_lock<boost::mutex> lock(csParamsLoading);
+    fParamsLoading = fLoading;
+    if (!fLoading)
+        condParamsLoaded.notify_all();
+}
+
+void ZC_WaitForParams()
+{
+    boost::unique_lock<boost::mutex> lock(csParamsLoading);
+    if (fParamsLoading)
+    {
+        LogPrintf("Waiting for the zk-SNARK parameters to finish loading\n");
+        while (fParamsLoading)
+            condParamsLoaded.wait(lock);
+    }
+}
+
 // Return the user specified export directory.  Create directory if it doesn't exist.
 // If user did not set option, return an empty path.
 // If there is a filesystem problem, throw an exception.
@@ -1045,6 +1073,26 @@ void AllocateFileRange(FILE *file, unsigned int offset, unsigned int length) {
 #endif
 }
 
+bool AdviseFileWillNeed(FILE *file, int64_t offset, int64_t length)
+{
+#if defined(POSIX_FADV_WILLNEED) && !defined(WIN32)
+    return posix_fadvise(fileno(file), (off_t)offset, (off_t)length, POSIX_FADV_WILLNEED) == 0;
+#else
+    return false;
+#endif
+}
+
+bool AdviseFileSequential(FILE *file)
+{
+#if defined(POSIX_FADV_SEQUENTIAL) && !defined(WIN32)
+    return posix_fadvise(fileno(file), 0, 0, POSIX_FADV_SEQUENTIAL) == 0;
+#elif defined(MAC_OSX)
+    return fcntl(fileno(file), F_RDAHEAD, 1) != -1;
+#else
+    return false;
+#endif
+}
+
 void ShrinkDebugFile()
 {
     // Scroll debug.log if it's getting too big
@@ -1175,6 +1223,71 @@ void SetThreadPriority(int nPriority)
 #endif // _WIN32
 }
 
+#ifdef __linux__
+// first logical CPU of each physical core, sorted by package and core id
+static std::vector<int> GetPhysicalCoreCPUs()
+{
+    std::set<std::pair<std::pair<int, int>, int>> coreCPUs;
+    std::set<std::pair<int, int>> seenCores;
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+    {
+        return std::vector<int>();
+    }
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+        if (!CPU_ISSET(cpu, &allowed))
+        {
+            continue;
+        }
+        std::string topology = strprintf("/sys/devices/system/cpu/cpu%d/topology/", cpu);
+        int package = 0, core = cpu;
+        FILE *pFile;
+        if ((pFile = fopen((topology + "physical_package_id").c_str(), "r")) != NULL)
+        {
+            if (fscanf(pFile, "%d", &package) != 1)
+                package = 0;
+            fclose(pFile);
+        }
+        if ((pFile = fopen((topology + "core_id").c_str(), "r")) != NULL)
+        {
+            if (fscanf(pFile, "%d", &core) != 1)
+                core = cpu;
+            fclose(pFile);
+        }
+        if (seenCores.insert(std::make_pair(package, core)).second)
+        {
+            coreCPUs.insert(std::make_pair(std::make_pair(package, core), cpu));
+        }
+    }
+    std::vector<int> cpus;
+    for (auto &oneCore : coreCPUs)
+    {
+        cpus.push_back(oneCore.second);
+    }
+    return cpus;
+}
+#endif
+
+bool SetThreadCoreAffinity(int nThreadIndex)
+{
+#ifdef __linux__
+    static std::vector<int> coreCPUs = GetPhysicalCoreCPUs();
+    if (!coreCPUs.size() || nThreadIndex < 0)
+    {
+        return false;
+    }
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(coreCPUs[nThreadIndex % coreCPUs.size()], &cpuSet);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) == 0;
+#else
+    (void)nThreadIndex;
+    return false;
+#endif
+}
+
 std::string PrivacyInfo()
 {
     return "\n" +
@@ -1203,3 +1316,32 @@ int GetNumCores()
     return boost::thread::physical_concurrency();
 }
 
+bool RunInParallel(size_t count, const std::function<bool(size_t)> &runOne, size_t minParallel)
+{
+    std::vector<unsigned char> runOK(count, 0);
+    std::atomic<size_t> nextItem(0);
+    auto runItems = [&runOne, &runOK, &nextItem, count]()
+    {
+        for (size_t i = nextItem++; i < count; i = nextItem++)
+        {
+            runOK[i] = runOne(i);
+        }
+    };
+
+    size_t nThreads = std::min((size_t)std::max(GetNumCores(), 1), count);
+    if (count < minParallel || nThreads <= 1)
+    {
+        runItems();
+    }
+    else
+    {
+        boost::thread_group runThreads;
+        for (size_t t = 0; t < nThreads; t++)
+        {
+            runThreads.create_thread(runItems);
+        }
+        runThreads.join_all();
+    }
+    return std::find(runOK.begin(), runOK.end(), 0) == runOK.end();
+}
+
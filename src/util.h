@@ -20,6 +20,7 @@
 
 #include <atomic>
 #include <exception>
+#include <functional>
 #include <map>
 #include <stdint.h>
 #include <string>
@@ -121,12 +122,26 @@ static inline bool error(const char* format)
 
 const boost::filesystem::path &ZC_GetParamsDir();
 
+/**
+ * The zk-SNARK parameters are loaded on a thread at startup when -loadparamsasync is set. ZC_WaitForParams() is
+ * called before anything proves or verifies, and returns at once unless they are still loading.
+ */
+static const bool DEFAULT_LOAD_PARAMS_ASYNC = true;
+void ZC_SetParamsLoading(bool fLoading);
+void ZC_WaitForParams();
+
 void PrintExceptionContinue(const std::exception *pex, const char* pszThread);
 void ParseParameters(int argc, const char*const argv[]);
 void FileCommit(FILE *fileout);
 bool TruncateFile(FILE *file, unsigned int length);
 int RaiseFileDescriptorLimit(int nMinFD);
 void AllocateFileRange(FILE *file, unsigned int offset, unsigned int length);
+/**
+ * Read hints to the OS, which starts reading a range in the background, or reads ahead further with a file read
+ * in order. Both are advisory and return false where the OS takes no hints, a length of 0 meaning to the end of file.
+ */
+bool AdviseFileWillNeed(FILE *file, int64_t offset, int64_t length);
+bool AdviseFileSequential(FILE *file);
 bool RenameOver(boost::filesystem::path src, boost::filesystem::path dest);
 bool TryCreateDirectory(const boost::filesystem::path& p);
 boost::filesystem::path GetDefaultDataDir();
@@ -260,9 +275,23 @@ std::string HelpMessageOpt(const std::string& option, const std::string& message
  */
 int GetNumCores();
 
+/**
+ * Run runOne(i) for each of count items on up to one thread per core, with each thread taking the next item not yet
+ * taken, so no thread waits on another's long item. Items run on the calling thread when there are fewer than
+ * minParallel of them. Returns true if runOne returned true for every item.
+ */
+bool RunInParallel(size_t count, const std::function<bool(size_t)> &runOne, size_t minParallel=2);
+
 void SetThreadPriority(int nPriority);
 void RenameThread(const char* name);
 
+/**
+ * Pin the calling thread to one physical core, chosen by thread index. Cores are ordered by
+ * package, so consecutive indexes fill one socket before the next, and memory the thread allocates
+ * afterwards is first touched on its own NUMA node. Returns false where affinity is not supported.
+ */
+bool SetThreadCoreAffinity(int nThreadIndex);
+
 /**
  * .. and a wrapper that just calls func once
  */
@@ -0,0 +1,224 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "utxostats.h"
+
+#include "clientversion.h"
+#include "main.h"
+#include "streams.h"
+#include "txdb.h"
+#include "undo.h"
+#include "util.h"
+
+#include <functional>
+
+bool fUTXOStats = DEFAULT_UTXOSTATS;
+
+namespace {
+
+enum UTXOStatsState
+{
+    UTXOSTATS_DISABLED,
+    UTXOSTATS_PENDING,                  // to be rebuilt, blocks are not applied until the rebuild takes its snapshot
+    UTXOSTATS_REBUILDING,               // utxoStats holds the changes made since the snapshot
+    UTXOSTATS_READY                     // utxoStats is as of the tip
+};
+
+// guarded by cs_main
+UTXOStatsState utxoStatsState = UTXOSTATS_DISABLED;
+CUTXOSetStats utxoStats;
+
+void UpdateSetHash(MuHash3072 &setHash, const uint256 &txid, uint32_t n, const CTxOut &out, bool fRemove)
+{
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << txid << n << out;
+    if (fRemove)
+        setHash.Remove((const unsigned char *)&ss[0], ss.size());
+    else
+        setHash.Insert((const unsigned char *)&ss[0], ss.size());
+}
+
+// outputs that are never added to the coins database are not part of the set
+bool IsCountedOutput(const CTxOut &out)
+{
+    return !out.IsNull() && !out.scriptPubKey.IsUnspendable();
+}
+
+void ThreadRebuildUTXOSetStats(CCoinsViewDB *pcoinsdb)
+{
+    // the coins database is flushed up to the tip, so the blocks connected from here on are all that is missing from
+    // a scan of the snapshot
+    std::shared_ptr<const CDBSnapshot> snapshot;
+    uint256 hashSnapshot;
+    {
+        LOCK(cs_main);
+        FlushStateToDisk();
+        snapshot = pcoinsdb->GetSnapshot();
+        hashSnapshot = pcoinsTip->GetBestBlock();
+        utxoStats = CUTXOSetStats();
+        utxoStatsState = UTXOSTATS_REBUILDING;
+    }
+    LogPrintf("%s: rebuilding UTXO set statistics from block %s\n", __func__, hashSnapshot.GetHex());
+
+    CUTXOSetStats stats;
+    if (!pcoinsdb->GetUTXOSetStats(stats, *snapshot) || stats.hashBlock != hashSnapshot)
+    {
+        LOCK(cs_main);
+        utxoStatsState = UTXOSTATS_DISABLED;
+        LogPrintf("%s: unable to read the coins database, UTXO set statistics are disabled\n", __func__);
+        return;
+    }
+
+    LOCK(cs_main);
+    stats += utxoStats;
+    stats.hashBlock = pcoinsTip->GetBestBlock();
+    utxoStats = stats;
+    utxoStatsState = UTXOSTATS_READY;
+    LogPrintf("%s: UTXO set statistics rebuilt at block %s, %d outputs\n", __func__, stats.hashBlock.GetHex(), stats.nTransactionOutputs);
+}
+
+} // namespace
+
+void CUTXOSetStats::AddOutput(const uint256 &txid, uint32_t n, const CTxOut &out)
+{
+    if (!IsCountedOutput(out))
+        return;
+    nTransactionOutputs++;
+    nTotalAmount += out.nValue;
+    CCurrencyValueMap reserveValues = out.ReserveOutValue();
+    if (reserveValues.valueMap.size())
+    {
+        reserves = (reserves + reserveValues).CanonicalMap();
+        for (auto &oneValue : reserveValues.valueMap)
+            reserveOutputs[oneValue.first]++;
+    }
+    UpdateSetHash(setHash, txid, n, out, false);
+}
+
+void CUTXOSetStats::RemoveOutput(const uint256 &txid, uint32_t n, const CTxOut &out)
+{
+    if (!IsCountedOutput(out))
+        return;
+    nTransactionOutputs--;
+    nTotalAmount -= out.nValue;
+    CCurrencyValueMap reserveValues = out.ReserveOutValue();
+    if (reserveValues.valueMap.size())
+    {
+        reserves = (reserves - reserveValues).CanonicalMap();
+        for (auto &oneValue : reserveValues.valueMap)
+        {
+            if (!--reserveOutputs[oneValue.first])
+                reserveOutputs.erase(oneValue.first);
+        }
+    }
+    UpdateSetHash(setHash, txid, n, out, true);
+}
+
+CUTXOSetStats &CUTXOSetStats::operator+=(const CUTXOSetStats &delta)
+{
+    if (!delta.hashBlock.IsNull())
+        hashBlock = delta.hashBlock;
+    nTransactionOutputs += delta.nTransactionOutputs;
+    nTotalAmount += delta.nTotalAmount;
+    reserves = (reserves + delta.reserves).CanonicalMap();
+    for (auto &oneCount : delta.reserveOutputs)
+        reserveOutputs[oneCount.first] += oneCount.second;
+    for (auto it = reserveOutputs.begin(); it != reserveOutputs.end(); )
+        it = it->second ? std::next(it) : reserveOutputs.erase(it);
+    setHash *= delta.setHash;
+    return *this;
+}
+
+uint256 CUTXOSetStats::GetSetHash() const
+{
+    uint256 hash;
+    setHash.Finalize(hash.begin());
+    return hash;
+}
+
+void LoadUTXOSetStats()
+{
+    LOCK(cs_main);
+    if (!fUTXOStats)
+        return;
+
+    // statistics persisted with a flush the coins database did not finish, or before a reindex, are not used
+    CUTXOSetStats stats;
+    uint256 hashTip = pcoinsTip->GetBestBlock();
+    if (hashTip.IsNull())
+    {
+        utxoStats = CUTXOSetStats();
+        utxoStatsState = UTXOSTATS_READY;
+    }
+    else if (pblocktree->ReadUTXOSetStats(stats) && stats.hashBlock == hashTip)
+    {
+        utxoStats = stats;
+        utxoStatsState = UTXOSTATS_READY;
+        LogPrintf("%s: loaded UTXO set statistics at block %s\n", __func__, hashTip.GetHex());
+    }
+    else
+    {
+        utxoStatsState = UTXOSTATS_PENDING;
+        LogPrintf("%s: UTXO set statistics will be rebuilt in the background\n", __func__);
+    }
+}
+
+void StartUTXOSetStats(boost::thread_group &threadGroup, CCoinsViewDB *pcoinsdb)
+{
+    {
+        LOCK(cs_main);
+        if (utxoStatsState != UTXOSTATS_PENDING)
+            return;
+    }
+    std::function<void()> rebuild = std::bind(&ThreadRebuildUTXOSetStats, pcoinsdb);
+    threadGroup.create_thread(boost::bind(&TraceThread<std::function<void()>>, "utxostats", rebuild));
+}
+
+void UpdateUTXOSetStats(const CBlock &block, const CBlockUndo &blockUndo, const CBlockIndex *pindex, bool fDisconnect)
+{
+    AssertLockHeld(cs_main);
+    if (utxoStatsState != UTXOSTATS_REBUILDING && utxoStatsState != UTXOSTATS_READY)
+        return;
+
+    for (size_t i = 0; i < block.vtx.size(); i++)
+    {
+        const CTransaction &tx = block.vtx[i];
+        const uint256 txid = tx.GetHash();
+        for (uint32_t k = 0; k < tx.vout.size(); k++)
+        {
+            if (fDisconnect)
+                utxoStats.RemoveOutput(txid, k, tx.vout[k]);
+            else
+                utxoStats.AddOutput(txid, k, tx.vout[k]);
+        }
+        if (i == 0 || tx.IsMint() || i > blockUndo.vtxundo.size())
+            continue;
+        const CTxUndo &txundo = blockUndo.vtxundo[i - 1];
+        for (size_t j = 0; j < tx.vin.size() && j < txundo.vprevout.size(); j++)
+        {
+            if (fDisconnect)
+                utxoStats.AddOutput(tx.vin[j].prevout.hash, tx.vin[j].prevout.n, txundo.vprevout[j].txout);
+            else
+                utxoStats.RemoveOutput(tx.vin[j].prevout.hash, tx.vin[j].prevout.n, txundo.vprevout[j].txout);
+        }
+    }
+    utxoStats.hashBlock = fDisconnect ? pindex->pprev->GetBlockHash() : pindex->GetBlockHash();
+}
+
+bool WriteUTXOSetStats(const uint256 &hashFlushed)
+{
+    AssertLockHeld(cs_main);
+    if (utxoStatsState != UTXOSTATS_READY || utxoStats.hashBlock != hashFlushed)
+        return true;
+    return pblocktree->WriteUTXOSetStats(utxoStats);
+}
+
+bool GetUTXOSetStats(CUTXOSetStats &stats)
+{
+    LOCK(cs_main);
+    if (utxoStatsState != UTXOSTATS_READY)
+        return false;
+    stats = utxoStats;
+    return true;
+}
@@ -0,0 +1,87 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_UTXOSTATS_H
+#define BITCOIN_UTXOSTATS_H
+
+#include "amount.h"
+#include "crypto/muhash.h"
+#include "pbaas/crosschainrpc.h"
+#include "serialize.h"
+#include "uint256.h"
+
+#include <map>
+
+#include <boost/thread.hpp>
+
+class CBlock;
+class CBlockIndex;
+class CBlockUndo;
+class CCoinsViewDB;
+class CTxOut;
+
+/** Whether to maintain UTXO set statistics, see -utxostats */
+static const bool DEFAULT_UTXOSTATS = false;
+
+extern bool fUTXOStats;
+
+/**
+ * Statistics of the unspent outputs as of a block, kept up to date as blocks are connected and disconnected. The
+ * counts and amounts are signed, since the same structure holds the changes made by blocks while the statistics are
+ * rebuilt from the coins database.
+ */
+struct CUTXOSetStats
+{
+    uint256 hashBlock;
+    int64_t nTransactionOutputs;
+    CAmount nTotalAmount;
+    CCurrencyValueMap reserves;                         // reserve currency amounts held by the outputs
+    std::map<uint160, int64_t> reserveOutputs;          // number of outputs holding each reserve currency
+    MuHash3072 setHash;                                 // hash of the set of serialized outpoints and outputs
+
+    CUTXOSetStats() : nTransactionOutputs(0), nTotalAmount(0) {}
+
+    void AddOutput(const uint256 &txid, uint32_t n, const CTxOut &out);
+    void RemoveOutput(const uint256 &txid, uint32_t n, const CTxOut &out);
+
+    /** Adds the changes of another set of statistics, which must start where these end */
+    CUTXOSetStats &operator+=(const CUTXOSetStats &delta);
+
+    uint256 GetSetHash() const;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        unsigned char num[Num3072::BYTE_SIZE], den[Num3072::BYTE_SIZE];
+        if (!ser_action.ForRead())
+            setHash.GetState(num, den);
+        READWRITE(hashBlock);
+        READWRITE(nTransactionOutputs);
+        READWRITE(nTotalAmount);
+        READWRITE(reserves);
+        READWRITE(reserveOutputs);
+        READWRITE(FLATDATA(num));
+        READWRITE(FLATDATA(den));
+        if (ser_action.ForRead())
+            setHash.SetState(num, den);
+    }
+};
+
+/** Reads the statistics persisted with the tip, call with the coins and block index loaded */
+void LoadUTXOSetStats();
+
+/** Starts rebuilding the statistics from the coins database if they were not valid for the tip */
+void StartUTXOSetStats(boost::thread_group &threadGroup, CCoinsViewDB *pcoinsdb);
+
+/** Applies a block that was connected to or disconnected from the tip, requires cs_main */
+void UpdateUTXOSetStats(const CBlock &block, const CBlockUndo &blockUndo, const CBlockIndex *pindex, bool fDisconnect);
+
+/** Persists the statistics if they are as of the block the coins database was flushed at, requires cs_main */
+bool WriteUTXOSetStats(const uint256 &hashFlushed);
+
+/** The statistics as of the tip, false while they are not enabled or still being rebuilt */
+bool GetUTXOSetStats(CUTXOSetStats &stats);
+
+#endif // BITCOIN_UTXOSTATS_H
@@ -200,6 +200,10 @@ void AsyncRPCOperation_sendmany::main() {
         set_error_message("unknown error");
     }
 
+    // a sent transaction is in the wallet by now, so its inputs are spent
+    unlock_utxos();
+    unlock_notes();
+
 #ifdef ENABLE_MINING
   #ifdef ENABLE_WALLET
     GenerateBitcoins(GetBoolArg("-gen",false), pwalletMain, GetArg("-genproclimit", 0));
@@ -243,7 +247,7 @@ void AsyncRPCOperation_sendmany::main() {
 // Notes:
 // 1. #1159 Currently there is no limit set on the number of joinsplits, so size of tx could be invalid.
 // 2. #1360 Note selection is not optimal
-// 3. #1277 Spendable notes are not locked, so an operation running in parallel could also try to use them
+// 3. #1277 Inputs of the builder path are locked once selected, so an operation running in parallel skips them
 bool AsyncRPCOperation_sendmany::main_impl() {
 
     assert(isfromtaddr_ != isfromzaddr_);
@@ -402,6 +406,16 @@ bool AsyncRPCOperation_sendmany::main_impl() {
             }
         }
 
+        // skip outputs that another operation locked after they were found, which may leave too little to select
+        for (int i = t_inputs_.size() - 1; i >= 0; i--)
+        {
+            if (pwalletMain->IsLockedCoin(t_inputs_txids_[i], t_inputs_[i].i))
+            {
+                t_inputs_.erase(t_inputs_.begin() + i);
+                t_inputs_txids_.erase(t_inputs_txids_.begin() + i);
+            }
+        }
+
         if (targetAllAmounts.valueMap.size() == 1 && targetNativeAmount != 0)
         {
             // only native currency matters, so use simpler functon
@@ -473,6 +487,10 @@ bool AsyncRPCOperation_sendmany::main_impl() {
 
         t_inputs_ = selectedTInputs;
         t_inputs_total = selectedUTXOAmount;
+        if (isUsingBuilder_)
+        {
+            lock_utxos();
+        }
 
         // Check mempooltxinputlimit to avoid creating a transaction which the local mempool rejects
         size_t limit = (size_t)GetArg("-mempooltxinputlimit", 0);
@@ -583,17 +601,28 @@ bool AsyncRPCOperation_sendmany::main_impl() {
             builder_.SendChangeTo(changeAddr);
         }
 
-        // Select Sapling notes
+        // Select Sapling notes that no other operation has locked since they were found
         std::vector<SaplingOutPoint> ops;
         std::vector<SaplingNote> notes;
         CAmount sum = 0;
-        for (auto t : z_sapling_inputs_) {
-            ops.push_back(t.op);
-            notes.push_back(t.note);
-            sum += t.note.value();
-            if (sum >= targetNativeAmount) {
-                break;
+        {
+            LOCK2(cs_main, pwalletMain->cs_wallet);
+            for (auto t : z_sapling_inputs_) {
+                if (pwalletMain->IsLockedNote(t.op)) {
+                    continue;
+                }
+                ops.push_back(t.op);
+                notes.push_back(t.note);
+                sum += t.note.value();
+                if (sum >= targetNativeAmount) {
+                    break;
+                }
             }
+            lock_notes(ops);
+        }
+        if (isfromzaddr_ && sum < targetNativeAmount) {
+            throw JSONRPCError(RPC_WALLET_INSUFFICIENT_FUNDS, strprintf("Insufficient unlocked funds, have %s, which is less than required amount %s, other operations may be spending the rest",
+                FormatMoney(sum), FormatMoney(targetNativeAmount)));
         }
 
         // Fetch Sapling anchor and witnesses
@@ -1265,6 +1294,51 @@ bool AsyncRPCOperation_sendmany::find_utxos(bool fAcceptProtectedCoinbase)
     return t_inputs_.size() > 0;
 }
 
+/**
+ * Lock selected input utxos
+ */
+void AsyncRPCOperation_sendmany::lock_utxos() {
+    LOCK2(cs_main, pwalletMain->cs_wallet);
+    for (auto &t : t_inputs_) {
+        COutPoint utxo(t.tx->GetHash(), t.i);
+        pwalletMain->LockCoin(utxo);
+        lockedUtxos_.push_back(utxo);
+    }
+}
+
+/**
+ * Unlock the utxos this operation locked
+ */
+void AsyncRPCOperation_sendmany::unlock_utxos() {
+    LOCK2(cs_main, pwalletMain->cs_wallet);
+    for (auto &utxo : lockedUtxos_) {
+        pwalletMain->UnlockCoin(utxo);
+    }
+    lockedUtxos_.clear();
+}
+
+/**
+ * Lock selected input notes
+ */
+void AsyncRPCOperation_sendmany::lock_notes(const std::vector<SaplingOutPoint>& ops) {
+    LOCK2(cs_main, pwalletMain->cs_wallet);
+    for (auto &op : ops) {
+        pwalletMain->LockNote(op);
+        lockedNotes_.push_back(op);
+    }
+}
+
+/**
+ * Unlock the notes this operation locked
+ */
+void AsyncRPCOperation_sendmany::unlock_notes() {
+    LOCK2(cs_main, pwalletMain->cs_wallet);
+    for (auto &op : lockedNotes_) {
+        pwalletMain->UnlockNote(op);
+    }
+    lockedNotes_.clear();
+}
+
 bool AsyncRPCOperation_sendmany::find_unspent_notes() {
     std::vector<SproutNoteEntry> sproutEntries;
     std::vector<SaplingNoteEntry> saplingEntries;
@@ -1397,6 +1471,7 @@ UniValue AsyncRPCOperation_sendmany::perform_joinsplit(
     uint256 esk; // payment disclosure - secret
 
     assert(mtx.fOverwintered && (mtx.nVersion >= SAPLING_TX_VERSION));
+    ZC_WaitForParams();
     JSDescription jsdesc = JSDescription::Randomized(
             *pzcashParams,
             joinSplitPubKey_,
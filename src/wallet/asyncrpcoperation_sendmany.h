@@ -106,6 +106,10 @@ private:
     std::vector<SendManyInputJSOP> z_sprout_inputs_;
     std::vector<SaplingNoteEntry> z_sapling_inputs_;
 
+    // inputs locked while this operation spends them, so that operations running in parallel do not select them too
+    std::vector<COutPoint> lockedUtxos_;
+    std::vector<SaplingOutPoint> lockedNotes_;
+
     TransactionBuilder builder_;
     CTransaction tx_;
 
@@ -115,6 +119,14 @@ private:
     bool find_utxos(bool fAcceptProtectedCoinbase);
     bool main_impl();
 
+    void lock_utxos();
+
+    void unlock_utxos();
+
+    void lock_notes(const std::vector<SaplingOutPoint>& ops);
+
+    void unlock_notes();
+
     // JoinSplit without any input notes to spend
     UniValue perform_joinsplit(AsyncJoinSplitInfo &);
 
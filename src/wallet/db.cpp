@@ -306,7 +306,7 @@ void CDB::Close()
     activeTxn = NULL;
     pdb = NULL;
 
-    if (fFlushOnClose)
+    if (fFlushOnClose && !bitdb.DeferFlush(strFile))
         Flush();
 
     {
@@ -338,6 +338,40 @@ bool CDBEnv::RemoveDb(const string& strFile)
     return (rc == 0);
 }
 
+bool CDBEnv::DeferFlush(const string& strFile)
+{
+    LOCK(cs_db);
+    if (!mapFileGroupCommits.count(strFile))
+        return false;
+    setFileFlushDeferred.insert(strFile);
+    return true;
+}
+
+CDBGroupCommit::CDBGroupCommit(const string& strFileIn) : strFile(strFileIn)
+{
+    if (strFile.empty())
+        return;
+    LOCK(bitdb.cs_db);
+    ++bitdb.mapFileGroupCommits[strFile];
+}
+
+CDBGroupCommit::~CDBGroupCommit()
+{
+    if (strFile.empty())
+        return;
+    {
+        LOCK(bitdb.cs_db);
+        if (--bitdb.mapFileGroupCommits[strFile] > 0)
+            return;
+        bitdb.mapFileGroupCommits.erase(strFile);
+        if (!bitdb.setFileFlushDeferred.erase(strFile))
+            return;
+    }
+    // the one flush of all of the writes made since the outermost group commit began
+    if (bitdb.dbenv)
+        bitdb.dbenv->txn_checkpoint(0, 0, 0);
+}
+
 bool CDB::Rewrite(const string& strFile, const char* pszSkip)
 {
     while (true) {
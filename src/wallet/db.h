@@ -13,6 +13,7 @@
 #include "version.h"
 
 #include <map>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -38,6 +39,9 @@ public:
     DbEnv *dbenv;
     std::map<std::string, int> mapFileUseCount;
     std::map<std::string, Db*> mapDb;
+    // the group commits open on each file, and the files with a flush deferred until the last of them ends
+    std::map<std::string, int> mapFileGroupCommits;
+    std::set<std::string> setFileFlushDeferred;
 
     CDBEnv();
     ~CDBEnv();
@@ -73,6 +77,8 @@ public:
 
     void CloseDb(const std::string& strFile);
     bool RemoveDb(const std::string& strFile);
+    // returns true if a group commit is open on strFile, which then flushes it when it ends
+    bool DeferFlush(const std::string& strFile);
 
     DbTxn* TxnBegin(int flags = DB_TXN_WRITE_NOSYNC)
     {
@@ -86,6 +92,24 @@ public:
 
 extern CDBEnv bitdb;
 
+/**
+ * RAII group commit of the writes to a database file. While any is open on the file, each CDB of it that is closed
+ * leaves its flush to the end of the outermost one, so a run of writes is checkpointed to disk once instead of once
+ * for each of them. Each write is still committed on its own, without a sync, as it is outside of a group commit.
+ */
+class CDBGroupCommit
+{
+public:
+    explicit CDBGroupCommit(const std::string& strFileIn);
+    ~CDBGroupCommit();
+
+private:
+    std::string strFile;
+
+    CDBGroupCommit(const CDBGroupCommit&);
+    void operator=(const CDBGroupCommit&);
+};
+
 
 /** RAII class that provides access to a Berkeley database */
 class CDB
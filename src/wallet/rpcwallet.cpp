@@ -3743,17 +3743,19 @@ UniValue listtransactions(const UniValue& params, bool fHelp)
     UniValue ret(UniValue::VARR);
 
     std::list<CAccountingEntry> acentries;
-    CWallet::TxItems txOrdered = pwalletMain->OrderedTxItems(acentries, strAccount);
 
     // iterate backwards until we have nCount items to return:
-    for (CWallet::TxItems::reverse_iterator it = txOrdered.rbegin(); it != txOrdered.rend(); ++it)
+    pwalletMain->ReverseOrderedTxItems(acentries, [&](CWalletTx *const pwtx, CAccountingEntry *const pacentry)
     {
-        CWalletTx *const pwtx = (*it).second.first;
-        uint256 blockHash = pwtx->hashBlock;
-        if (blockHash.IsNull())
+        uint256 blockHash;
+        if (pwtx != 0)
         {
-            CTransaction altTx;
-            myGetTransaction(pwtx->GetHash(), altTx, blockHash);
+            blockHash = pwtx->hashBlock;
+            if (blockHash.IsNull())
+            {
+                CTransaction altTx;
+                myGetTransaction(pwtx->GetHash(), altTx, blockHash);
+            }
         }
         auto blockIter = mapBlockIndex.find(blockHash);
         bool skipThis = (reportQuery.isObject() &&
@@ -3776,13 +3778,13 @@ UniValue listtransactions(const UniValue& params, bool fHelp)
                 }
             }
 
-            CAccountingEntry *const pacentry = (*it).second.second;
             if (pacentry != 0)
                 AcentryToJSON(*pacentry, strAccount, ret);
 
-            if ((int)ret.size() >= (nCount+nFrom)) break;
+            if ((int)ret.size() >= (nCount+nFrom)) return false;
         }
-    }
+        return true;
+    }, strAccount);
     // ret is newest to oldest
 
     bool summaryOutput = reportQuery.isObject() && !nFrom && nCount > ret.size();
@@ -5360,6 +5362,7 @@ UniValue zc_sample_joinsplit(const UniValue& params, bool fHelp)
 
     uint256 joinSplitPubKey;
     uint256 anchor = SproutMerkleTree().root();
+    ZC_WaitForParams();
     JSDescription samplejoinsplit(*pzcashParams,
                                   joinSplitPubKey,
                                   anchor,
@@ -5374,6 +5377,29 @@ UniValue zc_sample_joinsplit(const UniValue& params, bool fHelp)
     return HexStr(ss.begin(), ss.end());
 }
 
+// VerusHash version for the VerusHash benchmarks, "1", "2", "2.1" or "2.2". CLHash is only part of 2.0 and later
+static int BenchmarkVerusHashVersion(const UniValue &param, bool clhash)
+{
+    std::string version = param.isStr() ? param.get_str() : param.getValStr();
+    if (version == "1" && !clhash)
+    {
+        return 0;
+    }
+    else if (version == "2")
+    {
+        return SOLUTION_VERUSHHASH_V2;
+    }
+    else if (version == "2.1")
+    {
+        return SOLUTION_VERUSHHASH_V2_1;
+    }
+    else if (version == "2.2")
+    {
+        return SOLUTION_VERUSHHASH_V2_2;
+    }
+    throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid VerusHash version " + version);
+}
+
 UniValue zc_benchmark(const UniValue& params, bool fHelp)
 {
     if (!EnsureWalletIsAvailable(fHelp)) {
@@ -5387,6 +5413,15 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp)
             "Runs a benchmark of the selected type samplecount times,\n"
             "returning the running times of each sample.\n"
             "\n"
+            "VerusHash benchmarks time 100000 hashes per sample:\n"
+            "  zcbenchmark verushash samplecount version (nthreads)            version is 1, 2, 2.1 or 2.2\n"
+            "  zcbenchmark verusclhash samplecount version (nthreads)          optimized CLHash, version is 2, 2.1 or 2.2\n"
+            "  zcbenchmark verusclhashportable samplecount version (nthreads)  portable CLHash, version is 2, 2.1 or 2.2\n"
+            "  zcbenchmark verifyverushash samplecount                         proof of work hash check of the tip header\n"
+            "\n"
+            "  zcbenchmark convertamounts samplecount (nreserves)              1000 fractional basket conversions per sample, default 10 reserves\n"
+            "  zcbenchmark replayimports samplecount (nblocks)                 all imports of the last nblocks blocks per sample, default 1000\n"
+            "\n"
             "Output: [\n"
             "  {\n"
             "    \"runningtime\": runningtime\n"
@@ -5417,6 +5452,7 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp)
         ss >> samplejoinsplit;
     }
 
+    ZC_WaitForParams();
     for (int i = 0; i < samplecount; i++) {
         if (benchmarktype == "sleep") {
             sample_times.push_back(benchmark_sleep());
@@ -5446,6 +5482,46 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp)
 #endif
         } else if (benchmarktype == "verifyequihash") {
             sample_times.push_back(benchmark_verify_equihash());
+        } else if (benchmarktype == "verushash" || benchmarktype == "verusclhash" || benchmarktype == "verusclhashportable") {
+            if (params.size() < 3) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "VerusHash version required");
+            }
+            bool clhash = benchmarktype != "verushash";
+            bool portable = benchmarktype == "verusclhashportable";
+            int solutionVersion = BenchmarkVerusHashVersion(params[2], clhash);
+            if (clhash && !portable && !IsCPUVerusOptimized()) {
+                throw JSONRPCError(RPC_TYPE_ERROR, "Optimized VerusHash is not supported on this CPU");
+            }
+            std::function<double(void)> benchmark = clhash ?
+                std::function<double(void)>(std::bind(benchmark_verusclhash, solutionVersion, portable)) :
+                std::function<double(void)>(std::bind(benchmark_verushash, solutionVersion));
+            if (params.size() < 4) {
+                sample_times.push_back(benchmark());
+            } else {
+                int nThreads = params[3].get_int();
+                std::vector<double> vals = benchmark_verushash_threaded(nThreads, benchmark);
+                sample_times.insert(sample_times.end(), vals.begin(), vals.end());
+            }
+        } else if (benchmarktype == "verifyverushash") {
+            sample_times.push_back(benchmark_verify_verushash());
+        } else if (benchmarktype == "convertamounts") {
+            int nReserves = CCurrencyState::MAX_RESERVE_CURRENCIES;
+            if (params.size() >= 3) {
+                nReserves = params[2].get_int();
+            }
+            if (nReserves < 1 || nReserves > CCurrencyState::MAX_RESERVE_CURRENCIES) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "nreserves must be between 1 and 10");
+            }
+            sample_times.push_back(benchmark_convertamounts(nReserves));
+        } else if (benchmarktype == "replayimports") {
+            int nBlocks = 1000;
+            if (params.size() >= 3) {
+                nBlocks = params[2].get_int();
+            }
+            if (nBlocks < 1) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "nblocks must be positive");
+            }
+            sample_times.push_back(benchmark_replay_imports(nBlocks));
         } else if (benchmarktype == "validatelargetx") {
             // Number of inputs in the spending transaction that we will simulate
             int nInputs = 11130;
@@ -5726,6 +5802,7 @@ UniValue zc_raw_joinsplit(const UniValue& params, bool fHelp)
     mtx.nVersionGroupId = SAPLING_VERSION_GROUP_ID;
     mtx.joinSplitPubKey = joinSplitPubKey;
 
+    ZC_WaitForParams();
     JSDescription jsdesc(*pzcashParams,
                          joinSplitPubKey,
                          anchor,
@@ -12,9 +12,11 @@
 #include "consensus/upgrades.h"
 #include "consensus/validation.h"
 #include "consensus/consensus.h"
+#include "core_memusage.h"
 #include "init.h"
 #include "key_io.h"
 #include "main.h"
+#include "metrics.h"
 #include "mmr.h"
 #include "net.h"
 #include "random.h"
@@ -356,6 +358,7 @@ bool CWallet::AddKeyPubKey(const CKey& secret, const CPubKey &pubkey)
     AssertLockHeld(cs_wallet); // mapKeyMetadata
     if (!CCryptoKeyStore::AddKeyPubKey(secret, pubkey))
         return false;
+    MarkOutputIndexDirty();
 
     // check if we need to remove from watch-only
     CScript script;
@@ -379,6 +382,7 @@ bool CWallet::AddCryptedKey(const CPubKey &vchPubKey,
 
     if (!CCryptoKeyStore::AddCryptedKey(vchPubKey, vchCryptedSecret))
         return false;
+    MarkOutputIndexDirty();
     if (!fFileBacked)
         return true;
     {
@@ -550,6 +554,7 @@ bool CWallet::AddCScript(const CScript& redeemScript)
     // hash of the script, we store it under the name ID
     if (!CCryptoKeyStore::AddCScript(redeemScript))
         return false;
+    MarkOutputIndexDirty();
     if (!fFileBacked)
         return true;
     return CWalletDB(strWalletFile).WriteCScript(ScriptOrIdentityID(redeemScript), redeemScript);
@@ -578,6 +583,7 @@ bool CWallet::AddIdentity(const CIdentityMapKey &mapKey, const CIdentityMapValue
     // hash of the script, we store it under the name ID
     if (!CCryptoKeyStore::AddIdentity(mapKey, identity))
         return false;
+    MarkOutputIndexDirty();
     if (!fFileBacked)
         return true;
     return CWalletDB(strWalletFile).WriteIdentity(mapKey, identity);
@@ -590,6 +596,7 @@ bool CWallet::UpdateIdentity(const CIdentityMapKey &mapKey, const CIdentityMapVa
     // hash of the script, we store it under the name ID
     if (!CCryptoKeyStore::UpdateIdentity(mapKey, identity))
         return false;
+    MarkOutputIndexDirty();
     if (!fFileBacked)
         return true;
     return CWalletDB(strWalletFile).WriteIdentity(mapKey, identity);
@@ -602,6 +609,7 @@ bool CWallet::AddUpdateIdentity(const CIdentityMapKey &mapKey, const CIdentityMa
     // hash of the script, we store it under the name ID
     if (!CCryptoKeyStore::AddUpdateIdentity(mapKey, identity))
         return false;
+    MarkOutputIndexDirty();
     if (!fFileBacked)
         return true;
     return CWalletDB(strWalletFile).WriteIdentity(mapKey, identity);
@@ -611,6 +619,7 @@ void CWallet::ClearIdentities(uint32_t fromHeight)
 {
     if (fFileBacked)
     {
+        CDBGroupCommit groupCommit(strWalletFile);
         for (auto &idPair : mapIdentities)
         {
             if (CIdentityMapKey(idPair.first).blockHeight >= fromHeight)
@@ -621,6 +630,35 @@ void CWallet::ClearIdentities(uint32_t fromHeight)
     }
 
     CCryptoKeyStore::ClearIdentities(fromHeight);
+    mapIdentityStates.clear();
+    MarkOutputIndexDirty();
+}
+
+// returns the current confirmed state of an identity, looking it up on chain only if it changed since it was last read
+CIdentity CWallet::GetCurrentIdentityState(const CIdentityID &idID, uint32_t *pHeightOut)
+{
+    AssertLockHeld(cs_wallet);
+
+    auto it = mapIdentityStates.find(idID);
+    if (it == mapIdentityStates.end())
+    {
+        uint32_t height = 0;
+        CIdentity identity = CIdentity::LookupIdentity(idID, 0, &height);
+        if (!identity.IsValid())
+        {
+            if (pHeightOut)
+            {
+                *pHeightOut = height;
+            }
+            return identity;
+        }
+        it = mapIdentityStates.insert(std::make_pair(idID, std::make_pair(identity, height))).first;
+    }
+    if (pHeightOut)
+    {
+        *pHeightOut = it->second.second;
+    }
+    return it->second.first;
 }
 
 bool CWallet::RemoveIdentity(const CIdentityMapKey &mapKey, const uint256 &txid)
@@ -809,6 +847,7 @@ bool CWallet::AddWatchOnly(const CScript &dest)
 {
     if (!CCryptoKeyStore::AddWatchOnly(dest))
         return false;
+    MarkOutputIndexDirty();
     nTimeFirstKey = 1; // No birthday information for watch-only keys.
     NotifyWatchonlyChanged(true);
     if (!fFileBacked)
@@ -821,6 +860,7 @@ bool CWallet::RemoveWatchOnly(const CScript &dest)
     AssertLockHeld(cs_wallet);
     if (!CCryptoKeyStore::RemoveWatchOnly(dest))
         return false;
+    MarkOutputIndexDirty();
     if (!HaveWatchOnly())
         NotifyWatchonlyChanged(false);
     if (fFileBacked)
@@ -934,9 +974,17 @@ void CWallet::ChainTip(const CBlockIndex *pindex,
     } else {
         DecrementNoteWitnesses(pindex);
         UpdateSaplingNullifierNoteMapForBlock(pblock);
+        MarkStakeIndexDirty();
+        MarkOutputIndexDirty();
     }
 }
 
+void CWallet::MarkStakeIndexDirty()
+{
+    LOCK(cs_wallet);
+    fStakeIndexDirty = true;
+}
+
 void CWallet::RunSaplingMigration(int blockHeight) {
     if (!Params().GetConsensus().NetworkUpgradeActive(blockHeight, Consensus::UPGRADE_SAPLING)) {
         return;
@@ -1404,8 +1452,12 @@ void CopyPreviousWitnesses(NoteDataMap& noteDataMap, int indexHeight, int64_t nW
     }
 }
 
-template<typename NoteDataMap>
-void AppendNoteCommitment(NoteDataMap& noteDataMap, int indexHeight, int64_t nWitnessCacheSize, const uint256& note_commitment)
+// witnesses to append the commitments of a block to, each from the index of the first commitment after its note
+template<typename Witness>
+using WitnessesToIncrement = std::vector<std::pair<Witness*, size_t>>;
+
+template<typename NoteDataMap, typename Witness>
+void CollectWitnessesToIncrement(NoteDataMap& noteDataMap, int indexHeight, int64_t nWitnessCacheSize, WitnessesToIncrement<Witness>& toIncrement)
 {
     for (auto& item : noteDataMap) {
         auto* nd = &(item.second);
@@ -1413,13 +1465,47 @@ void AppendNoteCommitment(NoteDataMap& noteDataMap, int indexHeight, int64_t nWi
             // Check the validity of the cache
             // See comment in CopyPreviousWitnesses about validity.
             assert(nWitnessCacheSize >= nd->witnesses.size());
-            nd->witnesses.front().append(note_commitment);
+            toIncrement.push_back(std::make_pair(&nd->witnesses.front(), 0));
+        }
+    }
+}
+
+// every witness only depends on its own note, so they are appended to on as many threads as there is work for
+template<typename Witness>
+void AppendNoteCommitments(const WitnessesToIncrement<Witness>& toIncrement, const std::vector<uint256>& commitments, int nThreads)
+{
+    size_t nAppends = 0;
+    for (auto& oneWitness : toIncrement) {
+        nAppends += commitments.size() - oneWitness.second;
+    }
+    if (!nAppends) {
+        return;
+    }
+
+    nThreads = std::max(1, std::min({nThreads, (int)toIncrement.size(), (int)(nAppends / MIN_WITNESS_APPENDS_PER_THREAD)}));
+    auto appendRange = [&](int threadNum)
+    {
+        for (size_t k = threadNum; k < toIncrement.size(); k += nThreads) {
+            for (size_t i = toIncrement[k].second; i < commitments.size(); i++) {
+                toIncrement[k].first->append(commitments[i]);
+            }
+        }
+    };
+
+    if (nThreads == 1) {
+        appendRange(0);
+    } else {
+        boost::thread_group appendThreads;
+        for (int i = 0; i < nThreads; i++) {
+            appendThreads.create_thread(boost::bind<void>(appendRange, i));
         }
+        appendThreads.join_all();
     }
 }
 
 template<typename OutPoint, typename NoteData, typename Witness>
-void WitnessNoteIfMine(std::map<OutPoint, NoteData>& noteDataMap, int indexHeight, int64_t nWitnessCacheSize, const OutPoint& key, const Witness& witness)
+void WitnessNoteIfMine(std::map<OutPoint, NoteData>& noteDataMap, int indexHeight, int64_t nWitnessCacheSize, const OutPoint& key, const Witness& witness,
+                       WitnessesToIncrement<Witness>& toIncrement, size_t nextCommitment)
 {
     if (noteDataMap.count(key) && noteDataMap[key].witnessHeight < indexHeight) {
         auto* nd = &(noteDataMap[key]);
@@ -1438,9 +1524,14 @@ void WitnessNoteIfMine(std::map<OutPoint, NoteData>& noteDataMap, int indexHeigh
                         nd->witnesses.front().root().GetHex(),
                         indexHeight,
                         witness.root().GetHex());
+            Witness* pStale = &nd->witnesses.front();
+            toIncrement.erase(std::remove_if(toIncrement.begin(), toIncrement.end(),
+                                             [pStale](const std::pair<Witness*, size_t>& oneWitness) { return oneWitness.first == pStale; }),
+                              toIncrement.end());
             nd->witnesses.clear();
         }
         nd->witnesses.push_front(witness);
+        toIncrement.push_back(std::make_pair(&nd->witnesses.front(), nextCommitment));
         // Set height to one less than pindex so it gets incremented
         nd->witnessHeight = indexHeight - 1;
         // Check the validity of the cache
@@ -1485,6 +1576,18 @@ void CWallet::IncrementNoteWitnesses(const CBlockIndex* pindex,
         pblock = &block;
     }
 
+    // Existing witnesses get every commitment of the block, and the witnesses of our
+    // notes in it the commitments after their own. The tree and the new witnesses are
+    // built in order, then all of the appends are done at once.
+    WitnessesToIncrement<SproutWitness> sproutWitnesses;
+    WitnessesToIncrement<SaplingWitness> saplingWitnesses;
+    for (std::pair<const uint256, CWalletTx>& wtxItem : mapWallet) {
+        ::CollectWitnessesToIncrement(wtxItem.second.mapSproutNoteData, pindex->GetHeight(), nWitnessCacheSize, sproutWitnesses);
+        ::CollectWitnessesToIncrement(wtxItem.second.mapSaplingNoteData, pindex->GetHeight(), nWitnessCacheSize, saplingWitnesses);
+    }
+    std::vector<uint256> sproutCommitments;
+    std::vector<uint256> saplingCommitments;
+
     for (const CTransaction& tx : pblock->vtx) {
         auto hash = tx.GetHash();
         bool txIsOurs = mapWallet.count(hash);
@@ -1494,16 +1597,13 @@ void CWallet::IncrementNoteWitnesses(const CBlockIndex* pindex,
             for (uint8_t j = 0; j < jsdesc.commitments.size(); j++) {
                 const uint256& note_commitment = jsdesc.commitments[j];
                 sproutTree.append(note_commitment);
-
-                // Increment existing witnesses
-                for (std::pair<const uint256, CWalletTx>& wtxItem : mapWallet) {
-                    ::AppendNoteCommitment(wtxItem.second.mapSproutNoteData, pindex->GetHeight(), nWitnessCacheSize, note_commitment);
-                }
+                sproutCommitments.push_back(note_commitment);
 
                 // If this is our note, witness it
                 if (txIsOurs) {
                     JSOutPoint jsoutpt {hash, i, j};
-                    ::WitnessNoteIfMine(mapWallet[hash].mapSproutNoteData, pindex->GetHeight(), nWitnessCacheSize, jsoutpt, sproutTree.witness());
+                    ::WitnessNoteIfMine(mapWallet[hash].mapSproutNoteData, pindex->GetHeight(), nWitnessCacheSize, jsoutpt, sproutTree.witness(),
+                                        sproutWitnesses, sproutCommitments.size());
                 }
             }
         }
@@ -1511,20 +1611,22 @@ void CWallet::IncrementNoteWitnesses(const CBlockIndex* pindex,
         for (uint32_t i = 0; i < tx.vShieldedOutput.size(); i++) {
             const uint256& note_commitment = tx.vShieldedOutput[i].cm;
             saplingTree.append(note_commitment);
-
-            // Increment existing witnesses
-            for (std::pair<const uint256, CWalletTx>& wtxItem : mapWallet) {
-                ::AppendNoteCommitment(wtxItem.second.mapSaplingNoteData, pindex->GetHeight(), nWitnessCacheSize, note_commitment);
-            }
+            saplingCommitments.push_back(note_commitment);
 
             // If this is our note, witness it
             if (txIsOurs) {
                 SaplingOutPoint outPoint {hash, i};
-                ::WitnessNoteIfMine(mapWallet[hash].mapSaplingNoteData, pindex->GetHeight(), nWitnessCacheSize, outPoint, saplingTree.witness());
+                ::WitnessNoteIfMine(mapWallet[hash].mapSaplingNoteData, pindex->GetHeight(), nWitnessCacheSize, outPoint, saplingTree.witness(),
+                                    saplingWitnesses, saplingCommitments.size());
             }
         }
     }
 
+    // Increment witnesses
+    int nWitnessThreads = GetArg("-witnessthreads", DEFAULT_WITNESS_THREADS);
+    ::AppendNoteCommitments(sproutWitnesses, sproutCommitments, nWitnessThreads);
+    ::AppendNoteCommitments(saplingWitnesses, saplingCommitments, nWitnessThreads);
+
     // Update witness heights
     for (std::pair<const uint256, CWalletTx>& wtxItem : mapWallet) {
         ::UpdateWitnessHeights(wtxItem.second.mapSproutNoteData, pindex->GetHeight(), nWitnessCacheSize);
@@ -1707,12 +1809,9 @@ CWallet::TxItems CWallet::OrderedTxItems(std::list<CAccountingEntry>& acentries,
     // First: get all CWalletTx and CAccountingEntry into a sorted-by-order multimap.
     TxItems txOrdered;
 
-    // Note: maintaining indices in the database of (account,time) --> txid and (account, time) --> acentry
-    // would make this much faster for applications that do this a lot.
-    for (map<uint256, CWalletTx>::iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+    for (auto &entry : GetOrderedWalletTxes())
     {
-        CWalletTx* wtx = &((*it).second);
-        txOrdered.insert(make_pair(wtx->nOrderPos, TxPair(wtx, (CAccountingEntry*)0)));
+        txOrdered.insert(txOrdered.end(), make_pair(entry.first, TxPair(entry.second, (CAccountingEntry*)0)));
     }
     acentries.clear();
     walletdb.ListAccountCreditDebit(strAccount, acentries);
@@ -1724,15 +1823,121 @@ CWallet::TxItems CWallet::OrderedTxItems(std::list<CAccountingEntry>& acentries,
     return txOrdered;
 }
 
-CAmount CWallet::EligibleStakeOutputs(std::vector<COutput> &vecOutputs, std::vector<CWalletTx> &vwtx, bool extendedStake) const
+const std::multimap<int64_t, CWalletTx*>& CWallet::GetOrderedWalletTxes()
+{
+    AssertLockHeld(cs_wallet); // mapWallet
+    if (fTxOrderedDirty)
+    {
+        mapTxOrdered.clear();
+        for (auto &entry : mapWallet)
+        {
+            mapTxOrdered.insert(make_pair(entry.second.nOrderPos, &entry.second));
+        }
+        fTxOrderedDirty = false;
+    }
+    return mapTxOrdered;
+}
+
+void CWallet::ReverseOrderedTxItems(std::list<CAccountingEntry>& acentries, const std::function<bool(CWalletTx*, CAccountingEntry*)>& fn, std::string strAccount)
+{
+    AssertLockHeld(cs_wallet); // mapWallet
+
+    // accounting entries are few, so only they are read and sorted here, then merged with the ordered transactions
+    acentries.clear();
+    CWalletDB(strWalletFile).ListAccountCreditDebit(strAccount, acentries);
+    std::multimap<int64_t, CAccountingEntry*> acOrdered;
+    for (auto &entry : acentries)
+    {
+        acOrdered.insert(make_pair(entry.nOrderPos, &entry));
+    }
+
+    const std::multimap<int64_t, CWalletTx*> &txOrdered = GetOrderedWalletTxes();
+    auto txIt = txOrdered.rbegin();
+    auto acIt = acOrdered.rbegin();
+    while (txIt != txOrdered.rend() || acIt != acOrdered.rend())
+    {
+        bool more;
+        if (acIt == acOrdered.rend() || (txIt != txOrdered.rend() && txIt->first >= acIt->first))
+        {
+            more = fn((txIt++)->second, (CAccountingEntry*)0);
+        }
+        else
+        {
+            more = fn((CWalletTx*)0, (acIt++)->second);
+        }
+        if (!more)
+        {
+            break;
+        }
+    }
+}
+
+// returns all wallet outputs that are eligible to stake at nHeight and their total value. outputs that can stake are kept
+// in the stake index along with the height at which they reach stake age or maturity, so the wallet is only scanned
+// again after it changes
+CAmount CWallet::StakeCandidates(std::vector<CStakeableOutput> &candidates, uint32_t nHeight, bool extendedStake) const
 {
     CAmount totalStakingAmount = 0;
-    std:vector<std::vector<unsigned char>> vSolutions;
 
     LOCK2(cs_main, cs_wallet);
-    pwalletMain->AvailableCoins(vecOutputs, true, NULL, false, true, false);
 
-    int newSize = 0;
+    uint32_t solutionVersion = CConstVerusSolutionVector::GetVersionByHeight(nHeight);
+    if (fStakeIndexDirty || fStakeIndexExtended != extendedStake || nStakeIndexSolutionVersion != solutionVersion)
+    {
+        RebuildStakeIndex(extendedStake);
+        fStakeIndexDirty = false;
+        fStakeIndexExtended = extendedStake;
+        nStakeIndexSolutionVersion = solutionVersion;
+    }
+
+    candidates.clear();
+    for (auto &oneOutput : vStakeIndex)
+    {
+        if (oneOutput.eligibleHeight <= nHeight)
+        {
+            totalStakingAmount += oneOutput.nValue;
+            candidates.push_back(oneOutput);
+        }
+    }
+    return totalStakingAmount;
+}
+
+CAmount CWallet::EligibleStakeOutputs(std::vector<COutput> &vecOutputs, std::vector<CWalletTx> &vwtx, bool extendedStake) const
+{
+    std::vector<CStakeableOutput> candidates;
+    uint32_t nHeight;
+    CAmount totalStakingAmount;
+    {
+        LOCK(cs_main);
+        nHeight = chainActive.Height() + 1;
+        totalStakingAmount = StakeCandidates(candidates, nHeight, extendedStake);
+    }
+
+    // no reallocations to move objects
+    vecOutputs.resize(candidates.size());
+    vwtx.resize(candidates.size());
+    for (int i = 0; i < candidates.size(); i++)
+    {
+        vwtx[i] = *candidates[i].tx;
+        vecOutputs[i] = COutput(&vwtx[i], candidates[i].voutNum, nHeight - candidates[i].confirmedHeight, true);
+    }
+    return totalStakingAmount;
+}
+
+void CWallet::RebuildStakeIndex(bool extendedStake) const
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+
+    std::vector<COutput> vecOutputs;
+    std:vector<std::vector<unsigned char>> vSolutions;
+
+    // include immature coinbases, which become eligible when they mature
+    AvailableCoins(vecOutputs, true, NULL, false, true, false, true);
+    vStakeIndex.clear();
+
+    uint32_t nHeight = chainActive.Height() + 1;
+    std::map<uint256, std::shared_ptr<const CWalletTx>> sharedTxes;
     bool idStakingChain = ConnectedChains.ThisChain().IDStaking();
 
     std::set<uint160> validIDs;
@@ -1748,7 +1953,7 @@ CAmount CWallet::EligibleStakeOutputs(std::vector<COutput> &vecOutputs, std::vec
             txout.i < txout.tx->vout.size() &&
             txout.tx->vout[txout.i].nValue > 0 &&
             txout.fSpendable &&
-            (txout.nDepth >= VERUS_MIN_STAKEAGE) &&
+            txout.nDepth > 0 &&
             ((txout.tx->vout[txout.i].scriptPubKey.IsPayToCryptoCondition(p) &&
                 extendedStake &&
                 p.IsValid() &&
@@ -1817,13 +2022,20 @@ CAmount CWallet::EligibleStakeOutputs(std::vector<COutput> &vecOutputs, std::vec
                 continue;
             }
 
-            totalStakingAmount += txout.tx->vout[txout.i].nValue;
-            // if all are valid, no change, else compress
-            if (newSize != i)
+            uint32_t confirmedHeight = nHeight - txout.nDepth;
+            uint32_t eligibleHeight = confirmedHeight + VERUS_MIN_STAKEAGE;
+            int blocksToMaturity = txout.tx->GetBlocksToMaturity();
+            if (blocksToMaturity > 0)
             {
-                vecOutputs[newSize] = txout;
+                eligibleHeight = std::max(eligibleHeight, nHeight + blocksToMaturity);
             }
-            newSize++;
+
+            std::shared_ptr<const CWalletTx> &sharedTx = sharedTxes[txout.tx->GetHash()];
+            if (!sharedTx)
+            {
+                sharedTx = std::make_shared<const CWalletTx>(*txout.tx);
+            }
+            vStakeIndex.push_back(CStakeableOutput(sharedTx, txout.i, confirmedHeight, eligibleHeight));
         }
         else if (logFailures)
         {
@@ -1831,18 +2043,65 @@ CAmount CWallet::EligibleStakeOutputs(std::vector<COutput> &vecOutputs, std::vec
         }
     }
 
-    if (newSize)
+    LogPrint("staking", "%s: indexed %lu stakeable outputs at height %u\n", __func__, vStakeIndex.size(), nHeight);
+}
+
+// evaluates the stake hash of each candidate against the target, across -genproclimit threads, or all cores if mining
+// is not enabled. the POS nonce includes the txid and output of each candidate, so every worker uses its own copy of
+// the block nonce, and the nonce of each qualifying candidate is returned with its index, in candidate order
+static std::vector<std::pair<int, CPOSNonce>> EvaluateStakeHashes(const std::vector<CStakeableOutput> &candidates,
+                                                                  const CPOSNonce &blockNonce,
+                                                                  int32_t nHeight,
+                                                                  const uint256 &pastHash,
+                                                                  const arith_uint256 &target)
+{
+    // small wallets are not worth the cost of starting threads
+    const int minCandidatesPerThread = 256;
+
+    int numThreads = GetArg("-genproclimit", 0);
+    if (numThreads <= 0)
+    {
+        numThreads = GetNumCores();
+    }
+    numThreads = std::max(1, std::min(numThreads, (int)(candidates.size() / minCandidatesPerThread)));
+
+    std::vector<std::vector<std::pair<int, CPOSNonce>>> threadHits(numThreads);
+
+    auto evaluateRange = [&candidates, &blockNonce, &threadHits, nHeight, &pastHash, &target, numThreads](int threadNum)
+    {
+        CPOSNonce nonce = blockNonce;
+        int start = (candidates.size() * threadNum) / numThreads;
+        int end = (candidates.size() * (threadNum + 1)) / numThreads;
+        for (int i = start; i < end; i++)
+        {
+            const CStakeableOutput &oneCandidate = candidates[i];
+            if (UintToArith256(CTransaction::_GetVerusPOSHash(&nonce, oneCandidate.tx->GetHash(), oneCandidate.voutNum, nHeight, pastHash, oneCandidate.nValue)) <= target)
+            {
+                threadHits[threadNum].push_back(std::make_pair(i, nonce));
+            }
+        }
+    };
+
+    if (numThreads == 1)
+    {
+        evaluateRange(0);
+    }
+    else
     {
-        // no reallocations to move objects. do all at once, so we can release the wallet lock
-        vecOutputs.resize(newSize);
-        vwtx.resize(newSize);
-        for (int i = 0; i < vecOutputs.size(); i++)
+        boost::thread_group hashThreads;
+        for (int i = 0; i < numThreads; i++)
         {
-            vwtx[i] = *vecOutputs[i].tx;
-            vecOutputs[i].tx = &vwtx[i];
+            hashThreads.create_thread(boost::bind<void>(evaluateRange, i));
         }
+        hashThreads.join_all();
     }
-    return totalStakingAmount;
+
+    std::vector<std::pair<int, CPOSNonce>> stakeHits;
+    for (auto &oneThreadHits : threadHits)
+    {
+        stakeHits.insert(stakeHits.end(), oneThreadHits.begin(), oneThreadHits.end());
+    }
+    return stakeHits;
 }
 
 // looks through all wallet UTXOs and checks to see if any qualify to stake the block at the current height. it always returns the qualified
@@ -1853,8 +2112,7 @@ bool CWallet::VerusSelectStakeOutput(CBlock *pBlock, arith_uint256 &hashResult,
 {
     arith_uint256 target;
     arith_uint256 curHash;
-    COutput *pwinner = NULL;
-    CWalletTx winnerWtx;
+    const CStakeableOutput *pwinner = NULL;
 
     txnouttype whichType;
     std:vector<std::vector<unsigned char>> vSolutions;
@@ -1865,15 +2123,15 @@ bool CWallet::VerusSelectStakeOutput(CBlock *pBlock, arith_uint256 &hashResult,
     auto consensusParams = Params().GetConsensus();
     CValidationState state;
 
-    std::vector<COutput> vecOutputs;
-    std::vector<CWalletTx> vwtx;
+    std::vector<CStakeableOutput> candidates;
     CAmount totalStakingAmount = 0;
 
     uint32_t solutionVersion = CConstVerusSolutionVector::GetVersionByHeight(nHeight);
     bool isPBaaS = solutionVersion >= CActivationHeight::ACTIVATE_PBAAS;
     bool extendedStake = solutionVersion >= CActivationHeight::ACTIVATE_EXTENDEDSTAKE;
 
-    totalStakingAmount = EligibleStakeOutputs(vecOutputs, vwtx, extendedStake);
+    int64_t nEvaluationStart = GetTimeMicros();
+    totalStakingAmount = StakeCandidates(candidates, nHeight, extendedStake);
 
     if (totalStakingAmount)
     {
@@ -1917,28 +2175,32 @@ bool CWallet::VerusSelectStakeOutput(CBlock *pBlock, arith_uint256 &hashResult,
 
         std::map<uint160, uint32_t> idHeights;
 
-        BOOST_FOREACH(COutput &txout, vecOutputs)
+        // hash all candidates without locks, then check only those that qualify, in candidate order
+        std::vector<std::pair<int, CPOSNonce>> stakeHits = EvaluateStakeHashes(candidates, pBlock->nNonce, nHeight, pastHash, target);
+
+        for (auto &oneHit : stakeHits)
         {
+            const CStakeableOutput &txout = candidates[oneHit.first];
             COptCCParams p;
             std::vector<CTxDestination> destinations;
             int nRequired = 0;
             bool canSign = false, canSpend = false;
 
-            if (UintToArith256(txout.tx->GetVerusPOSHash(&(pBlock->nNonce), txout.i, nHeight, pastHash)) <= target)
+            pBlock->nNonce = oneHit.second;
             {
                 LOCK2(cs_main, cs_wallet);
 
-                if (ExtractDestinations(txout.tx->vout[txout.i].scriptPubKey, whichType, destinations, nRequired, this, &canSign, &canSpend) &&
-                    ((txout.tx->vout[txout.i].scriptPubKey.IsPayToCryptoCondition(p) &&
+                if (ExtractDestinations(txout.tx->vout[txout.voutNum].scriptPubKey, whichType, destinations, nRequired, this, &canSign, &canSpend) &&
+                    ((txout.tx->vout[txout.voutNum].scriptPubKey.IsPayToCryptoCondition(p) &&
                     extendedStake &&
                     canSpend) ||
                     (!p.IsValid() && (whichType == TX_PUBKEY || whichType == TX_PUBKEYHASH) && ::IsMine(*this, destinations[0]) == ISMINE_SPENDABLE)))
                 {
                     uint256 txHash = txout.tx->GetHash();
-                    checkStakeTx.vin.push_back(CTxIn(COutPoint(txHash, txout.i)));
+                    checkStakeTx.vin.push_back(CTxIn(COutPoint(txHash, txout.voutNum)));
 
                     if ((!pwinner || UintToArith256(curNonce) < UintToArith256(pBlock->nNonce)) &&
-                        !cheatList.IsUTXOInList(COutPoint(txHash, txout.i), nHeight <= 100 ? 1 : nHeight-100))
+                        !cheatList.IsUTXOInList(COutPoint(txHash, txout.voutNum), nHeight <= 100 ? 1 : nHeight-100))
                     {
                         if (view.HaveCoins(txHash) && Consensus::CheckTxInputs(checkStakeTx, state, view, nHeight, consensusParams))
                         {
@@ -1980,7 +2242,7 @@ bool CWallet::VerusSelectStakeOutput(CBlock *pBlock, arith_uint256 &hashResult,
                                 //printf("Found PoS block\nnNonce:    %s\n", pBlock->nNonce.GetHex().c_str());
                                 pwinner = &txout;
                                 curNonce = pBlock->nNonce;
-                                srcIndex = nHeight - txout.nDepth;
+                                srcIndex = txout.confirmedHeight;
                             }
                         }
                         else
@@ -1994,6 +2256,7 @@ bool CWallet::VerusSelectStakeOutput(CBlock *pBlock, arith_uint256 &hashResult,
                 }
             }
         }
+        RecordStakeEvaluation(candidates.size(), stakeHits.size(), pwinner != NULL, GetTimeMicros() - nEvaluationStart);
 
         if (pwinner)
         {
@@ -2006,7 +2269,7 @@ bool CWallet::VerusSelectStakeOutput(CBlock *pBlock, arith_uint256 &hashResult,
             //         stakeSource.GetVerusPOSHash(&(pBlock->nNonce), pwinner->i, nHeight, pastHash).GetHex().c_str(),
             //         ArithToUint256(post).GetHex().c_str());
 
-            voutNum = pwinner->i;
+            voutNum = pwinner->voutNum;
             pBlock->nNonce = curNonce;
 
             if (solutionVersion >= CActivationHeight::ACTIVATE_STAKEHEADER)
@@ -2033,13 +2296,13 @@ bool CWallet::VerusSelectStakeOutput(CBlock *pBlock, arith_uint256 &hashResult,
                 pBlock->AddUpdatePBaaSHeader();
 
                 // get map and MMR for stake source transaction
-                CTransactionMap txMap(stakeSource);
+                const CTransactionMap &txMap = stakeSource.GetTransactionMap();
                 TransactionMMView txView(txMap.transactionMMR);
                 uint256 txRoot = txView.GetRoot();
 
                 std::vector<CTransactionComponentProof> txProofVec;
                 txProofVec.push_back(CTransactionComponentProof(txView, txMap, stakeSource, CTransactionHeader::TX_HEADER, 0));
-                txProofVec.push_back(CTransactionComponentProof(txView, txMap, stakeSource, CTransactionHeader::TX_OUTPUT, pwinner->i));
+                txProofVec.push_back(CTransactionComponentProof(txView, txMap, stakeSource, CTransactionHeader::TX_OUTPUT, pwinner->voutNum));
 
                 // now, both the header and stake output are dependent on the transaction MMR root being provable up
                 // through the block MMR, and since we don't cache the new MMR proof for transactions yet, we need the block to create the proof.
@@ -2309,6 +2572,7 @@ void CWallet::MarkDirty()
         LOCK(cs_wallet);
         BOOST_FOREACH(PAIRTYPE(const uint256, CWalletTx)& item, mapWallet)
             item.second.MarkDirty();
+        MarkBalancesDirty();
     }
 }
 
@@ -2442,10 +2706,13 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet, CWalletD
         mapWallet[hash].BindWallet(this);
         UpdateNullifierNoteMapWithTx(mapWallet[hash]);
         AddToSpends(hash);
+        MarkOutputIndexDirty();
+        MarkTxOrderedDirty();
     }
     else
     {
         LOCK(cs_wallet);
+        fStakeIndexDirty = true;
         // Inserts only if not already there, returns tx inserted or tx found
         pair<map<uint256, CWalletTx>::iterator, bool> ret = mapWallet.insert(make_pair(hash, wtxIn));
         CWalletTx& wtx = (*ret.first).second;
@@ -2456,6 +2723,7 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet, CWalletD
         {
             wtx.nTimeReceived = GetAdjustedTime();
             wtx.nOrderPos = IncOrderPosNext(pwalletdb);
+            mapTxOrdered.insert(make_pair(wtx.nOrderPos, &wtx));
 
             wtx.nTimeSmart = wtx.nTimeReceived;
             if (!wtxIn.hashBlock.IsNull())
@@ -2468,13 +2736,10 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet, CWalletD
                         // Tolerate times up to the last timestamp in the wallet not more than 5 minutes into the future
                         int64_t latestTolerated = latestNow + 300;
                         std::list<CAccountingEntry> acentries;
-                        TxItems txOrdered = OrderedTxItems(acentries);
-                        for (TxItems::reverse_iterator it = txOrdered.rbegin(); it != txOrdered.rend(); ++it)
+                        ReverseOrderedTxItems(acentries, [&](CWalletTx *pwtx, CAccountingEntry *pacentry)
                         {
-                            CWalletTx *const pwtx = (*it).second.first;
                             if (pwtx == &wtx)
-                                continue;
-                            CAccountingEntry *const pacentry = (*it).second.second;
+                                return true;
                             int64_t nSmartTime;
                             if (pwtx)
                             {
@@ -2489,9 +2754,10 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet, CWalletD
                                 latestEntry = nSmartTime;
                                 if (nSmartTime > latestNow)
                                     latestNow = nSmartTime;
-                                break;
+                                return false;
                             }
-                        }
+                            return true;
+                        });
                     }
 
                     int64_t blocktime = mapBlockIndex[wtxIn.hashBlock]->GetBlockTime();
@@ -2544,6 +2810,9 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet, CWalletD
         // Break debit/credit balance caches:
         wtx.MarkDirty();
 
+        // index its outputs and unindex the ones it spends
+        UpdateOutputIndex(wtx);
+
         // Notify UI of new or updated transaction
         NotifyTransactionChanged(this, hash, fInsertedNew ? CT_NEW : CT_UPDATED);
 
@@ -2658,6 +2927,7 @@ bool CWallet::MarkIdentityDirty(const CIdentityID &idID)
         if (dirty)
         {
             txidAndWtx.second.MarkDirty();
+            MarkBalancesDirty();
         }
     }
     return found;
@@ -2675,7 +2945,8 @@ bool CWallet::MarkIdentityDirty(const CIdentityID &idID)
  * updated; instead, the transaction being in the mempool or conflicted is determined on
  * the fly in CMerkleTx::GetDepthInMainChain().
  */
-bool CWallet::AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pblock, bool fUpdate, bool isRescan)
+bool CWallet::AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pblock, bool fUpdate, bool isRescan,
+                                       const std::pair<mapSaplingNoteData_t, SaplingIncomingViewingKeyMap> *pSaplingNotes)
 {
     {
         AssertLockHeld(cs_wallet);
@@ -2686,10 +2957,14 @@ bool CWallet::AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pbl
         bool isNewID = false;
         if (fExisted && !fUpdate) return false;
         auto sproutNoteData = FindMySproutNotes(tx);
-        auto saplingNoteDataAndAddressesToAdd = FindMySaplingNotes(tx);
+        // notes decrypted ahead of time by a parallel rescan come with every address they were sent to, not only new ones
+        auto saplingNoteDataAndAddressesToAdd = pSaplingNotes ? *pSaplingNotes : FindMySaplingNotes(tx);
         auto saplingNoteData = saplingNoteDataAndAddressesToAdd.first;
         auto addressesToAdd = saplingNoteDataAndAddressesToAdd.second;
         for (const auto &addressToAdd : addressesToAdd) {
+            if (pSaplingNotes && HaveSaplingIncomingViewingKey(addressToAdd.first)) {
+                continue;
+            }
             if (!AddSaplingIncomingViewingKey(addressToAdd.second, addressToAdd.first)) {
                 return false;
             }
@@ -2976,6 +3251,7 @@ bool CWallet::AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pbl
                                 // mark the whole wallet dirty. if this is an issue, we can optimize.
                                 txidAndWtx.second.MarkDirty();
                             }
+                            MarkBalancesDirty();
 
                             if (canSignCanSpend.first != wasCanSignCanSpend.first)
                             {
@@ -3438,7 +3714,26 @@ bool CWallet::AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pbl
 void CWallet::SyncTransaction(const CTransaction& tx, const CBlock* pblock)
 {
     LOCK2(cs_main, cs_wallet);
-    if (!AddToWalletIfInvolvingMe(tx, pblock, true, false))
+
+    // identities with outputs in this transaction may have a new current state, whether or not it is ours
+    if (mapIdentityStates.size())
+    {
+        for (auto &oneOut : tx.vout)
+        {
+            COptCCParams p;
+            CIdentity identity;
+            if (oneOut.scriptPubKey.IsPayToCryptoCondition(p) &&
+                p.IsValid() &&
+                p.evalCode == EVAL_IDENTITY_PRIMARY &&
+                p.vData.size() &&
+                (identity = CIdentity(p.vData[0])).IsValid())
+            {
+                mapIdentityStates.erase(identity.GetID());
+            }
+        }
+    }
+
+    if (!AddToWalletIfInvolvingMe(tx, pblock, true, false, pblock ? GetBlockSaplingNotes(tx, *pblock) : nullptr))
         return; // Not one of ours
 
     MarkAffectedTransactionsDirty(tx);
@@ -3449,6 +3744,7 @@ void CWallet::MarkAffectedTransactionsDirty(const CTransaction& tx)
     // If a transaction changes 'conflicted' state, that changes the balance
     // available of the outputs it spends. So force those to be
     // recomputed, also:
+    MarkBalancesDirty();
     BOOST_FOREACH(const CTxIn& txin, tx.vin)
     {
         if (mapWallet.count(txin.prevout.hash))
@@ -3479,7 +3775,11 @@ void CWallet::EraseFromWallet(const uint256 &hash)
     {
         LOCK(cs_wallet);
         if (mapWallet.erase(hash))
+        {
+            MarkOutputIndexDirty();
+            MarkTxOrderedDirty();
             CWalletDB(strWalletFile).EraseTx(hash);
+        }
     }
     return;
 }
@@ -3578,6 +3878,89 @@ mapSproutNoteData_t CWallet::FindMySproutNotes(const CTransaction &tx) const
 }
 
 
+typedef std::pair<mapSaplingNoteData_t, SaplingIncomingViewingKeyMap> SaplingNotesAndAddresses;
+
+/**
+ * Trial decrypts the Sapling outputs of each transaction with every viewing key, and returns for each transaction
+ * the notes found with every address they were sent to. The outputs are split across up to nThreads threads when
+ * there are enough trials to make up for starting them.
+ */
+static std::vector<SaplingNotesAndAddresses> DecryptSaplingNotes(const std::vector<const CTransaction *> &txes,
+                                                                 const std::vector<SaplingIncomingViewingKey> &ivks,
+                                                                 int nThreads)
+{
+    std::vector<SaplingNotesAndAddresses> notes(txes.size());
+    std::vector<std::pair<size_t, uint32_t>> outputs;
+    for (size_t i = 0; i < txes.size(); i++)
+    {
+        for (uint32_t j = 0; j < txes[i]->vShieldedOutput.size(); j++)
+        {
+            outputs.push_back(std::make_pair(i, j));
+        }
+    }
+    if (outputs.empty() || ivks.empty())
+    {
+        return notes;
+    }
+
+    // each thread only writes the entries of its own outputs
+    std::vector<int> decryptedBy(outputs.size(), -1);
+    std::vector<boost::optional<SaplingPaymentAddress>> addresses(outputs.size());
+
+    nThreads = std::max(1, std::min({nThreads, (int)outputs.size(), (int)(outputs.size() * ivks.size() / MIN_SAPLING_TRIALS_PER_THREAD)}));
+    auto decryptOutputs = [&](int threadNum)
+    {
+        for (size_t k = threadNum; k < outputs.size(); k += nThreads)
+        {
+            const OutputDescription &output = txes[outputs[k].first]->vShieldedOutput[outputs[k].second];
+            for (int i = 0; i < ivks.size(); i++)
+            {
+                auto result = SaplingNotePlaintext::decrypt(output.encCiphertext, ivks[i], output.ephemeralKey, output.cm);
+                if (result)
+                {
+                    decryptedBy[k] = i;
+                    addresses[k] = ivks[i].address(result.get().d);
+                    break;
+                }
+            }
+        }
+    };
+
+    if (nThreads == 1)
+    {
+        decryptOutputs(0);
+    }
+    else
+    {
+        boost::thread_group decryptThreads;
+        for (int i = 0; i < nThreads; i++)
+        {
+            decryptThreads.create_thread(boost::bind<void>(decryptOutputs, i));
+        }
+        decryptThreads.join_all();
+    }
+
+    for (size_t k = 0; k < outputs.size(); k++)
+    {
+        if (decryptedBy[k] < 0)
+        {
+            continue;
+        }
+        SaplingNotesAndAddresses &txNotes = notes[outputs[k].first];
+        const SaplingIncomingViewingKey &ivk = ivks[decryptedBy[k]];
+        if (addresses[k])
+        {
+            txNotes.second[addresses[k].get()] = ivk;
+        }
+        // We don't cache the nullifier here as computing it requires knowledge of the note position
+        // in the commitment tree, which can only be determined when the transaction has been mined.
+        SaplingNoteData nd;
+        nd.ivk = ivk;
+        txNotes.first.insert(std::make_pair(SaplingOutPoint(txes[outputs[k].first]->GetHash(), outputs[k].second), nd));
+    }
+    return notes;
+}
+
 /**
  * Finds all output notes in the given transaction that have been sent to
  * SaplingPaymentAddresses in this wallet.
@@ -3589,35 +3972,72 @@ mapSproutNoteData_t CWallet::FindMySproutNotes(const CTransaction &tx) const
 std::pair<mapSaplingNoteData_t, SaplingIncomingViewingKeyMap> CWallet::FindMySaplingNotes(const CTransaction &tx) const
 {
     LOCK(cs_KeyStore);
-    uint256 hash = tx.GetHash();
 
     mapSaplingNoteData_t noteData;
     SaplingIncomingViewingKeyMap viewingKeysToAdd;
+    if (tx.vShieldedOutput.empty() || mapSaplingFullViewingKeys.empty()) {
+        return std::make_pair(noteData, viewingKeysToAdd);
+    }
+
+    std::vector<SaplingIncomingViewingKey> ivks;
+    for (auto it = mapSaplingFullViewingKeys.begin(); it != mapSaplingFullViewingKeys.end(); ++it) {
+        ivks.push_back(it->first);
+    }
 
     // Protocol Spec: 4.19 Block Chain Scanning (Sapling)
-    for (uint32_t i = 0; i < tx.vShieldedOutput.size(); ++i) {
-        const OutputDescription output = tx.vShieldedOutput[i];
-        for (auto it = mapSaplingFullViewingKeys.begin(); it != mapSaplingFullViewingKeys.end(); ++it) {
-            SaplingIncomingViewingKey ivk = it->first;
-            auto result = SaplingNotePlaintext::decrypt(output.encCiphertext, ivk, output.ephemeralKey, output.cm);
-            if (!result) {
-                continue;
-            }
-            auto address = ivk.address(result.get().d);
-            if (address && mapSaplingIncomingViewingKeys.count(address.get()) == 0) {
-                viewingKeysToAdd[address.get()] = ivk;
+    SaplingNotesAndAddresses notes = DecryptSaplingNotes({&tx}, ivks, GetArg("-saplingdecryptthreads", DEFAULT_SAPLING_DECRYPT_THREADS))[0];
+    for (auto &oneAddress : notes.second) {
+        if (mapSaplingIncomingViewingKeys.count(oneAddress.first) == 0) {
+            viewingKeysToAdd.insert(oneAddress);
+        }
+    }
+
+    return std::make_pair(notes.first, viewingKeysToAdd);
+}
+
+/**
+ * The Sapling notes of a transaction in a block being synced, from a trial decryption of every shielded output in
+ * the block at once, split across threads, rather than of one transaction at a time. Its addresses are not filtered
+ * to those the wallet does not already have.
+ */
+const std::pair<mapSaplingNoteData_t, SaplingIncomingViewingKeyMap> *CWallet::GetBlockSaplingNotes(const CTransaction &tx, const CBlock &block)
+{
+    AssertLockHeld(cs_wallet);
+    if (tx.vShieldedOutput.empty())
+    {
+        return nullptr;
+    }
+
+    LOCK(cs_KeyStore);
+    uint256 blockHash = block.GetHash();
+    if (blockHash != saplingNotesBlockHash || mapSaplingFullViewingKeys.size() != nSaplingNotesKeys)
+    {
+        std::vector<const CTransaction *> txes;
+        for (auto &oneTx : block.vtx)
+        {
+            if (oneTx.vShieldedOutput.size())
+            {
+                txes.push_back(&oneTx);
             }
-            // We don't cache the nullifier here as computing it requires knowledge of the note position
-            // in the commitment tree, which can only be determined when the transaction has been mined.
-            SaplingOutPoint op {hash, i};
-            SaplingNoteData nd;
-            nd.ivk = ivk;
-            noteData.insert(std::make_pair(op, nd));
-            break;
         }
+        std::vector<SaplingIncomingViewingKey> ivks;
+        for (auto &oneKey : mapSaplingFullViewingKeys)
+        {
+            ivks.push_back(oneKey.first);
+        }
+
+        std::vector<SaplingNotesAndAddresses> notes = DecryptSaplingNotes(txes, ivks, GetArg("-saplingdecryptthreads", DEFAULT_SAPLING_DECRYPT_THREADS));
+        mapBlockSaplingNotes.clear();
+        for (int i = 0; i < txes.size(); i++)
+        {
+            mapBlockSaplingNotes[txes[i]->GetHash()] = std::move(notes[i]);
+        }
+        saplingNotesBlockHash = blockHash;
+        nSaplingNotesKeys = ivks.size();
     }
 
-    return std::make_pair(noteData, viewingKeysToAdd);
+    auto it = mapBlockSaplingNotes.find(tx.GetHash());
+    return it == mapBlockSaplingNotes.end() ? nullptr : &it->second;
 }
 
 bool CWallet::IsSproutNullifierFromMe(const uint256& nullifier) const
@@ -4407,37 +4827,169 @@ void CWallet::WitnessNoteCommitment(std::vector<uint256> commitments,
     }
 }
 
+namespace {
+
 /**
- * Scan the block chain (starting in pindexStart) for transactions
- * from or to us. If fUpdate is true, found transactions that already
- * exist in the wallet will be updated.
+ * Reads the blocks of a rescan and trial decrypts their Sapling outputs on worker threads, up to a window of blocks
+ * ahead of the one the rescan is adding to the wallet. Everything that depends on what the wallet has found so far,
+ * keys, scripts and identities, is still checked by the rescan in block order.
+ *
+ * The scanning thread holds cs_main for as long as this exists, so the blocks of the active chain do not change.
  */
-int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
+class CRescanPipeline
 {
-    LOCK2(cs_main, cs_wallet);
-    int ret = 0;
-    int64_t nNow = GetTime();
-    const CChainParams& chainParams = Params();
+public:
+    CRescanPipeline(int nStartHeight, int nEndHeightIn, int nThreads, const std::vector<SaplingIncomingViewingKey> &ivksIn) :
+        nEndHeight(nEndHeightIn), nWindow(nThreads * RESCAN_BLOCKS_AHEAD_PER_THREAD),
+        ivks(ivksIn), nNextRead(nStartHeight), nNextAdd(nStartHeight), fStop(false)
+    {
+        for (int i = 0; i < nThreads; i++)
+        {
+            threads.create_thread(boost::bind(&CRescanPipeline::ReadBlocks, this));
+        }
+    }
 
-    CBlockIndex* pindex = pindexStart;
+    ~CRescanPipeline()
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(cs);
+            fStop = true;
+        }
+        cvRead.notify_all();
+        threads.join_all();
+    }
 
-    pwalletMain->ClearIdentities(pindexStart->GetHeight());
+    // waits for the block at the next height, returns false if it could not be read
+    bool GetNext(CBlock &block, std::vector<SaplingNotesAndAddresses> &txNotes)
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        std::map<int, CRescanBlock>::iterator it;
+        while ((it = mapRead.find(nNextAdd)) == mapRead.end())
+        {
+            cvReady.wait(lock);
+        }
+        bool fRead = it->second.fRead;
+        block = std::move(it->second.block);
+        txNotes = std::move(it->second.txNotes);
+        mapRead.erase(it);
+        nNextAdd++;
+        cvRead.notify_all();
+        return fRead;
+    }
 
-    std::vector<uint256> myTxHashes;
+private:
+    struct CRescanBlock
+    {
+        bool fRead;
+        CBlock block;
+        std::vector<SaplingNotesAndAddresses> txNotes;
+    };
 
+    void ReadBlocks()
     {
-        //Lock cs_keystore to prevent wallet from locking during rescan
-        LOCK2(mempool.cs, cs_KeyStore);
+        const Consensus::Params &consensusParams = Params().GetConsensus();
+        while (true)
+        {
+            int nHeight;
+            {
+                boost::unique_lock<boost::mutex> lock(cs);
+                while (!fStop && nNextRead <= nEndHeight && nNextRead >= nNextAdd + nWindow)
+                {
+                    cvRead.wait(lock);
+                }
+                if (fStop || nNextRead > nEndHeight)
+                {
+                    return;
+                }
+                nHeight = nNextRead++;
+            }
 
-        // REMOVE UNTIL WE HAVE A BETTER WAY OF ENABLING NEW KEYS THAT MAY HAVE EXISTED BEFORE WALLET BIRTHDAY
-        // no need to read and scan block, if block was created before
-        // our wallet birthday (as adjusted for block time variability)
-        //while (pindex && nTimeFirstKey && (pindex->GetBlockTime() < (nTimeFirstKey - 7200)))
-        //    pindex = chainActive.Next(pindex);
+            CRescanBlock readBlock;
+            readBlock.fRead = ReadBlockFromDisk(readBlock.block, chainActive[nHeight], consensusParams);
+            // the workers already run in parallel, one block each
+            std::vector<const CTransaction *> txes;
+            for (auto &oneTx : readBlock.block.vtx)
+            {
+                txes.push_back(&oneTx);
+            }
+            readBlock.txNotes = DecryptSaplingNotes(txes, ivks, 1);
+
+            {
+                boost::unique_lock<boost::mutex> lock(cs);
+                mapRead.insert(std::make_pair(nHeight, std::move(readBlock)));
+            }
+            cvReady.notify_all();
+        }
+    }
+
+    const int nEndHeight;
+    const int nWindow;
+    const std::vector<SaplingIncomingViewingKey> ivks;
+
+    boost::mutex cs;
+    boost::condition_variable cvRead;       // a worker may read the next block
+    boost::condition_variable cvReady;      // a block was read
+    int nNextRead;
+    int nNextAdd;
+    bool fStop;
+    std::map<int, CRescanBlock> mapRead;
+    boost::thread_group threads;
+};
+
+} // namespace
+
+/**
+ * Scan the block chain (starting in pindexStart) for transactions
+ * from or to us. If fUpdate is true, found transactions that already
+ * exist in the wallet will be updated.
+ *
+ * With -rescanthreads above 1, blocks are read and their Sapling outputs
+ * trial decrypted on that many threads ahead of the scan, which still adds
+ * transactions to the wallet one block at a time in chain order.
+ */
+int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
+{
+    LOCK2(cs_main, cs_wallet);
+    int ret = 0;
+    int64_t nNow = GetTime();
+    const CChainParams& chainParams = Params();
+
+    // the transactions, identities and note data found are flushed to disk once, when the rescan is done
+    CDBGroupCommit groupCommit(fFileBacked ? strWalletFile : std::string());
+
+    CBlockIndex* pindex = pindexStart;
+
+    pwalletMain->ClearIdentities(pindexStart->GetHeight());
+
+    std::vector<uint256> myTxHashes;
+
+    {
+        //Lock cs_keystore to prevent wallet from locking during rescan
+        LOCK2(mempool.cs, cs_KeyStore);
+
+        // REMOVE UNTIL WE HAVE A BETTER WAY OF ENABLING NEW KEYS THAT MAY HAVE EXISTED BEFORE WALLET BIRTHDAY
+        // no need to read and scan block, if block was created before
+        // our wallet birthday (as adjusted for block time variability)
+        //while (pindex && nTimeFirstKey && (pindex->GetBlockTime() < (nTimeFirstKey - 7200)))
+        //    pindex = chainActive.Next(pindex);
 
         ShowProgress(_("Rescanning..."), 0); // show rescan progress in GUI as dialog or on splashscreen, if -rescan on startup
         double dProgressStart = Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex, false);
         double dProgressTip = Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), chainActive.LastTip(), false);
+
+        std::unique_ptr<CRescanPipeline> pipeline;
+        int nThreads = GetArg("-rescanthreads", DEFAULT_RESCAN_THREADS);
+        if (nThreads > 1 && pindex && chainActive.Contains(pindex))
+        {
+            std::vector<SaplingIncomingViewingKey> ivks;
+            for (auto &oneKey : mapSaplingFullViewingKeys)
+            {
+                ivks.push_back(oneKey.first);
+            }
+            pipeline.reset(new CRescanPipeline(pindex->GetHeight(), chainActive.Height(), nThreads, ivks));
+        }
+        std::vector<SaplingNotesAndAddresses> txNotes;
+
         while (pindex)
         {
             //exit loop if trying to shutdown
@@ -4449,10 +5001,28 @@ int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
                 ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex, false) - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
 
             CBlock block;
-            ReadBlockFromDisk(block, pindex, Params().GetConsensus());
-            BOOST_FOREACH(CTransaction& tx, block.vtx)
+            if (pipeline)
+            {
+                pipeline->GetNext(block, txNotes);
+            }
+            else
+            {
+                // read on one thread, the OS is asked to read the coming blocks into its cache meanwhile
+                if (pindex->GetHeight() % RESCAN_PREFETCH_BLOCKS == 0 && chainActive.Contains(pindex))
+                {
+                    std::vector<const CBlockIndex *> ahead;
+                    for (int height = pindex->GetHeight(); height <= chainActive.Height() && ahead.size() < RESCAN_PREFETCH_BLOCKS; height++)
+                    {
+                        ahead.push_back(chainActive[height]);
+                    }
+                    PrefetchBlockData(ahead, false);
+                }
+                ReadBlockFromDisk(block, pindex, Params().GetConsensus());
+            }
+            for (int i = 0; i < block.vtx.size(); i++)
             {
-                if (AddToWalletIfInvolvingMe(tx, &block, fUpdate, true)) {
+                CTransaction& tx = block.vtx[i];
+                if (AddToWalletIfInvolvingMe(tx, &block, fUpdate, true, pipeline ? &txNotes[i] : nullptr)) {
                     myTxHashes.push_back(tx.GetHash());
                     ret++;
                 }
@@ -5002,214 +5572,397 @@ void CWallet::ResendWalletTransactions(int64_t nBestBlockTime)
 
 CAmount CWallet::GetBalance(bool includeIDLocked) const
 {
-    CAmount nTotal = 0;
+    return CachedBalance(includeIDLocked ? BALANCE_TRUSTED : BALANCE_TRUSTED_UNLOCKED, [&]()
     {
-        LOCK2(cs_main, cs_wallet);
+        CAmount nTotal = 0;
         for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
         {
             const CWalletTx* pcoin = &(*it).second;
             if (pcoin->IsTrusted())
                 nTotal += pcoin->GetAvailableCredit(includeIDLocked, includeIDLocked);
         }
-    }
-
-    return nTotal;
+        return nTotal;
+    });
 }
 
 CAmount CWallet::GetSharedBalance(bool includeIDLocked) const
 {
-    CAmount nTotal = 0;
+    return CachedBalance(includeIDLocked ? BALANCE_SHARED : BALANCE_SHARED_UNLOCKED, [&]()
     {
-        LOCK2(cs_main, cs_wallet);
+        CAmount nTotal = 0;
         for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
         {
             const CWalletTx* pcoin = &(*it).second;
             if (pcoin->IsTrusted())
                 nTotal += pcoin->GetAvailableCredit(includeIDLocked, includeIDLocked, ISMINE_SHARED);
         }
-    }
-
-    return nTotal;
+        return nTotal;
+    });
 }
 
 CCurrencyValueMap CWallet::GetReserveBalance(bool includeIDLocked) const
 {
-    CCurrencyValueMap retVal;
+    return CachedReserveBalance(includeIDLocked ? BALANCE_TRUSTED : BALANCE_TRUSTED_UNLOCKED, [&]()
     {
-        LOCK2(cs_main, cs_wallet);
+        CCurrencyValueMap retVal;
         for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
         {
             const CWalletTx* pcoin = &(*it).second;
             if (pcoin->IsTrusted())
                 retVal += pcoin->GetAvailableReserveCredit(includeIDLocked, includeIDLocked);
         }
-    }
-
-    return retVal;
+        return retVal;
+    });
 }
 
 CCurrencyValueMap CWallet::GetSharedReserveBalance(bool includeIDLocked) const
 {
-    CCurrencyValueMap retVal;
+    return CachedReserveBalance(includeIDLocked ? BALANCE_SHARED : BALANCE_SHARED_UNLOCKED, [&]()
     {
-        LOCK2(cs_main, cs_wallet);
+        CCurrencyValueMap retVal;
         for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
         {
             const CWalletTx* pcoin = &(*it).second;
             if (pcoin->IsTrusted())
                 retVal += pcoin->GetAvailableReserveCredit(includeIDLocked, includeIDLocked, ISMINE_SHARED);
         }
-    }
-
-    return retVal;
+        return retVal;
+    });
 }
 
 CAmount CWallet::GetUnconfirmedBalance() const
 {
-    CAmount nTotal = 0;
+    return CachedBalance(BALANCE_UNCONFIRMED, [&]()
     {
-        LOCK2(cs_main, cs_wallet);
+        CAmount nTotal = 0;
         for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
         {
             const CWalletTx* pcoin = &(*it).second;
             if (!CheckFinalTx(*pcoin) || (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0))
                 nTotal += pcoin->GetAvailableCredit();
         }
-    }
-    return nTotal;
+        return nTotal;
+    });
 }
 
 CCurrencyValueMap CWallet::GetUnconfirmedReserveBalance() const
 {
-    CCurrencyValueMap retVal;
+    return CachedReserveBalance(BALANCE_UNCONFIRMED, [&]()
     {
-        LOCK2(cs_main, cs_wallet);
+        CCurrencyValueMap retVal;
         for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
         {
             const CWalletTx* pcoin = &(*it).second;
             if (!CheckFinalTx(*pcoin) || (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0))
                 retVal += pcoin->GetAvailableReserveCredit();
         }
-    }
-    return retVal;
+        return retVal;
+    });
 }
 
 CAmount CWallet::GetImmatureBalance() const
 {
-    CAmount nTotal = 0;
+    return CachedBalance(BALANCE_IMMATURE, [&]()
     {
-        LOCK2(cs_main, cs_wallet);
+        CAmount nTotal = 0;
         for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
         {
             const CWalletTx* pcoin = &(*it).second;
             nTotal += pcoin->GetImmatureCredit();
         }
-    }
-    return nTotal;
+        return nTotal;
+    });
 }
 
 CCurrencyValueMap CWallet::GetImmatureReserveBalance() const
 {
-    CCurrencyValueMap retVal;
+    return CachedReserveBalance(BALANCE_IMMATURE, [&]()
     {
-        LOCK2(cs_main, cs_wallet);
+        CCurrencyValueMap retVal;
         for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
         {
             const CWalletTx* pcoin = &(*it).second;
             retVal += pcoin->GetImmatureReserveCredit();
         }
-    }
-    return retVal;
+        return retVal;
+    });
 }
 
 CAmount CWallet::GetWatchOnlyBalance() const
 {
-    CAmount nTotal = 0;
+    return CachedBalance(BALANCE_WATCHONLY, [&]()
     {
-        LOCK2(cs_main, cs_wallet);
+        CAmount nTotal = 0;
         for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
         {
             const CWalletTx* pcoin = &(*it).second;
             if (pcoin->IsTrusted())
                 nTotal += pcoin->GetAvailableWatchOnlyCredit();
         }
-    }
-
-    return nTotal;
+        return nTotal;
+    });
 }
 
 CCurrencyValueMap CWallet::GetWatchOnlyReserveBalance() const
 {
-    CCurrencyValueMap retVal;
+    return CachedReserveBalance(BALANCE_WATCHONLY, [&]()
     {
-        LOCK2(cs_main, cs_wallet);
+        CCurrencyValueMap retVal;
         for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
         {
             const CWalletTx* pcoin = &(*it).second;
             if (pcoin->IsTrusted())
                 retVal += pcoin->GetAvailableWatchOnlyReserveCredit();
         }
-    }
-
-    return retVal;
+        return retVal;
+    });
 }
 
 CAmount CWallet::GetUnconfirmedWatchOnlyBalance() const
 {
-    CAmount nTotal = 0;
+    return CachedBalance(BALANCE_UNCONFIRMED_WATCHONLY, [&]()
     {
-        LOCK2(cs_main, cs_wallet);
+        CAmount nTotal = 0;
         for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
         {
             const CWalletTx* pcoin = &(*it).second;
             if (!CheckFinalTx(*pcoin) || (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0))
                 nTotal += pcoin->GetAvailableWatchOnlyCredit();
         }
-    }
-    return nTotal;
+        return nTotal;
+    });
 }
 
 CCurrencyValueMap CWallet::GetUnconfirmedWatchOnlyReserveBalance() const
 {
-    CCurrencyValueMap retVal;
+    return CachedReserveBalance(BALANCE_UNCONFIRMED_WATCHONLY, [&]()
     {
-        LOCK2(cs_main, cs_wallet);
+        CCurrencyValueMap retVal;
         for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
         {
             const CWalletTx* pcoin = &(*it).second;
             if (!CheckFinalTx(*pcoin) || (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0))
                 retVal += pcoin->GetAvailableWatchOnlyReserveCredit();
         }
-    }
-    return retVal;
+        return retVal;
+    });
 }
 
 CAmount CWallet::GetImmatureWatchOnlyBalance() const
 {
-    CAmount nTotal = 0;
+    return CachedBalance(BALANCE_IMMATURE_WATCHONLY, [&]()
     {
-        LOCK2(cs_main, cs_wallet);
+        CAmount nTotal = 0;
         for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
         {
             const CWalletTx* pcoin = &(*it).second;
             nTotal += pcoin->GetImmatureWatchOnlyCredit();
         }
-    }
-    return nTotal;
+        return nTotal;
+    });
 }
 
 CCurrencyValueMap CWallet::GetImmatureWatchOnlyReserveBalance() const
 {
-    CCurrencyValueMap retVal;
+    return CachedReserveBalance(BALANCE_IMMATURE_WATCHONLY, [&]()
     {
-        LOCK2(cs_main, cs_wallet);
+        CCurrencyValueMap retVal;
         for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
         {
             const CWalletTx* pcoin = &(*it).second;
             retVal += pcoin->GetImmatureWatchOnlyReserveCredit();
         }
+        return retVal;
+    });
+}
+
+// balances are kept until the tip, the mempool or the wallet changes, -checkbalancecache recomputes a kept balance on
+// each call and logs it if they differ
+CAmount CWallet::CachedBalance(int balanceType, const std::function<CAmount()> &computeBalance) const
+{
+    LOCK2(cs_main, cs_wallet);
+    RefreshBalanceCache();
+    auto it = mapCachedBalances.find(balanceType);
+    if (it == mapCachedBalances.end())
+    {
+        return mapCachedBalances[balanceType] = computeBalance();
+    }
+    if (GetBoolArg("-checkbalancecache", false))
+    {
+        CAmount computed = computeBalance();
+        if (computed != it->second)
+        {
+            LogPrintf("%s: cached balance %d of type %d differs from computed balance %d\n", __func__, it->second, balanceType, computed);
+            it->second = computed;
+        }
+    }
+    return it->second;
+}
+
+CCurrencyValueMap CWallet::CachedReserveBalance(int balanceType, const std::function<CCurrencyValueMap()> &computeBalance) const
+{
+    LOCK2(cs_main, cs_wallet);
+    RefreshBalanceCache();
+    auto it = mapCachedReserveBalances.find(balanceType);
+    if (it == mapCachedReserveBalances.end())
+    {
+        return mapCachedReserveBalances[balanceType] = computeBalance();
+    }
+    if (GetBoolArg("-checkbalancecache", false))
+    {
+        CCurrencyValueMap computed = computeBalance();
+        if (computed != it->second)
+        {
+            LogPrintf("%s: cached balance %s of type %d differs from computed balance %s\n", __func__, it->second.ToUniValue().write(), balanceType, computed.ToUniValue().write());
+            it->second = computed;
+        }
+    }
+    return it->second;
+}
+
+void CWallet::RefreshBalanceCache() const
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+    uint256 tipHash = chainActive.LastTip() ? chainActive.LastTip()->GetBlockHash() : uint256();
+    unsigned int nMempoolUpdates = mempool.GetTransactionsUpdated();
+    uint64_t nGeneration = nBalanceGeneration;
+    if (tipHash != balanceCacheTip || nMempoolUpdates != nBalanceCacheMempoolUpdates || nGeneration != nBalanceCacheGeneration)
+    {
+        mapCachedBalances.clear();
+        mapCachedReserveBalances.clear();
+        balanceCacheTip = tipHash;
+        nBalanceCacheMempoolUpdates = nMempoolUpdates;
+        nBalanceCacheGeneration = nGeneration;
+    }
+}
+
+/**
+ * indexes an output of a wallet transaction if it is ours, unspent and of a type that can be spent, or unindexes it
+ * if it no longer is
+ */
+void CWallet::IndexWalletOutput(const CWalletTx &wtx, int voutNum) const
+{
+    AssertLockHeld(cs_wallet);
+    COutPoint output(wtx.GetHash(), voutNum);
+    UnindexWalletOutput(output);
+
+    const CTxOut &txOut = wtx.vout[voutNum];
+    CIndexedWalletOutput indexed;
+    indexed.pwtx = &wtx;
+    if ((indexed.mine = IsMine(txOut)) == ISMINE_NO || IsSpent(output.hash, output.n))
+    {
+        return;
+    }
+
+    COptCCParams p;
+    indexed.reserveValue = txOut.scriptPubKey.ReserveOutValue(p, true);
+    if (p.IsValid() && !txOut.scriptPubKey.IsSpendableOutputType(p))
+    {
+        return;
+    }
+
+    CTxDestination checkDest;
+    bool haveDest = ExtractDestination(txOut.scriptPubKey, checkDest);
+    if (haveDest && checkDest.which() == COptCCParams::ADDRTYPE_ID)
+    {
+        indexed.idDestination = GetDestinationID(checkDest);
+    }
+    if (p.IsValid())
+    {
+        for (auto &oneDest : p.vKeys)
+        {
+            indexed.destinations.push_back(GetDestinationID(oneDest));
+        }
+    }
+    else if (haveDest)
+    {
+        // support P2PK or P2PKH
+        indexed.destinations.push_back(GetDestinationID(checkDest));
+    }
+
+    for (auto &oneCurrency : indexed.reserveValue.valueMap)
+    {
+        mapOutputsByCurrency[oneCurrency.first].insert(output);
+    }
+    if (txOut.nValue)
+    {
+        mapOutputsByCurrency[ASSETCHAINS_CHAINID].insert(output);
+    }
+    for (auto &oneDest : indexed.destinations)
+    {
+        mapOutputsByDestination[oneDest].insert(output);
+    }
+    mapOutputIndex.insert(std::make_pair(output, indexed));
+}
+
+void CWallet::UnindexWalletOutput(const COutPoint &output) const
+{
+    AssertLockHeld(cs_wallet);
+    auto it = mapOutputIndex.find(output);
+    if (it == mapOutputIndex.end())
+    {
+        return;
+    }
+
+    auto unindexFrom = [&output](std::map<uint160, std::set<COutPoint>> &index, const uint160 &key)
+    {
+        auto keyIt = index.find(key);
+        if (keyIt != index.end() && keyIt->second.erase(output) && keyIt->second.empty())
+        {
+            index.erase(keyIt);
+        }
+    };
+    for (auto &oneCurrency : it->second.reserveValue.valueMap)
+    {
+        unindexFrom(mapOutputsByCurrency, oneCurrency.first);
+    }
+    unindexFrom(mapOutputsByCurrency, ASSETCHAINS_CHAINID);
+    for (auto &oneDest : it->second.destinations)
+    {
+        unindexFrom(mapOutputsByDestination, oneDest);
+    }
+    mapOutputIndex.erase(it);
+}
+
+// a transaction that was added or updated may have outputs of ours, and may spend outputs of ours, or no longer
+// spend them if it is now conflicted
+void CWallet::UpdateOutputIndex(const CWalletTx &wtx) const
+{
+    AssertLockHeld(cs_wallet);
+    MarkBalancesDirty();
+    if (fOutputIndexDirty)
+    {
+        return;
+    }
+    for (int i = 0; i < wtx.vout.size(); i++)
+    {
+        IndexWalletOutput(wtx, i);
+    }
+    for (auto &oneIn : wtx.vin)
+    {
+        auto prevIt = mapWallet.find(oneIn.prevout.hash);
+        if (prevIt != mapWallet.end() && oneIn.prevout.n < prevIt->second.vout.size())
+        {
+            IndexWalletOutput(prevIt->second, oneIn.prevout.n);
+        }
+    }
+}
+
+void CWallet::RebuildOutputIndex() const
+{
+    AssertLockHeld(cs_wallet);
+    mapOutputIndex.clear();
+    mapOutputsByCurrency.clear();
+    mapOutputsByDestination.clear();
+    fOutputIndexDirty = false;
+    for (auto &wtxItem : mapWallet)
+    {
+        for (int i = 0; i < wtxItem.second.vout.size(); i++)
+        {
+            IndexWalletOutput(wtxItem.second, i);
+        }
     }
-    return retVal;
 }
 
 /**
@@ -5225,28 +5978,35 @@ void CWallet::AvailableCoins(vector<COutput>& vCoins, bool fOnlyConfirmed, const
 
     {
         LOCK2(cs_main, cs_wallet);
-        uint32_t nHeight = chainActive.Height() + 1;
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        if (fOutputIndexDirty)
         {
-            const uint256& wtxid = it->first;
-            const CWalletTx* pcoin = &(*it).second;
+            RebuildOutputIndex();
+        }
+
+        uint32_t nHeight = chainActive.Height() + 1;
 
+        // outputs are indexed in the order of their transactions, which only need to be checked once
+        uint256 lastTxid;
+        bool fTxAvailable = false;
+        int nDepth = 0;
+        auto isTxAvailable = [&](const CWalletTx *pcoin) -> bool
+        {
             if (!CheckFinalTx(*pcoin))
-                continue;
+                return false;
 
             if (fOnlyConfirmed && !pcoin->IsTrusted())
-                continue;
+                return false;
 
             bool isCoinbase = pcoin->IsCoinBase();
             if (!fIncludeCoinBase && isCoinbase)
-                continue;
+                return false;
 
             if (!fIncludeImmatureCoins && isCoinbase && pcoin->GetBlocksToMaturity() > 0)
-                continue;
+                return false;
 
-            int nDepth = pcoin->GetDepthInMainChain();
+            nDepth = pcoin->GetDepthInMainChain();
             if (nDepth < 0)
-                continue;
+                return false;
 
             uint32_t coinHeight = nHeight - nDepth;
             // even if we should include coinbases, we may opt to exclude protected coinbases, which must only be included when shielding
@@ -5255,74 +6015,69 @@ void CWallet::AvailableCoins(vector<COutput>& vCoins, bool fOnlyConfirmed, const
                 Params().GetConsensus().fCoinbaseMustBeProtected &&
                 CConstVerusSolutionVector::GetVersionByHeight(coinHeight) < CActivationHeight::SOLUTION_VERUSV4 &&
                 CConstVerusSolutionVector::GetVersionByHeight(nHeight) < CActivationHeight::SOLUTION_VERUSV5)
+                return false;
+
+            return true;
+        };
+
+        for (auto &indexedOut : mapOutputIndex)
+        {
+            const uint256& wtxid = indexedOut.first.hash;
+            const CWalletTx* pcoin = indexedOut.second.pwtx;
+            int i = indexedOut.first.n;
+
+            if (wtxid != lastTxid)
+            {
+                lastTxid = wtxid;
+                fTxAvailable = isTxAvailable(pcoin);
+            }
+            if (!fTxAvailable)
                 continue;
 
-            for (int i = 0; i < pcoin->vout.size(); i++)
+            isminetype mine = indexedOut.second.mine;
+            if (!(IsSpent(wtxid, i)) &&
+                !IsLockedCoin(wtxid, i) && (pcoin->vout[i].nValue > 0 || fIncludeZeroValue) &&
+                (!coinControl || !coinControl->HasSelected() || coinControl->IsSelected(wtxid, i)))
             {
-                isminetype mine = IsMine(pcoin->vout[i]);
-                if (!(IsSpent(wtxid, i)) && mine != ISMINE_NO &&
-                    !IsLockedCoin((*it).first, i) && (pcoin->vout[i].nValue > 0 || fIncludeZeroValue) &&
-                    (!coinControl || !coinControl->HasSelected() || coinControl->IsSelected((*it).first, i)))
+                if (!fIncludeIDLockedCoins && !indexedOut.second.idDestination.IsNull())
                 {
-                    COptCCParams p;
-                    CCurrencyValueMap rOut = pcoin->vout[i].scriptPubKey.ReserveOutValue(p, true);
-
-                    if (p.IsValid() && !pcoin->vout[i].scriptPubKey.IsSpendableOutputType(p))
-                    {
-                        continue;
-                    }
-
-                    if (!fIncludeIDLockedCoins)
+                    // if this is sent to an ID in this wallet, ensure that the ID is unlocked or skip it
+                    std::pair<CIdentityMapKey, CIdentityMapValue> keyAndIdentity;
+                    if (GetIdentity(indexedOut.second.idDestination, keyAndIdentity))
                     {
-                        // if this is sent to an ID in this wallet, ensure that the ID is unlocked or skip it
-                        CTxDestination checkDest;
-                        std::pair<CIdentityMapKey, CIdentityMapValue> keyAndIdentity;
-                        if (ExtractDestination(pcoin->vout[i].scriptPubKey, checkDest) &&
-                            checkDest.which() == COptCCParams::ADDRTYPE_ID)
+                        if (keyAndIdentity.second.IsLocked(nHeight))
                         {
-                            if (GetIdentity(GetDestinationID(checkDest), keyAndIdentity))
-                            {
-                                if (keyAndIdentity.second.IsLocked(nHeight))
-                                {
-                                    continue;
-                                }
-                            }
-                            else
-                            {
-                                //LogPrintf("%s: unable to locate ID %s that should be present in wallet\n", __func__, EncodeDestination(checkDest).c_str());
-                                continue;
-                            }
+                            continue;
                         }
                     }
+                    else
+                    {
+                        continue;
+                    }
+                }
 
-                    if ( KOMODO_EXCHANGEWALLET == 0 )
+                if ( KOMODO_EXCHANGEWALLET == 0 )
+                {
+                    uint32_t locktime; int32_t txheight; CBlockIndex *tipindex;
+                    if ( ASSETCHAINS_SYMBOL[0] == 0 && chainActive.LastTip() != 0 && chainActive.LastTip()->GetHeight() >= 60000 )
                     {
-                        uint32_t locktime; int32_t txheight; CBlockIndex *tipindex;
-                        if ( ASSETCHAINS_SYMBOL[0] == 0 && chainActive.LastTip() != 0 && chainActive.LastTip()->GetHeight() >= 60000 )
+                        if ( pcoin->vout[i].nValue >= 10*COIN )
                         {
-                            if ( pcoin->vout[i].nValue >= 10*COIN )
+                            if ( (tipindex= chainActive.LastTip()) != 0 )
                             {
-                                if ( (tipindex= chainActive.LastTip()) != 0 )
-                                {
-                                    komodo_accrued_interest(&txheight,&locktime,wtxid,i,0,pcoin->vout[i].nValue,(int32_t)tipindex->GetHeight());
-                                    interest = komodo_interestnew(txheight,pcoin->vout[i].nValue,locktime,tipindex->nTime);
-                                } else interest = 0;
-                                //interest = komodo_interestnew(chainActive.LastTip()->GetHeight()+1,pcoin->vout[i].nValue,pcoin->nLockTime,chainActive.LastTip()->nTime);
-                                if ( interest != 0 )
-                                {
-                                    //printf("wallet nValueRet %.8f += interest %.8f ht.%d lock.%u/%u tip.%u\n",(double)pcoin->vout[i].nValue/COIN,(double)interest/COIN,txheight,locktime,pcoin->nLockTime,tipindex->nTime);
-                                    //fprintf(stderr,"wallet nValueRet %.8f += interest %.8f ht.%d lock.%u tip.%u\n",(double)pcoin->vout[i].nValue/COIN,(double)interest/COIN,chainActive.LastTip()->GetHeight()+1,pcoin->nLockTime,chainActive.LastTip()->nTime);
-                                    //ptr = (uint64_t *)&pcoin->vout[i].nValue;
-                                    //(*ptr) += interest;
-                                    ptr = (uint64_t *)&pcoin->vout[i].interest;
-                                    (*ptr) = interest;
-                                    //pcoin->vout[i].nValue += interest;
-                                }
-                                else
-                                {
-                                    ptr = (uint64_t *)&pcoin->vout[i].interest;
-                                    (*ptr) = 0;
-                                }
+                                komodo_accrued_interest(&txheight,&locktime,wtxid,i,0,pcoin->vout[i].nValue,(int32_t)tipindex->GetHeight());
+                                interest = komodo_interestnew(txheight,pcoin->vout[i].nValue,locktime,tipindex->nTime);
+                            } else interest = 0;
+                            //interest = komodo_interestnew(chainActive.LastTip()->GetHeight()+1,pcoin->vout[i].nValue,pcoin->nLockTime,chainActive.LastTip()->nTime);
+                            if ( interest != 0 )
+                            {
+                                //printf("wallet nValueRet %.8f += interest %.8f ht.%d lock.%u/%u tip.%u\n",(double)pcoin->vout[i].nValue/COIN,(double)interest/COIN,txheight,locktime,pcoin->nLockTime,tipindex->nTime);
+                                //fprintf(stderr,"wallet nValueRet %.8f += interest %.8f ht.%d lock.%u tip.%u\n",(double)pcoin->vout[i].nValue/COIN,(double)interest/COIN,chainActive.LastTip()->GetHeight()+1,pcoin->nLockTime,chainActive.LastTip()->nTime);
+                                //ptr = (uint64_t *)&pcoin->vout[i].nValue;
+                                //(*ptr) += interest;
+                                ptr = (uint64_t *)&pcoin->vout[i].interest;
+                                (*ptr) = interest;
+                                //pcoin->vout[i].nValue += interest;
                             }
                             else
                             {
@@ -5336,8 +6091,13 @@ void CWallet::AvailableCoins(vector<COutput>& vCoins, bool fOnlyConfirmed, const
                             (*ptr) = 0;
                         }
                     }
-                    vCoins.push_back(COutput(pcoin, i, nDepth, (mine & (fIncludeSharedCoins ? (ISMINE_SPENDABLE | ISMINE_SHARED) : ISMINE_SPENDABLE)) != ISMINE_NO));
+                    else
+                    {
+                        ptr = (uint64_t *)&pcoin->vout[i].interest;
+                        (*ptr) = 0;
+                    }
                 }
+                vCoins.push_back(COutput(pcoin, i, nDepth, (mine & (fIncludeSharedCoins ? (ISMINE_SPENDABLE | ISMINE_SHARED) : ISMINE_SPENDABLE)) != ISMINE_NO));
             }
         }
     }
@@ -5349,117 +6109,139 @@ void CWallet::AvailableReserveCoins(vector<COutput>& vCoins, bool fOnlyConfirmed
 
     {
         LOCK2(cs_main, cs_wallet);
-        uint32_t nHeight = chainActive.Height() + 1;
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        if (fOutputIndexDirty)
         {
-            const uint256& wtxid = it->first;
-            const CWalletTx* pcoin = &(*it).second;
+            RebuildOutputIndex();
+        }
+
+        uint32_t nHeight = chainActive.Height() + 1;
 
+        uint256 lastTxid;
+        bool fTxAvailable = false;
+        int nDepth = 0;
+        auto isTxAvailable = [&](const CWalletTx *pcoin) -> bool
+        {
             if (!CheckFinalTx(*pcoin))
-                continue;
+                return false;
 
             if (fOnlyConfirmed && !pcoin->IsTrusted())
-                continue;
+                return false;
 
             if (pcoin->IsCoinBase() && !fIncludeCoinBase)
-                continue;
+                return false;
 
             if (pcoin->IsCoinBase() && pcoin->GetBlocksToMaturity() > 0)
-                continue;
+                return false;
 
-            int nDepth = pcoin->GetDepthInMainChain();
-            if (nDepth < 0)
-                continue;
+            nDepth = pcoin->GetDepthInMainChain();
+            return nDepth >= 0;
+        };
+
+        auto addIfAvailable = [&](const COutPoint &outPoint, const CIndexedWalletOutput &indexed)
+        {
+            const uint256& wtxid = outPoint.hash;
+            const CWalletTx* pcoin = indexed.pwtx;
+            int i = outPoint.n;
 
-            for (int i = 0; i < pcoin->vout.size(); i++)
+            if (wtxid != lastTxid)
             {
-                isminetype mine = IsMine(pcoin->vout[i]);
-                if (!(IsSpent(wtxid, i)) &&
-                    mine != ISMINE_NO &&
-                    !IsLockedCoin((*it).first, i) &&
-                    (!coinControl || !coinControl->HasSelected() || coinControl->IsSelected((*it).first, i)))
-                {
-                    COptCCParams p;
-                    CCurrencyValueMap rOut = pcoin->vout[i].scriptPubKey.ReserveOutValue(p, true);
+                lastTxid = wtxid;
+                fTxAvailable = isTxAvailable(pcoin);
+            }
+            if (!fTxAvailable)
+                return;
 
-                    if (p.IsValid() && !pcoin->vout[i].scriptPubKey.IsSpendableOutputType(p))
-                    {
-                        continue;
-                    }
+            isminetype mine = indexed.mine;
+            if (IsSpent(wtxid, i) ||
+                IsLockedCoin(wtxid, i) ||
+                (coinControl && coinControl->HasSelected() && !coinControl->IsSelected(wtxid, i)))
+            {
+                return;
+            }
 
-                    // no zero valued outputs
-                    if (pOnlyTheseCurrencies &&
-                        !(pOnlyTheseCurrencies->Intersects(rOut) ||
-                          (fIncludeNative && pcoin->vout[i].nValue)))
-                    {
-                        continue;
-                    }
+            const CCurrencyValueMap &rOut = indexed.reserveValue;
 
-                    if (currencyTrustMode != CRating::TRUSTMODE_NORESTRICTION)
-                    {
-                        // if no currencies we will pay attention to and no native, don't return this output
-                        if (!RemoveBlockedCurrencies(rOut).valueMap.size() && !(fIncludeNative && pcoin->vout[i].nValue))
-                        {
-                            continue;
-                        }
-                    }
+            // no zero valued outputs
+            if (pOnlyTheseCurrencies &&
+                !(pOnlyTheseCurrencies->Intersects(rOut) ||
+                  (fIncludeNative && pcoin->vout[i].nValue)))
+            {
+                return;
+            }
 
-                    if (pOnlyFromDest)
-                    {
-                        if (p.IsValid())
-                        {
-                            bool found = false;
-                            for (auto &oneDest : p.vKeys)
-                            {
-                                if (GetDestinationID(oneDest) == GetDestinationID(*pOnlyFromDest))
-                                {
-                                    found = true;
-                                    break;
-                                }
-                            }
-                            if (!found)
-                            {
-                                continue;
-                            }
-                        }
-                        else
-                        {
-                            // support P2PK or P2PKH
-                            CTxDestination dest;
-                            if (!ExtractDestination(pcoin->vout[i].scriptPubKey, dest) || GetDestinationID(dest) != GetDestinationID(*pOnlyFromDest))
-                            {
-                                continue;
-                            }
-                        }
-                    }
+            if (currencyTrustMode != CRating::TRUSTMODE_NORESTRICTION)
+            {
+                // if no currencies we will pay attention to and no native, don't return this output
+                if (!RemoveBlockedCurrencies(rOut).valueMap.size() && !(fIncludeNative && pcoin->vout[i].nValue))
+                {
+                    return;
+                }
+            }
 
-                    if (!fIncludeIDLockedCoins)
-                    {
-                        // if this is sent to an ID in this wallet, ensure that the ID is unlocked or skip it
-                        CTxDestination checkDest;
-                        std::pair<CIdentityMapKey, CIdentityMapValue> keyAndIdentity;
-                        if (ExtractDestination(pcoin->vout[i].scriptPubKey, checkDest) &&
-                            checkDest.which() == COptCCParams::ADDRTYPE_ID)
-                        {
-                            if (GetIdentity(GetDestinationID(checkDest), keyAndIdentity))
-                            {
-                                if (keyAndIdentity.second.IsLocked(nHeight))
-                                {
-                                    continue;
-                                }
-                            }
-                            else
-                            {
-                                //LogPrintf("%s: unable to locate ID %s that should be present in wallet\n", __func__, EncodeDestination(checkDest).c_str());
-                                continue;
-                            }
-                        }
-                    }
+            if (pOnlyFromDest &&
+                std::find(indexed.destinations.begin(), indexed.destinations.end(), GetDestinationID(*pOnlyFromDest)) == indexed.destinations.end())
+            {
+                return;
+            }
+
+            if (!fIncludeIDLockedCoins && !indexed.idDestination.IsNull())
+            {
+                // if this is sent to an ID in this wallet, ensure that the ID is unlocked or skip it
+                std::pair<CIdentityMapKey, CIdentityMapValue> keyAndIdentity;
+                if (!GetIdentity(indexed.idDestination, keyAndIdentity) || keyAndIdentity.second.IsLocked(nHeight))
+                {
+                    return;
+                }
+            }
 
-                    vCoins.push_back(COutput(pcoin, i, nDepth, (mine & (fIncludeSharedCoins ? (ISMINE_SPENDABLE | ISMINE_SHARED) : ISMINE_SPENDABLE)) != ISMINE_NO));
+            vCoins.push_back(COutput(pcoin, i, nDepth, (mine & (fIncludeSharedCoins ? (ISMINE_SPENDABLE | ISMINE_SHARED) : ISMINE_SPENDABLE)) != ISMINE_NO));
+        };
+
+        // when only some destinations or currencies will do, only the outputs indexed under them are candidates
+        std::set<COutPoint> candidates;
+        if (pOnlyFromDest)
+        {
+            auto destIt = mapOutputsByDestination.find(GetDestinationID(*pOnlyFromDest));
+            if (destIt != mapOutputsByDestination.end())
+            {
+                candidates = destIt->second;
+            }
+        }
+        else if (pOnlyTheseCurrencies)
+        {
+            std::vector<uint160> currencies;
+            for (auto &oneCurrency : pOnlyTheseCurrencies->valueMap)
+            {
+                currencies.push_back(oneCurrency.first);
+            }
+            if (fIncludeNative)
+            {
+                currencies.push_back(ASSETCHAINS_CHAINID);
+            }
+            for (auto &oneCurrency : currencies)
+            {
+                auto currencyIt = mapOutputsByCurrency.find(oneCurrency);
+                if (currencyIt != mapOutputsByCurrency.end())
+                {
+                    candidates.insert(currencyIt->second.begin(), currencyIt->second.end());
                 }
             }
         }
+
+        if (pOnlyFromDest || pOnlyTheseCurrencies)
+        {
+            for (auto &oneOutput : candidates)
+            {
+                addIfAvailable(oneOutput, mapOutputIndex[oneOutput]);
+            }
+        }
+        else
+        {
+            for (auto &indexedOut : mapOutputIndex)
+            {
+                addIfAvailable(indexedOut.first, indexedOut.second);
+            }
+        }
     }
 }
 
@@ -5562,6 +6344,155 @@ bool CloserToTarget(const CCurrencyValueMap &target, const CCurrencyValueMap &cu
     return false;
 }
 
+// looks for the subset of outputs that meets every target currency with the fewest inputs, up to nMaxInputs, and of
+// those, the one with the least excess relative to each target. the search is depth first over outputs in order of
+// how much of the target they cover, pruned where what is left cannot reach the target or cannot beat the best
+// subset found, and stops after nMaxTries steps with the best found by then
+static bool SelectBestReserveSubset(const vector<std::pair<CUTXORef, CCurrencyValueMap>> &vValue,
+                                    const CCurrencyValueMap &targetValues,
+                                    int nMaxInputs,
+                                    vector<char>& vfBest,
+                                    CCurrencyValueMap& bestTotals,
+                                    int nMaxTries = RESERVE_SELECTION_MAX_TRIES)
+{
+    // currency values are compared as dense vectors in the order of the target's currencies
+    std::vector<uint160> currencies;
+    std::vector<CAmount> target;
+    for (auto &oneCur : targetValues.valueMap)
+    {
+        if (oneCur.second > 0)
+        {
+            currencies.push_back(oneCur.first);
+            target.push_back(oneCur.second);
+        }
+    }
+    size_t nCurrencies = currencies.size();
+    size_t nOutputs = vValue.size();
+    if (!nCurrencies || !nOutputs || nMaxInputs <= 0)
+    {
+        return false;
+    }
+
+    std::vector<std::vector<CAmount>> values(nOutputs, std::vector<CAmount>(nCurrencies, 0));
+    std::vector<double> coverage(nOutputs, 0.0);
+    for (size_t i = 0; i < nOutputs; i++)
+    {
+        for (size_t c = 0; c < nCurrencies; c++)
+        {
+            auto it = vValue[i].second.valueMap.find(currencies[c]);
+            if (it != vValue[i].second.valueMap.end() && it->second > 0)
+            {
+                values[i][c] = it->second;
+                coverage[i] += std::min(1.0, (double)it->second / target[c]);
+            }
+        }
+    }
+    std::vector<size_t> order(nOutputs);
+    for (size_t i = 0; i < nOutputs; i++)
+    {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&coverage](size_t a, size_t b) { return coverage[a] > coverage[b]; });
+
+    // value of the outputs from each position on, to prune branches that can no longer reach the target
+    std::vector<std::vector<CAmount>> remaining(nOutputs + 1, std::vector<CAmount>(nCurrencies, 0));
+    for (size_t k = nOutputs; k-- > 0; )
+    {
+        for (size_t c = 0; c < nCurrencies; c++)
+        {
+            remaining[k][c] = remaining[k + 1][c] + values[order[k]][c];
+        }
+    }
+    for (size_t c = 0; c < nCurrencies; c++)
+    {
+        if (remaining[0][c] < target[c])
+        {
+            return false;
+        }
+    }
+
+    std::vector<CAmount> totals(nCurrencies, 0);
+    std::vector<size_t> included;
+    std::vector<size_t> bestIncluded;
+    size_t bestCount = (size_t)nMaxInputs + 1;
+    double bestExcess = 0;
+    int nTries = 0;
+
+    std::function<void(size_t)> search = [&](size_t k)
+    {
+        double excess = 0;
+        bool fMet = true;
+        for (size_t c = 0; c < nCurrencies && fMet; c++)
+        {
+            fMet = totals[c] >= target[c];
+            excess += (double)(totals[c] - target[c]) / target[c];
+        }
+        if (fMet)
+        {
+            if (included.size() < bestCount || excess < bestExcess)
+            {
+                bestIncluded = included;
+                bestCount = included.size();
+                bestExcess = excess;
+            }
+            return;
+        }
+        // one more input must not be more than the best has
+        if (included.size() + 1 > bestCount)
+        {
+            return;
+        }
+
+        for (size_t j = k; j < nOutputs && nTries++ < nMaxTries; j++)
+        {
+            bool fReachable = true, fHelps = false;
+            for (size_t c = 0; c < nCurrencies; c++)
+            {
+                if (totals[c] < target[c])
+                {
+                    fReachable = fReachable && totals[c] + remaining[j][c] >= target[c];
+                    fHelps = fHelps || values[order[j]][c] > 0;
+                }
+            }
+            // what is left only gets smaller from here
+            if (!fReachable)
+            {
+                break;
+            }
+            if (!fHelps)
+            {
+                continue;
+            }
+
+            for (size_t c = 0; c < nCurrencies; c++)
+            {
+                totals[c] += values[order[j]][c];
+            }
+            included.push_back(order[j]);
+            search(j + 1);
+            included.pop_back();
+            for (size_t c = 0; c < nCurrencies; c++)
+            {
+                totals[c] -= values[order[j]][c];
+            }
+        }
+    };
+    search(0);
+
+    if (bestIncluded.empty())
+    {
+        return false;
+    }
+    vfBest.assign(nOutputs, false);
+    bestTotals = CCurrencyValueMap();
+    for (auto i : bestIncluded)
+    {
+        vfBest[i] = true;
+        bestTotals += vValue[i].second.IntersectingValues(targetValues);
+    }
+    return true;
+}
+
 static void ApproximateBestReserveSubset(vector<std::pair<CUTXORef, CCurrencyValueMap>> vValue,
                                          const CCurrencyValueMap &totalToOptimize,
                                          const CCurrencyValueMap &targetValues,
@@ -6307,11 +7238,16 @@ bool CWallet::SelectReserveUTXOs(const CCurrencyValueMap& targetValues,
 
     //printf("totalToOptimize:\n%s\nnewOptimizationTarget:\n%s\n", totalToOptimize.ToUniValue().write().c_str(), (adjustedTarget + nativeCent).ToUniValue().write().c_str());
 
-    ApproximateBestReserveSubset(vOutputsToOptimize, totalToOptimize, adjustedTarget, vfBest, bestTotals, 1000);
-    if (bestTotals != adjustedTarget && totalToOptimize >= (adjustedTarget + nativeCent))
+    // the fewest inputs that meet all currencies at once, if the search finds them within its bounds, otherwise
+    // the best randomized approximation
+    if (!SelectBestReserveSubset(vOutputsToOptimize, adjustedTarget, std::max((int)numInputsLimit - (int)added.size(), 1), vfBest, bestTotals))
     {
-        //printf("bestTotals:\n%s\ntotalToOptimize:\n%s\nnewOptimizationTarget:\n%s\n", bestTotals.ToUniValue().write().c_str(), totalToOptimize.ToUniValue().write().c_str(), (adjustedTarget + nativeCent).ToUniValue().write().c_str());
-        ApproximateBestReserveSubset(vOutputsToOptimize, totalToOptimize, adjustedTarget + nativeCent, vfBest, bestTotals, 1000);
+        ApproximateBestReserveSubset(vOutputsToOptimize, totalToOptimize, adjustedTarget, vfBest, bestTotals, 1000);
+        if (bestTotals != adjustedTarget && totalToOptimize >= (adjustedTarget + nativeCent))
+        {
+            //printf("bestTotals:\n%s\ntotalToOptimize:\n%s\nnewOptimizationTarget:\n%s\n", bestTotals.ToUniValue().write().c_str(), totalToOptimize.ToUniValue().write().c_str(), (adjustedTarget + nativeCent).ToUniValue().write().c_str());
+            ApproximateBestReserveSubset(vOutputsToOptimize, totalToOptimize, adjustedTarget + nativeCent, vfBest, bestTotals, 1000);
+        }
     }
 
     for (unsigned int i = 0; i < vOutputsToOptimize.size(); i++)
@@ -6868,13 +7804,14 @@ bool CWallet::CreateTransaction(const vector<CRecipient>& vecSend, CWalletTx& wt
                 // Sign
                 int nIn = 0;
                 CTransaction txNewConst(txNew);
+                PrecomputedTransactionData txdata(txNewConst);
                 BOOST_FOREACH(const PAIRTYPE(const CWalletTx*,unsigned int)& coin, setCoins)
                 {
                     bool signSuccess;
                     const CScript& scriptPubKey = coin.first->vout[coin.second].scriptPubKey;
                     SignatureData sigdata;
                     if (sign)
-                        signSuccess = ProduceSignature(TransactionSignatureCreator(this, &txNewConst, nIn, coin.first->vout[coin.second].nValue, scriptPubKey), scriptPubKey, sigdata, consensusBranchId);
+                        signSuccess = ProduceSignature(TransactionSignatureCreator(this, &txNewConst, nIn, coin.first->vout[coin.second].nValue, scriptPubKey, INT32_MAX, SIGHASH_ALL, &txdata), scriptPubKey, sigdata, consensusBranchId);
                     else
                         signSuccess = ProduceSignature(DummySignatureCreator(this), scriptPubKey, sigdata, consensusBranchId);
 
@@ -7346,13 +8283,14 @@ int CWallet::CreateReserveTransaction(const vector<CRecipient>& vecSend, CWallet
             // Sign
             int nIn = 0;
             CTransaction txNewConst(txNew);
+            PrecomputedTransactionData txdata(txNewConst);
             BOOST_FOREACH(const PAIRTYPE(const CWalletTx*,unsigned int)& coin, setCoins)
             {
                 bool signSuccess;
                 const CScript& scriptPubKey = coin.first->vout[coin.second].scriptPubKey;
                 SignatureData sigdata;
                 if (sign)
-                    signSuccess = ProduceSignature(TransactionSignatureCreator(this, &txNewConst, nIn, coin.first->vout[coin.second].nValue, scriptPubKey), scriptPubKey, sigdata, consensusBranchId);
+                    signSuccess = ProduceSignature(TransactionSignatureCreator(this, &txNewConst, nIn, coin.first->vout[coin.second].nValue, scriptPubKey, INT32_MAX, SIGHASH_ALL, &txdata), scriptPubKey, sigdata, consensusBranchId);
                 else
                     signSuccess = ProduceSignature(DummySignatureCreator(this), scriptPubKey, sigdata, consensusBranchId);
 
@@ -7433,6 +8371,9 @@ bool CWallet::CommitTransaction(CWalletTx& wtxNew, boost::optional<CReserveKey&>
         LOCK2(cs_main, cs_wallet);
         LogPrintf("CommitTransaction:\n%s", wtxNew.ToString());
         {
+            // the key, change and spent coin records are flushed once, when the group commit ends
+            CDBGroupCommit groupCommit(fFileBacked ? strWalletFile : std::string());
+
             // This is only to keep the database open to defeat the auto-flush for the
             // duration of this scope.  This is the only place where this optimization
             // maybe makes sense; please don't do it anywhere else.
@@ -7671,6 +8612,8 @@ bool CWallet::TopUpKeyPool(unsigned int kpSize)
         if (IsLocked())
             return false;
 
+        // each new key writes its key, metadata and pool records, which are flushed together
+        CDBGroupCommit groupCommit(fFileBacked ? strWalletFile : std::string());
         CWalletDB walletdb(strWalletFile);
 
         // Top up key pool
@@ -8026,18 +8969,21 @@ void CWallet::LockCoin(COutPoint& output)
 {
     AssertLockHeld(cs_wallet); // setLockedCoins
     setLockedCoins.insert(output);
+    fStakeIndexDirty = true;
 }
 
 void CWallet::UnlockCoin(COutPoint& output)
 {
     AssertLockHeld(cs_wallet); // setLockedCoins
     setLockedCoins.erase(output);
+    fStakeIndexDirty = true;
 }
 
 void CWallet::UnlockAllCoins()
 {
     AssertLockHeld(cs_wallet); // setLockedCoins
     setLockedCoins.clear();
+    fStakeIndexDirty = true;
 }
 
 bool CWallet::IsLockedCoin(uint256 hash, unsigned int n) const
@@ -8184,6 +9130,38 @@ public:
     void operator()(const CNoDestination &none) {}
 };
 
+void CWallet::GetMemoryUsage(size_t &nTransactionUsage, size_t &nWitnessUsage) const
+{
+    AssertLockHeld(cs_wallet);
+    nTransactionUsage = memusage::DynamicUsage(mapWallet);
+    nWitnessUsage = 0;
+    for (const auto &entry : mapWallet)
+    {
+        const CWalletTx &wtx = entry.second;
+        nTransactionUsage += RecursiveDynamicUsage(static_cast<const CTransaction &>(wtx)) +
+                             memusage::DynamicUsage(wtx.vShieldedSpend) +
+                             memusage::DynamicUsage(wtx.vShieldedOutput) +
+                             memusage::DynamicUsage(wtx.vJoinSplit) +
+                             memusage::DynamicUsage(wtx.vMerkleBranch) +
+                             memusage::DynamicUsage(wtx.mapValue) +
+                             memusage::DynamicUsage(wtx.vOrderForm) +
+                             memusage::DynamicUsage(wtx.mapSproutNoteData) +
+                             memusage::DynamicUsage(wtx.mapSaplingNoteData);
+
+        // the hashes a witness holds outside of itself are about its serialized size
+        for (const auto &noteData : wtx.mapSproutNoteData)
+        {
+            nWitnessUsage += memusage::DynamicUsage(noteData.second.witnesses) +
+                             ::GetSerializeSize(noteData.second.witnesses, SER_DISK, CLIENT_VERSION);
+        }
+        for (const auto &noteData : wtx.mapSaplingNoteData)
+        {
+            nWitnessUsage += memusage::DynamicUsage(noteData.second.witnesses) +
+                             ::GetSerializeSize(noteData.second.witnesses, SER_DISK, CLIENT_VERSION);
+        }
+    }
+}
+
 void CWallet::GetKeyBirthTimes(std::map<CKeyID, int64_t> &mapKeyBirth) const {
     AssertLockHeld(cs_wallet); // mapKeyMetadata
     mapKeyBirth.clear();
@@ -27,7 +27,10 @@
 #include "base58.h"
 
 #include <algorithm>
+#include <atomic>
+#include <functional>
 #include <map>
+#include <memory>
 #include <set>
 #include <stdexcept>
 #include <stdint.h>
@@ -57,6 +60,20 @@ static const CAmount nHighTransactionFeeWarning = 0.01 * COIN;
 static const CAmount DEFAULT_TRANSACTION_MAXFEE = 0.1 * COIN;
 //! -txconfirmtarget default
 static const unsigned int DEFAULT_TX_CONFIRM_TARGET = 2;
+//! -rescanthreads default, 0 or 1 rescans on the calling thread alone
+static const int DEFAULT_RESCAN_THREADS = 4;
+//! blocks a parallel rescan reads ahead of the block it adds to the wallet, per thread
+static const int RESCAN_BLOCKS_AHEAD_PER_THREAD = 8;
+//! blocks a rescan on the calling thread asks the OS to read ahead of it at a time
+static const size_t RESCAN_PREFETCH_BLOCKS = 100;
+//! -saplingdecryptthreads default, threads that trial decrypt the Sapling outputs of a block or transaction
+static const int DEFAULT_SAPLING_DECRYPT_THREADS = 4;
+//! output and viewing key pairs each thread of a trial decryption must have for it to be split across threads
+static const int MIN_SAPLING_TRIALS_PER_THREAD = 64;
+//! -witnessthreads default, threads that append the commitments of a connected block to the wallet's note witnesses
+static const int DEFAULT_WITNESS_THREADS = 4;
+//! commitments each thread must append to witnesses for the witness updates of a block to be split across threads
+static const int MIN_WITNESS_APPENDS_PER_THREAD = 256;
 //! -maxtxfee will warn if called with a higher fee than this amount (in satoshis)
 static const CAmount nHighTransactionMaxFeeWarning = 100 * nHighTransactionFeeWarning;
 //! Largest (in bytes) free transaction we're willing to create
@@ -71,6 +88,9 @@ static const unsigned int WITNESS_CACHE_SIZE = _COINBASE_MATURITY+10;
 // should be default when checking "-mempooltxinputlimit"
 #define MAX_NUM_INPUTS_LIMIT 200
 
+// steps the branch and bound search for multi-currency inputs may take before it settles for the best it has found
+static const int RESERVE_SELECTION_MAX_TRIES = 100000;
+
 //! Size of HD seed in bytes
 static const size_t HD_WALLET_SEED_LENGTH = 32;
 
@@ -677,6 +697,37 @@ public:
     std::string ToString() const;
 };
 
+/** An unspent output of ours in the output index, with what coin selection needs to know about its script, which
+ *  does not change while it stays in the index. */
+class CIndexedWalletOutput
+{
+public:
+    const CWalletTx *pwtx;
+    isminetype mine;
+    CCurrencyValueMap reserveValue;         // reserve currencies it can be spent for
+    uint160 idDestination;                  // identity it is sent to, which may be locked, or null
+    std::vector<uint160> destinations;      // the keys of a smart transaction or the address of any other output
+
+    CIndexedWalletOutput() : pwtx(nullptr), mine(ISMINE_NO) {}
+};
+
+/** A wallet output in the stake index, with a shared copy of its source transaction, so that stake hashes
+ *  can be evaluated without holding cs_wallet. */
+class CStakeableOutput
+{
+public:
+    std::shared_ptr<const CWalletTx> tx;
+    int voutNum;
+    uint32_t confirmedHeight;           // height of the block that includes the source transaction
+    uint32_t eligibleHeight;            // first block height this output can stake
+    CAmount nValue;
+
+    CStakeableOutput() : voutNum(0), confirmedHeight(0), eligibleHeight(0), nValue(0) {}
+
+    CStakeableOutput(const std::shared_ptr<const CWalletTx> &txIn, int voutNumIn, uint32_t confirmedHeightIn, uint32_t eligibleHeightIn) :
+        tx(txIn), voutNum(voutNumIn), confirmedHeight(confirmedHeightIn), eligibleHeight(eligibleHeightIn), nValue(txIn->vout[voutNumIn].nValue) {}
+};
+
 /** Private key that includes an expiration date in case it never gets used. */
 class CWalletKey
 {
@@ -846,6 +897,14 @@ private:
     std::vector<CTransaction> pendingSaplingMigrationTxs;
     AsyncRPCOperationId saplingMigrationOperationId;
 
+    // Sapling notes of the transactions in the last block synced, trial decrypted all at once when its first
+    // shielded transaction was, with the number of viewing keys they were decrypted with
+    uint256 saplingNotesBlockHash;
+    size_t nSaplingNotesKeys = 0;
+    std::map<uint256, std::pair<mapSaplingNoteData_t, SaplingIncomingViewingKeyMap>> mapBlockSaplingNotes;
+
+    const std::pair<mapSaplingNoteData_t, SaplingIncomingViewingKeyMap> *GetBlockSaplingNotes(const CTransaction& tx, const CBlock& block);
+
     void AddToTransparentSpends(const COutPoint& outpoint, const uint256& wtxid);
     void AddToSproutSpends(const uint256& nullifier, const uint256& wtxid);
     void AddToSaplingSpends(const uint256& nullifier, const uint256& wtxid);
@@ -957,6 +1016,59 @@ public:
     MasterKeyMap mapMasterKeys;
     unsigned int nMasterKeyMaxID;
 
+    /*
+     * Index of wallet outputs that can stake, including outputs that have not yet reached stake age, so that new
+     * blocks only need to filter by height. It is rebuilt from the wallet on the next stake attempt after any
+     * wallet transaction is added or updated, coins are locked or unlocked, or a block is disconnected.
+     */
+    mutable std::vector<CStakeableOutput> vStakeIndex;
+    mutable bool fStakeIndexDirty;
+    mutable bool fStakeIndexExtended;
+    mutable uint32_t nStakeIndexSolutionVersion;
+
+    /*
+     * Index of the unspent outputs of ours that can be spent, by outpoint and by the currencies and destinations
+     * they hold or are sent to, so that gathering coins does not walk all of mapWallet. Outputs are indexed and
+     * unindexed as the transactions that hold and spend them are added or updated. It is rebuilt on next use
+     * after keys, scripts, watch-only addresses or identities change what is ours, a transaction is erased,
+     * or a block is disconnected.
+     */
+    mutable std::map<COutPoint, CIndexedWalletOutput> mapOutputIndex;
+    mutable std::map<uint160, std::set<COutPoint>> mapOutputsByCurrency;
+    mutable std::map<uint160, std::set<COutPoint>> mapOutputsByDestination;
+    mutable std::atomic<bool> fOutputIndexDirty;
+
+    /*
+     * Wallet transactions by nOrderPos, so that the activity log is paged from its newest end rather than sorted on
+     * every call. New transactions are added as they are inserted, and it is rebuilt on next use after the wallet
+     * is loaded or reordered, or a transaction is erased.
+     */
+    std::multimap<int64_t, CWalletTx*> mapTxOrdered;
+    bool fTxOrderedDirty;
+
+    /*
+     * Wallet balances by BALANCE_ type, as of the tip, mempool update count and balance generation they were
+     * computed at. Anything that changes the wallet's transactions, their spent state or what is ours bumps the
+     * generation, so balances polled between changes are answered without walking mapWallet.
+     */
+    enum {
+        BALANCE_TRUSTED,
+        BALANCE_TRUSTED_UNLOCKED,
+        BALANCE_SHARED,
+        BALANCE_SHARED_UNLOCKED,
+        BALANCE_UNCONFIRMED,
+        BALANCE_IMMATURE,
+        BALANCE_WATCHONLY,
+        BALANCE_UNCONFIRMED_WATCHONLY,
+        BALANCE_IMMATURE_WATCHONLY
+    };
+    mutable std::map<int, CAmount> mapCachedBalances;
+    mutable std::map<int, CCurrencyValueMap> mapCachedReserveBalances;
+    mutable uint256 balanceCacheTip;
+    mutable unsigned int nBalanceCacheMempoolUpdates;
+    mutable uint64_t nBalanceCacheGeneration;
+    mutable std::atomic<uint64_t> nBalanceGeneration;
+
     CWallet()
     {
         SetNull();
@@ -989,6 +1101,14 @@ public:
         nTimeFirstKey = 0;
         fBroadcastTransactions = false;
         nWitnessCacheSize = 0;
+        fStakeIndexDirty = true;
+        fStakeIndexExtended = false;
+        nStakeIndexSolutionVersion = 0;
+        fOutputIndexDirty = true;
+        fTxOrderedDirty = true;
+        nBalanceCacheMempoolUpdates = 0;
+        nBalanceCacheGeneration = 0;
+        nBalanceGeneration = 0;
     }
 
     /**
@@ -1045,6 +1165,10 @@ public:
 
     std::map<uint256, CWalletTx> mapWallet;
 
+    // current confirmed state and height of identities listed from this wallet. an entry is erased when a transaction
+    // with an output of its identity is synced, so listing identities only looks up the ones that changed
+    std::map<CIdentityID, std::pair<CIdentity, uint32_t>> mapIdentityStates;
+
     int64_t nOrderPosNext;
     std::map<uint256, int> mapRequestCount;
 
@@ -1065,6 +1189,12 @@ public:
 
     void AvailableCoins(std::vector<COutput>& vCoins, bool fOnlyConfirmed=true, const CCoinControl *coinControl = NULL, bool fIncludeZeroValue=false, bool fIncludeCoinBase=true, bool fIncludeProtectedCoinbase=true, bool fIncludeImmatureCoins=false, bool fIncludeIDLockedCoins=true, bool fIncludeSharedCoins=false) const;
     void AvailableReserveCoins(std::vector<COutput>& vCoins, bool fOnlyConfirmed, const CCoinControl *coinControl, bool fIncludeCoinBase, bool fIncludeNative=true, const CTxDestination *pOnlyFromDest=nullptr, const CCurrencyValueMap *pOnlyTheseCurrencies=nullptr, bool fIncludeIDLockedCoins=true, bool fIncludeSharedCoins=false) const;
+    void IndexWalletOutput(const CWalletTx &wtx, int voutNum) const;
+    void UnindexWalletOutput(const COutPoint &output) const;
+    void UpdateOutputIndex(const CWalletTx &wtx) const;
+    void RebuildOutputIndex() const;
+    void MarkOutputIndexDirty() { fOutputIndexDirty = true; MarkBalancesDirty(); }
+    void MarkBalancesDirty() const { nBalanceGeneration++; }
     bool SelectCoinsMinConf(const CAmount& nTargetValue, int nConfMine, int nConfTheirs, std::vector<COutput> vCoins, std::set<std::pair<const CWalletTx*,unsigned int> >& setCoinsRet, CAmount& nValueRet) const;
     bool SelectReserveCoinsMinConf(const CCurrencyValueMap& targetValues,
                                     CAmount targetNativeValue,
@@ -1131,6 +1261,7 @@ public:
     bool AddUpdateIdentity(const CIdentityMapKey &mapKey, const CIdentityMapValue &identity);
     bool RemoveIdentity(const CIdentityMapKey &mapKey, const uint256 &txid=uint256());
     bool LoadIdentity(const CIdentityMapKey &mapKey, const CIdentityMapValue &identity);
+    CIdentity GetCurrentIdentityState(const CIdentityID &idID, uint32_t *pHeightOut=nullptr);
 
     void ClearCurrencyTrust();
     bool RemoveCurrencyTrust(const uint160 &currencyID);
@@ -1169,6 +1300,9 @@ public:
 
     void GetKeyBirthTimes(std::map<CKeyID, int64_t> &mapKeyBirth) const;
 
+    //! Approximate heap bytes of mapWallet, and of the note witnesses cached in it, for getmemoryinfo. Requires cs_wallet.
+    void GetMemoryUsage(size_t &nTransactionUsage, size_t &nWitnessUsage) const;
+
     /**
       * Sprout ZKeys
       */
@@ -1245,6 +1379,14 @@ public:
      */
     TxItems OrderedTxItems(std::list<CAccountingEntry>& acentries, std::string strAccount = "");
 
+    /**
+     * Walks the wallet's activity log from the newest entry, calling fn with each transaction or accounting entry
+     * of strAccount until it returns false. Only the accounting entries are read from the database.
+     */
+    void ReverseOrderedTxItems(std::list<CAccountingEntry>& acentries, const std::function<bool(CWalletTx*, CAccountingEntry*)>& fn, std::string strAccount = "");
+    const std::multimap<int64_t, CWalletTx*>& GetOrderedWalletTxes();
+    void MarkTxOrderedDirty() { fTxOrderedDirty = true; }
+
     void MarkDirty();
     bool UpdateNullifierNoteMap();
     void UpdateNullifierNoteMapWithTx(const CWalletTx& wtx);
@@ -1256,7 +1398,8 @@ public:
     void RescanWallet();
     std::pair<bool, bool> CheckAuthority(const CIdentity &identity);
     bool MarkIdentityDirty(const CIdentityID &idID);
-    bool AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pblock, bool fUpdate, bool isRescan);
+    bool AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pblock, bool fUpdate, bool isRescan,
+                                  const std::pair<mapSaplingNoteData_t, SaplingIncomingViewingKeyMap> *pSaplingNotes=nullptr);
     void WitnessNoteCommitment(
          std::vector<uint256> commitments,
          std::vector<boost::optional<SproutWitness>>& witnesses,
@@ -1279,6 +1422,9 @@ public:
     CCurrencyValueMap GetUnconfirmedWatchOnlyReserveBalance() const;
     CAmount GetImmatureWatchOnlyBalance() const;
     CCurrencyValueMap GetImmatureWatchOnlyReserveBalance() const;
+    CAmount CachedBalance(int balanceType, const std::function<CAmount()> &computeBalance) const;
+    CCurrencyValueMap CachedReserveBalance(int balanceType, const std::function<CCurrencyValueMap()> &computeBalance) const;
+    void RefreshBalanceCache() const;
     bool FundTransaction(CMutableTransaction& tx, CAmount& nFeeRet, int& nChangePosRet, std::string& strFailReason);
     bool CreateTransaction(const std::vector<CRecipient>& vecSend, CWalletTx& wtxNew, CReserveKey& reservekey, CAmount& nFeeRet, int& nChangePosRet,
                            std::string& strFailReason, const CCoinControl *coinControl = NULL, bool sign = true);
@@ -1471,6 +1617,9 @@ public:
     // staking functions
     bool VerusSelectStakeOutput(CBlock *pBlock, arith_uint256 &hashResult, CTransaction &stakeSource, int32_t &voutNum, int32_t nHeight, uint32_t &bnTarget) const;
     CAmount EligibleStakeOutputs(std::vector<COutput> &vecOutputs, std::vector<CWalletTx> &vwtx, bool extendedStake) const;
+    CAmount StakeCandidates(std::vector<CStakeableOutput> &candidates, uint32_t nHeight, bool extendedStake) const;
+    void RebuildStakeIndex(bool extendedStake) const;
+    void MarkStakeIndexDirty();
 
     int32_t VerusStakeTransaction(CBlock *pBlock, CMutableTransaction &txNew, uint32_t &bnTarget, arith_uint256 &hashResult, std::vector<unsigned char> &utxosig, CTxDestination &rewardDest) const;
 
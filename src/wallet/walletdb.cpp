@@ -433,6 +433,7 @@ DBErrors CWalletDB::ReorderTransactions(CWallet* pwallet)
 
     int64_t& nOrderPosNext = pwallet->nOrderPosNext;
     nOrderPosNext = 0;
+    pwallet->MarkTxOrderedDirty();
     std::vector<int64_t> nOrderPosOffsets;
     for (TxItems::iterator it = txByTime.begin(); it != txByTime.end(); ++it)
     {
@@ -506,6 +507,64 @@ public:
     }
 };
 
+// reads a wallet transaction record after its type, which needs nothing from the wallet, so that records can be
+// read on several threads at once
+static bool ReadWalletTx(CDataStream& ssKey, CDataStream& ssValue, CWalletTx& wtx, bool& fUpgraded, string& strErr)
+{
+    fUpgraded = false;
+    try {
+        uint256 hash;
+        ssKey >> hash;
+        ssValue >> wtx;
+        // the proofs of a wallet transaction were verified when it was accepted, and a record that still hashes to
+        // its key has not changed since
+        CValidationState state;
+        if (!(CheckTransactionWithoutProofVerification(wtx, state) && (wtx.GetHash() == hash) && state.IsValid()))
+        {
+            if (wtx.hashBlock.IsNull() && !wtx.vin.size() && !wtx.vout.size() && !wtx.vShieldedSpend.size() && !wtx.vShieldedOutput.size())
+            {
+                strErr = "nulltx";
+            }
+            return false;
+        }
+
+        // Undo serialize changes in 31600
+        if (31404 <= wtx.fTimeReceivedIsTxTime && wtx.fTimeReceivedIsTxTime <= 31703)
+        {
+            if (!ssValue.empty())
+            {
+                char fTmp;
+                char fUnused;
+                ssValue >> fTmp >> fUnused >> wtx.strFromAccount;
+                strErr = strprintf("LoadWallet() upgrading tx ver=%d %d '%s' %s",
+                                   wtx.fTimeReceivedIsTxTime, fTmp, wtx.strFromAccount, hash.ToString());
+                wtx.fTimeReceivedIsTxTime = fTmp;
+            }
+            else
+            {
+                strErr = strprintf("LoadWallet() repairing tx ver=%d %s", wtx.fTimeReceivedIsTxTime, hash.ToString());
+                wtx.fTimeReceivedIsTxTime = 0;
+            }
+            fUpgraded = true;
+        }
+    } catch (...)
+    {
+        return false;
+    }
+    return true;
+}
+
+static void LoadWalletTx(CWallet* pwallet, const CWalletTx& wtx, bool fUpgraded, CWalletScanState &wss)
+{
+    if (fUpgraded)
+        wss.vWalletUpgrade.push_back(wtx.GetHash());
+
+    if (wtx.nOrderPos == -1)
+        wss.fAnyUnordered = true;
+
+    pwallet->AddToWallet(wtx, true, NULL);
+}
+
 bool
 ReadKeyValue(CWallet* pwallet, CDataStream& ssKey, CDataStream& ssValue,
              CWalletScanState &wss, string& strType, string& strErr)
@@ -529,45 +588,11 @@ ReadKeyValue(CWallet* pwallet, CDataStream& ssKey, CDataStream& ssValue,
         }
         else if (strType == "tx")
         {
-            uint256 hash;
-            ssKey >> hash;
             CWalletTx wtx;
-            ssValue >> wtx;
-            CValidationState state;
-            auto verifier = libzcash::ProofVerifier::Strict();
-            if (!(CheckTransaction(wtx, state, verifier) && (wtx.GetHash() == hash) && state.IsValid()))
-            {
-                if (wtx.hashBlock.IsNull() && !wtx.vin.size() && !wtx.vout.size() && !wtx.vShieldedSpend.size() && !wtx.vShieldedOutput.size())
-                {
-                    strErr = "nulltx";
-                }
+            bool fUpgraded;
+            if (!ReadWalletTx(ssKey, ssValue, wtx, fUpgraded, strErr))
                 return false;
-            }
-
-            // Undo serialize changes in 31600
-            if (31404 <= wtx.fTimeReceivedIsTxTime && wtx.fTimeReceivedIsTxTime <= 31703)
-            {
-                if (!ssValue.empty())
-                {
-                    char fTmp;
-                    char fUnused;
-                    ssValue >> fTmp >> fUnused >> wtx.strFromAccount;
-                    strErr = strprintf("LoadWallet() upgrading tx ver=%d %d '%s' %s",
-                                       wtx.fTimeReceivedIsTxTime, fTmp, wtx.strFromAccount, hash.ToString());
-                    wtx.fTimeReceivedIsTxTime = fTmp;
-                }
-                else
-                {
-                    strErr = strprintf("LoadWallet() repairing tx ver=%d %s", wtx.fTimeReceivedIsTxTime, hash.ToString());
-                    wtx.fTimeReceivedIsTxTime = 0;
-                }
-                wss.vWalletUpgrade.push_back(hash);
-            }
-
-            if (wtx.nOrderPos == -1)
-                wss.fAnyUnordered = true;
-
-            pwallet->AddToWallet(wtx, true, NULL);
+            LoadWalletTx(pwallet, wtx, fUpgraded, wss);
         }
         else if (strType == "acentry")
         {
@@ -1104,6 +1129,73 @@ DBErrors CWalletDB::LoadWallet(CWallet* pwallet)
         pwallet->LoadCurrencyTrustMode(CRating::TRUSTMODE_NORESTRICTION);
         pwallet->LoadIdentityTrustMode(CRating::TRUSTMODE_NORESTRICTION);
 
+        // transaction records, which are most of a large wallet and all sorted together, are deserialized and checked
+        // a batch at a time on several threads, then added to the wallet in the order they were read
+        struct CWalletTxRecord
+        {
+            CDataStream ssKey;
+            CDataStream ssValue;
+            CWalletTx wtx;
+            bool fRead;
+            bool fUpgraded;
+            string strErr;
+
+            CWalletTxRecord(const CDataStream &ssKeyIn, const CDataStream &ssValueIn) :
+                ssKey(ssKeyIn), ssValue(ssValueIn), fRead(false), fUpgraded(false) {}
+        };
+        std::vector<CWalletTxRecord> vTxRecords;
+        int nLoadThreads = std::max(1, (int)GetArg("-walletloadthreads", DEFAULT_WALLET_LOAD_THREADS));
+
+        auto loadTxRecords = [&]()
+        {
+            if (vTxRecords.empty())
+                return;
+
+            int nThreads = std::min(nLoadThreads, (int)vTxRecords.size());
+            auto readRecords = [&](int threadNum)
+            {
+                for (size_t i = threadNum; i < vTxRecords.size(); i += nThreads)
+                {
+                    CWalletTxRecord &record = vTxRecords[i];
+                    record.fRead = ReadWalletTx(record.ssKey, record.ssValue, record.wtx, record.fUpgraded, record.strErr);
+                }
+            };
+            if (nThreads == 1)
+            {
+                readRecords(0);
+            }
+            else
+            {
+                boost::thread_group readThreads;
+                for (int i = 0; i < nThreads; i++)
+                {
+                    readThreads.create_thread(boost::bind<void>(readRecords, i));
+                }
+                readThreads.join_all();
+            }
+
+            for (auto &record : vTxRecords)
+            {
+                if (record.fRead)
+                {
+                    LoadWalletTx(pwallet, record.wtx, record.fUpgraded, wss);
+                }
+                else
+                {
+                    // as for any other bad transaction record below
+                    fNoncriticalErrors = true;
+                    SoftSetBoolArg("-rescan", true);
+                    if (record.strErr == "nulltx")
+                    {
+                        fNoncriticalErrors = false;
+                    }
+                }
+                if (!record.strErr.empty())
+                    LogPrintf("%s\n", record.strErr);
+            }
+            vTxRecords.clear();
+        };
+
         while (true)
         {
             // Read next record
@@ -1118,6 +1210,22 @@ DBErrors CWalletDB::LoadWallet(CWallet* pwallet)
                 return DB_CORRUPT;
             }
 
+            string strRecordType;
+            CDataStream ssRecordKey(ssKey);
+            try {
+                ssRecordKey >> strRecordType;
+            } catch (...) {}
+            if (strRecordType == "tx")
+            {
+                vTxRecords.emplace_back(ssRecordKey, ssValue);
+                if (vTxRecords.size() >= WALLET_LOAD_TX_BATCH)
+                {
+                    loadTxRecords();
+                }
+                continue;
+            }
+            loadTxRecords();
+
             // Try to be tolerant of single corrupt records:
             string strType, strErr;
             if (!ReadKeyValue(pwallet, ssKey, ssValue, wss, strType, strErr))
@@ -1144,6 +1252,7 @@ DBErrors CWalletDB::LoadWallet(CWallet* pwallet)
             if (!strErr.empty())
                 LogPrintf("%s\n", strErr);
         }
+        loadTxRecords();
         pcursor->close();
     }
     catch (const boost::thread_interrupted&) {
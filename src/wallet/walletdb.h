@@ -29,6 +29,11 @@ class CWalletTx;
 class uint160;
 class uint256;
 
+/** -walletloadthreads default, threads that read wallet transaction records at startup */
+static const int DEFAULT_WALLET_LOAD_THREADS = 4;
+/** Wallet transaction records read together before they are added to the wallet */
+static const size_t WALLET_LOAD_TX_BATCH = 4096;
+
 /** Error statuses for the wallet database */
 enum DBErrors
 {
@@ -1,4 +1,5 @@
 #include <cstdio>
+#include <functional>
 #include <future>
 #include <map>
 #include <thread>
@@ -11,12 +12,15 @@
 #include "primitives/transaction.h"
 #include "base58.h"
 #include "crypto/equihash.h"
+#include "crypto/verus_hash.h"
+#include "hash.h"
 #include "chain.h"
 #include "chainparams.h"
 #include "consensus/upgrades.h"
 #include "consensus/validation.h"
 #include "main.h"
 #include "miner.h"
+#include "pbaas/pbaas.h"
 #include "pow.h"
 #include "rpc/server.h"
 #include "script/sign.h"
@@ -217,6 +221,196 @@ double benchmark_verify_equihash()
     return timer_stop(tv_start);
 }
 
+// each VerusHash sample hashes this many block headers, as one hash is too fast to time reliably
+static const int VERUSHASH_BENCHMARK_HASHES = 100000;
+
+std::vector<double> benchmark_verushash_threaded(int nThreads, const std::function<double(void)> &benchmark)
+{
+    std::vector<double> ret;
+    std::vector<std::future<double>> tasks;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < nThreads; i++) {
+        std::packaged_task<double(void)> task(benchmark);
+        tasks.emplace_back(task.get_future());
+        threads.emplace_back(std::move(task));
+    }
+    for (auto it = tasks.begin(); it != tasks.end(); it++) {
+        it->wait();
+        ret.push_back(it->get());
+    }
+    for (auto it = threads.begin(); it != threads.end(); it++) {
+        it->join();
+    }
+    return ret;
+}
+
+// solutionVersion 0 is VerusHash 1.0, others are SOLUTION_VERUSHHASH_V2, V2_1 or V2_2
+double benchmark_verushash(int solutionVersion)
+{
+    CBlockHeader header = Params(CBaseChainParams::MAIN).GenesisBlock().GetBlockHeader();
+    header.nVersion = CBlockHeader::VERUS_V2;
+    randombytes_buf(header.hashPrevBlock.begin(), header.hashPrevBlock.size());
+    randombytes_buf(header.nNonce.begin(), header.nNonce.size());
+    uint64_t *pNonce = (uint64_t *)header.nNonce.begin();
+
+    uint256 hash;
+    struct timeval tv_start;
+    timer_start(tv_start);
+    for (int i = 0; i < VERUSHASH_BENCHMARK_HASHES; i++)
+    {
+        (*pNonce)++;
+        if (solutionVersion < SOLUTION_VERUSHHASH_V2)
+        {
+            hash = SerializeVerusHash(header);
+        }
+        else
+        {
+            hash = SerializeVerusHashV2b(header, solutionVersion);
+        }
+    }
+    return timer_stop(tv_start);
+}
+
+// times one CLHash kernel for VerusHash 2.0, 2.1 or 2.2, including the key refresh after each hash, as when mining
+double benchmark_verusclhash(int solutionVersion, bool portable)
+{
+    uint64_t (*clhashFunction)(void *random, const unsigned char buf[64], uint64_t keyMask, __m128i **pMoveScratch);
+    if (solutionVersion >= SOLUTION_VERUSHHASH_V2_2)
+    {
+        clhashFunction = portable ? &verusclhash_sv2_2_port : &verusclhash_sv2_2;
+    }
+    else if (solutionVersion >= SOLUTION_VERUSHHASH_V2_1)
+    {
+        clhashFunction = portable ? &verusclhash_sv2_1_port : &verusclhash_sv2_1;
+    }
+    else
+    {
+        clhashFunction = portable ? &verusclhash_port : &verusclhash;
+    }
+
+    CVerusHashV2 vh(solutionVersion);
+    alignas(32) unsigned char buf[64];
+    randombytes_buf(buf, sizeof(buf));
+    u128 *key = CVerusHashV2::GenNewCLKey(buf);
+    __m128i **pMoveScratch = (__m128i **)((unsigned char *)key + vh.vclh.keySizeInBytes + vh.vclh.keyrefreshsize());
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    for (int i = 0; i < VERUSHASH_BENCHMARK_HASHES; i++)
+    {
+        *((uint64_t *)(buf + 32)) = (*clhashFunction)(key, buf, vh.vclh.keyMask, pMoveScratch);
+        key = CVerusHashV2::GenNewCLKey(buf);
+    }
+    return timer_stop(tv_start);
+}
+
+// times the VerusHash proof of work check of the current tip header
+double benchmark_verify_verushash()
+{
+    CBlockHeader header;
+    {
+        LOCK(cs_main);
+        header = chainActive.LastTip() ? chainActive.LastTip()->GetBlockHeader() : Params().GenesisBlock().GetBlockHeader();
+    }
+    arith_uint256 target;
+    target.SetCompact(header.nBits);
+
+    bool passed = true;
+    struct timeval tv_start;
+    timer_start(tv_start);
+    for (int i = 0; i < VERUSHASH_BENCHMARK_HASHES; i++)
+    {
+        passed &= UintToArith256(header.GetHash()) <= target;
+    }
+    double ret = timer_stop(tv_start);
+    (void)passed;
+    return ret;
+}
+
+static const int CONVERTAMOUNTS_BENCHMARK_RUNS = 1000;
+
+// each run converts a different set of amounts through a fractional basket with nReserves equally weighted
+// reserves, half of them from reserve to fractional and half from fractional to reserve
+double benchmark_convertamounts(int nReserves)
+{
+    std::vector<uint160> currencies;
+    std::vector<int32_t> weights;
+    std::vector<int64_t> reserves;
+    for (int i = 0; i < nReserves; i++)
+    {
+        currencies.push_back(uint160(std::vector<unsigned char>(20, (unsigned char)(i + 1))));
+        weights.push_back(CCurrencyState::MAX_RESERVE_RATIO / (nReserves << 1));
+        reserves.push_back(1000000 * (CAmount)SATOSHIDEN);
+    }
+    CAmount supply = (nReserves << 1) * 1000000 * (CAmount)SATOSHIDEN;
+    CCurrencyState state(uint160(std::vector<unsigned char>(20, 0xff)), currencies, weights, reserves,
+                         supply, 0, supply, CCurrencyState::FLAG_FRACTIONAL);
+
+    uint32_t seed = GetRand(UINT32_MAX);
+    struct timeval tv_start;
+    timer_start(tv_start);
+    for (int i = 0; i < CONVERTAMOUNTS_BENCHMARK_RUNS; i++)
+    {
+        std::vector<CAmount> inputReserve(nReserves), inputFractional(nReserves);
+        for (int j = 0; j < nReserves; j++)
+        {
+            CAmount amount = (CAmount)((seed + i * nReserves + j) % 100000 + 1) * 10000;
+            if (j & 1)
+            {
+                inputFractional[j] = amount;
+            }
+            else
+            {
+                inputReserve[j] = amount;
+            }
+        }
+        CCurrencyState newState;
+        CValidationState validationState;
+        state.ConvertAmounts(inputReserve, inputFractional, newState, true, validationState);
+    }
+    return timer_stop(tv_start);
+}
+
+// replays the imports of the last nBlocks blocks of the active chain, timing only the creation of each import's
+// reserve transaction descriptor, which calculates all of its outputs from its reserve transfers
+double benchmark_replay_imports(int nBlocks)
+{
+    std::vector<std::pair<CTransaction, uint32_t>> imports;
+    {
+        LOCK(cs_main);
+        for (CBlockIndex *pindex = chainActive.LastTip(); pindex && nBlocks > 0; pindex = pindex->pprev, nBlocks--)
+        {
+            CBlock block;
+            if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus(), false))
+            {
+                throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read block " + std::to_string(pindex->GetHeight()));
+            }
+            for (auto &oneTx : block.vtx)
+            {
+                for (auto &oneOut : oneTx.vout)
+                {
+                    COptCCParams p;
+                    if (oneOut.scriptPubKey.IsPayToCryptoCondition(p) && p.IsValid() && p.evalCode == EVAL_CROSSCHAIN_IMPORT)
+                    {
+                        imports.push_back(std::make_pair(oneTx, pindex->GetHeight()));
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    LOCK2(cs_main, mempool.cs);
+    CCoinsViewCache view(pcoinsTip);
+    struct timeval tv_start;
+    timer_start(tv_start);
+    for (auto &oneImport : imports)
+    {
+        CReserveTransactionDescriptor rtxd(oneImport.first, view, oneImport.second);
+    }
+    return timer_stop(tv_start);
+}
+
 double benchmark_large_tx(size_t nInputs)
 {
     // Create priv/pub key
@@ -3,6 +3,7 @@
 
 #include <sys/time.h>
 #include <stdlib.h>
+#include <functional>
 
 extern double benchmark_sleep();
 extern double benchmark_create_joinsplit();
@@ -11,6 +12,12 @@ extern double benchmark_solve_equihash();
 extern std::vector<double> benchmark_solve_equihash_threaded(int nThreads);
 extern double benchmark_verify_joinsplit(const JSDescription &joinsplit);
 extern double benchmark_verify_equihash();
+extern std::vector<double> benchmark_verushash_threaded(int nThreads, const std::function<double(void)> &benchmark);
+extern double benchmark_verushash(int solutionVersion);
+extern double benchmark_verusclhash(int solutionVersion, bool portable);
+extern double benchmark_verify_verushash();
+extern double benchmark_convertamounts(int nReserves);
+extern double benchmark_replay_imports(int nBlocks);
 extern double benchmark_large_tx(size_t nInputs);
 extern double benchmark_try_decrypt_sprout_notes(size_t nAddrs);
 extern double benchmark_try_decrypt_sapling_notes(size_t nAddrs);
@@ -25,3 +25,8 @@ bool CZMQAbstractNotifier::NotifyTransaction(const CTransaction &/*transaction*/
 {
     return true;
 }
+
+bool CZMQAbstractNotifier::NotifyTransaction(const CZMQTransactionNotification &notification)
+{
+    return NotifyTransaction(notification.tx);
+}
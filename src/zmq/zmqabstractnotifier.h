@@ -7,9 +7,25 @@
 
 #include "zmqconfig.h"
 
+#include <vector>
+
 class CBlockIndex;
 class CZMQAbstractNotifier;
 
+/**
+ * A transaction as it is queued for the notifiers, which are called without cs_main, with what they can only look up
+ * while it is being validated
+ */
+struct CZMQTransactionNotification
+{
+    CTransaction tx;
+    uint256 blockHash;                      // block that confirms it, null for a mempool transaction
+    int nHeight;                            // height of that block, or -1
+    std::vector<CTxOut> spentOutputs;       // outputs spent by a mempool transaction, when a notifier needs them
+
+    CZMQTransactionNotification(const CTransaction &Tx) : tx(Tx), nHeight(-1) {}
+};
+
 typedef CZMQAbstractNotifier* (*CZMQNotifierFactory)();
 
 class CZMQAbstractNotifier
@@ -35,6 +51,10 @@ public:
     virtual bool NotifyBlock(const CBlockIndex *pindex);
     virtual bool NotifyBlock(const CBlock& pblock);
     virtual bool NotifyTransaction(const CTransaction &transaction);
+    virtual bool NotifyTransaction(const CZMQTransactionNotification &notification);
+
+    // true if the outputs spent by mempool transactions should be looked up for this notifier
+    virtual bool NeedsSpentOutputs() const { return false; }
 
 protected:
     void *psocket;
@@ -3,19 +3,23 @@
 // file COPYING or https://www.opensource.org/licenses/mit-license.php .
 
 #include "zmqnotificationinterface.h"
+#include "zmqpbaasnotifier.h"
 #include "zmqpublishnotifier.h"
 
 #include "version.h"
 #include "main.h"
 #include "streams.h"
+#include "txmempool.h"
 #include "util.h"
 
+#include <memory>
+
 void zmqError(const char *str)
 {
     LogPrint("zmq", "zmq: Error: %s, errno=%s\n", str, zmq_strerror(errno));
 }
 
-CZMQNotificationInterface::CZMQNotificationInterface() : pcontext(NULL)
+CZMQNotificationInterface::CZMQNotificationInterface() : pcontext(NULL), fSpentOutputs(false), queue("zmq"), pLastBlock(NULL)
 {
 }
 
@@ -40,6 +44,11 @@ CZMQNotificationInterface* CZMQNotificationInterface::CreateWithArguments(const
     factories["pubrawblock"] = CZMQAbstractNotifier::Create<CZMQPublishRawBlockNotifier>;
     factories["pubrawtx"] = CZMQAbstractNotifier::Create<CZMQPublishRawTransactionNotifier>;
     factories["pubcheckedblock"] = CZMQAbstractNotifier::Create<CZMQPublishCheckedBlockNotifier>;
+    factories["pubpbaasidentity"] = CZMQAbstractNotifier::Create<CZMQPublishPBaaSTopicNotifier<PBAAS_ZMQ_IDENTITY>>;
+    factories["pubpbaascurrencystate"] = CZMQAbstractNotifier::Create<CZMQPublishPBaaSTopicNotifier<PBAAS_ZMQ_CURRENCYSTATE>>;
+    factories["pubpbaascrosschain"] = CZMQAbstractNotifier::Create<CZMQPublishPBaaSTopicNotifier<PBAAS_ZMQ_CROSSCHAIN>>;
+    factories["pubpbaasnotarization"] = CZMQAbstractNotifier::Create<CZMQPublishPBaaSTopicNotifier<PBAAS_ZMQ_NOTARIZATION>>;
+    factories["pubpbaasoffer"] = CZMQAbstractNotifier::Create<CZMQPublishPBaaSTopicNotifier<PBAAS_ZMQ_OFFER>>;
 
     for (std::map<std::string, CZMQNotifierFactory>::const_iterator i=factories.begin(); i!=factories.end(); ++i)
     {
@@ -88,6 +97,7 @@ bool CZMQNotificationInterface::Initialize()
     for (; i!=notifiers.end(); ++i)
     {
         CZMQAbstractNotifier *notifier = *i;
+        fSpentOutputs |= notifier->NeedsSpentOutputs();
         if (notifier->Initialize(pcontext))
         {
             LogPrint("zmq", "  Notifier %s ready (address = %s)\n", notifier->GetType(), notifier->GetAddress());
@@ -104,6 +114,7 @@ bool CZMQNotificationInterface::Initialize()
         return false;
     }
 
+    queue.Start();
     return true;
 }
 
@@ -111,6 +122,7 @@ bool CZMQNotificationInterface::Initialize()
 void CZMQNotificationInterface::Shutdown()
 {
     LogPrint("zmq", "zmq: Shutdown notification interface\n");
+    queue.Stop();
     if (pcontext)
     {
         for (std::list<CZMQAbstractNotifier*>::iterator i=notifiers.begin(); i!=notifiers.end(); ++i)
@@ -125,7 +137,7 @@ void CZMQNotificationInterface::Shutdown()
     }
 }
 
-void CZMQNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindex)
+void CZMQNotificationInterface::NotifyBlock(const CBlockIndex *pindex)
 {
     for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
     {
@@ -142,12 +154,8 @@ void CZMQNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindex)
     }
 }
 
-void CZMQNotificationInterface::BlockChecked(const CBlock& block, const CValidationState& state)
+void CZMQNotificationInterface::NotifyBlock(const CBlock& block)
 {
-    if (state.IsInvalid()) {
-        return;
-    }
-
     for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
     {
         CZMQAbstractNotifier *notifier = *i;
@@ -163,12 +171,12 @@ void CZMQNotificationInterface::BlockChecked(const CBlock& block, const CValidat
     }
 }
 
-void CZMQNotificationInterface::SyncTransaction(const CTransaction &tx, const CBlock *pblock)
+void CZMQNotificationInterface::NotifyTransaction(const CZMQTransactionNotification &notification)
 {
     for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
     {
         CZMQAbstractNotifier *notifier = *i;
-        if (notifier->NotifyTransaction(tx))
+        if (notifier->NotifyTransaction(notification))
         {
             i++;
         }
@@ -179,3 +187,55 @@ void CZMQNotificationInterface::SyncTransaction(const CTransaction &tx, const CB
         }
     }
 }
+
+// the notifiers are only called from the queue, so they never hold up validation, and what they need from the chain
+// or the mempool is looked up before a notification is queued, since validation may hold cs_main while it waits for
+// room in the queue
+
+void CZMQNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindex)
+{
+    queue.Push([this, pindex]() { NotifyBlock(pindex); });
+}
+
+void CZMQNotificationInterface::BlockChecked(const CBlock& block, const CValidationState& state)
+{
+    if (state.IsInvalid()) {
+        return;
+    }
+
+    std::shared_ptr<const CBlock> pblock = std::make_shared<const CBlock>(block);
+    queue.Push([this, pblock]() { NotifyBlock(*pblock); });
+}
+
+void CZMQNotificationInterface::SyncTransaction(const CTransaction &tx, const CBlock *pblock)
+{
+    std::shared_ptr<CZMQTransactionNotification> pnotification = std::make_shared<CZMQTransactionNotification>(tx);
+    if (pblock)
+    {
+        // the transactions of a block are synced one after the other, and its memory may be reused for the next
+        if (pblock != pLastBlock || pblock->hashMerkleRoot != lastBlockMerkleRoot)
+        {
+            pLastBlock = pblock;
+            lastBlockMerkleRoot = pblock->hashMerkleRoot;
+            lastBlockHash = pblock->GetHash();
+        }
+        pnotification->blockHash = lastBlockHash;
+        LOCK(cs_main);
+        pnotification->nHeight = chainActive.Height();
+    }
+    else if (fSpentOutputs && !tx.IsCoinBase())
+    {
+        LOCK2(cs_main, mempool.cs);
+        CCoinsViewMemPool view(pcoinsTip, mempool);
+        pnotification->spentOutputs.resize(tx.vin.size());
+        for (int i = 0; i < tx.vin.size(); i++)
+        {
+            CCoins coins;
+            if (view.GetCoins(tx.vin[i].prevout.hash, coins) && coins.IsAvailable(tx.vin[i].prevout.n))
+            {
+                pnotification->spentOutputs[i] = coins.vout[tx.vin[i].prevout.n];
+            }
+        }
+    }
+    queue.Push([this, pnotification]() { NotifyTransaction(*pnotification); });
+}
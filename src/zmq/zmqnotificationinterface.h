@@ -7,11 +7,13 @@
 
 #include "validationinterface.h"
 #include "consensus/validation.h"
+#include "notificationqueue.h"
 #include <string>
 #include <map>
 
 class CBlockIndex;
 class CZMQAbstractNotifier;
+struct CZMQTransactionNotification;
 
 class CZMQNotificationInterface : public CValidationInterface
 {
@@ -34,6 +36,17 @@ private:
 
     void *pcontext;
     std::list<CZMQAbstractNotifier*> notifiers;
+    bool fSpentOutputs;
+
+    // notifications are sent from here, and the hash of the last block confirming transactions is kept for its others
+    CNotificationQueue queue;
+    const CBlock *pLastBlock;
+    uint256 lastBlockMerkleRoot;
+    uint256 lastBlockHash;
+
+    void NotifyBlock(const CBlockIndex *pindex);
+    void NotifyBlock(const CBlock &block);
+    void NotifyTransaction(const CZMQTransactionNotification &notification);
 };
 
 #endif // BITCOIN_ZMQ_ZMQNOTIFICATIONINTERFACE_H
@@ -0,0 +1,416 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "zmqpbaasnotifier.h"
+
+#include "core_io.h"
+#include "key_io.h"
+#include "main.h"
+#include "pbaas/identity.h"
+#include "pbaas/notarization.h"
+#include "pbaas/pbaas.h"
+#include "pbaas/reserves.h"
+#include "subscriptionindex.h"
+#include "util.h"
+
+#include <boost/algorithm/string.hpp>
+
+// the least value an offer is posted with, DEFAULT_TRANSACTION_FEE, which is only defined in wallet builds
+static const CAmount MIN_OFFER_POSTING_VALUE = 10000;
+
+static const char *const pbaasTopicNames[] = {"pbaasidentity", "pbaascurrencystate", "pbaascrosschain", "pbaasnotarization", "pbaasoffer"};
+
+const char *GetPBaaSZMQTopicName(PBaaSZMQTopic topic)
+{
+    return pbaasTopicNames[topic];
+}
+
+// an output shaped like the first output of an offer posting, an identity commitment or update indexed by the offer
+// keys, and the keys it is indexed by
+static bool GetOfferPostingKeys(const CTxOut &out, std::set<uint160> &keys)
+{
+    COptCCParams p;
+    if (!out.scriptPubKey.IsPayToCryptoCondition(p) ||
+        !p.IsValid() ||
+        (p.evalCode != EVAL_IDENTITY_COMMITMENT && p.evalCode != EVAL_IDENTITY_PRIMARY) ||
+        out.nValue < MIN_OFFER_POSTING_VALUE ||
+        p.vData.size() < 2)
+    {
+        return false;
+    }
+    COptCCParams master(p.vData.back());
+    if (master.vKeys.size() < 2)
+    {
+        return false;
+    }
+    for (auto &oneKey : master.vKeys)
+    {
+        keys.insert(GetDestinationID(oneKey));
+    }
+    GetSubscriptionKeys(out, keys);
+    return true;
+}
+
+static UniValue NewEvent(const std::string &type, const CTransaction &tx, int n)
+{
+    UniValue event(UniValue::VOBJ);
+    event.push_back(Pair("type", type));
+    event.push_back(Pair("txid", tx.GetHash().GetHex()));
+    event.push_back(Pair("vout", n));
+    return event;
+}
+
+bool CZMQPublishPBaaSNotifier::Initialize(void *pcontext)
+{
+    fBatch = GetBoolArg("-zmqpbaasbatch", false);
+
+    // the offer keys of each identity or currency are included, so that its offers pass the filter as well
+    filterKeys.clear();
+    std::vector<std::string> vFilter;
+    boost::split(vFilter, GetArg("-zmqpbaasfilter", ""), boost::is_any_of(","));
+    for (auto &oneName : vFilter)
+    {
+        boost::trim(oneName);
+        if (oneName.empty())
+        {
+            continue;
+        }
+        CTxDestination dest = DecodeDestination(oneName);
+        if (!IsValidDestination(dest) && oneName.back() != '@')
+        {
+            dest = DecodeDestination(oneName + "@");
+        }
+        if (!IsValidDestination(dest))
+        {
+            LogPrintf("zmq: Ignoring invalid -zmqpbaasfilter entry %s\n", oneName);
+            continue;
+        }
+        uint160 id = GetDestinationID(dest);
+        filterKeys.insert(id);
+        filterKeys.insert(COnChainOffer::OnChainIdentityOfferKey(id));
+        filterKeys.insert(COnChainOffer::OnChainCurrencyOfferKey(id));
+        filterKeys.insert(COnChainOffer::OnChainOfferForIdentityKey(id));
+        filterKeys.insert(COnChainOffer::OnChainOfferForCurrencyKey(id));
+    }
+
+    return CZMQAbstractPublishNotifier::Initialize(pcontext);
+}
+
+bool CZMQPublishPBaaSNotifier::IsFiltered(const std::set<uint160> &keys) const
+{
+    if (filterKeys.empty())
+    {
+        return false;
+    }
+    for (auto &oneKey : keys)
+    {
+        if (filterKeys.count(oneKey))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void CZMQPublishPBaaSNotifier::GetEvents(const CZMQTransactionNotification &notification, UniValue &events)
+{
+    if (topic == PBAAS_ZMQ_OFFER)
+    {
+        GetOfferEvents(notification, events);
+        return;
+    }
+
+    const CTransaction &tx = notification.tx;
+    for (int i = 0; i < tx.vout.size(); i++)
+    {
+        COptCCParams p;
+        if (!tx.vout[i].scriptPubKey.IsPayToCryptoCondition(p) || !p.IsValid())
+        {
+            continue;
+        }
+
+        std::set<uint160> keys;
+        UniValue event;
+        switch (topic)
+        {
+            case PBAAS_ZMQ_IDENTITY:
+            {
+                if (p.evalCode != EVAL_IDENTITY_PRIMARY)
+                {
+                    continue;
+                }
+                CIdentity identity(tx.vout[i].scriptPubKey);
+                if (!identity.IsValid())
+                {
+                    continue;
+                }
+                event = NewEvent("identityupdated", tx, i);
+                event.push_back(Pair("identity", identity.ToUniValue()));
+                break;
+            }
+
+            case PBAAS_ZMQ_CURRENCYSTATE:
+            {
+                CCoinbaseCurrencyState currencyState;
+                if (p.evalCode == EVAL_CURRENCYSTATE && p.vData.size())
+                {
+                    currencyState = CCoinbaseCurrencyState(p.vData[0]);
+                }
+                else if (p.evalCode == EVAL_EARNEDNOTARIZATION || p.evalCode == EVAL_ACCEPTEDNOTARIZATION)
+                {
+                    CPBaaSNotarization notarization(tx.vout[i].scriptPubKey);
+                    if (notarization.IsValid())
+                    {
+                        currencyState = notarization.currencyState;
+                    }
+                }
+                if (!currencyState.IsValid())
+                {
+                    continue;
+                }
+                keys.insert(currencyState.GetID());
+                event = NewEvent("currencystate", tx, i);
+                event.push_back(Pair("currencystate", currencyState.ToUniValue()));
+                break;
+            }
+
+            case PBAAS_ZMQ_CROSSCHAIN:
+            {
+                if (p.evalCode == EVAL_CROSSCHAIN_EXPORT)
+                {
+                    CCrossChainExport ccx(tx.vout[i].scriptPubKey);
+                    if (!ccx.IsValid())
+                    {
+                        continue;
+                    }
+                    keys.insert(ccx.sourceSystemID);
+                    keys.insert(ccx.destSystemID);
+                    event = NewEvent("exportcreated", tx, i);
+                    event.push_back(Pair("export", ccx.ToUniValue()));
+                }
+                else if (p.evalCode == EVAL_CROSSCHAIN_IMPORT)
+                {
+                    CCrossChainImport cci(tx.vout[i].scriptPubKey);
+                    if (!cci.IsValid())
+                    {
+                        continue;
+                    }
+                    keys.insert(cci.sourceSystemID);
+                    event = NewEvent("importcreated", tx, i);
+                    event.push_back(Pair("import", cci.ToUniValue()));
+                }
+                else
+                {
+                    continue;
+                }
+                break;
+            }
+
+            case PBAAS_ZMQ_NOTARIZATION:
+            {
+                if (p.evalCode != EVAL_FINALIZE_NOTARIZATION)
+                {
+                    continue;
+                }
+                CObjectFinalization finalization(tx.vout[i].scriptPubKey);
+                if (!finalization.IsValid() || !finalization.IsConfirmed())
+                {
+                    continue;
+                }
+                keys.insert(finalization.currencyID);
+                event = NewEvent("notarizationconfirmed", tx, i);
+                event.push_back(Pair("finalization", finalization.ToUniValue()));
+                break;
+            }
+
+            default:
+                continue;
+        }
+
+        GetSubscriptionKeys(tx.vout[i], keys);
+        if (!IsFiltered(keys))
+        {
+            events.push_back(event);
+        }
+    }
+}
+
+// an offer is opened by a posting whose first output is indexed by the offer keys and whose last output holds the
+// offer, and closed by any transaction that spends that first output, when it is taken or withdrawn
+void CZMQPublishPBaaSNotifier::GetOfferEvents(const CZMQTransactionNotification &notification, UniValue &events)
+{
+    const CTransaction &tx = notification.tx;
+    uint256 txid = tx.GetHash();
+    bool fConfirmed = !notification.blockHash.IsNull();
+
+    // the outputs spent by a mempool transaction are only in the coins view until it is confirmed, so the postings
+    // found among them are kept
+    std::vector<std::pair<uint256, std::vector<uint160>>> closedOffers;
+    if (!tx.IsCoinBase())
+    {
+        auto pendingIt = mapPendingOfferSpends.find(txid);
+        if (pendingIt != mapPendingOfferSpends.end())
+        {
+            closedOffers = pendingIt->second;
+            mapPendingOfferSpends.erase(pendingIt);
+        }
+        else
+        {
+            for (int i = 0; i < tx.vin.size(); i++)
+            {
+                const CTxIn &in = tx.vin[i];
+                if (in.prevout.n != 0)
+                {
+                    continue;
+                }
+                auto openIt = mapOpenOffers.find(in.prevout.hash);
+                std::set<uint160> keys;
+                if (openIt != mapOpenOffers.end())
+                {
+                    closedOffers.push_back(*openIt);
+                }
+                else if (i < notification.spentOutputs.size() && GetOfferPostingKeys(notification.spentOutputs[i], keys))
+                {
+                    closedOffers.push_back(std::make_pair(in.prevout.hash, std::vector<uint160>(keys.begin(), keys.end())));
+                }
+            }
+        }
+        if (!fConfirmed && !closedOffers.empty())
+        {
+            if (mapPendingOfferSpends.size() >= MAX_ZMQ_PENDING_OFFER_SPENDS)
+            {
+                mapPendingOfferSpends.erase(mapPendingOfferSpends.begin());
+            }
+            mapPendingOfferSpends[txid] = closedOffers;
+        }
+    }
+
+    for (auto &oneClosed : closedOffers)
+    {
+        if (fConfirmed)
+        {
+            mapOpenOffers.erase(oneClosed.first);
+        }
+        if (!IsFiltered(std::set<uint160>(oneClosed.second.begin(), oneClosed.second.end())))
+        {
+            UniValue event = NewEvent("offerclosed", tx, -1);
+            UniValue posting(UniValue::VOBJ);
+            posting.push_back(Pair("txid", oneClosed.first.GetHex()));
+            posting.push_back(Pair("voutnum", 0));
+            event.push_back(Pair("posting", posting));
+            events.push_back(event);
+        }
+    }
+
+    std::set<uint160> keys;
+    std::vector<CBaseChainObject *> opRetArray;
+    if (tx.vout.size() < 2 ||
+        !tx.vout.back().scriptPubKey.IsOpReturn() ||
+        !GetOfferPostingKeys(tx.vout[0], keys))
+    {
+        return;
+    }
+    opRetArray = RetrieveOpRetArray(tx.vout.back().scriptPubKey);
+    CTransaction offerTx;
+    bool isPartial = true;
+    if (opRetArray.size() == 1 && opRetArray[0]->objectType == CHAINOBJ_TRANSACTION_PROOF)
+    {
+        CPartialTransactionProof &offerTxProof = ((CChainObject<CPartialTransactionProof> *)(opRetArray[0]))->object;
+        if (!offerTxProof.IsValid() || offerTxProof.GetPartialTransaction(offerTx, &isPartial).IsNull())
+        {
+            isPartial = true;
+        }
+    }
+    DeleteOpRetObjects(opRetArray);
+    if (isPartial || offerTx.vin.size() != 1)
+    {
+        return;
+    }
+
+    if (fConfirmed)
+    {
+        if (mapOpenOffers.size() >= MAX_ZMQ_OPEN_OFFERS)
+        {
+            mapOpenOffers.erase(mapOpenOffers.begin());
+        }
+        mapOpenOffers[txid] = std::vector<uint160>(keys.begin(), keys.end());
+    }
+    if (!IsFiltered(keys))
+    {
+        UniValue event = NewEvent("offeropened", tx, 0);
+        UniValue offer(UniValue::VOBJ);
+        TxToUniv(offerTx, uint256(), offer);
+        event.push_back(Pair("offer", offer));
+        events.push_back(event);
+    }
+}
+
+bool CZMQPublishPBaaSNotifier::Publish(const UniValue &message)
+{
+    std::string strMessage = message.write();
+    return SendMessage(GetPBaaSZMQTopicName(topic), strMessage.data(), strMessage.size());
+}
+
+bool CZMQPublishPBaaSNotifier::FlushBatch()
+{
+    if (batchEvents.empty())
+    {
+        return true;
+    }
+    LogPrint("zmq", "zmq: Publish %s batch of %u for block %s\n", GetPBaaSZMQTopicName(topic), batchEvents.size(), batchBlockHash.GetHex());
+    UniValue message(UniValue::VOBJ);
+    message.push_back(Pair("blockhash", batchBlockHash.GetHex()));
+    message.push_back(Pair("height", batchHeight));
+    message.push_back(Pair("events", batchEvents));
+    batchEvents = UniValue(UniValue::VARR);
+    return Publish(message);
+}
+
+bool CZMQPublishPBaaSNotifier::NotifyBlock(const CBlockIndex *pindex)
+{
+    return FlushBatch();
+}
+
+bool CZMQPublishPBaaSNotifier::NotifyTransaction(const CZMQTransactionNotification &notification)
+{
+    UniValue events(UniValue::VARR);
+    GetEvents(notification, events);
+    if (events.empty())
+    {
+        return true;
+    }
+
+    // unconfirmed transactions are published at height -1 as they arrive, and again when they are confirmed
+    const uint256 &blockHash = notification.blockHash;
+    int height = notification.nHeight;
+    const CTransaction &transaction = notification.tx;
+
+    if (!blockHash.IsNull() && fBatch)
+    {
+        if (blockHash != batchBlockHash && !FlushBatch())
+        {
+            return false;
+        }
+        batchBlockHash = blockHash;
+        batchHeight = height;
+        for (int i = 0; i < events.size(); i++)
+        {
+            batchEvents.push_back(events[i]);
+        }
+        return true;
+    }
+
+    for (int i = 0; i < events.size(); i++)
+    {
+        UniValue event = events[i];
+        event.push_back(Pair("blockhash", blockHash.IsNull() ? "" : blockHash.GetHex()));
+        event.push_back(Pair("height", height));
+        LogPrint("zmq", "zmq: Publish %s %s for %s\n", GetPBaaSZMQTopicName(topic), find_value(event, "type").get_str(), transaction.GetHash().GetHex());
+        if (!Publish(event))
+        {
+            return false;
+        }
+    }
+    return true;
+}
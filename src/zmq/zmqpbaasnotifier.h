@@ -0,0 +1,77 @@
+// Copyright (c) 2026 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef BITCOIN_ZMQ_ZMQPBAASNOTIFIER_H
+#define BITCOIN_ZMQ_ZMQPBAASNOTIFIER_H
+
+#include "zmqpublishnotifier.h"
+#include "uint256.h"
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include <univalue.h>
+
+/** Offer postings remembered so that a transaction spending one can be published as closing it */
+static const size_t MAX_ZMQ_OPEN_OFFERS = 100000;
+/** Mempool transactions whose closed offers are remembered for when they are confirmed */
+static const size_t MAX_ZMQ_PENDING_OFFER_SPENDS = 50000;
+
+enum PBaaSZMQTopic
+{
+    PBAAS_ZMQ_IDENTITY,             // identity definitions and updates
+    PBAAS_ZMQ_CURRENCYSTATE,        // currency states, on their own or as part of a notarization
+    PBAAS_ZMQ_CROSSCHAIN,           // exports and imports
+    PBAAS_ZMQ_NOTARIZATION,         // confirmed notarizations
+    PBAAS_ZMQ_OFFER                 // offers opened and closed
+};
+
+const char *GetPBaaSZMQTopicName(PBaaSZMQTopic topic);
+
+/**
+ * Publishes the PBaaS objects of one topic decoded as JSON, so that subscribers do not need to decode every raw
+ * transaction to find them. Only objects for the identities and currencies given by -zmqpbaasfilter are published, if
+ * it is set. With -zmqpbaasbatch, the events of a block are published together as one message once it is connected.
+ */
+class CZMQPublishPBaaSNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    CZMQPublishPBaaSNotifier(PBaaSZMQTopic Topic) : topic(Topic), fBatch(false), batchHeight(-1), batchEvents(UniValue::VARR) {}
+
+    bool Initialize(void *pcontext);
+
+    bool NotifyBlock(const CBlockIndex *pindex);
+    bool NotifyTransaction(const CZMQTransactionNotification &notification);
+
+    bool NeedsSpentOutputs() const { return topic == PBAAS_ZMQ_OFFER; }
+
+private:
+    PBaaSZMQTopic topic;
+    std::set<uint160> filterKeys;   // no keys publishes everything
+    bool fBatch;
+
+    uint256 batchBlockHash;
+    int batchHeight;
+    UniValue batchEvents;
+
+    // offer postings seen and the keys they are indexed by, and the postings closed by mempool transactions
+    std::map<uint256, std::vector<uint160>> mapOpenOffers;
+    std::map<uint256, std::vector<std::pair<uint256, std::vector<uint160>>>> mapPendingOfferSpends;
+
+    bool IsFiltered(const std::set<uint160> &keys) const;
+    void GetEvents(const CZMQTransactionNotification &notification, UniValue &events);
+    void GetOfferEvents(const CZMQTransactionNotification &notification, UniValue &events);
+    bool Publish(const UniValue &message);
+    bool FlushBatch();
+};
+
+template <PBaaSZMQTopic T>
+class CZMQPublishPBaaSTopicNotifier : public CZMQPublishPBaaSNotifier
+{
+public:
+    CZMQPublishPBaaSTopicNotifier() : CZMQPublishPBaaSNotifier(T) {}
+};
+
+#endif // BITCOIN_ZMQ_ZMQPBAASNOTIFIER_H
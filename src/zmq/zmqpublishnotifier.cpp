@@ -168,10 +168,10 @@ bool CZMQPublishRawBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
 {
     LogPrint("zmq", "zmq: Publish rawblock %s\n", pindex->GetBlockHash().GetHex());
 
+    // this runs on the notification queue without cs_main, which the position of a connected block does not need
     const Consensus::Params& consensusParams = Params().GetConsensus();
     CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
     {
-        LOCK(cs_main);
         CBlock block;
         if(!ReadBlockFromDisk(block, pindex, consensusParams, 1))
         {
@@ -190,10 +190,7 @@ bool CZMQPublishCheckedBlockNotifier::NotifyBlock(const CBlock& block)
     LogPrint("zmq", "zmq: Publish checkedblock %s\n", block.GetHash().GetHex());
 
     CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-    {
-        LOCK(cs_main);
-        ss << block;
-    }
+    ss << block;
 
     return SendMessage(MSG_CHECKEDBLOCK, &(*ss.begin()), ss.size());
 }